@@ -19,6 +19,8 @@ typedef enum ni_autoip_state {
 
 typedef struct ni_autoip_device		ni_autoip_device_t;
 
+#define NI_AUTOIP_CANDIDATES_MAX	8
+
 struct ni_autoip_device {
 	ni_autoip_device_t *	next;
 	unsigned int		users;
@@ -39,6 +41,12 @@ struct ni_autoip_device {
 
 	struct {
 	    struct in_addr	candidate;
+	    struct {
+		unsigned int	seed;
+		unsigned int	next;
+		unsigned int	count;
+		struct in_addr	addr[NI_AUTOIP_CANDIDATES_MAX];
+	    } candidates;
 	    ni_arp_verify_t	verify;
 	    unsigned int	nconflicts;
 	    struct timeval	last_defense;
@@ -17,6 +17,7 @@
 #include <wicked/route.h>
 #include <wicked/logging.h>
 #include "autoip.h"
+#include "appconfig.h"
 
 /* The IPv4LL address range is 169.254.1.0 to 169.254.254.255 inclusive */
 #define IPV4LL_ADDRESS_FIRST		0xA9FE0100
@@ -38,8 +39,10 @@ static ni_autoip_event_handler_t *	ni_autoip_fsm_event_handler;
 
 extern int	ni_autoip_device_get_address(ni_autoip_device_t *, struct in_addr *);
 static int	ni_autoip_send_arp(ni_autoip_device_t *);
+static void	ni_autoip_fsm_claimed(ni_autoip_device_t *);
 static void	ni_autoip_fsm_set_timeout(ni_autoip_device_t *, ni_timeout_t, ni_timeout_t);
 static void	__ni_autoip_fsm_timeout(void *, const ni_timer_t *);
+static int	ni_autoip_arp_socket_open(ni_autoip_device_t *);
 
 
 void
@@ -56,11 +59,87 @@ ni_autoip_send_event(enum ni_lease_event ev, const ni_autoip_device_t *dev,
 		ni_autoip_fsm_event_handler(ev, dev, lease);
 }
 
+/*
+ * RFC 3927, Section 2.1:
+ * The pseudo-random number generation algorithm MUST be chosen so
+ * that different hosts do not generate the same sequence of numbers.
+ * If the host has access to persistent information that is different
+ * for each host, such as its IEEE 802 MAC address, then the pseudo-
+ * random number generator SHOULD be seeded using a value derived
+ * from this information.
+ *
+ * We derive the seed from the hardware address and precompute a
+ * small batch of candidates, so a conflict does not need another
+ * roundtrip through the global random() state, which is shared by
+ * all the devices we claim an address on.
+ */
+static void
+ni_autoip_fsm_fill_candidates(ni_autoip_device_t *dev)
+{
+	const ni_hwaddr_t *hwa = &dev->devinfo.hwaddr;
+	unsigned int i;
+
+	if (dev->autoip.candidates.seed == 0) {
+		unsigned int seed = 2166136261U;
+
+		for (i = 0; i < hwa->len; ++i)
+			seed = (seed ^ hwa->data[i]) * 16777619U;
+		if (hwa->len == 0)
+			seed ^= random();
+		dev->autoip.candidates.seed = seed ? seed : 1;
+	}
+
+	for (i = 0; i < NI_AUTOIP_CANDIDATES_MAX; ++i) {
+		unsigned int r = rand_r(&dev->autoip.candidates.seed);
+
+		dev->autoip.candidates.addr[i].s_addr =
+			htonl(IPV4LL_ADDRESS_FIRST + (r % IPV4LL_ADDRESS_RANGE));
+	}
+	dev->autoip.candidates.count = NI_AUTOIP_CANDIDATES_MAX;
+	dev->autoip.candidates.next = 0;
+}
+
+/*
+ * Skip candidates another of our devices is probing or claimed
+ * already -- when several interfaces share the same link, each
+ * would see the probes of the other ones as a conflict.
+ */
+static ni_bool_t
+ni_autoip_fsm_candidate_in_use(const ni_autoip_device_t *self, struct in_addr addr)
+{
+	const ni_autoip_device_t *dev;
+
+	for (dev = ni_autoip_active; dev; dev = dev->next) {
+		if (dev == self || dev->fsm.state == NI_AUTOIP_STATE_INIT)
+			continue;
+		if (dev->autoip.candidate.s_addr == addr.s_addr)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static struct in_addr
+ni_autoip_fsm_next_candidate(ni_autoip_device_t *dev)
+{
+	struct in_addr addr;
+	unsigned int tries = 2 * NI_AUTOIP_CANDIDATES_MAX;
+
+	do {
+		if (dev->autoip.candidates.next >= dev->autoip.candidates.count)
+			ni_autoip_fsm_fill_candidates(dev);
+
+		addr = dev->autoip.candidates.addr[dev->autoip.candidates.next++];
+	} while (ni_autoip_fsm_candidate_in_use(dev, addr) && --tries);
+
+	return addr;
+}
+
 int
 ni_autoip_fsm_select(ni_autoip_device_t *dev)
 {
 	ni_address_t *ap;
 	const ni_config_arp_t *arpcfg;
+	ni_bool_t reclaim = FALSE;
 
 	/*
 	 * RFC 3927, Section 2.1:
@@ -78,8 +157,10 @@ ni_autoip_fsm_select(ni_autoip_device_t *dev)
 		dev->autoip.candidate = dev->lease->addrs->local_addr.sin.sin_addr;
 		ni_debug_autoip("%s: trying to reuse our previous address %s",
 				dev->ifname, inet_ntoa(dev->autoip.candidate));
+		reclaim = dev->autoip.nconflicts == 0 &&
+			ni_config_addrconf_auto4_fast_reclaim();
 	} else {
-		dev->autoip.candidate.s_addr = htonl(IPV4LL_ADDRESS_FIRST + (random() % IPV4LL_ADDRESS_RANGE));
+		dev->autoip.candidate = ni_autoip_fsm_next_candidate(dev);
 #if 0
 		if (dev->autoip.nconflicts == 0) {
 			ni_trace("DEBUG CODE ACTIVE");
@@ -100,6 +181,18 @@ ni_autoip_fsm_select(ni_autoip_device_t *dev)
 		return 0;
 	}
 
+	/*
+	 * With fast-reclaim, we take our previous address without to probe
+	 * for it first and defend it as usual on conflicts, which drop the
+	 * lease and send us back to select a new candidate.
+	 */
+	if (reclaim && ni_autoip_arp_socket_open(dev) == 0) {
+		ni_debug_autoip("%s: reclaiming our previous address %s without to probe",
+				dev->ifname, inet_ntoa(dev->autoip.candidate));
+		ni_autoip_fsm_claimed(dev);
+		return 0;
+	}
+
 	dev->fsm.state = NI_AUTOIP_STATE_CLAIMING;
 	/*
 	 * RFC 3927, Section 2.2.1:
@@ -256,17 +349,34 @@ ni_autoip_fsm_process_arp(ni_arp_socket_t *sock, const ni_arp_packet_t *pkt, voi
 	}
 }
 
-int
-ni_autoip_send_arp(ni_autoip_device_t *dev)
+static int
+ni_autoip_arp_socket_open(ni_autoip_device_t *dev)
 {
-	ni_timeout_t timeout;
-
 	if (dev->arp_socket == NULL) {
 		dev->arp_socket = ni_arp_socket_open(&dev->devinfo,
 				ni_autoip_fsm_process_arp, dev);
 		if (dev->arp_socket == NULL)
 			return -1;
 	}
+	return 0;
+}
+
+static void
+ni_autoip_fsm_claimed(ni_autoip_device_t *dev)
+{
+	dev->fsm.state = NI_AUTOIP_STATE_CLAIMED;
+	ni_autoip_fsm_commit_lease(dev, ni_autoip_fsm_build_lease(dev));
+	dev->autoip.nconflicts = 0;
+	timerclear(&dev->autoip.last_defense);
+}
+
+int
+ni_autoip_send_arp(ni_autoip_device_t *dev)
+{
+	ni_timeout_t timeout;
+
+	if (ni_autoip_arp_socket_open(dev) < 0)
+		return -1;
 
 	switch (ni_arp_verify_send(dev->arp_socket, &dev->autoip.verify, &timeout)) {
 	case NI_ARP_SEND_PROGRESS:
@@ -277,10 +387,7 @@ ni_autoip_send_arp(ni_autoip_device_t *dev)
 		return -1;
 	case NI_ARP_SEND_COMPLETE:
 	default:
-		dev->fsm.state = NI_AUTOIP_STATE_CLAIMED;
-		ni_autoip_fsm_commit_lease(dev, ni_autoip_fsm_build_lease(dev));
-		dev->autoip.nconflicts = 0;
-		timerclear(&dev->autoip.last_defense);
+		ni_autoip_fsm_claimed(dev);
 		return 0;
 	}
 }
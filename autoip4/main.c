@@ -453,6 +453,7 @@ autoip4_supplicant(void)
 
 	autoip4_device_destroy_all(autoip4_dbus_server);
 	ni_dbus_objects_garbage_collect();
+	ni_addrconf_lease_file_flush();
 
 	ni_socket_deactivate_all();
 }
@@ -2639,6 +2639,8 @@ __ni_compat_generate_ipv6_devconf(xml_node_t *ifnode, const ni_ipv6_devinfo_t *i
 		xml_node_new_element("accept-dad", node,
 				ni_ipv6_devconf_accept_dad_to_name(ipv6->conf.accept_dad));
 	}
+	__ni_compat_optional_tristate("optimistic-dad", node,
+						ipv6->conf.optimistic_dad);
 	__ni_compat_optional_tristate("accept-redirects", node,
 						ipv6->conf.accept_redirects);
 
@@ -2676,10 +2678,8 @@ ni_compat_generate_ethtool_link_advertise(xml_node_t *parent, const ni_bitfield_
 		return FALSE;
 
 	bits = ni_bitfield_bits(bitfield);
-	for (bit = 0; bit < bits; ++bit) {
-		if (!ni_bitfield_testbit(bitfield, bit))
-			continue;
-
+	for (bit = ni_bitfield_next_set(bitfield, 0); bit < bits;
+	     bit = ni_bitfield_next_set(bitfield, bit + 1)) {
 		if ((name = ni_ethtool_link_adv_name(bit)))
 			xml_node_new_element("mode", node, name);
 		else
@@ -2876,13 +2876,18 @@ ni_compat_generate_ifnode_content(xml_node_t *ifnode, const ni_compat_netdev_t *
 				ni_format_boolean(control->usercontrol));
 		}
 
-		if (control->link_timeout || control->link_priority || ni_tristate_is_set(control->link_required)) {
+		if (control->link_timeout || control->link_priority || control->link_parallel ||
+		    ni_tristate_is_set(control->link_required)) {
 			linkdet = xml_node_create(child, "link-detection");
 			if (linkdet) {
 				if (ni_tristate_is_set(control->link_required)) {
 					xml_node_new_element("require-link", linkdet,
 						ni_format_boolean(ni_tristate_is_enabled(control->link_required)));
 				}
+				if (control->link_parallel) {
+					xml_node_new_element("parallel", linkdet,
+						ni_format_boolean(control->link_parallel));
+				}
 				if (control->link_timeout) {
 					xml_node_new_element("timeout", linkdet,
 						ni_sprint_timeout(control->link_timeout));
@@ -27,22 +27,34 @@
 #include "config.h"
 #endif
 
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <fcntl.h>
+#include <errno.h>
 
 #include <wicked/types.h>
 #include <wicked/logging.h>
 #include <wicked/util.h>
 #include <wicked/xml.h>
+#include <wicked/time.h>
 
 #include "appconfig.h"
 #include "read-config.h"
 #include "wicked-client.h"
 #include "client/ifconfig.h"
 
+/*
+ * Writing the files of a large ifcfg tree into a directory is spread
+ * over forked writer processes, each one for at least JOB_FILES files.
+ */
+#define NI_WICKED_CONVERT_JOBS_MAX	8
+#define NI_WICKED_CONVERT_JOB_FILES	64
 
 static ni_bool_t
 ni_wicked_convert_match_config(xml_node_t *node, const char *match)
@@ -189,13 +201,111 @@ ni_wicked_convert_to_file(xml_document_array_t *docs, ni_string_array_t *filter,
 	return NI_WICKED_RC_SUCCESS;
 }
 
+static ni_bool_t
+ni_wicked_convert_write_node(const xml_node_t *node, const char *filename)
+{
+	int fd, ret;
+
+	if ((fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)) < 0) {
+		ni_error("unable to open '%s' for writing: %m", filename);
+		return FALSE;
+	}
+
+	ret = xml_node_write_fd(node, fd);
+	if (close(fd) < 0 || ret < 0) {
+		ni_error("unable to write '%s': %m", filename);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static ni_bool_t
+ni_wicked_convert_write_files(const ni_var_array_t *files, const xml_node_array_t *nodes,
+				unsigned int first, unsigned int step)
+{
+	ni_bool_t ret = TRUE;
+	unsigned int i;
+
+	for (i = first; i < files->count; i += step) {
+		if (!ni_wicked_convert_write_node(nodes->data[i], files->data[i].name))
+			ret = FALSE;
+	}
+	return ret;
+}
+
+static unsigned int
+ni_wicked_convert_jobs(unsigned int jobs, unsigned int count)
+{
+	long cpus;
+
+	if (!jobs) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		jobs = cpus > 0 ? cpus : 1;
+	}
+	jobs = min_t(unsigned int, jobs, NI_WICKED_CONVERT_JOBS_MAX);
+	jobs = min_t(unsigned int, jobs, count / NI_WICKED_CONVERT_JOB_FILES);
+	return jobs > 1 ? jobs : 1;
+}
+
+static ni_bool_t
+ni_wicked_convert_write_parallel(const ni_var_array_t *files, const xml_node_array_t *nodes,
+				unsigned int jobs)
+{
+	pid_t pids[NI_WICKED_CONVERT_JOBS_MAX];
+	unsigned int i, n, started = 0;
+	ni_bool_t ret = TRUE;
+	int status;
+
+	if (jobs <= 1)
+		return ni_wicked_convert_write_files(files, nodes, 0, 1);
+
+	/* don't duplicate pending output in the writers */
+	fflush(stdout);
+	fflush(stderr);
+
+	for (n = 0; n < jobs; ++n) {
+		pids[n] = fork();
+		if (pids[n] == 0)
+			_exit(ni_wicked_convert_write_files(files, nodes, n, jobs) ? 0 : 1);
+		if (pids[n] < 0) {
+			ni_warn("unable to fork convert writer: %m");
+			break;
+		}
+		started++;
+	}
+
+	/* write the files of the writers we were unable to start */
+	for (i = started; i < jobs; ++i) {
+		if (!ni_wicked_convert_write_files(files, nodes, i, jobs))
+			ret = FALSE;
+	}
+
+	for (n = 0; n < started; ++n) {
+		while (waitpid(pids[n], &status, 0) < 0) {
+			if (errno != EINTR) {
+				status = -1;
+				break;
+			}
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			ret = FALSE;
+	}
+	return ret;
+}
+
 static int
-ni_wicked_convert_to_dir(xml_document_array_t *docs, ni_string_array_t *filter, const char *dirname)
+ni_wicked_convert_to_dir(xml_document_array_t *docs, ni_string_array_t *filter,
+			const char *dirname, unsigned int jobs)
 {
+	xml_node_array_t nodes = XML_NODE_ARRAY_INIT;
+	ni_var_array_t files = NI_VAR_ARRAY_INIT;
+	struct timeval begin, end, delta;
+	int status = NI_WICKED_RC_SUCCESS;
+	unsigned int i, pos, count = 0;
 	char *filename = NULL;
-	unsigned int i;
-	FILE *output;
+	ni_var_t *file;
 
+	ni_timer_get_time(&begin);
 	for (i = 0; i < docs->count; i++) {
 		xml_document_t *doc = docs->data[i];
 		xml_node_t *root = xml_document_root(doc);
@@ -208,21 +318,43 @@ ni_wicked_convert_to_dir(xml_document_array_t *docs, ni_string_array_t *filter,
 			if (!ni_wicked_convert_match(node, filter))
 				continue;
 
-			if (!ni_wicked_convert_node_filename(&filename, node, dirname))
-				return NI_WICKED_RC_ERROR;
+			if (!ni_wicked_convert_node_filename(&filename, node, dirname)) {
+				status = NI_WICKED_RC_ERROR;
+				goto cleanup;
+			}
 
-			if (!(output = fopen(filename, "w"))) {
-				ni_error("unable to open '%s' for writing: %m", filename);
-				ni_string_free(&filename);
-				return NI_WICKED_RC_ERROR;
+			/*
+			 * The last node with the same file name wins as when
+			 * the files were written one after another.
+			 */
+			if ((file = ni_var_array_get(&files, filename))) {
+				pos = file - files.data;
+				xml_node_free(nodes.data[pos]);
+				nodes.data[pos] = xml_node_clone_ref(node);
+			} else {
+				ni_var_array_append(&files, filename, NULL);
+				xml_node_array_append(&nodes, node);
 			}
 			ni_string_free(&filename);
-
-			xml_node_print(node, output);
-			fclose(output);
+			count++;
 		}
 	}
-	return NI_WICKED_RC_SUCCESS;
+
+	jobs = ni_wicked_convert_jobs(jobs, files.count);
+	if (!ni_wicked_convert_write_parallel(&files, &nodes, jobs))
+		status = NI_WICKED_RC_ERROR;
+
+	ni_timer_get_time(&end);
+	timersub(&end, &begin, &delta);
+	ni_info("converted %u configs into %u files in '%s' using %u writer%s in %ld.%03ld sec",
+			count, files.count, dirname, jobs, jobs == 1 ? "" : "s",
+			(long)delta.tv_sec, (long)delta.tv_usec / 1000);
+
+cleanup:
+	ni_string_free(&filename);
+	xml_node_array_destroy(&nodes);
+	ni_var_array_destroy(&files);
+	return status;
 }
 
 static ni_bool_t
@@ -271,12 +403,14 @@ ni_wicked_convert(const char *caller, int argc, char **argv)
 		OPT_IFCONFIG	= 'i',
 		OPT_OUTPUT	= 'o',
 		OPT_RAW		= 'R',
+		OPT_JOBS	= 'j',
 	};
 	static struct option options[] = {
 		{ "help",	no_argument,		NULL, OPT_HELP		},
 		{ "ifconfig",	required_argument,	NULL, OPT_IFCONFIG	},
 		{ "output",	required_argument,	NULL, OPT_OUTPUT	},
 		{ "raw",	no_argument,		NULL, OPT_RAW		},
+		{ "jobs",	required_argument,	NULL, OPT_JOBS		},
 		{ NULL }
 	};
 	xml_document_array_t docs = XML_DOCUMENT_ARRAY_INIT;
@@ -285,6 +419,7 @@ ni_wicked_convert(const char *caller, int argc, char **argv)
 	int opt, status = NI_WICKED_RC_USAGE;
 	const char *opt_output = NULL;
 	ni_bool_t opt_raw = FALSE;
+	unsigned int opt_jobs = 0;
 	char *program = NULL;
 	enum {
 		CONVERT_COMPAT,
@@ -303,7 +438,7 @@ ni_wicked_convert(const char *caller, int argc, char **argv)
 						argv[0] ? argv[0] : "convert");
 	argv[0] = program;
 	optind = 1;
-	while ((opt = getopt_long(argc, argv, "+hi:o:C:R", options, NULL)) != EOF) {
+	while ((opt = getopt_long(argc, argv, "+hi:o:C:Rj:", options, NULL)) != EOF) {
 		switch (opt) {
 		case OPT_HELP:
 			status = NI_WICKED_RC_SUCCESS;
@@ -320,6 +455,7 @@ ni_wicked_convert(const char *caller, int argc, char **argv)
 				"  --ifconfig <path>	read config from the specified sources\n"
 				"  --output   <path>	write output to specified file or directory\n"
 				"  --raw		do not display <client-state> tags\n"
+				"  --jobs <count>	number of processes writing an output directory\n"
 				"\n", program);
 			goto cleanup;
 
@@ -351,6 +487,11 @@ ni_wicked_convert(const char *caller, int argc, char **argv)
 			opt_raw = TRUE;
 			break;
 
+		case OPT_JOBS:
+			if (ni_parse_uint(optarg, &opt_jobs, 10) || !opt_jobs)
+				goto usage;
+			break;
+
 		}
 	}
 
@@ -433,7 +574,7 @@ ni_wicked_convert(const char *caller, int argc, char **argv)
 		ni_wicked_convert_dump(&docs, &filter, stdout);
 	} else
 	if (ni_isdir(opt_output)) {
-		status = ni_wicked_convert_to_dir(&docs, &filter, opt_output);
+		status = ni_wicked_convert_to_dir(&docs, &filter, opt_output, opt_jobs);
 	} else {
 		status = ni_wicked_convert_to_file(&docs, &filter, opt_output);
 	}
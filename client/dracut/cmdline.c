@@ -1118,6 +1118,29 @@ ni_dracut_cmdline_file_parse(ni_var_array_t *params, const char *filename)
 	return TRUE;
 }
 
+/**
+ * Parse the cmdline into the compat netdev array only, without to
+ * generate any config xml as used by the lean `wicked initrd` mode.
+ */
+ni_bool_t
+ni_dracut_cmdline_read_netdevs(ni_compat_netdev_array_t *netdevs, const char *path)
+{
+	ni_var_array_t params = NI_VAR_ARRAY_INIT;
+	xml_node_t *options;
+	ni_bool_t ret;
+
+	if (!netdevs || !(options = xml_node_new("options", NULL)))
+		return FALSE;
+
+	/* meta options are not used, but collected by the parser */
+	if ((ret = ni_dracut_cmdline_file_parse(&params, path)))
+		ni_dracut_cmdline_parse_params(&params, options, netdevs);
+
+	ni_var_array_destroy(&params);
+	xml_node_free(options);
+	return ret;
+}
+
 /** Main function, should read the dracut cmdline input and do mainly two things:
  *   - Parse the input and separate it in a string array where each string is exactly one config param
  *   - Construct the ni_compat_netdev struct
@@ -30,4 +30,7 @@ extern ni_bool_t	ni_ifconfig_read_dracut_cmdline(xml_document_array_t *,
 						ni_bool_t,
 						ni_bool_t);
 
+extern ni_bool_t	ni_dracut_cmdline_read_netdevs(ni_compat_netdev_array_t *,
+						const char *);
+
 #endif /* WICKED_CLIENT_DRACUT_CMDLINE_H */
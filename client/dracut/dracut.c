@@ -25,7 +25,9 @@
 #endif
 #include <wicked/types.h>
 #include <wicked/util.h>
+#include <wicked/netinfo.h>
 
+#include "client/wicked-client.h"
 #include "client/read-config.h"
 #include "client/dracut/dracut.h"
 #include "client/dracut/cmdline.h"
@@ -183,10 +183,8 @@ get_ethtool_link_adv_name_array(ni_string_array_t *array, ni_bitfield_t *bitfiel
 
 	count = array->count;
 	bits = ni_bitfield_bits(bitfield);
-	for (bit = 0; bit < bits; ++bit) {
-		if (!ni_bitfield_testbit(bitfield, bit))
-			continue;
-
+	for (bit = ni_bitfield_next_set(bitfield, 0); bit < bits;
+	     bit = ni_bitfield_next_set(bitfield, bit + 1)) {
 		if (!(name = bit_to_name(bit)))
 			continue;
 
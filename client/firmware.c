@@ -447,11 +447,33 @@ ni_netif_firmware_discovery_script_to_xml(xml_node_t *parent, const ni_script_ac
 	return TRUE;
 }
 
+static ni_bool_t
+ni_netif_firmware_discovery_builtin_to_xml(xml_node_t *parent, const ni_c_binding_t *binding)
+{
+	xml_node_t *node;
+
+	if (!parent || !binding)
+		return FALSE;
+
+	if (!(node = xml_node_new("builtin", parent)))
+		return FALSE;
+
+	xml_node_add_attr(node, "name", binding->name);
+	if (binding->library)
+		xml_node_add_attr(node, "library", binding->library);
+	xml_node_add_attr(node, "symbol", binding->symbol);
+	if (!binding->enabled)
+		xml_node_add_attr(node, "enabled", ni_format_boolean(binding->enabled));
+
+	return TRUE;
+}
+
 static ni_bool_t
 ni_netif_firmware_discovery_to_xml(xml_node_t *parent,
 		const ni_string_array_t *names, ni_bool_t expand)
 {
 	const ni_script_action_t *script;
+	const ni_c_binding_t *binding;
 	const ni_extension_t *ex;
 	xml_node_t *node;
 
@@ -476,7 +498,13 @@ ni_netif_firmware_discovery_to_xml(xml_node_t *parent,
 		if (!expand)
 			continue;
 
-		/* builtins are not supported in netif-firmware-discovery */
+		for (binding = ex->c_bindings; binding; binding = binding->next) {
+			if (ni_string_empty(binding->name) || ni_string_empty(binding->symbol))
+				continue;
+
+			if (!ni_netif_firmware_discovery_builtin_to_xml(node, binding))
+				return FALSE;
+		}
 
 		for (script = ex->actions; script; script = script->next) {
 			if (ni_string_empty(script->name) || !script->process)
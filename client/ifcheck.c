@@ -330,9 +330,13 @@ ni_do_ifcheck(int argc, char **argv)
 		}
 	}
 
-	if (!ni_ifconfig_load(fsm, opt_global_rootdir, &opt_ifconfig, TRUE, TRUE)) {
-		status = NI_WICKED_RC_NOT_CONFIGURED;
-		goto cleanup;
+	/* the checks need the config uuids only, use the index if valid */
+	if (!ni_ifconfig_load_uuid_index(fsm, opt_global_rootdir, &opt_ifconfig)) {
+		if (!ni_ifconfig_load(fsm, opt_global_rootdir, &opt_ifconfig, TRUE, TRUE)) {
+			status = NI_WICKED_RC_NOT_CONFIGURED;
+			goto cleanup;
+		}
+		ni_ifconfig_save_uuid_index(fsm, opt_global_rootdir, &opt_ifconfig);
 	}
 
 
@@ -342,7 +346,7 @@ ni_do_ifcheck(int argc, char **argv)
 		ni_uint_array_append(&checks, OPT_MISSED);
 	/* nmarked = 0; */
 	while (optind < argc) {
-		ni_ifworker_array_t marked = { 0, NULL };
+		ni_ifworker_array_t marked = NI_IFWORKER_ARRAY_INIT;
 		const char *ifname = argv[optind++];
 
 		ifmatch.name = ifname;
@@ -422,6 +426,7 @@ cleanup:
 	ni_string_array_destroy(&opt_ifconfig);
 	ni_string_array_destroy(&ifnames);
 	ni_uint_array_destroy(&checks);
+	ni_fsm_free(fsm);
 	return status;
 }
 
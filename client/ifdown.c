@@ -107,7 +107,7 @@ int
 ni_do_ifdown(int argc, char **argv)
 {
 	enum  { OPT_HELP, OPT_FORCE, OPT_DELETE, OPT_NO_DELETE, OPT_TIMEOUT,
-		OPT_RELEASE, OPT_NO_RELEASE	};
+		OPT_RELEASE, OPT_NO_RELEASE, OPT_BULK	};
 	static struct option ifdown_options[] = {
 		{ "help",	no_argument, NULL,		OPT_HELP },
 		{ "force",	required_argument, NULL,	OPT_FORCE },
@@ -116,6 +116,7 @@ ni_do_ifdown(int argc, char **argv)
 		{ "release",	no_argument, NULL,		OPT_RELEASE },
 		{ "no-release",	no_argument, NULL,		OPT_NO_RELEASE },
 		{ "timeout",	required_argument, NULL,	OPT_TIMEOUT },
+		{ "bulk",	no_argument, NULL,		OPT_BULK },
 		{ NULL }
 	};
 	ni_ifmatcher_t ifmatch;
@@ -126,6 +127,7 @@ ni_do_ifdown(int argc, char **argv)
 	unsigned int seconds = NI_IFWORKER_DEFAULT_TIMEOUT;
 	ni_stringbuf_t sb = NI_STRINGBUF_INIT_DYNAMIC;
 	ni_tristate_t opt_release = NI_TRISTATE_DEFAULT;
+	ni_bool_t opt_bulk = FALSE;
 	ni_fsm_t *fsm;
 	int c, status = NI_WICKED_RC_USAGE;
 
@@ -188,6 +190,10 @@ ni_do_ifdown(int argc, char **argv)
 			}
 			break;
 
+		case OPT_BULK:
+			opt_bulk = TRUE;
+			break;
+
 		default:
 		case OPT_HELP:
 usage:
@@ -207,7 +213,9 @@ usage:
 				"  --[no-]release\n"
 				"      Override active config to (not) release leases\n"
 				"  --timeout <sec>\n"
-				"      Timeout after <sec> seconds\n",
+				"      Timeout after <sec> seconds\n"
+				"  --bulk\n"
+				"      Delete virtual devices in one request without to deconfigure them first\n",
 				sb.string
 				);
 			ni_stringbuf_destroy(&sb);
@@ -277,6 +285,10 @@ usage:
 
 		/* Start workers to perform actual ifdown */
 		nmarked = ni_fsm_mark_matching_workers(fsm, &ifmarked, &ifmarker);
+
+		/* Delete the virtual devices, we'd delete anyway, at once */
+		if (nmarked && opt_bulk && max_state == NI_FSM_STATE_DEVICE_DOWN)
+			ni_fsm_delete_devices(fsm, &ifmarked);
 	}
 
 	if (nmarked == 0) {
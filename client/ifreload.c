@@ -34,11 +34,14 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <limits.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
 #include <wicked/fsm.h>
+#include <wicked/xml.h>
 
+#include "client/ifconfig.h"
 #include "wicked-client.h"
 #include "appconfig.h"
 #include "ifcheck.h"
@@ -174,6 +177,150 @@ ifreload_mark_down(const ni_fsm_t *fsm, ni_ifworker_array_t *marked, ni_ifworker
 	return TRUE;
 }
 
+/*
+ * Compare the config applied by nanny with the new interface config
+ * element by element. When only the address configuration changed,
+ * the up run alone reapplies it: wickedd adds and removes the changed
+ * addresses and routes, so neither an ifdown of the interface nor of
+ * the devices depending on it is needed.
+ */
+#define IFRELOAD_CONFIG_DIGEST_SIZE	20	/* SHA1 */
+
+static const char *	ifreload_addrconf_elements[] = {
+	"ipv4:static",	"ipv4:dhcp",	"ipv4:auto",
+	"ipv6:static",	"ipv6:dhcp",	"ipv6:auto",
+	NULL
+};
+
+static ni_bool_t
+ifreload_config_element_is_addrconf(const char *name)
+{
+	const char **ptr;
+
+	for (ptr = ifreload_addrconf_elements; *ptr; ++ptr) {
+		if (ni_string_eq(*ptr, name))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static ni_bool_t
+ifreload_config_element_equal(const xml_node_t *a, const xml_node_t *b)
+{
+	unsigned char da[IFRELOAD_CONFIG_DIGEST_SIZE];
+	unsigned char db[IFRELOAD_CONFIG_DIGEST_SIZE];
+
+	if (!a || !b)
+		return a == b;
+
+	if (xml_node_hash(a, NI_HASHCTX_SHA1, da, sizeof(da)) < 0 ||
+	    xml_node_hash(b, NI_HASHCTX_SHA1, db, sizeof(db)) < 0)
+		return FALSE;
+
+	return memcmp(da, db, sizeof(da)) == 0;
+}
+
+static ni_bool_t
+ifreload_config_element_unique(const xml_node_t *config, const xml_node_t *child)
+{
+	return xml_node_get_child(config, child->name) == child &&
+		!xml_node_get_next_child(config, child->name, child);
+}
+
+/*
+ * Returns TRUE when all elements differing between the applied
+ * and the new config are address configuration elements.
+ */
+static ni_bool_t
+ifreload_config_diff_addrconf_only(const ni_ifworker_t *w, const xml_node_t *applied,
+					const xml_node_t *config)
+{
+	const xml_node_t *a, *b;
+	unsigned int changed = 0;
+
+	for (a = applied->children; a; a = a->next) {
+		if (!ifreload_config_element_unique(applied, a))
+			return FALSE;
+
+		b = xml_node_get_child(config, a->name);
+		if (ifreload_config_element_equal(a, b))
+			continue;
+
+		if (!ifreload_config_element_is_addrconf(a->name))
+			return FALSE;
+
+		ni_debug_ifconfig("%s: config element <%s> %s", w->name,
+				a->name, b ? "modified" : "deleted");
+		changed++;
+	}
+
+	for (b = config->children; b; b = b->next) {
+		if (!ifreload_config_element_unique(config, b))
+			return FALSE;
+
+		if (xml_node_get_child(applied, b->name))
+			continue;
+
+		if (!ifreload_config_element_is_addrconf(b->name))
+			return FALSE;
+
+		ni_debug_ifconfig("%s: config element <%s> added", w->name, b->name);
+		changed++;
+	}
+
+	return changed > 0;
+}
+
+static xml_document_t *
+ifreload_applied_config_read(const ni_ifworker_t *w, const xml_node_t **applied)
+{
+	char path[PATH_MAX] = {'\0'};
+	xml_document_t *doc;
+	xml_node_t *policy;
+	char *pname;
+
+	if (!(pname = ni_ifpolicy_name_from_ifname(w->name)))
+		return NULL;
+
+	/* the policy file nanny saved when the config got applied */
+	snprintf(path, sizeof(path), "%s/nanny/%s.xml", ni_config_statedir(), pname);
+	ni_string_free(&pname);
+
+	if (!ni_file_exists(path) || !(doc = xml_document_read(path)))
+		return NULL;
+
+	policy = xml_node_get_child(xml_document_root(doc), NI_NANNY_IFPOLICY);
+	if (!policy || !(*applied = xml_node_get_child(policy, NI_NANNY_IFPOLICY_MERGE))) {
+		xml_document_free(doc);
+		return NULL;
+	}
+	return doc;
+}
+
+static ni_bool_t
+ifreload_config_addrconf_only(const ni_ifworker_t *w)
+{
+	const xml_node_t *applied = NULL;
+	xml_document_t *doc;
+	ni_bool_t ret;
+
+	if (!w->config.node || !w->device)
+		return FALSE;
+
+	if (!ni_ifcheck_device_configured(w->device))
+		return FALSE;
+
+	if (w->iftype != NI_IFTYPE_UNKNOWN && w->iftype != w->device->link.type)
+		return FALSE;
+
+	if (!(doc = ifreload_applied_config_read(w, &applied)))
+		return FALSE;
+
+	ret = ifreload_config_diff_addrconf_only(w, applied, w->config.node);
+	xml_document_free(doc);
+	return ret;
+}
+
 static void
 ifreload_mark_up_slave_deps(const ni_fsm_t *fsm, ni_ifworker_array_t *marked, ni_ifworker_t *master,
 				void (*logit)(const char *, ...) __fmtattr)
@@ -300,9 +447,30 @@ static void
 ifreload_mark_workers(const ni_fsm_t *fsm, ni_ifworker_array_t *down_marked, ni_ifworker_array_t *up_marked, const char *ifname)
 {
 	void (*logit)(const char *, ...) __fmtattr = ifname ? ni_note : ni_info;
+	ni_ifworker_array_t addrconf_only = NI_IFWORKER_ARRAY_INIT;
 	ni_ifworker_t *w;
 	unsigned int i;
 
+	/* address config changes only, applied by set-up without shutdown */
+	for (i = 0; i < fsm->workers.count; ++i) {
+		w = fsm->workers.data[i];
+
+		if (w->type != NI_IFWORKER_TYPE_NETDEV)
+			continue;
+
+		if (ifname && !ni_string_eq(w->name, ifname))
+			continue;
+
+		if (ni_ifcheck_worker_config_matches(w))
+			continue;
+
+		if (!ni_ifcheck_worker_config_exists(w) || !ni_ifcheck_worker_device_exists(w))
+			continue;
+
+		if (ifreload_config_addrconf_only(w))
+			ni_ifworker_array_append(&addrconf_only, w);
+	}
+
 	/* shutdown if config changed + dependencies */
 	for (i = 0; i < fsm->workers.count; ++i) {
 		w = fsm->workers.data[i];
@@ -313,6 +481,9 @@ ifreload_mark_workers(const ni_fsm_t *fsm, ni_ifworker_array_t *down_marked, ni_
 		if (ifname && !ni_string_eq(w->name, ifname))
 			continue;
 
+		if (ni_ifworker_array_index(&addrconf_only, w) != -1)
+			continue;
+
 		if (!ni_ifcheck_worker_config_matches(w))
 			ifreload_mark_down(fsm, down_marked, w, logit, 1);
 	}
@@ -327,9 +498,20 @@ ifreload_mark_workers(const ni_fsm_t *fsm, ni_ifworker_array_t *down_marked, ni_
 		if (ifname && !ni_string_eq(w->name, ifname))
 			continue;
 
+		if (ni_ifworker_array_index(&addrconf_only, w) != -1) {
+			if (ifreload_mark_add(up_marked, w)) {
+				ni_debug_ifconfig("marked %s for set-up (config: address changes only, "
+						"device: exists, target state %s)", w->name,
+						ni_ifworker_state_name(w->target_range.max));
+			}
+			continue;
+		}
+
 		if (!ni_ifcheck_worker_config_matches(w))
 			ifreload_mark_up(fsm, up_marked, w, logit);
 	}
+
+	ni_ifworker_array_destroy(&addrconf_only);
 }
 
 int
@@ -612,6 +794,7 @@ cleanup:
 	ni_string_array_destroy(&opt_ifconfig);
 	ni_ifworker_array_destroy(&down_marked);
 	ni_ifworker_array_destroy(&up_marked);
+	ni_fsm_free(fsm);
 	ni_string_free(&program);
 	argv[0] = saved_argv0;
 	return status;
@@ -33,6 +33,8 @@
 #include <stdarg.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <inttypes.h>
 #include <getopt.h>
 #include <net/if_arp.h>
 #include <netlink/netlink.h>
@@ -47,9 +49,14 @@
 #include <wicked/vlan.h>
 #include <wicked/fsm.h>
 #include <wicked/wireless.h>
+#include <wicked/objectmodel.h>
+#include <wicked/dbus-errors.h>
 
 #include "wicked-client.h"
+#include "client/client_state.h"
 #include "appconfig.h"
+#include "util_priv.h"
+#include "json.h"
 #include "ifcheck.h"
 #include "ifstatus.h"
 
@@ -684,11 +691,573 @@ ni_ifstatus_to_retcode(int status, ni_bool_t mandatory)
 	}
 }
 
+static int
+ni_ifstatus_result_code(int status, const ni_uint_array_t *stcodes,
+			const ni_uint_array_t *stflags, ni_bool_t multiple,
+			ni_bool_t opt_transient)
+{
+	unsigned int i;
+
+	if (!stcodes->count) {
+		if (status == NI_WICKED_ST_OK) {
+			status = NI_WICKED_ST_UNUSED;
+		}
+	} else
+	if (!multiple) {
+		status = stcodes->data[0];
+		if (!opt_transient) {
+			switch (status) {
+			case NI_WICKED_ST_NO_DEVICE:
+			case NI_WICKED_ST_UNCONFIGURED:
+			case NI_WICKED_ST_NOT_RUNNING:
+			case NI_WICKED_ST_IN_PROGRESS:
+			case NI_WICKED_ST_NO_CARRIER:
+				break;
+			default:
+				status = NI_WICKED_ST_OK;
+				break;
+			}
+		}
+	} else
+	for (i = 0; i < stcodes->count && i < stflags->count; ++i) {
+		unsigned int st = stcodes->data[i];
+		unsigned int fl = stflags->data[i];
+		int rc = ni_ifstatus_to_retcode(st, fl);
+		if (rc == NI_WICKED_ST_FAILED)
+			status = rc;
+	}
+	return status;
+}
+
+/*
+ * Brief status of the existing devices from one InterfaceList.getStatus
+ * summary query -- without loading the schema, refreshing the objects
+ * and reading the configuration. Used by frequent status polling.
+ */
+static ni_netdev_t *
+ni_ifstatus_summary_device(const ni_dbus_variant_t *dict)
+{
+	const ni_dbus_variant_t *leases, *entry;
+	ni_addrconf_lease_t *lease;
+	ni_client_state_t *cs;
+	const char *name = NULL;
+	const char *str = NULL;
+	uint32_t u32, family, type;
+	ni_netdev_t *dev;
+	dbus_bool_t bv;
+	unsigned int i;
+
+	if (!ni_dbus_dict_get_string(dict, "name", &name) || ni_string_empty(name) ||
+	    !ni_dbus_dict_get_uint32(dict, "index", &u32))
+		return NULL;
+
+	if (!(dev = ni_netdev_new(name, u32)))
+		return NULL;
+
+	if (ni_dbus_dict_get_uint32(dict, "type", &u32))
+		dev->link.type = u32;
+	if (ni_dbus_dict_get_uint32(dict, "status", &u32))
+		dev->link.ifflags = u32;
+	if (ni_dbus_dict_get_string(dict, "master", &str))
+		ni_netdev_ref_set_ifname(&dev->link.masterdev, str);
+
+	cs = ni_client_state_new(NI_FSM_STATE_NONE);
+	if (ni_dbus_dict_get_string(dict, "origin", &str))
+		ni_string_dup(&cs->config.origin, str);
+	if (ni_dbus_dict_get_bool(dict, "persistent", &bv))
+		cs->control.persistent = bv;
+	if (ni_dbus_dict_get_bool(dict, "require-link", &bv))
+		ni_tristate_set(&cs->control.require_link, bv);
+	ni_netdev_set_client_state(dev, cs);
+
+	leases = ni_dbus_dict_get(dict, "leases");
+	for (i = 0; leases && ni_dbus_variant_is_dict_array(leases) &&
+			i < leases->array.len; ++i) {
+		entry = &leases->variant_array_value[i];
+
+		if (!ni_dbus_dict_get_uint32(entry, "family", &family) ||
+		    !ni_dbus_dict_get_uint32(entry, "type", &type))
+			continue;
+
+		if (!(lease = ni_addrconf_lease_new(type, family)))
+			continue;
+
+		if (ni_dbus_dict_get_uint32(entry, "state", &u32))
+			lease->state = u32;
+		if (ni_dbus_dict_get_uint32(entry, "flags", &u32))
+			lease->flags = u32;
+
+		if (ni_netdev_set_lease(dev, lease) < 0)
+			ni_addrconf_lease_free(lease);
+	}
+
+	return dev;
+}
+
+typedef struct ni_ifstatus_summary {
+	const ni_string_array_t *	ifnames;
+	const char *			netns;
+	ni_bool_t			all;
+	ni_bool_t			quiet;
+	ni_bool_t			json;
+
+	ni_stringbuf_t			buf;
+	ni_uint_array_t			stcodes;
+	ni_uint_array_t			stflags;
+} ni_ifstatus_summary_t;
+
+static void
+ni_ifstatus_summary_json(ni_ifstatus_summary_t *summary, const ni_netdev_t *dev,
+			const ni_dbus_variant_t *dict, unsigned int st)
+{
+	ni_json_format_options_t options = { .flags = 0, .indent = 0 };
+	const ni_client_state_t *cs = dev->client_state;
+	const ni_addrconf_lease_t *lease;
+	ni_json_t *object, *leases, *entry;
+	uint32_t count = 0;
+
+	object = ni_json_new_object();
+	ni_json_object_set(object, "name", ni_json_new_string(dev->name));
+	ni_json_object_set(object, "index", ni_json_new_int64(dev->link.ifindex));
+	ni_json_object_set(object, "type", ni_json_new_string(
+				ni_linktype_type_to_name(dev->link.type)));
+	ni_json_object_set(object, "status", ni_json_new_string(
+				ni_ifstatus_code_name(st)));
+	ni_json_object_set(object, "up", ni_json_new_bool(ni_netdev_device_is_up(dev)));
+	ni_json_object_set(object, "link", ni_json_new_bool(ni_netdev_link_is_up(dev)));
+	if (dev->link.masterdev.name)
+		ni_json_object_set(object, "master",
+				ni_json_new_string(dev->link.masterdev.name));
+	if (cs && cs->config.origin)
+		ni_json_object_set(object, "origin",
+				ni_json_new_string(cs->config.origin));
+	if (cs)
+		ni_json_object_set(object, "persistent",
+				ni_json_new_bool(cs->control.persistent));
+	if (ni_dbus_dict_get_uint32(dict, "addresses", &count))
+		ni_json_object_set(object, "addresses", ni_json_new_int64(count));
+
+	leases = ni_json_new_array();
+	for (lease = dev->leases; lease; lease = lease->next) {
+		entry = ni_json_new_object();
+		ni_json_object_set(entry, "family", ni_json_new_string(
+					ni_addrfamily_type_to_name(lease->family)));
+		ni_json_object_set(entry, "type", ni_json_new_string(
+					ni_addrconf_type_to_name(lease->type)));
+		ni_json_object_set(entry, "state", ni_json_new_string(
+					ni_addrconf_state_to_name(lease->state)));
+		ni_json_array_append(leases, entry);
+	}
+	ni_json_object_set(object, "leases", leases);
+
+	/* print each interface as soon as it arrives */
+	ni_stringbuf_clear(&summary->buf);
+	printf("%s%s", summary->stcodes.count > 1 ? ",\n" : "\n",
+		ni_json_format_string(&summary->buf, object, &options));
+	ni_json_free(object);
+}
+
+static dbus_bool_t
+ni_ifstatus_summary_entry(const char *path, const ni_dbus_variant_t *dict, void *user_data)
+{
+	ni_ifstatus_summary_t *summary = user_data;
+	ni_bool_t mandatory = TRUE;
+	unsigned int st;
+	ni_netdev_t *dev;
+
+	(void)path;
+	if (!(dev = ni_ifstatus_summary_device(dict)))
+		return TRUE;
+
+	if (!summary->all && ni_string_array_index(summary->ifnames, dev->name) == -1) {
+		ni_netdev_put(dev);
+		return TRUE;
+	}
+
+	st = ni_ifstatus_of_device(dev, &mandatory);
+	ni_uint_array_append(&summary->stcodes, st);
+	ni_uint_array_append(&summary->stflags, mandatory);
+
+	if (summary->json)
+		ni_ifstatus_summary_json(summary, dev, dict, st);
+	else
+	if (!summary->quiet)
+		ni_ifstatus_show_status(dev->name, st);
+
+	ni_netdev_put(dev);
+	return TRUE;
+}
+
+static ni_bool_t
+ni_ifstatus_summary_query(ni_ifstatus_summary_t *summary)
+{
+	ni_dbus_variant_t arg = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_object_t *list_object;
+	ni_dbus_client_t *client;
+	const char *method;
+	unsigned int argc;
+	dbus_bool_t rv;
+
+	if (!(client = ni_create_dbus_client(NI_OBJECTMODEL_DBUS_BUS_NAME)))
+		return FALSE;
+
+	list_object = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class,
+					NI_OBJECTMODEL_NETIF_LIST_PATH,
+					NI_OBJECTMODEL_NETIFLIST_INTERFACE, NULL);
+
+	if (summary->netns) {
+		method = "getNetnsStatus";
+		ni_dbus_variant_set_string(&arg, summary->netns);
+		argc = 1;
+	} else {
+		method = "getStatus";
+		argc = 0;
+	}
+
+	/* the devices are formatted while the reply is parsed */
+	rv = ni_dbus_object_call_dict_foreach(list_object, NI_OBJECTMODEL_NETIFLIST_INTERFACE,
+					method, argc, &arg, ni_ifstatus_summary_entry,
+					summary, &error);
+	if (!rv) {
+		ni_dbus_print_error(&error, "%s.%s() failed",
+				ni_dbus_object_get_path(list_object), method);
+		dbus_error_free(&error);
+	}
+
+	ni_dbus_variant_destroy(&arg);
+	ni_dbus_object_free(list_object);
+	ni_dbus_client_free(client);
+	return rv;
+}
+
+static int
+ni_ifstatus_summary(const ni_string_array_t *ifnames, ni_bool_t all, const char *netns,
+			ni_bool_t opt_quiet, ni_bool_t opt_transient, ni_bool_t opt_json)
+{
+	ni_ifstatus_summary_t summary;
+	int status = NI_WICKED_ST_OK;
+	ni_bool_t rv;
+
+	memset(&summary, 0, sizeof(summary));
+	summary.ifnames = ifnames;
+	summary.netns = netns;
+	summary.all = all;
+	summary.quiet = opt_quiet;
+	summary.json = opt_json;
+	ni_stringbuf_init(&summary.buf);
+	ni_uint_array_init(&summary.stcodes);
+	ni_uint_array_init(&summary.stflags);
+
+	if (opt_json)
+		printf("{\"interfaces\":[");
+	rv = ni_ifstatus_summary_query(&summary);
+	if (opt_json)
+		printf("%s]}\n", summary.stcodes.count ? "\n" : "");
+	ni_stringbuf_destroy(&summary.buf);
+
+	if (!rv) {
+		/* Severe error we always explicitly return */
+		status = NI_WICKED_ST_ERROR;
+	} else
+	if (summary.stcodes.count == 0) {
+		if (!opt_quiet && !opt_json)
+			printf("ifstatus: no matching interfaces\n");
+		status = NI_WICKED_ST_NO_DEVICE;
+	} else {
+		status = ni_ifstatus_result_code(status, &summary.stcodes, &summary.stflags,
+					all || ifnames->count > 1, opt_transient);
+	}
+
+	ni_uint_array_destroy(&summary.stcodes);
+	ni_uint_array_destroy(&summary.stflags);
+	return status;
+}
+
+/*
+ * fsm transition timings, saved by nanny when enabled in the config
+ */
+static int64_t
+ni_ifstatus_timings_int(ni_json_t *json, const char *name)
+{
+	int64_t value = 0;
+
+	ni_json_int64_get(ni_json_object_get_value(json, name), &value);
+	return value;
+}
+
+static ni_bool_t
+ni_ifstatus_timings_bool(ni_json_t *json, const char *name)
+{
+	ni_bool_t value = FALSE;
+
+	ni_json_bool_get(ni_json_object_get_value(json, name), &value);
+	return value;
+}
+
+static void
+ni_ifstatus_timings_show(ni_json_t *iface, const char *ifname)
+{
+	ni_json_t *list, *entry;
+	char *state = NULL, *from = NULL, *to = NULL;
+	unsigned int i, count;
+
+	ni_json_string_get(ni_json_object_get_value(iface, "state"), &state);
+	if_printf(ifname, NULL, "%s%s\n", state ? state : "unknown",
+			ni_ifstatus_timings_bool(iface, "failed") ? ", failed" : "");
+	ni_string_free(&state);
+
+	list = ni_json_object_get_value(iface, "transitions");
+	count = ni_json_array_entries(list);
+	for (i = 0; i < count; ++i) {
+		entry = ni_json_array_get(list, i);
+
+		ni_json_string_get(ni_json_object_get_value(entry, "from"), &from);
+		ni_json_string_get(ni_json_object_get_value(entry, "to"), &to);
+		if_printf("", "timing:", "%s -> %s: +%"PRId64"ms %"PRId64"ms"
+				" (%"PRId64" calls %"PRId64"ms, wait %"PRId64"ms)%s%s%s\n",
+				from, to,
+				ni_ifstatus_timings_int(entry, "start"),
+				ni_ifstatus_timings_int(entry, "duration"),
+				ni_ifstatus_timings_int(entry, "calls"),
+				ni_ifstatus_timings_int(entry, "call-time"),
+				ni_ifstatus_timings_int(entry, "wait-time"),
+				ni_ifstatus_timings_bool(entry, "finished") ? "" : ", unfinished",
+				ni_ifstatus_timings_bool(entry, "timeout")  ? ", timeout" : "",
+				ni_ifstatus_timings_bool(entry, "failed")   ? ", failed" : "");
+		ni_string_free(&from);
+		ni_string_free(&to);
+	}
+}
+
+/*
+ * critical path -- follows the workers the latest finished one
+ * was blocked by, back to a worker that was not blocked at all
+ */
+typedef struct ni_ifstatus_timings_node {
+	ni_json_t *		iface;
+	char *			name;
+	int64_t			first;
+	int64_t			last;
+	int64_t			active;
+	int64_t			blocked;
+	ni_string_array_t	blocked_by;
+	ni_bool_t		visited;
+} ni_ifstatus_timings_node_t;
+
+static void
+ni_ifstatus_timings_blocked_by(ni_json_t *entry, ni_string_array_t *names)
+{
+	ni_json_t *by = ni_json_object_get_value(entry, "blocked-by");
+	unsigned int i, count = ni_json_array_entries(by);
+	char *name;
+
+	for (i = 0; i < count; ++i) {
+		name = NULL;
+		if (ni_json_string_get(ni_json_array_get(by, i), &name) &&
+		    ni_string_array_index(names, name) == -1)
+			ni_string_array_append(names, name);
+		ni_string_free(&name);
+	}
+}
+
+static void
+ni_ifstatus_timings_node_init(ni_ifstatus_timings_node_t *node, ni_json_t *iface)
+{
+	ni_json_t *list, *entry;
+	unsigned int i, count;
+	int64_t start, duration;
+
+	memset(node, 0, sizeof(*node));
+	node->iface = iface;
+	ni_json_string_get(ni_json_object_get_value(iface, "name"), &node->name);
+
+	list = ni_json_object_get_value(iface, "transitions");
+	count = ni_json_array_entries(list);
+	for (i = 0; i < count; ++i) {
+		entry = ni_json_array_get(list, i);
+		start = ni_ifstatus_timings_int(entry, "start");
+		duration = ni_ifstatus_timings_int(entry, "duration");
+
+		if (i == 0 || start < node->first)
+			node->first = start;
+		if (start + duration > node->last)
+			node->last = start + duration;
+		node->active  += duration;
+		node->blocked += ni_ifstatus_timings_int(entry, "blocked-time");
+		ni_ifstatus_timings_blocked_by(entry, &node->blocked_by);
+	}
+}
+
+static ni_ifstatus_timings_node_t *
+ni_ifstatus_timings_node_find(ni_ifstatus_timings_node_t *nodes, unsigned int count, const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; ++i) {
+		if (ni_string_eq(nodes[i].name, name))
+			return &nodes[i];
+	}
+	return NULL;
+}
+
+static void
+ni_ifstatus_timings_critical_path(ni_json_t *list, const ni_string_array_t *ifnames, ni_bool_t all)
+{
+	ni_ifstatus_timings_node_t *nodes, *node, *next, *dep;
+	ni_ifstatus_timings_node_t **path;
+	unsigned int i, n, count, len = 0;
+	ni_json_t *entries, *entry;
+	char *blockers = NULL, *from = NULL, *to = NULL;
+
+	if (!(count = ni_json_array_entries(list)))
+		return;
+
+	nodes = xcalloc(count, sizeof(*nodes));
+	path  = xcalloc(count, sizeof(*path));
+	for (i = 0, node = NULL; i < count; ++i) {
+		ni_ifstatus_timings_node_init(&nodes[i], ni_json_array_get(list, i));
+		if (!all && ni_string_array_index(ifnames, nodes[i].name) == -1)
+			continue;
+		if (!node || nodes[i].last > node->last)
+			node = &nodes[i];
+	}
+
+	for (; node && !node->visited; node = next) {
+		node->visited = TRUE;
+		path[len++] = node;
+
+		for (next = NULL, n = 0; n < node->blocked_by.count; ++n) {
+			dep = ni_ifstatus_timings_node_find(nodes, count,
+					node->blocked_by.data[n]);
+			if (dep && !dep->visited && (!next || dep->last > next->last))
+				next = dep;
+		}
+	}
+
+	if (len) {
+		printf("critical path: %"PRId64"ms\n", path[0]->last - path[len - 1]->first);
+		while (len--) {
+			node = path[len];
+			ni_string_join(&blockers, &node->blocked_by, ", ");
+			if_printf(node->name, "path:", "+%"PRId64"ms .. +%"PRId64"ms,"
+					" active %"PRId64"ms, blocked %"PRId64"ms%s%s\n",
+					node->first, node->last, node->active, node->blocked,
+					blockers ? " by " : "", blockers ? blockers : "");
+			ni_string_free(&blockers);
+		}
+	}
+
+	for (i = 0; i < count; ++i) {
+		node = &nodes[i];
+		if (!all && ni_string_array_index(ifnames, node->name) == -1)
+			continue;
+
+		entries = ni_json_object_get_value(node->iface, "transitions");
+		for (n = 0; n < ni_json_array_entries(entries); ++n) {
+			ni_string_array_t names = NI_STRING_ARRAY_INIT;
+
+			entry = ni_json_array_get(entries, n);
+			if (ni_ifstatus_timings_int(entry, "blocked-time") <= 0)
+				continue;
+
+			ni_ifstatus_timings_blocked_by(entry, &names);
+			ni_string_join(&blockers, &names, ", ");
+			ni_string_array_destroy(&names);
+
+			ni_json_string_get(ni_json_object_get_value(entry, "from"), &from);
+			ni_json_string_get(ni_json_object_get_value(entry, "to"), &to);
+			if_printf(node->name, "blocked:", "%s -> %s: %"PRId64"ms waiting for %s\n",
+					from, to, ni_ifstatus_timings_int(entry, "blocked-time"),
+					blockers ? blockers : "dependencies");
+			ni_string_free(&blockers);
+			ni_string_free(&from);
+			ni_string_free(&to);
+		}
+	}
+
+	for (i = 0; i < count; ++i) {
+		ni_string_free(&nodes[i].name);
+		ni_string_array_destroy(&nodes[i].blocked_by);
+	}
+	free(nodes);
+	free(path);
+}
+
+typedef enum {
+	NI_IFSTATUS_TIMINGS_TEXT,
+	NI_IFSTATUS_TIMINGS_JSON,
+	NI_IFSTATUS_TIMINGS_CRITICAL_PATH,
+} ni_ifstatus_timings_format_t;
+
+static int
+ni_ifstatus_timings(const ni_string_array_t *ifnames, ni_bool_t all,
+			ni_ifstatus_timings_format_t format)
+{
+	ni_json_format_options_t options = NI_JSON_OPTIONS_INIT;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_json_t *json, *list, *iface, *result;
+	unsigned int i, count, nmarked = 0;
+	char path[PATH_MAX];
+	char *ifname;
+
+	snprintf(path, sizeof(path), "%s/nanny/fsm-timings.json", ni_config_statedir());
+	if (!ni_file_exists(path)) {
+		printf("ifstatus: no fsm timings recorded\n");
+		return NI_WICKED_ST_NO_DEVICE;
+	}
+	if (!(json = ni_json_parse_file(path))) {
+		ni_error("unable to parse fsm timings in %s", path);
+		return NI_WICKED_ST_ERROR;
+	}
+
+	result = ni_json_new_array();
+	list = ni_json_object_get_value(json, "interfaces");
+	count = ni_json_array_entries(list);
+	for (i = 0; i < count; ++i) {
+		iface = ni_json_array_get(list, i);
+
+		ifname = NULL;
+		ni_json_string_get(ni_json_object_get_value(iface, "name"), &ifname);
+		if (all || ni_string_array_index(ifnames, ifname) != -1) {
+			if (format == NI_IFSTATUS_TIMINGS_JSON)
+				ni_json_array_append(result, ni_json_clone(iface));
+			else
+			if (format == NI_IFSTATUS_TIMINGS_TEXT)
+				ni_ifstatus_timings_show(iface, ifname);
+			nmarked++;
+		}
+		ni_string_free(&ifname);
+	}
+
+	if (format == NI_IFSTATUS_TIMINGS_JSON) {
+		ni_json_t *object = ni_json_new_object();
+
+		ni_json_object_set(object, "interfaces", result);
+		printf("%s\n", ni_json_format_string(&buf, object, &options));
+		ni_stringbuf_destroy(&buf);
+		ni_json_free(object);
+	} else {
+		if (format == NI_IFSTATUS_TIMINGS_CRITICAL_PATH && nmarked)
+			ni_ifstatus_timings_critical_path(list, ifnames, all);
+		ni_json_free(result);
+	}
+	ni_json_free(json);
+
+	if (nmarked == 0) {
+		if (format != NI_IFSTATUS_TIMINGS_JSON)
+			printf("ifstatus: no matching interfaces\n");
+		return NI_WICKED_ST_NO_DEVICE;
+	}
+	return NI_WICKED_ST_OK;
+}
+
 int
 ni_do_ifstatus(int argc, char **argv)
 {
 	enum  { OPT_QUIET, OPT_BRIEF, OPT_NORMAL, OPT_VERBOSE,
-		OPT_HELP, OPT_SHOW, OPT_IFCONFIG, OPT_TRANSIENT };
+		OPT_HELP, OPT_SHOW, OPT_IFCONFIG, OPT_TRANSIENT, OPT_SUMMARY,
+		OPT_TIMINGS, OPT_NETNS };
 	static struct option ifcheck_options[] = {
 		{ "help",         no_argument,       NULL, OPT_HELP        },
 		{ "quiet",        no_argument,       NULL, OPT_QUIET       },
@@ -696,6 +1265,9 @@ ni_do_ifstatus(int argc, char **argv)
 		{ "verbose",      no_argument,       NULL, OPT_VERBOSE     },
 		{ "ifconfig",     required_argument, NULL, OPT_IFCONFIG    },
 		{ "transient",    no_argument,       NULL, OPT_TRANSIENT },
+		{ "summary",      optional_argument, NULL, OPT_SUMMARY     },
+		{ "timings",      optional_argument, NULL, OPT_TIMINGS     },
+		{ "netns",        required_argument, NULL, OPT_NETNS       },
 
 		{ NULL,           no_argument,       NULL, 0               }
 	};
@@ -708,14 +1280,15 @@ ni_do_ifstatus(int argc, char **argv)
 	ni_bool_t         multiple = FALSE;
 	ni_bool_t         all = FALSE;
 	ni_bool_t         opt_transient = FALSE;
+	ni_bool_t         opt_summary = FALSE;
+	ni_bool_t         opt_summary_json = FALSE;
+	const char *      opt_netns = NULL;
+	ni_bool_t         opt_timings = FALSE;
+	ni_ifstatus_timings_format_t opt_format = NI_IFSTATUS_TIMINGS_TEXT;
 	ni_bool_t         check_config;
-	ni_fsm_t *        fsm;
+	ni_fsm_t *        fsm = NULL;
 	unsigned int      i, nmarked;
 
-	/* Allocate fsm and set to read-only */
-	fsm = ni_fsm_new();
-	fsm->readonly = TRUE;
-
 	/*
 	 * Parse config files in ifstatus mode, show deals with
 	 * runtime configuration of (existing) interfaces only.
@@ -746,6 +1319,16 @@ ni_do_ifstatus(int argc, char **argv)
 				"      Show only a brief status, no additional info\n"
 				"  --verbose\n"
 				"      Show a more detailed information\n"
+				"  --summary[=json]\n"
+				"      Show a brief status of the existing devices only,\n"
+				"      without reading the interface configuration\n"
+				"  --netns <name>\n"
+				"      Show the summary of the devices in the named\n"
+				"      network namespace (requires --summary)\n"
+				"  --timings[=json|critical-path]\n"
+				"      Show the state transition timings of the last\n"
+				"      up or down run recorded by wickedd-nanny or\n"
+				"      the critical path through the dependencies\n"
 				"\n"
 				"  --ifconfig <filename>\n"
 				"      Read interface configuration(s) from file\n"
@@ -766,9 +1349,39 @@ ni_do_ifstatus(int argc, char **argv)
 		case OPT_TRANSIENT:
 			opt_transient = TRUE;
 			break;
+
+		case OPT_SUMMARY:
+			if (ni_string_eq(optarg, "json"))
+				opt_summary_json = TRUE;
+			else
+			if (optarg)
+				goto usage;
+			opt_summary = TRUE;
+			break;
+
+		case OPT_TIMINGS:
+			if (ni_string_eq(optarg, "json"))
+				opt_format = NI_IFSTATUS_TIMINGS_JSON;
+			else
+			if (ni_string_eq(optarg, "critical-path"))
+				opt_format = NI_IFSTATUS_TIMINGS_CRITICAL_PATH;
+			else
+			if (optarg)
+				goto usage;
+			opt_timings = TRUE;
+			break;
+
+		case OPT_NETNS:
+			if (ni_string_empty(optarg) || strchr(optarg, '/'))
+				goto usage;
+			opt_netns = optarg;
+			break;
 		}
 	}
 
+	if (opt_netns && !opt_summary)
+		goto usage;
+
 	/* at least one argument is required */
 	if (optind >= argc) {
 		goto usage;
@@ -777,6 +1390,31 @@ ni_do_ifstatus(int argc, char **argv)
 			goto usage;
 	}
 
+	if (opt_summary || opt_timings) {
+		if (opt_summary && opt_timings)
+			goto usage;
+		if (opt_ifconfig.count || opt_verbose == OPT_VERBOSE)
+			goto usage;
+
+		for (c = optind; c < argc; ++c) {
+			if (ni_string_eq(argv[c], "all"))
+				all = TRUE;
+			else if (ni_string_array_index(&ifnames, argv[c]) == -1)
+				ni_string_array_append(&ifnames, argv[c]);
+		}
+		if (opt_timings)
+			status = ni_ifstatus_timings(&ifnames, all, opt_format);
+		else
+			status = ni_ifstatus_summary(&ifnames, all, opt_netns,
+					opt_verbose == OPT_QUIET, opt_transient,
+					opt_summary_json);
+		goto cleanup;
+	}
+
+	/* Allocate fsm and set to read-only */
+	fsm = ni_fsm_new();
+	fsm->readonly = TRUE;
+
 	if (!ni_fsm_create_client(fsm)) {
 		/* Severe error we always explicitly return */
 		status = NI_WICKED_ST_ERROR;
@@ -871,40 +1509,15 @@ ni_do_ifstatus(int argc, char **argv)
 		goto cleanup;
 	}
 
-	if (!stcodes.count) {
-		if (status == NI_WICKED_ST_OK) {
-			status = NI_WICKED_ST_UNUSED;
-		}
-	} else
-	if (!multiple) {
-		status = stcodes.data[0];
-		if (!opt_transient) {
-			switch (status) {
-			case NI_WICKED_ST_NO_DEVICE:
-			case NI_WICKED_ST_UNCONFIGURED:
-			case NI_WICKED_ST_NOT_RUNNING:
-			case NI_WICKED_ST_IN_PROGRESS:
-			case NI_WICKED_ST_NO_CARRIER:
-				break;
-			default:
-				status = NI_WICKED_ST_OK;
-				break;
-			}
-		}
-	} else
-	for (i = 0; i < stcodes.count && i < stflags.count; ++i) {
-		unsigned int st = stcodes.data[i];
-		unsigned int fl = stflags.data[i];
-		int rc = ni_ifstatus_to_retcode(st, fl);
-		if (rc == NI_WICKED_ST_FAILED)
-			status = rc;
-	}
+	status = ni_ifstatus_result_code(status, &stcodes, &stflags, multiple, opt_transient);
 
 cleanup:
 	ni_uint_array_destroy(&stcodes);
 	ni_uint_array_destroy(&stflags);
 	ni_string_array_destroy(&ifnames);
 	ni_string_array_destroy(&opt_ifconfig);
+	if (fsm)
+		ni_fsm_free(fsm);
 	return status;
 }
 
@@ -988,34 +1601,7 @@ ni_ifstatus_display_result(ni_fsm_t *fsm, ni_string_array_t *names, ni_ifworker_
 		ni_ifstatus_show_status(w->name, st);
 	}
 
-	if (!stcodes.count) {
-		if (status == NI_WICKED_ST_OK) {
-			status = NI_WICKED_ST_UNUSED;
-		}
-	} else
-	if (!multiple) {
-		status = stcodes.data[0];
-		if (!opt_transient) {
-			switch (status) {
-			case NI_WICKED_ST_NO_DEVICE:
-			case NI_WICKED_ST_UNCONFIGURED:
-			case NI_WICKED_ST_NOT_RUNNING:
-			case NI_WICKED_ST_IN_PROGRESS:
-			case NI_WICKED_ST_NO_CARRIER:
-				break;
-			default:
-				status = NI_WICKED_ST_OK;
-				break;
-			}
-		}
-	} else
-	for (i = 0; i < stcodes.count && i < stflags.count; ++i) {
-		unsigned int st = stcodes.data[i];
-		unsigned int fl = stflags.data[i];
-		int rc = ni_ifstatus_to_retcode(st, fl);
-		if (rc == NI_WICKED_ST_FAILED)
-			status = rc;
-	}
+	status = ni_ifstatus_result_code(status, &stcodes, &stflags, multiple, opt_transient);
 
 	ni_uint_array_destroy(&stcodes);
 	ni_uint_array_destroy(&stflags);
@@ -374,13 +374,15 @@ ni_nanny_fsm_monitor_new(ni_fsm_t *fsm)
 	if (!(fsm->client_root_object = ni_call_create_client()))
 		return NULL;
 
-	if (!(client = ni_dbus_object_get_client(fsm->client_root_object)))
+	/* the wickedd client may be connected directly to wickedd only */
+	if (!(client = ni_nanny_create_client(NULL)))
 		return NULL;
 
 	monitor = calloc(1, sizeof(*monitor));
 	if (monitor) {
-		ni_dbus_client_add_signal_handler(client, NULL, NULL,
-				NI_OBJECTMODEL_MANAGED_NETIF_INTERFACE,
+		ni_dbus_client_add_signal_match(client, NI_OBJECTMODEL_DBUS_BUS_NAME_NANNY,
+				NI_OBJECTMODEL_MANAGED_NETIF_LIST_PATH,
+				NI_OBJECTMODEL_MANAGED_NETIF_INTERFACE, NULL,
 				ni_nanny_fsm_monitor_handler, monitor);
 	}
 	return monitor;
@@ -446,6 +448,10 @@ ni_nanny_fsm_monitor_reset(ni_nanny_fsm_monitor_t *monitor)
 void
 ni_nanny_fsm_monitor_free(ni_nanny_fsm_monitor_t *monitor)
 {
+	ni_dbus_client_t *client;
+
+	if (monitor && (client = ni_nanny_create_client(NULL)))
+		ni_dbus_client_remove_signal_handlers(client, monitor);
 	ni_nanny_fsm_monitor_reset(monitor);
 	free(monitor);
 }
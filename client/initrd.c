@@ -0,0 +1,664 @@
+/*
+ *	wicked client initrd action -- lean apply of dracut cmdline configs
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include <wicked/types.h>
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/netinfo.h>
+#include <wicked/address.h>
+#include <wicked/addrconf.h>
+#include <wicked/route.h>
+#include <wicked/ipv4.h>
+#include <wicked/ipv6.h>
+#include <wicked/system.h>
+#include <wicked/socket.h>
+#include <wicked/fsm.h>
+
+#include "client/wicked-client.h"
+#include "client/read-config.h"
+#include "client/dracut/cmdline.h"
+#include "client/client_state.h"
+#include "dhcp4/dhcp4.h"
+#include "netinfo_priv.h"
+#include "appconfig.h"
+#include "initrd.h"
+#include "ifup.h"
+
+/*
+ * In the initrd, the common dracut cmdline configs are a static address
+ * or dhcp4 on one or a few ethernet interfaces.  Instead to convert them
+ * to xml and to apply them via wickedd, nanny and the supplicants (which
+ * requires to start them and to load the schema first), we request the
+ * leases directly in this process using the same library functions as
+ * the daemons.  Anything else is handed to the regular ifup.
+ *
+ * The state is handed over to the daemons after switch-root via the
+ * client state and lease files in the state directory: wickedd loads
+ * the client state of the device and wickedd-dhcp4 recovers the lease
+ * from its lease file in INIT-REBOOT.
+ */
+#define NI_INITRD_CMDLINE_PATH		"/proc/cmdline"
+#define NI_INITRD_CONFIG_ORIGIN		"dracut:cmdline"
+
+typedef enum {
+	NI_INITRD_LEASE_NONE = 0,
+	NI_INITRD_LEASE_PENDING,
+	NI_INITRD_LEASE_GRANTED,
+	NI_INITRD_LEASE_FAILED,
+} ni_initrd_lease_state_t;
+
+typedef struct ni_initrd_netif {
+	ni_compat_netdev_t *	compat;
+	unsigned int		ifindex;
+	ni_uuid_t		uuid;
+	ni_bool_t		started;
+
+	ni_initrd_lease_state_t	static4;
+	ni_initrd_lease_state_t	static6;
+	ni_initrd_lease_state_t	dhcp4;
+	ni_dhcp4_device_t *	dhcp4_dev;
+} ni_initrd_netif_t;
+
+/* the event handlers don't have any user data */
+static ni_initrd_netif_t *	ni_initrd_netifs;
+static unsigned int		ni_initrd_count;
+
+static ni_bool_t
+ni_initrd_addrs_have_family(const ni_address_t *list, unsigned int family)
+{
+	const ni_address_t *ap;
+
+	for (ap = list; ap; ap = ap->next) {
+		if (ap->family == family)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * Whether we can apply a compat netdev config in the lean mode.
+ */
+static ni_bool_t
+ni_initrd_netdev_supported(const ni_compat_netdev_t *compat)
+{
+	const ni_netdev_t *dev = compat->dev;
+	const char *reason = NULL;
+
+	if (ni_string_empty(dev->name))
+		reason = "config without interface name";
+	else
+	if (dev->link.type != NI_IFTYPE_UNKNOWN && dev->link.type != NI_IFTYPE_ETHERNET)
+		reason = ni_linktype_type_to_name(dev->link.type);
+	else
+	if (!ni_string_empty(dev->link.masterdev.name) || compat->port.type != NI_IFTYPE_UNKNOWN)
+		reason = "port config";
+	else
+	if (compat->identify.hwaddr.len)
+		reason = "identify by hwaddr";
+	else
+	if (compat->dhcp6.enabled || compat->auto6.enabled || compat->auto4.enabled)
+		reason = "ipv6 or ipv4ll address configuration";
+
+	if (reason) {
+		ni_debug_application("%s: not supported in initrd mode: %s",
+				dev->name ? dev->name : "<unnamed>", reason);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static ni_initrd_netif_t *
+ni_initrd_netif_by_index(unsigned int ifindex)
+{
+	unsigned int i;
+
+	for (i = 0; i < ni_initrd_count; ++i) {
+		if (ni_initrd_netifs[i].ifindex == ifindex)
+			return &ni_initrd_netifs[i];
+	}
+	return NULL;
+}
+
+static int
+ni_initrd_link_setup(ni_netconfig_t *nc, ni_netdev_t *ifp, const ni_netdev_t *cfg)
+{
+	ni_netdev_req_t *req;
+	int rv;
+
+	if (cfg->ipv4 && ni_system_ipv4_setup(nc, ifp, &cfg->ipv4->conf) < 0)
+		ni_warn("%s: unable to apply ipv4 settings", ifp->name);
+	if (cfg->ipv6 && ni_system_ipv6_setup(nc, ifp, &cfg->ipv6->conf) < 0)
+		ni_warn("%s: unable to apply ipv6 settings", ifp->name);
+
+	if (!ni_link_address_is_invalid(&cfg->link.hwaddr) &&
+	    !ni_link_address_equal(&cfg->link.hwaddr, &ifp->link.hwaddr) &&
+	    ni_system_hwaddr_change(nc, ifp, &cfg->link.hwaddr) < 0)
+		ni_warn("%s: unable to change link address", ifp->name);
+
+	req = ni_netdev_req_new();
+	req->ifflags = NI_IFF_LINK_UP | NI_IFF_NETWORK_UP;
+	req->mtu = cfg->link.mtu;
+	rv = ni_system_interface_link_change(ifp, req);
+	ni_netdev_req_free(req);
+	return rv;
+}
+
+static ni_initrd_lease_state_t
+ni_initrd_static_request(ni_netdev_t *ifp, const ni_netdev_t *cfg, unsigned int family)
+{
+	ni_addrconf_lease_t *lease;
+	const ni_route_table_t *tab;
+	const ni_address_t *ap;
+	ni_route_t *rp;
+	unsigned int i;
+	int rv;
+
+	lease = ni_addrconf_lease_new(NI_ADDRCONF_STATIC, family);
+	lease->state = NI_ADDRCONF_STATE_GRANTED;
+	ni_uuid_generate(&lease->uuid);
+
+	for (ap = cfg->addrs; ap; ap = ap->next) {
+		if (ap->family == family)
+			ni_address_list_append(&lease->addrs, ni_address_clone(ap));
+	}
+	for (tab = cfg->routes; tab; tab = tab->next) {
+		for (i = 0; i < tab->routes.count; ++i) {
+			if (!tab->routes.data[i] || tab->routes.data[i]->family != family)
+				continue;
+			if (!(rp = ni_route_clone(tab->routes.data[i])))
+				continue;
+			if (!rp->nh.device.name)
+				ni_string_dup(&rp->nh.device.name, ifp->name);
+			if (!ni_route_tables_add_route(&lease->routes, rp))
+				ni_route_free(rp);
+		}
+	}
+
+	/* mark all addresses tentative, causing to verify them */
+	ni_addrconf_lease_addrs_set_tentative(lease, TRUE);
+
+	rv = __ni_system_interface_update_lease(ifp, &lease, NI_EVENT_ADDRESS_ACQUIRED);
+	ni_addrconf_lease_drop(&lease);
+	if (rv < 0) {
+		ni_error("%s: unable to apply static %s addresses: %s", ifp->name,
+				ni_addrfamily_type_to_name(family), ni_strerror(rv));
+		return NI_INITRD_LEASE_FAILED;
+	}
+	return NI_INITRD_LEASE_PENDING;
+}
+
+static ni_initrd_lease_state_t
+ni_initrd_dhcp4_request(ni_initrd_netif_t *netif, ni_netdev_t *ifp)
+{
+	const ni_compat_netdev_t *compat = netif->compat;
+	ni_dhcp4_request_t *req;
+	int rv;
+
+	if (!ni_dhcp4_supported(ifp)) {
+		ni_error("%s: DHCPv4 not supported", ifp->name);
+		return NI_INITRD_LEASE_FAILED;
+	}
+
+	if (!netif->dhcp4_dev && !(netif->dhcp4_dev = ni_dhcp4_device_new(ifp->name, &ifp->link))) {
+		ni_error("%s: unable to allocate dhcp4 client", ifp->name);
+		return NI_INITRD_LEASE_FAILED;
+	}
+
+	req = ni_dhcp4_request_new();
+	req->uuid = netif->uuid;
+	req->flags = compat->dhcp4.flags;
+	req->update = compat->dhcp4.update;
+	req->start_delay = compat->dhcp4.start_delay;
+	req->acquire_timeout = compat->dhcp4.acquire_timeout;
+	req->lease_time = compat->dhcp4.lease_time;
+	req->recover_lease = compat->dhcp4.recover_lease;
+	req->release_lease = compat->dhcp4.release_lease;
+	req->broadcast = compat->dhcp4.broadcast;
+	req->route_priority = compat->dhcp4.route_priority;
+	req->route_set_src = compat->dhcp4.route_set_src;
+	req->create_cid = compat->dhcp4.create_cid;
+	req->fqdn = compat->dhcp4.fqdn;
+	ni_string_dup(&req->hostname, compat->dhcp4.hostname);
+	ni_string_dup(&req->clientid, compat->dhcp4.client_id);
+	ni_string_dup(&req->vendor_class, compat->dhcp4.vendor_class);
+	req->user_class.format = compat->dhcp4.user_class.format;
+	ni_string_array_copy(&req->user_class.class_id, &compat->dhcp4.user_class.class_id);
+	ni_string_array_copy(&req->request_options, &compat->dhcp4.request_options);
+	/* we wait for the lease: a deferred lease is no success here */
+
+	rv = ni_dhcp4_acquire(netif->dhcp4_dev, req);
+	ni_dhcp4_request_free(req);
+	if (rv < 0) {
+		ni_error("%s: DHCPv4 acquire request failed: %s",
+				ifp->name, ni_strerror(rv));
+		return NI_INITRD_LEASE_FAILED;
+	}
+	return NI_INITRD_LEASE_PENDING;
+}
+
+static void
+ni_initrd_netif_start(ni_initrd_netif_t *netif, ni_netdev_t *ifp)
+{
+	const ni_netdev_t *cfg = netif->compat->dev;
+
+	if (netif->started)
+		return;
+	netif->started = TRUE;
+
+	ni_debug_application("%s: link is up, requesting leases", ifp->name);
+	if (ni_initrd_addrs_have_family(cfg->addrs, AF_INET))
+		netif->static4 = ni_initrd_static_request(ifp, cfg, AF_INET);
+	if (ni_initrd_addrs_have_family(cfg->addrs, AF_INET6))
+		netif->static6 = ni_initrd_static_request(ifp, cfg, AF_INET6);
+	if (netif->compat->dhcp4.enabled)
+		netif->dhcp4 = ni_initrd_dhcp4_request(netif, ifp);
+}
+
+static void
+ni_initrd_lease_update(ni_initrd_lease_state_t *state, ni_netdev_t *ifp,
+		unsigned int family, ni_addrconf_mode_t type)
+{
+	const ni_addrconf_lease_t *lease;
+
+	if (*state != NI_INITRD_LEASE_PENDING)
+		return;
+
+	if (!(lease = ni_netdev_get_lease(ifp, family, type)) || lease->updater)
+		return;
+
+	if (lease->state == NI_ADDRCONF_STATE_GRANTED)
+		*state = NI_INITRD_LEASE_GRANTED;
+	else
+	if (lease->state == NI_ADDRCONF_STATE_FAILED)
+		*state = NI_INITRD_LEASE_FAILED;
+}
+
+static ni_bool_t
+ni_initrd_netif_done(ni_initrd_netif_t *netif)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t *ifp;
+
+	if (!netif->started)
+		return FALSE;
+
+	if ((ifp = ni_netdev_by_index(nc, netif->ifindex))) {
+		ni_initrd_lease_update(&netif->static4, ifp, AF_INET, NI_ADDRCONF_STATIC);
+		ni_initrd_lease_update(&netif->static6, ifp, AF_INET6, NI_ADDRCONF_STATIC);
+		ni_initrd_lease_update(&netif->dhcp4, ifp, AF_INET, NI_ADDRCONF_DHCP);
+	}
+
+	return netif->static4 != NI_INITRD_LEASE_PENDING &&
+		netif->static6 != NI_INITRD_LEASE_PENDING &&
+		netif->dhcp4 != NI_INITRD_LEASE_PENDING;
+}
+
+static ni_bool_t
+ni_initrd_netif_failed(const ni_initrd_netif_t *netif)
+{
+	return !netif->started ||
+		netif->static4 == NI_INITRD_LEASE_FAILED ||
+		netif->static6 == NI_INITRD_LEASE_FAILED ||
+		netif->dhcp4 == NI_INITRD_LEASE_FAILED;
+}
+
+static void
+ni_initrd_interface_event(ni_netdev_t *ifp, ni_event_t event)
+{
+	ni_initrd_netif_t *netif;
+
+	if (!ifp || !(netif = ni_initrd_netif_by_index(ifp->link.ifindex)))
+		return;
+
+	switch (event) {
+	case NI_EVENT_LINK_UP:
+		if (!netif->started) {
+			ni_initrd_netif_start(netif, ifp);
+			break;
+		}
+		/* fall through */
+	case NI_EVENT_DEVICE_UP:
+	case NI_EVENT_LINK_DOWN:
+		if (netif->dhcp4_dev)
+			ni_dhcp4_device_event(netif->dhcp4_dev, ifp, event);
+		break;
+
+	case NI_EVENT_DEVICE_DOWN:
+	case NI_EVENT_DEVICE_DELETE:
+		if (netif->dhcp4_dev)
+			ni_dhcp4_device_stop(netif->dhcp4_dev);
+		if (netif->dhcp4 == NI_INITRD_LEASE_PENDING)
+			netif->dhcp4 = NI_INITRD_LEASE_FAILED;
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void
+ni_initrd_dhcp4_event(enum ni_dhcp4_event ev, const ni_dhcp4_device_t *dev,
+		ni_addrconf_lease_t *lease)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_addrconf_lease_t *copy;
+	ni_initrd_netif_t *netif;
+	ni_netdev_t *ifp;
+
+	if (!(netif = ni_initrd_netif_by_index(dev->link.ifindex)) ||
+	    !(ifp = ni_netdev_by_index(nc, netif->ifindex)))
+		return;
+
+	switch (ev) {
+	case NI_DHCP4_EVENT_ACQUIRED:
+		if (!lease || lease->state != NI_ADDRCONF_STATE_GRANTED)
+			break;
+
+		/* as wickedd does with the lease it receives from the supplicant */
+		if (!(copy = ni_addrconf_lease_clone(lease)))
+			break;
+		copy->uuid = netif->uuid;
+		if (__ni_system_interface_update_lease(ifp, &copy, NI_EVENT_ADDRESS_ACQUIRED) < 0) {
+			ni_error("%s: unable to apply dhcp4 lease", ifp->name);
+			netif->dhcp4 = NI_INITRD_LEASE_FAILED;
+		}
+		ni_addrconf_lease_drop(&copy);
+		break;
+
+	case NI_DHCP4_EVENT_DEFERRED:
+		ni_note("%s: DHCPv4 lease deferred, still waiting for it", ifp->name);
+		break;
+
+	case NI_DHCP4_EVENT_LOST:
+	case NI_DHCP4_EVENT_RELEASED:
+		if (netif->dhcp4 == NI_INITRD_LEASE_PENDING)
+			netif->dhcp4 = NI_INITRD_LEASE_FAILED;
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void
+ni_initrd_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_bool_t *expired = user_data;
+
+	*expired = TRUE;
+}
+
+/*
+ * Record the applied config for wickedd, so it considers the interface
+ * configured by the dracut cmdline as after a regular ifup.
+ */
+static void
+ni_initrd_netif_save_state(const ni_initrd_netif_t *netif)
+{
+	ni_client_state_t *cs;
+
+	if (!(cs = ni_client_state_new(0)))
+		return;
+
+	cs->config.uuid = netif->uuid;
+	ni_string_dup(&cs->config.origin, NI_INITRD_CONFIG_ORIGIN);
+	if (!ni_client_state_save(cs, netif->ifindex))
+		ni_warn("%s: unable to store client state", netif->compat->dev->name);
+	ni_client_state_free(cs);
+}
+
+/*
+ * Hand the config over to the regular ifup, e.g. when there are
+ * bonds or vlans in the cmdline config.
+ */
+static int
+ni_initrd_fallback_ifup(const char *path, const char *timeout, int argc, char **argv)
+{
+	ni_string_array_t args = NI_STRING_ARRAY_INIT;
+	char *ifconfig = NULL;
+	int i, status;
+
+	ni_note("initrd: applying dracut cmdline config via regular ifup");
+
+	ni_string_printf(&ifconfig, "dracut:cmdline:%s", path);
+	ni_string_array_append(&args, "ifup");
+	ni_string_array_append(&args, "--ifconfig");
+	ni_string_array_append(&args, ifconfig);
+	if (timeout) {
+		ni_string_array_append(&args, "--timeout");
+		ni_string_array_append(&args, timeout);
+	}
+	for (i = 0; i < argc; ++i)
+		ni_string_array_append(&args, argv[i]);
+
+	status = ni_do_ifup(args.count, args.data);
+
+	ni_string_array_destroy(&args);
+	ni_string_free(&ifconfig);
+	return status;
+}
+
+static ni_bool_t
+ni_initrd_ifname_selected(const char *ifname, int argc, char **argv)
+{
+	int i;
+
+	for (i = 0; i < argc; ++i) {
+		if (ni_string_eq(argv[i], "all") || ni_string_eq(argv[i], ifname))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static int
+ni_initrd_apply(ni_compat_netdev_array_t *netdevs, unsigned int seconds,
+		int argc, char **argv)
+{
+	const ni_timer_t *timer = NULL;
+	ni_bool_t expired = FALSE;
+	ni_initrd_netif_t *netif;
+	ni_netconfig_t *nc;
+	ni_netdev_t *ifp;
+	unsigned int i, done;
+	int status = NI_WICKED_RC_SUCCESS;
+
+	if (!(nc = ni_global_state_handle(1))) {
+		ni_error("initrd: unable to refresh interfaces");
+		return NI_WICKED_RC_ERROR;
+	}
+
+	ni_initrd_netifs = xcalloc(netdevs->count, sizeof(*ni_initrd_netifs));
+	ni_initrd_count = 0;
+	for (i = 0; i < netdevs->count; ++i) {
+		ni_compat_netdev_t *compat = netdevs->data[i];
+
+		if (!ni_initrd_ifname_selected(compat->dev->name, argc, argv))
+			continue;
+
+		if (!(ifp = ni_netdev_by_name(nc, compat->dev->name))) {
+			ni_error("%s: no such interface", compat->dev->name);
+			status = NI_WICKED_RC_ERROR;
+			continue;
+		}
+
+		netif = &ni_initrd_netifs[ni_initrd_count++];
+		netif->compat = compat;
+		netif->ifindex = ifp->link.ifindex;
+		ni_uuid_generate(&netif->uuid);
+	}
+
+	if (!ni_initrd_count) {
+		ni_error("initrd: no interface config to apply");
+		status = NI_WICKED_RC_NOT_CONFIGURED;
+		goto cleanup;
+	}
+
+	ni_dhcp4_set_event_handler(ni_initrd_dhcp4_event);
+	if (ni_server_listen_interface_events(ni_initrd_interface_event) < 0 ||
+	    ni_server_enable_interface_addr_events(NULL) < 0) {
+		ni_error("initrd: unable to initialize netlink listener");
+		status = NI_WICKED_RC_ERROR;
+		goto cleanup;
+	}
+
+	for (i = 0; i < ni_initrd_count; ++i) {
+		netif = &ni_initrd_netifs[i];
+		if (!(ifp = ni_netdev_by_index(nc, netif->ifindex)))
+			continue;
+
+		if (ni_initrd_link_setup(nc, ifp, netif->compat->dev) < 0) {
+			ni_error("%s: unable to set up link", ifp->name);
+			continue;
+		}
+		if (ni_netdev_link_is_up(ifp))
+			ni_initrd_netif_start(netif, ifp);
+	}
+
+	timer = ni_timer_register(NI_TIMEOUT_FROM_SEC(seconds), ni_initrd_timeout, &expired);
+	while (!expired && !ni_caught_terminal_signal()) {
+		for (done = i = 0; i < ni_initrd_count; ++i) {
+			if (ni_initrd_netif_done(&ni_initrd_netifs[i]))
+				done++;
+		}
+		if (done == ni_initrd_count)
+			break;
+
+		if (ni_socket_wait(ni_timer_next_timeout()) != 0)
+			break;
+	}
+	if (!expired && timer)
+		ni_timer_cancel(timer);
+
+	for (i = 0; i < ni_initrd_count; ++i) {
+		netif = &ni_initrd_netifs[i];
+		if (ni_initrd_netif_done(netif) && !ni_initrd_netif_failed(netif)) {
+			ni_initrd_netif_save_state(netif);
+			ni_note("%s: up", netif->compat->dev->name);
+		} else {
+			ni_error("%s: setup %s", netif->compat->dev->name,
+					expired ? "timed out" : "failed");
+			status = NI_WICKED_RC_ERROR;
+		}
+	}
+
+	ni_server_deactivate_interface_events();
+	ni_socket_deactivate_all();
+
+	/* lease files are written behind, but the daemons need them now */
+	ni_addrconf_lease_file_flush();
+
+cleanup:
+	/* no release: the dhcp4 lease is recovered after switch-root */
+	for (i = 0; i < ni_initrd_count; ++i) {
+		if (ni_initrd_netifs[i].dhcp4_dev)
+			ni_dhcp4_device_put(ni_initrd_netifs[i].dhcp4_dev);
+	}
+	free(ni_initrd_netifs);
+	ni_initrd_netifs = NULL;
+	ni_initrd_count = 0;
+	return status;
+}
+
+int
+ni_do_initrd(int argc, char **argv)
+{
+	enum { OPT_HELP, OPT_CMDLINE, OPT_TIMEOUT };
+	static struct option initrd_options[] = {
+		{ "help",	no_argument,		NULL,	OPT_HELP },
+		{ "cmdline",	required_argument,	NULL,	OPT_CMDLINE },
+		{ "timeout",	required_argument,	NULL,	OPT_TIMEOUT },
+		{ NULL }
+	};
+	ni_compat_ifconfig_t conf;
+	const char *opt_cmdline = NI_INITRD_CMDLINE_PATH;
+	const char *opt_timeout = NULL;
+	unsigned int i, seconds = 0;
+	int c, status = NI_WICKED_RC_USAGE;
+
+	ni_compat_ifconfig_init(&conf, NI_INITRD_CONFIG_ORIGIN);
+
+	optind = 1;
+	while ((c = getopt_long(argc, argv, "", initrd_options, NULL)) != EOF) {
+		switch (c) {
+		case OPT_CMDLINE:
+			opt_cmdline = optarg;
+			break;
+
+		case OPT_TIMEOUT:
+			if (ni_parse_seconds_timeout(optarg, &seconds)) {
+				ni_error("initrd: cannot parse timeout option \"%s\"", optarg);
+				goto usage;
+			}
+			opt_timeout = optarg;
+			break;
+
+		default:
+		case OPT_HELP:
+usage:
+			fprintf(stderr,
+				"wicked [options] initrd [initrd-options] <ifname ...>|all\n"
+				"\nSupported initrd-options:\n"
+				"  --help\n"
+				"      Show this help text.\n"
+				"  --cmdline <pathname>\n"
+				"      Read the dracut cmdline from file (default: %s)\n"
+				"  --timeout <sec>\n"
+				"      Timeout after <sec> seconds\n",
+				NI_INITRD_CMDLINE_PATH);
+			goto cleanup;
+		}
+	}
+
+	if (optind >= argc) {
+		fprintf(stderr, "Missing interface argument\n");
+		goto usage;
+	}
+
+	if (!ni_dracut_cmdline_read_netdevs(&conf.netdevs, opt_cmdline)) {
+		ni_error("initrd: unable to read dracut cmdline '%s'", opt_cmdline);
+		status = NI_WICKED_RC_NOT_CONFIGURED;
+		goto cleanup;
+	}
+
+	for (i = 0; i < conf.netdevs.count; ++i) {
+		if (!ni_initrd_netdev_supported(conf.netdevs.data[i])) {
+			status = ni_initrd_fallback_ifup(opt_cmdline, opt_timeout,
+					argc - optind, argv + optind);
+			goto cleanup;
+		}
+	}
+
+	if (!seconds)
+		seconds = ni_wait_for_interfaces ? ni_wait_for_interfaces :
+			NI_IFWORKER_DEFAULT_TIMEOUT / 1000;
+
+	status = ni_initrd_apply(&conf.netdevs, seconds, argc - optind, argv + optind);
+
+cleanup:
+	ni_compat_ifconfig_destroy(&conf);
+	return status;
+}
@@ -0,0 +1,24 @@
+/*
+ *	wicked client initrd action -- lean apply of dracut cmdline configs
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef   __WICKED_CLIENT_INITRD_H__
+#define   __WICKED_CLIENT_INITRD_H__
+
+extern int		ni_do_initrd(int argc, char **argv);
+
+#endif /* __WICKED_CLIENT_INITRD_H__ */
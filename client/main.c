@@ -55,7 +55,9 @@
 #include "ifcheck.h"
 #include "ifreload.h"
 #include "ifstatus.h"
+#include "initrd.h"
 #include "main.h"
+#include "profile.h"
 
 enum {
 	OPT_HELP,
@@ -65,6 +67,7 @@ enum {
 	OPT_LOG_LEVEL,
 	OPT_LOG_TARGET,
 	OPT_SYSTEMD,
+	OPT_PROFILE,
 
 	OPT_DRYRUN,
 	OPT_ROOTDIR,
@@ -80,6 +83,7 @@ static struct option	options[] = {
 	{ "log-level",		required_argument,	NULL,	OPT_LOG_LEVEL },
 	{ "log-target",		required_argument,	NULL,	OPT_LOG_TARGET },
 	{ "systemd", 		no_argument,		NULL,	OPT_SYSTEMD },
+	{ "profile",		required_argument,	NULL,	OPT_PROFILE },
 
 	/* specific */
 	{ "dryrun",		no_argument,		NULL,	OPT_DRYRUN },
@@ -90,6 +94,7 @@ static struct option	options[] = {
 };
 
 static const char *	opt_log_target;
+static const char *	opt_profile;
 int			opt_global_dryrun;
 char *			opt_global_rootdir;
 ni_bool_t		opt_systemd;
@@ -159,6 +164,8 @@ main(int argc, char **argv)
 				"        Search all config files below this directory.\n"
 				"  --systemd\n"
 				"        Enables behavior required by systemd service\n"
+				"  --profile filename\n"
+				"        Write a timing profile in collapsed stack format.\n"
 				"\n"
 				"Commands:\n"
 				"  ifup        [options] <ifname ...>|all\n"
@@ -166,6 +173,7 @@ main(int argc, char **argv)
 				"  ifcheck     [options] <ifname ...>|all\n"
 				"  ifreload    [options] <ifname ...>|all\n"
 				"  ifstatus    [options] <ifname ...>|all\n"
+				"  initrd      [options] <ifname ...>|all\n"
 				"  show        [options] <ifname ...>|all\n"
 				"  show-xml    [options] [<ifname ...>|all]\n"
 				"  show-config [options] [<ifname ...>|all]\n"
@@ -183,6 +191,8 @@ main(int argc, char **argv)
 				"  iaid        <action> ...\n"
 				"  duid        <action> ...\n"
 				"  arp         <action> ...\n"
+				"  shell       [options]\n"
+				"  stats       [options]\n"
 				"\n"
 				, program);
 			goto done;
@@ -241,6 +251,11 @@ main(int argc, char **argv)
 		case OPT_SYSTEMD:
 			opt_systemd = TRUE;
 			break;
+
+		case OPT_PROFILE:
+			opt_profile = optarg;
+			ni_profile_enable();
+			break;
 		}
 	}
 
@@ -263,6 +278,7 @@ main(int argc, char **argv)
 		ni_log_destination(program, "syslog:user:perror");
 	}
 
+	ni_profile_enter(program);
 	if (ni_init("client") < 0) {
 		status = NI_WICKED_RC_ERROR;
 		goto done;
@@ -275,83 +291,114 @@ main(int argc, char **argv)
 
 	show_exec_info(argc, argv);
 
+	ni_profile_enter(cmd);
+	status = ni_wicked_command(program, argc - optind, argv + optind);
+	ni_profile_leave();
+	if (status < 0) {
+		fprintf(stderr, "Unsupported command %s\n", cmd);
+		status = NI_WICKED_RC_USAGE;
+		goto usage;
+	}
+
+done:
+	if (opt_profile)
+		ni_profile_write(opt_profile);
+	ni_debug_application("Exit with status: %d", status);
+	ni_string_free(&opt_global_rootdir);
+	return status;
+}
+
+/*
+ * Run a wicked command; returns -1 when the command is not supported.
+ */
+int
+ni_wicked_command(const char *program, int argc, char **argv)
+{
+	const char *cmd = argv[0];
+	int status;
+
 	if (!strcmp(cmd, "ifup")) {
-		status = ni_do_ifup(argc - optind, argv + optind);
+		status = ni_do_ifup(argc, argv);
 	} else
 	if (!strcmp(cmd, "ifdown")) {
-		status = ni_do_ifdown(argc - optind, argv + optind);
+		status = ni_do_ifdown(argc, argv);
 	} else
 	if (!strcmp(cmd, "ifcheck")) {
-		status = ni_do_ifcheck(argc - optind, argv + optind);
+		status = ni_do_ifcheck(argc, argv);
 	} else
 	if (!strcmp(cmd, "ifreload")) {
-		status = ni_do_ifreload(program, argc - optind, argv + optind);
+		status = ni_do_ifreload(program, argc, argv);
 	} else
 	if (!strcmp(cmd, "ifstatus")) {
-		status = ni_do_ifstatus(argc - optind, argv + optind);
+		status = ni_do_ifstatus(argc, argv);
 	} else
 	if (!strcmp(cmd, "show")) {
-		status = ni_do_ifstatus(argc - optind, argv + optind);
+		status = ni_do_ifstatus(argc, argv);
 	} else
 	if (!strcmp(cmd, "show-xml")) {
-		status = do_show_xml(argc - optind, argv + optind);
+		status = do_show_xml(argc, argv);
 	} else
 	if (!strcmp(cmd, "show-config")) {
-		status = ni_wicked_convert(program, argc - optind, argv + optind);
+		status = ni_wicked_convert(program, argc, argv);
 	} else
 	if (!strcmp(cmd, "show-policy")) {
-		status = ni_wicked_convert(program, argc - optind, argv + optind);
+		status = ni_wicked_convert(program, argc, argv);
 	} else
 	if (!strcmp(cmd, "convert")) {
-		status = ni_wicked_convert(program, argc - optind, argv + optind);
+		status = ni_wicked_convert(program, argc, argv);
 	} else
 	if (!strcmp(cmd, "nanny")) {
-		status = do_nanny(argc - optind, argv + optind);
+		status = do_nanny(argc, argv);
 	} else
 	if (!strcmp(cmd, "xpath")) {
-		status = do_xpath(argc - optind, argv + optind);
+		status = do_xpath(argc, argv);
 	} else
 	if (!strcmp(cmd, "lease")) {
-		status = do_lease(argc - optind, argv + optind);
+		status = do_lease(argc, argv);
 	} else
 	if (!strcmp(cmd, "check")) {
-		status = do_check(argc - optind, argv + optind);
+		status = do_check(argc, argv);
 	} else
 	if (!strcmp(cmd, "getnames")) {
-		status = do_get_names(argc - optind, argv + optind);
+		status = do_get_names(argc, argv);
 	} else
 	if (!strcmp(cmd, "duid")) {
-		status = ni_do_duid(program, argc - optind, argv + optind);
+		status = ni_do_duid(program, argc, argv);
 	} else
 	if (!strcmp(cmd, "iaid")) {
-		status = ni_do_iaid(program, argc - optind, argv + optind);
+		status = ni_do_iaid(program, argc, argv);
 	} else
 	if (!strcmp(cmd, "test")) {
-		status = ni_do_test(program, argc - optind, argv + optind);
+		status = ni_do_test(program, argc, argv);
 	} else
 	if (!strcmp(cmd, "arp")) {
-		status = ni_do_arp(program, argc - optind, argv + optind);
+		status = ni_do_arp(program, argc, argv);
 	} else
 	if (!strcmp(cmd, "ethtool")) {
-		status = ni_do_ethtool(program, argc - optind, argv + optind);
+		status = ni_do_ethtool(program, argc, argv);
+	} else
+	if (!strcmp(cmd, "initrd")) {
+		status = ni_do_initrd(argc, argv);
 	} else
 	if (!strcmp(cmd, "bootstrap")) {
-		 status = ni_do_ifup(argc - optind, argv + optind);
+		 status = ni_do_ifup(argc, argv);
 	} else
 	if (!strcmp(cmd, "redfish")) {
-		 status = ni_wicked_redfish(program, argc - optind, argv + optind);
+		 status = ni_wicked_redfish(program, argc, argv);
 	} else
 	if (!strcmp(cmd, "firmware")) {
-		 status = ni_wicked_firmware(program, argc - optind, argv + optind);
+		 status = ni_wicked_firmware(program, argc, argv);
+	} else
+	if (!strcmp(cmd, "shell")) {
+		status = ni_do_shell(program, argc, argv);
+	} else
+	if (!strcmp(cmd, "stats")) {
+		status = ni_do_stats(program, argc, argv);
 	} else {
-		fprintf(stderr, "Unsupported command %s\n", cmd);
-		goto usage;
+		status = -1;
 	}
-
-done:
-	ni_debug_application("Exit with status: %d", status);
-	ni_string_free(&opt_global_rootdir);
 	return status;
+
 }
 
 /*
@@ -366,8 +413,8 @@ get_netif_list_object(void)
 		if (!(interfaces = ni_call_get_netif_list_object()))
 			return NULL;
 
-		/* Call ObjectManager.GetManagedObjects to get list of objects and their properties */
-		if (!ni_dbus_object_refresh_children(interfaces)) {
+		/* Get the list of objects and their properties in pages */
+		if (!ni_call_refresh_netif_list(interfaces)) {
 			ni_error("Couldn't get list of active network interfaces");
 			return NULL;
 		}
@@ -1492,6 +1539,7 @@ do_check(int argc, char **argv)
 			ni_sockaddr_t *addr = &address[i];
 
 			if (addr->ss_family == AF_UNSPEC) {
+				ni_error("unable to resolve %s", hostname);
 				failed++;
 				if (opt_dbus_error_file) {
 					write_dbus_error(opt_dbus_error_file,
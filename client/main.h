@@ -34,4 +34,8 @@ extern int	ni_wicked_convert(const char *caller, int argc, char **argv);
 extern int	ni_wicked_redfish(const char *caller, int argc, char **argv);
 extern int	ni_wicked_firmware(const char *caller, int argc, char **argv);
 
+extern int	ni_do_shell(const char *caller, int argc, char **argv);
+extern int	ni_do_stats(const char *caller, int argc, char **argv);
+extern int	ni_wicked_command(const char *caller, int argc, char **argv);
+
 #endif /* WICKED_CLIENT_MAIN_H */
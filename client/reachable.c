@@ -25,57 +25,251 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+#include <sys/time.h>
+
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
+#include <wicked/resolver.h>
 #include <wicked/xml.h>
 #include <wicked/fsm.h>
 
 #include "wicked-client.h"
-
+#include "util_priv.h"
 
 /*
- * Data needed for this check
+ * The reachability checks of all requirements are performed by a shared
+ * checker: requirements with the same host and address family share one
+ * target and all targets are resolved in one batch per address family
+ * and checked together, but only when an address has been acquired, the
+ * resolver was updated, a resolved address expired or the retry timer
+ * waking up the fsm mainloop while targets are unreachable fired.
  */
-typedef struct ni_reachability_check {
+#define NI_REACHABLE_RESOLVE_TIMEOUT	1	/* sec, of a batch		*/
+#define NI_REACHABLE_RESOLVE_TTL	60	/* sec, of a resolved address	*/
+#define NI_REACHABLE_RESOLVE_RETRY	5	/* sec, of an unresolved host	*/
+#define NI_REACHABLE_CHECK_RETRY	1000	/* msec, of unreachable hosts	*/
+
+typedef struct ni_reachability_target	ni_reachability_target_t;
+
+struct ni_reachability_target {
+	ni_reachability_target_t *next;
+	unsigned int		users;
+
 	char *			hostname;
 	int			family;
 
 	ni_bool_t		address_valid;
 	ni_sockaddr_t		address;
+	struct timeval		resolve_after;	/* expiry or retry time	*/
+	ni_bool_t		reachable;
+};
+
+static struct {
+	ni_reachability_target_t *targets;
+	ni_bool_t		checked;
+	unsigned int		address_seq;
+	unsigned int		resolver_seq;
+	struct timeval		retry_after;
+	const ni_timer_t *	timer;
+} ni_reachability;
+
+/*
+ * Data needed for this check
+ */
+typedef struct ni_reachability_check {
+	ni_reachability_target_t *target;
 } ni_reachability_check_t;
 
 
-static ni_bool_t
-ni_fsm_require_check_reachable(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_require_t *req)
+static ni_reachability_target_t *
+ni_reachability_target_ref(const char *hostname, int family)
 {
-	ni_reachability_check_t *check = req->user_data;
+	ni_reachability_target_t *target;
+
+	for (target = ni_reachability.targets; target; target = target->next) {
+		if (target->family == family && ni_string_eq(target->hostname, hostname)) {
+			target->users++;
+			return target;
+		}
+	}
 
-	/* Do not check too often. If the dhcp or routing info didn't change,
-	 * there is no point wasting time on another lookup. */
-	if (req->event_seq == fsm->last_event_seq[NI_EVENT_ADDRESS_ACQUIRED]) {
-		ni_debug_application("check reachability: %s SKIP", check->hostname);
-		return FALSE;
+	target = xcalloc(1, sizeof(*target));
+	ni_string_dup(&target->hostname, hostname);
+	target->family = family;
+	target->users = 1;
+	target->next = ni_reachability.targets;
+	ni_reachability.targets = target;
+
+	/* (re)check all targets including the new one in the next batch */
+	ni_reachability.checked = FALSE;
+	return target;
+}
+
+static void
+ni_reachability_target_unref(ni_reachability_target_t *target)
+{
+	ni_reachability_target_t **pos, *cur;
+
+	if (!target || --target->users)
+		return;
+
+	for (pos = &ni_reachability.targets; (cur = *pos); pos = &cur->next) {
+		if (cur == target) {
+			*pos = cur->next;
+			break;
+		}
+	}
+	ni_string_free(&target->hostname);
+	free(target);
+
+	if (!ni_reachability.targets && ni_reachability.timer) {
+		ni_timer_cancel(ni_reachability.timer);
+		ni_reachability.timer = NULL;
 	}
+}
+
+static void
+ni_reachability_timeout(void *user_data, const ni_timer_t *timer)
+{
+	/* nothing to do, the fsm mainloop runs the checks again */
+	if (ni_reachability.timer == timer)
+		ni_reachability.timer = NULL;
+}
+
+static void
+ni_reachability_resolve(int family, const struct timeval *now)
+{
+	ni_reachability_target_t *target;
+	ni_sockaddr_t *addrs;
+	const char **names;
+	unsigned int count = 0, i;
+
+	for (target = ni_reachability.targets; target; target = target->next) {
+		if (target->family == family && !target->address_valid &&
+		    !timercmp(now, &target->resolve_after, <))
+			count++;
+	}
+	if (!count)
+		return;
+
+	names = xcalloc(count, sizeof(names[0]));
+	addrs = xcalloc(count, sizeof(addrs[0]));
+	for (i = 0, target = ni_reachability.targets; target; target = target->next) {
+		if (target->family == family && !target->address_valid &&
+		    !timercmp(now, &target->resolve_after, <))
+			names[i++] = target->hostname;
+	}
+
+	ni_debug_application("check reachability: resolving %u host name(s)%s%s", count,
+			family == AF_UNSPEC ? "" : " in ",
+			family == AF_UNSPEC ? "" : ni_addrfamily_type_to_name(family));
+	if (ni_resolve_hostnames_timed(family, count, names, addrs,
+				NI_REACHABLE_RESOLVE_TIMEOUT) < 0)
+		memset(addrs, 0, count * sizeof(addrs[0]));
+
+	for (i = 0, target = ni_reachability.targets; target && i < count; target = target->next) {
+		if (target->family != family || target->hostname != names[i])
+			continue;
+
+		target->resolve_after = *now;
+		if (addrs[i].ss_family == AF_UNSPEC) {
+			ni_debug_application("check reachability: %s not resolvable",
+					target->hostname);
+			target->resolve_after.tv_sec += NI_REACHABLE_RESOLVE_RETRY;
+		} else {
+			target->address = addrs[i];
+			target->address_valid = TRUE;
+			target->resolve_after.tv_sec += NI_REACHABLE_RESOLVE_TTL;
+		}
+		i++;
+	}
+
+	free(names);
+	free(addrs);
+}
+
+/*
+ * Resolve and check all targets, when something relevant changed.
+ */
+static void
+ni_reachability_update(ni_fsm_t *fsm)
+{
+	static const int families[] = { AF_UNSPEC, AF_INET, AF_INET6 };
+	ni_reachability_target_t *target;
+	ni_bool_t changed = FALSE;
+	unsigned int pending = 0, i;
+	struct timeval now;
+
+	ni_timer_get_time(&now);
+
 	/* Force another lookup if the resolver was updated in the meantime */
-	if (req->event_seq < fsm->last_event_seq[NI_EVENT_RESOLVER_UPDATED])
-		check->address_valid = FALSE;
-	req->event_seq = fsm->event_seq;
-
-	if (!check->address_valid
-	 && ni_resolve_hostname_timed(check->hostname, check->family, &check->address, 1) <= 0) {
-		ni_debug_application("check reachability: %s not resolvable", check->hostname);
-		return FALSE;
+	if (ni_reachability.resolver_seq != fsm->last_event_seq[NI_EVENT_RESOLVER_UPDATED]) {
+		ni_reachability.resolver_seq = fsm->last_event_seq[NI_EVENT_RESOLVER_UPDATED];
+		for (target = ni_reachability.targets; target; target = target->next)
+			target->address_valid = FALSE;
+		changed = TRUE;
 	}
-	check->address_valid = TRUE;
 
-	if (ni_host_is_reachable(check->hostname, &check->address) <= 0) {
-		ni_debug_application("check reachability: %s not reachable at %s",
-				check->hostname, ni_sockaddr_print(&check->address));
-		return FALSE;
+	/* Address (dhcp or routing info) changes can make all targets reachable */
+	if (ni_reachability.address_seq != fsm->last_event_seq[NI_EVENT_ADDRESS_ACQUIRED]) {
+		ni_reachability.address_seq = fsm->last_event_seq[NI_EVENT_ADDRESS_ACQUIRED];
+		changed = TRUE;
 	}
 
-	ni_debug_application("check reachability: %s OK", check->hostname);
-	return TRUE;
+	for (target = ni_reachability.targets; target; target = target->next) {
+		if (target->address_valid && !timercmp(&now, &target->resolve_after, <)) {
+			target->address_valid = FALSE;
+			changed = TRUE;
+		}
+	}
+
+	/* on changes, retry to resolve the unresolved hosts immediately */
+	for (target = ni_reachability.targets; changed && target; target = target->next) {
+		if (!target->address_valid)
+			timerclear(&target->resolve_after);
+	}
+
+	/* Do not check too often; also the retry applies to unreachable ones */
+	if (ni_reachability.checked && !changed && timercmp(&now, &ni_reachability.retry_after, <))
+		return;
+
+	for (i = 0; i < sizeof(families)/sizeof(families[0]); ++i)
+		ni_reachability_resolve(families[i], &now);
+
+	for (target = ni_reachability.targets; target; target = target->next) {
+		ni_bool_t reachable = target->address_valid &&
+			ni_host_is_reachable(target->hostname, &target->address) > 0;
+
+		if (reachable != target->reachable || !ni_reachability.checked) {
+			if (reachable) {
+				ni_debug_application("check reachability: %s OK", target->hostname);
+			} else if (target->address_valid) {
+				ni_debug_application("check reachability: %s not reachable at %s",
+						target->hostname, ni_sockaddr_print(&target->address));
+			}
+		}
+		target->reachable = reachable;
+		if (!reachable)
+			pending++;
+	}
+	ni_reachability.checked = TRUE;
+
+	ni_reachability.retry_after = now;
+	ni_timeval_add_timeout(&ni_reachability.retry_after, NI_REACHABLE_CHECK_RETRY);
+	if (pending && !ni_reachability.timer) {
+		ni_reachability.timer = ni_timer_register(NI_REACHABLE_CHECK_RETRY,
+				ni_reachability_timeout, NULL);
+	}
+}
+
+static ni_bool_t
+ni_fsm_require_check_reachable(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_require_t *req)
+{
+	ni_reachability_check_t *check = req->user_data;
+
+	ni_reachability_update(fsm);
+	return check->target->reachable;
 }
 
 static void
@@ -84,7 +278,7 @@ ni_ifworker_reachability_check_destroy(ni_fsm_require_t *req)
 	ni_reachability_check_t *check = req->user_data;
 
 	if (check != NULL) {
-		ni_string_free(&check->hostname);
+		ni_reachability_target_unref(check->target);
 		free(check);
 	}
 
@@ -112,12 +306,10 @@ ni_ifworker_reachability_check_new(xml_node_t *node)
 
 
 	check = calloc(1, sizeof(*check));
-	ni_string_dup(&check->hostname, hostname);
-	check->family = afhint;
+	check->target = ni_reachability_target_ref(hostname, afhint);
 
 	req = ni_fsm_require_new(ni_fsm_require_check_reachable, ni_ifworker_reachability_check_destroy);
 	req->user_data = check;
 
 	return req;
 }
-
@@ -36,22 +36,31 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
 #include <sys/param.h>
+#include <sys/stat.h>
 
 #include <wicked/util.h>
 #include <wicked/logging.h>
 #include <wicked/netinfo.h>
 
 #include "appconfig.h"
+#include "util_priv.h"
+#include "buffer.h"
 #include "wicked-client.h"
 #include "client/ifconfig.h"
 #include "client/read-config.h"
 #include "dracut/dracut.h"
 #include "firmware.h"
+#include "profile.h"
 
 #if defined(COMPAT_AUTO) || defined(COMPAT_SUSE)
 extern ni_bool_t	__ni_suse_get_ifconfig(const char *, const char *,
 						ni_compat_ifconfig_t *);
+extern ni_bool_t	__ni_suse_get_ifconfig_digest(const char *, const char *,
+						ni_hashctx_t *);
 #endif
 #if defined(COMPAT_AUTO) || defined(COMPAT_REDHAT)
 extern ni_bool_t	__ni_redhat_get_ifconfig(const char *, const char *,
@@ -105,6 +114,16 @@ static ni_bool_t	ni_ifconfig_read_firmware(xml_document_array_t *,
 						ni_bool_t,
 						ni_bool_t);
 
+static ni_bool_t	ni_ifconfig_digest_wicked(const char *,
+						const char *,
+						ni_hashctx_t *);
+static ni_bool_t	ni_ifconfig_digest_wicked_xml(const char *,
+						const char *,
+						ni_hashctx_t *);
+static ni_bool_t	ni_ifconfig_digest_compat(const char *,
+						const char *,
+						ni_hashctx_t *);
+
 const ni_ifconfig_type_t *
 ni_ifconfig_find_map(const ni_ifconfig_type_t *map, const char *name, size_t len)
 {
@@ -167,6 +186,37 @@ ni_ifconfig_read_subtype(xml_document_array_t *array, const ni_ifconfig_type_t *
 	return ret;
 }
 
+/*
+ * Digest the status of the files a config source reads, the same way
+ * as ni_ifconfig_read_subtype dispatches the read. Sources without a
+ * digest function (e.g. firmware discovery running scripts) fail.
+ */
+ni_bool_t
+ni_ifconfig_digest_subtype(const ni_ifconfig_type_t *type, const char *root,
+			const char *path, ni_hashctx_t *ctx)
+{
+	const ni_ifconfig_type_t *map;
+	const char *sub_path = path;
+	const char *sub_name = NULL;
+	size_t len;
+
+	if (!ctx || !type || !path)
+		return FALSE;
+
+	len = strcspn(path, ":");
+	if (path[len] == ':') {
+		sub_name = len ? path : NULL;
+		sub_path = path + len + 1;
+	}
+
+	map = ni_ifconfig_find_type(type, root, path, sub_name, len);
+	if (!map || !map->name || !map->ops.digest)
+		return FALSE;
+
+	ni_hashctx_puts(ctx, map->name);
+	return map->ops.digest(root, sub_path, ctx);
+}
+
 const ni_ifconfig_type_t *
 ni_ifconfig_guess_compat_type(const ni_ifconfig_type_t *map,
 				const char *root, const char *path)
@@ -244,13 +294,15 @@ ni_ifconfig_guess_type(const ni_ifconfig_type_t *map,
 }
 
 static const ni_ifconfig_type_t		ni_ifconfig_types_wicked[] = {
-	{ "xml",	{ .read = ni_ifconfig_read_wicked_xml	} },
+	{ "xml",	{ .read = ni_ifconfig_read_wicked_xml,
+			  .digest = ni_ifconfig_digest_wicked_xml } },
 	{ NULL,		{ .guess= ni_ifconfig_guess_wicked_type	} },
 };
 
 static const ni_ifconfig_type_t		ni_ifconfig_types_compat[] = {
 #if defined(COMPAT_AUTO) || defined(COMPAT_SUSE)
-	{ "suse",	{ .read = ni_ifconfig_read_compat_suse	} },
+	{ "suse",	{ .read = ni_ifconfig_read_compat_suse,
+			  .digest = __ni_suse_get_ifconfig_digest } },
 #endif
 #if defined(COMPAT_AUTO) || defined(COMPAT_REDHAT)
 	{ "redhat",	{ .read = ni_ifconfig_read_compat_redhat} },
@@ -259,8 +311,10 @@ static const ni_ifconfig_type_t		ni_ifconfig_types_compat[] = {
 };
 
 static const ni_ifconfig_type_t		ni_ifconfig_types[] = {
-	{ "wicked",	{ .read = ni_ifconfig_read_wicked	} },
-	{ "compat",	{ .read = ni_ifconfig_read_compat	} },
+	{ "wicked",	{ .read = ni_ifconfig_read_wicked,
+			  .digest = ni_ifconfig_digest_wicked	} },
+	{ "compat",	{ .read = ni_ifconfig_read_compat,
+			  .digest = ni_ifconfig_digest_compat	} },
 	{ "firmware",	{ .read = ni_ifconfig_read_firmware	} },
 	{ "dracut",	{ .read = ni_ifconfig_read_dracut	} },
 	{ NULL,		{ .guess= ni_ifconfig_guess_type	} },
@@ -273,29 +327,39 @@ ni_ifconfig_load(ni_fsm_t *fsm, const char *root, ni_string_array_t *opt_ifconfi
 	ni_ifconfig_kind_t kind = NI_IFCONFIG_KIND_CONFIG; /* load into fsm */
 	unsigned int i;
 
+	ni_profile_enter("ifconfig-read");
 	for (i = 0; i < opt_ifconfig->count; ++i) {
 		if (!ni_ifconfig_read(&docs, root, opt_ifconfig->data[i], kind, check_prio, raw)) {
 			xml_document_array_destroy(&docs);
+			ni_profile_leave();
 			return FALSE;
 		}
 	}
+	ni_profile_leave();
 
+	ni_profile_enter("ifconfig-workers");
 	for (i = 0; i < docs.count; i++) {
-		xml_node_t *root, *ifnode;
+		xml_node_t *root;
 		const char *origin;
 
 		root = xml_document_root(docs.data[i]);
 		origin = xml_node_location_filename(root);
-		for (ifnode = root->children; ifnode; ifnode = ifnode->next) {
-			/* We do not fail when unable to generate ifworker */
-			ni_fsm_workers_from_xml(fsm, ifnode, origin);
-		}
+
+		/* We do not fail when unable to generate ifworker */
+		ni_fsm_workers_from_xml_list(fsm, root, origin);
 	}
 
 	xml_document_array_destroy(&docs);
+	ni_profile_leave();
 	return TRUE;
 }
 
+ni_bool_t
+ni_ifconfig_digest(const char *root, const char *path, ni_hashctx_t *ctx)
+{
+	return ni_ifconfig_digest_subtype(ni_ifconfig_types, root, path, ctx);
+}
+
 ni_bool_t
 ni_ifconfig_read(xml_document_array_t *array, const char *root, const char *path, ni_ifconfig_kind_t kind, ni_bool_t check_prio, ni_bool_t raw)
 {
@@ -398,11 +462,18 @@ ni_ifconfig_read_get_ifname(xml_node_t *ifnode, char **ifname)
 	return TRUE;
 }
 
+/*
+ * Already processed configs, hashed by interface name: a single
+ * array lookup per config is quadratic with thousands of ifcfg files.
+ */
+#define NI_IFCONFIG_VALIDATED_BUCKETS	256
+
 ni_bool_t
 ni_ifconfig_validate_adding_doc(xml_document_t *config_doc, ni_bool_t check_prio)
 {
-	static ni_var_array_t validated_cfgs; /* Array of already processed configs */
+	static ni_var_array_t validated_cfgs[NI_IFCONFIG_VALIDATED_BUCKETS];
 	ni_config_origin_prio_t src_prio, dst_prio;
+	ni_var_array_t *bucket;
 	xml_node_t *src_root, *src_child;
 	char *ifname = NULL;
 
@@ -427,7 +498,8 @@ ni_ifconfig_validate_adding_doc(xml_document_t *config_doc, ni_bool_t check_prio
 		if (!ni_ifconfig_read_get_ifname(src_child, &ifname))
 			goto cleanup;
 
-		rv = ni_var_array_get_uint(&validated_cfgs, ifname, &dst_prio);
+		bucket = &validated_cfgs[ni_string_hash(ifname) % NI_IFCONFIG_VALIDATED_BUCKETS];
+		rv = ni_var_array_get_uint(bucket, ifname, &dst_prio);
 		if (rv < 0)
 			goto cleanup;
 
@@ -437,7 +509,7 @@ ni_ifconfig_validate_adding_doc(xml_document_t *config_doc, ni_bool_t check_prio
 			goto cleanup;
 		}
 
-		ni_var_array_set_uint(&validated_cfgs, ifname, src_prio);
+		ni_var_array_set_uint(bucket, ifname, src_prio);
 	}
 
 	ni_string_free(&ifname);
@@ -575,6 +647,31 @@ ni_ifconfig_read_wicked_xml(xml_document_array_t *array,
 	return rv;
 }
 
+ni_bool_t
+ni_ifconfig_digest_wicked_xml(const char *root, const char *path, ni_hashctx_t *ctx)
+{
+	char *ifconfig_dir = NULL;
+	char pathbuf[PATH_MAX];
+
+	if (ni_string_empty(path)) {
+		ni_string_printf(&ifconfig_dir, "%s/%s", ni_get_global_config_dir(), "ifconfig");
+		path = ifconfig_dir;
+	}
+
+	if (ni_string_empty(root)) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s", path);
+	} else {
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", root, path);
+	}
+	ni_string_free(&ifconfig_dir);
+
+	if (ni_isdir(pathbuf))
+		ni_ifconfig_cache_digest_dir(ctx, pathbuf);
+	else
+		ni_ifconfig_cache_digest_file(ctx, pathbuf);
+	return TRUE;
+}
+
 ni_bool_t
 ni_ifconfig_read_wicked(xml_document_array_t *array,
 			const char *type, const char *root, const char *path,
@@ -583,12 +680,516 @@ ni_ifconfig_read_wicked(xml_document_array_t *array,
 	return ni_ifconfig_read_subtype(array, ni_ifconfig_types_wicked, root, path, kind, prio, raw, type);
 }
 
+ni_bool_t
+ni_ifconfig_digest_wicked(const char *root, const char *path, ni_hashctx_t *ctx)
+{
+	return ni_ifconfig_digest_subtype(ni_ifconfig_types_wicked, root, path, ctx);
+}
+
+/*
+ * Converted compat config cache.
+ *
+ * Converting thousands of ifcfg files is a noticeable part of the run
+ * time of every wicked client call. The cache stores the documents
+ * generated from a compat source in a compact binary form in the state
+ * directory. Unlike the schema cache, it does not validate single files:
+ * the conversion of an ifcfg file depends on the global config files and
+ * on the other ifcfg files, e.g. bonding slaves. The cache is keyed by a
+ * digest over the status of all files the conversion reads instead and
+ * replaced by a full conversion on any change.
+ */
+#define NI_IFCONFIG_CACHE_MAGIC		"WICKEDIC"
+#define NI_IFCONFIG_CACHE_VERSION	1U
+#define NI_IFCONFIG_CACHE_MAX_SIZE	(64U << 20)
+
+typedef struct ni_ifconfig_cache {
+	char *			filename;
+	unsigned char		digest[20];
+} ni_ifconfig_cache_t;
+
+void
+ni_ifconfig_cache_digest_file(ni_hashctx_t *ctx, const char *filename)
+{
+	uint64_t status[7];
+	struct stat stb;
+
+	if (!ctx || ni_string_empty(filename))
+		return;
+
+	ni_hashctx_put(ctx, filename, strlen(filename) + 1);
+	memset(status, 0, sizeof(status));
+	if (stat(filename, &stb) == 0) {
+		status[0] = stb.st_dev;
+		status[1] = stb.st_ino;
+		status[2] = stb.st_size;
+		status[3] = stb.st_mtim.tv_sec;
+		status[4] = stb.st_mtim.tv_nsec;
+		status[5] = stb.st_ctim.tv_sec;
+		status[6] = stb.st_ctim.tv_nsec;
+	}
+	ni_hashctx_put(ctx, status, sizeof(status));
+}
+
+void
+ni_ifconfig_cache_digest_dir(ni_hashctx_t *ctx, const char *dirname)
+{
+	ni_string_array_t names = NI_STRING_ARRAY_INIT;
+	char *filename = NULL;
+	unsigned int i;
+
+	ni_ifconfig_cache_digest_file(ctx, dirname);
+	if (!ni_isdir(dirname) || !ni_scandir(dirname, NULL, &names))
+		return;
+
+	for (i = 0; i < names.count; ++i) {
+		if (ni_string_printf(&filename, "%s/%s", dirname, names.data[i]))
+			ni_ifconfig_cache_digest_file(ctx, filename);
+	}
+	ni_string_free(&filename);
+	ni_string_array_destroy(&names);
+}
+
+static ni_bool_t
+ni_ifconfig_cache_init(ni_ifconfig_cache_t *cache, const char *type,
+			const char *root, const char *path, ni_ifconfig_kind_t kind,
+			ni_bool_t raw, ni_bool_t (*digest)(const char *, const char *, ni_hashctx_t *))
+{
+	ni_stringbuf_t key = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_hashctx_t *ctx;
+	ni_bool_t ret = FALSE;
+
+	memset(cache, 0, sizeof(*cache));
+	if (!(ctx = ni_hashctx_new(NI_HASHCTX_SHA1)))
+		return FALSE;
+
+	ni_stringbuf_printf(&key, "%s:%s:%s:%s:%s", type, root ? root : "", path ? path : "",
+				ni_ifconfig_kind_to_name(kind), raw ? "raw" : "");
+
+	ni_hashctx_begin(ctx);
+	ni_hashctx_puts(ctx, PACKAGE_VERSION);
+	ni_hashctx_put(ctx, key.string, key.len + 1);
+	ni_ifconfig_cache_digest_file(ctx, ni_global.config_path);
+	ni_ifconfig_cache_digest_dir(ctx, ni_global.config_dir);
+	if (digest(root, path, ctx)) {
+		ni_hashctx_finish(ctx);
+		if (ni_hashctx_get_digest(ctx, cache->digest, sizeof(cache->digest)) > 0 &&
+		    ni_string_printf(&cache->filename, "%s/ifconfig-cache-%08x.bin",
+				ni_config_statedir(), ni_string_hash(key.string)))
+			ret = TRUE;
+	}
+
+	ni_hashctx_free(ctx);
+	ni_stringbuf_destroy(&key);
+	return ret;
+}
+
+static void
+ni_ifconfig_cache_destroy(ni_ifconfig_cache_t *cache)
+{
+	ni_string_free(&cache->filename);
+}
+
+static ni_bool_t
+ni_ifconfig_cache_get_uint32(ni_buffer_t *bp, uint32_t *value)
+{
+	return ni_buffer_get(bp, value, sizeof(*value)) == 0;
+}
+
+static ni_bool_t
+ni_ifconfig_cache_parse(const ni_ifconfig_cache_t *cache, ni_buffer_t *bp,
+			xml_document_array_t *docs, unsigned int *wait_for_interfaces)
+{
+	char magic[sizeof(NI_IFCONFIG_CACHE_MAGIC) - 1];
+	unsigned char digest[sizeof(cache->digest)];
+	uint32_t version, wait, count, len;
+	char *origin = NULL;
+	xml_document_t *doc;
+	xml_node_t *node;
+
+	if (ni_buffer_get(bp, magic, sizeof(magic)) < 0 ||
+	    memcmp(magic, NI_IFCONFIG_CACHE_MAGIC, sizeof(magic)) ||
+	    !ni_ifconfig_cache_get_uint32(bp, &version) || version != NI_IFCONFIG_CACHE_VERSION ||
+	    ni_buffer_get(bp, digest, sizeof(digest)) < 0 ||
+	    memcmp(digest, cache->digest, sizeof(digest)) ||
+	    !ni_ifconfig_cache_get_uint32(bp, &wait) ||
+	    !ni_ifconfig_cache_get_uint32(bp, &count))
+		return FALSE;
+
+	while (count--) {
+		size_t used = 0;
+
+		if (!ni_ifconfig_cache_get_uint32(bp, &len) || len == 0 ||
+		    len > ni_buffer_count(bp))
+			goto failed;
+		ni_string_set(&origin, ni_buffer_head(bp), len);
+		ni_buffer_pull_head(bp, len);
+
+		node = xml_node_read_binary(ni_buffer_head(bp),
+				ni_buffer_count(bp), &used, origin);
+		if (!node)
+			goto failed;
+		ni_buffer_pull_head(bp, used);
+
+		doc = xml_document_new();
+		xml_document_set_root(doc, node);
+		xml_document_array_append(docs, doc);
+	}
+	ni_string_free(&origin);
+
+	*wait_for_interfaces = wait;
+	return ni_buffer_count(bp) == 0;
+
+failed:
+	ni_string_free(&origin);
+	return FALSE;
+}
+
+static ni_bool_t
+ni_ifconfig_cache_load(const ni_ifconfig_cache_t *cache, xml_document_array_t *docs)
+{
+	extern unsigned int ni_wait_for_interfaces;
+	unsigned int wait = 0;
+	ni_bool_t ret;
+	ni_buffer_t buf;
+	size_t len = 0;
+	void *data;
+	FILE *fp;
+
+	if (!(fp = fopen(cache->filename, "re"))) {
+		if (errno != ENOENT)
+			ni_warn("unable to open ifconfig cache %s: %m", cache->filename);
+		return FALSE;
+	}
+
+	data = ni_file_read(fp, &len, NI_IFCONFIG_CACHE_MAX_SIZE);
+	fclose(fp);
+	if (!data)
+		return FALSE;
+
+	ni_buffer_init_reader(&buf, data, len);
+	if ((ret = ni_ifconfig_cache_parse(cache, &buf, docs, &wait))) {
+		ni_debug_ifconfig("using ifconfig cache %s", cache->filename);
+		ni_wait_for_interfaces = wait;
+	} else {
+		ni_debug_ifconfig("ignoring stale or invalid ifconfig cache %s",
+				cache->filename);
+		xml_document_array_destroy(docs);
+	}
+	free(data);
+	return ret;
+}
+
+static inline void
+ni_ifconfig_cache_put_uint32(ni_stringbuf_t *out, uint32_t value)
+{
+	ni_stringbuf_put(out, (const char *)&value, sizeof(value));
+}
+
+static int
+ni_ifconfig_cache_save(const ni_ifconfig_cache_t *cache, const xml_document_array_t *docs)
+{
+	extern unsigned int ni_wait_for_interfaces;
+	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
+	char tempname[PATH_MAX];
+	unsigned int i;
+	int fd, ret = -1;
+	FILE *fp;
+
+	ni_stringbuf_put(&out, NI_IFCONFIG_CACHE_MAGIC, sizeof(NI_IFCONFIG_CACHE_MAGIC) - 1);
+	ni_ifconfig_cache_put_uint32(&out, NI_IFCONFIG_CACHE_VERSION);
+	ni_stringbuf_put(&out, (const char *)cache->digest, sizeof(cache->digest));
+	ni_ifconfig_cache_put_uint32(&out, ni_wait_for_interfaces);
+	ni_ifconfig_cache_put_uint32(&out, docs->count);
+	for (i = 0; i < docs->count; ++i) {
+		xml_node_t *root = xml_document_root(docs->data[i]);
+		const char *origin = root ? xml_node_location_filename(root) : NULL;
+
+		if (ni_string_empty(origin))
+			goto failed;
+
+		ni_ifconfig_cache_put_uint32(&out, strlen(origin));
+		ni_stringbuf_puts(&out, origin);
+		if (xml_node_write_binary(root, &out) < 0)
+			goto failed;
+	}
+	if (out.len > NI_IFCONFIG_CACHE_MAX_SIZE)
+		goto failed;
+
+	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", cache->filename);
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_debug_ifconfig("cannot create temporary ifconfig cache file %s: %m",
+				tempname);
+		goto failed;
+	}
+	if (!(fp = fdopen(fd, "we"))) {
+		close(fd);
+		unlink(tempname);
+		goto failed;
+	}
+
+	if (ni_file_write(fp, out.string, out.len) < 0) {
+		ni_error("unable to write ifconfig cache %s", tempname);
+		fclose(fp);
+		unlink(tempname);
+		goto failed;
+	}
+	if (fclose(fp) != 0 || rename(tempname, cache->filename) < 0) {
+		ni_error("unable to write ifconfig cache %s: %m", cache->filename);
+		unlink(tempname);
+		goto failed;
+	}
+	ret = 0;
+
+failed:
+	ni_stringbuf_destroy(&out);
+	return ret;
+}
+
+/*
+ * Config uuid index.
+ *
+ * Checks comparing the config uuid of the interfaces with the uuid in
+ * the client state of the devices (ifcheck --changed) do not need the
+ * configs, but the uuid hashed over the config of each interface only.
+ * The index stores the name, origin and uuid of the configs of all
+ * interfaces loaded from a set of sources and is keyed by a digest over
+ * the status of the files the sources read. It is only available when
+ * all sources provide a digest function.
+ */
+#define NI_IFCONFIG_INDEX_MAGIC		"WICKEDUI"
+#define NI_IFCONFIG_INDEX_VERSION	1U
+
+static ni_bool_t
+ni_ifconfig_index_init(ni_ifconfig_cache_t *index, const char *root,
+			const ni_string_array_t *sources)
+{
+	ni_stringbuf_t key = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_hashctx_t *ctx;
+	ni_bool_t ret = FALSE;
+	unsigned int i;
+
+	memset(index, 0, sizeof(*index));
+	if (!sources || !sources->count || !(ctx = ni_hashctx_new(NI_HASHCTX_SHA1)))
+		return FALSE;
+
+	ni_stringbuf_printf(&key, "%s", root ? root : "");
+	for (i = 0; i < sources->count; ++i)
+		ni_stringbuf_printf(&key, ":%s", sources->data[i]);
+
+	ni_hashctx_begin(ctx);
+	ni_hashctx_puts(ctx, PACKAGE_VERSION);
+	ni_hashctx_put(ctx, key.string, key.len + 1);
+	ni_ifconfig_cache_digest_file(ctx, ni_global.config_path);
+	ni_ifconfig_cache_digest_dir(ctx, ni_global.config_dir);
+	for (i = 0; i < sources->count; ++i) {
+		if (!ni_ifconfig_digest(root, sources->data[i], ctx))
+			break;
+	}
+	if (i == sources->count) {
+		ni_hashctx_finish(ctx);
+		if (ni_hashctx_get_digest(ctx, index->digest, sizeof(index->digest)) > 0 &&
+		    ni_string_printf(&index->filename, "%s/ifconfig-index-%08x.bin",
+				ni_config_statedir(), ni_string_hash(key.string)))
+			ret = TRUE;
+	}
+
+	ni_hashctx_free(ctx);
+	ni_stringbuf_destroy(&key);
+	return ret;
+}
+
+static ni_bool_t
+ni_ifconfig_index_get_string(ni_buffer_t *bp, char **str)
+{
+	uint32_t len;
+
+	if (!ni_ifconfig_cache_get_uint32(bp, &len) || len == 0 ||
+	    len > ni_buffer_count(bp))
+		return FALSE;
+
+	ni_string_set(str, ni_buffer_head(bp), len);
+	ni_buffer_pull_head(bp, len);
+	return TRUE;
+}
+
+/*
+ * Create a config worker for each index entry or just verify the index
+ * without a fsm. The config of the worker is a stub with the interface
+ * name only, carrying the origin and uuid of the real config -- it is
+ * not usable to set up the interface.
+ */
+static ni_bool_t
+ni_ifconfig_index_parse(const ni_ifconfig_cache_t *index, ni_buffer_t *bp,
+			ni_fsm_t *fsm)
+{
+	char magic[sizeof(NI_IFCONFIG_INDEX_MAGIC) - 1];
+	unsigned char digest[sizeof(index->digest)];
+	char *name = NULL, *origin = NULL;
+	uint32_t version, count, type;
+	ni_bool_t ret = FALSE;
+	ni_ifworker_t *w;
+	xml_node_t *stub;
+	ni_uuid_t uuid;
+
+	if (ni_buffer_get(bp, magic, sizeof(magic)) < 0 ||
+	    memcmp(magic, NI_IFCONFIG_INDEX_MAGIC, sizeof(magic)) ||
+	    !ni_ifconfig_cache_get_uint32(bp, &version) || version != NI_IFCONFIG_INDEX_VERSION ||
+	    ni_buffer_get(bp, digest, sizeof(digest)) < 0 ||
+	    memcmp(digest, index->digest, sizeof(digest)) ||
+	    !ni_ifconfig_cache_get_uint32(bp, &count))
+		return FALSE;
+
+	while (count--) {
+		if (!ni_ifconfig_cache_get_uint32(bp, &type) ||
+		    !ni_ifconfig_index_get_string(bp, &name) ||
+		    !ni_ifconfig_index_get_string(bp, &origin) ||
+		    ni_buffer_get(bp, uuid.octets, sizeof(uuid.octets)) < 0 ||
+		    !ni_ifworker_type_to_string(type))
+			goto failed;
+		if (!fsm)
+			continue;
+
+		stub = xml_node_new(ni_ifworker_type_to_string(type), NULL);
+		xml_node_new_element("name", stub, name);
+		ni_fsm_workers_from_xml(fsm, stub, origin);
+		xml_node_free(stub);
+
+		if (!(w = ni_fsm_ifworker_by_name(fsm, type, name)))
+			goto failed;
+		w->config.meta.uuid = uuid;
+	}
+	ret = ni_buffer_count(bp) == 0;
+
+failed:
+	ni_string_free(&name);
+	ni_string_free(&origin);
+	return ret;
+}
+
+ni_bool_t
+ni_ifconfig_load_uuid_index(ni_fsm_t *fsm, const char *root, const ni_string_array_t *sources)
+{
+	ni_ifconfig_cache_t index;
+	ni_bool_t ret = FALSE;
+	ni_buffer_t buf;
+	size_t len = 0;
+	void *data;
+	FILE *fp;
+
+	if (!fsm || !ni_config_sources_ifconfig_cache() ||
+	    !ni_ifconfig_index_init(&index, root, sources))
+		return FALSE;
+
+	if (!(fp = fopen(index.filename, "re"))) {
+		if (errno != ENOENT)
+			ni_warn("unable to open ifconfig index %s: %m", index.filename);
+		goto done;
+	}
+	data = ni_file_read(fp, &len, NI_IFCONFIG_CACHE_MAX_SIZE);
+	fclose(fp);
+	if (!data)
+		goto done;
+
+	/* verify the whole index before creating any worker */
+	ni_buffer_init_reader(&buf, data, len);
+	if (ni_ifconfig_index_parse(&index, &buf, NULL)) {
+		ni_buffer_init_reader(&buf, data, len);
+		ret = ni_ifconfig_index_parse(&index, &buf, fsm);
+	}
+	if (ret) {
+		ni_debug_ifconfig("using ifconfig index %s", index.filename);
+	} else {
+		ni_debug_ifconfig("ignoring stale or invalid ifconfig index %s",
+				index.filename);
+	}
+	free(data);
+
+done:
+	ni_ifconfig_cache_destroy(&index);
+	return ret;
+}
+
+static inline void
+ni_ifconfig_index_put_string(ni_stringbuf_t *out, const char *str)
+{
+	ni_ifconfig_cache_put_uint32(out, strlen(str));
+	ni_stringbuf_puts(out, str);
+}
+
+void
+ni_ifconfig_save_uuid_index(ni_fsm_t *fsm, const char *root, const ni_string_array_t *sources)
+{
+	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_ifconfig_cache_t index;
+	char tempname[PATH_MAX];
+	unsigned int i, count = 0;
+	int fd;
+	FILE *fp;
+
+	if (!fsm || !ni_config_sources_ifconfig_cache() ||
+	    !ni_ifconfig_index_init(&index, root, sources))
+		return;
+
+	for (i = 0; i < fsm->workers.count; ++i) {
+		ni_ifworker_t *w = fsm->workers.data[i];
+
+		if (!xml_node_is_empty(w->config.node) && !ni_string_empty(w->name) &&
+		    !ni_string_empty(w->config.meta.origin))
+			count++;
+	}
+
+	ni_stringbuf_put(&out, NI_IFCONFIG_INDEX_MAGIC, sizeof(NI_IFCONFIG_INDEX_MAGIC) - 1);
+	ni_ifconfig_cache_put_uint32(&out, NI_IFCONFIG_INDEX_VERSION);
+	ni_stringbuf_put(&out, (const char *)index.digest, sizeof(index.digest));
+	ni_ifconfig_cache_put_uint32(&out, count);
+	for (i = 0; i < fsm->workers.count; ++i) {
+		ni_ifworker_t *w = fsm->workers.data[i];
+
+		if (xml_node_is_empty(w->config.node) || ni_string_empty(w->name) ||
+		    ni_string_empty(w->config.meta.origin))
+			continue;
+
+		ni_ifconfig_cache_put_uint32(&out, w->type);
+		ni_ifconfig_index_put_string(&out, w->name);
+		ni_ifconfig_index_put_string(&out, w->config.meta.origin);
+		ni_stringbuf_put(&out, (const char *)w->config.meta.uuid.octets,
+				sizeof(w->config.meta.uuid.octets));
+	}
+
+	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", index.filename);
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_debug_ifconfig("cannot create temporary ifconfig index file %s: %m",
+				tempname);
+		goto failed;
+	}
+	if (!(fp = fdopen(fd, "we"))) {
+		close(fd);
+		unlink(tempname);
+		goto failed;
+	}
+
+	if (ni_file_write(fp, out.string, out.len) < 0) {
+		ni_error("unable to write ifconfig index %s", tempname);
+		fclose(fp);
+		unlink(tempname);
+		goto failed;
+	}
+	if (fclose(fp) != 0 || rename(tempname, index.filename) < 0) {
+		ni_error("unable to write ifconfig index %s: %m", index.filename);
+		unlink(tempname);
+	}
+
+failed:
+	ni_ifconfig_cache_destroy(&index);
+	ni_stringbuf_destroy(&out);
+}
+
 /*
  * Read old-style ifcfg file(s)
  */
 #if defined(COMPAT_AUTO) || defined(COMPAT_SUSE)
-ni_bool_t
-ni_ifconfig_read_compat_suse(xml_document_array_t *array,
+static ni_bool_t
+ni_ifconfig_read_compat_suse_files(xml_document_array_t *array,
 			const char *type, const char *root, const char *path,
 			ni_ifconfig_kind_t kind, ni_bool_t check_prio, ni_bool_t raw)
 {
@@ -613,6 +1214,44 @@ ni_ifconfig_read_compat_suse(xml_document_array_t *array,
 	ni_compat_ifconfig_destroy(&conf);
 	return rv;
 }
+
+ni_bool_t
+ni_ifconfig_read_compat_suse(xml_document_array_t *array,
+			const char *type, const char *root, const char *path,
+			ni_ifconfig_kind_t kind, ni_bool_t check_prio, ni_bool_t raw)
+{
+	xml_document_array_t docs = XML_DOCUMENT_ARRAY_INIT;
+	ni_ifconfig_cache_t cache;
+	ni_bool_t rv = TRUE;
+	unsigned int i;
+
+	if (!ni_config_sources_ifconfig_cache() ||
+	    !ni_ifconfig_cache_init(&cache, type, root, path, kind, raw,
+					__ni_suse_get_ifconfig_digest))
+		return ni_ifconfig_read_compat_suse_files(array, type, root, path,
+							kind, check_prio, raw);
+
+	/* cache the docs before the prio check, it depends on other sources */
+	if (!ni_ifconfig_cache_load(&cache, &docs)) {
+		rv = ni_ifconfig_read_compat_suse_files(&docs, type, root, path,
+							kind, FALSE, raw);
+		if (rv)
+			ni_ifconfig_cache_save(&cache, &docs);
+	}
+	ni_ifconfig_cache_destroy(&cache);
+
+	for (i = 0; i < docs.count; ++i) {
+		xml_document_t *doc = docs.data[i];
+
+		docs.data[i] = NULL;
+		if (ni_ifconfig_validate_adding_doc(doc, check_prio))
+			xml_document_array_append(array, doc);
+		else
+			xml_document_free(doc);
+	}
+	xml_document_array_destroy(&docs);
+	return rv;
+}
 #endif
 
 #if defined(COMPAT_AUTO) || defined(COMPAT_REDHAT)
@@ -651,6 +1290,12 @@ ni_ifconfig_read_compat(xml_document_array_t *array,
 	return ni_ifconfig_read_subtype(array, ni_ifconfig_types_compat, root, path, kind, check_prio, raw, type);
 }
 
+ni_bool_t
+ni_ifconfig_digest_compat(const char *root, const char *path, ni_hashctx_t *ctx)
+{
+	return ni_ifconfig_digest_subtype(ni_ifconfig_types_compat, root, path, ctx);
+}
+
 ni_bool_t
 ni_ifconfig_read_firmware(xml_document_array_t *array,
 			const char *type, const char *root, const char *path,
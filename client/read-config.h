@@ -46,6 +46,9 @@ struct ni_ifconfig_type {
 	    const ni_ifconfig_type_t *	(*guess)(const ni_ifconfig_type_t *,
 						const char *root,
 						const char *path);
+		ni_bool_t		(*digest)(const char *root,
+						const char *path,
+						ni_hashctx_t *);
 	} ops;
 };
 
@@ -62,6 +65,10 @@ extern ni_bool_t			ni_ifconfig_read_subtype(xml_document_array_t *,
 
 extern ni_bool_t			ni_ifconfig_read(xml_document_array_t *, const char *,
 					const char *, ni_ifconfig_kind_t, ni_bool_t, ni_bool_t);
+extern ni_bool_t			ni_ifconfig_digest_subtype(const ni_ifconfig_type_t *,
+					const char *, const char *, ni_hashctx_t *);
+extern ni_bool_t			ni_ifconfig_digest(const char *, const char *,
+					ni_hashctx_t *);
 
 extern const char *			ni_ifconfig_kind_to_name(ni_ifconfig_kind_t);
 extern ni_bool_t			ni_ifconfig_kind_by_name(const char *, ni_ifconfig_kind_t *);
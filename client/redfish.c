@@ -65,6 +65,7 @@
 #include <wicked/xml.h>
 #include "buffer.h"
 #include "sysfs.h"
+#include "array_priv.h"
 #include "main.h"
 
 #define NI_REDFISH_CONFIG_EXTENSION	WICKED_EXTENSIONSDIR"/redfish-config"
@@ -525,27 +526,10 @@ ni_hosts_entry_array_find_addr(ni_hosts_entry_array_t *array, const ni_sockaddr_
 }
 
 static ni_bool_t
-ni_hosts_entry_array_realloc(ni_hosts_entry_array_t *array, unsigned int count)
+ni_hosts_entry_array_realloc(ni_hosts_entry_array_t *array, unsigned int newcount)
 {
-	ni_hosts_entry_t **newdata;
-	size_t             newsize;
-	unsigned int       i;
-
-	if ((UINT_MAX - array->count) <= count)
-		return FALSE;
-
-	newsize = array->count + count;
-	if ((SIZE_MAX / sizeof(*newdata)) < newsize)
-		return FALSE;
-
-	newdata = realloc(array->data, newsize * sizeof(*newdata));
-	if (!newdata)
-		return FALSE;
-
-	array->data = newdata;
-	for (i = array->count; i < newsize; ++i)
-		array->data[i] = NULL;
-	return TRUE;
+	return ni_array_grow((void **)&array->data, sizeof(ni_hosts_entry_t *),
+				array->count, newcount, NI_HOSTS_ENTRY_ARRAY_CHUNK);
 }
 
 static ni_bool_t
@@ -554,8 +538,8 @@ ni_hosts_entry_array_append(ni_hosts_entry_array_t *array, ni_hosts_entry_t *ent
 	if (!array || !entry)
 		return FALSE;
 
-	if ((array->count % NI_HOSTS_ENTRY_ARRAY_CHUNK) == 0 &&
-	    !ni_hosts_entry_array_realloc(array, NI_HOSTS_ENTRY_ARRAY_CHUNK))
+	if (array->count == UINT_MAX ||
+	    !ni_hosts_entry_array_realloc(array, array->count + 1))
 		return FALSE;
 
 	array->data[array->count++] = entry;
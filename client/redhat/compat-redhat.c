@@ -214,8 +214,8 @@ __ni_redhat_startmode(const char *mode)
 		const char *		name;
 		ni_ifworker_control_t	control;
 	} __ni_redhat_control_params[] = {
-		{ "manual",	{ "manual",	NULL,	FALSE, FALSE, TRUE, 0, 0 } },
-		{ "onboot",	{ "auto",	NULL,	FALSE, FALSE, TRUE, 0, 0 } },
+		{ "manual",	{ "manual",	NULL,	FALSE, FALSE, TRUE, 0, 0, FALSE } },
+		{ "onboot",	{ "auto",	NULL,	FALSE, FALSE, TRUE, 0, 0, FALSE } },
 		{ NULL }
 	};
 	const struct __ni_control_params *p;
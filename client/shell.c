@@ -0,0 +1,355 @@
+/*
+ *	wicked client shell -- runs commands in a long-running client
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+
+#include "socket_priv.h"
+#include "wicked-client.h"
+#include "main.h"
+
+/*
+ * The shell reads one command per line from stdin or from the clients
+ * of a unix control socket and runs it the same way as the command
+ * line client would do. The reply is the command output followed by
+ * a "status <code>" line.
+ *
+ * The appconfig, the schema, the dbus connection and the dbus proxy
+ * objects are initialized by the first command only and reused by the
+ * following ones; while idle, the shell waits in the socket loop, so the
+ * dbus signals are dispatched to the proxies and do not queue up.
+ */
+#define NI_SHELL_LINE_MAX		4096
+
+typedef struct ni_shell {
+	const char *		program;
+
+	ni_socket_t *		listener;	/* unix control socket	*/
+	ni_socket_t *		input;		/* stdin or the client	*/
+	ni_bool_t		redirect;	/* output to the client	*/
+	ni_bool_t		ready;
+	ni_bool_t		done;
+
+	ni_stringbuf_t		line;
+} ni_shell_t;
+
+static void
+ni_shell_socket_ready(ni_socket_t *sock)
+{
+	ni_shell_t *shell = sock->user_data;
+
+	/*
+	 * Just note it and read outside of the socket loop:
+	 * the commands run their own loop while they wait.
+	 */
+	shell->ready = TRUE;
+}
+
+static ni_socket_t *
+ni_shell_socket_new(ni_shell_t *shell, int fd)
+{
+	ni_socket_t *sock;
+
+	if (!(sock = ni_socket_wrap(fd, SOCK_STREAM)))
+		return NULL;
+
+	sock->receive = ni_shell_socket_ready;
+	sock->handle_hangup = ni_shell_socket_ready;
+	sock->user_data = shell;
+
+	if (!ni_socket_activate(sock)) {
+		sock->__fd = -1;	/* closed by the caller */
+		ni_socket_release(sock);
+		return NULL;
+	}
+	return sock;
+}
+
+static int
+ni_shell_run(ni_shell_t *shell, char *line)
+{
+	ni_string_array_t args = NI_STRING_ARRAY_INIT;
+	char **argv = NULL;
+	unsigned int i;
+	int status;
+
+	if (!ni_string_split(&args, line, " \t\r", 0) || args.data[0][0] == '#') {
+		ni_string_array_destroy(&args);
+		return -1;
+	}
+
+	if (ni_string_eq(args.data[0], "quit") || ni_string_eq(args.data[0], "exit")) {
+		ni_string_array_destroy(&args);
+		return -2;
+	}
+
+	argv = xcalloc(args.count + 1, sizeof(char *));
+	for (i = 0; i < args.count; ++i)
+		argv[i] = args.data[i];
+
+	ni_debug_application("%s shell: executing %s", shell->program, line);
+	if (ni_string_eq(argv[0], "shell") || ni_string_eq(argv[0], "help")) {
+		fprintf(stderr, "Unsupported shell command %s\n", argv[0]);
+		status = NI_WICKED_RC_USAGE;
+	} else
+	if ((status = ni_wicked_command(shell->program, args.count, argv)) < 0) {
+		fprintf(stderr, "Unsupported command %s\n", argv[0]);
+		status = NI_WICKED_RC_USAGE;
+	}
+
+	free(argv);
+	ni_string_array_destroy(&args);
+	return status;
+}
+
+static ni_bool_t
+ni_shell_exec(ni_shell_t *shell, char *line)
+{
+	int saved_out = -1, saved_err = -1;
+	int status;
+
+	fflush(stdout);
+	fflush(stderr);
+	if (shell->redirect) {
+		saved_out = dup(STDOUT_FILENO);
+		saved_err = dup(STDERR_FILENO);
+		dup2(shell->input->__fd, STDOUT_FILENO);
+		dup2(shell->input->__fd, STDERR_FILENO);
+	}
+
+	/* each command parses its options from the start */
+	optind = 0;
+	status = ni_shell_run(shell, line);
+	if (status >= 0)
+		printf("status %d\n", status);
+
+	fflush(stdout);
+	fflush(stderr);
+	if (saved_out >= 0) {
+		dup2(saved_out, STDOUT_FILENO);
+		close(saved_out);
+	}
+	if (saved_err >= 0) {
+		dup2(saved_err, STDERR_FILENO);
+		close(saved_err);
+	}
+	return status != -2;
+}
+
+static void
+ni_shell_input_close(ni_shell_t *shell)
+{
+	if (shell->input) {
+		ni_socket_close(shell->input);
+		shell->input = NULL;
+	}
+	ni_stringbuf_destroy(&shell->line);
+
+	if (shell->listener)
+		ni_socket_activate(shell->listener);
+	else
+		shell->done = TRUE;
+}
+
+static void
+ni_shell_input_read(ni_shell_t *shell)
+{
+	char buf[1024], *nl, *line;
+	ni_bool_t more = TRUE;
+	ssize_t len;
+
+	/* no nested reads while a command runs its own socket loop */
+	ni_socket_deactivate(shell->input);
+
+	len = read(shell->input->__fd, buf, sizeof(buf));
+	if (len < 0 && (errno == EINTR || errno == EAGAIN)) {
+		ni_socket_activate(shell->input);
+		return;
+	}
+	if (len <= 0) {
+		ni_shell_input_close(shell);
+		return;
+	}
+
+	ni_stringbuf_put(&shell->line, buf, len);
+	while (more && shell->line.string && (nl = strchr(shell->line.string, '\n'))) {
+		*nl = '\0';
+		line = xstrdup(shell->line.string);
+		memmove(shell->line.string, nl + 1, strlen(nl + 1) + 1);
+		shell->line.len = strlen(shell->line.string);
+
+		more = ni_shell_exec(shell, line);
+		free(line);
+	}
+
+	if (!more || shell->line.len > NI_SHELL_LINE_MAX) {
+		ni_shell_input_close(shell);
+		return;
+	}
+	ni_socket_activate(shell->input);
+}
+
+static void
+ni_shell_accept(ni_shell_t *shell)
+{
+	int fd;
+
+	if ((fd = accept(shell->listener->__fd, NULL, NULL)) < 0) {
+		if (errno != EINTR && errno != EAGAIN)
+			ni_error("%s shell: cannot accept connection: %m", shell->program);
+		return;
+	}
+
+	if (!(shell->input = ni_shell_socket_new(shell, fd))) {
+		close(fd);
+		return;
+	}
+
+	/* serve one client at a time */
+	ni_socket_deactivate(shell->listener);
+}
+
+static ni_socket_t *
+ni_shell_listen(ni_shell_t *shell, const char *path)
+{
+	struct sockaddr_un sun;
+	ni_socket_t *sock;
+	mode_t mask;
+	int fd;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	if (ni_string_len(path) >= sizeof(sun.sun_path)) {
+		ni_error("%s shell: socket path too long: %s", shell->program, path);
+		return NULL;
+	}
+	strcpy(sun.sun_path, path);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+		ni_error("%s shell: cannot create socket: %m", shell->program);
+		return NULL;
+	}
+
+	unlink(path);
+	mask = umask(0177);
+	if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0 || listen(fd, 8) < 0) {
+		ni_error("%s shell: cannot listen on %s: %m", shell->program, path);
+		umask(mask);
+		close(fd);
+		return NULL;
+	}
+	umask(mask);
+
+	if (!(sock = ni_shell_socket_new(shell, fd)))
+		close(fd);
+	return sock;
+}
+
+int
+ni_do_shell(const char *caller, int argc, char **argv)
+{
+	enum  { OPT_HELP, OPT_SOCKET };
+	static struct option shell_options[] = {
+		{ "help",	no_argument,		NULL,	OPT_HELP	},
+		{ "socket",	required_argument,	NULL,	OPT_SOCKET	},
+		{ NULL,		no_argument,		NULL,	0		}
+	};
+	ni_shell_t shell = { .line = NI_STRINGBUF_INIT_DYNAMIC };
+	const char *opt_socket = NULL;
+	int c, status = NI_WICKED_RC_USAGE;
+
+	optind = 1;
+	while ((c = getopt_long(argc, argv, "", shell_options, NULL)) != EOF) {
+		switch (c) {
+		case OPT_SOCKET:
+			opt_socket = optarg;
+			break;
+
+		case OPT_HELP:
+			status = NI_WICKED_RC_SUCCESS;
+			/* fall through */
+		default:
+		usage:
+			fprintf(stderr,
+				"%s %s [options]\n"
+				"\n"
+				"Reads commands, one per line, and runs them in one process.\n"
+				"Each reply ends with a \"status <code>\" line.\n"
+				"\n"
+				"Supported options:\n"
+				"  --help\n"
+				"      Show this help text.\n"
+				"  --socket <path>\n"
+				"      Accept commands via a unix socket instead of stdin.\n"
+				, caller, argv[0]);
+			return status;
+		}
+	}
+	if (optind < argc)
+		goto usage;
+
+	shell.program = caller;
+	if (opt_socket) {
+		if (!(shell.listener = ni_shell_listen(&shell, opt_socket)))
+			return NI_WICKED_RC_ERROR;
+		shell.redirect = TRUE;
+	} else
+	if (!(shell.input = ni_shell_socket_new(&shell, STDIN_FILENO))) {
+		ni_error("%s shell: cannot read from stdin", caller);
+		return NI_WICKED_RC_ERROR;
+	}
+
+	while (!shell.done) {
+		ni_socket_wait(NI_TIMEOUT_INFINITE);
+		if (!shell.ready)
+			continue;
+
+		shell.ready = FALSE;
+		if (shell.input)
+			ni_shell_input_read(&shell);
+		else
+			ni_shell_accept(&shell);
+	}
+
+	if (shell.input)
+		ni_socket_close(shell.input);
+	if (shell.listener) {
+		ni_socket_close(shell.listener);
+		unlink(opt_socket);
+	}
+	ni_stringbuf_destroy(&shell.line);
+	return NI_WICKED_RC_SUCCESS;
+}
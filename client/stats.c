@@ -0,0 +1,492 @@
+/*
+ *	wicked client stats -- show the runtime counters of wickedd
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+#include <wicked/dbus.h>
+#include <wicked/dbus-errors.h>
+#include <wicked/objectmodel.h>
+
+#include "wicked-client.h"
+#include "main.h"
+
+enum {
+	NI_STATS_FORMAT_TEXT,
+	NI_STATS_FORMAT_PROMETHEUS,
+};
+
+static const ni_intmap_t	ni_stats_format_names[] = {
+	{ "text",		NI_STATS_FORMAT_TEXT		},
+	{ "prometheus",		NI_STATS_FORMAT_PROMETHEUS	},
+	{ NULL,			0				}
+};
+
+static ni_dbus_object_t *
+ni_stats_object(void)
+{
+	ni_dbus_client_t *client;
+
+	if (!(client = ni_create_dbus_client(NI_OBJECTMODEL_DBUS_BUS_NAME)))
+		return NULL;
+
+	return ni_dbus_client_object_new(client, &ni_dbus_anonymous_class,
+					NI_OBJECTMODEL_OBJECT_ROOT,
+					NI_OBJECTMODEL_STATS_INTERFACE, NULL);
+}
+
+static ni_bool_t
+ni_stats_query(ni_dbus_object_t *root, const char *method, ni_dbus_variant_t *result)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	dbus_bool_t rv;
+
+	rv = ni_dbus_object_call_variant(root, NI_OBJECTMODEL_STATS_INTERFACE,
+					method, 0, NULL, 1, result, &error);
+	if (!rv) {
+		ni_dbus_print_error(&error, "%s.%s() failed",
+				ni_dbus_object_get_path(root), method);
+		dbus_error_free(&error);
+	}
+	return rv && ni_dbus_variant_is_dict(result);
+}
+
+static ni_bool_t
+ni_stats_subscribe(ni_dbus_object_t *root, const char *method, const ni_string_array_t *names)
+{
+	ni_dbus_variant_t arg = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_bool_t ret = TRUE;
+	unsigned int i;
+
+	for (i = 0; i < names->count; ++i) {
+		ni_dbus_variant_set_string(&arg, names->data[i]);
+		if (!ni_dbus_object_call_variant(root, NI_OBJECTMODEL_STATS_INTERFACE,
+					method, 1, &arg, 0, NULL, &error)) {
+			ni_dbus_print_error(&error, "%s.%s(%s) failed",
+					ni_dbus_object_get_path(root), method,
+					names->data[i]);
+			dbus_error_free(&error);
+			ret = FALSE;
+		}
+		ni_dbus_variant_destroy(&arg);
+	}
+	return ret;
+}
+
+/*
+ * Metric names use underscores; label values are quoted as-is.
+ */
+static const char *
+ni_stats_metric_name(const char *name, char *buf, size_t size)
+{
+	size_t i;
+
+	for (i = 0; name[i] && i + 1 < size; ++i)
+		buf[i] = name[i] == '-' || name[i] == '.' ? '_' : name[i];
+	buf[i] = '\0';
+	return buf;
+}
+
+static void
+ni_stats_print_dict(const ni_dbus_variant_t *result, const char *section,
+			const char *metric, const char *label, unsigned int format)
+{
+	const ni_dbus_variant_t *dict, *var;
+	const char *name;
+	unsigned int i;
+	uint64_t value;
+	char buf[128];
+
+	if (!(dict = ni_dbus_dict_get(result, section)))
+		return;
+
+	if (format == NI_STATS_FORMAT_TEXT)
+		printf("%s:\n", section);
+	for (i = 0; (var = ni_dbus_dict_get_entry(dict, i, &name)); ++i) {
+		if (!ni_dbus_variant_get_uint64(var, &value))
+			continue;
+
+		if (format == NI_STATS_FORMAT_TEXT)
+			printf("  %-24s %llu\n", name, (unsigned long long)value);
+		else if (label)
+			printf("wicked_%s_total{%s=\"%s\"} %llu\n", metric, label, name,
+					(unsigned long long)value);
+		else
+			printf("wicked_%s_total %llu\n",
+					ni_stats_metric_name(name, buf, sizeof(buf)),
+					(unsigned long long)value);
+	}
+}
+
+static void
+ni_stats_print_objects(const ni_dbus_variant_t *result, unsigned int format)
+{
+	const ni_dbus_variant_t *dict, *obj;
+	uint64_t allocated, freed, bytes;
+	const char *name;
+	unsigned int i;
+
+	if (!(dict = ni_dbus_dict_get(result, "objects")))
+		return;
+
+	if (format == NI_STATS_FORMAT_TEXT)
+		printf("objects:\n");
+	else
+		printf("# TYPE wicked_objects_live_bytes gauge\n");
+
+	for (i = 0; (obj = ni_dbus_dict_get_entry(dict, i, &name)); ++i) {
+		if (!ni_dbus_dict_get_uint64(obj, "allocated", &allocated) ||
+		    !ni_dbus_dict_get_uint64(obj, "freed", &freed) ||
+		    !ni_dbus_dict_get_uint64(obj, "bytes", &bytes))
+			continue;
+
+		if (format == NI_STATS_FORMAT_TEXT) {
+			printf("  %-24s %llu live, %llu bytes, %llu allocated, %llu freed\n",
+					name, (unsigned long long)(allocated - freed),
+					(unsigned long long)bytes,
+					(unsigned long long)allocated,
+					(unsigned long long)freed);
+		} else {
+			printf("wicked_objects_allocated_total{type=\"%s\"} %llu\n",
+					name, (unsigned long long)allocated);
+			printf("wicked_objects_freed_total{type=\"%s\"} %llu\n",
+					name, (unsigned long long)freed);
+			printf("wicked_objects_live_bytes{type=\"%s\"} %llu\n",
+					name, (unsigned long long)bytes);
+		}
+	}
+}
+
+static void
+ni_stats_print_histogram_labels(const char *name, const char *label)
+{
+	const char *dot;
+
+	/* dbus calls are named <interface>.<method> */
+	if (!label && (dot = strrchr(name, '.')))
+		printf("interface=\"%.*s\",method=\"%s\"", (int)(dot - name), name, dot + 1);
+	else
+		printf("%s=\"%s\"", label ? label : "name", name);
+}
+
+static void
+ni_stats_print_histograms(const ni_dbus_variant_t *result, const char *section,
+			const char *metric, const char *label, unsigned int format)
+{
+	const ni_dbus_variant_t *dict, *hist, *buckets, *var;
+	const char *name, *bound, *last;
+	uint64_t count, sum, value, total;
+	unsigned int i, b;
+
+	if (!(dict = ni_dbus_dict_get(result, section)))
+		return;
+
+	if (format == NI_STATS_FORMAT_TEXT)
+		printf("%s:\n", section);
+	else
+		printf("# TYPE wicked_%s_duration_seconds histogram\n", metric);
+
+	for (i = 0; (hist = ni_dbus_dict_get_entry(dict, i, &name)); ++i) {
+		if (!ni_dbus_dict_get_uint64(hist, "count", &count) ||
+		    !ni_dbus_dict_get_uint64(hist, "sum", &sum))
+			continue;
+
+		buckets = ni_dbus_dict_get(hist, "buckets");
+		if (format == NI_STATS_FORMAT_TEXT) {
+			printf("  %-48s %8llu calls, avg %llu.%03llu ms, max <= ",
+					name, (unsigned long long)count,
+					count ? (unsigned long long)(sum / count / 1000) : 0ULL,
+					count ? (unsigned long long)(sum / count % 1000) : 0ULL);
+
+			bound = "0";
+			for (b = 0; buckets && (var = ni_dbus_dict_get_entry(buckets, b, &last)); ++b) {
+				if (ni_dbus_variant_get_uint64(var, &value) && value)
+					bound = last;
+			}
+			if (ni_string_eq(bound, "+Inf"))
+				printf("+Inf\n");
+			else
+				printf("%g ms\n", strtod(bound, NULL) / 1000);
+			continue;
+		}
+
+		total = 0;
+		for (b = 0; buckets && (var = ni_dbus_dict_get_entry(buckets, b, &bound)); ++b) {
+			if (!ni_dbus_variant_get_uint64(var, &value))
+				continue;
+
+			total += value;
+			printf("wicked_%s_duration_seconds_bucket{", metric);
+			ni_stats_print_histogram_labels(name, label);
+			if (ni_string_eq(bound, "+Inf"))
+				printf(",le=\"+Inf\"} %llu\n", (unsigned long long)total);
+			else
+				printf(",le=\"%g\"} %llu\n", strtod(bound, NULL) / 1000000,
+						(unsigned long long)total);
+		}
+		printf("wicked_%s_duration_seconds_sum{", metric);
+		ni_stats_print_histogram_labels(name, label);
+		printf("} %g\n", (double)sum / 1000000);
+		printf("wicked_%s_duration_seconds_count{", metric);
+		ni_stats_print_histogram_labels(name, label);
+		printf("} %llu\n", (unsigned long long)count);
+	}
+}
+
+static void
+ni_stats_print_link_rates(const ni_dbus_variant_t *result, unsigned int format)
+{
+	static const char *sections[] = { "current", "average", NULL };
+	const ni_dbus_variant_t *link, *dict, *var;
+	const char *ifname, *name, **section;
+	uint32_t interval, samples;
+	unsigned int i, c;
+	uint64_t value;
+	char buf[128];
+
+	if (format == NI_STATS_FORMAT_PROMETHEUS) {
+		printf("# TYPE wicked_link_rate gauge\n");
+		printf("# TYPE wicked_link_total counter\n");
+	}
+
+	for (i = 0; (link = ni_dbus_dict_get_entry(result, i, &ifname)); ++i) {
+		if (!ni_dbus_dict_get_uint32(link, "interval", &interval) ||
+		    !ni_dbus_dict_get_uint32(link, "samples", &samples))
+			continue;
+
+		if (format == NI_STATS_FORMAT_TEXT) {
+			printf("%s: %u samples, interval %u ms\n", ifname, samples, interval);
+			printf("  %-24s %20s %20s %20s\n", "", "total", "current/s", "average/s");
+		}
+
+		if (!(dict = ni_dbus_dict_get(link, "counters")))
+			continue;
+
+		for (c = 0; (var = ni_dbus_dict_get_entry(dict, c, &name)); ++c) {
+			if (!ni_dbus_variant_get_uint64(var, &value))
+				continue;
+
+			if (format == NI_STATS_FORMAT_TEXT)
+				printf("  %-24s %20llu", name, (unsigned long long)value);
+			else
+				printf("wicked_link_total{interface=\"%s\",counter=\"%s\"} %llu\n",
+						ifname, ni_stats_metric_name(name, buf, sizeof(buf)),
+						(unsigned long long)value);
+
+			for (section = sections; *section; ++section) {
+				const ni_dbus_variant_t *rates;
+
+				value = 0;
+				if ((rates = ni_dbus_dict_get(link, *section)))
+					ni_dbus_dict_get_uint64(rates, name, &value);
+
+				if (format == NI_STATS_FORMAT_TEXT)
+					printf(" %20llu", (unsigned long long)value);
+				else
+					printf("wicked_link_rate{interface=\"%s\",counter=\"%s\",rate=\"%s\"} %llu\n",
+						ifname, buf, *section, (unsigned long long)value);
+			}
+			if (format == NI_STATS_FORMAT_TEXT)
+				printf("\n");
+		}
+	}
+}
+
+static void
+ni_stats_print_netdev_memory(const ni_dbus_variant_t *result, unsigned int format)
+{
+	const ni_dbus_variant_t *link, *var;
+	const char *ifname, *name;
+	uint64_t value, devices = 0, sum = 0;
+	unsigned int i, b;
+
+	if (format == NI_STATS_FORMAT_PROMETHEUS)
+		printf("# TYPE wicked_netdev_memory_bytes gauge\n");
+
+	for (i = 0; (link = ni_dbus_dict_get_entry(result, i, &ifname)); ++i) {
+		if (!ni_dbus_dict_get_uint64(link, "total", &value))
+			continue;
+
+		devices++;
+		sum += value;
+		if (format == NI_STATS_FORMAT_TEXT)
+			printf("%s: %llu bytes\n", ifname, (unsigned long long)value);
+
+		for (b = 0; (var = ni_dbus_dict_get_entry(link, b, &name)); ++b) {
+			if (ni_string_eq(name, "total") ||
+			    !ni_dbus_variant_get_uint64(var, &value) || !value)
+				continue;
+
+			if (format == NI_STATS_FORMAT_TEXT)
+				printf("  %-24s %llu\n", name, (unsigned long long)value);
+			else
+				printf("wicked_netdev_memory_bytes{interface=\"%s\",block=\"%s\"} %llu\n",
+						ifname, name, (unsigned long long)value);
+		}
+	}
+
+	if (format == NI_STATS_FORMAT_TEXT && devices) {
+		printf("%llu interfaces: %llu bytes, %llu bytes per interface\n",
+				(unsigned long long)devices, (unsigned long long)sum,
+				(unsigned long long)(sum / devices));
+	}
+}
+
+int
+ni_do_stats(const char *caller, int argc, char **argv)
+{
+	enum { OPT_HELP, OPT_FORMAT, OPT_LINKS, OPT_SUBSCRIBE, OPT_UNSUBSCRIBE, OPT_MEMORY };
+	static struct option stats_options[] = {
+		{ "help",	no_argument,		NULL,	OPT_HELP	},
+		{ "format",	required_argument,	NULL,	OPT_FORMAT	},
+		{ "links",	no_argument,		NULL,	OPT_LINKS	},
+		{ "subscribe",	required_argument,	NULL,	OPT_SUBSCRIBE	},
+		{ "unsubscribe",required_argument,	NULL,	OPT_UNSUBSCRIBE	},
+		{ "memory",	no_argument,		NULL,	OPT_MEMORY	},
+		{ NULL,		no_argument,		NULL,	0		}
+	};
+	ni_string_array_t subscribe = NI_STRING_ARRAY_INIT;
+	ni_string_array_t unsubscribe = NI_STRING_ARRAY_INIT;
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	unsigned int format = NI_STATS_FORMAT_TEXT;
+	int c, status = NI_WICKED_RC_USAGE;
+	ni_dbus_object_t *root = NULL;
+	ni_bool_t links = FALSE;
+	ni_bool_t memory = FALSE;
+
+	optind = 1;
+	while ((c = getopt_long(argc, argv, "", stats_options, NULL)) != EOF) {
+		switch (c) {
+		case OPT_FORMAT:
+			if (ni_parse_uint_mapped(optarg, ni_stats_format_names, &format) < 0)
+				goto usage;
+			break;
+
+		case OPT_LINKS:
+			links = TRUE;
+			break;
+
+		case OPT_MEMORY:
+			memory = TRUE;
+			break;
+
+		case OPT_SUBSCRIBE:
+			ni_string_array_append(&subscribe, optarg);
+			break;
+
+		case OPT_UNSUBSCRIBE:
+			ni_string_array_append(&unsubscribe, optarg);
+			break;
+
+		case OPT_HELP:
+			status = NI_WICKED_RC_SUCCESS;
+			/* fall through */
+		default:
+		usage:
+			fprintf(stderr,
+				"%s %s [options]\n"
+				"\n"
+				"Shows the runtime counters of the wicked service.\n"
+				"\n"
+				"Supported options:\n"
+				"  --help\n"
+				"      Show this help text.\n"
+				"  --format <text|prometheus>\n"
+				"      Output format, prometheus is the text exposition format.\n"
+				"  --subscribe <ifname>\n"
+				"      Start to sample the link statistics of the interface.\n"
+				"  --unsubscribe <ifname>\n"
+				"      Stop to sample the link statistics of the interface.\n"
+				"  --links\n"
+				"      Show the rates of the sampled interfaces instead of the counters.\n"
+				"  --memory\n"
+				"      Show the memory used by each interface instead of the counters.\n"
+				, caller, argv[0]);
+			goto cleanup;
+		}
+	}
+	if (optind < argc || (links && memory))
+		goto usage;
+
+	status = NI_WICKED_RC_ERROR;
+	if (!(root = ni_stats_object()))
+		goto cleanup;
+
+	if (!ni_stats_subscribe(root, "unsubscribeLink", &unsubscribe) ||
+	    !ni_stats_subscribe(root, "subscribeLink", &subscribe))
+		goto cleanup;
+
+	if (links) {
+		if (!ni_stats_query(root, "getLinkRates", &result))
+			goto cleanup;
+
+		ni_stats_print_link_rates(&result, format);
+		status = NI_WICKED_RC_SUCCESS;
+		goto cleanup;
+	}
+
+	if (memory) {
+		if (!ni_stats_query(root, "getNetdevMemory", &result))
+			goto cleanup;
+
+		ni_stats_print_netdev_memory(&result, format);
+		status = NI_WICKED_RC_SUCCESS;
+		goto cleanup;
+	}
+
+	/* only (un)subscribed */
+	if (subscribe.count || unsubscribe.count) {
+		status = NI_WICKED_RC_SUCCESS;
+		goto cleanup;
+	}
+
+	if (!ni_stats_query(root, "getCounters", &result))
+		goto cleanup;
+
+	ni_stats_print_dict(&result, "counters", NULL, NULL, format);
+	ni_stats_print_dict(&result, "rtnl-events", "rtnl_events", "group", format);
+	ni_stats_print_dict(&result, "rtnl-refresh", "rtnl_refresh", "type", format);
+	ni_stats_print_objects(&result, format);
+	ni_stats_print_histograms(&result, "netlink-dumps", "netlink_dump", "type", format);
+	ni_stats_print_histograms(&result, "dbus-calls", "dbus_call", NULL, format);
+	status = NI_WICKED_RC_SUCCESS;
+
+cleanup:
+	ni_dbus_variant_destroy(&result);
+	ni_string_array_destroy(&subscribe);
+	ni_string_array_destroy(&unsubscribe);
+	if (root) {
+		ni_dbus_client_t *client = ni_dbus_object_get_client(root);
+
+		ni_dbus_object_free(root);
+		ni_dbus_client_free(client);
+	}
+	return status;
+}
@@ -289,6 +289,60 @@ done:
 	return success;
 }
 
+/*
+ * Digest the status of all files read by __ni_suse_get_ifconfig,
+ * used to detect changes by the converted config cache.
+ */
+ni_bool_t
+__ni_suse_get_ifconfig_digest(const char *root, const char *path, ni_hashctx_t *ctx)
+{
+	const char *filenames[] = __NI_SUSE_HOSTNAME_FILES, **name;
+	const char *sysctldirs[] = __NI_SUSE_SYSCTL_DIRS, **sysctld;
+	const char *_path = __NI_SUSE_SYSCONFIG_NETWORK_DIR;
+	char pathbuf[PATH_MAX];
+	struct utsname u;
+
+	if (!ctx)
+		return FALSE;
+
+	if (!ni_string_empty(path))
+		_path = path;
+
+	if (!root)
+		root = "";
+
+	if (ni_string_empty(root))
+		snprintf(pathbuf, sizeof(pathbuf), "%s", _path);
+	else
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", root, _path);
+	ni_ifconfig_cache_digest_dir(ctx, pathbuf);
+
+	/* ppp provider files referenced by the ifcfg files */
+	strncat(pathbuf, "/providers", sizeof(pathbuf) - strlen(pathbuf) - 1);
+	ni_ifconfig_cache_digest_dir(ctx, pathbuf);
+
+	for (name = filenames; name && !ni_string_empty(*name); name++) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, *name);
+		ni_ifconfig_cache_digest_file(ctx, pathbuf);
+	}
+
+	memset(&u, 0, sizeof(u));
+	if (uname(&u) == 0) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s%s%s", root,
+				__NI_SUSE_SYSCTL_BOOT, u.release);
+		ni_ifconfig_cache_digest_file(ctx, pathbuf);
+	}
+	for (sysctld = sysctldirs; *sysctld; ++sysctld) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, *sysctld);
+		ni_ifconfig_cache_digest_dir(ctx, pathbuf);
+	}
+	snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, __NI_SUSE_SYSCTL_FILE);
+	ni_ifconfig_cache_digest_file(ctx, pathbuf);
+
+	ni_hashctx_puts(ctx, ni_isdir(__NI_SUSE_PROC_IPV6_DIR) ? "ipv6" : "no-ipv6");
+	return TRUE;
+}
+
 /*
  * Read HOSTNAME file
  */
@@ -509,14 +563,34 @@ __ni_suse_free_globals(void)
 	ni_var_array_destroy(&__ni_suse_global_ifsysctl);
 }
 
+/*
+ * Return the next route line option token as string in buf, without
+ * splitting the whole line into an allocated string array first.
+ * Overlong tokens are returned as an empty, invalid option.
+ */
+#define NI_SUSE_ROUTE_OPT_MAX	256
+
+static const char *
+__ni_suse_route_opt(ni_slice_t *opts, char *buf, size_t size)
+{
+	ni_slice_t token;
+
+	if (!ni_slice_token(opts, " \t", &token))
+		return NULL;
+	if (!ni_slice_cstr(&token, buf, size))
+		*buf = '\0';
+	return buf;
+}
+
 /*
  * Read the routing information from sysconfig/network/routes or ifroutes-<ifname>.
  */
 int
-__ni_suse_parse_route_hops(ni_route_nexthop_t *nh, ni_string_array_t *opts,
-				unsigned int *pos, const char *ifname,
-				const char *filename, unsigned int line)
+__ni_suse_parse_route_hops(ni_route_nexthop_t *nh, ni_slice_t *opts,
+				const char *ifname, const char *filename,
+				unsigned int line)
 {
+	char obuf[NI_SUSE_ROUTE_OPT_MAX], vbuf[NI_SUSE_ROUTE_OPT_MAX];
 	const char *opt, *val;
 	unsigned int tmp;
 
@@ -527,12 +601,12 @@ __ni_suse_parse_route_hops(ni_route_nexthop_t *nh, ni_string_array_t *opts,
 	 * "                nexthop via 192.168.1.1 [dev nic] weight 2 \"
 	 * "                nexthop via 192.168.1.2 [dev nic] weight 3"
 	 */
-	while ((opt = ni_string_array_at(opts, (*pos)++))) {
+	while ((opt = __ni_suse_route_opt(opts, obuf, sizeof(obuf)))) {
 		if (!strcmp(opt, "nexthop")) {
 			ni_route_nexthop_t *next = ni_route_nexthop_new();
 			if (!next)
 				return -1;
-			if (__ni_suse_parse_route_hops(next, opts, pos, ifname,
+			if (__ni_suse_parse_route_hops(next, opts, ifname,
 							filename, line) < 0) {
 				ni_route_nexthop_free(next);
 				return -1;
@@ -548,20 +622,20 @@ __ni_suse_parse_route_hops(ni_route_nexthop_t *nh, ni_string_array_t *opts,
 			break;
 		} else
 		if (!strcmp(opt, "via")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (!val || nh->gateway.ss_family != AF_UNSPEC)
 				return -1;
 			if (ni_sockaddr_parse(&nh->gateway, val, AF_UNSPEC) < 0)
 				return -1;
 		} else
 		if (!strcmp(opt, "dev")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (!val || nh->device.name)
 				return -1;
 			ni_string_dup(&nh->device.name, val);
 		} else
 		if (!strcmp(opt, "weight")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (!val || nh->weight)
 				return -1;
 			if (ni_parse_uint(val, &tmp, 10) < 0 || !tmp)
@@ -569,7 +643,7 @@ __ni_suse_parse_route_hops(ni_route_nexthop_t *nh, ni_string_array_t *opts,
 			nh->weight = tmp;
 		} else
 		if (!strcmp(opt, "realm")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (!val || nh->realm)
 				return -1;
 			/* TODO: */
@@ -646,20 +720,21 @@ ni_suse_route_parse_time(const char *input, unsigned int *result)
 }
 
 int
-__ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
-				unsigned int *pos, const char *ifname,
-				const char *filename, unsigned int line)
+__ni_suse_route_parse_opts(ni_route_t *rp, ni_slice_t *opts,
+				const char *ifname, const char *filename,
+				unsigned int line)
 {
+	char obuf[NI_SUSE_ROUTE_OPT_MAX], vbuf[NI_SUSE_ROUTE_OPT_MAX];
 	const char *opt, *val;
 	unsigned int tmp;
 
-	while ((opt = ni_string_array_at(opts, (*pos)++))) {
+	while ((opt = __ni_suse_route_opt(opts, obuf, sizeof(obuf)))) {
 		if (!strcmp(opt, "nexthop")) {
 			/* either single or multipath, not both? */
 			if (rp->nh.gateway.ss_family != AF_UNSPEC)
 				return -1;
 
-			if (__ni_suse_parse_route_hops(&rp->nh, opts, pos,
+			if (__ni_suse_parse_route_hops(&rp->nh, opts,
 						ifname, filename, line) < 0)
 				return -1;
 
@@ -676,7 +751,7 @@ __ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
 
 		/* other attrs */
 		if (!strcmp(opt, "src")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (!val || rp->pref_src.ss_family != AF_UNSPEC)
 				return -1;
 			if (ni_sockaddr_parse(&rp->pref_src, val, AF_UNSPEC) < 0)
@@ -690,26 +765,26 @@ __ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
 		if (!strcmp(opt, "metric")   ||
 		    !strcmp(opt, "priority") ||
 		    !strcmp(opt, "preference")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
 			rp->priority = tmp;
 		} else
 		if (!strcmp(opt, "realm")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			/* TODO: */
 			if (ni_parse_uint(val, &tmp, 10) < 0 || tmp == 0 || tmp > 255)
 				return -1;
 			rp->realm = tmp;
 		} else
 		if (!strcmp(opt, "mark")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
 			rp->mark = tmp;
 		} else
 		if (!strcmp(opt, "tos") || !strcmp(opt, "dsfield")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_parse_uint(val, &tmp, 16) < 0 || tmp > 256)
 				return -1;
 			rp->tos = tmp;
@@ -717,110 +792,110 @@ __ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
 
 		/* metrics attr dict */
 		if (!strcmp(opt, "mtu")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (!val || ni_parse_uint(val, &tmp, 10) < 0 || tmp > 65536)
 				return -1;
 			rp->mtu = tmp;
 		} else
 		if (!strcmp(opt, "window")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
 			rp->window = tmp;
 		} else
 		if (!strcmp(opt, "rtt")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_suse_route_parse_time(val, &tmp) < 0)
 				return -1;
 			rp->rtt = tmp;
 		} else
 		if (!strcmp(opt, "rttvar")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_suse_route_parse_time(val, &tmp) < 0)
 				return -1;
 			rp->rttvar = tmp;
 		} else
 		if (!strcmp(opt, "ssthresh")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
 			rp->ssthresh = tmp;
 		} else
 		if (!strcmp(opt, "cwnd")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
 			rp->cwnd = tmp;
 		} else
 		if (!strcmp(opt, "advmss")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
 			rp->advmss = tmp;
 		} else
 		if (!strcmp(opt, "reordering")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
 			rp->reordering = tmp;
 		} else
 		if (!strcmp(opt, "hoplimit")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
 			rp->hoplimit = tmp;
 		} else
 		if (!strcmp(opt, "initcwnd")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
@@ -828,11 +903,11 @@ __ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
 		} else
 #if 0		/* iproute2 does not allow to set them */
 		if (!strcmp(opt, "features")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
@@ -840,22 +915,22 @@ __ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
 		} else
 #endif
 		if (!strcmp(opt, "rto_min")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_suse_route_parse_time(val, &tmp) < 0)
 				return -1;
 			rp->rto_min = tmp;
 		} else
 		if (!strcmp(opt, "initrwnd")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (ni_string_eq("lock", val)) {
 				if (!ni_route_metrics_lock_set(opt, &rp->lock))
 					return -1;
-				val = ni_string_array_at(opts, (*pos)++);
+				val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			}
 			if (ni_parse_uint(val, &tmp, 10) < 0)
 				return -1;
@@ -864,7 +939,7 @@ __ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
 
 		/* kern dict */
 		if (!strcmp(opt, "table")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (!val || rp->table != RT_TABLE_UNSPEC)
 				return -1;
 			if (!ni_route_table_name_to_type(val, &tmp))
@@ -874,7 +949,7 @@ __ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
 			rp->table = tmp;
 		} else
 		if (!strcmp(opt, "scope")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (!ni_route_scope_name_to_type(val, &tmp))
 				return -1;
 			if (rp->scope != RT_SCOPE_UNIVERSE)
@@ -882,7 +957,7 @@ __ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
 			rp->scope = tmp;
 		} else
 		if (!strcmp(opt, "proto") || !strcmp(opt, "protocol")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (!ni_route_protocol_name_to_type(val, &tmp) || tmp > 255)
 				return -1;
 			if (rp->protocol != RTPROT_UNSPEC)
@@ -890,7 +965,7 @@ __ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
 			rp->protocol = tmp;
 		} else
 		if (!strcmp(opt, "type")) {
-			val = ni_string_array_at(opts, (*pos)++);
+			val = __ni_suse_route_opt(opts, vbuf, sizeof(vbuf));
 			if (!ni_route_type_name_to_type(val, &tmp) || tmp >= __RTN_MAX)
 				return -1;
 			if (rp->type != RTN_UNSPEC)
@@ -910,44 +985,44 @@ __ni_suse_route_parse_opts(ni_route_t *rp, ni_string_array_t *opts,
 }
 
 int
-__ni_suse_route_parse(ni_route_table_t **routes, char *buffer, const char *ifname,
+__ni_suse_route_parse(ni_route_table_t **routes, const char *buffer, const char *ifname,
 			const char *filename, unsigned int line)
 {
-	char *dest, *gway, *mask = NULL, *name = NULL, *end = NULL;
-	unsigned int plen, i = 0;
-	ni_string_array_t opts = NI_STRING_ARRAY_INIT;
+	ni_slice_t dest = NI_SLICE_INIT, gway = NI_SLICE_INIT, mask = NI_SLICE_INIT;
+	ni_slice_t name = NI_SLICE_INIT, opts = NI_SLICE_INIT, rest, scan;
+	const char *slash = NULL;
+	char *devname = NULL;
 	ni_route_nexthop_t *nh;
-	ni_route_t *rp;
+	ni_route_t *rp = NULL;
+	unsigned int plen;
 
 	ni_assert(routes != NULL);
 
-	dest = strtok_r(buffer, " \t", &end);
-	if (!dest)
+	rest = ni_slice_from_string(buffer);
+	if (!ni_slice_token(&rest, " \t", &dest))
 		return 0;	/* empty line */
 
-	gway = strtok_r(NULL, " \t", &end);
-	if (gway)
-		mask = strtok_r(NULL, " \t", &end);
-	if (mask)
-		name = strtok_r(NULL, " \t", &end);
-	if (name) {
-		if (ni_string_eq(name, "-"))
-			name = NULL;
+	if (ni_slice_token(&rest, " \t", &gway) &&
+	    ni_slice_token(&rest, " \t", &mask) &&
+	    ni_slice_token(&rest, " \t", &name)) {
+		if (ni_slice_eq(&name, "-"))
+			name = ni_slice_init(NULL, 0);
 
 		/*
 		 * ifname is set while reading per-interface routes;
 		 * do not allow another interfaces in the name field.
 		 */
-		if (ifname && name && !ni_string_eq(ifname, name)) {
-			ni_warn("%s[%u]: Ignoring foreign interface name \"%s\"",
-				filename, line, name);
-			name = NULL;
+		if (ifname && name.len && !ni_slice_eq(&name, ifname)) {
+			ni_warn("%s[%u]: Ignoring foreign interface name \"%.*s\"",
+				filename, line, (int)name.len, name.data);
+			name = ni_slice_init(NULL, 0);
 		}
 
-		if (ifname == NULL)
-			ifname = name;
+		if (ifname == NULL && name.len)
+			ifname = ni_slice_dup(&devname, &name);
 
-		ni_string_split(&opts, end, " \t", 0);
+		opts = rest;
+		ni_slice_trim(&opts, " \t");
 	}
 
 	/*
@@ -960,30 +1035,29 @@ __ni_suse_route_parse(ni_route_table_t **routes, char *buffer, const char *ifnam
 	 * We need an address either in gateway or in destination
 	 * to get the address family.
 	 */
-	if (!gway || ni_string_eq(gway, "-")) {
+	if (ni_slice_empty(&gway) || ni_slice_eq(&gway, "-")) {
 		/*
 		 * This is either a local interface route, e.g.
 		 * ifroute-lo contains just 127/8 in it, or a
 		 * multipath route where the hops are in opts.
 		 */
-		gway = NULL;
 	} else
-	if (ni_sockaddr_parse(&rp->nh.gateway, gway, AF_UNSPEC) < 0) {
-		ni_error("%s[%u]: Cannot parse route gateway address \"%s\"",
-			filename, line, gway);
+	if (ni_sockaddr_parse_slice(&rp->nh.gateway, &gway, AF_UNSPEC) < 0) {
+		ni_error("%s[%u]: Cannot parse route gateway address \"%.*s\"",
+			filename, line, (int)gway.len, gway.data);
 		goto failure;
 	}
 	if (rp->family == AF_UNSPEC)
 		rp->family = rp->nh.gateway.ss_family;
 
-	if (__ni_suse_route_parse_opts(rp, &opts, &i, ifname, filename, line)) {
-		ni_error("%s[%u]: Cannot parse route options \"%s\"",
-			filename, line, end);
+	scan = opts;
+	if (__ni_suse_route_parse_opts(rp, &scan, ifname, filename, line)) {
+		ni_error("%s[%u]: Cannot parse route options \"%.*s\"",
+			filename, line, (int)opts.len, opts.data);
 		goto failure;
 	}
-	ni_string_array_destroy(&opts);
 
-	if (ni_string_eq(dest, "default")) {
+	if (ni_slice_eq(&dest, "default")) {
 		/*
 		 * A default route with family from gateway
 		 */
@@ -992,17 +1066,18 @@ __ni_suse_route_parse(ni_route_table_t **routes, char *buffer, const char *ifnam
 	} else {
 		rp->prefixlen = -1U;
 
-		if ((end = strchr(dest, '/'))) {
-			*end++ = '\0';
-			if (ni_parse_uint(end, &rp->prefixlen, 10) < 0) {
-				ni_error("%s[%u]: Cannot parse route destination length \"%s\"",
-					filename, line, end);
+		if ((slash = memchr(dest.data, '/', dest.len))) {
+			scan = ni_slice_init(slash + 1, dest.len - (slash + 1 - dest.data));
+			dest.len = slash - dest.data;
+			if (ni_slice_parse_uint(&scan, &rp->prefixlen, 10) < 0) {
+				ni_error("%s[%u]: Cannot parse route destination length \"%.*s\"",
+					filename, line, (int)scan.len, scan.data);
 				goto failure;
 			}
 		}
-		if (ni_sockaddr_parse(&rp->destination, dest, AF_UNSPEC) < 0) {
-			ni_error("%s[%u]: Cannot parse route destination prefix \"%s\"",
-				filename, line, dest);
+		if (ni_sockaddr_parse_slice(&rp->destination, &dest, AF_UNSPEC) < 0) {
+			ni_error("%s[%u]: Cannot parse route destination prefix \"%.*s\"",
+				filename, line, (int)dest.len, dest.data);
 			goto failure;
 		}
 		if (rp->family == AF_UNSPEC)
@@ -1011,18 +1086,18 @@ __ni_suse_route_parse(ni_route_table_t **routes, char *buffer, const char *ifnam
 			goto failure;
 
 		plen = ni_af_address_length(rp->destination.ss_family) * 8;
-		if (end == NULL) {
+		if (slash == NULL) {
 			/*
 			 * Destination without prefix-length, parse mask field.
 			 */
-			if (!mask || ni_string_eq(mask, "-")) {
+			if (ni_slice_empty(&mask) || ni_slice_eq(&mask, "-")) {
 				/*
 				 * No mask field is provided, assume the destination is
 				 * a single IP address -- use the full address length.
 				 */
 				rp->prefixlen = plen;
 			} else
-			if (strchr(mask, '.')) {
+			if (memchr(mask.data, '.', mask.len)) {
 				ni_sockaddr_t netmask;
 
 				/*
@@ -1030,25 +1105,25 @@ __ni_suse_route_parse(ni_route_table_t **routes, char *buffer, const char *ifnam
 				 * dotted-decimal format (we do not parse a IPv6 netmask).
 				 */
 				if (rp->destination.ss_family != AF_INET ||
-				    ni_sockaddr_parse(&netmask, mask, AF_INET) < 0) {
-					ni_error("%s[%u]: Cannot parse route netmask \"%s\"",
-						filename, line, mask);
+				    ni_sockaddr_parse_slice(&netmask, &mask, AF_INET) < 0) {
+					ni_error("%s[%u]: Cannot parse route netmask \"%.*s\"",
+						filename, line, (int)mask.len, mask.data);
 					goto failure;
 				}
 				rp->prefixlen = ni_sockaddr_netmask_bits(&netmask);
 			} else
-			if (ni_parse_uint(mask, &rp->prefixlen, 10) < 0) {
+			if (ni_slice_parse_uint(&mask, &rp->prefixlen, 10) < 0) {
 				/*
 				 * The mask field contains a prefix length.
 				 */
-				ni_error("%s[%u]: Cannot parse route destination length \"%s\"",
-					filename, line, mask);
+				ni_error("%s[%u]: Cannot parse route destination length \"%.*s\"",
+					filename, line, (int)mask.len, mask.data);
 				goto failure;
 			}
 		}
 		if (rp->prefixlen > plen) {
-			ni_error("%s[%u]: Cannot parse route destination length \"%s\"",
-				filename, line, mask);
+			ni_error("%s[%u]: Cannot parse route destination length \"%.*s\"",
+				filename, line, (int)mask.len, mask.data);
 			goto failure;
 		}
 	}
@@ -1115,14 +1190,17 @@ __ni_suse_route_parse(ni_route_table_t **routes, char *buffer, const char *ifnam
 	if (ni_route_tables_find_match(*routes, rp, ni_route_equal_destination)) {
 		ni_debug_readwrite("Skipping route -- duplicate destination: %s/%u",
 				ni_sockaddr_print(&rp->destination), rp->prefixlen);
+		ni_string_free(&devname);
 		return 1;
 	}
 
-	if (ni_route_tables_add_route(routes, rp))
+	if (ni_route_tables_add_route(routes, rp)) {
+		ni_string_free(&devname);
 		return 0;
+	}
 
 failure:
-	ni_string_array_destroy(&opts);
+	ni_string_free(&devname);
 	if (rp) {
 		ni_route_free(rp);
 	}
@@ -1619,19 +1697,19 @@ __ni_suse_startmode(const ni_sysconfig_t *sc)
 		ni_ifworker_control_t	control;
 	} __ni_suse_control_params[] = {
 		/* manual is the default in ifcfg */
-		{ "manual",	{ "manual",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0 } },
+		{ "manual",	{ "manual",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0, FALSE } },
 
-		{ "auto",	{ "boot",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0 } },
-		{ "boot",	{ "boot",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0 } },
-		{ "onboot",	{ "boot",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0 } },
-		{ "on",		{ "boot",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0 } },
+		{ "auto",	{ "boot",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0, FALSE } },
+		{ "boot",	{ "boot",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0, FALSE } },
+		{ "onboot",	{ "boot",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0, FALSE } },
+		{ "on",		{ "boot",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0, FALSE } },
 
-		{ "nfsroot",	{ "boot",	"localfs",	TRUE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0 } },
+		{ "nfsroot",	{ "boot",	"localfs",	TRUE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0, FALSE } },
 
-		{ "hotplug",	{ "hotplug",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0 } },
-		{ "ifplugd",	{ "ifplugd",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0 } },
+		{ "hotplug",	{ "hotplug",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0, FALSE } },
+		{ "ifplugd",	{ "ifplugd",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0, FALSE } },
 
-		{ "off",	{ "off",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0 } },
+		{ "off",	{ "off",	NULL,		FALSE,	FALSE,	NI_TRISTATE_DEFAULT,	0, 0, FALSE } },
 
 		{ NULL }
 	};
@@ -1670,6 +1748,11 @@ __ni_suse_startmode(const ni_sysconfig_t *sc)
 				ni_tristate_set(&control->link_required, FALSE);
 		}
 
+		if ((value = ni_sysconfig_get_value(sc, "LINK_PARALLEL"))) {
+			if (ni_string_eq(value, "yes"))
+				control->link_parallel = TRUE;
+		}
+
 		if ((value = ni_sysconfig_get_value(sc, "LINK_READY_WAIT"))) {
 			if (ni_parse_seconds_timeout(value, &control->link_timeout)
 			||  control->link_timeout == NI_IFWORKER_INFINITE_SECONDS)
@@ -4364,7 +4447,6 @@ static int
 try_wireless(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 {
 	ni_netdev_t *dev = compat->dev;
-	ni_string_array_t vnames = NI_STRING_ARRAY_INIT;
 	ni_bool_t enabled = FALSE;
 	const char *value;
 	int ret = 1;
@@ -4388,7 +4470,7 @@ try_wireless(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 	if (enabled ||
 	    ni_sysconfig_get_value(sc, "WIRELESS_AP_SCANMODE") ||
 	    ni_sysconfig_get_value(sc, "WIRELESS_WPA_DRIVER")  ||
-	    ni_sysconfig_find_matching(sc, "WIRELESS_ESSID", &vnames) > 0 ) {
+	    ni_sysconfig_foreach_matching(sc, "WIRELESS_ESSID", NULL, NULL) > 0 ) {
 
 		if (try_add_wireless(sc, dev))
 			ret = 0;
@@ -4396,7 +4478,6 @@ try_wireless(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 			ret = -1;
 	}
 
-	ni_string_array_destroy(&vnames);
 	return ret;
 }
 
@@ -5128,6 +5209,18 @@ __get_ipaddr(const ni_sysconfig_t *sc, const char *ifname, const char *suffix, n
 	return TRUE;
 }
 
+static ni_bool_t
+__get_ipaddr_matching(const ni_sysconfig_t *sc, const ni_var_t *var,
+			const char *suffix, void *user_data)
+{
+	ni_netdev_t *dev = user_data;
+
+	(void)var;
+	/* skip / ignore addrs we aren't able to process */
+	(void)__get_ipaddr(sc, dev->name, suffix, &dev->addrs);
+	return TRUE;
+}
+
 /*
  * Process static addrconf
  */
@@ -5187,19 +5280,7 @@ __ni_suse_addrconf_static(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 		ipv6_enabled = FALSE;
 
 	/* Loop over all IPADDR* variables and get the addresses */
-	{
-		ni_string_array_t names = NI_STRING_ARRAY_INIT;
-		unsigned int i;
-
-		if (ni_sysconfig_find_matching(sc, "IPADDR", &names) > 0) {
-			for (i = 0; i < names.count; ++i) {
-				(void)__get_ipaddr(sc, dev->name, names.data[i] + 6,
-							&dev->addrs);
-				/* skip / ignore addrs we aren't able to process */
-			}
-			ni_string_array_destroy(&names);
-		}
-	}
+	ni_sysconfig_foreach_matching(sc, "IPADDR", __get_ipaddr_matching, dev);
 
 	/* Hack up the loopback interface */
 	if (dev->link.type == NI_IFTYPE_LOOPBACK) {
@@ -5310,6 +5391,38 @@ __ni_suse_addrconf_static(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 	return TRUE;
 }
 
+struct __ni_suse_dhcp4_user_class {
+	ni_compat_netdev_t *	compat;
+	const char *		prefix;
+	size_t			total;
+};
+
+static ni_bool_t
+__ni_suse_parse_dhcp4_user_class_id(const ni_sysconfig_t *sc, const ni_var_t *var,
+				const char *suffix, void *user_data)
+{
+	struct __ni_suse_dhcp4_user_class *ctx = user_data;
+	const char *string = var->value;
+	size_t length = ni_string_len(string);
+
+	(void)suffix;
+	ctx->total += length + 1;
+	if (length >= 255 || ctx->total >= 255) {
+		ni_warn("%s: %s array%s data is too long",
+			ni_basename(sc->pathname), ctx->prefix,
+			ctx->total >= 255 ? "" : " element");
+		return FALSE;
+	} else if (!ni_dhcp_check_user_class_id(string, length)) {
+		ni_warn("%s: %s contains suspect class id element: '%s'",
+			ni_basename(sc->pathname), ctx->prefix,
+			ni_print_suspect(string, length));
+		return FALSE;
+	}
+
+	ni_string_array_append(&ctx->compat->dhcp4.user_class.class_id, string);
+	return TRUE;
+}
+
 static ni_bool_t
 __ni_suse_parse_dhcp4_user_class(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat, const char *prefix)
 {
@@ -5317,46 +5430,15 @@ __ni_suse_parse_dhcp4_user_class(const ni_sysconfig_t *sc, ni_compat_netdev_t *c
 	size_t length;
 
 	if (compat->dhcp4.user_class.format == NI_DHCP4_USER_CLASS_RFC3004) {
-		ni_string_array_t names = NI_STRING_ARRAY_INIT;
-		unsigned int i;
-		size_t pfxlen;
-		size_t total;
-		ni_var_t *var;
-
-		if (!ni_sysconfig_find_matching(sc, prefix, &names))
+		struct __ni_suse_dhcp4_user_class ctx = { .compat = compat, .prefix = prefix };
+		int ret;
+
+		ret = ni_sysconfig_foreach_matching(sc, prefix,
+				__ni_suse_parse_dhcp4_user_class_id, &ctx);
+		if (ret < 0)
+			ni_string_array_destroy(&compat->dhcp4.user_class.class_id);
+		if (ret <= 0)
 			return FALSE;
-
-		pfxlen = ni_string_len(prefix);
-		for (total = 0, i = 0; i < names.count; ++i) {
-			const char *suffix = names.data[i] + pfxlen;
-
-			if (!(var = __find_indexed_variable(sc, prefix, suffix)))
-				continue;
-
-			if (!(length = ni_string_len(var->value)))
-				continue;
-
-			string = var->value;
-			total += length + 1;
-			if (length >= 255 || total >= 255) {
-				ni_warn("%s: %s array%s data is too long",
-					ni_basename(sc->pathname), prefix,
-					total >= 255 ? "" : " element");
-				ni_string_array_destroy(&names);
-				ni_string_array_destroy(&compat->dhcp4.user_class.class_id);
-				return FALSE;
-			} else if (!ni_dhcp_check_user_class_id(string, length)) {
-				ni_warn("%s: %s contains suspect class id element: '%s'",
-					ni_basename(sc->pathname), prefix,
-					ni_print_suspect(string, length));
-				ni_string_array_destroy(&names);
-				ni_string_array_destroy(&compat->dhcp4.user_class.class_id);
-				return FALSE;
-			}
-
-			ni_string_array_append(&compat->dhcp4.user_class.class_id, string);
-		}
-		ni_string_array_destroy(&names);
 	} else if ((string = ni_sysconfig_get_value(sc, prefix))) {
 		length = ni_string_len(string);
 
@@ -5380,48 +5462,65 @@ __ni_suse_parse_dhcp4_user_class(const ni_sysconfig_t *sc, ni_compat_netdev_t *c
 	return TRUE;
 }
 
-static void
-__ni_suse_parse_dhcp_req_options(const ni_sysconfig_t *sc, ni_string_array_t *options,
-				const char *prefix, const ni_dhcp_option_decl_t *custom,
-				unsigned int code_min, unsigned int code_max)
+struct __ni_suse_dhcp_req_options {
+	ni_string_array_t *		options;
+	const ni_dhcp_option_decl_t *	custom;
+	unsigned int			code_min;
+	unsigned int			code_max;
+};
+
+static ni_bool_t
+__ni_suse_parse_dhcp_req_option_var(const ni_sysconfig_t *sc, const ni_var_t *var,
+				const char *suffix, void *user_data)
 {
-	ni_string_array_t vars = NI_STRING_ARRAY_INIT;
+	struct __ni_suse_dhcp_req_options *ctx = user_data;
 	ni_string_array_t opts = NI_STRING_ARRAY_INIT;
-	const char *value;
-	unsigned int i, j;
+	unsigned int j;
 	unsigned int code;
 
-	ni_sysconfig_find_matching(sc, prefix, &vars);
-	for (i = 0; i < vars.count; ++i) {
-		value = ni_sysconfig_get_value(sc, vars.data[i]);
-		ni_string_split(&opts, value, " ", 0);
-		for (j = 0; j < opts.count; ++j) {
-			const ni_dhcp_option_decl_t *decl;
-			const char *opt = opts.data[j];
+	(void)suffix;
+	ni_string_split(&opts, var->value, " ", 0);
+	for (j = 0; j < opts.count; ++j) {
+		const ni_dhcp_option_decl_t *decl;
+		const char *opt = opts.data[j];
 
-			if ((decl = ni_dhcp_option_decl_list_find_by_name(custom, opt)))
-				opt = decl->name;
-			else
-			if (ni_parse_uint(opt, &code, 10)) {
-				ni_warn("%s: Cannot parse %s option code '%s'",
-						ni_basename(sc->pathname), vars.data[i],
-						opt);
-				continue;
-			} else
-			if (code < code_min || code_max < code) {
-				ni_warn("%s: %s option code %u is out of range (%u..%u)",
-						ni_basename(sc->pathname), vars.data[i],
-						code, code_min, code_max);
-				continue;
-			} else
-			if ((decl = ni_dhcp_option_decl_list_find_by_code(custom, code)))
-				opt = decl->name;
+		if ((decl = ni_dhcp_option_decl_list_find_by_name(ctx->custom, opt)))
+			opt = decl->name;
+		else
+		if (ni_parse_uint(opt, &code, 10)) {
+			ni_warn("%s: Cannot parse %s option code '%s'",
+					ni_basename(sc->pathname), var->name,
+					opt);
+			continue;
+		} else
+		if (code < ctx->code_min || ctx->code_max < code) {
+			ni_warn("%s: %s option code %u is out of range (%u..%u)",
+					ni_basename(sc->pathname), var->name,
+					code, ctx->code_min, ctx->code_max);
+			continue;
+		} else
+		if ((decl = ni_dhcp_option_decl_list_find_by_code(ctx->custom, code)))
+			opt = decl->name;
 
-			ni_string_array_append(options, opt);
-		}
-		ni_string_array_destroy(&opts);
+		ni_string_array_append(ctx->options, opt);
 	}
-	ni_string_array_destroy(&vars);
+	ni_string_array_destroy(&opts);
+	return TRUE;
+}
+
+static void
+__ni_suse_parse_dhcp_req_options(const ni_sysconfig_t *sc, ni_string_array_t *options,
+				const char *prefix, const ni_dhcp_option_decl_t *custom,
+				unsigned int code_min, unsigned int code_max)
+{
+	struct __ni_suse_dhcp_req_options ctx = {
+		.options	= options,
+		.custom		= custom,
+		.code_min	= code_min,
+		.code_max	= code_max,
+	};
+
+	ni_sysconfig_foreach_matching(sc, prefix, __ni_suse_parse_dhcp_req_option_var, &ctx);
 }
 
 /*
@@ -6377,6 +6476,9 @@ __ni_suse_read_ifsysctl(ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 	if (ipv6->conf.accept_dad < NI_IPV6_ACCEPT_DAD_DEFAULT)
 		ipv6->conf.accept_dad = NI_IPV6_ACCEPT_DAD_DEFAULT;
 
+	__ifsysctl_get_tristate(&ifsysctl, "net/ipv6/conf", dev->name,
+				"optimistic_dad", &ipv6->conf.optimistic_dad);
+
 	__ifsysctl_get_tristate(&ifsysctl, "net/ipv6/conf", dev->name,
 				"autoconf", &ipv6->conf.autoconf);
 
@@ -6455,7 +6557,7 @@ __ni_suse_set_link_master(ni_netdev_t *dev, const char *master, const char *ifcf
 static ni_compat_netdev_t *
 __ni_suse_create_compat_slave(ni_compat_netdev_array_t *netdevs, ni_compat_netdev_t *master, const char *master_name, const char *slave)
 {
-	ni_ifworker_control_t control = { "hotplug", NULL, FALSE, FALSE, NI_TRISTATE_DEFAULT, 0, 0 };
+	ni_ifworker_control_t control = { "hotplug", NULL, FALSE, FALSE, NI_TRISTATE_DEFAULT, 0, 0, FALSE };
 	ni_compat_netdev_t *compat;
 	ni_client_state_t *m_cs;
 	ni_client_state_t *s_cs;
@@ -6566,7 +6668,7 @@ static void
 __ni_suse_adjust_ovs_system(ni_compat_netdev_t *compat)
 {
 	static const ni_ifworker_control_t control = {
-		"hotplug", NULL, FALSE, FALSE, NI_TRISTATE_DISABLE, 0, 0
+		"hotplug", NULL, FALSE, FALSE, NI_TRISTATE_DISABLE, 0, 0, FALSE
 	};
 	ni_ipv4_devinfo_t *ipv4;
 	ni_ipv6_devinfo_t *ipv6;
@@ -6726,6 +6828,21 @@ __ni_suse_sysconfig_read(ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 	return TRUE;
 }
 
+struct __indexed_variables {
+	ni_netdev_t *	dev;
+	ni_bool_t	(*func)(const ni_sysconfig_t *, ni_netdev_t *, const char *);
+};
+
+static ni_bool_t
+__process_indexed_variable(const ni_sysconfig_t *sc, const ni_var_t *var,
+				const char *suffix, void *user_data)
+{
+	struct __indexed_variables *ctx = user_data;
+
+	(void)var;
+	return ctx->func(sc, ctx->dev, suffix);
+}
+
 /*
  * Given a basename like "IPADDR", try to find all variables with this
  * prefix (eg "IPADDR", "IPADDR_0", "IPADDR_1", ...) and invoke the provided function
@@ -6737,21 +6854,13 @@ __process_indexed_variables(const ni_sysconfig_t *sc, ni_netdev_t *dev,
 				const char *basename,
 				ni_bool_t (*func)(const ni_sysconfig_t *, ni_netdev_t *, const char *))
 {
-	ni_string_array_t names = NI_STRING_ARRAY_INIT;
-	unsigned int i, pfxlen;
+	struct __indexed_variables ctx = { .dev = dev, .func = func };
+	int ret;
 
-	if (!ni_sysconfig_find_matching(sc, basename, &names))
+	if (!(ret = ni_sysconfig_foreach_matching(sc, basename, __process_indexed_variable, &ctx)))
 		return 1;
 
-	pfxlen = strlen(basename);
-	for (i = 0; i < names.count; ++i) {
-		if (!func(sc, dev, names.data[i] + pfxlen)) {
-			ni_string_array_destroy(&names);
-			return -1;
-		}
-	}
-	ni_string_array_destroy(&names);
-	return 0;
+	return ret < 0 ? -1 : 0;
 }
 
 /*
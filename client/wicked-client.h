@@ -159,6 +159,10 @@ extern void			ni_compat_netdev_set_origin(ni_compat_netdev_t *, const char *, co
 
 extern ni_bool_t		ni_ifconfig_load(ni_fsm_t *, const char *, ni_string_array_t *,
 						ni_bool_t, ni_bool_t);
+extern ni_bool_t		ni_ifconfig_load_uuid_index(ni_fsm_t *, const char *,
+						const ni_string_array_t *);
+extern void			ni_ifconfig_save_uuid_index(ni_fsm_t *, const char *,
+						const ni_string_array_t *);
 
 extern const ni_string_array_t *ni_config_sources(const char *);
 
@@ -167,6 +171,8 @@ extern void			ni_ifconfig_metadata_add_to_node(xml_node_t *, ni_client_state_con
 extern ni_bool_t		ni_ifconfig_metadata_get_from_node(ni_client_state_config_t *, xml_node_t *);
 extern void			ni_ifconfig_metadata_clear(xml_node_t *);
 extern const char *		ni_ifconfig_format_origin(char **, const char *, const char *);
+extern void			ni_ifconfig_cache_digest_file(ni_hashctx_t *, const char *);
+extern void			ni_ifconfig_cache_digest_dir(ni_hashctx_t *, const char *);
 
 typedef struct ni_nanny_fsm_monitor	ni_nanny_fsm_monitor_t;
 
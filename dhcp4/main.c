@@ -26,6 +26,7 @@
 
 #include "dhcp4/dhcp4.h"
 #include "dhcp4/tester.h"
+#include "dhcp4/server.h"
 
 enum {
 	/* common */
@@ -48,6 +49,15 @@ enum {
 	OPT_TEST_OUTPUT,
 	OPT_TEST_OUTFMT,
 	OPT_TEST_BROADCAST,
+
+	/* test server */
+	OPT_TEST_SERVER,
+	OPT_TEST_LATENCY,
+	OPT_TEST_JITTER,
+	OPT_TEST_LOSS,
+	OPT_TEST_LEASE_TIME,
+	OPT_TEST_DURATION,
+	OPT_TEST_NAK,
 };
 
 static struct option	options[] = {
@@ -74,6 +84,15 @@ static struct option	options[] = {
 	{ "test-format",	required_argument,	NULL,	OPT_TEST_OUTFMT  },
 	{ "test-broadcast",	no_argument,		NULL,	OPT_TEST_BROADCAST},
 
+	/* test server */
+	{ "test-server",	no_argument,		NULL,	OPT_TEST_SERVER  },
+	{ "test-latency",	required_argument,	NULL,	OPT_TEST_LATENCY },
+	{ "test-jitter",	required_argument,	NULL,	OPT_TEST_JITTER  },
+	{ "test-loss",		required_argument,	NULL,	OPT_TEST_LOSS    },
+	{ "test-lease-time",	required_argument,	NULL,	OPT_TEST_LEASE_TIME},
+	{ "test-duration",	required_argument,	NULL,	OPT_TEST_DURATION},
+	{ "test-nak",		no_argument,		NULL,	OPT_TEST_NAK     },
+
 	{ NULL,			no_argument,		NULL,	0 }
 };
 
@@ -88,6 +107,7 @@ static ni_dbus_server_t *dhcp4_dbus_server;
 
 static void		dhcp4_supplicant(void);
 static void		dhcp4_recover_state(const char *);
+static void		dhcp4_recover_handover(void);
 static void		dhcp4_discover_devices(ni_dbus_server_t *);
 static void		dhcp4_interface_event(ni_netdev_t *, ni_event_t);
 static void		dhcp4_protocol_event(enum ni_dhcp4_event, const ni_dhcp4_device_t *, ni_addrconf_lease_t *);
@@ -100,6 +120,7 @@ int
 main(int argc, char **argv)
 {
 	ni_dhcp4_tester_t * tester = NULL;
+	ni_dhcp4_server_opts_t * server = NULL;
 	int c, status = NI_WICKED_RC_USAGE;
 
 	ni_log_init();
@@ -141,6 +162,15 @@ main(int argc, char **argv)
 				"       --test-output  <output file name>\n"
 				"       --test-format  <leaseinfo|lease-xml>\n"
 				"       --test-broadcast\n"
+				"\n"
+				"  --test-server [server-options] <ifname> [<ifname> ...]\n"
+				"    server-options:\n"
+				"       --test-latency <reply delay in msec> (default: 0)\n"
+				"       --test-jitter  <random extra delay in msec> (default: 0)\n"
+				"       --test-loss    <dropped replies in percent> (default: 0)\n"
+				"       --test-lease-time <lease time in sec> (default: 3600)\n"
+				"       --test-duration <run time in sec> (default: until signaled)\n"
+				"       --test-nak\n"
 				, program_name);
 			return status;
 
@@ -195,6 +225,8 @@ main(int argc, char **argv)
 
 		/* test run */
 		case OPT_TEST:
+			if (server)
+				goto usage;
 			opt_foreground = TRUE;
 			tester = ni_dhcp4_tester_init();
 			break;
@@ -228,6 +260,52 @@ main(int argc, char **argv)
 				goto usage;
 			tester->broadcast = NI_TRISTATE_ENABLE;
 			break;
+
+		/* test server */
+		case OPT_TEST_SERVER:
+			if (tester)
+				goto usage;
+			opt_foreground = TRUE;
+			server = ni_dhcp4_server_init();
+			break;
+
+		case OPT_TEST_LATENCY:
+			if (!server || ni_parse_uint(optarg,
+						&server->latency, 0) < 0)
+				goto usage;
+			break;
+
+		case OPT_TEST_JITTER:
+			if (!server || ni_parse_uint(optarg,
+						&server->jitter, 0) < 0)
+				goto usage;
+			break;
+
+		case OPT_TEST_LOSS:
+			if (!server || ni_parse_uint(optarg,
+						&server->loss, 0) < 0 ||
+					server->loss > 100)
+				goto usage;
+			break;
+
+		case OPT_TEST_LEASE_TIME:
+			if (!server || ni_parse_uint(optarg,
+						&server->lease_time, 0) < 0 ||
+					!server->lease_time)
+				goto usage;
+			break;
+
+		case OPT_TEST_DURATION:
+			if (!server || ni_parse_uint(optarg,
+						&server->duration, 0) < 0)
+				goto usage;
+			break;
+
+		case OPT_TEST_NAK:
+			if (!server)
+				goto usage;
+			server->nak = TRUE;
+			break;
 		}
 	}
 
@@ -239,6 +317,14 @@ main(int argc, char **argv)
 			goto usage;
 		}
 	}
+	if (server) {
+		while (optind < argc && !ni_string_empty(argv[optind]))
+			ni_string_array_append(&server->ifnames, argv[optind++]);
+		if (!server->ifnames.count) {
+			fprintf(stderr, "Missing interface argument\n");
+			goto usage;
+		}
+	}
 	if (optind != argc)
 		goto usage;
 
@@ -249,7 +335,7 @@ main(int argc, char **argv)
 			goto usage;
 		}
 	}
-	else if (opt_foreground && tester) {
+	else if (opt_foreground && (tester || server)) {
 		ni_log_destination(program_name, "stderr");
 	}
 	else if (opt_systemd || getppid() == 1 || !opt_foreground) { /* syslog only */
@@ -281,6 +367,13 @@ main(int argc, char **argv)
 
 		return ni_dhcp4_tester_run(tester);
 	}
+	if (server) {
+		ni_config_statedir();
+
+		status = ni_dhcp4_server_run(server);
+		ni_string_array_destroy(&server->ifnames);
+		return status;
+	}
 
 	dhcp4_supplicant();
 	return NI_WICKED_RC_SUCCESS;
@@ -484,6 +577,8 @@ dhcp4_supplicant(void)
 
 	if (opt_recover_state)
 		dhcp4_recover_state(opt_state_file);
+	else
+		dhcp4_recover_handover();
 
 #ifdef HAVE_SYSTEMD_SD_DAEMON_H
 	if (opt_systemd) {
@@ -504,11 +599,14 @@ dhcp4_supplicant(void)
 
 	if (opt_recover_state)
 		ni_objectmodel_save_state(opt_state_file);
+	else
+		ni_objectmodel_save_handover("dhcp4");
 
 	ni_server_deactivate_interface_events();
 
 	dhcp4_device_destroy_all(dhcp4_dbus_server);
 	ni_dbus_objects_garbage_collect();
+	ni_addrconf_lease_file_flush();
 
 	ni_socket_deactivate_all();
 }
@@ -665,6 +763,19 @@ dhcp4_recover_state(const char *filename)
 
 	/* Now loop over all devices that have a request associated with them,
 	 * and kickstart those. */
-	ni_dhcp4_restart_leases();
+	ni_dhcp4_restart_leases(FALSE);
+}
+
+/*
+ * Take over the requests of the initrd instance once and continue
+ * with the still valid leases in bound state.
+ */
+void
+dhcp4_recover_handover(void)
+{
+	if (!ni_objectmodel_recover_handover("dhcp4", NULL))
+		return;
+
+	ni_dhcp4_restart_leases(TRUE);
 }
 
@@ -487,6 +487,7 @@ dhcp6_supplicant(void)
 
 	dhcp6_device_destroy_all(dhcp6_dbus_server);
 	ni_dbus_objects_garbage_collect();
+	ni_addrconf_lease_file_flush();
 
 	ni_socket_deactivate_all();
 }
@@ -78,6 +78,10 @@ typedef struct ni_address_array {
 
 #define NI_ADDRESS_ARRAY_INIT	{ .count = 0, .data = NULL }
 
+typedef struct ni_address_index	ni_address_index_t;
+
+typedef int		ni_address_cmp_fn_t(const ni_address_t *, const ni_address_t *);
+
 extern ni_bool_t	ni_sockaddr_is_ipv4_loopback(const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_is_ipv4_linklocal(const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_is_ipv4_broadcast(const ni_sockaddr_t *);
@@ -99,6 +103,7 @@ extern ni_bool_t	ni_sockaddr_is_specified(const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_is_unspecified(const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_equal(const ni_sockaddr_t *, const ni_sockaddr_t *);
 extern int		ni_sockaddr_compare(const ni_sockaddr_t *, const ni_sockaddr_t *);
+extern unsigned int	ni_sockaddr_hash(const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_prefix_match(unsigned int, const ni_sockaddr_t *, const ni_sockaddr_t *);
 
 extern void		ni_sockaddr_set_ipv4(ni_sockaddr_t *, struct in_addr, uint16_t);
@@ -107,6 +112,7 @@ extern const char *	ni_sockaddr_format(const ni_sockaddr_t *ss, char *abuf, size
 extern const char *	ni_sockaddr_print(const ni_sockaddr_t *ss);
 extern const char *	ni_sockaddr_prefix_print(const ni_sockaddr_t *, unsigned int);
 extern int		ni_sockaddr_parse(ni_sockaddr_t *ss, const char *string, int af);
+extern int		ni_sockaddr_parse_slice(ni_sockaddr_t *ss, const ni_slice_t *, int af);
 extern ni_bool_t	ni_sockaddr_prefix_parse(const char *, ni_sockaddr_t *, unsigned int *);
 extern unsigned int	ni_sockaddr_netmask_bits(const ni_sockaddr_t *mask);
 extern int		ni_sockaddr_build_netmask(int, unsigned int, ni_sockaddr_t *);
@@ -146,6 +152,7 @@ extern ni_bool_t	ni_address_is_loopback(const ni_address_t *laddr);
 extern ni_bool_t	ni_address_is_linklocal(const ni_address_t *laddr);
 extern ni_bool_t	ni_address_is_duplicate(const ni_address_t *laddr);
 extern ni_bool_t	ni_address_is_tentative(const ni_address_t *laddr);
+extern ni_bool_t	ni_address_is_optimistic(const ni_address_t *laddr);
 extern ni_bool_t	ni_address_is_temporary(const ni_address_t *laddr);
 extern ni_bool_t	ni_address_is_permanent(const ni_address_t *laddr);
 extern ni_bool_t	ni_address_is_deprecated(const ni_address_t *laddr);
@@ -174,8 +181,17 @@ extern 			ni_declare_slist_count(ni_address);
 extern void		ni_address_list_dedup(ni_address_t **);
 extern ni_address_t *	ni_address_list_find(ni_address_t *, const ni_sockaddr_t *);
 
+extern ni_address_index_t *	ni_address_index_new(const ni_address_t *);
+extern void		ni_address_index_free(ni_address_index_t *);
+extern void		ni_address_index_insert(ni_address_index_t *, ni_address_t *);
+extern ni_bool_t	ni_address_index_remove(ni_address_index_t *, const ni_address_t *);
+extern ni_address_t *	ni_address_index_find(const ni_address_index_t *, const ni_sockaddr_t *);
+extern unsigned int	ni_address_list_merge_match(const ni_address_t *, const ni_address_t *,
+					ni_address_cmp_fn_t *, ni_address_t **);
+
 extern void		ni_address_array_init(ni_address_array_t *);
 extern void		ni_address_array_destroy(ni_address_array_t *);
+extern ni_bool_t	ni_address_array_reserve(ni_address_array_t *, unsigned int);
 extern ni_bool_t	ni_address_array_append(ni_address_array_t *, ni_address_t *);
 extern ni_bool_t	ni_address_array_delete(ni_address_array_t *, const ni_address_t *);
 extern ni_bool_t	ni_address_array_delete_at(ni_address_array_t *, unsigned int);
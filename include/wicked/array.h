@@ -46,6 +46,9 @@
 #define			ni_declare_ptr_array_realloc(prefix)				\
 	ni_bool_t	prefix##_array_realloc(prefix##_array_t *)
 
+#define			ni_declare_ptr_array_reserve(prefix)				\
+	ni_bool_t	prefix##_array_reserve(prefix##_array_t *, unsigned int)
+
 #define			ni_declare_ptr_array_append(prefix)				\
 	ni_bool_t	prefix##_array_append(prefix##_array_t *, prefix##_t *)
 
@@ -38,12 +38,28 @@ typedef struct ni_bridge_port_status {
 	unsigned long		forward_delay_timer;
 } ni_bridge_port_status_t;
 
+/*
+ * A VLAN ID or a range of VLAN IDs the port is member of
+ */
+typedef struct ni_bridge_port_vlan {
+	unsigned int		vid_begin;
+	unsigned int		vid_end;
+	ni_bool_t		pvid;
+	ni_bool_t		untagged;
+} ni_bridge_port_vlan_t;
+
+typedef struct ni_bridge_port_vlan_array {
+	unsigned int		count;
+	ni_bridge_port_vlan_t *	data;
+} ni_bridge_port_vlan_array_t;
+
 struct ni_bridge_port {
 	char *			ifname;
 	unsigned int		ifindex;
 
 	unsigned int		priority;
 	unsigned int		path_cost;
+	ni_bridge_port_vlan_array_t vlans;
 
 	ni_bridge_port_status_t	status;
 };
@@ -77,6 +93,7 @@ struct ni_bridge {
 	double			ageing_time;
 	double			hello_time;
 	double			max_age;
+	ni_tristate_t		vlan_filtering;
 
 	ni_bridge_status_t	status;
 	ni_bridge_port_array_t	ports;
@@ -99,6 +116,12 @@ extern ni_bridge_port_t *ni_bridge_port_by_name(const ni_bridge_t *br, const cha
 extern ni_bridge_port_t *ni_bridge_port_clone(const ni_bridge_port_t *port);
 extern void		ni_bridge_port_free(ni_bridge_port_t *port);
 
+extern ni_bool_t	ni_bridge_port_vlan_array_append(ni_bridge_port_vlan_array_t *,
+				unsigned int, unsigned int, ni_bool_t, ni_bool_t);
+extern void		ni_bridge_port_vlan_array_destroy(ni_bridge_port_vlan_array_t *);
+extern ni_bool_t	ni_bridge_port_vlan_parse(const char *, unsigned int *, unsigned int *);
+extern const char *	ni_bridge_port_vlan_format(const ni_bridge_port_vlan_t *, ni_stringbuf_t *);
+
 
 extern const char *	ni_bridge_port_validate(const ni_bridge_port_t *);
 extern const char *	ni_bridge_validate(const ni_bridge_t *);
@@ -18,6 +18,9 @@ extern int			ni_call_error_context_get_retries(ni_call_error_context_t *, const
 
 extern ni_dbus_object_t *	ni_call_get_netif_list_object(void);
 extern ni_dbus_object_t *	ni_call_get_modem_list_object(void);
+extern dbus_bool_t		ni_call_refresh_netif_list(ni_dbus_object_t *);
+extern dbus_bool_t		ni_call_delete_devices(ni_dbus_object_t *, const ni_uint_array_t *,
+					ni_uint_array_t *);
 
 extern ni_dbus_object_t *	ni_call_create_client(void);
 extern char *			ni_call_device_by_name(ni_dbus_object_t *, const char *);
@@ -28,6 +31,14 @@ extern int			ni_call_common_xml(ni_dbus_object_t *,
 					const ni_dbus_service_t *, const ni_dbus_method_t *,
 					xml_node_t *, ni_objectmodel_callback_info_t **,
 					ni_call_error_handler_t *error_func);
+extern int			ni_call_common_xml_async(ni_dbus_object_t *,
+					const ni_dbus_service_t *, const ni_dbus_method_t *,
+					xml_node_t *, ni_dbus_async_callback_t *, uint32_t *);
+extern int			ni_call_common_xml_result(ni_dbus_object_t *,
+					const ni_dbus_service_t *, const ni_dbus_method_t *,
+					xml_node_t *, ni_dbus_message_t *,
+					ni_objectmodel_callback_info_t **,
+					ni_call_error_handler_t *error_func);
 extern int			ni_call_set_client_state_control(ni_dbus_object_t *, const ni_client_state_control_t *);
 extern int			ni_call_set_client_state_config(ni_dbus_object_t *, const ni_client_state_config_t *);
 extern int			ni_call_set_client_state_scripts(ni_dbus_object_t *, const ni_client_state_scripts_t *);
@@ -37,6 +37,7 @@ struct ni_dbus_variant {
 		int		element_type;
 		char *		element_signature;
 		unsigned int	len;
+		unsigned int	alloc;		/* allocated elements */
 	} array;
 
 	/* Possible values */
@@ -139,6 +140,7 @@ struct ni_dbus_object {
 	ni_dbus_object_t *	parent;
 
 	ni_bool_t		stale;		/* used by GetManagedObjects client code */
+	ni_bool_t		updated;	/* kept current by PropertiesChanged */
 
 	const ni_dbus_class_t *	class;
 	char *			name;		/* relative path */
@@ -147,6 +149,14 @@ struct ni_dbus_object {
 	ni_dbus_object_t *	children;
 	const ni_dbus_service_t **interfaces;
 
+	unsigned int		hash;		/* hash of the name */
+	ni_dbus_object_t *	hash_next;	/* in the parent's child hash */
+	struct {
+		unsigned int	size;
+		unsigned int	count;
+		ni_dbus_object_t **table;
+	}			child_hash;
+
 	ni_dbus_server_object_t *server_object;
 	ni_dbus_client_object_t *client_object;
 };
@@ -164,9 +174,18 @@ extern ni_dbus_object_t *	ni_dbus_server_register_object(ni_dbus_server_t *serve
 					void *object_handle);
 extern dbus_bool_t		ni_dbus_server_unregister_object(ni_dbus_server_t *, void *);
 extern ni_dbus_object_t *	ni_dbus_server_find_object_by_handle(ni_dbus_server_t *, const void *);
+extern dbus_bool_t		ni_dbus_object_get_managed_object_dict(ni_dbus_object_t *,
+					ni_dbus_variant_t *, DBusError *);
 extern dbus_bool_t		ni_dbus_server_send_signal(ni_dbus_server_t *server, ni_dbus_object_t *object,
 					const char *interface, const char *signal_name,
 					unsigned int nargs, const ni_dbus_variant_t *args);
+extern dbus_bool_t		ni_dbus_server_send_properties_changed(ni_dbus_server_t *,
+					ni_dbus_object_t *);
+extern ni_dbus_deferred_reply_t *ni_dbus_server_defer_reply(ni_dbus_object_t *,
+					ni_dbus_message_t *);
+extern ni_dbus_message_t *	ni_dbus_deferred_reply_message(const ni_dbus_deferred_reply_t *);
+extern void			ni_dbus_deferred_reply_complete(ni_dbus_deferred_reply_t *,
+					const DBusError *);
 
 extern dbus_bool_t		ni_dbus_class_is_subclass(const ni_dbus_class_t *sub, const ni_dbus_class_t *super);
 
@@ -224,6 +243,9 @@ extern void			ni_dbus_variant_init(ni_dbus_variant_t *);
 extern dbus_bool_t		ni_dbus_variant_init_signature(ni_dbus_variant_t *, const char *);
 extern void			ni_dbus_variant_copy(ni_dbus_variant_t *dst,
 					const ni_dbus_variant_t *src);
+extern dbus_bool_t		ni_dbus_variant_equal(const ni_dbus_variant_t *,
+					const ni_dbus_variant_t *);
+extern dbus_bool_t		ni_dbus_variant_reserve(ni_dbus_variant_t *, unsigned int);
 extern void			ni_dbus_variant_destroy(ni_dbus_variant_t *);
 extern const char *		ni_dbus_variant_print(ni_stringbuf_t *, const ni_dbus_variant_t *);
 extern const char *		ni_dbus_variant_sprint(const ni_dbus_variant_t *);
@@ -349,6 +371,7 @@ extern dbus_bool_t		ni_dbus_variant_get_variant(const ni_dbus_variant_t *, const
  * Client side functions
  */
 extern ni_dbus_client_t *	ni_dbus_client_open(const char *bus_type, const char *bus_name);
+extern ni_dbus_client_t *	ni_dbus_client_open_peer(const char *path, const char *bus_name);
 extern void			ni_dbus_client_free(ni_dbus_client_t *);
 extern void			ni_dbus_client_add_signal_handler(ni_dbus_client_t *client,
 					const char *sender,
@@ -356,11 +379,21 @@ extern void			ni_dbus_client_add_signal_handler(ni_dbus_client_t *client,
 					const char *object_interface,
 					ni_dbus_signal_handler_t *callback,
 					void *user_data);
+extern void			ni_dbus_client_add_signal_match(ni_dbus_client_t *client,
+					const char *sender,
+					const char *path_namespace,
+					const char *object_interface,
+					const char *member,
+					ni_dbus_signal_handler_t *callback,
+					void *user_data);
+extern void			ni_dbus_client_remove_signal_handlers(ni_dbus_client_t *client,
+					const void *user_data);
 extern void			ni_dbus_client_set_call_timeout(ni_dbus_client_t *, unsigned int msec);
 extern void			ni_dbus_client_set_error_map(ni_dbus_client_t *, const ni_intmap_t *);
 extern int			ni_dbus_client_translate_error(ni_dbus_client_t *, const DBusError *);
 extern ni_dbus_message_t *	ni_dbus_client_call(ni_dbus_client_t *client, ni_dbus_message_t *call,
 					DBusError *error);
+extern dbus_bool_t		ni_dbus_client_wait(ni_dbus_client_t *client, unsigned int msec);
 extern ni_dbus_object_t *	ni_dbus_client_object_new(ni_dbus_client_t *client,
 					const ni_dbus_class_t *,
 					const char *object_path,
@@ -377,19 +410,37 @@ extern dbus_bool_t		ni_dbus_object_call_variant(const ni_dbus_object_t *,
 					unsigned int nargs, const ni_dbus_variant_t *args,
 					unsigned int maxres, ni_dbus_variant_t *res,
 					DBusError *error);
+typedef dbus_bool_t		ni_dbus_dict_entry_callback_t(const char *,
+					const ni_dbus_variant_t *, void *);
+extern dbus_bool_t		ni_dbus_object_call_dict_foreach(const ni_dbus_object_t *,
+					const char *interface, const char *method,
+					unsigned int nargs, const ni_dbus_variant_t *args,
+					ni_dbus_dict_entry_callback_t *, void *,
+					DBusError *error);
 extern int			ni_dbus_object_call_simple(const ni_dbus_object_t *,
 					const char *interface, const char *method,
 					int arg_type, void *arg_ptr,
 					int res_type, void *res_ptr);
 extern int			ni_dbus_object_call_async(ni_dbus_object_t *obj,
 					ni_dbus_async_callback_t *callback, const char *method, ...);
+extern int			ni_dbus_object_call_variant_async(ni_dbus_object_t *,
+					const char *interface, const char *method,
+					unsigned int nargs, const ni_dbus_variant_t *args,
+					ni_dbus_async_callback_t *callback, uint32_t *serial);
 
 extern ni_dbus_message_t *	ni_dbus_object_call_new(const ni_dbus_object_t *, const char *method, ...);
 extern ni_dbus_message_t *	ni_dbus_object_call_new_va(const ni_dbus_object_t *obj,
 					const char *method, va_list *app);
 
 extern dbus_bool_t		ni_dbus_object_get_managed_objects(ni_dbus_object_t *, DBusError *, ni_bool_t purge);
+extern dbus_bool_t		ni_dbus_object_get_managed_objects_paged(ni_dbus_object_t *,
+					const char *interface, const char *method,
+					unsigned int page_size, DBusError *);
 extern dbus_bool_t		ni_dbus_object_refresh_properties(ni_dbus_object_t *, const ni_dbus_service_t *, DBusError *);
+extern dbus_bool_t		ni_dbus_object_refresh_properties_reply(ni_dbus_object_t *, const ni_dbus_service_t *,
+					ni_dbus_message_t *, DBusError *);
+extern dbus_bool_t		ni_dbus_object_apply_properties_changed(ni_dbus_object_t *,
+					ni_dbus_message_t *);
 extern dbus_bool_t		ni_dbus_object_send_property(ni_dbus_object_t *proxy,
 					const char *service_name,
 					const char *property_name,
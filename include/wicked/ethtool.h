@@ -268,6 +268,8 @@ typedef struct ni_ethtool_pause {
  */
 struct ni_ethtool {
 	ni_bitfield_t			supported;
+	ni_bitfield_t			cached;		/* kept current by monitor */
+	unsigned int			refresh_gen;	/* bumped on invalidation  */
 
 	/* read-only info        */
 	ni_ethtool_driver_info_t *	driver_info;
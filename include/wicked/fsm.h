@@ -53,6 +53,7 @@ typedef struct ni_ifworker		ni_ifworker_t;
 typedef struct ni_fsm_event		ni_fsm_event_t;
 typedef struct ni_fsm_require		ni_fsm_require_t;
 typedef struct ni_fsm_policy		ni_fsm_policy_t;
+typedef struct ni_fsm_policy_index	ni_fsm_policy_index_t;
 typedef int				ni_fsm_policy_compare_fn_t(const ni_fsm_policy_t *, const ni_fsm_policy_t *);
 
 typedef struct ni_fsm_policy_array {
@@ -62,9 +63,12 @@ typedef struct ni_fsm_policy_array {
 
 #define NI_FSM_POLICY_ARRAY_INIT	{ .count = 0, .data = NULL }
 
+typedef struct ni_ifworker_index	ni_ifworker_index_t;
+
 typedef struct ni_ifworker_array {
 	unsigned int			count;
 	ni_ifworker_t **		data;
+	ni_ifworker_index_t *		index;
 } ni_ifworker_array_t;
 
 #define NI_IFWORKER_ARRAY_INIT		{ .count = 0, .data = NULL }
@@ -126,20 +130,47 @@ typedef struct ni_ifworker_control {
 	ni_tristate_t		link_required;
 	unsigned int		link_priority;
 	unsigned int		link_timeout;
+	ni_bool_t		link_parallel;
 } ni_ifworker_control_t;
 
+/*
+ * Timing of a worker transition, recorded when enabled in the fsm.
+ * The durations are in msec, the timevals use the timer clock.
+ */
+typedef struct ni_ifworker_timing	ni_ifworker_timing_t;
+struct ni_ifworker_timing {
+	ni_ifworker_timing_t *	next;
+
+	ni_fsm_state_t		from_state;
+	ni_fsm_state_t		next_state;
+
+	struct timeval		started;	/* transition started		*/
+	struct timeval		called;		/* last call returned		*/
+	unsigned int		calls;		/* dbus calls made		*/
+	ni_timeout_t		call_time;	/* time spent in dbus calls	*/
+	ni_timeout_t		wait_time;	/* waiting for the event	*/
+	ni_timeout_t		duration;	/* until the state change	*/
+	ni_timeout_t		blocked_time;	/* deferred by dependencies	*/
+	ni_string_array_t	blocked_by;	/* workers it was waiting for	*/
+
+	unsigned int		finished	: 1,
+				failed		: 1,
+				timed_out	: 1;
+};
+
 struct ni_ifworker {
 	unsigned int		refcount;
 
-	char *			name;
+	const char *		name;		/* interned, ni_string_intern	*/
 	char *			old_name;
 	ni_ifworker_type_t	type;
 	ni_iftype_t		iftype;
 
 	ni_dbus_object_t *	object;
-	char *			object_path;
+	const char *		object_path;	/* interned, ni_string_intern	*/
 
 	unsigned int		ifindex;
+	unsigned int		generation;
 
 	ni_uint_range_t		target_range;
 	unsigned int		target_state;
@@ -149,10 +180,18 @@ struct ni_ifworker {
 				done		: 1,
 				kickstarted	: 1,
 				pending		: 1,
-				readonly	: 1;
+				readonly	: 1,
+				queued		: 1;	/* in fsm schedule queue	*/
 
 	ni_fsm_policy_array_t	policies;
 
+	struct {
+		ni_ifworker_array_t	workers;	/* deferred, waiting for us	*/
+		unsigned int		generation;
+		unsigned int		state;
+		unsigned int		failed	: 1;
+	}			dependents;
+
 	ni_ifworker_control_t	control;
 
 	struct {
@@ -216,6 +255,14 @@ struct ni_ifworker {
 		void *		user_data;
 	} completion;
 
+	struct {
+		ni_ifworker_timing_t *	list;
+		ni_ifworker_timing_t *	current;
+
+		struct timeval		blocked;
+		ni_string_array_t	blockers;
+	}			timings;
+
 	ni_ifworker_t *		masterdev;
 	ni_ifworker_t * 	lowerdev;
 
@@ -244,7 +291,7 @@ struct ni_fsm_require {
 struct ni_fsm_event {
 	ni_fsm_event_t *	next;
 
-	char *			object_path;
+	const char *		object_path;	/* interned, ni_string_intern	*/
 	char *			signal_name;
 
 	ni_event_t		event_type;
@@ -257,20 +304,32 @@ struct ni_fsm_event {
 struct ni_fsm {
 	ni_ifworker_array_t	pending;
 	ni_ifworker_array_t	workers;
+	ni_ifworker_array_t	blockers;	/* of a deferred worker		*/
 	ni_timeout_t		worker_timeout;
 	ni_bool_t		readonly;
+	ni_bool_t		timings;
 
 	unsigned int		timeout_count;
 	unsigned int		event_seq;
 	unsigned int		last_event_seq[__NI_EVENT_MAX];
 	unsigned int		block_events;
 	ni_fsm_event_t *	events;
+	ni_fsm_event_t *	events_last;
+	struct {
+		unsigned int	limit;
+		unsigned int	count;
+		unsigned int	window;		/* adaptive limit <= limit	*/
+		unsigned int	latency;	/* target reply latency, msec	*/
+		unsigned int	replies;	/* fast replies in the window	*/
+		struct timeval	reduced;	/* last window reduction time	*/
+	} calls;
 	struct {
 		void            (*callback)(ni_fsm_t *, ni_ifworker_t *, ni_fsm_event_t *);
 		void *          user_data;
 	} process_event;
 
 	ni_fsm_policy_t *	policies;
+	ni_fsm_policy_index_t *	policy_index;
 
 	ni_dbus_object_t *	client_root_object;
 };
@@ -306,6 +365,7 @@ extern void			ni_fsm_policy_free(ni_fsm_policy_t *);
 extern ni_bool_t		ni_fsm_policy_update(ni_fsm_policy_t *, xml_node_t *);
 extern ni_bool_t		ni_fsm_policy_remove(ni_fsm_t *, ni_fsm_policy_t *);
 extern ni_fsm_policy_t *	ni_fsm_policy_by_name(const ni_fsm_t *, const char *);
+extern void			ni_fsm_policy_index_free(ni_fsm_t *);
 extern int			ni_fsm_policy_compare_weight(const ni_fsm_policy_t *, const ni_fsm_policy_t *);
 extern unsigned int		ni_fsm_policy_get_applicable_policies(const ni_fsm_t *, ni_ifworker_t *,
 						const ni_fsm_policy_t **, unsigned int);
@@ -324,6 +384,7 @@ extern void			ni_fsm_policy_array_init(ni_fsm_policy_array_t *);
 extern void			ni_fsm_policy_array_destroy(ni_fsm_policy_array_t *);
 extern void			ni_fsm_policy_array_sort(ni_fsm_policy_array_t *, ni_fsm_policy_compare_fn_t *);
 extern ni_bool_t		ni_fsm_policy_array_move(ni_fsm_policy_array_t *, ni_fsm_policy_array_t *);
+extern ni_bool_t		ni_fsm_policy_array_reserve(ni_fsm_policy_array_t *, unsigned int);
 extern ni_bool_t		ni_fsm_policy_array_append(ni_fsm_policy_array_t *, ni_fsm_policy_t *);
 extern ni_bool_t		ni_fsm_policy_array_insert(ni_fsm_policy_array_t *, unsigned int, ni_fsm_policy_t *);
 extern ni_bool_t		ni_fsm_policy_array_delete(ni_fsm_policy_array_t *, unsigned int);
@@ -337,10 +398,12 @@ extern ni_bool_t		ni_fsm_refresh_state(ni_fsm_t *);
 extern unsigned int		ni_fsm_schedule(ni_fsm_t *);
 extern ni_bool_t		ni_fsm_do(ni_fsm_t *, ni_timeout_t *);
 extern void			ni_fsm_mainloop(ni_fsm_t *);
+extern ni_bool_t		ni_fsm_timings_save(const ni_fsm_t *, const char *);
 extern void			ni_fsm_set_process_event_callback(ni_fsm_t *, void (*)(ni_fsm_t *, ni_ifworker_t *, ni_fsm_event_t *), void *);
 extern unsigned int		ni_fsm_get_matching_workers(ni_fsm_t *, ni_ifmatcher_t *, ni_ifworker_array_t *);
 extern unsigned int		ni_fsm_mark_matching_workers(ni_fsm_t *, ni_ifworker_array_t *, const ni_ifmarker_t *);
 extern unsigned int		ni_fsm_start_matching_workers(ni_fsm_t *, ni_ifworker_array_t *);
+extern unsigned int		ni_fsm_delete_devices(ni_fsm_t *, ni_ifworker_array_t *);
 extern void			ni_fsm_reset_matching_workers(ni_fsm_t *, ni_ifworker_array_t *, const ni_uint_range_t *, ni_bool_t);
 extern void			ni_fsm_print_config_hierarchy(const ni_fsm_t *);
 extern void			ni_fsm_print_system_hierarchy(const ni_fsm_t *);
@@ -348,6 +411,7 @@ extern int			ni_fsm_build_hierarchy(ni_fsm_t *, ni_bool_t);
 extern ni_ifworker_t *		ni_fsm_worker_identify(ni_fsm_t *, const xml_node_t *, const char *,
 							ni_ifworker_type_t *, const char **);
 extern ni_ifworker_t *		ni_fsm_workers_from_xml(ni_fsm_t *, xml_node_t *, const char *);
+extern unsigned int		ni_fsm_workers_from_xml_list(ni_fsm_t *, xml_node_t *, const char *);
 extern unsigned int		ni_fsm_fail_count(ni_fsm_t *);
 extern ni_ifworker_t *		ni_fsm_ifworker_by_object_path(ni_fsm_t *, const char *);
 extern ni_ifworker_t *		ni_fsm_ifworker_by_ifindex(ni_fsm_t *, unsigned int);
@@ -397,6 +461,7 @@ extern void			ni_ifworker_control_free(ni_ifworker_control_t *);
 extern ni_ifworker_array_t *	ni_ifworker_array_new(void);
 extern void			ni_ifworker_array_free(ni_ifworker_array_t *);
 extern ni_ifworker_array_t *	ni_ifworker_array_clone(ni_ifworker_array_t *);
+extern ni_bool_t		ni_ifworker_array_reserve(ni_ifworker_array_t *, unsigned int);
 extern void			ni_ifworker_array_append(ni_ifworker_array_t *, ni_ifworker_t *);
 extern ni_bool_t		ni_ifworker_array_remove_index(ni_ifworker_array_t *, unsigned int);
 extern ni_bool_t		ni_ifworker_array_remove(ni_ifworker_array_t *, ni_ifworker_t *);
@@ -53,6 +53,7 @@ struct ni_ipv6_devconf {
 	ni_tristate_t		accept_redirects;
 	int			accept_ra;
 	int			accept_dad;
+	ni_tristate_t		optimistic_dad;
 
 	int			addr_gen_mode;
 	struct in6_addr		stable_secret;
@@ -106,11 +107,12 @@ struct ni_ipv6_devinfo {
 	unsigned int		flags;
 
 	ni_ipv6_devconf_t	conf;
-	ni_ipv6_ra_info_t	radv;
+	ni_ipv6_ra_info_t *	radv;	/* on first RA info */
 };
 
 extern ni_bool_t		ni_ipv6_supported(void);
 extern ni_ipv6_devinfo_t *	ni_netdev_get_ipv6(ni_netdev_t *);
+extern ni_ipv6_ra_info_t *	ni_netdev_get_ipv6_ra_info(ni_netdev_t *);
 extern void			ni_netdev_set_ipv6(ni_netdev_t *, ni_ipv6_devconf_t *);
 extern ni_bool_t		ni_netdev_ipv6_is_ready(const ni_netdev_t *);
 extern ni_bool_t		ni_netdev_ipv6_ra_received(const ni_netdev_t *);
@@ -39,6 +39,8 @@ extern unsigned int	ni_log_level_get(void);
 extern ni_bool_t	ni_log_destination(const char *program, const char *destination);
 extern void		ni_log_reopen(void);
 extern void		ni_log_close(void);
+extern void		ni_log_flush(void);
+extern ni_bool_t	ni_log_ratelimit_set(const char *);
 
 enum {
 	NI_LOG_ERROR,
@@ -78,16 +80,32 @@ enum {
 
 extern unsigned int	ni_debug;
 extern unsigned int	ni_log_level;
+extern unsigned int	ni_log_ratelimit_burst;
+extern ni_bool_t	__ni_log_ratelimit(unsigned int facility);
 
 #define ni_log_level_at(level)			(ni_log_level >= (level))
 #define ni_log_facility(facility)		(ni_debug & (facility))
 
+/*
+ * Debug messages above the NI_LOG_DEBUG_MAX level are compiled out.
+ * The guard is checked before any message argument is evaluated;
+ * call sites preparing arguments in advance (e.g. formatting flags
+ * into a string buffer) have to check ni_debug_guard() first.
+ */
+#ifndef NI_LOG_DEBUG_MAX
+#define NI_LOG_DEBUG_MAX			NI_LOG_DEBUG3
+#endif
+
 #define ni_debug_guard(level, facility) \
-	(ni_log_level_at(level) && ni_log_facility(facility))
+	((level) <= NI_LOG_DEBUG_MAX && \
+	 __builtin_expect(ni_log_level_at(level) && ni_log_facility(facility), 0))
+
+#define ni_log_ratelimit(facility) \
+	(!ni_log_ratelimit_burst || __ni_log_ratelimit(facility))
 
 #define __ni_debug(level, facility, fmt, args...) \
 	do { \
-		if (ni_debug_guard(level, facility)) \
+		if (ni_debug_guard(level, facility) && ni_log_ratelimit(facility)) \
 			ni_trace(fmt, ##args); \
 	} while (0)
 
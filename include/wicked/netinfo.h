@@ -52,10 +52,16 @@ struct ni_linkinfo {
 
 struct ni_netdev {
 	ni_netdev_t *		next;
+	struct {
+		ni_netdev_t *	index_next;
+		ni_netdev_t *	name_next;
+		unsigned int	name_hash;
+	}			hash;
 	unsigned int		seq;
 	unsigned int		modified : 1,
 				deleted : 1,
-				created : 1;
+				created : 1,
+				pci_probed : 1;
 
 	char *			name;
 	ni_linkinfo_t		link;
@@ -65,6 +71,7 @@ struct ni_netdev {
 	unsigned int		users;
 
 	ni_address_t *		addrs;
+	ni_address_index_t *	addrs_index;
 	ni_route_table_t *	routes;
 
 	/* Network layer */
@@ -136,11 +143,15 @@ extern int		ni_server_enable_interface_nduseropt_events(void (*handler)(ni_netde
 extern int		ni_server_enable_route_events(void (*handler)(ni_netconfig_t *, ni_event_t, const ni_route_t *));
 extern int		ni_server_enable_rule_events(void (*handler)(ni_netconfig_t *, ni_event_t, const ni_rule_t *));
 extern int		ni_server_enable_interface_uevents(void);
+extern int		ni_server_enable_ethtool_events(void);
 extern void		ni_server_disable_interface_uevents(void);
 extern void		ni_server_trace_interface_addr_events(ni_netdev_t *, ni_event_t, const ni_address_t *);
 extern void		ni_server_trace_interface_prefix_events(ni_netdev_t *, ni_event_t, const ni_ipv6_ra_pinfo_t *);
 extern void		ni_server_trace_interface_nduseropt_events(ni_netdev_t *, ni_event_t);
 extern void		ni_server_trace_route_events(ni_netconfig_t *, ni_event_t, const ni_route_t *);
+
+typedef void		ni_addr_monitor_handler_t(unsigned int, ni_event_t, const ni_address_t *, void *);
+extern ni_socket_t *	ni_addr_monitor_open(unsigned int, ni_addr_monitor_handler_t *, void *);
 extern void		ni_server_trace_rule_events(ni_netconfig_t *, ni_event_t, const ni_rule_t *);
 extern void		ni_server_deactivate_interface_events(void);
 extern void		ni_server_deactivate_interface_uevents(void);
@@ -219,6 +230,7 @@ extern void		ni_netdev_set_ovs_bridge(ni_netdev_t *, ni_ovs_bridge_t *);
 extern void		ni_netdev_set_ethtool(ni_netdev_t *, ni_ethtool_t *);
 extern void		ni_netdev_set_ethernet(ni_netdev_t *, ni_ethernet_t *);
 extern void		ni_netdev_set_infiniband(ni_netdev_t *, ni_infiniband_t *);
+extern ni_link_stats_t *ni_netdev_get_link_stats(ni_netdev_t *);
 extern void		ni_netdev_set_link_stats(ni_netdev_t *, ni_link_stats_t *);
 extern void		ni_netdev_set_wireless(ni_netdev_t *, ni_wireless_t *);
 extern void		ni_netdev_set_openvpn(ni_netdev_t *, ni_openvpn_t *);
@@ -230,6 +242,7 @@ extern void		ni_netdev_set_ppp(ni_netdev_t *, ni_ppp_t *);
 extern void		ni_netdev_set_dcb(ni_netdev_t *, ni_dcb_t *);
 extern void		ni_netdev_set_lldp(ni_netdev_t *, ni_lldp_t *);
 extern void		ni_netdev_set_auto6(ni_netdev_t *, ni_auto6_t *);
+extern const ni_pci_dev_t *ni_netdev_get_pci(ni_netdev_t *);
 extern void		ni_netdev_set_pci(ni_netdev_t *, ni_pci_dev_t *);
 extern void		ni_netdev_set_client_state(ni_netdev_t *, ni_client_state_t *);
 extern ni_client_state_t *	ni_netdev_get_client_state(ni_netdev_t *);
@@ -238,6 +251,11 @@ extern void		ni_netdev_discover_client_state(ni_netdev_t *);
 extern ni_bool_t	ni_netdev_supports_arp(ni_netdev_t *);
 
 extern void             ni_netdev_clear_addresses(ni_netdev_t *);
+extern ni_address_t *	ni_netdev_find_address(ni_netdev_t *, const ni_sockaddr_t *);
+extern void		ni_netdev_append_address(ni_netdev_t *, ni_address_t *);
+extern void		ni_netdev_delete_address(ni_netdev_t *, ni_address_t *);
+extern void		ni_netdev_unindex_address(ni_netdev_t *, const ni_address_t *);
+extern void		ni_netdev_drop_address_index(ni_netdev_t *);
 extern void             ni_netdev_clear_routes(ni_netdev_t *);
 extern void		ni_netdev_clear_event_filters(ni_netdev_t *);
 extern void		ni_netdev_slaveinfo_destroy(ni_slaveinfo_t *);
@@ -23,6 +23,8 @@ extern void			ni_objectmodel_register_netif_service(ni_iftype_t, ni_dbus_service
 extern ni_dbus_server_t *	ni_objectmodel_create_service(void);
 extern ni_bool_t		ni_objectmodel_save_state(const char *);
 extern ni_bool_t		ni_objectmodel_recover_state(const char *, const char **);
+extern ni_bool_t		ni_objectmodel_save_handover(const char *);
+extern ni_bool_t		ni_objectmodel_recover_handover(const char *, const char **);
 
 extern dbus_bool_t		ni_objectmodel_create_initial_objects(ni_dbus_server_t *);
 extern ni_dbus_object_t *	ni_objectmodel_register_netif(ni_dbus_server_t *, ni_netdev_t *ifp,
@@ -69,6 +71,7 @@ extern ni_dbus_class_t *	ni_objectmodel_class_new(const char *, const ni_dbus_cl
 
 #define NI_OBJECTMODEL_INTERFACE		NI_OBJECTMODEL_NAMESPACE
 #define NI_OBJECTMODEL_NETIFLIST_INTERFACE	NI_OBJECTMODEL_INTERFACE ".InterfaceList"
+#define NI_OBJECTMODEL_STATS_INTERFACE		NI_OBJECTMODEL_INTERFACE ".Stats"
 #define NI_OBJECTMODEL_NETIF_INTERFACE		NI_OBJECTMODEL_INTERFACE ".Interface"
 #define NI_OBJECTMODEL_ETHTOOL_INTERFACE	NI_OBJECTMODEL_INTERFACE ".Ethtool"
 #define NI_OBJECTMODEL_ETHERNET_INTERFACE	NI_OBJECTMODEL_INTERFACE ".Ethernet"
@@ -61,6 +61,7 @@ struct ni_route {
 	unsigned int		mark;
 	unsigned int		tos;
 	ni_route_nexthop_t	nh;
+	unsigned int		nh_id;			/* RTA_NH_ID group */
 
 	unsigned int		table;			/* RT_TABLE_* */
 	unsigned int		type;			/* RTN_* */
@@ -86,11 +87,14 @@ struct ni_route {
 ni_declare_ptr_array_type(ni_route);
 ni_declare_ptr_array_cmp_fn(ni_route);
 
+typedef struct ni_route_index	ni_route_index_t;
+
 struct ni_route_table {
 	ni_route_table_t *	next;
 
 	unsigned int		tid;
 	ni_route_array_t	routes;
+	ni_route_index_t *	index;	/* prefix trie of the routes */
 };
 
 enum {
@@ -239,6 +243,7 @@ extern ni_route_array_t *	ni_route_array_new(void);
 extern void			ni_route_array_free(ni_route_array_t *);
 extern				ni_declare_ptr_array_init(ni_route);
 extern				ni_declare_ptr_array_destroy(ni_route);
+extern				ni_declare_ptr_array_reserve(ni_route);
 extern				ni_declare_ptr_array_append(ni_route);
 extern				ni_declare_ptr_array_delete_at(ni_route);
 extern				ni_declare_ptr_array_remove_at(ni_route);
@@ -258,6 +263,7 @@ extern void			ni_route_array_sort_rev(ni_route_array_t *);
 extern ni_route_table_t *	ni_route_table_new(unsigned int);
 extern void			ni_route_table_free(ni_route_table_t *);
 extern void			ni_route_table_clear(ni_route_table_t *);
+extern ni_route_t *		ni_route_table_remove_at(ni_route_table_t *, unsigned int);
 
 extern void			ni_route_tables_copy(ni_route_table_t **, const ni_route_table_t *);
 extern ni_bool_t		ni_route_tables_add_route(ni_route_table_t **, ni_route_t *);
@@ -267,6 +273,8 @@ extern ni_bool_t		ni_route_tables_del_route(ni_route_table_t *, ni_route_t *);
 
 extern ni_route_t *		ni_route_tables_find_match(ni_route_table_t *, const ni_route_t *,
 					ni_bool_t (*match)(const ni_route_t *, const ni_route_t *));
+extern ni_route_t *		ni_route_tables_find_prefix_match(ni_route_table_t *, const ni_route_t *,
+					ni_bool_t (*match)(const ni_route_t *, const ni_route_t *));
 extern unsigned int		ni_route_tables_find_matches(ni_route_table_t *, const ni_route_t *,
 					ni_bool_t (*match)(const ni_route_t *, const ni_route_t *),
 					ni_route_array_t *);
@@ -300,6 +308,7 @@ extern void			ni_rule_array_copy(ni_rule_array_t *, const ni_rule_array_t *);
 extern				ni_declare_ptr_array_init(ni_rule);
 extern				ni_declare_ptr_array_destroy(ni_rule);
 extern				ni_declare_ptr_array_index(ni_rule);
+extern				ni_declare_ptr_array_reserve(ni_rule);
 extern				ni_declare_ptr_array_append(ni_rule);
 extern				ni_declare_ptr_array_insert(ni_rule);
 extern				ni_declare_ptr_array_delete_at(ni_rule);
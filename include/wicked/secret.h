@@ -22,6 +22,8 @@ typedef struct ni_secret	ni_secret_t;
 struct ni_secret {
 	ni_secret_t **		prev;
 	ni_secret_t *		next;
+	ni_secret_t *		hnext;		/* next in the key hash bucket */
+	unsigned int		hkey;
 
 	unsigned int		refcount;
 	unsigned int		seq;		/* sequence no of last update */
@@ -37,10 +39,13 @@ typedef struct ni_secret_array {
 	ni_secret_t **		data;
 } ni_secret_array_t;
 
+#define NI_SECRET_DB_BUCKETS	64
+
 typedef struct ni_secret_db {
 	unsigned int		seq;
 
 	ni_secret_t *		list;
+	ni_secret_t *		hash[NI_SECRET_DB_BUCKETS];
 } ni_secret_db_t;
 
 extern ni_secret_db_t *	ni_secret_db_new(void);
@@ -49,6 +54,7 @@ extern ni_secret_t *	ni_secret_db_update(ni_secret_db_t *,
 					const ni_security_id_t *id, const char *path,
 					const char *value);
 extern ni_secret_t *	ni_secret_db_find(ni_secret_db_t *, const ni_security_id_t *id, const char *path);
+extern ni_secret_t *	ni_secret_db_request(ni_secret_db_t *, const ni_security_id_t *id, const char *path);
 extern void		ni_secret_db_drop(ni_secret_db_t *, const ni_security_id_t *id, const char *path);
 
 extern ni_secret_t *	ni_secret_new(const ni_security_id_t *id, const char *path);
@@ -13,8 +13,18 @@ typedef struct ni_sysconfig	ni_sysconfig_t;
 struct ni_sysconfig {
 	char *		pathname;
 	ni_var_array_t	vars;
+
+	struct ni_sysconfig_index *index;	/* lazy sorted name index	*/
 };
 
+/*
+ * Called with each variable with a non-empty value whose name starts
+ * with the prefix and the remaining name suffix.  Returning FALSE
+ * stops the enumeration.
+ */
+typedef ni_bool_t	ni_sysconfig_match_fn_t(const ni_sysconfig_t *, const ni_var_t *,
+				const char *suffix, void *user_data);
+
 extern int		ni_sysconfig_scandir(const char *, const char *,
 				struct ni_string_array *nsa);
 extern ni_sysconfig_t *	ni_sysconfig_new(const char *pathname);
@@ -42,6 +52,8 @@ extern ni_bool_t	ni_sysconfig_test_boolean(const ni_sysconfig_t *, const char *)
 
 extern int		ni_sysconfig_find_matching(const ni_sysconfig_t *, const char *,
 				struct ni_string_array *);
+extern int		ni_sysconfig_foreach_matching(const ni_sysconfig_t *, const char *prefix,
+				ni_sysconfig_match_fn_t *, void *user_data);
 
 
 #endif /* __WICKED_SYSCONFIG_H__ */
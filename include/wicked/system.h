@@ -18,6 +18,10 @@ extern int		ni_system_interface_link_monitor(ni_netdev_t *);
 extern int		ni_system_interface_stats_refresh(ni_netconfig_t *, ni_netdev_t *);
 extern int		ni_system_ipv4_setup(ni_netconfig_t *, ni_netdev_t *, const ni_ipv4_devconf_t *);
 extern int		ni_system_ipv6_setup(ni_netconfig_t *, ni_netdev_t *, const ni_ipv6_devconf_t *);
+extern ni_bool_t	ni_system_ipv6_setup_prepare(ni_netconfig_t *, ni_netdev_t *);
+extern ni_bool_t	ni_system_ipv6_setup_ready(const ni_netdev_t *);
+extern int		ni_system_ipv6_setup_finish(ni_netconfig_t *, ni_netdev_t *,
+				const ni_ipv6_devconf_t *, ni_bool_t);
 extern int		ni_system_mtu_change(ni_netconfig_t *, ni_netdev_t *,
 				unsigned int mtu);
 extern int		ni_system_hwaddr_change(ni_netconfig_t *, ni_netdev_t *,
@@ -28,21 +32,35 @@ extern int		ni_system_ethernet_setup(ni_netconfig_t *, ni_netdev_t *,
 				const ni_netdev_t *);
 extern int		ni_system_infiniband_setup(ni_netconfig_t *, ni_netdev_t *,
 				const ni_netdev_t *);
+typedef void		ni_system_infiniband_setup_done_t(void *, int);
+extern int		ni_system_infiniband_setup_async(ni_netconfig_t *, ni_netdev_t *,
+				const ni_netdev_t *, ni_system_infiniband_setup_done_t *,
+				void *);
 extern int		ni_system_infiniband_child_create(ni_netconfig_t *,
 				const ni_netdev_t *, ni_netdev_t **);
+extern int		ni_system_infiniband_child_create_batch(ni_netconfig_t *, unsigned int,
+				const ni_netdev_t **, ni_netdev_t **, int *);
 extern int		ni_system_infiniband_child_delete(ni_netdev_t *);
 extern int		ni_system_vlan_create(ni_netconfig_t *,
 				const ni_netdev_t *, ni_netdev_t **);
+extern int		ni_system_vlan_create_batch(ni_netconfig_t *, unsigned int,
+				const ni_netdev_t **, ni_netdev_t **, int *);
 extern int		ni_system_vlan_change(ni_netconfig_t *, ni_netdev_t *,
 				const ni_netdev_t *);
 extern int		ni_system_vlan_delete(ni_netdev_t *);
 extern int		ni_system_vxlan_create(ni_netconfig_t *,
 				const ni_netdev_t *, ni_netdev_t **);
+extern int		ni_system_vxlan_create_batch(ni_netconfig_t *, unsigned int,
+				const ni_netdev_t **, ni_netdev_t **, int *);
+extern int		ni_system_vxlan_fdb_update(ni_netconfig_t *, ni_netdev_t *,
+				const ni_vxlan_fdb_array_t *, ni_bool_t, int *);
 extern int		ni_system_vxlan_change(ni_netconfig_t *, ni_netdev_t *,
 				const ni_netdev_t *);
 extern int		ni_system_vxlan_delete(ni_netdev_t *);
 extern int		ni_system_macvlan_create(ni_netconfig_t *,
 				const ni_netdev_t *, ni_netdev_t **);
+extern int		ni_system_macvlan_create_batch(ni_netconfig_t *, unsigned int,
+				const ni_netdev_t **, ni_netdev_t **, int *);
 extern int		ni_system_macvlan_change(ni_netconfig_t *, ni_netdev_t *,
 				const ni_netdev_t *);
 extern int		ni_system_macvlan_delete(ni_netdev_t *);
@@ -57,6 +75,10 @@ extern int		ni_system_bridge_setup(ni_netconfig_t *, ni_netdev_t *,
 				const ni_bridge_t *);
 extern int		ni_system_bridge_add_port(ni_netconfig_t *, ni_netdev_t *,
 				const ni_bridge_port_t *);
+extern int		ni_system_bridge_add_ports(ni_netconfig_t *, ni_netdev_t *,
+				unsigned int, const ni_bridge_port_t **, int *);
+extern int		ni_system_bridge_update_ports(ni_netconfig_t *, ni_netdev_t *,
+				const ni_bridge_t *);
 extern int		ni_system_bridge_remove_port(ni_netdev_t *, unsigned int);
 extern int		ni_system_bridge_shutdown(ni_netdev_t *);
 extern int		ni_system_bridge_delete(ni_netconfig_t *, ni_netdev_t *);
@@ -82,6 +104,8 @@ extern int		ni_system_tap_change(ni_netconfig_t *, ni_netdev_t *, const ni_netde
 extern int		ni_system_tuntap_create(ni_netconfig_t *, const ni_netdev_t *,
 				ni_netdev_t **);
 extern int		ni_system_tuntap_delete(ni_netdev_t *);
+extern int		ni_system_interfaces_delete_batch(ni_netconfig_t *, unsigned int,
+				ni_netdev_t **, int *);
 extern int		ni_system_tap_create(ni_netconfig_t *, const char *,
 				ni_netdev_t **);
 extern int		ni_system_tap_delete(ni_netdev_t *);
@@ -36,6 +36,7 @@ typedef struct ni_rule		ni_rule_t;
 typedef struct ni_rule_array	ni_rule_array_t;
 typedef struct ni_vlan		ni_vlan_t;
 typedef struct ni_vxlan		ni_vxlan_t;
+typedef struct ni_vxlan_fdb_array	ni_vxlan_fdb_array_t;
 typedef struct ni_macvlan	ni_macvlan_t;
 typedef struct ni_bridge	ni_bridge_t;
 typedef struct ni_bridge_port	ni_bridge_port_t;
@@ -88,6 +89,7 @@ typedef struct ni_netdev_ref_array {
 
 typedef struct ni_dbus_server	ni_dbus_server_t;
 typedef struct ni_dbus_client	ni_dbus_client_t;
+typedef struct ni_dbus_deferred_reply	ni_dbus_deferred_reply_t;
 
 typedef struct ni_socket	ni_socket_t;
 typedef struct ni_socket_array	ni_socket_array_t;
@@ -26,6 +26,19 @@ typedef struct ni_intmap {
 	unsigned int	value;
 } ni_intmap_t;
 
+/*
+ * Hash index of a static map, built on first use; lookups return the
+ * first matching map entry as the linear ni_*_uint_mapped functions.
+ */
+typedef struct ni_intmap_index {
+	const ni_intmap_t *	map;
+	unsigned int		mask;
+	unsigned int *		names;		/* position + 1, 0 is unused	*/
+	unsigned int *		values;
+} ni_intmap_index_t;
+
+#define NI_INTMAP_INDEX_INIT(m)	{ .map = (m), .mask = 0, .names = NULL, .values = NULL }
+
 typedef struct ni_uint_arrray {
 	unsigned int	count;
 	unsigned int *	data;
@@ -54,6 +67,7 @@ struct ni_var_array {
 	ni_var_array_t *next;
 	unsigned int	count;
 	ni_var_t *	data;
+	struct ni_var_index *index;	/* lazy name lookup index	*/
 };
 
 #define NI_VAR_ARRAY_INIT	{ .count = 0, .data = NULL }
@@ -68,6 +82,17 @@ typedef struct ni_stringbuf {
 #define NI_STRINGBUF_INIT_BUFFER(buf)	{ .size = sizeof(buf), .len = 0, .string = buf, .dynamic = 0 }
 #define NI_STRINGBUF_INIT_DYNAMIC	{ .size = 0, .len = 0, .string = NULL, .dynamic = 1 }
 
+/*
+ * A non-owning, not NUL terminated view into a string owned elsewhere,
+ * e.g. a line buffer being tokenized without copying each token.
+ */
+typedef struct ni_slice {
+	const char *		data;
+	size_t			len;
+} ni_slice_t;
+
+#define NI_SLICE_INIT			{ .data = NULL, .len = 0 }
+
 typedef struct ni_opaque {
 	unsigned char	data[130];
 	size_t		len;
@@ -106,6 +131,14 @@ extern ni_bool_t	ni_bitfield_clearbit(ni_bitfield_t *, unsigned int);
 extern ni_bool_t	ni_bitfield_turnbit(ni_bitfield_t *, unsigned int, ni_bool_t);
 extern ni_bool_t	ni_bitfield_testbit(const ni_bitfield_t *, unsigned int);
 extern ni_bool_t	ni_bitfield_isset(const ni_bitfield_t *);
+extern unsigned int	ni_bitfield_count(const ni_bitfield_t *);
+extern unsigned int	ni_bitfield_next_set(const ni_bitfield_t *, unsigned int);
+extern ni_bool_t	ni_bitfield_copy(ni_bitfield_t *, const ni_bitfield_t *);
+extern ni_bool_t	ni_bitfield_or(ni_bitfield_t *, const ni_bitfield_t *);
+extern ni_bool_t	ni_bitfield_and(ni_bitfield_t *, const ni_bitfield_t *);
+extern ni_bool_t	ni_bitfield_andnot(ni_bitfield_t *, const ni_bitfield_t *);
+extern ni_bool_t	ni_bitfield_xor(ni_bitfield_t *, const ni_bitfield_t *);
+extern ni_bool_t	ni_bitfield_equal(const ni_bitfield_t *, const ni_bitfield_t *);
 extern ni_bool_t	ni_bitfield_parse(ni_bitfield_t *, const char *, unsigned int);
 extern ni_bool_t	ni_bitfield_format(const ni_bitfield_t *, char **, ni_bool_t);
 
@@ -119,6 +152,7 @@ extern void		ni_string_array_init(ni_string_array_t *);
 extern int		ni_string_array_copy(ni_string_array_t *dst, const ni_string_array_t *src);
 extern void		ni_string_array_move(ni_string_array_t *dst, ni_string_array_t *src);
 extern void		ni_string_array_destroy(ni_string_array_t *);
+extern ni_bool_t	ni_string_array_reserve(ni_string_array_t *, unsigned int);
 extern int		ni_string_array_append(ni_string_array_t *, const char *);
 extern int		ni_string_array_insert(ni_string_array_t *, unsigned int, const char *);
 extern int		ni_string_array_set(ni_string_array_t *, unsigned int, const char *);
@@ -139,6 +173,7 @@ extern int		ni_string_array_cmp(const ni_string_array_t *, const ni_string_array
 
 extern void		ni_uint_array_init(ni_uint_array_t *);
 extern void		ni_uint_array_destroy(ni_uint_array_t *);
+extern ni_bool_t	ni_uint_array_reserve(ni_uint_array_t *, unsigned int);
 extern ni_bool_t	ni_uint_array_append(ni_uint_array_t *, unsigned int);
 extern ni_bool_t	ni_uint_array_remove(ni_uint_array_t *, unsigned int);
 extern ni_bool_t	ni_uint_array_remove_at(ni_uint_array_t *, unsigned int);
@@ -170,6 +205,7 @@ extern void		ni_var_array_init(ni_var_array_t *);
 extern ni_bool_t	ni_var_array_remove_at(ni_var_array_t *, unsigned int);
 extern ni_bool_t	ni_var_array_remove(ni_var_array_t *, const char *);
 extern void		ni_var_array_destroy(ni_var_array_t *);
+extern ni_bool_t	ni_var_array_reserve(ni_var_array_t *, unsigned int);
 extern ni_bool_t	ni_var_array_copy(ni_var_array_t *, const ni_var_array_t *);
 extern ni_bool_t	ni_var_array_move(ni_var_array_t *, ni_var_array_t *);
 extern ni_bool_t	ni_var_array_insert(ni_var_array_t *, unsigned int, const char *, const char *);
@@ -220,12 +256,26 @@ extern void		ni_stringbuf_trim_tail(ni_stringbuf_t *, const char *);
 extern void		ni_stringbuf_trim_empty_lines(ni_stringbuf_t *);
 extern ni_bool_t	ni_stringbuf_empty(const ni_stringbuf_t *);
 extern const char *	ni_stringbuf_join(ni_stringbuf_t *, const ni_string_array_t *, const char *);
+extern ni_slice_t	ni_stringbuf_slice(const ni_stringbuf_t *);
+extern void		ni_stringbuf_put_slice(ni_stringbuf_t *, const ni_slice_t *);
+
+extern ni_slice_t	ni_slice_init(const char *, size_t);
+extern ni_slice_t	ni_slice_from_string(const char *);
+extern ni_bool_t	ni_slice_empty(const ni_slice_t *);
+extern ni_bool_t	ni_slice_token(ni_slice_t *, const char *, ni_slice_t *);
+extern void		ni_slice_trim(ni_slice_t *, const char *);
+extern ni_bool_t	ni_slice_eq(const ni_slice_t *, const char *);
+extern int		ni_slice_cmp(const ni_slice_t *, const ni_slice_t *);
+extern const char *	ni_slice_cstr(const ni_slice_t *, char *, size_t);
+extern char *		ni_slice_dup(char **, const ni_slice_t *);
+extern int		ni_slice_parse_uint(const ni_slice_t *, unsigned int *, int);
 
 extern ni_bool_t	ni_file_exists(const char *);
 extern ni_bool_t	ni_file_executable(const char *);
 extern ni_bool_t	ni_isdir(const char *);
 extern ni_bool_t	ni_isreg(const char *);
 extern ni_bool_t	ni_fs_is_read_only(const char *);
+extern ni_bool_t	ni_running_in_initrd(void);
 extern ni_bool_t	ni_file_exists_fmt(const char*, ...);
 extern const char *	ni_find_executable(const char **);
 extern const char *	ni_basename(const char *path);
@@ -240,6 +290,7 @@ extern int		ni_pidfile_write(const char *, unsigned int, pid_t);
 
 extern FILE *		ni_mkstemp(char **namep);
 extern int		ni_copy_file(FILE *, FILE *);
+extern int		ni_copy_file_path(const char *, const char *);
 extern int		ni_backup_file_to(const char *, const char *);
 extern int		ni_restore_file_from(const char *, const char *);
 extern FILE *		ni_file_open(const char *, const char *, unsigned int);
@@ -265,6 +316,10 @@ extern int		ni_parse_uint_maybe_mapped(const char *, const struct ni_intmap *, u
 
 extern const char *	ni_format_uint_mapped(unsigned int, const ni_intmap_t *);
 extern const char *	ni_format_uint_maybe_mapped(unsigned int, const ni_intmap_t *);
+extern int		ni_intmap_index_parse(ni_intmap_index_t *, const char *, unsigned int *);
+extern int		ni_intmap_index_parse_maybe(ni_intmap_index_t *, const char *, unsigned int *, int);
+extern const char *	ni_intmap_index_format(ni_intmap_index_t *, unsigned int);
+extern const char *	ni_intmap_index_format_maybe(ni_intmap_index_t *, unsigned int);
 extern const char *	ni_format_hex(const unsigned char *data, unsigned int data_len,
 				char *namebuf, size_t name_max);
 extern const char *	ni_print_hex(const unsigned char *data, unsigned int data_len);
@@ -455,6 +510,14 @@ extern ni_bool_t	ni_string_ishex(const char *);
 extern int		ni_string_remove_char(char *, int);
 extern void		ni_string_tolower(char *);
 extern void		ni_string_toupper(char *);
+extern unsigned int	ni_string_hash(const char *);
+extern unsigned int	ni_string_hash_len(const char *, size_t);
+
+extern const char *	ni_string_intern(const char *);
+extern const char *	ni_string_intern_lookup(const char *);
+extern const char *	ni_string_intern_ref(const char *);
+extern void		ni_string_intern_free(const char **);
+extern ni_bool_t	ni_string_intern_set(const char **, const char *);
 
 extern char *		ni_sprint_hex(const unsigned char *, size_t);
 extern const char *	ni_sprint_uint(unsigned int);
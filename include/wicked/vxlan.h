@@ -52,8 +52,30 @@ struct ni_vxlan {
 	ni_bool_t		gpe;
 };
 
+/*
+ * Forwarding database entry of a vxlan device: the remote vtep
+ * of a mac address, all-zeros for the flood list of the device.
+ */
+typedef struct ni_vxlan_fdb_entry {
+	ni_hwaddr_t		lladdr;
+	ni_sockaddr_t		dst;
+	uint32_t		vni;		/* 0: id of the device	*/
+	uint16_t		port;		/* 0: dst-port of device*/
+} ni_vxlan_fdb_entry_t;
+
+struct ni_vxlan_fdb_array {
+	unsigned int		count;
+	ni_vxlan_fdb_entry_t *	data;
+};
+
+#define NI_VXLAN_FDB_ARRAY_INIT	{ .count = 0, .data = NULL }
+
 extern ni_vxlan_t *	ni_vxlan_new(void);
 extern void		ni_vxlan_free(ni_vxlan_t *);
 extern const char *	ni_vxlan_validate(const ni_vxlan_t *, const ni_netdev_ref_t *);
 
+extern ni_bool_t	ni_vxlan_fdb_array_append(ni_vxlan_fdb_array_t *, const ni_vxlan_fdb_entry_t *);
+extern void		ni_vxlan_fdb_array_destroy(ni_vxlan_fdb_array_t *);
+extern const char *	ni_vxlan_fdb_entry_validate(const ni_vxlan_fdb_entry_t *);
+
 #endif /* WICKED_VXLAN_H */
@@ -416,7 +416,7 @@ extern void				ni_wireless_association_changed(unsigned int ifindex, ni_wireless
 extern const char *			ni_wireless_ssid_print_data(const unsigned char *data, size_t len, ni_stringbuf_t *out);
 extern const char *			ni_wireless_ssid_print(const ni_wireless_ssid_t *, ni_stringbuf_t *out);
 extern ni_bool_t			ni_wireless_ssid_parse(ni_wireless_ssid_t *, const char *);
-extern ni_bool_t			ni_wireless_ssid_eq(ni_wireless_ssid_t *, ni_wireless_ssid_t *);
+extern ni_bool_t			ni_wireless_ssid_eq(const ni_wireless_ssid_t *, const ni_wireless_ssid_t *);
 
 extern const char *			ni_wireless_mode_to_name(ni_wireless_mode_t);
 extern ni_bool_t			ni_wireless_name_to_mode(const char *, unsigned int *);
@@ -50,12 +50,27 @@ struct xml_location {
 	unsigned int		line;
 };
 
+/*
+ * Digests of the node subtree cached by xml_node_hash and
+ * xml_node_content_uuid; any node mutation drops the cached
+ * digests of the node and all of its parents.
+ */
+typedef struct xml_node_digest {
+	unsigned int		hash_algo;
+	unsigned int		hash_len;
+	unsigned char		hash[20];
+
+	unsigned int		uuid_version;
+	ni_uuid_t		uuid_ns;
+	ni_uuid_t		uuid;
+} xml_node_digest_t;
+
 struct xml_node {
 	struct xml_node *	next;
 	uint16_t		refcount;
 	uint16_t		final : 1;
 
-	char *			name;
+	const char *		name;		/* interned atom */
 	struct xml_node *	parent;
 
 	/* For now, we assume just a single blob of cdata */
@@ -65,6 +80,7 @@ struct xml_node {
 	struct xml_node *	children;
 
 	xml_location_t *	location;
+	xml_node_digest_t *	digest;
 };
 
 typedef struct xml_node_array	xml_node_array_t;
@@ -74,6 +90,9 @@ struct xml_node_array {
 };
 #define XML_NODE_ARRAY_INIT	{ 0, NULL }
 
+/* string length marking a NULL string in binary node trees */
+#define XML_BINARY_NULL		(~0U)
+
 extern xml_document_t *	xml_document_read(const char *);
 extern xml_document_t *	xml_document_scan(FILE *, const char *location);
 extern xml_document_t *	xml_document_from_buffer(ni_buffer_t *, const char *location);
@@ -81,6 +100,7 @@ extern xml_document_t *	xml_document_from_string(const char *, const char *locat
 extern int		xml_document_write(const xml_document_t *, const char *);
 extern int		xml_document_print(const xml_document_t *, FILE *fp);
 extern char *		xml_document_sprint(const xml_document_t *);
+extern int		xml_document_write_fd(const xml_document_t *, int);
 extern int		xml_document_hash(const xml_document_t *, ni_hashctx_algo_t, void *, size_t);
 extern int		xml_document_uuid(const xml_document_t *, unsigned int, const ni_uuid_t *, ni_uuid_t *);
 extern const char *	xml_document_dtd(const xml_document_t *);
@@ -91,6 +111,8 @@ extern void		xml_document_set_root(xml_document_t *, xml_node_t *);
 extern xml_node_t *	xml_document_take_root(xml_document_t *);
 extern void		xml_document_free(xml_document_t *);
 
+extern const char *	xml_name_intern(const char *);
+extern const char *	xml_name_lookup(const char *);
 extern xml_node_t *	xml_node_new(const char *ident, xml_node_t *);
 extern xml_node_t *	xml_node_new_element(const char *ident, xml_node_t *, const char *cdata);
 extern xml_node_t *	xml_node_new_element_int(const char *ident, xml_node_t *, int);
@@ -100,10 +122,15 @@ extern xml_node_t *	xml_node_new_element_uint64(const char *ident, xml_node_t *,
 extern xml_node_t *	xml_node_new_element_unique(const char *ident, xml_node_t *, const char *cdata);
 extern xml_node_t *	xml_node_clone(const xml_node_t *src, xml_node_t *parent);
 extern xml_node_t *	xml_node_clone_ref(xml_node_t *src);
+extern xml_node_t *	xml_node_unshare(xml_node_t *node);
 extern void		xml_node_merge(xml_node_t *, const xml_node_t *);
 extern void		xml_node_free(xml_node_t *);
+extern void		xml_node_touch(xml_node_t *);
 extern int		xml_node_print(const xml_node_t *, FILE *fp);
+extern int		xml_node_write_binary(const xml_node_t *, ni_stringbuf_t *);
+extern xml_node_t *	xml_node_read_binary(const void *, size_t, size_t *, const char *);
 extern char *		xml_node_sprint(const xml_node_t *);
+extern int		xml_node_write_fd(const xml_node_t *, int);
 extern int		xml_node_hash(const xml_node_t *, ni_hashctx_algo_t, void *md_buffer, size_t md_bufsz);
 extern int		xml_node_uuid(const xml_node_t *, unsigned int, const ni_uuid_t *, ni_uuid_t *);
 extern int		xml_node_content_uuid(const xml_node_t *, unsigned int, const ni_uuid_t *, ni_uuid_t *);
@@ -138,6 +165,7 @@ extern ni_bool_t	xml_node_delete_child_node(xml_node_t *, xml_node_t *);
 extern void		xml_node_detach(xml_node_t *);
 extern xml_node_t *	xml_node_find_parent(const xml_node_t *, const char *);
 extern void		xml_node_reparent(xml_node_t *parent, xml_node_t *child);
+extern void		xml_node_set_name(xml_node_t *, const char *);
 extern void		xml_node_add_child(xml_node_t *, xml_node_t *);
 extern xml_node_t *	xml_node_get_next_named(xml_node_t *, const char *, xml_node_t *);
 
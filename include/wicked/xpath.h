@@ -62,6 +62,9 @@ typedef struct xpath_result {
 
 extern xpath_enode_t *	xpath_expression_parse(const char *);
 extern void		xpath_expression_free(xpath_enode_t *);
+extern xpath_enode_t *	xpath_expression_get(const char *);
+extern xpath_enode_t *	xpath_expression_hold(xpath_enode_t *);
+extern void		xpath_expression_cache_flush(void);
 extern xpath_result_t *	xpath_expression_eval(const xpath_enode_t *, xml_node_t *);
 
 extern xpath_format_t *	xpath_format_parse(const char *);
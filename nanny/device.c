@@ -146,7 +146,7 @@ ni_managed_device_get_worker(const ni_managed_device_t *mdev)
 	return w;
 }
 
-char *
+const char *
 ni_managed_device_get_name(ni_managed_device_t *mdev)
 {
 	ni_ifworker_t *w;
@@ -292,6 +292,7 @@ ni_managed_device_up_done(ni_ifworker_t *w)
 		ni_error("%s: no managed device for worker %s", __func__, w->name);
 		return;
 	}
+	mgr->timings_dirty = mgr->fsm->timings;
 
 	if (w->failed) {
 		mdev->fail_count++;
@@ -387,6 +388,7 @@ ni_managed_device_up(ni_managed_device_t *mdev, const char *origin)
 	 * Inside the prompt callback, we record all secrets for tracking
 	 */
 	ni_secret_array_destroy(&mdev->secrets);
+	mdev->missing_secrets = FALSE;
 
 	previous_state = mdev->state;
 	mdev->state = NI_MANAGED_STATE_BINDING;
@@ -447,6 +449,7 @@ ni_managed_device_down_done(ni_ifworker_t *w)
 		ni_error("%s: no managed device for worker %s", __func__, w->name);
 		return;
 	}
+	mgr->timings_dirty = mgr->fsm->timings;
 
 	if (w->failed) {
 		mdev->fail_count++;
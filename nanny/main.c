@@ -17,6 +17,7 @@
 #include <getopt.h>
 #include <limits.h>
 #include <errno.h>
+#include <signal.h>
 #ifdef HAVE_SYSTEMD_SD_DAEMON_H
 #include <systemd/sd-daemon.h>
 #endif
@@ -33,6 +34,7 @@
 
 #include "client/ifconfig.h"
 #include "util_priv.h"
+#include "stats.h"
 #include "nanny.h"
 
 enum {
@@ -288,6 +290,7 @@ babysit(void)
 	}
 #endif
 
+	ni_stats_snapshot_enable(SIGUSR1);
 	while (!ni_caught_terminal_signal()) {
 		ni_timeout_t timeout = NI_TIMEOUT_INFINITE;
 
@@ -299,6 +302,14 @@ babysit(void)
 		} while (ni_nanny_recheck_do(mgr));
 #endif
 
+		if (mgr->timings_dirty) {
+			char path[PATH_MAX];
+
+			snprintf(path, sizeof(path), "%s/fsm-timings.json", ni_nanny_statedir());
+			ni_fsm_timings_save(mgr->fsm, path);
+			mgr->timings_dirty = FALSE;
+		}
+
 		if (ni_socket_wait(timeout) != 0)
 			ni_fatal("ni_socket_wait failed");
 	}
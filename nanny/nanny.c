@@ -25,6 +25,7 @@
 #include <wicked/socket.h>
 #include <wicked/objectmodel.h>
 #include <wicked/modem.h>
+#include <wicked/wireless.h>
 #include <wicked/dbus-service.h>
 #include <wicked/dbus-errors.h>
 #include <wicked/fsm.h>
@@ -211,19 +212,95 @@ ni_nanny_recheck(ni_nanny_t *mgr, ni_ifworker_t *w)
 	return count;
 }
 
+/*
+ * The recheck priority of a worker is the length of its lowerdev and
+ * masterdev chain: devices near the root of a dependency chain, which
+ * others are waiting for, are rechecked first. The chain walk is bound
+ * to not loop forever on a (broken) reference cycle.
+ */
+typedef struct ni_nanny_recheck_entry {
+	ni_ifworker_t *		w;
+	unsigned int		depth;
+	unsigned int		index;
+} ni_nanny_recheck_entry_t;
+
+#define NI_NANNY_RECHECK_MAX_DEPTH	64
+
+static unsigned int
+ni_nanny_recheck_depth(const ni_ifworker_t *w)
+{
+	const ni_ifworker_t *p;
+	unsigned int depth = 0;
+
+	for (p = w->lowerdev; p && depth < NI_NANNY_RECHECK_MAX_DEPTH; p = p->lowerdev)
+		depth++;
+	for (p = w->masterdev; p && depth < NI_NANNY_RECHECK_MAX_DEPTH; p = p->masterdev)
+		depth++;
+
+	return depth;
+}
+
+static int
+ni_nanny_recheck_entry_cmp(const void *a, const void *b)
+{
+	const ni_nanny_recheck_entry_t *ea = a;
+	const ni_nanny_recheck_entry_t *eb = b;
+
+	if (ea->depth != eb->depth)
+		return ea->depth < eb->depth ? -1 : 1;
+	return ea->index < eb->index ? -1 : ea->index > eb->index;
+}
+
+static inline ni_bool_t
+ni_nanny_recheck_ready(const ni_ifworker_t *w)
+{
+	return !w->dead && !w->pending && !w->kickstarted && !w->done && !w->failed;
+}
+
+/*
+ * Drain all scheduled devices in one batch: collect the devices ready
+ * for a recheck in one pass over the queue and recheck them in order
+ * of their priority (see above), in scheduling order otherwise.
+ */
 unsigned int
 ni_nanny_recheck_do(ni_nanny_t *mgr)
 {
-	unsigned int i, count = 0;
+	ni_nanny_recheck_entry_t *batch;
+	unsigned int i, n = 0, count = 0;
 	ni_fsm_t *fsm = mgr->fsm;
 
 	ni_assert(fsm);
 	for (i = 0; i < mgr->recheck.count; ++i) {
+		if (ni_nanny_recheck_ready(mgr->recheck.data[i]))
+			n++;
+	}
+	if (!n)
+		return 0;
+
+	batch = xcalloc(n, sizeof(*batch));
+	for (i = 0, n = 0; i < mgr->recheck.count; ++i) {
 		ni_ifworker_t *w = mgr->recheck.data[i];
 
-		if (!w->dead && !w->pending && !w->kickstarted && !w->done && !w->failed)
+		if (!ni_nanny_recheck_ready(w))
+			continue;
+
+		batch[n].w = ni_ifworker_get(w);
+		batch[n].depth = ni_nanny_recheck_depth(w);
+		batch[n].index = n;
+		n++;
+	}
+	qsort(batch, n, sizeof(*batch), ni_nanny_recheck_entry_cmp);
+
+	ni_debug_nanny("%s: recheck batch of %u scheduled devices", __func__, n);
+	for (i = 0; i < n; ++i) {
+		ni_ifworker_t *w = batch[i].w;
+
+		/* an earlier recheck in the batch may have changed it */
+		if (ni_nanny_recheck_ready(w))
 			count += ni_nanny_recheck(mgr, w);
+		ni_ifworker_release(w);
 	}
+	free(batch);
 
 	return count;
 }
@@ -486,6 +563,9 @@ ni_nanny_register_device(ni_nanny_t *mgr, ni_ifworker_t *w)
 	if (!mdev->object || !dev_class)
 		return;
 
+	/* radio disabled before the device appeared */
+	mdev->rfkill_blocked = ni_rfkill_disabled(ni_ifworker_get_rfkill_type(w));
+
 	for (match = mgr->enable; match; match = match->next) {
 		switch (match->type) {
 		case NI_NANNY_DEVMATCH_CLASS:
@@ -614,15 +694,22 @@ ni_nanny_prompt(const ni_fsm_prompt_t *p, xml_node_t *node, void *user_data)
 		goto done;
 	}
 
-	sec = ni_secret_db_find(user->secret_db, &w->security_id, path_buf.string);
-	if (sec == NULL) {
+	/* Record the secrets we're binding with, to recheck the device
+	 * as soon as all of them have been supplied. */
+	if (mdev->state == NI_MANAGED_STATE_BINDING)
+		sec = ni_secret_db_request(user->secret_db, &w->security_id, path_buf.string);
+	else
+		sec = ni_secret_db_find(user->secret_db, &w->security_id, path_buf.string);
+	if (sec && mdev->state == NI_MANAGED_STATE_BINDING)
+		ni_secret_array_append(&mdev->secrets, sec);
+
+	if (sec == NULL || sec->value == NULL) {
 		if (mdev->state == NI_MANAGED_STATE_BINDING) {
 			mdev->missing_secrets = TRUE;
 
 			/* Return retry-operation - this makes the validator ignore
 			 * the missing secret. In this way, we can record all required
 			 * secrets. */
-			ni_secret_array_append(&mdev->secrets, sec);
 			rv = -NI_ERROR_RETRY_OPERATION;
 			goto done;
 		}
@@ -659,8 +746,12 @@ ni_nanny_add_secret(ni_nanny_t *mgr, uid_t caller_uid,
 	ni_secret_db_update(user->secret_db, security_id, path, value);
 
 	ni_debug_nanny("%s: secret for %s updated", ni_security_id_print(security_id), path);
+
+	/* Every device waiting for secrets proceeds on its own once it has
+	 * all of them, rather than one after another. */
 	for (mdev = mgr->device_list; mdev; mdev = mdev->next) {
 		const char *name = ni_managed_device_get_name(mdev);
+		ni_ifworker_t *w;
 
 		if (mdev->missing_secrets) {
 			ni_secret_t *missing = NULL;
@@ -678,6 +769,9 @@ ni_nanny_add_secret(ni_nanny_t *mgr, uid_t caller_uid,
 			}
 
 			ni_debug_nanny("%s: secret for %s updated, rechecking", name ? name : "anon", path);
+			mdev->missing_secrets = FALSE;
+			if ((w = ni_managed_device_get_worker(mdev)))
+				ni_nanny_schedule_recheck(&mgr->recheck, w);
 		}
 	}
 }
@@ -98,6 +98,7 @@ struct ni_nanny {
 	unsigned int		last_policy_seq;
 	ni_ifworker_array_t	recheck;
 	ni_ifworker_array_t	down;
+	ni_bool_t		timings_dirty;
 
 	ni_nanny_user_t *	users;
 
@@ -146,7 +147,7 @@ extern void			ni_managed_modem_up(ni_managed_device_t *, unsigned int);
 extern ni_managed_device_t *	ni_managed_device_new(ni_nanny_t *, unsigned int, ni_managed_device_t **list);
 extern void			ni_managed_device_free(ni_managed_device_t *);
 extern ni_ifworker_t *		ni_managed_device_get_worker(const ni_managed_device_t *);
-extern char *			ni_managed_device_get_name(ni_managed_device_t *);
+extern const char *		ni_managed_device_get_name(ni_managed_device_t *);
 extern int			ni_factory_device_apply_policy(ni_fsm_t *, ni_ifworker_t *, ni_managed_policy_t *);
 extern int			ni_managed_device_apply_policy(ni_managed_device_t *mdev, ni_managed_policy_t *mpolicy);
 extern void			ni_managed_device_set_policy(ni_managed_device_t *, ni_managed_policy_t *, xml_node_t *);
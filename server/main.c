@@ -19,6 +19,7 @@
 #include <getopt.h>
 #include <limits.h>
 #include <errno.h>
+#include <signal.h>
 #ifdef HAVE_SYSTEMD_SD_DAEMON_H
 #include <systemd/sd-daemon.h>
 #endif
@@ -35,6 +36,9 @@
 #include "udev-utils.h"
 #include "addrconf.h"
 #include "auto6.h"
+#include "stats.h"
+#include "worker.h"
+#include "client/client_state.h"
 
 enum {
 	OPT_HELP,
@@ -90,6 +94,7 @@ static ni_dbus_server_t *dbus_server;
 static void		run_interface_server(void);
 static void		discover_state(ni_dbus_server_t *);
 static void		recover_state(const char *filename);
+static void		recover_handover(void);
 static void		handle_interface_event(ni_netdev_t *, ni_event_t);
 static void		handle_interface_addr_events(ni_netdev_t *, ni_event_t, const ni_address_t *);
 static void		handle_interface_prefix_events(ni_netdev_t *, ni_event_t, const ni_ipv6_ra_pinfo_t *);
@@ -263,6 +268,9 @@ run_interface_server(void)
 		ni_server_disable_interface_uevents();
 	}
 
+	if (ni_server_enable_ethtool_events() < 0)
+		ni_info("ethtool netlink monitor not available, polling ethtool settings");
+
 	ni_rfkill_open(handle_rfkill_event, NULL);
 
 	/* Listen for other events, such as RESOLVER_UPDATED */
@@ -278,10 +286,16 @@ run_interface_server(void)
 			ni_fatal("unable to background server");
 	}
 
+	/* after the fork: the threads are not inherited by the child */
+	if (!ni_worker_pool_start(NI_WORKER_THREADS))
+		ni_info("worker threads not available, running blocking calls inline");
+
 	discover_state(dbus_server);
 
 	if (opt_recover_state)
 		recover_state(opt_state_file);
+	else
+		recover_handover();
 
 #ifdef HAVE_SYSTEMD_SD_DAEMON_H
 	if (opt_systemd) {
@@ -289,6 +303,7 @@ run_interface_server(void)
 	}
 #endif
 
+	ni_stats_snapshot_enable(SIGUSR1);
 	while (!ni_caught_terminal_signal()) {
 		ni_timeout_t timeout;
 
@@ -299,10 +314,15 @@ run_interface_server(void)
 		if (ni_socket_wait(timeout) != 0)
 			ni_fatal("ni_socket_wait failed");
 	}
+	ni_worker_pool_stop();
 
 	if (opt_recover_state)
 		ni_objectmodel_save_state(opt_state_file);
+	else
+		ni_objectmodel_save_handover("state");
 
+	ni_addrconf_lease_file_flush();
+	ni_client_state_flush();
 	exit(0);
 }
 
@@ -388,6 +408,22 @@ recover_state(const char *filename)
 	/* FIXME: update resolver etc. */
 }
 
+/*
+ * Take over the lease information left by the initrd instance once,
+ * so the leases applied there are not seen as unrequested ones.
+ */
+void
+recover_handover(void)
+{
+	const char *prefix_list[] = {
+		NI_OBJECTMODEL_ADDRCONF_INTERFACE,
+		NULL
+	};
+
+	if (ni_objectmodel_recover_handover("state", prefix_list))
+		ni_info("took over the address configuration state of the initrd");
+}
+
 /*
  * Handle network layer events for interface server.
  * FIXME: There should be some locking here, which prevents us from
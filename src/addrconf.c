@@ -39,6 +39,7 @@
 #include "netinfo_priv.h"
 #include "dhcp6/options.h"
 #include "dhcp.h"
+#include "stats.h"
 
 #include <stdlib.h>
 #include <sys/time.h>
@@ -56,6 +57,7 @@ ni_addrconf_lease_init(ni_addrconf_lease_t *lease, int type, int family)
 		lease->type = type;
 		lease->family = family;
 		lease->update = ni_config_addrconf_update_mask(lease->type, lease->family);
+		ni_stats_object_alloc(NI_STATS_OBJECT_LEASE, sizeof(*lease));
 		return TRUE;
 	}
 	return FALSE;
@@ -206,6 +208,7 @@ ni_addrconf_lease_dhcp6_destroy(struct ni_addrconf_lease_dhcp6 *dhcp6)
 void
 ni_addrconf_lease_destroy(ni_addrconf_lease_t *lease)
 {
+	ni_stats_object_free(NI_STATS_OBJECT_LEASE, sizeof(*lease));
 	ni_addrconf_updater_free(&lease->updater);
 	if (lease->old) {
 		ni_addrconf_lease_free(lease->old);
@@ -803,3 +806,85 @@ ni_addrconf_updater_free(ni_addrconf_updater_t **updater)
 	}
 }
 
+
+/*
+ * A token bucket in its virtual scheduling form: each call reserves
+ * the next slot of 1/rate seconds after the theoretical arrival time
+ * and the first burst calls are not delayed.
+ */
+static ni_timeout_t
+ni_addrconf_rate_slot(struct timeval *tat, unsigned int rate, unsigned int burst)
+{
+	ni_timeout_t interval, allowance, left, delay = 0;
+	struct timeval now;
+
+	if (!rate)
+		return 0;
+
+	interval = max_t(ni_timeout_t, 1000 / rate, 1);
+	allowance = burst ? (burst - 1) * interval : 0;
+
+	ni_timer_get_time(&now);
+	if (!timerisset(tat) || timercmp(tat, &now, <))
+		*tat = now;
+
+	left = ni_timeout_left(tat, &now, NULL);
+	if (left > allowance)
+		delay = left - allowance;
+
+	ni_timeval_add_timeout(tat, interval);
+	return delay;
+}
+
+/*
+ * Rate limit of the lease acquisitions started by a supplicant.
+ *
+ * Each start reserves the next slot and a random jitter is added
+ * to spread the starts in a slot.
+ */
+static struct timeval		ni_addrconf_start_tat;
+
+ni_timeout_t
+ni_addrconf_start_slot(void)
+{
+	const ni_config_start_rate_t *conf = ni_config_addrconf_start_rate();
+	ni_int_range_t jitter = { .min = 0, .max = conf->jitter };
+	ni_timeout_t delay;
+
+	delay = ni_addrconf_rate_slot(&ni_addrconf_start_tat, conf->rate, conf->burst);
+	return ni_timeout_randomize(delay, &jitter);
+}
+
+/*
+ * Rate limit of the lease renewals of a supplicant, e.g. to not
+ * overload the server when the renewals of hundreds of interfaces
+ * are due at once after a long outage.
+ */
+static struct timeval		ni_addrconf_renew_tat;
+
+ni_timeout_t
+ni_addrconf_renew_slot(void)
+{
+	const ni_config_renew_rate_t *conf = ni_config_addrconf_renew_rate();
+
+	return ni_addrconf_rate_slot(&ni_addrconf_renew_tat, conf->rate, conf->burst);
+}
+
+/*
+ * Align a renewal due in given seconds to the start of its window,
+ * so renewals of leases from the same server with about the same
+ * renewal time are coalesced into one burst instead of one wakeup
+ * per lease. The renewal happens at most window seconds earlier.
+ */
+unsigned int
+ni_addrconf_renew_align(unsigned int sec)
+{
+	const ni_config_renew_rate_t *conf = ni_config_addrconf_renew_rate();
+	struct timeval now;
+
+	if (!conf->window || sec <= conf->window || sec == NI_LIFETIME_INFINITE)
+		return sec;
+
+	ni_timer_get_time(&now);
+	return sec - ((now.tv_sec + sec) % conf->window);
+}
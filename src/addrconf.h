@@ -67,6 +67,10 @@ extern void			ni_addrconf_updater_set_data(ni_addrconf_updater_t *, void *, ni_a
 extern void *			ni_addrconf_updater_get_data(ni_addrconf_updater_t *, ni_addrconf_updater_cleanup_t *);
 extern void			ni_addrconf_updater_free(ni_addrconf_updater_t **);
 
+extern ni_timeout_t		ni_addrconf_start_slot(void);
+extern ni_timeout_t		ni_addrconf_renew_slot(void);
+extern unsigned int		ni_addrconf_renew_align(unsigned int);
+
 extern int			ni_addrconf_action_mtu_apply(ni_netdev_t *, ni_addrconf_lease_t *);
 extern int			ni_addrconf_action_addrs_apply(ni_netdev_t *, ni_addrconf_lease_t *);
 extern int			ni_addrconf_action_addrs_verify(ni_netdev_t *, ni_addrconf_lease_t *);
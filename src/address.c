@@ -33,11 +33,14 @@
 #include "refcount_priv.h"
 #include "slist_priv.h"
 #include "util_priv.h"
+#include "array_priv.h"
+#include "stats.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <limits.h>
 #include <ctype.h>
+#include <endian.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netinet/if_ether.h>
@@ -67,6 +70,7 @@ ni_address_init(ni_address_t *ap)
 		memset(ap, 0, sizeof(*ap));
 		ap->cache_info.valid_lft = NI_LIFETIME_INFINITE;
 		ap->cache_info.preferred_lft = NI_LIFETIME_INFINITE;
+		ni_stats_object_alloc(NI_STATS_OBJECT_ADDRESS, sizeof(*ap));
 		return TRUE;
 	}
 	return FALSE;
@@ -76,6 +80,7 @@ static inline void
 ni_address_destroy(ni_address_t *ap)
 {
 	ni_string_free(&ap->label);
+	ni_stats_object_free(NI_STATS_OBJECT_ADDRESS, sizeof(*ap));
 }
 
 extern ni_define_refcounted_new(ni_address);
@@ -124,7 +129,7 @@ ni_address_copy(ni_address_t *dst, const ni_address_t *src)
 		dst->bcast_addr	= src->bcast_addr;
 		dst->anycast_addr    = src->anycast_addr;
 		dst->cache_info = src->cache_info;
-		ni_string_dup(&dst->label, src->label);
+		return ni_string_dup(&dst->label, src->label);
 	}
 	return FALSE;
 }
@@ -295,6 +300,12 @@ ni_address_is_tentative(const ni_address_t *laddr)
 	return laddr->flags & IFA_F_TENTATIVE ? TRUE : FALSE;
 }
 
+ni_bool_t
+ni_address_is_optimistic(const ni_address_t *laddr)
+{
+	return laddr->flags & IFA_F_OPTIMISTIC ? TRUE : FALSE;
+}
+
 ni_bool_t
 ni_address_is_duplicate(const ni_address_t *laddr)
 {
@@ -473,6 +484,215 @@ ni_address_list_find(ni_address_t *list, const ni_sockaddr_t *addr)
 	return NULL;
 }
 
+/*
+ * Hash index of an address list by the local address (family and data),
+ * holding the list entries without a reference in an open addressed table
+ * with linear probing and backward shift deletion. Probing preserves the
+ * insert order of equal keys, so a lookup finds the first list entry as
+ * ni_address_list_find does. The list owner keeps it in sync.
+ */
+#define NI_ADDRESS_INDEX_MIN_SIZE	64
+
+typedef struct ni_address_index_slot {
+	unsigned int		hash;
+	ni_address_t *		ap;
+} ni_address_index_slot_t;
+
+struct ni_address_index {
+	unsigned int		count;
+	unsigned int		mask;
+	ni_address_index_slot_t *slots;
+};
+
+static void
+ni_address_index_slot_set(ni_address_index_t *index, unsigned int hash, ni_address_t *ap)
+{
+	unsigned int i = hash & index->mask;
+
+	while (index->slots[i].ap)
+		i = (i + 1) & index->mask;
+	index->slots[i].hash = hash;
+	index->slots[i].ap = ap;
+}
+
+static void
+ni_address_index_resize(ni_address_index_t *index, unsigned int size)
+{
+	ni_address_index_slot_t *slots = index->slots;
+	unsigned int i, old = slots ? index->mask + 1 : 0;
+
+	index->mask = size - 1;
+	index->slots = xcalloc(size, sizeof(ni_address_index_slot_t));
+	for (i = 0; i < old; ++i) {
+		if (slots[i].ap)
+			ni_address_index_slot_set(index, slots[i].hash, slots[i].ap);
+	}
+	free(slots);
+}
+
+ni_address_index_t *
+ni_address_index_new(const ni_address_t *list)
+{
+	ni_address_index_t *index;
+	unsigned int count, size;
+	const ni_address_t *ap;
+
+	for (count = 0, ap = list; ap; ap = ap->next)
+		count++;
+
+	/* keep the table at most half full */
+	for (size = NI_ADDRESS_INDEX_MIN_SIZE; size < count * 2; size <<= 1)
+		;
+
+	index = xcalloc(1, sizeof(*index));
+	ni_address_index_resize(index, size);
+	for (ap = list; ap; ap = ap->next)
+		ni_address_index_insert(index, (ni_address_t *)ap);
+	return index;
+}
+
+void
+ni_address_index_free(ni_address_index_t *index)
+{
+	if (index) {
+		free(index->slots);
+		free(index);
+	}
+}
+
+void
+ni_address_index_insert(ni_address_index_t *index, ni_address_t *ap)
+{
+	if (!index || !ap)
+		return;
+
+	if ((index->count + 1) * 2 > index->mask + 1)
+		ni_address_index_resize(index, (index->mask + 1) << 1);
+
+	ni_address_index_slot_set(index, ni_sockaddr_hash(&ap->local_addr), ap);
+	index->count++;
+}
+
+ni_bool_t
+ni_address_index_remove(ni_address_index_t *index, const ni_address_t *ap)
+{
+	unsigned int i, j, k;
+
+	if (!index || !ap)
+		return FALSE;
+
+	i = ni_sockaddr_hash(&ap->local_addr) & index->mask;
+	for ( ; index->slots[i].ap != ap; i = (i + 1) & index->mask) {
+		if (!index->slots[i].ap)
+			return FALSE;
+	}
+
+	/* shift back the following entries, which would not be found */
+	for (j = (i + 1) & index->mask; index->slots[j].ap; j = (j + 1) & index->mask) {
+		k = index->slots[j].hash & index->mask;
+		if (((j - k) & index->mask) >= ((j - i) & index->mask)) {
+			index->slots[i] = index->slots[j];
+			i = j;
+		}
+	}
+	index->slots[i].ap = NULL;
+	index->count--;
+	return TRUE;
+}
+
+ni_address_t *
+ni_address_index_find(const ni_address_index_t *index, const ni_sockaddr_t *addr)
+{
+	unsigned int i, hash;
+
+	if (!index || !addr)
+		return NULL;
+
+	hash = ni_sockaddr_hash(addr);
+	i = hash & index->mask;
+	for ( ; index->slots[i].ap; i = (i + 1) & index->mask) {
+		/* compare the cached hash first */
+		if (index->slots[i].hash == hash &&
+		    ni_sockaddr_equal(&index->slots[i].ap->local_addr, addr))
+			return index->slots[i].ap;
+	}
+	return NULL;
+}
+
+/*
+ * Sort-merge match of two address lists in O(N log N): sets match[i] to
+ * the first address (in list order) of the list b, which compares equal
+ * to the i-th address of the list a, or to NULL when there is none.
+ * Returns the number of matched addresses in a.
+ */
+typedef struct ni_address_merge_entry {
+	ni_address_t *		ap;
+	unsigned int		pos;
+} ni_address_merge_entry_t;
+
+static int
+ni_address_merge_entry_cmp(const void *p1, const void *p2, void *arg)
+{
+	const ni_address_merge_entry_t *e1 = p1, *e2 = p2;
+	ni_address_cmp_fn_t *cmp = arg;
+	int ret;
+
+	if ((ret = cmp(e1->ap, e2->ap)))
+		return ret;
+	return e1->pos > e2->pos ? 1 : e1->pos < e2->pos ? -1 : 0;
+}
+
+static ni_address_merge_entry_t *
+ni_address_merge_entries(const ni_address_t *list, unsigned int count, ni_address_cmp_fn_t *cmp)
+{
+	ni_address_merge_entry_t *entries;
+	unsigned int i;
+
+	entries = xcalloc(count ?: 1, sizeof(*entries));
+	for (i = 0; list && i < count; list = list->next, ++i) {
+		entries[i].ap = (ni_address_t *)list;
+		entries[i].pos = i;
+	}
+	qsort_r(entries, count, sizeof(*entries), ni_address_merge_entry_cmp, cmp);
+	return entries;
+}
+
+unsigned int
+ni_address_list_merge_match(const ni_address_t *a, const ni_address_t *b,
+		ni_address_cmp_fn_t *cmp, ni_address_t **match)
+{
+	ni_address_merge_entry_t *ea, *eb;
+	unsigned int na, nb, i, j, n = 0;
+	int ret;
+
+	if (!cmp || !match)
+		return 0;
+
+	na = ni_address_list_count(a);
+	nb = ni_address_list_count(b);
+	for (i = 0; i < na; ++i)
+		match[i] = NULL;
+	if (!na || !nb)
+		return 0;
+
+	ea = ni_address_merge_entries(a, na, cmp);
+	eb = ni_address_merge_entries(b, nb, cmp);
+	for (i = j = 0; i < na && j < nb; ) {
+		if ((ret = cmp(ea[i].ap, eb[j].ap)) > 0) {
+			j++;
+		} else {
+			if (ret == 0) {
+				match[ea[i].pos] = eb[j].ap;
+				n++;
+			}
+			i++;
+		}
+	}
+	free(ea);
+	free(eb);
+	return n;
+}
+
 void
 ni_address_array_init(ni_address_array_t *array)
 {
@@ -492,36 +712,20 @@ ni_address_array_destroy(ni_address_array_t *array)
 	}
 }
 
-static ni_bool_t
-ni_address_array_realloc(ni_address_array_t *array, unsigned int newlen)
+ni_bool_t
+ni_address_array_reserve(ni_address_array_t *array, unsigned int count)
 {
-	ni_address_t ** newdata;
-	size_t          newsize;
-	unsigned int    i;
-
-	if (!array || (UINT_MAX - NI_ADDRESS_ARRAY_CHUNK) <= newlen)
-		return FALSE;
-
-	newlen += NI_ADDRESS_ARRAY_CHUNK;
-	newsize = newlen * sizeof(ni_address_t *);
-	newdata = xrealloc(array->data, newsize);
-	if (!newdata)
+	if (!array || (UINT_MAX - array->count) < count)
 		return FALSE;
 
-	array->data = newdata;
-	for (i = array->count; i < newlen; ++i)
-		array->data[i] = NULL;
-	return TRUE;
+	return ni_array_grow((void **)&array->data, sizeof(ni_address_t *), array->count,
+				array->count + count, NI_ADDRESS_ARRAY_CHUNK);
 }
 
 ni_bool_t
 ni_address_array_append(ni_address_array_t *array, ni_address_t *ap)
 {
-	if (!array)
-		return FALSE;
-
-	if ((array->count % NI_ADDRESS_ARRAY_CHUNK) == 0 &&
-	    !ni_address_array_realloc(array, array->count))
+	if (!ni_address_array_reserve(array, 1))
 		return FALSE;
 
 	array->data[array->count++] = ap;
@@ -918,11 +1122,72 @@ __ni_sockaddr_data(const ni_sockaddr_t *ss, unsigned int *len)
 	return ((const unsigned char *) ss) + offset;
 }
 
+/*
+ * Family specialized fast paths of the compare functions: an IPv4
+ * address is one and an IPv6 address two words in network byte order.
+ */
+static inline void
+ni_sockaddr_ipv6_words(const ni_sockaddr_t *ss, uint64_t w[2])
+{
+	memcpy(w, ss->six.sin6_addr.s6_addr, 2 * sizeof(uint64_t));
+}
+
+static inline int
+ni_sockaddr_word_cmp(uint64_t w1, uint64_t w2)
+{
+	w1 = be64toh(w1);
+	w2 = be64toh(w2);
+	return w1 > w2 ? 1 : w1 < w2 ? -1 : 0;
+}
+
+static inline uint64_t
+ni_sockaddr_word_mask(unsigned int bits)
+{
+	return bits >= 64 ? ~(uint64_t)0 : bits ? htobe64(~(uint64_t)0 << (64 - bits)) : 0;
+}
+
+static inline unsigned int
+ni_sockaddr_mix(uint64_t v)
+{
+	v ^= v >> 33;
+	v *= 0xff51afd7ed558ccdULL;
+	v ^= v >> 33;
+	return (unsigned int)v;
+}
+
+/*
+ * Hash of the address family and data, as used by the address index
+ */
+unsigned int
+ni_sockaddr_hash(const ni_sockaddr_t *ss)
+{
+	const unsigned char *data;
+	unsigned int len;
+	uint64_t w[2];
+
+	if (!ss)
+		return 0;
+
+	switch (ss->ss_family) {
+	case AF_INET:
+		return ni_sockaddr_mix(((uint64_t)AF_INET << 32) | ss->sin.sin_addr.s_addr);
+	case AF_INET6:
+		ni_sockaddr_ipv6_words(ss, w);
+		return ni_sockaddr_mix(w[0] ^ ni_sockaddr_mix(w[1]) ^ AF_INET6);
+	default:
+		if (!(data = __ni_sockaddr_data(ss, &len)))
+			return 0;
+		return ni_string_hash_len((const char *)data, len) ^
+			((unsigned int)ss->ss_family * 2654435761U);
+	}
+}
+
 int
 ni_sockaddr_compare(const ni_sockaddr_t *ss1, const ni_sockaddr_t *ss2)
 {
 	const unsigned char *ap1, *ap2;
 	unsigned int len1, len2;
+	uint64_t w1[2], w2[2];
 
 	if (!ss1 || !ss2)
 		return ss1 > ss2 ? 1 : ss1 < ss2 ? -1 : 0;
@@ -930,8 +1195,22 @@ ni_sockaddr_compare(const ni_sockaddr_t *ss1, const ni_sockaddr_t *ss2)
 	if (ss1->ss_family != ss2->ss_family)
 		return ss1->ss_family - ss2->ss_family;
 
-	if (ss1->ss_family == AF_UNSPEC)
+	switch (ss1->ss_family) {
+	case AF_UNSPEC:
 		return 0;
+	case AF_INET:
+		len1 = ntohl(ss1->sin.sin_addr.s_addr);
+		len2 = ntohl(ss2->sin.sin_addr.s_addr);
+		return len1 > len2 ? 1 : len1 < len2 ? -1 : 0;
+	case AF_INET6:
+		ni_sockaddr_ipv6_words(ss1, w1);
+		ni_sockaddr_ipv6_words(ss2, w2);
+		if (w1[0] != w2[0])
+			return ni_sockaddr_word_cmp(w1[0], w2[0]);
+		return ni_sockaddr_word_cmp(w1[1], w2[1]);
+	default:
+		break;
+	}
 
 	ap1 = __ni_sockaddr_data(ss1, &len1);
 	ap2 = __ni_sockaddr_data(ss2, &len2);
@@ -952,11 +1231,23 @@ ni_sockaddr_equal(const ni_sockaddr_t *ss1, const ni_sockaddr_t *ss2)
 {
 	const unsigned char *ap1, *ap2;
 	unsigned int len;
+	uint64_t w1[2], w2[2];
 
 	if (ss1->ss_family != ss2->ss_family)
 		return FALSE;
-	if (ss1->ss_family == AF_UNSPEC)
+
+	switch (ss1->ss_family) {
+	case AF_UNSPEC:
 		return TRUE;
+	case AF_INET:
+		return ss1->sin.sin_addr.s_addr == ss2->sin.sin_addr.s_addr;
+	case AF_INET6:
+		ni_sockaddr_ipv6_words(ss1, w1);
+		ni_sockaddr_ipv6_words(ss2, w2);
+		return w1[0] == w2[0] && w1[1] == w2[1];
+	default:
+		break;
+	}
 
 	ap1 = __ni_sockaddr_data(ss1, &len);
 	ap2 = __ni_sockaddr_data(ss2, &len);
@@ -973,10 +1264,31 @@ ni_sockaddr_prefix_match(unsigned int prefix_bits, const ni_sockaddr_t *laddr, c
 	const unsigned char *laddr_ptr, *gw_ptr;
 	unsigned int offset = 0, len;
 	unsigned int cc;
+	uint64_t w1[2], w2[2];
+
+	if (!laddr || !gw || laddr->ss_family != gw->ss_family)
+		return FALSE;
+
+	switch (laddr->ss_family) {
+	case AF_INET:
+		if (prefix_bits > 32)
+			prefix_bits = 32;
+		return !((laddr->sin.sin_addr.s_addr ^ gw->sin.sin_addr.s_addr) &
+			htonl(prefix_bits ? ~0U << (32 - prefix_bits) : 0));
+	case AF_INET6:
+		ni_sockaddr_ipv6_words(laddr, w1);
+		ni_sockaddr_ipv6_words(gw, w2);
+		if ((w1[0] ^ w2[0]) & ni_sockaddr_word_mask(prefix_bits))
+			return FALSE;
+		return prefix_bits <= 64 ||
+			!((w1[1] ^ w2[1]) & ni_sockaddr_word_mask(prefix_bits - 64));
+	default:
+		break;
+	}
 
 	laddr_ptr = __ni_sockaddr_data(laddr, &len);
 	gw_ptr = __ni_sockaddr_data(gw, &len);
-	if (!laddr_ptr || !gw_ptr || laddr->ss_family != gw->ss_family)
+	if (!laddr_ptr || !gw_ptr)
 		return FALSE;
 
 	if (prefix_bits > (len * 8))
@@ -1112,6 +1424,14 @@ ni_sockaddr_parse(ni_sockaddr_t *ss, const char *string, int af)
 	return -1;
 }
 
+int
+ni_sockaddr_parse_slice(ni_sockaddr_t *ss, const ni_slice_t *slice, int af)
+{
+	char buf[INET6_ADDRSTRLEN + 1];
+
+	return ni_sockaddr_parse(ss, ni_slice_cstr(slice, buf, sizeof(buf)), af);
+}
+
 ni_bool_t
 ni_sockaddr_prefix_parse(const char *address_string, ni_sockaddr_t *addr, unsigned int *prefixlen)
 {
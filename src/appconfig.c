@@ -19,6 +19,7 @@
 #include <wicked/netinfo.h>
 #include <wicked/addrconf.h>
 #include <wicked/address.h>
+#include <wicked/route.h>
 #include <wicked/xpath.h>
 #include <wicked/dbus.h>
 #include "netinfo_priv.h"
@@ -26,10 +27,19 @@
 #include "appconfig.h"
 #include "extension.h"
 #include "xml-schema.h"
+#include "xml-cache.h"
 #include "process.h"
 #include "dhcp.h"
 #include "duid.h"
 
+/*
+ * Cache of the parsed config files (and includes), see xml-cache.c
+ */
+#define NI_CONFIG_CACHE_FILE	WICKED_STATEDIR "/config.cache"
+#define NI_CONFIG_CACHE_MAGIC	"WICKEDCF"
+
+static xml_file_cache_t *	ni_config_cache;
+
 static const char *__ni_ifconfig_source_types[] = {
 	"firmware:",
 	"compat:",
@@ -43,6 +53,9 @@ static ni_bool_t	ni_config_parse_addrconf_auto4(ni_config_auto4_t *, xml_node_t
 static ni_bool_t	ni_config_parse_addrconf_auto6(ni_config_auto6_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_addrconf_arp(ni_config_arp_t *, const xml_node_t *);
 static void		ni_config_parse_update_targets(unsigned int *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_addrconf_lease_file_format(ni_config_lease_file_format_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_addrconf_start_rate(ni_config_start_rate_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_addrconf_renew_rate(ni_config_renew_rate_t *, const xml_node_t *);
 static void		ni_config_parse_update_dhcp4_routes(unsigned int *, const xml_node_t *);
 static void		ni_config_parse_fslocation(ni_config_fslocation_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_objectmodel_extension(ni_extension_t **, xml_node_t *);
@@ -51,6 +64,11 @@ static ni_bool_t	ni_config_parse_objectmodel_firmware_discovery(ni_extension_t *
 static ni_bool_t	ni_config_parse_system_updater(ni_extension_t **, xml_node_t *);
 static ni_bool_t	ni_config_parse_sources(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_rtnl_event(ni_config_rtnl_event_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_socket(ni_config_socket_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_route_filter(ni_config_route_filter_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_fsm(ni_config_fsm_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_link_stats(ni_config_link_stats_t *, const xml_node_t *);
+static void		ni_config_route_filter_destroy(ni_config_route_filter_t *);
 static ni_bool_t	ni_config_parse_bonding(ni_config_bonding_t *, const xml_node_t *);
 static ni_bool_t	ni_config_parse_teamd(ni_config_teamd_t *, const xml_node_t *);
 static const char *	ni_config_build_include(char *, size_t, const char *, const char *);
@@ -104,6 +122,7 @@ ni_config_new()
 	ni_config_fslocation_init(&conf->storedir, WICKED_STOREDIR, 0755);
 
 	conf->rtnl_event.recv_buff_length = 1024 * 1024;
+	conf->rtnl_event.recv_buff_max_length = 16 * 1024 * 1024;
 	conf->rtnl_event.mesg_buff_length = 0;
 
 	/* we enable it explicitly in wickedd only */
@@ -133,6 +152,7 @@ ni_config_dhcp4_clone(const ni_config_dhcp4_t *src, const char *device)
 	dst->arp = src->arp;
 	ni_string_dup(&dst->vendor_class, src->vendor_class);
 	dst->lease_time = src->lease_time;
+	dst->fast_reboot = src->fast_reboot;
 	ni_string_array_copy(&dst->ignore_servers, &src->ignore_servers);
 	memcpy(&dst->preferred_server, &src->preferred_server, sizeof(dst->preferred_server));
 	ni_dhcp_option_decl_list_copy(&dst->custom_options, src->custom_options);
@@ -195,6 +215,7 @@ ni_config_dhcp6_clone(const ni_config_dhcp6_t *src, const char *device)
 
 	dst->lease_time = src->lease_time;
 	dst->allow_update = src->allow_update;
+	dst->offer_selection = src->offer_selection;
 	ni_string_dup(&dst->default_duid, src->default_duid);
 	dst->create_duid = src->create_duid;
 	dst->device_duid = src->device_duid;
@@ -264,6 +285,7 @@ ni_config_free(ni_config_t *conf)
 	ni_string_free(&conf->dbus_name);
 	ni_string_free(&conf->dbus_type);
 	ni_string_free(&conf->dbus_xml_schema_file);
+	ni_string_free(&conf->dbus_xml_schema_cache);
 	ni_config_fslocation_destroy(&conf->piddir);
 	ni_config_fslocation_destroy(&conf->storedir);
 	ni_config_fslocation_destroy(&conf->statedir);
@@ -271,6 +293,7 @@ ni_config_free(ni_config_t *conf)
 
 	ni_config_dhcp4_destroy(&conf->addrconf.dhcp4);
 	ni_config_dhcp6_destroy(&conf->addrconf.dhcp6);
+	ni_config_route_filter_destroy(&conf->route_filter);
 
 	free(conf);
 }
@@ -278,17 +301,23 @@ ni_config_free(ni_config_t *conf)
 ni_bool_t
 __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callback_t *cb, void *appdata)
 {
-	xml_document_t *doc;
-	xml_node_t *node, *child;
+	xml_document_t *doc = NULL;
+	xml_node_t *root, *node, *child;
 
 	ni_debug_wicked("Reading config file %s", filename);
-	doc = xml_document_read(filename);
-	if (!doc) {
+	if (ni_config_cache) {
+		/* the root is owned by the cache */
+		root = xml_file_cache_get(ni_config_cache, filename);
+	} else {
+		doc = xml_document_read(filename);
+		root = doc ? doc->root : NULL;
+	}
+	if (!root) {
 		ni_error("%s: error parsing configuration file", filename);
 		goto failed;
 	}
 
-	node = xml_node_get_child(doc->root, "config");
+	node = xml_node_get_child(root, "config");
 	if (!node) {
 		ni_error("%s: no <config> element", filename);
 		goto failed;
@@ -358,7 +387,9 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 			/* New school:
 			 *  <dbus>
 			 *    <service name="org.opensuse.Network" />
-			 *    <schema name="/some/path/wicked.xml" />
+			 *    <schema name="/some/path/wicked.xml"
+			 *            cache="/some/path/schema.cache" />
+			 *    <peer-socket enabled="true" />
 			 *  </dbus>
 			 */
 			for (gchild = child->children; gchild; gchild = gchild->next) {
@@ -371,6 +402,14 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 				if (!strcmp(gchild->name, "schema")) {
 					if ((attrval = xml_node_get_attr(gchild, "name")) != NULL)
 						ni_string_dup(&conf->dbus_xml_schema_file, attrval);
+					if ((attrval = xml_node_get_attr(gchild, "cache")) != NULL)
+						ni_string_dup(&conf->dbus_xml_schema_cache, attrval);
+				} else
+				if (!strcmp(gchild->name, "peer-socket")) {
+					attrval = xml_node_get_attr(gchild, "enabled");
+					if (attrval && ni_parse_boolean(attrval, &conf->dbus_peer_socket))
+						ni_warn("%s: invalid <dbus><peer-socket enabled=\"%s\"> value",
+							xml_node_location(gchild), attrval);
 				}
 			}
 		} else
@@ -407,6 +446,32 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 				if (ni_string_eq(gchild->name, "arp")
 				 && !ni_config_parse_addrconf_arp(&conf->addrconf.arp, gchild))
 					goto failed;
+
+				if (ni_string_eq(gchild->name, "lease-file-format")
+				 && !ni_config_parse_addrconf_lease_file_format(&conf->addrconf.lease_file_format, gchild))
+					goto failed;
+
+				if (ni_string_eq(gchild->name, "lease-file-delay")
+				 && ni_parse_uint(gchild->cdata, &conf->addrconf.lease_file_delay, 10) != 0) {
+					ni_error("%s: invalid <addrconf><lease-file-delay>%s</lease-file-delay></addrconf> option",
+							xml_node_location(gchild), gchild->cdata);
+					goto failed;
+				}
+
+				if (ni_string_eq(gchild->name, "start-rate")
+				 && !ni_config_parse_addrconf_start_rate(&conf->addrconf.start_rate, gchild))
+					goto failed;
+
+				if (ni_string_eq(gchild->name, "renew-rate")
+				 && !ni_config_parse_addrconf_renew_rate(&conf->addrconf.renew_rate, gchild))
+					goto failed;
+
+				if (ni_string_eq(gchild->name, "updater-pipeline")
+				 && ni_parse_boolean(gchild->cdata, &conf->addrconf.updater_pipeline) != 0) {
+					ni_error("%s: invalid <addrconf><updater-pipeline>%s</updater-pipeline></addrconf> option",
+							xml_node_location(gchild), gchild->cdata);
+					goto failed;
+				}
 			}
 		} else
 		if (strcmp(child->name, "sources") == 0) {
@@ -436,6 +501,29 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 			if (!ni_config_parse_rtnl_event(&conf->rtnl_event, child))
 				goto failed;
 		} else
+		if (strcmp(child->name, "socket") == 0) {
+			if (!ni_config_parse_socket(&conf->socket, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "route-filter") == 0) {
+			if (!ni_config_parse_route_filter(&conf->route_filter, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "nexthop-groups") == 0) {
+			const char *attrval = xml_node_get_attr(child, "enabled");
+
+			if (attrval && ni_parse_boolean(attrval, &conf->nexthop_groups))
+				ni_warn("%s: invalid <nexthop-groups enabled=\"%s\"> value",
+					xml_node_location(child), attrval);
+		} else
+		if (strcmp(child->name, "fsm") == 0) {
+			if (!ni_config_parse_fsm(&conf->fsm, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "link-stats") == 0) {
+			if (!ni_config_parse_link_stats(&conf->link_stats, child))
+				goto failed;
+		} else
 		if (strcmp(child->name, "bonding") == 0) {
 			if (!ni_config_parse_bonding(&conf->bonding, child))
 				goto failed;
@@ -457,7 +545,8 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 		ni_config_fslocation_init(&conf->backupdir, pathname, 0700);
 	}
 
-	xml_document_free(doc);
+	if (doc)
+		xml_document_free(doc);
 	return TRUE;
 
 failed:
@@ -470,13 +559,18 @@ ni_config_t *
 ni_config_parse(const char *filename, ni_init_appdata_callback_t *cb, void *appdata)
 {
 	ni_config_t *conf;
+	ni_bool_t ret;
 
 	conf = ni_config_new();
-	if (!__ni_config_parse(conf, filename, cb, appdata)) {
+	ni_config_cache = xml_file_cache_open(NI_CONFIG_CACHE_FILE, NI_CONFIG_CACHE_MAGIC);
+	ret = __ni_config_parse(conf, filename, cb, appdata);
+	xml_file_cache_close(ni_config_cache);
+	ni_config_cache = NULL;
+
+	if (!ret) {
 		ni_config_free(conf);
 		return NULL;
 	}
-
 	return conf;
 }
 
@@ -567,6 +661,11 @@ ni_config_parse_addrconf_dhcp4_nodes(ni_config_dhcp4_t *dhcp4, xml_node_t *node)
 		if (!strcmp(child->name, "lease-time") && child->cdata)
 			ni_parse_uint(child->cdata, &dhcp4->lease_time, 0);
 		else
+		if (ni_string_eq(child->name, "fast-reboot")) {
+			if (ni_parse_boolean(child->cdata, &dhcp4->fast_reboot) != 0)
+				ni_warn("config: unable to parse <fast-reboot>%s</fast-reboot>",
+						child->cdata);
+		} else
 		if (!strcmp(child->name, "ignore-server")) {
 			if ((attrval = xml_node_get_attr(child, "ip")) != NULL)
 				ni_string_array_append(&dhcp4->ignore_servers, attrval);
@@ -685,6 +784,25 @@ ni_config_parse_addrconf_dhcp4(ni_config_t *conf, xml_node_t *node)
 }
 
 
+static const ni_intmap_t	config_dhcp6_offer_selection_names[] = {
+	{ "wait",		NI_CONFIG_DHCP6_OFFER_SELECTION_WAIT	},
+	{ "shared",		NI_CONFIG_DHCP6_OFFER_SELECTION_SHARED	},
+	{ "fast",		NI_CONFIG_DHCP6_OFFER_SELECTION_FAST	},
+
+	{ NULL,			NI_CONFIG_DHCP6_OFFER_SELECTION_WAIT	}
+};
+
+const char *
+ni_config_dhcp6_offer_selection_format(ni_config_dhcp6_offer_selection_t type)
+{
+	return ni_format_uint_mapped(type, config_dhcp6_offer_selection_names);
+}
+ni_bool_t
+ni_config_dhcp6_offer_selection_parse(unsigned int *type, const char *name)
+{
+	return ni_parse_uint_mapped(name, config_dhcp6_offer_selection_names, type) == 0;
+}
+
 static int
 __ni_config_parse_dhcp6_class_data(xml_node_t *node, ni_string_array_t *data, const char *parent)
 {
@@ -1112,6 +1230,12 @@ ni_config_parse_addrconf_dhcp6_nodes(ni_config_dhcp6_t *dhcp6, xml_node_t *node)
 		if (!strcmp(child->name, "release-retransmits") && child->cdata) {
 			ni_parse_uint(child->cdata, &dhcp6->release_nretries, 0);
 		} else
+		if (!strcmp(child->name, "offer-selection") && child->cdata) {
+			if (!ni_config_dhcp6_offer_selection_parse(&dhcp6->offer_selection,
+						child->cdata))
+				ni_warn("config: discarding invalid offer-selection value '%s'",
+						child->cdata);
+		} else
 		if (!strcmp(child->name, "info-refresh-time")) {
 			const char *attrval;
 			unsigned int value;
@@ -1267,6 +1391,11 @@ ni_config_parse_addrconf_auto4(ni_config_auto4_t *auto4, xml_node_t *node)
 		if (ni_string_eq(child->name, "arp")) {
 			if (!ni_config_parse_addrconf_arp(&auto4->arp, child))
 				return FALSE;
+		} else
+		if (ni_string_eq(child->name, "fast-reclaim")) {
+			if (ni_parse_boolean(child->cdata, &auto4->fast_reclaim) != 0)
+				ni_warn("config: unable to parse <fast-reclaim>%s</fast-reclaim>",
+						child->cdata);
 		}
 	}
 	return TRUE;
@@ -1567,6 +1696,24 @@ ni_config_parse_extension_script_env(ni_script_action_t *script, xml_node_t *nod
 	return TRUE;
 }
 
+/*
+ * The builtin symbol is a C identifier, e.g. ni_ibft_firmware_show_config
+ */
+static ni_bool_t
+ni_config_check_symbol_name(const char *symbol)
+{
+	const char *p;
+
+	if (ni_string_empty(symbol) || isdigit((unsigned char)*symbol))
+		return FALSE;
+
+	for (p = symbol; *p; ++p) {
+		if (!isalnum((unsigned char)*p) && *p != '_')
+			return FALSE;
+	}
+	return TRUE;
+}
+
 static ni_bool_t
 ni_config_parse_extension(ni_extension_t *ex, xml_node_t *node)
 {
@@ -1614,6 +1761,12 @@ ni_config_parse_extension(ni_extension_t *ex, xml_node_t *node)
 			if ((script = ni_script_action_new(name, command))) {
 				script->enabled = enabled;
 				ni_config_parse_extension_script_env(script, child, old);
+
+				attr = xml_node_get_attr(child, "timeout");
+				if (attr && ni_parse_uint(attr, &script->process->timeout, 10)) {
+					ni_error("[%s] script action with invalid timeout attribute",
+							xml_node_location(child));
+				}
 			}
 
 			if (ni_script_action_list_replace(&ex->actions, old, script)) {
@@ -1642,7 +1795,7 @@ ni_config_parse_extension(ni_extension_t *ex, xml_node_t *node)
 				return FALSE;
 			}
 			symbol = xml_node_get_attr(child, "symbol");
-			if (!ni_check_domain_name(symbol, ni_string_len(symbol), -1)) {
+			if (!ni_config_check_symbol_name(symbol)) {
 				ni_error("[%s] builtin action without valid symbol attribute",
 						xml_node_location(child));
 				return FALSE;
@@ -1933,6 +2086,36 @@ ni_config_objectmodel_firmware_discovery_migrate(ni_extension_t **list, ni_exten
 	return TRUE;
 }
 
+/*
+ * The firmware discovery extensions may implement an action using a
+ * builtin, e.g.:
+ *   <netif-firmware-discovery name="ibft">
+ *     <builtin name="show-config"  symbol="ni_ibft_firmware_show_config" />
+ *     <builtin name="list-ifnames" symbol="ni_ibft_firmware_list_ifnames" />
+ *   </netif-firmware-discovery>
+ * A later definition of the extension inherits the builtins for actions
+ * it does not define as builtin or script; a script overrides a builtin.
+ */
+static void
+ni_config_firmware_discovery_merge_builtins(ni_extension_t *nex, ni_extension_t *oex)
+{
+	ni_c_binding_t *binding, *next;
+
+	if (!nex || !oex)
+		return;
+
+	for (binding = oex->c_bindings; binding; binding = next) {
+		next = binding->next;
+
+		if (ni_c_binding_list_find(nex->c_bindings, binding->name) ||
+		    ni_script_action_list_find(nex->actions, binding->name))
+			continue;
+
+		if (ni_c_binding_list_remove(&oex->c_bindings, binding))
+			ni_c_binding_list_append(&nex->c_bindings, binding);
+	}
+}
+
 static ni_bool_t
 ni_config_parse_objectmodel_firmware_discovery(ni_extension_t **list, xml_node_t *node)
 {
@@ -1977,7 +2160,8 @@ ni_config_parse_objectmodel_firmware_discovery(ni_extension_t **list, xml_node_t
 		 * We simply change the enable flag in the old extension and
 		 * when it defines some env vars, we override then too:
 		 */
-		if (!ex->actions && (old = ni_extension_list_find(*list, name))) {
+		if (!ex->actions && !ex->c_bindings &&
+		    (old = ni_extension_list_find(*list, name))) {
 			old->enabled = ex->enabled;
 			ni_var_array_set_vars(&old->environment, &ex->environment, TRUE);
 
@@ -2000,20 +2184,16 @@ ni_config_parse_objectmodel_firmware_discovery(ni_extension_t **list, xml_node_t
 		ex->next = NULL;
 
 		name = ex->name;
-		if (ex->c_bindings) {
-			ni_warn("[%s] builtin actions not supported in %s extensions",
-					xml_node_location(node), node->name);
-			ni_c_binding_list_destroy(&ex->c_bindings);
-		}
-		if (!ex->actions) {
+		if (!ex->actions && !ex->c_bindings) {
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_APPLICATION,
-					"[%s] disarding %s extension without script actions",
+					"[%s] disarding %s extension without actions",
 					xml_node_location(node), node->name);
 			ni_extension_free(ex);
 			return TRUE;
 		}
 
 		old = ni_extension_list_find(*list, name);
+		ni_config_firmware_discovery_merge_builtins(ex, old);
 		if (!ni_config_extension_list_add(list, old, ex)) {
 			ni_warn("[%s] unable to add %s extension to list",
 					xml_node_location(node), node->name);
@@ -2034,6 +2214,14 @@ ni_config_parse_objectmodel_firmware_discovery(ni_extension_t **list, xml_node_t
  *  <script name="restore" command="/some/crazy/path/to/script restore" />
  *  ...
  * </system-updater>
+ *
+ * The hostname and resolver updaters provide in-process builtins for
+ * their backup, restore, install and remove actions, e.g.:
+ *
+ * <system-updater name="hostname">
+ *  <builtin name="install" symbol="ni_hostname_updater_install" />
+ *  ...
+ * </system-updater>
  */
 static ni_bool_t
 ni_config_parse_system_updater(ni_extension_t **list, xml_node_t *node)
@@ -2074,14 +2262,9 @@ ni_config_parse_system_updater(ni_extension_t **list, xml_node_t *node)
 		}
 	}
 
-	if (ex->c_bindings) {
-		ni_warn("[%s] builtin actions not supported in %s extensions",
-				xml_node_location(node), node->name);
-		ni_c_binding_list_destroy(&ex->c_bindings);
-	}
-	if (!ex->actions) {
+	if (!ex->actions && !ex->c_bindings) {
 		ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_APPLICATION,
-				"[%s] disarding %s extension without script actions",
+				"[%s] disarding %s extension without script or builtin actions",
 				xml_node_location(node), node->name);
 		ni_extension_free(ex);
 		return TRUE;
@@ -2139,12 +2322,25 @@ ni_config_parse_sources(ni_config_t *conf, xml_node_t *sources)
 		if (!strcmp(child->name, "ifconfig")) {
 			 if (!__ni_config_parse_ifconfig_source(&conf->sources.ifconfig, child))
 				return FALSE;
+		} else
+		if (!strcmp(child->name, "ifconfig-cache")) {
+			if (ni_parse_boolean(child->cdata, &conf->sources.ifconfig_cache) != 0) {
+				ni_error("%s: invalid <sources><ifconfig-cache>%s</ifconfig-cache></sources> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
 		}
 	}
 
 	return TRUE;
 }
 
+ni_bool_t
+ni_config_sources_ifconfig_cache(void)
+{
+	return ni_global.config ? ni_global.config->sources.ifconfig_cache : FALSE;
+}
+
 const ni_string_array_t *
 ni_config_sources(const char *type)
 {
@@ -2161,9 +2357,16 @@ ni_config_sources(const char *type)
 	return retval;
 }
 
+static const ni_intmap_t	config_rtnl_refresh_names[] = {
+	{ "full",		NI_CONFIG_RTNL_REFRESH_FULL		},
+	{ "incremental",	NI_CONFIG_RTNL_REFRESH_INCREMENTAL	},
+	{ NULL,			-1U					}
+};
+
 ni_bool_t
 ni_config_parse_rtnl_event(ni_config_rtnl_event_t *conf, xml_node_t *node)
 {
+	unsigned int refresh;
 	xml_node_t *child;
 
 	if (!conf || !node)
@@ -2174,9 +2377,330 @@ ni_config_parse_rtnl_event(ni_config_rtnl_event_t *conf, xml_node_t *node)
 			if (ni_parse_uint(child->cdata, &conf->recv_buff_length, 0))
 				return FALSE;
 		} else
+		if (ni_string_eq(child->name, "receive-buffer-max-length")) {
+			if (ni_parse_uint(child->cdata, &conf->recv_buff_max_length, 0))
+				return FALSE;
+		} else
 		if (ni_string_eq(child->name, "message-buffer-length")) {
 			if (ni_parse_uint(child->cdata, &conf->mesg_buff_length, 0))
 				return FALSE;
+		} else
+		if (ni_string_eq(child->name, "refresh")) {
+			if (ni_parse_uint_mapped(child->cdata, config_rtnl_refresh_names, &refresh) != 0) {
+				ni_error("%s: invalid <netlink-events><refresh>%s</refresh></netlink-events> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			conf->refresh = refresh;
+		} else
+		if (ni_string_eq(child->name, "coalesce-window")) {
+			if (ni_parse_uint(child->cdata, &conf->coalesce_window, 10))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * socket wait backend config options
+ */
+static const ni_intmap_t	config_socket_backend_names[] = {
+	{ "poll",		NI_CONFIG_SOCKET_BACKEND_POLL	},
+	{ "epoll",		NI_CONFIG_SOCKET_BACKEND_EPOLL	},
+	{ NULL,			-1U				}
+};
+
+ni_config_socket_backend_t
+ni_config_socket_backend(void)
+{
+	return ni_global.config ? ni_global.config->socket.backend : NI_CONFIG_SOCKET_BACKEND_POLL;
+}
+
+ni_bool_t
+ni_config_socket_packet_ring(void)
+{
+	return ni_global.config ? ni_global.config->socket.packet_ring : FALSE;
+}
+
+ni_bool_t
+ni_config_socket_shared_capture(void)
+{
+	return ni_global.config ? ni_global.config->socket.shared_capture : FALSE;
+}
+
+unsigned int
+ni_config_socket_shared_capture_fanout(void)
+{
+	return ni_global.config ? ni_global.config->socket.shared_fanout : 0;
+}
+
+ni_bool_t
+ni_config_socket_shared_dhcp6(void)
+{
+	return ni_global.config ? ni_global.config->socket.shared_dhcp6 : FALSE;
+}
+
+static ni_bool_t
+ni_config_parse_socket(ni_config_socket_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int backend;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "backend")) {
+			if (ni_parse_uint_mapped(child->cdata, config_socket_backend_names, &backend) != 0) {
+				ni_error("%s: invalid <socket><backend>%s</backend></socket> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			conf->backend = backend;
+		} else
+		if (ni_string_eq(child->name, "packet-ring")) {
+			if (ni_parse_boolean(child->cdata, &conf->packet_ring) != 0) {
+				ni_error("%s: invalid <socket><packet-ring>%s</packet-ring></socket> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "shared-capture")) {
+			const char *attr;
+
+			if (ni_parse_boolean(child->cdata, &conf->shared_capture) != 0) {
+				ni_error("%s: invalid <socket><shared-capture>%s</shared-capture></socket> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			if ((attr = xml_node_get_attr(child, "fanout")) &&
+			    (ni_parse_uint(attr, &conf->shared_fanout, 10) != 0 ||
+			     conf->shared_fanout > NI_CONFIG_SOCKET_FANOUT_MAX)) {
+				ni_error("%s: invalid <socket><shared-capture fanout=\"%s\"> attribute",
+						xml_node_location(child), attr);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "shared-dhcp6-socket")) {
+			if (ni_parse_boolean(child->cdata, &conf->shared_dhcp6) != 0) {
+				ni_error("%s: invalid <socket><shared-dhcp6-socket>%s</shared-dhcp6-socket></socket> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * client fsm config options
+ */
+unsigned int
+ni_config_fsm_parallel_calls(void)
+{
+	return ni_global.config ? ni_global.config->fsm.parallel_calls : 0;
+}
+
+unsigned int
+ni_config_fsm_parallel_calls_latency(void)
+{
+	return ni_global.config ? ni_global.config->fsm.parallel_calls_latency : 0;
+}
+
+ni_bool_t
+ni_config_fsm_timings(void)
+{
+	return ni_global.config ? ni_global.config->fsm.timings : FALSE;
+}
+
+static ni_bool_t
+ni_config_parse_fsm(ni_config_fsm_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	const char *attr;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "parallel-calls")) {
+			if (ni_parse_uint(child->cdata, &conf->parallel_calls, 10) != 0) {
+				ni_error("%s: invalid <fsm><parallel-calls>%s</parallel-calls></fsm> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			if ((attr = xml_node_get_attr(child, "latency")) &&
+			    ni_parse_uint(attr, &conf->parallel_calls_latency, 10) != 0) {
+				ni_error("%s: invalid <fsm><parallel-calls latency=\"%s\"/></fsm> option",
+						xml_node_location(child), attr);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "timings")) {
+			if (ni_parse_boolean(child->cdata, &conf->timings) != 0) {
+				ni_error("%s: invalid <fsm><timings>%s</timings></fsm> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * server link stats sampling config options
+ */
+unsigned int
+ni_config_link_stats_interval(void)
+{
+	return ni_global.config ? ni_global.config->link_stats.interval : 0;
+}
+
+unsigned int
+ni_config_link_stats_history(void)
+{
+	return ni_global.config ? ni_global.config->link_stats.history : 0;
+}
+
+static ni_bool_t
+ni_config_parse_link_stats(ni_config_link_stats_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "interval")) {
+			if (ni_parse_uint(child->cdata, &conf->interval, 10) != 0) {
+				ni_error("%s: invalid <link-stats><interval>%s</interval></link-stats> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "history")) {
+			if (ni_parse_uint(child->cdata, &conf->history, 10) != 0) {
+				ni_error("%s: invalid <link-stats><history>%s</history></link-stats> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * route refresh/event filter config options
+ */
+const ni_config_route_filter_t *
+ni_config_route_filter(void)
+{
+	return ni_global.config ? &ni_global.config->route_filter : NULL;
+}
+
+ni_bool_t
+ni_config_route_filter_match(unsigned int family, unsigned int table, unsigned int protocol)
+{
+	ni_config_route_filter_t *filter;
+
+	if (!ni_global.config)
+		return TRUE;
+
+	filter = &ni_global.config->route_filter;
+	if (filter->family != AF_UNSPEC && filter->family != family)
+		return FALSE;
+	if (filter->tables.count && !ni_uint_array_contains(&filter->tables, table))
+		return FALSE;
+	if (filter->protocols.count && !ni_uint_array_contains(&filter->protocols, protocol))
+		return FALSE;
+	if (ni_uint_array_contains(&filter->exclude_protocols, protocol))
+		return FALSE;
+	return TRUE;
+}
+
+ni_bool_t
+ni_config_route_filter_managed_tables(void)
+{
+	ni_config_route_filter_t *filter;
+
+	if (!ni_global.config)
+		return FALSE;
+
+	/* an explicit table list takes precedence */
+	filter = &ni_global.config->route_filter;
+	return filter->managed_tables && !filter->tables.count;
+}
+
+/*
+ * kernel nexthop groups of multipath routes
+ */
+ni_bool_t
+ni_config_nexthop_groups(void)
+{
+	return ni_global.config ? ni_global.config->nexthop_groups : FALSE;
+}
+
+static void
+ni_config_route_filter_destroy(ni_config_route_filter_t *filter)
+{
+	ni_uint_array_destroy(&filter->tables);
+	ni_uint_array_destroy(&filter->protocols);
+	ni_uint_array_destroy(&filter->exclude_protocols);
+	filter->family = AF_UNSPEC;
+	filter->managed_tables = FALSE;
+}
+
+static ni_bool_t
+ni_config_parse_route_filter(ni_config_route_filter_t *filter, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int value;
+	int family;
+
+	if (!filter || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "family")) {
+			family = ni_addrfamily_name_to_type(child->cdata);
+			if (family != AF_INET && family != AF_INET6) {
+				ni_error("%s: invalid <route-filter><family>%s</family></route-filter> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			filter->family = family;
+		} else
+		if (ni_string_eq(child->name, "table")) {
+			if (!ni_route_table_name_to_type(child->cdata, &value) ||
+			    !ni_route_is_valid_table(value)) {
+				ni_error("%s: invalid <route-filter><table>%s</table></route-filter> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			ni_uint_array_append(&filter->tables, value);
+		} else
+		if (ni_string_eq(child->name, "protocol")) {
+			if (!ni_route_protocol_name_to_type(child->cdata, &value)) {
+				ni_error("%s: invalid <route-filter><protocol>%s</protocol></route-filter> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			ni_uint_array_append(&filter->protocols, value);
+		} else
+		if (ni_string_eq(child->name, "exclude-protocol")) {
+			if (!ni_route_protocol_name_to_type(child->cdata, &value)) {
+				ni_error("%s: invalid <route-filter><exclude-protocol>%s</exclude-protocol></route-filter> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			ni_uint_array_append(&filter->exclude_protocols, value);
+		} else
+		if (ni_string_eq(child->name, "managed-tables")) {
+			if (ni_parse_boolean(child->cdata, &filter->managed_tables)) {
+				ni_error("%s: invalid <route-filter><managed-tables>%s</managed-tables></route-filter> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
 		}
 	}
 	return TRUE;
@@ -2599,6 +3123,121 @@ ni_config_addrconf_arp_default(ni_config_arp_t *cfg)
 	cfg->notify.retries = NI_ADDRCONF_ARP_NOTIFY_RETRIES;
 }
 
+/*
+ * lease file format config options
+ */
+static const ni_intmap_t	config_lease_file_format_names[] = {
+	{ "binary",		NI_CONFIG_LEASE_FILE_BINARY	},
+	{ "xml",		NI_CONFIG_LEASE_FILE_XML	},
+	{ NULL,			-1U				}
+};
+
+static ni_bool_t
+ni_config_parse_addrconf_lease_file_format(ni_config_lease_file_format_t *format, const xml_node_t *node)
+{
+	unsigned int value;
+
+	if (ni_parse_uint_mapped(node->cdata, config_lease_file_format_names, &value) != 0) {
+		ni_error("%s: invalid <addrconf><lease-file-format>%s</lease-file-format></addrconf> option",
+				xml_node_location(node), node->cdata);
+		return FALSE;
+	}
+	*format = value;
+	return TRUE;
+}
+
+ni_config_lease_file_format_t
+ni_config_addrconf_lease_file_format(void)
+{
+	return ni_global.config ? ni_global.config->addrconf.lease_file_format : NI_CONFIG_LEASE_FILE_BINARY;
+}
+
+unsigned int
+ni_config_addrconf_lease_file_delay(void)
+{
+	return ni_global.config ? ni_global.config->addrconf.lease_file_delay : 0;
+}
+
+static ni_bool_t
+ni_config_parse_addrconf_start_rate(ni_config_start_rate_t *conf, const xml_node_t *node)
+{
+	const char *attr;
+
+	memset(conf, 0, sizeof(*conf));
+	if (ni_parse_uint(node->cdata, &conf->rate, 10) != 0) {
+		ni_error("%s: invalid <addrconf><start-rate>%s</start-rate></addrconf> option",
+				xml_node_location(node), node->cdata);
+		return FALSE;
+	}
+	if ((attr = xml_node_get_attr(node, "burst")) &&
+	    ni_parse_uint(attr, &conf->burst, 10) != 0) {
+		ni_error("%s: invalid <addrconf><start-rate burst=\"%s\"> attribute",
+				xml_node_location(node), attr);
+		return FALSE;
+	}
+	if ((attr = xml_node_get_attr(node, "jitter")) &&
+	    ni_parse_uint(attr, &conf->jitter, 10) != 0) {
+		ni_error("%s: invalid <addrconf><start-rate jitter=\"%s\"> attribute",
+				xml_node_location(node), attr);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+const ni_config_start_rate_t *
+ni_config_addrconf_start_rate(void)
+{
+	static const ni_config_start_rate_t unlimited;
+
+	return ni_global.config ? &ni_global.config->addrconf.start_rate : &unlimited;
+}
+
+static ni_bool_t
+ni_config_parse_addrconf_renew_rate(ni_config_renew_rate_t *conf, const xml_node_t *node)
+{
+	const char *attr;
+
+	memset(conf, 0, sizeof(*conf));
+	if (ni_parse_uint(node->cdata, &conf->rate, 10) != 0) {
+		ni_error("%s: invalid <addrconf><renew-rate>%s</renew-rate></addrconf> option",
+				xml_node_location(node), node->cdata);
+		return FALSE;
+	}
+	if ((attr = xml_node_get_attr(node, "burst")) &&
+	    ni_parse_uint(attr, &conf->burst, 10) != 0) {
+		ni_error("%s: invalid <addrconf><renew-rate burst=\"%s\"> attribute",
+				xml_node_location(node), attr);
+		return FALSE;
+	}
+	if ((attr = xml_node_get_attr(node, "window")) &&
+	    ni_parse_uint(attr, &conf->window, 10) != 0) {
+		ni_error("%s: invalid <addrconf><renew-rate window=\"%s\"> attribute",
+				xml_node_location(node), attr);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+const ni_config_renew_rate_t *
+ni_config_addrconf_renew_rate(void)
+{
+	static const ni_config_renew_rate_t unlimited;
+
+	return ni_global.config ? &ni_global.config->addrconf.renew_rate : &unlimited;
+}
+
+ni_bool_t
+ni_config_addrconf_updater_pipeline(void)
+{
+	return ni_global.config ? ni_global.config->addrconf.updater_pipeline : FALSE;
+}
+
+ni_bool_t
+ni_config_addrconf_auto4_fast_reclaim(void)
+{
+	return ni_global.config ? ni_global.config->addrconf.auto4.fast_reclaim : FALSE;
+}
+
 extern const ni_config_arp_t *
 ni_config_addrconf_arp(ni_addrconf_mode_t owner, const char *ifname)
 {
@@ -69,14 +69,73 @@ typedef struct ni_server_preference {
 	int			weight;
 } ni_server_preference_t;
 
+typedef enum {
+	NI_CONFIG_RTNL_REFRESH_FULL = 0,
+	NI_CONFIG_RTNL_REFRESH_INCREMENTAL,
+} ni_config_rtnl_refresh_t;
+
 typedef struct ni_config_rtnl_event {
 	/*
 	 * rtnetlink event related tunables
 	 */
 	unsigned int	recv_buff_length;
+	unsigned int	recv_buff_max_length;
 	unsigned int	mesg_buff_length;
+	ni_config_rtnl_refresh_t refresh;
+	unsigned int	coalesce_window;
 } ni_config_rtnl_event_t;
 
+typedef enum {
+	NI_CONFIG_SOCKET_BACKEND_POLL = 0,
+	NI_CONFIG_SOCKET_BACKEND_EPOLL,
+} ni_config_socket_backend_t;
+
+typedef enum {
+	NI_CONFIG_LEASE_FILE_BINARY = 0,
+	NI_CONFIG_LEASE_FILE_XML,
+} ni_config_lease_file_format_t;
+
+typedef struct ni_config_start_rate {
+	unsigned int		rate;		/* starts per second, 0 unlimited */
+	unsigned int		burst;		/* starts without any delay	*/
+	unsigned int		jitter;		/* random delay in msec		*/
+} ni_config_start_rate_t;
+
+typedef struct ni_config_renew_rate {
+	unsigned int		rate;		/* renewals per second, 0 unlimited */
+	unsigned int		burst;		/* renewals without any delay	*/
+	unsigned int		window;		/* align renewals in seconds	*/
+} ni_config_renew_rate_t;
+
+#define NI_CONFIG_SOCKET_FANOUT_MAX	16
+
+typedef struct ni_config_socket {
+	ni_config_socket_backend_t	backend;
+	ni_bool_t			packet_ring;
+	ni_bool_t			shared_capture;
+	unsigned int			shared_fanout;
+	ni_bool_t			shared_dhcp6;
+} ni_config_socket_t;
+
+typedef struct ni_config_fsm {
+	unsigned int			parallel_calls;
+	unsigned int			parallel_calls_latency;
+	ni_bool_t			timings;
+} ni_config_fsm_t;
+
+typedef struct ni_config_link_stats {
+	unsigned int			interval;	/* msec, 0: default	*/
+	unsigned int			history;	/* samples, 0: default	*/
+} ni_config_link_stats_t;
+
+typedef struct ni_config_route_filter {
+	unsigned int		family;
+	ni_uint_array_t		tables;
+	ni_uint_array_t		protocols;
+	ni_uint_array_t		exclude_protocols;
+	ni_bool_t		managed_tables;
+} ni_config_route_filter_t;
+
 typedef enum {
 	NI_CONFIG_BONDING_CTL_NETLINK = 0,
 	NI_CONFIG_BONDING_CTL_SYSFS,
@@ -111,6 +170,12 @@ typedef enum {
 	NI_CONFIG_DHCP4_CID_TYPE_DISABLE,
 } ni_config_dhcp4_cid_type_t;
 
+typedef enum {
+	NI_CONFIG_DHCP6_OFFER_SELECTION_WAIT = 0U,
+	NI_CONFIG_DHCP6_OFFER_SELECTION_SHARED,
+	NI_CONFIG_DHCP6_OFFER_SELECTION_FAST,
+} ni_config_dhcp6_offer_selection_t;
+
 typedef struct ni_config_arp_verify {
 	unsigned int	count;
 	unsigned int	retries;
@@ -140,6 +205,7 @@ typedef struct ni_config_dhcp4 {
 	unsigned int		lease_time;
 	ni_string_array_t	ignore_servers;
 	ni_config_arp_t		arp;
+	ni_bool_t		fast_reboot;
 
 	unsigned int		num_preferred_servers;
 	ni_server_preference_t	preferred_server[NI_DHCP_SERVER_PREFERENCES_MAX];
@@ -158,6 +224,7 @@ typedef struct ni_config_dhcp6 {
 	unsigned int		allow_update;
 	unsigned int		lease_time;
 	unsigned int		release_nretries;
+	unsigned int		offer_selection;
 	struct {
 		unsigned int	time;
 		ni_uint_range_t range;
@@ -178,6 +245,7 @@ typedef struct ni_config_dhcp6 {
 
 typedef struct ni_config_auto4 {
 	unsigned int		allow_update;
+	ni_bool_t		fast_reclaim;
 	ni_config_arp_t		arp;
 } ni_config_auto4_t;
 
@@ -194,6 +262,11 @@ typedef struct ni_config {
 	struct {
 	    unsigned int	default_allow_update;
 	    ni_config_arp_t	arp;
+	    ni_config_lease_file_format_t lease_file_format;
+	    unsigned int	lease_file_delay;
+	    ni_config_start_rate_t start_rate;
+	    ni_config_renew_rate_t renew_rate;
+	    ni_bool_t		updater_pipeline;
 
 	    ni_config_dhcp4_t	dhcp4;
 	    ni_config_dhcp6_t	dhcp6;
@@ -204,6 +277,7 @@ typedef struct ni_config {
 	} addrconf;
 
 	char *			dbus_xml_schema_file;
+	char *			dbus_xml_schema_cache;
 	ni_extension_t *	dbus_extensions;
 	ni_extension_t *	ns_extensions;
 	ni_extension_t *	fw_extensions;
@@ -211,12 +285,19 @@ typedef struct ni_config {
 
 	struct {
 	    ni_string_array_t	ifconfig;
+	    ni_bool_t		ifconfig_cache;
 	} sources;
 
 	char *			dbus_name;
 	char *			dbus_type;
+	ni_bool_t		dbus_peer_socket;
 
 	ni_config_rtnl_event_t	rtnl_event;
+	ni_config_socket_t	socket;
+	ni_config_route_filter_t route_filter;
+	ni_bool_t		nexthop_groups;
+	ni_config_fsm_t		fsm;
+	ni_config_link_stats_t	link_stats;
 
 	ni_config_bonding_t	bonding;
 	ni_config_teamd_t	teamd;
@@ -230,11 +311,35 @@ extern ni_extension_t *		ni_config_find_system_updater(ni_config_t *, const char
 extern unsigned int		ni_config_addrconf_update_mask(ni_addrconf_mode_t, unsigned int);
 extern unsigned int		ni_config_addrconf_update(const char *, ni_addrconf_mode_t, unsigned int);
 extern const ni_config_arp_t *	ni_config_addrconf_arp(ni_addrconf_mode_t, const char *);
+extern ni_config_lease_file_format_t	ni_config_addrconf_lease_file_format(void);
+extern unsigned int		ni_config_addrconf_lease_file_delay(void);
+extern const ni_config_start_rate_t *ni_config_addrconf_start_rate(void);
+extern const ni_config_renew_rate_t *ni_config_addrconf_renew_rate(void);
+extern ni_bool_t		ni_config_addrconf_updater_pipeline(void);
+extern ni_bool_t		ni_config_addrconf_auto4_fast_reclaim(void);
 
 extern const ni_config_dhcp4_t *ni_config_dhcp4_find_device(const char *);
 extern const char *		ni_config_dhcp4_cid_type_format(ni_config_dhcp4_cid_type_t);
 extern ni_bool_t		ni_config_dhcp4_cid_type_parse(ni_config_dhcp4_cid_type_t *, const char *);
 extern const ni_config_dhcp6_t *ni_config_dhcp6_find_device(const char *);
+extern const char *		ni_config_dhcp6_offer_selection_format(ni_config_dhcp6_offer_selection_t);
+extern ni_bool_t		ni_config_dhcp6_offer_selection_parse(unsigned int *, const char *);
+
+extern ni_config_socket_backend_t ni_config_socket_backend(void);
+extern ni_bool_t		ni_config_socket_packet_ring(void);
+extern ni_bool_t		ni_config_socket_shared_capture(void);
+extern unsigned int		ni_config_socket_shared_capture_fanout(void);
+extern ni_bool_t		ni_config_socket_shared_dhcp6(void);
+extern const ni_config_route_filter_t *ni_config_route_filter(void);
+extern ni_bool_t		ni_config_route_filter_match(unsigned int, unsigned int, unsigned int);
+extern ni_bool_t		ni_config_route_filter_managed_tables(void);
+extern ni_bool_t		ni_config_nexthop_groups(void);
+extern unsigned int		ni_config_fsm_parallel_calls(void);
+extern unsigned int		ni_config_fsm_parallel_calls_latency(void);
+extern ni_bool_t		ni_config_fsm_timings(void);
+extern unsigned int		ni_config_link_stats_interval(void);
+extern unsigned int		ni_config_link_stats_history(void);
+extern ni_bool_t		ni_config_sources_ifconfig_cache(void);
 
 extern ni_config_bonding_ctl_t	ni_config_bonding_ctl(void);
 
@@ -13,6 +13,7 @@
 #include <limits.h>
 #include <sys/time.h>
 #include <errno.h>
+#include <linux/filter.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/socket.h>
@@ -21,6 +22,9 @@
 #include "array_priv.h"
 #include "buffer.h"
 
+/* keeps the jumps to the accept/drop statements within 8 bit */
+#define NI_ARP_FILTER_MAX_ADDRS	240
+
 static void	ni_arp_socket_recv(ni_socket_t *);
 static int	ni_arp_parse(ni_arp_socket_t *, ni_buffer_t *, ni_arp_packet_t *);
 
@@ -40,6 +44,7 @@ ni_arp_socket_open(const ni_capture_devinfo_t *dev_info, ni_arp_callback_t *call
 
 	memset(&prot_info, 0, sizeof(prot_info));
 	prot_info.eth_protocol = ETHERTYPE_ARP;
+	prot_info.rx_ring = ni_config_socket_packet_ring();
 
 	arph->capture = ni_capture_open(dev_info, &prot_info, ni_arp_socket_recv, "arp");
 	if (!arph->capture) {
@@ -294,6 +299,7 @@ ni_arp_verify_reset(ni_arp_verify_t *vfy, const ni_config_arp_verify_t *cfg)
 	timerclear(&vfy->started);
 	vfy->last_timeout = 0;
 	ni_arp_address_array_destroy(&vfy->ipaddrs);
+	vfy->refilter = TRUE;
 }
 
 void
@@ -318,6 +324,7 @@ ni_arp_verify_add_address(ni_arp_verify_t *vfy,  ni_address_t *ap)
 	if (!ni_arp_address_array_append_addr(&vfy->ipaddrs, ap))
 		return 0;
 
+	vfy->refilter = TRUE;
 	return vfy->ipaddrs.count;
 }
 
@@ -336,7 +343,11 @@ ni_arp_verify_remove_address(ni_arp_verify_t *vfy,  ni_address_t *ap)
 				ni_address_equal_local_addr))
 		return FALSE;
 
-	return ni_arp_address_array_delete_at(&vfy->ipaddrs, index);
+	if (!ni_arp_address_array_delete_at(&vfy->ipaddrs, index))
+		return FALSE;
+
+	vfy->refilter = TRUE;
+	return TRUE;
 }
 
 unsigned int
@@ -365,7 +376,7 @@ ni_arp_reply_match_address(ni_arp_socket_t *sock, ni_arp_address_array_t *ipaddr
 		const ni_arp_packet_t *pkt)
 {
 	ni_netconfig_t *nc = ni_global_state_handle(0);
-	const ni_netdev_t *dev;
+	ni_netdev_t *dev;
 	ni_bool_t false_alarm = FALSE;
 	ni_bool_t found_addr = FALSE;
 	ni_arp_address_t *vap;
@@ -416,7 +427,7 @@ ni_arp_reply_match_address(ni_arp_socket_t *sock, ni_arp_address_array_t *ipaddr
 		 * alarm, except it really has the IP assigned.
 		 */
 		false_alarm = TRUE;
-		found_addr = !!ni_address_list_find(dev->addrs, &vap->address->local_addr);
+		found_addr = !!ni_netdev_find_address(dev, &vap->address->local_addr);
 	}
 	if (false_alarm && !found_addr) {
 		ni_debug_application("%s: reply from one of our interfaces",
@@ -427,6 +438,61 @@ ni_arp_reply_match_address(ni_arp_socket_t *sock, ni_arp_address_array_t *ipaddr
 	return vap;
 }
 
+/*
+ * Install a socket filter passing only ARP replies about the addresses
+ * in the verify set, which is all ni_arp_reply_match_address accepts,
+ * so we don't wake up for every ARP packet on busy broadcast domains.
+ */
+static void
+ni_arp_verify_filter(ni_arp_socket_t *sock, ni_arp_verify_t *vfy)
+{
+	unsigned int hwlen = sock->dev_info.hwaddr.len;
+	unsigned int naddrs = vfy->ipaddrs.count;
+	unsigned int i, len, drop;
+	struct sock_filter *filter;
+	const ni_address_t *ap;
+
+	if (sock->filtered && !vfy->refilter)
+		return;
+
+	if (!hwlen)
+		return;
+
+	/*
+	 * [0] ar_hln matches, [2] ar_op is a reply, [4] load ar_sip,
+	 * [5..] one match per address or accept when there are too
+	 * many addresses to match, followed by drop and accept.
+	 */
+	drop = 5 + (naddrs > NI_ARP_FILTER_MAX_ADDRS ? 1 : naddrs);
+	len = drop + 2;
+	filter = xcalloc(len, sizeof(*filter));
+
+	filter[0] = (struct sock_filter)BPF_STMT(BPF_LD + BPF_B + BPF_ABS, 4);
+	filter[1] = (struct sock_filter)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, hwlen, 0, drop - 2);
+	filter[2] = (struct sock_filter)BPF_STMT(BPF_LD + BPF_H + BPF_ABS, 6);
+	filter[3] = (struct sock_filter)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, ARPOP_REPLY, 0, drop - 4);
+	filter[4] = (struct sock_filter)BPF_STMT(BPF_LD + BPF_W + BPF_ABS, 8 + hwlen);
+	if (naddrs > NI_ARP_FILTER_MAX_ADDRS) {
+		filter[5] = (struct sock_filter)BPF_STMT(BPF_RET + BPF_K, ~0U);
+	} else {
+		for (i = 0; i < naddrs; ++i) {
+			ap = vfy->ipaddrs.data[i]->address;
+			filter[5 + i] = (struct sock_filter)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					ntohl(ap->local_addr.sin.sin_addr.s_addr), drop - 5 - i, 0);
+		}
+	}
+	filter[drop] = (struct sock_filter)BPF_STMT(BPF_RET + BPF_K, 0);
+	filter[drop + 1] = (struct sock_filter)BPF_STMT(BPF_RET + BPF_K, ~0U);
+
+	if (ni_capture_attach_filter(sock->capture, filter, len) == 0) {
+		ni_debug_socket("%s: installed arp filter for %u verify addresses",
+				sock->dev_info.ifname, naddrs);
+		sock->filtered = TRUE;
+		vfy->refilter = FALSE;
+	}
+	free(filter);
+}
+
 ni_arp_send_status_t
 ni_arp_verify_send(ni_arp_socket_t *sock, ni_arp_verify_t *vfy, ni_timeout_t *timeout)
 {
@@ -445,6 +511,8 @@ ni_arp_verify_send(ni_arp_socket_t *sock, ni_arp_verify_t *vfy, ni_timeout_t *ti
 	if ((*timeout = ni_arp_timeout_left(&vfy->started, &now, vfy->last_timeout)))
 		return NI_ARP_SEND_PROGRESS;
 
+	ni_arp_verify_filter(sock, vfy);
+
 	for (i = 0; i < vfy->ipaddrs.count; ++i) {
 		vap = vfy->ipaddrs.data[i];
 		ap  = vap->address;
@@ -454,8 +522,12 @@ ni_arp_verify_send(ni_arp_socket_t *sock, ni_arp_verify_t *vfy, ni_timeout_t *ti
 		if (!ni_address_is_tentative(ap))
 			continue;
 
-		if (vap->nattempts >= vfy->nprobes)
+		if (vap->nattempts >= vfy->nprobes) {
+			ni_debug_application("%s: ARP verify of IP %s succeeded after %u probes",
+					sock->dev_info.ifname, ni_sockaddr_print(&ap->local_addr),
+					vap->nattempts);
 			ni_address_set_tentative(ap, FALSE);
+		}
 	}
 
 	need_wait = FALSE;
@@ -544,6 +616,16 @@ ni_arp_notify_destroy(ni_arp_notify_t *nfy)
 	memset(nfy, 0, sizeof(*nfy));
 }
 
+ni_bool_t
+ni_arp_notify_has_address(ni_arp_notify_t *nfy, ni_address_t *ap)
+{
+	if (!nfy || !ap)
+		return FALSE;
+
+	return !!ni_arp_address_array_find_match_addr(&nfy->ipaddrs, ap, NULL,
+			ni_address_equal_local_addr);
+}
+
 unsigned int
 ni_arp_notify_add_address(ni_arp_notify_t *nfy,  ni_address_t *ap)
 {
@@ -26,6 +26,20 @@
 #include <limits.h>
 #include <stdlib.h>
 
+/*
+ * Geometric growth of the { count, data } arrays: the allocation is
+ * resized to the array chunk size doubled until the needed entries
+ * fit, so N appends cause log2(N / chunk) reallocs instead of N / chunk.
+ * The capacity is not kept in the (public) array structs, but taken
+ * from the allocation, so entries reserved by a caller knowing the
+ * final size are used before any further resize.  New entries are
+ * zeroed and the functions return FALSE on overflow or ENOMEM.
+ */
+extern unsigned int	ni_array_capacity(unsigned int count, unsigned int chunk);
+extern ni_bool_t	ni_array_grow(void **data, size_t entsize,
+				unsigned int count, unsigned int newcount,
+				unsigned int chunk);
+
 #define			ni_define_ptr_array_init(prefix)				\
 	void										\
 	prefix##_array_init(prefix##_array_t *arr)					\
@@ -51,31 +65,22 @@
 	ni_bool_t									\
 	prefix##_array_realloc(prefix##_array_t *arr)					\
 	{										\
-		static const size_t entsize = sizeof(prefix##_t *);			\
-		prefix##_t ** newdata;							\
-		unsigned int newcount;							\
-											\
-		if (!arr)								\
+		if (!arr || arr->count == UINT_MAX)					\
 			return FALSE;							\
 											\
-		if ((arr->count % chunk_size) != 0)					\
-			return TRUE;							\
-											\
-		if ((UINT_MAX - arr->count) <= chunk_size)				\
-			return FALSE;							\
-											\
-		newcount = arr->count + chunk_size;					\
-		if (SIZE_MAX / entsize < newcount)					\
-			return FALSE;							\
-											\
-		newdata = realloc(arr->data, newcount * entsize);			\
-		if (!newdata)								\
+		return ni_array_grow((void **)&arr->data, sizeof(prefix##_t *),		\
+				arr->count, arr->count + 1, chunk_size);		\
+	}
+
+#define			ni_define_ptr_array_reserve(prefix, chunk_size)			\
+	ni_bool_t									\
+	prefix##_array_reserve(prefix##_array_t *arr, unsigned int count)		\
+	{										\
+		if (!arr || (UINT_MAX - arr->count) < count)				\
 			return FALSE;							\
 											\
-		arr->data = newdata;							\
-		memset(&arr->data[arr->count], 0, (newcount - arr->count) * entsize);	\
-											\
-		return TRUE;								\
+		return ni_array_grow((void **)&arr->data, sizeof(prefix##_t *),		\
+				arr->count, arr->count + count, chunk_size);		\
 	}
 
 #define			ni_define_ptr_array_append(prefix)				\
@@ -171,31 +171,40 @@ ni_resolve_hostname_timed(const char *hostname, int af, ni_sockaddr_t *addr, uns
 	return 1;
 }
 
+/*
+ * Resolve a batch of hostnames concurrently, returns the number of
+ * resolved addresses; the addresses of unresolved ones are cleared.
+ */
 int
 ni_resolve_hostnames_timed(int af, unsigned int count, const char *hostnames[], ni_sockaddr_t addrs[], unsigned int timeout)
 {
 	struct gaicb **cblist = NULL;
 	unsigned int i;
+	int resolved = 0;
 
 	cblist = calloc(count, sizeof(cblist[0]));
 	for (i = 0; i < count; ++i)
 		cblist[i] = gaicb_new(hostnames[i], af);
 
-	if (gaicb_list_resolve(cblist, count, NI_TIMEOUT_FROM_SEC(timeout)) < 0)
+	if (gaicb_list_resolve(cblist, count, NI_TIMEOUT_FROM_SEC(timeout)) < 0) {
+		gaicb_list_free(cblist, count);
 		return -1;
+	}
 
 	for (i = 0; i < count; ++i) {
 		struct gaicb *cb = cblist[i];
 		int gerr;
 
 		if ((gerr = gaicb_get_address(cb, &addrs[i])) != 0) {
-			ni_error("unable to resolve %s: %s", cb->ar_name, gai_strerror(gerr));
+			ni_debug_objectmodel("cannot resolve %s: %s", cb->ar_name, gai_strerror(gerr));
 			memset(&addrs[i], 0, sizeof(addrs[i]));
+		} else {
+			resolved++;
 		}
 	}
 	gaicb_list_free(cblist, count);
 
-	return 0;
+	return resolved;
 }
 
 static int
@@ -394,6 +394,40 @@ ni_auto6_is_autoconf_prefix(const ni_ipv6_ra_pinfo_t *pi)
 	return pi && pi->length == 64 && pi->autoconf;
 }
 
+/*
+ * Router advertisements of a known prefix only refresh the lifetimes
+ * of the addresses; these don't require to update the lease (and run
+ * netconfig), so we compare everything else.
+ */
+static ni_bool_t
+ni_auto6_lease_address_differs(const ni_address_t *la, const ni_address_t *ap)
+{
+	return  la->owner != ap->owner ||
+		la->flags != ap->flags ||
+		la->scope != ap->scope ||
+		la->prefixlen != ap->prefixlen ||
+		!ni_sockaddr_equal(&la->peer_addr, &ap->peer_addr) ||
+		!ni_sockaddr_equal(&la->anycast_addr, &ap->anycast_addr) ||
+		!ni_sockaddr_equal(&la->bcast_addr, &ap->bcast_addr) ||
+		!ni_string_eq(la->label, ap->label);
+}
+
+/*
+ * A lease waiting for a router advertisement (e.g. on a repeated
+ * acquire) is applied also when its data didn't change.
+ */
+static ni_bool_t
+ni_auto6_lease_needs_update(const ni_addrconf_lease_t *lease, ni_bool_t changed)
+{
+	switch (lease->state) {
+	case NI_ADDRCONF_STATE_GRANTED:
+	case NI_ADDRCONF_STATE_APPLYING:
+		return changed;
+	default:
+		return TRUE;
+	}
+}
+
 static ni_bool_t
 ni_auto6_lease_address_update(ni_netdev_t *dev, ni_addrconf_lease_t *lease, const ni_address_t *ap)
 {
@@ -413,6 +447,15 @@ ni_auto6_lease_address_update(ni_netdev_t *dev, ni_addrconf_lease_t *lease, cons
 					ni_addrfamily_type_to_name(lease->family),
 					ni_addrconf_type_to_name(lease->type),
 					ni_addrconf_type_to_name(ap->owner));
+		} else
+		if (!ni_auto6_lease_address_differs(la, ap)) {
+			la->cache_info = ap->cache_info;
+			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_IPV6|NI_TRACE_AUTOIP,
+					"%s: refreshed address %s/%u lifetimes in %s:%s lease",
+					dev->name,
+					ni_sockaddr_print(&la->local_addr), la->prefixlen,
+					ni_addrfamily_type_to_name(lease->family),
+					ni_addrconf_type_to_name(lease->type));
 		} else {
 			changed = TRUE;
 			ni_address_copy(la, ap);
@@ -439,6 +482,20 @@ ni_auto6_lease_address_update(ni_netdev_t *dev, ni_addrconf_lease_t *lease, cons
 	return changed;
 }
 
+static ni_bool_t
+ni_auto6_has_prefix_address(const ni_netdev_t *dev, const ni_ipv6_ra_pinfo_t *pi)
+{
+	const ni_address_t *ap;
+
+	for (ap = dev->addrs; ap; ap = ap->next) {
+		if (ap->family != AF_INET6 || ap->prefixlen != pi->length)
+			continue;
+		if (ni_sockaddr_prefix_match(pi->length, &pi->prefix, &ap->local_addr))
+			return TRUE;
+	}
+	return FALSE;
+}
+
 void
 ni_auto6_on_prefix_event(ni_netdev_t *dev, ni_event_t event, const ni_ipv6_ra_pinfo_t *pi)
 {
@@ -446,6 +503,7 @@ ni_auto6_on_prefix_event(ni_netdev_t *dev, ni_event_t event, const ni_ipv6_ra_pi
 	ni_addrconf_lease_t *lease;
 	ni_bool_t changed = FALSE;
 	ni_address_t *ap, *la, **pos;
+	struct timeval now;
 
 	if (!dev || !pi)
 		return;
@@ -453,6 +511,13 @@ ni_auto6_on_prefix_event(ni_netdev_t *dev, ni_event_t event, const ni_ipv6_ra_pi
 	if (!(nc = ni_global_state_handle(0)))
 		return;
 
+	/* (re)arm the expire timer to the next prefix or option expiry */
+	if (dev->ipv6) {
+		ni_timer_get_time(&now);
+		ni_auto6_expire_set_timer(ni_netdev_get_auto6(dev),
+				ni_ipv6_ra_info_expire(dev->ipv6->radv, &now));
+	}
+
 	/* boo#975020, bsc#934067 workaround
 	 * There are still many kernels in the wild that do not send
 	 * NEWLINK on IPv6 RA changes (fixed upstream in 3.x stable),
@@ -460,15 +525,17 @@ ni_auto6_on_prefix_event(ni_netdev_t *dev, ni_event_t event, const ni_ipv6_ra_pi
 	 */
 	__ni_device_refresh_ipv6_link_info(nc, dev);
 
-	/* When autonomous autoconf prefix arrives, refresh addresses
-	 * to track tentative addresses; the kernel sends the events
-	 * once it finished duplicate address detection and removed
-	 * the tentative flag or replaced by dadfailed.
+	/* When a new autonomous autoconf prefix arrives, refresh the
+	 * addresses to track tentative addresses; the kernel sends the
+	 * events once it finished duplicate address detection and removed
+	 * the tentative flag or replaced by dadfailed. Lifetime updates of
+	 * addresses we already track arrive as NEWADDR events, so periodic
+	 * router advertisements of a known prefix don't cause a dump.
 	 */
-	if (ni_auto6_is_autoconf_prefix(pi))
-		__ni_system_refresh_interface_addrs(nc, dev);
-	else
+	if (!ni_auto6_is_autoconf_prefix(pi))
 		return;
+	if (!ni_auto6_has_prefix_address(dev, pi))
+		__ni_system_refresh_interface_addrs(nc, dev);
 
 	if (dev->auto6 && !dev->auto6->enabled)
 		return;
@@ -504,6 +571,7 @@ ni_auto6_on_prefix_event(ni_netdev_t *dev, ni_event_t event, const ni_ipv6_ra_pi
 			if (ni_auto6_lease_address_update(dev, lease, ap))
 				changed = TRUE;
 		}
+		changed = ni_auto6_lease_needs_update(lease, changed);
 		break;
 
 	case NI_EVENT_PREFIX_DELETE:
@@ -551,7 +619,9 @@ ni_auto6_on_address_event(ni_netdev_t *dev, ni_event_t event, const ni_address_t
 		return;
 
 	if (ni_sockaddr_is_ipv6_linklocal(&ap->local_addr)) {
-		__ni_system_refresh_interface_addrs(ni_global_state_handle(0), dev);
+		/* a (tentative) replacement is not reported by events */
+		if (!ni_auto6_get_linklocal(dev))
+			__ni_system_refresh_interface_addrs(ni_global_state_handle(0), dev);
 		if (!ni_auto6_get_linklocal(dev)) {
 			ni_auto6_release(dev, FALSE);
 		}
@@ -571,6 +641,7 @@ ni_auto6_on_address_event(ni_netdev_t *dev, ni_event_t event, const ni_address_t
 	case NI_EVENT_ADDRESS_UPDATE:
 		if (ni_auto6_lease_address_update(dev, lease, ap))
 			changed = TRUE;
+		changed = ni_auto6_lease_needs_update(lease, changed);
 		break;
 
 	case NI_EVENT_ADDRESS_DELETE:
@@ -636,7 +707,8 @@ ni_auto6_lease_rdnss_update(ni_netdev_t *dev, ni_addrconf_lease_t *lease)
 		}
 		return changed;
 	}
-	for (rdnss = dev->ipv6->radv.rdnss; rdnss; rdnss = rdnss->next) {
+	rdnss = dev->ipv6->radv ? dev->ipv6->radv->rdnss : NULL;
+	for ( ; rdnss; rdnss = rdnss->next) {
 		const char *ptr;
 		unsigned int i;
 
@@ -692,7 +764,8 @@ ni_auto6_lease_dnssl_update(ni_netdev_t *dev, ni_addrconf_lease_t *lease)
 		}
 		return changed;
 	}
-	for (dnssl = dev->ipv6->radv.dnssl; dnssl; dnssl = dnssl->next) {
+	dnssl = dev->ipv6->radv ? dev->ipv6->radv->dnssl : NULL;
+	for ( ; dnssl; dnssl = dnssl->next) {
 		const char *ptr;
 		unsigned int i;
 
@@ -750,13 +823,14 @@ ni_auto6_on_nduseropt_events(ni_netdev_t *dev, ni_event_t event)
 	case NI_EVENT_RDNSS_UPDATE:
 	case NI_EVENT_DNSSL_UPDATE:
 		ni_timer_get_time(&now);
-		lifetime = ni_ipv6_ra_info_expire(&dev->ipv6->radv, &now);
+		lifetime = ni_ipv6_ra_info_expire(dev->ipv6->radv, &now);
 		ni_auto6_expire_set_timer(ni_netdev_get_auto6(dev), lifetime);
 		/* we expire both, so also update both in the lease */
 		if (ni_auto6_lease_rdnss_update(dev, lease))
 			changed = TRUE;
 		if (ni_auto6_lease_dnssl_update(dev, lease))
 			changed = TRUE;
+		changed = ni_auto6_lease_needs_update(lease, changed);
 		break;
 
 	default:
@@ -797,7 +871,8 @@ ni_auto6_expire_update_lease(ni_netdev_t *dev)
 		break;
 	}
 
-	if (dev->ipv6 && (dev->ipv6->radv.rdnss || dev->ipv6->radv.dnssl)) {
+	if (dev->ipv6 && dev->ipv6->radv &&
+	    (dev->ipv6->radv->rdnss || dev->ipv6->radv->dnssl)) {
 		if (ni_auto6_lease_rdnss_update(dev, lease))
 			changed = TRUE;
 		if (ni_auto6_lease_dnssl_update(dev, lease))
@@ -835,7 +910,7 @@ ni_auto6_expire_timeout(void *user_data, const ni_timer_t *timer)
 		return;
 
 	ni_timer_get_time(&now);
-	lifetime = ni_ipv6_ra_info_expire(&dev->ipv6->radv, &now);
+	lifetime = ni_ipv6_ra_info_expire(dev->ipv6->radv, &now);
 	ni_auto6_expire_set_timer(ni_netdev_get_auto6(dev), lifetime);
 	ni_auto6_expire_update_lease(dev);
 }
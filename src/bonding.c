@@ -16,6 +16,7 @@
 #include <wicked/bonding.h>
 #include "netinfo_priv.h"
 #include "util_priv.h"
+#include "array_priv.h"
 #include "sysfs.h"
 #include "modprobe.h"
 
@@ -1718,27 +1719,21 @@ ni_bonding_slave_array_init(ni_bonding_slave_array_t *array)
 	memset(array, 0, sizeof(*array));
 }
 
-static void
-ni_bonding_slave_array_realloc(ni_bonding_slave_array_t *array, unsigned int newsize)
+static ni_bool_t
+ni_bonding_slave_array_realloc(ni_bonding_slave_array_t *array, unsigned int newcount)
 {
-	ni_bonding_slave_t **newdata;
-	unsigned int i;
-
-	newsize += NI_BONDING_SLAVE_ARRAY_CHUNK;
-	newdata = xrealloc(array->data, newsize * sizeof(ni_bonding_slave_t *));
-	array->data = newdata;
-	for (i = array->count; i < newsize; ++i)
-		array->data[i] = NULL;
+	return ni_array_grow((void **)&array->data, sizeof(ni_bonding_slave_t *),
+				array->count, newcount, NI_BONDING_SLAVE_ARRAY_CHUNK);
 }
 
 ni_bool_t
 ni_bonding_slave_array_append(ni_bonding_slave_array_t *array, ni_bonding_slave_t *slave)
 {
-	if (!array || !slave)
+	if (!array || !slave || array->count == UINT_MAX)
 		return FALSE;
 
-	if ((array->count % NI_BONDING_SLAVE_ARRAY_CHUNK) == 0)
-		ni_bonding_slave_array_realloc(array, array->count);
+	if (!ni_bonding_slave_array_realloc(array, array->count + 1))
+		return FALSE;
 
 	array->data[array->count++] = slave;
 	return TRUE;
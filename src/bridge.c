@@ -12,6 +12,7 @@
 #include <wicked/xml.h>
 #include "netinfo_priv.h"
 #include "util_priv.h"
+#include "array_priv.h"
 #include "limits.h"
 
 #define NI_BRIDGE_PORT_ARRAY_CHUNK	16
@@ -45,11 +46,18 @@ ni_bridge_port_t *
 ni_bridge_port_clone(const ni_bridge_port_t *src)
 {
 	ni_bridge_port_t *dst;
+	unsigned int i;
 
 	if (src) {
 		dst = ni_bridge_port_new(NULL, src->ifname, src->ifindex);
 		dst->priority = src->priority;
 		dst->path_cost = src->path_cost;
+		for (i = 0; i < src->vlans.count; ++i) {
+			const ni_bridge_port_vlan_t *vlan = &src->vlans.data[i];
+
+			ni_bridge_port_vlan_array_append(&dst->vlans, vlan->vid_begin,
+					vlan->vid_end, vlan->pvid, vlan->untagged);
+		}
 		return dst;
 	}
 	return NULL;
@@ -59,10 +67,85 @@ void
 ni_bridge_port_free(ni_bridge_port_t *port)
 {
 	ni_string_free(&port->ifname);
+	ni_bridge_port_vlan_array_destroy(&port->vlans);
 	ni_bridge_port_status_destroy(&port->status);
 	free(port);
 }
 
+/*
+ * Port VLAN membership
+ */
+#define NI_BRIDGE_PORT_VLAN_ARRAY_CHUNK	8
+
+ni_bool_t
+ni_bridge_port_vlan_array_append(ni_bridge_port_vlan_array_t *array,
+		unsigned int vid_begin, unsigned int vid_end,
+		ni_bool_t pvid, ni_bool_t untagged)
+{
+	ni_bridge_port_vlan_t *vlan;
+
+	if (!array)
+		return FALSE;
+
+	if (array->count == UINT_MAX ||
+	    !ni_array_grow((void **)&array->data, sizeof(*array->data),
+			array->count, array->count + 1, NI_BRIDGE_PORT_VLAN_ARRAY_CHUNK))
+		return FALSE;
+
+	vlan = &array->data[array->count++];
+	vlan->vid_begin = vid_begin;
+	vlan->vid_end = vid_end;
+	vlan->pvid = pvid;
+	vlan->untagged = untagged;
+	return TRUE;
+}
+
+void
+ni_bridge_port_vlan_array_destroy(ni_bridge_port_vlan_array_t *array)
+{
+	if (array) {
+		free(array->data);
+		memset(array, 0, sizeof(*array));
+	}
+}
+
+/*
+ * Parse a VLAN ID ("100") or a range of VLAN IDs ("100-200")
+ */
+ni_bool_t
+ni_bridge_port_vlan_parse(const char *str, unsigned int *vid_begin, unsigned int *vid_end)
+{
+	char *beg = NULL, *end;
+	ni_bool_t ret = FALSE;
+
+	if (!str || !vid_begin || !vid_end || !ni_string_dup(&beg, str))
+		return FALSE;
+
+	if ((end = strchr(beg, '-')))
+		*end++ = '\0';
+
+	if (ni_parse_uint(beg, vid_begin, 10) == 0) {
+		if (!end)
+			*vid_end = *vid_begin;
+		ret = !end || ni_parse_uint(end, vid_end, 10) == 0;
+	}
+	free(beg);
+	return ret;
+}
+
+const char *
+ni_bridge_port_vlan_format(const ni_bridge_port_vlan_t *vlan, ni_stringbuf_t *buf)
+{
+	if (!vlan || !buf)
+		return NULL;
+
+	if (vlan->vid_begin == vlan->vid_end)
+		ni_stringbuf_printf(buf, "%u", vlan->vid_begin);
+	else
+		ni_stringbuf_printf(buf, "%u-%u", vlan->vid_begin, vlan->vid_end);
+	return buf->string;
+}
+
 static void
 ni_bridge_port_array_init(ni_bridge_port_array_t *array)
 {
@@ -79,23 +162,17 @@ ni_bridge_port_array_destroy(ni_bridge_port_array_t *array)
 }
 
 static void
-__ni_bridge_port_array_realloc(ni_bridge_port_array_t *array, unsigned int newsize)
+__ni_bridge_port_array_realloc(ni_bridge_port_array_t *array, unsigned int newcount)
 {
-	ni_bridge_port_t **newdata;
-	unsigned int i;
-
-	newsize = (newsize + NI_BRIDGE_PORT_ARRAY_CHUNK);
-	newdata = xrealloc(array->data, newsize * sizeof(ni_bridge_port_t));
-	array->data = newdata;
-	for (i = array->count; i < newsize; ++i)
-		array->data[i] = NULL;
+	if (!ni_array_grow((void **)&array->data, sizeof(ni_bridge_port_t *),
+				array->count, newcount, NI_BRIDGE_PORT_ARRAY_CHUNK))
+		ni_fatal("allocation failed for %u bridge port array entries", newcount);
 }
 
 static int
 __ni_bridge_port_array_append(ni_bridge_port_array_t *array, ni_bridge_port_t *port)
 {
-	if ((array->count % NI_BRIDGE_PORT_ARRAY_CHUNK) == 0)
-		__ni_bridge_port_array_realloc(array, array->count);
+	__ni_bridge_port_array_realloc(array, array->count + 1);
 
 	array->data[array->count++] = port;
 	return 0;
@@ -239,6 +316,7 @@ __ni_bridge_init(ni_bridge_t *bridge)
 	bridge->hello_time = NI_BRIDGE_VALUE_NOT_SET;
 	bridge->max_age = NI_BRIDGE_VALUE_NOT_SET;
 	bridge->priority = NI_BRIDGE_VALUE_NOT_SET;
+	bridge->vlan_filtering = NI_TRISTATE_DEFAULT;
 }
 
 ni_bridge_t *
@@ -355,9 +433,14 @@ ni_bridge_ports_destroy(ni_bridge_t *bridge)
 
 #define NI_BRIDGE_PORT_MAX_COUNT	1024
 
+#define NI_BRIDGE_PORT_VLAN_ID_MIN	1
+#define NI_BRIDGE_PORT_VLAN_ID_MAX	4094
+
 const char *
 ni_bridge_port_validate(const ni_bridge_port_t *port)
 {
+	unsigned int i, pvid = 0;
+
 	if (!port || !port->ifname)
 		return "uninitialized port configuration";
 
@@ -370,6 +453,22 @@ ni_bridge_port_validate(const ni_bridge_port_t *port)
 	    port->path_cost > NI_BRIDGE_PORT_PATH_COST_MAX))
 		return "bridge port priority is out of supported range (0-65535)";
 
+	for (i = 0; i < port->vlans.count; ++i) {
+		const ni_bridge_port_vlan_t *vlan = &port->vlans.data[i];
+
+		if (vlan->vid_begin < NI_BRIDGE_PORT_VLAN_ID_MIN ||
+		    vlan->vid_end > NI_BRIDGE_PORT_VLAN_ID_MAX ||
+		    vlan->vid_begin > vlan->vid_end)
+			return "bridge port vlan id is out of supported range (1-4094)";
+
+		if (vlan->pvid) {
+			if (vlan->vid_begin != vlan->vid_end)
+				return "bridge port pvid has to be a single vlan id";
+			if (pvid++)
+				return "bridge port has more than one pvid";
+		}
+	}
+
 	return NULL;
 }
 
@@ -124,6 +124,73 @@ ni_call_get_netif_list_object(void)
 	return list_object;
 }
 
+/*
+ * Refresh the interface proxies of the Wicked.InterfaceList object.
+ * The interfaces are retrieved in pages, to keep the size of the
+ * messages down on systems with many interfaces.
+ */
+#define NI_CALL_NETIF_LIST_PAGE_SIZE	64
+
+dbus_bool_t
+ni_call_refresh_netif_list(ni_dbus_object_t *list_object)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	dbus_bool_t rv;
+
+	if (!list_object)
+		return FALSE;
+
+	rv = ni_dbus_object_get_managed_objects_paged(list_object,
+			NI_OBJECTMODEL_NETIFLIST_INTERFACE, "getManagedObjects",
+			NI_CALL_NETIF_LIST_PAGE_SIZE, &error);
+	if (!rv) {
+		/* e.g. a server not supporting it yet */
+		ni_debug_dbus("%s.getManagedObjects failed (%s), using GetManagedObjects",
+				list_object->path, error.message);
+		rv = ni_dbus_object_refresh_children(list_object);
+	}
+	dbus_error_free(&error);
+	return rv;
+}
+
+/*
+ * Delete a set of virtual devices with one InterfaceList.deleteDevices
+ * call, returning the indexes of the deleted devices.
+ */
+dbus_bool_t
+ni_call_delete_devices(ni_dbus_object_t *list_object, const ni_uint_array_t *ifindexes,
+			ni_uint_array_t *deleted)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_variant_t arg = NI_DBUS_VARIANT_INIT;
+	ni_dbus_variant_t res = NI_DBUS_VARIANT_INIT;
+	dbus_bool_t rv;
+	unsigned int i;
+
+	if (!list_object || !ifindexes || !deleted)
+		return FALSE;
+
+	ni_dbus_variant_init_uint32_array(&arg);
+	for (i = 0; i < ifindexes->count; ++i)
+		ni_dbus_variant_append_uint32_array(&arg, ifindexes->data[i]);
+
+	rv = ni_dbus_object_call_variant(list_object, NI_OBJECTMODEL_NETIFLIST_INTERFACE,
+					"deleteDevices", 1, &arg, 1, &res, &error);
+	if (rv && ni_dbus_variant_is_uint32_array(&res)) {
+		for (i = 0; i < res.array.len; ++i)
+			ni_uint_array_append(deleted, res.uint32_array_value[i]);
+	} else
+	if (!rv) {
+		/* e.g. a server not supporting it yet */
+		ni_debug_dbus("%s.deleteDevices failed (%s)", list_object->path, error.message);
+		dbus_error_free(&error);
+	}
+
+	ni_dbus_variant_destroy(&arg);
+	ni_dbus_variant_destroy(&res);
+	return rv;
+}
+
 /*
  * Obtain an object handle for Wicked.Modem
  */
@@ -332,6 +399,26 @@ ni_call_device_new_xml(const ni_dbus_service_t *service,
 	return result;
 }
 
+static int
+ni_call_device_method_error(const ni_dbus_service_t *service, const ni_dbus_method_t *method,
+				const DBusError *error, ni_call_error_context_t *error_ctx)
+{
+	int rv;
+
+	if (error_ctx && error_ctx->handler) {
+		rv = error_ctx->handler(error_ctx, error);
+		if (rv > 0) {
+			ni_warn("Whaaah. Error context handler returns positive code. "
+				"Assuming programmer mistake");
+			rv = -rv;
+		}
+	} else {
+		ni_dbus_print_error(error, "%s.%s() failed", service->name, method->name);
+		rv = ni_dbus_get_error(error, NULL);
+	}
+	return rv;
+}
+
 /*
  * Place a generic call to a device. This call will optionally return a
  * callback list.
@@ -351,18 +438,7 @@ ni_call_device_method_common(ni_dbus_object_t *object,
 				argc, argv,
 				1, &result,
 				&error)) {
-
-		if (error_ctx && error_ctx->handler) {
-			rv = error_ctx->handler(error_ctx, &error);
-			if (rv > 0) {
-				ni_warn("Whaaah. Error context handler returns positive code. "
-					"Assuming programmer mistake");
-				rv = -rv;
-			}
-		} else {
-			ni_dbus_print_error(&error, "%s.%s() failed", service->name, method->name);
-			rv = ni_dbus_get_error(&error, NULL);
-		}
+		rv = ni_call_device_method_error(service, method, &error, error_ctx);
 	} else {
 		if (callback_list)
 			*callback_list = ni_objectmodel_callback_info_from_dict(&result);
@@ -424,6 +500,81 @@ out:
 	return rv;
 }
 
+/*
+ * Asynchronous variant of ni_call_common_xml: the reply is passed to
+ * the callback, which evaluates it using ni_call_common_xml_result.
+ */
+int
+ni_call_common_xml_async(ni_dbus_object_t *object, const ni_dbus_service_t *service,
+			const ni_dbus_method_t *method, xml_node_t *config,
+			ni_dbus_async_callback_t *callback, uint32_t *serial)
+{
+	ni_dbus_variant_t argv[1];
+	int rv, argc = 0;
+
+	memset(argv, 0, sizeof(argv));
+	if (ni_dbus_xml_method_num_args(method)) {
+		ni_dbus_variant_t *dict = &argv[argc++];
+
+		ni_dbus_variant_init_dict(dict);
+		if (config && !ni_dbus_xml_serialize_arg(method, 0, dict, config)) {
+			ni_error("%s.%s: error serializing argument", service->name, method->name);
+			rv = -NI_ERROR_CANNOT_MARSHAL;
+			goto out;
+		}
+	}
+
+	rv = ni_dbus_object_call_variant_async(object, service->name, method->name,
+				argc, argv, callback, serial);
+
+out:
+	while (argc--)
+		ni_dbus_variant_destroy(&argv[argc]);
+	return rv;
+}
+
+int
+ni_call_common_xml_result(ni_dbus_object_t *object, const ni_dbus_service_t *service,
+			const ni_dbus_method_t *method, xml_node_t *config,
+			ni_dbus_message_t *reply, ni_objectmodel_callback_info_t **callback_list,
+			ni_call_error_handler_t *error_handler)
+{
+	ni_call_error_context_t error_context = NI_CALL_ERROR_CONTEXT_INIT(error_handler, config);
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	int rv = 0;
+
+	if (!reply) {
+		dbus_set_error(&error, DBUS_ERROR_NO_REPLY, "%s.%s(): no reply",
+				service->name, method->name);
+	} else
+	if (dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR) {
+		dbus_set_error_from_message(&error, reply);
+	} else
+	if (ni_dbus_message_get_args_variants(reply, &result, 1) < 0) {
+		dbus_set_error(&error, DBUS_ERROR_FAILED, "%s: unable to parse %s() response",
+				__func__, method->name);
+	}
+
+	if (dbus_error_is_set(&error)) {
+		rv = ni_call_device_method_error(service, method, &error, &error_context);
+	} else if (callback_list) {
+		*callback_list = ni_objectmodel_callback_info_from_dict(&result);
+	}
+
+	/* The error handler fixed up the config, e.g. prompted for a missing
+	 * passphrase -- repeat the call synchronously with the new config. */
+	if (rv == -NI_ERROR_RETRY_OPERATION && error_context.config) {
+		rv = ni_call_common_xml(object, service, method, error_context.config,
+				callback_list, error_handler);
+	}
+
+	ni_call_error_context_destroy(&error_context);
+	ni_dbus_variant_destroy(&result);
+	dbus_error_free(&error);
+	return rv;
+}
+
 static int
 ni_get_device_method(ni_dbus_object_t *object, const char *method_name, const ni_dbus_service_t **service_ret, const ni_dbus_method_t **method_ret)
 {
@@ -30,6 +30,7 @@
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/mman.h>
 
 #include <linux/filter.h>
 #define bpf_insn sock_filter
@@ -40,12 +41,17 @@
 #include <netpacket/packet.h>
 #endif
 
+#if defined(PACKET_RX_RING) && defined(TPACKET3_HDRLEN)
+#define NI_CAPTURE_RX_RING	1
+#endif
+
 #include <wicked/logging.h>
 #include <wicked/socket.h>
 #include "netinfo_priv.h"
 #include "socket_priv.h"
 #include "modprobe.h"
 #include "buffer.h"
+#include "appconfig.h"
 
 #define MTU_MAX			1500
 #define DHCP_CLIENT_PORT	68
@@ -57,6 +63,15 @@
 #define	AFPACKET_MODULE_NAME	"af_packet"
 #define AFPACKET_MODULE_OPTS	NULL
 
+/*
+ * TPACKET_V3 receive ring geometry: the kernel fills the frames of
+ * a block and passes it to us when full or after the retire timeout.
+ */
+#define RX_RING_BLOCK_SIZE	(1U << 14)
+#define RX_RING_BLOCK_NR	4U
+#define RX_RING_FRAME_SIZE	(1U << 11)
+#define RX_RING_RETIRE_TOV	10	/* msec */
+
 /* in case we have old headers files */
 #if defined(PACKET_AUXDATA) && !defined(HAVE_STRUCT_TPACKET_AUXDATA)
 struct tpacket_auxdata {
@@ -70,6 +85,34 @@ struct tpacket_auxdata {
 };
 #endif
 
+#if defined(PACKET_AUXDATA) && !defined(TP_STATUS_CSUM_VALID)
+#define TP_STATUS_CSUM_VALID	(1 << 7)
+#endif
+
+/*
+ * Checksum state of a received packet as reported by the kernel:
+ * partial are locally sent packets using tx checksum offload, valid
+ * packets with a checksum validated by the nic (rx offload) or kernel.
+ */
+typedef enum {
+	NI_CAPTURE_CSUM_UNKNOWN = 0,
+	NI_CAPTURE_CSUM_PARTIAL,
+	NI_CAPTURE_CSUM_VALID,
+} ni_capture_csum_t;
+
+static const char *
+ni_capture_csum_hint(ni_capture_csum_t csum)
+{
+	switch (csum) {
+	case NI_CAPTURE_CSUM_PARTIAL:
+		return " with partial checksum";
+	case NI_CAPTURE_CSUM_VALID:
+		return " with valid checksum";
+	default:
+		return "";
+	}
+}
+
 /*
  * Credit where credit is due :)
  * The below BPF filter is taken from ISC DHCP
@@ -123,43 +166,114 @@ struct ni_capture {
 	void *			buffer;
 	size_t			mtu;
 
+	struct {
+		unsigned char *		map;
+		size_t			map_len;
+		unsigned int		block_cur;	/* block to take next	*/
+		void *			block;		/* block we hold	*/
+		void *			frame;		/* next frame in block	*/
+		unsigned int		frames;		/* frames left in block	*/
+		void			(*receive)(ni_socket_t *);
+	} ring;
+
 	struct {
 		struct timeval		deadline;
 		const ni_buffer_t *	buffer;
 		ni_timeout_param_t	timeout;
 	} retrans;
 
+	struct {
+		ni_capture_t *		master;		/* shared socket owner	*/
+		ni_capture_t *		next;		/* in ifindex bucket	*/
+		ni_bool_t		pending;	/* received packet	*/
+		ni_buffer_t		buffer;
+		ni_sockaddr_t		from;
+		unsigned int		checked;	/* timeout check round	*/
+	} member;
+
+	struct {
+		ni_capture_t *		next;		/* in shared list	*/
+		ni_capture_protinfo_t	protinfo;
+		ni_capture_t **		members;
+		unsigned int		count;
+		unsigned int		round;
+		ni_capture_t *		owner;		/* of fanout sibling	*/
+		ni_capture_t **		fanout;		/* fanout siblings	*/
+		unsigned int		nfanout;
+	} shared;
+
+	ni_capture_stats_t	stats;
+
 	void *			user_data;
 	char *			desc;
 };
 
+#define NI_CAPTURE_SHARED_BUCKETS	64
+
+static ni_capture_t *	ni_capture_shared_list;
+
 static int		ni_capture_set_filter(ni_capture_t *, const ni_capture_protinfo_t *);
+
+static inline int
+ni_capture_fd(const ni_capture_t *capture)
+{
+	if (capture->member.master)
+		return capture->member.master->sock->__fd;
+	return capture->sock->__fd;
+}
+
 static ssize_t		ni_capture_send_buf(const ni_capture_t *, const ni_buffer_t *);
 
+/*
+ * RFC 1071 internet checksum: the one's complement sum is independent
+ * of the byte order and can be computed using wider words, so we add
+ * 32bit words to a 64bit accumulator and fold it to 16bit at the end
+ * instead to add one 16bit word after another.
+ */
 static uint32_t
 checksum_partial(uint32_t sum, const void *data, uint16_t len)
 {
-	union {
-		const uint16_t *s;
-		const uint8_t *c;
-	} u;
-
-	u.s = data;
-	while (len > 1) {
-		sum += *u.s++;
-		len -= 2;
+	const uint8_t *ptr = data;
+	uint64_t acc = sum;
+	uint32_t w[4];
+	uint16_t s;
+
+	while (len >= sizeof(w)) {
+		memcpy(w, ptr, sizeof(w));
+		acc += w[0];
+		acc += w[1];
+		acc += w[2];
+		acc += w[3];
+		ptr += sizeof(w);
+		len -= sizeof(w);
+	}
+	while (len >= sizeof(w[0])) {
+		memcpy(w, ptr, sizeof(w[0]));
+		acc += w[0];
+		ptr += sizeof(w[0]);
+		len -= sizeof(w[0]);
+	}
+	if (len >= sizeof(s)) {
+		memcpy(&s, ptr, sizeof(s));
+		acc += s;
+		ptr += sizeof(s);
+		len -= sizeof(s);
 	}
-
 	if (len == 1) {
 		union {
 			uint8_t c[2];
 			uint16_t s;
 		} bs;
-		bs.c[0] = u.c[0];
+		bs.c[0] = ptr[0];
 		bs.c[1] = 0;
-		sum += bs.s;
+		acc += bs.s;
 	}
-	return sum;
+
+	acc = (acc >> 32) + (acc & 0xffffffffU);
+	acc = (acc >> 32) + (acc & 0xffffffffU);
+	acc = (acc >> 16) + (acc & 0xffffU);
+	acc = (acc >> 16) + (acc & 0xffffU);
+	return acc;
 }
 
 static inline uint16_t
@@ -260,9 +374,42 @@ ni_capture_build_udp_header(ni_buffer_t *bp,
 	return 0;
 }
 
+/*
+ * Patch a 16bit field at an even payload offset of a packet built by
+ * ni_capture_build_udp_header and update the udp checksum incremental
+ * (RFC 1624) instead to recompute it over the whole packet payload.
+ */
+int
+ni_capture_patch_udp_payload16(ni_buffer_t *bp, size_t offset, uint16_t value)
+{
+	const size_t hlen = sizeof(struct ip) + sizeof(struct udphdr);
+	struct udphdr *udp;
+	unsigned char *ptr;
+	uint16_t old;
+	uint32_t sum;
+
+	if (!bp || (offset & 1) || ni_buffer_count(bp) < hlen + offset + sizeof(value))
+		return -1;
+
+	ptr = ni_buffer_head(bp);
+	udp = (struct udphdr *)(ptr + sizeof(struct ip));
+	ptr += hlen + offset;
+
+	memcpy(&old, ptr, sizeof(old));
+	if (old == value)
+		return 0;
+
+	memcpy(ptr, &value, sizeof(value));
+	sum  = (uint16_t)~udp->uh_sum;
+	sum += (uint16_t)~old;
+	sum += value;
+	udp->uh_sum = checksum_fold(sum);
+	return 0;
+}
+
 static void *
 ni_capture_inspect_udp_header(void *data, size_t bytes, size_t *payload_len,
-				ni_bool_t partial_checksum)
+				ni_capture_csum_t csum, ni_capture_stats_t *stats)
 {
 	struct ip *iph = data;
 	struct udphdr *uh;
@@ -272,21 +419,25 @@ ni_capture_inspect_udp_header(void *data, size_t bytes, size_t *payload_len,
 	ihl = iph->ip_hl << 2;
 	if (iph->ip_v != 4 || ihl < 20) {
 		ni_debug_socket("bad IP header, ignoring");
+		stats->bad_header++;
 		return NULL;
 	}
 
 	if (bytes < ihl) {
 		ni_debug_socket("truncated IP header, ignoring");
+		stats->bad_header++;
 		return NULL;
 	}
 
 	if (checksum(iph, ihl) != 0) {
 		ni_debug_socket("bad IP header checksum, ignoring");
+		stats->bad_checksum++;
 		return NULL;
 	}
 
 	if (bytes < ip_len) {
 		ni_debug_socket("truncated IP packet, ignoring");
+		stats->bad_header++;
 		return NULL;
 	}
 
@@ -300,11 +451,13 @@ ni_capture_inspect_udp_header(void *data, size_t bytes, size_t *payload_len,
 
 	if (iph->ip_p != IPPROTO_UDP) {
 		ni_debug_socket("unexpected IP protocol, ignoring");
+		stats->bad_header++;
 		return NULL;
 	}
 
 	if (bytes < sizeof(*uh)) {
 		ni_debug_socket("truncated IP packet, ignoring");
+		stats->bad_header++;
 		return NULL;
 	}
 
@@ -312,10 +465,28 @@ ni_capture_inspect_udp_header(void *data, size_t bytes, size_t *payload_len,
 	data += sizeof(*uh);
 	bytes -= sizeof(*uh);
 
-	if (!partial_checksum && uh->uh_sum &&
-		ipudp_checksum(iph, uh, data, bytes) != uh->uh_sum) {
-		ni_debug_socket("bad UDP checksum, ignoring");
-		return NULL;
+	/*
+	 * Verify the udp checksum unless the kernel reports it as not
+	 * ready (tx offload) or as already validated (rx offload).
+	 */
+	switch (csum) {
+	case NI_CAPTURE_CSUM_PARTIAL:
+		stats->csum_partial++;
+		break;
+	case NI_CAPTURE_CSUM_VALID:
+		stats->csum_valid++;
+		break;
+	default:
+		if (!uh->uh_sum)
+			break;
+
+		stats->csum_verified++;
+		if (ipudp_checksum(iph, uh, data, bytes) != uh->uh_sum) {
+			ni_debug_socket("bad UDP checksum, ignoring");
+			stats->bad_checksum++;
+			return NULL;
+		}
+		break;
 	}
 
 	*payload_len = ip_len;
@@ -414,11 +585,63 @@ ni_capture_socket_check_timeout(ni_socket_t *sock, const struct timeval *now)
 		ni_capture_retransmit(capture);
 }
 
+/*
+ * Timeouts of the members of a shared capture socket
+ */
+static int
+ni_capture_shared_get_timeout(const ni_socket_t *sock, struct timeval *tv)
+{
+	ni_capture_t *master, *member;
+	unsigned int i;
+
+	timerclear(tv);
+	if (!(master = sock->user_data))
+		return -1;
+
+	for (i = 0; i < NI_CAPTURE_SHARED_BUCKETS; ++i) {
+		for (member = master->shared.members[i]; member; member = member->member.next) {
+			if (!timerisset(&member->retrans.deadline))
+				continue;
+			if (!timerisset(tv) || timercmp(&member->retrans.deadline, tv, <))
+				*tv = member->retrans.deadline;
+		}
+	}
+	return timerisset(tv)? 0 : -1;
+}
+
+static void
+ni_capture_shared_check_timeout(ni_socket_t *sock, const struct timeval *now)
+{
+	ni_capture_t *master, *member;
+	unsigned int i, round;
+
+	if (!(master = sock->user_data))
+		return;
+
+	/* the retransmit callbacks may close members, thus restart
+	 * the scan after each retransmit, skipping checked members */
+	round = ++master->shared.round;
+restart:
+	for (i = 0; i < NI_CAPTURE_SHARED_BUCKETS; ++i) {
+		for (member = master->shared.members[i]; member; member = member->member.next) {
+			if (member->member.checked == round)
+				continue;
+			member->member.checked = round;
+
+			if (timerisset(&member->retrans.deadline) &&
+			    timercmp(&member->retrans.deadline, now, <)) {
+				ni_capture_retransmit(member);
+				goto restart;
+			}
+		}
+	}
+}
+
 /*
  * Capture receive handling
  */
 static int
-ni_capture_recv_raw(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_sockaddr_t *from)
+ni_capture_recv_raw(int fd, void *buf, size_t len, ni_capture_csum_t *csum, ni_sockaddr_t *from)
 {
 #if defined(PACKET_AUXDATA)
 	/* use 2 times bigger buffer to catch possible additions... */
@@ -439,7 +662,7 @@ ni_capture_recv_raw(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_s
 	struct tpacket_auxdata *aux;
 	ssize_t bytes;
 
-	*partial_csum = FALSE;
+	*csum = NI_CAPTURE_CSUM_UNKNOWN;
 	memset(cbuf, 0, sizeof(cbuf));
 	if (from)
 		memset(from, 0, sizeof(*from));
@@ -453,14 +676,17 @@ ni_capture_recv_raw(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_s
 		    cmsg->cmsg_len >= CMSG_LEN(sizeof(struct tpacket_auxdata))) {
 			aux = (void *)CMSG_DATA(cmsg);
 			if (aux->tp_status & TP_STATUS_CSUMNOTREADY)
-				*partial_csum = TRUE;
+				*csum = NI_CAPTURE_CSUM_PARTIAL;
+			else
+			if (aux->tp_status & TP_STATUS_CSUM_VALID)
+				*csum = NI_CAPTURE_CSUM_VALID;
 			break;
 		}
 	}
 
 	return bytes;
 #else
-	*partial_csum = FALSE;
+	*csum = NI_CAPTURE_CSUM_UNKNOWN;
 
 	return read(fd, buf, len);
 #endif
@@ -493,18 +719,197 @@ ni_capture_from_hwaddr_print(const ni_sockaddr_t *from)
 	return ni_link_address_print(&hwaddr);
 }
 
+/*
+ * TPACKET_V3 receive ring handling
+ */
+#if defined(NI_CAPTURE_RX_RING)
+static ni_bool_t
+ni_capture_ring_open(ni_capture_t *capture, int fd)
+{
+	struct tpacket_req3 req;
+	int version = TPACKET_V3;
+	void *map;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		ni_debug_socket("%s: cannot use TPACKET_V3 packet ring: %m", capture->ifname);
+		return FALSE;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = RX_RING_BLOCK_SIZE;
+	req.tp_block_nr = RX_RING_BLOCK_NR;
+	req.tp_frame_size = RX_RING_FRAME_SIZE;
+	req.tp_frame_nr = (RX_RING_BLOCK_SIZE / RX_RING_FRAME_SIZE) * RX_RING_BLOCK_NR;
+	req.tp_retire_blk_tov = RX_RING_RETIRE_TOV;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+		ni_debug_socket("%s: cannot setup packet receive ring: %m", capture->ifname);
+		goto reset;
+	}
+
+	map = mmap(NULL, (size_t)req.tp_block_size * req.tp_block_nr,
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		ni_debug_socket("%s: cannot map packet receive ring: %m", capture->ifname);
+		memset(&req, 0, sizeof(req));
+		setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req));
+		goto reset;
+	}
+
+	capture->ring.map = map;
+	capture->ring.map_len = (size_t)req.tp_block_size * req.tp_block_nr;
+	capture->ring.block_cur = 0;
+	return TRUE;
+
+reset:
+	version = TPACKET_V1;
+	setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version));
+	return FALSE;
+}
+
+static void
+ni_capture_ring_close(ni_capture_t *capture)
+{
+	if (capture->ring.map)
+		munmap(capture->ring.map, capture->ring.map_len);
+	memset(&capture->ring, 0, sizeof(capture->ring));
+}
+
+/*
+ * Return the held block to the kernel
+ */
+static void
+ni_capture_ring_release(ni_capture_t *capture)
+{
+	struct tpacket_block_desc *block;
+
+	if (!(block = capture->ring.block))
+		return;
+
+	__sync_synchronize();
+	block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+	capture->ring.block = NULL;
+	capture->ring.frame = NULL;
+	capture->ring.frames = 0;
+	capture->ring.block_cur = (capture->ring.block_cur + 1) % RX_RING_BLOCK_NR;
+}
+
+/*
+ * Check whether there is a frame to receive, taking the next block
+ * from the kernel when the frames of the held block are consumed.
+ */
+static ni_bool_t
+ni_capture_ring_pending(ni_capture_t *capture)
+{
+	struct tpacket_block_desc *block;
+
+	if (!capture->ring.map)
+		return FALSE;
+
+	while (!capture->ring.frames) {
+		ni_capture_ring_release(capture);
+
+		block = (void *)(capture->ring.map +
+				(size_t)capture->ring.block_cur * RX_RING_BLOCK_SIZE);
+		if (!(block->hdr.bh1.block_status & TP_STATUS_USER))
+			return FALSE;
+		__sync_synchronize();
+
+		capture->ring.block = block;
+		capture->ring.frames = block->hdr.bh1.num_pkts;
+		capture->ring.frame = (unsigned char *)block +
+				block->hdr.bh1.offset_to_first_pkt;
+	}
+	return TRUE;
+}
+
+static ssize_t
+ni_capture_ring_recv(ni_capture_t *capture, void **data, ni_capture_csum_t *csum, ni_sockaddr_t *from)
+{
+	struct tpacket3_hdr *hdr;
+	size_t bytes;
+
+	*csum = NI_CAPTURE_CSUM_UNKNOWN;
+	if (from)
+		memset(from, 0, sizeof(*from));
+
+	if (!ni_capture_ring_pending(capture)) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	hdr = capture->ring.frame;
+	capture->ring.frames--;
+	capture->ring.frame = capture->ring.frames ?
+			(unsigned char *)hdr + hdr->tp_next_offset : NULL;
+
+	if (hdr->tp_status & TP_STATUS_CSUMNOTREADY)
+		*csum = NI_CAPTURE_CSUM_PARTIAL;
+	else
+	if (hdr->tp_status & TP_STATUS_CSUM_VALID)
+		*csum = NI_CAPTURE_CSUM_VALID;
+	if (from) {
+		memcpy(from, (unsigned char *)hdr + TPACKET_ALIGN(sizeof(*hdr)),
+				sizeof(struct sockaddr_ll));
+	}
+
+	bytes = hdr->tp_snaplen;
+	if (bytes > capture->mtu)
+		bytes = capture->mtu;
+
+	*data = (unsigned char *)hdr + hdr->tp_mac;
+	return bytes;
+}
+
+/*
+ * Process all frames of the ring in one wakeup, the callback
+ * receives one frame each via ni_capture_recv.
+ */
+static void
+ni_capture_ring_receive(ni_socket_t *sock)
+{
+	ni_capture_t *capture;
+
+	ni_socket_hold(sock);
+	while (sock->__fd >= 0 && (capture = sock->user_data)) {
+		if (!ni_capture_ring_pending(capture))
+			break;
+		capture->ring.receive(sock);
+	}
+	ni_socket_release(sock);
+}
+#endif
+
 int
 ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from)
 {
-	void *payload;
+	void *payload, *data = capture->buffer;
 	size_t payload_len;
 	ssize_t bytes;
-	ni_bool_t partial_checksum = FALSE;
+	ni_capture_csum_t csum = NI_CAPTURE_CSUM_UNKNOWN;
 	const char *lladdr;
 	const char *hint = capture->desc;
 
+	if (capture->member.master) {
+		/* packet received and inspected via the shared socket */
+		if (!capture->member.pending)
+			return -1;
+
+		capture->member.pending = FALSE;
+		capture->stats.received++;
+		if (from)
+			*from = capture->member.from;
+		*bp = capture->member.buffer;
+		return ni_buffer_count(bp);
+	}
+
+#if defined(NI_CAPTURE_RX_RING)
+	if (capture->ring.map)
+		bytes = ni_capture_ring_recv(capture, &data, &csum, from);
+	else
+#endif
 	bytes = ni_capture_recv_raw(capture->sock->__fd, capture->buffer,
-				  capture->mtu, &partial_checksum, from);
+				  capture->mtu, &csum, from);
 
 	if (bytes < 0) {
 		ni_error("%s: %s cannot read %s%spacket from socket: %m",
@@ -512,18 +917,21 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from)
 				hint ? hint : "", hint ? " " : "");
 		return -1;
 	}
-
-	lladdr = ni_capture_from_hwaddr_print(from);
-	ni_debug_socket("%s: incoming %s%spacket%s%s%s", capture->ifname,
-			hint ? hint : "", hint ? " " : "",
-			(partial_checksum ? " with partial checksum" : ""),
-			lladdr ? " from " : "", lladdr ? lladdr : "");
+	capture->stats.received++;
+
+	if (ni_debug_guard(NI_LOG_DEBUG, NI_TRACE_SOCKET)) {
+		lladdr = ni_capture_from_hwaddr_print(from);
+		ni_debug_socket("%s: incoming %s%spacket%s%s%s", capture->ifname,
+				hint ? hint : "", hint ? " " : "",
+				ni_capture_csum_hint(csum),
+				lladdr ? " from " : "", lladdr ? lladdr : "");
+	}
 
 	switch (capture->protocol) {
 	case ETHERTYPE_IP:
 		/* Make sure IP and UDP header are sane */
-		payload = ni_capture_inspect_udp_header(capture->buffer, bytes,
-						&payload_len, partial_checksum);
+		payload = ni_capture_inspect_udp_header(data, bytes,
+						&payload_len, csum, &capture->stats);
 		if (payload == NULL) {
 			ni_debug_socket("%s: bad IP/UDP %s%spacket header",
 					capture->ifname,
@@ -534,7 +942,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from)
 
 	case ETHERTYPE_ARP:
 	case ETHERTYPE_LLDP:
-		payload = capture->buffer;
+		payload = data;
 		payload_len = bytes;
 		break;
 
@@ -571,6 +979,9 @@ ni_capture_is_valid(const ni_capture_t *capture, int protocol)
 {
 	ni_socket_t *sock = capture->sock;
 
+	if (capture->member.master)
+		sock = capture->member.master->sock;
+
 	return (sock && !sock->error && capture->protocol == protocol);
 }
 
@@ -675,23 +1086,11 @@ ni_capture_init_once(void)
 	ni_modprobe(AFPACKET_MODULE_NAME, AFPACKET_MODULE_OPTS);
 }
 
-ni_capture_t *
-ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo,
-		void (*receive)(ni_socket_t *), const char* desc)
+static ni_bool_t
+ni_capture_set_destaddr(ni_capture_t *capture, const ni_capture_devinfo_t *devinfo,
+		const ni_capture_protinfo_t *protinfo)
 {
-	ni_packetaddr_t	addr;
-	ni_capture_t *capture = NULL;
 	ni_hwaddr_t destaddr;
-	int fd = -1;
-
-	if (devinfo->ifindex == 0) {
-		ni_error("no ifindex for interface `%s'", devinfo->ifname);
-		return NULL;
-	}
-	if (protinfo->eth_protocol == 0) {
-		ni_error("%s: bad ethernet protocol for dev %s", __func__, devinfo->ifname);
-		return NULL;
-	}
 
 	/* Destination address defaults to broadcast */
 	destaddr = protinfo->eth_destaddr;
@@ -699,12 +1098,32 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	if (destaddr.len == 0 && ni_link_address_length(devinfo->hwaddr.type) > 0
 	 && ni_link_address_get_broadcast(devinfo->hwaddr.type, &destaddr) < 0) {
 		ni_error("cannot get broadcast address for %s (bad iftype)", devinfo->ifname);
-		return NULL;
+		return FALSE;
 	}
 
+	capture->addr.sll.sll_family = AF_PACKET;
+	capture->addr.sll.sll_protocol = htons(protinfo->eth_protocol);
+	capture->addr.sll.sll_ifindex = devinfo->ifindex;
+	capture->addr.sll.sll_hatype = htons(devinfo->hwaddr.type);
+	capture->addr.sll.sll_halen = destaddr.len;
+	memcpy(&capture->addr.sll.sll_addr, destaddr.data, destaddr.len);
+	return TRUE;
+}
+
+static ni_capture_t *
+__ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo,
+		void (*receive)(ni_socket_t *), const char* desc)
+{
+	ni_packetaddr_t	addr;
+	ni_capture_t *capture = NULL;
+	int fd = -1;
+
 	ni_capture_init_once();
 
-	if ((fd = socket (PF_PACKET, SOCK_DGRAM, htons(protinfo->eth_protocol))) < 0) {
+	/* with a ring, receive nothing until bound to the protocol,
+	 * so no packets get queued to the socket before the ring */
+	if ((fd = socket (PF_PACKET, SOCK_DGRAM, protinfo->rx_ring ? 0 :
+					htons(protinfo->eth_protocol))) < 0) {
 		ni_error("socket: %m");
 		return NULL;
 	}
@@ -717,12 +1136,15 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	capture->sock = ni_socket_wrap(fd, SOCK_DGRAM);
 	capture->protocol = protinfo->eth_protocol;
 
-	capture->addr.sll.sll_family = AF_PACKET;
-	capture->addr.sll.sll_protocol = htons(protinfo->eth_protocol);
-	capture->addr.sll.sll_ifindex = devinfo->ifindex;
-	capture->addr.sll.sll_hatype = htons(devinfo->hwaddr.type);
-	capture->addr.sll.sll_halen = destaddr.len;
-	memcpy(&capture->addr.sll.sll_addr, destaddr.data, destaddr.len);
+#if defined(NI_CAPTURE_RX_RING)
+	if (protinfo->rx_ring && ni_capture_ring_open(capture, fd)) {
+		ni_debug_socket("%s: using packet receive ring for %s capture",
+				capture->ifname, desc ? desc : "");
+	}
+#endif
+
+	if (!ni_capture_set_destaddr(capture, devinfo, protinfo))
+		goto failed;
 
 	if (ni_capture_set_filter(capture, protinfo) < 0)
 		goto failed;
@@ -745,6 +1167,12 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	capture->buffer = xmalloc(capture->mtu);
 
 	capture->sock->receive = receive;
+#if defined(NI_CAPTURE_RX_RING)
+	if (capture->ring.map) {
+		capture->ring.receive = receive;
+		capture->sock->receive = ni_capture_ring_receive;
+	}
+#endif
 	capture->sock->get_timeout = ni_capture_socket_get_timeout;
 	capture->sock->check_timeout = ni_capture_socket_check_timeout;
 	capture->sock->user_data = capture;
@@ -759,6 +1187,288 @@ failed:
 	return NULL;
 }
 
+/*
+ * Shared capture socket: one socket bound to all interfaces, which
+ * demultiplexes the received packets to the member captures of the
+ * interfaces by the ifindex in the packet source address.
+ */
+static ni_capture_t *
+ni_capture_shared_member(ni_capture_t *master, unsigned int ifindex)
+{
+	ni_capture_t *member;
+
+	member = master->shared.members[ifindex % NI_CAPTURE_SHARED_BUCKETS];
+	for ( ; member; member = member->member.next) {
+		if (member->addr.sll.sll_ifindex == (int)ifindex)
+			return member;
+	}
+	return NULL;
+}
+
+static void
+ni_capture_shared_dispatch(ni_capture_t *master, ni_capture_t *capture)
+{
+	ni_capture_t *member;
+	ni_socket_t *msock;
+	ni_sockaddr_t from;
+	ni_buffer_t buf;
+	struct sockaddr_ll *ll;
+
+	if (ni_capture_recv(capture, &buf, &from) < 0)
+		return;
+
+	if (from.ss_family != AF_PACKET)
+		return;
+
+	ll = (struct sockaddr_ll *)&from.ss;
+	member = ni_capture_shared_member(master, ll->sll_ifindex);
+	if (!member || !(msock = member->sock) || !msock->receive)
+		return;
+
+	member->member.pending = TRUE;
+	member->member.buffer = buf;
+	member->member.from = from;
+
+	ni_socket_hold(msock);
+	msock->receive(msock);
+	if ((member = msock->user_data))
+		member->member.pending = FALSE;
+	ni_socket_release(msock);
+}
+
+static void
+ni_capture_shared_receive(ni_socket_t *sock)
+{
+	ni_capture_t *master = sock->user_data;
+
+	if (master)
+		ni_capture_shared_dispatch(master, master);
+}
+
+/*
+ * Fanout of a shared capture: further sockets bound to all interfaces
+ * joining a PACKET_FANOUT group with the shared socket, so the kernel
+ * balances the received packets over their queues, switching to the
+ * next socket when a queue is full instead to drop the packet. Each
+ * sibling dispatches its packets to the members of the shared socket.
+ */
+#if defined(PACKET_FANOUT) && defined(PACKET_FANOUT_FLAG_UNIQUEID)
+static ni_bool_t
+ni_capture_fanout_join(ni_capture_t *capture, uint16_t *id)
+{
+	int fd = capture->sock->__fd;
+	unsigned int arg;
+	socklen_t len = sizeof(arg);
+
+	arg = PACKET_FANOUT_LB | PACKET_FANOUT_FLAG_ROLLOVER;
+	if (!*id)
+		arg |= PACKET_FANOUT_FLAG_UNIQUEID;
+	arg = (arg << 16) | *id;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg)) < 0) {
+		ni_warn("%s: unable to join packet fanout group: %m", capture->ifname);
+		return FALSE;
+	}
+	if (!*id) {
+		if (getsockopt(fd, SOL_PACKET, PACKET_FANOUT, &arg, &len) < 0) {
+			ni_warn("%s: unable to query packet fanout group: %m", capture->ifname);
+			return FALSE;
+		}
+		if (!(arg & 0xffff)) {
+			ni_warn("%s: unable to query packet fanout group id", capture->ifname);
+			return FALSE;
+		}
+		*id = arg & 0xffff;
+	}
+	return TRUE;
+}
+
+static void
+ni_capture_shared_fanout_receive(ni_socket_t *sock)
+{
+	ni_capture_t *sibling = sock->user_data;
+
+	if (sibling && sibling->shared.owner)
+		ni_capture_shared_dispatch(sibling->shared.owner, sibling);
+}
+
+static void
+ni_capture_shared_fanout_open(ni_capture_t *master, const ni_capture_devinfo_t *any,
+		const ni_capture_protinfo_t *protinfo, const char *desc)
+{
+	unsigned int count = min_t(unsigned int, protinfo->fanout, NI_CONFIG_SOCKET_FANOUT_MAX);
+	ni_capture_t *sibling;
+	uint16_t id = 0;
+
+	if (count < 2 || !ni_capture_fanout_join(master, &id))
+		return;
+
+	master->shared.fanout = xcalloc(count - 1, sizeof(ni_capture_t *));
+	while (master->shared.nfanout < count - 1) {
+		sibling = __ni_capture_open(any, protinfo, ni_capture_shared_fanout_receive, desc);
+		if (!sibling)
+			break;
+
+		sibling->shared.owner = master;
+		if (!ni_capture_fanout_join(sibling, &id)) {
+			ni_capture_free(sibling);
+			break;
+		}
+		master->shared.fanout[master->shared.nfanout++] = sibling;
+	}
+
+	ni_debug_socket("%s: using shared %s%scapture fanout group %u with %u sockets",
+			master->ifname, desc ? desc : "", desc ? " " : "",
+			id, master->shared.nfanout + 1);
+}
+#endif
+
+static ni_bool_t
+ni_capture_shared_match(const ni_capture_t *master, const ni_capture_protinfo_t *protinfo)
+{
+	const ni_capture_protinfo_t *info = &master->shared.protinfo;
+
+	return info->eth_protocol == protinfo->eth_protocol &&
+		info->ip_protocol == protinfo->ip_protocol &&
+		info->ip_port == protinfo->ip_port &&
+		info->rx_ring == protinfo->rx_ring &&
+		info->fanout == protinfo->fanout &&
+		ni_link_address_equal(&info->eth_destaddr, &protinfo->eth_destaddr);
+}
+
+static ni_capture_t *
+ni_capture_shared_get(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo,
+		const char *desc)
+{
+	ni_capture_devinfo_t any;
+	ni_capture_t *master;
+
+	for (master = ni_capture_shared_list; master; master = master->shared.next) {
+		if (ni_capture_shared_match(master, protinfo))
+			return master;
+	}
+
+	memset(&any, 0, sizeof(any));
+	any.ifname = "any";
+	any.ifindex = 0;
+	any.iftype = devinfo->iftype;
+	any.hwaddr.type = devinfo->hwaddr.type;
+	any.mtu = max_t(unsigned int, devinfo->mtu, MTU_MAX);
+
+	if (!(master = __ni_capture_open(&any, protinfo, ni_capture_shared_receive, desc)))
+		return NULL;
+
+	master->shared.members = xcalloc(NI_CAPTURE_SHARED_BUCKETS, sizeof(ni_capture_t *));
+	master->shared.protinfo = *protinfo;
+	master->shared.protinfo.shared = FALSE;
+	master->sock->get_timeout = ni_capture_shared_get_timeout;
+	master->sock->check_timeout = ni_capture_shared_check_timeout;
+#if defined(PACKET_FANOUT) && defined(PACKET_FANOUT_FLAG_UNIQUEID)
+	ni_capture_shared_fanout_open(master, &any, &master->shared.protinfo, desc);
+#endif
+
+	master->shared.next = ni_capture_shared_list;
+	ni_capture_shared_list = master;
+	return master;
+}
+
+static void
+ni_capture_shared_put(ni_capture_t *master)
+{
+	ni_capture_t **pos;
+
+	if (!master || master->shared.count)
+		return;
+
+	for (pos = &ni_capture_shared_list; *pos; pos = &(*pos)->shared.next) {
+		if (*pos == master) {
+			*pos = master->shared.next;
+			break;
+		}
+	}
+	ni_capture_free(master);
+}
+
+static ni_capture_t *
+ni_capture_shared_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo,
+		void (*receive)(ni_socket_t *), const char* desc)
+{
+	ni_capture_t *master, *capture;
+	unsigned int bucket;
+
+	if (!(master = ni_capture_shared_get(devinfo, protinfo, desc)))
+		return NULL;
+
+	if (!(capture = calloc(1, sizeof(*capture)))) {
+		ni_capture_shared_put(master);
+		return NULL;
+	}
+
+	ni_string_dup(&capture->ifname, devinfo->ifname);
+	ni_string_dup(&capture->desc, desc);
+	capture->protocol = protinfo->eth_protocol;
+	capture->mtu = master->mtu;
+	if (!ni_capture_set_destaddr(capture, devinfo, protinfo)) {
+		ni_capture_free(capture);
+		ni_capture_shared_put(master);
+		return NULL;
+	}
+
+	/* not activated, just dispatching the received packets */
+	capture->sock = ni_socket_wrap(-1, SOCK_DGRAM);
+	capture->sock->receive = receive;
+	capture->sock->user_data = capture;
+
+	bucket = devinfo->ifindex % NI_CAPTURE_SHARED_BUCKETS;
+	capture->member.master = master;
+	capture->member.next = master->shared.members[bucket];
+	master->shared.members[bucket] = capture;
+	master->shared.count++;
+
+	ni_debug_socket("%s: using shared %s%scapture socket", capture->ifname,
+			desc ? desc : "", desc ? " " : "");
+	return capture;
+}
+
+static void
+ni_capture_shared_leave(ni_capture_t *capture)
+{
+	ni_capture_t *master, **pos;
+
+	if (!(master = capture->member.master))
+		return;
+
+	pos = &master->shared.members[capture->addr.sll.sll_ifindex % NI_CAPTURE_SHARED_BUCKETS];
+	for ( ; *pos; pos = &(*pos)->member.next) {
+		if (*pos == capture) {
+			*pos = capture->member.next;
+			master->shared.count--;
+			break;
+		}
+	}
+	capture->member.master = NULL;
+	ni_capture_shared_put(master);
+}
+
+ni_capture_t *
+ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo,
+		void (*receive)(ni_socket_t *), const char* desc)
+{
+	if (devinfo->ifindex == 0) {
+		ni_error("no ifindex for interface `%s'", devinfo->ifname);
+		return NULL;
+	}
+	if (protinfo->eth_protocol == 0) {
+		ni_error("%s: bad ethernet protocol for dev %s", __func__, devinfo->ifname);
+		return NULL;
+	}
+
+	if (protinfo->shared)
+		return ni_capture_shared_open(devinfo, protinfo, receive, desc);
+
+	return __ni_capture_open(devinfo, protinfo, receive, desc);
+}
+
 static int
 ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
 {
@@ -805,6 +1515,34 @@ ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
 	return 0;
 }
 
+/*
+ * Replace the capture filter with a protocol specific program
+ * built by the caller, e.g. to match the addresses of interest.
+ */
+int
+ni_capture_attach_filter(ni_capture_t *cap, const struct sock_filter *filter, unsigned int len)
+{
+	struct sock_fprog pf;
+
+	if (!cap || !cap->sock || !filter || !len)
+		return -1;
+
+	/* a member of a shared socket would filter for all members */
+	if (cap->member.master)
+		return 1;
+
+	memset(&pf, 0, sizeof(pf));
+	pf.filter = (struct sock_filter *)filter;
+	pf.len = len;
+
+	if (setsockopt(cap->sock->__fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) < 0) {
+		ni_error("%s: %s%sSO_ATTACH_FILTER: %m", cap->ifname, cap->desc ?: "", cap->desc ? " " : "");
+		return -1;
+	}
+
+	return 0;
+}
+
 static ssize_t
 ni_capture_send_buf(const ni_capture_t *capture, const ni_buffer_t *buf)
 {
@@ -815,7 +1553,7 @@ ni_capture_send_buf(const ni_capture_t *capture, const ni_buffer_t *buf)
 		return -1;
 	}
 
-	rv = sendto(capture->sock->__fd, ni_buffer_head(buf), ni_buffer_count(buf), 0,
+	rv = sendto(ni_capture_fd(capture), ni_buffer_head(buf), ni_buffer_count(buf), 0,
 			&capture->addr.sa, sizeof(capture->addr));
 	if (rv < 0)
 		ni_error("%s: unable to send %s%spacket: %m", capture->ifname,
@@ -840,13 +1578,87 @@ ni_capture_send(ni_capture_t *capture, const ni_buffer_t *buf, const ni_timeout_
 	return rv;
 }
 
+/*
+ * Receive and validation counters of a capture. The kernel drops
+ * are queried via PACKET_STATISTICS, which resets them on read, so
+ * we accumulate them. Members of a shared capture don't own the
+ * socket, the kernel drops are reported by the shared socket only.
+ */
+ni_bool_t
+ni_capture_get_stats(ni_capture_t *capture, ni_capture_stats_t *stats)
+{
+	unsigned int i;
+#if defined(PACKET_STATISTICS)
+	struct tpacket_stats ks;
+	socklen_t len = sizeof(ks);
+#endif
+
+	if (!capture || !stats)
+		return FALSE;
+
+#if defined(PACKET_STATISTICS)
+	memset(&ks, 0, sizeof(ks));
+	if (!capture->member.master && capture->sock && capture->sock->__fd >= 0 &&
+	    getsockopt(capture->sock->__fd, SOL_PACKET, PACKET_STATISTICS, &ks, &len) == 0)
+		capture->stats.kernel_drops += ks.tp_drops;
+#endif
+
+	*stats = capture->stats;
+	for (i = 0; i < capture->shared.nfanout; ++i) {
+		ni_capture_stats_t fanout;
+
+		if (!ni_capture_get_stats(capture->shared.fanout[i], &fanout))
+			continue;
+
+		stats->received      += fanout.received;
+		stats->csum_valid    += fanout.csum_valid;
+		stats->csum_partial  += fanout.csum_partial;
+		stats->csum_verified += fanout.csum_verified;
+		stats->bad_header    += fanout.bad_header;
+		stats->bad_checksum  += fanout.bad_checksum;
+		stats->kernel_drops  += fanout.kernel_drops;
+	}
+	return TRUE;
+}
+
+static void
+ni_capture_trace_stats(ni_capture_t *capture)
+{
+	const char *hint = capture->desc;
+	ni_capture_stats_t stats;
+
+	if (!ni_debug_guard(NI_LOG_DEBUG, NI_TRACE_SOCKET))
+		return;
+
+	if (!ni_capture_get_stats(capture, &stats) || !stats.received)
+		return;
+
+	ni_debug_socket("%s: %s%scapture received %u packets, checksum valid %u,"
+			" partial %u, verified %u, dropped bad header %u, bad checksum %u,"
+			" kernel drops %u", capture->ifname, hint ? hint : "", hint ? " " : "",
+			stats.received, stats.csum_valid, stats.csum_partial,
+			stats.csum_verified, stats.bad_header, stats.bad_checksum,
+			stats.kernel_drops);
+}
+
 void
 ni_capture_free(ni_capture_t *capture)
 {
 	if (!capture)
 		return;
-	if (capture->sock)
+	ni_capture_trace_stats(capture);
+	ni_capture_shared_leave(capture);
+	while (capture->shared.nfanout)
+		ni_capture_free(capture->shared.fanout[--capture->shared.nfanout]);
+	free(capture->shared.fanout);
+	free(capture->shared.members);
+	if (capture->sock) {
+		capture->sock->user_data = NULL;
 		ni_socket_close(capture->sock);
+	}
+#if defined(NI_CAPTURE_RX_RING)
+	ni_capture_ring_close(capture);
+#endif
 	if (capture->buffer)
 		free(capture->buffer);
 	ni_string_free(&capture->ifname);
@@ -12,6 +12,9 @@
 #endif
 #include <sys/time.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <limits.h>
 #include <errno.h>
 #include <unistd.h>
@@ -21,6 +24,7 @@
 #include <wicked/util.h>
 #include <wicked/netinfo.h>	/* for ni_config_statedir() */
 #include <wicked/logging.h>
+#include <wicked/time.h>
 
 #include "client/client_state.h"
 #include "util_priv.h"
@@ -28,12 +32,20 @@
 /*
  * Internal utilities
  */
+#define NI_CLIENT_STATE_SUFFIX_XML	"xml"
+#define NI_CLIENT_STATE_SUFFIX_BINARY	"bin"
+
+/* msec the write-behind store collects state updates */
+#ifndef NI_CLIENT_STATE_SAVE_DELAY
+#define NI_CLIENT_STATE_SAVE_DELAY	250
+#endif
+
 static void
-ni_client_state_filename(unsigned int ifindex, char *path, size_t size)
+ni_client_state_filename(unsigned int ifindex, const char *suffix, char *path, size_t size)
 {
-	snprintf(path, size, "%s/state-%u.xml",
+	snprintf(path, size, "%s/state-%u.%s",
 			ni_config_statedir(),
-			ifindex);
+			ifindex, suffix);
 }
 
 ni_bool_t
@@ -426,16 +438,122 @@ ni_client_state_scripts_copy(ni_client_state_scripts_t *dst,
 		dst->node = xml_node_clone(src->node, NULL);
 }
 
-ni_bool_t
-ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex)
+/*
+ * The state is stored either in a compact binary form of the xml tree,
+ * which is read back without going through the xml parser, or as xml.
+ * Binary files have their own suffix, so old xml state files are still
+ * found and read.
+ */
+#define NI_CLIENT_STATE_FILE_MAGIC	"WICKEDCS"
+#define NI_CLIENT_STATE_FILE_VERSION	1U
+#define NI_CLIENT_STATE_FILE_MAX_SIZE	(1U << 20)
+
+static int
+ni_client_state_write_binary(FILE *fp, const xml_node_t *node)
+{
+	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
+	uint32_t u32;
+	size_t hlen;
+	int ret = -1;
+
+	ni_stringbuf_put(&out, NI_CLIENT_STATE_FILE_MAGIC, sizeof(NI_CLIENT_STATE_FILE_MAGIC) - 1);
+	u32 = NI_CLIENT_STATE_FILE_VERSION;
+	ni_stringbuf_put(&out, (const char *)&u32, sizeof(u32));
+	u32 = 0;
+	ni_stringbuf_put(&out, (const char *)&u32, sizeof(u32));
+	hlen = out.len;
+
+	if (xml_node_write_binary(node, &out) < 0 || out.len - hlen > NI_CLIENT_STATE_FILE_MAX_SIZE)
+		goto done;
+
+	u32 = out.len - hlen;
+	memcpy(out.string + hlen - sizeof(u32), &u32, sizeof(u32));
+	ret = ni_file_write(fp, out.string, out.len) < 0 ? -1 : 0;
+
+done:
+	ni_stringbuf_destroy(&out);
+	return ret;
+}
+
+static xml_node_t *
+ni_client_state_read_binary(FILE *fp, const char *path)
+{
+	char magic[sizeof(NI_CLIENT_STATE_FILE_MAGIC) - 1];
+	uint32_t version, len;
+	xml_node_t *xml = NULL;
+	size_t hlen, size = 0, used = 0;
+	char *data;
+
+	hlen = sizeof(magic) + sizeof(version) + sizeof(len);
+	if (!(data = ni_file_read(fp, &size, hlen + NI_CLIENT_STATE_FILE_MAX_SIZE)))
+		return NULL;
+
+	if (size >= hlen) {
+		memcpy(magic, data, sizeof(magic));
+		memcpy(&version, data + sizeof(magic), sizeof(version));
+		memcpy(&len, data + sizeof(magic) + sizeof(version), sizeof(len));
+
+		if (!memcmp(magic, NI_CLIENT_STATE_FILE_MAGIC, sizeof(magic)) &&
+		    version == NI_CLIENT_STATE_FILE_VERSION && len == size - hlen) {
+			xml = xml_node_read_binary(data + hlen, len, &used, path);
+			if (xml && used != len) {
+				xml_node_free(xml);
+				xml = NULL;
+			}
+		}
+	}
+	free(data);
+	return xml;
+}
+
+static xml_node_t *
+ni_client_state_to_xml(const ni_client_state_t *client_state, const char *path)
+{
+	xml_node_t *node;
+
+	if (!(node = xml_node_new(NI_CLIENT_STATE_XML_NODE, NULL))) {
+		ni_error("Cannot create %s node for %s", NI_CLIENT_STATE_XML_NODE, path);
+		return NULL;
+	}
+
+	if (!ni_client_state_print_xml(client_state, node)) {
+		ni_error("Cannot format state into xml for %s", path);
+		xml_node_free(node);
+		return NULL;
+	}
+	return node;
+}
+
+static ni_bool_t
+ni_client_state_from_xml(ni_client_state_t *client_state, const xml_node_t *xml,
+			const char *path)
+{
+	const xml_node_t *node;
+
+	node = xml->name ? xml : xml->children;
+	if (!node || !ni_string_eq(node->name, NI_CLIENT_STATE_XML_NODE)) {
+		ni_error("State file '%s' does not contain %s node",
+			path, NI_CLIENT_STATE_XML_NODE);
+		return FALSE;
+	}
+
+	ni_client_state_reset(client_state);
+	if (!ni_client_state_parse_xml(node, client_state)) {
+		ni_error("Cannot parse state from file '%s'", path);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static ni_bool_t
+ni_client_state_store(const xml_node_t *node, unsigned int ifindex)
 {
 	char path[PATH_MAX - sizeof(".XXXXXX")] = {'\0'};
 	char temp[PATH_MAX] = {'\0'};
-	xml_node_t *node;
 	FILE *fp = NULL;
 	int fd;
 
-	ni_client_state_filename(ifindex, path, sizeof(path));
+	ni_client_state_filename(ifindex, NI_CLIENT_STATE_SUFFIX_BINARY, path, sizeof(path));
 	snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
 
 	if ((fd = mkstemp(temp)) < 0) {
@@ -448,23 +566,10 @@ ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex
 		goto failure;
 	}
 
-	if (!(node = xml_node_new(NI_CLIENT_STATE_XML_NODE, NULL))) {
-		ni_error("Cannot create %s node for %s", NI_CLIENT_STATE_XML_NODE, path);
-		goto failure;
-	}
-
-	if (!ni_client_state_print_xml(client_state, node)) {
-		ni_error("Cannot format state into xml for %s", path);
-		xml_node_free(node);
-		goto failure;
-	}
-
-	if (xml_node_print(node, fp) < 0) {
+	if (ni_client_state_write_binary(fp, node) < 0) {
 		ni_error("Cannot write into %s state temp file", path);
-		xml_node_free(node);
 		goto failure;
 	}
-	xml_node_free(node);
 
 	if (rename(temp, path) < 0) {
 		ni_error("Cannot move temp file to state file %s", path);
@@ -473,6 +578,9 @@ ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex
 
 	fclose(fp);
 
+	/* drop an old xml state file */
+	ni_client_state_filename(ifindex, NI_CLIENT_STATE_SUFFIX_XML, path, sizeof(path));
+	unlink(path);
 	return TRUE;
 
 failure:
@@ -483,90 +591,242 @@ failure:
 	return FALSE;
 }
 
+/*
+ * Write-behind state store
+ *
+ * wickedd receives several client state updates per interface and ifup
+ * (control, config and scripts). A deferred save keeps the formatted
+ * state in memory and writes all states pending after a short delay in
+ * one batch; updates of the same interface replace each other, so only
+ * the last one is written. Loads see a pending state.
+ */
+typedef struct ni_client_state_pending	ni_client_state_pending_t;
+struct ni_client_state_pending {
+	ni_client_state_pending_t *	next;
+	unsigned int			ifindex;
+	xml_node_t *			xml;
+};
+
+static struct {
+	ni_client_state_pending_t *	list;
+	ni_client_state_pending_t **	tail;
+	const ni_timer_t *		timer;
+} ni_client_state_queue = { NULL, &ni_client_state_queue.list, NULL };
+
+static ni_client_state_pending_t **
+ni_client_state_pending_find(unsigned int ifindex)
+{
+	ni_client_state_pending_t **pos, *cur;
+
+	for (pos = &ni_client_state_queue.list; (cur = *pos); pos = &cur->next) {
+		if (cur->ifindex == ifindex)
+			return pos;
+	}
+	return NULL;
+}
+
+static void
+ni_client_state_pending_drop(unsigned int ifindex)
+{
+	ni_client_state_pending_t **pos, *cur;
+
+	if ((pos = ni_client_state_pending_find(ifindex))) {
+		cur = *pos;
+		if (!(*pos = cur->next))
+			ni_client_state_queue.tail = pos;
+		xml_node_free(cur->xml);
+		free(cur);
+	}
+}
+
+static void
+ni_client_state_timeout(void *user_data, const ni_timer_t *timer)
+{
+	if (ni_client_state_queue.timer == timer) {
+		ni_client_state_queue.timer = NULL;
+		ni_client_state_flush();
+	}
+}
+
+/*
+ * Write all pending state updates; to be called before exit.
+ */
+void
+ni_client_state_flush(void)
+{
+	ni_client_state_pending_t *cur;
+	unsigned int count = 0;
+
+	if (ni_client_state_queue.timer) {
+		ni_timer_cancel(ni_client_state_queue.timer);
+		ni_client_state_queue.timer = NULL;
+	}
+
+	while ((cur = ni_client_state_queue.list)) {
+		ni_client_state_queue.list = cur->next;
+
+		if (ni_client_state_store(cur->xml, cur->ifindex))
+			count++;
+		xml_node_free(cur->xml);
+		free(cur);
+	}
+	ni_client_state_queue.tail = &ni_client_state_queue.list;
+
+	if (count)
+		ni_debug_readwrite("Flushed %u pending client state updates", count);
+}
+
 ni_bool_t
-ni_client_state_load(ni_client_state_t *client_state, unsigned int ifindex)
+ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex)
 {
 	char path[PATH_MAX] = {'\0'};
-	xml_node_t *xml;
 	xml_node_t *node;
-	FILE *fp;
+	ni_bool_t ret;
 
-	if (!client_state)
+	ni_client_state_filename(ifindex, NI_CLIENT_STATE_SUFFIX_BINARY, path, sizeof(path));
+	if (!(node = ni_client_state_to_xml(client_state, path)))
 		return FALSE;
 
-	ni_client_state_filename(ifindex, path, sizeof(path));
-	if (!(fp = fopen(path, "re"))) {
-		if (errno != ENOENT)
-			ni_error("Cannot open state file '%s': %m", path);
+	ni_client_state_pending_drop(ifindex);
+	ret = ni_client_state_store(node, ifindex);
+	xml_node_free(node);
+	return ret;
+}
+
+ni_bool_t
+ni_client_state_save_deferred(const ni_client_state_t *client_state, unsigned int ifindex)
+{
+	char path[PATH_MAX] = {'\0'};
+	ni_client_state_pending_t **pos, *pending;
+	xml_node_t *node;
+
+	ni_client_state_filename(ifindex, NI_CLIENT_STATE_SUFFIX_BINARY, path, sizeof(path));
+	if (!(node = ni_client_state_to_xml(client_state, path)))
 		return FALSE;
+
+	if ((pos = ni_client_state_pending_find(ifindex))) {
+		pending = *pos;
+		xml_node_free(pending->xml);
+	} else {
+		pending = xcalloc(1, sizeof(*pending));
+		pending->ifindex = ifindex;
+		*ni_client_state_queue.tail = pending;
+		ni_client_state_queue.tail = &pending->next;
 	}
+	pending->xml = node;
 
-	if (!(xml = xml_node_scan(fp, path))) {
-		fclose(fp);
-		ni_error("Cannot parse xml from state file '%s", path);
+	if (!ni_client_state_queue.timer)
+		ni_client_state_queue.timer = ni_timer_register(NI_CLIENT_STATE_SAVE_DELAY,
+					ni_client_state_timeout, NULL);
+	if (!ni_client_state_queue.timer)
+		ni_client_state_flush();
+	return TRUE;
+}
+
+ni_bool_t
+ni_client_state_load(ni_client_state_t *client_state, unsigned int ifindex)
+{
+	char path[PATH_MAX] = {'\0'};
+	ni_client_state_pending_t **pos;
+	ni_bool_t binary = TRUE;
+	xml_node_t *xml;
+	ni_bool_t ret;
+	FILE *fp;
+
+	if (!client_state)
 		return FALSE;
+
+	/* a not yet written update is the current state */
+	if ((pos = ni_client_state_pending_find(ifindex))) {
+		ni_client_state_filename(ifindex, NI_CLIENT_STATE_SUFFIX_BINARY,
+				path, sizeof(path));
+		return ni_client_state_from_xml(client_state, (*pos)->xml, path);
 	}
-	fclose(fp);
 
-	node = xml->name ? xml : xml->children;
-	if (!node || !ni_string_eq(node->name, NI_CLIENT_STATE_XML_NODE)) {
-		ni_error("State file '%s' does not contain %s node",
-			path, NI_CLIENT_STATE_XML_NODE);
-		xml_node_free(xml);
+	ni_client_state_filename(ifindex, NI_CLIENT_STATE_SUFFIX_BINARY, path, sizeof(path));
+	if (!(fp = fopen(path, "re")) && errno == ENOENT) {
+		binary = FALSE;
+		ni_client_state_filename(ifindex, NI_CLIENT_STATE_SUFFIX_XML, path, sizeof(path));
+		fp = fopen(path, "re");
+	}
+	if (!fp) {
+		if (errno != ENOENT)
+			ni_error("Cannot open state file '%s': %m", path);
 		return FALSE;
 	}
 
-	ni_client_state_reset(client_state);
-	if (!ni_client_state_parse_xml(node, client_state)) {
-		ni_error("Cannot parse state from file '%s'", path);
-		xml_node_free(xml);
+	xml = binary ? ni_client_state_read_binary(fp, path) : xml_node_scan(fp, path);
+	fclose(fp);
+	if (!xml) {
+		ni_error("Cannot parse xml from state file '%s", path);
 		return FALSE;
 	}
 
+	ret = ni_client_state_from_xml(client_state, xml, path);
 	xml_node_free(xml);
-	return TRUE;
+	return ret;
 }
 
-
 ni_bool_t
 ni_client_state_move(unsigned int ifindex_old, unsigned int ifindex_new)
 {
+	static const char *suffixes[] = {
+		NI_CLIENT_STATE_SUFFIX_BINARY,
+		NI_CLIENT_STATE_SUFFIX_XML,
+		NULL
+	};
 	char path_old[PATH_MAX] = {'\0'};
 	char path_new[PATH_MAX] = {'\0'};
+	ni_client_state_pending_t **pos;
+	const char **sp;
+	ni_bool_t ret = TRUE;
 
 	if (ifindex_old == ifindex_new)
 		return TRUE;
 
-	ni_client_state_filename(ifindex_old, path_old, sizeof(path_old));
-	ni_client_state_filename(ifindex_new, path_new, sizeof(path_new));
-
-	if (rename(path_old, path_new) < 0) {
-		if (errno == ENOENT && !ni_file_exists(path_old)) {
-			ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_READWRITE,
-				"%s does not exists, not renamed to %s", path_old, path_new);
-			return TRUE;
+	ni_client_state_pending_drop(ifindex_new);
+	if ((pos = ni_client_state_pending_find(ifindex_old)))
+		(*pos)->ifindex = ifindex_new;
+
+	for (sp = suffixes; *sp; ++sp) {
+		ni_client_state_filename(ifindex_old, *sp, path_old, sizeof(path_old));
+		ni_client_state_filename(ifindex_new, *sp, path_new, sizeof(path_new));
+
+		if (rename(path_old, path_new) < 0) {
+			if (errno == ENOENT && !ni_file_exists(path_old)) {
+				ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_READWRITE,
+					"%s does not exists, not renamed to %s", path_old, path_new);
+				continue;
+			}
+			ni_error("Cannot rename state %s to %s", path_old, path_new);
+			ret = FALSE;
 		}
-		ni_error("Cannot rename state %s to %s", path_old, path_new);
-		return FALSE;
 	}
-	return TRUE;
+	return ret;
 }
 
 ni_bool_t
 ni_client_state_drop(unsigned int ifindex)
 {
+	static const char *suffixes[] = {
+		NI_CLIENT_STATE_SUFFIX_BINARY,
+		NI_CLIENT_STATE_SUFFIX_XML,
+		NULL
+	};
 	char path[PATH_MAX] = {'\0'};
+	const char **sp;
+	ni_bool_t ret = TRUE;
 
-	ni_client_state_filename(ifindex, path, sizeof(path));
+	ni_client_state_pending_drop(ifindex);
+	for (sp = suffixes; *sp; ++sp) {
+		ni_client_state_filename(ifindex, *sp, path, sizeof(path));
 
-	if (unlink(path) < 0) {
-		if (errno == ENOENT)
-			return TRUE;
-
-		ni_error("Cannot remove state file '%s': %m", path);
-		return FALSE;
+		if (unlink(path) < 0 && errno != ENOENT) {
+			ni_error("Cannot remove state file '%s': %m", path);
+			ret = FALSE;
+		}
 	}
-	return TRUE;
+	return ret;
 }
 
 ni_bool_t
@@ -596,7 +856,7 @@ ni_client_state_set_persistent(xml_node_t *config)
 		return FALSE;
 
 	if (!persistent)
-		ni_string_dup(&pernode->cdata, ni_format_boolean(TRUE));
+		xml_node_set_cdata(pernode, ni_format_boolean(TRUE));
 
 	return TRUE;
 }
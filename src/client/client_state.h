@@ -80,6 +80,8 @@ extern ni_bool_t	ni_client_state_scripts_parse_xml(const xml_node_t *, ni_client
 extern ni_bool_t	ni_client_state_parse_xml(const xml_node_t *, ni_client_state_t *);
 extern ni_bool_t	ni_client_state_load(ni_client_state_t *, unsigned int);
 extern ni_bool_t	ni_client_state_save(const ni_client_state_t *, unsigned int);
+extern ni_bool_t	ni_client_state_save_deferred(const ni_client_state_t *, unsigned int);
+extern void		ni_client_state_flush(void);
 extern ni_bool_t	ni_client_state_move(unsigned int, unsigned int);
 extern ni_bool_t	ni_client_state_drop(unsigned int);
 extern ni_bool_t	ni_client_state_set_persistent(xml_node_t *);
@@ -43,6 +43,7 @@ static dbus_bool_t	__ni_dbus_object_refresh_properties(ni_dbus_object_t *proxy,
 					const ni_dbus_service_t *service,
 					DBusMessageIter *iter);
 static void		__ni_dbus_object_mark_stale(ni_dbus_object_t *);
+static dbus_bool_t	__ni_dbus_object_process_managed_objects(ni_dbus_object_t *, DBusMessageIter *);
 static void		__ni_dbus_object_purge_stale(ni_dbus_object_t *);
 static const char *	__ni_dbus_print_argument(char, const void *);
 
@@ -67,6 +68,28 @@ ni_dbus_client_open(const char *bus_type, const char *bus_name)
 	return dbc;
 }
 
+/*
+ * Constructor for a DBus client handle, connected to the private
+ * peer socket of the service directly instead of the bus.
+ */
+ni_dbus_client_t *
+ni_dbus_client_open_peer(const char *path, const char *bus_name)
+{
+	ni_dbus_connection_t *peerconn;
+	ni_dbus_client_t *dbc;
+
+	NI_TRACE_ENTER_ARGS("path=%s, bus_name=%s", path, bus_name);
+	peerconn = ni_dbus_connection_open_peer(path);
+	if (peerconn == NULL)
+		return NULL;
+
+	dbc = xcalloc(1, sizeof(*dbc));
+	ni_string_dup(&dbc->bus_name, bus_name);
+	dbc->connection = peerconn;
+	dbc->call_timeout = 1000 * 60;
+	return dbc;
+}
+
 /*
  * Destructor for DBus client handle
  */
@@ -208,6 +231,15 @@ ni_dbus_client_call(ni_dbus_client_t *client, ni_dbus_message_t *call, DBusError
 	return ni_dbus_connection_call(client->connection, call, client->call_timeout, error);
 }
 
+/*
+ * Wait for and dispatch incoming messages, e.g. signals
+ */
+dbus_bool_t
+ni_dbus_client_wait(ni_dbus_client_t *client, unsigned int msec)
+{
+	return ni_dbus_connection_wait(client->connection, msec);
+}
+
 /*
  * Signal handling
  */
@@ -224,6 +256,26 @@ ni_dbus_client_add_signal_handler(ni_dbus_client_t *client,
 					callback, user_data);
 }
 
+void
+ni_dbus_client_add_signal_match(ni_dbus_client_t *client,
+					const char *sender,
+					const char *path_namespace,
+					const char *object_interface,
+					const char *member,
+					ni_dbus_signal_handler_t *callback,
+					void *user_data)
+{
+	ni_dbus_add_signal_match(client->connection,
+					sender, path_namespace, object_interface,
+					member, callback, user_data);
+}
+
+void
+ni_dbus_client_remove_signal_handlers(ni_dbus_client_t *client, const void *user_data)
+{
+	ni_dbus_remove_signal_handlers(client->connection, user_data);
+}
+
 /*
  * Proxy objects, and calling through proxies
  */
@@ -440,6 +492,74 @@ out:
 	return rv;
 }
 
+/*
+ * Call a method returning a dict and pass each dict entry to the
+ * callback as soon as it is parsed from the reply, without to build
+ * the complete result dict first. The callback returns FALSE to stop.
+ */
+dbus_bool_t
+ni_dbus_object_call_dict_foreach(const ni_dbus_object_t *proxy,
+					const char *interface_name, const char *method,
+					unsigned int nargs, const ni_dbus_variant_t *args,
+					ni_dbus_dict_entry_callback_t *callback, void *user_data,
+					DBusError *error)
+{
+	ni_dbus_message_t *call = NULL, *reply = NULL;
+	DBusMessageIter iter, iter_dict;
+	ni_dbus_dict_entry_t entry;
+	ni_dbus_client_t *client;
+	dbus_bool_t rv = FALSE;
+
+	if (!proxy || !(client = ni_dbus_object_get_client(proxy)) ||
+	    !interface_name || !callback) {
+		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS, "%s: bad proxy object", __func__);
+		return FALSE;
+	}
+
+	NI_TRACE_ENTER_ARGS("%s, if=%s, method=%s", proxy->path, interface_name, method);
+	call = dbus_message_new_method_call(client->bus_name, proxy->path, interface_name, method);
+	if (call == NULL) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: unable to build %s() message", __func__, method);
+		goto out;
+	}
+
+	if (nargs && !ni_dbus_message_serialize_variants(call, nargs, args, error))
+		goto out;
+
+	if ((reply = ni_dbus_client_call(client, call, error)) == NULL)
+		goto out;
+
+	dbus_message_iter_init(reply, &iter);
+	if (dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_VARIANT)
+		dbus_message_iter_recurse(&iter, &iter);
+	if (!ni_dbus_message_open_dict_read(&iter, &iter_dict)) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: unable to parse %s() response", __func__, method);
+		goto out;
+	}
+
+	rv = TRUE;
+	while (dbus_message_iter_get_arg_type(&iter_dict) != DBUS_TYPE_INVALID) {
+		memset(&entry, 0, sizeof(entry));
+		if (!ni_dbus_message_get_next_dict_entry(&iter_dict, &entry)) {
+			dbus_set_error(error, DBUS_ERROR_FAILED, "%s: unable to parse %s() response", __func__, method);
+			rv = FALSE;
+			break;
+		}
+
+		rv = callback(entry.key, &entry.datum, user_data);
+		ni_dbus_dict_entry_clear(&entry);
+		if (!rv)
+			break;
+	}
+
+out:
+	if (call)
+		dbus_message_unref(call);
+	if (reply)
+		dbus_message_unref(reply);
+	return rv;
+}
+
 /*
  * Asynchronous dbus calls
  */
@@ -470,38 +590,59 @@ ni_dbus_object_call_async(ni_dbus_object_t *proxy,
 	return rv;
 }
 
-/*
- * Use ObjectManager.GetManagedObjects to retrieve (part of)
- * the server's object hierarchy
- */
-dbus_bool_t
-ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni_bool_t purge)
+int
+ni_dbus_object_call_variant_async(ni_dbus_object_t *proxy,
+			const char *interface_name, const char *method,
+			unsigned int nargs, const ni_dbus_variant_t *args,
+			ni_dbus_async_callback_t *callback, uint32_t *serial)
 {
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_message_t *call = NULL;
 	ni_dbus_client_t *client;
-	ni_dbus_object_t *objmgr;
-	ni_dbus_message_t *call = NULL, *reply = NULL;
-	DBusMessageIter iter, iter_dict;
-	dbus_bool_t rv = FALSE;
+	int rv;
 
-	if (!(client = ni_dbus_object_get_client(proxy))) {
-		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: not a client object", __FUNCTION__);
-		return FALSE;
+	if (!proxy || !interface_name || !(client = ni_dbus_object_get_client(proxy))) {
+		ni_error("%s: bad proxy object", __func__);
+		return -NI_ERROR_INVALID_ARGS;
 	}
 
-	if (purge)
-		__ni_dbus_object_mark_stale(proxy);
+	ni_debug_dbus("%s(%s.%s, %s)", __func__, interface_name, method, proxy->path);
+	call = dbus_message_new_method_call(client->bus_name, proxy->path, interface_name, method);
+	if (call == NULL) {
+		ni_error("%s: unable to build %s() message", __func__, method);
+		return -NI_ERROR_INVALID_ARGS;
+	}
 
-	objmgr = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class, proxy->path,
-			NI_DBUS_INTERFACE ".ObjectManager",
-			NULL);
+	if (nargs && !ni_dbus_message_serialize_variants(call, nargs, args, &error)) {
+		ni_dbus_print_error(&error, "%s: unable to serialize %s() arguments",
+				__func__, method);
+		dbus_error_free(&error);
+		rv = -NI_ERROR_CANNOT_MARSHAL;
+	} else {
+		rv = ni_dbus_connection_call_async(client->connection,
+				call, client->call_timeout,
+				callback, proxy);
 
-	call = ni_dbus_object_call_new(objmgr, "GetManagedObjects", 0);
-	if ((reply = ni_dbus_client_call(client, call, error)) == NULL)
-		goto out;
+		/* the serial the reply refers to, assigned on send */
+		if (rv >= 0 && serial)
+			*serial = dbus_message_get_serial(call);
+	}
+
+	dbus_message_unref(call);
+	return rv;
+}
+
+/*
+ * Create/update the proxy objects from a GetManagedObjects dict
+ */
+static dbus_bool_t
+__ni_dbus_object_process_managed_objects(ni_dbus_object_t *proxy, DBusMessageIter *iter)
+{
+	DBusMessageIter iter_dict;
+
+	if (!ni_dbus_message_open_dict_read(iter, &iter_dict))
+		return FALSE;
 
-	dbus_message_iter_init(reply, &iter);
-	if (!ni_dbus_message_open_dict_read(&iter, &iter_dict))
-		goto bad_reply;
 	while (dbus_message_iter_get_arg_type(&iter_dict) == DBUS_TYPE_DICT_ENTRY) {
 		DBusMessageIter iter_dict_entry;
 		ni_dbus_object_t *descendant;
@@ -511,11 +652,11 @@ ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni
 		dbus_message_iter_next(&iter_dict);
 
 		if (dbus_message_iter_get_arg_type(&iter_dict_entry) != DBUS_TYPE_STRING)
-			goto bad_reply;
+			return FALSE;
 		dbus_message_iter_get_basic(&iter_dict_entry, &object_path);
 
 		if (!dbus_message_iter_next(&iter_dict_entry))
-			goto bad_reply;
+			return FALSE;
 
 		descendant = ni_dbus_object_create(proxy, object_path, NULL, NULL);
 
@@ -538,11 +679,47 @@ ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni
 			descendant->class->initialize(descendant);
 
 		if (!__ni_dbus_object_get_managed_object_interfaces(descendant, &iter_dict_entry))
-			goto bad_reply;
+			return FALSE;
 
 		descendant->stale = FALSE;
 	}
 
+	return TRUE;
+}
+
+/*
+ * Use ObjectManager.GetManagedObjects to retrieve (part of)
+ * the server's object hierarchy
+ */
+dbus_bool_t
+ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni_bool_t purge)
+{
+	ni_dbus_client_t *client;
+	ni_dbus_object_t *objmgr;
+	ni_dbus_message_t *call = NULL, *reply = NULL;
+	DBusMessageIter iter;
+	dbus_bool_t rv = FALSE;
+
+	if (!(client = ni_dbus_object_get_client(proxy))) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: not a client object", __FUNCTION__);
+		return FALSE;
+	}
+
+	if (purge)
+		__ni_dbus_object_mark_stale(proxy);
+
+	objmgr = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class, proxy->path,
+			NI_DBUS_INTERFACE ".ObjectManager",
+			NULL);
+
+	call = ni_dbus_object_call_new(objmgr, "GetManagedObjects", 0);
+	if ((reply = ni_dbus_client_call(client, call, error)) == NULL)
+		goto out;
+
+	dbus_message_iter_init(reply, &iter);
+	if (!__ni_dbus_object_process_managed_objects(proxy, &iter))
+		goto bad_reply;
+
 	if (purge)
 		__ni_dbus_object_purge_stale(proxy);
 
@@ -561,6 +738,75 @@ bad_reply:
 	goto out;
 }
 
+/*
+ * Retrieve the children of a list object in pages, using a method
+ * which takes a cursor and the page size as arguments and returns a
+ * GetManagedObjects dict with the next cursor, 0 when done.
+ * Client and server then never need to hold the whole object tree in
+ * a single message.
+ */
+dbus_bool_t
+ni_dbus_object_get_managed_objects_paged(ni_dbus_object_t *proxy, const char *interface,
+		const char *method, unsigned int page_size, DBusError *error)
+{
+	ni_dbus_message_t *call = NULL, *reply = NULL;
+	uint32_t cursor = 0, count = page_size;
+	ni_dbus_client_t *client;
+	DBusMessageIter iter;
+	dbus_bool_t rv = FALSE;
+
+	if (!(client = ni_dbus_object_get_client(proxy))) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: not a client object", __FUNCTION__);
+		return FALSE;
+	}
+
+	if (!interface || !method || !count) {
+		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS, "%s: bad arguments", __FUNCTION__);
+		return FALSE;
+	}
+
+	__ni_dbus_object_mark_stale(proxy);
+	do {
+		call = dbus_message_new_method_call(client->bus_name, proxy->path, interface, method);
+		if (!call || !dbus_message_append_args(call,
+					DBUS_TYPE_UINT32, &cursor,
+					DBUS_TYPE_UINT32, &count,
+					DBUS_TYPE_INVALID)) {
+			dbus_set_error(error, DBUS_ERROR_NO_MEMORY, "%s: cannot build call", __FUNCTION__);
+			goto out;
+		}
+
+		if ((reply = ni_dbus_client_call(client, call, error)) == NULL)
+			goto out;
+		dbus_message_unref(call);
+		call = NULL;
+
+		dbus_message_iter_init(reply, &iter);
+		if (!__ni_dbus_object_process_managed_objects(proxy, &iter)
+		 || !dbus_message_iter_next(&iter)
+		 || dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_UINT32)
+			goto bad_reply;
+		dbus_message_iter_get_basic(&iter, &cursor);
+
+		dbus_message_unref(reply);
+		reply = NULL;
+	} while (cursor);
+
+	__ni_dbus_object_purge_stale(proxy);
+	rv = TRUE;
+
+out:
+	if (call)
+		dbus_message_unref(call);
+	if (reply)
+		dbus_message_unref(reply);
+	return rv;
+
+bad_reply:
+	dbus_set_error(error, DBUS_ERROR_FAILED, "%s: failed to parse reply", __FUNCTION__);
+	goto out;
+}
+
 static dbus_bool_t
 __ni_dbus_object_get_managed_object_interfaces(ni_dbus_object_t *proxy, DBusMessageIter *iter)
 {
@@ -792,6 +1038,32 @@ ni_dbus_object_refresh_children(ni_dbus_object_t *proxy)
 	return rv;
 }
 
+/*
+ * Refresh the properties of an object from a Properties.GetAll reply,
+ * e.g. as received by an asynchronous call.
+ */
+dbus_bool_t
+ni_dbus_object_refresh_properties_reply(ni_dbus_object_t *proxy, const ni_dbus_service_t *service,
+				ni_dbus_message_t *reply, DBusError *error)
+{
+	DBusMessageIter iter;
+
+	if (!proxy || !service || !reply) {
+		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS, "%s: invalid arguments", __func__);
+		return FALSE;
+	}
+
+	if (dbus_set_error_from_message(error, reply))
+		return FALSE;
+
+	dbus_message_iter_init(reply, &iter);
+	if (!__ni_dbus_object_refresh_properties(proxy, service, &iter)) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: failed to parse reply", __func__);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /*
  * Use Properties.GetAll to refresh the properties of an object
  */
@@ -801,7 +1073,6 @@ ni_dbus_object_refresh_properties(ni_dbus_object_t *proxy, const ni_dbus_service
 	ni_dbus_client_t *client;
 	ni_dbus_object_t *objmgr;
 	ni_dbus_message_t *call = NULL, *reply = NULL;
-	DBusMessageIter iter;
 	dbus_bool_t rv = FALSE;
 
 	if (!(client = ni_dbus_object_get_client(proxy))) {
@@ -818,10 +1089,7 @@ ni_dbus_object_refresh_properties(ni_dbus_object_t *proxy, const ni_dbus_service
 	if ((reply = ni_dbus_client_call(client, call, error)) == NULL)
 		goto out;
 
-	dbus_message_iter_init(reply, &iter);
-	rv = __ni_dbus_object_refresh_properties(proxy, service, &iter);
-	if (!rv)
-		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: failed to parse reply", __func__);
+	rv = ni_dbus_object_refresh_properties_reply(proxy, service, reply, error);
 
 out:
 	if (call)
@@ -832,6 +1100,64 @@ out:
 	return rv;
 }
 
+/*
+ * Apply a Properties.PropertiesChanged signal to a proxy object.
+ * Returns FALSE when the delta cannot be applied exactly and the
+ * caller has to refresh the object properties instead.
+ */
+dbus_bool_t
+ni_dbus_object_apply_properties_changed(ni_dbus_object_t *proxy, ni_dbus_message_t *msg)
+{
+	ni_dbus_variant_t argv[3];
+	const ni_dbus_service_t *service;
+	const ni_dbus_property_t *property;
+	const ni_dbus_dict_entry_t *entry;
+	dbus_bool_t rv = FALSE;
+	unsigned int i;
+	int argc;
+
+	memset(argv, 0, sizeof(argv));
+	argc = ni_dbus_message_get_args_variants(msg, argv, 3);
+	if (argc != 3
+	 || argv[0].type != DBUS_TYPE_STRING
+	 || !ni_dbus_variant_is_dict(&argv[1])
+	 || !ni_dbus_variant_is_string_array(&argv[2]))
+		goto out;
+
+	if (argv[2].array.len) {
+		ni_debug_dbus("%s: %u %s properties invalidated", proxy->path,
+				argv[2].array.len, argv[0].string_value);
+		goto out;
+	}
+
+	if (!(service = ni_dbus_object_get_service(proxy, argv[0].string_value))
+	 || !service->properties)
+		goto out;
+
+	/* Dicts without a setter are merged into the object and would
+	 * keep removed members, so only apply what we can replace */
+	for (i = 0, entry = argv[1].dict_array_value; i < argv[1].array.len; ++i, ++entry) {
+		property = __ni_dbus_service_get_property(service->properties, entry->key);
+		if (!property || !property->set)
+			goto out;
+	}
+
+	for (i = 0, entry = argv[1].dict_array_value; i < argv[1].array.len; ++i, ++entry) {
+		if (!__ni_dbus_object_refresh_property(proxy, service, service->properties,
+							entry->key, &entry->datum))
+			goto out;
+	}
+
+	ni_debug_dbus("%s: applied %u changed %s properties", proxy->path,
+			argv[1].array.len, service->name);
+	rv = TRUE;
+
+out:
+	for (i = 0; i < 3; ++i)
+		ni_dbus_variant_destroy(&argv[i]);
+	return rv;
+}
+
 /*
  * Use Properties.Set to update one properties of an object
  */
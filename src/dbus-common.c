@@ -584,30 +584,88 @@ ni_dbus_variant_is_uint32_array(const ni_dbus_variant_t *var)
 
 /*
  * Helper function for handling arrays
+ *
+ * Arrays start with a chunk of elements and then double their size,
+ * so appending many elements one at a time does not copy the array
+ * over and over again. Newly allocated elements are zeroed.
  */
 #define NI_DBUS_ARRAY_CHUNK		32
 #define NI_DBUS_ARRAY_ALLOCATION(len)	(((len) + NI_DBUS_ARRAY_CHUNK - 1) & ~(NI_DBUS_ARRAY_CHUNK - 1))
+static void
+__ni_dbus_array_resize(ni_dbus_variant_t *var, size_t element_size, unsigned int max)
+{
+	void *new_data;
+
+	new_data = xrealloc(var->byte_array_value, max * element_size);
+	if (new_data == NULL)
+		ni_fatal("%s: out of memory try to grow array to %u elements",
+				__FUNCTION__, max);
+
+	memset((unsigned char *) new_data + var->array.alloc * element_size, 0,
+			(max - var->array.alloc) * element_size);
+	var->byte_array_value = new_data;
+	var->array.alloc = max;
+}
+
 static inline void
 __ni_dbus_array_grow(ni_dbus_variant_t *var, size_t element_size, unsigned int grow_by)
 {
-	unsigned int max = NI_DBUS_ARRAY_ALLOCATION(var->array.len);
 	unsigned int len = var->array.len;
+	unsigned int max;
 
-	if (len + grow_by >= max) {
-		void *new_data;
+	if (len + grow_by <= var->array.alloc)
+		return;
 
-		max = NI_DBUS_ARRAY_ALLOCATION(len + grow_by);
-		new_data = xcalloc(max, element_size);
-		if (new_data == NULL)
-			ni_fatal("%s: out of memory try to grow array to %u elements",
-					__FUNCTION__, len + grow_by);
+	max = NI_DBUS_ARRAY_ALLOCATION(len + grow_by);
+	if (max < 2 * var->array.alloc)
+		max = 2 * var->array.alloc;
+	__ni_dbus_array_resize(var, element_size, max);
+}
 
-		memcpy(new_data, var->byte_array_value, len * element_size);
-		free(var->byte_array_value);
-		var->byte_array_value = new_data;
+static size_t
+__ni_dbus_array_element_size(const ni_dbus_variant_t *var)
+{
+	switch (var->array.element_type) {
+	case DBUS_TYPE_BYTE:
+		return sizeof(unsigned char);
+	case DBUS_TYPE_UINT32:
+		return sizeof(uint32_t);
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		return sizeof(char *);
+	case DBUS_TYPE_DICT_ENTRY:
+		return sizeof(ni_dbus_dict_entry_t);
+	case DBUS_TYPE_INVALID:
+		if (var->array.element_signature == NULL)
+			return 0;
+		/* fallthrough */
+	case DBUS_TYPE_VARIANT:
+	case DBUS_TYPE_STRUCT:
+		return sizeof(ni_dbus_variant_t);
+	default:
+		return 0;
 	}
 }
 
+/*
+ * Make room for count more elements in an array or dict, for callers
+ * which know in advance how many elements they are going to add.
+ */
+dbus_bool_t
+ni_dbus_variant_reserve(ni_dbus_variant_t *var, unsigned int count)
+{
+	size_t element_size;
+
+	if (!var || var->type != DBUS_TYPE_ARRAY)
+		return FALSE;
+	if (!(element_size = __ni_dbus_array_element_size(var)))
+		return FALSE;
+
+	if (var->array.len + count > var->array.alloc)
+		__ni_dbus_array_resize(var, element_size, var->array.len + count);
+	return TRUE;
+}
+
 void
 ni_dbus_variant_init_byte_array(ni_dbus_variant_t *var)
 {
@@ -766,6 +824,106 @@ ni_dbus_variant_copy(ni_dbus_variant_t *dst, const ni_dbus_variant_t *src)
 	ni_fatal("%s: not implemented", __FUNCTION__);
 }
 
+/*
+ * Compare two variants by type and value
+ */
+dbus_bool_t
+ni_dbus_variant_equal(const ni_dbus_variant_t *a, const ni_dbus_variant_t *b)
+{
+	unsigned int i;
+
+	if (a == b)
+		return TRUE;
+	if (!a || !b || a->type != b->type)
+		return FALSE;
+
+	switch (a->type) {
+	case DBUS_TYPE_INVALID:
+		return TRUE;
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		return ni_string_eq(a->string_value, b->string_value);
+	case DBUS_TYPE_BYTE:
+		return a->byte_value == b->byte_value;
+	case DBUS_TYPE_BOOLEAN:
+		return !a->bool_value == !b->bool_value;
+	case DBUS_TYPE_INT16:
+		return a->int16_value == b->int16_value;
+	case DBUS_TYPE_UINT16:
+		return a->uint16_value == b->uint16_value;
+	case DBUS_TYPE_INT32:
+		return a->int32_value == b->int32_value;
+	case DBUS_TYPE_UINT32:
+		return a->uint32_value == b->uint32_value;
+	case DBUS_TYPE_INT64:
+		return a->int64_value == b->int64_value;
+	case DBUS_TYPE_UINT64:
+		return a->uint64_value == b->uint64_value;
+	case DBUS_TYPE_DOUBLE:
+		return a->double_value == b->double_value;
+	case DBUS_TYPE_VARIANT:
+		return ni_dbus_variant_equal(a->variant_value, b->variant_value);
+	case DBUS_TYPE_STRUCT:
+		if (a->array.len != b->array.len)
+			return FALSE;
+		for (i = 0; i < a->array.len; ++i) {
+			if (!ni_dbus_variant_equal(&a->struct_value[i], &b->struct_value[i]))
+				return FALSE;
+		}
+		return TRUE;
+	case DBUS_TYPE_ARRAY:
+		break;
+	default:
+		return FALSE;
+	}
+
+	if (a->array.element_type != b->array.element_type
+	 || a->array.len != b->array.len
+	 || !ni_string_eq(a->array.element_signature, b->array.element_signature))
+		return FALSE;
+
+	switch (a->array.element_type) {
+	case DBUS_TYPE_BYTE:
+		return !a->array.len || !memcmp(a->byte_array_value, b->byte_array_value, a->array.len);
+	case DBUS_TYPE_UINT32:
+		return !a->array.len || !memcmp(a->uint32_array_value, b->uint32_array_value,
+						a->array.len * sizeof(uint32_t));
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		for (i = 0; i < a->array.len; ++i) {
+			if (!ni_string_eq(a->string_array_value[i], b->string_array_value[i]))
+				return FALSE;
+		}
+		return TRUE;
+	case DBUS_TYPE_DICT_ENTRY:
+		for (i = 0; i < a->array.len; ++i) {
+			if (!ni_string_eq(a->dict_array_value[i].key, b->dict_array_value[i].key)
+			 || !ni_dbus_variant_equal(&a->dict_array_value[i].datum,
+						   &b->dict_array_value[i].datum))
+				return FALSE;
+		}
+		return TRUE;
+	case DBUS_TYPE_INVALID:
+		if (a->array.element_signature == NULL)
+			return TRUE;
+		/* fallthrough */
+	case DBUS_TYPE_VARIANT:
+		for (i = 0; i < a->array.len; ++i) {
+			if (!ni_dbus_variant_equal(&a->variant_array_value[i], &b->variant_array_value[i]))
+				return FALSE;
+		}
+		return TRUE;
+	case DBUS_TYPE_STRUCT:
+		for (i = 0; i < a->array.len; ++i) {
+			if (!ni_dbus_variant_equal(&a->struct_value[i], &b->struct_value[i]))
+				return FALSE;
+		}
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 void
 ni_dbus_variant_destroy(ni_dbus_variant_t *var)
 {
@@ -35,6 +35,10 @@ extern dbus_bool_t		ni_dbus_message_iter_append_byte_array(DBusMessageIter *iter
 						const unsigned char *value, unsigned int len);
 extern dbus_bool_t		ni_dbus_message_iter_append_uint32_array(DBusMessageIter *iter,
 					const uint32_t *value, unsigned int len);
+extern dbus_bool_t		ni_dbus_message_iter_append_string_array(DBusMessageIter *iter,
+					char **string_array, unsigned int len);
+extern dbus_bool_t		ni_dbus_message_iter_append_dict_entry(DBusMessageIter *iter,
+					const ni_dbus_dict_entry_t *entry);
 
 extern const ni_dbus_property_t *__ni_dbus_service_get_property(const ni_dbus_property_t *, const char *);
 
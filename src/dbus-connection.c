@@ -8,6 +8,8 @@
 #endif
 
 #include <sys/poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <errno.h>
 
 #include <wicked/util.h>
@@ -45,6 +47,7 @@ struct ni_dbus_sigaction {
 	char *			sender;
 	char *			object_path;
 	char *			object_interface;
+	char *			match;
 	ni_dbus_signal_handler_t *signal_handler;
 	void *			user_data;
 };
@@ -52,6 +55,8 @@ struct ni_dbus_sigaction {
 struct ni_dbus_connection {
 	DBusConnection *	conn;
 	ni_bool_t		private;
+	ni_bool_t		peer;		/* direct, not via the bus daemon */
+	char *			address;	/* of the peer to reconnect to */
 
 	ni_dbus_async_client_call_t *async_client_calls;
 	ni_dbus_async_server_call_t *async_server_calls;
@@ -79,14 +84,24 @@ struct ni_dbus_watch_data {
 };
 static ni_dbus_watch_data_t *	ni_dbus_watches;
 
+struct ni_dbus_peer_listener {
+	DBusServer *		server;
+	char *			path;
+	ni_dbus_peer_accept_t *	accept;
+	void *			user_data;
+};
+
 static void			__ni_dbus_sigaction_free(ni_dbus_sigaction_t *);
 static void			__ni_dbus_async_server_call_free(ni_dbus_async_server_call_t *);
 static void			__ni_dbus_async_client_call_free(ni_dbus_async_client_call_t *);
 static void			__ni_dbus_notify_async(DBusPendingCall *, void *);
 static dbus_bool_t		__ni_dbus_add_watch(DBusWatch *, void *);
 static void			__ni_dbus_remove_watch(DBusWatch *, void *);
+static void			__ni_dbus_toggle_watch(DBusWatch *, void *);
 static DBusHandlerResult	__ni_dbus_signal_filter(DBusConnection *, DBusMessage *, void *);
 static void			__ni_dbus_connection_dispatch(ni_dbus_connection_t *);
+static void			__ni_dbus_connection_setup(ni_dbus_connection_t *);
+static void			__ni_dbus_connection_reconnect(ni_dbus_connection_t *);
 
 static int			ni_dbus_use_socket_mainloop = 1;
 
@@ -189,25 +204,130 @@ ni_dbus_connection_open(const char *bus_type_string, const char *bus_name)
 		ni_debug_dbus("Successfully acquired bus name \"%s\"", bus_name);
 	}
 
+	__ni_dbus_connection_setup(connection);
+	return connection;
+
+failed_unexpectedly:
+	ni_error("%s: unexpected error", __FUNCTION__);
+
+failed:
+	ni_dbus_connection_free(connection);
+	dbus_error_free(&error);
+	return NULL;
+}
+
+static void
+__ni_dbus_connection_setup(ni_dbus_connection_t *connection)
+{
 	dbus_connection_add_filter(connection->conn, __ni_dbus_signal_filter, connection, NULL);
 	if (ni_dbus_use_socket_mainloop) {
 		dbus_connection_set_watch_functions(connection->conn,
 				__ni_dbus_add_watch,
 				__ni_dbus_remove_watch,
-				NULL,			/* toggle_function */
+				__ni_dbus_toggle_watch,
 				connection,		/* data */
 				NULL);			/* free_data_function */
 	}
+}
+
+/*
+ * Constructor for a direct (peer-to-peer) connection to the private
+ * socket of a wicked service, without any bus daemon in between.
+ */
+static DBusConnection *
+__ni_dbus_connection_connect_peer(const char *address)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	DBusConnection *conn;
+
+	conn = dbus_connection_open_private(address, &error);
+	if (conn == NULL)
+		ni_debug_dbus("Cannot connect to dbus peer %s (%s)", address,
+				dbus_error_is_set(&error) ? error.message : "unexpected error");
+	dbus_error_free(&error);
+	return conn;
+}
 
+ni_dbus_connection_t *
+ni_dbus_connection_open_peer(const char *path)
+{
+	ni_dbus_connection_t *connection;
+	char *escaped, *address = NULL;
+	DBusConnection *conn;
+
+	NI_TRACE_ENTER_ARGS("path=%s", path);
+
+	/* only root may connect to the (0600) socket of a root daemon */
+	if (ni_string_empty(path) || access(path, R_OK | W_OK) < 0)
+		return NULL;
+
+	if (!(escaped = dbus_address_escape_value(path)))
+		return NULL;
+	ni_string_printf(&address, "unix:path=%s", escaped);
+	dbus_free(escaped);
+
+	if (!address || !(conn = __ni_dbus_connection_connect_peer(address))) {
+		ni_string_free(&address);
+		return NULL;
+	}
+
+	connection = xcalloc(1, sizeof(*connection));
+	connection->conn = conn;
+	connection->private = TRUE;
+	connection->peer = TRUE;
+	connection->address = address;
+	__ni_dbus_connection_setup(connection);
+
+	ni_debug_dbus("Connected to dbus peer %s", connection->address);
 	return connection;
+}
 
-failed_unexpectedly:
-	ni_error("%s: unexpected error", __FUNCTION__);
+/*
+ * A peer which closed the connection, e.g. on restart, is not there
+ * any more, so we connect again, before to send something new.
+ * Signals do not need any subscription, the handlers are just kept.
+ */
+static void
+__ni_dbus_connection_reconnect(ni_dbus_connection_t *connection)
+{
+	DBusConnection *conn;
 
-failed:
-	ni_dbus_connection_free(connection);
-	dbus_error_free(&error);
-	return NULL;
+	if (!connection->peer || !connection->address || connection->dispatching)
+		return;
+
+	if (dbus_connection_get_is_connected(connection->conn))
+		return;
+
+	if (!(conn = __ni_dbus_connection_connect_peer(connection->address)))
+		return;
+
+	ni_debug_dbus("Reconnected to dbus peer %s", connection->address);
+
+	/* fail the calls pending in the old connection */
+	__ni_dbus_connection_dispatch(connection);
+	dbus_connection_remove_filter(connection->conn, __ni_dbus_signal_filter, connection);
+	dbus_connection_close(connection->conn);
+	dbus_connection_unref(connection->conn);
+
+	connection->conn = conn;
+	__ni_dbus_connection_setup(connection);
+}
+
+ni_bool_t
+ni_dbus_connection_is_peer(const ni_dbus_connection_t *connection)
+{
+	return connection && connection->peer;
+}
+
+/*
+ * A peer connection, which can be released: the peer disconnected
+ * and we're not dispatching a message of it at the moment.
+ */
+ni_bool_t
+ni_dbus_connection_is_disconnected(const ni_dbus_connection_t *connection)
+{
+	return connection && !connection->dispatching &&
+		!dbus_connection_get_is_connected(connection->conn);
 }
 
 /*
@@ -250,6 +370,7 @@ ni_dbus_connection_free(ni_dbus_connection_t *dbc)
 		dbc->conn = NULL;
 	}
 
+	ni_string_free(&dbc->address);
 	free(dbc);
 }
 
@@ -312,6 +433,7 @@ ni_dbus_connection_call(ni_dbus_connection_t *connection,
 	DBusMessage *reply;
 	int msgtype;
 
+	__ni_dbus_connection_reconnect(connection);
 	if (!dbus_connection_send_with_reply(connection->conn, call, &pending, call_timeout)) {
 		dbus_set_error(error, DBUS_ERROR_FAILED,
 				"unable to send DBus message (errno=%d)", errno);
@@ -366,6 +488,7 @@ ni_dbus_connection_call_async(ni_dbus_connection_t *connection,
 {
 	DBusPendingCall *pending;
 
+	__ni_dbus_connection_reconnect(connection);
 	if (!dbus_connection_send_with_reply(connection->conn, call, &pending, timeout)) {
 		ni_error("dbus: unable to send async message (errno=%d): %m", errno);
 		return -NI_ERROR_DBUS_CALL_FAILED;
@@ -389,12 +512,28 @@ __ni_dbus_notify_async(DBusPendingCall *pending, void *call_data)
 	__ni_dbus_process_pending(conn, pending);
 }
 
+/*
+ * Wait up to timeout msec for data on the connection and dispatch it,
+ * e.g. to receive an expected signal while blocking in a method call.
+ */
+dbus_bool_t
+ni_dbus_connection_wait(ni_dbus_connection_t *connection, unsigned int timeout)
+{
+	if (!dbus_connection_read_write(connection->conn, timeout))
+		return FALSE;
+
+	if (!connection->dispatching)
+		__ni_dbus_connection_dispatch(connection);
+	return TRUE;
+}
+
 /*
  * Send a message out
  */
 int
 ni_dbus_connection_send_message(ni_dbus_connection_t *connection, ni_dbus_message_t *msg)
 {
+	__ni_dbus_connection_reconnect(connection);
 	if (!dbus_connection_send(connection->conn, msg, NULL))
 		return -NI_ERROR_DBUS_CALL_FAILED;
 	return 0;
@@ -422,7 +561,7 @@ ni_dbus_connection_send_error(ni_dbus_connection_t *connection, ni_dbus_message_
  * Signal handling
  */
 static ni_dbus_sigaction_t *
-__ni_sigaction_new(const char *object_interface,
+__ni_sigaction_new(const char *object_interface, const char *match,
 				ni_dbus_signal_handler_t *callback,
 				void *user_data)
 {
@@ -430,6 +569,7 @@ __ni_sigaction_new(const char *object_interface,
 
 	s = calloc(1, sizeof(*s));
 	ni_string_dup(&s->object_interface, object_interface);
+	ni_string_dup(&s->match, match);
 	s->signal_handler = callback;
 	s->user_data = user_data;
 
@@ -440,13 +580,12 @@ static void
 __ni_dbus_sigaction_free(ni_dbus_sigaction_t *s)
 {
 	ni_string_free(&s->object_interface);
+	ni_string_free(&s->match);
 	free(s);
 }
 
-void
-ni_dbus_add_signal_handler(ni_dbus_connection_t *connection,
-					const char *sender,
-					const char *object_path,
+static void
+__ni_dbus_add_signal_match(ni_dbus_connection_t *connection, const char *spec,
 					const char *object_interface,
 					ni_dbus_signal_handler_t *callback,
 					void *user_data)
@@ -454,19 +593,11 @@ ni_dbus_add_signal_handler(ni_dbus_connection_t *connection,
 	DBusMessage *call = NULL, *reply = NULL;
 	DBusError error = DBUS_ERROR_INIT;
 	ni_dbus_sigaction_t *sigact;
-	char specbuf[1024], *arg;
+	const char *arg = spec;
 
-	if (sender && object_path && object_interface) {
-		snprintf(specbuf, sizeof(specbuf), "type='signal',sender='%s',path='%s',interface='%s'",
-			sender, object_path, object_interface);
-	} else if (sender && object_interface) {
-		snprintf(specbuf, sizeof(specbuf), "type='signal',sender='%s',interface='%s'",
-			sender, object_interface);
-	} else {
-		snprintf(specbuf, sizeof(specbuf), "type='signal',interface='%s'",
-			object_interface);
-	}
-	arg = specbuf;
+	/* a peer sends its signals to us without to ask for */
+	if (connection->peer)
+		goto add;
 
 	call = dbus_message_new_method_call(NI_DBUS_BUS_NAME,
 			NI_DBUS_OBJECT_PATH, NI_DBUS_INTERFACE, "AddMatch");
@@ -476,7 +607,8 @@ ni_dbus_add_signal_handler(ni_dbus_connection_t *connection,
 	if ((reply = ni_dbus_connection_call(connection, call, 1000 * 10, &error)) == NULL)
 		goto out;
 
-	sigact = __ni_sigaction_new(object_interface, callback, user_data);
+add:
+	sigact = __ni_sigaction_new(object_interface, spec, callback, user_data);
 	sigact->next = connection->sighandlers;
 	connection->sighandlers = sigact;
 
@@ -493,6 +625,99 @@ failed:
 	goto out;
 }
 
+void
+ni_dbus_add_signal_handler(ni_dbus_connection_t *connection,
+					const char *sender,
+					const char *object_path,
+					const char *object_interface,
+					ni_dbus_signal_handler_t *callback,
+					void *user_data)
+{
+	char specbuf[1024];
+
+	if (sender && object_path && object_interface) {
+		snprintf(specbuf, sizeof(specbuf), "type='signal',sender='%s',path='%s',interface='%s'",
+			sender, object_path, object_interface);
+	} else if (sender && object_interface) {
+		snprintf(specbuf, sizeof(specbuf), "type='signal',sender='%s',interface='%s'",
+			sender, object_interface);
+	} else {
+		snprintf(specbuf, sizeof(specbuf), "type='signal',interface='%s'",
+			object_interface);
+	}
+
+	__ni_dbus_add_signal_match(connection, specbuf, object_interface, callback, user_data);
+}
+
+/*
+ * Subscribe to the signals of an interface, sent by the sender for the
+ * objects below the path_namespace and optionally with the member name
+ * only. The bus daemon does not forward any other signals to us then,
+ * so we don't need to wake up and drop them locally.
+ */
+void
+ni_dbus_add_signal_match(ni_dbus_connection_t *connection,
+					const char *sender,
+					const char *path_namespace,
+					const char *object_interface,
+					const char *member,
+					ni_dbus_signal_handler_t *callback,
+					void *user_data)
+{
+	ni_stringbuf_t spec = NI_STRINGBUF_INIT_DYNAMIC;
+
+	ni_stringbuf_puts(&spec, "type='signal'");
+	if (sender)
+		ni_stringbuf_printf(&spec, ",sender='%s'", sender);
+	if (path_namespace)
+		ni_stringbuf_printf(&spec, ",path_namespace='%s'", path_namespace);
+	if (object_interface)
+		ni_stringbuf_printf(&spec, ",interface='%s'", object_interface);
+	if (member)
+		ni_stringbuf_printf(&spec, ",member='%s'", member);
+
+	__ni_dbus_add_signal_match(connection, spec.string, object_interface, callback, user_data);
+	ni_stringbuf_destroy(&spec);
+}
+
+/*
+ * Remove the signal handlers registered with user_data, e.g. of
+ * a client fsm freed while the connection is in use further on.
+ */
+void
+ni_dbus_remove_signal_handlers(ni_dbus_connection_t *connection, const void *user_data)
+{
+	ni_dbus_sigaction_t **pos, *sigact;
+	DBusMessage *call;
+	const char *arg;
+
+	for (pos = &connection->sighandlers; (sigact = *pos) != NULL; ) {
+		if (sigact->user_data != user_data) {
+			pos = &sigact->next;
+			continue;
+		}
+		*pos = sigact->next;
+
+		if (connection->peer) {
+			__ni_dbus_sigaction_free(sigact);
+			continue;
+		}
+
+		call = dbus_message_new_method_call(NI_DBUS_BUS_NAME,
+				NI_DBUS_OBJECT_PATH, NI_DBUS_INTERFACE, "RemoveMatch");
+		arg = sigact->match;
+		if (call && arg && dbus_message_append_args(call, DBUS_TYPE_STRING, &arg, 0)) {
+			/* no reply needed, the rule is just dropped */
+			dbus_message_set_no_reply(call, TRUE);
+			dbus_connection_send(connection->conn, call, NULL);
+		}
+		if (call)
+			dbus_message_unref(call);
+
+		__ni_dbus_sigaction_free(sigact);
+	}
+}
+
 static DBusHandlerResult
 __ni_dbus_signal_filter(DBusConnection *conn, DBusMessage *msg, void *user_data)
 {
@@ -637,9 +862,19 @@ ni_dbus_connection_get_caller_uid(ni_dbus_connection_t *conn, const char *name,
 {
 	DBusError error = DBUS_ERROR_INIT;
 	DBusMessage *call = NULL, *reply = NULL;
+	unsigned long peer_uid;
 	uint32_t user_id;
 	int rv = 0;
 
+	/* a peer authenticated itself on connect, there is no bus to ask */
+	if (conn->peer) {
+		if (!dbus_connection_get_unix_user(conn->conn, &peer_uid))
+			return -NI_ERROR_DBUS_CALL_FAILED;
+		if (uidp)
+			*uidp = peer_uid;
+		return 0;
+	}
+
 	call = dbus_message_new_method_call("org.freedesktop.DBus",
 					"/org/freedesktop/DBus",
 					"org.freedesktop.DBus",
@@ -708,11 +943,33 @@ __ni_dbus_watch_flags(int flags)
 	return "???";
 }
 
+/*
+ * The poll flags of a socket, as needed by the enabled watches.
+ */
+static int
+__ni_dbus_watch_poll_flags(const ni_socket_t *sock)
+{
+	ni_dbus_watch_data_t *wd;
+	int watch_flags, poll_flags = 0;
+
+	for (wd = ni_dbus_watches; wd; wd = wd->next) {
+		if (wd->socket != sock || !dbus_watch_get_enabled(wd->watch))
+			continue;
+
+		watch_flags = dbus_watch_get_flags(wd->watch);
+		if (watch_flags & DBUS_WATCH_READABLE)
+			poll_flags |= POLLIN;
+		if (watch_flags & DBUS_WATCH_WRITABLE)
+			poll_flags |= POLLOUT;
+	}
+	return poll_flags;
+}
+
 static inline void
 __ni_dbus_watch_handle(const char *func, ni_socket_t *sock, int flags)
 {
 	ni_dbus_watch_data_t *wd;
-	int found = 0, poll_flags = 0;
+	int found = 0;
 
 	/* All of this is somewhat more complicated than it may need to be.
 	 * For some odd reason, libdbus insists on maintaining two watches
@@ -721,9 +978,8 @@ __ni_dbus_watch_handle(const char *func, ni_socket_t *sock, int flags)
 	 */
 restart:
 	for (wd = ni_dbus_watches; wd; wd = wd->next) {
-		int new_watch_flags;
 #ifdef DEBUG_WATCH_VERBOSE
-		int old_watch_flags;
+		int old_watch_flags, new_watch_flags;
 #endif
 
 		if (wd->socket != sock)
@@ -749,18 +1005,11 @@ restart:
 			goto restart;
 		}
 
-		if (flags & (DBUS_WATCH_READABLE | DBUS_WATCH_WRITABLE))
+		if (wd->connection && (flags & (DBUS_WATCH_READABLE | DBUS_WATCH_WRITABLE)))
 			__ni_dbus_connection_dispatch(wd->connection);
 
-		new_watch_flags = dbus_watch_get_flags(wd->watch);
-		if (dbus_watch_get_enabled(wd->watch)) {
-			if (new_watch_flags & DBUS_WATCH_READABLE)
-				poll_flags |= POLLIN;
-			if (new_watch_flags & DBUS_WATCH_WRITABLE)
-				poll_flags |= POLLOUT;
-		}
-
 #ifdef DEBUG_WATCH_VERBOSE
+		new_watch_flags = dbus_watch_get_flags(wd->watch);
 		if (old_watch_flags != new_watch_flags) {
 			ni_debug_dbus("%s: changing watch flags %s to %s",
 					__func__,
@@ -771,7 +1020,8 @@ restart:
 		__ni_put_dbus_watch_data(wd);
 	}
 
-	sock->poll_flags = poll_flags;
+	/* handling one watch may toggle the others */
+	sock->poll_flags = __ni_dbus_watch_poll_flags(sock);
 	if (!found)
 		ni_warn("%s: dead socket", func);
 }
@@ -833,8 +1083,10 @@ __ni_dbus_add_watch(DBusWatch *watch, void *data)
 	ni_dbus_watch_data_t *wd;
 	ni_socket_t *sock = NULL;
 
+	/* the listener watches (with NULL connection) reuse by fd only */
 	for (wd = ni_dbus_watches; wd; wd = wd->next) {
-		if (wd->connection == connection) {
+		if (wd->connection == connection &&
+		    dbus_watch_get_socket(wd->watch) == dbus_watch_get_socket(watch)) {
 			sock = wd->socket;
 			break;
 		}
@@ -900,6 +1152,132 @@ __ni_dbus_remove_watch(DBusWatch *watch, void *dummy)
 	ni_warn("%s(%p): watch not found", __FUNCTION__, watch);
 }
 
+/*
+ * Listen for peer-to-peer connections on a private unix socket, e.g. of
+ * the wicked daemons talking to each other without the bus daemon. The
+ * accept callback takes over the new, authenticated connections.
+ */
+static void
+__ni_dbus_peer_listener_accept(DBusServer *server, DBusConnection *conn, void *data)
+{
+	ni_dbus_peer_listener_t *listener = data;
+	ni_dbus_connection_t *connection;
+
+	connection = xcalloc(1, sizeof(*connection));
+	connection->conn = dbus_connection_ref(conn);
+	connection->private = TRUE;
+	connection->peer = TRUE;
+	__ni_dbus_connection_setup(connection);
+
+	ni_debug_dbus("Accepted dbus peer connection on %s", listener->path);
+	listener->accept(connection, listener->user_data);
+}
+
+ni_dbus_peer_listener_t *
+ni_dbus_peer_listen(const char *path, ni_dbus_peer_accept_t *accept, void *user_data)
+{
+	static const char *mechanisms[] = { "EXTERNAL", NULL };
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_peer_listener_t *listener;
+	char *escaped, *address = NULL;
+	struct stat stb;
+
+	if (ni_string_empty(path) || !accept)
+		return NULL;
+
+	/* remove a stale socket of a previous instance */
+	if (lstat(path, &stb) == 0 && S_ISSOCK(stb.st_mode))
+		unlink(path);
+
+	if (!(escaped = dbus_address_escape_value(path)))
+		return NULL;
+	ni_string_printf(&address, "unix:path=%s", escaped);
+	dbus_free(escaped);
+
+	listener = xcalloc(1, sizeof(*listener));
+	ni_string_dup(&listener->path, path);
+	listener->accept = accept;
+	listener->user_data = user_data;
+
+	if (!address || !(listener->server = dbus_server_listen(address, &error))) {
+		ni_error("Cannot listen for dbus peers on %s (%s)", path,
+				dbus_error_is_set(&error) ? error.message : "unexpected error");
+		goto failed;
+	}
+
+	if (chmod(path, S_IRUSR | S_IWUSR) < 0) {
+		ni_error("Cannot set permissions of dbus peer socket %s: %m", path);
+		goto failed;
+	}
+
+	dbus_server_set_auth_mechanisms(listener->server, mechanisms);
+	dbus_server_set_new_connection_function(listener->server,
+			__ni_dbus_peer_listener_accept, listener, NULL);
+	if (!dbus_server_set_watch_functions(listener->server,
+				__ni_dbus_add_watch,
+				__ni_dbus_remove_watch,
+				__ni_dbus_toggle_watch,
+				NULL,			/* no connection */
+				NULL)) {		/* free_data_function */
+		ni_error("Cannot watch dbus peer socket %s", path);
+		goto failed;
+	}
+
+	ni_debug_dbus("Listening for dbus peers on %s", path);
+	ni_string_free(&address);
+	dbus_error_free(&error);
+	return listener;
+
+failed:
+	ni_string_free(&address);
+	dbus_error_free(&error);
+	ni_dbus_peer_listener_free(listener);
+	return NULL;
+}
+
+void
+ni_dbus_peer_listener_free(ni_dbus_peer_listener_t *listener)
+{
+	if (!listener)
+		return;
+
+	if (listener->server) {
+		dbus_server_disconnect(listener->server);
+		dbus_server_unref(listener->server);
+		unlink(listener->path);
+	}
+	ni_string_free(&listener->path);
+	free(listener);
+}
+
+/*
+ * Register a fallback handler for the objects below path, e.g. of
+ * a server dispatching the calls it receives on a peer connection.
+ */
+void
+ni_dbus_connection_register_fallback(ni_dbus_connection_t *connection, const char *path,
+				const DBusObjectPathVTable *vtable, void *user_data)
+{
+	dbus_connection_register_fallback(connection->conn, path, vtable, user_data);
+}
+
+/*
+ * A connection authenticating in the main loop, e.g. a peer we've
+ * accepted, enables and disables its watches while doing so.
+ */
+void
+__ni_dbus_toggle_watch(DBusWatch *watch, void *dummy)
+{
+	ni_dbus_watch_data_t *wd;
+
+	for (wd = ni_dbus_watches; wd; wd = wd->next) {
+		if (wd->watch == watch && wd->socket) {
+			wd->socket->poll_flags = __ni_dbus_watch_poll_flags(wd->socket);
+			return;
+		}
+	}
+}
+
 void
 __ni_dbus_connection_dispatch(ni_dbus_connection_t *connection)
 {
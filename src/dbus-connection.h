@@ -11,13 +11,20 @@
 #include <dbus/dbus.h>
 #include "dbus-common.h"
 
+typedef struct ni_dbus_peer_listener ni_dbus_peer_listener_t;
+typedef void			ni_dbus_peer_accept_t(ni_dbus_connection_t *, void *user_data);
+
 extern ni_dbus_connection_t *	ni_dbus_connection_open(const char *bus_type, const char *bus_name);
+extern ni_dbus_connection_t *	ni_dbus_connection_open_peer(const char *path);
+extern ni_bool_t		ni_dbus_connection_is_peer(const ni_dbus_connection_t *);
+extern ni_bool_t		ni_dbus_connection_is_disconnected(const ni_dbus_connection_t *);
 extern void			ni_dbus_connection_free(ni_dbus_connection_t *);
 extern ni_dbus_message_t *	ni_dbus_connection_call(ni_dbus_connection_t *connection,
 					ni_dbus_message_t *call, unsigned int call_timeout, DBusError *error);
 extern int			ni_dbus_connection_call_async(ni_dbus_connection_t *connection,
 					ni_dbus_message_t *call, unsigned int timeout,
 					ni_dbus_async_callback_t *callback, ni_dbus_object_t *proxy);
+extern dbus_bool_t		ni_dbus_connection_wait(ni_dbus_connection_t *, unsigned int);
 extern int			ni_dbus_connection_send_message(ni_dbus_connection_t *, ni_dbus_message_t *);
 extern void			ni_dbus_connection_send_error(ni_dbus_connection_t *, ni_dbus_message_t *, DBusError *);
 extern void			ni_dbus_add_signal_handler(ni_dbus_connection_t *conn,
@@ -26,8 +33,20 @@ extern void			ni_dbus_add_signal_handler(ni_dbus_connection_t *conn,
 					const char *object_interface,
 					ni_dbus_signal_handler_t *callback,
 					void *user_data);
+extern void			ni_dbus_add_signal_match(ni_dbus_connection_t *conn,
+					const char *sender,
+					const char *path_namespace,
+					const char *object_interface,
+					const char *member,
+					ni_dbus_signal_handler_t *callback,
+					void *user_data);
+extern void			ni_dbus_remove_signal_handlers(ni_dbus_connection_t *conn,
+					const void *user_data);
 extern void			ni_dbus_connection_register_object(ni_dbus_connection_t *, ni_dbus_object_t *);
 extern void			ni_dbus_connection_unregister_object(ni_dbus_connection_t *, ni_dbus_object_t *);
+extern void			ni_dbus_connection_register_fallback(ni_dbus_connection_t *,
+					const char *path, const DBusObjectPathVTable *vtable,
+					void *user_data);
 extern int			ni_dbus_async_server_call_run_command(ni_dbus_connection_t *conn,
 					ni_dbus_object_t *object,
 					const ni_dbus_method_t *method,
@@ -35,6 +54,10 @@ extern int			ni_dbus_async_server_call_run_command(ni_dbus_connection_t *conn,
 					ni_process_t *process);
 extern void			ni_dbus_mainloop(ni_dbus_connection_t *);
 
+extern ni_dbus_peer_listener_t *ni_dbus_peer_listen(const char *path,
+					ni_dbus_peer_accept_t *accept, void *user_data);
+extern void			ni_dbus_peer_listener_free(ni_dbus_peer_listener_t *);
+
 extern int			ni_dbus_connection_get_caller_uid(ni_dbus_connection_t *, const char *, uid_t *);
 
 #endif /* __WICKED_DBUS_CONNECTION_H__ */
@@ -7,6 +7,9 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <wicked/util.h>
 #include <wicked/logging.h>
 #include <wicked/dbus-service.h>
@@ -15,8 +18,29 @@
 #include "dbus-object.h"
 #include "dbus-dict.h"
 #include "xml-schema.h"
+#include "util_priv.h"
+
+/*
+ * The interface part of the introspection data depends on the class and
+ * the services of an object only, so we generate it once per distinct
+ * set and share it among all objects using it. The object path and its
+ * children are added on each call; dbus object paths and names consist
+ * of [A-Za-z0-9_/] only and do not need any xml escaping.
+ */
+typedef struct ni_dbus_introspect_cache	ni_dbus_introspect_cache_t;
+struct ni_dbus_introspect_cache {
+	ni_dbus_introspect_cache_t *	next;
+	const ni_dbus_class_t *		class;
+	const ni_dbus_service_t **	interfaces;
+	unsigned int			count;
+	char *				body;
+};
+
+static ni_dbus_introspect_cache_t *	ni_dbus_introspect_cache_list;
 
-static ni_bool_t	__ni_dbus_introspect_object(ni_dbus_object_t *, xml_node_t *);
+static const char *	ni_dbus_introspect_cache_body(const ni_dbus_object_t *);
+static char *		__ni_dbus_introspect_body(const ni_dbus_object_t *);
+static ni_bool_t	__ni_dbus_introspect_object(const ni_dbus_object_t *, xml_node_t *);
 static ni_bool_t	__ni_dbus_introspect_service(const ni_dbus_service_t *, xml_node_t *);
 static ni_bool_t	__ni_dbus_introspect_method(const ni_dbus_method_t *, xml_node_t *);
 static ni_bool_t	__ni_dbus_introspect_property(const ni_dbus_property_t *, xml_node_t *);
@@ -25,8 +49,9 @@ static void		__ni_dbus_introspect_annotate(xml_node_t *, const char *, const cha
 char *
 ni_dbus_object_introspect(ni_dbus_object_t *object)
 {
-	xml_node_t *node;
-	char *result = NULL;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	const ni_dbus_object_t *child;
+	const char *body;
 
 	ni_debug_dbus("%s(%s)", __func__, object->path);
 
@@ -35,22 +60,91 @@ ni_dbus_object_introspect(ni_dbus_object_t *object)
 	 * <!DOCTYPE node PUBLIC "-//freedesktop//DTD D-BUS Object Introspection 1.0//EN"
 	 *     "http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd">
 	 */
+	if (!(body = ni_dbus_introspect_cache_body(object)))
+		return NULL;
+
+	ni_stringbuf_printf(&buf, "<node name=\"%s\"", object->path);
+	if (!*body && !object->children) {
+		ni_stringbuf_puts(&buf, "/>\n");
+		return buf.string;
+	}
+
+	ni_stringbuf_printf(&buf, ">\n%s", body);
+
+	/* We do not do a full introspection of children, but only show their presence. */
+	for (child = object->children; child; child = child->next)
+		ni_stringbuf_printf(&buf, "  <node name=\"%s\"/>\n", child->name);
+
+	ni_stringbuf_puts(&buf, "</node>\n");
+	return buf.string;
+}
+
+static const char *
+ni_dbus_introspect_cache_body(const ni_dbus_object_t *object)
+{
+	ni_dbus_introspect_cache_t *entry;
+	unsigned int count;
+
+	for (count = 0; object->interfaces && object->interfaces[count]; ++count)
+		;
+
+	for (entry = ni_dbus_introspect_cache_list; entry; entry = entry->next) {
+		if (entry->class == object->class && entry->count == count &&
+		    !memcmp(entry->interfaces, object->interfaces, count * sizeof(entry->interfaces[0])))
+			return entry->body;
+	}
+
+	entry = xcalloc(1, sizeof(*entry));
+	if (!(entry->body = __ni_dbus_introspect_body(object))) {
+		free(entry);
+		return NULL;
+	}
+	entry->class = object->class;
+	entry->count = count;
+	if (count) {
+		entry->interfaces = xcalloc(count, sizeof(entry->interfaces[0]));
+		memcpy(entry->interfaces, object->interfaces, count * sizeof(entry->interfaces[0]));
+	}
+	entry->next = ni_dbus_introspect_cache_list;
+	ni_dbus_introspect_cache_list = entry;
+	return entry->body;
+}
+
+/*
+ * Generate the interfaces and class annotation of an object, as indented
+ * inside of its <node> element.
+ */
+char *
+__ni_dbus_introspect_body(const ni_dbus_object_t *object)
+{
+	static const char head[] = "<node>\n";
+	static const char tail[] = "</node>\n";
+	char *result = NULL;
+	xml_node_t *node;
+	size_t len;
+
 	node = xml_node_new("node", NULL);
 	if (!__ni_dbus_introspect_object(object, node))
 		goto out;
 
-	if (object->children) {
-		/* We do not do a full introspection of children, but only show their presence. */
-		ni_dbus_object_t *child;
+	if (!node->children) {
+		result = xstrdup("");
+		goto out;
+	}
 
-		for (child = object->children; child; child = child->next) {
-			xml_node_t *cnode = xml_node_new("node", node);
+	if (!(result = xml_node_sprint(node)))
+		goto out;
 
-			xml_node_add_attr(cnode, "name", child->name);
-		}
+	len = strlen(result);
+	if (len < sizeof(head) - 1 + sizeof(tail) - 1 ||
+	    strncmp(result, head, sizeof(head) - 1) ||
+	    strcmp(result + len - (sizeof(tail) - 1), tail)) {
+		ni_string_free(&result);
+		goto out;
 	}
-
-	result = xml_node_sprint(node);
+	len -= sizeof(head) - 1 + sizeof(tail) - 1;
+	memmove(result, result + sizeof(head) - 1, len);
+	result[len] = '\0';
 
 out:
 	xml_node_free(node);
@@ -58,12 +152,11 @@ out:
 }
 
 ni_bool_t
-__ni_dbus_introspect_object(ni_dbus_object_t *object, xml_node_t *node)
+__ni_dbus_introspect_object(const ni_dbus_object_t *object, xml_node_t *node)
 {
 	unsigned int i;
 
-	xml_node_add_attr(node, "name", object->path);
-	for (i = 0; object->interfaces[i]; ++i) {
+	for (i = 0; object->interfaces && object->interfaces[i]; ++i) {
 		if (!__ni_dbus_introspect_service(object->interfaces[i], xml_node_new("interface", node)))
 			return FALSE;
 	}
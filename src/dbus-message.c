@@ -23,19 +23,16 @@ ni_dbus_message_iter_append_byte_array(DBusMessageIter *iter,
 				const unsigned char *value, unsigned int len)
 {
 	DBusMessageIter iter_array;
-	unsigned int i;
 
 	if (!dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY,
 					      DBUS_TYPE_BYTE_AS_STRING,
 					      &iter_array))
 		return FALSE;
 
-	for (i = 0; i < len; i++) {
-		if (!dbus_message_iter_append_basic(&iter_array,
-						    DBUS_TYPE_BYTE,
-						    &(value[i])))
-			return FALSE;
-	}
+	/* marshal the whole block instead of each element */
+	if (len && !dbus_message_iter_append_fixed_array(&iter_array,
+						DBUS_TYPE_BYTE, &value, len))
+		return FALSE;
 
 	if (!dbus_message_iter_close_container(iter, &iter_array))
 		return FALSE;
@@ -47,15 +44,12 @@ dbus_bool_t
 ni_dbus_message_iter_append_uint32_array(DBusMessageIter *iter, const uint32_t *value, unsigned int len)
 {
 	DBusMessageIter iter_array;
-	unsigned int i;
 
 	if (!dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32_AS_STRING, &iter_array))
 		return FALSE;
 
-	for (i = 0; i < len; i++) {
-		if (!dbus_message_iter_append_basic(&iter_array, DBUS_TYPE_UINT32, &(value[i])))
-			return FALSE;
-	}
+	if (len && !dbus_message_iter_append_fixed_array(&iter_array, DBUS_TYPE_UINT32, &value, len))
+		return FALSE;
 
 	if (!dbus_message_iter_close_container(iter, &iter_array))
 		return FALSE;
@@ -326,30 +320,32 @@ ni_dbus_message_iter_append_variant(DBusMessageIter *iter, const ni_dbus_variant
 dbus_bool_t
 ni_dbus_message_iter_get_byte_array(DBusMessageIter *iter, ni_dbus_variant_t *variant)
 {
-	ni_dbus_variant_init_byte_array(variant);
+	const unsigned char *data = NULL;
+	int len = 0;
 
-	while (dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_BYTE) {
-		unsigned char byte;
-
-		dbus_message_iter_get_basic(iter, &byte);
-		ni_dbus_variant_append_byte_array(variant, byte);
-		dbus_message_iter_next(iter);
-	}
+	/*
+	 * The block is borrowed from the message; the variant outlives it,
+	 * so it gets a copy at once, not appended byte by byte.
+	 */
+	if (dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_BYTE)
+		dbus_message_iter_get_fixed_array(iter, &data, &len);
 
+	ni_dbus_variant_set_byte_array(variant, data, len > 0 ? len : 0);
 	return TRUE;
 }
 
 dbus_bool_t
 ni_dbus_message_iter_get_uint32_array(DBusMessageIter *iter, ni_dbus_variant_t *variant)
 {
-	uint32_t u;
+	const uint32_t *data = NULL;
+	int i, len = 0;
 
 	ni_dbus_variant_init_uint32_array(variant);
-	while (dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_UINT32) {
-		dbus_message_iter_get_basic(iter, &u);
-		ni_dbus_variant_append_uint32_array(variant, u);
-		dbus_message_iter_next(iter);
-	}
+	if (dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_UINT32)
+		dbus_message_iter_get_fixed_array(iter, &data, &len);
+
+	for (i = 0; i < len; ++i)
+		ni_dbus_variant_append_uint32_array(variant, data[i]);
 
 	return TRUE;
 }
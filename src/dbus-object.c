@@ -16,6 +16,7 @@
 #include "dbus-dict.h"
 #include "util_priv.h"
 #include "debug.h"
+#include "stats.h"
 
 static ni_dbus_object_t *	__ni_dbus_objects_trashcan;
 
@@ -25,6 +26,8 @@ static dbus_bool_t		__ni_dbus_object_get_one_property(const ni_dbus_object_t *ob
 					ni_dbus_variant_t *var,
 					DBusError *error);
 static const char *		__ni_dbus_object_child_path(const ni_dbus_object_t *, const char *);
+static void			__ni_dbus_object_hash_child(ni_dbus_object_t *, ni_dbus_object_t *);
+static void			__ni_dbus_object_unhash_child(ni_dbus_object_t *);
 
 const ni_dbus_class_t		ni_dbus_anonymous_class = {
 	.name = "<anonymous>"
@@ -39,6 +42,7 @@ __ni_dbus_object_new(const ni_dbus_class_t *class, const char *path)
 	ni_dbus_object_t *object;
 
 	object = xcalloc(1, sizeof(*object));
+	ni_stats_object_alloc(NI_STATS_OBJECT_DBUS, sizeof(*object));
 	ni_string_dup(&object->path, path);
 	object->class = class;
 	return object;
@@ -71,6 +75,7 @@ __ni_dbus_object_new_child(ni_dbus_object_t *parent, const ni_dbus_class_t *obje
 	child->parent = parent;
 	__ni_dbus_object_insert(pos, child);
 	ni_string_dup(&child->name, name);
+	__ni_dbus_object_hash_child(parent, child);
 	if (parent->server_object)
 		__ni_dbus_server_object_inherit(child, parent);
 	if (parent->client_object)
@@ -105,6 +110,7 @@ __ni_dbus_object_free(ni_dbus_object_t *object)
 {
 	ni_dbus_object_t *child;
 
+	__ni_dbus_object_unhash_child(object);
 	__ni_dbus_object_unlink(object);
 	object->parent = NULL;
 
@@ -122,7 +128,9 @@ __ni_dbus_object_free(ni_dbus_object_t *object)
 	ni_string_free(&object->name);
 	ni_string_free(&object->path);
 
+	free(object->child_hash.table);
 	free(object->interfaces);
+	ni_stats_object_free(NI_STATS_OBJECT_DBUS, sizeof(*object));
 	free(object);
 }
 
@@ -136,6 +144,7 @@ ni_dbus_object_free(ni_dbus_object_t *object)
 	if (object->pprev) {
 		ni_debug_dbus("%s: deferring deletion of active object %s",
 				__FUNCTION__, object->path);
+		__ni_dbus_object_unhash_child(object);
 		__ni_dbus_object_unlink(object);
 		object->parent = NULL;
 		__ni_dbus_object_insert(&__ni_dbus_objects_trashcan, object);
@@ -171,19 +180,86 @@ ni_dbus_object_translate_error(ni_dbus_object_t *obj, const DBusError *error)
 	return ni_dbus_translate_error(error, error_map);
 }
 
+/*
+ * Hash the children by name, so the object path lookups do not
+ * need to scan the list of children at each level.
+ */
+#define NI_DBUS_OBJECT_HASH_MIN		16
+
+static void
+__ni_dbus_object_rehash_children(ni_dbus_object_t *parent, unsigned int size)
+{
+	ni_dbus_object_t **table, *child;
+
+	table = xcalloc(size, sizeof(*table));
+	for (child = parent->children; child; child = child->next) {
+		child->hash_next = table[child->hash & (size - 1)];
+		table[child->hash & (size - 1)] = child;
+	}
+
+	free(parent->child_hash.table);
+	parent->child_hash.table = table;
+	parent->child_hash.size = size;
+}
+
+static void
+__ni_dbus_object_hash_child(ni_dbus_object_t *parent, ni_dbus_object_t *child)
+{
+	unsigned int size = parent->child_hash.size;
+
+	child->hash = ni_string_hash(child->name);
+	parent->child_hash.count++;
+
+	if (!size || parent->child_hash.count > size * 2) {
+		/* the rehash picks up the new child from the list */
+		__ni_dbus_object_rehash_children(parent, size ?
+				size * 4 : NI_DBUS_OBJECT_HASH_MIN);
+	} else {
+		child->hash_next = parent->child_hash.table[child->hash & (size - 1)];
+		parent->child_hash.table[child->hash & (size - 1)] = child;
+	}
+}
+
+static void
+__ni_dbus_object_unhash_child(ni_dbus_object_t *child)
+{
+	ni_dbus_object_t *parent = child->parent;
+	ni_dbus_object_t **pos, *cur;
+
+	if (!parent || !parent->child_hash.table)
+		return;
+
+	pos = &parent->child_hash.table[child->hash & (parent->child_hash.size - 1)];
+	for ( ; (cur = *pos); pos = &cur->hash_next) {
+		if (cur == child) {
+			*pos = child->hash_next;
+			child->hash_next = NULL;
+			parent->child_hash.count--;
+			break;
+		}
+	}
+}
+
 /*
  * Look up an object by its relative name
  */
 static ni_dbus_object_t *
-__ni_dbus_object_get_child(ni_dbus_object_t *parent, const char *name)
+__ni_dbus_object_get_child(ni_dbus_object_t *parent, const char *name, size_t len)
 {
 	ni_dbus_object_t *child;
+	unsigned int hash;
 
-	if (*name == '\0')
+	if (len == 0)
 		return parent;
 
-	for (child = parent->children; child; child = child->next) {
-		if (!strcmp(child->name, name))
+	if (!parent->child_hash.table)
+		return NULL;
+
+	hash = ni_string_hash_len(name, len);
+	child = parent->child_hash.table[hash & (parent->child_hash.size - 1)];
+	for ( ; child; child = child->hash_next) {
+		if (child->hash == hash && !strncmp(child->name, name, len) &&
+		    child->name[len] == '\0')
 			return child;
 	}
 
@@ -195,8 +271,10 @@ __ni_dbus_object_lookup(ni_dbus_object_t *root_object, const char *path, int cre
 				const ni_dbus_class_t *object_class,
 				void *object_handle)
 {
-	char *path_copy = NULL, *name, *next_name;
 	ni_dbus_object_t *found;
+	const char *next;
+	char *name = NULL;
+	size_t len;
 
 	if (path == NULL)
 		return root_object;
@@ -216,16 +294,18 @@ __ni_dbus_object_lookup(ni_dbus_object_t *root_object, const char *path, int cre
 		path = relative_path;
 	}
 
-	ni_string_dup(&path_copy, path);
-
 	found = root_object;
-	for (name = strtok(path_copy, "/"); name && found; name = next_name) {
+	for (path += strspn(path, "/"); *path && found; path = next) {
 		ni_dbus_object_t *child;
 
-		next_name = strtok(NULL, "/");
-		child = __ni_dbus_object_get_child(found, name);
+		len = strcspn(path, "/");
+		next = path + len;
+		next += strspn(next, "/");
+
+		child = __ni_dbus_object_get_child(found, path, len);
 		if (child == NULL && create) {
-			if (next_name != NULL) {
+			ni_string_set(&name, path, len);
+			if (*next != '\0') {
 				/* Intermediate path component */
 				child = __ni_dbus_object_new_child(found, NULL, name, NULL);
 			} else {
@@ -236,7 +316,7 @@ __ni_dbus_object_lookup(ni_dbus_object_t *root_object, const char *path, int cre
 		found = child;
 	}
 
-	ni_string_free(&path_copy);
+	ni_string_free(&name);
 	return found;
 }
 
@@ -316,6 +316,68 @@ __ni_objectmodel_bridge_set_ports(ni_dbus_object_t *object, const ni_dbus_proper
 	return TRUE;
 }
 
+/*
+ * Helper functions to represent port vlans as a dbus dict array
+ */
+static void
+__ni_objectmodel_bridge_port_vlans_to_dict(const ni_bridge_port_vlan_array_t *vlans,
+				ni_dbus_variant_t *dict)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_dbus_variant_t *array, *entry;
+	unsigned int i;
+
+	if (!(array = ni_dbus_dict_add(dict, "vlans")))
+		return;
+
+	ni_dbus_dict_array_init(array);
+	for (i = 0; i < vlans->count; ++i) {
+		const ni_bridge_port_vlan_t *vlan = &vlans->data[i];
+
+		if (!(entry = ni_dbus_dict_array_add(array)))
+			break;
+		ni_dbus_variant_init_dict(entry);
+
+		ni_dbus_dict_add_string(entry, "id", ni_bridge_port_vlan_format(vlan, &buf));
+		ni_stringbuf_destroy(&buf);
+		if (vlan->pvid)
+			ni_dbus_dict_add_bool(entry, "pvid", TRUE);
+		if (vlan->untagged)
+			ni_dbus_dict_add_bool(entry, "untagged", TRUE);
+	}
+}
+
+static dbus_bool_t
+__ni_objectmodel_bridge_port_vlans_from_dict(ni_bridge_port_vlan_array_t *vlans,
+				const ni_dbus_variant_t *array, DBusError *error)
+{
+	unsigned int i, vid_begin, vid_end;
+	const ni_dbus_variant_t *entry;
+	dbus_bool_t pvid, untagged;
+	const char *string;
+
+	if (!ni_dbus_variant_is_dict_array(array))
+		return FALSE;
+
+	for (i = 0; i < array->array.len; ++i) {
+		entry = &array->variant_array_value[i];
+
+		if (!ni_dbus_dict_get_string(entry, "id", &string) ||
+		    !ni_bridge_port_vlan_parse(string, &vid_begin, &vid_end)) {
+			dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
+					"invalid bridge port vlan id '%s'",
+					ni_print_suspect(string, 16));
+			return FALSE;
+		}
+
+		pvid = untagged = FALSE;
+		ni_dbus_dict_get_bool(entry, "pvid", &pvid);
+		ni_dbus_dict_get_bool(entry, "untagged", &untagged);
+		ni_bridge_port_vlan_array_append(vlans, vid_begin, vid_end, pvid, untagged);
+	}
+	return TRUE;
+}
+
 /*
  * Helper functions to represent ports as a dbus dict
  */
@@ -337,6 +399,8 @@ __ni_objectmodel_bridge_port_to_dict(const ni_bridge_port_t *port, ni_dbus_varia
 	ni_dbus_dict_add_string(dict, "device", port->ifname);
 	ni_dbus_dict_add_uint32(dict, "priority", port->priority);
 	ni_dbus_dict_add_uint32(dict, "path-cost", port->path_cost);
+	if (port->vlans.count)
+		__ni_objectmodel_bridge_port_vlans_to_dict(&port->vlans, dict);
 
 	if (config_only)
 		return TRUE;
@@ -353,6 +417,7 @@ __ni_objectmodel_bridge_port_from_dict(ni_bridge_port_t *port, const ni_dbus_var
 				DBusError *error,
 				int config_only)
 {
+	const ni_dbus_variant_t *vlans;
 	const char *string;
 	uint32_t value;
 
@@ -369,6 +434,9 @@ __ni_objectmodel_bridge_port_from_dict(ni_bridge_port_t *port, const ni_dbus_var
 		port->priority = value;
 	if (ni_dbus_dict_get_uint32(dict, "path-cost", &value))
 		port->path_cost = value;
+	if ((vlans = ni_dbus_dict_get(dict, "vlans")) &&
+	    !__ni_objectmodel_bridge_port_vlans_from_dict(&port->vlans, vlans, error))
+		return FALSE;
 
 	/* FIXME: Really? I don't think so... */
 	if (ni_dbus_dict_get_uint32(dict, "state", &value))
@@ -381,6 +449,46 @@ __ni_objectmodel_bridge_port_from_dict(ni_bridge_port_t *port, const ni_dbus_var
 	return TRUE;
 }
 
+/*
+ * Property vlan-filtering
+ */
+static dbus_bool_t
+__ni_objectmodel_bridge_get_vlan_filtering(const ni_dbus_object_t *object,
+				const ni_dbus_property_t *property,
+				ni_dbus_variant_t *result,
+				DBusError *error)
+{
+	const ni_bridge_t *bridge;
+
+	if (!(bridge = __ni_objectmodel_bridge_read_handle(object, error)))
+		return FALSE;
+
+	if (!ni_tristate_is_set(bridge->vlan_filtering))
+		return ni_dbus_error_property_not_present(error, object->path, property->name);
+
+	ni_dbus_variant_set_bool(result, ni_tristate_is_enabled(bridge->vlan_filtering));
+	return TRUE;
+}
+
+static dbus_bool_t
+__ni_objectmodel_bridge_set_vlan_filtering(ni_dbus_object_t *object,
+				const ni_dbus_property_t *property,
+				const ni_dbus_variant_t *argument,
+				DBusError *error)
+{
+	ni_bridge_t *bridge;
+	dbus_bool_t value;
+
+	if (!(bridge = __ni_objectmodel_bridge_write_handle(object, error)))
+		return FALSE;
+
+	if (!ni_dbus_variant_get_bool(argument, &value))
+		return FALSE;
+
+	ni_tristate_set(&bridge->vlan_filtering, value);
+	return TRUE;
+}
+
 static dbus_bool_t
 ni_objectmodel_bridge_get_address(const ni_dbus_object_t *object,
 				const ni_dbus_property_t *property,
@@ -431,6 +539,8 @@ static const ni_dbus_property_t	ni_objectmodel_bridge_property_table[] = {
 	BRIDGE_TIME_PROPERTY(aging-time, ageing_time, RO),
 	BRIDGE_TIME_PROPERTY(hello-time, hello_time, RO),
 	BRIDGE_TIME_PROPERTY(max-age, max_age, RO),
+	___NI_DBUS_PROPERTY(DBUS_TYPE_BOOLEAN_AS_STRING, vlan-filtering,
+			vlan_filtering, __ni_objectmodel_bridge, RO),
 
 	/* ports is an array of dicts */
 	WICKED_BRIDGE_PROPERTY_SIGNATURE(DBUS_TYPE_ARRAY_AS_STRING NI_DBUS_DICT_SIGNATURE,
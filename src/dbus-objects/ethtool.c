@@ -37,6 +37,7 @@
 #include "model.h"
 #include "debug.h"
 #include "misc.h"
+#include "netinfo_priv.h"
 
 
 /*
@@ -99,8 +100,12 @@ ni_objectmodel_ethtool_handle(const ni_dbus_object_t *object,
 	if (!(dev = ni_objectmodel_unwrap_netif(object, error)))
 		return NULL;
 
-	if (!write_access)
+	if (!write_access) {
+		/* fetched on first use by the server only */
+		if (ni_dbus_object_get_server(object))
+			return ni_system_ethtool_get(dev);
 		return dev->ethtool;
+	}
 
 	return ni_netdev_get_ethtool(dev);
 }
@@ -362,10 +367,8 @@ ni_objectmodel_ethtool_link_adv_bitfield_into_array(ni_string_array_t *array,
 	const char *name;
 
 	bits = ni_bitfield_bits(bitfield);
-	for (bit = 0; bit < bits; ++bit) {
-		if (!ni_bitfield_testbit(bitfield, bit))
-			continue;
-
+	for (bit = ni_bitfield_next_set(bitfield, 0); bit < bits;
+	     bit = ni_bitfield_next_set(bitfield, bit + 1)) {
 		if (!(name = bit_to_name(bit)))
 			continue;
 
@@ -916,10 +919,8 @@ ni_objectmodel_ethtool_eee_adv_into_dict(ni_dbus_variant_t *dict,
 
 	/* known modes by name */
 	bits = ni_bitfield_bits(bitfield);
-	for (bit = 0; bit < bits; ++bit) {
-		if (!ni_bitfield_testbit(bitfield, bit))
-			continue;
-
+	for (bit = ni_bitfield_next_set(bitfield, 0); bit < bits;
+	     bit = ni_bitfield_next_set(bitfield, bit + 1)) {
 		if (!(name = ni_ethtool_link_adv_speed_name(bit)))
 			ni_bitfield_setbit(&tmpfield, bit);
 		else
@@ -7,12 +7,15 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
+
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
 #include <wicked/system.h>
 #include <wicked/infiniband.h>
 #include <wicked/dbus-errors.h>
 #include <wicked/dbus-service.h>
+#include "util_priv.h"
 #include "model.h"
 #include "debug.h"
 
@@ -38,34 +41,31 @@ __ni_objectmodel_ibchild_device_arg(const ni_dbus_variant_t *dict)
  * InfinibandChild.Factory.newDevice:
  * Create a new infiniband child interface
  */
-static ni_netdev_t *
-__ni_objectmodel_ib_newchild(ni_netdev_t *cfg, const char *ifname, DBusError *error)
+static ni_bool_t
+__ni_objectmodel_ib_newchild_check(ni_netdev_t *cfg, const char **ifname, DBusError *error)
 {
-	ni_netconfig_t *nc = ni_global_state_handle(0);
-	ni_netdev_t *dev = NULL;
 	const ni_infiniband_t *ib;
 	const char *err;
-	int rv;
 
 	ib = ni_netdev_get_infiniband(cfg);
 	if ((err = ni_infiniband_validate(NI_IFTYPE_INFINIBAND_CHILD,
 					ib, &cfg->link.lowerdev)) != NULL) {
 		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS, "%s", err);
-		return NULL;
+		return FALSE;
 	}
 
-	if (ni_string_empty(ifname)) {
+	if (ni_string_empty(*ifname)) {
 		if (ni_string_empty(cfg->name) &&
 		    !ni_string_printf(&cfg->name, "%s.%04x",
 					cfg->link.lowerdev.name, ib->pkey)) {
 			dbus_set_error(error, DBUS_ERROR_FAILED,
 				"Unable to create infiniband child: "
 				"name argument missed, failed to construct");
-			return NULL;
+			return FALSE;
 		}
-		ifname = NULL;
-	} else if (!ni_string_eq(cfg->name, ifname)) {
-		ni_string_dup(&cfg->name, ifname);
+		*ifname = NULL;
+	} else if (!ni_string_eq(cfg->name, *ifname)) {
+		ni_string_dup(&cfg->name, *ifname);
 	}
 
 	if (ni_string_eq(cfg->name, cfg->link.lowerdev.name)) {
@@ -73,10 +73,16 @@ __ni_objectmodel_ib_newchild(ni_netdev_t *cfg, const char *ifname, DBusError *er
 			"Cannot to create infiniband child: "
 			"child name %s equal with parent device name",
 			cfg->name);
-		return NULL;
+		return FALSE;
 	}
+	return TRUE;
+}
 
-	if ((rv = ni_system_infiniband_child_create(nc, cfg, &dev)) < 0) {
+static ni_netdev_t *
+__ni_objectmodel_ib_newchild_result(ni_netdev_t *dev, int rv, const ni_netdev_t *cfg,
+					const char *ifname, DBusError *error)
+{
+	if (rv < 0) {
 		if (rv != -NI_ERROR_DEVICE_EXISTS || !dev
 		|| (ifname && dev && !ni_string_eq(ifname, dev->name))) {
 			dbus_set_error(error,
@@ -93,11 +99,25 @@ __ni_objectmodel_ib_newchild(ni_netdev_t *cfg, const char *ifname, DBusError *er
 			"Unable to create infiniband child interface %s: it exists with type %s",
 			cfg->name, ni_linktype_type_to_name(dev->link.type));
 		return NULL;
-        }
+	}
 
 	return dev;
 }
 
+static ni_netdev_t *
+__ni_objectmodel_ib_newchild(ni_netdev_t *cfg, const char *ifname, DBusError *error)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t *dev = NULL;
+	int rv;
+
+	if (!__ni_objectmodel_ib_newchild_check(cfg, &ifname, error))
+		return NULL;
+
+	rv = ni_system_infiniband_child_create(nc, cfg, &dev);
+	return __ni_objectmodel_ib_newchild_result(dev, rv, cfg, ifname, error);
+}
+
 static dbus_bool_t
 ni_objectmodel_ib_newchild(ni_dbus_object_t *factory_object, const ni_dbus_method_t *method,
 				unsigned int argc, const ni_dbus_variant_t *argv,
@@ -123,6 +143,75 @@ ni_objectmodel_ib_newchild(ni_dbus_object_t *factory_object, const ni_dbus_metho
 	return ni_objectmodel_netif_factory_result(server, reply, dev, NULL, error);
 }
 
+/*
+ * InfinibandChild.Factory.newDevices:
+ * Create a set of infiniband children, e.g. all pkeys of a port,
+ * sending the netlink requests in one batch.
+ * The call fails as a whole when any of the configs is invalid;
+ * when the creation of a device fails, the devices created so
+ * far are kept and are registered by the newlink events.
+ */
+static dbus_bool_t
+ni_objectmodel_ib_newchildren(ni_dbus_object_t *factory_object, const ni_dbus_method_t *method,
+				unsigned int argc, const ni_dbus_variant_t *argv,
+				ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_server_t *server = ni_dbus_object_get_server(factory_object);
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	const char **ifnames = NULL;
+	ni_netdev_t **cfgs = NULL;
+	ni_netdev_t **devs = NULL;
+	int *results = NULL;
+	unsigned int i, count;
+	dbus_bool_t rv = FALSE;
+
+	NI_TRACE_ENTER();
+
+	if (argc != 2 ||
+	    !ni_dbus_variant_is_string_array(&argv[0]) ||
+	    !ni_dbus_variant_is_dict_array(&argv[1]) ||
+	    argv[0].array.len != argv[1].array.len)
+		return ni_dbus_error_invalid_args(error, factory_object->path, method->name);
+
+	count = argv[0].array.len;
+	ifnames = xcalloc(count + 1, sizeof(*ifnames));
+	cfgs    = xcalloc(count + 1, sizeof(*cfgs));
+	devs    = xcalloc(count + 1, sizeof(*devs));
+	results = xcalloc(count + 1, sizeof(*results));
+
+	for (i = 0; i < count; ++i) {
+		ifnames[i] = argv[0].string_array_value[i];
+		if (!(cfgs[i] = __ni_objectmodel_ibchild_device_arg(&argv[1].variant_array_value[i]))) {
+			ni_dbus_error_invalid_args(error, factory_object->path, method->name);
+			goto cleanup;
+		}
+		if (!__ni_objectmodel_ib_newchild_check(cfgs[i], &ifnames[i], error))
+			goto cleanup;
+	}
+
+	ni_system_infiniband_child_create_batch(nc, count, (const ni_netdev_t **)cfgs,
+						devs, results);
+	for (i = 0; i < count; ++i) {
+		devs[i] = __ni_objectmodel_ib_newchild_result(devs[i], results[i],
+						cfgs[i], ifnames[i], error);
+		if (!devs[i])
+			goto cleanup;
+	}
+
+	rv = ni_objectmodel_netif_factory_results(server, reply, devs, count, NULL, error);
+
+cleanup:
+	for (i = 0; i < count; ++i) {
+		if (cfgs[i])
+			ni_netdev_put(cfgs[i]);
+	}
+	free(results);
+	free(devs);
+	free(cfgs);
+	free(ifnames);
+	return rv;
+}
+
 
 /*
  * InfinibandChild.delete method
@@ -151,14 +240,30 @@ ni_objectmodel_ib_delete(ni_dbus_object_t *object, const ni_dbus_method_t *metho
 /*
  * Infiniband(Child).changeDevice method
  */
+static void
+ni_objectmodel_ib_setup_done(void *user_data, int result)
+{
+	ni_dbus_deferred_reply_t *deferred = user_data;
+	DBusError error = DBUS_ERROR_INIT;
+
+	if (result < 0) {
+		dbus_set_error(&error, DBUS_ERROR_FAILED,
+				"failed to configure infiniband device");
+	}
+	ni_dbus_deferred_reply_complete(deferred, &error);
+	dbus_error_free(&error);
+}
+
 static dbus_bool_t
 ni_objectmodel_ib_setup(ni_dbus_object_t *object, const ni_dbus_method_t *method,
 				unsigned int argc, const ni_dbus_variant_t *argv,
 				ni_dbus_message_t *reply, DBusError *error)
 {
 	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_dbus_deferred_reply_t *deferred;
 	ni_netdev_t *ifp, *cfg;
 	dbus_bool_t rv = FALSE;
+	int ret;
 
 	/* we've already checked that argv matches our signature */
 	if (argc != 1 || !(ifp = ni_objectmodel_unwrap_netif(object, error)))
@@ -187,7 +292,18 @@ ni_objectmodel_ib_setup(ni_dbus_object_t *object, const ni_dbus_method_t *method
 			goto out;
 		}
 
-		if (ni_system_infiniband_setup(nc, ifp, cfg) < 0) {
+		/* reply when the (slow) sysfs writes are done */
+		deferred = ni_dbus_server_defer_reply(object, reply);
+		ret = ni_system_infiniband_setup_async(nc, ifp, cfg, deferred ?
+				ni_objectmodel_ib_setup_done : NULL, deferred);
+		if (ret > 0) {
+			rv = TRUE;
+			goto out;
+		}
+		/* applied inline, hand the reply back to the dispatcher */
+		ni_dbus_deferred_reply_complete(deferred, NULL);
+
+		if (ret < 0) {
 			dbus_set_error(error, DBUS_ERROR_FAILED,
 					"failed to configure infiniband device %s",
 					ifp->name);
@@ -355,6 +471,7 @@ static ni_dbus_method_t		ni_objectmodel_ibchild_methods[] = {
 
 static ni_dbus_method_t		ni_objectmodel_ibchild_factory_methods[] = {
 	{ "newDevice",		"sa{sv}",	.handler = ni_objectmodel_ib_newchild},
+	{ "newDevices",		"asaa{sv}",	.handler = ni_objectmodel_ib_newchildren },
 	{ NULL }
 };
 
@@ -24,10 +24,12 @@
 #include <wicked/system.h>
 #include <wicked/xml.h>
 #include "netinfo_priv.h"
+#include "util_priv.h"
 #include "dbus-common.h"
 #include "xml-schema.h"
 #include "appconfig.h"
 #include "model.h"
+#include "netns.h"
 #include "debug.h"
 
 extern dbus_bool_t	ni_objectmodel_netif_list_refresh(ni_dbus_object_t *);
@@ -458,10 +460,315 @@ ni_objectmodel_netif_list_get_addresses(ni_dbus_object_t *object, const ni_dbus_
 	return rv;
 }
 
+/*
+ * InterfaceList.getStatus
+ *
+ * Compact status summary of all interfaces in one reply, for status
+ * queries not needing the full interface properties: a dict by object
+ * path with the name, index, type, ifflags, master, client state and
+ * the lease states and the number of addresses of each interface.
+ */
+static void
+ni_objectmodel_netif_list_get_status_leases(const ni_netdev_t *dev, ni_dbus_variant_t *dict)
+{
+	const ni_addrconf_lease_t *lease;
+	ni_dbus_variant_t *leases, *entry;
+
+	if (!dev->leases || !(leases = ni_dbus_dict_add(dict, "leases")))
+		return;
+
+	ni_dbus_dict_array_init(leases);
+	for (lease = dev->leases; lease; lease = lease->next) {
+		if (!(entry = ni_dbus_dict_array_add(leases)))
+			break;
+
+		ni_dbus_variant_init_dict(entry);
+		ni_dbus_dict_add_uint32(entry, "family", lease->family);
+		ni_dbus_dict_add_uint32(entry, "type",   lease->type);
+		ni_dbus_dict_add_uint32(entry, "state",  lease->state);
+		ni_dbus_dict_add_uint32(entry, "flags",  lease->flags);
+	}
+}
+
+static void
+ni_objectmodel_netif_list_get_status_device(const ni_netdev_t *dev, ni_dbus_variant_t *dict)
+{
+	const ni_client_state_t *cs = dev->client_state;
+	ni_tristate_t require_link = NI_TRISTATE_DEFAULT;
+	const ni_address_t *ap;
+	unsigned int count = 0;
+
+	ni_dbus_variant_init_dict(dict);
+	ni_dbus_dict_add_string(dict, "name",   dev->name);
+	ni_dbus_dict_add_uint32(dict, "index",  dev->link.ifindex);
+	ni_dbus_dict_add_uint32(dict, "type",   dev->link.type);
+	ni_dbus_dict_add_uint32(dict, "status", dev->link.ifflags);
+
+	if (!ni_string_empty(dev->link.masterdev.name))
+		ni_dbus_dict_add_string(dict, "master", dev->link.masterdev.name);
+
+	if (cs) {
+		if (!ni_string_empty(cs->config.origin))
+			ni_dbus_dict_add_string(dict, "origin", cs->config.origin);
+		ni_dbus_dict_add_bool(dict, "persistent", cs->control.persistent);
+
+		if (ni_tristate_is_set(cs->control.require_link))
+			require_link = cs->control.require_link;
+	}
+	if (!ni_tristate_is_set(require_link))
+		require_link = ni_netdev_guess_link_required(dev);
+	if (ni_tristate_is_set(require_link))
+		ni_dbus_dict_add_bool(dict, "require-link",
+				ni_tristate_is_enabled(require_link));
+
+	ni_objectmodel_netif_list_get_status_leases(dev, dict);
+
+	for (ap = dev->addrs; ap; ap = ap->next)
+		count++;
+	ni_dbus_dict_add_uint32(dict, "addresses", count);
+}
+
+static dbus_bool_t
+ni_objectmodel_netif_list_get_status(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_dbus_variant_t *dict;
+	ni_netdev_t *dev;
+	const char *path;
+	dbus_bool_t rv;
+
+	if (argc != 0)
+		return ni_dbus_error_invalid_args(error, object->path, method->name);
+
+	ni_dbus_variant_init_dict(&result);
+	for (dev = nc ? ni_netconfig_devlist(nc) : NULL; dev; dev = dev->next) {
+		path = ni_objectmodel_netif_full_path(dev);
+		if (ni_string_empty(path))
+			continue;
+
+		if (!(dict = ni_dbus_dict_add(&result, path)))
+			break;
+
+		ni_objectmodel_netif_list_get_status_device(dev, dict);
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+/*
+ * InterfaceList.getManagedObjects(cursor, count)
+ *
+ * Paged variant of ObjectManager.GetManagedObjects. Returns the dict of
+ * at most count interfaces with an ifindex above cursor, in ifindex
+ * order, and the cursor to continue with -- 0 when there are no more.
+ */
+static int
+ni_objectmodel_netif_list_ifindex_cmp(const void *a, const void *b)
+{
+	const ni_netdev_t *da = ni_objectmodel_unwrap_netif(*(ni_dbus_object_t * const *)a, NULL);
+	const ni_netdev_t *db = ni_objectmodel_unwrap_netif(*(ni_dbus_object_t * const *)b, NULL);
+
+	return (da->link.ifindex > db->link.ifindex) - (da->link.ifindex < db->link.ifindex);
+}
+
+static dbus_bool_t
+ni_objectmodel_netif_list_get_managed_objects(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result[2] = { NI_DBUS_VARIANT_INIT, NI_DBUS_VARIANT_INIT };
+	ni_dbus_object_t *child, **objects = NULL;
+	uint32_t cursor, count, next = 0;
+	unsigned int i, n = 0;
+	dbus_bool_t rv = TRUE;
+	ni_netdev_t *dev;
+
+	if (argc != 2 || !ni_dbus_variant_get_uint32(&argv[0], &cursor) ||
+	    !ni_dbus_variant_get_uint32(&argv[1], &count) || !count)
+		return ni_dbus_error_invalid_args(error, object->path, method->name);
+
+	for (child = object->children; child; child = child->next)
+		n++;
+	if (n)
+		objects = xcalloc(n, sizeof(objects[0]));
+
+	for (n = 0, child = object->children; child; child = child->next) {
+		if (!(dev = ni_objectmodel_unwrap_netif(child, NULL)))
+			continue;
+		if (dev->link.ifindex > cursor)
+			objects[n++] = child;
+	}
+	if (n > 1)
+		qsort(objects, n, sizeof(objects[0]), ni_objectmodel_netif_list_ifindex_cmp);
+
+	ni_dbus_variant_init_dict(&result[0]);
+	for (i = 0; rv && i < n && i < count; ++i)
+		rv = ni_dbus_object_get_managed_object_dict(objects[i], &result[0], error);
+
+	if (n > count) {
+		dev = ni_objectmodel_unwrap_netif(objects[count - 1], NULL);
+		next = dev->link.ifindex;
+	}
+	ni_dbus_variant_set_uint32(&result[1], next);
+
+	if (rv)
+		rv = ni_dbus_message_serialize_variants(reply, 2, result, error);
+
+	ni_dbus_variant_destroy(&result[0]);
+	ni_dbus_variant_destroy(&result[1]);
+	free(objects);
+	return rv;
+}
+
+/*
+ * InterfaceList.deleteDevices(ifindexes)
+ *
+ * Delete a set of virtual devices (vlan, macvlan, dummy, tun/tap, ...)
+ * in one netlink batch, e.g. on a bulk ifdown. Returns the indexes of
+ * the deleted devices; their objects are removed on the delete events.
+ */
+static dbus_bool_t
+ni_objectmodel_netif_list_delete_devices(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t **devs;
+	unsigned int i, count;
+	dbus_bool_t rv;
+	int *results;
+
+	if (argc != 1 || !ni_dbus_variant_is_uint32_array(&argv[0]) || !nc)
+		return ni_dbus_error_invalid_args(error, object->path, method->name);
+
+	count   = argv[0].array.len;
+	devs    = xcalloc(count + 1, sizeof(*devs));
+	results = xcalloc(count + 1, sizeof(*results));
+	for (i = 0; i < count; ++i) {
+		if ((devs[i] = ni_netdev_by_index(nc, argv[0].uint32_array_value[i])))
+			ni_netdev_get(devs[i]);
+	}
+
+	ni_system_interfaces_delete_batch(nc, count, devs, results);
+
+	ni_dbus_variant_init_uint32_array(&result);
+	for (i = 0; i < count; ++i) {
+		if (devs[i] && results[i] == 0)
+			ni_dbus_variant_append_uint32_array(&result, devs[i]->link.ifindex);
+		if (devs[i])
+			ni_netdev_put(devs[i]);
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	free(results);
+	free(devs);
+	return rv;
+}
+
+/*
+ * InterfaceList.getNetnsStatus(name)
+ *
+ * Status summary as getStatus of the interfaces in a named network
+ * namespace, refreshed on each call. The dict keys are the paths of
+ * the interfaces scoped by the namespace (inode) id, e.g.
+ * /org/opensuse/Network/Netns/<id>/Interface/<ifindex>.
+ */
+static ni_netns_t **		ni_objectmodel_netns_list;
+static unsigned int		ni_objectmodel_netns_count;
+
+static ni_netns_t *
+ni_objectmodel_netns_get(const char *name)
+{
+	ni_netns_t *ns, **list;
+	unsigned int i;
+
+	for (i = 0; i < ni_objectmodel_netns_count; ++i) {
+		ns = ni_objectmodel_netns_list[i];
+		if (!ni_string_eq(ni_netns_name(ns), name))
+			continue;
+
+		if (ni_netns_valid(ns))
+			return ns;
+
+		/* deleted or recreated under the same name */
+		ni_netns_free(ns);
+		ni_objectmodel_netns_list[i] = ni_netns_open(name);
+		return ni_objectmodel_netns_list[i];
+	}
+
+	if (!(ns = ni_netns_open(name)))
+		return NULL;
+
+	list = realloc(ni_objectmodel_netns_list, (i + 1) * sizeof(*list));
+	if (!list) {
+		ni_netns_free(ns);
+		return NULL;
+	}
+	list[i] = ns;
+	ni_objectmodel_netns_list = list;
+	ni_objectmodel_netns_count++;
+	return ns;
+}
+
+static dbus_bool_t
+ni_objectmodel_netif_list_get_netns_status(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_dbus_variant_t *dict;
+	const char *name;
+	ni_netns_t *ns;
+	ni_netdev_t *dev;
+	char path[256];
+	dbus_bool_t rv;
+
+	if (!reply || !argv || argc != 1 ||
+	    !ni_dbus_variant_get_string(&argv[0], &name) || ni_string_empty(name)) {
+		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
+				"%s.%s: invalid network namespace name argument",
+				object->path, method->name);
+		return FALSE;
+	}
+
+	if (!(ns = ni_objectmodel_netns_get(name)) || ni_netns_refresh(ns) < 0) {
+		dbus_set_error(error, DBUS_ERROR_FAILED,
+				"Unable to query network namespace %s", name);
+		return FALSE;
+	}
+
+	ni_dbus_variant_init_dict(&result);
+	for (dev = ni_netconfig_devlist(ni_netns_state(ns)); dev; dev = dev->next) {
+		snprintf(path, sizeof(path), "%s/Netns/%lu/Interface/%u",
+				NI_OBJECTMODEL_OBJECT_PATH, ni_netns_id(ns),
+				dev->link.ifindex);
+
+		if (!(dict = ni_dbus_dict_add(&result, path)))
+			break;
+
+		ni_objectmodel_netif_list_get_status_device(dev, dict);
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
 static ni_dbus_method_t		ni_objectmodel_netif_list_methods[] = {
 	{ "deviceByName",	"s",		.handler = ni_objectmodel_netif_list_device_by_name },
 	{ "identifyDevice",	"sa{sv}",	.handler = ni_objectmodel_netif_list_identify_device },
 	{ "getAddresses",	"a{sv}",	.handler = ni_objectmodel_netif_list_get_addresses },
+	{ "getManagedObjects",	"uu",		.handler = ni_objectmodel_netif_list_get_managed_objects },
+	{ "getStatus",		"",		.handler = ni_objectmodel_netif_list_get_status },
+	{ "getNetnsStatus",	"s",		.handler = ni_objectmodel_netif_list_get_netns_status },
+	{ "deleteDevices",	"au",		.handler = ni_objectmodel_netif_list_delete_devices },
 	{ NULL }
 };
 
@@ -618,14 +925,11 @@ ni_objectmodel_get_netif_argument(const ni_dbus_variant_t *dict, ni_iftype_t ift
  * Device factory functions need to register the newly created interface with the
  * dbus service, and return the device's object path
  */
-dbus_bool_t
-ni_objectmodel_netif_factory_result(ni_dbus_server_t *server, ni_dbus_message_t *reply,
-				ni_netdev_t *dev, const ni_dbus_class_t *override_class,
-				DBusError *error)
+static ni_dbus_object_t *
+ni_objectmodel_netif_factory_object(ni_dbus_server_t *server, ni_netdev_t *dev,
+				const ni_dbus_class_t *override_class, DBusError *error)
 {
-	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
 	ni_dbus_object_t *new_object;
-	dbus_bool_t rv;
 
 	new_object = ni_dbus_server_find_object_by_handle(server, dev);
 	if (new_object == NULL)
@@ -634,8 +938,22 @@ ni_objectmodel_netif_factory_result(ni_dbus_server_t *server, ni_dbus_message_t
 		dbus_set_error(error, DBUS_ERROR_FAILED,
 				"failed to register new device %s",
 				dev->name);
-		return FALSE;
 	}
+	return new_object;
+}
+
+dbus_bool_t
+ni_objectmodel_netif_factory_result(ni_dbus_server_t *server, ni_dbus_message_t *reply,
+				ni_netdev_t *dev, const ni_dbus_class_t *override_class,
+				DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_dbus_object_t *new_object;
+	dbus_bool_t rv;
+
+	if (!(new_object = ni_objectmodel_netif_factory_object(server, dev,
+					override_class, error)))
+		return FALSE;
 
 	/* For now, we return a string here. This should really be an object-path,
 	 * though. */
@@ -647,6 +965,36 @@ ni_objectmodel_netif_factory_result(ni_dbus_server_t *server, ni_dbus_message_t
 	return rv;
 }
 
+/*
+ * Reply to a factory call creating several devices at once
+ * with the array of the new object paths (as strings again).
+ */
+dbus_bool_t
+ni_objectmodel_netif_factory_results(ni_dbus_server_t *server, ni_dbus_message_t *reply,
+				ni_netdev_t **devs, unsigned int count,
+				const ni_dbus_class_t *override_class, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_dbus_object_t *new_object;
+	dbus_bool_t rv = TRUE;
+	unsigned int i;
+
+	ni_dbus_variant_init_string_array(&result);
+	for (i = 0; rv && i < count; ++i) {
+		if (!(new_object = ni_objectmodel_netif_factory_object(server, devs[i],
+						override_class, error)))
+			rv = FALSE;
+		else
+			ni_dbus_variant_append_string_array(&result, new_object->path);
+	}
+
+	if (rv)
+		rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+
+	return rv;
+}
+
 /*
  * Build a dummy dbus object encapsulating a network interface,
  * and add the appropriate dbus services
@@ -1110,7 +1458,7 @@ static void
 __ni_objectmodel_netif_set_client_state_save_trigger(ni_netdev_t *dev)
 {
 	if (dev && dev->client_state) {
-		ni_client_state_save(dev->client_state, dev->link.ifindex);
+		ni_client_state_save_deferred(dev->client_state, dev->link.ifindex);
 		ni_debug_dbus("saving %s structure into a file for %s",
 			NI_CLIENT_STATE_XML_NODE, dev->name);
 	}
@@ -1218,6 +1566,10 @@ ni_objectmodel_send_netif_event(ni_dbus_server_t *server, ni_dbus_object_t *obje
 		return FALSE;
 	}
 
+	/* Let clients update their proxy before they see the event */
+	if (ifevent != NI_EVENT_DEVICE_DELETE)
+		ni_dbus_server_send_properties_changed(server, object);
+
 	return __ni_objectmodel_device_event(server, object, NI_OBJECTMODEL_NETIF_INTERFACE, ifevent, uuid);
 }
 
@@ -1408,6 +1760,7 @@ __ni_objectmodel_netif_set_addresses(ni_dbus_object_t *object,
 {
 	ni_netdev_t *ifp = ni_dbus_object_get_handle(object);
 
+	ni_netdev_drop_address_index(ifp);
 	return __ni_objectmodel_set_address_list(&ifp->addrs, argument, error);
 }
 
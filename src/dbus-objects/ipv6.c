@@ -28,9 +28,25 @@
 #include "netinfo_priv.h"
 #include "dbus-common.h"
 #include "model.h"
+#include "util_priv.h"
 #include "debug.h"
 
 static ni_netdev_t *	__ni_objectmodel_protocol_arg(const ni_dbus_variant_t *, const ni_dbus_service_t *);
+static void		ni_objectmodel_ipv6_setup_timeout(void *, const ni_timer_t *);
+
+/*
+ * The IPv6.changeProtocol call waiting until the kernel recovered
+ * the ipv6 setup of a device, without to block the daemon meanwhile.
+ */
+typedef struct ni_objectmodel_ipv6_setup {
+	unsigned int		ifindex;
+	unsigned int		count;
+	ni_ipv6_devconf_t	conf;
+	ni_dbus_deferred_reply_t *reply;
+} ni_objectmodel_ipv6_setup_t;
+
+#define NI_OBJECTMODEL_IPV6_SETUP_WAIT		100	/* msec */
+#define NI_OBJECTMODEL_IPV6_SETUP_COUNT		100
 
 /*
  * IPv6.changeProtocol method
@@ -41,6 +57,7 @@ ni_objectmodel_ipv6_change_protocol(ni_dbus_object_t *object, const ni_dbus_meth
 			ni_dbus_message_t *reply, DBusError *error)
 {
 	ni_netconfig_t *nc = ni_global_state_handle(0);
+	unsigned int count = NI_OBJECTMODEL_IPV6_SETUP_COUNT;
 	ni_netdev_t *dev, *cfg;
 	dbus_bool_t rv = FALSE;
 
@@ -55,11 +72,32 @@ ni_objectmodel_ipv6_change_protocol(ni_dbus_object_t *object, const ni_dbus_meth
 		goto out;
 	}
 
-	if (ni_system_ipv6_setup(nc, dev, &cfg->ipv6->conf) < 0) {
-		dbus_set_error(error, DBUS_ERROR_FAILED,
-				"failed to configure ipv6 protocol");
-		goto out;
-	}
+	if (ni_system_ipv6_setup_prepare(nc, dev)) {
+		ni_objectmodel_ipv6_setup_t *setup;
+
+		setup = xcalloc(1, sizeof(*setup));
+		setup->ifindex = dev->link.ifindex;
+		setup->count = NI_OBJECTMODEL_IPV6_SETUP_COUNT;
+		setup->conf = cfg->ipv6->conf;
+		setup->reply = ni_dbus_server_defer_reply(object, reply);
+
+		if (setup->reply && ni_timer_register(NI_OBJECTMODEL_IPV6_SETUP_WAIT,
+					ni_objectmodel_ipv6_setup_timeout, setup)) {
+			rv = TRUE;
+			goto out;
+		}
+		/* hand the reply back to the dispatcher and wait here */
+		ni_dbus_deferred_reply_complete(setup->reply, NULL);
+		free(setup);
+
+		while (count-- && !ni_system_ipv6_setup_ready(dev))
+			usleep(NI_OBJECTMODEL_IPV6_SETUP_WAIT * 1000);
+
+		if (ni_system_ipv6_setup_finish(nc, dev, &cfg->ipv6->conf, TRUE) < 0)
+			goto failed;
+	} else
+	if (ni_system_ipv6_setup_finish(nc, dev, &cfg->ipv6->conf, FALSE) < 0)
+		goto failed;
 
 	rv = TRUE;
 
@@ -67,6 +105,38 @@ out:
 	if (cfg)
 		ni_netdev_put(cfg);
 	return rv;
+
+failed:
+	dbus_set_error(error, DBUS_ERROR_FAILED,
+			"failed to configure ipv6 protocol");
+	goto out;
+}
+
+static void
+ni_objectmodel_ipv6_setup_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_objectmodel_ipv6_setup_t *setup = user_data;
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	DBusError error = DBUS_ERROR_INIT;
+	ni_netdev_t *dev;
+
+	if (!(dev = ni_netdev_by_index(nc, setup->ifindex))) {
+		dbus_set_error(&error, DBUS_ERROR_FAILED,
+				"failed to configure ipv6 protocol: device disappeared");
+	} else
+	if (!ni_system_ipv6_setup_ready(dev) && --setup->count) {
+		ni_timer_register(NI_OBJECTMODEL_IPV6_SETUP_WAIT,
+				ni_objectmodel_ipv6_setup_timeout, setup);
+		return;
+	} else
+	if (ni_system_ipv6_setup_finish(nc, dev, &setup->conf, TRUE) < 0) {
+		dbus_set_error(&error, DBUS_ERROR_FAILED,
+				"failed to configure ipv6 protocol");
+	}
+
+	ni_dbus_deferred_reply_complete(setup->reply, &error);
+	dbus_error_free(&error);
+	free(setup);
 }
 
 /*
@@ -169,6 +239,7 @@ const ni_dbus_property_t	ni_objectmodel_ipv6_property_table[] = {
 	IPV6_INT_PROPERTY(forwarding, conf.forwarding, RO),
 	IPV6_INT_PROPERTY(accept-ra, conf.accept_ra, RO),
 	IPV6_INT_PROPERTY(accept-dad, conf.accept_dad, RO),
+	IPV6_INT_PROPERTY(optimistic-dad, conf.optimistic_dad, RO),
 	IPV6_INT_PROPERTY(autoconf, conf.autoconf, RO),
 	IPV6_INT_PROPERTY(privacy, conf.privacy, RO),
 	IPV6_INT_PROPERTY(accept-redirects, conf.accept_redirects, RO),
@@ -27,6 +27,7 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
 #include <net/if_arp.h>
 
 #include <wicked/netinfo.h>
@@ -35,6 +36,7 @@
 #include <wicked/macvlan.h>
 #include <wicked/dbus-errors.h>
 #include <wicked/dbus-service.h>
+#include "util_priv.h"
 #include "model.h"
 #include "debug.h"
 
@@ -112,35 +114,38 @@ ni_objectmodel_macvtap_newlink(ni_dbus_object_t *factory_object,
 	return ni_objectmodel_netif_factory_result(server, reply, dev, NULL, error);
 }
 
-static ni_netdev_t *
-__ni_objectmodel_macvlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusError *error)
+/*
+ * Validate the macvlan/macvtap config and construct its name when
+ * the ifname argument is empty (ifname is set to NULL).
+ */
+static dbus_bool_t
+__ni_objectmodel_macvlan_newlink_check(ni_netdev_t *cfg_ifp, const char **ifnamep, DBusError *error)
 {
 	ni_netconfig_t *nc = ni_global_state_handle(0);
-	ni_netdev_t *dev_ifp = NULL;
+	const char *ifname = *ifnamep;
 	const ni_macvlan_t *macvlan;
 	const char *err;
 	const char *cfg_ifp_iftype = NULL;
-	int rv;
 
 	cfg_ifp_iftype = ni_linktype_type_to_name(cfg_ifp->link.type);
 
 	if (ni_string_empty(cfg_ifp->link.lowerdev.name)) {
 		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
 				"Incomplete arguments: need a lower device name");
-		return NULL;
+		return FALSE;
 	} else
 	if (!ni_netdev_ref_bind_ifindex(&cfg_ifp->link.lowerdev, nc)) {
 		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
 			"Unable to find %s lower device %s by name",
 			cfg_ifp_iftype,
 			cfg_ifp->link.lowerdev.name);
-		return NULL;
+		return FALSE;
 	}
 
 	macvlan = ni_netdev_get_macvlan(cfg_ifp);
 	if ((err = ni_macvlan_validate(macvlan))) {
 		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS, "%s", err);
-		goto out;
+		return FALSE;
 	}
 
 	if (ni_string_empty(ifname)) {
@@ -155,7 +160,7 @@ __ni_objectmodel_macvlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusE
 				"Unable to create %s interface: "
 				"name argument missed",
 				cfg_ifp_iftype);
-			goto out;
+			return FALSE;
 		}
 		ifname = NULL;
 	} else if(!ni_string_eq(cfg_ifp->name, ifname)) {
@@ -167,7 +172,7 @@ __ni_objectmodel_macvlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusE
 			"macvlan name %s equal with lower device name",
 			cfg_ifp_iftype,
 			cfg_ifp->name);
-		return NULL;
+		return FALSE;
 	}
 
 	if (cfg_ifp->link.hwaddr.len) {
@@ -180,19 +185,28 @@ __ni_objectmodel_macvlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusE
 				"invalid ethernet address '%s'",
 				cfg_ifp_iftype,
 				ni_link_address_print(&cfg_ifp->link.hwaddr));
-			return NULL;
+			return FALSE;
 		}
 	}
 
-	if ((rv = ni_system_macvlan_create(nc, cfg_ifp, &dev_ifp)) < 0) {
+	*ifnamep = ifname;
+	return TRUE;
+}
+
+static ni_netdev_t *
+__ni_objectmodel_macvlan_newlink_result(const ni_netdev_t *cfg_ifp, ni_netdev_t *dev_ifp,
+					int rv, const char *ifname, DBusError *error)
+{
+	const char *cfg_ifp_iftype = ni_linktype_type_to_name(cfg_ifp->link.type);
+
+	if (rv < 0) {
 		if (rv != -NI_ERROR_DEVICE_EXISTS || dev_ifp == NULL
 		|| (ifname && dev_ifp && !ni_string_eq(dev_ifp->name, ifname))) {
 			dbus_set_error(error, DBUS_ERROR_FAILED,
 					"Unable to create %s interface: %s",
 				cfg_ifp_iftype,
 				ni_strerror(rv));
-			dev_ifp = NULL;
-			goto out;
+			return NULL;
 		}
 		ni_debug_dbus("%s interface exists (and name matches)",
 			cfg_ifp_iftype);
@@ -204,15 +218,125 @@ __ni_objectmodel_macvlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusE
 				"new interface is of type %s",
 			cfg_ifp_iftype,
 			ni_linktype_type_to_name(dev_ifp->link.type));
-		dev_ifp = NULL;
+		return NULL;
+	}
+	return dev_ifp;
+}
+
+static ni_netdev_t *
+__ni_objectmodel_macvlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusError *error)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t *dev_ifp = NULL;
+	int rv;
+
+	if (__ni_objectmodel_macvlan_newlink_check(cfg_ifp, &ifname, error)) {
+		rv = ni_system_macvlan_create(nc, cfg_ifp, &dev_ifp);
+		dev_ifp = __ni_objectmodel_macvlan_newlink_result(cfg_ifp, dev_ifp,
+								rv, ifname, error);
 	}
 
-out:
 	if (cfg_ifp)
 		ni_netdev_put(cfg_ifp);
 	return dev_ifp;
 }
 
+/*
+ * Create a set of macvlan/macvtap interfaces, sending the netlink
+ * requests in one batch. The call fails as a whole when any of the
+ * configs is invalid; when the creation of a device fails, the
+ * devices created so far are kept and are registered by the
+ * newlink events.
+ */
+static dbus_bool_t
+__ni_objectmodel_macvlan_newlinks(ni_dbus_object_t *factory_object,
+			const ni_dbus_method_t *method, unsigned int iftype,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_server_t *server = ni_dbus_object_get_server(factory_object);
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	const char **ifnames = NULL;
+	ni_netdev_t **cfgs = NULL;
+	ni_netdev_t **devs = NULL;
+	int *results = NULL;
+	unsigned int i, count;
+	dbus_bool_t rv = FALSE;
+
+	ni_assert(argc == 2);
+	if (!ni_dbus_variant_is_string_array(&argv[0]) ||
+	    !ni_dbus_variant_is_dict_array(&argv[1]) ||
+	    argv[0].array.len != argv[1].array.len) {
+		return ni_dbus_error_invalid_args(error,
+						factory_object->path,
+						method->name);
+	}
+
+	count = argv[0].array.len;
+	ifnames = xcalloc(count + 1, sizeof(*ifnames));
+	cfgs    = xcalloc(count + 1, sizeof(*cfgs));
+	devs    = xcalloc(count + 1, sizeof(*devs));
+	results = xcalloc(count + 1, sizeof(*results));
+
+	for (i = 0; i < count; ++i) {
+		ifnames[i] = argv[0].string_array_value[i];
+		if (!(cfgs[i] = __ni_objectmodel_macvlan_device_arg(
+					&argv[1].variant_array_value[i], iftype))) {
+			ni_dbus_error_invalid_args(error,
+						factory_object->path,
+						method->name);
+			goto cleanup;
+		}
+		if (!__ni_objectmodel_macvlan_newlink_check(cfgs[i], &ifnames[i], error))
+			goto cleanup;
+	}
+
+	ni_system_macvlan_create_batch(nc, count, (const ni_netdev_t **)cfgs, devs, results);
+	for (i = 0; i < count; ++i) {
+		devs[i] = __ni_objectmodel_macvlan_newlink_result(cfgs[i], devs[i],
+						results[i], ifnames[i], error);
+		if (!devs[i])
+			goto cleanup;
+	}
+
+	rv = ni_objectmodel_netif_factory_results(server, reply, devs, count, NULL, error);
+
+cleanup:
+	for (i = 0; i < count; ++i) {
+		if (cfgs[i])
+			ni_netdev_put(cfgs[i]);
+	}
+	free(results);
+	free(devs);
+	free(cfgs);
+	free(ifnames);
+	return rv;
+}
+
+static dbus_bool_t
+ni_objectmodel_macvlan_newlinks(ni_dbus_object_t *factory_object,
+			const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	NI_TRACE_ENTER();
+
+	return __ni_objectmodel_macvlan_newlinks(factory_object, method,
+			NI_IFTYPE_MACVLAN, argc, argv, reply, error);
+}
+
+static dbus_bool_t
+ni_objectmodel_macvtap_newlinks(ni_dbus_object_t *factory_object,
+			const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	NI_TRACE_ENTER();
+
+	return __ni_objectmodel_macvlan_newlinks(factory_object, method,
+			NI_IFTYPE_MACVTAP, argc, argv, reply, error);
+}
+
 static dbus_bool_t
 ni_objectmodel_macvlan_change(ni_dbus_object_t *object, const ni_dbus_method_t *method,
 			unsigned int argc, const ni_dbus_variant_t *argv,
@@ -515,6 +639,7 @@ static ni_dbus_method_t		ni_objectmodel_macvlan_methods[] = {
 
 static ni_dbus_method_t		ni_objectmodel_macvlan_factory_methods[] = {
 	{ "newDevice",		"sa{sv}",	.handler = ni_objectmodel_macvlan_newlink },
+	{ "newDevices",		"asaa{sv}",	.handler = ni_objectmodel_macvlan_newlinks },
 
 	{ NULL }
 };
@@ -528,6 +653,7 @@ static ni_dbus_method_t		ni_objectmodel_macvtap_methods[] = {
 
 static ni_dbus_method_t		ni_objectmodel_macvtap_factory_methods[] = {
 	{ "newDevice",		"sa{sv}",	.handler = ni_objectmodel_macvtap_newlink },
+	{ "newDevices",		"asaa{sv}",	.handler = ni_objectmodel_macvtap_newlinks },
 
 	{ NULL }
 };
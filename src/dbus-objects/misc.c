@@ -418,6 +418,11 @@ __ni_objectmodel_get_address_list(ni_address_t *list,
 {
 	const ni_address_t *ap;
 	dbus_bool_t rv = TRUE;
+	unsigned int count = 0;
+
+	for (ap = list; ap; ap = ap->next)
+		count++;
+	ni_dbus_variant_reserve(result, count);
 
 	for (ap = list; ap && rv; ap = ap->next) {
 		ni_dbus_variant_t *dict;
@@ -685,9 +690,13 @@ __ni_objectmodel_get_route_list(ni_route_table_t *list,
 {
 	const ni_route_table_t *tab;
 	const ni_route_t *rp;
-	unsigned int i;
+	unsigned int i, count = 0;
 	dbus_bool_t rv = TRUE;
 
+	for (tab = list; tab; tab = tab->next)
+		count += tab->routes.count;
+	ni_dbus_variant_reserve(result, count);
+
 	for (tab = list; rv && tab; tab = tab->next) {
 		for (i = 0; rv && i < tab->routes.count; ++i) {
 			ni_dbus_variant_t *dict;
@@ -723,6 +732,7 @@ __ni_objectmodel_get_rule_list(ni_rule_array_t *rules, unsigned int family,
 	if (!result)
 		return FALSE;
 
+	ni_dbus_variant_reserve(result, rules->count);
 	for (i = 0; rv && i < rules->count; ++i) {
 		ni_dbus_variant_t *dict;
 
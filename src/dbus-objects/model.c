@@ -24,6 +24,7 @@
 #include "util_priv.h"
 #include "dbus-common.h"
 #include "xml-schema.h"
+#include "profile.h"
 #include "model.h"
 #include "appconfig.h"
 #include "extension.h"
@@ -80,6 +81,7 @@ ni_xs_scope_t *
 ni_objectmodel_init(ni_dbus_server_t *server)
 {
 	if (__ni_objectmodel_schema == NULL) {
+		ni_profile_enter("schema-load");
 		__ni_objectmodel_schema = ni_server_dbus_xml_schema();
 		if (__ni_objectmodel_schema == NULL)
 			ni_fatal("Giving up.");
@@ -103,6 +105,7 @@ ni_objectmodel_init(ni_dbus_server_t *server)
 
 		/* Bind all extensions */
 		ni_objectmodel_bind_extensions();
+		ni_profile_leave();
 	}
 
 	return __ni_objectmodel_schema;
@@ -132,6 +135,7 @@ ni_objectmodel_create_initial_objects(ni_dbus_server_t *server)
 	/* Register root interface with the root of the object hierarchy */
 	object = ni_dbus_server_get_root_object(server);
 	ni_dbus_object_register_service(object, &ni_objectmodel_netif_root_interface);
+	ni_dbus_object_register_service(object, &ni_objectmodel_stats_service);
 
 	ni_objectmodel_create_netif_list(server);
 #ifdef MODEM
@@ -82,6 +82,7 @@ __ni_objectmodel_get_property_ulong(const void *handle, unsigned long *member_of
 
 extern ni_dbus_server_t *	__ni_objectmodel_server;
 extern ni_xs_scope_t *		__ni_objectmodel_schema;
+extern ni_dbus_service_t	ni_objectmodel_stats_service;
 extern ni_dbus_service_t	ni_objectmodel_ipv4_service;
 extern ni_dbus_service_t	ni_objectmodel_ipv6_service;
 extern ni_dbus_service_t	ni_objectmodel_ethtool_service;
@@ -126,6 +127,9 @@ extern ni_netdev_t *		ni_objectmodel_get_netif_argument(const ni_dbus_variant_t
 extern dbus_bool_t		ni_objectmodel_netif_factory_result(ni_dbus_server_t *, ni_dbus_message_t *,
 						ni_netdev_t *, const ni_dbus_class_t *,
 						DBusError *);
+extern dbus_bool_t		ni_objectmodel_netif_factory_results(ni_dbus_server_t *, ni_dbus_message_t *,
+						ni_netdev_t **, unsigned int, const ni_dbus_class_t *,
+						DBusError *);
 extern const char *		ni_objectmodel_netif_path(const ni_netdev_t *);
 extern const char *		ni_objectmodel_netif_full_path(const ni_netdev_t *);
 extern const char *		ni_objectmodel_interface_full_path(const ni_netdev_t *);
@@ -9,6 +9,8 @@
 #include "config.h"
 #endif
 
+#include <unistd.h>
+
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
 #include <wicked/dbus.h>
@@ -208,3 +210,48 @@ ni_objectmodel_recover_state(const char *filename, const char **prefix_list)
 }
 
 
+/*
+ * The initrd instances of the daemons leave a state snapshot in the
+ * state directory, which survives the switch-root; the root-fs daemon
+ * instances take it over once at startup without to renegotiate.
+ */
+static const char *
+ni_objectmodel_handover_file(char **path, const char *name)
+{
+	return ni_string_printf(path, "%s/%s-handover.xml", ni_config_statedir(), name);
+}
+
+ni_bool_t
+ni_objectmodel_save_handover(const char *name)
+{
+	char *path = NULL;
+	ni_bool_t rv;
+
+	if (!ni_running_in_initrd() || !ni_objectmodel_handover_file(&path, name))
+		return FALSE;
+
+	rv = ni_objectmodel_save_state(path);
+	ni_string_free(&path);
+	return rv;
+}
+
+ni_bool_t
+ni_objectmodel_recover_handover(const char *name, const char **prefix_list)
+{
+	char *path = NULL;
+	ni_bool_t rv;
+
+	if (ni_running_in_initrd() || !ni_objectmodel_handover_file(&path, name))
+		return FALSE;
+
+	if (!ni_file_exists(path)) {
+		ni_string_free(&path);
+		return FALSE;
+	}
+
+	ni_debug_objectmodel("taking over initrd state from %s", path);
+	rv = ni_objectmodel_recover_state(path, prefix_list);
+	unlink(path);
+	ni_string_free(&path);
+	return rv;
+}
@@ -0,0 +1,322 @@
+/*
+ *	DBus encapsulation of the runtime performance counters
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+#include <wicked/dbus-errors.h>
+#include <wicked/dbus-service.h>
+#include <wicked/objectmodel.h>
+#include "netinfo_priv.h"
+#include "stats.h"
+#include "link-sampler.h"
+#include "model.h"
+
+/*
+ * Stats.getCounters
+ *
+ * Returns a dict with the plain "counters", the received "rtnl-events"
+ * per netlink group, the "rtnl-refresh" dump counts, the allocated and
+ * freed "objects" per subsystem with the bytes of the live ones and the
+ * latency histograms of the "netlink-dumps" and "dbus-calls" by name. Each
+ * histogram provides the count, the sum in usec and the (non-cumulative)
+ * buckets by their upper bound in usec, where the last one is "+Inf".
+ */
+static void
+ni_objectmodel_stats_add_histograms(ni_dbus_variant_t *dict, const char *name,
+			const ni_stats_histogram_array_t *array)
+{
+	ni_dbus_variant_t *hists, *hdict, *bdict;
+	const ni_stats_histogram_t *hist;
+	unsigned int i, b;
+
+	if (!(hists = ni_dbus_dict_add(dict, name)))
+		return;
+
+	ni_dbus_variant_init_dict(hists);
+	for (i = 0; i < array->count; ++i) {
+		hist = array->data[i];
+
+		if (!(hdict = ni_dbus_dict_add(hists, hist->name)))
+			return;
+
+		ni_dbus_variant_init_dict(hdict);
+		ni_dbus_dict_add_uint64(hdict, "count", hist->count);
+		ni_dbus_dict_add_uint64(hdict, "sum", hist->sum);
+
+		if (!(bdict = ni_dbus_dict_add(hdict, "buckets")))
+			return;
+
+		ni_dbus_variant_init_dict(bdict);
+		for (b = 0; b < NI_STATS_HISTOGRAM_BUCKETS; ++b)
+			ni_dbus_dict_add_uint64(bdict, ni_stats_histogram_bucket_name(b),
+					hist->buckets[b]);
+	}
+}
+
+static dbus_bool_t
+ni_objectmodel_stats_get_counters(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	const ni_rtnl_refresh_stats_t *refresh = &__ni_global_rtnl_refresh_stats;
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_dbus_variant_t *dict;
+	const uint64_t *events;
+	unsigned int i, count;
+	dbus_bool_t rv;
+
+	if (argc != 0)
+		return ni_dbus_error_invalid_args(error, object->path, method->name);
+
+	ni_dbus_variant_init_dict(&result);
+
+	if ((dict = ni_dbus_dict_add(&result, "counters"))) {
+		ni_dbus_variant_init_dict(dict);
+		for (i = 0; i < NI_STATS_COUNTER_MAX; ++i)
+			ni_dbus_dict_add_uint64(dict, ni_stats_counter_name(i),
+					ni_stats_counters[i]);
+	}
+
+	if ((dict = ni_dbus_dict_add(&result, "rtnl-events"))) {
+		const char *name;
+
+		ni_dbus_variant_init_dict(dict);
+		events = ni_stats_rtnl_events(&count);
+		for (i = 0; i < count; ++i) {
+			if (!events[i] || !(name = ni_stats_rtnl_group_name(i)))
+				continue;
+			ni_dbus_dict_add_uint64(dict, name, events[i]);
+		}
+	}
+
+	if ((dict = ni_dbus_dict_add(&result, "rtnl-refresh"))) {
+		ni_dbus_variant_init_dict(dict);
+		ni_dbus_dict_add_uint64(dict, "full",    refresh->full);
+		ni_dbus_dict_add_uint64(dict, "skipped", refresh->skipped);
+		ni_dbus_dict_add_uint64(dict, "resync",  refresh->resync);
+		ni_dbus_dict_add_uint64(dict, "overrun", refresh->overrun);
+		ni_dbus_dict_add_uint64(dict, "grown",   refresh->grown);
+	}
+
+	if ((dict = ni_dbus_dict_add(&result, "objects"))) {
+		const ni_stats_object_t *obj;
+		ni_dbus_variant_t *odict;
+
+		ni_dbus_variant_init_dict(dict);
+		for (i = 0; i < NI_STATS_OBJECT_MAX; ++i) {
+			if (!(odict = ni_dbus_dict_add(dict, ni_stats_object_name(i))))
+				break;
+
+			obj = &ni_stats_objects[i];
+			ni_dbus_variant_init_dict(odict);
+			ni_dbus_dict_add_uint64(odict, "allocated", obj->allocated);
+			ni_dbus_dict_add_uint64(odict, "freed", obj->freed);
+			ni_dbus_dict_add_uint64(odict, "bytes", obj->bytes);
+		}
+	}
+
+	ni_objectmodel_stats_add_histograms(&result, "netlink-dumps", ni_stats_netlink_dumps());
+	ni_objectmodel_stats_add_histograms(&result, "dbus-calls", ni_stats_dbus_calls());
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+/*
+ * Stats.subscribeLink(ifname), Stats.unsubscribeLink(ifname)
+ *
+ * Start and stop the periodic link statistics sampling of an interface.
+ */
+static ni_netdev_t *
+ni_objectmodel_stats_get_netdev(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv, DBusError *error)
+{
+	ni_netconfig_t *nc;
+	ni_netdev_t *dev;
+	const char *name;
+
+	if (argc != 1 || !ni_dbus_variant_get_string(&argv[0], &name) || ni_string_empty(name)) {
+		ni_dbus_error_invalid_args(error, object->path, method->name);
+		return NULL;
+	}
+
+	if (!(nc = ni_global_state_handle(0)) || !(dev = ni_netdev_by_name(nc, name))) {
+		dbus_set_error(error, NI_DBUS_ERROR_DEVICE_NOT_KNOWN,
+				"failed to identify interface %s", name);
+		return NULL;
+	}
+	return dev;
+}
+
+static dbus_bool_t
+ni_objectmodel_stats_subscribe_link(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_netdev_t *dev;
+
+	if (!(dev = ni_objectmodel_stats_get_netdev(object, method, argc, argv, error)))
+		return FALSE;
+
+	if (ni_link_sampler_subscribe(dev->link.ifindex) < 0) {
+		dbus_set_error(error, DBUS_ERROR_FAILED,
+				"unable to sample link statistics of interface %s", dev->name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static dbus_bool_t
+ni_objectmodel_stats_unsubscribe_link(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_netdev_t *dev;
+
+	if (!(dev = ni_objectmodel_stats_get_netdev(object, method, argc, argv, error)))
+		return FALSE;
+
+	ni_link_sampler_unsubscribe(dev->link.ifindex);
+	return TRUE;
+}
+
+/*
+ * Stats.getLinkRates
+ *
+ * Returns a dict of the sampled interfaces by name, each providing the
+ * "ifindex", the sample "interval" in msec, the number of "samples" in
+ * the history, the last "counters" as well as the "current" rates over
+ * the last interval and the "average" rates over the history in units
+ * per second.
+ */
+static void
+ni_objectmodel_stats_add_link_counters(ni_dbus_variant_t *dict, const char *name,
+			const uint64_t *counters)
+{
+	ni_dbus_variant_t *cdict;
+	unsigned int i;
+
+	if (!(cdict = ni_dbus_dict_add(dict, name)))
+		return;
+
+	ni_dbus_variant_init_dict(cdict);
+	for (i = 0; i < NI_LINK_SAMPLER_COUNTER_MAX; ++i)
+		ni_dbus_dict_add_uint64(cdict, ni_link_sampler_counter_name(i), counters[i]);
+}
+
+static dbus_bool_t
+ni_objectmodel_stats_get_link_rates(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_link_sampler_rates_t rates;
+	ni_dbus_variant_t *dict;
+	const ni_netdev_t *dev;
+	char buf[32];
+	unsigned int i;
+	dbus_bool_t rv;
+
+	if (argc != 0)
+		return ni_dbus_error_invalid_args(error, object->path, method->name);
+
+	ni_dbus_variant_init_dict(&result);
+	for (i = 0; ni_link_sampler_rates(i, &rates); ++i) {
+		if (nc && (dev = ni_netdev_by_index(nc, rates.ifindex)))
+			dict = ni_dbus_dict_add(&result, dev->name);
+		else if (snprintf(buf, sizeof(buf), "%u", rates.ifindex) > 0)
+			dict = ni_dbus_dict_add(&result, buf);
+		else
+			dict = NULL;
+		if (!dict)
+			break;
+
+		ni_dbus_variant_init_dict(dict);
+		ni_dbus_dict_add_uint32(dict, "ifindex", rates.ifindex);
+		ni_dbus_dict_add_uint32(dict, "interval", rates.interval);
+		ni_dbus_dict_add_uint32(dict, "samples", rates.samples);
+		ni_objectmodel_stats_add_link_counters(dict, "counters", rates.counters);
+		ni_objectmodel_stats_add_link_counters(dict, "current", rates.current);
+		ni_objectmodel_stats_add_link_counters(dict, "average", rates.average);
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+/*
+ * Stats.getNetdevMemory
+ *
+ * Returns a dict of the interfaces by name, each providing the bytes
+ * of the structs allocated for it by block and the "total".
+ */
+static dbus_bool_t
+ni_objectmodel_stats_get_netdev_memory(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	size_t usage[NI_NETDEV_MEMORY_MAX], total;
+	ni_dbus_variant_t *dict;
+	const ni_netdev_t *dev;
+	unsigned int i;
+	dbus_bool_t rv;
+
+	if (argc != 0)
+		return ni_dbus_error_invalid_args(error, object->path, method->name);
+
+	ni_dbus_variant_init_dict(&result);
+	for (dev = nc ? ni_netconfig_devlist(nc) : NULL; dev; dev = dev->next) {
+		if (ni_string_empty(dev->name))
+			continue;
+		if (!(dict = ni_dbus_dict_add(&result, dev->name)))
+			break;
+
+		total = ni_netdev_memory_usage(dev, usage);
+		ni_dbus_variant_init_dict(dict);
+		for (i = 0; i < NI_NETDEV_MEMORY_MAX; ++i)
+			ni_dbus_dict_add_uint64(dict, ni_netdev_memory_block_name(i), usage[i]);
+		ni_dbus_dict_add_uint64(dict, "total", total);
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+static ni_dbus_method_t		ni_objectmodel_stats_methods[] = {
+	{ "getCounters",	"",		.handler = ni_objectmodel_stats_get_counters },
+	{ "subscribeLink",	"s",		.handler = ni_objectmodel_stats_subscribe_link },
+	{ "unsubscribeLink",	"s",		.handler = ni_objectmodel_stats_unsubscribe_link },
+	{ "getLinkRates",	"",		.handler = ni_objectmodel_stats_get_link_rates },
+	{ "getNetdevMemory",	"",		.handler = ni_objectmodel_stats_get_netdev_memory },
+	{ NULL }
+};
+
+ni_dbus_service_t		ni_objectmodel_stats_service = {
+	.name		= NI_OBJECTMODEL_STATS_INTERFACE,
+	.methods	= ni_objectmodel_stats_methods,
+};
@@ -7,6 +7,7 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
 #include <net/if_arp.h>
 
 #include <wicked/netinfo.h>
@@ -15,6 +16,7 @@
 #include <wicked/vlan.h>
 #include <wicked/dbus-errors.h>
 #include <wicked/dbus-service.h>
+#include "util_priv.h"
 #include "model.h"
 #include "debug.h"
 
@@ -57,31 +59,34 @@ ni_objectmodel_vlan_newlink(ni_dbus_object_t *factory_object, const ni_dbus_meth
 	return ni_objectmodel_netif_factory_result(server, reply, ifp, NULL, error);
 }
 
-static ni_netdev_t *
-__ni_objectmodel_vlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusError *error)
+/*
+ * Validate the vlan config and construct its name when
+ * the ifname argument is empty (ifname is set to NULL).
+ */
+static dbus_bool_t
+__ni_objectmodel_vlan_newlink_check(ni_netdev_t *cfg_ifp, const char **ifnamep, DBusError *error)
 {
 	ni_netconfig_t *nc = ni_global_state_handle(0);
-	ni_netdev_t *new_ifp = NULL;
+	const char *ifname = *ifnamep;
 	const ni_vlan_t *vlan;
 	const char *err;
-	int rv;
 
 	if (ni_string_empty(cfg_ifp->link.lowerdev.name)) {
 		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
 				"Incomplete arguments: need a lower device name");
-		return NULL;
+		return FALSE;
 	} else
 	if (!ni_netdev_ref_bind_ifindex(&cfg_ifp->link.lowerdev, nc)) {
 		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
 				"Unable to find vlan lower device %s by name",
 				cfg_ifp->link.lowerdev.name);
-		return NULL;
+		return FALSE;
 	}
 
 	vlan = ni_netdev_get_vlan(cfg_ifp);
 	if ((err = ni_vlan_validate(vlan))) {
 		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS, "%s", err);
-		return NULL;
+		return FALSE;
 	}
 
 	if (ni_string_empty(ifname)) {
@@ -92,7 +97,7 @@ __ni_objectmodel_vlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusErro
 			dbus_set_error(error, DBUS_ERROR_FAILED,
 				"Unable to create vlan interface: "
 				"name argument missed, failed to construct");
-			return NULL;
+			return FALSE;
 		}
 	} else
 	if (!ni_string_eq(cfg_ifp->name, ifname)) {
@@ -102,7 +107,7 @@ __ni_objectmodel_vlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusErro
 		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
 				"Cannot create vlan interface: "
 				"vlan name %s equal with lower device name", cfg_ifp->name);
-		return NULL;
+		return FALSE;
 	}
 
 	ni_debug_dbus("VLAN.newDevice(name=%s/%s, dev=%s, tag=%u)", ifname,
@@ -118,19 +123,26 @@ __ni_objectmodel_vlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusErro
 				"Cannot create vlan interface: "
 				"invalid ethernet address '%s'",
 				ni_link_address_print(&cfg_ifp->link.hwaddr));
-			return NULL;
+			return FALSE;
 		}
 	}
 
-	if ((rv = ni_system_vlan_create(nc, cfg_ifp, &new_ifp)) < 0) {
+	*ifnamep = ifname;
+	return TRUE;
+}
+
+static ni_netdev_t *
+__ni_objectmodel_vlan_newlink_result(ni_netdev_t *new_ifp, int rv, const char *ifname,
+					DBusError *error)
+{
+	if (rv < 0) {
 		if (rv != -NI_ERROR_DEVICE_EXISTS || new_ifp == NULL
 		|| (ifname && new_ifp && !ni_string_eq(ifname, new_ifp->name))) {
 			dbus_set_error(error,
 					DBUS_ERROR_FAILED,
 					"Unable to create VLAN interface: %s",
 					ni_strerror(rv));
-			new_ifp = NULL;
-			goto out;
+			return NULL;
 		}
 		ni_debug_dbus("VLAN interface exists (and name matches)");
 	}
@@ -140,16 +152,94 @@ __ni_objectmodel_vlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusErro
 				DBUS_ERROR_FAILED,
 				"Unable to create VLAN interface: new interface is of type %s",
 				ni_linktype_type_to_name(new_ifp->link.type));
-		new_ifp = NULL;
-		goto out;
+		return NULL;
+	}
+	return new_ifp;
+}
+
+static ni_netdev_t *
+__ni_objectmodel_vlan_newlink(ni_netdev_t *cfg_ifp, const char *ifname, DBusError *error)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t *new_ifp = NULL;
+	int rv;
+
+	if (__ni_objectmodel_vlan_newlink_check(cfg_ifp, &ifname, error)) {
+		rv = ni_system_vlan_create(nc, cfg_ifp, &new_ifp);
+		new_ifp = __ni_objectmodel_vlan_newlink_result(new_ifp, rv, ifname, error);
 	}
 
-out:
 	if (cfg_ifp)
 		ni_netdev_put(cfg_ifp);
 	return new_ifp;
 }
 
+/*
+ * Create a set of VLAN interfaces, e.g. all vlans on top of a
+ * trunk port, sending the netlink requests in one batch.
+ * The call fails as a whole when any of the configs is invalid;
+ * when the creation of a device fails, the devices created so
+ * far are kept and are registered by the newlink events.
+ */
+static dbus_bool_t
+ni_objectmodel_vlan_newlinks(ni_dbus_object_t *factory_object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_server_t *server = ni_dbus_object_get_server(factory_object);
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	const char **ifnames = NULL;
+	ni_netdev_t **cfgs = NULL;
+	ni_netdev_t **devs = NULL;
+	int *results = NULL;
+	unsigned int i, count;
+	dbus_bool_t rv = FALSE;
+
+	NI_TRACE_ENTER();
+
+	ni_assert(argc == 2);
+	if (!ni_dbus_variant_is_string_array(&argv[0]) ||
+	    !ni_dbus_variant_is_dict_array(&argv[1]) ||
+	    argv[0].array.len != argv[1].array.len)
+		return ni_dbus_error_invalid_args(error, factory_object->path, method->name);
+
+	count = argv[0].array.len;
+	ifnames = xcalloc(count + 1, sizeof(*ifnames));
+	cfgs    = xcalloc(count + 1, sizeof(*cfgs));
+	devs    = xcalloc(count + 1, sizeof(*devs));
+	results = xcalloc(count + 1, sizeof(*results));
+
+	for (i = 0; i < count; ++i) {
+		ifnames[i] = argv[0].string_array_value[i];
+		if (!(cfgs[i] = __ni_objectmodel_vlan_device_arg(&argv[1].variant_array_value[i]))) {
+			ni_dbus_error_invalid_args(error, factory_object->path, method->name);
+			goto cleanup;
+		}
+		if (!__ni_objectmodel_vlan_newlink_check(cfgs[i], &ifnames[i], error))
+			goto cleanup;
+	}
+
+	ni_system_vlan_create_batch(nc, count, (const ni_netdev_t **)cfgs, devs, results);
+	for (i = 0; i < count; ++i) {
+		devs[i] = __ni_objectmodel_vlan_newlink_result(devs[i], results[i], ifnames[i], error);
+		if (!devs[i])
+			goto cleanup;
+	}
+
+	rv = ni_objectmodel_netif_factory_results(server, reply, devs, count, NULL, error);
+
+cleanup:
+	for (i = 0; i < count; ++i) {
+		if (cfgs[i])
+			ni_netdev_put(cfgs[i]);
+	}
+	free(results);
+	free(devs);
+	free(cfgs);
+	free(ifnames);
+	return rv;
+}
+
 /*
  * Change a VLAN interface
  */
@@ -398,6 +488,7 @@ static ni_dbus_method_t		ni_objectmodel_vlan_methods[] = {
 
 static ni_dbus_method_t		ni_objectmodel_vlan_factory_methods[] = {
 	{ "newDevice",		"sa{sv}",	.handler = ni_objectmodel_vlan_newlink },
+	{ "newDevices",		"asaa{sv}",	.handler = ni_objectmodel_vlan_newlinks },
 
 	{ NULL }
 };
@@ -21,6 +21,8 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
+#include <string.h>
 #include <net/if_arp.h>
 
 #include <wicked/netinfo.h>
@@ -32,6 +34,7 @@
 #include "model.h"
 #include "debug.h"
 #include "misc.h"
+#include "util_priv.h"
 
 /*
  * Return an interface handle containing all vxlan-specific information provided
@@ -46,19 +49,17 @@ ni_objectmodel_vxlan_device_arg(const ni_dbus_variant_t *dict)
 /*
  * Create a new vxlan interface
  */
-static ni_netdev_t *
-ni_objectmodel_vxlan_create(ni_netdev_t *cfg, const char *ifname, DBusError *error)
+static dbus_bool_t
+__ni_objectmodel_vxlan_check(ni_netdev_t *cfg, const char *ifname, DBusError *error)
 {
 	ni_netconfig_t *nc = ni_global_state_handle(0);
-	ni_netdev_t *dev = NULL;
 	ni_vxlan_t *vxlan;
 	const char *iftype;
 	const char *err;
-	int rv;
 
 	iftype = ni_linktype_type_to_name(cfg->link.type);
 	if (!iftype || !(vxlan = ni_netdev_get_vxlan(cfg)))
-		goto out;
+		return FALSE;
 
 	if (ni_string_empty(ifname)) {
 		if ((ifname = ni_netdev_make_name(nc, iftype, 0))) {
@@ -67,7 +68,7 @@ ni_objectmodel_vxlan_create(ni_netdev_t *cfg, const char *ifname, DBusError *err
 			dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
 				"Unable to create %s interface: "
 				"name argument missed", iftype);
-			goto out;
+			return FALSE;
 		}
 		ifname = cfg->name;
 	} else
@@ -76,7 +77,7 @@ ni_objectmodel_vxlan_create(ni_netdev_t *cfg, const char *ifname, DBusError *err
 				"Unable to create %s interface: "
 				"invalid interface name '%s'",
 				iftype, ni_print_suspect(ifname, 15));
-		goto out;
+		return FALSE;
 	} else
 	if(!ni_string_eq(cfg->name, ifname)) {
 		ni_string_dup(&cfg->name, ifname);
@@ -85,7 +86,7 @@ ni_objectmodel_vxlan_create(ni_netdev_t *cfg, const char *ifname, DBusError *err
 	if (!ni_string_empty(cfg->link.lowerdev.name) &&
 	    !ni_objectmodel_bind_netdev_ref_index(cfg->name, "vxlan link",
 	    				&cfg->link.lowerdev, nc, error))
-		goto out;
+		return FALSE;
 
 	if (cfg->link.hwaddr.len) {
 		if (cfg->link.hwaddr.type == ARPHRD_VOID)
@@ -97,7 +98,7 @@ ni_objectmodel_vxlan_create(ni_netdev_t *cfg, const char *ifname, DBusError *err
 				"Cannot create %s interface: "
 				"invalid ethernet address '%s'",
 				iftype, ni_link_address_print(&cfg->link.hwaddr));
-			goto out;
+			return FALSE;
 		}
 	}
 
@@ -105,20 +106,27 @@ ni_objectmodel_vxlan_create(ni_netdev_t *cfg, const char *ifname, DBusError *err
 		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
 				"%s: Cannot create %s interface: %s",
 				ifname, iftype, err);
-		goto out;
+		return FALSE;
 	}
+	return TRUE;
+}
+
+static ni_netdev_t *
+__ni_objectmodel_vxlan_result(ni_netdev_t *dev, int rv, const ni_netdev_t *cfg,
+				DBusError *error)
+{
+	const char *iftype = ni_linktype_type_to_name(cfg->link.type);
 
-	if ((rv = ni_system_vxlan_create(nc, cfg, &dev)) < 0) {
+	if (rv < 0) {
 		if (rv != -NI_ERROR_DEVICE_EXISTS || dev == NULL
-		|| (ifname && dev && !ni_string_eq(dev->name, ifname))) {
+		|| (dev && !ni_string_eq(dev->name, cfg->name))) {
 			dbus_set_error(error, DBUS_ERROR_FAILED,
 				"Unable to create %s interface: %s",
 				iftype, ni_strerror(rv));
-			dev = NULL;
-			goto out;
+			return NULL;
 		}
 		ni_debug_dbus("%s interface %s exists (and name matches)",
-				iftype, ifname);
+				iftype, cfg->name);
 	}
 
 	if (dev->link.type != cfg->link.type) {
@@ -126,13 +134,25 @@ ni_objectmodel_vxlan_create(ni_netdev_t *cfg, const char *ifname, DBusError *err
 				"Unable to create %s interface: "
 				"new interface is of type %s",
 			iftype, ni_linktype_type_to_name(dev->link.type));
-		dev = NULL;
+		return NULL;
 	}
-
-out:
 	return dev;
 }
 
+static ni_netdev_t *
+ni_objectmodel_vxlan_create(ni_netdev_t *cfg, const char *ifname, DBusError *error)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t *dev = NULL;
+	int rv;
+
+	if (!__ni_objectmodel_vxlan_check(cfg, ifname, error))
+		return NULL;
+
+	rv = ni_system_vxlan_create(nc, cfg, &dev);
+	return __ni_objectmodel_vxlan_result(dev, rv, cfg, error);
+}
+
 static dbus_bool_t
 ni_objectmodel_vxlan_newlink(ni_dbus_object_t *factory, const ni_dbus_method_t *method,
 			unsigned int argc, const ni_dbus_variant_t *argv,
@@ -157,6 +177,69 @@ ni_objectmodel_vxlan_newlink(ni_dbus_object_t *factory, const ni_dbus_method_t *
 	return ni_objectmodel_netif_factory_result(server, reply, dev, NULL, error);
 }
 
+/*
+ * Create several vxlan interfaces in one netlink batch. The names
+ * are required here, as the generated ones are unique per device.
+ */
+static dbus_bool_t
+ni_objectmodel_vxlan_newlinks(ni_dbus_object_t *factory, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_server_t *server = ni_dbus_object_get_server(factory);
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t **cfgs = NULL;
+	ni_netdev_t **devs = NULL;
+	int *results = NULL;
+	unsigned int i, count;
+	const char *ifname;
+	dbus_bool_t rv = FALSE;
+
+	NI_TRACE_ENTER();
+
+	if (argc != 2 ||
+	    !ni_dbus_variant_is_string_array(&argv[0]) ||
+	    !ni_dbus_variant_is_dict_array(&argv[1]) ||
+	    argv[0].array.len != argv[1].array.len)
+		return ni_dbus_error_invalid_args(error, factory->path, method->name);
+
+	count = argv[0].array.len;
+	cfgs    = xcalloc(count + 1, sizeof(*cfgs));
+	devs    = xcalloc(count + 1, sizeof(*devs));
+	results = xcalloc(count + 1, sizeof(*results));
+
+	for (i = 0; i < count; ++i) {
+		ifname = argv[0].string_array_value[i];
+		if (ni_string_empty(ifname) ||
+		    !(cfgs[i] = ni_objectmodel_vxlan_device_arg(&argv[1].variant_array_value[i]))) {
+			ni_dbus_error_invalid_args(error, factory->path, method->name);
+			goto cleanup;
+		}
+		if (!__ni_objectmodel_vxlan_check(cfgs[i], ifname, error))
+			goto cleanup;
+	}
+
+	ni_system_vxlan_create_batch(nc, count, (const ni_netdev_t **)cfgs,
+					devs, results);
+	for (i = 0; i < count; ++i) {
+		if (!(devs[i] = __ni_objectmodel_vxlan_result(devs[i], results[i],
+							cfgs[i], error)))
+			goto cleanup;
+	}
+
+	rv = ni_objectmodel_netif_factory_results(server, reply, devs, count, NULL, error);
+
+cleanup:
+	for (i = 0; i < count; ++i) {
+		if (cfgs[i])
+			ni_netdev_put(cfgs[i]);
+	}
+	free(results);
+	free(devs);
+	free(cfgs);
+	return rv;
+}
+
 static dbus_bool_t
 ni_objectmodel_vxlan_change(ni_dbus_object_t *object, const ni_dbus_method_t *method,
 			unsigned int argc, const ni_dbus_variant_t *argv,
@@ -272,6 +355,105 @@ ni_objectmodel_vxlan_delete(ni_dbus_object_t *object, const ni_dbus_method_t *me
 	return TRUE;
 }
 
+/*
+ * Add or delete forwarding database entries of a vxlan interface
+ */
+static dbus_bool_t
+__ni_objectmodel_vxlan_fdb_entry_arg(const ni_dbus_variant_t *dict,
+				ni_vxlan_fdb_entry_t *entry)
+{
+	const ni_dbus_variant_t *var;
+
+	memset(entry, 0, sizeof(*entry));
+	if (!(var = ni_dbus_dict_get(dict, "lladdr")) ||
+	    !__ni_objectmodel_set_hwaddr(var, &entry->lladdr))
+		return FALSE;
+	entry->lladdr.type = ARPHRD_ETHER;
+
+	if (!(var = ni_dbus_dict_get(dict, "destination")) ||
+	    !__ni_objectmodel_get_sockaddr(var, &entry->dst))
+		return FALSE;
+
+	if (!ni_dbus_dict_get_uint32(dict, "vni", &entry->vni))
+		entry->vni = 0;
+	if (!ni_dbus_dict_get_uint16(dict, "port", &entry->port))
+		entry->port = 0;
+	return TRUE;
+}
+
+static dbus_bool_t
+__ni_objectmodel_vxlan_fdb_update(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_bool_t add, DBusError *error)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_vxlan_fdb_array_t fdb = NI_VXLAN_FDB_ARRAY_INIT;
+	ni_vxlan_fdb_entry_t entry;
+	dbus_bool_t result = FALSE;
+	ni_netdev_t *dev;
+	unsigned int i;
+	const char *err;
+	int failed;
+
+	if (!(dev = ni_objectmodel_unwrap_netif(object, error)))
+		return FALSE;
+
+	if (argc != 1 || !ni_dbus_variant_is_dict_array(&argv[0]) || !dev->vxlan)
+		return ni_dbus_error_invalid_args(error, object->path, method->name);
+
+	for (i = 0; i < argv[0].array.len; ++i) {
+		if (!__ni_objectmodel_vxlan_fdb_entry_arg(&argv[0].variant_array_value[i], &entry)) {
+			ni_dbus_error_invalid_args(error, object->path, method->name);
+			goto out;
+		}
+		if ((err = ni_vxlan_fdb_entry_validate(&entry))) {
+			dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
+					"%s: %s", dev->name, err);
+			goto out;
+		}
+		if (!ni_vxlan_fdb_array_append(&fdb, &entry)) {
+			dbus_set_error(error, DBUS_ERROR_NO_MEMORY,
+					"%s: unable to allocate fdb entries", dev->name);
+			goto out;
+		}
+	}
+
+	NI_TRACE_ENTER_ARGS("dev=%s, entries=%u", dev->name, fdb.count);
+	if ((failed = ni_system_vxlan_fdb_update(nc, dev, &fdb, add, NULL)) != 0) {
+		if (failed < 0) {
+			dbus_set_error(error, DBUS_ERROR_FAILED,
+				"%s: unable to %s vxlan fdb entries",
+				dev->name, add ? "add" : "delete");
+		} else {
+			dbus_set_error(error, DBUS_ERROR_FAILED,
+				"%s: unable to %s %d of %u vxlan fdb entries",
+				dev->name, add ? "add" : "delete", failed, fdb.count);
+		}
+		goto out;
+	}
+	result = TRUE;
+
+out:
+	ni_vxlan_fdb_array_destroy(&fdb);
+	return result;
+}
+
+static dbus_bool_t
+ni_objectmodel_vxlan_fdb_add(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	return __ni_objectmodel_vxlan_fdb_update(object, method, argc, argv, TRUE, error);
+}
+
+static dbus_bool_t
+ni_objectmodel_vxlan_fdb_delete(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	return __ni_objectmodel_vxlan_fdb_update(object, method, argc, argv, FALSE, error);
+}
+
 /*
  * Helper function to obtain vxlan interface properties from/into dbus object
  */
@@ -480,11 +662,14 @@ const ni_dbus_property_t	ni_objectmodel_vxlan_property_table[] = {
 static ni_dbus_method_t		ni_objectmodel_vxlan_methods[] = {
 	{ "changeDevice",	"a{sv}",	.handler = ni_objectmodel_vxlan_change },
 	{ "deleteDevice",	"",		.handler = ni_objectmodel_vxlan_delete },
+	{ "addFdbEntries",	"aa{sv}",	.handler = ni_objectmodel_vxlan_fdb_add },
+	{ "deleteFdbEntries",	"aa{sv}",	.handler = ni_objectmodel_vxlan_fdb_delete },
 	{ NULL }
 };
 
 static ni_dbus_method_t		ni_objectmodel_vxlan_factory_methods[] = {
 	{ "newDevice",		"sa{sv}",	.handler = ni_objectmodel_vxlan_newlink },
+	{ "newDevices",		"asaa{sv}",	.handler = ni_objectmodel_vxlan_newlinks },
 
 	{ NULL }
 };
@@ -9,6 +9,7 @@
 
 #include <wicked/util.h>
 #include <wicked/logging.h>
+#include <wicked/time.h>
 #include <wicked/dbus-service.h>
 #include <wicked/dbus-errors.h>
 #include "dbus-server.h"
@@ -16,25 +17,67 @@
 #include "dbus-dict.h"
 #include "debug.h"
 #include "util_priv.h"
+#include "stats.h"
+#include "probes.h"
 
 
 struct ni_dbus_server_object {
 	ni_dbus_server_t *	server;			/* back pointer at server */
+	ni_dbus_variant_t	properties;		/* of the last PropertiesChanged */
 };
 
 static const ni_dbus_class_t	dbus_root_object_class = {
 	.name = "<root>",
 };
 
+typedef struct ni_dbus_server_peer ni_dbus_server_peer_t;
+
 struct ni_dbus_server {
 	ni_dbus_connection_t *	connection;
 	ni_dbus_object_t *	root_object;
+	ni_dbus_deferred_reply_t *deferred;
+
+	ni_dbus_peer_listener_t *listener;
+	ni_dbus_server_peer_t *	peers;
+	const ni_timer_t *	peers_timer;
+	ni_dbus_connection_t *	dispatching;	/* of the call in progress */
+};
+
+/*
+ * A wicked daemon connected directly to us, without the bus daemon.
+ */
+struct ni_dbus_server_peer {
+	ni_dbus_server_peer_t *	next;
+
+	ni_dbus_server_t *	server;
+	ni_dbus_connection_t *	connection;
+};
+
+/*
+ * A method reply, which is sent out when the handler completes it,
+ * e.g. from a timer or event callback, instead of on handler return.
+ */
+struct ni_dbus_deferred_reply {
+	ni_dbus_deferred_reply_t *next;
+
+	ni_dbus_server_t *	server;
+	ni_dbus_connection_t *	connection;	/* to send the reply to */
+	ni_dbus_message_t *	reply;
+	ni_bool_t		dispatched;
+	ni_bool_t		completed;
+	DBusError		error;
 };
 
 static dbus_bool_t		ni_dbus_object_register_object_manager(ni_dbus_object_t *);
 static dbus_bool_t		ni_dbus_object_register_introspectable_interface(ni_dbus_object_t *);
 static const char *		__ni_dbus_server_root_path(const char *);
 static void			__ni_dbus_server_object_init(ni_dbus_object_t *object, ni_dbus_server_t *server);
+static ni_dbus_deferred_reply_t *__ni_dbus_server_deferred_reply_find(ni_dbus_server_t *, const ni_dbus_message_t *);
+static void			__ni_dbus_server_deferred_reply_finish(ni_dbus_deferred_reply_t *);
+static void			__ni_dbus_server_peer_free(ni_dbus_server_peer_t *);
+static int			__ni_dbus_server_send_message(ni_dbus_server_t *, ni_dbus_message_t *);
+static DBusHandlerResult	__ni_dbus_object_dispatch(ni_dbus_connection_t *,
+					ni_dbus_object_t *, DBusMessage *);
 
 /*
  * Constructor for DBus server handle
@@ -71,6 +114,29 @@ ni_dbus_server_free(ni_dbus_server_t *server)
 {
 	NI_TRACE_ENTER();
 
+	if (server->peers_timer)
+		ni_timer_cancel(server->peers_timer);
+	server->peers_timer = NULL;
+
+	ni_dbus_peer_listener_free(server->listener);
+	server->listener = NULL;
+
+	while (server->peers) {
+		ni_dbus_server_peer_t *peer = server->peers;
+
+		server->peers = peer->next;
+		__ni_dbus_server_peer_free(peer);
+	}
+
+	while (server->deferred) {
+		ni_dbus_deferred_reply_t *deferred = server->deferred;
+
+		server->deferred = deferred->next;
+		dbus_message_unref(deferred->reply);
+		dbus_error_free(&deferred->error);
+		free(deferred);
+	}
+
 	if (server->root_object)
 		__ni_dbus_object_free(server->root_object);
 	server->root_object = NULL;
@@ -82,6 +148,136 @@ ni_dbus_server_free(ni_dbus_server_t *server)
 	free(server);
 }
 
+/*
+ * Accept calls of the other wicked daemons on a private socket, in
+ * addition to the bus: they're dispatched to the same objects, but
+ * the messages don't pass the bus daemon. The signals are sent to
+ * the bus and each connected peer.
+ */
+static void
+__ni_dbus_server_peer_free(ni_dbus_server_peer_t *peer)
+{
+	ni_dbus_deferred_reply_t *deferred;
+
+	/* the handler completes them later, but there is no one to reply to */
+	for (deferred = peer->server->deferred; deferred; deferred = deferred->next) {
+		if (deferred->connection == peer->connection)
+			deferred->connection = NULL;
+	}
+
+	ni_dbus_connection_free(peer->connection);
+	free(peer);
+}
+
+static void
+__ni_dbus_server_peers_cleanup(void *user_data, const ni_timer_t *timer)
+{
+	ni_dbus_server_t *server = user_data;
+	ni_dbus_server_peer_t **pos, *peer;
+
+	if (server->peers_timer != timer)
+		return;
+	server->peers_timer = NULL;
+
+	for (pos = &server->peers; (peer = *pos) != NULL; ) {
+		if (ni_dbus_connection_is_disconnected(peer->connection)) {
+			ni_debug_dbus("%s: dbus peer disconnected", __func__);
+			*pos = peer->next;
+			__ni_dbus_server_peer_free(peer);
+		} else {
+			pos = &peer->next;
+		}
+	}
+}
+
+/*
+ * We may be in the middle of a dispatch, so the disconnected peers
+ * are released from the main loop.
+ */
+static void
+__ni_dbus_server_peers_check(ni_dbus_server_t *server)
+{
+	ni_dbus_server_peer_t *peer;
+
+	if (server->peers_timer)
+		return;
+
+	for (peer = server->peers; peer; peer = peer->next) {
+		if (ni_dbus_connection_is_disconnected(peer->connection)) {
+			server->peers_timer = ni_timer_register(0,
+					__ni_dbus_server_peers_cleanup, server);
+			return;
+		}
+	}
+}
+
+static DBusHandlerResult
+__ni_dbus_server_peer_message(DBusConnection *conn, DBusMessage *call, void *user_data)
+{
+	ni_dbus_server_peer_t *peer = user_data;
+	const char *path = dbus_message_get_path(call);
+	ni_dbus_object_t *object;
+
+	if (!path || !ni_dbus_object_get_relative_path(peer->server->root_object, path))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	object = ni_dbus_object_lookup(peer->server->root_object, path);
+	if (!object || ni_dbus_object_get_server(object) != peer->server)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	return __ni_dbus_object_dispatch(peer->connection, object, call);
+}
+
+static void
+__ni_dbus_server_peer_accept(ni_dbus_connection_t *connection, void *user_data)
+{
+	static const DBusObjectPathVTable vtable = {
+		.message_function = __ni_dbus_server_peer_message,
+	};
+	ni_dbus_server_t *server = user_data;
+	ni_dbus_server_peer_t *peer;
+
+	__ni_dbus_server_peers_check(server);
+
+	peer = xcalloc(1, sizeof(*peer));
+	peer->server = server;
+	peer->connection = connection;
+	peer->next = server->peers;
+	server->peers = peer;
+
+	ni_dbus_connection_register_fallback(connection, "/", &vtable, peer);
+}
+
+dbus_bool_t
+ni_dbus_server_listen_peers(ni_dbus_server_t *server, const char *path)
+{
+	if (!server || server->listener)
+		return FALSE;
+
+	server->listener = ni_dbus_peer_listen(path, __ni_dbus_server_peer_accept, server);
+	return server->listener != NULL;
+}
+
+/*
+ * Send a message to the bus and each connected peer
+ */
+static int
+__ni_dbus_server_send_message(ni_dbus_server_t *server, ni_dbus_message_t *msg)
+{
+	ni_dbus_server_peer_t *peer;
+	int rv;
+
+	if ((rv = ni_dbus_connection_send_message(server->connection, msg)) < 0)
+		return rv;
+
+	__ni_dbus_server_peers_check(server);
+	for (peer = server->peers; peer; peer = peer->next) {
+		if (ni_dbus_connection_send_message(peer->connection, msg) < 0)
+			ni_debug_dbus("%s: unable to send message to dbus peer", __func__);
+	}
+	return rv;
+}
+
 /*
  * Retrieve the server's root object
  */
@@ -91,6 +287,123 @@ ni_dbus_server_get_root_object(const ni_dbus_server_t *server)
 	return server->root_object;
 }
 
+/*
+ * Defer the reply of the method call in progress: the handler keeps the
+ * returned handle, returns TRUE and completes the reply later, once e.g.
+ * the kernel finished to apply the request, without to block the main
+ * loop in the meantime. Until then, other calls are dispatched.
+ */
+ni_dbus_deferred_reply_t *
+ni_dbus_server_defer_reply(ni_dbus_object_t *object, ni_dbus_message_t *reply)
+{
+	ni_dbus_server_t *server;
+	ni_dbus_deferred_reply_t *deferred;
+
+	if (!reply || !(server = ni_dbus_object_get_server(object)))
+		return NULL;
+
+	if ((deferred = __ni_dbus_server_deferred_reply_find(server, reply)))
+		return deferred;
+
+	deferred = xcalloc(1, sizeof(*deferred));
+	deferred->server = server;
+	deferred->connection = server->dispatching ? server->dispatching : server->connection;
+	deferred->reply = dbus_message_ref(reply);
+	dbus_error_init(&deferred->error);
+
+	deferred->next = server->deferred;
+	server->deferred = deferred;
+	return deferred;
+}
+
+/*
+ * The reply message of a deferred call, to append the results to.
+ */
+ni_dbus_message_t *
+ni_dbus_deferred_reply_message(const ni_dbus_deferred_reply_t *deferred)
+{
+	return deferred ? deferred->reply : NULL;
+}
+
+/*
+ * Send the deferred reply or, when the error is set, an error reply.
+ */
+void
+ni_dbus_deferred_reply_complete(ni_dbus_deferred_reply_t *deferred, const DBusError *error)
+{
+	if (!deferred || deferred->completed)
+		return;
+
+	deferred->completed = TRUE;
+	if (error && dbus_error_is_set(error))
+		dbus_set_error(&deferred->error, error->name, "%s", error->message);
+
+	/* completed by the handler itself, the dispatcher sends it */
+	if (deferred->dispatched)
+		__ni_dbus_server_deferred_reply_finish(deferred);
+}
+
+static ni_dbus_deferred_reply_t *
+__ni_dbus_server_deferred_reply_find(ni_dbus_server_t *server, const ni_dbus_message_t *reply)
+{
+	ni_dbus_deferred_reply_t *deferred;
+
+	for (deferred = server->deferred; deferred; deferred = deferred->next) {
+		if (deferred->reply == reply)
+			return deferred;
+	}
+	return NULL;
+}
+
+static void
+__ni_dbus_server_deferred_reply_unlink(ni_dbus_deferred_reply_t *deferred)
+{
+	ni_dbus_deferred_reply_t **pos;
+
+	for (pos = &deferred->server->deferred; *pos; pos = &(*pos)->next) {
+		if (*pos == deferred) {
+			*pos = deferred->next;
+			break;
+		}
+	}
+	dbus_message_unref(deferred->reply);
+	dbus_error_free(&deferred->error);
+	free(deferred);
+}
+
+static void
+__ni_dbus_server_deferred_reply_finish(ni_dbus_deferred_reply_t *deferred)
+{
+	ni_dbus_message_t *msg;
+	const char *text;
+
+	if (!dbus_error_is_set(&deferred->error)) {
+		msg = dbus_message_ref(deferred->reply);
+	} else {
+		/* we do not have the call, but the reply addresses the caller */
+		msg = dbus_message_new(DBUS_MESSAGE_TYPE_ERROR);
+		text = deferred->error.message;
+		if (!msg || !dbus_message_set_error_name(msg, deferred->error.name) ||
+		    !dbus_message_set_reply_serial(msg, dbus_message_get_reply_serial(deferred->reply)) ||
+		    !dbus_message_set_destination(msg, dbus_message_get_destination(deferred->reply)) ||
+		    !dbus_message_append_args(msg, DBUS_TYPE_STRING, &text, DBUS_TYPE_INVALID)) {
+			ni_error("unable to create deferred error reply (out of memory)");
+			if (msg)
+				dbus_message_unref(msg);
+			msg = NULL;
+		}
+		ni_stats_inc(NI_STATS_DBUS_ERRORS);
+	}
+
+	if (msg && deferred->connection &&
+	    ni_dbus_connection_send_message(deferred->connection, msg) < 0)
+		ni_error("unable to send deferred reply (out of memory)");
+	if (msg)
+		dbus_message_unref(msg);
+
+	__ni_dbus_server_deferred_reply_unlink(deferred);
+}
+
 /*
  * Turn a dbus object into a server side object
  */
@@ -106,6 +419,7 @@ __ni_dbus_server_object_init(ni_dbus_object_t *object, ni_dbus_server_t *server)
 
 		object->server_object = calloc(1, sizeof(ni_dbus_server_object_t));
 		object->server_object->server = server;
+		ni_dbus_variant_init_dict(&object->server_object->properties);
 
 		if (object->path) {
 			ni_dbus_connection_register_object(server->connection, object);
@@ -154,7 +468,7 @@ ni_dbus_server_send_signal(ni_dbus_server_t *server, ni_dbus_object_t *object,
 	if (nargs && !ni_dbus_message_serialize_variants(msg, nargs, args, &error))
 		goto out;
 
-	if (ni_dbus_connection_send_message(server->connection, msg) < 0)
+	if (__ni_dbus_server_send_message(server, msg) < 0)
 		goto out;
 
 	rv = TRUE;
@@ -166,6 +480,131 @@ out:
 	return rv;
 }
 
+/*
+ * Send a PropertiesChanged signal with the properties of a service
+ * which differ from the ones sent last time.
+ */
+static dbus_bool_t
+__ni_dbus_server_send_properties_delta(ni_dbus_server_t *server, ni_dbus_object_t *object,
+				const ni_dbus_service_t *service,
+				const ni_dbus_variant_t *previous,
+				const ni_dbus_variant_t *current)
+{
+	ni_string_array_t invalidated = NI_STRING_ARRAY_INIT;
+	const ni_dbus_dict_entry_t *entry;
+	const ni_dbus_variant_t *value;
+	DBusMessageIter iter, iter_dict;
+	DBusMessage *msg = NULL;
+	unsigned int i, changed = 0;
+	dbus_bool_t rv = FALSE;
+
+	for (i = 0, entry = current->dict_array_value; i < current->array.len; ++i, ++entry) {
+		value = ni_dbus_dict_get(previous, entry->key);
+		if (!value || !ni_dbus_variant_equal(value, &entry->datum))
+			changed++;
+	}
+	for (i = 0, entry = previous->dict_array_value; i < previous->array.len; ++i, ++entry) {
+		if (!ni_dbus_dict_get(current, entry->key))
+			ni_string_array_append(&invalidated, entry->key);
+	}
+	if (!changed && !invalidated.count)
+		return TRUE;
+
+	ni_debug_dbus("%s: sending %u changed, %u invalidated %s properties",
+			object->path, changed, invalidated.count, service->name);
+
+	msg = dbus_message_new_signal(object->path, NI_DBUS_INTERFACE ".Properties",
+					"PropertiesChanged");
+	if (msg == NULL) {
+		ni_error("%s: unable to build PropertiesChanged() signal message", __func__);
+		goto out;
+	}
+
+	dbus_message_iter_init_append(msg, &iter);
+	if (!dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &service->name))
+		goto out;
+
+	if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_VARIANT_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+					&iter_dict))
+		goto out;
+	for (i = 0, entry = current->dict_array_value; i < current->array.len; ++i, ++entry) {
+		value = ni_dbus_dict_get(previous, entry->key);
+		if (value && ni_dbus_variant_equal(value, &entry->datum))
+			continue;
+		if (!ni_dbus_message_iter_append_dict_entry(&iter_dict, entry))
+			goto out;
+	}
+	if (!dbus_message_iter_close_container(&iter, &iter_dict))
+		goto out;
+
+	if (!ni_dbus_message_iter_append_string_array(&iter, invalidated.data, invalidated.count))
+		goto out;
+
+	if (__ni_dbus_server_send_message(server, msg) < 0)
+		goto out;
+
+	rv = TRUE;
+
+out:
+	if (msg)
+		dbus_message_unref(msg);
+	ni_string_array_destroy(&invalidated);
+	return rv;
+}
+
+/*
+ * Send org.freedesktop.DBus.Properties.PropertiesChanged signals for
+ * the properties of an object which changed since the last call. The
+ * first call for an object only records its current properties.
+ *
+ * This lets clients keep their proxy up to date without fetching all
+ * properties of all services again after every event.
+ */
+dbus_bool_t
+ni_dbus_server_send_properties_changed(ni_dbus_server_t *server, ni_dbus_object_t *object)
+{
+	ni_dbus_variant_t snapshot = NI_DBUS_VARIANT_INIT;
+	ni_dbus_server_object_t *sob;
+	const ni_dbus_service_t *service;
+	DBusError error = DBUS_ERROR_INIT;
+	unsigned int i;
+
+	if (!object || !(sob = object->server_object) || !object->interfaces)
+		return FALSE;
+	if (!server && !(server = sob->server))
+		return FALSE;
+
+	ni_dbus_variant_init_dict(&snapshot);
+	for (i = 0; (service = object->interfaces[i]) != NULL; ++i) {
+		const ni_dbus_variant_t *previous;
+		ni_dbus_variant_t *current;
+
+		if (!service->properties)
+			continue;
+
+		current = ni_dbus_dict_add(&snapshot, service->name);
+		ni_dbus_variant_init_dict(current);
+		if (!ni_dbus_object_get_properties_as_dict(object, service, current, &error)) {
+			ni_debug_dbus("%s: unable to get %s properties: %s", object->path,
+					service->name, error.message);
+			dbus_error_free(&error);
+			ni_dbus_dict_delete_entry(&snapshot, service->name);
+			continue;
+		}
+
+		if ((previous = ni_dbus_dict_get(&sob->properties, service->name)))
+			__ni_dbus_server_send_properties_delta(server, object, service, previous, current);
+	}
+
+	ni_dbus_variant_destroy(&sob->properties);
+	sob->properties = snapshot;
+	return TRUE;
+}
+
 /*
  * When creating an object as a child of a server side object, inherit
  * its server handle.
@@ -189,6 +628,7 @@ __ni_dbus_server_object_destroy(ni_dbus_object_t *object)
 		ni_dbus_connection_unregister_object(server->connection, object);
 
 	if (object->server_object) {
+		ni_dbus_variant_destroy(&object->server_object->properties);
 		free(object->server_object);
 		object->server_object = NULL;
 	}
@@ -278,6 +718,18 @@ __ni_dbus_object_manager_get_managed_objects(ni_dbus_object_t *object,
 	return rv;
 }
 
+/*
+ * Add the interfaces and properties of an object and its descendants
+ * to a dict in the format used by GetManagedObjects, e.g. to return
+ * them in pages.
+ */
+dbus_bool_t
+ni_dbus_object_get_managed_object_dict(ni_dbus_object_t *object, ni_dbus_variant_t *obj_dict,
+		DBusError *error)
+{
+	return __ni_dbus_object_manager_enumerate_object(object, obj_dict, error);
+}
+
 static ni_dbus_method_t	__ni_dbus_object_manager_methods[] = {
 	{ "GetManagedObjects",	NULL,	.handler = __ni_dbus_object_manager_get_managed_objects },
 	{ NULL }
@@ -473,9 +925,15 @@ static ni_dbus_method_t	__ni_dbus_object_properties_methods[] = {
 	{ NULL }
 };
 
+static ni_dbus_method_t	__ni_dbus_object_properties_signals[] = {
+	{ "PropertiesChanged",	"sa{sv}as",	.handler = NULL },
+	{ NULL }
+};
+
 static const ni_dbus_service_t __ni_dbus_object_properties_interface = {
 	.name = NI_DBUS_INTERFACE ".Properties",
 	.methods = __ni_dbus_object_properties_methods,
+	.signals = __ni_dbus_object_properties_signals,
 };
 
 static dbus_bool_t
@@ -567,16 +1025,35 @@ __ni_dbus_object_unregister(DBusConnection *conn, void *user_data)
 
 static DBusHandlerResult
 __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_data)
+{
+	ni_dbus_object_t *object = user_data;
+	ni_dbus_server_t *server;
+
+	if (!(server = ni_dbus_object_get_server(object)))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	return __ni_dbus_object_dispatch(server->connection, object, call);
+}
+
+/*
+ * Dispatch a call received on the bus or a peer connection and send
+ * the reply back to the connection it came from.
+ */
+static DBusHandlerResult
+__ni_dbus_object_dispatch(ni_dbus_connection_t *connection, ni_dbus_object_t *object,
+				DBusMessage *call)
 {
 	const char *interface = dbus_message_get_interface(call);
 	const char *method_name = dbus_message_get_member(call);
-	ni_dbus_object_t *object = user_data;
+	ni_dbus_connection_t *dispatching;
 	const ni_dbus_method_t *method;
 	DBusError error = DBUS_ERROR_INIT;
 	DBusMessage *reply = NULL;
+	ni_dbus_deferred_reply_t *deferred;
 	const ni_dbus_service_t *svc;
 	ni_dbus_server_t *server;
 	dbus_bool_t rv = FALSE;
+	struct timeval started;
 
 	/* Clean out deceased objects */
 	ni_dbus_objects_garbage_collect();
@@ -596,6 +1073,10 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 	}
 
 	server = ni_dbus_object_get_server(object);
+	dispatching = server->dispatching;
+	server->dispatching = connection;
+	ni_timer_get_time(&started);
+	NI_PROBE3(dbus_method_start, interface, method_name, object->path);
 
 	method = ni_dbus_service_get_method(svc, method_name);
 	if (method == NULL
@@ -679,13 +1160,30 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 				ni_dbus_variant_destroy(&argv[argc]);
 		} else
 		if (method->async_handler) {
-			rv = method->async_handler(server->connection, object, method, call);
+			rv = method->async_handler(connection, object, method, call);
 		} else {
 			dbus_set_error(&error, DBUS_ERROR_FAILED, "No server side handler for method");
 			rv = FALSE;
 		}
 	}
 
+	if (reply && (deferred = __ni_dbus_server_deferred_reply_find(server, reply))) {
+		if (!rv) {
+			/* failed anyway, reply with the handler error below */
+			__ni_dbus_server_deferred_reply_unlink(deferred);
+		} else if (deferred->completed) {
+			/* already done by the handler, send it as usual */
+			rv = !dbus_error_is_set(&deferred->error);
+			if (!rv)
+				dbus_set_error(&error, deferred->error.name, "%s", deferred->error.message);
+			__ni_dbus_server_deferred_reply_unlink(deferred);
+		} else {
+			deferred->dispatched = TRUE;
+			dbus_message_unref(reply);
+			reply = NULL;
+		}
+	}
+
 	if (!rv) {
 error_reply:
 		if (reply)
@@ -693,16 +1191,23 @@ error_reply:
 		if (!dbus_error_is_set(&error))
 			dbus_set_error(&error, DBUS_ERROR_FAILED, "Unexpected error in method call");
 		reply = dbus_message_new_error(call, error.name, error.message);
+		ni_stats_inc(NI_STATS_DBUS_ERRORS);
 	}
 
 	/* send reply */
-	if (reply && ni_dbus_connection_send_message(server->connection, reply) < 0)
+	if (reply && ni_dbus_connection_send_message(connection, reply) < 0)
 		ni_error("unable to send reply (out of memory)");
+	server->dispatching = dispatching;
 
 	dbus_error_free(&error);
 	if (reply)
 		dbus_message_unref(reply);
 
+	/* async methods account the dispatch only, not the completion */
+	NI_PROBE3(dbus_method_end, interface, method_name, rv);
+	if (method)
+		ni_stats_dbus_call(svc->name, method->name, method, &started);
+
 	return DBUS_HANDLER_RESULT_HANDLED;
 
 
@@ -738,7 +1243,10 @@ ni_dbus_object_get_caller_uid(const ni_dbus_object_t *object, ni_dbus_message_t
 	if ((server = ni_dbus_object_get_server(object)) == NULL)
 		return -NI_ERROR_INVALID_ARGS;
 
-	return ni_dbus_connection_get_caller_uid(server->connection, dbus_message_get_sender(call), uidp);
+	/* of the call in progress, which may come from a peer connection */
+	return ni_dbus_connection_get_caller_uid(server->dispatching ?
+			server->dispatching : server->connection,
+			dbus_message_get_sender(call), uidp);
 }
 
 /*
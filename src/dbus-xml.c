@@ -52,6 +52,7 @@ static char *		__ni_xs_type_to_dbus_signature(const ni_xs_type_t *, char *, size
 static char *		ni_xs_type_to_dbus_signature(const ni_xs_type_t *);
 static ni_xs_service_t *ni_dbus_xml_get_service_schema(const ni_xs_scope_t *, const char *);
 static ni_xs_type_t *	ni_dbus_xml_get_properties_schema(const ni_xs_scope_t *, const ni_xs_service_t *);
+static void		ni_dbus_xml_precompute_signatures(ni_xs_scope_t *);
 
 static ni_tempstate_t *	__ni_dbus_xml_global_temp_state;
 
@@ -78,6 +79,8 @@ ni_dbus_xml_register_services(ni_xs_scope_t *scope)
 
 	NI_TRACE_ENTER_ARGS("scope=%s", scope->name);
 
+	ni_dbus_xml_precompute_signatures(scope);
+
 	/* First, register any classes defined by the schema */
 	if ((rv = ni_dbus_xml_register_classes(scope)) < 0)
 		return rv;
@@ -195,15 +198,17 @@ ni_dbus_xml_register_methods(ni_xs_service_t *xs_service, ni_xs_method_t *xs_met
 		sigbuf[0] = '\0';
 		for (i = 0; i < xs_method->arguments.count; ++i) {
 			ni_xs_type_t *type = xs_method->arguments.data[i].type;
+			const char *signature = ni_xs_type_to_dbus_signature(type);
 			unsigned int k = strlen(sigbuf);
 
-			if (!__ni_xs_type_to_dbus_signature(type, sigbuf + k, sizeof(sigbuf) - k)) {
+			if (!signature || strlen(signature) >= sizeof(sigbuf) - k) {
 				ni_error("bad definition of service %s method %s: "
 					 "cannot build dbus signature of argument[%u] (%s)",
 					 xs_service->interface, xs_method->name, i,
 					 xs_method->arguments.data[i].name);
 				goto next_method;
 			}
+			strcpy(sigbuf + k, signature);
 		}
 
 		if (method != NULL) {
@@ -1368,6 +1373,11 @@ __ni_xs_type_to_dbus_signature(const ni_xs_type_t *type, char *sigbuf, size_t bu
 		sigbuf[i++] = DBUS_TYPE_ARRAY;
 
 #if 1
+		if (array_info->element_type->signature) {
+			if (strlen(array_info->element_type->signature) >= buflen - i)
+				return NULL;
+			strcpy(sigbuf + i, array_info->element_type->signature);
+		} else
 		if (!__ni_xs_type_to_dbus_signature(array_info->element_type, sigbuf + i, buflen - i))
 			return NULL;
 #else
@@ -1391,12 +1401,87 @@ __ni_xs_type_to_dbus_signature(const ni_xs_type_t *type, char *sigbuf, size_t bu
 	return sigbuf;
 }
 
+/*
+ * The schema types don't change once loaded, so the signature is
+ * computed once and kept with the type.
+ */
 static char *
 ni_xs_type_to_dbus_signature(const ni_xs_type_t *type)
 {
-	static char sigbuf[32];
+	char sigbuf[32];
+
+	if (type->signature)
+		return type->signature;
+
+	if (!__ni_xs_type_to_dbus_signature(type, sigbuf, sizeof(sigbuf)))
+		return NULL;
+
+	ni_string_dup(&((ni_xs_type_t *)type)->signature, sigbuf);
+	return type->signature;
+}
+
+/*
+ * Compute the signatures of all types of a schema scope at load time,
+ * including the anonymous member, element and argument types.
+ */
+static void
+ni_dbus_xml_type_precompute_signature(ni_xs_type_t *type)
+{
+	const ni_xs_name_type_array_t *children = NULL;
+	unsigned int i;
+
+	if (!type || type->signature)
+		return;
+
+	switch (type->class) {
+	case NI_XS_TYPE_ARRAY:
+		ni_dbus_xml_type_precompute_signature(ni_xs_array_info(type)->element_type);
+		break;
+	case NI_XS_TYPE_DICT:
+		children = &ni_xs_dict_info(type)->children;
+		break;
+	case NI_XS_TYPE_STRUCT:
+		children = &ni_xs_struct_info(type)->children;
+		break;
+	case NI_XS_TYPE_UNION:
+		children = &ni_xs_union_info(type)->children;
+		break;
+	default:
+		break;
+	}
+
+	/* set before the members, as types may refer to each other */
+	ni_xs_type_to_dbus_signature(type);
+
+	for (i = 0; children && i < children->count; ++i)
+		ni_dbus_xml_type_precompute_signature(children->data[i].type);
+}
+
+static void
+ni_dbus_xml_precompute_signatures(ni_xs_scope_t *scope)
+{
+	const ni_xs_service_t *service;
+	const ni_xs_method_t *method;
+	ni_xs_scope_t *child;
+	unsigned int i;
+
+	for (i = 0; i < scope->types.count; ++i)
+		ni_dbus_xml_type_precompute_signature(scope->types.data[i].type);
+
+	for (service = scope->services; service; service = service->next) {
+		for (method = service->methods; method; method = method->next) {
+			for (i = 0; i < method->arguments.count; ++i)
+				ni_dbus_xml_type_precompute_signature(method->arguments.data[i].type);
+			ni_dbus_xml_type_precompute_signature(method->retval);
+		}
+		for (method = service->signals; method; method = method->next) {
+			for (i = 0; i < method->arguments.count; ++i)
+				ni_dbus_xml_type_precompute_signature(method->arguments.data[i].type);
+		}
+	}
 
-	return __ni_xs_type_to_dbus_signature(type, sigbuf, sizeof(sigbuf));
+	for (child = scope->children; child; child = child->next)
+		ni_dbus_xml_precompute_signatures(child);
 }
 
 /*
@@ -1822,7 +1907,7 @@ ni_dbus_xml_expand_element_reference(xml_node_t *doc_node, const char *expr_stri
 	if (xml_node_is_empty(doc_node))
 		return 0;
 
-	expression = xpath_expression_parse(expr_string);
+	expression = xpath_expression_get(expr_string);
 	if (expression == NULL)
 		return -NI_ERROR_DOCUMENT_ERROR;
 
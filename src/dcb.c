@@ -241,14 +241,41 @@ ni_dcbx_update_local(ni_dcbx_state_t *dcbx, const ni_dcb_attributes_t *local)
  * This function should return TRUE if the local configuration changed.
  * This tells the LLDP engine to rebuild the PDU on the next transmit
  */
+static ni_bool_t
+ni_dcbx_ets_equal(const ni_dcb_ets_t *a, const ni_dcb_ets_t *b)
+{
+	return a->willing == b->willing &&
+		a->cbs_supported == b->cbs_supported &&
+		a->num_tc_supported == b->num_tc_supported &&
+		!memcmp(a->prio2tc, b->prio2tc, sizeof(a->prio2tc)) &&
+		!memcmp(a->tc_bw, b->tc_bw, sizeof(a->tc_bw)) &&
+		!memcmp(a->tsa, b->tsa, sizeof(a->tsa));
+}
+
+static ni_bool_t
+ni_dcbx_pfc_equal(const ni_dcb_pfc_t *a, const ni_dcb_pfc_t *b)
+{
+	return a->willing == b->willing &&
+		a->mbc == b->mbc &&
+		a->cap == b->cap &&
+		a->enable == b->enable;
+}
+
+/*
+ * Returns TRUE when the operational parameters sent in the LLDP
+ * PDU changed and it has to be rebuilt.
+ */
 ni_bool_t
 ni_dcbx_update_remote(ni_dcbx_state_t *dcbx, const ni_dcb_attributes_t *remote)
 {
+	ni_dcb_ets_t ets = dcbx->ets.oper_param;
+	ni_dcb_pfc_t pfc = dcbx->pfc.oper_param;
+
 	ni_dcbx_recv_ets(dcbx, &remote->ets_recommended);
 	ni_dcbx_recv_pfc(dcbx, &remote->pfc_config);
 
-	/* For now, we tell LLDP to always rebuild the packet */
-	return TRUE;
+	return !ni_dcbx_ets_equal(&ets, &dcbx->ets.oper_param) ||
+		!ni_dcbx_pfc_equal(&pfc, &dcbx->pfc.oper_param);
 }
 
 static inline void
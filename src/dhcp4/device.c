@@ -22,12 +22,14 @@
 #include <wicked/xml.h>
 #include "netinfo_priv.h"
 #include "appconfig.h"
+#include "addrconf.h"
 
 #include "dhcp4/dhcp4.h"
 #include "dhcp4/protocol.h"
 #include "dhcp.h"
 #include "iaid.h"
 #include "duid.h"
+#include "probes.h"
 
 
 static unsigned int	ni_dhcp4_do_bits(const ni_dhcp4_device_t *, unsigned int);
@@ -330,6 +332,7 @@ ni_dhcp4_acquire(ni_dhcp4_device_t *dev, const ni_dhcp4_request_t *info)
 	config->route_priority = info->route_priority;
 	config->route_set_src = info->route_set_src;
 	config->recover_lease = info->recover_lease;
+	config->fast_reboot = ni_dhcp4_config_fast_reboot(dev->ifname);
 	config->release_lease = info->release_lease;
 	config->broadcast = info->broadcast;
 
@@ -402,6 +405,7 @@ ni_dhcp4_acquire(ni_dhcp4_device_t *dev, const ni_dhcp4_request_t *info)
 		ni_trace("  uuid            %s", ni_uuid_print(&config->uuid));
 		ni_trace("  update-flags    %s", ni_dhcp4_print_doflags(config->doflags));
 		ni_trace("  recover_lease   %s", config->recover_lease ? "true" : "false");
+		ni_trace("  fast_reboot     %s", config->fast_reboot ? "true" : "false");
 		ni_trace("  release_lease   %s", config->release_lease ? "true" : "false");
 	}
 	ni_dhcp4_config_set_request_options(dev->ifname, &config->request_options, &info->request_options);
@@ -429,15 +433,22 @@ ni_dhcp4_acquire(ni_dhcp4_device_t *dev, const ni_dhcp4_request_t *info)
  * For now, we go through a full discover/request cycle. If this proves
  * a too coarse approach, we should probably store the current leases
  * in the state file as well, and just do a renew/rebind.
+ *
+ * On a handover from the initrd, a still valid lease with the address
+ * on the device is taken over in bound state without any request.
  */
 void
-ni_dhcp4_restart_leases(void)
+ni_dhcp4_restart_leases(ni_bool_t handover)
 {
 	ni_dhcp4_device_t *dev;
 
 	for (dev = ni_dhcp4_active; dev; dev = dev->next) {
-		if (dev->request)
-			ni_dhcp4_acquire(dev, dev->request);
+		if (!dev->request)
+			continue;
+
+		if (ni_dhcp4_acquire(dev, dev->request) > 0 && handover &&
+		    dev->fsm.state == NI_DHCP4_STATE_REBOOT)
+			dev->dhcp4.handover = 1;
 	}
 }
 
@@ -684,9 +695,10 @@ ni_dhcp4_device_start(ni_dhcp4_device_t *dev)
 		return -1;
 	}
 
+	/* spread the starts of many devices at the configured rate */
 	sec = ni_dhcp4_fsm_start_delay(dev->config->start_delay);
-	ni_dhcp4_timer_arm(&dev->timer.delay, NI_TIMEOUT_FROM_SEC(sec),
-			ni_dhcp4_device_start_delayed, dev);
+	ni_dhcp4_timer_arm(&dev->timer.delay, NI_TIMEOUT_FROM_SEC(sec) +
+			ni_addrconf_start_slot(), ni_dhcp4_device_start_delayed, dev);
 
 	ni_dhcp4_defer_timer_arm(dev);
 	ni_dhcp4_acquire_timer_arm(dev);
@@ -736,6 +748,24 @@ ni_dhcp4_device_prepare_message(void *data)
 	ni_debug_dhcp("%s: sending %s with xid 0x%x in state %s",
 			dev->ifname, ni_dhcp4_message_name(dev->transmit.msg_code),
 			dev->dhcp4.xid, ni_dhcp4_fsm_state_name(dev->fsm.state));
+	NI_PROBE3(dhcp4_tx, dev->ifname, dev->transmit.msg_code, dev->dhcp4.xid);
+	return 0;
+}
+
+static int
+ni_dhcp4_device_update_message(void *data)
+{
+	ni_dhcp4_device_t *dev = data;
+
+	/* Rebuild when there is no message to retransmit */
+	if (!ni_buffer_count(&dev->message) ||
+	    ni_dhcp4_update_message(dev, &dev->message) < 0)
+		return ni_dhcp4_device_prepare_message(dev);
+
+	ni_debug_dhcp("%s: resending %s with xid 0x%x in state %s",
+			dev->ifname, ni_dhcp4_message_name(dev->transmit.msg_code),
+			dev->dhcp4.xid, ni_dhcp4_fsm_state_name(dev->fsm.state));
+	NI_PROBE3(dhcp4_tx, dev->ifname, dev->transmit.msg_code, dev->dhcp4.xid);
 	return 0;
 }
 
@@ -764,7 +794,7 @@ ni_dhcp4_device_send_message_broadcast(ni_dhcp4_device_t *dev, unsigned int msg_
 	case DHCP4_DISCOVER:
 	case DHCP4_REQUEST:
 	case DHCP4_INFORM:
-		dev->transmit.params.timeout_callback = ni_dhcp4_device_prepare_message;
+		dev->transmit.params.timeout_callback = ni_dhcp4_device_update_message;
 		dev->transmit.params.timeout_data = dev;
 		rv = ni_capture_send(dev->capture, &dev->message, &dev->transmit.params);
 		break;
@@ -1067,6 +1097,14 @@ ni_dhcp4_config_max_lease_time(const char *ifname)
 	return dhconf && dhconf->lease_time ? dhconf->lease_time : NI_SECONDS_INFINITE;
 }
 
+ni_bool_t
+ni_dhcp4_config_fast_reboot(const char *ifname)
+{
+	const ni_config_dhcp4_t *dhconf = ni_config_dhcp4_find_device(ifname);
+
+	return dhconf ? dhconf->fast_reboot : FALSE;
+}
+
 static void
 ni_dhcp4_config_set_request_options(const char *ifname, ni_uint_array_t *cfg, const ni_string_array_t *req)
 {
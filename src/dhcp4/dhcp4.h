@@ -78,6 +78,9 @@ struct ni_dhcp4_device {
 	    uint32_t		xid;
 	    unsigned int	nak_backoff;	/* backoff timer when we get NAKs */
 	    unsigned int	accept_any_offer : 1;
+	    unsigned int	fast_reboot : 1;	/* cached lease applied unconfirmed */
+	    unsigned int	handover : 1;		/* take over the initrd lease	*/
+	    unsigned int	renew_slot : 1;		/* renewal rate slot reserved	*/
 	} dhcp4;
 
 	ni_buffer_t		message;
@@ -223,6 +226,7 @@ struct ni_dhcp4_config {
 	unsigned int		max_lease_time;
 	ni_bool_t		recover_lease;
 	ni_bool_t		release_lease;
+	ni_bool_t		fast_reboot;
 };
 
 enum ni_dhcp4_event {
@@ -243,7 +247,7 @@ extern void		ni_dhcp4_set_event_handler(ni_dhcp4_event_handler_t);
 
 extern int		ni_dhcp4_acquire(ni_dhcp4_device_t *, const ni_dhcp4_request_t *);
 extern int		ni_dhcp4_drop(ni_dhcp4_device_t *, const ni_dhcp4_drop_request_t *);
-extern void		ni_dhcp4_restart_leases(void);
+extern void		ni_dhcp4_restart_leases(ni_bool_t);
 
 extern const char *	ni_dhcp4_fsm_state_name(enum fsm_state);
 extern unsigned int	ni_dhcp4_fsm_start_delay(unsigned int);
@@ -253,6 +257,7 @@ extern int		ni_dhcp4_fsm_commit_lease(ni_dhcp4_device_t *, ni_addrconf_lease_t *
 extern int		ni_dhcp4_recover_lease(ni_dhcp4_device_t *);
 extern int		ni_dhcp4_build_message(const ni_dhcp4_device_t *,
 				unsigned int, const ni_addrconf_lease_t *, ni_buffer_t *);
+extern int		ni_dhcp4_update_message(const ni_dhcp4_device_t *, ni_buffer_t *);
 extern void		ni_dhcp4_fsm_link_up(ni_dhcp4_device_t *);
 extern void		ni_dhcp4_fsm_link_down(ni_dhcp4_device_t *);
 
@@ -310,6 +315,7 @@ extern int		ni_dhcp4_config_have_server_preference(void);
 extern int		ni_dhcp4_config_server_preference_ipaddr(struct in_addr);
 extern int		ni_dhcp4_config_server_preference_hwaddr(const ni_hwaddr_t *);
 extern unsigned int	ni_dhcp4_config_max_lease_time(const char *);
+extern ni_bool_t	ni_dhcp4_config_fast_reboot(const char *);
 extern void		ni_dhcp4_config_free(ni_dhcp4_config_t *);
 
 extern ni_dhcp4_request_t *ni_dhcp4_request_new(void);
@@ -23,9 +23,11 @@
 #include <netlink/netlink.h>
 #include "netinfo_priv.h"
 #include "buffer.h"
+#include "addrconf.h"
 
 #include "dhcp4/dhcp4.h"
 #include "dhcp4/protocol.h"
+#include "probes.h"
 
 
 static ni_bool_t		ni_dhcp4_address_on_link(ni_dhcp4_device_t *, struct in_addr);
@@ -192,6 +194,7 @@ ni_dhcp4_fsm_process_dhcp4_packet(ni_dhcp4_device_t *dev, ni_buffer_t *msgbuf, n
 	}
 	ni_string_dup(&lease->dhcp4.sender_hwa, sender);
 	sender = lease->dhcp4.sender_hwa;
+	NI_PROBE3(dhcp4_rx, dev->ifname, msg_code, dev->dhcp4.xid);
 
 	/*
 	 * The lease lifetime starts at the original request send time.
@@ -426,6 +429,9 @@ ni_dhcp4_fsm_restart(ni_dhcp4_device_t *dev)
 	ni_dhcp4_timer_disarm(&dev->fsm.timer);
 
 	dev->dhcp4.xid = 0;
+	dev->dhcp4.fast_reboot = 0;
+	dev->dhcp4.handover = 0;
+	dev->dhcp4.renew_slot = 0;
 
 	ni_dhcp4_device_drop_lease(dev);
 }
@@ -579,6 +585,36 @@ ni_dhcp4_fsm_renewal_retransmit(ni_dhcp4_device_t *dev)
 	return TRUE;
 }
 
+/*
+ * Defer the renewal to the next free slot of the renew-rate,
+ * as long as the slot is before the rebind time (T2).
+ */
+static ni_bool_t
+ni_dhcp4_fsm_renewal_defer(ni_dhcp4_device_t *dev)
+{
+	unsigned int rebind_time;
+	ni_timeout_t delay;
+
+	if (dev->dhcp4.renew_slot) {
+		dev->dhcp4.renew_slot = 0;
+		return FALSE;
+	}
+
+	if (!(delay = ni_addrconf_renew_slot()))
+		return FALSE;
+
+	rebind_time = ni_dhcp4_lease_rebind_time(dev->lease, NULL);
+	if (rebind_time == NI_LIFETIME_EXPIRED ||
+	    NI_TIMEOUT_FROM_SEC(rebind_time) <= delay)
+		return FALSE;
+
+	ni_debug_dhcp("%s: deferring lease renewal by %u.%03u sec", dev->ifname,
+			NI_TIMEOUT_SEC(delay), NI_TIMEOUT_MSEC(delay));
+	dev->dhcp4.renew_slot = 1;
+	ni_dhcp4_fsm_set_timeout_msec(dev, delay);
+	return TRUE;
+}
+
 static ni_bool_t
 ni_dhcp4_fsm_renewal_init(ni_dhcp4_device_t *dev)
 {
@@ -770,6 +806,69 @@ ni_dhcp4_fsm_reboot_dad_validate(ni_dhcp4_device_t *dev)
 	return TRUE;
 }
 
+/*
+ * Apply the recovered lease before it has been confirmed, with its
+ * addresses marked tentative to verify them while they are set up.
+ */
+static ni_bool_t
+ni_dhcp4_fsm_fast_reboot(ni_dhcp4_device_t *dev)
+{
+	if (!dev->config->fast_reboot || dev->config->dry_run != NI_DHCP4_RUN_NORMAL)
+		return FALSE;
+
+	if (dev->dhcp4.fast_reboot)
+		return TRUE;
+
+	ni_info("%s: Applying recovered DHCPv4 lease with address %s",
+			dev->ifname, inet_ntoa(dev->lease->dhcp4.address));
+
+	if (dev->config->doflags & DHCP4_DO_ARP)
+		ni_addrconf_lease_addrs_set_tentative(dev->lease, TRUE);
+	ni_dhcp4_send_event(NI_DHCP4_EVENT_ACQUIRED, dev, dev->lease);
+	ni_addrconf_lease_addrs_set_tentative(dev->lease, FALSE);
+
+	dev->dhcp4.fast_reboot = 1;
+	dev->link.reconnect = FALSE;
+	return TRUE;
+}
+
+static void
+ni_dhcp4_fsm_fast_reboot_lost(ni_dhcp4_device_t *dev)
+{
+	if (!dev->dhcp4.fast_reboot)
+		return;
+
+	dev->dhcp4.fast_reboot = 0;
+	if (dev->lease) {
+		ni_addrconf_lease_file_remove(dev->ifname,
+				dev->lease->type, dev->lease->family);
+	}
+	ni_dhcp4_send_event(NI_DHCP4_EVENT_LOST, dev, NULL);
+}
+
+/*
+ * Continue with the lease the initrd instance has been bound to: the
+ * renewal is scheduled from the lease acquire time as if we didn't
+ * restart at all.
+ */
+static ni_bool_t
+ni_dhcp4_fsm_handover(ni_dhcp4_device_t *dev)
+{
+	if (!dev->dhcp4.handover)
+		return FALSE;
+
+	dev->dhcp4.handover = 0;
+	if (dev->config->dry_run != NI_DHCP4_RUN_NORMAL ||
+	    !ni_dhcp4_address_on_link(dev, dev->lease->dhcp4.address))
+		return FALSE;
+
+	ni_info("%s: Taking over DHCPv4 lease with address %s from initrd",
+			dev->ifname, inet_ntoa(dev->lease->dhcp4.address));
+
+	ni_dhcp4_fsm_commit_lease(dev, dev->lease);
+	return TRUE;
+}
+
 static ni_bool_t
 ni_dhcp4_fsm_reboot(ni_dhcp4_device_t *dev)
 {
@@ -791,6 +890,14 @@ ni_dhcp4_fsm_reboot(ni_dhcp4_device_t *dev)
 	if (lft == NI_LIFETIME_EXPIRED)
 		return FALSE;
 
+	/* the lease applied in the initrd is still valid and in use */
+	if (ni_dhcp4_fsm_handover(dev))
+		return TRUE;
+
+	/* the addresses are verified while applying the lease */
+	if (ni_dhcp4_fsm_fast_reboot(dev))
+		return ni_dhcp4_fsm_reboot_request(dev);
+
 	if (dev->link.reconnect && ni_dhcp4_fsm_reboot_dad_validate(dev))
 		return TRUE;
 
@@ -935,6 +1042,9 @@ ni_dhcp4_fsm_timeout(ni_dhcp4_device_t *dev)
 		break;
 
 	case NI_DHCP4_STATE_BOUND:
+		if (ni_dhcp4_fsm_renewal_defer(dev))
+			return;
+
 		if (ni_dhcp4_fsm_renewal_init(dev))
 			return;
 
@@ -979,6 +1089,7 @@ ni_dhcp4_fsm_timeout(ni_dhcp4_device_t *dev)
 				ni_dhcp4_fsm_commit_lease(dev, dev->lease);
 			break;
 		}
+		ni_dhcp4_fsm_fast_reboot_lost(dev);
 		ni_dhcp4_fsm_restart(dev);
 		ni_dhcp4_fsm_set_timeout_sec(dev, ni_dhcp4_fsm_start_delay(conf->start_delay));
 		break;
@@ -1238,6 +1349,7 @@ ni_dhcp4_fsm_commit_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 		if (dev->config->dry_run == NI_DHCP4_RUN_NORMAL) {
 			if (renewal_time != NI_LIFETIME_EXPIRED &&
 			    renewal_time != NI_LIFETIME_INFINITE) {
+				renewal_time = ni_addrconf_renew_align(renewal_time);
 				ni_debug_dhcp("%s: schedule lease renewal in %u seconds",
 						dev->ifname, renewal_time);
 				ni_dhcp4_fsm_set_timeout_sec(dev, renewal_time);
@@ -1280,6 +1392,8 @@ ni_dhcp4_fsm_commit_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 		ni_dhcp4_device_set_lease(dev, lease);
 		dev->fsm.state = NI_DHCP4_STATE_BOUND;
 		dev->link.reconnect = FALSE;
+		dev->dhcp4.fast_reboot = 0;
+		dev->dhcp4.renew_slot = 0;
 
 		ni_stringbuf_printf(&buf, "%s", ni_sprint_timeout(lease_time));
 		if (renewal_time != NI_LIFETIME_INFINITE)
@@ -1679,6 +1793,7 @@ ni_dhcp4_process_nak(ni_dhcp4_device_t *dev)
 	case NI_DHCP4_STATE_REBINDING:
 	case NI_DHCP4_STATE_REBOOT:
 		/* FIXME: how do we handle a NAK response to an INFORM? */
+		ni_dhcp4_fsm_fast_reboot_lost(dev);
 		ni_dhcp4_device_drop_lease(dev);
 		break;
 	case NI_DHCP4_STATE_DOWN:
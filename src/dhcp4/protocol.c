@@ -22,7 +22,9 @@
 #include "dhcp.h"
 #include "buffer.h"
 #include "socket_priv.h"
+#include "appconfig.h"
 
+#include <stddef.h>
 #include <limits.h>
 #include <errno.h>
 
@@ -96,6 +98,9 @@ ni_dhcp4_socket_open(ni_dhcp4_device_t *dev)
 	prot_info.eth_protocol = ETHERTYPE_IP;
 	prot_info.ip_protocol = IPPROTO_UDP;
 	prot_info.ip_port = DHCP4_CLIENT_PORT;
+	prot_info.rx_ring = ni_config_socket_packet_ring();
+	prot_info.shared = ni_config_socket_shared_capture();
+	prot_info.fanout = ni_config_socket_shared_capture_fanout();
 
 	if ((capture = dev->capture) != NULL) {
 		if (ni_capture_is_valid(capture, ETHERTYPE_IP))
@@ -1347,6 +1352,139 @@ failed:
 	return -1;
 }
 
+/*
+ * Update a message built by ni_dhcp4_build_message for a retransmit.
+ *
+ * The options do not change while a message is retransmitted in the
+ * same state with the same xid, so we patch the secs elapsed in the
+ * header and the udp checksum only instead to rebuild the message.
+ */
+int
+ni_dhcp4_update_message(const ni_dhcp4_device_t *dev, ni_buffer_t *msgbuf)
+{
+	int renew = dev->fsm.state == NI_DHCP4_STATE_RENEWING &&
+			dev->transmit.msg_code == DHCP4_REQUEST;
+	ni_dhcp4_message_t *message;
+	uint16_t secs;
+
+	secs = htons(ni_dhcp4_device_uptime(dev, 0xFFFF));
+	if (renew) {
+		if (ni_buffer_count(msgbuf) < sizeof(*message))
+			return -1;
+
+		message = ni_buffer_head(msgbuf);
+		message->secs = secs;
+	} else
+	if (ni_capture_patch_udp_payload16(msgbuf,
+			offsetof(ni_dhcp4_message_t, secs), secs) < 0)
+		return -1;
+
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
+			"%s: xid: 0x%x, secs: %u", dev->ifname,
+			dev->dhcp4.xid, ntohs(secs));
+	return 0;
+}
+
+/*
+ * Server side of the protocol, used by the test server only:
+ * parse client messages and build offer/ack/nak replies.
+ */
+int
+ni_dhcp4_parse_client_message(ni_buffer_t *msgbuf, ni_dhcp4_client_message_t *info)
+{
+	const ni_dhcp4_message_t *message;
+	ni_buffer_t optbuf;
+	int option;
+
+	memset(info, 0, sizeof(*info));
+	if (!(message = ni_buffer_pull_head(msgbuf, sizeof(*message))))
+		return -1;
+
+	if (message->op != DHCP4_BOOTREQUEST || message->cookie != htonl(MAGIC_COOKIE))
+		return -1;
+
+	info->header = message;
+	while (ni_buffer_count(msgbuf) && !msgbuf->underflow) {
+		option = ni_dhcp4_option_next(msgbuf, &optbuf);
+		if (option == DHCP4_END || option < 0)
+			break;
+
+		switch (option) {
+		case DHCP4_MESSAGETYPE:
+			if ((option = ni_buffer_getc(&optbuf)) == EOF)
+				return -1;
+			info->type = option;
+			break;
+
+		case DHCP4_ADDRESS:
+			if (ni_dhcp4_option_get_ipv4(&optbuf, &info->requested) < 0)
+				return -1;
+			break;
+
+		case DHCP4_SERVERIDENTIFIER:
+			if (ni_dhcp4_option_get_ipv4(&optbuf, &info->server_id) < 0)
+				return -1;
+			break;
+
+		case DHCP4_CLIENTID:
+			if (ni_dhcp4_option_get_opaque(&optbuf, &info->client_id) < 0)
+				return -1;
+			break;
+
+		default:
+			break;
+		}
+	}
+	return info->type ? 0 : -1;
+}
+
+int
+ni_dhcp4_build_server_reply(const ni_dhcp4_client_message_t *info,
+			const ni_dhcp4_server_reply_t *reply, ni_buffer_t *msgbuf)
+{
+	ni_dhcp4_message_t *message;
+
+	if (!info || !info->header || !reply)
+		return -1;
+
+	if (!(message = ni_buffer_push_tail(msgbuf, sizeof(*message))))
+		return -1;
+
+	memset(message, 0, sizeof(*message));
+	message->op = DHCP4_BOOTREPLY;
+	message->hwtype = info->header->hwtype;
+	message->hwlen = info->header->hwlen;
+	message->xid = info->header->xid;
+	message->flags = info->header->flags;
+	message->giaddr = info->header->giaddr;
+	memcpy(message->chaddr, info->header->chaddr, sizeof(message->chaddr));
+	message->cookie = htonl(MAGIC_COOKIE);
+
+	ni_dhcp4_option_put8(msgbuf, DHCP4_MESSAGETYPE, reply->type);
+	ni_dhcp4_option_put_ipv4(msgbuf, DHCP4_SERVERIDENTIFIER, reply->server_id);
+	if (info->client_id.len)
+		ni_dhcp4_option_put(msgbuf, DHCP4_CLIENTID,
+				info->client_id.data, info->client_id.len);
+
+	if (reply->type != DHCP4_NAK) {
+		message->yiaddr = reply->address.s_addr;
+		message->siaddr = reply->server_id.s_addr;
+
+		ni_dhcp4_option_put32(msgbuf, DHCP4_LEASETIME, reply->lease_time);
+		ni_dhcp4_option_put32(msgbuf, DHCP4_RENEWALTIME, reply->lease_time / 2);
+		ni_dhcp4_option_put32(msgbuf, DHCP4_REBINDTIME, (reply->lease_time / 8) * 7);
+		ni_dhcp4_option_put_ipv4(msgbuf, DHCP4_NETMASK, reply->netmask);
+		if (reply->router.s_addr)
+			ni_dhcp4_option_put_ipv4(msgbuf, DHCP4_ROUTERS, reply->router);
+	}
+
+	ni_buffer_putc(msgbuf, DHCP4_END);
+#ifdef BOOTP_MESSAGE_LENGTH_MIN
+	ni_buffer_pad(msgbuf, BOOTP_MESSAGE_LENGTH_MIN, DHCP4_PAD);
+#endif
+	return msgbuf->overflow ? -1 : 0;
+}
+
 /*
  * Decode an RFC3397 DNS search order option.
  */
@@ -1896,6 +2034,328 @@ ni_dhcp4_apply_routes(ni_addrconf_lease_t *lease, ni_route_array_t *routes)
 	ni_route_array_destroy(&temp);
 }
 
+/*
+ * Table driven decoding of the DHCP4 options in a response.
+ *
+ * Each known option has a codec descriptor with the value type, the
+ * length constraints and the destination, either a field in the lease
+ * or in the parse state collecting the data which is applied to the
+ * lease after all options were decoded. Options needing more logic
+ * use a decode function instead of a destination.
+ */
+typedef struct ni_dhcp4_parse_state {
+	const ni_dhcp4_config_t *config;
+	ni_addrconf_lease_t *	lease;
+
+	ni_route_array_t	default_routes;
+	ni_route_array_t	static_routes;
+	ni_route_array_t	classless_routes;
+	ni_string_array_t	dns_servers;
+	ni_string_array_t	dns_search;
+	ni_string_array_t	dns_domain;
+	ni_string_array_t	nis_servers;
+	char *			nisdomain;
+} ni_dhcp4_parse_state_t;
+
+typedef enum {
+	NI_DHCP4_CODEC_NONE = 0,
+	NI_DHCP4_CODEC_IPV4,		/* struct in_addr			*/
+	NI_DHCP4_CODEC_UINT16,		/* uint16_t in host byte order		*/
+	NI_DHCP4_CODEC_UINT32,		/* uint32_t in host byte order		*/
+	NI_DHCP4_CODEC_OPAQUE,		/* ni_opaque_t				*/
+	NI_DHCP4_CODEC_DOMAIN,		/* char *, checked domain name		*/
+	NI_DHCP4_CODEC_DOMAIN_LIST,	/* ni_string_array_t, domain names	*/
+	NI_DHCP4_CODEC_PRINTABLE,	/* char *, printable string		*/
+	NI_DHCP4_CODEC_PATHNAME,	/* char *, checked path name		*/
+	NI_DHCP4_CODEC_ADDR_LIST,	/* ni_string_array_t, ipv4 addresses	*/
+	NI_DHCP4_CODEC_FUNC,		/* decode function			*/
+} ni_dhcp4_codec_type_t;
+
+typedef enum {
+	NI_DHCP4_CODEC_LEASE = 0,
+	NI_DHCP4_CODEC_STATE,
+} ni_dhcp4_codec_base_t;
+
+typedef struct ni_dhcp4_option_codec {
+	unsigned char		type;
+	unsigned char		base;
+	unsigned char		minlen;
+	unsigned char		multiple;
+	unsigned short		offset;
+	const char *		what;
+	int			(*decode)(ni_buffer_t *, ni_dhcp4_parse_state_t *);
+} ni_dhcp4_option_codec_t;
+
+#define NI_DHCP4_CODEC(t, b, min, mul, st, field, name)			\
+	{ .type = t, .base = b, .minlen = min, .multiple = mul,		\
+	  .offset = offsetof(st, field), .what = name }
+#define NI_DHCP4_LEASE(t, min, mul, field, name)			\
+	NI_DHCP4_CODEC(t, NI_DHCP4_CODEC_LEASE, min, mul, ni_addrconf_lease_t, field, name)
+#define NI_DHCP4_STATE(t, min, mul, field, name)			\
+	NI_DHCP4_CODEC(t, NI_DHCP4_CODEC_STATE, min, mul, ni_dhcp4_parse_state_t, field, name)
+#define NI_DHCP4_FUNC(fn)						\
+	{ .type = NI_DHCP4_CODEC_FUNC, .decode = fn }
+
+static int
+ni_dhcp4_codec_decode_mtu(ni_buffer_t *bp, ni_dhcp4_parse_state_t *state)
+{
+	ni_addrconf_lease_t *lease = state->lease;
+
+	if (ni_dhcp4_option_get16(bp, &lease->dhcp4.mtu) < 0)
+		return -1;
+
+	/* Minimum legal mtu is 68 accoridng to
+	 * RFC 2132. In practise it's 576 which is the
+	 * minimum maximum message size. */
+	if (lease->dhcp4.mtu <= MTU_MIN) {
+		ni_debug_dhcp("MTU %u is too low, minimum is %d; ignoring",
+				lease->dhcp4.mtu, MTU_MIN);
+		lease->dhcp4.mtu = 0;
+	}
+	return 0;
+}
+
+static int
+ni_dhcp4_codec_decode_fqdn(ni_buffer_t *bp, ni_dhcp4_parse_state_t *state)
+{
+	return ni_dhcp4_option_get_fqdn(bp, &state->lease->hostname, &state->lease->fqdn);
+}
+
+static int
+ni_dhcp4_codec_decode_hostname(ni_buffer_t *bp, ni_dhcp4_parse_state_t *state)
+{
+	if (state->lease->fqdn.enabled == NI_TRISTATE_ENABLE) {
+		ni_buffer_clear(bp);
+		return 0;
+	}
+	return ni_dhcp4_option_get_domain(bp, &state->lease->hostname, "hostname");
+}
+
+static int
+ni_dhcp4_codec_decode_netbios_type(ni_buffer_t *bp, ni_dhcp4_parse_state_t *state)
+{
+	return ni_dhcp4_option_get_netbios_type(bp, &state->lease->netbios_type);
+}
+
+static int
+ni_dhcp4_codec_decode_dnssearch(ni_buffer_t *bp, ni_dhcp4_parse_state_t *state)
+{
+	return ni_dhcp4_decode_dnssearch(bp, &state->dns_search, "dns-search domain");
+}
+
+static int
+ni_dhcp4_codec_decode_nds_context(ni_buffer_t *bp, ni_dhcp4_parse_state_t *state)
+{
+	char *tmp = NULL;
+	int ret;
+
+	if (!(ret = ni_dhcp4_option_get_printable(bp, &tmp, "nds-context")))
+		ni_string_array_append(&state->lease->nds_context, tmp);
+	ni_string_free(&tmp);
+	return ret;
+}
+
+static int
+ni_dhcp4_codec_decode_csr(ni_buffer_t *bp, ni_dhcp4_parse_state_t *state)
+{
+	ni_route_array_destroy(&state->classless_routes);
+	return ni_dhcp4_decode_csr(bp, &state->classless_routes);
+}
+
+static int
+ni_dhcp4_codec_decode_sipservers(ni_buffer_t *bp, ni_dhcp4_parse_state_t *state)
+{
+	return ni_dhcp4_decode_sipservers(bp, &state->lease->sip_servers);
+}
+
+static int
+ni_dhcp4_codec_decode_static_routes(ni_buffer_t *bp, ni_dhcp4_parse_state_t *state)
+{
+	ni_route_array_destroy(&state->static_routes);
+	return ni_dhcp4_decode_static_routes(bp, &state->static_routes);
+}
+
+static int
+ni_dhcp4_codec_decode_routers(ni_buffer_t *bp, ni_dhcp4_parse_state_t *state)
+{
+	ni_route_array_destroy(&state->default_routes);
+	return ni_dhcp4_decode_routers(bp, &state->default_routes);
+}
+
+static const ni_dhcp4_option_codec_t	ni_dhcp4_option_codecs[256] = {
+ [DHCP4_ADDRESS]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_IPV4,        4, 0, dhcp4.address,        NULL),
+ [DHCP4_NETMASK]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_IPV4,        4, 0, dhcp4.netmask,        NULL),
+ [DHCP4_BROADCAST]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_IPV4,        4, 0, dhcp4.broadcast,      NULL),
+ [DHCP4_SERVERIDENTIFIER]	= NI_DHCP4_LEASE(NI_DHCP4_CODEC_IPV4,        4, 0, dhcp4.server_id,      NULL),
+ [DHCP4_CLIENTID]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_OPAQUE,      1, 0, dhcp4.client_id,      NULL),
+ [DHCP4_LEASETIME]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_UINT32,      4, 0, dhcp4.lease_time,     NULL),
+ [DHCP4_RENEWALTIME]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_UINT32,      4, 0, dhcp4.renewal_time,   NULL),
+ [DHCP4_REBINDTIME]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_UINT32,      4, 0, dhcp4.rebind_time,    NULL),
+ [DHCP4_MTU]			= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_mtu),
+ [DHCP4_FQDN]			= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_fqdn),
+ [DHCP4_HOSTNAME]		= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_hostname),
+ [DHCP4_DNSDOMAIN]		= NI_DHCP4_STATE(NI_DHCP4_CODEC_DOMAIN_LIST, 1, 0, dns_domain,           "dns-domain"),
+ [DHCP4_MESSAGE]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_PRINTABLE,   1, 0, dhcp4.message,        "dhcp4-message"),
+ [DHCP4_ROOTPATH]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_PATHNAME,    1, 0, dhcp4.root_path,      "root-path"),
+ [DHCP4_NISDOMAIN]		= NI_DHCP4_STATE(NI_DHCP4_CODEC_DOMAIN,      1, 0, nisdomain,            "nis-domain"),
+ [DHCP4_NETBIOSNODETYPE]	= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_netbios_type),
+ [DHCP4_NETBIOSSCOPE]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_DOMAIN,      1, 0, netbios_scope,        "netbios-scope"),
+ [DHCP4_DNSSERVER]		= NI_DHCP4_STATE(NI_DHCP4_CODEC_ADDR_LIST,   4, 4, dns_servers,          NULL),
+ [DHCP4_NTPSERVER]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_ADDR_LIST,   4, 4, ntp_servers,          NULL),
+ [DHCP4_NISSERVER]		= NI_DHCP4_STATE(NI_DHCP4_CODEC_ADDR_LIST,   4, 4, nis_servers,          NULL),
+ [DHCP4_LPRSERVER]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_ADDR_LIST,   4, 4, lpr_servers,          NULL),
+ [DHCP4_LOGSERVER]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_ADDR_LIST,   4, 4, log_servers,          NULL),
+ [DHCP4_NETBIOSNAMESERVER]	= NI_DHCP4_LEASE(NI_DHCP4_CODEC_ADDR_LIST,   4, 4, netbios_name_servers, NULL),
+ [DHCP4_NETBIOSDDSERVER]	= NI_DHCP4_LEASE(NI_DHCP4_CODEC_ADDR_LIST,   4, 4, netbios_dd_servers,   NULL),
+ [DHCP4_DNSSEARCH]		= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_dnssearch),
+ [DHCP4_NDS_SERVER]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_ADDR_LIST,   4, 4, nds_servers,          NULL),
+ [DHCP4_NDS_CTX]		= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_nds_context),
+ [DHCP4_NDS_TREE]		= NI_DHCP4_LEASE(NI_DHCP4_CODEC_PRINTABLE,   1, 0, nds_tree,             "nds-tree"),
+ [DHCP4_CSR]			= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_csr),
+ [DHCP4_MSCSR]			= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_csr),
+ [DHCP4_SIPSERVER]		= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_sipservers),
+ [DHCP4_STATICROUTE]		= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_static_routes),
+ [DHCP4_ROUTERS]		= NI_DHCP4_FUNC(ni_dhcp4_codec_decode_routers),
+ [DHCP4_POSIX_TZ_STRING]	= NI_DHCP4_LEASE(NI_DHCP4_CODEC_PRINTABLE,   1, 0, posix_tz_string,      "posix-tz-string"),
+ [DHCP4_POSIX_TZ_DBNAME]	= NI_DHCP4_LEASE(NI_DHCP4_CODEC_PRINTABLE,   1, 0, posix_tz_dbname,      "posix-tz-dbname"),
+};
+
+static int
+ni_dhcp4_option_decode(const ni_dhcp4_option_codec_t *codec, ni_buffer_t *bp,
+			ni_dhcp4_parse_state_t *state)
+{
+	void *dst;
+
+	if (codec->type == NI_DHCP4_CODEC_FUNC)
+		return codec->decode(bp, state);
+
+	if (ni_buffer_count(bp) < codec->minlen ||
+	    (codec->multiple && ni_buffer_count(bp) % codec->multiple)) {
+		bp->underflow = 1;
+		return -1;
+	}
+
+	if (codec->base == NI_DHCP4_CODEC_STATE)
+		dst = (unsigned char *)state + codec->offset;
+	else
+		dst = (unsigned char *)state->lease + codec->offset;
+
+	switch (codec->type) {
+	case NI_DHCP4_CODEC_IPV4:
+		return ni_dhcp4_option_get_ipv4(bp, dst);
+	case NI_DHCP4_CODEC_UINT16:
+		return ni_dhcp4_option_get16(bp, dst);
+	case NI_DHCP4_CODEC_UINT32:
+		return ni_dhcp4_option_get32(bp, dst);
+	case NI_DHCP4_CODEC_OPAQUE:
+		return ni_dhcp4_option_get_opaque(bp, dst);
+	case NI_DHCP4_CODEC_DOMAIN:
+		return ni_dhcp4_option_get_domain(bp, dst, codec->what);
+	case NI_DHCP4_CODEC_DOMAIN_LIST:
+		return ni_dhcp4_option_get_domain_list(bp, dst, codec->what);
+	case NI_DHCP4_CODEC_PRINTABLE:
+		return ni_dhcp4_option_get_printable(bp, dst, codec->what);
+	case NI_DHCP4_CODEC_PATHNAME:
+		return ni_dhcp4_option_get_pathname(bp, dst, codec->what);
+	case NI_DHCP4_CODEC_ADDR_LIST:
+		return ni_dhcp4_decode_address_list(bp, dst);
+	default:
+		return -1;
+	}
+}
+
+/*
+ * The options of one message area (options, overloaded file or sname)
+ * as spans into the message. Long options split into several parts
+ * (RFC 3396) are the only ones copied, to concatenate their parts.
+ */
+typedef struct ni_dhcp4_option_span {
+	const unsigned char *	data;
+	unsigned int		len;
+	unsigned char *		joined;
+} ni_dhcp4_option_span_t;
+
+typedef struct ni_dhcp4_option_spans {
+	ni_dhcp4_option_span_t	span[256];
+	unsigned char		order[256];
+	unsigned int		count;
+} ni_dhcp4_option_spans_t;
+
+static ni_bool_t
+ni_dhcp4_option_spans_add(ni_dhcp4_option_spans_t *spans, unsigned int code,
+			const unsigned char *data, unsigned int len)
+{
+	ni_dhcp4_option_span_t *span = &spans->span[code];
+	unsigned char *joined;
+
+	if (!span->data) {
+		span->data = data;
+		span->len = len;
+		spans->order[spans->count++] = code;
+		return TRUE;
+	}
+
+	if (!(joined = realloc(span->joined, span->len + len)))
+		return FALSE;
+	if (!span->joined)
+		memcpy(joined, span->data, span->len);
+	memcpy(joined + span->len, data, len);
+	span->joined = joined;
+	span->data = joined;
+	span->len += len;
+	return TRUE;
+}
+
+static void
+ni_dhcp4_option_spans_destroy(ni_dhcp4_option_spans_t *spans)
+{
+	unsigned int i;
+
+	for (i = 0; i < spans->count; ++i)
+		free(spans->span[spans->order[i]].joined);
+	memset(spans, 0, sizeof(*spans));
+}
+
+static void
+ni_dhcp4_decode_options(ni_dhcp4_option_spans_t *spans, ni_dhcp4_parse_state_t *state)
+{
+	const ni_dhcp4_option_codec_t *codec;
+	const ni_dhcp4_option_span_t *span;
+	ni_dhcp_option_t *opt;
+	unsigned int i, option;
+	ni_buffer_t buf;
+
+	for (i = 0; i < spans->count; ++i) {
+		option = spans->order[i];
+		span = &spans->span[option];
+		codec = &ni_dhcp4_option_codecs[option];
+
+		ni_buffer_init_reader(&buf, (void *)span->data, span->len);
+		if (codec->type != NI_DHCP4_CODEC_NONE) {
+			ni_dhcp4_option_decode(codec, &buf, state);
+		} else {
+			ni_debug_dhcp("adding unparsed DHCP4 option %s code %u len %u",
+					ni_dhcp4_option_name(option), option, span->len);
+
+			if ((opt = ni_dhcp_option_new(option, span->len, span->data))) {
+				if (ni_dhcp_option_list_append(&state->lease->dhcp4.options, opt))
+					ni_buffer_clear(&buf);
+				else
+					ni_dhcp_option_free(opt);
+			}
+		}
+
+		if (buf.underflow) {
+			ni_debug_dhcp("unable to parse DHCP4 option %s (%u): too short",
+					ni_dhcp4_option_name(option), option);
+		} else if (ni_buffer_count(&buf)) {
+			ni_debug_dhcp("excess data in DHCP4 option %s (%u): %zu data bytes left",
+					ni_dhcp4_option_name(option), option,
+					ni_buffer_count(&buf));
+		}
+	}
+}
+
 /*
  * Parse a DHCP4 response.
  */
@@ -1903,23 +2363,18 @@ int
 ni_dhcp4_parse_response(const ni_dhcp4_config_t *config, const ni_dhcp4_message_t *message,
 			ni_buffer_t *options, ni_addrconf_lease_t **leasep)
 {
+	ni_dhcp4_parse_state_t state;
+	ni_dhcp4_option_spans_t spans;
 	ni_buffer_t overload_buf;
 	ni_addrconf_lease_t *lease;
-	ni_route_array_t default_routes = NI_ROUTE_ARRAY_INIT;
-	ni_route_array_t static_routes = NI_ROUTE_ARRAY_INIT;
-	ni_route_array_t classless_routes = NI_ROUTE_ARRAY_INIT;
-	ni_string_array_t dns_servers = NI_STRING_ARRAY_INIT;
-	ni_string_array_t dns_search = NI_STRING_ARRAY_INIT;
-	ni_string_array_t dns_domain = NI_STRING_ARRAY_INIT;
-	ni_string_array_t nis_servers = NI_STRING_ARRAY_INIT;
-	char *nisdomain = NULL;
-	char *tmp = NULL;
 	int opt_overload = 0;
 	int msg_type = -1;
 	int use_bootserver = 1;
 	int use_bootfile = 1;
 	unsigned int pfxlen;
-	ni_dhcp_option_t *opts = NULL, *opt;
+
+	memset(&state, 0, sizeof(state));
+	memset(&spans, 0, sizeof(spans));
 
 	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET);
 
@@ -1933,6 +2388,9 @@ ni_dhcp4_parse_response(const ni_dhcp4_config_t *config, const ni_dhcp4_message_
 	lease->dhcp4.boot_saddr.s_addr = message->siaddr;
 	lease->dhcp4.relay_addr.s_addr = message->giaddr;
 
+	state.config = config;
+	state.lease = lease;
+
 parse_more:
 	/* Loop as long as we still have data in the buffer. */
 	while (ni_buffer_count(options) && !options->underflow) {
@@ -1979,28 +2437,11 @@ parse_more:
 			continue;
 		}
 
-		if ((opt = ni_dhcp_option_list_find(opts, option))) {
-			if (ni_dhcp_option_append(opt, ni_buffer_count(&buf), ni_buffer_head(&buf)))
-				ni_buffer_pull_head(&buf, ni_buffer_count(&buf));
-		} else
-		if ((opt = ni_dhcp_option_new(option, ni_buffer_count(&buf), ni_buffer_head(&buf)))) {
-			if (ni_dhcp_option_list_append(&opts, opt))
-				ni_buffer_pull_head(&buf, ni_buffer_count(&buf));
-			else
-				ni_dhcp_option_free(opt);
-		} else {
+		if (!ni_dhcp4_option_spans_add(&spans, option, ni_buffer_head(&buf),
+						ni_buffer_count(&buf))) {
 			ni_debug_dhcp("unable to allocate DHCP4 option %s", ni_dhcp4_option_name(option));
 			continue;
 		}
-
-		if (buf.underflow) {
-			ni_debug_dhcp("unable to parse DHCP4 option %s: too short",
-					ni_dhcp4_option_name(option));
-		} else if (ni_buffer_count(&buf)) {
-			ni_debug_dhcp("excess data in DHCP4 option %s - %zu bytes left",
-					ni_dhcp4_option_name(option),
-					ni_buffer_count(&buf));
-		}
 	}
 
 	// We should have a msg_type by now
@@ -2014,168 +2455,8 @@ parse_more:
 		goto error;
 	}
 
-	while ((opt = ni_dhcp_option_list_pull(&opts))) {
-		ni_buffer_t buf;
-		int option = opt->code;
-
-		ni_buffer_init_reader(&buf, opt->data, opt->len);
-		switch (option) {
-		case DHCP4_ADDRESS:
-			ni_dhcp4_option_get_ipv4(&buf, &lease->dhcp4.address);
-			break;
-		case DHCP4_NETMASK:
-			ni_dhcp4_option_get_ipv4(&buf, &lease->dhcp4.netmask);
-			break;
-		case DHCP4_BROADCAST:
-			ni_dhcp4_option_get_ipv4(&buf, &lease->dhcp4.broadcast);
-			break;
-		case DHCP4_SERVERIDENTIFIER:
-			ni_dhcp4_option_get_ipv4(&buf, &lease->dhcp4.server_id);
-			break;
-		case DHCP4_CLIENTID:
-			ni_dhcp4_option_get_opaque(&buf, &lease->dhcp4.client_id);
-			break;
-		case DHCP4_LEASETIME:
-			ni_dhcp4_option_get32(&buf, &lease->dhcp4.lease_time);
-			break;
-		case DHCP4_RENEWALTIME:
-			ni_dhcp4_option_get32(&buf, &lease->dhcp4.renewal_time);
-			break;
-		case DHCP4_REBINDTIME:
-			ni_dhcp4_option_get32(&buf, &lease->dhcp4.rebind_time);
-			break;
-		case DHCP4_MTU:
-			ni_dhcp4_option_get16(&buf, &lease->dhcp4.mtu);
-			/* Minimum legal mtu is 68 accoridng to
-			 * RFC 2132. In practise it's 576 which is the
-			 * minimum maximum message size. */
-			if (lease->dhcp4.mtu <= MTU_MIN) {
-				ni_debug_dhcp("MTU %u is too low, minimum is %d; ignoring",
-						lease->dhcp4.mtu, MTU_MIN);
-				lease->dhcp4.mtu = 0;
-			}
-			break;
-		case DHCP4_FQDN:
-			ni_dhcp4_option_get_fqdn(&buf, &lease->hostname, &lease->fqdn);
-			break;
-		case DHCP4_HOSTNAME:
-			if (lease->fqdn.enabled != NI_TRISTATE_ENABLE) {
-				ni_dhcp4_option_get_domain(&buf, &lease->hostname,
-								"hostname");
-			}
-			break;
-		case DHCP4_DNSDOMAIN:
-			ni_dhcp4_option_get_domain_list(&buf, &dns_domain,
-							"dns-domain");
-			break;
-		case DHCP4_MESSAGE:
-			ni_dhcp4_option_get_printable(&buf, &lease->dhcp4.message,
-							"dhcp4-message");
-			break;
-		case DHCP4_ROOTPATH:
-			ni_dhcp4_option_get_pathname(&buf, &lease->dhcp4.root_path,
-							"root-path");
-			break;
-		case DHCP4_NISDOMAIN:
-			ni_dhcp4_option_get_domain(&buf, &nisdomain,
-							"nis-domain");
-			break;
-		case DHCP4_NETBIOSNODETYPE:
-			ni_dhcp4_option_get_netbios_type(&buf, &lease->netbios_type);
-			break;
-		case DHCP4_NETBIOSSCOPE:
-			ni_dhcp4_option_get_domain(&buf, &lease->netbios_scope,
-							"netbios-scope");
-			break;
-		case DHCP4_DNSSERVER:
-			ni_dhcp4_decode_address_list(&buf, &dns_servers);
-			break;
-		case DHCP4_NTPSERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->ntp_servers);
-			break;
-		case DHCP4_NISSERVER:
-			ni_dhcp4_decode_address_list(&buf, &nis_servers);
-			break;
-		case DHCP4_LPRSERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->lpr_servers);
-			break;
-		case DHCP4_LOGSERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->log_servers);
-			break;
-		case DHCP4_NETBIOSNAMESERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->netbios_name_servers);
-			break;
-		case DHCP4_NETBIOSDDSERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->netbios_dd_servers);
-			break;
-		case DHCP4_DNSSEARCH:
-			ni_dhcp4_decode_dnssearch(&buf, &dns_search, "dns-search domain");
-			break;
-
-		case DHCP4_NDS_SERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->nds_servers);
-			break;
-		case DHCP4_NDS_CTX:
-			if (!ni_dhcp4_option_get_printable(&buf, &tmp, "nds-context"))
-				ni_string_array_append(&lease->nds_context, tmp);
-			ni_string_free(&tmp);
-			break;
-		case DHCP4_NDS_TREE:
-			ni_dhcp4_option_get_printable(&buf, &lease->nds_tree,
-							"nds-tree");
-			break;
-
-		case DHCP4_CSR:
-		case DHCP4_MSCSR:
-			ni_route_array_destroy(&classless_routes);
-			ni_dhcp4_decode_csr(&buf, &classless_routes);
-			break;
-
-		case DHCP4_SIPSERVER:
-			ni_dhcp4_decode_sipservers(&buf, &lease->sip_servers);
-			break;
-
-		case DHCP4_STATICROUTE:
-			ni_route_array_destroy(&static_routes);
-			ni_dhcp4_decode_static_routes(&buf, &static_routes);
-			break;
-
-		case DHCP4_ROUTERS:
-			ni_route_array_destroy(&default_routes);
-			ni_dhcp4_decode_routers(&buf, &default_routes);
-			break;
-
-		case DHCP4_POSIX_TZ_STRING:
-			ni_dhcp4_option_get_printable(&buf, &lease->posix_tz_string,
-							"posix-tz-string");
-			break;
-
-		case DHCP4_POSIX_TZ_DBNAME:
-			ni_dhcp4_option_get_printable(&buf, &lease->posix_tz_dbname,
-							"posix-tz-dbname");
-			break;
-
-		default:
-			ni_debug_dhcp("adding unparsed DHCP4 option %s code %u len %u",
-					ni_dhcp4_option_name(option), option, opt->len);
-
-			if (ni_dhcp_option_list_append(&lease->dhcp4.options, opt)) {
-				ni_buffer_clear(&buf);
-				opt = NULL;
-			}
-			break;
-		}
-
-		ni_dhcp_option_free(opt);
-		if (buf.underflow) {
-			ni_debug_dhcp("unable to parse DHCP4 option %s (%u): too short",
-					ni_dhcp4_option_name(option), option);
-		} else if (ni_buffer_count(&buf)) {
-			ni_debug_dhcp("excess data in DHCP4 option %s (%u): %zu data bytes left",
-					ni_dhcp4_option_name(option), option,
-					ni_buffer_count(&buf));
-		}
-	}
+	ni_dhcp4_decode_options(&spans, &state);
+	ni_dhcp4_option_spans_destroy(&spans);
 
 	if (opt_overload) {
 		const void *more_data = NULL;
@@ -2259,41 +2540,41 @@ parse_more:
 			ni_sockaddr_set_ipv4(&ap->bcast_addr, lease->dhcp4.broadcast, 0);
 	}
 
-	if (classless_routes.count) {
+	if (state.classless_routes.count) {
 		/* if CSR or MSCSR are available, ignore other routes */
-		ni_dhcp4_apply_routes(lease, &classless_routes);
-		ni_route_array_destroy(&classless_routes);
+		ni_dhcp4_apply_routes(lease, &state.classless_routes);
+		ni_route_array_destroy(&state.classless_routes);
 	} else {
-		ni_dhcp4_apply_routes(lease, &static_routes);
-		ni_route_array_destroy(&static_routes);
-		ni_dhcp4_apply_routes(lease, &default_routes);
-		ni_route_array_destroy(&default_routes);
+		ni_dhcp4_apply_routes(lease, &state.static_routes);
+		ni_route_array_destroy(&state.static_routes);
+		ni_dhcp4_apply_routes(lease, &state.default_routes);
+		ni_route_array_destroy(&state.default_routes);
 	}
 
-	if (dns_servers.count || dns_search.count || dns_domain.count) {
+	if (state.dns_servers.count || state.dns_search.count || state.dns_domain.count) {
 		ni_resolver_info_t *resolver = ni_resolver_info_new();
 
-		if (dns_domain.count)
-			ni_string_dup(&resolver->default_domain, dns_domain.data[0]);
+		if (state.dns_domain.count)
+			ni_string_dup(&resolver->default_domain, state.dns_domain.data[0]);
 
-		if (dns_search.count)
-			ni_string_array_move(&resolver->dns_search, &dns_search);
+		if (state.dns_search.count)
+			ni_string_array_move(&resolver->dns_search, &state.dns_search);
 		else
-			ni_string_array_move(&resolver->dns_search, &dns_domain);
+			ni_string_array_move(&resolver->dns_search, &state.dns_domain);
 
-		ni_string_array_move(&resolver->dns_servers, &dns_servers);
+		ni_string_array_move(&resolver->dns_servers, &state.dns_servers);
 		lease->resolver = resolver;
 	}
-	if (nisdomain != NULL) {
+	if (state.nisdomain != NULL) {
 		ni_nis_info_t *nis = ni_nis_info_new();
 
-		nis->domainname = nisdomain;
-		nisdomain = NULL;
+		nis->domainname = state.nisdomain;
+		state.nisdomain = NULL;
 
-		if (nis_servers.count == 0)
+		if (state.nis_servers.count == 0)
 			nis->default_binding = NI_NISCONF_BROADCAST;
 		else
-			ni_string_array_move(&nis->default_servers, &nis_servers);
+			ni_string_array_move(&nis->default_servers, &state.nis_servers);
 		lease->nis = nis;
 	}
 
@@ -2301,15 +2582,15 @@ parse_more:
 	lease = NULL;
 
 done:
-	ni_route_array_destroy(&default_routes);
-	ni_route_array_destroy(&static_routes);
-	ni_route_array_destroy(&classless_routes);
-	ni_string_array_destroy(&dns_servers);
-	ni_string_array_destroy(&dns_search);
-	ni_string_array_destroy(&dns_domain);
-	ni_string_array_destroy(&nis_servers);
-	ni_string_free(&nisdomain);
-	ni_dhcp_option_list_destroy(&opts);
+	ni_route_array_destroy(&state.default_routes);
+	ni_route_array_destroy(&state.static_routes);
+	ni_route_array_destroy(&state.classless_routes);
+	ni_string_array_destroy(&state.dns_servers);
+	ni_string_array_destroy(&state.dns_search);
+	ni_string_array_destroy(&state.dns_domain);
+	ni_string_array_destroy(&state.nis_servers);
+	ni_string_free(&state.nisdomain);
+	ni_dhcp4_option_spans_destroy(&spans);
 
 	return msg_type;
 
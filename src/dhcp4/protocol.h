@@ -181,6 +181,30 @@ struct ni_dhcp4_message {
 # define IN_LINKLOCAL(addr) ((addr & IN_CLASSB_NET) == LINKLOCAL_ADDR)
 #endif
 
+/*
+ * Server side messages of the test server
+ */
+typedef struct ni_dhcp4_client_message {
+	const ni_dhcp4_message_t *	header;
+	unsigned int			type;
+	struct in_addr			requested;
+	struct in_addr			server_id;
+	ni_opaque_t			client_id;
+} ni_dhcp4_client_message_t;
+
+typedef struct ni_dhcp4_server_reply {
+	unsigned int			type;
+	struct in_addr			server_id;
+	struct in_addr			address;
+	struct in_addr			netmask;
+	struct in_addr			router;
+	unsigned int			lease_time;
+} ni_dhcp4_server_reply_t;
+
+extern int		ni_dhcp4_parse_client_message(ni_buffer_t *, ni_dhcp4_client_message_t *);
+extern int		ni_dhcp4_build_server_reply(const ni_dhcp4_client_message_t *,
+					const ni_dhcp4_server_reply_t *, ni_buffer_t *);
+
 extern const char *	ni_dhcp4_message_name(unsigned int);
 extern const char *	ni_dhcp4_option_name(unsigned int);
 
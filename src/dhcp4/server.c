@@ -0,0 +1,569 @@
+/*
+ *	wicked dhcp4 in test server (load generator peer) mode
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+
+#include <wicked/types.h>
+#include <wicked/netinfo.h>
+#include <wicked/address.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+
+#include "dhcp4/dhcp4.h"
+#include "dhcp4/protocol.h"
+#include "dhcp4/server.h"
+#include "socket_priv.h"
+#include "buffer.h"
+#include "util_priv.h"
+
+/*
+ * A minimal DHCPv4 server answering the clients on one or more
+ * interfaces (e.g. the host side of veth pairs or a bridge), using
+ * a static address pool derived from the interface address.
+ * It is intended as a load generator peer to benchmark the client
+ * acquisition rate and retransmit behaviour only; there is no lease
+ * expiry, no persistence and no relay agent support.
+ */
+#define NI_DHCP4_SERVER_HASH_SIZE	1024
+#define NI_DHCP4_SERVER_MSG_MAX		1500
+
+typedef struct ni_dhcp4_server_client	ni_dhcp4_server_client_t;
+typedef struct ni_dhcp4_server_port	ni_dhcp4_server_port_t;
+typedef struct ni_dhcp4_server_reply_tx	ni_dhcp4_server_reply_tx_t;
+
+struct ni_dhcp4_server_client {
+	ni_dhcp4_server_client_t *	next;
+
+	unsigned char			hwlen;
+	unsigned char			chaddr[DHCP4_CHADDR_LEN];
+	struct in_addr			address;
+
+	struct timeval			started;
+	unsigned int			discovers;
+	unsigned int			requests;
+	ni_bool_t			bound;
+};
+
+struct ni_dhcp4_server_port {
+	ni_dhcp4_server_port_t *	next;
+
+	char *				ifname;
+	unsigned int			ifindex;
+	ni_socket_t *			sock;
+
+	struct in_addr			server_id;
+	struct in_addr			netmask;
+	uint32_t			pool_next;
+	uint32_t			pool_last;
+
+	ni_dhcp4_server_client_t *	hash[NI_DHCP4_SERVER_HASH_SIZE];
+};
+
+struct ni_dhcp4_server_reply_tx {
+	ni_dhcp4_server_port_t *	port;
+	size_t				len;
+	unsigned char			data[NI_DHCP4_SERVER_MSG_MAX];
+};
+
+typedef struct ni_dhcp4_server_stats {
+	unsigned int			received[DHCP4_INFORM + 1];
+	unsigned int			sent[DHCP4_INFORM + 1];
+	unsigned int			invalid;
+	unsigned int			dropped;
+	unsigned int			exhausted;
+	unsigned int			retransmits;
+	unsigned int			renewals;
+	unsigned int			clients;
+	unsigned int			bound;
+
+	ni_timeout_t			acquire_min;
+	ni_timeout_t			acquire_max;
+	unsigned long long		acquire_sum;
+} ni_dhcp4_server_stats_t;
+
+static ni_dhcp4_server_opts_t		dhcp4_server_opts;
+static ni_dhcp4_server_port_t *		dhcp4_server_ports;
+static ni_dhcp4_server_stats_t		dhcp4_server_stats;
+
+ni_dhcp4_server_opts_t *
+ni_dhcp4_server_init(void)
+{
+	memset(&dhcp4_server_opts, 0, sizeof(dhcp4_server_opts));
+	dhcp4_server_opts.lease_time = 3600;
+	return &dhcp4_server_opts;
+}
+
+static unsigned int
+ni_dhcp4_server_client_hash(const unsigned char *chaddr, unsigned char hwlen)
+{
+	unsigned int hash = 5381, i;
+
+	for (i = 0; i < hwlen; ++i)
+		hash = ((hash << 5) + hash) ^ chaddr[i];
+	return hash % NI_DHCP4_SERVER_HASH_SIZE;
+}
+
+static ni_dhcp4_server_client_t *
+ni_dhcp4_server_client_get(ni_dhcp4_server_port_t *port, const ni_dhcp4_message_t *msg)
+{
+	ni_dhcp4_server_client_t *client;
+	unsigned char hwlen;
+	unsigned int hash;
+
+	hwlen = min_t(unsigned char, msg->hwlen, DHCP4_CHADDR_LEN);
+	hash = ni_dhcp4_server_client_hash(msg->chaddr, hwlen);
+	for (client = port->hash[hash]; client; client = client->next) {
+		if (client->hwlen == hwlen && !memcmp(client->chaddr, msg->chaddr, hwlen))
+			return client;
+	}
+
+	client = xcalloc(1, sizeof(*client));
+	client->hwlen = hwlen;
+	memcpy(client->chaddr, msg->chaddr, hwlen);
+	ni_timer_get_time(&client->started);
+
+	client->next = port->hash[hash];
+	port->hash[hash] = client;
+	dhcp4_server_stats.clients++;
+	return client;
+}
+
+static ni_bool_t
+ni_dhcp4_server_client_assign(ni_dhcp4_server_port_t *port, ni_dhcp4_server_client_t *client)
+{
+	uint32_t addr;
+
+	if (client->address.s_addr)
+		return TRUE;
+
+	do {
+		if (port->pool_next > port->pool_last) {
+			dhcp4_server_stats.exhausted++;
+			return FALSE;
+		}
+		addr = port->pool_next++;
+	} while (addr == ntohl(port->server_id.s_addr));
+
+	client->address.s_addr = htonl(addr);
+	return TRUE;
+}
+
+static void
+ni_dhcp4_server_transmit(ni_dhcp4_server_port_t *port, const void *data, size_t len)
+{
+	struct sockaddr_in sin;
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(DHCP4_CLIENT_PORT);
+	sin.sin_addr.s_addr = INADDR_BROADCAST;
+
+	if (sendto(port->sock->__fd, data, len, 0, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+		ni_warn("%s: unable to send reply: %m", port->ifname);
+}
+
+static void
+ni_dhcp4_server_transmit_delayed(void *user_data, const ni_timer_t *timer)
+{
+	ni_dhcp4_server_reply_tx_t *tx = user_data;
+
+	(void)timer;
+	ni_dhcp4_server_transmit(tx->port, tx->data, tx->len);
+	free(tx);
+}
+
+static void
+ni_dhcp4_server_send(ni_dhcp4_server_port_t *port, const ni_dhcp4_client_message_t *info,
+			const ni_dhcp4_server_reply_t *reply)
+{
+	ni_dhcp4_server_reply_tx_t *tx;
+	ni_buffer_t msgbuf;
+	ni_timeout_t delay;
+
+	if (dhcp4_server_opts.loss && (unsigned int)(random() % 100) < dhcp4_server_opts.loss) {
+		dhcp4_server_stats.dropped++;
+		return;
+	}
+
+	tx = xcalloc(1, sizeof(*tx));
+	tx->port = port;
+	ni_buffer_init(&msgbuf, tx->data, sizeof(tx->data));
+	if (ni_dhcp4_build_server_reply(info, reply, &msgbuf) < 0) {
+		ni_error("%s: unable to build %s reply", port->ifname,
+				ni_dhcp4_message_name(reply->type));
+		free(tx);
+		return;
+	}
+	tx->len = ni_buffer_count(&msgbuf);
+	dhcp4_server_stats.sent[reply->type]++;
+
+	delay = dhcp4_server_opts.latency;
+	if (dhcp4_server_opts.jitter)
+		delay += random() % (dhcp4_server_opts.jitter + 1);
+
+	if (!delay || !ni_timer_register(delay, ni_dhcp4_server_transmit_delayed, tx)) {
+		ni_dhcp4_server_transmit(port, tx->data, tx->len);
+		free(tx);
+	}
+}
+
+static void
+ni_dhcp4_server_process(ni_dhcp4_server_port_t *port, const ni_dhcp4_client_message_t *info)
+{
+	ni_dhcp4_server_reply_t reply;
+	ni_dhcp4_server_client_t *client;
+	struct in_addr requested;
+	ni_timeout_t acquired;
+
+	client = ni_dhcp4_server_client_get(port, info->header);
+
+	memset(&reply, 0, sizeof(reply));
+	reply.server_id = port->server_id;
+	reply.netmask = port->netmask;
+	reply.router = port->server_id;
+	reply.lease_time = dhcp4_server_opts.lease_time;
+
+	switch (info->type) {
+	case DHCP4_DISCOVER:
+		if (client->discovers++ && !client->bound)
+			dhcp4_server_stats.retransmits++;
+		if (client->bound) {
+			/* restarted client, measure the new acquisition */
+			client->bound = FALSE;
+			client->requests = 0;
+			dhcp4_server_stats.bound--;
+			ni_timer_get_time(&client->started);
+		}
+		if (!ni_dhcp4_server_client_assign(port, client))
+			return;
+
+		reply.type = DHCP4_OFFER;
+		reply.address = client->address;
+		break;
+
+	case DHCP4_REQUEST:
+		if (info->server_id.s_addr && info->server_id.s_addr != port->server_id.s_addr)
+			return;	/* client selected another server */
+
+		requested = info->requested;
+		if (!requested.s_addr)
+			requested.s_addr = info->header->ciaddr;
+
+		if (!client->address.s_addr || requested.s_addr != client->address.s_addr) {
+			if (!dhcp4_server_opts.nak)
+				return;
+			reply.type = DHCP4_NAK;
+			break;
+		}
+
+		if (client->bound) {
+			/* a renewing client sets ciaddr, else the ack was lost */
+			if (info->header->ciaddr)
+				dhcp4_server_stats.renewals++;
+			else
+				dhcp4_server_stats.retransmits++;
+		} else {
+			if (client->requests++)
+				dhcp4_server_stats.retransmits++;
+
+			client->bound = TRUE;
+			dhcp4_server_stats.bound++;
+
+			acquired = ni_timeout_since(&client->started, NULL, NULL);
+			if (!dhcp4_server_stats.acquire_min || acquired < dhcp4_server_stats.acquire_min)
+				dhcp4_server_stats.acquire_min = acquired;
+			if (acquired > dhcp4_server_stats.acquire_max)
+				dhcp4_server_stats.acquire_max = acquired;
+			dhcp4_server_stats.acquire_sum += acquired;
+		}
+
+		reply.type = DHCP4_ACK;
+		reply.address = client->address;
+		break;
+
+	case DHCP4_DECLINE:
+		/* the address is in use, hand out a fresh one */
+		if (client->bound)
+			dhcp4_server_stats.bound--;
+		client->bound = FALSE;
+		client->address.s_addr = 0;
+		return;
+
+	case DHCP4_RELEASE:
+		if (client->bound)
+			dhcp4_server_stats.bound--;
+		client->bound = FALSE;
+		return;
+
+	default:
+		return;
+	}
+
+	ni_dhcp4_server_send(port, info, &reply);
+}
+
+static void
+ni_dhcp4_server_receive(ni_socket_t *sock)
+{
+	ni_dhcp4_server_port_t *port = sock->user_data;
+	unsigned char data[NI_DHCP4_SERVER_MSG_MAX];
+	ni_dhcp4_client_message_t info;
+	ni_buffer_t msgbuf;
+	ssize_t len;
+
+	len = recv(sock->__fd, data, sizeof(data), 0);
+	if (len < 0) {
+		if (errno != EINTR && errno != EAGAIN)
+			ni_error("%s: unable to receive: %m", port->ifname);
+		return;
+	}
+
+	ni_buffer_init_reader(&msgbuf, data, len);
+	if (ni_dhcp4_parse_client_message(&msgbuf, &info) < 0) {
+		dhcp4_server_stats.invalid++;
+		return;
+	}
+
+	if (info.type <= DHCP4_INFORM)
+		dhcp4_server_stats.received[info.type]++;
+
+	ni_debug_dhcp("%s: received %s from %s", port->ifname,
+			ni_dhcp4_message_name(info.type),
+			ni_print_hex(info.header->chaddr,
+				min_t(unsigned char, info.header->hwlen, DHCP4_CHADDR_LEN)));
+
+	ni_dhcp4_server_process(port, &info);
+}
+
+static ni_bool_t
+ni_dhcp4_server_port_pool(ni_dhcp4_server_port_t *port, const ni_netdev_t *dev)
+{
+	const ni_address_t *ap;
+	uint32_t addr, mask;
+
+	for (ap = dev->addrs; ap; ap = ap->next) {
+		if (ap->family != AF_INET || ap->prefixlen == 0 || ap->prefixlen > 30)
+			continue;
+
+		addr = ntohl(ap->local_addr.sin.sin_addr.s_addr);
+		mask = ~0U << (32 - ap->prefixlen);
+
+		port->server_id = ap->local_addr.sin.sin_addr;
+		port->netmask.s_addr = htonl(mask);
+		port->pool_next = (addr & mask) + 1;
+		port->pool_last = (addr | ~mask) - 1;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static ni_dhcp4_server_port_t *
+ni_dhcp4_server_port_open(ni_netconfig_t *nc, const char *ifname)
+{
+	ni_dhcp4_server_port_t *port;
+	struct sockaddr_in sin;
+	ni_netdev_t *dev;
+	int fd, on = 1;
+
+	if (!(dev = ni_netdev_by_name(nc, ifname))) {
+		ni_error("Cannot find interface with name '%s'", ifname);
+		return NULL;
+	}
+
+	port = xcalloc(1, sizeof(*port));
+	ni_string_dup(&port->ifname, dev->name);
+	port->ifindex = dev->link.ifindex;
+
+	if (!ni_dhcp4_server_port_pool(port, dev)) {
+		ni_error("%s: no IPv4 address to derive the address pool from", ifname);
+		goto failure;
+	}
+
+	if ((fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) < 0) {
+		ni_error("%s: cannot create socket: %m", ifname);
+		goto failure;
+	}
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(DHCP4_SERVER_PORT);
+	sin.sin_addr.s_addr = INADDR_ANY;
+
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+	    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on)) < 0 ||
+	    setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, port->ifname, strlen(port->ifname) + 1) < 0 ||
+	    bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+		ni_error("%s: cannot bind server socket: %m", ifname);
+		close(fd);
+		goto failure;
+	}
+
+	if (!(port->sock = ni_socket_wrap(fd, SOCK_DGRAM))) {
+		close(fd);
+		goto failure;
+	}
+	port->sock->receive = ni_dhcp4_server_receive;
+	port->sock->user_data = port;
+	if (!ni_socket_activate(port->sock))
+		goto failure;
+
+	ni_info("%s: serving %u addresses from %s",
+			port->ifname, port->pool_last - port->pool_next + 1,
+			inet_ntoa(port->server_id));
+	return port;
+
+failure:
+	if (port->sock)
+		ni_socket_release(port->sock);
+	ni_string_free(&port->ifname);
+	free(port);
+	return NULL;
+}
+
+static void
+ni_dhcp4_server_port_close(ni_dhcp4_server_port_t *port)
+{
+	ni_dhcp4_server_client_t *client;
+	unsigned int i;
+
+	for (i = 0; i < NI_DHCP4_SERVER_HASH_SIZE; ++i) {
+		while ((client = port->hash[i])) {
+			port->hash[i] = client->next;
+			free(client);
+		}
+	}
+	if (port->sock)
+		ni_socket_close(port->sock);
+	ni_string_free(&port->ifname);
+	free(port);
+}
+
+static void
+ni_dhcp4_server_report(const struct timeval *started)
+{
+	const ni_dhcp4_server_stats_t *stats = &dhcp4_server_stats;
+	ni_timeout_t elapsed;
+	unsigned int type;
+
+	elapsed = ni_timeout_since(started, NULL, NULL);
+
+	printf("%-15s %llu ms\n", "elapsed:", (unsigned long long)elapsed);
+	printf("%-15s %u\n", "clients:", stats->clients);
+	printf("%-15s %u\n", "bound:", stats->bound);
+	for (type = DHCP4_DISCOVER; type <= DHCP4_INFORM; ++type) {
+		if (!stats->received[type] && !stats->sent[type])
+			continue;
+		printf("%-15s %u received, %u sent\n",
+				ni_dhcp4_message_name(type),
+				stats->received[type], stats->sent[type]);
+	}
+	printf("%-15s %u\n", "dropped:", stats->dropped);
+	printf("%-15s %u\n", "invalid:", stats->invalid);
+	printf("%-15s %u\n", "exhausted:", stats->exhausted);
+	printf("%-15s %u\n", "retransmits:", stats->retransmits);
+	printf("%-15s %u\n", "renewals:", stats->renewals);
+	if (stats->sent[DHCP4_ACK]) {
+		unsigned int acks = stats->bound;
+
+		printf("%-15s min %llu ms, avg %llu ms, max %llu ms\n", "acquire:",
+				(unsigned long long)stats->acquire_min,
+				acks ? stats->acquire_sum / acks : 0ULL,
+				(unsigned long long)stats->acquire_max);
+		if (elapsed)
+			printf("%-15s %.1f leases/s\n", "rate:",
+					(double)acks * 1000 / elapsed);
+	}
+	fflush(stdout);
+}
+
+int
+ni_dhcp4_server_run(ni_dhcp4_server_opts_t *opts)
+{
+	ni_dhcp4_server_port_t *port, **tail;
+	struct timeval started;
+	ni_netconfig_t *nc;
+	unsigned int i;
+
+	if (!opts || !opts->ifnames.count)
+		ni_fatal("Invalid start parameters!");
+
+	dhcp4_server_opts = *opts;
+	memset(&dhcp4_server_stats, 0, sizeof(dhcp4_server_stats));
+
+	if (!(nc = ni_global_state_handle(1)))
+		ni_fatal("Cannot refresh interface list!");
+
+	tail = &dhcp4_server_ports;
+	for (i = 0; i < opts->ifnames.count; ++i) {
+		if (!(port = ni_dhcp4_server_port_open(nc, opts->ifnames.data[i])))
+			goto failure;
+		*tail = port;
+		tail = &port->next;
+	}
+
+	ni_timer_get_time(&started);
+	while (!ni_caught_terminal_signal()) {
+		ni_timeout_t timeout;
+
+		if (opts->duration) {
+			ni_timeout_t elapsed = ni_timeout_since(&started, NULL, NULL);
+
+			if (elapsed >= opts->duration * 1000ULL)
+				break;
+			timeout = ni_timer_next_timeout();
+			if (timeout == NI_TIMEOUT_INFINITE ||
+			    timeout > opts->duration * 1000ULL - elapsed)
+				timeout = opts->duration * 1000ULL - elapsed;
+		} else {
+			timeout = ni_timer_next_timeout();
+		}
+
+		if (ni_socket_wait(timeout) != 0)
+			break;
+	}
+	ni_dhcp4_server_report(&started);
+
+	while ((port = dhcp4_server_ports)) {
+		dhcp4_server_ports = port->next;
+		ni_dhcp4_server_port_close(port);
+	}
+	ni_socket_deactivate_all();
+	return NI_WICKED_RC_SUCCESS;
+
+failure:
+	while ((port = dhcp4_server_ports)) {
+		dhcp4_server_ports = port->next;
+		ni_dhcp4_server_port_close(port);
+	}
+	return NI_WICKED_RC_ERROR;
+}
@@ -0,0 +1,39 @@
+/*
+ *	wicked dhcp4 in test server (load generator peer) mode
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ */
+#ifndef   __WICKED_DHCP4_SERVER_H__
+#define   __WICKED_DHCP4_SERVER_H__
+
+typedef struct ni_dhcp4_server_opts {
+	ni_string_array_t	ifnames;
+	unsigned int		latency;	/* reply delay in msec	*/
+	unsigned int		jitter;		/* random extra delay	*/
+	unsigned int		loss;		/* dropped replies in %	*/
+	unsigned int		lease_time;	/* in seconds		*/
+	unsigned int		duration;	/* 0: until signaled	*/
+	ni_bool_t		nak;		/* nak foreign requests	*/
+} ni_dhcp4_server_opts_t;
+
+extern ni_dhcp4_server_opts_t *	ni_dhcp4_server_init(void);
+
+extern int			ni_dhcp4_server_run(ni_dhcp4_server_opts_t *);
+
+#endif /* __WICKED_DHCP4_SERVER_H__ */
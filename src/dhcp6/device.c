@@ -45,6 +45,7 @@
 #include "iaid.h"
 #include "duid.h"
 #include "dhcp.h"
+#include "probes.h"
 
 
 /*
@@ -143,6 +144,31 @@ ni_dhcp6_device_by_index(unsigned int ifindex)
 	return NULL;
 }
 
+/*
+ * Find another device using a lease from the server with given DUID,
+ * e.g. a delegating router reached via the same relay on several links.
+ */
+ni_dhcp6_device_t *
+ni_dhcp6_device_by_server_id(const ni_dhcp6_device_t *self, const ni_opaque_t *server_id)
+{
+	ni_dhcp6_device_t *dev;
+
+	if (!server_id || !server_id->len)
+		return NULL;
+
+	for (dev = ni_dhcp6_active; dev; dev = dev->next) {
+		if (dev == self || !dev->lease)
+			continue;
+
+		if (dev->lease->state != NI_ADDRCONF_STATE_GRANTED)
+			continue;
+
+		if (ni_opaque_eq(&dev->lease->dhcp6.server_id, server_id))
+			return dev;
+	}
+	return NULL;
+}
+
 /*
  * Refcount handling
  */
@@ -687,11 +713,11 @@ ni_dhcp6_device_update_mode(ni_dhcp6_device_t *dev, const ni_netdev_t *ifp)
 	if (ni_ipv6_devinfo_ra_received(ifp->ipv6) && dev->config) {
 		omode = dev->config->mode;
 
-		if (ifp->ipv6->radv.managed_addr) {
+		if (ifp->ipv6->radv && ifp->ipv6->radv->managed_addr) {
 			dev->config->mode |= NI_BIT(NI_DHCP6_MODE_MANAGED);
 			dev->config->mode = ni_dhcp6_mode_adjust(dev->config->mode);
 		} else
-		if (ifp->ipv6->radv.other_config) {
+		if (ifp->ipv6->radv && ifp->ipv6->radv->other_config) {
 			dev->config->mode |= NI_BIT(NI_DHCP6_MODE_INFO);
 			dev->config->mode = ni_dhcp6_mode_adjust(dev->config->mode);
 		} else {
@@ -737,7 +763,7 @@ ni_dhcp6_device_ra_info(const ni_dhcp6_device_t *dev, const ni_netdev_t *ifp)
 		ni_netconfig_t *nc = ni_global_state_handle(0);
 		ifp = nc ? ni_netdev_by_index(nc, dev->link.ifindex) : NULL;
 	}
-	return ifp && ifp->ipv6 ? &ifp->ipv6->radv : NULL;
+	return ifp && ifp->ipv6 ? ifp->ipv6->radv : NULL;
 }
 
 const ni_ipv6_ra_pinfo_t *
@@ -999,6 +1025,49 @@ __nondefault(unsigned int req, unsigned int def)
 	return req ? req : def;
 }
 
+static ni_bool_t
+ni_dhcp6_config_has_ia_pd_iaid(const ni_dhcp6_config_t *config, unsigned int iaid)
+{
+	const ni_dhcp6_ia_t *ia;
+
+	for (ia = config->ia_list; ia; ia = ia->next) {
+		if (ni_dhcp6_ia_type_pd(ia) && ia->iaid == iaid)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * The iaid of the next IA-PD in the config: the first IA-PD uses the
+ * device iaid, further ones reuse the iaid of the corresponding IA-PD
+ * in the current lease or a stable iaid derived from the device iaid.
+ */
+static unsigned int
+ni_dhcp6_config_ia_pd_iaid(const ni_dhcp6_device_t *dev, const ni_dhcp6_config_t *config)
+{
+	const ni_dhcp6_ia_t *ia;
+	unsigned int nth = 0, n = 0, iaid;
+
+	for (ia = config->ia_list; ia; ia = ia->next) {
+		if (ni_dhcp6_ia_type_pd(ia))
+			nth++;
+	}
+	if (!nth)
+		return dev->iaid;
+
+	for (ia = dev->lease ? dev->lease->dhcp6.ia_list : NULL; ia; ia = ia->next) {
+		if (!ni_dhcp6_ia_type_pd(ia) || !ia->iaid)
+			continue;
+		if (n++ == nth && !ni_dhcp6_config_has_ia_pd_iaid(config, ia->iaid))
+			return ia->iaid;
+	}
+
+	iaid = dev->iaid + nth * 0x9e3779b9U;
+	while (!iaid || ni_dhcp6_config_has_ia_pd_iaid(config, iaid))
+		iaid += 0x9e3779b9U;
+	return iaid;
+}
+
 /*
  * Process a request to reconfigure the device (ie rebind a lease, or discover
  * a new lease).
@@ -1067,6 +1136,7 @@ ni_dhcp6_acquire(ni_dhcp6_device_t *dev, const ni_dhcp6_request_t *req, char **e
 						NI_DHCP6_DEFER_TIMEOUT);
 	} else {
 		config->rapid_commit	= req->rapid_commit;
+		config->offer_selection	= ni_dhcp6_config_offer_selection(dev->ifname);
 		config->defer_timeout	= __nondefault(req->defer_timeout,
 						NI_DHCP6_DEFER_TIMEOUT);
 		config->acquire_timeout	= __nondefault(req->acquire_timeout,
@@ -1107,16 +1177,16 @@ ni_dhcp6_acquire(ni_dhcp6_device_t *dev, const ni_dhcp6_request_t *req, char **e
 	 * Another IA's aren't using a hint and will be added according to
 	 * the managed/info mode bit later to request automatically.
 	 *
-	 * Once we support multiple prefixes, we will need to sort requests
-	 * by iaid into a unique list of IAs + per-ia prefix hints. */
+	 * Each prefix request is an own IA-PD, so all of them are solicited
+	 * and requested in one exchange instead to run one per prefix. */
 	if ((config->mode & NI_BIT(NI_DHCP6_MODE_PREFIX)) && req->prefix_reqs) {
 		const ni_dhcp6_prefix_req_t *pr;
 		ni_dhcp6_ia_addr_t *ph, *padr;
 		ni_dhcp6_ia_t *ia;
 
 		for (pr = req->prefix_reqs; pr; pr = pr->next) {
-			/* one IA using our iaid + hint for now */
-			if (!(ia = ni_dhcp6_ia_pd_new(dev->iaid)))
+			/* one IA per prefix request, the first one using our iaid */
+			if (!(ia = ni_dhcp6_ia_pd_new(ni_dhcp6_config_ia_pd_iaid(dev, config))))
 				continue;
 
 			for (ph = pr->hints; ph; ph = ph->next) {
@@ -1128,7 +1198,6 @@ ni_dhcp6_acquire(ni_dhcp6_device_t *dev, const ni_dhcp6_request_t *req, char **e
 				break; /* one pd hint per ia only */
 			}
 			ni_dhcp6_ia_list_append(&config->ia_list, ia);
-			break; /* one ia-pd only */
 		}
 	}
 
@@ -1414,7 +1483,7 @@ ni_dhcp6_device_transmit(ni_dhcp6_device_t *dev)
 		return rv;
 	}
 
-	rv = ni_dhcp6_socket_send(dev->mcast.sock, &dev->message, &dev->mcast.dest);
+	rv = ni_dhcp6_socket_send(dev->mcast.sock, &dev->message, &dev->mcast.dest, &dev->link);
 	if (rv <= 0 || (size_t)rv != cnt) {
 		/* Hmm... advance retrans.count here? Use stop? */
 
@@ -1430,6 +1499,7 @@ ni_dhcp6_device_transmit(ni_dhcp6_device_t *dev)
 	} else {
 		struct timeval now;
 
+		NI_PROBE3(dhcp6_tx, dev->ifname, header->type, xid);
 		dev->retrans.count++;
 
 		ni_timer_get_time(&now);
@@ -1546,6 +1616,14 @@ ni_dhcp6_config_release_nretries(const char *ifname)
 	return conf && conf->release_nretries ? conf->release_nretries : -1U;
 }
 
+unsigned int
+ni_dhcp6_config_offer_selection(const char *ifname)
+{
+	const ni_config_dhcp6_t *conf = ni_config_dhcp6_find_device(ifname);
+
+	return conf ? conf->offer_selection : NI_CONFIG_DHCP6_OFFER_SELECTION_WAIT;
+}
+
 unsigned int
 ni_dhcp6_config_info_refresh_time(const char *ifname, ni_uint_range_t *range)
 {
@@ -144,6 +144,7 @@ struct ni_dhcp6_config {
 	unsigned int		mode;		/* auto,info,managed,prefix mask */
 	ni_dhcp6_run_t		dry_run;
 	ni_bool_t		rapid_commit;
+	unsigned int		offer_selection;
 	unsigned int		address_len;
 	unsigned int		max_rt;
 
@@ -251,12 +252,15 @@ struct ni_dhcp6_device {
 /*
  * -- device methods
  */
+extern ni_dhcp6_device_t *	ni_dhcp6_active;
+
 extern ni_dhcp6_device_t *	ni_dhcp6_device_new(const char *, const ni_linkinfo_t *);
 extern ni_dhcp6_device_t *	ni_dhcp6_device_get(ni_dhcp6_device_t *);
 extern void			ni_dhcp6_device_put(ni_dhcp6_device_t *);
 
 extern ni_dhcp6_device_t *	ni_dhcp6_device_by_index(unsigned int);
 extern ni_dhcp6_device_t *	ni_dhcp6_device_by_index_show_all(unsigned int);
+extern ni_dhcp6_device_t *	ni_dhcp6_device_by_server_id(const ni_dhcp6_device_t *, const ni_opaque_t *);
 
 extern void			ni_dhcp6_device_set_request(ni_dhcp6_device_t *, ni_dhcp6_request_t *);
 extern ni_bool_t		ni_dhcp6_device_check_ready(ni_dhcp6_device_t *);
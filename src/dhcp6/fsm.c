@@ -35,7 +35,9 @@
 #include "dhcp6/options.h"
 #include "dhcp6/protocol.h"
 #include "dhcp6/fsm.h"
+#include "appconfig.h"
 #include "duid.h"
+#include "probes.h"
 
 
 static void			ni_dhcp6_fsm_timeout(ni_dhcp6_device_t *);
@@ -711,9 +713,107 @@ __fsm_select_best_offer(const ni_dhcp6_device_t *dev, const ni_addrconf_lease_t
 		    ni_opaque_eq(&dev->lease->dhcp6.server_id, &lease->dhcp6.server_id))
 			return TRUE;
 	}
+
+	/* prefer equal weight offer from a server selected by another device */
+	if (dev->config->offer_selection == NI_CONFIG_DHCP6_OFFER_SELECTION_SHARED &&
+	    ni_dhcp6_device_by_server_id(dev, &lease->dhcp6.server_id))
+		return TRUE;
 	return FALSE;
 }
 
+/*
+ * rfc8415#section-18.2.9: an advertise with the maximum server
+ * preference of 255 is selected immediately. With the "fast"
+ * offer-selection the first usable offer is selected as well,
+ * with "shared" the first usable offer from a server another
+ * device already selected, without to wait until the first
+ * solicit RT has elapsed.
+ */
+static inline ni_bool_t
+__fsm_select_offer_now(const ni_dhcp6_device_t *dev)
+{
+	if (dev->best_offer.pref > 254)
+		return TRUE;
+
+	if (dev->best_offer.weight <= 0)
+		return FALSE;
+
+	switch (dev->config->offer_selection) {
+	case NI_CONFIG_DHCP6_OFFER_SELECTION_FAST:
+		return TRUE;
+	case NI_CONFIG_DHCP6_OFFER_SELECTION_SHARED:
+		return ni_dhcp6_device_by_server_id(dev,
+				&dev->best_offer.lease->dhcp6.server_id) != NULL;
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * Screen an advertise before we parse it into a lease.
+ *
+ * Returns -1 when the full parse has to decide (e.g. to report
+ * missed or mismatching identifiers), 0 when the advertise can
+ * be discarded with the reason in hint and 1 when the offer can
+ * not exceed the weight of the best offer we already have.
+ */
+static int
+ni_dhcp6_fsm_select_scan_advertise(ni_dhcp6_device_t *dev, ni_dhcp6_message_t *msg,
+					const ni_buffer_t *optbuf, char **hint)
+{
+	ni_dhcp6_message_scan_t scan;
+	int pref;
+
+	if (ni_dhcp6_scan_client_options(dev, optbuf, &scan) < 0)
+		return -1;
+
+	if (!scan.client_id.len || !scan.server_id.len ||
+	    !ni_opaque_eq(&dev->config->client_duid, &scan.client_id))
+		return -1;
+
+	if (dev->config->max_rt) {
+		if (scan.max_rt != dev->config->max_rt)
+			dev->config->max_rt = -1U;	/* inconsistent -> disable */
+	} else if (scan.max_rt) {
+		dev->config->max_rt = scan.max_rt;	/* new setting  -> apply   */
+	}
+
+	if (scan.rapid_commit) {
+		ni_string_printf(hint, "advertise with rapid commit option");
+		return 0;
+	}
+
+	if (scan.status.valid && scan.status.code != NI_DHCP6_STATUS_SUCCESS) {
+		ni_string_printf(hint, "status %s - %.*s",
+				ni_dhcp6_status_name(scan.status.code),
+				(int)scan.status.len, scan.status.message ?
+				scan.status.message : "");
+		return 0;
+	}
+
+	if (!ni_dhcp6_config_server_preference(&msg->sender, &scan.server_id, &pref))
+		pref = scan.server_pref;
+
+	if (pref < 0) {
+		ni_string_printf(hint, "blacklisted server");
+		return 0;
+	}
+
+	if (!scan.iadrs) {
+		ni_string_printf(hint, "lease offer without usable address");
+		return 0;
+	}
+
+	if (dev->best_offer.lease && dev->best_offer.weight > (int)scan.iadrs) {
+		ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
+				"%s: we have a better offer than weight %u",
+				dev->ifname, scan.iadrs);
+		return 1;
+	}
+
+	return -1;
+}
+
 static int
 ni_dhcp6_fsm_select_process_msg(ni_dhcp6_device_t *dev, ni_dhcp6_message_t *msg, ni_buffer_t *optbuf, char **hint)
 {
@@ -724,6 +824,19 @@ ni_dhcp6_fsm_select_process_msg(ni_dhcp6_device_t *dev, ni_dhcp6_message_t *msg,
 
 	switch (msg->type) {
 	case NI_DHCP6_ADVERTISE:
+		/*
+		 * Validate and score the advertise in place first, so we
+		 * don't build leases for offers we would discard anyway.
+		 */
+		switch (ni_dhcp6_fsm_select_scan_advertise(dev, msg, optbuf, hint)) {
+		case 0:
+			goto cleanup;
+		case 1:
+			goto offered;
+		default:
+			break;
+		}
+
 		if (ni_dhcp6_fsm_parse_client_options(dev, msg, optbuf) < 0)
 			return -1;
 
@@ -794,9 +907,10 @@ ni_dhcp6_fsm_select_process_msg(ni_dhcp6_device_t *dev, ni_dhcp6_message_t *msg,
 			goto cleanup;
 		}
 
+offered:
 		if (dev->best_offer.lease && dev->retrans.count > 0) {
-			/* if the weight has maximum value, just accept this offer */
-			if (dev->best_offer.pref > 254) {
+			/* maximum preference or fast selection, accept this offer */
+			if (__fsm_select_offer_now(dev)) {
 				ni_dhcp6_fsm_timer_cancel(dev);
 				rv = ni_dhcp6_fsm_accept_offer(dev);
 			} else {
@@ -880,8 +994,8 @@ ni_dhcp6_fsm_select_process_msg(ni_dhcp6_device_t *dev, ni_dhcp6_message_t *msg,
 		}
 
 		if (dev->best_offer.lease && dev->retrans.count > 0) {
-			/* if the weight has maximum value, just accept this offer */
-			if (dev->best_offer.pref > 254) {
+			/* maximum preference or fast selection, accept this offer */
+			if (__fsm_select_offer_now(dev)) {
 				ni_dhcp6_fsm_timer_cancel(dev);
 				rv = ni_dhcp6_fsm_accept_offer(dev);
 			} else {
@@ -1597,6 +1711,7 @@ ni_dhcp6_fsm_process_client_message(ni_dhcp6_device_t *dev, ni_dhcp6_message_t *
 			dev->ifname, ni_dhcp6_message_name(msg->type), msg->xid,
 			ni_dhcp6_fsm_state_name(dev->fsm.state),
 			ni_dhcp6_address_print(&msg->sender));
+	NI_PROBE3(dhcp6_rx, dev->ifname, msg->type, msg->xid);
 
 	ni_string_printf(&hint, "unexpected");
 	switch (state) {
@@ -53,9 +53,11 @@
 #include "dhcp.h"
 #include "socket_priv.h"
 #include "netinfo_priv.h"
+#include "array_priv.h"
 #include "buffer.h"
 #include "debug.h"
 #include "duid.h"
+#include "appconfig.h"
 
 
 /*
@@ -154,6 +156,120 @@ ni_dhcp6_link_mcast_socket_open(const struct ni_dhcp6_link *link, const char *if
 	return fd;
 }
 
+/*
+ * The shared client socket is bound to the wildcard address and used
+ * by all devices; received packets are dispatched by the interface
+ * index in their packet info, sent ones carry the link-local source
+ * address and the interface index of the device in the packet info.
+ */
+static struct {
+	ni_socket_t *		sock;
+	unsigned int		users;
+} ni_dhcp6_shared;
+
+static int
+ni_dhcp6_shared_socket_fd(void)
+{
+	ni_sockaddr_t saddr;
+	int fd, on;
+
+	if ((fd = socket (PF_INET6, SOCK_DGRAM, IPPROTO_UDP)) == -1) {
+		ni_error("dhcp6: Cannot open socket(INET6, DGRAM, UDP): %m");
+		return -1;
+	}
+
+	on = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1)
+		ni_error("dhcp6: Cannot set setsockopt(SO_REUSEADDR): %m");
+
+	if (setsockopt(fd, IPPROTO_IPV6, IPV6_RECVPKTINFO, &on, sizeof(on)) != 0) {
+		ni_error("dhcp6: Cannot set setsockopt(IPV6_RECVPKTINFO): %m");
+		close(fd);
+		return -1;
+	}
+
+	if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
+		ni_error("dhcp6: Cannot set fcntl(SETDF, CLOEXEC): %m");
+
+	ni_sockaddr_set_ipv6(&saddr, in6addr_any, NI_DHCP6_CLIENT_PORT);
+	if (bind(fd, &saddr.sa, sizeof(saddr.six)) == -1) {
+		ni_error("dhcp6: Cannot bind(%s): %m", ni_sockaddr_print(&saddr));
+		close(fd);
+		return -1;
+	}
+
+	ni_debug_dhcp("dhcp6: bound shared DHCPv6 socket to [%s]:%u",
+		ni_sockaddr_print(&saddr), ntohs(saddr.six.sin6_port));
+
+	return fd;
+}
+
+static void
+ni_dhcp6_shared_socket_drop(void)
+{
+	ni_dhcp6_device_t *dev;
+
+	if (!ni_dhcp6_shared.sock)
+		return;
+
+	for (dev = ni_dhcp6_active; dev; dev = dev->next) {
+		if (dev->mcast.sock == ni_dhcp6_shared.sock)
+			dev->mcast.sock = NULL;
+	}
+	ni_socket_close(ni_dhcp6_shared.sock);
+	ni_dhcp6_shared.sock = NULL;
+	ni_dhcp6_shared.users = 0;
+}
+
+static ni_socket_t *
+ni_dhcp6_shared_socket_open(void)
+{
+	int fd;
+
+	if (ni_dhcp6_shared.sock) {
+		if (ni_dhcp6_shared.sock->active && !ni_dhcp6_shared.sock->error) {
+			ni_dhcp6_shared.users++;
+			return ni_dhcp6_shared.sock;
+		}
+
+		/* there were a receive error, detach all devices */
+		ni_dhcp6_shared_socket_drop();
+	}
+
+	if ((fd = ni_dhcp6_shared_socket_fd()) == -1)
+		return NULL;
+
+	if (!(ni_dhcp6_shared.sock = ni_socket_wrap(fd, SOCK_DGRAM))) {
+		ni_error("dhcp6: Unable to prepare shared DHCPv6 socket");
+		close(fd);
+		return NULL;
+	}
+
+	ni_dhcp6_shared.sock->user_data = NULL;
+	ni_dhcp6_shared.sock->receive = ni_dhcp6_socket_recv;
+	ni_dhcp6_shared.sock->get_timeout = ni_dhcp6_socket_get_timeout;
+	ni_dhcp6_shared.sock->check_timeout = ni_dhcp6_socket_check_timeout;
+	ni_buffer_init_dynamic(&ni_dhcp6_shared.sock->rbuf, NI_DHCP6_RBUF_SIZE);
+
+	ni_socket_activate(ni_dhcp6_shared.sock);
+	ni_dhcp6_shared.users = 1;
+	return ni_dhcp6_shared.sock;
+}
+
+static void
+ni_dhcp6_shared_socket_close(void)
+{
+	if (ni_dhcp6_shared.users > 1) {
+		ni_dhcp6_shared.users--;
+		return;
+	}
+
+	if (ni_dhcp6_shared.sock)
+		ni_socket_close(ni_dhcp6_shared.sock);
+	ni_dhcp6_shared.sock = NULL;
+	ni_dhcp6_shared.users = 0;
+}
+
 /*
  * Open a DHCP6 socket for send and receive
  */
@@ -195,6 +311,13 @@ ni_dhcp6_mcast_socket_open(ni_dhcp6_device_t *dev)
 	dev->mcast.dest.six.sin6_port = htons(NI_DHCP6_SERVER_PORT);
 	dev->mcast.dest.six.sin6_scope_id = dev->link.ifindex;
 
+	/* use the shared socket when enabled */
+	if (ni_config_socket_shared_dhcp6()) {
+		if (!(dev->mcast.sock = ni_dhcp6_shared_socket_open()))
+			return -1;
+		return 0;
+	}
+
 	/* open the socket an bind to the link-local address */
 	if ((fd = ni_dhcp6_link_mcast_socket_open(&dev->link, dev->ifname)) == -1)
 		return -1;
@@ -222,15 +345,23 @@ ni_dhcp6_mcast_socket_open(ni_dhcp6_device_t *dev)
 void
 ni_dhcp6_mcast_socket_close(ni_dhcp6_device_t *dev)
 {
-	if (dev->mcast.sock)
+	if (dev->mcast.sock && dev->mcast.sock == ni_dhcp6_shared.sock)
+		ni_dhcp6_shared_socket_close();
+	else if (dev->mcast.sock)
 		ni_socket_close(dev->mcast.sock);
 	dev->mcast.sock = NULL;
 	memset(&dev->mcast.dest, 0, sizeof(dev->mcast.dest));
 }
 
 ssize_t
-ni_dhcp6_socket_send(ni_socket_t *sock, const ni_buffer_t *mesg, const ni_sockaddr_t *dest)
+ni_dhcp6_socket_send(ni_socket_t *sock, const ni_buffer_t *mesg, const ni_sockaddr_t *dest,
+			const struct ni_dhcp6_link *link)
 {
+	unsigned char cbuf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+	struct in6_pktinfo *pinfo;
+	struct cmsghdr *cm;
+	struct iovec iov;
+	struct msghdr msg;
 	int flags = 0;
 	size_t cnt;
 
@@ -253,8 +384,34 @@ ni_dhcp6_socket_send(ni_socket_t *sock, const ni_buffer_t *mesg, const ni_sockad
 	    ni_sockaddr_is_ipv6_linklocal(dest))
 		flags |= MSG_DONTROUTE;
 
-	return sendto(sock->__fd, ni_buffer_head(mesg), cnt,
-			flags, &dest->sa, sizeof(dest->six));
+	if (!link)
+		return sendto(sock->__fd, ni_buffer_head(mesg), cnt,
+				flags, &dest->sa, sizeof(dest->six));
+
+	/*
+	 * Select the interface and the link-local source address,
+	 * required when the socket is not bound to such address.
+	 */
+	memset(&msg, 0, sizeof(msg));
+	memset(&cbuf, 0, sizeof(cbuf));
+	iov.iov_base = ni_buffer_head(mesg);
+	iov.iov_len = cnt;
+	msg.msg_name = (void *)&dest->six;
+	msg.msg_namelen = sizeof(dest->six);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof(cbuf);
+
+	cm = CMSG_FIRSTHDR(&msg);
+	cm->cmsg_level = IPPROTO_IPV6;
+	cm->cmsg_type = IPV6_PKTINFO;
+	cm->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+	pinfo = (struct in6_pktinfo *)CMSG_DATA(cm);
+	pinfo->ipi6_ifindex = link->ifindex;
+	pinfo->ipi6_addr = link->addr.six.sin6_addr;
+
+	return sendmsg(sock->__fd, &msg, flags);
 }
 
 
@@ -277,6 +434,7 @@ ni_dhcp6_socket_recv(ni_socket_t *sock)
 	ni_stringbuf_t hexbuf = NI_STRINGBUF_INIT_DYNAMIC;
 #endif
 	ni_dhcp6_device_t * dev = sock->user_data;
+	const char *ifname = dev ? dev->ifname : "dhcp6";
 	ni_buffer_t * rbuf = &sock->rbuf;
 	unsigned char cbuf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
 	ni_sockaddr_t saddr;
@@ -304,13 +462,13 @@ ni_dhcp6_socket_recv(ni_socket_t *sock)
 	if(bytes < 0) {
 		if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
 			ni_error("%s: recvmsg error on socket %d: %m",
-				dev->ifname, sock->__fd);
+				ifname, sock->__fd);
 			ni_socket_deactivate(sock);
 		}
 		return;
 	} else if (bytes == 0) {
 		ni_error("%s: recvmsg didn't returned any data on socket %d",
-			dev->ifname, sock->__fd);
+			ifname, sock->__fd);
 		return;
 	}
 
@@ -324,9 +482,20 @@ ni_dhcp6_socket_recv(ni_socket_t *sock)
 
 	if (pinfo == NULL) {
 		ni_error("%s: discarding packet without packet info on socket %d",
-			dev->ifname, sock->__fd);
+			ifname, sock->__fd);
 		return;
 	}
+
+	/* dispatch packets received on the shared socket by interface */
+	if (!dev) {
+		dev = ni_dhcp6_device_by_index(pinfo->ipi6_ifindex);
+		if (!dev || dev->mcast.sock != sock) {
+			ni_debug_dhcp("%s: discarding packet for interface index %u"
+					" without shared socket user",
+					ifname, pinfo->ipi6_ifindex);
+			return;
+		}
+	}
 	if(dev->link.ifindex != pinfo->ipi6_ifindex) {
 		ni_error("%s: discarding packet with interface index %u instead %u",
 			dev->ifname, pinfo->ipi6_ifindex, dev->link.ifindex);
@@ -413,10 +582,49 @@ ni_dhcp6_address_print(const struct in6_addr *ipv6)
 	return ni_sockaddr_print(&addr);
 }
 
+/*
+ * The shared socket runs the retransmissions of all its devices.
+ */
+static int
+ni_dhcp6_shared_socket_get_timeout(const ni_socket_t *sock, struct timeval *tv)
+{
+	ni_dhcp6_device_t *dev;
+
+	timerclear(tv);
+	for (dev = ni_dhcp6_active; dev; dev = dev->next) {
+		if (dev->mcast.sock != sock || !timerisset(&dev->retrans.deadline))
+			continue;
+
+		if (!timerisset(tv) || timercmp(&dev->retrans.deadline, tv, <))
+			*tv = dev->retrans.deadline;
+	}
+	return timerisset(tv) ? 0 : -1;
+}
+
+static void
+ni_dhcp6_shared_socket_check_timeout(ni_socket_t *sock, const struct timeval *now)
+{
+	ni_dhcp6_device_t *dev, *next;
+
+	for (dev = ni_dhcp6_active; dev; dev = next) {
+		next = dev->next;
+
+		if (dev->mcast.sock != sock || !timerisset(&dev->retrans.deadline))
+			continue;
+
+		if (timercmp(&dev->retrans.deadline, now, <))
+			ni_dhcp6_device_retransmit(dev);
+	}
+}
+
 static int
 ni_dhcp6_socket_get_timeout(const ni_socket_t *sock, struct timeval *tv)
 {
 	ni_dhcp6_device_t * dev = sock->user_data;
+
+	if (sock == ni_dhcp6_shared.sock)
+		return ni_dhcp6_shared_socket_get_timeout(sock, tv);
+
 	if( !(dev = sock->user_data)) {
 		ni_error("check_timeout: socket without capture object?!");
 		return -1;
@@ -442,6 +650,11 @@ ni_dhcp6_socket_check_timeout(ni_socket_t *sock, const struct timeval *now)
 	ni_dhcp6_device_t * dev;
 	struct tm;
 
+	if (sock == ni_dhcp6_shared.sock) {
+		ni_dhcp6_shared_socket_check_timeout(sock, now);
+		return;
+	}
+
 	if (!(dev = sock->user_data)) {
 		ni_error("check_timeout: socket without device object?!");
 		return;
@@ -1169,30 +1382,20 @@ ni_dhcp6_option_request_destroy(ni_dhcp6_option_request_t *ora)
 }
 
 static ni_bool_t
-ni_dhcp6_option_request_realloc(ni_dhcp6_option_request_t *ora, unsigned int newsize)
+ni_dhcp6_option_request_realloc(ni_dhcp6_option_request_t *ora, unsigned int newcount)
 {
-	unsigned int i;
-	uint16_t *options;
-
 	if (!ora)
 		return FALSE;
 
-	newsize += NI_DHCP6_OPTION_REQUEST_CHUNK;
-	options = xrealloc(ora->options, newsize * sizeof(uint16_t));
-	if (!options)
-		return FALSE;
-
-	ora->options = options;
-	for (i = ora->count; i < newsize; ++i)
-		ora->options[i] = 0;
-	return TRUE;
+	return ni_array_grow((void **)&ora->options, sizeof(uint16_t),
+				ora->count, newcount, NI_DHCP6_OPTION_REQUEST_CHUNK);
 }
 
 ni_bool_t
 ni_dhcp6_option_request_append(ni_dhcp6_option_request_t *ora, uint16_t option)
 {
-	if ((ora->count % NI_DHCP6_OPTION_REQUEST_CHUNK) == 0 &&
-	    !ni_dhcp6_option_request_realloc(ora, ora->count))
+	if (ora->count == UINT_MAX ||
+	    !ni_dhcp6_option_request_realloc(ora, ora->count + 1))
 		return FALSE;
 
 	ora->options[ora->count++] = htons(option);
@@ -2789,6 +2992,155 @@ ni_dhcp6_lease_set_nis_info(ni_addrconf_lease_t *lease, const ni_string_array_t
 	return 0;
 }
 
+/*
+ * Allocation-free pre-scan of the client message options.
+ *
+ * Walks a copy of the option buffer in place, records the identifiers
+ * and the few values needed to decide whether an offer is worth to be
+ * considered at all, and an upper bound of the addresses it provides.
+ * The caller materializes the lease via ni_dhcp6_parse_client_options
+ * only when the message passed this check.
+ */
+static unsigned int
+ni_dhcp6_scan_ia_options(ni_buffer_t *bp, unsigned int type)
+{
+	unsigned int count = 0;
+	uint16_t code;
+
+	while (ni_buffer_count(bp) && !bp->underflow) {
+		ni_buffer_t optbuf;
+		int option;
+
+		ni_buffer_init(&optbuf, NULL, 0);
+		option = ni_dhcp6_option_next(bp, &optbuf);
+		if (option <= 0)
+			break;
+
+		switch (option) {
+		case NI_DHCP6_OPTION_IA_ADDRESS:
+			if (type != NI_DHCP6_OPTION_IA_PD)
+				count++;
+		break;
+		case NI_DHCP6_OPTION_IA_PREFIX:
+			if (type == NI_DHCP6_OPTION_IA_PD)
+				count++;
+		break;
+		case NI_DHCP6_OPTION_STATUS_CODE:
+			if (ni_dhcp6_option_get16(&optbuf, &code) == 0 &&
+			    code != NI_DHCP6_STATUS_SUCCESS)
+				return 0;
+		break;
+		default:
+		break;
+		}
+	}
+	return count;
+}
+
+static unsigned int
+ni_dhcp6_scan_ia(ni_buffer_t *bp, unsigned int type)
+{
+	uint32_t iaid, t1 = 0, t2 = 0;
+
+	if (ni_dhcp6_option_get32(bp, &iaid) < 0)
+		return 0;
+
+	if (type != NI_DHCP6_OPTION_IA_TA) {
+		if (ni_dhcp6_option_get32(bp, &t1) < 0 ||
+		    ni_dhcp6_option_get32(bp, &t2) < 0)
+			return 0;
+
+		/* discarded by the parser, see rfc3315#section-22.4 */
+		if (t1 && t2 && t1 > t2)
+			return 0;
+	}
+
+	return ni_dhcp6_scan_ia_options(bp, type);
+}
+
+int
+ni_dhcp6_scan_client_options(ni_dhcp6_device_t *dev, const ni_buffer_t *buffer,
+				ni_dhcp6_message_scan_t *scan)
+{
+	ni_buffer_t options;
+	unsigned int count;
+
+	if (!dev || !buffer || !scan)
+		return -1;
+
+	memset(scan, 0, sizeof(*scan));
+	options = *buffer;
+
+	while (ni_buffer_count(&options) && !options.underflow) {
+		ni_buffer_t optbuf;
+		int option;
+
+		ni_buffer_init(&optbuf, NULL, 0);
+		option = ni_dhcp6_option_next(&options, &optbuf);
+		if (option < 0)
+			return -1;
+
+		if (option == 0)
+			break;
+
+		switch (option) {
+		case NI_DHCP6_OPTION_CLIENTID:
+			ni_dhcp6_option_get_duid(&optbuf, &scan->client_id);
+		break;
+		case NI_DHCP6_OPTION_SERVERID:
+			ni_dhcp6_option_get_duid(&optbuf, &scan->server_id);
+		break;
+		case NI_DHCP6_OPTION_PREFERENCE:
+			ni_dhcp6_option_get8(&optbuf, &scan->server_pref);
+		break;
+		case NI_DHCP6_OPTION_SOL_MAX_RT:
+			if (dev->fsm.state != NI_DHCP6_STATE_REQUESTING_INFO &&
+			    ni_dhcp6_option_get32(&optbuf, &scan->max_rt) == 0) {
+				if (scan->max_rt < NI_DHCP6_SOL_MAX_RT_MIN ||
+				    scan->max_rt > NI_DHCP6_SOL_MAX_RT_MAX)
+					scan->max_rt = 0;
+			}
+		break;
+		case NI_DHCP6_OPTION_INF_MAX_RT:
+			if (dev->fsm.state == NI_DHCP6_STATE_REQUESTING_INFO &&
+			    ni_dhcp6_option_get32(&optbuf, &scan->max_rt) == 0) {
+				if (scan->max_rt < NI_DHCP6_INF_MAX_RT_MIN ||
+				    scan->max_rt > NI_DHCP6_INF_MAX_RT_MAX)
+					scan->max_rt = 0;
+			}
+		break;
+		case NI_DHCP6_OPTION_STATUS_CODE:
+			if (ni_dhcp6_option_get16(&optbuf, &scan->status.code) == 0) {
+				scan->status.valid = TRUE;
+				scan->status.message = ni_buffer_head(&optbuf);
+				scan->status.len = ni_buffer_count(&optbuf);
+				if (scan->status.len && !ni_check_printable(
+						scan->status.message, scan->status.len))
+					scan->status.len = 0;
+			}
+		break;
+		case NI_DHCP6_OPTION_RAPID_COMMIT:
+			if (ni_buffer_count(&optbuf) == 0)
+				scan->rapid_commit = TRUE;
+		break;
+		case NI_DHCP6_OPTION_IA_NA:
+			count = ni_dhcp6_scan_ia(&optbuf, option);
+			if (dev->config->mode & NI_BIT(NI_DHCP6_MODE_MANAGED))
+				scan->iadrs += count;
+		break;
+		case NI_DHCP6_OPTION_IA_PD:
+			count = ni_dhcp6_scan_ia(&optbuf, option);
+			if (dev->config->mode & NI_BIT(NI_DHCP6_MODE_PREFIX))
+				scan->iadrs += count;
+		break;
+		default:
+		break;
+		}
+	}
+
+	return options.underflow ? -1 : 0;
+}
+
 int
 ni_dhcp6_parse_client_options(ni_dhcp6_device_t *dev, ni_dhcp6_message_t *msg, ni_buffer_t *buffer)
 {
@@ -222,6 +222,25 @@ typedef struct ni_dhcp6_message {
 	ni_addrconf_lease_t *		lease;
 } ni_dhcp6_message_t;
 
+/*
+ * Result of the allocation-free option pre-scan;
+ * the status message points into the scanned buffer.
+ */
+typedef struct ni_dhcp6_message_scan {
+	ni_opaque_t			client_id;
+	ni_opaque_t			server_id;
+	uint8_t				server_pref;
+	unsigned int			max_rt;
+	ni_bool_t			rapid_commit;
+	struct {
+		ni_bool_t		valid;
+		uint16_t		code;
+		const char *		message;
+		size_t			len;
+	}				status;
+	unsigned int			iadrs;
+} ni_dhcp6_message_scan_t;
+
 /*
  * DHCPv6 specific FQDN option bits/flags
  * https://tools.ietf.org/html/rfc4704#section-4.1
@@ -259,10 +278,13 @@ extern int		ni_dhcp6_parse_client_header(ni_dhcp6_message_t *msg, ni_buffer_t *m
 extern int		ni_dhcp6_check_client_header(ni_dhcp6_device_t *dev, ni_dhcp6_message_t *msg);
 extern int		ni_dhcp6_parse_client_options(ni_dhcp6_device_t *dev, ni_dhcp6_message_t *msg,
 							ni_buffer_t *optbuf);
+extern int		ni_dhcp6_scan_client_options(ni_dhcp6_device_t *dev, const ni_buffer_t *optbuf,
+							ni_dhcp6_message_scan_t *scan);
 
 extern int		ni_dhcp6_mcast_socket_open(ni_dhcp6_device_t *);
 extern void		ni_dhcp6_mcast_socket_close(ni_dhcp6_device_t *);
-extern ssize_t		ni_dhcp6_socket_send(ni_socket_t *, const ni_buffer_t *, const ni_sockaddr_t *);
+extern ssize_t		ni_dhcp6_socket_send(ni_socket_t *, const ni_buffer_t *, const ni_sockaddr_t *,
+						const struct ni_dhcp6_link *);
 
 
 /* FIXME: cleanup */
@@ -69,8 +69,27 @@ struct ni_duid_map {
 	int		fd;
 	char *		file;
 	struct flock	flock;
+
+	ni_bool_t	resident;
+	ni_bool_t	dirty;
 };
 
+/*
+ * Resident copy of the default duid map file of the process.
+ *
+ * As the iaid map, the parsed document is kept as long as the status
+ * of the shared map file shows that no other process changed it since,
+ * so the dhcp supplicants do not re-parse it for each device and the
+ * lookup of an existing duid does not need to lock the file.
+ */
+typedef struct ni_duid_map_resident {
+	char *		file;
+	struct stat	stb;
+	xml_document_t *doc;
+} ni_duid_map_resident_t;
+
+static ni_duid_map_resident_t	ni_duid_map_resident;
+
 /*
  * compiler (gcc) specific ...
  */
@@ -515,6 +534,66 @@ ni_duid_create(ni_opaque_t *duid, uint16_t type, ni_netconfig_t *nc, const ni_ne
 	return FALSE;
 }
 
+static ni_bool_t
+ni_duid_map_stat_equal(const struct stat *a, const struct stat *b)
+{
+	return a->st_dev == b->st_dev && a->st_ino == b->st_ino &&
+		a->st_size == b->st_size &&
+		a->st_mtim.tv_sec == b->st_mtim.tv_sec &&
+		a->st_mtim.tv_nsec == b->st_mtim.tv_nsec &&
+		a->st_ctim.tv_sec == b->st_ctim.tv_sec &&
+		a->st_ctim.tv_nsec == b->st_ctim.tv_nsec;
+}
+
+static xml_document_t *
+ni_duid_map_resident_adopt(const char *file, int fd)
+{
+	ni_duid_map_resident_t *res = &ni_duid_map_resident;
+	xml_document_t *doc;
+	struct stat stb;
+
+	if (!res->doc || !ni_string_eq(res->file, file) ||
+	    fstat(fd, &stb) < 0 || !ni_duid_map_stat_equal(&stb, &res->stb))
+		return NULL;
+
+	doc = res->doc;
+	res->doc = NULL;
+	return doc;
+}
+
+static void
+ni_duid_map_resident_update(ni_duid_map_t *map)
+{
+	ni_duid_map_resident_t *res = &ni_duid_map_resident;
+	struct stat stb;
+
+	xml_document_free(res->doc);
+	res->doc = NULL;
+
+	if (map->dirty || !map->doc || fstat(map->fd, &stb) < 0) {
+		ni_string_free(&res->file);
+		return;
+	}
+
+	ni_string_dup(&res->file, map->file);
+	res->stb = stb;
+	res->doc = map->doc;
+	map->doc = NULL;
+}
+
+static xml_document_t *
+ni_duid_map_resident_doc(void)
+{
+	ni_duid_map_resident_t *res = &ni_duid_map_resident;
+	struct stat stb;
+
+	if (!res->doc || stat(res->file, &stb) < 0 ||
+	    !ni_duid_map_stat_equal(&stb, &res->stb))
+		return NULL;
+
+	return res->doc;
+}
+
 static ni_duid_map_t *
 ni_duid_map_new(void)
 {
@@ -571,6 +650,9 @@ void
 ni_duid_map_free(ni_duid_map_t *map)
 {
 	if (map) {
+		if (map->resident && map->fd >= 0)
+			ni_duid_map_resident_update(map);
+
 		if (map->fd >= 0) {
 			ni_duid_map_unlock(map);
 			close(map->fd);
@@ -640,6 +722,7 @@ ni_duid_map_load(const char *filename)
 		}
 	} else {
 		type = "default";
+		map->resident = TRUE;
 		if (!ni_duid_map_set_default_file(&map->file)) {
 			ni_error("unable to construct %s duid map file name: %m", type);
 			goto failure;
@@ -666,6 +749,9 @@ ni_duid_map_load(const char *filename)
 		goto failure;
 	}
 
+	if (map->resident && (map->doc = ni_duid_map_resident_adopt(map->file, map->fd)))
+		return map;
+
 	if (fstat(map->fd, &stb) < 0)
 		stb.st_size = BUFSIZ;
 
@@ -730,7 +816,11 @@ ni_duid_map_save(ni_duid_map_t *map)
 	}
 	free(data);
 
-	return ret < 0 ? FALSE : TRUE;
+	if (ret < 0)
+		return FALSE;
+
+	map->dirty = FALSE;
+	return TRUE;
 }
 
 static xml_node_t *
@@ -747,13 +837,13 @@ ni_duid_map_next_node(const xml_node_t *root, const xml_node_t *last)
 	return xml_node_get_next_child(root, NI_CONFIG_DEFAULT_DUID_NODE, last);
 }
 
-ni_bool_t
-ni_duid_map_get_duid(ni_duid_map_t *map, const char *name, const char **hex, ni_opaque_t *raw)
+static ni_bool_t
+ni_duid_map_doc_get_duid(xml_document_t *doc, const char *name, const char **hex, ni_opaque_t *raw)
 {
 	xml_node_t *root, *node = NULL;
 	const char *attr;
 
-	if (!(root = ni_duid_map_root_node(map)) || !(hex || raw))
+	if (!doc || !(root = xml_document_root(doc)) || !(hex || raw))
 		return FALSE;
 
 	while ((node = ni_duid_map_next_node(root, node))) {
@@ -773,6 +863,12 @@ ni_duid_map_get_duid(ni_duid_map_t *map, const char *name, const char **hex, ni_
 	return FALSE;
 }
 
+ni_bool_t
+ni_duid_map_get_duid(ni_duid_map_t *map, const char *name, const char **hex, ni_opaque_t *raw)
+{
+	return map && ni_duid_map_doc_get_duid(map->doc, name, hex, raw);
+}
+
 ni_bool_t
 ni_duid_map_get_name(ni_duid_map_t *map, const char *duid, const char **name)
 {
@@ -809,12 +905,14 @@ ni_duid_map_set(ni_duid_map_t *map, const char *name, const char *duid)
 			continue;
 
 		xml_node_set_cdata(node, duid);
+		map->dirty = TRUE;
 		return TRUE;
 	}
 	if ((node = xml_node_new(NI_CONFIG_DEFAULT_DUID_NODE, root))) {
 		if (!ni_string_empty(name))
 			xml_node_add_attr(node, NI_CONFIG_DEFAULT_DUID_DEVICE, name);
 		xml_node_set_cdata(node, duid);
+		map->dirty = TRUE;
 		return TRUE;
 	}
 	return FALSE;
@@ -836,6 +934,7 @@ ni_duid_map_del(ni_duid_map_t *map, const char *name)
 
 		xml_node_detach(node);
 		xml_node_free(node);
+		map->dirty = TRUE;
 		return TRUE;
 	}
 	return FALSE;
@@ -861,6 +960,40 @@ ni_duid_map_to_vars(ni_duid_map_t *map, ni_var_array_t *vars)
 	return TRUE;
 }
 
+/*
+ * Lookup of a duid in the resident map without to lock the map file.
+ * Succeeds only when the duid ni_duid_acquire would use is in the map
+ * already, otherwise the acquire takes the locked path to update it.
+ */
+static ni_bool_t
+ni_duid_acquire_resident(ni_opaque_t *duid, const ni_netdev_t *dev,
+			const ni_config_dhcp6_t *conf, const char *requested)
+{
+	const char *scope = NULL;
+	const char *hex = NULL;
+	xml_document_t *doc;
+
+	if (!(doc = ni_duid_map_resident_doc()))
+		return FALSE;
+
+	if (requested && ni_duid_parse_hex(duid, requested))
+		return ni_duid_map_doc_get_duid(doc, dev->name, &hex, NULL) &&
+			ni_string_eq(hex, requested);
+
+	if (conf->device_duid)
+		scope = dev->name;
+
+	if (ni_duid_map_doc_get_duid(doc, scope, &hex, duid))
+		return TRUE;
+
+	requested = conf->default_duid;
+	if (requested && ni_duid_parse_hex(duid, requested))
+		return ni_duid_map_doc_get_duid(doc, scope, &hex, NULL) &&
+			ni_string_eq(hex, requested);
+
+	return FALSE;
+}
+
 ni_bool_t
 ni_duid_acquire(ni_opaque_t *duid, const ni_netdev_t *dev, ni_netconfig_t *nc, const char *requested)
 {
@@ -875,6 +1008,9 @@ ni_duid_acquire(ni_opaque_t *duid, const ni_netdev_t *dev, ni_netconfig_t *nc, c
 	if (!(conf = ni_config_dhcp6_find_device(dev->name)))
 		return FALSE;
 
+	if (ni_duid_acquire_resident(duid, dev, conf, requested))
+		return TRUE;
+
 	if (!(map = ni_duid_map_load(NULL)))
 		return FALSE;
 
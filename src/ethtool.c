@@ -27,13 +27,25 @@
 
 #include <net/if_arp.h>
 #include <linux/ethtool.h>
+#ifdef HAVE_LINUX_ETHTOOL_NETLINK_H
+#include <linux/genetlink.h>
+#include <linux/ethtool_netlink.h>
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#endif
 #include <errno.h>
 
 #include <wicked/util.h>
 #include <wicked/ethtool.h>
+#include <wicked/socket.h>
 #include "netinfo_priv.h"
+#include "socket_priv.h"
 #include "util_priv.h"
+#include "array_priv.h"
 #include "kernel.h"
+#include "netns.h"
+#include "worker.h"
 
 /*
  * support mask to not repeat ioctl
@@ -234,6 +246,119 @@ ni_ethtool_get_gstrings(const ni_netdev_ref_t *ref, const char *hint, unsigned i
 	return gstrings;
 }
 
+/*
+ * The gstring sets are the same for all devices using the same
+ * driver, version and firmware, so they are cached per driver and
+ * the ioctls are issued only for the first device using them.
+ */
+typedef struct ni_ethtool_gstrings_cache	ni_ethtool_gstrings_cache_t;
+struct ni_ethtool_gstrings_cache {
+	ni_ethtool_gstrings_cache_t *	next;
+
+	char *				driver;
+	char *				version;
+	char *				fw_version;
+	unsigned int			sset;
+	struct ethtool_gstrings *	gstrings;
+};
+
+static ni_ethtool_gstrings_cache_t *	ni_ethtool_gstrings_cache_list;
+
+static inline ni_bool_t
+ni_ethtool_gstrings_cache_key(const ni_ethtool_t *ethtool)
+{
+	return ethtool && ethtool->driver_info &&
+		!ni_string_empty(ethtool->driver_info->driver);
+}
+
+static ni_ethtool_gstrings_cache_t *
+ni_ethtool_gstrings_cache_find(const ni_ethtool_t *ethtool, unsigned int sset)
+{
+	const ni_ethtool_driver_info_t *info;
+	ni_ethtool_gstrings_cache_t *entry;
+
+	if (!ni_ethtool_gstrings_cache_key(ethtool))
+		return NULL;
+
+	info = ethtool->driver_info;
+	for (entry = ni_ethtool_gstrings_cache_list; entry; entry = entry->next) {
+		if (entry->sset == sset &&
+		    ni_string_eq(entry->driver, info->driver) &&
+		    ni_string_eq(entry->version, info->version) &&
+		    ni_string_eq(entry->fw_version, info->fw_version))
+			return entry;
+	}
+	return NULL;
+}
+
+static struct ethtool_gstrings *
+ni_ethtool_gstrings_dup(const struct ethtool_gstrings *gstrings)
+{
+	struct ethtool_gstrings *copy;
+	size_t size;
+
+	size = sizeof(*gstrings) + gstrings->len * ETH_GSTRING_LEN;
+	if ((copy = malloc(size)))
+		memcpy(copy, gstrings, size);
+	return copy;
+}
+
+static void
+ni_ethtool_gstrings_cache_add(const ni_ethtool_t *ethtool, unsigned int sset,
+		const struct ethtool_gstrings *gstrings)
+{
+	const ni_ethtool_driver_info_t *info;
+	ni_ethtool_gstrings_cache_t *entry;
+
+	if (!ni_ethtool_gstrings_cache_key(ethtool) || ni_ethtool_gstrings_cache_find(ethtool, sset))
+		return;
+
+	if (!(entry = calloc(1, sizeof(*entry))))
+		return;
+
+	if (!(entry->gstrings = ni_ethtool_gstrings_dup(gstrings))) {
+		free(entry);
+		return;
+	}
+
+	info = ethtool->driver_info;
+	entry->sset = sset;
+	ni_string_dup(&entry->driver, info->driver);
+	ni_string_dup(&entry->version, info->version);
+	ni_string_dup(&entry->fw_version, info->fw_version);
+
+	entry->next = ni_ethtool_gstrings_cache_list;
+	ni_ethtool_gstrings_cache_list = entry;
+}
+
+static unsigned int
+ni_ethtool_get_gstring_count_cached(const ni_netdev_ref_t *ref, const ni_ethtool_t *ethtool,
+		const char *hint, unsigned int sset)
+{
+	ni_ethtool_gstrings_cache_t *entry;
+
+	if ((entry = ni_ethtool_gstrings_cache_find(ethtool, sset)))
+		return entry->gstrings->len;
+
+	return ni_ethtool_get_gstring_count(ref, hint, sset);
+}
+
+static struct ethtool_gstrings *
+ni_ethtool_get_gstrings_cached(const ni_netdev_ref_t *ref, const ni_ethtool_t *ethtool,
+		const char *hint, unsigned int sset, unsigned int count)
+{
+	ni_ethtool_gstrings_cache_t *entry;
+	struct ethtool_gstrings *gstrings;
+
+	if ((entry = ni_ethtool_gstrings_cache_find(ethtool, sset)) && entry->gstrings->len == count)
+		return ni_ethtool_gstrings_dup(entry->gstrings);
+
+	if ((gstrings = ni_ethtool_get_gstrings(ref, hint, sset, count)) && gstrings->len == count)
+		ni_ethtool_gstrings_cache_add(ethtool, sset, gstrings);
+
+	return gstrings;
+}
+
 
 /*
  * driver-info (GDRVINFO)
@@ -401,7 +526,7 @@ ni_ethtool_get_priv_flags_names(const ni_netdev_ref_t *ref, ni_ethtool_t *ethtoo
 	ni_stringbuf_t buf;
 	const char *name;
 
-	count = ni_ethtool_get_gstring_count(ref, " priv-flags count", ETH_SS_PRIV_FLAGS);
+	count = ni_ethtool_get_gstring_count_cached(ref, ethtool, " priv-flags count", ETH_SS_PRIV_FLAGS);
 	if (!count) {
 		if (errno == EOPNOTSUPP && ethtool->driver_info)
 			count = ethtool->driver_info->supports.n_priv_flags;
@@ -413,7 +538,7 @@ ni_ethtool_get_priv_flags_names(const ni_netdev_ref_t *ref, ni_ethtool_t *ethtoo
 	}
 	if (count > 32)
 		count = 32;
-	gstrings = ni_ethtool_get_gstrings(ref, " priv-flags names", ETH_SS_PRIV_FLAGS, count);
+	gstrings = ni_ethtool_get_gstrings_cached(ref, ethtool, " priv-flags names", ETH_SS_PRIV_FLAGS, count);
 	if (!gstrings) {
 		if (errno == EOPNOTSUPP)
 			ni_ethtool_set_supported(ethtool, NI_ETHTOOL_SUPP_GET_PRIV_FLAGS, FALSE);
@@ -776,6 +901,7 @@ static const ni_intmap_t		ni_ethtool_link_adv_speed_names[] = {
 
 	{ NULL,			-1U							}
 };
+static ni_intmap_index_t	ni_ethtool_link_adv_speed_index = NI_INTMAP_INDEX_INIT(ni_ethtool_link_adv_speed_names);
 static const ni_intmap_t		ni_ethtool_link_adv_autoneg_names[] = {
 	{ "Autoneg",			ETHTOOL_LINK_MODE_Autoneg_BIT			},
 
@@ -881,13 +1007,13 @@ ni_ethtool_link_adv_port_type(const char *name, unsigned int *type)
 const char *
 ni_ethtool_link_adv_speed_name(unsigned int type)
 {
-	return ni_format_uint_mapped(type, ni_ethtool_link_adv_speed_names);
+	return ni_intmap_index_format(&ni_ethtool_link_adv_speed_index, type);
 }
 
 ni_bool_t
 ni_ethtool_link_adv_speed_type(const char *name, unsigned int *type)
 {
-	return ni_parse_uint_mapped(name, ni_ethtool_link_adv_speed_names, type) == 0;
+	return ni_intmap_index_parse(&ni_ethtool_link_adv_speed_index, name, type) == 0;
 }
 
 const char *
@@ -1241,36 +1367,36 @@ ni_ethtool_set_advertise(ni_bitfield_t *adv, const ni_bitfield_t *sup,
 		const ni_bitfield_t *old, const ni_netdev_ref_t *ref,
 		const ni_ethtool_link_settings_t *cfg)
 {
+	ni_bitfield_t diff = NI_BITFIELD_INIT;
 	ni_bitfield_t tmp = NI_BITFIELD_INIT;
 	ni_bitfield_t flg = NI_BITFIELD_INIT;
 	unsigned int bit, bits;
-	ni_bool_t want, have;
 	const char *modify;
 	const char *name;
 	char *hex = NULL;
+	ni_bool_t want;
 
 	ni_ethtool_set_adv_flags_bitfield(&flg);
-	if ((bits = ni_bitfield_bits(&cfg->advertising))) {
+	if (ni_bitfield_bits(&cfg->advertising)) {
 		/* inform or clear unsupported custom advertise modes */
 
-		for (bit = 0; bit < bits; ++bit) {
-			/* ignore requested non-mode flags... */
-			if (ni_bitfield_testbit(&flg, bit))
-				continue;
-
-			/* do we have to change this mode?    */
+		/* the modes we have to change, ignoring requested non-mode flags */
+		ni_bitfield_copy(&diff, &cfg->advertising);
+		ni_bitfield_xor(&diff, old);
+		ni_bitfield_andnot(&diff, &flg);
+
+		/* keep the unchanged modes as they are */
+		ni_bitfield_copy(&tmp, old);
+		ni_bitfield_andnot(&tmp, &diff);
+		ni_bitfield_andnot(&tmp, &flg);
+		ni_bitfield_or(adv, &tmp);
+		ni_bitfield_destroy(&tmp);
+
+		bits = ni_bitfield_bits(&diff);
+		for (bit = ni_bitfield_next_set(&diff, 0); bit < bits;
+		     bit = ni_bitfield_next_set(&diff, bit + 1)) {
 			want   = ni_bitfield_testbit(&cfg->advertising, bit);
-			have   = ni_bitfield_testbit(old, bit);
-			modify = NULL;
-			if (want && !have)
-				modify = "enable";
-			else
-			if (have && !want)
-				modify = "disable";
-			else {
-				ni_bitfield_turnbit(adv, bit, have);
-				continue;
-			}
+			modify = want ? "enable" : "disable";
 
 			/* get the name or hex value of it */
 			if (!(name = ni_ethtool_link_adv_name(bit))) {
@@ -1298,20 +1424,14 @@ ni_ethtool_set_advertise(ni_bitfield_t *adv, const ni_bitfield_t *sup,
 		/* no custom advertise, try to set from speed and duplex */
 		ni_ethtool_set_adv_by_speed(adv, cfg->speed, cfg->duplex);
 
+		ni_bitfield_copy(&diff, adv);
+		ni_bitfield_xor(&diff, old);
+
 		bits = ni_bitfield_bits(adv);
-		for (bit = 0; bit < bits; ++bit) {
+		for (bit = ni_bitfield_next_set(&diff, 0); bit < bits;
+		     bit = ni_bitfield_next_set(&diff, bit + 1)) {
 			want   = ni_bitfield_testbit(adv, bit);
-			have   = ni_bitfield_testbit(old, bit);
-			modify = NULL;
-			if (want && !have)
-				modify = "enable";
-			else
-			if (have && !want)
-				modify = "disable";
-			else {
-				ni_bitfield_turnbit(adv, bit, have);
-				continue;
-			}
+			modify = want ? "enable" : "disable";
 
 			if (!(name = ni_ethtool_link_adv_name(bit))) {
 				ni_bitfield_setbit(&tmp, bit);
@@ -1334,6 +1454,8 @@ ni_ethtool_set_advertise(ni_bitfield_t *adv, const ni_bitfield_t *sup,
 			ni_string_free(&hex);
 		}
 	}
+	ni_bitfield_destroy(&diff);
+	ni_bitfield_destroy(&flg);
 
 	if (!ni_bitfield_isset(adv)) {
 		/* no advertise mode bits set yet, enable all supported */
@@ -1547,16 +1669,72 @@ ni_ethtool_set_link_settings_legacy(const ni_netdev_ref_t *ref, ni_ethtool_t *et
 /*
  * Link settings (GLINKSETTINGS,SLINKSETTINGS)
  */
+typedef struct ni_ethtool_link_settings_cmd {
+	struct ethtool_link_settings settings;
+	uint32_t link_mode_maps[SCHAR_MAX * 3];
+} ni_ethtool_link_settings_cmd_t;
+
+static ni_ethtool_link_settings_t *
+ni_ethtool_link_settings_parse(const ni_ethtool_link_settings_cmd_t *ecmd)
+{
+	ni_ethtool_link_settings_t *link;
+
+	if (!(link = ni_ethtool_link_settings_new()))
+		return NULL;
+
+	link->autoneg   = ecmd->settings.autoneg == AUTONEG_ENABLE;
+	link->port      = ecmd->settings.port;
+	link->speed     = ecmd->settings.speed;
+	link->duplex    = ecmd->settings.duplex;
+
+	if (link->port == NI_ETHTOOL_PORT_TP) {
+		ni_ethtool_get_link_settings_map_mdix(link,
+				ecmd->settings.eth_tp_mdix_ctrl,
+				ecmd->settings.eth_tp_mdix);
+	}
+
+	link->transceiver  = ecmd->settings.transceiver;
+	link->phy_address  = ecmd->settings.phy_address;
+	link->mdio_support = ecmd->settings.mdio_support;
+
+	if (ecmd->settings.link_mode_masks_nwords > 0) {
+		size_t len, off;
+
+		link->nwords = ecmd->settings.link_mode_masks_nwords;
+		len = link->nwords * sizeof(uint32_t);
+
+		off = 0;
+		if (ni_ethtool_get_link_settings_adv_isset(link->nwords,
+					&ecmd->link_mode_maps[off])) {
+			ni_bitfield_set_data(&link->supported,
+					&ecmd->link_mode_maps[off], len);
+		}
+
+		off += link->nwords;
+		if (ni_ethtool_get_link_settings_adv_isset(link->nwords,
+					&ecmd->link_mode_maps[off])) {
+			ni_bitfield_set_data(&link->advertising,
+				&ecmd->link_mode_maps[off], len);
+		}
+
+		off += link->nwords;
+		if (ni_ethtool_get_link_settings_adv_isset(link->nwords,
+					&ecmd->link_mode_maps[off])) {
+			ni_bitfield_set_data(&link->lp_advertising,
+				&ecmd->link_mode_maps[off], len);
+		}
+	}
+
+	return link;
+}
+
 static int
 ni_ethtool_get_link_settings_current(const ni_netdev_ref_t *ref, ni_ethtool_t *ethtool)
 {
 	static const ni_ethtool_cmd_info_t NI_ETHTOOL_CMD_GLINKSETINGS = {
 		ETHTOOL_GLINKSETTINGS,	"get link settings"
 	};
-	struct {
-		struct ethtool_link_settings settings;
-		uint32_t link_mode_maps[SCHAR_MAX * 3];
-	} ecmd;
+	ni_ethtool_link_settings_cmd_t ecmd;
 	ni_ethtool_link_settings_t *link;
 	int ret;
 
@@ -1588,52 +1766,9 @@ ni_ethtool_get_link_settings_current(const ni_netdev_ref_t *ref, ni_ethtool_t *e
 			return ret;
 	}
 
-	if (!(link = ni_ethtool_link_settings_new()))
+	if (!(link = ni_ethtool_link_settings_parse(&ecmd)))
 		return -ENOMEM;
 
-	link->autoneg   = ecmd.settings.autoneg == AUTONEG_ENABLE;
-	link->port      = ecmd.settings.port;
-	link->speed     = ecmd.settings.speed;
-	link->duplex    = ecmd.settings.duplex;
-
-	if (link->port == NI_ETHTOOL_PORT_TP) {
-		ni_ethtool_get_link_settings_map_mdix(link,
-				ecmd.settings.eth_tp_mdix_ctrl,
-				ecmd.settings.eth_tp_mdix);
-	}
-
-	link->transceiver  = ecmd.settings.transceiver;
-	link->phy_address  = ecmd.settings.phy_address;
-	link->mdio_support = ecmd.settings.mdio_support;
-
-	if (ecmd.settings.link_mode_masks_nwords > 0) {
-		size_t len, off;
-
-		link->nwords = ecmd.settings.link_mode_masks_nwords;
-		len = link->nwords * sizeof(uint32_t);
-
-		off = 0;
-		if (ni_ethtool_get_link_settings_adv_isset(link->nwords,
-					&ecmd.link_mode_maps[off])) {
-			ni_bitfield_set_data(&link->supported,
-					&ecmd.link_mode_maps[off], len);
-		}
-
-		off += link->nwords;
-		if (ni_ethtool_get_link_settings_adv_isset(link->nwords,
-					&ecmd.link_mode_maps[off])) {
-			ni_bitfield_set_data(&link->advertising,
-				&ecmd.link_mode_maps[off], len);
-		}
-
-		off += link->nwords;
-		if (ni_ethtool_get_link_settings_adv_isset(link->nwords,
-					&ecmd.link_mode_maps[off])) {
-			ni_bitfield_set_data(&link->lp_advertising,
-				&ecmd.link_mode_maps[off], len);
-		}
-	}
-
 	ethtool->link_settings = link;
 	return 0;
 }
@@ -1648,10 +1783,7 @@ ni_ethtool_set_link_settings_current(const ni_netdev_ref_t *ref, ni_ethtool_t *e
 	static const ni_ethtool_cmd_info_t NI_ETHTOOL_CMD_SLINKSETINGS = {
 		ETHTOOL_SLINKSETTINGS,	"set link settings"
 	};
-	struct {
-		struct ethtool_link_settings settings;
-		uint32_t link_mode_maps[SCHAR_MAX * 3];
-	} ecmd;
+	ni_ethtool_link_settings_cmd_t ecmd;
 	ni_bitfield_t adv = NI_BITFIELD_INIT;
 	ni_bitfield_t sup = NI_BITFIELD_INIT;
 	ni_bitfield_t old = NI_BITFIELD_INIT;
@@ -2276,23 +2408,13 @@ ni_ethtool_features_new(void)
 #define NI_ETHTOOL_FEATURE_ARRAY_CHUNK		16
 
 static inline ni_bool_t
-ni_ethtool_features_realloc(ni_ethtool_features_t *features, unsigned int newsize)
+ni_ethtool_features_realloc(ni_ethtool_features_t *features, unsigned int newcount)
 {
-	ni_ethtool_feature_t **newdata;
-	unsigned int i;
-
-	if (!features || (UINT_MAX - NI_ETHTOOL_FEATURE_ARRAY_CHUNK) <= newsize)
-		return FALSE;
-
-	newsize = (newsize + NI_ETHTOOL_FEATURE_ARRAY_CHUNK);
-	newdata = realloc(features->data, newsize * sizeof(*newdata));
-	if (!newdata)
+	if (!features)
 		return FALSE;
 
-	features->data = newdata;
-	for (i = features->count; i < newsize; ++i)
-		features->data[i] = NULL;
-	return TRUE;
+	return ni_array_grow((void **)&features->data, sizeof(ni_ethtool_feature_t *),
+				features->count, newcount, NI_ETHTOOL_FEATURE_ARRAY_CHUNK);
 }
 
 static ni_bool_t
@@ -2301,8 +2423,8 @@ ni_ethtool_features_add(ni_ethtool_features_t *features, ni_ethtool_feature_t *f
 	if (!features || !feature)
 		return FALSE;
 
-	if ((features->count % NI_ETHTOOL_FEATURE_ARRAY_CHUNK) == 0 &&
-	    !ni_ethtool_features_realloc(features, features->count))
+	if (features->count == UINT_MAX ||
+	    !ni_ethtool_features_realloc(features, features->count + 1))
 		return FALSE;
 
 	features->data[features->count++] = feature;
@@ -2357,15 +2479,15 @@ ni_ethtool_features_set(ni_ethtool_features_t *features, const char *name, ni_et
 }
 
 static unsigned int
-ni_ethtool_get_feature_count(const ni_netdev_ref_t *ref)
+ni_ethtool_get_feature_count(const ni_netdev_ref_t *ref, const ni_ethtool_t *ethtool)
 {
-	return ni_ethtool_get_gstring_count(ref, "features count", ETH_SS_FEATURES);
+	return ni_ethtool_get_gstring_count_cached(ref, ethtool, "features count", ETH_SS_FEATURES);
 }
 
 static struct ethtool_gstrings *
-ni_ethtool_get_feature_names(const ni_netdev_ref_t *ref, unsigned int count)
+ni_ethtool_get_feature_names(const ni_netdev_ref_t *ref, const ni_ethtool_t *ethtool, unsigned int count)
 {
-	return ni_ethtool_get_gstrings(ref, "feature names", ETH_SS_FEATURES, count);
+	return ni_ethtool_get_gstrings_cached(ref, ethtool, "feature names", ETH_SS_FEATURES, count);
 }
 
 #define ni_ethtool_get_feature_blocks(n)	(((n) + 31U) / 32U)
@@ -2421,7 +2543,7 @@ ni_ethtool_get_features_init(const ni_netdev_ref_t *ref, ni_ethtool_t *ethtool,
 		return -ENOMEM;
 
 	features = ethtool->features;
-	if (!features->total && !(features->total = ni_ethtool_get_feature_count(ref))) {
+	if (!features->total && !(features->total = ni_ethtool_get_feature_count(ref, ethtool))) {
 		ni_ethtool_set_supported(ethtool, NI_ETHTOOL_SUPP_GET_FEATURES, FALSE);
 		return -EOPNOTSUPP;
 	}
@@ -2435,7 +2557,7 @@ ni_ethtool_get_features_init(const ni_netdev_ref_t *ref, ni_ethtool_t *ethtool,
 		return errno;
 	}
 
-	gstrings = ni_ethtool_get_feature_names(ref, features->total);
+	gstrings = ni_ethtool_get_feature_names(ref, ethtool, features->total);
 	if (!gstrings || !gstrings->len) {
 		if (errno == EOPNOTSUPP)
 			ni_ethtool_set_supported(ethtool, NI_ETHTOOL_SUPP_GET_FEATURES, FALSE);
@@ -3724,9 +3846,486 @@ ni_ethtool_set_pause(const ni_netdev_ref_t *ref, ni_ethtool_t *ethtool, const ni
 }
 
 
+#ifdef HAVE_LINUX_ETHTOOL_NETLINK_H
+/*
+ * ethtool generic netlink backend
+ *
+ * Updates the link state, ring, channel and pause settings of the
+ * devices with ethtool state in use with one dump request per set
+ * on a full refresh and keeps them (and the invalidation of the ioctl
+ * based sets) current using the ethtool monitor group notifications.
+ */
+#define NI_ETHTOOL_NL_ATTR_MAX	31	/* attributes above are not used */
+#define NI_ETHTOOL_NL_RCVBUF	(256 * 1024)
+
+typedef struct ni_ethtool_nl_set {
+	const char *	name;
+	uint8_t		cmd;		/* ETHTOOL_MSG_*_GET request	*/
+	uint8_t		reply;		/* ETHTOOL_MSG_*_GET_REPLY	*/
+	uint8_t		ntf;		/* ETHTOOL_MSG_*_NTF		*/
+	unsigned int	supp;		/* NI_ETHTOOL_SUPP_GET_*	*/
+	void		(*parse)(ni_ethtool_t *, struct nlattr **);
+} ni_ethtool_nl_set_t;
+
+static struct {
+	struct nl_sock *	nl_sock;
+	int			family;		/* 0: unresolved, < 0: unavailable */
+	unsigned int		monitor_group;
+	ni_socket_t *		monitor;
+} ni_ethtool_nl;
+
+static void
+ni_ethtool_nl_parse_linkstate(ni_ethtool_t *ethtool, struct nlattr **tb)
+{
+	if (tb[ETHTOOL_A_LINKSTATE_LINK])
+		ni_tristate_set(&ethtool->link_detected,
+				!!nla_get_u8(tb[ETHTOOL_A_LINKSTATE_LINK]));
+}
+
+static void
+ni_ethtool_nl_parse_rings(ni_ethtool_t *ethtool, struct nlattr **tb)
+{
+	ni_ethtool_ring_t *ring;
+
+	ni_ethtool_ring_free(ethtool->ring);
+	if (!(ethtool->ring = ring = ni_ethtool_ring_new()))
+		return;
+
+	if (tb[ETHTOOL_A_RINGS_TX])
+		ring->tx       = nla_get_u32(tb[ETHTOOL_A_RINGS_TX]);
+	if (tb[ETHTOOL_A_RINGS_RX])
+		ring->rx       = nla_get_u32(tb[ETHTOOL_A_RINGS_RX]);
+	if (tb[ETHTOOL_A_RINGS_RX_MINI])
+		ring->rx_mini  = nla_get_u32(tb[ETHTOOL_A_RINGS_RX_MINI]);
+	if (tb[ETHTOOL_A_RINGS_RX_JUMBO])
+		ring->rx_jumbo = nla_get_u32(tb[ETHTOOL_A_RINGS_RX_JUMBO]);
+}
+
+static void
+ni_ethtool_nl_parse_channels(ni_ethtool_t *ethtool, struct nlattr **tb)
+{
+	ni_ethtool_channels_t *channels;
+
+	ni_ethtool_channels_free(ethtool->channels);
+	if (!(ethtool->channels = channels = ni_ethtool_channels_new()))
+		return;
+
+	if (tb[ETHTOOL_A_CHANNELS_TX_COUNT])
+		channels->tx       = nla_get_u32(tb[ETHTOOL_A_CHANNELS_TX_COUNT]);
+	if (tb[ETHTOOL_A_CHANNELS_RX_COUNT])
+		channels->rx       = nla_get_u32(tb[ETHTOOL_A_CHANNELS_RX_COUNT]);
+	if (tb[ETHTOOL_A_CHANNELS_OTHER_COUNT])
+		channels->other    = nla_get_u32(tb[ETHTOOL_A_CHANNELS_OTHER_COUNT]);
+	if (tb[ETHTOOL_A_CHANNELS_COMBINED_COUNT])
+		channels->combined = nla_get_u32(tb[ETHTOOL_A_CHANNELS_COMBINED_COUNT]);
+}
+
+static void
+ni_ethtool_nl_parse_pause(ni_ethtool_t *ethtool, struct nlattr **tb)
+{
+	ni_ethtool_pause_t *pause;
+
+	ni_ethtool_pause_free(ethtool->pause);
+	if (!(ethtool->pause = pause = ni_ethtool_pause_new()))
+		return;
+
+	if (tb[ETHTOOL_A_PAUSE_TX])
+		ni_tristate_set(&pause->tx, nla_get_u8(tb[ETHTOOL_A_PAUSE_TX]));
+	if (tb[ETHTOOL_A_PAUSE_RX])
+		ni_tristate_set(&pause->rx, nla_get_u8(tb[ETHTOOL_A_PAUSE_RX]));
+	if (tb[ETHTOOL_A_PAUSE_AUTONEG])
+		ni_tristate_set(&pause->autoneg, nla_get_u8(tb[ETHTOOL_A_PAUSE_AUTONEG]));
+}
+
+static const ni_ethtool_nl_set_t	ni_ethtool_nl_sets[] = {
+	{ "linkstate",	ETHTOOL_MSG_LINKSTATE_GET,	ETHTOOL_MSG_LINKSTATE_GET_REPLY,	0,
+			NI_ETHTOOL_SUPP_GET_LINK_DETECTED,	ni_ethtool_nl_parse_linkstate	},
+	{ "rings",	ETHTOOL_MSG_RINGS_GET,		ETHTOOL_MSG_RINGS_GET_REPLY,	ETHTOOL_MSG_RINGS_NTF,
+			NI_ETHTOOL_SUPP_GET_RING,		ni_ethtool_nl_parse_rings	},
+	{ "channels",	ETHTOOL_MSG_CHANNELS_GET,	ETHTOOL_MSG_CHANNELS_GET_REPLY,	ETHTOOL_MSG_CHANNELS_NTF,
+			NI_ETHTOOL_SUPP_GET_CHANNELS,		ni_ethtool_nl_parse_channels	},
+	{ "pause",	ETHTOOL_MSG_PAUSE_GET,		ETHTOOL_MSG_PAUSE_GET_REPLY,	ETHTOOL_MSG_PAUSE_NTF,
+			NI_ETHTOOL_SUPP_GET_PAUSE,		ni_ethtool_nl_parse_pause	},
+	{ NULL }
+};
+
+/*
+ * Notifications about the sets still read via ioctl just
+ * tell that the cached settings have to be read again.
+ */
+static const struct {
+	uint8_t		ntf;
+	unsigned int	supp;
+} ni_ethtool_nl_invalidate[] = {
+	{ ETHTOOL_MSG_PRIVFLAGS_NTF,	NI_ETHTOOL_SUPP_GET_PRIV_FLAGS	},
+	{ ETHTOOL_MSG_WOL_NTF,		NI_ETHTOOL_SUPP_GET_WAKE_ON_LAN	},
+	{ ETHTOOL_MSG_FEATURES_NTF,	NI_ETHTOOL_SUPP_GET_FEATURES	},
+	{ ETHTOOL_MSG_EEE_NTF,		NI_ETHTOOL_SUPP_GET_EEE		},
+	{ ETHTOOL_MSG_COALESCE_NTF,	NI_ETHTOOL_SUPP_GET_COALESCE	},
+	{ 0,				0				}
+};
+
+static struct nl_msg *
+ni_ethtool_nl_msg_new(int family, uint8_t cmd, uint8_t version, int flags)
+{
+	struct genlmsghdr *ghdr;
+	struct nlmsghdr *nlh;
+	struct nl_msg *msg;
+
+	if (!(msg = nlmsg_alloc()))
+		return NULL;
+
+	if (!(nlh = nlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, family,
+					GENL_HDRLEN, flags))) {
+		nlmsg_free(msg);
+		return NULL;
+	}
+	ghdr = nlmsg_data(nlh);
+	ghdr->cmd = cmd;
+	ghdr->version = version;
+	return msg;
+}
+
+static int
+ni_ethtool_nl_talk(struct nl_sock *sock, struct nl_msg *msg,
+		int (*handler)(struct nl_msg *, void *), void *arg)
+{
+	struct nl_cb *cb;
+	int err;
+
+	if (!(cb = nl_cb_alloc(NL_CB_DEFAULT)))
+		return -NLE_NOMEM;
+
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, handler, arg);
+	if ((err = nl_send_auto(sock, msg)) >= 0)
+		err = nl_recvmsgs(sock, cb);
+
+	nl_cb_put(cb);
+	return err;
+}
+
+static int
+ni_ethtool_nl_family_handler(struct nl_msg *msg, void *arg)
+{
+	struct nlattr *tb[CTRL_ATTR_MAX + 1];
+	struct nlattr *gtb[CTRL_ATTR_MCAST_GRP_MAX + 1];
+	struct nlattr *grp;
+	int rem;
+
+	(void)arg;
+	if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, CTRL_ATTR_MAX, NULL) < 0)
+		return NL_SKIP;
+
+	if (tb[CTRL_ATTR_FAMILY_ID])
+		ni_ethtool_nl.family = nla_get_u16(tb[CTRL_ATTR_FAMILY_ID]);
+
+	if (tb[CTRL_ATTR_MCAST_GROUPS]) {
+		nla_for_each_nested(grp, tb[CTRL_ATTR_MCAST_GROUPS], rem) {
+			if (nla_parse_nested(gtb, CTRL_ATTR_MCAST_GRP_MAX, grp, NULL) < 0)
+				continue;
+			if (!gtb[CTRL_ATTR_MCAST_GRP_NAME] || !gtb[CTRL_ATTR_MCAST_GRP_ID])
+				continue;
+			if (ni_string_eq(nla_get_string(gtb[CTRL_ATTR_MCAST_GRP_NAME]),
+						ETHTOOL_MCGRP_MONITOR_NAME))
+				ni_ethtool_nl.monitor_group = nla_get_u32(gtb[CTRL_ATTR_MCAST_GRP_ID]);
+		}
+	}
+	return NL_OK;
+}
+
+/*
+ * Connect the request socket and resolve the ethtool family
+ * once; returns FALSE when the kernel does not provide it.
+ */
+static ni_bool_t
+ni_ethtool_nl_init(void)
+{
+	struct nl_msg *msg;
+	int err;
+
+	if (ni_ethtool_nl.family)
+		return ni_ethtool_nl.family > 0;
+
+	ni_ethtool_nl.family = -1;
+	if (!(ni_ethtool_nl.nl_sock = nl_socket_alloc()))
+		return FALSE;
+
+	if ((err = nl_connect(ni_ethtool_nl.nl_sock, NETLINK_GENERIC)) < 0) {
+		ni_debug_ifconfig("ethtool netlink: cannot open generic netlink: %s",
+				nl_geterror(err));
+		goto failure;
+	}
+	/*
+	 * the dump replies of several devices exceed a page and the
+	 * kernel refuses to start a dump (ENOBUFS) when the default
+	 * receive buffer is considered full by its skb accounting.
+	 */
+	nl_socket_enable_msg_peek(ni_ethtool_nl.nl_sock);
+	nl_socket_set_buffer_size(ni_ethtool_nl.nl_sock, NI_ETHTOOL_NL_RCVBUF, 0);
+
+	if (!(msg = ni_ethtool_nl_msg_new(GENL_ID_CTRL, CTRL_CMD_GETFAMILY, 1, 0)))
+		goto failure;
+
+	if (nla_put_string(msg, CTRL_ATTR_FAMILY_NAME, ETHTOOL_GENL_NAME) < 0) {
+		nlmsg_free(msg);
+		goto failure;
+	}
+
+	err = ni_ethtool_nl_talk(ni_ethtool_nl.nl_sock, msg,
+				ni_ethtool_nl_family_handler, NULL);
+	nlmsg_free(msg);
+	if (err < 0 || ni_ethtool_nl.family <= 0) {
+		ni_debug_ifconfig("ethtool netlink: family %s not available, using ioctl",
+				ETHTOOL_GENL_NAME);
+		ni_ethtool_nl.family = -1;
+		goto failure;
+	}
+
+	ni_debug_ifconfig("ethtool netlink: family %s resolved to %d, monitor group %u",
+			ETHTOOL_GENL_NAME, ni_ethtool_nl.family,
+			ni_ethtool_nl.monitor_group);
+	return TRUE;
+
+failure:
+	nl_socket_free(ni_ethtool_nl.nl_sock);
+	ni_ethtool_nl.nl_sock = NULL;
+	return FALSE;
+}
+
+static const ni_ethtool_nl_set_t *
+ni_ethtool_nl_set_by_cmd(uint8_t cmd)
+{
+	const ni_ethtool_nl_set_t *set;
+
+	for (set = ni_ethtool_nl_sets; set->name; ++set) {
+		if (set->reply == cmd || (set->ntf && set->ntf == cmd))
+			return set;
+	}
+	return NULL;
+}
+
+/*
+ * Apply one reply or notification to the device it refers to
+ */
+static int
+ni_ethtool_nl_process(struct nl_msg *msg, void *arg)
+{
+	struct nlattr *tb[NI_ETHTOOL_NL_ATTR_MAX + 1];
+	struct nlattr *htb[ETHTOOL_A_HEADER_MAX + 1];
+	ni_netconfig_t *nc = arg ? arg : ni_global_state_handle(0);
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	const ni_ethtool_nl_set_t *set;
+	struct genlmsghdr *ghdr;
+	ni_ethtool_t *ethtool;
+	ni_netdev_t *dev;
+	unsigned int i = 0;
+
+	if (nlh->nlmsg_type != ni_ethtool_nl.family || !nc)
+		return NL_SKIP;
+
+	ghdr = nlmsg_data(nlh);
+	if (!(set = ni_ethtool_nl_set_by_cmd(ghdr->cmd))) {
+		for (i = 0; ni_ethtool_nl_invalidate[i].ntf; ++i) {
+			if (ni_ethtool_nl_invalidate[i].ntf == ghdr->cmd)
+				break;
+		}
+		if (!ni_ethtool_nl_invalidate[i].ntf)
+			return NL_SKIP;
+	}
+
+	/* the header nest is the first attribute in all the sets */
+	if (nlmsg_parse(nlh, GENL_HDRLEN, tb, NI_ETHTOOL_NL_ATTR_MAX, NULL) < 0 ||
+	    !tb[1] || nla_parse_nested(htb, ETHTOOL_A_HEADER_MAX, tb[1], NULL) < 0 ||
+	    !htb[ETHTOOL_A_HEADER_DEV_INDEX])
+		return NL_SKIP;
+
+	/* the ethtool state of a device is fetched on first use only */
+	dev = ni_netdev_by_index(nc, nla_get_u32(htb[ETHTOOL_A_HEADER_DEV_INDEX]));
+	if (!dev || !ni_netdev_device_is_ready(dev) || !(ethtool = dev->ethtool))
+		return NL_SKIP;
+
+	if (set) {
+		set->parse(ethtool, tb);
+		ni_ethtool_set_supported(ethtool, set->supp, TRUE);
+		ni_bitfield_setbit(&ethtool->cached, set->supp);
+		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_IFCONFIG,
+				"%s[%u]: ethtool netlink %s %s", dev->name,
+				dev->link.ifindex, set->name,
+				ghdr->cmd == set->ntf ? "notification" : "reply");
+	} else {
+		ni_bitfield_clearbit(&ethtool->cached, ni_ethtool_nl_invalidate[i].supp);
+	}
+	return NL_OK;
+}
+
+static int
+ni_ethtool_nl_dump(ni_netconfig_t *nc, const ni_ethtool_nl_set_t *set)
+{
+	struct nlattr *nest;
+	struct nl_msg *msg;
+	int err;
+
+	msg = ni_ethtool_nl_msg_new(ni_ethtool_nl.family, set->cmd,
+				ETHTOOL_GENL_VERSION, NLM_F_DUMP);
+	if (!msg)
+		return -NLE_NOMEM;
+
+	/* an empty header requests the data of all devices */
+	if (!(nest = nla_nest_start(msg, 1))) {
+		nlmsg_free(msg);
+		return -NLE_NOMEM;
+	}
+	nla_nest_end(msg, nest);
+
+	err = ni_ethtool_nl_talk(ni_ethtool_nl.nl_sock, msg, ni_ethtool_nl_process, nc);
+	nlmsg_free(msg);
+	return err;
+}
+
+/*
+ * Called after the link processing of a full refresh to update
+ * the ethtool state in use of all devices with one dump per set.
+ */
+void
+ni_system_ethtool_refresh_all(ni_netconfig_t *nc)
+{
+	const ni_ethtool_nl_set_t *set;
+	ni_netdev_t *dev;
+	int err;
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		if (dev->ethtool)
+			break;
+	}
+	if (!dev || !ni_ethtool_nl_init())
+		return;
+
+	for (set = ni_ethtool_nl_sets; set->name; ++set) {
+		/* not in the dump: read via ioctl on next use */
+		if ((err = ni_ethtool_nl_dump(nc, set)) < 0) {
+			ni_warn("ethtool netlink: %s dump failed: %s",
+					set->name, nl_geterror(err));
+		}
+	}
+}
+
+static inline ni_bool_t
+ni_ethtool_monitored(void)
+{
+	return ni_ethtool_nl.monitor != NULL;
+}
+
+static void
+ni_ethtool_nl_monitor_receive(ni_socket_t *sock)
+{
+	struct nl_sock *nl_sock = sock->user_data;
+	int err;
+
+	if ((err = nl_recvmsgs_default(nl_sock)) < 0 && err != -NLE_AGAIN) {
+		ni_debug_ifconfig("ethtool netlink: monitor receive failed: %s",
+				nl_geterror(err));
+	}
+}
+
+static void
+ni_ethtool_nl_monitor_close(ni_socket_t *sock)
+{
+	struct nl_sock *nl_sock = sock->user_data;
+
+	/* closes the socket fd as well */
+	if (nl_sock)
+		nl_socket_free(nl_sock);
+	sock->user_data = NULL;
+	if (ni_ethtool_nl.monitor == sock)
+		ni_ethtool_nl.monitor = NULL;
+}
+
+/*
+ * Subscribe to the ethtool monitor notifications, so the settings
+ * the kernel reports changes for are applied or invalidated
+ * instead of being polled with every device refresh.
+ */
+int
+ni_server_enable_ethtool_events(void)
+{
+	struct nl_sock *nl_sock;
+	ni_socket_t *sock;
+	int err, fd;
+
+	if (ni_ethtool_nl.monitor)
+		return 0;
+
+	if (!ni_ethtool_nl_init() || !ni_ethtool_nl.monitor_group)
+		return -1;
+
+	if (!(nl_sock = nl_socket_alloc()))
+		return -1;
+
+	nl_socket_disable_seq_check(nl_sock);
+	nl_socket_modify_cb(nl_sock, NL_CB_VALID, NL_CB_CUSTOM,
+				ni_ethtool_nl_process, NULL);
+	nl_socket_enable_msg_peek(nl_sock);
+
+	if ((err = nl_connect(nl_sock, NETLINK_GENERIC)) < 0 ||
+	    (err = nl_socket_add_membership(nl_sock, ni_ethtool_nl.monitor_group)) < 0) {
+		ni_error("ethtool netlink: cannot join monitor group: %s",
+				nl_geterror(err));
+		nl_socket_free(nl_sock);
+		return -1;
+	}
+	nl_socket_set_nonblocking(nl_sock);
+
+	fd = nl_socket_get_fd(nl_sock);
+	if (!(sock = ni_socket_wrap(fd, SOCK_DGRAM))) {
+		ni_error("ethtool netlink: cannot wrap monitor socket: %m");
+		nl_socket_free(nl_sock);
+		return -1;
+	}
+
+	sock->user_data = nl_sock;
+	sock->receive = ni_ethtool_nl_monitor_receive;
+	sock->close = ni_ethtool_nl_monitor_close;
+	ni_ethtool_nl.monitor = sock;
+	ni_socket_activate(sock);
+	return 0;
+}
+
+#else
+void
+ni_system_ethtool_refresh_all(ni_netconfig_t *nc)
+{
+	(void)nc;
+}
+
+static inline ni_bool_t
+ni_ethtool_monitored(void)
+{
+	return FALSE;
+}
+
+int
+ni_server_enable_ethtool_events(void)
+{
+	return -1;
+}
+#endif
+
 /*
  * main system refresh and setup functions
  */
+static inline ni_bool_t
+ni_ethtool_cached(const ni_ethtool_t *ethtool, unsigned int flag)
+{
+	return ni_bitfield_testbit(&ethtool->cached, flag);
+}
+
+static inline void
+ni_ethtool_set_cached(ni_ethtool_t *ethtool, unsigned int flag)
+{
+	/* valid until invalidated by a link event or the monitor */
+	ni_bitfield_setbit(&ethtool->cached, flag);
+}
+
 static ni_bool_t
 ni_ethtool_refresh(ni_netdev_t *dev)
 {
@@ -3740,27 +4339,185 @@ ni_ethtool_refresh(ni_netdev_t *dev)
 	ref.index = dev->link.ifindex;
 	if (!ethtool->driver_info)
 		ni_ethtool_get_driver_info(&ref, ethtool);
-	ni_ethtool_get_priv_flags(&ref, ethtool);
-	ni_ethtool_get_link_detected(&ref, ethtool);
-	ni_ethtool_get_link_settings(&ref, ethtool);
-	ni_ethtool_get_wake_on_lan(&ref, ethtool);
-	ni_ethtool_get_features(&ref, ethtool, FALSE);
-	ni_ethtool_get_eee(&ref, ethtool);
-	ni_ethtool_get_ring(&ref, ethtool);
-	ni_ethtool_get_channels(&ref, ethtool);
-	ni_ethtool_get_coalesce(&ref, ethtool);
-	ni_ethtool_get_pause(&ref, ethtool);
+	if (!ni_ethtool_cached(ethtool, NI_ETHTOOL_SUPP_GET_PRIV_FLAGS)) {
+		ni_ethtool_get_priv_flags(&ref, ethtool);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_PRIV_FLAGS);
+	}
+	if (!ni_ethtool_cached(ethtool, NI_ETHTOOL_SUPP_GET_LINK_DETECTED)) {
+		ni_ethtool_get_link_detected(&ref, ethtool);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_LINK_DETECTED);
+	}
+	if (!ni_ethtool_cached(ethtool, NI_ETHTOOL_SUPP_GET_LINK_SETTINGS)) {
+		ni_ethtool_get_link_settings(&ref, ethtool);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_LINK_SETTINGS);
+	}
+	if (!ni_ethtool_cached(ethtool, NI_ETHTOOL_SUPP_GET_WAKE_ON_LAN)) {
+		ni_ethtool_get_wake_on_lan(&ref, ethtool);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_WAKE_ON_LAN);
+	}
+	if (!ni_ethtool_cached(ethtool, NI_ETHTOOL_SUPP_GET_FEATURES)) {
+		ni_ethtool_get_features(&ref, ethtool, FALSE);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_FEATURES);
+	}
+	if (!ni_ethtool_cached(ethtool, NI_ETHTOOL_SUPP_GET_EEE)) {
+		ni_ethtool_get_eee(&ref, ethtool);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_EEE);
+	}
+	if (!ni_ethtool_cached(ethtool, NI_ETHTOOL_SUPP_GET_RING)) {
+		ni_ethtool_get_ring(&ref, ethtool);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_RING);
+	}
+	if (!ni_ethtool_cached(ethtool, NI_ETHTOOL_SUPP_GET_CHANNELS)) {
+		ni_ethtool_get_channels(&ref, ethtool);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_CHANNELS);
+	}
+	if (!ni_ethtool_cached(ethtool, NI_ETHTOOL_SUPP_GET_COALESCE)) {
+		ni_ethtool_get_coalesce(&ref, ethtool);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_COALESCE);
+	}
+	if (!ni_ethtool_cached(ethtool, NI_ETHTOOL_SUPP_GET_PAUSE)) {
+		ni_ethtool_get_pause(&ref, ethtool);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_PAUSE);
+	}
 
 	return TRUE;
 }
 
+/*
+ * The link state and settings invalidated by a link event are fetched
+ * by a worker thread when the pool is active, so the next get finds
+ * them cached instead to block in the (sometimes slow) driver ioctls.
+ * Except of an unsupported ioctl, failures are left to the synchronous
+ * get to retry, which falls back to the legacy link settings and logs.
+ */
+typedef struct ni_ethtool_link_job {
+	char				ifname[IFNAMSIZ];
+	unsigned int			ifindex;
+	unsigned int			refresh_gen;
+
+	int				glink_ret;
+	struct ethtool_value		glink;
+	int				gset_ret;
+	ni_ethtool_link_settings_cmd_t	gset;
+} ni_ethtool_link_job_t;
+
+static void
+ni_ethtool_link_job_work(int iocfd, void *user_data)
+{
+	ni_ethtool_link_job_t *job = user_data;
+	int8_t nwords;
+
+	if (job->glink_ret == 0) {
+		if (__ni_ethtool_fd(iocfd, job->ifname, ETHTOOL_GLINK, &job->glink) < 0)
+			job->glink_ret = -errno;
+	}
+
+	if (job->gset_ret == 0) {
+		if (__ni_ethtool_fd(iocfd, job->ifname, ETHTOOL_GLINKSETTINGS, &job->gset) < 0) {
+			job->gset_ret = -errno;
+		} else
+		if (job->gset.settings.link_mode_masks_nwords < 0) {
+			nwords = -job->gset.settings.link_mode_masks_nwords;
+			memset(&job->gset, 0, sizeof(job->gset));
+			job->gset.settings.link_mode_masks_nwords = nwords;
+			if (__ni_ethtool_fd(iocfd, job->ifname, ETHTOOL_GLINKSETTINGS, &job->gset) < 0)
+				job->gset_ret = -errno;
+		}
+	}
+}
+
+static void
+ni_ethtool_link_job_done(void *user_data, ni_bool_t completed)
+{
+	ni_ethtool_link_job_t *job = user_data;
+	ni_ethtool_link_settings_t *link;
+	ni_ethtool_t *ethtool;
+	ni_netdev_t *dev;
+
+	dev = ni_netdev_by_index(ni_global_state_handle(0), job->ifindex);
+	if (!completed || !dev || !(ethtool = dev->ethtool) ||
+	    !ni_string_eq(dev->name, job->ifname) ||
+	    ethtool->refresh_gen != job->refresh_gen)
+		goto cleanup;
+
+	if (job->glink_ret == -EOPNOTSUPP)
+		ni_ethtool_set_supported(ethtool, NI_ETHTOOL_SUPP_GET_LINK_DETECTED, FALSE);
+	if (job->gset_ret == -EOPNOTSUPP)
+		ni_ethtool_set_supported(ethtool, NI_ETHTOOL_SUPP_GET_LINK_SETTINGS, FALSE);
+
+	if (job->glink_ret == 0) {
+		ni_tristate_set(&ethtool->link_detected, !!job->glink.data);
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_LINK_DETECTED);
+	}
+	if (job->gset_ret == 0 && (link = ni_ethtool_link_settings_parse(&job->gset))) {
+		ni_ethtool_link_settings_free(ethtool->link_settings);
+		ethtool->link_settings = link;
+		ni_ethtool_set_cached(ethtool, NI_ETHTOOL_SUPP_GET_LINK_SETTINGS);
+	}
+
+cleanup:
+	free(job);
+}
+
+static void
+ni_ethtool_link_job_submit(ni_netdev_t *dev, const ni_ethtool_t *ethtool)
+{
+	ni_ethtool_link_job_t *job;
+
+	if (!ni_worker_pool_active() || ni_netns_current() ||
+	    !dev->link.ifindex || !ni_netdev_device_is_ready(dev))
+		return;
+
+	if (!ni_ethtool_supported(ethtool, NI_ETHTOOL_SUPP_GET_LINK_DETECTED) &&
+	    !ni_ethtool_supported(ethtool, NI_ETHTOOL_SUPP_GET_LINK_SETTINGS))
+		return;
+
+	job = xcalloc(1, sizeof(*job));
+	strncpy(job->ifname, dev->name, sizeof(job->ifname) - 1);
+	job->ifindex = dev->link.ifindex;
+	job->refresh_gen = ethtool->refresh_gen;
+	if (!ni_ethtool_supported(ethtool, NI_ETHTOOL_SUPP_GET_LINK_DETECTED))
+		job->glink_ret = -EOPNOTSUPP;
+	if (!ni_ethtool_supported(ethtool, NI_ETHTOOL_SUPP_GET_LINK_SETTINGS))
+		job->gset_ret = -EOPNOTSUPP;
+
+	if (!ni_worker_submit(ni_ethtool_link_job_work, ni_ethtool_link_job_done, job))
+		free(job);
+}
+
+/*
+ * Called on link events: the ethtool state is not fetched here, but
+ * on first use by ni_system_ethtool_get.  The monitor reports the
+ * changes of all other sets, except of the link state and settings.
+ */
 void
 ni_system_ethtool_refresh(ni_netdev_t *dev)
 {
-	if (!ni_netdev_device_is_ready(dev) || !dev->link.ifindex)
+	ni_ethtool_t *ethtool;
+
+	if (!dev || !(ethtool = dev->ethtool))
 		return;
 
-	ni_ethtool_refresh(dev);
+	ethtool->refresh_gen++;
+	if (ni_ethtool_monitored()) {
+		ni_bitfield_clearbit(&ethtool->cached, NI_ETHTOOL_SUPP_GET_LINK_DETECTED);
+		ni_bitfield_clearbit(&ethtool->cached, NI_ETHTOOL_SUPP_GET_LINK_SETTINGS);
+	} else {
+		ni_bitfield_destroy(&ethtool->cached);
+	}
+	ni_ethtool_link_job_submit(dev, ethtool);
+}
+
+ni_ethtool_t *
+ni_system_ethtool_get(ni_netdev_t *dev)
+{
+	if (!dev)
+		return NULL;
+
+	if (ni_netdev_device_is_ready(dev) && dev->link.ifindex)
+		ni_ethtool_refresh(dev);
+
+	return dev->ethtool;
 }
 
 int
@@ -3786,6 +4543,9 @@ ni_system_ethtool_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t
 		ni_ethtool_set_channels(&ref, dev->ethtool, cfg->ethtool->channels);
 		ni_ethtool_set_coalesce(&ref, dev->ethtool, cfg->ethtool->coalesce);
 		ni_ethtool_set_pause(&ref, dev->ethtool, cfg->ethtool->pause);
+		/* read back everything, not only what the monitor reports */
+		dev->ethtool->refresh_gen++;
+		ni_bitfield_destroy(&dev->ethtool->cached);
 		ni_ethtool_refresh(dev);
 	}
 	return 0;
@@ -3799,6 +4559,7 @@ ni_ethtool_free(ni_ethtool_t *ethtool)
 {
 	if (ethtool) {
 		ni_bitfield_destroy(&ethtool->supported);
+		ni_bitfield_destroy(&ethtool->cached);
 		ni_ethtool_driver_info_free(ethtool->driver_info);
 		ni_ethtool_priv_flags_free(ethtool->priv_flags);
 		ni_ethtool_link_settings_free(ethtool->link_settings);
@@ -3808,6 +4569,7 @@ ni_ethtool_free(ni_ethtool_t *ethtool)
 		ni_ethtool_ring_free(ethtool->ring);
 		ni_ethtool_channels_free(ethtool->channels);
 		ni_ethtool_coalesce_free(ethtool->coalesce);
+		ni_ethtool_pause_free(ethtool->pause);
 		free(ethtool);
 	}
 }
@@ -39,6 +39,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 /*
  * Check if extension script contains name and executable command
@@ -73,22 +74,21 @@ ni_netif_firmware_discovery_script_exec(int argc, char *const argv[], char *cons
 	exit(EXIT_FAILURE);
 }
 
-static int
-ni_netif_firmware_discovery_script_call(ni_buffer_t *buf, ni_script_action_t *script,
+static ni_process_t *
+ni_netif_firmware_discovery_script_new(ni_script_action_t *script,
 		const ni_var_array_t *vars, const char *type, const char *root,
 		const char *path)
 {
 	ni_process_t *pi;
-	int status;
 
-	ni_assert(buf && script);
+	ni_assert(script);
 
 	ni_debug_ifconfig("trying to discover %s netif config from extension", type);
 
 	/* Create an instance for this script command process */
 	if (!(pi = ni_process_new(script->process))) {
 		ni_error("%s discovery process allocation failure: %m", type);
-		return NI_PROCESS_FAILURE;
+		return NULL;
 	}
 
 	/* Add root directory argument if given */
@@ -107,9 +107,12 @@ ni_netif_firmware_discovery_script_call(ni_buffer_t *buf, ni_script_action_t *sc
 	ni_process_setenv_vars(pi, vars, FALSE);
 
 	pi->exec = ni_netif_firmware_discovery_script_exec;
-	status = ni_process_run_and_capture_output(pi, buf);
-	ni_process_free(pi);
+	return pi;
+}
 
+static int
+ni_netif_firmware_discovery_script_status(const char *type, int status, const ni_buffer_t *buf)
+{
 	if (status > NI_PROCESS_SUCCESS) {
 		/* (post-fork) exit codes returned by extension sub-process */
 		ni_info("%s discovery script failure: exit status %d", type, status);
@@ -127,43 +130,246 @@ ni_netif_firmware_discovery_script_call(ni_buffer_t *buf, ni_script_action_t *sc
 	return status;
 }
 
+/*
+ * The discovery scripts of the selected extensions are run concurrently,
+ * builtin actions (e.g. of the ibft extension) directly in-process.
+ * The successful script output is cached in the state directory (a tmpfs) for
+ * the rest of the boot, keyed by the extension, action, command, root and
+ * path, so further client invocations don't run slow scripts (e.g. the
+ * redfish BMC queries) again.
+ */
+typedef struct ni_netif_firmware_discovery {
+	const ni_extension_t *	ex;
+	ni_script_action_t *	script;
+	char *			type;		/* e.g. firmware:ibft	*/
+	char *			cache;
+	ni_process_t *		proc;
+	ni_buffer_t		buf;
+	int			status;
+} ni_netif_firmware_discovery_t;
+
+static void
+ni_netif_firmware_discovery_cache_name(ni_netif_firmware_discovery_t *job,
+		const char *action, const char *root, const char *path)
+{
+	ni_stringbuf_t key = NI_STRINGBUF_INIT_DYNAMIC;
+	const char *dir = ni_config_statedir();
+
+	if (ni_string_empty(dir) || !ni_isdir(dir))
+		return;
+
+	ni_stringbuf_printf(&key, "%s\n%s\n%s", job->script->process->command,
+			root ? root : "", path ? path : "");
+	ni_string_printf(&job->cache, "%s/firmware-%s-%s-%08x.cache", dir,
+			job->ex->name, action, ni_string_hash(key.string));
+	ni_stringbuf_destroy(&key);
+}
+
+static ni_bool_t
+ni_netif_firmware_discovery_cache_load(ni_netif_firmware_discovery_t *job)
+{
+	struct stat stb;
+	size_t len = 0;
+	void *data;
+	FILE *fp;
+
+	if (!job->cache || stat(job->cache, &stb) < 0 || !S_ISREG(stb.st_mode))
+		return FALSE;
+
+	if (stb.st_size > 0) {
+		if (!(fp = fopen(job->cache, "re")))
+			return FALSE;
+		data = ni_file_read(fp, &len, 0);
+		fclose(fp);
+		if (!data)
+			return FALSE;
+
+		ni_buffer_ensure_tailroom(&job->buf, len);
+		ni_buffer_put(&job->buf, data, len);
+		free(data);
+	}
+
+	ni_debug_extension("%s discovery script output cached in %s",
+			job->type, job->cache);
+	return TRUE;
+}
+
+static void
+ni_netif_firmware_discovery_cache_store(const ni_netif_firmware_discovery_t *job)
+{
+	char *temp = NULL;
+	ni_bool_t done;
+	FILE *fp;
+	int fd;
+
+	if (!job->cache || !ni_string_printf(&temp, "%s.XXXXXX", job->cache))
+		return;
+
+	if ((fd = mkstemp(temp)) < 0) {
+		ni_debug_extension("%s: unable to create discovery cache: %m", temp);
+		ni_string_free(&temp);
+		return;
+	}
+
+	if (!(fp = fdopen(fd, "w"))) {
+		close(fd);
+		done = FALSE;
+	} else {
+		done = !ni_buffer_count(&job->buf) || ni_file_write(fp,
+				ni_buffer_head(&job->buf), ni_buffer_count(&job->buf)) >= 0;
+		done = fclose(fp) == 0 && done && rename(temp, job->cache) == 0;
+	}
+	if (!done)
+		unlink(temp);
+	ni_string_free(&temp);
+}
+
+static void
+ni_netif_firmware_discovery_destroy(ni_netif_firmware_discovery_t *jobs, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; ++i) {
+		ni_string_free(&jobs[i].type);
+		ni_string_free(&jobs[i].cache);
+		if (jobs[i].proc)
+			ni_process_free(jobs[i].proc);
+		ni_buffer_destroy(&jobs[i].buf);
+	}
+	free(jobs);
+}
+
+static unsigned int
+ni_netif_firmware_discovery_run(ni_netif_firmware_discovery_t **jobs_ret,
+		const char *action, const char *name, const char *type,
+		const char *root, const char *path)
+{
+	ni_netif_firmware_discovery_t *jobs = NULL, *job;
+	unsigned int i, count = 0, nprocs = 0;
+	ni_process_t **procs;
+	ni_buffer_t **bufs;
+	ni_extension_t *ex;
+	int *status;
+
+	for (ex = ni_global.config->fw_extensions; ex; ex = ex->next) {
+		ni_netif_firmware_discovery_builtin_t *builtin = NULL;
+		ni_script_action_t *script = NULL;
+		const ni_c_binding_t *binding;
+
+		if (ni_string_empty(ex->name) || !ex->enabled)
+			continue;
+
+		/* Check if to use specific type/name only (e.g. "ibft") */
+		if (name && !ni_string_eq_nocase(name, ex->name))
+			continue;
+
+		/* A builtin action is preferred over a script action */
+		if ((binding = ni_extension_find_c_binding(ex, action))) {
+			if (!(builtin = ni_c_binding_get_address(binding)))
+				continue;
+		} else {
+			if (!(script = ni_script_action_list_find(ex->actions, action)))
+				continue;
+
+			/* Check if script is usable/non-empty and executable */
+			if (!ni_netif_firmware_extension_script_usable(script))
+				continue;
+		}
+
+		jobs = xrealloc(jobs, (count + 1) * sizeof(*jobs));
+		job = &jobs[count];
+		memset(job, 0, sizeof(*job));
+		job->ex = ex;
+		job->script = script;
+
+		/* Construct full firmware type name, e.g. firmware:ibft */
+		if (!ni_string_printf(&job->type, "%s:%s", type, ex->name))
+			continue;
+
+		ni_buffer_init_dynamic(&job->buf, BUFSIZ);
+		count++;
+
+		/* Builtins run in-process and are not cached */
+		if (builtin) {
+			ni_debug_ifconfig("trying to discover %s netif config from builtin",
+					job->type);
+			if (builtin(&job->buf, root, path) < 0) {
+				ni_warn("%s discovery builtin failure", job->type);
+				job->status = NI_PROCESS_FAILURE;
+			}
+			continue;
+		}
+
+		ni_netif_firmware_discovery_cache_name(job, action, root, path);
+		if (ni_netif_firmware_discovery_cache_load(job))
+			continue;
+
+		job->proc = ni_netif_firmware_discovery_script_new(script,
+				&ex->environment, job->type, root, path);
+		if (!job->proc)
+			job->status = NI_PROCESS_FAILURE;
+		else
+			nprocs++;
+	}
+
+	if (nprocs) {
+		procs = xcalloc(nprocs, sizeof(*procs));
+		bufs = xcalloc(nprocs, sizeof(*bufs));
+		status = xcalloc(nprocs, sizeof(*status));
+
+		for (nprocs = i = 0; i < count; ++i) {
+			if (!jobs[i].proc)
+				continue;
+			procs[nprocs] = jobs[i].proc;
+			bufs[nprocs] = &jobs[i].buf;
+			nprocs++;
+		}
+
+		ni_process_run_and_capture_outputs(nprocs, procs, bufs, status);
+
+		for (nprocs = i = 0; i < count; ++i) {
+			job = &jobs[i];
+			if (!job->proc)
+				continue;
+
+			job->status = ni_netif_firmware_discovery_script_status(
+					job->type, status[nprocs++], &job->buf);
+			if (job->status == NI_PROCESS_SUCCESS)
+				ni_netif_firmware_discovery_cache_store(job);
+		}
+
+		free(status);
+		free(bufs);
+		free(procs);
+	}
+
+	*jobs_ret = jobs;
+	return count;
+}
+
 static int
 ni_netif_firmware_discovery_script_ifconfig(xml_document_t **doc,
-		ni_script_action_t *script, const ni_var_array_t *env,
-		const char *type, const char *root, const char *path)
+		ni_buffer_t *buf, const char *type)
 {
-	char buffer[BUFSIZ];
-	ni_buffer_t buf;
-	int status;
-
-	ni_assert(doc && !*doc && script);
-
-	/* Use an initial static (8k) buffer, that should be sufficient.
-	 * When it gets full, it will be automatically reallocated... */
-	memset(buffer, 0, sizeof(buffer));
-	ni_buffer_init(&buf, &buffer, sizeof(buffer));
-
-	status = ni_netif_firmware_discovery_script_call(&buf, script,
-					env, type, root, path);
-
-	if (status == NI_PROCESS_SUCCESS && ni_buffer_count(&buf)) {
-
-		if (!(*doc = xml_document_from_buffer(&buf, type))) {
-			ni_warn("%s discovery script failure: can't parse xml output", type);
-			/* hmm... NI_ERROR_DOCUMENT_ERROR? */
-			status = NI_WICKED_RC_ERROR;
-		} else if (xml_document_is_empty(*doc)) {
-			/* bunch of spaces?! */
-			ni_debug_ifconfig("%s discovery script xml output: empty", type);
-			xml_document_free(*doc);
-			*doc = NULL;
-		} else if (ni_log_level_at(NI_LOG_DEBUG2)) {
-			ni_debug_ifconfig("%s discovery script xml output:", type);
-			xml_node_print_debug(xml_document_root(*doc), NI_TRACE_IFCONFIG);
-		}
+	ni_assert(doc && !*doc && buf);
+
+	if (!ni_buffer_count(buf))
+		return NI_PROCESS_SUCCESS;
+
+	if (!(*doc = xml_document_from_buffer(buf, type))) {
+		ni_warn("%s discovery script failure: can't parse xml output", type);
+		/* hmm... NI_ERROR_DOCUMENT_ERROR? */
+		return NI_WICKED_RC_ERROR;
+	} else if (xml_document_is_empty(*doc)) {
+		/* bunch of spaces?! */
+		ni_debug_ifconfig("%s discovery script xml output: empty", type);
+		xml_document_free(*doc);
+		*doc = NULL;
+	} else if (ni_log_level_at(NI_LOG_DEBUG2)) {
+		ni_debug_ifconfig("%s discovery script xml output:", type);
+		xml_node_print_debug(xml_document_root(*doc), NI_TRACE_IFCONFIG);
 	}
-	ni_buffer_destroy(&buf);
-	return status;
+	return NI_PROCESS_SUCCESS;
 }
 
 static ni_bool_t
@@ -206,9 +412,10 @@ ni_bool_t
 ni_netif_firmware_discover_ifconfig(xml_document_array_t *docs,
 		const char *type, const char *root, const char *path)
 {
+	ni_netif_firmware_discovery_t *jobs = NULL;
 	unsigned int success = 0;
 	unsigned int failure = 0;
-	ni_extension_t *ex;
+	unsigned int i, count;
 	char *name = NULL;
 
 	if (!docs || !ni_global.config)
@@ -223,42 +430,21 @@ ni_netif_firmware_discover_ifconfig(xml_document_array_t *docs,
 	if (!ni_netif_firmware_name_from_path(&name, &path))
 		return FALSE;
 
-	for (ex = ni_global.config->fw_extensions; ex; ex = ex->next) {
-		ni_script_action_t *script;
-
-		if (ni_string_empty(ex->name) || !ex->enabled)
-			continue;
-
-		/* Check if to use specific type/name only (e.g. "ibft") */
-		if (name && !ni_string_eq_nocase(name, ex->name))
-			continue;
-
-		/* builtins are not supported in netif-firmware-discovery */
-
-		if ((script = ni_script_action_list_find(ex->actions, "show-config"))) {
-			xml_document_t *doc = NULL;
-			char *full = NULL;
-
-			/* Check if script is usable/non-empty and executable */
-			if (!ni_netif_firmware_extension_script_usable(script))
-				continue;
+	count = ni_netif_firmware_discovery_run(&jobs, "show-config",
+						name, type, root, path);
+	for (i = 0; i < count; ++i) {
+		xml_document_t *doc = NULL;
 
-			/* Construct full firmware type name, e.g. firmware:ibft */
-			if (!ni_string_printf(&full, "%s:%s", type, ex->name))
-				continue;
-
-			if (ni_netif_firmware_discovery_script_ifconfig(&doc,
-					script, &ex->environment,
-					full, root, path) == 0) {
-				xml_document_array_append(docs, doc);
-				success++;
-			} else {
-				failure++;
-			}
-
-			ni_string_free(&full);
+		if (jobs[i].status == NI_PROCESS_SUCCESS &&
+		    ni_netif_firmware_discovery_script_ifconfig(&doc,
+				&jobs[i].buf, jobs[i].type) == 0) {
+			xml_document_array_append(docs, doc);
+			success++;
+		} else {
+			failure++;
 		}
 	}
+	ni_netif_firmware_discovery_destroy(jobs, count);
 	ni_string_free(&name);
 
 	if (failure && !success)
@@ -365,45 +551,29 @@ ni_netif_firmware_ifnames_parse(ni_netif_firmware_ifnames_t **list,
 	return ret;
 }
 
-int
+static int
 ni_netif_firmware_discover_script_ifnames(ni_netif_firmware_ifnames_t **list,
-		ni_script_action_t *script, const ni_var_array_t *env,
-		const char *name, const char *type, const char *root, const char *path)
+		ni_buffer_t *buf, const char *name, const char *type)
 {
-	char buffer[BUFSIZ];
-	ni_buffer_t buf;
-	int status;
-
-	ni_assert(list && script);
-
-	/* Use an initial static (8k) buffer, that should be sufficient.
-	 * When it gets full, it will be automatically reallocated... */
-	memset(buffer, 0, sizeof(buffer));
-	ni_buffer_init(&buf, &buffer, sizeof(buffer));
+	ni_assert(list && buf);
 
-	status = ni_netif_firmware_discovery_script_call(&buf, script,
-					env, type, root, path);
-
-	if (status == NI_PROCESS_SUCCESS && ni_buffer_count(&buf)) {
-
-		if (!ni_netif_firmware_ifnames_parse(list, name, &buf)) {
-			ni_debug_ifconfig("%s discovery script failure: invalid list output", type);
-			ni_netif_firmware_ifnames_list_destroy(list);
-			/* hmm... NI_ERROR_DOCUMENT_ERROR? */
-			status = NI_WICKED_RC_ERROR;
-		}
+	if (ni_buffer_count(buf) && !ni_netif_firmware_ifnames_parse(list, name, buf)) {
+		ni_debug_ifconfig("%s discovery script failure: invalid list output", type);
+		ni_netif_firmware_ifnames_list_destroy(list);
+		/* hmm... NI_ERROR_DOCUMENT_ERROR? */
+		return NI_WICKED_RC_ERROR;
 	}
-	ni_buffer_destroy(&buf);
-	return status;
+	return NI_PROCESS_SUCCESS;
 }
 
 ni_bool_t
 ni_netif_firmware_discover_ifnames(ni_netif_firmware_ifnames_t **list,
 		const char *type, const char *root, const char *path)
 {
+	ni_netif_firmware_discovery_t *jobs = NULL;
 	unsigned int success = 0;
 	unsigned int failure = 0;
-	ni_extension_t *ex;
+	unsigned int i, count;
 	char *name = NULL;
 
 	if (!list || !ni_global.config)
@@ -418,42 +588,21 @@ ni_netif_firmware_discover_ifnames(ni_netif_firmware_ifnames_t **list,
 	if (!ni_netif_firmware_name_from_path(&name, &path))
 		return FALSE;
 
-	for (ex = ni_global.config->fw_extensions; ex; ex = ex->next) {
-		ni_script_action_t *script;
-
-		if (ni_string_empty(ex->name) || !ex->enabled)
-			continue;
-
-		/* Check if to use specific type/name only (e.g. "ibft") */
-		if (name && !ni_string_eq_nocase(name, ex->name))
-			continue;
-
-		/* builtins are not supported in netif-firmware-discovery */
-
-		if ((script = ni_script_action_list_find(ex->actions, "list-ifnames"))) {
-			ni_netif_firmware_ifnames_t *curr = NULL;
-			char *full = NULL;
-
-			/* Check if script is usable/non-empty and executable */
-			if (!ni_netif_firmware_extension_script_usable(script))
-				continue;
-
-			/* Construct full firmware type name, e.g. firmware:ibft */
-			if (!ni_string_printf(&full, "%s:%s", type, ex->name))
-				continue;
-
-			if (ni_netif_firmware_discover_script_ifnames(&curr,
-					script, &ex->environment, ex->name,
-					full, root, path) == 0) {
-				ni_netif_firmware_ifnames_list_append(list, curr);
-				success++;
-			} else {
-				failure++;
-			}
+	count = ni_netif_firmware_discovery_run(&jobs, "list-ifnames",
+						name, type, root, path);
+	for (i = 0; i < count; ++i) {
+		ni_netif_firmware_ifnames_t *curr = NULL;
 
-			ni_string_free(&full);
+		if (jobs[i].status == NI_PROCESS_SUCCESS &&
+		    ni_netif_firmware_discover_script_ifnames(&curr, &jobs[i].buf,
+				jobs[i].ex->name, jobs[i].type) == 0) {
+			ni_netif_firmware_ifnames_list_append(list, curr);
+			success++;
+		} else {
+			failure++;
 		}
 	}
+	ni_netif_firmware_discovery_destroy(jobs, count);
 	ni_string_free(&name);
 
 	if (failure && !success)
@@ -27,6 +27,13 @@
 
 typedef struct ni_netif_firmware_ifnames	ni_netif_firmware_ifnames_t;
 
+/*
+ * Signature of a <builtin> action symbol: appends the same output as
+ * the corresponding script action (xml or ifnames list) to the buffer.
+ */
+typedef int				ni_netif_firmware_discovery_builtin_t(ni_buffer_t *,
+							const char *root, const char *path);
+
 struct ni_netif_firmware_ifnames {
 	ni_netif_firmware_ifnames_t *	next;
 	char *				fwname;
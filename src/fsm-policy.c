@@ -16,8 +16,10 @@
 
 #include "client/ifconfig.h"
 #include "util_priv.h"
+#include "array_priv.h"
 
 #define NI_FSM_POLICY_ARRAY_CHUNK	2
+#define NI_FSM_POLICY_INDEX_BUCKETS	256
 
 /*
  * The <match> expression
@@ -29,6 +31,13 @@ typedef void		ni_ifcondition_free_fn_t(ni_ifcondition_t *);
 struct ni_ifcondition {
 	ni_ifcondition_check_fn_t *	check;
 	ni_ifcondition_free_fn_t *	free;
+	unsigned int			cost;	/* relative cost of the check */
+	ni_bool_t			local;	/* checks the worker's own state only */
+
+	union {
+		unsigned int		uint;
+		ni_wireless_ssid_t	ssid;
+	} value;			/* cdata resolved by the compile step */
 
 	union {
 		struct {
@@ -89,6 +98,7 @@ struct ni_fsm_policy_action {
 		unsigned int		serial;
 		ni_bool_t		instantiate_multi;
 		ni_fsm_template_input_t *inputs;
+		xml_node_t *		document;	/* transformed template */
 	} create;
 };
 
@@ -116,10 +126,31 @@ struct ni_fsm_policy {
 
 	ni_ifcondition_t *		match;
 
+	/* last match result, valid while the policy seq and
+	 * the worker generation did not change */
+	struct {
+		const ni_ifworker_t *	worker;
+		unsigned int		generation;
+		unsigned int		seq;
+		ni_bool_t		result;
+	} cache;
+
 	ni_fsm_policy_action_t *	create_action;
 	ni_fsm_policy_action_t *	actions;
 };
 
+/*
+ * Policies by name hash; a policy applies to the worker with
+ * the matching name only, so we don't need to check them all.
+ */
+struct ni_fsm_policy_index {
+	unsigned int			gen;
+	ni_fsm_policy_array_t		bucket[NI_FSM_POLICY_INDEX_BUCKETS];
+};
+
+/* bumped on every policy list change to invalidate the indexes */
+static unsigned int			ni_fsm_policy_list_gen = 1;
+
 
 static void			ni_fsm_policy_reset(ni_fsm_policy_t *);
 static void			ni_fsm_policy_destroy(ni_fsm_policy_t *);
@@ -147,6 +178,7 @@ ni_fsm_policy_list_insert(ni_fsm_policy_t **list, ni_fsm_policy_t *policy)
 	if (policy->next)
 		policy->next->pprev = &policy->next;
 	*list = policy;
+	ni_fsm_policy_list_gen++;
 }
 
 static inline void
@@ -160,6 +192,8 @@ ni_fsm_policy_list_unlink(ni_fsm_policy_t *policy)
 		*pprev = next;
 	if (next)
 		next->pprev = pprev;
+	if (pprev)
+		ni_fsm_policy_list_gen++;
 	policy->pprev = NULL;
 	policy->next = NULL;
 }
@@ -197,6 +231,7 @@ ni_fsm_policy_reset(ni_fsm_policy_t *policy)
 		ni_ifcondition_free(policy->match);
 		policy->match = NULL;
 	}
+	memset(&policy->cache, 0, sizeof(policy->cache));
 	while (policy->actions) {
 		ni_fsm_policy_action_t *a = policy->actions;
 
@@ -427,6 +462,9 @@ ni_fsm_policy_new(ni_fsm_t *fsm, const char *name, xml_node_t *node)
 		return NULL;
 	}
 
+	if (!fsm->policy_index)
+		fsm->policy_index = xcalloc(1, sizeof(*fsm->policy_index));
+
 	ni_fsm_policy_list_insert(&fsm->policies, policy);
 	return policy;
 }
@@ -511,12 +549,64 @@ ni_fsm_policies_changed_since(const ni_fsm_t *fsm, unsigned int *tstamp)
 	return rv;
 }
 
+static void
+ni_fsm_policy_index_destroy(ni_fsm_policy_index_t *index)
+{
+	unsigned int i;
+
+	for (i = 0; i < NI_FSM_POLICY_INDEX_BUCKETS; ++i)
+		ni_fsm_policy_array_destroy(&index->bucket[i]);
+	index->gen = 0;
+}
+
+void
+ni_fsm_policy_index_free(ni_fsm_t *fsm)
+{
+	if (fsm && fsm->policy_index) {
+		ni_fsm_policy_index_destroy(fsm->policy_index);
+		free(fsm->policy_index);
+		fsm->policy_index = NULL;
+	}
+}
+
+/*
+ * Get the index bucket with the policies for a policy name,
+ * (re)building the index after changes to the policy list.
+ */
+static const ni_fsm_policy_array_t *
+ni_fsm_policy_index_lookup(const ni_fsm_t *fsm, const char *name)
+{
+	ni_fsm_policy_index_t *index = fsm->policy_index;
+	ni_fsm_policy_t *policy;
+
+	if (!index)
+		return NULL;
+
+	if (index->gen != ni_fsm_policy_list_gen) {
+		ni_fsm_policy_index_destroy(index);
+
+		for (policy = fsm->policies; policy; policy = policy->next) {
+			ni_fsm_policy_array_append(&index->bucket[ni_string_hash(policy->name)
+						% NI_FSM_POLICY_INDEX_BUCKETS], policy);
+		}
+		index->gen = ni_fsm_policy_list_gen;
+	}
+
+	return &index->bucket[ni_string_hash(name) % NI_FSM_POLICY_INDEX_BUCKETS];
+}
+
 ni_fsm_policy_t *
 ni_fsm_policy_by_name(const ni_fsm_t *fsm, const char *name)
 {
+	const ni_fsm_policy_array_t *bucket;
 	ni_fsm_policy_t *policy;
+	unsigned int i;
 
-	for (policy = fsm->policies; policy; policy = policy->next) {
+	if (!(bucket = ni_fsm_policy_index_lookup(fsm, name)))
+		return NULL;
+
+	for (i = 0; i < bucket->count; ++i) {
+		policy = bucket->data[i];
 		if (policy->name && ni_string_eq(policy->name, name))
 			return policy;
 	}
@@ -599,21 +689,17 @@ ni_fsm_policy_weight(const ni_fsm_policy_t *policy)
  * Check whether policy applies to this ifworker
  */
 static ni_bool_t
-ni_fsm_policy_applicable(const ni_fsm_t *fsm, ni_fsm_policy_t *policy, ni_ifworker_t *w)
+__ni_fsm_policy_applicable(const ni_fsm_t *fsm, ni_fsm_policy_t *policy, ni_ifworker_t *w,
+				const char *pname)
 {
 	xml_node_t *node;
-	char *pname;
 
 	if (!policy || !w)
 		return FALSE;
 
 	/* 1st match check -ifworker to policy name comparison */
-	pname = ni_ifpolicy_name_from_ifname(w->name);
-	if (!ni_string_eq(policy->name, pname)) {
-		ni_string_free(&pname);
+	if (!ni_string_eq(policy->name, pname))
 		return FALSE;
-	}
-	ni_string_free(&pname);
 
 	/* 2nd match check - ifworker  to config name comparison */
 	if (!xml_node_is_empty(w->config.node) &&
@@ -645,6 +731,51 @@ ni_fsm_policy_applicable(const ni_fsm_t *fsm, ni_fsm_policy_t *policy, ni_ifwork
 	return TRUE;
 }
 
+/*
+ * Cached variant of the above: the result can't change as long as
+ * neither the policy (seq) nor the worker (generation) changed, but
+ * only when <match> does not look at other workers, e.g. children.
+ */
+static ni_bool_t
+ni_fsm_policy_applicable_cached(const ni_fsm_t *fsm, ni_fsm_policy_t *policy,
+				ni_ifworker_t *w, const char *pname)
+{
+	ni_bool_t result;
+
+	if (!policy || !w)
+		return FALSE;
+
+	if (!policy->match || !policy->match->local)
+		return __ni_fsm_policy_applicable(fsm, policy, w, pname);
+
+	if (policy->cache.worker == w &&
+	    policy->cache.generation == w->generation &&
+	    policy->cache.seq == policy->seq)
+		return policy->cache.result;
+
+	result = __ni_fsm_policy_applicable(fsm, policy, w, pname);
+	policy->cache.worker = w;
+	policy->cache.generation = w->generation;
+	policy->cache.seq = policy->seq;
+	policy->cache.result = result;
+	return result;
+}
+
+static ni_bool_t
+ni_fsm_policy_applicable(const ni_fsm_t *fsm, ni_fsm_policy_t *policy, ni_ifworker_t *w)
+{
+	ni_bool_t rv;
+	char *pname;
+
+	if (!policy || !w)
+		return FALSE;
+
+	pname = ni_ifpolicy_name_from_ifname(w->name);
+	rv = ni_fsm_policy_applicable_cached(fsm, policy, w, pname);
+	ni_string_free(&pname);
+	return rv;
+}
+
 /*
  * Compare the weight of two policies.
  * Returns < 0 if a's weight is smaller than that of b, etc.
@@ -665,8 +796,8 @@ ni_fsm_policy_compare_weight(const ni_fsm_policy_t *a, const ni_fsm_policy_t *b)
 static int
 ni_fsm_policy_compare(const void *a, const void *b)
 {
-	const ni_fsm_policy_t *pa = a;
-	const ni_fsm_policy_t *pb = b;
+	const ni_fsm_policy_t *pa = *(const ni_fsm_policy_t * const *)a;
+	const ni_fsm_policy_t *pb = *(const ni_fsm_policy_t * const *)b;
 
 	return ((int) pa->weight) - ((int) pb->weight);
 }
@@ -678,15 +809,29 @@ unsigned int
 ni_fsm_policy_get_applicable_policies(const ni_fsm_t *fsm, ni_ifworker_t *w,
 			const ni_fsm_policy_t **result, unsigned int max)
 {
-	unsigned int count = 0;
+	const ni_fsm_policy_array_t *bucket;
+	unsigned int i, count = 0;
 	ni_fsm_policy_t *policy;
+	char *pname;
 
 	if (!w) {
 		ni_error("unable to get applicable policy for non-existing device");
 		return 0;
 	}
 
-	for (policy = fsm->policies; policy; policy = policy->next) {
+	/* there is no index when no policy has been created yet */
+	pname = ni_ifpolicy_name_from_ifname(w->name);
+	if (!pname || !(bucket = ni_fsm_policy_index_lookup(fsm, pname))) {
+		ni_string_free(&pname);
+		return 0;
+	}
+
+	for (i = 0; i < bucket->count; ++i) {
+		policy = bucket->data[i];
+
+		if (!ni_string_eq(policy->name, pname))
+			continue;
+
 		if (!ni_ifpolicy_name_is_valid(policy->name)) {
 			ni_error("policy with invalid name %s", policy->name);
 			continue;
@@ -702,11 +847,12 @@ ni_fsm_policy_get_applicable_policies(const ni_fsm_t *fsm, ni_ifworker_t *w,
 			continue;
 		}
 
-		if (ni_fsm_policy_applicable(fsm, policy, w)) {
+		if (ni_fsm_policy_applicable_cached(fsm, policy, w, pname)) {
 			if (count < max)
 				result[count++] = policy;
 		}
 	}
+	ni_string_free(&pname);
 
 	qsort(result, count, sizeof(result[0]), ni_fsm_policy_compare);
 	return count;
@@ -914,6 +1060,7 @@ ni_fsm_policy_action_free(ni_fsm_policy_action_t *action)
 			action->create.inputs = input->next;
 			ni_fsm_template_input_free(input);
 		}
+		xml_node_free(action->create.document);
 	}
 	free(action);
 }
@@ -1004,6 +1151,25 @@ ni_fsm_policy_action_xml_lookup(xml_node_t *node, const char *path)
 	return cur;
 }
 
+/*
+ * Look up the path nodes to modify in a document, which may be shared
+ * (e.g. it is the data of a previous replace action). The document is
+ * copied on write only when the action has something to modify in it.
+ */
+static xml_node_array_t *
+ni_fsm_policy_action_xml_lookup_unshare(xml_node_t **node, const char *path)
+{
+	xml_node_array_t *nodes;
+
+	nodes = ni_fsm_policy_action_xml_lookup(*node, path);
+	if (!nodes || !nodes->count || (*node)->refcount == 1)
+		return nodes;
+
+	xml_node_array_free(nodes);
+	*node = xml_node_unshare(*node);
+	return ni_fsm_policy_action_xml_lookup(*node, path);
+}
+
 /*
  * ifpolicy merge action
  *   <merge path="/foo">
@@ -1025,12 +1191,13 @@ ni_fsm_policy_action_xml_merge(const ni_fsm_policy_action_t *action, xml_node_t
 		return node;
 
 	if (action->xpath == NULL) {
+		node = xml_node_unshare(node);
 		xml_node_merge(node, action->data);
 		node->final = action->final;
 		return node;
 	}
 
-	nodes = ni_fsm_policy_action_xml_lookup(node, action->xpath);
+	nodes = ni_fsm_policy_action_xml_lookup_unshare(&node, action->xpath);
 	if (nodes == NULL)
 		return NULL;
 
@@ -1070,7 +1237,7 @@ ni_fsm_policy_action_xml_replace(const ni_fsm_policy_action_t *action, xml_node_
 		return xml_node_clone_ref(action->data);
 	}
 
-	nodes = ni_fsm_policy_action_xml_lookup(node, action->xpath);
+	nodes = ni_fsm_policy_action_xml_lookup_unshare(&node, action->xpath);
 	if (nodes == NULL)
 		return NULL;
 
@@ -1164,8 +1331,15 @@ ni_fsm_template_instantiate(const ni_fsm_t *fsm, ni_fsm_policy_t *policy, const
 	return config;
 }
 
-xml_node_t *
-ni_fsm_template_build_document(ni_fsm_policy_t *policy, ni_fsm_policy_action_t *action)
+/*
+ * The merge and replace actions of a template do not depend on the
+ * devices bound to the inputs, so we transform the document once and
+ * cache it in the create action (freed with the actions on policy
+ * reset). Each instance is a copy of it, with the instance name set
+ * in multi instance templates and the device paths bound afterwards.
+ */
+static xml_node_t *
+ni_fsm_template_transform_document(ni_fsm_policy_t *policy, ni_fsm_policy_action_t *action)
 {
 	xml_node_t *config;
 
@@ -1177,15 +1351,7 @@ ni_fsm_template_build_document(ni_fsm_policy_t *policy, ni_fsm_policy_action_t *
 	}
 
 	xml_node_add_attr(config, "class", action->create.class->name);
-
-	if (action->create.instantiate_multi) {
-		char new_name[128];
-
-		snprintf(new_name, sizeof(new_name), "%s%u", policy->name, action->create.serial++);
-		xml_node_new_element("name", config, new_name);
-	} else {
-		xml_node_new_element("name", config, policy->name);
-	}
+	xml_node_new_element("name", config, policy->name);
 
 	/* Now transform the document */
 	for (action = policy->actions; action; action = action->next) {
@@ -1211,6 +1377,30 @@ ni_fsm_template_build_document(ni_fsm_policy_t *policy, ni_fsm_policy_action_t *
 	return config;
 }
 
+xml_node_t *
+ni_fsm_template_build_document(ni_fsm_policy_t *policy, ni_fsm_policy_action_t *action)
+{
+	xml_node_t *config, *name;
+
+	if (!action->create.document &&
+	    !(action->create.document = ni_fsm_template_transform_document(policy, action)))
+		return NULL;
+
+	if (!(config = xml_node_clone(action->create.document, NULL)))
+		return NULL;
+
+	if (action->create.instantiate_multi) {
+		char new_name[128];
+
+		snprintf(new_name, sizeof(new_name), "%s%u", policy->name, action->create.serial++);
+		if ((name = xml_node_get_child(config, "name")) &&
+		    ni_string_eq(name->cdata, policy->name))
+			xml_node_set_cdata(name, new_name);
+	}
+
+	return config;
+}
+
 ni_bool_t
 ni_fsm_template_bind_devices(ni_fsm_policy_t *policy, ni_fsm_policy_action_t *action, xml_node_t *node)
 {
@@ -1667,11 +1857,9 @@ ni_fsm_policy_match_device_alias_check(const ni_ifcondition_t *cond, const ni_fs
 static ni_bool_t
 ni_fsm_policy_match_device_ifindex_check(const ni_ifcondition_t *cond, const ni_fsm_t *fsm, ni_ifworker_t *w)
 {
-	unsigned int ifindex;
-
-	if (ni_parse_uint(cond->args.string, &ifindex, 10) < 0 || !ifindex)
+	if (!cond->value.uint)
 		return FALSE;
-	return ni_ifworker_match_netdev_ifindex(w, ifindex);
+	return ni_ifworker_match_netdev_ifindex(w, cond->value.uint);
 }
 
 static ni_ifcondition_t *
@@ -1966,9 +2154,9 @@ ni_ifcondition_reference(xml_node_t *node)
 static ni_bool_t
 ni_fsm_policy_match_wireless_essid_check(const ni_ifcondition_t *cond, const ni_fsm_t *fsm, ni_ifworker_t *w)
 {
+	const ni_wireless_ssid_t *ssid = &cond->value.ssid;
 	ni_netdev_t *dev;
 	ni_wireless_t *wireless;
-	ni_wireless_ssid_t ssid;
 	ni_wireless_bss_t *bss;
 	ni_stringbuf_t sbuf = NI_STRINGBUF_INIT_DYNAMIC;
 
@@ -1978,17 +2166,13 @@ ni_fsm_policy_match_wireless_essid_check(const ni_ifcondition_t *cond, const ni_
 	if (!(bss = wireless->scan.bsss))
 		return FALSE;
 
-	if (!ni_wireless_ssid_parse(&ssid, cond->args.string))
-		return FALSE;
-
-
 	for (; bss; bss = bss->next) {
-		if (!ni_wireless_ssid_eq(&ssid, &bss->ssid))
+		if (!ni_wireless_ssid_eq(ssid, &bss->ssid))
 			continue;
 
 		if (ni_debug_guard(NI_LOG_DEBUG2, NI_TRACE_IFCONFIG)) {
 			ni_trace("%s - ssid `%s` MATCH - bssid:%s age:%u signal:%hd",
-					__func__, ni_wireless_ssid_print(&ssid, &sbuf),
+					__func__, ni_wireless_ssid_print(ssid, &sbuf),
 					ni_link_address_print(&bss->bssid),
 					bss->age, bss->signal );
 			ni_stringbuf_destroy(&sbuf);
@@ -2126,6 +2310,131 @@ ni_ifcondition_from_xml(xml_node_t *node)
 	return NULL;
 }
 
+/*
+ * Compile step run once on a parsed condition tree: resolve the cdata
+ * the checks would parse on each call and reorder the terms of each
+ * <and>/<or> chain by increasing cost, so the cheap and selective
+ * checks short-circuit before the expensive ones, e.g. a reference
+ * looping over all workers or a wireless scan result lookup.
+ * A tree is local when none of its checks inspects other workers
+ * or the scan results, so its result can be cached per worker.
+ */
+#define NI_IFCONDITION_COST_SIMPLE	1
+#define NI_IFCONDITION_COST_LOOKUP	2
+#define NI_IFCONDITION_COST_SCAN	4
+#define NI_IFCONDITION_COST_CHILDREN	8
+#define NI_IFCONDITION_COST_WORKERS	16
+
+typedef struct ni_ifcondition_chain {
+	unsigned int			count;
+	ni_ifcondition_t **		terms;
+	unsigned int			nconn;
+	ni_ifcondition_t **		conn;
+} ni_ifcondition_chain_t;
+
+static unsigned int			ni_ifcondition_compile(ni_ifcondition_t *);
+
+static void
+ni_ifcondition_chain_collect(ni_ifcondition_chain_t *chain, ni_ifcondition_t *cond,
+				ni_ifcondition_check_fn_t *op)
+{
+	if (cond->check == op) {
+		chain->conn = xrealloc(chain->conn, (chain->nconn + 1) * sizeof(cond));
+		chain->conn[chain->nconn++] = cond;
+
+		ni_ifcondition_chain_collect(chain, cond->args.terms.left, op);
+		ni_ifcondition_chain_collect(chain, cond->args.terms.right, op);
+	} else {
+		chain->terms = xrealloc(chain->terms, (chain->count + 1) * sizeof(cond));
+		chain->terms[chain->count++] = cond;
+	}
+}
+
+static unsigned int
+ni_ifcondition_compile_chain(ni_ifcondition_t *cond)
+{
+	ni_ifcondition_chain_t chain;
+	ni_ifcondition_t *term;
+	unsigned int i, j, cost = 0;
+	ni_bool_t local = TRUE;
+
+	memset(&chain, 0, sizeof(chain));
+	ni_ifcondition_chain_collect(&chain, cond, cond->check);
+
+	/* stable insertion sort, keeping the order of same cost terms */
+	for (i = 0; i < chain.count; ++i) {
+		term = chain.terms[i];
+		cost += ni_ifcondition_compile(term);
+		local = local && term->local;
+
+		for (j = i; j > 0 && chain.terms[j - 1]->cost > term->cost; --j)
+			chain.terms[j] = chain.terms[j - 1];
+		chain.terms[j] = term;
+	}
+
+	/* relink the connectors as a left-deep chain, cond stays the root */
+	for (i = 0; i < chain.nconn; ++i) {
+		chain.conn[i]->args.terms.right = chain.terms[chain.count - 1 - i];
+		chain.conn[i]->args.terms.left  = i + 1 < chain.nconn ?
+						chain.conn[i + 1] : chain.terms[0];
+		chain.conn[i]->cost = cost;
+		chain.conn[i]->local = local;
+	}
+	free(chain.terms);
+	free(chain.conn);
+	return cond->cost = cost;
+}
+static unsigned int
+ni_ifcondition_compile(ni_ifcondition_t *cond)
+{
+	ni_ifcondition_check_fn_t *check = cond->check;
+
+	if (check == ni_fsm_policy_match_and_check ||
+	    check == ni_fsm_policy_match_or_check)
+		return ni_ifcondition_compile_chain(cond);
+
+	cond->local = TRUE;
+	if (check == ni_fsm_policy_match_not_check) {
+		cond->cost = ni_ifcondition_compile(cond->args.terms.left);
+		cond->local = cond->args.terms.left->local;
+	} else
+	if (check == ni_fsm_policy_match_and_children_check) {
+		cond->cost = NI_IFCONDITION_COST_CHILDREN *
+			ni_ifcondition_compile(cond->args.terms.left);
+		cond->local = FALSE;
+	} else
+	if (check == ni_fsm_policy_match_reference) {
+		cond->cost = NI_IFCONDITION_COST_WORKERS *
+			ni_ifcondition_compile(cond->args.ref);
+		cond->local = FALSE;
+	} else
+	if (check == ni_fsm_policy_match_device_ifindex_check) {
+		if (ni_parse_uint(cond->args.string, &cond->value.uint, 10) < 0)
+			cond->value.uint = 0;
+		cond->cost = NI_IFCONDITION_COST_SIMPLE;
+	} else
+	if (check == ni_fsm_policy_match_wireless_essid_check) {
+		ni_wireless_ssid_parse(&cond->value.ssid, cond->args.string);
+		cond->cost = NI_IFCONDITION_COST_SCAN;
+		cond->local = FALSE;
+	} else
+	if (check == ni_fsm_policy_match_sharable_check) {
+		/* lowerdev_for is set up by the hierarchy of other workers */
+		cond->cost = NI_IFCONDITION_COST_SIMPLE;
+		cond->local = FALSE;
+	} else
+	if (check == ni_fsm_policy_match_class_check ||
+	    check == ni_fsm_policy_match_device_alias_check ||
+	    check == ni_fsm_policy_match_modem_equipment_id_check ||
+	    check == ni_fsm_policy_match_modem_manufacturer_check ||
+	    check == ni_fsm_policy_match_modem_model_check)
+		cond->cost = NI_IFCONDITION_COST_LOOKUP;
+	else
+		cond->cost = NI_IFCONDITION_COST_SIMPLE;
+
+	return cond->cost;
+}
+
 /*
  * When the policy's <match> element contains several children, this
  * is treated as an <and> statement
@@ -2133,7 +2442,11 @@ ni_ifcondition_from_xml(xml_node_t *node)
 ni_ifcondition_t *
 ni_fsm_policy_conditions_from_xml(xml_node_t *node)
 {
-	return ni_ifcondition_and(node);
+	ni_ifcondition_t *cond;
+
+	if ((cond = ni_ifcondition_and(node)))
+		ni_ifcondition_compile(cond);
+	return cond;
 }
 
 void
@@ -2189,25 +2502,14 @@ ni_fsm_policy_array_move(ni_fsm_policy_array_t *dst, ni_fsm_policy_array_t *src)
 	return FALSE;
 }
 
-static ni_bool_t
-ni_fsm_policy_array_realloc(ni_fsm_policy_array_t *array, unsigned int newsize)
+ni_bool_t
+ni_fsm_policy_array_reserve(ni_fsm_policy_array_t *array, unsigned int count)
 {
-	ni_fsm_policy_t **newdata;
-	unsigned int i;
-
-	if (!array || (UINT_MAX - NI_FSM_POLICY_ARRAY_CHUNK) <= newsize)
-		return FALSE;
-
-	newsize = newsize + NI_FSM_POLICY_ARRAY_CHUNK;
-	newdata	= realloc(array->data, (size_t)newsize * sizeof(*newdata));
-	if (!newdata)
+	if (!array || (UINT_MAX - array->count) < count)
 		return FALSE;
 
-	array->data = newdata;
-	for (i = array->count; i < newsize; ++i)
-		array->data[i] = NULL;
-
-	return TRUE;
+	return ni_array_grow((void **)&array->data, sizeof(*array->data), array->count,
+				array->count + count, NI_FSM_POLICY_ARRAY_CHUNK);
 }
 
 ni_bool_t
@@ -2224,8 +2526,7 @@ ni_fsm_policy_array_insert(ni_fsm_policy_array_t *array, unsigned int index, ni_
 	if (!array || !policy || !(ref = ni_fsm_policy_ref(policy)))
 		return FALSE;
 
-	if ((array->count % NI_FSM_POLICY_ARRAY_CHUNK) == 0 &&
-	    !ni_fsm_policy_array_realloc(array, array->count)) {
+	if (!ni_fsm_policy_array_reserve(array, 1)) {
 		ni_fsm_policy_free(ref);
 		return FALSE;
 	}
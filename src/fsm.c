@@ -8,8 +8,11 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/time.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
@@ -32,6 +35,13 @@
 #include "client/ifconfig.h"
 #include "appconfig.h"
 #include "util_priv.h"
+#include "json.h"
+#include "probes.h"
+#include "stats.h"
+#include "profile.h"
+#include "array_priv.h"
+
+#define NI_IFWORKER_ARRAY_CHUNK		16
 
 static ni_fsm_user_prompt_fn_t *ni_fsm_user_prompt_fn;
 static void *			ni_fsm_user_prompt_data;
@@ -63,12 +73,16 @@ static void			ni_ifworker_advance_state(ni_ifworker_t *, ni_event_t);
 static ni_bool_t		ni_ifworker_revert_state(ni_ifworker_t *, ni_event_t);
 static ni_bool_t		ni_ifworker_del_child_master(xml_node_t *);
 static void			ni_fsm_clear_hierarchy(ni_ifworker_t *);
+static void			ni_ifworker_timings_destroy(ni_ifworker_t *);
+static void			ni_fsm_timings_profile(const ni_fsm_t *);
 
 static void			ni_ifworker_update_client_state_control(ni_ifworker_t *w);
 static inline void		ni_ifworker_update_client_state_config(ni_ifworker_t *w);
 static void			ni_ifworker_update_client_state_scripts(ni_ifworker_t *w);
 static void			ni_fsm_events_destroy(ni_fsm_event_t **);
 static void			ni_fsm_process_event(ni_fsm_t *, ni_fsm_event_t *);
+static void			ni_fsm_async_calls_cancel(ni_fsm_t *, ni_ifworker_t *);
+static ni_bool_t		ni_fsm_async_call_pending(const ni_fsm_t *, const char *);
 
 
 ni_fsm_t *
@@ -78,6 +92,10 @@ ni_fsm_new(void)
 
 	fsm = calloc(1, sizeof(*fsm));
 	fsm->readonly = FALSE;
+	fsm->calls.limit = ni_config_fsm_parallel_calls();
+	fsm->calls.latency = ni_config_fsm_parallel_calls_latency();
+	fsm->calls.window = fsm->calls.limit;
+	fsm->timings = ni_config_fsm_timings() || ni_profile_enabled();
 
 	ni_fsm_user_prompt_fn = ni_fsm_user_prompt_default;
 	return fsm;
@@ -86,14 +104,25 @@ ni_fsm_new(void)
 void
 ni_fsm_free(ni_fsm_t *fsm)
 {
+	ni_dbus_client_t *client;
 	unsigned int i;
 
+	/* drop the signal handlers ni_fsm_create_client added for us */
+	if (fsm->client_root_object &&
+	    (client = ni_dbus_object_get_client(fsm->client_root_object)))
+		ni_dbus_client_remove_signal_handlers(client, fsm);
+
+	ni_fsm_async_calls_cancel(fsm, NULL);
+	ni_fsm_timings_profile(fsm);
 	for (i = 0; i < fsm->workers.count; ++i)
 		ni_ifworker_reset(fsm->workers.data[i]);
 
 	ni_fsm_events_destroy(&fsm->events);
+	fsm->events_last = NULL;
+	ni_ifworker_array_destroy(&fsm->blockers);
 	ni_ifworker_array_destroy(&fsm->pending);
 	ni_ifworker_array_destroy(&fsm->workers);
+	ni_fsm_policy_index_free(fsm);
 	free(fsm);
 }
 
@@ -107,7 +136,7 @@ ni_fsm_event_new(const char *object_path, const char *signal_name, ni_event_t ev
 	ni_fsm_event_t *ev;
 
 	ev = xcalloc(1, sizeof(*ev));
-	ni_string_dup(&ev->object_path, object_path);
+	ni_string_intern_set(&ev->object_path, object_path);
 	ni_string_dup(&ev->signal_name, signal_name);
 	ev->event_type = event_type;
 	return ev;
@@ -117,7 +146,7 @@ void
 ni_fsm_event_free(ni_fsm_event_t *ev)
 {
 	if (ev) {
-		ni_string_free(&ev->object_path);
+		ni_string_intern_free(&ev->object_path);
 		ni_string_free(&ev->signal_name);
 		free(ev);
 	}
@@ -163,6 +192,48 @@ ni_fsm_events_destroy(ni_fsm_event_t **events)
 	}
 }
 
+/*
+ * The fsm event queue maintains a tail pointer for O(1) appends and
+ * coalesces an event with the last queued one, when it is for the
+ * same object-path, event type and uuid. This keeps the queue short
+ * during event storms, e.g. when wickedd emits a sequence of device
+ * (link) change events while a call of the worker is in progress.
+ */
+static inline ni_bool_t
+ni_fsm_event_equal(const ni_fsm_event_t *a, const ni_fsm_event_t *b)
+{
+	return a->object_path == b->object_path &&
+		a->event_type == b->event_type &&
+		ni_uuid_equal(&a->event_uuid, &b->event_uuid);
+}
+
+static ni_bool_t
+ni_fsm_event_enqueue(ni_fsm_t *fsm, ni_fsm_event_t *ev)
+{
+	if (fsm->events_last && ni_fsm_event_equal(fsm->events_last, ev))
+		return FALSE;
+
+	ev->next = NULL;
+	if (fsm->events_last)
+		fsm->events_last->next = ev;
+	else
+		fsm->events = ev;
+	fsm->events_last = ev;
+	return TRUE;
+}
+
+static void
+ni_fsm_event_dequeue(ni_fsm_t *fsm, ni_fsm_event_t *prev, ni_fsm_event_t *ev)
+{
+	if (prev)
+		prev->next = ev->next;
+	else
+		fsm->events = ev->next;
+	if (fsm->events_last == ev)
+		fsm->events_last = prev;
+	ev->next = NULL;
+}
+
 void
 ni_fsm_events_block(ni_fsm_t *fsm)
 {
@@ -183,16 +254,26 @@ ni_fsm_events_unblock(ni_fsm_t *fsm)
 void
 ni_fsm_process_events(ni_fsm_t *fsm)
 {
-	ni_fsm_event_t *ev;
+	ni_fsm_event_t *ev, *prev = NULL;
 
-	while ((ev = fsm->events)) {
-		fsm->events = ev->next;
+	ev = fsm->events;
+	while (ev) {
+		/* Keep events of workers with a call in progress
+		 * until their reply has been processed. */
+		if (ni_fsm_async_call_pending(fsm, ev->object_path)) {
+			prev = ev;
+			ev = ev->next;
+			continue;
+		}
+		ni_fsm_event_dequeue(fsm, prev, ev);
 
 		ni_fsm_events_block(fsm);
 		ni_fsm_process_event(fsm, ev);
 		ni_fsm_events_unblock(fsm);
 
 		ni_fsm_event_free(ev);
+		prev = NULL;
+		ev = fsm->events;
 	}
 }
 
@@ -214,13 +295,30 @@ ni_fsm_fail_count(ni_fsm_t *fsm)
 	return nfailed;
 }
 
+/*
+ * Bump the worker generation on changes of the state the policy
+ * <match> conditions look at, so the cached match results of the
+ * policies get invalidated. The counter is shared by all workers,
+ * a new worker never reuses the generation of a freed one.
+ */
+static inline void
+ni_ifworker_generation_bump(ni_ifworker_t *w)
+{
+	static unsigned int generation = 0;
+
+	if (!++generation)
+		++generation;
+	w->generation = generation;
+}
+
 static inline ni_ifworker_t *
 __ni_ifworker_new(ni_ifworker_type_t type, const char *name)
 {
 	ni_ifworker_t *w;
 
 	w = xcalloc(1, sizeof(*w));
-	ni_string_dup(&w->name, name);
+	ni_stats_object_alloc(NI_STATS_OBJECT_FSM, sizeof(*w));
+	ni_string_intern_set(&w->name, name);
 	w->type = type;
 	w->refcount = 1;
 
@@ -231,6 +329,7 @@ __ni_ifworker_new(ni_ifworker_type_t type, const char *name)
 
 	ni_ifworker_control_init(&w->control);
 	ni_client_state_config_init(&w->config.meta);
+	ni_ifworker_generation_bump(w);
 
 	return w;
 }
@@ -332,6 +431,7 @@ __ni_ifworker_reset_action_table(ni_ifworker_t *w)
 		ni_fsm_require_list_destroy(&action->require.list);
 		ni_ifworker_cancel_callbacks(w, &action->callbacks);
 	}
+	ni_fsm_async_calls_cancel(NULL, w);
 	w->fsm.wait_for = NULL;
 	w->fsm.next_action = w->fsm.action_table;
 }
@@ -385,6 +485,7 @@ ni_ifworker_rearm(ni_ifworker_t *w)
 	w->failed = FALSE;
 	w->kickstarted = FALSE;
 	__ni_ifworker_reset_fsm(w);
+	ni_ifworker_generation_bump(w);
 }
 
 void
@@ -438,14 +539,16 @@ ni_ifworker_free(ni_ifworker_t *w)
 	w->target_range.min = NI_FSM_STATE_NONE;
 	w->target_range.max = __NI_FSM_STATE_MAX;
 
-	ni_string_free(&w->object_path);
+	ni_string_intern_free(&w->object_path);
 	if (w->device)
 		ni_netdev_put(w->device);
 	if (w->modem)
 		ni_modem_release(w->modem);
 
-	ni_string_free(&w->name);
+	ni_ifworker_timings_destroy(w);
+	ni_string_intern_free(&w->name);
 	ni_string_free(&w->old_name);
+	ni_stats_object_free(NI_STATS_OBJECT_FSM, sizeof(*w));
 	free(w);
 }
 
@@ -466,6 +569,13 @@ ni_fsm_require_register_type(const char *name, ni_fsm_require_ctor_t *ctor)
 {
 	ni_fsm_require_type_t *type;
 
+	for (type = ni_fsm_require_type_registry; type; type = type->next) {
+		if (ni_string_eq(type->name, name)) {
+			type->func = ctor;
+			return;
+		}
+	}
+
 	type = xcalloc(1, sizeof(*type));
 	ni_string_dup(&type->name, name);
 	type->func = ctor;
@@ -579,6 +689,276 @@ __ni_ifworker_done(ni_ifworker_t *w)
 		w->completion.callback(w);
 }
 
+/*
+ * Transition timings, recorded when enabled in the fsm
+ */
+static void
+ni_ifworker_timing_finish(ni_ifworker_t *w, ni_bool_t failed)
+{
+	ni_ifworker_timing_t *timing;
+	struct timeval now;
+
+	if (!(timing = w->timings.current))
+		return;
+
+	ni_timer_get_time(&now);
+	timing->duration  = ni_timeout_since(&timing->started, &now, NULL);
+	timing->wait_time = ni_timeout_since(&timing->called, &now, NULL);
+	timing->finished  = TRUE;
+	timing->failed    = failed;
+	w->timings.current = NULL;
+}
+
+static void
+ni_ifworker_timing_start(ni_fsm_t *fsm, ni_ifworker_t *w, const ni_fsm_transition_t *action)
+{
+	ni_ifworker_timing_t *timing, **tail;
+
+	if (!fsm->timings)
+		return;
+
+	ni_ifworker_timing_finish(w, FALSE);
+
+	timing = xcalloc(1, sizeof(*timing));
+	timing->from_state = action->from_state;
+	timing->next_state = action->next_state;
+	ni_timer_get_time(&timing->started);
+	timing->called = timing->started;
+
+	/* hand over the time it has been deferred by its dependencies */
+	if (timerisset(&w->timings.blocked)) {
+		timing->blocked_time = ni_timeout_since(&w->timings.blocked, &timing->started, NULL);
+		timerclear(&w->timings.blocked);
+	}
+	ni_string_array_move(&timing->blocked_by, &w->timings.blockers);
+
+	for (tail = &w->timings.list; *tail; tail = &(*tail)->next)
+		;
+	*tail = timing;
+	w->timings.current = timing;
+}
+
+static void
+ni_ifworker_timing_call(ni_ifworker_t *w, const struct timeval *begin, const struct timeval *end)
+{
+	ni_ifworker_timing_t *timing;
+
+	if (!(timing = w->timings.current))
+		return;
+
+	if (end)
+		timing->called = *end;
+	else
+		ni_timer_get_time(&timing->called);
+
+	timing->call_time += ni_timeout_since(begin, &timing->called, NULL);
+	timing->calls++;
+}
+
+static void
+ni_ifworker_timing_blocked(ni_fsm_t *fsm, ni_ifworker_t *w, const ni_ifworker_t *cw)
+{
+	if (!fsm->timings)
+		return;
+
+	if (!timerisset(&w->timings.blocked))
+		ni_timer_get_time(&w->timings.blocked);
+
+	if (cw && ni_string_array_index(&w->timings.blockers, cw->name) == -1)
+		ni_string_array_append(&w->timings.blockers, cw->name);
+}
+
+/*
+ * Remember the worker, a worker is waiting for while its dependencies
+ * are checked (see ni_ifworker_check_state_req_test).
+ */
+static void
+ni_fsm_schedule_blocked_by(ni_fsm_t *fsm, ni_ifworker_t *cw)
+{
+	if (cw && ni_ifworker_array_index(&fsm->blockers, cw) < 0)
+		ni_ifworker_array_append(&fsm->blockers, cw);
+}
+
+static void
+ni_ifworker_timings_destroy(ni_ifworker_t *w)
+{
+	ni_ifworker_timing_t *timing;
+
+	while ((timing = w->timings.list)) {
+		w->timings.list = timing->next;
+		ni_string_array_destroy(&timing->blocked_by);
+		free(timing);
+	}
+	w->timings.current = NULL;
+
+	timerclear(&w->timings.blocked);
+	ni_string_array_destroy(&w->timings.blockers);
+}
+
+static ni_json_t *
+ni_ifworker_timings_json(const ni_ifworker_t *w, const struct timeval *base, const struct timeval *now)
+{
+	const ni_ifworker_timing_t *timing;
+	ni_json_t *json, *list, *entry, *blocked;
+	ni_timeout_t duration, wait_time;
+	unsigned int i;
+
+	json = ni_json_new_object();
+	ni_json_object_set(json, "name", ni_json_new_string(w->name));
+	ni_json_object_set(json, "ifindex", ni_json_new_int64(w->ifindex));
+	if (w->masterdev)
+		ni_json_object_set(json, "master", ni_json_new_string(w->masterdev->name));
+	if (w->lowerdev)
+		ni_json_object_set(json, "lower", ni_json_new_string(w->lowerdev->name));
+	ni_json_object_set(json, "state", ni_json_new_string(ni_ifworker_state_name(w->fsm.state)));
+	ni_json_object_set(json, "failed", ni_json_new_bool(w->failed));
+
+	list = ni_json_new_array();
+	for (timing = w->timings.list; timing; timing = timing->next) {
+		if (timing->finished) {
+			duration  = timing->duration;
+			wait_time = timing->wait_time;
+		} else {
+			duration  = ni_timeout_since(&timing->started, now, NULL);
+			wait_time = ni_timeout_since(&timing->called, now, NULL);
+		}
+
+		entry = ni_json_new_object();
+		ni_json_object_set(entry, "from", ni_json_new_string(ni_ifworker_state_name(timing->from_state)));
+		ni_json_object_set(entry, "to", ni_json_new_string(ni_ifworker_state_name(timing->next_state)));
+		ni_json_object_set(entry, "start", ni_json_new_int64(ni_timeout_since(base, &timing->started, NULL)));
+		ni_json_object_set(entry, "duration", ni_json_new_int64(duration));
+		ni_json_object_set(entry, "calls", ni_json_new_int64(timing->calls));
+		ni_json_object_set(entry, "call-time", ni_json_new_int64(timing->call_time));
+		ni_json_object_set(entry, "wait-time", ni_json_new_int64(wait_time));
+		ni_json_object_set(entry, "blocked-time", ni_json_new_int64(timing->blocked_time));
+		blocked = ni_json_new_array();
+		for (i = 0; i < timing->blocked_by.count; ++i)
+			ni_json_array_append(blocked, ni_json_new_string(timing->blocked_by.data[i]));
+		ni_json_object_set(entry, "blocked-by", blocked);
+		ni_json_object_set(entry, "finished", ni_json_new_bool(timing->finished));
+		ni_json_object_set(entry, "timeout", ni_json_new_bool(timing->timed_out));
+		ni_json_object_set(entry, "failed", ni_json_new_bool(timing->failed));
+		ni_json_array_append(list, entry);
+	}
+	ni_json_object_set(json, "transitions", list);
+	return json;
+}
+
+/*
+ * Add the recorded transition timings of all workers to the profile
+ * as "fsm-workers;<name>;<from>-><to>;<phase>" stacks; the workers
+ * run in parallel, so their sum may exceed the wall time.
+ */
+static void
+ni_fsm_timings_profile(const ni_fsm_t *fsm)
+{
+	const ni_ifworker_timing_t *timing;
+	ni_timeout_t busy;
+	char stack[256];
+	unsigned int i;
+	ni_ifworker_t *w;
+	int len;
+
+	if (!ni_profile_enabled())
+		return;
+
+	for (i = 0; i < fsm->workers.count; ++i) {
+		w = fsm->workers.data[i];
+
+		for (timing = w->timings.list; timing; timing = timing->next) {
+			len = snprintf(stack, sizeof(stack), "fsm-workers;%s;%s->%s;", w->name,
+					ni_ifworker_state_name(timing->from_state),
+					ni_ifworker_state_name(timing->next_state));
+			if (len <= 0 || (size_t)len >= sizeof(stack) - 16)
+				continue;
+
+			busy = timing->call_time + timing->wait_time;
+			strcpy(stack + len, "blocked");
+			ni_profile_add(stack, timing->blocked_time * 1000);
+			strcpy(stack + len, "dbus-calls");
+			ni_profile_add(stack, timing->call_time * 1000);
+			strcpy(stack + len, "event-wait");
+			ni_profile_add(stack, timing->wait_time * 1000);
+			strcpy(stack + len, "other");
+			ni_profile_add(stack, timing->duration > busy ?
+					(timing->duration - busy) * 1000 : 0);
+		}
+	}
+}
+
+/*
+ * Save the recorded transition timings of all workers as json;
+ * the transition start times are relative to the earliest one.
+ */
+ni_bool_t
+ni_fsm_timings_save(const ni_fsm_t *fsm, const char *path)
+{
+	ni_json_format_options_t options = NI_JSON_OPTIONS_INIT;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	struct timeval base, now;
+	ni_json_t *json, *list;
+	ni_ifworker_t *w;
+	char *tempname = NULL;
+	ni_bool_t ret = FALSE;
+	unsigned int i;
+	FILE *fp;
+	int fd;
+
+	if (!fsm || ni_string_empty(path))
+		return FALSE;
+
+	ni_timer_get_time(&now);
+	timerclear(&base);
+	for (i = 0; i < fsm->workers.count; ++i) {
+		w = fsm->workers.data[i];
+		if (!w->timings.list)
+			continue;
+		if (!timerisset(&base) || timercmp(&w->timings.list->started, &base, <))
+			base = w->timings.list->started;
+	}
+
+	json = ni_json_new_object();
+	list = ni_json_new_array();
+	for (i = 0; i < fsm->workers.count; ++i) {
+		w = fsm->workers.data[i];
+		if (w->timings.list)
+			ni_json_array_append(list, ni_ifworker_timings_json(w, &base, &now));
+	}
+	ni_json_object_set(json, "interfaces", list);
+	ni_json_format_string(&buf, json, &options);
+	ni_json_free(json);
+
+	if (!ni_string_printf(&tempname, "%s.XXXXXX", path)) {
+		ni_stringbuf_destroy(&buf);
+		return FALSE;
+	}
+
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_error("%s: unable to create temporary file: %m", path);
+		goto done;
+	}
+	if (!(fp = fdopen(fd, "we"))) {
+		ni_error("%s: unable to open temporary file: %m", path);
+		close(fd);
+		unlink(tempname);
+		goto done;
+	}
+
+	fprintf(fp, "%s\n", buf.string ? buf.string : "");
+	if (fclose(fp) != 0 || rename(tempname, path) < 0) {
+		ni_error("%s: unable to write fsm timings: %m", path);
+		unlink(tempname);
+		goto done;
+	}
+	ret = TRUE;
+
+done:
+	ni_string_free(&tempname);
+	ni_stringbuf_destroy(&buf);
+	return ret;
+}
+
 void
 ni_ifworker_fail(ni_ifworker_t *w, const char *fmt, ...)
 {
@@ -593,6 +973,7 @@ ni_ifworker_fail(ni_ifworker_t *w, const char *fmt, ...)
 	va_end(ap);
 
 	ni_error("device %s: %s", w->name, ni_string_empty(errmsg) ? "failed" : errmsg);
+	ni_ifworker_timing_finish(w, TRUE);
 	w->fsm.state = NI_FSM_STATE_NONE;
 	w->failed = TRUE;
 	w->pending = FALSE;
@@ -727,6 +1108,9 @@ ni_ifworker_timeout(const ni_timer_t *timer, ni_fsm_timer_ctx_t *tcx)
 	tcx->worker->fsm.timer = NULL;
 	tcx->fsm->timeout_count++;
 
+	if (w->timings.current)
+		w->timings.current->timed_out = TRUE;
+
 	if (ni_ifworker_waiting_for_events(w) || !ni_ifworker_complete(w) || w->pending)
 		ni_ifworker_fail(w, "operation timed out");
 }
@@ -807,6 +1191,204 @@ ni_ifworker_state_from_name(const char *name, unsigned int *state)
 	return TRUE;
 }
 
+/*
+ * Worker arrays with at least NI_IFWORKER_INDEX_MIN_COUNT workers get
+ * lazily built hash indexes by name, object path, ifindex and alias,
+ * holding the positions (+1, 0 is unused) in open addressed tables.
+ * Appends are indexed incrementally, removals drop the index. Changes
+ * of the worker keys bump ni_ifworker_index_gen to invalidate them.
+ */
+#define NI_IFWORKER_INDEX_MIN_COUNT	16
+#define NI_IFWORKER_INDEX_MIN_SIZE	64
+
+struct ni_ifworker_index {
+	unsigned int			gen;
+	unsigned int			count;
+	unsigned int			mask;
+	unsigned int *			name;
+	unsigned int *			path;
+	unsigned int *			ifindex;
+	unsigned int *			alias;	/* device and config alias */
+};
+
+typedef ni_bool_t			ni_ifworker_index_match_fn_t(const ni_ifworker_t *, const void *);
+
+static unsigned int			ni_ifworker_index_gen = 1;
+static unsigned int			ni_ifworker_keys_deferred = 0;
+static ni_bool_t			ni_ifworker_keys_pending = FALSE;
+
+static inline void
+ni_ifworker_keys_changed(void)
+{
+	if (ni_ifworker_keys_deferred)
+		ni_ifworker_keys_pending = TRUE;
+	else
+		ni_ifworker_index_gen++;
+}
+
+/*
+ * Defer the index invalidation while applying a batch of configs;
+ * the config alias keys are stale until ni_ifworker_keys_commit,
+ * so only lookups by name are permitted meanwhile.
+ */
+static inline void
+ni_ifworker_keys_defer(void)
+{
+	ni_ifworker_keys_deferred++;
+}
+
+static inline void
+ni_ifworker_keys_commit(void)
+{
+	if (!ni_ifworker_keys_deferred || --ni_ifworker_keys_deferred)
+		return;
+
+	if (ni_ifworker_keys_pending) {
+		ni_ifworker_keys_pending = FALSE;
+		ni_ifworker_index_gen++;
+	}
+}
+
+static inline unsigned int
+ni_ifworker_index_hash_ifindex(unsigned int ifindex)
+{
+	return ifindex * 2654435761U;
+}
+
+static inline const char *
+ni_ifworker_index_device_alias(const ni_netdev_t *dev)
+{
+	return dev ? dev->link.alias : NULL;
+}
+
+static inline const char *
+ni_ifworker_index_config_alias(const ni_ifworker_t *w)
+{
+	xml_node_t *node;
+
+	if (xml_node_is_empty(w->config.node) ||
+	    !(node = xml_node_get_child(w->config.node, "alias")))
+		return NULL;
+	return node->cdata;
+}
+
+static void
+ni_ifworker_index_free(ni_ifworker_array_t *array)
+{
+	ni_ifworker_index_t *index;
+
+	if ((index = array->index)) {
+		array->index = NULL;
+		free(index->name);
+		free(index->path);
+		free(index->ifindex);
+		free(index->alias);
+		free(index);
+	}
+}
+
+static void
+ni_ifworker_index_slot_set(unsigned int *slots, unsigned int mask, unsigned int hash, unsigned int pos)
+{
+	unsigned int i = hash & mask;
+
+	while (slots[i])
+		i = (i + 1) & mask;
+	slots[i] = pos + 1;
+}
+
+static void
+ni_ifworker_index_insert(ni_ifworker_index_t *index, const ni_ifworker_t *w, unsigned int pos)
+{
+	const char *alias;
+
+	if (w->name)
+		ni_ifworker_index_slot_set(index->name, index->mask, ni_string_hash(w->name), pos);
+	if (w->object_path)
+		ni_ifworker_index_slot_set(index->path, index->mask, ni_string_hash(w->object_path), pos);
+	if (w->ifindex)
+		ni_ifworker_index_slot_set(index->ifindex, index->mask,
+				ni_ifworker_index_hash_ifindex(w->ifindex), pos);
+	if (w->device && (alias = w->device->link.alias))
+		ni_ifworker_index_slot_set(index->alias, index->mask, ni_string_hash(alias), pos);
+	if ((alias = ni_ifworker_index_config_alias(w)))
+		ni_ifworker_index_slot_set(index->alias, index->mask, ni_string_hash(alias), pos);
+	index->count = pos + 1;
+}
+
+static ni_ifworker_index_t *
+ni_ifworker_index_build(ni_ifworker_array_t *array)
+{
+	ni_ifworker_index_t *index;
+	unsigned int i, size;
+
+	ni_ifworker_index_free(array);
+
+	/* up to two aliases per worker, keep the tables at most half full */
+	for (size = NI_IFWORKER_INDEX_MIN_SIZE; size < array->count * 4; size <<= 1)
+		;
+
+	index = xcalloc(1, sizeof(*index));
+	index->gen = ni_ifworker_index_gen;
+	index->mask = size - 1;
+	index->name = xcalloc(size, sizeof(unsigned int));
+	index->path = xcalloc(size, sizeof(unsigned int));
+	index->ifindex = xcalloc(size, sizeof(unsigned int));
+	index->alias = xcalloc(size, sizeof(unsigned int));
+
+	for (i = 0; i < array->count; ++i)
+		ni_ifworker_index_insert(index, array->data[i], i);
+
+	array->index = index;
+	return index;
+}
+
+static ni_ifworker_index_t *
+ni_ifworker_index_get(const ni_ifworker_array_t *array)
+{
+	ni_ifworker_index_t *index = array->index;
+
+	if (array->count < NI_IFWORKER_INDEX_MIN_COUNT)
+		return NULL;
+
+	if (!index || index->gen != ni_ifworker_index_gen || index->count != array->count)
+		index = ni_ifworker_index_build((ni_ifworker_array_t *)array);
+	return index;
+}
+
+static void
+ni_ifworker_index_append(ni_ifworker_array_t *array)
+{
+	ni_ifworker_index_t *index = array->index;
+	unsigned int pos = array->count - 1;
+
+	if (!index || index->gen != ni_ifworker_index_gen || index->count != pos)
+		ni_ifworker_index_free(array);
+	else
+	if (array->count * 4 > index->mask + 1)
+		ni_ifworker_index_build(array);
+	else
+		ni_ifworker_index_insert(index, array->data[pos], pos);
+}
+
+/*
+ * Return the first worker in the array matching the key
+ */
+static ni_ifworker_t *
+ni_ifworker_index_find(const ni_ifworker_array_t *array, const unsigned int *slots,
+			unsigned int mask, unsigned int hash,
+			ni_ifworker_index_match_fn_t *match, const void *key)
+{
+	unsigned int i = hash & mask, pos, best = array->count;
+
+	for ( ; slots[i]; i = (i + 1) & mask) {
+		pos = slots[i] - 1;
+		if (pos < best && match(array->data[pos], key))
+			best = pos;
+	}
+	return best < array->count ? array->data[best] : NULL;
+}
+
 ni_ifworker_array_t *
 ni_ifworker_array_new(void)
 {
@@ -816,14 +1398,28 @@ ni_ifworker_array_new(void)
 	return array;
 }
 
+ni_bool_t
+ni_ifworker_array_reserve(ni_ifworker_array_t *array, unsigned int count)
+{
+	if (!array || (UINT_MAX - array->count) < count)
+		return FALSE;
+
+	return ni_array_grow((void **)&array->data, sizeof(array->data[0]),
+				array->count, array->count + count, NI_IFWORKER_ARRAY_CHUNK);
+}
+
 void
 ni_ifworker_array_append(ni_ifworker_array_t *array, ni_ifworker_t *w)
 {
 	if (!array || !w)
 		return;
 
-	array->data = realloc(array->data, (array->count + 1) * sizeof(array->data[0]));
+	if (!ni_ifworker_array_reserve(array, 1))
+		ni_fatal("allocation failed for %u worker array entries", array->count + 1);
 	array->data[array->count++] = ni_ifworker_get(w);
+
+	if (array->index)
+		ni_ifworker_index_append(array);
 }
 
 int
@@ -842,6 +1438,7 @@ void
 ni_ifworker_array_destroy(ni_ifworker_array_t *array)
 {
 	if (array) {
+		ni_ifworker_index_free(array);
 		while (array->count)
 			ni_ifworker_release(array->data[--(array->count)]);
 		free(array->data);
@@ -856,35 +1453,71 @@ ni_ifworker_array_free(ni_ifworker_array_t *array)
 	free(array);
 }
 
+static ni_bool_t
+ni_ifworker_index_match_path(const ni_ifworker_t *w, const void *object_path)
+{
+	return w->object_path == object_path;
+}
+
 static ni_ifworker_t *
 ni_ifworker_array_find_by_objectpath(ni_ifworker_array_t *array, const char *object_path)
 {
+	ni_ifworker_index_t *index;
 	unsigned int i;
 
-	if (ni_string_empty(object_path))
+	/* worker paths are interned, a path no one holds matches none */
+	if (ni_string_empty(object_path) || !(object_path = ni_string_intern_lookup(object_path)))
 		return NULL;
 
+	if ((index = ni_ifworker_index_get(array)))
+		return ni_ifworker_index_find(array, index->path, index->mask,
+				ni_string_hash(object_path),
+				ni_ifworker_index_match_path, object_path);
+
 	for (i = 0; i < array->count; ++i) {
 		ni_ifworker_t *w = array->data[i];
 
-		if (ni_string_eq(w->object_path, object_path))
+		if (w->object_path == object_path)
 			return w;
 	}
 	return NULL;
 }
 
+typedef struct ni_ifworker_index_name_key {
+	ni_ifworker_type_t		type;
+	const char *			name;
+} ni_ifworker_index_name_key_t;
+
+static ni_bool_t
+ni_ifworker_index_match_name(const ni_ifworker_t *w, const void *data)
+{
+	const ni_ifworker_index_name_key_t *key = data;
+
+	return w->type == key->type && w->name == key->name;
+}
+
 static ni_ifworker_t *
 ni_ifworker_array_find_by_name(const ni_ifworker_array_t *array, ni_ifworker_type_t type, const char *name)
 {
+	ni_ifworker_index_name_key_t key;
+	ni_ifworker_index_t *index;
 	unsigned int i;
 
-	if (ni_string_empty(name))
+	/* worker names are interned, a name no one holds matches none */
+	if (ni_string_empty(name) || !(name = ni_string_intern_lookup(name)))
 		return NULL;
 
+	if ((index = ni_ifworker_index_get(array))) {
+		key.type = type;
+		key.name = name;
+		return ni_ifworker_index_find(array, index->name, index->mask,
+				ni_string_hash(name), ni_ifworker_index_match_name, &key);
+	}
+
 	for (i = 0; i < array->count; ++i) {
 		ni_ifworker_t *worker = array->data[i];
 
-		if (worker->type == type && ni_string_eq(worker->name, name))
+		if (worker->type == type && worker->name == name)
 			return worker;
 	}
 	return NULL;
@@ -900,6 +1533,7 @@ ni_ifworker_array_clone(ni_ifworker_array_t *array)
 		return NULL;
 
 	clone = ni_ifworker_array_new();
+	ni_ifworker_array_reserve(clone, array->count);
 	for (i = 0; i < array->count; ++i)
 		ni_ifworker_array_append(clone, array->data[i]);
 
@@ -914,6 +1548,7 @@ ni_ifworker_array_remove_index(ni_ifworker_array_t *array, unsigned int index)
 	if (!array || index >= array->count)
 		return FALSE;
 
+	ni_ifworker_index_free(array);
 	if (array->data[index])
 		ni_ifworker_release(array->data[index]);
 
@@ -992,14 +1627,26 @@ ni_fsm_ifworker_by_object_path(ni_fsm_t *fsm, const char *object_path)
 	return ni_ifworker_array_find_by_objectpath(&fsm->workers, object_path);
 }
 
+static ni_bool_t
+ni_ifworker_index_match_ifindex(const ni_ifworker_t *w, const void *ifindex)
+{
+	return w->ifindex == *(const unsigned int *)ifindex;
+}
+
 ni_ifworker_t *
 ni_fsm_ifworker_by_ifindex(ni_fsm_t *fsm, unsigned int ifindex)
 {
+	ni_ifworker_index_t *index;
 	unsigned int i;
 
 	if (0 == ifindex)
 		return NULL;
 
+	if ((index = ni_ifworker_index_get(&fsm->workers)))
+		return ni_ifworker_index_find(&fsm->workers, index->ifindex, index->mask,
+				ni_ifworker_index_hash_ifindex(ifindex),
+				ni_ifworker_index_match_ifindex, &ifindex);
+
 	for (i = 0; i < fsm->workers.count; ++i) {
 		ni_ifworker_t *w = fsm->workers.data[i];
 
@@ -1142,14 +1789,25 @@ ni_ifworker_match_alias(const ni_ifworker_t *w, const char *alias)
 	return FALSE;
 }
 
+static ni_bool_t
+ni_ifworker_index_match_alias(const ni_ifworker_t *w, const void *alias)
+{
+	return ni_ifworker_match_alias(w, alias);
+}
+
 static ni_ifworker_t *
 ni_ifworker_by_alias(ni_fsm_t *fsm, const char *alias)
 {
+	ni_ifworker_index_t *index;
 	unsigned int i;
 
 	if (!alias)
 		return NULL;
 
+	if ((index = ni_ifworker_index_get(&fsm->workers)))
+		return ni_ifworker_index_find(&fsm->workers, index->alias, index->mask,
+				ni_string_hash(alias), ni_ifworker_index_match_alias, alias);
+
 	for (i = 0; i < fsm->workers.count; ++i) {
 		ni_ifworker_t *w = fsm->workers.data[i];
 
@@ -1167,7 +1825,7 @@ ni_rfkill_type_t
 ni_ifworker_get_rfkill_type(const ni_ifworker_t *w)
 {
 	if (w->object == NULL)
-		return FALSE;
+		return -1;
 
 	switch (w->type) {
 	case NI_IFWORKER_TYPE_MODEM:
@@ -1651,6 +2309,11 @@ ni_ifworker_set_state(ni_ifworker_t *w, unsigned int new_state)
 			w->progress.callback(w, new_state);
 
 		w->fsm.state = new_state;
+		ni_ifworker_generation_bump(w);
+		NI_PROBE3(fsm_state, w->name, prev_state, new_state);
+
+		if (w->timings.current && w->timings.current->next_state == new_state)
+			ni_ifworker_timing_finish(w, FALSE);
 		ni_debug_application("%s: changed state %s -> %s%s",
 				w->name,
 				ni_ifworker_state_name(prev_state),
@@ -1759,6 +2422,10 @@ ni_ifworker_revert_state(ni_ifworker_t *w, ni_event_t event)
 		break;
 
 	case NI_EVENT_LINK_DOWN:
+		/* as long as the carrier settles in parallel */
+		if (w->control.link_parallel && !w->done)
+			return FALSE;
+
 		/* until the link (carrier) is UP again */
 		state = NI_FSM_STATE_LINK_UP;
 		event = NI_EVENT_LINK_UP;
@@ -1865,6 +2532,7 @@ ni_ifworker_control_init(ni_ifworker_control_t *control)
 	control->persistent    = FALSE;
 	control->usercontrol   = FALSE;
 	control->link_required = NI_TRISTATE_DEFAULT;
+	control->link_parallel = FALSE;
 	control->link_priority = 0;
 	control->link_timeout  = NI_IFWORKER_INFINITE_SECONDS;
 }
@@ -1897,6 +2565,7 @@ ni_ifworker_control_clone(const ni_ifworker_control_t *control)
 	_control->persistent    = control->persistent;
 	_control->usercontrol   = control->usercontrol;
 	_control->link_required = control->link_required;
+	_control->link_parallel = control->link_parallel;
 	_control->link_priority = control->link_priority;
 	_control->link_timeout  = control->link_timeout;
 	return _control;
@@ -2022,6 +2691,7 @@ ni_ifworker_control_from_xml(ni_ifworker_t *w, xml_node_t *ctrlnode)
 
 	control->link_priority = 0;
 	control->link_required = NI_TRISTATE_DEFAULT;
+	control->link_parallel = FALSE;
 	control->link_timeout  = NI_IFWORKER_INFINITE_SECONDS;
 	if ((linknode = xml_node_get_child(ctrlnode, "link-detection")) != NULL) {
 		if ((np = xml_node_get_child(linknode, "timeout")) != NULL) {
@@ -2039,6 +2709,10 @@ ni_ifworker_control_from_xml(ni_ifworker_t *w, xml_node_t *ctrlnode)
 			if (ni_string_eq(np->cdata, "false"))
 				 ni_tristate_set(&control->link_required, FALSE);
 		}
+		if ((np = xml_node_get_child(linknode, "parallel")) &&
+		    !ni_parse_boolean(np->cdata, &val)) {
+			control->link_parallel = val;
+		}
 	}
 }
 
@@ -2098,6 +2772,9 @@ ni_ifworker_set_config(ni_ifworker_t *w, xml_node_t *ifnode, const char *config_
 	if (!w)
 		return FALSE;
 
+	ni_ifworker_generation_bump(w);
+	if (ni_ifworker_index_config_alias(w))
+		ni_ifworker_keys_changed();
 	xml_node_free(w->config.node);
 	w->config.node = NULL;
 	ni_client_state_config_reset(&w->config.meta);
@@ -2106,6 +2783,8 @@ ni_ifworker_set_config(ni_ifworker_t *w, xml_node_t *ifnode, const char *config_
 
 	if (!(w->config.node = xml_node_clone_ref(ifnode)))
 		return FALSE;
+	if (ni_ifworker_index_config_alias(w))
+		ni_ifworker_keys_changed();
 
 	if ((child = xml_node_get_child(ifnode, NI_CLIENT_STATE_XML_NODE))) {
 		/* cleanup obsolete stuff in case of attic configs */
@@ -2188,13 +2867,74 @@ ni_fsm_workers_from_xml(ni_fsm_t *fsm, xml_node_t *node, const char *origin)
 		}
 	}
 
-	if (!ni_ifworker_set_config(w, node, origin)) {
-		ni_error("%s: cannot apply configuration to %s '%s'",
-				xml_node_location(node), node->name, w->name);
-		return NULL;
+	if (!ni_ifworker_set_config(w, node, origin)) {
+		ni_error("%s: cannot apply configuration to %s '%s'",
+				xml_node_location(node), node->name, w->name);
+		return NULL;
+	}
+
+	return w;
+}
+
+/*
+ * Build the workers of all <interface> and <modem> configs in a list
+ * in two phases: the index by name is used to find or create workers
+ * of the configs using a plain name and to apply the configs without
+ * to invalidate the worker index for each (alias) config. Then, the
+ * configs identifying their device by alias, ifindex or any other
+ * namespace are resolved in a second pass using the updated index.
+ */
+unsigned int
+ni_fsm_workers_from_xml_list(ni_fsm_t *fsm, xml_node_t *list, const char *origin)
+{
+	xml_node_t **deferred = NULL;
+	unsigned int count = 0, ndeferred = 0, i;
+	xml_node_t *node, *name;
+	ni_ifworker_type_t type;
+	ni_ifworker_t *w;
+
+	if (!fsm || !list)
+		return 0;
+
+	ni_ifworker_keys_defer();
+	for (node = list->children; node; node = node->next) {
+		if (xml_node_is_empty(node))
+			continue;
+
+		type = ni_ifworker_type_from_string(node->name);
+		name = xml_node_get_child(node, "name");
+		if (type == NI_IFWORKER_TYPE_NONE || !name ||
+		    xml_node_get_attr(name, "namespace") || ni_string_empty(name->cdata)) {
+			if (!ni_array_grow((void **)&deferred, sizeof(deferred[0]),
+					ndeferred, ndeferred + 1, NI_IFWORKER_ARRAY_CHUNK))
+				ni_fatal("allocation failed for %u config node entries", ndeferred + 1);
+			deferred[ndeferred++] = node;
+			continue;
+		}
+
+		if (!(w = ni_fsm_ifworker_by_name(fsm, type, name->cdata)) &&
+		    !(w = ni_ifworker_new(&fsm->workers, type, name->cdata))) {
+			ni_error("%s: cannot allocate worker for '%s' configuration",
+				xml_node_location(node), node->name);
+			continue;
+		}
+
+		if (!ni_ifworker_set_config(w, node, origin)) {
+			ni_error("%s: cannot apply configuration to %s '%s'",
+					xml_node_location(node), node->name, w->name);
+			continue;
+		}
+		count++;
+	}
+	ni_ifworker_keys_commit();
+
+	for (i = 0; i < ndeferred; ++i) {
+		if (ni_fsm_workers_from_xml(fsm, deferred[i], origin))
+			count++;
 	}
+	free(deferred);
 
-	return w;
+	return count;
 }
 
 /*
@@ -2300,6 +3040,28 @@ ni_ifworker_link_detection_timeout(const ni_timer_t *timer, ni_fsm_timer_ctx_t *
 	}
 }
 
+/*
+ * Complete the link-detection as soon as a refreshed device reports
+ * the link (IFF_LOWER_UP) as up, regardless of the event it was
+ * refreshed on, without to wait for the link-detection timeout.
+ */
+static ni_bool_t
+ni_ifworker_link_detection_complete(ni_ifworker_t *w)
+{
+	ni_fsm_transition_t *action;
+
+	if (!(action = w->fsm.wait_for) || action->next_state != NI_FSM_STATE_LINK_UP)
+		return FALSE;
+	if (w->fsm.state != NI_FSM_STATE_DEVICE_UP || !ni_netdev_link_is_up(w->device))
+		return FALSE;
+
+	ni_debug_application("%s: link is up, completing link-detection", w->name);
+	ni_ifworker_cancel_secondary_timeout(w);
+	ni_ifworker_cancel_callbacks(w, &action->callbacks);
+	ni_ifworker_set_state(w, action->next_state);
+	return TRUE;
+}
+
 /*
  * Handle dependencies that check for a specific child state.
  */
@@ -2624,6 +3386,8 @@ ni_ifworker_check_state_req_test(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_require
 				w->name, required ? "required " : "", cw->name,
 				csr->method,
 				ni_ifworker_state_name(wait_for_state));
+		ni_ifworker_timing_blocked(fsm, w, cw);
+		ni_fsm_schedule_blocked_by(fsm, cw);
 
 		if (required)
 			all_required_ok = FALSE;
@@ -3275,6 +4039,105 @@ ni_fsm_start_matching_workers(ni_fsm_t *fsm, ni_ifworker_array_t *marked)
 	return count;
 }
 
+/*
+ * Bulk teardown of marked virtual devices: delete those of them, which
+ * are going to be deleted anyway, with one deleteDevices call instead
+ * to drive each through the down transitions removing their addresses,
+ * routes and links one call per step. This applies to not enslaved
+ * vlan, macvlan, dummy and tun/tap devices without any leases, which
+ * are not a lower device of other devices than the deleted ones.
+ * The remaining marked workers are left to the fsm.
+ */
+static ni_bool_t
+ni_fsm_delete_devices_candidate(const ni_ifworker_t *w)
+{
+	const ni_netdev_t *dev = w->device;
+
+	if (w->failed || w->done || w->pending || w->masterdev ||
+	    w->target_state != NI_FSM_STATE_DEVICE_DOWN ||
+	    !dev || !dev->link.ifindex || dev->leases)
+		return FALSE;
+
+	switch (dev->link.type) {
+	case NI_IFTYPE_DUMMY:
+	case NI_IFTYPE_VLAN:
+	case NI_IFTYPE_MACVLAN:
+	case NI_IFTYPE_MACVTAP:
+	case NI_IFTYPE_TUN:
+	case NI_IFTYPE_TAP:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+unsigned int
+ni_fsm_delete_devices(ni_fsm_t *fsm, ni_ifworker_array_t *marked)
+{
+	ni_uint_array_t ifindexes = NI_UINT_ARRAY_INIT;
+	ni_uint_array_t deleted = NI_UINT_ARRAY_INIT;
+	ni_ifworker_array_t bulk = NI_IFWORKER_ARRAY_INIT;
+	unsigned int i, j, count = 0;
+	ni_bool_t changed;
+
+	if (!fsm || !marked)
+		return 0;
+
+	for (i = 0; i < marked->count; ++i) {
+		ni_ifworker_t *w = marked->data[i];
+
+		if (ni_fsm_delete_devices_candidate(w))
+			ni_ifworker_array_append(&bulk, w);
+	}
+
+	/* drop lower devices of workers we don't delete */
+	do {
+		changed = FALSE;
+		for (i = 0; i < bulk.count; ++i) {
+			ni_ifworker_t *w = bulk.data[i];
+
+			for (j = 0; j < w->lowerdev_for.count; ++j) {
+				if (ni_ifworker_array_index(&bulk, w->lowerdev_for.data[j]) < 0)
+					break;
+			}
+			if (j < w->lowerdev_for.count) {
+				ni_ifworker_array_remove_index(&bulk, i--);
+				changed = TRUE;
+			}
+		}
+	} while (changed);
+
+	for (i = 0; i < bulk.count; ++i)
+		ni_uint_array_append(&ifindexes, bulk.data[i]->device->link.ifindex);
+
+	if (ifindexes.count) {
+		ni_debug_application("deleting %u devices in bulk", ifindexes.count);
+		ni_call_delete_devices(ni_call_get_netif_list_object(), &ifindexes, &deleted);
+	}
+
+	/* the deleted ifindexes are in the order we've requested them */
+	for (i = j = 0; i < bulk.count && j < deleted.count; ++i) {
+		ni_ifworker_t *w = bulk.data[i];
+
+		if (w->device->link.ifindex != deleted.data[j])
+			continue;
+		j++;
+
+		ni_ifworker_cancel_secondary_timeout(w);
+		ni_ifworker_cancel_timeout(w);
+		ni_ifworker_set_state(w, NI_FSM_STATE_DEVICE_DOWN);
+		w->kickstarted = TRUE;
+		ni_ifworker_success(w);
+		count++;
+	}
+
+	ni_ifworker_array_destroy(&bulk);
+	ni_uint_array_destroy(&ifindexes);
+	ni_uint_array_destroy(&deleted);
+	ni_debug_application("deleted %u devices in bulk", count);
+	return count;
+}
+
 void
 ni_fsm_reset_matching_workers(ni_fsm_t *fsm, ni_ifworker_array_t *marked,
 			const ni_uint_range_t *target_range, ni_bool_t hard)
@@ -3358,6 +4221,7 @@ ni_ifworker_device_delete(ni_ifworker_t *w)
 	ni_ifworker_get(w);
 	ni_debug_application("%s(%s)", __func__, w->name);
 
+	ni_ifworker_keys_changed();
 	w->ifindex = 0;
 	if (w->device) {
 		ni_netdev_put(w->device);
@@ -3367,8 +4231,7 @@ ni_ifworker_device_delete(ni_ifworker_t *w)
 		ni_dbus_object_free(w->object);
 		w->object = NULL;
 	}
-	ni_string_free(&w->object_path);
-	w->object_path = NULL;
+	ni_string_intern_free(&w->object_path);
 
 	ni_ifworker_cancel_secondary_timeout(w);
 	ni_ifworker_cancel_timeout(w);
@@ -3468,6 +4331,8 @@ ni_ifworker_start(ni_fsm_t *fsm, ni_ifworker_t *w, unsigned long timeout)
 				ni_ifworker_state_name(w->fsm.state),
 				ni_ifworker_state_name(w->target_state));
 
+	/* the timings are kept for the last run only */
+	ni_ifworker_timings_destroy(w);
 	if (w->target_state != NI_FSM_STATE_NONE)
 		ni_ifworker_set_timeout(fsm, w, timeout);
 
@@ -3614,6 +4479,7 @@ ni_ifworker_bind_device_apis(ni_ifworker_t *w, const ni_dbus_service_t *service)
 struct ni_ifworker_xml_validation_user_data {
 	ni_fsm_t *	fsm;
 	ni_ifworker_t *	worker;
+	ni_fsm_transition_t *action;
 };
 static dbus_bool_t	ni_ifworker_netif_resolve_cb(xml_node_t *, const ni_xs_type_t *, const xml_node_t *, void *);
 static int		ni_ifworker_prompt_cb(xml_node_t *, const ni_xs_type_t *, const xml_node_t *, void *);
@@ -3958,7 +4824,9 @@ ni_fsm_refresh_state(ni_fsm_t *fsm)
 	ni_ifworker_t *w;
 	unsigned int i;
 
+	ni_profile_enter("dbus-refresh");
 	ni_fsm_events_block(fsm);
+	ni_ifworker_keys_changed();
 	for (i = 0; i < fsm->workers.count; ++i) {
 		w = fsm->workers.data[i];
 
@@ -3969,16 +4837,21 @@ ni_fsm_refresh_state(ni_fsm_t *fsm)
 			ni_netdev_put(w->device);
 			w->device = NULL;
 		}
+		ni_ifworker_generation_bump(w);
 
 		/* Set ifworkers to readonly if fsm is readonly */
 		w->readonly = fsm->readonly;
 	}
 
-	if (!ni_fsm_refresh_netdevs_state(fsm))
+	if (!ni_fsm_refresh_netdevs_state(fsm)) {
+		ni_profile_leave();
 		return FALSE;
+	}
 #ifdef MODEM
-	if (!ni_fsm_refresh_modems_state(fsm))
+	if (!ni_fsm_refresh_modems_state(fsm)) {
+		ni_profile_leave();
 		return FALSE;
+	}
 #endif
 
 	for (i = 0; i < fsm->workers.count; ++i) {
@@ -3989,6 +4862,7 @@ ni_fsm_refresh_state(ni_fsm_t *fsm)
 			ni_ifworker_update_state(w, NI_FSM_STATE_DEVICE_EXISTS, __NI_FSM_STATE_MAX);
 	}
 	ni_fsm_events_unblock(fsm);
+	ni_profile_leave();
 
 	return TRUE;
 }
@@ -4004,14 +4878,26 @@ ni_fsm_refresh_netdevs_state(ni_fsm_t *fsm)
 		return FALSE;
 	}
 
-	/* Call ObjectManager.GetManagedObjects to get list of objects and their properties */
-	if (!ni_dbus_object_refresh_children(list_object)) {
+	/*
+	 * Wipe out the properties of the known devices, so the list refresh
+	 * does not merge them into stale ones, and use its result as is,
+	 * instead of to fetch each device object once again.
+	 */
+	for (object = list_object->children; object; object = object->next) {
+		ni_netdev_t *dev = ni_objectmodel_unwrap_netif(object, NULL);
+
+		if (dev)
+			ni_netdev_reset(dev);
+	}
+
+	/* Get the list of objects and their properties in pages */
+	if (!ni_call_refresh_netif_list(list_object)) {
 		ni_error("Couldn't refresh list of active network interfaces");
 		return FALSE;
 	}
 
 	for (object = list_object->children; object; object = object->next)
-		ni_fsm_recv_new_netif(fsm, object, TRUE);
+		ni_fsm_recv_new_netif(fsm, object, FALSE);
 	return TRUE;
 }
 
@@ -4093,17 +4979,22 @@ ni_fsm_recv_new_netif(ni_fsm_t *fsm, ni_dbus_object_t *object, ni_bool_t refresh
 	if (!found)
 		return NULL;
 
+	if (!found->object_path || renamed || found->ifindex != dev->link.ifindex ||
+	    !ni_string_eq(ni_ifworker_index_device_alias(found->device), dev->link.alias))
+		ni_ifworker_keys_changed();
+
 	if (!found->object_path)
-		ni_string_dup(&found->object_path, object->path);
+		ni_string_intern_set(&found->object_path, object->path);
 
 	dev = ni_netdev_get(dev);
 	if (found->device)
 		ni_netdev_put(found->device);
 	found->device = dev;
+	ni_ifworker_generation_bump(found);
 
 	if (renamed) {
 		ni_string_dup(&found->old_name, found->name);
-		ni_string_dup(&found->name, dev->name);
+		ni_string_intern_set(&found->name, dev->name);
 	} else {
 		ni_string_free(&found->old_name);
 	}
@@ -4119,6 +5010,7 @@ ni_fsm_recv_new_netif_path(ni_fsm_t *fsm, const char *path)
 {
 	static ni_dbus_object_t *list_object = NULL;
 	ni_dbus_object_t *object;
+	ni_ifworker_t *found;
 
 	if (!list_object && !(list_object = ni_call_get_netif_list_object())) {
 		ni_error("unable to get server's netdev list");
@@ -4126,7 +5018,14 @@ ni_fsm_recv_new_netif_path(ni_fsm_t *fsm, const char *path)
 	}
 
 	object = ni_dbus_object_create(list_object, path, NULL, NULL);
-	return ni_fsm_recv_new_netif(fsm, object, TRUE);
+	if (object->updated)
+		return ni_fsm_recv_new_netif(fsm, object, FALSE);
+
+	/* a full refresh syncs the proxy, further deltas keep it current */
+	if (!(found = ni_fsm_recv_new_netif(fsm, object, TRUE)))
+		return NULL;
+	object->updated = TRUE;
+	return found;
 }
 
 #ifdef MODEM
@@ -4187,8 +5086,10 @@ ni_fsm_recv_new_modem(ni_fsm_t *fsm, ni_dbus_object_t *object, ni_bool_t refresh
 	if (!found)
 		return NULL;
 
-	if (!found->object_path)
-		ni_string_dup(&found->object_path, object->path);
+	if (!found->object_path) {
+		ni_string_intern_set(&found->object_path, object->path);
+		ni_ifworker_keys_changed();
+	}
 	if (!found->modem)
 		found->modem = ni_modem_hold(modem);
 	found->object = object;
@@ -4342,6 +5243,19 @@ ni_ifworker_xml_metadata_callback(xml_node_t *node, const ni_xs_type_t *type, co
 	return TRUE;
 }
 
+/*
+ * Record the method requirements and resolve the device references in
+ * one validation pass over the method argument document.
+ */
+static dbus_bool_t
+ni_ifworker_bind_metadata_callback(xml_node_t *node, const ni_xs_type_t *type, const xml_node_t *metadata, void *user_data)
+{
+	struct ni_ifworker_xml_validation_user_data *closure = user_data;
+
+	return ni_ifworker_xml_metadata_callback(node, type, metadata, closure->action) &&
+		ni_ifworker_netif_resolve_cb(node, type, metadata, closure);
+}
+
 /*
  * User input callback. A mandatory element is missing from the document, but the schema
  * provides prompting information for it.
@@ -4770,21 +5684,12 @@ ni_ifworker_do_common_bind(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t
 			struct ni_ifworker_xml_validation_user_data user_data = {
 				.fsm = fsm,
 				.worker = w,
+				.action = action,
 			};
 			ni_dbus_xml_validate_context_t context;
 
-			context.metadata_callback = ni_ifworker_xml_metadata_callback;
+			context.metadata_callback = ni_ifworker_bind_metadata_callback;
 			context.prompt_callback = ni_ifworker_prompt_cb;
-			context.user_data = action;
-
-			if (!ni_dbus_xml_validate_argument(bind->method, 0, bind->config, &context)) {
-				xml_node_free(bind->config);
-				bind->config = NULL;
-				goto document_error;
-			}
-
-			context.metadata_callback = ni_ifworker_netif_resolve_cb;
-			context.prompt_callback = ni_ifworker_prompt_later_cb;
 			context.user_data = &user_data;
 
 			if (!ni_dbus_xml_validate_argument(bind->method, 0, bind->config, &context)) {
@@ -4885,29 +5790,375 @@ cleanup:
 	ni_string_array_destroy(&array);
 }
 
-static void
-ni_ifworker_update_from_request(ni_ifworker_t *w, const char *service, const char *method,
-				int result, ni_objectmodel_callback_info_t *callback_list)
-{
-	if (ni_string_startswith(service, NI_OBJECTMODEL_ADDRCONF_INTERFACE)) {
-		ni_ifworker_update_from_addrconf_requests(w, service, method, result, callback_list);
+static void
+ni_ifworker_update_from_request(ni_ifworker_t *w, const char *service, const char *method,
+				int result, ni_objectmodel_callback_info_t *callback_list)
+{
+	if (ni_string_startswith(service, NI_OBJECTMODEL_ADDRCONF_INTERFACE)) {
+		ni_ifworker_update_from_addrconf_requests(w, service, method, result, callback_list);
+	}
+}
+
+/*
+ * Asynchronous common calls, enabled by the <fsm><parallel-calls> option.
+ *
+ * The worker waits for the action while the call is in progress, so the
+ * scheduler continues with the other workers, whose dependencies permit
+ * it, until the limit of calls in progress is reached. The reply arrives
+ * via the dbus connection dispatching and is evaluated by the scheduler.
+ *
+ * The calls of all bindings of an action (e.g. the changeProtocol of each
+ * address family or the requestLease of each addrconf method) are sent at
+ * once and not one after the other reply; the server executes them in
+ * the call order and the replies are evaluated in the binding order.
+ */
+typedef struct ni_fsm_async_call	ni_fsm_async_call_t;
+
+struct ni_fsm_async_call {
+	ni_fsm_async_call_t *	next;
+
+	ni_fsm_t *		fsm;
+	ni_dbus_object_t *	proxy;
+	ni_ifworker_t *		worker;
+	ni_fsm_transition_t *	action;
+	unsigned int		binding;
+	unsigned int		callbacks;
+	uint32_t		serial;
+
+	ni_bool_t		replied;
+	ni_dbus_message_t *	reply;
+
+	struct timeval		sent;
+	struct timeval		received;
+};
+
+static ni_fsm_async_call_t *	ni_fsm_async_calls;
+
+static int			ni_ifworker_do_common_calls(ni_fsm_t *, ni_ifworker_t *,
+					ni_fsm_transition_t *, unsigned int, unsigned int);
+static int			ni_ifworker_do_common_call(ni_fsm_t *, ni_ifworker_t *,
+					ni_fsm_transition_t *);
+static void			ni_ifworker_do_common_calls_done(ni_ifworker_t *,
+					ni_fsm_transition_t *, unsigned int);
+
+static inline ni_bool_t
+ni_fsm_async_call_enabled(const ni_fsm_t *fsm, const ni_fsm_transition_t *action)
+{
+	return fsm->calls.limit && action->call_func == ni_ifworker_do_common_call;
+}
+
+static ni_fsm_async_call_t *
+ni_fsm_async_call_new(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t *action,
+			unsigned int binding, unsigned int callbacks)
+{
+	ni_fsm_async_call_t *call, **tail;
+
+	call = xcalloc(1, sizeof(*call));
+	call->fsm = fsm;
+	call->proxy = w->object;
+	call->worker = ni_ifworker_get(w);
+	call->action = action;
+	call->binding = binding;
+	call->callbacks = callbacks;
+
+	/* replies arrive in call order -- append */
+	for (tail = &ni_fsm_async_calls; *tail; tail = &(*tail)->next)
+		;
+	*tail = call;
+
+	fsm->calls.count++;
+	return call;
+}
+
+static void
+ni_fsm_async_call_free(ni_fsm_async_call_t *call)
+{
+	if (call->reply)
+		dbus_message_unref(call->reply);
+	if (call->worker)
+		ni_ifworker_release(call->worker);
+	free(call);
+}
+
+/*
+ * The number of calls the fsm may keep in progress. With a target reply
+ * latency, the window adapts to the load of wickedd: the time a call
+ * waits in its queue adds to the reply latency, so a slow reply or no
+ * reply at all halves the window (once per window of calls sent since
+ * the last reduction) and fast replies grow it by one call per window
+ * up to the configured limit.
+ */
+static inline unsigned int
+ni_fsm_async_call_window(const ni_fsm_t *fsm)
+{
+	return fsm->calls.latency ? fsm->calls.window : fsm->calls.limit;
+}
+
+static void
+ni_fsm_async_call_feedback(ni_fsm_t *fsm, const ni_fsm_async_call_t *call, ni_bool_t replied)
+{
+	ni_timeout_t latency;
+
+	if (!fsm || !fsm->calls.latency)
+		return;
+
+	latency = ni_timeout_since(&call->sent, &call->received, NULL);
+	if (replied && latency <= fsm->calls.latency) {
+		if (fsm->calls.window >= fsm->calls.limit)
+			return;
+		if (++fsm->calls.replies < fsm->calls.window)
+			return;
+
+		fsm->calls.replies = 0;
+		fsm->calls.window++;
+		ni_debug_application("fsm: call window increased to %u calls",
+				fsm->calls.window);
+		return;
+	}
+
+	/* sent before the last reduction -- congestion of an older window */
+	if (timercmp(&call->sent, &fsm->calls.reduced, <))
+		return;
+
+	fsm->calls.reduced = call->received;
+	fsm->calls.replies = 0;
+	if (fsm->calls.window > 1)
+		fsm->calls.window /= 2;
+	ni_debug_application("fsm: call window reduced to %u calls (reply latency %u msec)",
+			fsm->calls.window, (unsigned int)latency);
+}
+
+static void
+ni_fsm_async_call_reply(ni_dbus_object_t *proxy, ni_dbus_message_t *reply)
+{
+	uint32_t serial = reply ? dbus_message_get_reply_serial(reply) : 0;
+	ni_fsm_async_call_t *call, **pos;
+
+	for (pos = &ni_fsm_async_calls; (call = *pos); pos = &call->next) {
+		if (call->proxy != proxy || call->replied)
+			continue;
+		if (serial && call->serial && call->serial != serial)
+			continue;
+
+		if (!call->worker) {
+			/* cancelled meanwhile */
+			*pos = call->next;
+			ni_fsm_async_call_free(call);
+			return;
+		}
+
+		call->replied = TRUE;
+		ni_timer_get_time(&call->received);
+		if (reply)
+			call->reply = dbus_message_ref(reply);
+		ni_fsm_async_call_feedback(call->fsm, call, reply &&
+				!dbus_message_is_error(reply, DBUS_ERROR_NO_REPLY) &&
+				!dbus_message_is_error(reply, DBUS_ERROR_TIMEOUT));
+		return;
+	}
+}
+
+static void
+ni_fsm_async_calls_cancel(ni_fsm_t *fsm, ni_ifworker_t *w)
+{
+	ni_fsm_async_call_t *call, **pos;
+	ni_ifworker_t *worker;
+
+	pos = &ni_fsm_async_calls;
+	while ((call = *pos)) {
+		if (!call->worker || (fsm && call->fsm != fsm) || (w && call->worker != w)) {
+			pos = &call->next;
+			continue;
+		}
+
+		ni_debug_application("%s: cancel call in progress", call->worker->name);
+		worker = call->worker;
+		call->fsm->calls.count--;
+		call->fsm = NULL;
+		call->worker = NULL;
+		call->action = NULL;
+
+		/* keep it to consume the reply, unless it arrived already */
+		if (call->replied) {
+			*pos = call->next;
+			ni_fsm_async_call_free(call);
+		} else {
+			pos = &call->next;
+		}
+		ni_ifworker_release(worker);
+	}
+}
+
+/*
+ * The next call of the same action batch, the call is pending for.
+ */
+static ni_fsm_async_call_t *
+ni_fsm_async_call_next(const ni_fsm_async_call_t *call)
+{
+	ni_fsm_async_call_t *next;
+
+	for (next = call->next; next; next = next->next) {
+		if (next->worker == call->worker && next->action == call->action)
+			return next;
+	}
+	return NULL;
+}
+
+/*
+ * Whether an earlier call of the same action batch is still unreplied.
+ */
+static ni_bool_t
+ni_fsm_async_call_blocked(const ni_fsm_async_call_t *call)
+{
+	const ni_fsm_async_call_t *prev;
+
+	for (prev = ni_fsm_async_calls; prev && prev != call; prev = prev->next) {
+		if (prev->worker == call->worker && prev->action == call->action)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * The object_path has to be interned, e.g. of an fsm event.
+ */
+static ni_bool_t
+ni_fsm_async_call_pending(const ni_fsm_t *fsm, const char *object_path)
+{
+	const ni_fsm_async_call_t *call;
+
+	for (call = ni_fsm_async_calls; call; call = call->next) {
+		if (call->fsm == fsm && call->worker &&
+		    call->worker->object_path == object_path)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static int
+ni_ifworker_common_call_result(ni_ifworker_t *w, ni_fsm_transition_t *action,
+				ni_fsm_transition_bind_t *bind, int rv,
+				ni_objectmodel_callback_info_t *callback_list,
+				unsigned int *count)
+{
+	char *service = NULL;
+	char *method = NULL;
+
+	ni_string_dup(&service, bind->service->name);
+	ni_string_dup(&method, bind->method->name);
+
+	ni_ifworker_update_from_request(w, service, method, rv, callback_list);
+	if (rv < 0) {
+		if (action->common.may_fail) {
+			ni_error("[ignored] %s: call to %s.%s() failed: %s", w->name,
+					service, method, ni_strerror(rv));
+			ni_ifworker_set_state(w, action->next_state);
+			rv = 1;
+		} else {
+			ni_ifworker_fail(w, "call to %s.%s() failed: %s", service, method, ni_strerror(rv));
+		}
+	} else {
+		if (callback_list) {
+			ni_debug_application("%s: adding callback for %s.%s()", w->name, service, method);
+			ni_ifworker_add_callbacks(action, callback_list, w->name);
+			(*count)++;
+		}
+		rv = 0;
+	}
+
+	ni_string_free(&service);
+	ni_string_free(&method);
+	return rv;
+}
+
+static void
+ni_fsm_async_call_process(ni_fsm_t *fsm, ni_fsm_async_call_t *call)
+{
+	ni_objectmodel_callback_info_t *callback_list = NULL;
+	ni_ifworker_t *w = call->worker;
+	ni_fsm_transition_t *action = call->action;
+	ni_fsm_transition_bind_t *bind = &action->binding[call->binding];
+	unsigned int prev_state = w->fsm.state;
+	ni_fsm_async_call_t *next;
+	int rv;
+
+	if (w->failed || w->done || w->fsm.wait_for != action) {
+		ni_debug_application("%s: discarding reply to %s.%s()", w->name,
+				bind->service->name, bind->method->name);
+		return;
+	}
+
+	rv = ni_call_common_xml_result(w->object, bind->service, bind->method, bind->config,
+			call->reply, &callback_list, ni_ifworker_error_handler);
+	ni_ifworker_timing_call(w, &call->sent, &call->received);
+	rv = ni_ifworker_common_call_result(w, action, bind, rv, callback_list, &call->callbacks);
+	if (rv == 0) {
+		/* the result of the last call in the batch completes the action */
+		if ((next = ni_fsm_async_call_next(call)))
+			next->callbacks = call->callbacks;
+		else
+			ni_ifworker_do_common_calls_done(w, action, call->callbacks);
+	}
+
+	if (rv >= 0) {
+		if (w->fsm.wait_for) {
+			ni_debug_application("%s: waiting for event in state %s",
+				w->name, ni_ifworker_state_name(w->fsm.state));
+		} else {
+			ni_debug_application("%s: successfully transitioned from %s to %s",
+				w->name, ni_ifworker_state_name(prev_state),
+				ni_ifworker_state_name(w->fsm.state));
+		}
+	} else
+	if (!w->failed) {
+		ni_ifworker_fail(w, "failed to transition from %s to %s",
+				ni_ifworker_state_name(prev_state),
+				ni_ifworker_state_name(action->next_state));
+	}
+}
+
+static ni_bool_t
+ni_fsm_async_calls_process(ni_fsm_t *fsm)
+{
+	ni_fsm_async_call_t *call, **pos;
+	ni_bool_t progress = FALSE;
+
+	pos = &ni_fsm_async_calls;
+	while ((call = *pos)) {
+		if (call->fsm != fsm || !call->replied || ni_fsm_async_call_blocked(call)) {
+			pos = &call->next;
+			continue;
+		}
+		*pos = call->next;
+		fsm->calls.count--;
+
+		ni_fsm_events_block(fsm);
+		ni_fsm_async_call_process(fsm, call);
+		ni_fsm_process_events(fsm);
+		ni_fsm_events_unblock(fsm);
+
+		ni_fsm_async_call_free(call);
+		progress = TRUE;
+		pos = &ni_fsm_async_calls;
 	}
+	return progress;
 }
 
 static int
-ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t *action)
+ni_ifworker_do_common_calls(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t *action,
+				unsigned int index, unsigned int count)
 {
-	unsigned int i, count = 0;
+	ni_bool_t async = ni_fsm_async_call_enabled(fsm, action);
+	ni_bool_t sent = FALSE;
+	unsigned int i;
+	uint32_t serial;
 	int rv;
 
-	/* Initially, enable waiting for this action */
-	w->fsm.wait_for = action;
-
-	for (i = 0; i < action->num_bindings; ++i) {
+	for (i = index; i < action->num_bindings; ++i) {
 		ni_fsm_transition_bind_t *bind = &action->binding[i];
 		ni_objectmodel_callback_info_t *callback_list = NULL;
-		char *service = NULL;
-		char *method = NULL;
+		ni_fsm_async_call_t *call;
+		struct timeval begin;
 
 		if (!bind->method || !bind->service)
 			continue;
@@ -4915,39 +6166,46 @@ ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t
 		if (bind->skip_call)
 			continue;
 
-		ni_string_dup(&service, bind->service->name);
-		ni_string_dup(&method, bind->method->name);
+		ni_debug_application("%s: calling %s.%s()%s", w->name,
+				bind->service->name, bind->method->name,
+				async ? " asynchronously" : "");
 
-		ni_debug_application("%s: calling %s.%s()", w->name, service, method);
-
-		rv = ni_call_common_xml(w->object, bind->service, bind->method, bind->config,
-				&callback_list, ni_ifworker_error_handler);
-		ni_ifworker_update_from_request(w, service, method, rv, callback_list);
-		if (rv < 0) {
-			if (action->common.may_fail) {
-				ni_error("[ignored] %s: call to %s.%s() failed: %s", w->name,
-						service, method, ni_strerror(rv));
-				ni_ifworker_set_state(w, action->next_state);
-				ni_string_free(&service);
-				ni_string_free(&method);
-				return 0;
+		ni_timer_get_time(&begin);
+		if (async) {
+			serial = 0;
+			rv = ni_call_common_xml_async(w->object, bind->service, bind->method,
+					bind->config, ni_fsm_async_call_reply, &serial);
+			if (rv >= 0) {
+				call = ni_fsm_async_call_new(fsm, w, action, i, count);
+				call->serial = serial;
+				call->sent = begin;
+				sent = TRUE;
+				continue;
 			}
-			ni_ifworker_fail(w, "call to %s.%s() failed: %s", service, method, ni_strerror(rv));
-			ni_string_free(&service);
-			ni_string_free(&method);
-			return rv;
-		}
-
-		if (callback_list) {
-			ni_debug_application("%s: adding callback for %s.%s()", w->name, service, method);
-			ni_ifworker_add_callbacks(action, callback_list, w->name);
-			count++;
+			/* the calls sent already are discarded on failure */
+		} else {
+			rv = ni_call_common_xml(w->object, bind->service, bind->method, bind->config,
+					&callback_list, ni_ifworker_error_handler);
 		}
+		ni_ifworker_timing_call(w, &begin, NULL);
 
-		ni_string_free(&service);
-		ni_string_free(&method);
+		rv = ni_ifworker_common_call_result(w, action, bind, rv, callback_list, &count);
+		if (rv)
+			return rv < 0 ? rv : 0;
 	}
 
+	/* the replies complete the action */
+	if (sent)
+		return 0;
+
+	ni_ifworker_do_common_calls_done(w, action, count);
+	return 0;
+}
+
+static void
+ni_ifworker_do_common_calls_done(ni_ifworker_t *w, ni_fsm_transition_t *action,
+				unsigned int count)
+{
 	/* Reset wait_for if there are no callbacks ... */
 	if (count == 0) {
 		/* ... unless this action requires ACK via event */
@@ -4956,8 +6214,15 @@ ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t
 			w->fsm.wait_for = NULL;
 		}
 	}
+}
 
-	return 0;
+static int
+ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t *action)
+{
+	/* Initially, enable waiting for this action */
+	w->fsm.wait_for = action;
+
+	return ni_ifworker_do_common_calls(fsm, w, action, 0, 0);
 }
 
 static int
@@ -4983,6 +6248,12 @@ ni_ifworker_link_detection_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transiti
 		w->control.link_required = ni_netdev_guess_link_required(w->device);
 
 	if (ret >= 0 && w->fsm.wait_for) {
+		if (w->control.link_parallel) {
+			ni_debug_application("%s: not waiting for link-up, proceeding in parallel", w->name);
+			ni_ifworker_cancel_callbacks(w, &action->callbacks);
+			ni_ifworker_set_state(w, action->next_state);
+			w->fsm.wait_for = NULL;
+		} else
 		if (w->control.link_timeout != NI_IFWORKER_INFINITE_SECONDS) {
 			ni_ifworker_set_secondary_timeout(fsm, w,
 					NI_TIMEOUT_FROM_SEC(w->control.link_timeout),
@@ -5072,15 +6343,16 @@ ni_ifworker_call_device_factory(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transiti
 			return -1;
 		}
 		ni_debug_application("created device %s (path=%s)", w->name, object_path);
-		ni_string_free(&w->object_path);
-		w->object_path = object_path;
+		ni_string_intern_set(&w->object_path, object_path);
+		ni_string_free(&object_path);
+		ni_ifworker_keys_changed();
 
 		/* Lookup the object corresponding to this path. If it doesn't
 		 * exist, create it on the fly (with a generic class of "netif" -
 		 * the following refresh call with take care of this and correct
 		 * the class.
 		 */
-		w->object = ni_dbus_object_create(fsm->client_root_object, object_path,
+		w->object = ni_dbus_object_create(fsm->client_root_object, w->object_path,
 					NULL,
 					NULL);
 
@@ -5092,6 +6364,8 @@ ni_ifworker_call_device_factory(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transiti
 		dev = ni_netdev_get(ni_objectmodel_unwrap_netif(w->object, NULL));
 		ni_netdev_put(w->device);
 		w->device = dev;
+		ni_ifworker_generation_bump(w);
+		ni_ifworker_keys_changed();
 
 		ni_fsm_schedule_bind_methods(fsm, w);
 	}
@@ -5329,108 +6603,331 @@ ni_fsm_schedule_bind_methods(ni_fsm_t *fsm, ni_ifworker_t *w)
 	return 0;
 }
 
-unsigned int
-ni_fsm_schedule(ni_fsm_t *fsm)
+/*
+ * Workers deferred by ni_fsm_schedule are parked with the reason they
+ * were deferred, instead to visit (and to check the dependencies of)
+ * every worker again in each scheduling pass:
+ *  - waiting for a call or event in progress,
+ *  - waiting for the workers blocking the dependency check; each
+ *    blocker tracks the workers depending on it (reverse dependency),
+ *    so a change of a blocker wakes up exactly its dependents,
+ *  - waiting for an unknown worker reference to resolve,
+ *  - waiting for a free async call slot.
+ */
+typedef struct ni_fsm_schedule {
+	ni_ifworker_array_t		ready;
+	ni_ifworker_array_t		next;
+
+	ni_ifworker_array_t		waiting;
+	ni_ifworker_array_t		blockers;
+	ni_ifworker_array_t		resolving;
+	ni_ifworker_array_t		limited;
+} ni_fsm_schedule_t;
+
+#define NI_FSM_SCHEDULE_INIT		{ .ready = NI_IFWORKER_ARRAY_INIT,	\
+					  .next = NI_IFWORKER_ARRAY_INIT,	\
+					  .waiting = NI_IFWORKER_ARRAY_INIT,	\
+					  .blockers = NI_IFWORKER_ARRAY_INIT,	\
+					  .resolving = NI_IFWORKER_ARRAY_INIT,	\
+					  .limited = NI_IFWORKER_ARRAY_INIT }
+
+static void
+ni_fsm_schedule_queue(ni_fsm_schedule_t *sched, ni_ifworker_t *w)
 {
-	unsigned int i, waiting, nrequested;
+	if (w->queued)
+		return;
 
-	while (1) {
-		int made_progress = 0;
+	w->queued = TRUE;
+	ni_ifworker_array_append(&sched->next, w);
+}
 
-		for (i = 0; i < fsm->workers.count; ++i) {
-			ni_ifworker_t *w = fsm->workers.data[i];
-			ni_fsm_transition_t *action;
-			unsigned int prev_state;
-			int rv;
+static void
+ni_fsm_schedule_depends_on(ni_fsm_schedule_t *sched, ni_ifworker_t *w, ni_ifworker_t *cw)
+{
+	if (!cw->dependents.workers.count) {
+		cw->dependents.generation = cw->generation;
+		cw->dependents.state = cw->fsm.state;
+		cw->dependents.failed = cw->failed;
+		ni_ifworker_array_append(&sched->blockers, cw);
+	}
+	if (ni_ifworker_array_index(&cw->dependents.workers, w) < 0)
+		ni_ifworker_array_append(&cw->dependents.workers, w);
+}
 
-			ni_ifworker_get(w);
+static inline ni_bool_t
+ni_fsm_schedule_blocker_changed(const ni_ifworker_t *cw)
+{
+	return cw->generation != cw->dependents.generation ||
+		cw->fsm.state != cw->dependents.state ||
+		cw->failed != cw->dependents.failed;
+}
 
-			if (w->pending)
-				goto release;
+/*
+ * Move the workers, the condition they're waiting for changed for,
+ * from the wait lists to the ready queue.
+ */
+static void
+ni_fsm_schedule_wakeup_if(ni_fsm_schedule_t *sched, ni_ifworker_array_t *array,
+			ni_bool_t (*ready)(const ni_fsm_t *, const ni_ifworker_t *),
+			const ni_fsm_t *fsm)
+{
+	unsigned int i = 0;
 
-			if (ni_ifworker_complete(w)) {
-				ni_ifworker_cancel_secondary_timeout(w);
-				ni_ifworker_cancel_timeout(w);
-				goto release;
-			}
+	while (i < array->count) {
+		ni_ifworker_t *w = array->data[i];
 
-			if (!w->kickstarted)
-				w->kickstarted = TRUE;
-
-			/* We requested a change that takes time (such as acquiring
-			 * a DHCP lease). Wait for a notification from wickedd */
-			if (w->fsm.wait_for) {
-				ni_debug_application("%s: state=%s want=%s, wait-for=%s", w->name,
-					ni_ifworker_state_name(w->fsm.state),
-					ni_ifworker_state_name(w->target_state),
-					ni_ifworker_state_name(w->fsm.wait_for->next_state));
-				goto release;
-			}
+		if (w->queued || !ready || ready(fsm, w)) {
+			ni_fsm_schedule_queue(sched, w);
+			ni_ifworker_array_remove_index(array, i);
+		} else {
+			i++;
+		}
+	}
+}
 
-			action = w->fsm.next_action;
-			if (action->next_state == NI_FSM_STATE_NONE)
-				w->fsm.state = w->target_state;
+static ni_bool_t
+ni_fsm_schedule_event_done(const ni_fsm_t *fsm, const ni_ifworker_t *w)
+{
+	return ni_ifworker_complete(w) || (!w->pending && !w->fsm.wait_for);
+}
 
-			if (w->fsm.state == w->target_state) {
-				ni_ifworker_success(w);
-				made_progress = 1;
-				goto release;
-			}
+static ni_bool_t
+ni_fsm_schedule_call_slot(const ni_fsm_t *fsm, const ni_ifworker_t *w)
+{
+	return fsm->calls.count < ni_fsm_async_call_window(fsm);
+}
 
-			ni_debug_application("%s: state=%s want=%s, next transition is %s -> %s", w->name,
-				ni_ifworker_state_name(w->fsm.state),
-				ni_ifworker_state_name(w->target_state),
-				ni_ifworker_state_name(w->fsm.next_action->from_state),
-				ni_ifworker_state_name(w->fsm.next_action->next_state));
-
-			if (!action->bound) {
-				ni_ifworker_fail(w, "failed to bind services and methods for %s()",
-						action->common.method_name);
-				goto release;
-			}
+static void
+ni_fsm_schedule_wakeup(ni_fsm_t *fsm, ni_fsm_schedule_t *sched, ni_bool_t progress)
+{
+	unsigned int i = 0, j;
 
-			if (!ni_ifworker_check_dependencies(fsm, w, action)) {
-				ni_debug_application("%s: defer action (pending dependencies)", w->name);
-				goto release;
-			}
+	ni_fsm_schedule_wakeup_if(sched, &sched->waiting, ni_fsm_schedule_event_done, fsm);
+	ni_fsm_schedule_wakeup_if(sched, &sched->limited, ni_fsm_schedule_call_slot, fsm);
+	if (progress)
+		ni_fsm_schedule_wakeup_if(sched, &sched->resolving, NULL, fsm);
 
-			ni_ifworker_cancel_secondary_timeout(w);
+	while (i < sched->blockers.count) {
+		ni_ifworker_t *cw = sched->blockers.data[i];
 
-			prev_state = w->fsm.state;
-			ni_fsm_events_block(fsm);
+		if (!ni_fsm_schedule_blocker_changed(cw)) {
+			i++;
+			continue;
+		}
 
-			rv = action->call_func(fsm, w, action);
-			if (w->fsm.next_action)
-				w->fsm.next_action++;
+		for (j = 0; j < cw->dependents.workers.count; ++j)
+			ni_fsm_schedule_queue(sched, cw->dependents.workers.data[j]);
+		ni_ifworker_array_destroy(&cw->dependents.workers);
+		ni_ifworker_array_remove_index(&sched->blockers, i);
+	}
+}
 
-			if (rv >= 0) {
-				made_progress = 1;
+static void
+ni_fsm_schedule_destroy(ni_fsm_schedule_t *sched)
+{
+	unsigned int i;
 
-				if (w->fsm.wait_for) {
-					ni_debug_application("%s: waiting for event in state %s",
-						w->name, ni_ifworker_state_name(w->fsm.state));
-				} else {
-					ni_debug_application("%s: successfully transitioned from %s to %s",
-							w->name,
-							ni_ifworker_state_name(prev_state),
-							ni_ifworker_state_name(w->fsm.state));
-				}
-			} else
-			if (!w->failed) {
-				/* The fsm action should really have marked this
-				 * as a failure. shame on the lazy programmer. */
-				ni_ifworker_fail(w, "failed to transition from %s to %s",
-						ni_ifworker_state_name(prev_state),
-						ni_ifworker_state_name(action->next_state));
-			}
+	for (i = 0; i < sched->next.count; ++i)
+		sched->next.data[i]->queued = FALSE;
+	for (i = 0; i < sched->ready.count; ++i)
+		sched->ready.data[i]->queued = FALSE;
+	for (i = 0; i < sched->blockers.count; ++i)
+		ni_ifworker_array_destroy(&sched->blockers.data[i]->dependents.workers);
+
+	ni_ifworker_array_destroy(&sched->next);
+	ni_ifworker_array_destroy(&sched->ready);
+	ni_ifworker_array_destroy(&sched->waiting);
+	ni_ifworker_array_destroy(&sched->blockers);
+	ni_ifworker_array_destroy(&sched->resolving);
+	ni_ifworker_array_destroy(&sched->limited);
+}
+
+static ni_bool_t
+ni_fsm_schedule_check_dependencies(ni_fsm_t *fsm, ni_fsm_schedule_t *sched,
+			ni_ifworker_t *w, ni_fsm_transition_t *action)
+{
+	unsigned int i;
+
+	ni_ifworker_array_destroy(&fsm->blockers);
+	if (ni_ifworker_check_dependencies(fsm, w, action)) {
+		ni_ifworker_array_destroy(&fsm->blockers);
+		return TRUE;
+	}
+
+	if (!fsm->blockers.count)
+		ni_ifworker_array_append(&sched->resolving, w);
+	for (i = 0; i < fsm->blockers.count; ++i)
+		ni_fsm_schedule_depends_on(sched, w, fsm->blockers.data[i]);
+
+	ni_ifworker_array_destroy(&fsm->blockers);
+	return FALSE;
+}
+
+static int
+ni_fsm_schedule_worker(ni_fsm_t *fsm, ni_fsm_schedule_t *sched, ni_ifworker_t *w)
+{
+	ni_fsm_transition_t *action;
+	unsigned int prev_state;
+	int made_progress = 0;
+	int rv;
+
+	if (w->pending) {
+		ni_ifworker_array_append(&sched->waiting, w);
+		return 0;
+	}
+
+	if (ni_ifworker_complete(w)) {
+		ni_ifworker_cancel_secondary_timeout(w);
+		ni_ifworker_cancel_timeout(w);
+		return 0;
+	}
+
+	if (!w->kickstarted)
+		w->kickstarted = TRUE;
+
+	/* We requested a change that takes time (such as acquiring
+	 * a DHCP lease). Wait for a notification from wickedd */
+	if (w->fsm.wait_for) {
+		ni_debug_application("%s: state=%s want=%s, wait-for=%s", w->name,
+			ni_ifworker_state_name(w->fsm.state),
+			ni_ifworker_state_name(w->target_state),
+			ni_ifworker_state_name(w->fsm.wait_for->next_state));
+		ni_ifworker_array_append(&sched->waiting, w);
+		return 0;
+	}
+
+	action = w->fsm.next_action;
+	if (action->next_state == NI_FSM_STATE_NONE)
+		w->fsm.state = w->target_state;
+
+	if (w->fsm.state == w->target_state) {
+		ni_ifworker_success(w);
+		return 1;
+	}
+
+	ni_debug_application("%s: state=%s want=%s, next transition is %s -> %s", w->name,
+		ni_ifworker_state_name(w->fsm.state),
+		ni_ifworker_state_name(w->target_state),
+		ni_ifworker_state_name(w->fsm.next_action->from_state),
+		ni_ifworker_state_name(w->fsm.next_action->next_state));
+
+	if (!action->bound) {
+		ni_ifworker_fail(w, "failed to bind services and methods for %s()",
+				action->common.method_name);
+		return 0;
+	}
+
+	if (!ni_fsm_schedule_check_dependencies(fsm, sched, w, action)) {
+		ni_debug_application("%s: defer action (pending dependencies)", w->name);
+		ni_ifworker_timing_blocked(fsm, w, NULL);
+		return 0;
+	}
+
+	if (ni_fsm_async_call_enabled(fsm, action) &&
+	    fsm->calls.count >= ni_fsm_async_call_window(fsm)) {
+		ni_debug_application("%s: defer action (%u calls in progress)",
+				w->name, fsm->calls.count);
+		ni_ifworker_array_append(&sched->limited, w);
+		return 0;
+	}
+
+	ni_ifworker_cancel_secondary_timeout(w);
+
+	prev_state = w->fsm.state;
+	ni_fsm_events_block(fsm);
+
+	ni_ifworker_timing_start(fsm, w, action);
+	rv = action->call_func(fsm, w, action);
+	if (w->fsm.next_action)
+		w->fsm.next_action++;
+
+	if (rv >= 0) {
+		made_progress = 1;
+
+		if (w->fsm.wait_for) {
+			ni_debug_application("%s: waiting for event in state %s",
+				w->name, ni_ifworker_state_name(w->fsm.state));
+		} else {
+			ni_debug_application("%s: successfully transitioned from %s to %s",
+					w->name,
+					ni_ifworker_state_name(prev_state),
+					ni_ifworker_state_name(w->fsm.state));
+		}
+	} else
+	if (!w->failed) {
+		/* The fsm action should really have marked this
+		 * as a failure. shame on the lazy programmer. */
+		ni_ifworker_fail(w, "failed to transition from %s to %s",
+				ni_ifworker_state_name(prev_state),
+				ni_ifworker_state_name(action->next_state));
+	}
+
+	ni_fsm_process_events(fsm);
+	ni_fsm_events_unblock(fsm);
+
+	/* run the next transition in the next pass or wait for the event */
+	if (w->failed)
+		return made_progress;
+	if (w->pending || w->fsm.wait_for)
+		ni_ifworker_array_append(&sched->waiting, w);
+	else
+		ni_fsm_schedule_queue(sched, w);
+
+	return made_progress;
+}
+
+/*
+ * Run the worker state transitions.
+ *
+ * The first pass visits all workers, as we don't know what happened
+ * since the last call (events, timeouts, new workers). The following
+ * passes visit only the workers in the ready queue, that is workers
+ * which made a transition and the deferred workers which are ready
+ * to run again (see ni_fsm_schedule_wakeup).
+ */
+unsigned int
+ni_fsm_schedule(ni_fsm_t *fsm)
+{
+	ni_fsm_schedule_t sched = NI_FSM_SCHEDULE_INIT;
+	unsigned int i, count, waiting, nrequested;
+	int made_progress = 1;
+
+	for (i = 0; i < fsm->workers.count; ++i)
+		ni_fsm_schedule_queue(&sched, fsm->workers.data[i]);
+
+	while (1) {
+		ni_ifworker_array_t swap;
+
+		if (ni_fsm_async_calls_process(fsm))
+			made_progress = 1;
+
+		ni_fsm_schedule_wakeup(fsm, &sched, made_progress);
+
+		swap = sched.ready;
+		sched.ready = sched.next;
+		sched.next = swap;
+		for (i = 0; i < sched.ready.count; ++i)
+			sched.ready.data[i]->queued = FALSE;
+
+		made_progress = 0;
+		count = fsm->workers.count;
+		for (i = 0; i < sched.ready.count; ++i) {
+			ni_ifworker_t *w = sched.ready.data[i];
+
+			ni_ifworker_get(w);
+
+			if (ni_fsm_schedule_worker(fsm, &sched, w))
+				made_progress = 1;
 
-			ni_fsm_process_events(fsm);
-			ni_fsm_events_unblock(fsm);
-release:
 			ni_ifworker_release(w);
 
 			ni_dbus_objects_garbage_collect();
 		}
+		ni_ifworker_array_destroy(&sched.ready);
+
+		/* workers created while processing the events */
+		for (i = count; i < fsm->workers.count; ++i)
+			ni_fsm_schedule_queue(&sched, fsm->workers.data[i]);
 
 		if (!made_progress)
 			break;
@@ -5449,6 +6946,7 @@ release:
 		if (nrequested == 0)
 			break;
 	}
+	ni_fsm_schedule_destroy(&sched);
 
 	for (i = waiting = nrequested = 0; i < fsm->workers.count; ++i) {
 		ni_ifworker_t *w = fsm->workers.data[i];
@@ -5491,24 +6989,104 @@ ni_call_netif_refresh_tentative_addresses(ni_dbus_variant_t *result)
 	return rv;
 }
 
+/*
+ * The tentative addresses we wait for, tracked until their dad
+ * completion or deletion is reported by the address monitor.
+ */
+typedef struct ni_fsm_tentative_addr	ni_fsm_tentative_addr_t;
+struct ni_fsm_tentative_addr {
+	ni_fsm_tentative_addr_t *	next;
+	unsigned int			ifindex;
+	char *				ifname;
+	ni_sockaddr_t			local_addr;
+};
+
+typedef struct ni_fsm_tentative_addrs {
+	ni_fsm_tentative_addr_t *	list;
+	ni_bool_t			resync;
+} ni_fsm_tentative_addrs_t;
+
+static void
+ni_fsm_tentative_addrs_destroy(ni_fsm_tentative_addrs_t *tentative)
+{
+	ni_fsm_tentative_addr_t *ta;
+
+	while ((ta = tentative->list)) {
+		tentative->list = ta->next;
+		ni_string_free(&ta->ifname);
+		free(ta);
+	}
+}
+
+static void
+ni_fsm_tentative_addrs_add(ni_fsm_tentative_addrs_t *tentative, unsigned int ifindex,
+				const char *ifname, const ni_sockaddr_t *local_addr)
+{
+	ni_fsm_tentative_addr_t *ta;
+
+	ta = xcalloc(1, sizeof(*ta));
+	ta->ifindex = ifindex;
+	ni_string_dup(&ta->ifname, ifname);
+	ta->local_addr = *local_addr;
+	ta->next = tentative->list;
+	tentative->list = ta;
+}
+
+static void
+ni_fsm_tentative_addrs_event(unsigned int ifindex, ni_event_t event,
+				const ni_address_t *ap, void *user_data)
+{
+	ni_fsm_tentative_addrs_t *tentative = user_data;
+	ni_fsm_tentative_addr_t **pos, *ta;
+
+	if (!ap) {
+		/* events were dropped, query the addresses again */
+		tentative->resync = TRUE;
+		return;
+	}
+
+	if (event == NI_EVENT_ADDRESS_UPDATE && ni_address_is_tentative(ap) &&
+	    !ni_address_is_optimistic(ap) && !ni_address_is_duplicate(ap))
+		return;
+
+	for (pos = &tentative->list; (ta = *pos); pos = &ta->next) {
+		if (ta->ifindex != ifindex)
+			continue;
+		if (!ni_sockaddr_equal(&ta->local_addr, &ap->local_addr))
+			continue;
+
+		ni_debug_application("%s: address %s is %s", ta->ifname,
+				ni_sockaddr_print(&ta->local_addr),
+				event == NI_EVENT_ADDRESS_DELETE ? "deleted" :
+				ni_address_is_duplicate(ap) ? "duplicate" :
+				ni_address_is_optimistic(ap) ? "optimistic" :
+				"not tentative any more");
+		*pos = ta->next;
+		ni_string_free(&ta->ifname);
+		free(ta);
+		break;
+	}
+}
+
 static ni_bool_t
-ni_fsm_have_tentative_addrs(ni_fsm_t *fsm)
+ni_fsm_get_tentative_addrs(ni_fsm_tentative_addrs_t *tentative)
 {
 	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
 	ni_address_t *list = NULL, *ap;
-	dbus_bool_t found = FALSE;
 	ni_dbus_variant_t *entry;
 	ni_dbus_variant_t *array;
 	const char *path;
 	unsigned int i;
 
+	ni_fsm_tentative_addrs_destroy(tentative);
 	if (!ni_call_netif_refresh_tentative_addresses(&result)) {
 		ni_dbus_variant_destroy(&result);
-		return found;
+		return FALSE;
 	}
 
 	for (i = 0; (entry = ni_dbus_dict_get_entry(&result, i, &path)); ++i) {
 		const char * ifname  = NULL;
+		uint32_t     ifindex = 0;
 		uint32_t     ifflags = 0;
 
 		/*
@@ -5516,6 +7094,7 @@ ni_fsm_have_tentative_addrs(ni_fsm_t *fsm)
 		 * so we basically don't need to refresh + lookup workers devs.
 		 */
 		ni_dbus_dict_get_string(entry, "name",   &ifname);
+		ni_dbus_dict_get_uint32(entry, "index",  &ifindex);
 		ni_dbus_dict_get_uint32(entry, "status", &ifflags);
 		if (!(array = ni_dbus_dict_get(entry, "addresses")))
 			continue;
@@ -5527,32 +7106,67 @@ ni_fsm_have_tentative_addrs(ni_fsm_t *fsm)
 			continue;
 
 		for (ap = list; ap; ap = ap->next) {
+			/* usable while the optimistic dad is running */
+			if (ni_address_is_optimistic(ap))
+				continue;
+
 			ni_debug_application("%s: address %s is tentative",
 					ifname,
 					ni_sockaddr_print(&ap->local_addr));
-			found = TRUE;
+			ni_fsm_tentative_addrs_add(tentative, ifindex,
+					ifname, &ap->local_addr);
 		}
 		ni_address_list_destroy(&list);
 	}
 	ni_dbus_variant_destroy(&result);
 
-	return found;
+	return tentative->list != NULL;
 }
 
+/*
+ * Wait until the dad of the currently tentative ipv6 addresses is
+ * finished, as reported by the address events of the kernel.
+ */
 void
 ni_fsm_wait_tentative_addrs(ni_fsm_t *fsm)
 {
-	unsigned int i, count = 40; /* 10sec timeout */
+	ni_fsm_tentative_addrs_t tentative = { NULL, FALSE };
+	ni_timeout_t timeout = NI_TIMEOUT_FROM_SEC(10);
+	struct timeval expires;
+	ni_socket_t *monitor;
 
 	if (!fsm)
 		return;
 
 	ni_debug_application("waiting for tentative addresses");
-	for (i = 0; i < count; i++) {
-		if (!ni_fsm_have_tentative_addrs(fsm))
+
+	/* subscribe before the query to not miss any event */
+	monitor = ni_addr_monitor_open(AF_INET6, ni_fsm_tentative_addrs_event, &tentative);
+
+	ni_timer_get_time(&expires);
+	ni_timeval_add_timeout(&expires, timeout);
+	while (ni_fsm_get_tentative_addrs(&tentative)) {
+		tentative.resync = FALSE;
+		while (tentative.list && !tentative.resync) {
+			if (!(timeout = ni_timeout_left(&expires, NULL, NULL)))
+				break;
+
+			if (!monitor)
+				usleep(min_t(ni_timeout_t, timeout, 250) * 1000);
+			else
+			if (ni_socket_wait(timeout) != 0)
+				break;
+
+			/* poll the addresses without monitor */
+			tentative.resync = !monitor;
+		}
+		if (!tentative.resync || !ni_timeout_left(&expires, NULL, NULL))
 			break;
-		usleep(250000);
 	}
+	ni_fsm_tentative_addrs_destroy(&tentative);
+
+	if (monitor)
+		ni_socket_close(monitor);
 
 	ni_fsm_refresh_state(fsm);
 }
@@ -5753,6 +7367,9 @@ ni_fsm_process_worker_event(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_event_t *ev)
 		}
 	}
 
+	if (event_type != NI_EVENT_DEVICE_DELETE && ni_ifworker_link_detection_complete(w))
+		goto done;
+
 	ni_ifworker_advance_state(w, event_type);
 
 	if (event_type == NI_EVENT_DEVICE_DELETE) {
@@ -5907,6 +7524,7 @@ ni_fsm_process_event(ni_fsm_t *fsm, ni_fsm_event_t *ev)
 	}
 
 	ni_ifworker_get(w);
+	ni_ifworker_generation_bump(w);
 	/* process non-pending/ready or factory worker events */
 	ni_fsm_process_worker_event(fsm, w, ev);
 	ni_ifworker_release(w);
@@ -5970,8 +7588,12 @@ interface_state_change_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg
 	}
 
 	/* enqueue for processing */
-	ni_fsm_events_append(&fsm->events, ev);
-
+	if (!ni_fsm_event_enqueue(fsm, ev)) {
+		ni_debug_events("coalesce event signal %s from %s; uuid=<%s>",
+				ni_objectmodel_event_to_signal(ev->event_type),
+				ev->object_path, ni_uuid_print(&ev->event_uuid));
+		ni_fsm_event_free(ev);
+	} else
 	if (fsm->block_events) {
 		ni_debug_events("enqueue event signal %s from %s; uuid=<%s>",
 				ni_objectmodel_event_to_signal(ev->event_type),
@@ -5982,6 +7604,39 @@ interface_state_change_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg
 	}
 }
 
+/*
+ * Apply property deltas the server sends before device events to the
+ * netdev proxies. When a delta cannot be applied, the proxy is marked
+ * to be refreshed in full on the next event.
+ */
+static void
+interface_properties_changed_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg, void *user_data)
+{
+	const char *object_path = dbus_message_get_path(msg);
+	const char *signal_name = dbus_message_get_member(msg);
+	ni_dbus_object_t *list_object, *object;
+	const char *suffix = NULL;
+
+	if (!ni_string_eq(signal_name, "PropertiesChanged"))
+		return;
+	if (ni_ifworker_type_from_object_path(object_path, &suffix) != NI_IFWORKER_TYPE_NETDEV)
+		return;
+
+	if (!(list_object = ni_call_get_netif_list_object()))
+		return;
+	if (!(object = ni_dbus_object_lookup(list_object, object_path)) || !object->handle)
+		return;
+
+	if (!object->updated)
+		return;
+
+	if (!ni_dbus_object_apply_properties_changed(object, msg)) {
+		ni_debug_events("%s: cannot apply property changes, refresh on next event",
+				object_path);
+		object->updated = FALSE;
+	}
+}
+
 ni_dbus_client_t *
 ni_fsm_create_client(ni_fsm_t *fsm)
 {
@@ -5992,16 +7647,26 @@ ni_fsm_create_client(ni_fsm_t *fsm)
 
 	client = ni_dbus_object_get_client(fsm->client_root_object);
 
-	ni_dbus_client_add_signal_handler(client, NULL, NULL,
-					NI_OBJECTMODEL_NETIF_INTERFACE,
+	/* let the bus daemon pass the wickedd device signals only */
+	ni_dbus_client_add_signal_match(client, NI_OBJECTMODEL_DBUS_BUS_NAME,
+					NI_OBJECTMODEL_NETIF_LIST_PATH,
+					NI_OBJECTMODEL_NETIF_INTERFACE, NULL,
 					interface_state_change_signal,
 					fsm);
 
-	ni_dbus_client_add_signal_handler(client, NULL, NULL,
-					NI_OBJECTMODEL_MODEM_INTERFACE,
+	ni_dbus_client_add_signal_match(client, NI_OBJECTMODEL_DBUS_BUS_NAME,
+					NI_OBJECTMODEL_MODEM_LIST_PATH,
+					NI_OBJECTMODEL_MODEM_INTERFACE, NULL,
 					interface_state_change_signal,
 					fsm);
 
+	ni_dbus_client_add_signal_match(client, NI_OBJECTMODEL_DBUS_BUS_NAME,
+					NI_OBJECTMODEL_NETIF_LIST_PATH,
+					"org.freedesktop.DBus.Properties",
+					"PropertiesChanged",
+					interface_properties_changed_signal,
+					fsm);
+
 	return client;
 }
 
@@ -6035,6 +7700,7 @@ ni_fsm_mainloop(ni_fsm_t *fsm)
 {
 	ni_timeout_t timeout;
 
+	ni_profile_enter("fsm-run");
 	while (!ni_caught_terminal_signal()) {
 		if (!ni_fsm_do(fsm, &timeout))
 			break;
@@ -6045,6 +7711,7 @@ ni_fsm_mainloop(ni_fsm_t *fsm)
 		if (ni_fsm_schedule(fsm) == 0)
 			break;
 	}
+	ni_profile_leave();
 
 	ni_debug_application("finished with all devices.");
 }
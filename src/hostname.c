@@ -0,0 +1,270 @@
+/*
+ *	In-process builtins of the hostname system-updater
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+
+#include "netinfo_priv.h"
+#include "util_priv.h"
+#include "process.h"
+#include "update.h"
+#include "debug.h"
+
+/*
+ * These implement the actions of extensions/hostname.sh without to
+ * spawn a shell: the hostname.<ifname>.<type>.<family> files in the
+ * extension state directory record, which lease applied the hostname.
+ */
+#define NI_HOSTNAME_UPDATER_NAME	"hostname"
+#define NI_HOSTNAME_DEFAULT_FILE	"/etc/hostname"
+
+static int
+ni_hostname_updater_cmp(const void *a, const void *b)
+{
+	return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static ni_bool_t
+ni_hostname_updater_read(const char *filename, char *buf, size_t size)
+{
+	FILE *fp;
+	ni_bool_t ret;
+
+	if (!(fp = fopen(filename, "re")))
+		return FALSE;
+
+	ret = fgets(buf, size, fp) != NULL;
+	fclose(fp);
+	if (ret) {
+		/* the short name, as the script uses ${h%%.*} */
+		buf[strcspn(buf, ".\r\n")] = '\0';
+	}
+	return ret;
+}
+
+static void
+ni_hostname_updater_current(char *buf, size_t size)
+{
+	if (__ni_system_hostname_get(buf, size) < 0)
+		*buf = '\0';
+	buf[size - 1] = '\0';
+	buf[strcspn(buf, ".")] = '\0';
+}
+
+static void
+ni_hostname_updater_syslog_reload(void)
+{
+	static const char *paths[] = {
+		"/usr/sbin/rcsyslog",
+		"/sbin/rcsyslog",
+		NULL
+	};
+	const char *rcsyslog;
+	ni_shellcmd_t *cmd;
+	ni_process_t *pi;
+
+	/* fire and forget, as the script does with its result */
+	if (!(rcsyslog = ni_find_executable(paths)))
+		return;
+
+	if (!(cmd = ni_shellcmd_new(NULL)))
+		return;
+
+	if (ni_shellcmd_add_arg(cmd, rcsyslog) && ni_shellcmd_add_arg(cmd, "reload") &&
+	    (pi = ni_process_new(cmd))) {
+		if (ni_process_run(pi) != NI_PROCESS_SUCCESS)
+			ni_process_free(pi);
+	}
+	ni_shellcmd_release(cmd);
+}
+
+static int
+ni_hostname_updater_set(const char *hostname)
+{
+	if (__ni_system_hostname_put(hostname) < 0) {
+		ni_error("unable to set hostname '%s': %m", hostname);
+		return 1;
+	}
+
+	ni_debug_extension("%s updater: set hostname to '%s'",
+			NI_HOSTNAME_UPDATER_NAME, hostname);
+	ni_hostname_updater_syslog_reload();
+	return 0;
+}
+
+static int
+ni_hostname_updater_set_default(void)
+{
+	char def[HOST_NAME_MAX + 1];
+	char cur[HOST_NAME_MAX + 1];
+
+	if (!ni_hostname_updater_read(NI_HOSTNAME_DEFAULT_FILE, def, sizeof(def)) ||
+	    ni_string_empty(def))
+		return 0;
+
+	ni_hostname_updater_current(cur, sizeof(cur));
+	if (ni_string_eq(cur, def))
+		return 0;
+
+	return ni_hostname_updater_set(def);
+}
+
+static unsigned int
+ni_hostname_updater_scan(const char *statedir, ni_string_array_t *files)
+{
+	if (!ni_scandir(statedir, "hostname.*", files))
+		return 0;
+
+	/* consider them in the glob order of the script */
+	qsort(files->data, files->count, sizeof(files->data[0]),
+			ni_hostname_updater_cmp);
+	return files->count;
+}
+
+static const char *
+ni_hostname_updater_file(char **path, const char *statedir, const char *ifname,
+			const char *type, const char *family)
+{
+	return ni_string_printf(path, "%s/hostname.%s.%s.%s", statedir,
+			ifname, type, family);
+}
+
+int
+ni_hostname_updater_backup(const char *ifname, const char *type,
+			const char *family, const ni_string_array_t *args)
+{
+	/* /etc/hostname is not modified by us, so no need for a backup */
+	return 0;
+}
+
+int
+ni_hostname_updater_restore(const char *ifname, const char *type,
+			const char *family, const ni_string_array_t *args)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	const char *statedir;
+	char path[PATH_MAX];
+	unsigned int i;
+
+	if ((statedir = ni_extension_statedir(NI_HOSTNAME_UPDATER_NAME))) {
+		ni_hostname_updater_scan(statedir, &files);
+		for (i = 0; i < files.count; ++i) {
+			snprintf(path, sizeof(path), "%s/%s", statedir, files.data[i]);
+			unlink(path);
+		}
+		ni_string_array_destroy(&files);
+	}
+
+	return ni_hostname_updater_set_default();
+}
+
+int
+ni_hostname_updater_install(const char *ifname, const char *type,
+			const char *family, const ni_string_array_t *args)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	char name[HOST_NAME_MAX + 1];
+	char cur[HOST_NAME_MAX + 1];
+	char buf[HOST_NAME_MAX + 2];
+	char path[PATH_MAX];
+	const char *statedir;
+	char *own = NULL;
+	ni_bool_t found = FALSE;
+	unsigned int i;
+	FILE *fp;
+	int rc = 0;
+
+	if (ni_string_empty(ifname) || ni_string_empty(type) || ni_string_empty(family))
+		return 1;
+
+	if (!(statedir = ni_extension_statedir(NI_HOSTNAME_UPDATER_NAME)) ||
+	    !ni_hostname_updater_file(&own, statedir, ifname, type, family))
+		return 1;
+
+	snprintf(name, sizeof(name), "%s", args && args->count ? args->data[0] : "");
+	name[strcspn(name, ".")] = '\0';
+	ni_hostname_updater_current(cur, sizeof(cur));
+
+	/* drop outdated files, find the one which applied the current name */
+	ni_hostname_updater_scan(statedir, &files);
+	for (i = 0; i < files.count && !found; ++i) {
+		snprintf(path, sizeof(path), "%s/%s", statedir, files.data[i]);
+		if (!ni_file_exists(path))
+			continue;
+
+		if (ni_hostname_updater_read(path, buf, sizeof(buf)) && ni_string_eq(buf, cur))
+			found = TRUE;
+		else
+			unlink(path);
+	}
+	ni_string_array_destroy(&files);
+
+	/*
+	 * Either there were no files, so we're first, or we process an
+	 * update of the lease which controls the hostname.
+	 */
+	if (!found || ni_file_exists(own)) {
+		if (!ni_string_empty(name) && !ni_string_eq(cur, name))
+			rc = ni_hostname_updater_set(name);
+
+		/* store regardless of whether the hostname differs */
+		if ((fp = fopen(own, "we"))) {
+			fprintf(fp, "%s\n", name);
+			fclose(fp);
+		}
+	}
+
+	ni_string_free(&own);
+	return rc;
+}
+
+int
+ni_hostname_updater_remove(const char *ifname, const char *type,
+			const char *family, const ni_string_array_t *args)
+{
+	const char *statedir;
+	char *own = NULL;
+	int rc = 0;
+
+	if (ni_string_empty(ifname) || ni_string_empty(type) || ni_string_empty(family))
+		return 1;
+
+	if (!(statedir = ni_extension_statedir(NI_HOSTNAME_UPDATER_NAME)) ||
+	    !ni_hostname_updater_file(&own, statedir, ifname, type, family))
+		return 1;
+
+	/* restore the default only, when the remove is for our lease */
+	if (ni_file_exists(own)) {
+		unlink(own);
+		rc = ni_hostname_updater_set_default();
+	}
+
+	ni_string_free(&own);
+	return rc;
+}
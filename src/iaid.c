@@ -54,8 +54,99 @@ struct ni_iaid_map {
 	int			fd;
 	char *			file;
 	struct flock		flock;
+
+	ni_bool_t		resident;
+	ni_bool_t		dirty;
 };
 
+/*
+ * Resident copy of the default iaid map file of the process.
+ *
+ * The dhcp supplicants acquire the iaid for each device they start on.
+ * The map file is shared with other processes and still locked, read
+ * and written by the map handle, but the parsed document is kept while
+ * the file status (inode, size and timestamps) shows that no other
+ * process changed it since, so it is parsed once instead to re-parse it
+ * for each device. Lookups of an existing device use a name index of it
+ * and do not need to lock the file at all.
+ */
+typedef struct ni_iaid_map_resident {
+	char *			file;
+	struct stat		stb;
+	xml_document_t *	doc;
+	ni_var_array_t		vars;
+} ni_iaid_map_resident_t;
+
+static ni_iaid_map_resident_t	ni_iaid_map_resident;
+
+static ni_bool_t		ni_iaid_map_to_vars_doc(xml_document_t *, ni_var_array_t *);
+
+static ni_bool_t
+ni_iaid_map_stat_equal(const struct stat *a, const struct stat *b)
+{
+	return a->st_dev == b->st_dev && a->st_ino == b->st_ino &&
+		a->st_size == b->st_size &&
+		a->st_mtim.tv_sec == b->st_mtim.tv_sec &&
+		a->st_mtim.tv_nsec == b->st_mtim.tv_nsec &&
+		a->st_ctim.tv_sec == b->st_ctim.tv_sec &&
+		a->st_ctim.tv_nsec == b->st_ctim.tv_nsec;
+}
+
+static xml_document_t *
+ni_iaid_map_resident_adopt(const char *file, int fd)
+{
+	ni_iaid_map_resident_t *res = &ni_iaid_map_resident;
+	xml_document_t *doc;
+	struct stat stb;
+
+	if (!res->doc || !ni_string_eq(res->file, file) ||
+	    fstat(fd, &stb) < 0 || !ni_iaid_map_stat_equal(&stb, &res->stb))
+		return NULL;
+
+	doc = res->doc;
+	res->doc = NULL;
+	return doc;
+}
+
+static void
+ni_iaid_map_resident_update(ni_iaid_map_t *map)
+{
+	ni_iaid_map_resident_t *res = &ni_iaid_map_resident;
+	struct stat stb;
+
+	xml_document_free(res->doc);
+	res->doc = NULL;
+	ni_var_array_destroy(&res->vars);
+
+	if (map->dirty || !map->doc || fstat(map->fd, &stb) < 0) {
+		ni_string_free(&res->file);
+		return;
+	}
+
+	ni_string_dup(&res->file, map->file);
+	res->stb = stb;
+	res->doc = map->doc;
+	map->doc = NULL;
+	ni_iaid_map_to_vars_doc(res->doc, &res->vars);
+}
+
+static ni_bool_t
+ni_iaid_map_resident_get_iaid(const char *name, unsigned int *iaid)
+{
+	ni_iaid_map_resident_t *res = &ni_iaid_map_resident;
+	const ni_var_t *var;
+	struct stat stb;
+
+	if (!res->doc || ni_string_empty(name) || stat(res->file, &stb) < 0 ||
+	    !ni_iaid_map_stat_equal(&stb, &res->stb))
+		return FALSE;
+
+	if (!(var = ni_var_array_get(&res->vars, name)))
+		return FALSE;
+
+	return ni_parse_uint(var->value, iaid, 0) == 0;
+}
+
 static ni_iaid_map_t *
 ni_iaid_map_new(void)
 {
@@ -108,6 +199,9 @@ void
 ni_iaid_map_free(ni_iaid_map_t *map)
 {
 	if (map) {
+		if (map->resident && map->fd >= 0)
+			ni_iaid_map_resident_update(map);
+
 		if (map->fd >= 0) {
 			ni_iaid_map_unlock(map);
 			close(map->fd);
@@ -177,6 +271,7 @@ ni_iaid_map_load(const char *filename)
 		}
 	} else {
 		type = "default";
+		map->resident = TRUE;
 		if (!ni_iaid_map_set_default_file(&map->file)) {
 			ni_error("unable to construct %s iaid map file name: %m", type);
 			goto failure;
@@ -203,6 +298,9 @@ ni_iaid_map_load(const char *filename)
 		goto failure;
 	}
 
+	if (map->resident && (map->doc = ni_iaid_map_resident_adopt(map->file, map->fd)))
+		return map;
+
 	if (fstat(map->fd, &stb) < 0)
 		stb.st_size = BUFSIZ;
 
@@ -267,7 +365,11 @@ ni_iaid_map_save(ni_iaid_map_t *map)
 	}
 	free(data);
 
-	return ret < 0 ? FALSE : TRUE;
+	if (ret < 0)
+		return FALSE;
+
+	map->dirty = FALSE;
+	return TRUE;
 }
 
 static xml_node_t *
@@ -303,16 +405,13 @@ ni_iaid_map_node_to_iaid(const xml_node_t *node, unsigned int *iaid)
 	return ni_parse_uint(node->cdata, iaid, 0) == 0;
 }
 
-ni_bool_t
-ni_iaid_map_to_vars(const ni_iaid_map_t *map, ni_var_array_t *vars)
+static ni_bool_t
+ni_iaid_map_to_vars_doc(xml_document_t *doc, ni_var_array_t *vars)
 {
 	xml_node_t *root, *node = NULL;
 	const char *name;
 
-	if (!vars)
-		return FALSE;
-
-	if (!(root = ni_iaid_map_root_node(map)))
+	if (!vars || !doc || !(root = xml_document_root(doc)))
 		return FALSE;
 
 	ni_var_array_destroy(vars);
@@ -329,6 +428,12 @@ ni_iaid_map_to_vars(const ni_iaid_map_t *map, ni_var_array_t *vars)
 	return TRUE;
 }
 
+ni_bool_t
+ni_iaid_map_to_vars(const ni_iaid_map_t *map, ni_var_array_t *vars)
+{
+	return map && ni_iaid_map_to_vars_doc(map->doc, vars);
+}
+
 ni_bool_t
 ni_iaid_map_get_iaid(const ni_iaid_map_t *map, const char *name, unsigned int *iaid)
 {
@@ -387,12 +492,14 @@ ni_iaid_map_set(ni_iaid_map_t *map, const char *name, unsigned int iaid)
 			continue;
 
 		xml_node_set_uint(node, iaid);
+		map->dirty = TRUE;
 		return TRUE;
 	}
 
 	if ((node = xml_node_new(NI_CONFIG_DEFAULT_IAID_NODE, root))) {
 		xml_node_add_attr(node, NI_CONFIG_DEFAULT_IAID_DEVICE, name);
 		xml_node_set_uint(node, iaid);
+		map->dirty = TRUE;
 		return TRUE;
 	}
 	return FALSE;
@@ -417,6 +524,7 @@ ni_iaid_map_del_name(ni_iaid_map_t *map, const char *name)
 
 		xml_node_detach(node);
 		xml_node_free(node);
+		map->dirty = TRUE;
 		return TRUE;
 	}
 	return FALSE;
@@ -437,6 +545,7 @@ ni_iaid_map_del_iaid(ni_iaid_map_t *map, unsigned int iaid)
 
 		xml_node_detach(node);
 		xml_node_free(node);
+		map->dirty = TRUE;
 		return TRUE;
 	}
 	return FALSE;
@@ -462,29 +571,61 @@ ni_iaid_create_hwaddr(unsigned int *iaid, const ni_hwaddr_t *hwa)
 	return TRUE;
 }
 
+static int
+ni_iaid_map_cmp_iaid(const void *a, const void *b)
+{
+	unsigned int ia = *(const unsigned int *)a;
+	unsigned int ib = *(const unsigned int *)b;
+
+	return ia < ib ? -1 : ia > ib;
+}
+
+/*
+ * Find the lowest iaid not used in the map, using one sorted pass over
+ * the iaids in the map instead to scan the map for each candidate.
+ */
+static ni_bool_t
+ni_iaid_map_get_free(const ni_iaid_map_t *map, unsigned int *iaid)
+{
+	ni_uint_array_t used = NI_UINT_ARRAY_INIT;
+	xml_node_t *root, *node = NULL;
+	unsigned int i, curr, next = 1;
+
+	if (!(root = ni_iaid_map_root_node(map)))
+		return FALSE;
+
+	while ((node = ni_iaid_map_next_node(root, node))) {
+		if (ni_iaid_map_node_to_iaid(node, &curr) && curr)
+			ni_uint_array_append(&used, curr);
+	}
+	if (used.count)
+		qsort(used.data, used.count, sizeof(used.data[0]), ni_iaid_map_cmp_iaid);
+
+	for (i = 0; i < used.count && next < -1U; ++i) {
+		if (used.data[i] > next)
+			break;
+		if (used.data[i] == next)
+			next++;
+	}
+	ni_uint_array_destroy(&used);
+
+	if (next == -1U)
+		return FALSE;
+
+	*iaid = next;
+	return TRUE;
+}
+
 ni_bool_t
 ni_iaid_create(unsigned int *iaid, const ni_netdev_t *dev, const ni_iaid_map_t *map)
 {
-	unsigned int i;
-
 	if (!iaid || !dev)
 		return FALSE;
 
 	if (ni_iaid_create_hwaddr(iaid, &dev->link.hwaddr))
 		return TRUE;
 
-	if (map) {
-		for (i = 1; i < -1U; ++i) {
-			const char *name = NULL;
-
-			if (ni_iaid_map_get_name(map, i, &name))
-				continue;
-
-			*iaid = i;
-			return TRUE;
-		}
-	}
-	return FALSE;
+	return map && ni_iaid_map_get_free(map, iaid);
 }
 
 ni_bool_t
@@ -495,6 +636,9 @@ ni_iaid_acquire(unsigned int *iaid, const ni_netdev_t *dev, unsigned int request
 	if (!iaid || !dev)
 		return FALSE;
 
+	if (ni_iaid_map_resident_get_iaid(dev->name, iaid))
+		return TRUE;
+
 	if (!(map = ni_iaid_map_load(NULL)))
 		goto failure;
 
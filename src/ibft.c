@@ -25,13 +25,21 @@
 #endif
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <net/if.h>
 
 #include <wicked/types.h>
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
+#include <wicked/ethtool.h>
+#include <wicked/xml.h>
 
 #include "ibft.h"
+#include "buffer.h"
+#include "modprobe.h"
 #include "util_priv.h"
+#include "array_priv.h"
 
 /* ibft nic array chunk size */
 #define NI_IBFT_NIC_ARRAY_CHUNK		2
@@ -92,28 +100,307 @@ ni_ibft_nic_array_destroy(ni_ibft_nic_array_t *nics)
 }
 
 static void
-__ni_ibft_nic_array_realloc(ni_ibft_nic_array_t *nics, unsigned int newsize)
+__ni_ibft_nic_array_realloc(ni_ibft_nic_array_t *nics, unsigned int newcount)
 {
-	ni_ibft_nic_t **newdata;
-	unsigned int   i;
+	ni_bool_t ok;
 
-	newsize = (newsize + NI_IBFT_NIC_ARRAY_CHUNK);
-	newdata = realloc(nics->data, newsize * sizeof(ni_ibft_nic_t *));
-	ni_assert(newdata != NULL);
-
-	nics->data = newdata;
-	for(i = nics->count; i < newsize; ++i) {
-		nics->data[i] = NULL;
-	}
+	ok = ni_array_grow((void **)&nics->data, sizeof(ni_ibft_nic_t *),
+				nics->count, newcount, NI_IBFT_NIC_ARRAY_CHUNK);
+	ni_assert(ok);
 }
 
 void
 ni_ibft_nic_array_append(ni_ibft_nic_array_t *nics, ni_ibft_nic_t *nic)
 {
 	if (nics && nic) {
-		if((nics->count % NI_IBFT_NIC_ARRAY_CHUNK) == 0)
-			__ni_ibft_nic_array_realloc(nics, nics->count);
+		__ni_ibft_nic_array_realloc(nics, nics->count + 1);
 
 		nics->data[nics->count++] = ni_ibft_nic_ref(nic);
 	}
 }
+
+/*
+ * Built-in firmware discovery of the netif-firmware-discovery "ibft"
+ * extension, producing the same output as the extensions/ibft script
+ * without to fork+exec a shell and its tools in the initrd.
+ */
+#define NI_IBFT_SYSFS_PATH		"/sys/firmware/ibft"
+#define NI_IBFT_NIC_PREFIX		"ethernet"
+#define NI_IBFT_MODULE			"iscsi_ibft"
+#define NI_IBFT_PROC_VLAN_CONFIG	"/proc/net/vlan/config"
+
+static void
+ni_ibft_firmware_scan(ni_ibft_nic_array_t *nics, const char *root, const char *path)
+{
+	ni_ibft_nic_array_t all = NI_IBFT_NIC_ARRAY_INIT;
+	unsigned int i;
+
+	if (ni_string_empty(root) && !ni_isdir(NI_IBFT_SYSFS_PATH))
+		ni_modprobe(NI_IBFT_MODULE, NULL);
+
+	ni_sysfs_ibft_scan_nics(&all, root);
+	for (i = 0; i < all.count; ++i) {
+		ni_ibft_nic_t *nic = all.data[i];
+
+		/* skip invalid nic blocks */
+		if (!(nic->flags & 0x01))
+			continue;
+
+		/* ethernet<N> nodes only, optionally the path/node only */
+		if (!ni_string_startswith(nic->node, NI_IBFT_NIC_PREFIX) ||
+		    !nic->node[sizeof(NI_IBFT_NIC_PREFIX) - 1])
+			continue;
+		if (!ni_string_empty(path) && !ni_string_eq(path, nic->node))
+			continue;
+
+		ni_ibft_nic_array_append(nics, nic);
+	}
+	ni_ibft_nic_array_destroy(&all);
+}
+
+static char *
+ni_ibft_firmware_vlan_ifname(const ni_ibft_nic_t *nic, char **ifname)
+{
+	char line[256], name[IFNAMSIZ + 1], dev[IFNAMSIZ + 1];
+	unsigned int vid;
+	FILE *fp;
+
+	ni_string_free(ifname);
+	if ((fp = fopen(NI_IBFT_PROC_VLAN_CONFIG, "re"))) {
+		/* "<name> | <vid> | <dev>" after the two header lines */
+		while (!*ifname && fgets(line, sizeof(line), fp)) {
+			if (sscanf(line, "%16s | %u | %16s", name, &vid, dev) != 3)
+				continue;
+			if (vid == nic->vlan && ni_string_eq(dev, nic->ifname))
+				ni_string_dup(ifname, name);
+		}
+		fclose(fp);
+	}
+	if (!*ifname)
+		ni_string_printf(ifname, "%s.%u", nic->ifname, nic->vlan);
+	return *ifname;
+}
+
+static xml_node_t *
+ni_ibft_firmware_interface_new(const ni_ibft_nic_t *nic, xml_node_t *parent,
+		const char *ifname, unsigned int vlan)
+{
+	xml_node_t *ifnode, *node;
+	char *origin = NULL;
+
+	ifnode = xml_node_new("interface", parent);
+	ni_string_printf(&origin, "firmware:ibft:%s", nic->node);
+	xml_node_add_attr(ifnode, "origin", origin);
+	ni_string_free(&origin);
+
+	if (ifname) {
+		xml_node_new_element("name", ifnode, ifname);
+	} else {
+		node = xml_node_new_element_uint("name", ifnode, nic->ifindex);
+		xml_node_add_attr(node, "namespace", "ifindex");
+	}
+
+	node = xml_node_new("alias", ifnode);
+	ni_string_printf(&node->cdata, "ibft%s.%u",
+			nic->node + sizeof(NI_IBFT_NIC_PREFIX) - 1, vlan);
+
+	node = xml_node_new("control", ifnode);
+	xml_node_new_element("persistent", node, "true");
+	xml_node_new_element("usercontrol", node, "false");
+
+	return ifnode;
+}
+
+static ni_bool_t
+ni_ibft_firmware_storage_only(const ni_ibft_nic_t *nic)
+{
+	ni_netdev_ref_t ref = NI_NETDEV_REF_INIT;
+	ni_ethtool_t *ethtool;
+	ni_bool_t ret = FALSE;
+	unsigned int i;
+
+	if (!(ethtool = ni_ethtool_new()))
+		return FALSE;
+
+	ni_netdev_ref_set(&ref, nic->ifname, nic->ifindex);
+	if (ni_ethtool_get_driver_info(&ref, ethtool) == 0 && ethtool->driver_info &&
+	    ni_string_eq(ethtool->driver_info->driver, "bnx2x") &&
+	    ni_ethtool_get_priv_flags(&ref, ethtool) == 0 && ethtool->priv_flags) {
+		const ni_ethtool_priv_flags_t *pflags = ethtool->priv_flags;
+
+		for (i = 0; i < pflags->names.count && i < 32; ++i) {
+			if (ni_string_eq_nocase(pflags->names.data[i],
+						"Storage only interface"))
+				ret = !!(pflags->bitmap & NI_BIT(i));
+		}
+	}
+	ni_netdev_ref_destroy(&ref);
+	ni_ethtool_free(ethtool);
+	return ret;
+}
+
+static ni_bool_t
+ni_ibft_firmware_gateway_valid(const ni_sockaddr_t *gw)
+{
+	/* 0.0.0.0, :: and 255.255.255.255 are ignored by the script too */
+	if (!ni_sockaddr_is_specified(gw))
+		return FALSE;
+	if (gw->ss_family == AF_INET && gw->sin.sin_addr.s_addr == INADDR_BROADCAST)
+		return FALSE;
+	return TRUE;
+}
+
+static void
+ni_ibft_firmware_nic_config(const ni_ibft_nic_t *nic, xml_node_t *root)
+{
+	xml_node_t *ifnode, *ipnode, *node, *servers;
+	char *vlan_ifname = NULL;
+	const char *family;
+	char *temp = NULL;
+
+	switch (nic->ipaddr.ss_family) {
+	case AF_INET:
+		family = "ipv4";
+		break;
+	case AF_INET6:
+		family = "ipv6";
+		break;
+	default:
+		return;
+	}
+
+	/* Enum: Other,Manual,WellKnown,Dhcp,RouterAdv */
+	if (nic->origin != 3 && !nic->prefix_len)
+		return;
+
+	ifnode = ni_ibft_firmware_interface_new(nic, root, NULL, 0);
+	if (nic->vlan) {
+		ni_ibft_firmware_vlan_ifname(nic, &vlan_ifname);
+		ifnode = ni_ibft_firmware_interface_new(nic, root,
+				vlan_ifname, nic->vlan);
+		ni_string_free(&vlan_ifname);
+
+		node = xml_node_new("vlan", ifnode);
+		xml_node_add_attr(xml_node_new_element_uint("device", node,
+					nic->ifindex), "namespace", "ifindex");
+		xml_node_new_element_uint("tag", node, nic->vlan);
+	}
+
+	if (ni_ibft_firmware_storage_only(nic)) {
+		node = xml_node_new("ipv4", ifnode);
+		xml_node_new_element("enabled", node, "false");
+		node = xml_node_new("ipv6", ifnode);
+		xml_node_new_element("enabled", node, "false");
+		return;
+	}
+
+	if (nic->origin != 3) {
+		ni_string_printf(&temp, "%s:static", family);
+		ipnode = xml_node_new(temp, ifnode);
+
+		node = xml_node_new("address", ipnode);
+		ni_string_printf(&temp, "%s/%u", ni_sockaddr_print(&nic->ipaddr),
+				nic->prefix_len);
+		xml_node_new_element("local", node, temp);
+
+		if (ni_ibft_firmware_gateway_valid(&nic->gateway)) {
+			node = xml_node_new("nexthop", xml_node_new("route", ipnode));
+			xml_node_new_element("gateway", node,
+					ni_sockaddr_print(&nic->gateway));
+		}
+
+		servers = NULL;
+		if (ni_sockaddr_is_specified(&nic->primary_dns)) {
+			servers = xml_node_new("servers", xml_node_new("resolver", ipnode));
+			xml_node_new_element("server", servers,
+					ni_sockaddr_print(&nic->primary_dns));
+		}
+		if (ni_sockaddr_is_specified(&nic->secondary_dns)) {
+			if (!servers)
+				servers = xml_node_new("servers", xml_node_new("resolver", ipnode));
+			xml_node_new_element("server", servers,
+					ni_sockaddr_print(&nic->secondary_dns));
+		}
+
+		if (!ni_string_empty(nic->hostname))
+			xml_node_new_element("hostname", ipnode, nic->hostname);
+	}
+
+	if (nic->origin == 3 || ni_sockaddr_is_specified(&nic->dhcp)) {
+		ni_string_printf(&temp, "%s:dhcp", family);
+		ipnode = xml_node_new(temp, ifnode);
+		xml_node_new_element("enabled", ipnode, "true");
+	}
+	ni_string_free(&temp);
+}
+
+static int
+ni_ibft_firmware_output(ni_buffer_t *out, const char *data)
+{
+	size_t len = ni_string_len(data);
+
+	if (len && (!ni_buffer_ensure_tailroom(out, len) ||
+		    ni_buffer_put(out, data, len) < 0))
+		return -1;
+	return 0;
+}
+
+int
+ni_ibft_firmware_show_config(ni_buffer_t *out, const char *root, const char *path)
+{
+	ni_ibft_nic_array_t nics = NI_IBFT_NIC_ARRAY_INIT;
+	xml_node_t *top, *ifnode;
+	unsigned int i;
+	char *data;
+	int ret = 0;
+
+	if (!out)
+		return -1;
+
+	ni_ibft_firmware_scan(&nics, root, path);
+
+	top = xml_node_new(NULL, NULL);
+	for (i = 0; i < nics.count; ++i)
+		ni_ibft_firmware_nic_config(nics.data[i], top);
+	ni_ibft_nic_array_destroy(&nics);
+
+	for (ifnode = top->children; ifnode && !ret; ifnode = ifnode->next) {
+		if ((data = xml_node_sprint(ifnode))) {
+			ret = ni_ibft_firmware_output(out, data);
+			free(data);
+		}
+	}
+	xml_node_free(top);
+	return ret;
+}
+
+int
+ni_ibft_firmware_list_ifnames(ni_buffer_t *out, const char *root, const char *path)
+{
+	ni_ibft_nic_array_t nics = NI_IBFT_NIC_ARRAY_INIT;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	char *vlan_ifname = NULL;
+	ni_ibft_nic_t *nic;
+	unsigned int i;
+	int ret;
+
+	if (!out)
+		return -1;
+
+	ni_ibft_firmware_scan(&nics, root, path);
+	for (i = 0; i < nics.count; ++i) {
+		nic = nics.data[i];
+
+		if (nic->vlan) {
+			ni_ibft_firmware_vlan_ifname(nic, &vlan_ifname);
+			ni_stringbuf_printf(&buf, "%s ", vlan_ifname);
+			ni_string_free(&vlan_ifname);
+		}
+		ni_stringbuf_printf(&buf, "%s\n", nic->ifname);
+	}
+	ni_ibft_nic_array_destroy(&nics);
+
+	ret = ni_ibft_firmware_output(out, buf.string);
+	ni_stringbuf_destroy(&buf);
+	return ret;
+}
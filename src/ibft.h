@@ -68,4 +68,12 @@ extern void		ni_ibft_nic_array_append(ni_ibft_nic_array_t *nics,
 extern int		ni_sysfs_ibft_scan_nics(ni_ibft_nic_array_t *nics,
 						const char *root);
 
+/*
+ * netif-firmware-discovery builtins of the "ibft" extension
+ */
+extern int		ni_ibft_firmware_show_config(ni_buffer_t *out,
+						const char *root, const char *path);
+extern int		ni_ibft_firmware_list_ifnames(ni_buffer_t *out,
+						const char *root, const char *path);
+
 #endif /* WICKED_IBFT_H */
@@ -46,6 +46,7 @@
 #include "pppd.h"
 #include "teamd.h"
 #include "ovs.h"
+#include "nexthop.h"
 
 #include <errno.h>
 
@@ -64,6 +65,7 @@
 #include <linux/if_link.h>
 #include <linux/if_ether.h>
 #include <linux/if_tunnel.h>
+#include <linux/if_bridge.h>
 #include <linux/fib_rules.h>
 
 #if defined(HAVE_IFLA_VLAN_PROTOCOL)
@@ -94,6 +96,11 @@
 #define DUMMY_MODULE_OPTS "numdummies=0"
 #endif
 
+#ifndef	BRIDGE_VLAN_INFO_RANGE_BEGIN
+#define	BRIDGE_VLAN_INFO_RANGE_BEGIN	(1<<3)
+#define	BRIDGE_VLAN_INFO_RANGE_END	(1<<4)
+#endif
+
 #ifndef	BOND_MAX_ARP_TARGETS
 #define	BOND_MAX_ARP_TARGETS		16
 #endif
@@ -116,6 +123,7 @@ static int	__ni_netdev_update_mtu(ni_netconfig_t *nc, ni_netdev_t *dev,
 				ni_addrconf_lease_t       *new_lease);
 
 static int	__ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg);
+static struct nl_msg *	__ni_rtnl_link_create_msg(ni_netconfig_t *nc, const ni_netdev_t *cfg);
 static int	__ni_rtnl_link_change(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t *cfg);
 
 static int	__ni_rtnl_link_change_mtu(ni_netdev_t *dev, unsigned int mtu);
@@ -125,16 +133,20 @@ static int	__ni_rtnl_link_up(const ni_netdev_t *, const ni_netdev_req_t *);
 static int	__ni_rtnl_link_down(const ni_netdev_t *);
 static int	__ni_rtnl_link_unenslave(const ni_netdev_t *);
 static int	__ni_rtnl_link_delete(const ni_netdev_t *);
+static struct nl_msg *	__ni_rtnl_link_unenslave_msg(const ni_netdev_t *);
+static struct nl_msg *	__ni_rtnl_link_delete_msg(const ni_netdev_t *);
 
 static int	__ni_rtnl_link_add_port_up(const ni_netdev_t *, const char *, unsigned int);
+static struct nl_msg *	__ni_rtnl_link_add_port_msg(const ni_netdev_t *, unsigned int);
+static struct nl_msg *	__ni_rtnl_link_bridge_msg(const char *, unsigned int, const ni_bridge_t *);
+static struct nl_msg *	__ni_rtnl_link_bridge_port_msg(const ni_netdev_t *, const ni_bridge_port_t *);
+static struct nl_msg *	__ni_rtnl_link_bridge_vlan_msg(const ni_netdev_t *, const ni_bridge_port_t *, int);
 static int	__ni_rtnl_link_bond_enslave(const ni_netdev_t *, const char *, unsigned int);
 
 static int	__ni_rtnl_send_deladdr(ni_netdev_t *, const ni_address_t *);
 static int	__ni_rtnl_send_newaddr(ni_netdev_t *, const ni_address_t *, int);
 static int	__ni_rtnl_send_delroute(ni_netdev_t *, ni_route_t *);
 static int	__ni_rtnl_send_newroute(ni_netdev_t *, ni_route_t *, int);
-static int	__ni_rtnl_send_newrule(const ni_rule_t *, int);
-static int	__ni_rtnl_send_delrule(const ni_rule_t *);
 
 static int	addattr_sockaddr(struct nl_msg *, int, const ni_sockaddr_t *);
 
@@ -171,6 +183,7 @@ static int
 ni_system_interface_enslave(ni_netconfig_t *nc, ni_netdev_t *master, ni_netdev_t *dev,
 				const ni_netdev_req_t *req)
 {
+	ni_teamd_port_batch_t *batch;
 	int ret = -1;
 
 	if (!master || !dev || !req)
@@ -223,16 +236,19 @@ ni_system_interface_enslave(ni_netconfig_t *nc, ni_netdev_t *master, ni_netdev_t
 			ni_error("%s: port configuration type mismatch", dev->name);
 			return -1;
 		}
-		ret = ni_teamd_port_enslave(master, dev, req->port ? &req->port->team : NULL);
+		/* refresh master - also when enslave fails... */
+		batch = ni_teamd_port_batch_new();
+		if (ni_teamd_port_batch_add(batch, dev, req->port ? &req->port->team : NULL))
+			ret = ni_teamd_port_batch_commit(batch, master, master);
+		else
+			ni_teamd_discover(master);
+		ni_teamd_port_batch_free(batch);
 
 		if (ret == 0) {
 			ni_netdev_ref_set(&dev->link.masterdev,
 					master->name, master->link.ifindex);
 
 		}
-
-		/* refresh master - also when enslave fails... */
-		ni_teamd_discover(master);
 		break;
 	case NI_IFTYPE_BRIDGE:
 		ret = __ni_rtnl_link_add_port_up(dev, master->name,
@@ -605,7 +621,7 @@ ni_addrconf_action_addrs_verify_check(ni_netdev_t *dev, ni_addrconf_lease_t *lea
 			else	/* shouldn't happen, ...count it just in case */
 				duplicates++;
 		} else
-		if (ni_address_is_tentative(ap)) {
+		if (ni_address_is_tentative(ap) && !ni_address_is_optimistic(ap)) {
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_IFCONFIG,
 					"%s: lease %s:%s address %s is tentative",
 					dev->name,
@@ -628,7 +644,7 @@ ni_addrconf_action_addrs_verify_check(ni_netdev_t *dev, ni_addrconf_lease_t *lea
 					ni_sockaddr_print(&la->local_addr));
 			duplicates++;
 		} else {
-			ap = ni_address_list_find(dev->addrs, &la->local_addr);
+			ap = ni_netdev_find_address(dev, &la->local_addr);
 			if (ap && !ni_address_is_duplicate(ap))
 				verified++;
 		}
@@ -740,7 +756,7 @@ ni_addrconf_action_verify_address_apply(ni_netdev_t *dev, ni_addrconf_lease_t *l
 			duplicates++;
 			continue;
 		}
-		ap = ni_address_list_find(dev->addrs, &la->local_addr);
+		ap = ni_netdev_find_address(dev, &la->local_addr);
 		if (ap && !ni_address_is_duplicate(ap))
 			verified++;
 	}
@@ -764,7 +780,12 @@ ni_addrconf_action_routes_apply(ni_netdev_t *dev, ni_addrconf_lease_t *lease)
 	ni_netconfig_t *nc = ni_global_state_handle(0);
 	int res;
 
-	if ((res = __ni_system_refresh_interface_routes(nc, dev)) < 0)
+	/* load the routes of tables the lease refers to first */
+	if (ni_netconfig_route_tables_update(nc))
+		res = __ni_system_refresh_routes(nc);
+	else
+		res = __ni_system_refresh_interface_routes(nc, dev);
+	if (res < 0)
 		return res;
 
 	if ((res = __ni_netdev_update_routes(nc, dev, lease->old, lease)) < 0)
@@ -846,6 +867,9 @@ ni_addrconf_action_routes_remove(ni_netdev_t *dev, ni_addrconf_lease_t *lease)
 	if ((res = __ni_netdev_update_rules(nc, dev, lease->old, NULL)) < 0)
 		return res;
 
+	/* stop to track tables no other lease refers to */
+	ni_netconfig_route_tables_update(nc);
+
 	if ((res = __ni_system_refresh_interface_routes(nc, dev)) < 0)
 		return res;
 
@@ -1022,10 +1046,190 @@ ni_system_interface_delete(ni_netconfig_t *nc, const char *ifname)
 }
 
 /*
- * Create a VLAN interface
+ * Delete a set of virtual interfaces, sending the RTM_DELLINK requests
+ * of all of them in one netlink batch. Upper devices are deleted before
+ * their lower devices in the set, the kernel would delete them with the
+ * lower device anyway. Returns the number of failed deletions, with the
+ * result of each device in the results array.
  */
+static ni_bool_t
+__ni_system_interfaces_delete_type(ni_iftype_t type)
+{
+	switch (type) {
+	case NI_IFTYPE_DUMMY:
+	case NI_IFTYPE_VLAN:
+	case NI_IFTYPE_MACVLAN:
+	case NI_IFTYPE_MACVTAP:
+	case NI_IFTYPE_TUN:
+	case NI_IFTYPE_TAP:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static unsigned int
+__ni_system_interfaces_delete_depth(ni_netconfig_t *nc, unsigned int count,
+			ni_netdev_t **devs, unsigned int *depth, unsigned int pos)
+{
+	unsigned int lower, i;
+	ni_netdev_t *ldev;
+
+	if (depth[pos])
+		return depth[pos];
+
+	depth[pos] = 1;	/* loop guard */
+	if ((lower = devs[pos]->link.lowerdev.index) &&
+	    (ldev = ni_netdev_by_index(nc, lower)) &&
+	    __ni_system_interfaces_delete_type(ldev->link.type)) {
+		for (i = 0; i < count; ++i) {
+			if (i != pos && devs[i] && devs[i]->link.ifindex == lower) {
+				depth[pos] += __ni_system_interfaces_delete_depth(nc,
+							count, devs, depth, i);
+				break;
+			}
+		}
+	}
+	return depth[pos];
+}
+
 int
-ni_system_vlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
+ni_system_interfaces_delete_batch(ni_netconfig_t *nc, unsigned int count,
+				ni_netdev_t **devs, int *results)
+{
+	unsigned int i, level, max = 0, failed = 0;
+	unsigned int *depth;
+	ni_nl_batch_t *batch;
+	struct nl_msg *msg;
+	int *pos;
+
+	if (!nc || !devs || !results)
+		return -1;
+
+	if (!(batch = ni_nl_batch_new()))
+		return -1;
+
+	pos = xcalloc(count ? count : 1, sizeof(*pos));
+	depth = xcalloc(count ? count : 1, sizeof(*depth));
+	for (i = 0; i < count; ++i) {
+		pos[i] = -1;
+		if (!devs[i] || !devs[i]->link.ifindex ||
+		    !__ni_system_interfaces_delete_type(devs[i]->link.type)) {
+			results[i] = -NI_ERROR_DEVICE_NOT_COMPATIBLE;
+			continue;
+		}
+		results[i] = 0;
+		if (__ni_system_interfaces_delete_depth(nc, count, devs, depth, i) > max)
+			max = depth[i];
+	}
+
+	for (level = max; level > 0; --level) {
+		for (i = 0; i < count; ++i) {
+			if (results[i] < 0 || depth[i] != level)
+				continue;
+
+			ni_debug_ifconfig("%s: deleting %s interface", devs[i]->name,
+					ni_linktype_type_to_name(devs[i]->link.type));
+			if (!(msg = __ni_rtnl_link_delete_msg(devs[i])) ||
+			    (pos[i] = ni_nl_batch_add(batch, msg)) < 0) {
+				nlmsg_free(msg);
+				results[i] = -1;
+			}
+		}
+	}
+
+	ni_nl_batch_commit(batch);
+
+	for (i = 0; i < count; ++i) {
+		if (pos[i] >= 0) {
+			results[i] = ni_nl_batch_result(batch, pos[i]);
+			if (abs(results[i]) == NLE_NODEV)
+				results[i] = 0;
+
+			if (results[i]) {
+				ni_error("could not destroy %s interface %s: %s",
+					ni_linktype_type_to_name(devs[i]->link.type),
+					devs[i]->name, nl_geterror(results[i]));
+				results[i] = -1;
+			} else {
+				ni_client_state_drop(devs[i]->link.ifindex);
+			}
+		}
+		if (results[i] < 0)
+			failed++;
+	}
+
+	free(depth);
+	free(pos);
+	ni_nl_batch_free(batch);
+	return failed;
+}
+
+/*
+ * Create a set of vlan, macvlan or ipoib interfaces, sending the
+ * RTM_NEWLINK requests of all of them in one netlink batch.
+ */
+static int
+__ni_system_link_create_batch(ni_netconfig_t *nc, unsigned int count,
+		const ni_netdev_t **cfgs, ni_netdev_t **devs, int *results,
+		int (*check)(ni_netconfig_t *, const ni_netdev_t *, ni_netdev_t **))
+{
+	ni_nl_batch_t *batch;
+	struct nl_msg *msg;
+	unsigned int i, failed = 0;
+	int *pos;
+
+	if (!nc || !cfgs || !devs || !results)
+		return -1;
+
+	if (!(batch = ni_nl_batch_new()))
+		return -1;
+
+	pos = xcalloc(count ? count : 1, sizeof(*pos));
+	for (i = 0; i < count; ++i) {
+		pos[i] = -1;
+		devs[i] = NULL;
+		if ((results[i] = check(nc, cfgs[i], &devs[i])) < 0)
+			continue;
+
+		ni_debug_ifconfig("%s: creating %s interface", cfgs[i]->name,
+				ni_linktype_type_to_name(cfgs[i]->link.type));
+		if (!(msg = __ni_rtnl_link_create_msg(nc, cfgs[i])) ||
+		    (pos[i] = ni_nl_batch_add(batch, msg)) < 0) {
+			nlmsg_free(msg);
+			results[i] = -1;
+		}
+	}
+
+	ni_nl_batch_commit(batch);
+
+	for (i = 0; i < count; ++i) {
+		if (pos[i] >= 0) {
+			if ((results[i] = ni_nl_batch_result(batch, pos[i]))) {
+				ni_error("unable to create %s interface %s: %s",
+					ni_linktype_type_to_name(cfgs[i]->link.type),
+					cfgs[i]->name, nl_geterror(results[i]));
+			} else {
+				ni_debug_ifconfig("successfully created interface %s",
+						cfgs[i]->name);
+				results[i] = __ni_system_netdev_create(nc, cfgs[i]->name, 0,
+						cfgs[i]->link.type, &devs[i]);
+			}
+		}
+		if (results[i] < 0 && !devs[i])
+			failed++;
+	}
+
+	free(pos);
+	ni_nl_batch_free(batch);
+	return failed;
+}
+
+/*
+ * Create a VLAN interface
+ */
+static int
+__ni_system_vlan_check(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 						ni_netdev_t **dev_ret)
 {
 	ni_netdev_t *dev;
@@ -1043,6 +1247,17 @@ ni_system_vlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 		*dev_ret = dev;
 		return -NI_ERROR_DEVICE_EXISTS;
 	}
+	return 0;
+}
+
+int
+ni_system_vlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
+						ni_netdev_t **dev_ret)
+{
+	int rv;
+
+	if ((rv = __ni_system_vlan_check(nc, cfg, dev_ret)) < 0)
+		return rv;
 
 	ni_debug_ifconfig("%s: creating VLAN device", cfg->name);
 	if (__ni_rtnl_link_create(nc, cfg)) {
@@ -1053,6 +1268,19 @@ ni_system_vlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 	return __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_VLAN, dev_ret);
 }
 
+/*
+ * Create several VLAN interfaces at once; the results array
+ * receives the ni_system_vlan_create return code of each one.
+ * Returns the number of devices neither created nor found.
+ */
+int
+ni_system_vlan_create_batch(ni_netconfig_t *nc, unsigned int count,
+		const ni_netdev_t **cfgs, ni_netdev_t **devs, int *results)
+{
+	return __ni_system_link_create_batch(nc, count, cfgs, devs, results,
+						__ni_system_vlan_check);
+}
+
 int
 ni_system_vlan_change(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t *cfg)
 {
@@ -1075,8 +1303,8 @@ ni_system_vlan_delete(ni_netdev_t *dev)
 /*
  * Create/change/delete a vxlan interface
  */
-int
-ni_system_vxlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
+static int
+__ni_system_vxlan_check(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 						ni_netdev_t **dev_ret)
 {
 	ni_netdev_t *dev;
@@ -1101,6 +1329,18 @@ ni_system_vxlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 		}
 		return -NI_ERROR_DEVICE_EXISTS;
 	}
+	return 0;
+}
+
+int
+ni_system_vxlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
+						ni_netdev_t **dev_ret)
+{
+	const char *iftype;
+	int rv;
+
+	if ((rv = __ni_system_vxlan_check(nc, cfg, dev_ret)) < 0)
+		return rv;
 
 	iftype = ni_linktype_type_to_name(cfg->link.type);
 	ni_debug_ifconfig("%s: creating %s interface", cfg->name, iftype);
@@ -1113,12 +1353,147 @@ ni_system_vxlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 	return __ni_system_netdev_create(nc, cfg->name, 0, cfg->link.type, dev_ret);
 }
 
+/*
+ * Create several vxlan interfaces at once; the results array
+ * receives the ni_system_vxlan_create return code of each one.
+ * Returns the number of devices neither created nor found.
+ */
+int
+ni_system_vxlan_create_batch(ni_netconfig_t *nc, unsigned int count,
+		const ni_netdev_t **cfgs, ni_netdev_t **devs, int *results)
+{
+	return __ni_system_link_create_batch(nc, count, cfgs, devs, results,
+						__ni_system_vxlan_check);
+}
+
 int
 ni_system_vxlan_change(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t *cfg)
 {
 	return __ni_rtnl_link_change(nc, dev, cfg);
 }
 
+/*
+ * Add or delete forwarding database entries of a vxlan device,
+ * sending the RTM_NEWNEIGH/RTM_DELNEIGH requests in one batch.
+ * The all-zeros address entries (flood list) are appended, the
+ * unicast ones replace the remote of the address. An existing
+ * entry to add respectively a missed entry to delete is fine.
+ * The results array (optional) receives 0 or -1 per entry;
+ * returns the number of failed entries or -1 on error.
+ */
+static ni_bool_t
+__ni_rtnl_vxlan_fdb_flood(const ni_hwaddr_t *lladdr)
+{
+	unsigned char z = 0;
+	unsigned int i;
+
+	for (i = 0; i < lladdr->len; ++i)
+		z |= lladdr->data[i];
+	return z == 0x00;
+}
+
+static struct nl_msg *
+__ni_rtnl_vxlan_fdb_msg(const ni_netdev_t *dev, const ni_vxlan_fdb_entry_t *entry,
+			ni_bool_t add)
+{
+	struct nl_msg *msg;
+	struct ndmsg ndm;
+	int flags = 0;
+
+	if (add) {
+		flags = NLM_F_CREATE;
+		flags |= __ni_rtnl_vxlan_fdb_flood(&entry->lladdr) ?
+			NLM_F_APPEND : NLM_F_REPLACE;
+	}
+
+	memset(&ndm, 0, sizeof(ndm));
+	ndm.ndm_family	= AF_BRIDGE;
+	ndm.ndm_ifindex	= dev->link.ifindex;
+	ndm.ndm_state	= NUD_PERMANENT;
+	ndm.ndm_flags	= NTF_SELF;
+
+	if (!(msg = nlmsg_alloc_simple(add ? RTM_NEWNEIGH : RTM_DELNEIGH, flags)))
+		return NULL;
+
+	if (nlmsg_append(msg, &ndm, sizeof(ndm), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+
+	NLA_PUT(msg, NDA_LLADDR, entry->lladdr.len, entry->lladdr.data);
+	if (addattr_sockaddr(msg, NDA_DST, &entry->dst) < 0)
+		goto nla_put_failure;
+	if (entry->vni)
+		NLA_PUT_U32(msg, NDA_VNI, entry->vni);
+	if (entry->port)
+		NLA_PUT_U16(msg, NDA_PORT, htons(entry->port));
+
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+int
+ni_system_vxlan_fdb_update(ni_netconfig_t *nc, ni_netdev_t *dev,
+			const ni_vxlan_fdb_array_t *fdb, ni_bool_t add, int *results)
+{
+	const ni_vxlan_fdb_entry_t *entry;
+	ni_nl_batch_t *batch;
+	struct nl_msg *msg;
+	unsigned int i, failed = 0;
+	int *pos, err;
+
+	if (!nc || !dev || !fdb || !dev->link.ifindex ||
+	    dev->link.type != NI_IFTYPE_VXLAN)
+		return -1;
+
+	if (!fdb->count)
+		return 0;
+
+	if (!(batch = ni_nl_batch_new()))
+		return -1;
+
+	pos = xcalloc(fdb->count, sizeof(*pos));
+	for (i = 0; i < fdb->count; ++i) {
+		entry = &fdb->data[i];
+		if (!(msg = __ni_rtnl_vxlan_fdb_msg(dev, entry, add)) ||
+		    (pos[i] = ni_nl_batch_add(batch, msg)) < 0) {
+			ni_error("%s: unable to encode vxlan fdb entry %s",
+				dev->name, ni_link_address_print(&entry->lladdr));
+			nlmsg_free(msg);
+			pos[i] = -1;
+		}
+	}
+
+	ni_debug_ifconfig("%s: %s %u vxlan fdb entries", dev->name,
+			add ? "adding" : "deleting", ni_nl_batch_count(batch));
+	ni_nl_batch_commit(batch);
+
+	for (i = 0; i < fdb->count; ++i) {
+		entry = &fdb->data[i];
+		err = pos[i] < 0 ? -NLE_FAILURE : ni_nl_batch_result(batch, pos[i]);
+		if (add && abs(err) == NLE_EXIST)
+			err = 0;
+		if (!add && (abs(err) == NLE_OBJ_NOTFOUND || abs(err) == NLE_NOADDR))
+			err = 0;
+
+		if (err && pos[i] >= 0) {
+			ni_error("%s: unable to %s vxlan fdb entry %s dst %s: %s",
+				dev->name, add ? "add" : "delete",
+				ni_link_address_print(&entry->lladdr),
+				ni_sockaddr_print(&entry->dst), nl_geterror(err));
+		}
+		if (results)
+			results[i] = err ? -1 : 0;
+		if (err)
+			failed++;
+	}
+
+	free(pos);
+	ni_nl_batch_free(batch);
+	return failed;
+}
+
 int
 ni_system_vxlan_delete(ni_netdev_t *dev)
 {
@@ -1133,12 +1508,11 @@ ni_system_vxlan_delete(ni_netdev_t *dev)
 /*
  * Create a macvlan/macvtap interface
  */
-int
-ni_system_macvlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
+static int
+__ni_system_macvlan_check(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 						ni_netdev_t **dev_ret)
 {
 	ni_netdev_t *dev;
-	const char *cfg_iftype = NULL;
 
 	if (!nc || !dev_ret || !cfg || !cfg->name || !cfg->macvlan
 	||  !cfg->link.lowerdev.name || !cfg->link.lowerdev.index)
@@ -1160,6 +1534,18 @@ ni_system_macvlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 		}
 		return -NI_ERROR_DEVICE_EXISTS;
 	}
+	return 0;
+}
+
+int
+ni_system_macvlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
+						ni_netdev_t **dev_ret)
+{
+	const char *cfg_iftype = NULL;
+	int rv;
+
+	if ((rv = __ni_system_macvlan_check(nc, cfg, dev_ret)) < 0)
+		return rv;
 
 	cfg_iftype = ni_linktype_type_to_name(cfg->link.type);
 	ni_debug_ifconfig("%s: creating %s interface", cfg->name, cfg_iftype);
@@ -1173,6 +1559,14 @@ ni_system_macvlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 	return __ni_system_netdev_create(nc, cfg->name, 0, cfg->link.type, dev_ret);
 }
 
+int
+ni_system_macvlan_create_batch(ni_netconfig_t *nc, unsigned int count,
+		const ni_netdev_t **cfgs, ni_netdev_t **devs, int *results)
+{
+	return __ni_system_link_create_batch(nc, count, cfgs, devs, results,
+						__ni_system_macvlan_check);
+}
+
 int
 ni_system_macvlan_change(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t *cfg)
 {
@@ -1278,29 +1672,110 @@ __ni_system_infiniband_setup(const char *ifname, unsigned int mode, unsigned int
 	return ret;
 }
 
-int
-ni_system_infiniband_setup(ni_netconfig_t *nc, ni_netdev_t *dev,
-				const ni_netdev_t *cfg)
+static const ni_infiniband_t *
+__ni_system_infiniband_setup_check(const ni_netdev_t *dev, const ni_netdev_t *cfg)
 {
-	ni_infiniband_t *ib;
-
-	if (!cfg || !(ib = cfg->infiniband)) {
+	if (!cfg || !cfg->infiniband) {
 		ni_error("Cannot setup infiniband interface without config");
-		return -1;
+		return NULL;
 	}
 	if (!dev || !dev->name) {
 		ni_error("Cannot setup infiniband interface without name");
-		return -1;
+		return NULL;
 	}
 	if (dev->link.type != NI_IFTYPE_INFINIBAND &&
 	    dev->link.type != NI_IFTYPE_INFINIBAND_CHILD) {
 		ni_error("%s: %s is not infiniband interface", __func__, dev->name);
-		return -1;
+		return NULL;
 	}
+	return cfg->infiniband;
+}
+
+int
+ni_system_infiniband_setup(ni_netconfig_t *nc, ni_netdev_t *dev,
+				const ni_netdev_t *cfg)
+{
+	const ni_infiniband_t *ib;
+
+	if (!(ib = __ni_system_infiniband_setup_check(dev, cfg)))
+		return -1;
 
 	return __ni_system_infiniband_setup(dev->name, ib->mode, ib->umcast);
 }
 
+/*
+ * Setup infiniband interface in a worker thread: the connection mode
+ * change flushes the IPoIB paths and blocks for a while.  Returns 1
+ * when the done function will be called, 0 when the setup has been
+ * applied inline (no worker pool running) and -1 on invalid config.
+ */
+typedef struct ni_system_infiniband_setup_job {
+	unsigned int				umcast;
+	ni_system_infiniband_setup_done_t *	done;
+	void *					user_data;
+} ni_system_infiniband_setup_job_t;
+
+static void
+__ni_system_infiniband_setup_done(void *user_data, const char *ifname,
+				const ni_var_array_t *attrs, const int *errors)
+{
+	ni_system_infiniband_setup_job_t *job = user_data;
+	const ni_var_t *var;
+	unsigned int i;
+
+	for (i = 0; i < attrs->count; ++i) {
+		var = &attrs->data[i];
+		if (!errors[i])
+			continue;
+
+		if (ni_string_eq(var->name, "mode")) {
+			ni_error("%s: Cannot set infiniband IPoIB connection-mode '%s': %s",
+				ifname, var->value, strerror(errors[i]));
+		} else {
+			ni_error("%s: Cannot set infiniband IPoIB user-multicast '%s' (%u): %s",
+				ifname, ni_infiniband_get_umcast_name(job->umcast),
+				job->umcast, strerror(errors[i]));
+		}
+	}
+
+	job->done(job->user_data, 0);
+	free(job);
+}
+
+int
+ni_system_infiniband_setup_async(ni_netconfig_t *nc, ni_netdev_t *dev,
+				const ni_netdev_t *cfg,
+				ni_system_infiniband_setup_done_t *done,
+				void *user_data)
+{
+	ni_system_infiniband_setup_job_t *job;
+	ni_var_array_t attrs = NI_VAR_ARRAY_INIT;
+	const ni_infiniband_t *ib;
+	const char *mstr;
+	int ret = 1;
+
+	if (!(ib = __ni_system_infiniband_setup_check(dev, cfg)))
+		return -1;
+
+	if ((mstr = ni_infiniband_get_mode_name(ib->mode)))
+		ni_var_array_append(&attrs, "mode", mstr);
+	if (ib->umcast == 0 || ib->umcast == 1)
+		ni_var_array_set_uint(&attrs, "umcast", ib->umcast);
+
+	job = xcalloc(1, sizeof(*job));
+	job->umcast = ib->umcast;
+	job->done = done;
+	job->user_data = user_data;
+
+	if (!done || !ni_sysfs_netif_put_attrs_async(dev->name, &attrs,
+				__ni_system_infiniband_setup_done, job)) {
+		free(job);
+		ret = __ni_system_infiniband_setup(dev->name, ib->mode, ib->umcast);
+	}
+	ni_var_array_destroy(&attrs);
+	return ret;
+}
+
 /*
  * Create infinband child interface
  */
@@ -1364,6 +1839,47 @@ ni_system_infiniband_child_create(ni_netconfig_t *nc,
 	return __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_INFINIBAND_CHILD, dev_ret);
 }
 
+static int
+__ni_system_infiniband_child_check(ni_netconfig_t *nc, const ni_netdev_t *cfg,
+						ni_netdev_t **dev_ret)
+{
+	ni_netdev_t *dev;
+
+	if (!nc || !dev_ret || !cfg || ni_string_empty(cfg->name) || !cfg->infiniband)
+		return -1;
+
+	*dev_ret = NULL;
+
+	if (!(dev = ni_netdev_by_name(nc, cfg->link.lowerdev.name)) ||
+	    dev->link.type != NI_IFTYPE_INFINIBAND) {
+		ni_error("%s: Invalid parent reference in infiniband child config",
+			cfg->name);
+		return -1;
+	}
+
+	if ((dev = ni_netdev_by_name(nc, cfg->name))) {
+		/* This is not necessarily an error */
+
+		*dev_ret = dev;
+		return -NI_ERROR_DEVICE_EXISTS;
+	}
+	return 0;
+}
+
+/*
+ * Create several infiniband child interfaces at once via rtnetlink,
+ * with the final name and the IPoIB mode and umcast settings, instead
+ * to write create_child and to wait for each device to appear.
+ * Returns the number of devices neither created nor found.
+ */
+int
+ni_system_infiniband_child_create_batch(ni_netconfig_t *nc, unsigned int count,
+		const ni_netdev_t **cfgs, ni_netdev_t **devs, int *results)
+{
+	return __ni_system_link_create_batch(nc, count, cfgs, devs, results,
+						__ni_system_infiniband_child_check);
+}
+
 /*
  * Delete infinband child interface
  */
@@ -1393,6 +1909,7 @@ int
 ni_system_bridge_create(ni_netconfig_t *nc, const char *ifname,
 			const ni_bridge_t *cfg_bridge, ni_netdev_t **dev_ret)
 {
+	struct nl_msg *msg;
 	ni_netdev_t *dev;
 
 	*dev_ret = NULL;
@@ -1403,6 +1920,14 @@ ni_system_bridge_create(ni_netconfig_t *nc, const char *ifname,
 	}
 
 	ni_debug_ifconfig("%s: creating bridge interface", ifname);
+	if ((msg = __ni_rtnl_link_bridge_msg(ifname, 0, cfg_bridge)) &&
+	    ni_nl_talk(msg, NULL) == 0) {
+		nlmsg_free(msg);
+		return __ni_system_netdev_create(nc, ifname, 0, NI_IFTYPE_BRIDGE, dev_ret);
+	}
+	nlmsg_free(msg);
+
+	/* kernel without the bridge rtnl link ops */
 	if (__ni_brioctl_add_bridge(ifname) < 0) {
 		ni_error("__ni_brioctl_add_bridge(%s) failed", ifname);
 		return -1;
@@ -1417,17 +1942,27 @@ ni_system_bridge_create(ni_netconfig_t *nc, const char *ifname,
 int
 ni_system_bridge_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_bridge_t *bcfg /*, ni_bool_t add_only */)
 {
+	struct nl_msg *msg;
+	int rv;
+
 	if (dev->link.type != NI_IFTYPE_BRIDGE) {
 		ni_error("%s: %s is not a bridge interface", __func__, dev->name);
 		return -1;
 	}
 
-	if (ni_sysfs_bridge_update_config(dev->name, bcfg) < 0) {
+	if (!(msg = __ni_rtnl_link_bridge_msg(dev->name, dev->link.ifindex, bcfg)))
+		rv = -1;
+	else
+		rv = ni_nl_talk(msg, NULL);
+	nlmsg_free(msg);
+
+	if (rv && ni_sysfs_bridge_update_config(dev->name, bcfg) < 0) {
 		ni_error("%s: failed to update sysfs attributes for %s", __func__, dev->name);
 		return -1;
 	}
 
-	/* port enslave themself on linkUp() */
+	/* port enslave themself on linkUp(), update the enslaved ones */
+	ni_system_bridge_update_ports(nc, dev, bcfg);
 
 	return 0;
 }
@@ -1462,16 +1997,22 @@ ni_system_bridge_delete(ni_netconfig_t *nc, ni_netdev_t *dev)
 	return 0;
 }
 
+static inline ni_bool_t
+__ni_system_bridge_port_has_options(const ni_bridge_port_t *port)
+{
+	return port->priority != NI_BRIDGE_VALUE_NOT_SET ||
+		port->path_cost != NI_BRIDGE_VALUE_NOT_SET;
+}
+
 /*
- * Add a port to a bridge interface
+ * Check a port to add to a bridge interface: returns 0 when it has
+ * to be enslaved, 1 when it is a port of the bridge already.
  */
-int
-ni_system_bridge_add_port(ni_netconfig_t *nc, ni_netdev_t *brdev, const ni_bridge_port_t *port)
+static int
+__ni_system_bridge_port_check(ni_netconfig_t *nc, ni_netdev_t *brdev,
+		const ni_bridge_port_t *port, ni_netdev_t **pif_ret)
 {
-	ni_bridge_t *bridge = ni_netdev_get_bridge(brdev);
 	ni_netdev_t *pif = NULL;
-	ni_bridge_port_t *new_port;
-	int rv;
 
 	if (port->ifindex)
 		pif = ni_netdev_by_index(nc, port->ifindex);
@@ -1510,21 +2051,17 @@ ni_system_bridge_add_port(ni_netconfig_t *nc, ni_netdev_t *brdev, const ni_bridg
 		return -NI_ERROR_DEVICE_BAD_HIERARCHY;
 	}
 
-	if (pif->link.masterdev.index &&
-			pif->link.masterdev.index == brdev->link.ifindex) {
-		/* already a port of this bridge -- make sure the device is up */
-		if (!ni_netdev_device_is_up(pif) && __ni_rtnl_link_up(pif, NULL) < 0) {
-			ni_warn("%s: Cannot set up link on bridge port %s",
-				brdev->name, pif->name);
-		}
-		return 0; /* part of the bridge and hopefully up now */
-	}
+	*pif_ret = pif;
+	return pif->link.masterdev.index ? 1 : 0;
+}
 
-	if (__ni_rtnl_link_add_port_up(pif, brdev->name, brdev->link.ifindex) == 0) {
-		ni_netdev_ref_set(&pif->link.masterdev, brdev->name,
-				brdev->link.ifindex);
-		return 0;
-	}
+/*
+ * Add a port using the bridge ioctl and sysfs as fallback
+ */
+static int
+__ni_system_bridge_add_port_ioctl(ni_netdev_t *brdev, ni_netdev_t *pif)
+{
+	int rv;
 
 	if (!ni_netdev_device_is_up(pif) && __ni_rtnl_link_up(pif, NULL) < 0) {
 		ni_warn("%s: Cannot set up link on bridge port %s",
@@ -1536,15 +2073,22 @@ ni_system_bridge_add_port(ni_netconfig_t *nc, ni_netdev_t *brdev, const ni_bridg
 				ni_strerror(rv));
 		return rv;
 	}
+	return 0;
+}
 
-	/* Now configure the newly added port */
-	if ((rv = ni_sysfs_bridge_port_update_config(pif->name, port)) < 0) {
-		ni_error("%s: failed to configure port %s: %s",
-			brdev->name, pif->name, ni_strerror(rv));
-		return rv;
-	}
+static void
+__ni_system_bridge_port_track(ni_netdev_t *brdev, ni_netdev_t *pif,
+		const ni_bridge_port_t *port)
+{
+	ni_bridge_t *bridge = ni_netdev_get_bridge(brdev);
+	ni_bridge_port_t *new_port;
+
+	ni_netdev_ref_set(&pif->link.masterdev, brdev->name, brdev->link.ifindex);
 
 	/* when this fails, next event will update/add it... */
+	if (ni_bridge_port_by_index(bridge, pif->link.ifindex))
+		return;
+
 	new_port = ni_bridge_port_clone(port);
 	new_port->ifindex = pif->link.ifindex;
 	if (!ni_string_eq(new_port->ifname, pif->name))
@@ -1552,7 +2096,224 @@ ni_system_bridge_add_port(ni_netconfig_t *nc, ni_netdev_t *brdev, const ni_bridg
 
 	if (!ni_bridge_add_port(bridge, new_port))
 		ni_bridge_port_free(new_port);
-	return 0;
+}
+
+/*
+ * Add the requests replacing the VLANs of a port to the batch and
+ * return the batch index of the one adding the configured VLANs.
+ */
+static int
+__ni_system_bridge_port_vlans_batch(ni_nl_batch_t *batch, const ni_netdev_t *pif,
+		const ni_bridge_port_t *port)
+{
+	struct nl_msg *msg;
+	int pos;
+
+	/* the kernel adds the default pvid on enslave, drop it too */
+	if (!(msg = __ni_rtnl_link_bridge_vlan_msg(pif, port, RTM_DELLINK)) ||
+	    ni_nl_batch_add(batch, msg) < 0) {
+		nlmsg_free(msg);
+		return -1;
+	}
+	if (!(msg = __ni_rtnl_link_bridge_vlan_msg(pif, port, RTM_SETLINK)) ||
+	    (pos = ni_nl_batch_add(batch, msg)) < 0) {
+		nlmsg_free(msg);
+		return -1;
+	}
+	return pos;
+}
+
+static int
+__ni_system_bridge_port_vlans_apply(const ni_netdev_t *pif, const ni_bridge_port_t *port)
+{
+	ni_nl_batch_t *batch;
+	int pos, rv = -1;
+
+	if (!(batch = ni_nl_batch_new()))
+		return -1;
+
+	if ((pos = __ni_system_bridge_port_vlans_batch(batch, pif, port)) >= 0 &&
+	    ni_nl_batch_commit(batch) >= 0)
+		rv = ni_nl_batch_result(batch, pos);
+
+	ni_nl_batch_free(batch);
+	return rv;
+}
+
+/*
+ * Add a set of ports to a bridge interface, sending the enslave
+ * and the port option requests of all of them in one netlink batch.
+ * Returns the number of ports failed to add, results[i] is set to
+ * the result of the i-th port.
+ */
+int
+ni_system_bridge_add_ports(ni_netconfig_t *nc, ni_netdev_t *brdev, unsigned int count,
+		const ni_bridge_port_t **ports, int *results)
+{
+	ni_netdev_t **pifs;
+	ni_nl_batch_t *batch;
+	struct nl_msg *msg;
+	unsigned int i, failed = 0;
+	int *enslave, *options, *vlans;
+
+	if (!nc || !brdev || !ports || !results)
+		return -1;
+
+	if (!(batch = ni_nl_batch_new()))
+		return -1;
+
+	pifs = xcalloc(count ? count : 1, sizeof(*pifs));
+	enslave = xcalloc(count ? count : 1, sizeof(*enslave));
+	options = xcalloc(count ? count : 1, sizeof(*options));
+	vlans = xcalloc(count ? count : 1, sizeof(*vlans));
+	for (i = 0; i < count; ++i) {
+		enslave[i] = options[i] = vlans[i] = -1;
+		if ((results[i] = __ni_system_bridge_port_check(nc, brdev, ports[i], &pifs[i])) < 0)
+			continue;
+
+		if (results[i] == 0 || !ni_netdev_device_is_up(pifs[i])) {
+			/* enslave or (already a port) make sure the device is up */
+			if (!(msg = __ni_rtnl_link_add_port_msg(pifs[i], brdev->link.ifindex)) ||
+			    (enslave[i] = ni_nl_batch_add(batch, msg)) < 0) {
+				nlmsg_free(msg);
+				enslave[i] = -1;
+			}
+		}
+		if (__ni_system_bridge_port_has_options(ports[i])) {
+			if (!(msg = __ni_rtnl_link_bridge_port_msg(pifs[i], ports[i])) ||
+			    (options[i] = ni_nl_batch_add(batch, msg)) < 0) {
+				nlmsg_free(msg);
+				options[i] = -1;
+			}
+		}
+		if (ports[i]->vlans.count)
+			vlans[i] = __ni_system_bridge_port_vlans_batch(batch, pifs[i], ports[i]);
+	}
+
+	if (ni_nl_batch_count(batch))
+		ni_nl_batch_commit(batch);
+
+	for (i = 0; i < count; ++i) {
+		ni_bool_t member = results[i] == 1;
+
+		if (results[i] < 0) {
+			failed++;
+			continue;
+		}
+
+		results[i] = 0;
+		if (member) {
+			if (enslave[i] >= 0 && ni_nl_batch_result(batch, enslave[i]))
+				ni_warn("%s: Cannot set up link on bridge port %s",
+					brdev->name, pifs[i]->name);
+		} else
+		if (enslave[i] >= 0 && !ni_nl_batch_result(batch, enslave[i])) {
+			ni_debug_ifconfig("successfully added port %s into master %s",
+					pifs[i]->name, brdev->name);
+		} else
+		if ((results[i] = __ni_system_bridge_add_port_ioctl(brdev, pifs[i])) < 0) {
+			failed++;
+			continue;
+		}
+
+		/* options sent before the ioctl enslave are rejected */
+		if (__ni_system_bridge_port_has_options(ports[i]) &&
+		    (options[i] < 0 || ni_nl_batch_result(batch, options[i])) &&
+		    (results[i] = ni_sysfs_bridge_port_update_config(pifs[i]->name, ports[i])) < 0) {
+			ni_error("%s: failed to configure port %s: %s",
+				brdev->name, pifs[i]->name, ni_strerror(results[i]));
+			failed++;
+			continue;
+		}
+
+		if (ports[i]->vlans.count &&
+		    (vlans[i] < 0 || ni_nl_batch_result(batch, vlans[i])) &&
+		    (results[i] = __ni_system_bridge_port_vlans_apply(pifs[i], ports[i])) < 0) {
+			ni_error("%s: failed to configure vlans of port %s: %s",
+				brdev->name, pifs[i]->name, nl_geterror(results[i]));
+			failed++;
+			continue;
+		}
+
+		__ni_system_bridge_port_track(brdev, pifs[i], ports[i]);
+	}
+
+	free(vlans);
+	free(options);
+	free(enslave);
+	free(pifs);
+	ni_nl_batch_free(batch);
+	return failed;
+}
+
+/*
+ * Add a port to a bridge interface
+ */
+int
+ni_system_bridge_add_port(ni_netconfig_t *nc, ni_netdev_t *brdev, const ni_bridge_port_t *port)
+{
+	int result = -1;
+
+	if (!port || ni_system_bridge_add_ports(nc, brdev, 1, &port, &result) < 0)
+		return -1;
+
+	return result;
+}
+
+/*
+ * Apply the configured port options to the ports already enslaved
+ * into the bridge, with one netlink request per port in one batch.
+ */
+int
+ni_system_bridge_update_ports(ni_netconfig_t *nc, ni_netdev_t *brdev, const ni_bridge_t *bcfg)
+{
+	const ni_bridge_port_t *port;
+	ni_nl_batch_t *batch;
+	struct nl_msg *msg;
+	ni_netdev_t *pif;
+	unsigned int i;
+	int rv;
+
+	if (!nc || !brdev || !bcfg || !bcfg->ports.count)
+		return 0;
+
+	if (!(batch = ni_nl_batch_new()))
+		return -1;
+
+	for (i = 0; i < bcfg->ports.count; ++i) {
+		port = bcfg->ports.data[i];
+		if (!__ni_system_bridge_port_has_options(port) && !port->vlans.count)
+			continue;
+
+		if (port->ifindex)
+			pif = ni_netdev_by_index(nc, port->ifindex);
+		else
+			pif = ni_netdev_by_name(nc, port->ifname);
+		if (!pif || pif->link.masterdev.index != brdev->link.ifindex)
+			continue;
+
+		if (__ni_system_bridge_port_has_options(port) &&
+		    (!(msg = __ni_rtnl_link_bridge_port_msg(pif, port)) ||
+		     ni_nl_batch_add(batch, msg) < 0))
+			nlmsg_free(msg);
+
+		if (port->vlans.count)
+			__ni_system_bridge_port_vlans_batch(batch, pif, port);
+	}
+
+	if (!ni_nl_batch_count(batch)) {
+		ni_nl_batch_free(batch);
+		return 0;
+	}
+
+	if ((rv = ni_nl_batch_commit(batch)) != 0) {
+		ni_error("%s: failed to configure %d of %u ports", brdev->name,
+				rv < 0 ? (int)ni_nl_batch_count(batch) : rv,
+				ni_nl_batch_count(batch));
+		rv = -1;
+	}
+	ni_nl_batch_free(batch);
+	return rv;
 }
 
 /*
@@ -1816,8 +2577,8 @@ ni_system_bond_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t *cf
 /*
  * Shutdown a bonding device
  */
-int
-ni_system_bond_shutdown(ni_netdev_t *dev)
+static int
+ni_system_bond_shutdown_sysfs(ni_netdev_t *dev)
 {
 	ni_string_array_t list = NI_STRING_ARRAY_INIT;
 	unsigned int i;
@@ -1836,17 +2597,79 @@ cleanup:
 	return rv;
 }
 
+static int
+ni_system_bond_shutdown_netlink(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	ni_netdev_t *port;
+	ni_nl_batch_t *batch;
+	struct nl_msg *msg;
+	int rv;
+
+	/* release all slaves in one batch */
+	batch = ni_nl_batch_new();
+	for (port = ni_netconfig_devlist(nc); port; port = port->next) {
+		if (port->link.masterdev.index != dev->link.ifindex)
+			continue;
+
+		if (!(msg = __ni_rtnl_link_unenslave_msg(port))) {
+			ni_error("%s: failed to encode netlink message to release slave %s",
+					dev->name, port->name);
+			ni_nl_batch_free(batch);
+			return -1;
+		}
+		ni_nl_batch_add(batch, msg);
+	}
+
+	if ((rv = ni_nl_batch_commit(batch)) != 0) {
+		ni_error("%s: failed to release %d of %u slaves", dev->name,
+				rv < 0 ? (int)ni_nl_batch_count(batch) : rv,
+				ni_nl_batch_count(batch));
+		rv = -1;
+	}
+	ni_nl_batch_free(batch);
+	return rv;
+}
+
+int
+ni_system_bond_shutdown(ni_netdev_t *dev)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+
+	if (!dev || !nc)
+		return -1;
+
+	switch (ni_config_bonding_ctl()) {
+	case NI_CONFIG_BONDING_CTL_SYSFS:
+		return ni_system_bond_shutdown_sysfs(dev);
+
+	case NI_CONFIG_BONDING_CTL_NETLINK:
+	default:
+		return ni_system_bond_shutdown_netlink(nc, dev);
+	}
+}
+
 /*
  * Delete a bonding device
  */
 int
 ni_system_bond_delete(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
-	if (ni_sysfs_bonding_delete_master(dev->name) < 0) {
-		ni_error("could not destroy bonding interface %s", dev->name);
-		return -1;
+	switch (ni_config_bonding_ctl()) {
+	case NI_CONFIG_BONDING_CTL_SYSFS:
+		if (ni_sysfs_bonding_delete_master(dev->name) < 0) {
+			ni_error("could not destroy bonding interface %s", dev->name);
+			return -1;
+		}
+		return 0;
+
+	case NI_CONFIG_BONDING_CTL_NETLINK:
+	default:
+		if (__ni_rtnl_link_delete(dev) < 0) {
+			ni_error("could not destroy bonding interface %s", dev->name);
+			return -1;
+		}
+		return 0;
 	}
-	return 0;
 }
 
 /*
@@ -2140,6 +2963,8 @@ ni_system_ppp_delete(ni_netconfig_t *nc, ni_netdev_t *dev)
 static int
 __ni_system_tunnel_load_modules(unsigned int type)
 {
+	ni_string_array_t modules = NI_STRING_ARRAY_INIT;
+	char *names = NULL;
 	int mod_load_ret = 0;
 
 	/* Modules may need to be loaded (if support not compiled directly into
@@ -2150,43 +2975,32 @@ __ni_system_tunnel_load_modules(unsigned int type)
 	 */
 	switch (type) {
 	case NI_IFTYPE_GRE:
-		if (ni_modprobe(GRE_TUNNEL_MODULE_NAME, NULL) < 0) {
-			ni_error("failed to load %s module",
-				GRE_TUNNEL_MODULE_NAME);
-			mod_load_ret = -1;
-		}
+		ni_string_array_append(&modules, GRE_TUNNEL_MODULE_NAME);
 		break;
 
 	case NI_IFTYPE_SIT:
-		if (ni_modprobe(TUNNEL4_MODULE_NAME, NULL) < 0) {
-			ni_error("failed to load %s module",
-				TUNNEL4_MODULE_NAME);
-			mod_load_ret = -1;
-		}
-		if (ni_modprobe(SIT_TUNNEL_MODULE_NAME, NULL) < 0) {
-			ni_error("failed to load %s module",
-				SIT_TUNNEL_MODULE_NAME);
-			mod_load_ret = -1;
-		}
+		ni_string_array_append(&modules, TUNNEL4_MODULE_NAME);
+		ni_string_array_append(&modules, SIT_TUNNEL_MODULE_NAME);
 		break;
 
 	case NI_IFTYPE_IPIP:
-		if (ni_modprobe(TUNNEL4_MODULE_NAME, NULL) < 0) {
-			ni_error("failed to load %s module",
-				TUNNEL4_MODULE_NAME);
-			mod_load_ret = -1;
-		}
-		if (ni_modprobe(IPIP_TUNNEL_MODULE_NAME, NULL) < 0) {
-			ni_error("failed to load %s module",
-				IPIP_TUNNEL_MODULE_NAME);
-			mod_load_ret = -1;
-		}
+		ni_string_array_append(&modules, TUNNEL4_MODULE_NAME);
+		ni_string_array_append(&modules, IPIP_TUNNEL_MODULE_NAME);
 		break;
 
 	default:
 		break;
 	}
 
+	/* load them in one modprobe run */
+	if (modules.count && ni_modprobe_all(&modules) < 0) {
+		ni_error("failed to load %s module(s)",
+			ni_string_join(&names, &modules, ", "));
+		mod_load_ret = -1;
+	}
+	ni_string_array_destroy(&modules);
+	ni_string_free(&names);
+
 	return mod_load_ret;
 }
 
@@ -2276,23 +3090,48 @@ ni_system_ipv4_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_ipv4_devconf
 int
 ni_system_ipv6_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_ipv6_devconf_t *ipv6)
 {
-	int brought_up = 0;
-	int rv = -1;
-
-	/* You can confuse the kernel IPv6 code to a degree that it will
-	 * remove /proc/sys/ipv6/conf/<ifname> completely. dhcpcd in particular
-	 * seems rather good at that.
-	 * The only way to recover from that is by upping the interface briefly.
-	 */
-	if (ni_ipv6_supported() && !ni_sysctl_ipv6_ifconfig_is_present(dev->name)) {
-		if (__ni_rtnl_link_up(dev, NULL) >= 0) {
-			unsigned int count = 100;
+	ni_bool_t brought_up;
+	unsigned int count = 100;
 
-			while (count-- && !ni_sysctl_ipv6_ifconfig_is_present(dev->name))
-				usleep(100000);
-			brought_up = 1;
-		}
+	if ((brought_up = ni_system_ipv6_setup_prepare(nc, dev))) {
+		while (count-- && !ni_system_ipv6_setup_ready(dev))
+			usleep(100000);
 	}
+	return ni_system_ipv6_setup_finish(nc, dev, ipv6, brought_up);
+}
+
+/*
+ * You can confuse the kernel IPv6 code to a degree that it will
+ * remove /proc/sys/ipv6/conf/<ifname> completely. dhcpcd in particular
+ * seems rather good at that.
+ * The only way to recover from that is by upping the interface briefly,
+ * which returns TRUE here: the caller waits until the setup is ready
+ * (up to 10 sec) and passes it to ni_system_ipv6_setup_finish then.
+ */
+ni_bool_t
+ni_system_ipv6_setup_prepare(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	(void)nc;
+
+	if (!ni_ipv6_supported() || ni_system_ipv6_setup_ready(dev))
+		return FALSE;
+
+	return __ni_rtnl_link_up(dev, NULL) >= 0;
+}
+
+ni_bool_t
+ni_system_ipv6_setup_ready(const ni_netdev_t *dev)
+{
+	return ni_sysctl_ipv6_ifconfig_is_present(dev->name);
+}
+
+int
+ni_system_ipv6_setup_finish(ni_netconfig_t *nc, ni_netdev_t *dev,
+			const ni_ipv6_devconf_t *ipv6, ni_bool_t brought_up)
+{
+	int rv;
+
+	(void)nc;
 
 	rv = ni_system_ipv6_devinfo_set(dev, ipv6);
 
@@ -3568,14 +4407,66 @@ nla_put_failure:
 }
 
 static int
-__ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg)
+__ni_rtnl_link_put_ipoib(ni_netconfig_t *nc, struct nl_msg *msg, const ni_netdev_t *cfg)
+{
+	const ni_infiniband_t *ib = cfg->infiniband;
+	unsigned int ifindex = cfg->link.lowerdev.index;
+	struct nlattr *linkinfo;
+	struct nlattr *infodata;
+	ni_netdev_t *parent;
+
+	if (!ib || ni_string_empty(cfg->link.lowerdev.name))
+		return -1;
+
+	if (!ifindex && (parent = ni_netdev_by_name(nc, cfg->link.lowerdev.name)))
+		ifindex = parent->link.ifindex;
+	if (!ifindex)
+		return -1;
+
+	/* IPoIB:
+	 *  INFO_KIND must be "ipoib"
+	 *  INFO_DATA must contain the PKEY, MODE and UMCAST are optional
+	 *  LINK must contain the link ID of the parent ipoib device
+	 */
+	ni_debug_ifconfig("%s(%s, ipoib, 0x%04x, %s[%u])",
+			__func__, cfg->name, ib->pkey,
+			cfg->link.lowerdev.name, ifindex);
+
+	if (!(linkinfo = nla_nest_start(msg, IFLA_LINKINFO)))
+		return -1;
+	NLA_PUT_STRING(msg, IFLA_INFO_KIND, "ipoib");
+
+	if (!(infodata = nla_nest_start(msg, IFLA_INFO_DATA)))
+		return -1;
+
+	NLA_PUT_U16(msg, IFLA_IPOIB_PKEY, ib->pkey);
+	if (ib->mode == NI_INFINIBAND_MODE_DATAGRAM ||
+	    ib->mode == NI_INFINIBAND_MODE_CONNECTED)
+		NLA_PUT_U16(msg, IFLA_IPOIB_MODE, ib->mode);
+	if (ib->umcast == NI_INFINIBAND_UMCAST_DISALLOWED ||
+	    ib->umcast == NI_INFINIBAND_UMCAST_ALLOWED)
+		NLA_PUT_U16(msg, IFLA_IPOIB_UMCAST, ib->umcast);
+
+	nla_nest_end(msg, infodata);
+	nla_nest_end(msg, linkinfo);
+
+	/* Note, IFLA_LINK must be outside of IFLA_LINKINFO */
+	NLA_PUT_U32(msg, IFLA_LINK, ifindex);
+
+	return 0;
+
+nla_put_failure:
+	return -1;
+}
+
+static struct nl_msg *
+__ni_rtnl_link_create_msg(ni_netconfig_t *nc, const ni_netdev_t *cfg)
 {
 	struct ifinfomsg ifi;
 	struct nl_msg *msg;
-	int err = -1;
 
 	if (!nc || !cfg || ni_string_empty(cfg->name))
-		return -1;
+		return NULL;
 
 	memset(&ifi, 0, sizeof(ifi));
 	ifi.ifi_family = AF_UNSPEC;
@@ -3605,6 +4496,11 @@ __ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg)
 			goto nla_put_failure;
 		break;
 
+	case NI_IFTYPE_INFINIBAND_CHILD:
+		if (__ni_rtnl_link_put_ipoib(nc, msg, cfg) < 0)
+			goto nla_put_failure;
+		break;
+
 	case NI_IFTYPE_MACVLAN:
 	case NI_IFTYPE_MACVTAP:
 		if (__ni_rtnl_link_put_macvlan(msg, cfg) < 0)
@@ -3656,17 +4552,28 @@ __ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg)
 		goto failed;
 	}
 
-	/* Actually capture the netlink -error code for use by callers. */
-	if ((err = ni_nl_talk(msg, NULL)))
-		goto failed;
-
-	ni_debug_ifconfig("successfully created interface %s", cfg->name);
-	nlmsg_free(msg);
-	return 0;
+	return msg;
 
 nla_put_failure:
 	ni_error("failed to encode netlink message to create %s", cfg->name);
 failed:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static int
+__ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg)
+{
+	struct nl_msg *msg;
+	int err;
+
+	if (!(msg = __ni_rtnl_link_create_msg(nc, cfg)))
+		return -1;
+
+	/* Actually capture the netlink -error code for use by callers. */
+	if ((err = ni_nl_talk(msg, NULL)) == 0)
+		ni_debug_ifconfig("successfully created interface %s", cfg->name);
+
 	nlmsg_free(msg);
 	return err;
 }
@@ -3911,6 +4818,32 @@ __ni_rtnl_link_down(const ni_netdev_t *dev)
 	return __ni_rtnl_simple(RTM_NEWLINK, 0, &ifi, sizeof(ifi));
 }
 
+/*
+ * Build a request to delete the interface
+ */
+static struct nl_msg *
+__ni_rtnl_link_delete_msg(const ni_netdev_t *dev)
+{
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+	int rv;
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_index = dev->link.ifindex;
+	ifi.ifi_change = IFF_UP;
+
+	if (!(msg = nlmsg_alloc_simple(RTM_DELLINK, 0)))
+		return NULL;
+
+	if ((rv = nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO))) {
+		ni_error("%s: nlmsg_append failed: %s", __func__,  nl_geterror(rv));
+		nlmsg_free(msg);
+		return NULL;
+	}
+	return msg;
+}
+
 /*
  * Delete the interface
  */
@@ -3936,17 +4869,13 @@ __ni_rtnl_link_delete(const ni_netdev_t *dev)
 }
 
 /*
- * Set the interface link down and unenslave from master
+ * Build a request to set the interface link down and unenslave it
  */
-int
-__ni_rtnl_link_unenslave(const ni_netdev_t *dev)
+static struct nl_msg *
+__ni_rtnl_link_unenslave_msg(const ni_netdev_t *dev)
 {
 	struct ifinfomsg ifi;
 	struct nl_msg *msg;
-	int err = 0;
-
-	if (!dev->link.masterdev.index)
-		return __ni_rtnl_link_down(dev);
 
 	memset(&ifi, 0, sizeof(ifi));
 	ifi.ifi_family = AF_UNSPEC;
@@ -3958,6 +4887,27 @@ __ni_rtnl_link_unenslave(const ni_netdev_t *dev)
 		goto nla_put_failure;
 
 	NLA_PUT_U32(msg, IFLA_MASTER, 0);
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+/*
+ * Set the interface link down and unenslave from master
+ */
+int
+__ni_rtnl_link_unenslave(const ni_netdev_t *dev)
+{
+	struct nl_msg *msg;
+	int err = 0;
+
+	if (!dev->link.masterdev.index)
+		return __ni_rtnl_link_down(dev);
+
+	if (!(msg = __ni_rtnl_link_unenslave_msg(dev)))
+		goto nla_put_failure;
 
 	if ((err = ni_nl_talk(msg, NULL)) != NLE_SUCCESS)
 		goto nl_talk_failed;
@@ -3974,50 +4924,260 @@ nla_put_failure:
 			dev->name, dev->link.masterdev.name, nl_geterror(err));
 	goto cleanup;
 
-nl_talk_failed:
-	ni_error("%s: failed to set down and unenslave from master %s: %s",
-			dev->name, dev->link.masterdev.name, nl_geterror(err));
-	goto cleanup;
+nl_talk_failed:
+	ni_error("%s: failed to set down and unenslave from master %s: %s",
+			dev->name, dev->link.masterdev.name, nl_geterror(err));
+	goto cleanup;
+}
+
+/*
+ * Bring up an interface and enslave (bridge port) to master
+ */
+int
+__ni_rtnl_link_add_port_up(const ni_netdev_t *port, const char *mname, unsigned int mindex)
+{
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+
+	if (!port || !mname || !mindex)
+		return -1;
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_index = port->link.ifindex;
+	ifi.ifi_change = IFF_UP;
+	ifi.ifi_flags = IFF_UP;
+
+	msg = nlmsg_alloc_simple(RTM_NEWLINK, NLM_F_REQUEST);
+	if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+
+	NLA_PUT_U32(msg, IFLA_MASTER, mindex);
+
+	if (ni_nl_talk(msg, NULL))
+		goto failed;
+
+	ni_debug_ifconfig("successfully added port %s into master %s",
+			port->name, mname);
+	nlmsg_free(msg);
+	return 0;
+
+nla_put_failure:
+	ni_error("failed to encode netlink message to add port %s into %s",
+			port->name, mname);
+failed:
+	nlmsg_free(msg);
+	return -1;
+}
+
+/*
+ * Build a request to bring up an interface and enslave it (bridge port)
+ */
+static struct nl_msg *
+__ni_rtnl_link_add_port_msg(const ni_netdev_t *port, unsigned int mindex)
+{
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_index = port->link.ifindex;
+	ifi.ifi_change = IFF_UP;
+	ifi.ifi_flags = IFF_UP;
+
+	msg = nlmsg_alloc_simple(RTM_NEWLINK, NLM_F_REQUEST);
+	if (!msg || nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+
+	NLA_PUT_U32(msg, IFLA_MASTER, mindex);
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+/*
+ * Build a request to create a bridge (by name) or to change the
+ * options of an existing bridge (by index) with IFLA_BR_* data.
+ * The times are in USER_HZ as in the bridge sysfs attributes.
+ */
+static struct nl_msg *
+__ni_rtnl_link_bridge_msg(const char *ifname, unsigned int ifindex, const ni_bridge_t *bridge)
+{
+	struct nlattr *linkinfo, *data;
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_index = ifindex;
+
+	msg = nlmsg_alloc_simple(RTM_NEWLINK, ifindex ? NLM_F_REQUEST :
+				NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL);
+	if (!msg || nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+
+	if (!ifindex && __ni_rtnl_link_put_ifname(msg, ifname) < 0)
+		goto nla_put_failure;
+
+	if (!(linkinfo = nla_nest_start(msg, IFLA_LINKINFO)))
+		goto nla_put_failure;
+
+	NLA_PUT_STRING(msg, IFLA_INFO_KIND, "bridge");
+
+	if (bridge) {
+		if (!(data = nla_nest_start(msg, IFLA_INFO_DATA)))
+			goto nla_put_failure;
+
+		NLA_PUT_U32(msg, IFLA_BR_STP_STATE, bridge->stp);
+		if (bridge->priority != NI_BRIDGE_VALUE_NOT_SET)
+			NLA_PUT_U16(msg, IFLA_BR_PRIORITY, bridge->priority);
+		if (bridge->forward_delay != NI_BRIDGE_VALUE_NOT_SET)
+			NLA_PUT_U32(msg, IFLA_BR_FORWARD_DELAY,
+					(unsigned int)(bridge->forward_delay * 100.0));
+		if (bridge->ageing_time != NI_BRIDGE_VALUE_NOT_SET)
+			NLA_PUT_U32(msg, IFLA_BR_AGEING_TIME,
+					(unsigned int)(bridge->ageing_time * 100.0));
+		if (bridge->hello_time != NI_BRIDGE_VALUE_NOT_SET)
+			NLA_PUT_U32(msg, IFLA_BR_HELLO_TIME,
+					(unsigned int)(bridge->hello_time * 100.0));
+		if (bridge->max_age != NI_BRIDGE_VALUE_NOT_SET)
+			NLA_PUT_U32(msg, IFLA_BR_MAX_AGE,
+					(unsigned int)(bridge->max_age * 100.0));
+		if (ni_tristate_is_set(bridge->vlan_filtering))
+			NLA_PUT_U8(msg, IFLA_BR_VLAN_FILTERING,
+					ni_tristate_is_enabled(bridge->vlan_filtering));
+
+		nla_nest_end(msg, data);
+	}
+	nla_nest_end(msg, linkinfo);
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+/*
+ * Build a request to change the IFLA_BRPORT_* options of a bridge
+ * port.  The kernel applies them to enslaved ports only, so it has
+ * to follow the enslave request when both are sent in one batch.
+ */
+static struct nl_msg *
+__ni_rtnl_link_bridge_port_msg(const ni_netdev_t *dev, const ni_bridge_port_t *port)
+{
+	struct nlattr *linkinfo, *data;
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_index = dev->link.ifindex;
+
+	msg = nlmsg_alloc_simple(RTM_NEWLINK, NLM_F_REQUEST);
+	if (!msg || nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+
+	if (!(linkinfo = nla_nest_start(msg, IFLA_LINKINFO)))
+		goto nla_put_failure;
+
+	NLA_PUT_STRING(msg, IFLA_INFO_SLAVE_KIND, "bridge");
+
+	if (!(data = nla_nest_start(msg, IFLA_INFO_SLAVE_DATA)))
+		goto nla_put_failure;
+
+	if (port->priority != NI_BRIDGE_VALUE_NOT_SET)
+		NLA_PUT_U16(msg, IFLA_BRPORT_PRIORITY, port->priority);
+	if (port->path_cost != NI_BRIDGE_VALUE_NOT_SET)
+		NLA_PUT_U32(msg, IFLA_BRPORT_COST, port->path_cost);
+
+	nla_nest_end(msg, data);
+	nla_nest_end(msg, linkinfo);
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static int
+__ni_rtnl_link_put_bridge_vlan(struct nl_msg *msg, unsigned int vid_begin,
+		unsigned int vid_end, unsigned int flags)
+{
+	struct bridge_vlan_info vinfo;
+
+	memset(&vinfo, 0, sizeof(vinfo));
+	vinfo.vid = vid_begin;
+	if (vid_begin == vid_end) {
+		vinfo.flags = flags;
+		return nla_put(msg, IFLA_BRIDGE_VLAN_INFO, sizeof(vinfo), &vinfo);
+	}
+
+	vinfo.flags = flags | BRIDGE_VLAN_INFO_RANGE_BEGIN;
+	if (nla_put(msg, IFLA_BRIDGE_VLAN_INFO, sizeof(vinfo), &vinfo) < 0)
+		return -1;
+
+	vinfo.vid = vid_end;
+	vinfo.flags = flags | BRIDGE_VLAN_INFO_RANGE_END;
+	return nla_put(msg, IFLA_BRIDGE_VLAN_INFO, sizeof(vinfo), &vinfo);
 }
 
 /*
- * Bring up an interface and enslave (bridge port) to master
+ * Build a request to add (RTM_SETLINK) the configured VLANs of a
+ * bridge port or to delete (RTM_DELLINK) all VLANs from it, using
+ * VLAN ranges, so even a trunk port needs one message only.
  */
-int
-__ni_rtnl_link_add_port_up(const ni_netdev_t *port, const char *mname, unsigned int mindex)
+static struct nl_msg *
+__ni_rtnl_link_bridge_vlan_msg(const ni_netdev_t *dev, const ni_bridge_port_t *port, int type)
 {
+	const ni_bridge_port_vlan_t *vlan;
 	struct ifinfomsg ifi;
+	struct nlattr *afspec;
 	struct nl_msg *msg;
-
-	if (!port || !mname || !mindex)
-		return -1;
+	unsigned int i, flags;
+	size_t size;
 
 	memset(&ifi, 0, sizeof(ifi));
-	ifi.ifi_family = AF_UNSPEC;
-	ifi.ifi_index = port->link.ifindex;
-	ifi.ifi_change = IFF_UP;
-	ifi.ifi_flags = IFF_UP;
+	ifi.ifi_family = AF_BRIDGE;
+	ifi.ifi_index = dev->link.ifindex;
 
-	msg = nlmsg_alloc_simple(RTM_NEWLINK, NLM_F_REQUEST);
-	if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0)
+	size = NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(ifi)) + nla_total_size(0) +
+		2 * nla_total_size(sizeof(struct bridge_vlan_info)) *
+		(type == RTM_DELLINK ? 1 : port->vlans.count);
+
+	if (!(msg = nlmsg_alloc_size(size + NLMSG_ALIGNTO)) ||
+	    !nlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, type, 0, NLM_F_REQUEST) ||
+	    nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0)
 		goto nla_put_failure;
 
-	NLA_PUT_U32(msg, IFLA_MASTER, mindex);
+	if (!(afspec = nla_nest_start(msg, IFLA_AF_SPEC)))
+		goto nla_put_failure;
 
-	if (ni_nl_talk(msg, NULL))
-		goto failed;
+	if (type == RTM_DELLINK) {
+		if (__ni_rtnl_link_put_bridge_vlan(msg, 1, 4094, 0) < 0)
+			goto nla_put_failure;
+	} else {
+		for (i = 0; i < port->vlans.count; ++i) {
+			vlan = &port->vlans.data[i];
+			flags = 0;
+			if (vlan->pvid)
+				flags |= BRIDGE_VLAN_INFO_PVID;
+			if (vlan->untagged)
+				flags |= BRIDGE_VLAN_INFO_UNTAGGED;
+
+			if (__ni_rtnl_link_put_bridge_vlan(msg, vlan->vid_begin,
+						vlan->vid_end, flags) < 0)
+				goto nla_put_failure;
+		}
+	}
 
-	ni_debug_ifconfig("successfully added port %s into master %s",
-			port->name, mname);
-	nlmsg_free(msg);
-	return 0;
+	nla_nest_end(msg, afspec);
+	return msg;
 
 nla_put_failure:
-	ni_error("failed to encode netlink message to add port %s into %s",
-			port->name, mname);
-failed:
 	nlmsg_free(msg);
-	return -1;
+	return NULL;
 }
 
 /*
@@ -4126,43 +5286,23 @@ addattr_sockaddr(struct nl_msg *msg, int type, const ni_sockaddr_t *addr)
 	return nla_put(msg, type, len, ((const caddr_t) addr) + offset);
 }
 
-static ni_address_t *
-__ni_netdev_address_in_list(ni_address_t *list, const ni_address_t *ap)
+/*
+ * Order of the system and lease addresses matching each other: inet
+ * addresses match by the local and peer address, inet6 by the local
+ * address only.
+ */
+static int
+__ni_netdev_address_match_cmp(const ni_address_t *a1, const ni_address_t *a2)
 {
-	ni_address_t *ap2;
-
-	if (ap->local_addr.ss_family == AF_INET) {
-		const struct sockaddr_in *sin1, *sin2;
-
-		sin1 = &ap->local_addr.sin;
-		for (ap2 = list; ap2; ap2 = ap2->next) {
-			if (ap2->local_addr.ss_family != AF_INET)
-				continue;
-			sin2 = &ap2->local_addr.sin;
-			if (sin1->sin_addr.s_addr != sin2->sin_addr.s_addr)
-				continue;
-
-			if (!ni_sockaddr_equal(&ap->peer_addr, &ap2->peer_addr))
-				continue;
-
-			return ap2;
-		}
-	}
+	int ret;
 
-	if (ap->local_addr.ss_family == AF_INET6) {
-		const struct sockaddr_in6 *sin1, *sin2;
+	if ((ret = ni_sockaddr_compare(&a1->local_addr, &a2->local_addr)))
+		return ret;
 
-		sin1 = &ap->local_addr.six;
-		for (ap2 = list; ap2; ap2 = ap2->next) {
-			if (ap2->local_addr.ss_family != AF_INET6)
-				continue;
-			sin2 = &ap2->local_addr.six;
-			if (!memcmp(&sin1->sin6_addr, &sin2->sin6_addr, 16))
-				return ap2;
-		}
-	}
+	if (a1->local_addr.ss_family == AF_INET)
+		return ni_sockaddr_compare(&a1->peer_addr, &a2->peer_addr);
 
-	return NULL;
+	return 0;
 }
 
 static int
@@ -4170,6 +5310,7 @@ __ni_rtnl_send_newaddr(ni_netdev_t *dev, const ni_address_t *ap, int flags)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	unsigned int omit = IFA_F_TENTATIVE|IFA_F_DADFAILED;
+	unsigned int aflags = ap->flags;
 	struct ifaddrmsg ifa;
 	struct nl_msg *msg;
 	int err;
@@ -4180,11 +5321,16 @@ __ni_rtnl_send_newaddr(ni_netdev_t *dev, const ni_address_t *ap, int flags)
 			ni_address_print(&buf, ap));
 	ni_stringbuf_destroy(&buf);
 
+	/* permit to use the address while the optimistic dad is running */
+	if (ap->family == AF_INET6 && (flags & NLM_F_CREATE) && !ni_address_is_nodad(ap) &&
+	    dev->ipv6 && ni_tristate_is_enabled(dev->ipv6->conf.optimistic_dad))
+		aflags |= IFA_F_OPTIMISTIC;
+
 	memset(&ifa, 0, sizeof(ifa));
 	ifa.ifa_index = dev->link.ifindex;
 	ifa.ifa_family = ap->family;
 	ifa.ifa_prefixlen = ap->prefixlen;
-	ifa.ifa_flags = (ap->flags & ~omit) & 0xff;
+	ifa.ifa_flags = (aflags & ~omit) & 0xff;
 
 	/* Handle ifa_scope */
 	if (ap->scope >= 0)
@@ -4198,8 +5344,8 @@ __ni_rtnl_send_newaddr(ni_netdev_t *dev, const ni_address_t *ap, int flags)
 	if (nlmsg_append(msg, &ifa, sizeof(ifa), NLMSG_ALIGNTO) < 0)
 		goto nla_put_failure;
 
-	if (ap->flags)
-		NLA_PUT_U32(msg, IFA_FLAGS, (ap->flags & ~omit));
+	if (aflags)
+		NLA_PUT_U32(msg, IFA_FLAGS, (aflags & ~omit));
 
 	if (addattr_sockaddr(msg, IFA_LOCAL, &ap->local_addr) < 0)
 		goto nla_put_failure;
@@ -4315,15 +5461,84 @@ failed:
 }
 
 /*
- * Add a static route
+ * Resolve the interface index of a multipath route hop; returns 0 for
+ * a hop with a gateway only and -1 when the hop can't be resolved.
  */
 static int
-__ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
+__ni_rtnl_route_nexthop_ifindex(ni_netdev_t *dev, const ni_route_t *rp,
+				const ni_route_nexthop_t *nh)
+{
+	ni_netconfig_t *nc;
+	ni_netdev_t *other;
+
+	if (nh->device.index)
+		return nh->device.index;
+
+	if (dev && ni_string_eq(rp->nh.device.name, dev->name))
+		return dev->link.ifindex;
+
+	if (rp->nh.device.name) {
+		/* TODO: multi-device hops not supported yet */
+		if (!(nc = ni_global_state_handle(0)))
+			return -1;
+		if (!(other = ni_netdev_by_name(nc, rp->nh.device.name)))
+			return -1;
+
+		return other->link.ifindex;
+	}
+
+	/* hop without gw and device? */
+	return ni_sockaddr_is_specified(&nh->gateway) ? 0 : -1;
+}
+
+#if defined(HAVE_LINUX_NEXTHOP_H)
+/*
+ * Refer to a shared kernel nexthop group instead to carry the hops
+ * in the route, when enabled; returns 0 to use RTA_MULTIPATH.
+ */
+static unsigned int
+__ni_rtnl_route_nexthop_group(ni_netdev_t *dev, const ni_route_t *rp)
+{
+	const ni_route_nexthop_t *nh;
+	ni_nexthop_hop_t *hops;
+	unsigned int count, id = 0;
+	int ifindex;
+
+	if (!ni_config_nexthop_groups())
+		return 0;
+
+	for (count = 0, nh = &rp->nh; nh; nh = nh->next, ++count) {
+		if (nh->realm)
+			return 0;
+	}
+
+	hops = xcalloc(count, sizeof(*hops));
+	for (count = 0, nh = &rp->nh; nh; nh = nh->next, ++count) {
+		if ((ifindex = __ni_rtnl_route_nexthop_ifindex(dev, rp, nh)) <= 0)
+			goto cleanup;
+
+		hops[count].ifindex = ifindex;
+		hops[count].weight = nh->weight;
+		hops[count].flags = nh->flags & 0xFF;
+		hops[count].gateway = nh->gateway;
+	}
+	id = ni_nexthop_group_get(rp->family, hops, count);
+
+cleanup:
+	free(hops);
+	return id;
+}
+#endif
+
+/*
+ * Build a request to add a static route
+ */
+static struct nl_msg *
+__ni_rtnl_newroute_msg(ni_netdev_t *dev, ni_route_t *rp, int flags)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	struct rtmsg rt;
 	struct nl_msg *msg;
-	int err;
 
 	ni_debug_ifconfig("%s(%s%s)", __FUNCTION__,
 			flags & NLM_F_REPLACE ? "replace " :
@@ -4395,17 +5610,26 @@ __ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
 
 		if (rp->realm)
 			NLA_PUT_U32(msg, RTA_FLOW, rp->realm);
+#if defined(HAVE_LINUX_NEXTHOP_H)
+	} else
+	if (rt.rtm_type == RTN_UNICAST &&
+	    (rp->nh_id = __ni_rtnl_route_nexthop_group(dev, rp))) {
+		NLA_PUT_U32(msg, RTA_NH_ID, rp->nh_id);
+#endif
 	} else {
 		struct nlattr *mp_head;
 		struct rtnexthop *rtnh;
 		ni_route_nexthop_t *nh;
-		ni_netconfig_t *nc = NULL;
+		int ifindex;
 
 		mp_head = nla_nest_start(msg, RTA_MULTIPATH);
 		if (mp_head == NULL)
 			goto nla_put_failure;
 
 		for (nh = &rp->nh; nh; nh = nh->next) {
+			if ((ifindex = __ni_rtnl_route_nexthop_ifindex(dev, rp, nh)) < 0)
+				goto failed;
+
 			rtnh = nlmsg_reserve(msg, sizeof(*rtnh), NLMSG_ALIGNTO);
 			if (rtnh == NULL)
 				goto nla_put_failure;
@@ -4413,28 +5637,7 @@ __ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
 			memset(rtnh, 0, sizeof(*rtnh));
 			rtnh->rtnh_flags = nh->flags & 0xFF;
 			rtnh->rtnh_hops = nh->weight ? nh->weight - 1 : 0;
-
-			if (nh->device.index) {
-				rtnh->rtnh_ifindex = nh->device.index;
-			} else
-			if (dev && ni_string_eq(rp->nh.device.name, dev->name)) {
-				rtnh->rtnh_ifindex = dev->link.ifindex;
-			} else
-			if (rp->nh.device.name) {
-				/* TODO: multi-device hops not supported yet */
-				ni_netdev_t *other;
-
-				if (!nc || !(nc = ni_global_state_handle(0)))
-					goto failed;
-				if (!(other = ni_netdev_by_name(nc, rp->nh.device.name)))
-					goto failed;
-
-				rtnh->rtnh_ifindex = other->link.ifindex;
-			} else
-			if (!ni_sockaddr_is_specified(&nh->gateway)) {
-				/* hop without gw and device? */
-				goto failed;
-			}
+			rtnh->rtnh_ifindex = ifindex;
 
 			if (ni_sockaddr_is_specified(&nh->gateway) &&
 			    addattr_sockaddr(msg, RTA_GATEWAY, &nh->gateway))
@@ -4509,22 +5712,43 @@ __ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
 		nla_nest_end(msg, mxrta);
 	}
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
+	return msg;
+
+nla_put_failure:
+	ni_error("failed to encode netlink attr");
+failed:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static int
+__ni_rtnl_newroute_result(const ni_route_t *rp, int err)
+{
+	if (err && abs(err) != NLE_EXIST) {
 		ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
-		ni_error("%s(%s): ni_nl_talk failed [%s]", __FUNCTION__,
-				ni_route_print(&buf, rp),  nl_geterror(err));
+		ni_error("%s(%s): netlink request failed [%s]", __func__,
+				ni_route_print(&buf, rp), nl_geterror(err));
 		ni_stringbuf_destroy(&buf);
-		goto failed;
+		return -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
 	}
-
-	nlmsg_free(msg);
 	return 0;
+}
 
-nla_put_failure:
-	ni_error("failed to encode netlink attr");
-failed:
+/*
+ * Add a static route
+ */
+static int
+__ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
+{
+	struct nl_msg *msg;
+	int err;
+
+	if (!(msg = __ni_rtnl_newroute_msg(dev, rp, flags)))
+		return -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
+
+	err = ni_nl_talk(msg, NULL);
 	nlmsg_free(msg);
-	return -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
+	return __ni_rtnl_newroute_result(rp, err);
 }
 
 static int
@@ -4557,11 +5781,20 @@ __ni_rtnl_send_delroute(ni_netdev_t *dev, ni_route_t *rp)
 	 && addattr_sockaddr(msg, RTA_DST, &rp->destination))
 		goto nla_put_failure;
 
+#if defined(HAVE_LINUX_NEXTHOP_H)
+	/* routes using a nexthop group match by the group id only */
+	if (rp->nh_id) {
+		NLA_PUT_U32(msg, RTA_NH_ID, rp->nh_id);
+	} else {
+#endif
 	if (rp->nh.gateway.ss_family != AF_UNSPEC
 	 && addattr_sockaddr(msg, RTA_GATEWAY, &rp->nh.gateway))
 		goto nla_put_failure;
 
 	NLA_PUT_U32(msg, RTA_OIF, dev->link.ifindex);
+#if defined(HAVE_LINUX_NEXTHOP_H)
+	}
+#endif
 
 	if ((err = ni_nl_talk(msg, NULL)) < 0) {
 		ni_error("%s(%s): rtnl_talk failed[%d]: %s", __func__,
@@ -4628,19 +5861,11 @@ nla_put_failure:
 	return -1;
 }
 
-static int
-__ni_rtnl_send_newrule(const ni_rule_t *rule, int flags)
+static struct nl_msg *
+__ni_rtnl_rule_msg(const ni_rule_t *rule, int type, int flags)
 {
-	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	struct nl_msg *msg;
 	struct fib_rule_hdr frh;
-	int err;
-
-	ni_debug_ifconfig("%s(%s%s)", __FUNCTION__,
-			flags & NLM_F_REPLACE ? "replace " :
-			flags & NLM_F_CREATE  ? "create " : "",
-			ni_rule_print(&buf, rule));
-	ni_stringbuf_destroy(&buf);
 
 	memset(&frh, 0, sizeof(frh));
 	frh.family = rule->family;
@@ -4652,70 +5877,59 @@ __ni_rtnl_send_newrule(const ni_rule_t *rule, int flags)
 		frh.flags |= FIB_RULE_INVERT;
 	frh.tos = rule->tos;
 
-	msg = nlmsg_alloc_simple(RTM_NEWRULE, NLM_F_REQUEST | flags);
-	if (nlmsg_append(msg, &frh, sizeof(frh), NLMSG_ALIGNTO) < 0)
-		goto nla_put_failure;
-
-	if (ni_rtnl_rule_msg_put(msg, rule) < 0)
-		goto nla_put_failure;
+	if (!(msg = nlmsg_alloc_simple(type, NLM_F_REQUEST | flags)))
+		return NULL;
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
-		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_rule_print(&buf, rule));
-		ni_stringbuf_destroy(&buf);
-		goto failed;
+	if (nlmsg_append(msg, &frh, sizeof(frh), NLMSG_ALIGNTO) < 0 ||
+	    ni_rtnl_rule_msg_put(msg, rule) < 0) {
+		ni_error("failed to encode netlink %s message attribute",
+				type == RTM_NEWRULE ? "NEWRULE" : "DELRULE");
+		nlmsg_free(msg);
+		return NULL;
 	}
+	return msg;
+}
 
-	nlmsg_free(msg);
-	return 0;
+static struct nl_msg *
+__ni_rtnl_newrule_msg(const ni_rule_t *rule, int flags)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 
-nla_put_failure:
-	ni_error("failed to encode netlink NEWRULE message attribute");
-failed:
-	nlmsg_free(msg);
-	return -1;
+	ni_debug_ifconfig("%s(%s%s)", __FUNCTION__,
+			flags & NLM_F_REPLACE ? "replace " :
+			flags & NLM_F_CREATE  ? "create " : "",
+			ni_rule_print(&buf, rule));
+	ni_stringbuf_destroy(&buf);
+
+	return __ni_rtnl_rule_msg(rule, RTM_NEWRULE, flags);
 }
 
-static int
-__ni_rtnl_send_delrule(const ni_rule_t *rule)
+static struct nl_msg *
+__ni_rtnl_delrule_msg(const ni_rule_t *rule)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
-	struct fib_rule_hdr frh;
-	struct nl_msg *msg;
-	int err;
 
 	ni_debug_ifconfig("%s(%s)", __FUNCTION__, ni_rule_print(&buf, rule));
 	ni_stringbuf_destroy(&buf);
 
-	memset(&frh, 0, sizeof(frh));
-	frh.family = rule->family;
-	frh.action = rule->action;
-	frh.table = rule->table > RT_TABLE_LOCAL ? RT_TABLE_UNSPEC : rule->table;
-	frh.dst_len = rule->dst.len && !ni_sockaddr_is_unspecified(&rule->dst.addr) ? rule->dst.len : 0;
-	frh.src_len = rule->src.len && !ni_sockaddr_is_unspecified(&rule->src.addr) ? rule->src.len : 0;
-	if (rule->flags & NI_BIT(NI_RULE_INVERT))
-		frh.flags |= FIB_RULE_INVERT;
-	frh.tos = rule->tos;
-
-	msg = nlmsg_alloc_simple(RTM_DELRULE, NLM_F_REQUEST);
-	if (nlmsg_append(msg, &frh, sizeof(frh), NLMSG_ALIGNTO) < 0)
-		goto nla_put_failure;
-
-	if (ni_rtnl_rule_msg_put(msg, rule) < 0)
-		goto nla_put_failure;
+	return __ni_rtnl_rule_msg(rule, RTM_DELRULE, 0);
+}
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_OBJ_NOTFOUND) {
-		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_rule_print(&buf, rule));
-		ni_stringbuf_destroy(&buf);
-		goto failed;
-	}
+/*
+ * Check the batch result of a rule request, ignoring an already
+ * existing rule on create and a not existing one on delete.
+ */
+static int
+__ni_rtnl_rule_result(const ni_rule_t *rule, int type, int err)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 
-	nlmsg_free(msg);
-	return 0;
+	if (!err || abs(err) == (type == RTM_NEWRULE ? NLE_EXIST : NLE_OBJ_NOTFOUND))
+		return 0;
 
-nla_put_failure:
-	ni_error("failed to encode netlink DELRULE message attribute");
-failed:
-	nlmsg_free(msg);
+	ni_error("unable to %s rule %s: %s", type == RTM_NEWRULE ? "apply" : "delete",
+			ni_rule_print(&buf, rule), nl_geterror(err));
+	ni_stringbuf_destroy(&buf);
 	return -1;
 }
 
@@ -5061,26 +6275,39 @@ ni_address_updater_init(ni_addrconf_updater_t *updater, ni_netdev_t *dev, unsign
 	return au;
 }
 
+/*
+ * Send the pending claims of added and the probes of the tentative
+ * addresses in the same run, waiting for whichever is due first.
+ * The verifying hint tells whether tentative addresses are pending.
+ */
 static ni_bool_t
-ni_address_updater_arp_send(ni_addrconf_updater_t *updater, ni_netdev_t *dev, ni_addrconf_mode_t owner)
+ni_address_updater_arp_send(ni_addrconf_updater_t *updater, ni_netdev_t *dev,
+				ni_addrconf_mode_t owner, ni_bool_t *verifying)
 {
 	ni_timeout_t wait_verify = 0, wait_notify = 0;
 	ni_address_updater_t *au;
+	ni_bool_t notify, verify;
+
+	if (verifying)
+		*verifying = FALSE;
 
 	if (!dev || !(au = ni_addrconf_address_updater_get(updater)))
 		return FALSE;
 
-	if (ni_arp_notify_send(au->sock, &au->notify, &wait_notify)) {
-		updater->timeout = wait_notify;
-		return TRUE;
-	}
+	notify = ni_arp_notify_send(au->sock, &au->notify, &wait_notify);
+	verify = ni_arp_verify_send(au->sock, &au->verify, &wait_verify) == NI_ARP_SEND_PROGRESS;
 
-	if (ni_arp_verify_send(au->sock, &au->verify, &wait_verify) == NI_ARP_SEND_PROGRESS) {
+	if (notify && verify)
+		updater->timeout = min_t(ni_timeout_t, wait_notify, wait_verify);
+	else if (notify)
+		updater->timeout = wait_notify;
+	else if (verify)
 		updater->timeout = wait_verify;
-		return TRUE;
-	}
 
-	return FALSE;
+	if (verifying)
+		*verifying = verify;
+
+	return notify || verify;
 }
 
 static int
@@ -5093,8 +6320,9 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 	ni_addrconf_mode_t owner = NI_ADDRCONF_NONE;
 	ni_address_updater_t *au;
 	unsigned int family = AF_UNSPEC;
-	ni_address_t *ap, *next;
-	unsigned int minprio;
+	ni_address_t *ap, *next, **matches;
+	ni_bool_t verifying;
+	unsigned int minprio, pos;
 	int rv;
 
 	do {
@@ -5118,16 +6346,22 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 		return -1;
 	}
 
-	for (ap = dev->addrs; ap; ap = next) {
+	/* See which of the addresses we've found in the system the config
+	 * list contains, sort-merging both instead to scan the config list
+	 * for each of them. */
+	matches = xcalloc(ni_address_list_count(dev->addrs) ?: 1, sizeof(*matches));
+	if (new_lease)
+		ni_address_list_merge_match(dev->addrs, new_lease->addrs,
+				__ni_netdev_address_match_cmp, matches);
+
+	for (pos = 0, ap = dev->addrs; ap; ap = next, ++pos) {
 		ni_address_t *new_addr;
 
 		next = ap->next;
 		if (family != ap->family)
 			continue;
 
-		/* See if the config list contains the address we've found in the
-		 * system. */
-		new_addr = new_lease ? __ni_netdev_address_in_list(new_lease->addrs, ap) : NULL;
+		new_addr = matches[pos];
 
 		/* Do not touch addresses not managed by us. */
 		if (ap->owner == NI_ADDRCONF_NONE) {
@@ -5214,14 +6448,17 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 				continue;
 		}
 	}
+	free(matches);
 
 	if (max_changes == 0)
 		return 1;
 
 	/* Loop over all addresses in the configuration and create
-	 * those that don't exist yet.
+	 * those that don't exist yet. While we are still claiming
+	 * the addresses added before, verify the next tentative ones.
 	 */
-	if (family == AF_INET && ni_address_updater_arp_send(updater, dev, owner))
+	if (family == AF_INET && ni_address_updater_arp_send(updater, dev, owner, &verifying)
+	&&  verifying)
 		return 1;
 
 	for (ap = new_lease ? new_lease->addrs : NULL ; ap; ap = ap->next) {
@@ -5236,6 +6473,10 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 		if (ni_address_is_duplicate(ap))
 			continue;
 
+		/* added in a previous run, still claiming it */
+		if (ni_arp_notify_has_address(&au->notify, ap))
+			continue;
+
 		if (!ni_address_is_tentative(ap)) {
 			/*
 			 *  Remove address from verify array, as it isn't
@@ -5269,7 +6510,7 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 		ni_arp_notify_add_address(&au->notify, ap);
 	}
 
-	if (family == AF_INET && ni_address_updater_arp_send(updater, dev, owner))
+	if (family == AF_INET && ni_address_updater_arp_send(updater, dev, owner, NULL))
 		return 1;
 
 	if (max_changes == 0)
@@ -5281,57 +6522,31 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 /*
  * Check if a route already exists.
  */
-static ni_route_t *
-__ni_netdev_route_table_contains(ni_route_table_t *tab, const ni_route_t *rp)
-{
-	unsigned int i;
-	ni_route_t *rp2;
-
-	for (i = 0; i < tab->routes.count; ++i) {
-		if ((rp2 = tab->routes.data[i]) == NULL)
-			continue;
-
-		if (rp->table != rp2->table)
-			continue;
-
-		if (ni_route_equal_destination(rp, rp2))
-			return rp2;
-	}
-
-	return NULL;
-}
-
 static ni_route_t *
 __ni_skip_conflicting_route(ni_netconfig_t *nc, ni_netdev_t *our_dev,
 		ni_addrconf_lease_t *our_lease, ni_route_t *our_rp)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	ni_netdev_t *dev;
-	ni_route_table_t *tab;
 	ni_route_t *rp;
-	unsigned int i;
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
 		if (!dev->routes)
 			continue;
 
-		if (!(tab = ni_route_tables_find(dev->routes, our_rp->table)))
+		rp = ni_route_tables_find_prefix_match(dev->routes, our_rp,
+				ni_route_equal_destination);
+		if (!rp)
 			continue;
 
-		for (i = 0; i < tab->routes.count; ++i) {
-			rp = tab->routes.data[i];
-			if (!rp || !ni_route_equal_destination(rp, our_rp))
-				continue;
-
-			ni_debug_ifconfig("%s: skipping conflicting %s:%s route: %s",
-					our_dev->name,
-					ni_addrfamily_type_to_name(our_lease->family),
-					ni_addrconf_type_to_name(our_lease->type),
-					ni_route_print(&buf, rp));
-			ni_stringbuf_destroy(&buf);
+		ni_debug_ifconfig("%s: skipping conflicting %s:%s route: %s",
+				our_dev->name,
+				ni_addrfamily_type_to_name(our_lease->family),
+				ni_addrconf_type_to_name(our_lease->type),
+				ni_route_print(&buf, rp));
+		ni_stringbuf_destroy(&buf);
 
-			return rp;
-		}
+		return rp;
 	}
 	return NULL;
 }
@@ -5344,9 +6559,11 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	ni_addrconf_mode_t old_type = NI_ADDRCONF_NONE;
 	unsigned int family = AF_UNSPEC;
-	ni_route_table_t *tab, *cfg_tab;
+	ni_route_array_t added = NI_ROUTE_ARRAY_INIT;
+	ni_route_table_t *tab;
 	ni_route_t *rp, *new_route;
 	unsigned int minprio, i;
+	ni_nl_batch_t *batch;
 	int rv = 0;
 
 	do {
@@ -5376,11 +6593,8 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 
 			/* See if the config list contains the route we've
 			 * found in the system. */
-			cfg_tab = new_lease ? ni_route_tables_find(new_lease->routes, rp->table) : NULL;
-			if (cfg_tab)
-				new_route = __ni_netdev_route_table_contains(cfg_tab, rp);
-			else
-				new_route = NULL;
+			new_route = new_lease ? ni_route_tables_find_prefix_match(new_lease->routes,
+							rp, ni_route_equal_destination) : NULL;
 
 			/* Do not touch route if not managed by us. */
 			if (rp->owner == NI_ADDRCONF_NONE) {
@@ -5447,10 +6661,13 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 	}
 
 	/* Loop over all tables and routes in the configuration
-	 * and create those that don't exist yet.
+	 * and create those that don't exist yet in one batch.
 	 */
+	batch = ni_nl_batch_new();
 	for (tab = new_lease ? new_lease->routes : NULL; tab; tab = tab->next) {
 		for (i = 0; i < tab->routes.count; ++i) {
+			struct nl_msg *msg;
+
 			if ((rp = tab->routes.data[i]) == NULL)
 				continue;
 
@@ -5466,15 +6683,32 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 					dev->name, ni_route_print(&buf, rp));
 			ni_stringbuf_destroy(&buf);
 
-			if ((rv = __ni_rtnl_send_newroute(dev, rp, NLM_F_CREATE)) < 0)
+			if (!(msg = __ni_rtnl_newroute_msg(dev, rp, NLM_F_CREATE))) {
+				rv = -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
 				continue;
+			}
 
-			rp->owner = new_lease->type;
-			rp->seq = __ni_global_seqno;
-			ni_netconfig_route_add(nc, rp, dev);
+			ni_nl_batch_add(batch, msg);
+			ni_route_array_append(&added, ni_route_ref(rp));
 		}
 	}
 
+	if (ni_nl_batch_count(batch) && ni_nl_batch_commit(batch) < 0)
+		rv = -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
+
+	for (i = 0; i < added.count; ++i) {
+		rp = added.data[i];
+
+		if ((rv = __ni_rtnl_newroute_result(rp, ni_nl_batch_result(batch, i))) < 0)
+			continue;
+
+		rp->owner = new_lease->type;
+		rp->seq = __ni_global_seqno;
+		ni_netconfig_route_add(nc, rp, dev);
+	}
+	ni_route_array_destroy(&added);
+	ni_nl_batch_free(batch);
+
 	return rv;
 }
 
@@ -5605,12 +6839,16 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
 	ni_rule_array_t del_rules = NI_RULE_ARRAY_INIT;
 	ni_rule_array_t mod_rules = NI_RULE_ARRAY_INIT;
+	ni_rule_array_t req_rules = NI_RULE_ARRAY_INIT;
 	const ni_addrconf_lease_t *lease;
 	ni_rule_array_t *old_rules;
 	ni_rule_array_t *new_rules;
+	ni_nl_batch_t *batch;
+	struct nl_msg *msg;
 	ni_rule_t *rule, *r;
 	unsigned int prio;
 	unsigned int i;
+	int pos;
 
 	do {
 		__ni_global_seqno++;
@@ -5677,9 +6915,13 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 	if (!del_rules.count && !mod_rules.count)
 		return 0;
 
-	if (__ni_system_refresh_rules(nc))
+	if (__ni_system_refresh_rules(nc)) {
+		ni_rule_array_destroy(&del_rules);
+		ni_rule_array_destroy(&mod_rules);
 		return -1;
+	}
 
+	batch = ni_nl_batch_new();
 	for (i = 0; i < del_rules.count; ++i) {
 		rule = del_rules.data[i];
 
@@ -5714,12 +6956,24 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 			}
 
 			/* OK to delete -- no other lease provides it */
-			if (__ni_rtnl_send_delrule(rule) < 0)
-				continue;
+			if ((msg = __ni_rtnl_delrule_msg(rule)) &&
+			    (pos = ni_nl_batch_add(batch, msg)) >= 0)
+				ni_rule_array_append(&req_rules, ni_rule_ref(rule));
+			else
+				nlmsg_free(msg);
+		}
+	}
 
+	/* send all deletes at once, then forget the deleted rules */
+	ni_nl_batch_commit(batch);
+	for (i = 0; i < req_rules.count; ++i) {
+		rule = req_rules.data[i];
+		if (!__ni_rtnl_rule_result(rule, RTM_DELRULE, ni_nl_batch_result(batch, i)))
 			ni_netconfig_rule_del(nc, rule, NULL);
-		}
 	}
+	ni_rule_array_destroy(&req_rules);
+	ni_nl_batch_free(batch);
+	batch = ni_nl_batch_new();
 
 	for (i = 0; i < mod_rules.count; ++i) {
 		rule = mod_rules.data[i];
@@ -5755,6 +7009,10 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 				r->owner = new_lease->uuid;
 			}
 			continue;
+		} else
+		if (ni_rule_array_find_match(&req_rules, rule, ni_rule_equal)) {
+			/* an equal rule is already in the batch */
+			continue;
 		} else {
 			ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_IFCONFIG|NI_TRACE_ROUTE,
 					"%s: applying new rule %s",
@@ -5771,13 +7029,28 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 
 		r->seq = __ni_global_seqno;
 		r->owner = new_lease->uuid;
-		if (__ni_rtnl_send_newrule(r, NLM_F_REPLACE) < 0) {
-			ni_rule_free(r);
+		if ((msg = __ni_rtnl_newrule_msg(r, NLM_F_REPLACE)) &&
+		    (pos = ni_nl_batch_add(batch, msg)) >= 0) {
+			ni_rule_array_append(&req_rules, r);
 		} else {
-			ni_netconfig_rule_add(nc, r);
+			nlmsg_free(msg);
+			ni_rule_free(r);
 		}
 	}
 
+	/* send all new rules at once, then track the applied ones */
+	ni_nl_batch_commit(batch);
+	for (i = 0; i < req_rules.count; ++i) {
+		r = req_rules.data[i];
+		if (!__ni_rtnl_rule_result(r, RTM_NEWRULE, ni_nl_batch_result(batch, i)))
+			ni_netconfig_rule_add(nc, r);
+	}
+	ni_rule_array_destroy(&req_rules);
+	ni_nl_batch_free(batch);
+
+	ni_rule_array_destroy(&del_rules);
+	ni_rule_array_destroy(&mod_rules);
+
 	(void)__ni_system_refresh_rules(nc);
 
 	return 0;
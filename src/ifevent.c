@@ -27,6 +27,9 @@
 #include "sysfs.h"
 #include "kernel.h"
 #include "appconfig.h"
+#include "stats.h"
+#include "probes.h"
+#include "netns.h"
 
 #ifndef NI_ND_OPT_RDNSS_INFORMATION
 #define NI_ND_OPT_RDNSS_INFORMATION	25	/* RFC 5006 */
@@ -66,6 +69,20 @@ typedef struct ni_rtevent_handle
  */
 static ni_socket_t *	__ni_rtevent_sock;
 
+/*
+ * Whether the state has been dumped while the event socket is
+ * listening, so the events alone keep it in sync, and whether
+ * we're discarding stale events after an overrun.
+ */
+static ni_bool_t	__ni_rtevent_synced;
+static ni_bool_t	__ni_rtevent_discard;
+
+/*
+ * The receive buffer length in use, grown on overruns and kept
+ * when the socket gets restarted.
+ */
+static unsigned int	__ni_rtevent_recv_buff_len;
+
 static int	__ni_rtevent_process(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_newlink(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_dellink(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
@@ -79,6 +96,212 @@ static int	__ni_rtevent_delrule(ni_netconfig_t *, const struct sockaddr_nl *, st
 static int	__ni_rtevent_nduseropt(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 
 
+/*
+ * Coalescing of redundant device change and address update events:
+ * each object gets at most one pending event, emitted when the
+ * configured window expires. Other events of a device flush its
+ * pending events first to preserve the ordering per device.
+ */
+#define NI_RTEVENT_COALESCE_BUCKETS	64
+
+typedef struct ni_rtevent_coalesced	ni_rtevent_coalesced_t;
+struct ni_rtevent_coalesced {
+	ni_rtevent_coalesced_t *	next;	/* in emit order	*/
+	ni_rtevent_coalesced_t **	pprev;
+	ni_rtevent_coalesced_t *	hnext;	/* in ifindex bucket	*/
+
+	unsigned int			ifindex;
+	ni_event_t			event;
+	ni_sockaddr_t			addr;
+};
+
+static struct {
+	ni_rtevent_coalesced_t *	head;
+	ni_rtevent_coalesced_t **	tail;
+	ni_rtevent_coalesced_t *	hash[NI_RTEVENT_COALESCE_BUCKETS];
+	const ni_timer_t *		timer;
+} __ni_rtevent_coalesce;
+
+static unsigned int
+__ni_rtevent_config_coalesce_window(void)
+{
+	return ni_global.config ? ni_global.config->rtnl_event.coalesce_window : 0;
+}
+
+static ni_rtevent_coalesced_t *
+__ni_rtevent_coalesce_find(unsigned int ifindex, ni_event_t event, const ni_sockaddr_t *addr)
+{
+	ni_rtevent_coalesced_t *ce;
+
+	ce = __ni_rtevent_coalesce.hash[ifindex % NI_RTEVENT_COALESCE_BUCKETS];
+	for ( ; ce; ce = ce->hnext) {
+		if (ce->ifindex != ifindex || ce->event != event)
+			continue;
+		if (!addr || ni_sockaddr_equal(&ce->addr, addr))
+			return ce;
+	}
+	return NULL;
+}
+
+static void
+__ni_rtevent_coalesce_unlink(ni_rtevent_coalesced_t *ce)
+{
+	ni_rtevent_coalesced_t **pos;
+
+	pos = &__ni_rtevent_coalesce.hash[ce->ifindex % NI_RTEVENT_COALESCE_BUCKETS];
+	for ( ; *pos; pos = &(*pos)->hnext) {
+		if (*pos == ce) {
+			*pos = ce->hnext;
+			break;
+		}
+	}
+
+	if (ce->next)
+		ce->next->pprev = ce->pprev;
+	else
+		__ni_rtevent_coalesce.tail = ce->pprev;
+	*ce->pprev = ce->next;
+	free(ce);
+}
+
+static void
+__ni_rtevent_coalesce_emit(const ni_rtevent_coalesced_t *ce)
+{
+	const ni_address_t *ap;
+	ni_netconfig_t *nc;
+	ni_netdev_t *dev;
+
+	if (!(nc = ni_global_state_handle(0)))
+		return;
+	if (!(dev = ni_netdev_by_index(nc, ce->ifindex)))
+		return;
+
+	ni_debug_events("%s(%s, idx=%d, %s)", __FUNCTION__,
+			dev->name, dev->link.ifindex, ni_event_type_to_name(ce->event));
+
+	if (ce->event == NI_EVENT_ADDRESS_UPDATE) {
+		if (!ni_global.interface_addr_event)
+			return;
+		if ((ap = ni_netdev_find_address(dev, &ce->addr)))
+			ni_global.interface_addr_event(dev, ce->event, ap);
+	} else {
+		if (ni_global.interface_event)
+			ni_global.interface_event(dev, ce->event);
+	}
+}
+
+/*
+ * Emit the pending events of a device, or all of them for ifindex 0
+ */
+static void
+__ni_rtevent_coalesce_flush(unsigned int ifindex)
+{
+	ni_rtevent_coalesced_t *ce, *next, copy;
+
+	for (ce = __ni_rtevent_coalesce.head; ce; ce = next) {
+		next = ce->next;
+		if (ifindex && ce->ifindex != ifindex)
+			continue;
+
+		copy = *ce;
+		__ni_rtevent_coalesce_unlink(ce);
+		__ni_rtevent_coalesce_emit(&copy);
+
+		/* the handlers may have flushed further events */
+		next = __ni_rtevent_coalesce.head;
+	}
+
+	if (!__ni_rtevent_coalesce.head && __ni_rtevent_coalesce.timer) {
+		ni_timer_cancel(__ni_rtevent_coalesce.timer);
+		__ni_rtevent_coalesce.timer = NULL;
+	}
+}
+
+/*
+ * Discard the pending events of a device or of one of its addresses
+ */
+static void
+__ni_rtevent_coalesce_drop(unsigned int ifindex, const ni_sockaddr_t *addr)
+{
+	ni_rtevent_coalesced_t *ce, *next;
+
+	ce = __ni_rtevent_coalesce.hash[ifindex % NI_RTEVENT_COALESCE_BUCKETS];
+	for ( ; ce; ce = next) {
+		next = ce->hnext;
+		if (ce->ifindex != ifindex)
+			continue;
+		if (addr && (ce->event != NI_EVENT_ADDRESS_UPDATE ||
+			     !ni_sockaddr_equal(&ce->addr, addr)))
+			continue;
+		__ni_rtevent_coalesce_unlink(ce);
+	}
+}
+
+static void
+__ni_rtevent_coalesce_timeout(void *user_data, const ni_timer_t *timer)
+{
+	if (__ni_rtevent_coalesce.timer != timer)
+		return;
+
+	__ni_rtevent_coalesce.timer = NULL;
+	__ni_rtevent_coalesce_flush(0);
+}
+
+static ni_bool_t
+__ni_rtevent_coalesce_add(unsigned int ifindex, ni_event_t event, const ni_sockaddr_t *addr)
+{
+	unsigned int window = __ni_rtevent_config_coalesce_window();
+	ni_rtevent_coalesced_t *ce;
+	unsigned int bucket;
+
+	if (!window || !ifindex)
+		return FALSE;
+
+	if (__ni_rtevent_coalesce_find(ifindex, event, addr)) {
+		ni_debug_events("coalesced %s event of idx=%u",
+				ni_event_type_to_name(event), ifindex);
+		return TRUE;
+	}
+
+	if (!(ce = calloc(1, sizeof(*ce))))
+		return FALSE;
+
+	if (!__ni_rtevent_coalesce.timer &&
+	    !(__ni_rtevent_coalesce.timer = ni_timer_register(window,
+				__ni_rtevent_coalesce_timeout, NULL))) {
+		free(ce);
+		return FALSE;
+	}
+
+	ce->ifindex = ifindex;
+	ce->event = event;
+	if (addr)
+		ce->addr = *addr;
+
+	bucket = ifindex % NI_RTEVENT_COALESCE_BUCKETS;
+	ce->hnext = __ni_rtevent_coalesce.hash[bucket];
+	__ni_rtevent_coalesce.hash[bucket] = ce;
+
+	if (!__ni_rtevent_coalesce.tail)
+		__ni_rtevent_coalesce.tail = &__ni_rtevent_coalesce.head;
+	ce->pprev = __ni_rtevent_coalesce.tail;
+	*__ni_rtevent_coalesce.tail = ce;
+	__ni_rtevent_coalesce.tail = &ce->next;
+	return TRUE;
+}
+
+static void
+__ni_rtevent_coalesce_destroy(void)
+{
+	while (__ni_rtevent_coalesce.head)
+		__ni_rtevent_coalesce_unlink(__ni_rtevent_coalesce.head);
+
+	if (__ni_rtevent_coalesce.timer) {
+		ni_timer_cancel(__ni_rtevent_coalesce.timer);
+		__ni_rtevent_coalesce.timer = NULL;
+	}
+}
+
 /*
  * Helper to trigger interface events
  */
@@ -87,15 +310,40 @@ __ni_netdev_event(ni_netconfig_t *nc, ni_netdev_t *dev, ni_event_t ev)
 {
 	ni_debug_events("%s(%s, idx=%d, %s)", __FUNCTION__,
 			dev->name, dev->link.ifindex, ni_event_type_to_name(ev));
-	if (ni_global.interface_event)
-		ni_global.interface_event(dev, ev);
+	if (!ni_global.interface_event)
+		return;
+
+	switch (ev) {
+	case NI_EVENT_DEVICE_CHANGE:
+		if (__ni_rtevent_coalesce_add(dev->link.ifindex, ev, NULL))
+			return;
+		break;
+	case NI_EVENT_DEVICE_DELETE:
+		__ni_rtevent_coalesce_drop(dev->link.ifindex, NULL);
+		break;
+	default:
+		__ni_rtevent_coalesce_flush(dev->link.ifindex);
+		break;
+	}
+	ni_global.interface_event(dev, ev);
 }
 
 static inline void
 __ni_netdev_addr_event(ni_netdev_t *dev, ni_event_t ev, const ni_address_t *ap)
 {
-	if (ni_global.interface_addr_event)
-		ni_global.interface_addr_event(dev, ev, ap);
+	if (!ni_global.interface_addr_event)
+		return;
+
+	if (!ap) {
+		/* nothing to coalesce */
+	} else
+	if (ev == NI_EVENT_ADDRESS_UPDATE) {
+		if (__ni_rtevent_coalesce_add(dev->link.ifindex, ev, &ap->local_addr))
+			return;
+	} else {
+		__ni_rtevent_coalesce_drop(dev->link.ifindex, &ap->local_addr);
+	}
+	ni_global.interface_addr_event(dev, ev, ap);
 }
 
 static inline void
@@ -112,6 +360,124 @@ __ni_netdev_nduseropt_event(ni_netdev_t *dev, ni_event_t ev)
 		ni_global.interface_nduseropt_event(dev, ev);
 }
 
+/*
+ * Address lifetime expiry: the kernel removes addresses with an
+ * expired valid lifetime and sends a DELADDR, but a lost event or
+ * a tentative address it never reported would stay in the list
+ * until the next address dump. A single timer armed to the earliest
+ * finite valid lifetime of the tracked addresses drops them instead.
+ */
+#define NI_RTEVENT_EXPIRY_GRACE		2000	/* msec, let kernel win */
+
+static struct {
+	const ni_timer_t *		timer;
+	struct timeval			expires;
+} __ni_rtevent_expiry;
+
+static void	__ni_rtevent_expiry_timeout(void *, const ni_timer_t *);
+
+static void
+__ni_rtevent_expiry_arm(const ni_address_t *ap, const struct timeval *now)
+{
+	struct timeval expires;
+	ni_timeout_t timeout;
+	unsigned int lft;
+
+	if (!ap || !__ni_rtevent_sock)
+		return;
+
+	lft = ni_address_valid_lft(ap, now);
+	if (lft == NI_LIFETIME_INFINITE)
+		return;
+	if (lft == NI_LIFETIME_EXPIRED)
+		lft = 0;
+
+	timeout = (ni_timeout_t)lft * 1000 + NI_RTEVENT_EXPIRY_GRACE;
+	expires.tv_sec  = now->tv_sec + timeout / 1000;
+	expires.tv_usec = now->tv_usec + (timeout % 1000) * 1000;
+	if (expires.tv_usec >= 1000000) {
+		expires.tv_sec  += 1;
+		expires.tv_usec -= 1000000;
+	}
+
+	if (__ni_rtevent_expiry.timer) {
+		if (!timercmp(&expires, &__ni_rtevent_expiry.expires, <))
+			return;
+		if ((__ni_rtevent_expiry.timer = ni_timer_rearm(
+				__ni_rtevent_expiry.timer, timeout)))
+			goto done;
+	}
+	if (!(__ni_rtevent_expiry.timer = ni_timer_register(timeout,
+				__ni_rtevent_expiry_timeout, NULL)))
+		return;
+done:
+	__ni_rtevent_expiry.expires = expires;
+}
+
+static void
+__ni_rtevent_expiry_update(ni_netconfig_t *nc)
+{
+	struct timeval now;
+	ni_netdev_t *dev;
+	ni_address_t *ap;
+
+	if (!nc || !__ni_rtevent_sock)
+		return;
+
+	ni_timer_get_time(&now);
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		for (ap = dev->addrs; ap; ap = ap->next)
+			__ni_rtevent_expiry_arm(ap, &now);
+	}
+}
+
+static void
+__ni_rtevent_expiry_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_address_t *ap, **pos;
+	struct timeval now;
+	ni_netdev_t *dev;
+
+	if (__ni_rtevent_expiry.timer != timer)
+		return;
+
+	__ni_rtevent_expiry.timer = NULL;
+	if (!nc)
+		return;
+
+	ni_timer_get_time(&now);
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		for (pos = &dev->addrs; (ap = *pos); ) {
+			if (ap->cache_info.valid_lft == NI_LIFETIME_INFINITE ||
+			    ni_address_lft_is_valid(ap, &now)) {
+				__ni_rtevent_expiry_arm(ap, &now);
+				pos = &ap->next;
+				continue;
+			}
+
+			ni_debug_events("%s: address %s/%u valid lifetime expired",
+					dev->name, ni_sockaddr_print(&ap->local_addr),
+					ap->prefixlen);
+
+			*pos = ap->next;
+			ap->next = NULL;
+			ni_netdev_unindex_address(dev, ap);
+			__ni_netdev_addr_event(dev, NI_EVENT_ADDRESS_DELETE, ap);
+			ni_address_free(ap);
+		}
+	}
+}
+
+static void
+__ni_rtevent_expiry_destroy(void)
+{
+	if (__ni_rtevent_expiry.timer) {
+		ni_timer_cancel(__ni_rtevent_expiry.timer);
+		__ni_rtevent_expiry.timer = NULL;
+	}
+}
+
 static inline void
 __ni_netinfo_route_event(ni_netconfig_t *nc, ni_event_t ev, const ni_route_t *rp)
 {
@@ -238,7 +604,7 @@ __ni_netdev_process_events(ni_netconfig_t *nc, ni_netdev_t *dev, unsigned int ol
 			continue;
 		if (old_flags & edge->flag) {
 			if (dev->ipv6 && edge->event_down == NI_EVENT_DEVICE_DOWN)
-				ni_ipv6_ra_info_flush(&dev->ipv6->radv);
+				ni_ipv6_ra_info_flush(dev->ipv6->radv);
 
 			if (edge->event_down)
 				ni_uint_array_append(&events, edge->event_down);
@@ -275,11 +641,17 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 	if (!(ifi = ni_rtnl_ifinfomsg(h, RTM_NEWLINK)))
 		return -1;
 
+	/* bridge port changes are sent to the AF_BRIDGE family */
+	old = ni_netdev_by_index(nc, ifi->ifi_index);
+	if (old)
+		ni_sysfs_netif_cache_invalidate(old->name);
+
 	if (ifi->ifi_family == AF_BRIDGE)
 		return 0;
 
-	old = ni_netdev_by_index(nc, ifi->ifi_index);
 	ni_netdev_index_to_name(&ifname, ifi->ifi_index);
+	if (ifname)
+		ni_sysfs_netif_cache_invalidate(ifname);
 	if (!ifname) {
 		/*
 		 * device (index) does not exists any more;
@@ -301,7 +673,7 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 		if (!ni_string_eq(old->name, ifname)) {
 			ni_debug_events("%s[%u]: device renamed to %s",
 					old->name, old->link.ifindex, ifname);
-			ni_string_dup(&old->name, ifname);
+			ni_netconfig_device_rename(nc, old, ifname);
 			__ni_netdev_event(nc, old, NI_EVENT_DEVICE_RENAME);
 		}
 		dev = old;
@@ -343,6 +715,7 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 			 * and when the interface does not exist any more, emit events.
 			 */
 			if (ni_netdev_index_to_name(&conflict->name, conflict->link.ifindex)) {
+				ni_sysfs_netif_cache_invalidate(conflict->name);
 				__ni_netdev_event(nc, conflict, NI_EVENT_DEVICE_RENAME);
 			} else {
 				unsigned int ifflags = conflict->link.ifflags;
@@ -394,6 +767,7 @@ __ni_rtevent_dellink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 	} else {
 		unsigned int old_flags = dev->link.ifflags;
 
+		ni_sysfs_netif_cache_invalidate(dev->name);
 		dev->link.ifflags = __ni_netdev_translate_ifflags(dev->name, ifi->ifi_flags, old_flags);
 		dev->deleted = 1;
 		__ni_netdev_process_events(nc, dev, old_flags);
@@ -412,7 +786,7 @@ int
 __ni_rtevent_newprefix(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struct nlmsghdr *h)
 {
 	struct prefixmsg *pfx;
-	ni_ipv6_devinfo_t *ipv6;
+	ni_ipv6_ra_info_t *radv;
 	ni_ipv6_ra_pinfo_t *pi, *old = NULL;
 	ni_netdev_t *dev;
 
@@ -426,8 +800,8 @@ __ni_rtevent_newprefix(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, str
 		return 0;
 	}
 
-	ipv6 = ni_netdev_get_ipv6(dev);
-	if (!ipv6) {
+	radv = ni_netdev_get_ipv6_ra_info(dev);
+	if (!radv) {
 		ni_error("%s: unable to allocate device ipv6 structure: %m",
 				dev->name);
 		return -1;
@@ -449,10 +823,10 @@ __ni_rtevent_newprefix(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, str
 		return -1;
 	}
 
-	if ((old = ni_ipv6_ra_pinfo_list_remove(&ipv6->radv.pinfo, pi)) != NULL) {
+	if ((old = ni_ipv6_ra_pinfo_list_remove(&radv->pinfo, pi)) != NULL) {
 		if (pi->valid_lft != NI_LIFETIME_EXPIRED) {
-			/* Replace with updated prefix info - most recent in front */
-			ni_ipv6_ra_pinfo_list_prepend(&ipv6->radv.pinfo, pi);
+			/* Replace with updated prefix info - by expiry time */
+			ni_ipv6_ra_pinfo_list_insert(&radv->pinfo, pi);
 			__ni_netdev_prefix_event(dev, NI_EVENT_PREFIX_UPDATE, pi);
 		} else {
 			/* A lifetime of 0 means the router requests a prefix remove;
@@ -462,8 +836,8 @@ __ni_rtevent_newprefix(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, str
 		}
 		free(old);
 	} else if (pi->valid_lft != NI_LIFETIME_EXPIRED) {
-		/* Add prefix info - most recent in front */
-		ni_ipv6_ra_pinfo_list_prepend(&ipv6->radv.pinfo, pi);
+		/* Add prefix info - by expiry time */
+		ni_ipv6_ra_pinfo_list_insert(&radv->pinfo, pi);
 		__ni_netdev_prefix_event(dev, NI_EVENT_PREFIX_UPDATE, pi);
 	} else {
 		/* Request to remove unhandled prefix (missed event?), ignore it. */
@@ -494,6 +868,12 @@ __ni_rtevent_newaddr(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 	if (__ni_netdev_process_newaddr_event(dev, h, ifa, &ap) < 0)
 		return -1;
 
+	if (ap) {
+		struct timeval now;
+
+		ni_timer_get_time(&now);
+		__ni_rtevent_expiry_arm(ap, &now);
+	}
 	__ni_netdev_addr_event(dev, NI_EVENT_ADDRESS_UPDATE, ap);
 	return 0;
 }
@@ -519,8 +899,8 @@ __ni_rtevent_deladdr(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 	}
 
 	/* Remove the address when we track it */
-	if ((ap = ni_address_list_find(dev->addrs, &tmp.local_addr)) != NULL)
-		ni_address_list_delete(&dev->addrs, ap);
+	if ((ap = ni_netdev_find_address(dev, &tmp.local_addr)) != NULL)
+		ni_netdev_delete_address(dev, ap);
 
 	/* Tentative IPv6 addresses are not exposed via NEWADDR events,
 	 * but in manuall address lookup / dump only.
@@ -549,7 +929,7 @@ __ni_rtevent_newroute(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, stru
 		return -1;
 
 	/* filter unwanted / unsupported  msgs */
-	if (ni_rtnl_route_filter_msg(rtm))
+	if (ni_rtnl_route_filter_msg(h, rtm))
 		return 1;
 
 	rp = ni_route_new();
@@ -562,7 +942,7 @@ __ni_rtevent_newroute(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, stru
 		if (!(dev = ni_netdev_by_index(nc, nh->device.index)))
 			continue;
 
-		if (!(r = ni_route_tables_find_match(dev->routes, rp, ni_route_equal)))
+		if (!(r = ni_route_tables_find_prefix_match(dev->routes, rp, ni_route_equal)))
 			continue;
 
 		rp->owner = r->owner;
@@ -591,7 +971,7 @@ __ni_rtevent_delroute(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, stru
 		return -1;
 
 	/* filter unwanted / unsupported  msgs */
-	if (ni_rtnl_route_filter_msg(rtm))
+	if (ni_rtnl_route_filter_msg(h, rtm))
 		return 1;
 
 	rp = ni_route_new();
@@ -604,7 +984,7 @@ __ni_rtevent_delroute(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, stru
 		if (!(dev = ni_netdev_by_index(nc, nh->device.index)))
 			continue;
 
-		if (!(r = ni_route_tables_find_match(dev->routes, rp, ni_route_equal)))
+		if (!(r = ni_route_tables_find_prefix_match(dev->routes, rp, ni_route_equal)))
 			continue;
 
 		__ni_netinfo_route_event(nc, NI_EVENT_ROUTE_DELETE, r);
@@ -681,7 +1061,7 @@ __ni_rtevent_process_rdnss_info(ni_netdev_t *dev, const struct nd_opt_hdr *opt,
 	const struct ni_nd_opt_rdnss_info_p *ropt;
 	char buf[INET6_ADDRSTRLEN+1] = {'\0'};
 	const struct in6_addr* addr;
-	ni_ipv6_devinfo_t *ipv6;
+	ni_ipv6_ra_info_t *radv;
 	unsigned int lifetime;
 	struct timeval acquired;
 	ni_bool_t emit = FALSE;
@@ -693,8 +1073,8 @@ __ni_rtevent_process_rdnss_info(ni_netdev_t *dev, const struct nd_opt_hdr *opt,
 		return -1;
 	}
 
-	ipv6 = ni_netdev_get_ipv6(dev);
-	if (!ipv6) {
+	radv = ni_netdev_get_ipv6_ra_info(dev);
+	if (!radv) {
 		ni_error("%s: unable to allocate device ipv6 structure: %m",
 				dev->name);
 		return -1;
@@ -715,7 +1095,7 @@ __ni_rtevent_process_rdnss_info(ni_netdev_t *dev, const struct nd_opt_hdr *opt,
 			continue;
 		}
 
-		if (!ni_ipv6_ra_rdnss_list_update(&ipv6->radv.rdnss, addr,
+		if (!ni_ipv6_ra_rdnss_list_update(&radv->rdnss, addr,
 					lifetime, &acquired)) {
 			server = inet_ntop(AF_INET6, addr, buf, sizeof(buf));
 			ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_IPV6|NI_TRACE_EVENTS,
@@ -736,7 +1116,7 @@ static int
 __ni_rtevent_process_dnssl_info(ni_netdev_t *dev, const struct nd_opt_hdr *opt, size_t len)
 {
 	const struct ni_nd_opt_dnssl_info_p *dopt;
-	ni_ipv6_devinfo_t *ipv6;
+	ni_ipv6_ra_info_t *radv;
 	unsigned int lifetime;
 	struct timeval acquired;
 	size_t length, cnt, off;
@@ -749,8 +1129,8 @@ __ni_rtevent_process_dnssl_info(ni_netdev_t *dev, const struct nd_opt_hdr *opt,
 		return -1;
 	}
 
-	ipv6 = ni_netdev_get_ipv6(dev);
-	if (!ipv6) {
+	radv = ni_netdev_get_ipv6_ra_info(dev);
+	if (!radv) {
 		ni_error("%s: unable to allocate device ipv6 structure: %m",
 				dev->name);
 		return -1;
@@ -777,7 +1157,7 @@ __ni_rtevent_process_dnssl_info(ni_netdev_t *dev, const struct nd_opt_hdr *opt,
 					"%s: ignoring suspect DNSSL domain: %s",
 					dev->name, ni_print_suspect(domain, length));
 			} else
-			if (!ni_ipv6_ra_dnssl_list_update(&ipv6->radv.dnssl,
+			if (!ni_ipv6_ra_dnssl_list_update(&radv->dnssl,
 						domain, lifetime, &acquired)) {
 				ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_IPV6|NI_TRACE_EVENTS,
 						"%s: unable to track ipv6 dnssl domain %s",
@@ -911,24 +1291,175 @@ __ni_rtevent_process_cb(struct nl_msg *msg, void *ptr)
 	if ((nc = ni_global_state_handle(0)) == NULL)
 		return NL_SKIP;
 
+	if (__ni_rtevent_discard)
+		return NL_SKIP;
+
 	if (sender->nl_pid != 0) {
 		ni_error("ignoring rtnetlink event message from PID %u",
 			sender->nl_pid);
 		return NL_SKIP;
 	}
 
+	ni_stats_rtnl_event(sender->nl_groups);
+
 	nlh = nlmsg_hdr(msg);
+	NI_PROBE2(rtnl_event, nlh->nlmsg_type, sender->nl_groups);
 	if (__ni_rtevent_process(nc, sender, nlh) < 0) {
+		NI_PROBE2(rtnl_event_done, nlh->nlmsg_type, -1);
 		ni_debug_events("ignoring %s rtnetlink event",
 			ni_rtnl_msg_type_to_name(nlh->nlmsg_type, "unknown"));
 		return NL_SKIP;
 	}
+	NI_PROBE2(rtnl_event_done, nlh->nlmsg_type, 0);
 
 	return NL_OK;
 }
 
 static ni_bool_t	__ni_rtevent_restart(ni_socket_t *sock);
+static void		__ni_rtevent_grow_recv_buff(ni_rtevent_handle_t *);
 
+/*
+ * Incremental refresh support: once the state has been dumped
+ * with the event socket listening, the events keep it in sync
+ * and only lost events (overrun, socket restart) need a resync.
+ */
+ni_bool_t
+__ni_rtevent_incremental_refresh(void)
+{
+	if (!ni_global.config || ni_global.config->rtnl_event.refresh !=
+			NI_CONFIG_RTNL_REFRESH_INCREMENTAL)
+		return FALSE;
+
+	return __ni_rtevent_sock && __ni_rtevent_sock->active && __ni_rtevent_synced;
+}
+
+void
+__ni_rtevent_refresh_synced(void)
+{
+	/* the events are not monitored in other namespaces */
+	if (ni_netns_current())
+		return;
+
+	__ni_rtevent_synced = __ni_rtevent_sock != NULL;
+	__ni_rtevent_expiry_update(ni_global_state_handle(0));
+}
+
+typedef struct ni_rtevent_resync_dev {
+	unsigned int		ifindex;
+	unsigned int		ifflags;
+} ni_rtevent_resync_dev_t;
+
+static int
+__ni_rtevent_resync_dev_cmp(const void *a, const void *b)
+{
+	const ni_rtevent_resync_dev_t *da = a;
+	const ni_rtevent_resync_dev_t *db = b;
+
+	return da->ifindex > db->ifindex ? 1 : da->ifindex < db->ifindex ? -1 : 0;
+}
+
+/*
+ * Dump the current state after lost events and emit the device
+ * events we've missed, comparing with the state before the dump.
+ */
+static void
+__ni_rtevent_resync(ni_netconfig_t *nc)
+{
+	ni_rtevent_resync_dev_t *known = NULL, *old, key;
+	ni_netdev_t *dev, *del_list = NULL;
+	unsigned int count = 0, flags;
+	struct timeval started;
+
+	ni_timer_get_time(&started);
+	__ni_rtevent_synced = FALSE;
+	__ni_global_rtnl_refresh_stats.resync++;
+	ni_sysfs_netif_cache_invalidate(NULL);
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+		count++;
+
+	if (count && !(known = calloc(count, sizeof(*known)))) {
+		ni_error("unable to allocate rtnetlink resync device state");
+		__ni_system_refresh_all(nc, NULL);
+		ni_stats_netlink_dump("resync", &started);
+		return;
+	}
+
+	count = 0;
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		known[count].ifindex = dev->link.ifindex;
+		known[count].ifflags = dev->link.ifflags;
+		count++;
+	}
+	if (count)
+		qsort(known, count, sizeof(*known), __ni_rtevent_resync_dev_cmp);
+
+	ni_note("resyncing state after lost rtnetlink events");
+	if (__ni_system_refresh_all(nc, &del_list) < 0)
+		ni_error("unable to resync state after lost rtnetlink events");
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		key.ifindex = dev->link.ifindex;
+		old = count ? bsearch(&key, known, count, sizeof(*known),
+				__ni_rtevent_resync_dev_cmp) : NULL;
+		if (!old) {
+			dev->created = 1;
+			__ni_netdev_process_events(nc, dev, 0);
+		} else
+		if (old->ifflags != dev->link.ifflags) {
+			__ni_netdev_process_events(nc, dev, old->ifflags);
+		}
+	}
+
+	while ((dev = del_list) != NULL) {
+		del_list = dev->next;
+		dev->next = NULL;
+
+		flags = dev->link.ifflags;
+		dev->link.ifflags = 0;
+		dev->deleted = 1;
+		__ni_netdev_process_events(nc, dev, flags);
+		ni_client_state_drop(dev->link.ifindex);
+		ni_netdev_put(dev);
+	}
+	free(known);
+	ni_stats_netlink_dump("resync", &started);
+}
+
+/*
+ * Discard the events still queued after an overrun, they're
+ * older than the state we're going to dump.
+ */
+static void
+__ni_rtevent_drain(ni_rtevent_handle_t *handle)
+{
+	int ret;
+
+	__ni_rtevent_discard = TRUE;
+	do {
+		ret = nl_recvmsgs_default(handle->nlsock);
+	} while (ret == NLE_SUCCESS || ret == -NLE_INTR || ret == -NLE_NOMEM);
+	__ni_rtevent_discard = FALSE;
+}
+
+/*
+ * The kernel dropped events for us (ENOBUFS): discard the queued
+ * stale events, grow the receive buffer and resync the state.
+ */
+static void
+__ni_rtevent_overrun(ni_rtevent_handle_t *handle)
+{
+	ni_netconfig_t *nc;
+
+	__ni_global_rtnl_refresh_stats.overrun++;
+	ni_warn("rtnetlink event receive buffer overrun (%lu)",
+			__ni_global_rtnl_refresh_stats.overrun);
+
+	__ni_rtevent_drain(handle);
+	__ni_rtevent_grow_recv_buff(handle);
+	if ((nc = ni_global_state_handle(0)))
+		__ni_rtevent_resync(nc);
+}
 
 /*
  * Receive netlink message and trigger processing by callback
@@ -937,6 +1468,7 @@ static void
 __ni_rtevent_receive(ni_socket_t *sock)
 {
 	ni_rtevent_handle_t *handle = sock->user_data;
+	ni_netconfig_t *nc;
 	int ret;
 
 	if (handle && handle->nlsock) {
@@ -949,11 +1481,17 @@ __ni_rtevent_receive(ni_socket_t *sock)
 		case -NLE_AGAIN:
 			break;
 
+		case -NLE_NOMEM:
+			__ni_rtevent_overrun(handle);
+			break;
+
 		default:
 			ni_error("rtnetlink event receive error: %s (%m)",
 					nl_geterror(ret));
 			if (__ni_rtevent_restart(sock)) {
 				ni_note("restarted rtnetlink event listener");
+				if ((nc = ni_global_state_handle(0)))
+					__ni_rtevent_resync(nc);
 			} else {
 				ni_error("unable to restart rtnetlink event listener");
 			}
@@ -1024,9 +1562,30 @@ __ni_rtevent_join_group(ni_rtevent_handle_t *handle, unsigned int group)
 static void
 __ni_rtevent_sock_error_handler(ni_socket_t *sock)
 {
+	ni_rtevent_handle_t *handle = sock->user_data;
+	socklen_t len = sizeof(int);
+	ni_netconfig_t *nc;
+	int err = 0;
+
+	/*
+	 * An overrun is reported as socket error too; the socket is
+	 * still usable, so recover and reactivate it without to reopen.
+	 */
+	if (handle && handle->nlsock &&
+	    getsockopt(sock->__fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 &&
+	    err == ENOBUFS) {
+		__ni_rtevent_overrun(handle);
+		ni_socket_activate(sock);
+		return;
+	}
+
+	if (err)
+		errno = err;
 	ni_error("poll error on rtnetlink event socket: %m");
 	if (__ni_rtevent_restart(sock)) {
 		ni_note("restarted rtnetlink event listener");
+		if ((nc = ni_global_state_handle(0)))
+			__ni_rtevent_resync(nc);
 	} else {
 		ni_error("unable to restart rtnetlink event listener");
 	}
@@ -1044,16 +1603,68 @@ __ni_rtevent_config_recv_buff_len(void)
 	return ni_global.config ? ni_global.config->rtnl_event.recv_buff_length : 0;
 }
 
+static unsigned int
+__ni_rtevent_config_recv_buff_max(void)
+{
+	return ni_global.config ? ni_global.config->rtnl_event.recv_buff_max_length : 0;
+}
+
 static unsigned int
 __ni_rtevent_config_mesg_buff_len(void)
 {
 	return ni_global.config ? ni_global.config->rtnl_event.mesg_buff_length : 0;
 }
 
+static ni_bool_t
+__ni_rtevent_set_recv_buff_len(int fd, unsigned int len)
+{
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, (char *)&len, sizeof(len)) &&
+	    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char *)&len, sizeof(len)))
+		return FALSE;
+	return TRUE;
+}
+
+/*
+ * Double the receive buffer after an overrun, up to the configured
+ * maximum, so a burst of events does not cost a resync every time.
+ */
+static void
+__ni_rtevent_grow_recv_buff(ni_rtevent_handle_t *handle)
+{
+	unsigned int max = __ni_rtevent_config_recv_buff_max();
+	unsigned int len = __ni_rtevent_recv_buff_len;
+	socklen_t optlen = sizeof(len);
+	int fd;
+
+	if (!handle || !handle->nlsock || !max)
+		return;
+
+	fd = nl_socket_get_fd(handle->nlsock);
+	if (!len) {
+		/* the kernel reports the doubled (bookkeeping) length */
+		if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char *)&len, &optlen) < 0)
+			return;
+		len /= 2;
+	}
+	if (len >= max)
+		return;
+
+	len = len > max / 2 ? max : len * 2;
+	if (!__ni_rtevent_set_recv_buff_len(fd, len)) {
+		ni_warn("Unable to grow netlink event receive buffer to %u bytes: %m", len);
+		return;
+	}
+
+	__ni_rtevent_recv_buff_len = len;
+	__ni_global_rtnl_refresh_stats.grown++;
+	ni_info("Grown netlink event receive buffer to %u bytes", len);
+}
+
 static ni_socket_t *
 __ni_rtevent_sock_open(void)
 {
-	unsigned int recv_buff_len = __ni_rtevent_config_recv_buff_len();
+	unsigned int recv_buff_len = max_t(unsigned int, __ni_rtevent_recv_buff_len,
+						__ni_rtevent_config_recv_buff_len());
 	unsigned int mesg_buff_len = __ni_rtevent_config_mesg_buff_len();
 	ni_rtevent_handle_t *handle;
 	ni_socket_t *sock;
@@ -1097,10 +1708,7 @@ __ni_rtevent_sock_open(void)
 	}
 
 	if (recv_buff_len) {
-		if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE,
-				(char *)&recv_buff_len, sizeof(recv_buff_len)) &&
-		    setsockopt(fd, SOL_SOCKET, SO_RCVBUF,
-				(char *)&recv_buff_len, sizeof(recv_buff_len))) {
+		if (!__ni_rtevent_set_recv_buff_len(fd, recv_buff_len)) {
 			ni_warn("Unable to set netlink event receive buffer to %u bytes: %m",
 					recv_buff_len);
 		} else {
@@ -1126,6 +1734,156 @@ __ni_rtevent_sock_open(void)
 	return sock;
 }
 
+/*
+ * A lightweight address event monitor for applications which do not
+ * track the netconfig state (e.g. to wait for the dad completion in
+ * the client), reporting the parsed NEWADDR events as UPDATE and the
+ * DELADDR events as DELETE with the interface index.
+ * A NULL address is reported when the kernel dropped events.
+ */
+typedef struct ni_addr_monitor {
+	struct nl_sock *		nlsock;
+	unsigned int			family;
+	ni_addr_monitor_handler_t *	handler;
+	void *				user_data;
+} ni_addr_monitor_t;
+
+static int
+ni_addr_monitor_process(struct nl_msg *msg, void *ptr)
+{
+	ni_addr_monitor_t *mon = ptr;
+	struct nlmsghdr *h = nlmsg_hdr(msg);
+	struct ifaddrmsg *ifa;
+	ni_address_t tmp;
+	ni_event_t event;
+
+	switch (h->nlmsg_type) {
+	case RTM_NEWADDR:
+		event = NI_EVENT_ADDRESS_UPDATE;
+		break;
+	case RTM_DELADDR:
+		event = NI_EVENT_ADDRESS_DELETE;
+		break;
+	default:
+		return NL_SKIP;
+	}
+
+	if (!(ifa = ni_rtnl_ifaddrmsg(h, h->nlmsg_type)))
+		return NL_SKIP;
+
+	if (mon->family != AF_UNSPEC && mon->family != ifa->ifa_family)
+		return NL_SKIP;
+
+	if (__ni_rtnl_parse_newaddr("address monitor", 0, h, ifa, &tmp) < 0)
+		return NL_SKIP;
+
+	mon->handler(ifa->ifa_index, event, &tmp, mon->user_data);
+	ni_string_free(&tmp.label);
+	return NL_OK;
+}
+
+static void
+ni_addr_monitor_receive(ni_socket_t *sock)
+{
+	ni_addr_monitor_t *mon = sock->user_data;
+	int ret;
+
+	if (!mon || !mon->nlsock)
+		return;
+
+	do {
+		ret = nl_recvmsgs_default(mon->nlsock);
+	} while (ret == NLE_SUCCESS || ret == -NLE_INTR);
+
+	if (ret == -NLE_NOMEM) {
+		/* ENOBUFS: the kernel dropped events for us */
+		do {
+			ret = nl_recvmsgs_default(mon->nlsock);
+		} while (ret == NLE_SUCCESS || ret == -NLE_INTR || ret == -NLE_NOMEM);
+		mon->handler(0, NI_EVENT_ADDRESS_UPDATE, NULL, mon->user_data);
+	} else
+	if (ret != -NLE_AGAIN) {
+		ni_error("address monitor receive error: %s", nl_geterror(ret));
+	}
+}
+
+static void
+ni_addr_monitor_close(ni_socket_t *sock)
+{
+	ni_addr_monitor_t *mon = sock->user_data;
+
+	if (mon && mon->nlsock) {
+		nl_socket_free(mon->nlsock);
+		mon->nlsock = NULL;
+	}
+}
+
+static void
+ni_addr_monitor_release_data(void *user_data)
+{
+	ni_addr_monitor_t *mon = user_data;
+
+	if (mon) {
+		if (mon->nlsock)
+			nl_socket_free(mon->nlsock);
+		free(mon);
+	}
+}
+
+ni_socket_t *
+ni_addr_monitor_open(unsigned int family, ni_addr_monitor_handler_t *handler, void *user_data)
+{
+	ni_addr_monitor_t *mon;
+	ni_socket_t *sock;
+	int ret;
+
+	if (!handler || !(mon = calloc(1, sizeof(*mon))))
+		return NULL;
+
+	mon->family = family;
+	mon->handler = handler;
+	mon->user_data = user_data;
+	if (!(mon->nlsock = nl_socket_alloc())) {
+		ni_error("Cannot allocate address monitor socket: %m");
+		ni_addr_monitor_release_data(mon);
+		return NULL;
+	}
+
+	nl_socket_modify_cb(mon->nlsock, NL_CB_VALID, NL_CB_CUSTOM,
+				ni_addr_monitor_process, mon);
+	nl_socket_disable_seq_check(mon->nlsock);
+
+	if ((ret = nl_connect(mon->nlsock, NETLINK_ROUTE)) < 0) {
+		ni_error("Cannot open rtnetlink: %s", nl_geterror(ret));
+		ni_addr_monitor_release_data(mon);
+		return NULL;
+	}
+
+	if ((family != AF_INET6 && (ret = nl_socket_add_membership(mon->nlsock,
+						RTNLGRP_IPV4_IFADDR)) < 0) ||
+	    (family != AF_INET  && (ret = nl_socket_add_membership(mon->nlsock,
+						RTNLGRP_IPV6_IFADDR)) < 0)) {
+		ni_error("Cannot add rtnetlink address group membership: %s",
+				nl_geterror(ret));
+		ni_addr_monitor_release_data(mon);
+		return NULL;
+	}
+	nl_socket_set_nonblocking(mon->nlsock);
+
+	if (!(sock = ni_socket_wrap(nl_socket_get_fd(mon->nlsock), SOCK_DGRAM))) {
+		ni_error("Cannot wrap address monitor socket: %m");
+		ni_addr_monitor_release_data(mon);
+		return NULL;
+	}
+
+	sock->user_data = mon;
+	sock->receive = ni_addr_monitor_receive;
+	sock->close = ni_addr_monitor_close;
+	sock->release_user_data = ni_addr_monitor_release_data;
+	ni_socket_activate(sock);
+	return sock;
+}
+
 static ni_bool_t
 __ni_rtevent_restart(ni_socket_t *sock)
 {
@@ -1134,6 +1892,7 @@ __ni_rtevent_restart(ni_socket_t *sock)
 
 	ni_assert(sock == __ni_rtevent_sock);
 
+	__ni_rtevent_synced = FALSE;
 	handle = sock->user_data;
 	if ((__ni_rtevent_sock = __ni_rtevent_sock_open())) {
 		const ni_uint_array_t *groups = &handle->groups;
@@ -1180,6 +1939,7 @@ ni_server_listen_interface_events(void (*ifevent_handler)(ni_netdev_t *, ni_even
 	}
 	ni_global.interface_event = ifevent_handler;
 	ni_socket_activate(__ni_rtevent_sock);
+	ni_sysfs_netif_cache_enable(TRUE);
 	return 0;
 }
 
@@ -1188,6 +1948,9 @@ ni_server_trace_interface_addr_events(ni_netdev_t *dev, ni_event_t event, const
 {
 	ni_stringbuf_t flags = NI_STRINGBUF_INIT_DYNAMIC;
 
+	if (!ni_debug_guard(NI_LOG_DEBUG2, NI_TRACE_IPV6|NI_TRACE_EVENTS))
+		return;
+
 	ni_address_format_flags(&flags, ap->family, ap->flags, NULL);
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_IPV6|NI_TRACE_EVENTS,
 			"%s: %s event: %s flags[%u] %s",
@@ -1228,12 +1991,13 @@ ni_server_trace_interface_prefix_events(ni_netdev_t *dev, ni_event_t event, cons
 	char vbuf[32] = {'\0'}, pbuf[32] = {'\0'};
 	ni_stringbuf_t vlft = NI_STRINGBUF_INIT_BUFFER(vbuf);
 	ni_stringbuf_t plft = NI_STRINGBUF_INIT_BUFFER(pbuf);
+	const ni_ipv6_ra_info_t *radv = dev->ipv6 ? dev->ipv6->radv : NULL;
 
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_IPV6|NI_TRACE_EVENTS,
 		"%s: %s IPv6 RA<%s> Prefix<%s/%u %s,%s>[%s,%s]", dev->name,
 		(event == NI_EVENT_PREFIX_UPDATE ? "update" : "delete"),
-		(dev->ipv6 && dev->ipv6->radv.managed_addr ? "managed" :
-		(dev->ipv6 && dev->ipv6->radv.other_config ? "config" : "unmanaged")),
+		(radv && radv->managed_addr ? "managed" :
+		(radv && radv->other_config ? "config" : "unmanaged")),
 		ni_sockaddr_print(&pi->prefix), pi->length,
 		(pi->on_link ? "onlink" : "not-onlink"),
 		(pi->autoconf ? "autoconf" : "no-autoconf"),
@@ -1266,22 +2030,22 @@ ni_server_enable_interface_prefix_events(void (*ifprefix_handler)(ni_netdev_t *,
 void
 ni_server_trace_interface_nduseropt_events(ni_netdev_t *dev, ni_event_t event)
 {
-	ni_ipv6_devinfo_t *ipv6 = dev->ipv6;
+	const ni_ipv6_ra_info_t *radv = dev->ipv6 ? dev->ipv6->radv : NULL;
 
 	if (!ni_debug_guard(NI_LOG_DEBUG2, NI_TRACE_IPV6|NI_TRACE_EVENTS))
 		return;
 
 	switch (event) {
 	case NI_EVENT_RDNSS_UPDATE:
-		if (ipv6 && ipv6->radv.rdnss) {
+		if (radv && radv->rdnss) {
 			ni_ipv6_ra_rdnss_t *rdnss;
 			char buf[32] = {'\0'};
 			const char *rainfo;
 
-			rainfo = ipv6->radv.managed_addr ? "managed" :
-				 ipv6->radv.other_config ? "config"  : "unmanaged";
+			rainfo = radv->managed_addr ? "managed" :
+				 radv->other_config ? "config"  : "unmanaged";
 
-			for (rdnss = ipv6->radv.rdnss; rdnss; rdnss = rdnss->next) {
+			for (rdnss = radv->rdnss; rdnss; rdnss = rdnss->next) {
 				ni_stringbuf_t lft = NI_STRINGBUF_INIT_BUFFER(buf);
 
 				ni_trace("%s: update IPv6 RA<%s> RDNSS<%s>[%s]",
@@ -1294,14 +2058,14 @@ ni_server_trace_interface_nduseropt_events(ni_netdev_t *dev, ni_event_t event)
 		break;
 
 	case NI_EVENT_DNSSL_UPDATE:
-		if (ipv6 && ipv6->radv.dnssl) {
+		if (radv && radv->dnssl) {
 			ni_ipv6_ra_dnssl_t *dnssl;
 			char buf[32] = {'\0'};
 			const char *rainfo;
 
-			rainfo = ipv6->radv.managed_addr ? "managed" :
-				 ipv6->radv.other_config ? "config"  : "unmanaged";
-			for (dnssl = ipv6->radv.dnssl; dnssl; dnssl = dnssl->next) {
+			rainfo = radv->managed_addr ? "managed" :
+				 radv->other_config ? "config"  : "unmanaged";
+			for (dnssl = radv->dnssl; dnssl; dnssl = dnssl->next) {
 				ni_stringbuf_t lft = NI_STRINGBUF_INIT_BUFFER(buf);
 
 				ni_trace("%s: update IPv6 RA<%s> DNSSL<%s>[%s]",
@@ -1436,6 +2200,9 @@ void
 ni_server_deactivate_interface_events(void)
 {
 	ni_server_deactivate_interface_uevents();
+	ni_sysfs_netif_cache_enable(FALSE);
+	__ni_rtevent_coalesce_destroy();
+	__ni_rtevent_expiry_destroy();
 
 	if (__ni_rtevent_sock) {
 		ni_socket_t *sock = __ni_rtevent_sock;
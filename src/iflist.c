@@ -115,6 +115,103 @@ retry:
 	return rv;
 }
 
+/*
+ * Query the routes applying the configured route filter tables and
+ * protocols as well as the outgoing interface as strict dump filter,
+ * so the kernel does not send routes we would discard anyway.
+ */
+static int
+__ni_rtnl_query_route_dump(struct ni_nlmsg_list *list, int af, unsigned int table,
+				unsigned int protocol, unsigned int oif)
+{
+	struct rtmsg rtm;
+	struct nl_msg *msg;
+	int rv;
+
+	if (!(msg = nlmsg_alloc_simple(RTM_GETROUTE, NLM_F_DUMP)))
+		return -NLE_NOMEM;
+
+	memset(&rtm, 0, sizeof(rtm));
+	rtm.rtm_family = af;
+	rtm.rtm_table = table < 256 ? table : RT_TABLE_UNSPEC;
+	rtm.rtm_protocol = protocol;
+
+	if (nlmsg_append(msg, &rtm, sizeof(rtm), NLMSG_ALIGNTO) < 0
+	 || (table && nla_put_u32(msg, RTA_TABLE, table) < 0)
+	 || (oif && nla_put_u32(msg, RTA_OIF, oif) < 0)) {
+		nlmsg_free(msg);
+		return -NLE_NOMEM;
+	}
+
+	rv = ni_nl_dump_store_strict(msg, TRUE, list);
+	nlmsg_free(msg);
+
+	/* dump of a table which does not exist (yet) */
+	return rv == -NLE_OBJ_NOTFOUND ? NLE_SUCCESS : rv;
+}
+
+static int
+__ni_rtnl_query_routes(struct ni_rtnl_info *qr, int af, unsigned int oif)
+{
+	const ni_config_route_filter_t *filter = ni_config_route_filter();
+	ni_uint_array_t managed = NI_UINT_ARRAY_INIT;
+	const ni_uint_array_t *tables = NULL;
+	unsigned int t, tcount, p, pcount, table, protocol;
+	int rv;
+
+	if (filter && ni_config_route_filter_managed_tables()) {
+		/* dump the main and the tables referenced by leases only */
+		ni_uint_array_append(&managed, RT_TABLE_MAIN);
+		if ((tables = ni_netconfig_route_tables(ni_global_state_handle(0)))) {
+			for (t = 0; t < tables->count; ++t) {
+				if (!ni_uint_array_contains(&managed, tables->data[t]))
+					ni_uint_array_append(&managed, tables->data[t]);
+			}
+		}
+		tables = &managed;
+	} else
+	if (filter) {
+		tables = &filter->tables;
+	}
+
+	if (!filter || (!tables->count && !filter->protocols.count && !oif)) {
+		if (filter && af == AF_UNSPEC)
+			af = filter->family;
+		return __ni_rtnl_query(qr, af, RTM_GETROUTE);
+	}
+
+	if (af == AF_UNSPEC)
+		af = filter->family;
+	tcount = max_t(unsigned int, tables->count, 1);
+	pcount = max_t(unsigned int, filter->protocols.count, 1);
+
+	ni_nlmsg_list_init(&qr->nlmsg_list);
+retry:
+	rv = NLE_SUCCESS;
+	for (t = 0; rv == NLE_SUCCESS && t < tcount; ++t) {
+		table = tables->count ? tables->data[t] : 0;
+
+		for (p = 0; rv == NLE_SUCCESS && p < pcount; ++p) {
+			protocol = filter->protocols.count ? filter->protocols.data[p] : 0;
+			rv = __ni_rtnl_query_route_dump(&qr->nlmsg_list, af, table, protocol, oif);
+		}
+	}
+
+	switch (rv) {
+	case NLE_SUCCESS:
+		qr->entry = qr->nlmsg_list.head;
+		break;
+	case -NLE_DUMP_INTR:
+		ni_nlmsg_list_destroy(&qr->nlmsg_list);
+		goto retry;
+	default:
+		qr->entry = NULL;
+		break;
+	}
+	ni_uint_array_destroy(&managed);
+	return rv;
+}
+
 static inline struct nlmsghdr *
 __ni_rtnl_info_next(struct ni_rtnl_info *qr)
 {
@@ -147,7 +244,7 @@ ni_rtnl_query(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family
 	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK) < 0
 	 || (family != AF_INET && __ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK) < 0)
 	 || __ni_rtnl_query(&q->addr_info, family, RTM_GETADDR) < 0
-	 || __ni_rtnl_query(&q->route_info, family, RTM_GETROUTE) < 0) {
+	 || __ni_rtnl_query_routes(&q->route_info, family, 0) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -254,11 +351,11 @@ ni_rtnl_query_next_addr_info(struct ni_rtnl_query *q, struct nlmsghdr **hp)
 }
 
 static int
-ni_rtnl_query_route_info(struct ni_rtnl_query *q, unsigned int family)
+ni_rtnl_query_route_info(struct ni_rtnl_query *q, unsigned int family, unsigned int oif)
 {
 	memset(q, 0, sizeof(*q));
 
-	if (__ni_rtnl_query(&q->route_info, family, RTM_GETROUTE) < 0) {
+	if (__ni_rtnl_query_routes(&q->route_info, family, oif) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -323,13 +420,15 @@ ni_address_list_reset_seq(ni_address_t *addrs)
 }
 
 static void
-ni_address_list_drop_by_seq(ni_address_t **tail, unsigned int seq)
+ni_address_list_drop_by_seq(ni_netdev_t *dev, unsigned int seq)
 {
+	ni_address_t **tail = &dev->addrs;
 	ni_address_t *ap;
 
 	while ((ap = *tail)) {
 		if (ap->seq != seq) {
 			*tail = ap->next;
+			ni_netdev_unindex_address(dev, ap);
 			ni_address_free(ap);
 		} else {
 			tail = &ap->next;
@@ -357,15 +456,15 @@ ni_route_tables_reset_seq(ni_route_table_t *tab)
 }
 
 static void
-ni_route_array_drop_by_seq(ni_netconfig_t *nc, ni_route_array_t *routes, unsigned int seq)
+ni_route_table_drop_by_seq(ni_netconfig_t *nc, ni_route_table_t *tab, unsigned int seq)
 {
 	unsigned int i;
 	ni_route_t *rp;
 
-	for (i = 0; i < routes->count; ) {
-		rp = routes->data[i];
+	for (i = 0; i < tab->routes.count; ) {
+		rp = tab->routes.data[i];
 		if (rp->seq != seq) {
-			if (ni_route_array_remove_at(routes, i) == rp) {
+			if (ni_route_table_remove_at(tab, i) == rp) {
 				ni_netconfig_route_del(nc, rp, NULL);
 				ni_route_free(rp);
 				continue;
@@ -379,7 +478,7 @@ static void
 ni_route_tables_drop_by_seq(ni_netconfig_t *nc, ni_route_table_t *tab, unsigned int seq)
 {
 	for ( ; tab; tab = tab->next)
-		ni_route_array_drop_by_seq(nc, &tab->routes, seq);
+		ni_route_table_drop_by_seq(nc, tab, seq);
 }
 
 static void
@@ -507,6 +606,14 @@ int
 __ni_system_refresh_interfaces(ni_netconfig_t *nc)
 {
 	ni_assert(nc == ni_global_state_handle(0));
+
+	/* state is kept up-to-date by the rtnetlink events */
+	if (__ni_rtevent_incremental_refresh()) {
+		__ni_global_rtnl_refresh_stats.skipped++;
+		ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
+				"Full refresh of all interfaces skipped (incremental)");
+		return 0;
+	}
 	return __ni_system_refresh_all(nc, NULL);
 }
 
@@ -557,21 +664,18 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 
 		/* Create interface if it doesn't exist. */
 		if ((dev = ni_netdev_by_index(nc, ifi->ifi_index)) == NULL) {
-			ni_pci_dev_t *pci_dev;
-
+			/* the pci device info is looked up on first use */
 			dev = ni_netdev_new(ifname, ifi->ifi_index);
 			if (!dev)
 				goto failed;
 
-			if ((pci_dev = ni_sysfs_netdev_get_pci(ifname)) != NULL)
-				ni_netdev_set_pci(dev, pci_dev);
-
-			/* FIXME: use ni_netconfig_device_append() */
+			/* append to the tail we're tracking and index it */
 			*tail = dev;
 			tail = &dev->next;
+			ni_netconfig_device_hash_insert(nc, dev);
 		} else {
 			if (!ni_string_eq(dev->name, ifname))
-				ni_string_dup(&dev->name, ifname);
+				ni_netconfig_device_rename(nc, dev, ifname);
 
 			/* Clear out addresses and routes */
 			ni_address_list_reset_seq(dev->addrs);
@@ -583,6 +687,7 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 		if (__ni_netdev_process_newlink(dev, h, ifi, nc) < 0)
 			ni_error("Problem parsing RTM_NEWLINK message for %s", ifname);
 	}
+	ni_system_ethtool_refresh_all(nc);
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
 		__ni_refresh_bind_master(nc, dev);
@@ -628,10 +733,11 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 	/* Cull any interfaces that went away */
 	tail = ni_netconfig_device_list_head(nc);
 	while ((dev = *tail) != NULL) {
-		ni_address_list_drop_by_seq(&dev->addrs, seqno);
+		ni_address_list_drop_by_seq(dev, seqno);
 		ni_route_tables_drop_by_seq(nc, dev->routes, seqno);
 		if (dev->seq != seqno) {
 			*tail = dev->next;
+			ni_netconfig_device_hash_remove(nc, dev);
 			if (del_list == NULL) {
 				__ni_refresh_unbind_master(nc, dev);
 				ni_client_state_drop(dev->link.ifindex);
@@ -652,6 +758,8 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 	if (!ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_ROUTE_RULES))
 		(void)__ni_system_refresh_rules(nc);
 
+	__ni_global_rtnl_refresh_stats.full++;
+	__ni_rtevent_refresh_synced();
 	res = 0;
 
 failed:
@@ -696,7 +804,7 @@ __ni_system_refresh_interface(ni_netconfig_t *nc, ni_netdev_t *dev)
 
 		ifname = nla_get_string(nla);
 		if (!ni_string_eq(dev->name, ifname))
-			ni_string_dup(&dev->name, ifname);
+			ni_netconfig_device_rename(nc, dev, ifname);
 
 		/* Clear out addresses and routes */
 		dev->seq = __ni_global_seqno;
@@ -716,7 +824,7 @@ __ni_system_refresh_interface(ni_netconfig_t *nc, ni_netdev_t *dev)
 		if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
 			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
 	}
-	ni_address_list_drop_by_seq(&dev->addrs, dev->seq);
+	ni_address_list_drop_by_seq(dev, dev->seq);
 
 	while (1) {
 		struct rtmsg *rtm;
@@ -779,7 +887,7 @@ __ni_system_refresh_addrs(ni_netconfig_t *nc, unsigned int family)
 	}
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
-		ni_address_list_drop_by_seq(&dev->addrs, seqno);
+		ni_address_list_drop_by_seq(dev, seqno);
 
 	res = 0;
 
@@ -816,7 +924,7 @@ __ni_system_refresh_interface_addrs(ni_netconfig_t *nc, ni_netdev_t *dev)
 		if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
 			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
 	}
-	ni_address_list_drop_by_seq(&dev->addrs, dev->seq);
+	ni_address_list_drop_by_seq(dev, dev->seq);
 
 	res = 0;
 
@@ -882,7 +990,8 @@ __ni_system_refresh_routes(ni_netconfig_t *nc)
 		seqno = ++__ni_global_seqno;
 	} while (!seqno);
 
-	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
+	ni_netconfig_route_tables_update(nc);
+	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc), 0) < 0)
 		goto failed;
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
@@ -923,7 +1032,8 @@ __ni_system_refresh_interface_routes(ni_netconfig_t *nc, ni_netdev_t *dev)
 		dev->seq = ++__ni_global_seqno;
 	} while (!dev->seq);
 
-	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
+	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc),
+				dev->link.ifindex) < 0)
 		goto failed;
 
 	ni_route_tables_reset_seq(dev->routes);
@@ -1530,13 +1640,11 @@ __ni_process_ifinfomsg_linkinfo(ni_linkinfo_t *link, const char *ifname,
 		link->oper_state = nla_get_u8(tb[IFLA_OPERSTATE]);
 	}
 
-	if (tb[IFLA_STATS]) {
+	/* only kept for the interfaces someone asked for the stats */
+	if (tb[IFLA_STATS] && link->stats) {
 		struct rtnl_link_stats *s = nla_data(tb[IFLA_STATS]);
 		ni_link_stats_t *n;
 
-		if (!link->stats)
-			link->stats = calloc(1, sizeof(*n));
-
 		if ((n = link->stats)) {
 			n->rx_packets = s->rx_packets;
 			n->tx_packets = s->tx_packets;
@@ -1621,6 +1729,7 @@ ni_process_ifinfomsg_ifla_inet6_flags(ni_netdev_t *dev, struct nlattr *ifla_inet
 	ni_bool_t old_managed_addr;
 	ni_bool_t old_other_config;
 	ni_ipv6_devinfo_t *ipv6;
+	ni_ipv6_ra_info_t *radv;
 	unsigned int old_flags;
 	unsigned int flags = 0;
 
@@ -1652,32 +1761,38 @@ ni_process_ifinfomsg_ifla_inet6_flags(ni_netdev_t *dev, struct nlattr *ifla_inet
 				ipv6->flags & NI_BIT(NI_IPV6_RS_SENT) ? "requested" : "unrequested");
 	}
 
-	old_managed_addr = ipv6->radv.managed_addr;
-	old_other_config = ipv6->radv.other_config;
+	old_managed_addr = ipv6->radv ? ipv6->radv->managed_addr : FALSE;
+	old_other_config = ipv6->radv ? ipv6->radv->other_config : FALSE;
 	if (flags & IF_RA_MANAGED) {
-		ipv6->radv.managed_addr = TRUE;
-		ipv6->radv.other_config = TRUE;
-		if (ipv6->radv.managed_addr != old_managed_addr ||
-		    ipv6->radv.other_config != old_other_config) {
+		if (!(radv = ni_netdev_get_ipv6_ra_info(dev)))
+			return -1;
+		radv->managed_addr = TRUE;
+		radv->other_config = TRUE;
+		if (radv->managed_addr != old_managed_addr ||
+		    radv->other_config != old_other_config) {
 			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EVENTS,
 				"%s: obtain config and address via DHCPv6",
 				dev->name);
 		}
 	} else
 	if (flags & IF_RA_OTHERCONF) {
-		ipv6->radv.managed_addr = FALSE;
-		ipv6->radv.other_config = TRUE;
-		if (ipv6->radv.managed_addr != old_managed_addr ||
-		    ipv6->radv.other_config != old_other_config) {
+		if (!(radv = ni_netdev_get_ipv6_ra_info(dev)))
+			return -1;
+		radv->managed_addr = FALSE;
+		radv->other_config = TRUE;
+		if (radv->managed_addr != old_managed_addr ||
+		    radv->other_config != old_other_config) {
 			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EVENTS,
 				"%s: obtain config only via DHCPv6",
 				dev->name);
 		}
 	} else {
-		ipv6->radv.managed_addr = FALSE;
-		ipv6->radv.other_config = FALSE;
-		if (ipv6->radv.managed_addr != old_managed_addr ||
-		    ipv6->radv.other_config != old_other_config) {
+		/* nothing to allocate for, when there is no RA info yet */
+		if ((radv = ipv6->radv)) {
+			radv->managed_addr = FALSE;
+			radv->other_config = FALSE;
+		}
+		if (old_managed_addr || old_other_config) {
 			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EVENTS,
 				"%s: no DHCPv6 suggestion in RA",
 				dev->name);
@@ -1739,11 +1854,13 @@ __ni_process_ifinfomsg_af_ipv4_conf(ni_netdev_t *dev, struct nlattr *nla)
 	if (bytes <= 0 || !array || (bytes % 4))
 		return -1;
 
-	return __ni_ipv4_devconf_process_flags(dev, array, bytes / 4);
+	if (__ni_ipv4_devconf_process_flags(dev, array, bytes / 4) < 0)
+		return -1;
+	return bytes / 4;
 }
 
 static int
-__ni_process_ifinfomsg_af_ipv4(ni_netdev_t *dev, struct nlattr *nla, ni_bool_t *ipv4_conf)
+__ni_process_ifinfomsg_af_ipv4(ni_netdev_t *dev, struct nlattr *nla, int *ipv4_conf)
 {
 	struct nlattr *tb[IFLA_INET_MAX + 1];
 
@@ -1754,10 +1871,8 @@ __ni_process_ifinfomsg_af_ipv4(ni_netdev_t *dev, struct nlattr *nla, ni_bool_t *
 	if (nla_parse_nested(tb, IFLA_INET_MAX, nla, NULL) < 0)
 		return -1;
 
-	if (tb[IFLA_INET_CONF]) {
-		if (!__ni_process_ifinfomsg_af_ipv4_conf(dev, tb[IFLA_INET_CONF]) && ipv4_conf)
-			*ipv4_conf = TRUE;
-	}
+	if (tb[IFLA_INET_CONF] && ipv4_conf)
+		*ipv4_conf = __ni_process_ifinfomsg_af_ipv4_conf(dev, tb[IFLA_INET_CONF]);
 
 	return 0;
 }
@@ -1773,11 +1888,13 @@ __ni_process_ifinfomsg_af_ipv6_conf(ni_netdev_t *dev, struct nlattr *nla)
 	if (bytes <= 0 || !array || (bytes % 4))
 		return -1;
 
-	return __ni_ipv6_devconf_process_flags(dev, array, bytes / 4);
+	if (__ni_ipv6_devconf_process_flags(dev, array, bytes / 4) < 0)
+		return -1;
+	return bytes / 4;
 }
 
 static int
-__ni_process_ifinfomsg_af_ipv6(ni_netdev_t *dev, struct nlattr *nla, ni_bool_t *ipv6_conf)
+__ni_process_ifinfomsg_af_ipv6(ni_netdev_t *dev, struct nlattr *nla, int *ipv6_conf)
 {
 	struct nlattr *tb[IFLA_INET6_MAX + 1];
 
@@ -1791,10 +1908,8 @@ __ni_process_ifinfomsg_af_ipv6(ni_netdev_t *dev, struct nlattr *nla, ni_bool_t *
 	if (tb[IFLA_INET6_FLAGS])
 		ni_process_ifinfomsg_ifla_inet6_flags(dev, tb[IFLA_INET6_FLAGS]);
 
-	if (tb[IFLA_INET6_CONF]) {
-		if (!__ni_process_ifinfomsg_af_ipv6_conf(dev, tb[IFLA_INET6_CONF]) && ipv6_conf)
-			*ipv6_conf = TRUE;
-	}
+	if (tb[IFLA_INET6_CONF] && ipv6_conf)
+		*ipv6_conf = __ni_process_ifinfomsg_af_ipv6_conf(dev, tb[IFLA_INET6_CONF]);
 
 	return 0;
 }
@@ -1806,9 +1921,14 @@ __ni_process_ifinfomsg_af_spec(ni_netdev_t *dev, struct nlattr *ifla_af_spec, ni
 	 * not every newlink provides device sysctl's;
 	 * we get them on a refresh and on any change
 	 * and this is IMO completely sufficient.
+	 * Only when the kernel does not provide them
+	 * at all, we read them from /proc/sys, or the
+	 * flags missing in the arrays of older kernels.
 	 */
 	static ni_bool_t ipv4_conf = FALSE;
 	static ni_bool_t ipv6_conf = FALSE;
+	int ipv4_count = -1;
+	int ipv6_count = -1;
 
 	if (ifla_af_spec) {
 		struct nlattr *af;
@@ -1817,25 +1937,33 @@ __ni_process_ifinfomsg_af_spec(ni_netdev_t *dev, struct nlattr *ifla_af_spec, ni
 		nla_for_each_nested(af, ifla_af_spec, rem) {
 			switch (nla_type(af)) {
 			case AF_INET:
-				__ni_process_ifinfomsg_af_ipv4(dev, af, &ipv4_conf);
+				__ni_process_ifinfomsg_af_ipv4(dev, af, &ipv4_count);
 				break;
 			case AF_INET6:
-				__ni_process_ifinfomsg_af_ipv6(dev, af, &ipv6_conf);
+				__ni_process_ifinfomsg_af_ipv6(dev, af, &ipv6_count);
 				break;
 			default:
 				break;
 			}
 		}
 	}
-
-		return 0;
+	if (ipv4_count >= 0)
+		ipv4_conf = TRUE;
+	if (ipv6_count >= 0)
+		ipv6_conf = TRUE;
 
 	/* don't read sysfs when device (name) is not ready */
 	if (ni_netdev_device_is_ready(dev) &&
 	    ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN)) {
+		if (ipv4_count >= 0) {
+			__ni_ipv4_devconf_process_missing(dev, ipv4_count);
+		} else
 		if (!ipv4_conf) {
 			ni_system_ipv4_devinfo_get(dev, NULL);
 		}
+		if (ipv6_count >= 0) {
+			__ni_ipv6_devconf_process_missing(dev, ipv6_count);
+		} else
 		if (!ipv6_conf) {
 			ni_system_ipv6_devinfo_get(dev, NULL);
 		}
@@ -1974,7 +2102,7 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 		 * even worse, by name...
 		 */
 		if (ni_config_teamd_enabled() && ni_netdev_device_is_ready(dev))
-			ni_teamd_discover(dev);
+			ni_teamd_refresh(dev, nc);
 		break;
 
 	case NI_IFTYPE_OVS_BRIDGE:
@@ -2909,13 +3037,14 @@ __ni_netdev_process_newaddr_event(ni_netdev_t *dev, struct nlmsghdr *h, struct i
 	if (__ni_rtnl_parse_newaddr(dev->name, dev->link.ifflags, h, ifa, &tmp) < 0)
 		return -1;
 
-	ap = ni_address_list_find(dev->addrs, &tmp.local_addr);
+	ap = ni_netdev_find_address(dev, &tmp.local_addr);
 	if (!ap) {
-		ap = ni_address_create(tmp.family, tmp.prefixlen, &tmp.local_addr, &dev->addrs);
+		ap = ni_address_create(tmp.family, tmp.prefixlen, &tmp.local_addr, NULL);
 		if (!ap) {
 			ni_string_free(&tmp.label);
 			return -1;
 		}
+		ni_netdev_append_address(dev, ap);
 	}
 	ap->seq = dev->seq;
 	ap->scope = tmp.scope;
@@ -2975,8 +3104,11 @@ __ni_netdev_process_newaddr(ni_netdev_t *dev, struct nlmsghdr *h, struct ifaddrm
 }
 
 ni_bool_t
-ni_rtnl_route_filter_msg(struct rtmsg *rtm)
+ni_rtnl_route_filter_msg(struct nlmsghdr *h, struct rtmsg *rtm)
 {
+	struct nlattr *rta;
+	unsigned int table;
+
 	switch (rtm->rtm_family) {
 	case AF_INET:
 	case AF_INET6:
@@ -3027,6 +3159,17 @@ ni_rtnl_route_filter_msg(struct rtmsg *rtm)
 	if (rtm->rtm_flags & RTM_F_CLONED)
 		return TRUE;
 
+	/* applied in userspace as well, the kernel filters dumps only */
+	if ((rta = nlmsg_find_attr(h, sizeof(*rtm), RTA_TABLE)))
+		table = nla_get_u32(rta);
+	else
+		table = rtm->rtm_table;
+	if (!ni_config_route_filter_match(rtm->rtm_family, table, rtm->rtm_protocol))
+		return TRUE;
+
+	if (!ni_netconfig_route_table_tracked(ni_global_state_handle(0), table))
+		return TRUE;
+
 	return FALSE;
 }
 
@@ -3164,6 +3307,9 @@ int
 ni_rtnl_route_parse_msg(struct nlmsghdr *h, struct rtmsg *rtm, ni_route_t *rp)
 {
 	struct nlattr *tb[RTA_MAX+1];
+#if defined(HAVE_LINUX_NEXTHOP_H)
+	struct nlattr *nh_id;
+#endif
 
 	if (!rtm || !h || !rp)
 		return -1;
@@ -3202,6 +3348,12 @@ ni_rtnl_route_parse_msg(struct nlmsghdr *h, struct rtmsg *rtm, ni_route_t *rp)
 			return -1;
 	}
 
+#if defined(HAVE_LINUX_NEXTHOP_H)
+	/* not in tb, as parsed up to RTN_MAX above */
+	if ((nh_id = nlmsg_find_attr(h, sizeof(*rtm), RTA_NH_ID)) != NULL)
+		rp->nh_id = nla_get_u32(nh_id);
+#endif
+
 	if (tb[RTA_PREFSRC] != NULL)
 		__ni_nla_get_addr(rtm->rtm_family, &rp->pref_src, tb[RTA_PREFSRC]);
 
@@ -3244,7 +3396,7 @@ __ni_netdev_process_newroute(ni_netdev_t *dev, struct nlmsghdr *h,
 #endif
 
 	/* filter unwanted / unsupported  msgs */
-	if (ni_rtnl_route_filter_msg(rtm))
+	if (ni_rtnl_route_filter_msg(h, rtm))
 		return 1;
 
 	rp = ni_route_new();
@@ -3258,7 +3410,7 @@ __ni_netdev_process_newroute(ni_netdev_t *dev, struct nlmsghdr *h,
 		goto failure;
 
 	/* apply lease owner info from equal old route if any */
-	if (dev && (r = ni_route_tables_find_match(dev->routes, rp, ni_route_equal))) {
+	if (dev && (r = ni_route_tables_find_prefix_match(dev->routes, rp, ni_route_equal))) {
 		if (rp->seq != r->seq) {
 			rp->owner = r->owner;
 			ni_netconfig_route_del(nc, r, dev);
@@ -3271,7 +3423,7 @@ __ni_netdev_process_newroute(ni_netdev_t *dev, struct nlmsghdr *h,
 			if (!(d = ni_netdev_by_index(nc, nh->device.index)))
 				continue;
 
-			if (!(r = ni_route_tables_find_match(d->routes, rp, ni_route_equal)))
+			if (!(r = ni_route_tables_find_prefix_match(d->routes, rp, ni_route_equal)))
 				continue;
 
 			if (rp->seq != r->seq) {
@@ -3966,7 +4118,7 @@ __ni_discover_infiniband(ni_netdev_t *dev, ni_netconfig_t *nc)
 	if (!(ib = ni_netdev_get_infiniband(dev)))
 		return -1;
 
-	if (ni_sysfs_netif_get_string(dev->name, "mode", &value) < 0
+	if (ni_sysfs_netif_get_cached_string(dev->name, "mode", &value) < 0
 	   || !ni_infiniband_get_mode_flag(value, &ib->mode)) {
 		ni_error("%s: unable to retrieve infiniband mode attribute from sysfs",
 			dev->name);
@@ -3974,13 +4126,13 @@ __ni_discover_infiniband(ni_netdev_t *dev, ni_netconfig_t *nc)
 	}
 	ni_string_free(&value);
 
-	if (ni_sysfs_netif_get_uint(dev->name, "umcast", &ib->umcast) < 0) {
+	if (ni_sysfs_netif_get_cached_uint(dev->name, "umcast", &ib->umcast) < 0) {
 		ni_error("%s: unable to retrieve infiniband umcast attribute from sysfs",
 			dev->name);
 		ret = -1;
 	}
 
-	if (ni_sysfs_netif_get_uint(dev->name, "pkey", &pkey) < 0) {
+	if (ni_sysfs_netif_get_cached_uint(dev->name, "pkey", &pkey) < 0) {
 		ni_error("%s: unable to retrieve infiniband paritition key from sysfs",
 			dev->name);
 		ret = -1;
@@ -3990,7 +4142,7 @@ __ni_discover_infiniband(ni_netdev_t *dev, ni_netconfig_t *nc)
 	if (dev->link.type != NI_IFTYPE_INFINIBAND_CHILD)
 		return ret;
 
-	if (ni_sysfs_netif_get_string(dev->name, "parent", &value) < 0) {
+	if (ni_sysfs_netif_get_cached_string(dev->name, "parent", &value) < 0) {
 		ni_error("%s: unable to retrieve infiniband child's parent interface name",
 			dev->name);
 		ret = -1;
@@ -309,6 +309,40 @@ __ni_ipv4_devconf_process_flag(ni_netdev_t *dev, unsigned int flag, int value)
 	return unused;
 }
 
+/*
+ * Read the flags we care about from /proc/sys, which are missing
+ * in the devconf array of count flags sent by an older kernel.
+ */
+int
+__ni_ipv4_devconf_process_missing(ni_netdev_t *dev, unsigned int count)
+{
+	static const unsigned int flags[] = {
+		NI_IPV4_DEVCONF_FORWARDING,
+		NI_IPV4_DEVCONF_ACCEPT_REDIRECTS,
+		NI_IPV4_DEVCONF_ARP_NOTIFY,
+	};
+	const char *name;
+	unsigned int i;
+	int value;
+
+	if (!dev || !ni_netdev_get_ipv4(dev))
+		return -1;
+
+	for (i = 0; i < sizeof(flags)/sizeof(flags[0]); ++i) {
+		/* ipv4 flags start at 1 */
+		if (flags[i] <= count)
+			continue;
+
+		if (flags[i] == NI_IPV4_DEVCONF_ARP_NOTIFY && !ni_netdev_supports_arp(dev))
+			continue;
+
+		name = ni_ipv4_devconf_flag_to_sysctl_name(flags[i]);
+		if (ni_sysctl_ipv4_ifconfig_get_int(dev->name, name, &value) >= 0)
+			__ni_ipv4_devconf_process_flag(dev, flags[i], value);
+	}
+	return 0;
+}
+
 int
 __ni_ipv4_devconf_process_flags(ni_netdev_t *dev, int32_t *array, unsigned int count)
 {
@@ -165,21 +165,24 @@ ni_ipv6_devconf_reset(ni_ipv6_devconf_t *conf)
 	conf->privacy = NI_IPV6_PRIVACY_DEFAULT;
 	conf->accept_ra = NI_IPV6_ACCEPT_RA_DEFAULT;
 	conf->accept_dad = NI_IPV6_ACCEPT_DAD_DEFAULT;
+	conf->optimistic_dad = NI_TRISTATE_DEFAULT;
 	conf->accept_redirects = NI_TRISTATE_DEFAULT;
 	conf->addr_gen_mode = NI_IPV6_ADDR_GEN_MODE_DEFAULT;
 	conf->stable_secret = in6addr_any;
 }
 
 /*
- * Reset to ipv6 config defaults
+ * Discard the router advertisement info; it is allocated
+ * on first use only as most devices never receive any.
  */
 static void
-ni_ipv6_ra_info_reset(ni_ipv6_ra_info_t *radv)
+ni_ipv6_ra_info_reset(ni_ipv6_ra_info_t **radv)
 {
-	radv->managed_addr = FALSE;
-	radv->other_config = FALSE;
-
-	ni_ipv6_ra_info_flush(radv);
+	if (*radv) {
+		ni_ipv6_ra_info_flush(*radv);
+		free(*radv);
+		*radv = NULL;
+	}
 }
 
 /*
@@ -193,6 +196,18 @@ ni_netdev_get_ipv6(ni_netdev_t *dev)
 	return dev->ipv6;
 }
 
+ni_ipv6_ra_info_t *
+ni_netdev_get_ipv6_ra_info(ni_netdev_t *dev)
+{
+	ni_ipv6_devinfo_t *ipv6;
+
+	if (!(ipv6 = ni_netdev_get_ipv6(dev)))
+		return NULL;
+	if (ipv6->radv == NULL)
+		ipv6->radv = xcalloc(1, sizeof(*ipv6->radv));
+	return ipv6->radv;
+}
+
 ni_bool_t
 ni_netdev_ipv6_is_ready(const ni_netdev_t *dev)
 {
@@ -230,7 +245,6 @@ ni_ipv6_devinfo_new(void)
 
 	ipv6 = xcalloc(1, sizeof(*ipv6));
 	ni_ipv6_devconf_reset(&ipv6->conf);
-	ni_ipv6_ra_info_reset(&ipv6->radv);
 	return ipv6;
 }
 
@@ -306,6 +320,9 @@ ni_system_ipv6_devinfo_get(ni_netdev_t *dev, ni_ipv6_devinfo_t *ipv6)
 		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, "accept_dad", &val) >= 0)
 			ipv6->conf.accept_dad = val < 0 ? 0 : val > 2 ? 2 : val;
 
+		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, "optimistic_dad", &val) >= 0)
+			ni_tristate_set(&ipv6->conf.optimistic_dad, !!val);
+
 		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, "accept_redirects", &val) >= 0)
 			ni_tristate_set(&ipv6->conf.accept_redirects, !!val);
 
@@ -433,6 +450,14 @@ ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
 			ipv6->conf.accept_dad = accept_dad;
 	}
 
+	if (__tristate_changed(conf->optimistic_dad, ipv6->conf.optimistic_dad)) {
+		ret = __change_int(dev->name, "optimistic_dad", conf->optimistic_dad);
+		if (ret < 0)
+			return ret;
+		if (ret == 0)
+			ipv6->conf.optimistic_dad = conf->optimistic_dad;
+	}
+
 	if (__tristate_changed(conf->accept_redirects, ipv6->conf.accept_redirects)) {
 		ret = __change_int(dev->name, "accept_redirects", conf->accept_redirects);
 		if (ret < 0)
@@ -468,17 +493,36 @@ ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
 void
 ni_ipv6_ra_info_flush(ni_ipv6_ra_info_t *radv)
 {
+	if (!radv)
+		return;
+
 	ni_ipv6_ra_pinfo_list_destroy(&radv->pinfo);
 	ni_ipv6_ra_rdnss_list_destroy(&radv->rdnss);
 	ni_ipv6_ra_dnssl_list_destroy(&radv->dnssl);
 }
 
+/*
+ * The prefix, rdnss and dnssl lists are kept sorted by their expiry
+ * time, so expiring them stops at the first unexpired item and the
+ * next expiry (to arm the timer) is given by the head of the lists.
+ */
+static inline uint64_t
+ni_ipv6_ra_expires(unsigned int lifetime, const struct timeval *acquired)
+{
+	if (lifetime == NI_LIFETIME_INFINITE)
+		return -1ULL;
+	return (uint64_t)acquired->tv_sec + lifetime;
+}
+
 unsigned int
 ni_ipv6_ra_info_expire(ni_ipv6_ra_info_t *radv, const struct timeval *current)
 {
 	unsigned int left, lifetime = NI_LIFETIME_INFINITE;
 	struct timeval now;
 
+	if (!radv)
+		return lifetime;
+
 	if (!current || !timerisset(current)) {
 		ni_timer_get_time(&now);
 		current = &now;
@@ -503,8 +547,15 @@ ni_ipv6_ra_pinfo_free(ni_ipv6_ra_pinfo_t *pi)
 }
 
 void
-ni_ipv6_ra_pinfo_list_prepend(ni_ipv6_ra_pinfo_t **list, ni_ipv6_ra_pinfo_t *pi)
+ni_ipv6_ra_pinfo_list_insert(ni_ipv6_ra_pinfo_t **list, ni_ipv6_ra_pinfo_t *pi)
 {
+	uint64_t expires = ni_ipv6_ra_expires(pi->valid_lft, &pi->acquired);
+	ni_ipv6_ra_pinfo_t *cur;
+
+	for ( ; (cur = *list); list = &cur->next) {
+		if (expires < ni_ipv6_ra_expires(cur->valid_lft, &cur->acquired))
+			break;
+	}
 	pi->next = *list;
 	*list = pi;
 }
@@ -524,21 +575,17 @@ unsigned int
 ni_ipv6_ra_pinfo_list_expire(ni_ipv6_ra_pinfo_t **list, const struct timeval *current)
 {
 	unsigned int left, lifetime = NI_LIFETIME_INFINITE;
-	ni_ipv6_ra_pinfo_t *cur, **pos;
+	ni_ipv6_ra_pinfo_t *cur;
 
 	if (!list)
 		return lifetime;
 
-	for (pos = list; (cur = *pos) != NULL; ) {
-		left = ni_lifetime_left(cur->valid_lft, &cur->acquired, current);
-		if (left) {
-			if (left < lifetime)
-				lifetime = left;
-			pos = &cur->next;
-		} else {
-			*pos = cur->next;
-			ni_ipv6_ra_pinfo_free(cur);
-		}
+	while ((cur = *list) != NULL) {
+		if ((left = ni_lifetime_left(cur->valid_lft, &cur->acquired, current)))
+			return left;
+
+		*list = cur->next;
+		ni_ipv6_ra_pinfo_free(cur);
 	}
 	return lifetime;
 }
@@ -572,6 +619,20 @@ ni_ipv6_ra_rdnss_free(ni_ipv6_ra_rdnss_t *rdnss)
 	free(rdnss);
 }
 
+static void
+ni_ipv6_ra_rdnss_list_insert(ni_ipv6_ra_rdnss_t **list, ni_ipv6_ra_rdnss_t *rdnss)
+{
+	uint64_t expires = ni_ipv6_ra_expires(rdnss->lifetime, &rdnss->acquired);
+	ni_ipv6_ra_rdnss_t *cur;
+
+	for ( ; (cur = *list); list = &cur->next) {
+		if (expires < ni_ipv6_ra_expires(cur->lifetime, &cur->acquired))
+			break;
+	}
+	rdnss->next = *list;
+	*list = rdnss;
+}
+
 void
 ni_ipv6_ra_rdnss_list_destroy(ni_ipv6_ra_rdnss_t **list)
 {
@@ -587,21 +648,17 @@ unsigned int
 ni_ipv6_ra_rdnss_list_expire(ni_ipv6_ra_rdnss_t **list, const struct timeval *current)
 {
 	unsigned int left, lifetime = NI_LIFETIME_INFINITE;
-	ni_ipv6_ra_rdnss_t *cur, **pos;
+	ni_ipv6_ra_rdnss_t *cur;
 
 	if (!list)
 		return lifetime;
 
-	for (pos = list; (cur = *pos) != NULL; ) {
-		left = ni_lifetime_left(cur->lifetime, &cur->acquired, current);
-		if (left) {
-			if (left < lifetime)
-				lifetime = left;
-			pos = &cur->next;
-		} else {
-			*pos = cur->next;
-			ni_ipv6_ra_rdnss_free(cur);
-		}
+	while ((cur = *list) != NULL) {
+		if ((left = ni_lifetime_left(cur->lifetime, &cur->acquired, current)))
+			return left;
+
+		*list = cur->next;
+		ni_ipv6_ra_rdnss_free(cur);
 	}
 	return lifetime;
 }
@@ -619,11 +676,12 @@ ni_ipv6_ra_rdnss_list_update(ni_ipv6_ra_rdnss_t **list, const struct in6_addr *i
 	ni_sockaddr_set_ipv6(&addr, *ipv6, 0);
 	for (pos = list; (rdnss = *pos); pos = &rdnss->next) {
 		if (ni_sockaddr_equal(&rdnss->server, &addr)) {
+			*pos = rdnss->next;
 			if (lifetime) {
 				rdnss->lifetime = lifetime;
 				rdnss->acquired = *acquired;
+				ni_ipv6_ra_rdnss_list_insert(list, rdnss);
 			} else {
-				*pos = rdnss->next;
 				ni_ipv6_ra_rdnss_free(rdnss);
 			}
 			return TRUE;
@@ -636,7 +694,7 @@ ni_ipv6_ra_rdnss_list_update(ni_ipv6_ra_rdnss_t **list, const struct in6_addr *i
 			rdnss->server   = addr;
 			rdnss->lifetime = lifetime;
 			rdnss->acquired = *acquired;
-			*pos = rdnss;
+			ni_ipv6_ra_rdnss_list_insert(list, rdnss);
 			return TRUE;
 		}
 		return FALSE;
@@ -661,6 +719,20 @@ ni_ipv6_ra_dnssl_free(ni_ipv6_ra_dnssl_t *dnssl)
 	}
 }
 
+static void
+ni_ipv6_ra_dnssl_list_insert(ni_ipv6_ra_dnssl_t **list, ni_ipv6_ra_dnssl_t *dnssl)
+{
+	uint64_t expires = ni_ipv6_ra_expires(dnssl->lifetime, &dnssl->acquired);
+	ni_ipv6_ra_dnssl_t *cur;
+
+	for ( ; (cur = *list); list = &cur->next) {
+		if (expires < ni_ipv6_ra_expires(cur->lifetime, &cur->acquired))
+			break;
+	}
+	dnssl->next = *list;
+	*list = dnssl;
+}
+
 void
 ni_ipv6_ra_dnssl_list_destroy(ni_ipv6_ra_dnssl_t **list)
 {
@@ -676,21 +748,17 @@ unsigned int
 ni_ipv6_ra_dnssl_list_expire(ni_ipv6_ra_dnssl_t **list, const struct timeval *current)
 {
 	unsigned int left, lifetime = NI_LIFETIME_INFINITE;
-	ni_ipv6_ra_dnssl_t *cur, **pos;
+	ni_ipv6_ra_dnssl_t *cur;
 
 	if (!list)
 		return lifetime;
 
-	for (pos = list; (cur = *pos) != NULL; ) {
-		left = ni_lifetime_left(cur->lifetime, &cur->acquired, current);
-		if (left) {
-			if (left < lifetime)
-				lifetime = left;
-			pos = &cur->next;
-		} else {
-			*pos = cur->next;
-			ni_ipv6_ra_dnssl_free(cur);
-		}
+	while ((cur = *list) != NULL) {
+		if ((left = ni_lifetime_left(cur->lifetime, &cur->acquired, current)))
+			return left;
+
+		*list = cur->next;
+		ni_ipv6_ra_dnssl_free(cur);
 	}
 	return lifetime;
 }
@@ -706,11 +774,12 @@ ni_ipv6_ra_dnssl_list_update(ni_ipv6_ra_dnssl_t **list, const char *domain,
 
 	for (pos = list; (dnssl = *pos); pos = &dnssl->next) {
 		if (ni_string_eq_nocase(dnssl->domain, domain)) {
+			*pos = dnssl->next;
 			if (lifetime) {
 				dnssl->lifetime = lifetime;
 				dnssl->acquired = *acquired;
+				ni_ipv6_ra_dnssl_list_insert(list, dnssl);
 			} else {
-				*pos = dnssl->next;
 				ni_ipv6_ra_dnssl_free(dnssl);
 			}
 			return TRUE;
@@ -724,7 +793,7 @@ ni_ipv6_ra_dnssl_list_update(ni_ipv6_ra_dnssl_t **list, const char *domain,
 			dnssl->acquired = *acquired;
 			if (ni_string_dup(&dnssl->domain, domain)) {
 				ni_string_tolower(dnssl->domain);
-				*pos = dnssl;
+				ni_ipv6_ra_dnssl_list_insert(list, dnssl);
 				return TRUE;
 			}
 			ni_ipv6_ra_dnssl_free(dnssl);
@@ -833,6 +902,9 @@ __ni_ipv6_devconf_process_flag(ni_netdev_t *dev, unsigned int flag, int value)
 	case NI_IPV6_DEVCONF_ACCEPT_DAD:
 		ipv6->conf.accept_dad = value < -1 ? -1 : value > 2 ? 2 : value;
 		break;
+	case NI_IPV6_DEVCONF_OPTIMISTIC_DAD:
+		ipv6->conf.optimistic_dad = !!value;
+		break;
 	case NI_IPV6_DEVCONF_AUTOCONF:
 		ipv6->conf.autoconf = !!value;
 		break;
@@ -870,6 +942,42 @@ __ni_ipv6_devconf_process_flag(ni_netdev_t *dev, unsigned int flag, int value)
 	return unused;
 }
 
+/*
+ * Read the flags we care about from /proc/sys, which are missing
+ * in the devconf array of count flags sent by an older kernel.
+ */
+int
+__ni_ipv6_devconf_process_missing(ni_netdev_t *dev, unsigned int count)
+{
+	static const unsigned int flags[] = {
+		NI_IPV6_DEVCONF_FORWARDING,
+		NI_IPV6_DEVCONF_DISABLE_IPV6,
+		NI_IPV6_DEVCONF_ACCEPT_REDIRECTS,
+		NI_IPV6_DEVCONF_ACCEPT_RA,
+		NI_IPV6_DEVCONF_ACCEPT_DAD,
+		NI_IPV6_DEVCONF_AUTOCONF,
+		NI_IPV6_DEVCONF_USE_TEMPADDR,
+		NI_IPV6_DEVCONF_ADDR_GEN_MODE,
+	};
+	const char *name;
+	unsigned int i;
+	int value;
+
+	if (!dev || !ni_netdev_get_ipv6(dev))
+		return -1;
+
+	for (i = 0; i < sizeof(flags)/sizeof(flags[0]); ++i) {
+		/* ipv6 flags start at 0 */
+		if (flags[i] < count)
+			continue;
+
+		name = ni_ipv6_devconf_flag_to_sysctl_name(flags[i]);
+		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, name, &value) >= 0)
+			__ni_ipv6_devconf_process_flag(dev, flags[i], value);
+	}
+	return 0;
+}
+
 int
 __ni_ipv6_devconf_process_flags(ni_netdev_t *dev, int32_t *array, unsigned int count)
 {
@@ -20,7 +20,7 @@ extern void			ni_ipv6_ra_pinfo_free(ni_ipv6_ra_pinfo_t *);
 extern void			ni_ipv6_ra_pinfo_list_destroy(ni_ipv6_ra_pinfo_t **);
 extern unsigned int		ni_ipv6_ra_pinfo_list_expire(ni_ipv6_ra_pinfo_t **,
 							const struct timeval *);
-extern void			ni_ipv6_ra_pinfo_list_prepend(ni_ipv6_ra_pinfo_t **,
+extern void			ni_ipv6_ra_pinfo_list_insert(ni_ipv6_ra_pinfo_t **,
 							ni_ipv6_ra_pinfo_t *);
 extern ni_ipv6_ra_pinfo_t *	ni_ipv6_ra_pinfo_list_remove(ni_ipv6_ra_pinfo_t **,
 							const ni_ipv6_ra_pinfo_t *);
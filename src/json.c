@@ -29,6 +29,7 @@
 #include "json.h"
 #include "buffer.h"
 #include "util_priv.h"
+#include "array_priv.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -46,6 +47,11 @@
 #define	NI_JSON_OBJECT_CHUNK	4
 #define NI_JSON_ARRAY_CHUNK	4
 
+/*
+ * objects with at least this number of members get a name index
+ */
+#define NI_JSON_OBJECT_INDEX_MIN	16
+
 
 /*
  * structured types
@@ -74,6 +80,9 @@ struct ni_json_pair {
 struct ni_json_object {
 	unsigned int		count;
 	ni_json_pair_t **	data;
+
+	unsigned int		mask;		/* name index size - 1		*/
+	unsigned int *		index;		/* pair position + 1, 0 unused	*/
 };
 
 struct ni_json_array {
@@ -193,6 +202,14 @@ ni_json_string_get(ni_json_t *json, char **ret)
 	return FALSE;
 }
 
+const char *
+ni_json_string_value(ni_json_t *json)
+{
+	char **val;
+
+	return (val = ni_json_to_string(json)) ? *val : NULL;
+}
+
 /*
  * json object name:value pair
  */
@@ -286,18 +303,79 @@ ni_json_object_free(ni_json_object_t *njo)
 	}
 	free(njo->data);
 	njo->data = NULL;
+	free(njo->index);
 	free(njo);
 }
 
+/*
+ * The name index of larger objects is built on the first lookup,
+ * extended by appends while at most half full and dropped when
+ * a member is removed.  Member names are unique and immutable.
+ */
+static unsigned int *
+ni_json_object_index_slot(const ni_json_object_t *njo, const char *name)
+{
+	unsigned int i = ni_string_hash(name) & njo->mask;
+
+	while (njo->index[i]) {
+		if (ni_string_eq(njo->data[njo->index[i] - 1]->name, name))
+			break;
+		i = (i + 1) & njo->mask;
+	}
+	return &njo->index[i];
+}
+
+static void
+ni_json_object_index_drop(ni_json_object_t *njo)
+{
+	free(njo->index);
+	njo->index = NULL;
+	njo->mask = 0;
+}
+
+static ni_bool_t
+ni_json_object_index_build(ni_json_object_t *njo)
+{
+	unsigned int size, pos;
+
+	for (size = 2 * NI_JSON_OBJECT_INDEX_MIN; size < 2 * njo->count; size <<= 1)
+		;
+	if (!(njo->index = calloc(size, sizeof(*njo->index))))
+		return FALSE;
+
+	njo->mask = size - 1;
+	for (pos = 0; pos < njo->count; ++pos)
+		*ni_json_object_index_slot(njo, njo->data[pos]->name) = pos + 1;
+	return TRUE;
+}
+
+static void
+ni_json_object_index_append(ni_json_object_t *njo)
+{
+	if (!njo->index)
+		return;
+
+	if (2 * njo->count > njo->mask + 1)
+		ni_json_object_index_drop(njo);
+	else
+		*ni_json_object_index_slot(njo, njo->data[njo->count - 1]->name) = njo->count;
+}
+
 ni_json_pair_t *
 ni_json_object_get_pair(ni_json_t *json, const char *name)
 {
 	ni_json_object_t *njo;
-	unsigned int i;
+	unsigned int i, *slot;
 
 	if (!(njo = ni_json_to_object(json)))
 		return NULL;
 
+	if (njo->count >= NI_JSON_OBJECT_INDEX_MIN &&
+	    (njo->index || ni_json_object_index_build(njo))) {
+		slot = ni_json_object_index_slot(njo, name);
+		return *slot ? njo->data[*slot - 1] : NULL;
+	}
+
 	for (i = 0; i < njo->count; ++i) {
 		ni_json_pair_t *pair = njo->data[i];
 
@@ -344,17 +422,11 @@ ni_json_object_ref_value(ni_json_t *json, const char *name)
 }
 
 static void
-ni_json_object_realloc(ni_json_object_t *njo, unsigned int size)
+ni_json_object_realloc(ni_json_object_t *njo, unsigned int count)
 {
-	ni_json_pair_t **data;
-	unsigned int i;
-
-	size = (size + NI_JSON_OBJECT_CHUNK);
-	data = xrealloc(njo->data, size * sizeof(ni_json_pair_t *));
-	njo->data = data;
-
-	for (i = njo->count; i < size; ++i)
-		njo->data[i] = NULL;
+	if (!ni_array_grow((void **)&njo->data, sizeof(ni_json_pair_t *),
+				njo->count, count, NI_JSON_OBJECT_CHUNK))
+		ni_fatal("allocation failed for %u json object entries", count);
 }
 
 static ni_bool_t
@@ -369,10 +441,10 @@ ni_json_object_append(ni_json_t *json, const char *name, ni_json_t *value)
 	if (!(pair = ni_json_pair_new(name, value)))
 		return FALSE;
 
-	if ((njo->count % NI_JSON_OBJECT_CHUNK) == 0)
-		ni_json_object_realloc(njo, njo->count);
+	ni_json_object_realloc(njo, njo->count + 1);
 
 	njo->data[njo->count++] = pair;
+	ni_json_object_index_append(njo);
 	return TRUE;
 }
 
@@ -420,6 +492,7 @@ ni_json_object_remove_at(ni_json_t *json, unsigned int pos)
 	if (!(njo = ni_json_to_object(json)) || pos >= njo->count)
 		return NULL;
 
+	ni_json_object_index_drop(njo);
 	ret = ni_json_ref(njo->data[pos]->value);
 	ni_json_pair_free(njo->data[pos]);
 	njo->count--;
@@ -516,17 +589,11 @@ ni_json_array_ref(ni_json_t *json, unsigned int pos)
 }
 
 static void
-ni_json_array_realloc(ni_json_array_t *nja, unsigned int size)
+ni_json_array_realloc(ni_json_array_t *nja, unsigned int count)
 {
-	ni_json_t **data;
-	unsigned int i;
-
-	size = (size + NI_JSON_ARRAY_CHUNK);
-	data = xrealloc(nja->data, size * sizeof(ni_json_t *));
-	nja->data = data;
-
-	for (i = nja->count; i < size; ++i)
-		nja->data[i] = NULL;
+	if (!ni_array_grow((void **)&nja->data, sizeof(ni_json_t *),
+				nja->count, count, NI_JSON_ARRAY_CHUNK))
+		ni_fatal("allocation failed for %u json array entries", count);
 }
 
 ni_bool_t
@@ -537,8 +604,7 @@ ni_json_array_append(ni_json_t *json, ni_json_t *value)
 	if (!value || !(nja = ni_json_to_array(json)))
 		return FALSE;
 
-	if ((nja->count % NI_JSON_ARRAY_CHUNK) == 0)
-		ni_json_array_realloc(nja, nja->count);
+	ni_json_array_realloc(nja, nja->count + 1);
 
 	nja->data[nja->count++] = value;
 	return TRUE;
@@ -552,8 +618,7 @@ ni_json_array_insert(ni_json_t *json, unsigned int pos, ni_json_t *value)
 	if (!value || !(nja = ni_json_to_array(json)))
 		return FALSE;
 
-	if ((nja->count % NI_JSON_ARRAY_CHUNK) == 0)
-		ni_json_array_realloc(nja, nja->count);
+	ni_json_array_realloc(nja, nja->count + 1);
 
 	if (pos >= nja->count) {
 		nja->data[nja->count++] = value;
@@ -1094,6 +1159,7 @@ struct ni_json_reader_stack {
 	ni_json_state_t			state;
 	char *				name;
 	ni_json_t *			value;
+	ni_bool_t			skipped;
 };
 
 struct ni_json_reader {
@@ -1106,6 +1172,8 @@ struct ni_json_reader {
 	ni_bool_t			quiet;
 	ni_string_array_t		error;
 	ni_json_reader_stack_t *	stack;
+	ni_stringbuf_t			token;
+	const char * const *		members;
 	ni_json_reader_get_data_fn_t *	get_data;
 	ni_json_reader_get_char_fn_t *	get_char;
 	ni_json_reader_unget_char_fn_t *unget_char;
@@ -1168,6 +1236,8 @@ ni_json_reader_init_buffer(ni_json_reader_t *jr, ni_buffer_t *buf)
 	jr->close = FALSE;
 	jr->quiet = FALSE;
 	ni_string_array_init(&jr->error);
+	ni_stringbuf_init(&jr->token);
+	jr->members = NULL;
 
 	jr->get_data   = ni_json_reader_buffer_get;
 	jr->get_char   = ni_json_reader_buffer_getc;
@@ -1205,6 +1275,8 @@ ni_json_reader_init_file(ni_json_reader_t *jr, FILE *file)
 	jr->close = FALSE;
 	jr->quiet = FALSE;
 	ni_string_array_init(&jr->error);
+	ni_stringbuf_init(&jr->token);
+	jr->members = NULL;
 
 	jr->get_data   = ni_json_reader_file_get;
 	jr->get_char   = ni_json_reader_file_getc;
@@ -1239,6 +1311,7 @@ static ni_bool_t
 ni_json_reader_destroy(ni_json_reader_t *jr)
 {
 	ni_string_array_destroy(&jr->error);
+	ni_stringbuf_destroy(&jr->token);
 	while (ni_json_reader_stack_pop(jr))
 		;
 
@@ -1321,11 +1394,37 @@ ni_json_reader_get_parent(ni_json_reader_t *jr)
 	return jr->stack->parent ? jr->stack->parent->value : NULL;
 }
 
+/*
+ * Buffer readers scan the input in place instead of per character.
+ */
+static inline const char *
+ni_json_reader_peek(ni_json_reader_t *jr, size_t *len)
+{
+	if (!jr->inbuf || !(*len = ni_buffer_count(jr->inbuf)))
+		return NULL;
+	return ni_buffer_head(jr->inbuf);
+}
+
+static inline void
+ni_json_reader_advance(ni_json_reader_t *jr, size_t len)
+{
+	ni_buffer_pull_head(jr->inbuf, len);
+}
+
 static void
 ni_json_reader_skip_spaces(ni_json_reader_t *jr)
 {
+	const char *ptr;
+	size_t len, n;
 	int cc;
 
+	if ((ptr = ni_json_reader_peek(jr, &len))) {
+		for (n = 0; n < len && isspace((unsigned char)ptr[n]); ++n)
+			;
+		ni_json_reader_advance(jr, n);
+		return;
+	}
+
 	while ((cc = jr->get_char(jr)) != EOF) {
 		if (!isspace(cc)) {
 			jr->unget_char(jr, cc);
@@ -1334,6 +1433,78 @@ ni_json_reader_skip_spaces(ni_json_reader_t *jr)
 	}
 }
 
+/*
+ * Consume one value without building it; skipped values are checked
+ * for balanced nesting and quoting only.
+ */
+static ni_bool_t
+ni_json_reader_skip_value(ni_json_reader_t *jr)
+{
+	ni_bool_t quoted = FALSE, escaped = FALSE;
+	unsigned int depth = 0;
+	const char *ptr;
+	size_t len, n;
+	int cc;
+
+	ni_json_reader_skip_spaces(jr);
+	while ((cc = jr->get_char(jr)) != EOF) {
+		if (quoted) {
+			if (escaped) {
+				escaped = FALSE;
+			} else
+			if (cc == '\\') {
+				escaped = TRUE;
+			} else
+			if (cc == '"') {
+				quoted = FALSE;
+				if (!depth)
+					return TRUE;
+			} else
+			if ((ptr = ni_json_reader_peek(jr, &len))) {
+				for (n = 0; n < len && ptr[n] != '"' && ptr[n] != '\\'; ++n)
+					;
+				ni_json_reader_advance(jr, n);
+			}
+			continue;
+		}
+
+		switch (cc) {
+		case '"':
+			quoted = TRUE;
+			break;
+		case '[':
+		case '{':
+			depth++;
+			break;
+		case ']':
+		case '}':
+			if (!depth) {
+				jr->unget_char(jr, cc);
+				return FALSE;
+			}
+			if (!--depth)
+				return TRUE;
+			break;
+		default:
+			if (depth)
+				break;
+			if (!isalnum(cc) && cc != '-') {
+				jr->unget_char(jr, cc);
+				return FALSE;
+			}
+			/* literal or number */
+			while ((cc = jr->get_char(jr)) != EOF) {
+				if (!isalnum(cc) && !strchr("+-.", cc)) {
+					jr->unget_char(jr, cc);
+					break;
+				}
+			}
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 static void
 ni_json_reader_get_literal(ni_json_reader_t *jr, ni_stringbuf_t *res)
 {
@@ -1570,6 +1741,23 @@ ni_json_reader_get_eunicode(ni_json_reader_t *jr, ni_stringbuf_t *res)
 }
 #endif
 
+static void
+ni_json_reader_get_qstring_run(ni_json_reader_t *jr, ni_stringbuf_t *res)
+{
+	const char *ptr;
+	size_t len, n;
+
+	if (!(ptr = ni_json_reader_peek(jr, &len)))
+		return;
+
+	for (n = 0; n < len && ptr[n] != '"' && ptr[n] != '\\'; ++n)
+		;
+	if (n) {
+		ni_stringbuf_put(res, ptr, n);
+		ni_json_reader_advance(jr, n);
+	}
+}
+
 static ni_bool_t
 ni_json_reader_get_qstring(ni_json_reader_t *jr, ni_stringbuf_t *res)
 {
@@ -1577,7 +1765,13 @@ ni_json_reader_get_qstring(ni_json_reader_t *jr, ni_stringbuf_t *res)
 	const char *us;
 	int cc;
 
-	while ((cc = jr->get_char(jr)) != EOF) {
+	for (;;) {
+		/* copy the unescaped characters up to the next quote or escape */
+		if (!escaped)
+			ni_json_reader_get_qstring_run(jr, res);
+		if ((cc = jr->get_char(jr)) == EOF)
+			break;
+
 		if (escaped) {
 			if (cc == 'u') {
 #ifdef HAVE_ICONV_H
@@ -1653,6 +1847,13 @@ ni_json_get_token(ni_json_reader_t *jr, ni_stringbuf_t *res)
 	}
 }
 
+/* the reused token buffer; NULL for empty strings as before */
+static inline const char *
+ni_json_reader_token(const ni_stringbuf_t *token)
+{
+	return token->len ? token->string : NULL;
+}
+
 static void
 ni_json_reader_process_array_beg(ni_json_reader_t *jr)
 {
@@ -1711,6 +1912,53 @@ ni_json_reader_process_object_beg(ni_json_reader_t *jr)
 	}
 }
 
+/*
+ * When the reader has a member filter, the values of the other members
+ * of the top level object are skipped.  A null value stands in for the
+ * skipped one, so the separator checks apply unchanged.
+ */
+static ni_bool_t
+ni_json_reader_skip_member(ni_json_reader_t *jr, const char *name)
+{
+	const char * const *member;
+
+	if (!jr->members || !jr->stack->parent || jr->stack->parent->parent)
+		return FALSE;
+
+	for (member = jr->members; *member; ++member) {
+		if (ni_string_eq(*member, name))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+ni_json_reader_process_skipped_value(ni_json_reader_t *jr)
+{
+	if (!ni_json_reader_skip_value(jr)) {
+		ni_json_reader_set_error(jr, "invalid object member '%s' value",
+				ni_json_reader_get_pair_name(jr));
+	} else {
+		ni_json_reader_set_current(jr, ni_json_new_null());
+		jr->stack->skipped = TRUE;
+		ni_json_reader_set_state(jr, InPair);
+	}
+}
+
+static ni_bool_t
+ni_json_reader_drop_skipped_value(ni_json_reader_t *jr)
+{
+	if (!jr->stack->skipped)
+		return FALSE;
+
+	jr->stack->skipped = FALSE;
+	ni_json_free(ni_json_reader_get_current(jr));
+	ni_json_reader_set_pair_name(jr, NULL);
+	ni_json_reader_set_current(jr, NULL);
+	ni_json_reader_set_state(jr, InObject);
+	return TRUE;
+}
+
 static void
 ni_json_reader_process_object_add(ni_json_reader_t *jr)
 {
@@ -1718,6 +1966,9 @@ ni_json_reader_process_object_add(ni_json_reader_t *jr)
 	ni_json_t *value = ni_json_reader_get_current(jr);
 	const char *name = ni_json_reader_get_pair_name(jr);
 
+	if (ni_json_reader_drop_skipped_value(jr))
+		return;
+
 	if (!name)
 		ni_json_reader_set_error(jr, "object pair without name");
 	else
@@ -1737,8 +1988,12 @@ static void
 ni_json_reader_process_object_end(ni_json_reader_t *jr)
 {
 	ni_json_t *parent = ni_json_reader_get_parent(jr);
-	ni_json_t *value = ni_json_reader_get_current(jr);
-	const char *name = ni_json_reader_get_pair_name(jr);
+	ni_json_t *value;
+	const char *name;
+
+	ni_json_reader_drop_skipped_value(jr);
+	value = ni_json_reader_get_current(jr);
+	name = ni_json_reader_get_pair_name(jr);
 
 	if (name && !value)
 		ni_json_reader_set_error(jr, "unexpected object end");
@@ -1789,11 +2044,12 @@ ni_json_reader_process_string_value(ni_json_reader_t *jr, const char *string)
 static void
 ni_json_reader_parse_array(ni_json_reader_t *jr)
 {
-	ni_stringbuf_t tokenValue = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t *tokenValue = &jr->token;
 	ni_json_token_type_t token;
 
 	ni_json_reader_skip_spaces(jr);
-	token = ni_json_get_token(jr, &tokenValue);
+	ni_stringbuf_truncate(tokenValue, 0);
+	token = ni_json_get_token(jr, tokenValue);
 
 	switch (token) {
 	case ArrayBegin:
@@ -1819,21 +2075,21 @@ ni_json_reader_parse_array(ni_json_reader_t *jr)
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed array element separator");
 		else
-			ni_json_reader_process_literal_value(jr, tokenValue.string);
+			ni_json_reader_process_literal_value(jr, ni_json_reader_token(tokenValue));
 		break;
 
 	case Number:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed array element separator");
 		else
-			ni_json_reader_process_number_value(jr, tokenValue.string);
+			ni_json_reader_process_number_value(jr, ni_json_reader_token(tokenValue));
 		break;
 
 	case String:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed array element separator");
 		else
-			ni_json_reader_process_string_value(jr, tokenValue.string);
+			ni_json_reader_process_string_value(jr, ni_json_reader_token(tokenValue));
 		break;
 
 	case EndOfFile:
@@ -1844,19 +2100,19 @@ ni_json_reader_parse_array(ni_json_reader_t *jr)
 		ni_json_reader_set_error(jr, "unexpected array token");
 		break;
 	}
-	ni_stringbuf_destroy(&tokenValue);
 }
 
 static void
 ni_json_reader_parse_object(ni_json_reader_t *jr)
 {
-	ni_stringbuf_t tokenValue = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t *tokenValue = &jr->token;
 	ni_json_token_type_t token;
 	ni_json_t *value;
 	const char *name;
 
 	ni_json_reader_skip_spaces(jr);
-	token = ni_json_get_token(jr, &tokenValue);
+	ni_stringbuf_truncate(tokenValue, 0);
+	token = ni_json_get_token(jr, tokenValue);
 
 	switch (token) {
 	case ObjectEnd:
@@ -1871,12 +2127,15 @@ ni_json_reader_parse_object(ni_json_reader_t *jr)
 		if ((value = ni_json_reader_get_current(jr)))
 			ni_json_reader_set_error(jr, "unexpected object pair value");
 		else
-			ni_json_reader_set_pair_name(jr, tokenValue.string);
+			ni_json_reader_set_pair_name(jr, ni_json_reader_token(tokenValue));
 		break;
 
 	case Colon:
 		if (!(name = ni_json_reader_get_pair_name(jr)))
 			ni_json_reader_set_error(jr, "unexpected colon without object pair name");
+		else
+		if (ni_json_reader_skip_member(jr, name))
+			ni_json_reader_process_skipped_value(jr);
 		else
 			ni_json_reader_set_state(jr, InPair);
 		break;
@@ -1889,17 +2148,17 @@ ni_json_reader_parse_object(ni_json_reader_t *jr)
 		ni_json_reader_set_error(jr, "unexpected object token");
 		break;
 	}
-	ni_stringbuf_destroy(&tokenValue);
 }
 
 static void
 ni_json_reader_parse_pair(ni_json_reader_t *jr)
 {
-	ni_stringbuf_t tokenValue = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t *tokenValue = &jr->token;
 	ni_json_token_type_t token;
 
 	ni_json_reader_skip_spaces(jr);
-	token = ni_json_get_token(jr, &tokenValue);
+	ni_stringbuf_truncate(tokenValue, 0);
+	token = ni_json_get_token(jr, tokenValue);
 
 	switch (token) {
 	case ArrayBegin:
@@ -1922,21 +2181,21 @@ ni_json_reader_parse_pair(ni_json_reader_t *jr)
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed object member separator or end");
 		else
-			ni_json_reader_process_literal_value(jr, tokenValue.string);
+			ni_json_reader_process_literal_value(jr, ni_json_reader_token(tokenValue));
 		break;
 
 	case Number:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed object member separator or end");
 		else
-			ni_json_reader_process_number_value(jr, tokenValue.string);
+			ni_json_reader_process_number_value(jr, ni_json_reader_token(tokenValue));
 		break;
 
 	case String:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed object memmer separator or end");
 		else
-			ni_json_reader_process_string_value(jr, tokenValue.string);
+			ni_json_reader_process_string_value(jr, ni_json_reader_token(tokenValue));
 		break;
 
 	case EndOfFile:
@@ -1947,17 +2206,17 @@ ni_json_reader_parse_pair(ni_json_reader_t *jr)
 		ni_json_reader_set_error(jr, "unexpected object pair token");
 		break;
 	}
-	ni_stringbuf_destroy(&tokenValue);
 }
 
 static void
 ni_json_reader_parse_initial(ni_json_reader_t *jr)
 {
-	ni_stringbuf_t tokenValue = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t *tokenValue = &jr->token;
 	ni_json_token_type_t token;
 
 	ni_json_reader_skip_spaces(jr);
-	token = ni_json_get_token(jr, &tokenValue);
+	ni_stringbuf_truncate(tokenValue, 0);
+	token = ni_json_get_token(jr, tokenValue);
 
 	switch (token) {
 	case ArrayBegin:
@@ -1972,21 +2231,21 @@ ni_json_reader_parse_initial(ni_json_reader_t *jr)
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "unexpected literal in scalar context");
 		else
-			ni_json_reader_process_literal_value(jr, tokenValue.string);
+			ni_json_reader_process_literal_value(jr, ni_json_reader_token(tokenValue));
 		break;
 
 	case Number:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "unexpected number in scalar context");
 		else
-			ni_json_reader_process_number_value(jr, tokenValue.string);
+			ni_json_reader_process_number_value(jr, ni_json_reader_token(tokenValue));
 		break;
 
 	case String:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "unexpected string in scalar context");
 		else
-			ni_json_reader_process_string_value(jr, tokenValue.string);
+			ni_json_reader_process_string_value(jr, ni_json_reader_token(tokenValue));
 		break;
 
 	case EndOfFile:
@@ -1997,7 +2256,6 @@ ni_json_reader_parse_initial(ni_json_reader_t *jr)
 		ni_json_reader_set_error(jr, "unexpected token");
 		break;
 	}
-	ni_stringbuf_destroy(&tokenValue);
 }
 
 static ni_json_t *
@@ -2055,6 +2313,33 @@ ni_json_parse_buffer(ni_buffer_t *buf)
 	return json;
 }
 
+/*
+ * Parse a top level object keeping only the named members, e.g. the
+ * few teamd config sections we discover; NULL terminated list.
+ */
+ni_json_t *
+ni_json_parse_string_members(const char *str, const char * const *members)
+{
+	ni_json_reader_t reader;
+	ni_json_t *json;
+	ni_buffer_t buf;
+
+	if (ni_string_empty(str))
+		return NULL;
+
+	ni_buffer_init_reader(&buf, (char *)str, ni_string_len(str));
+	if (!ni_json_reader_init_buffer(&reader, &buf))
+		return NULL;
+
+	reader.members = members;
+	json = ni_json_reader_parse(&reader);
+	if (!ni_json_reader_destroy(&reader)) {
+		ni_json_free(json);
+		return NULL;
+	}
+	return json;
+}
+
 ni_json_t *
 ni_json_parse_string(const char *str)
 {
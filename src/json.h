@@ -72,6 +72,7 @@ extern	ni_bool_t			ni_json_bool_get(ni_json_t *, ni_bool_t *);
 extern	ni_bool_t			ni_json_int64_get(ni_json_t *, int64_t *);
 extern	ni_bool_t			ni_json_double_get(ni_json_t *, double *);
 extern	ni_bool_t			ni_json_string_get(ni_json_t *, char **);
+extern	const char *			ni_json_string_value(ni_json_t *);
 
 extern	ni_json_t *			ni_json_array_get(ni_json_t *, unsigned int);
 extern	ni_json_t *			ni_json_array_ref(ni_json_t *, unsigned int);
@@ -121,6 +122,8 @@ extern	const char *			ni_json_format_string(ni_stringbuf_t *,
 							const ni_json_format_options_t *);
 
 extern	ni_json_t *			ni_json_parse_string(const char *);
+extern	ni_json_t *			ni_json_parse_string_members(const char *,
+							const char * const *);
 extern	ni_json_t *			ni_json_parse_file(const char *);
 
 #endif /* NI_JSON_H */
@@ -31,6 +31,8 @@
 #include "util_priv.h"
 #include "sysfs.h"
 #include "kernel.h"
+#include "stats.h"
+#include "probes.h"
 #include <wicked/ppp.h>
 #include <wicked/tuntap.h>
 
@@ -45,6 +47,12 @@
 #ifndef SIOCETHTOOL
 # define SIOCETHTOOL	0x8946
 #endif
+#ifndef SOL_NETLINK
+# define SOL_NETLINK		270
+#endif
+#ifndef NETLINK_GET_STRICT_CHK
+# define NETLINK_GET_STRICT_CHK	12
+#endif
 
 ni_netlink_t *		__ni_global_netlink;
 int			__ni_global_iocfd = -1;
@@ -108,6 +116,25 @@ __ni_ethtool(const char *ifname, int cmd, void *data)
 	return 0;
 }
 
+/*
+ * Same as __ni_ethtool, but using the given ioctl socket
+ * without any global state, as done by the worker threads.
+ */
+int
+__ni_ethtool_fd(int fd, const char *ifname, int cmd, void *data)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, ifname, IFNAMSIZ);
+	((struct ethtool_cmd *) data)->cmd = cmd;
+	ifr.ifr_data = data;
+
+	if (ioctl(fd, SIOCETHTOOL, &ifr) < 0)
+		return -1;
+	return 0;
+}
+
 /*
  * Bridge helper functions
  */
@@ -366,6 +393,7 @@ __ni_nl_talk(ni_netlink_t *nl, struct nl_msg *msg,
 		ni_error("%s: unable to send: %s", __func__, nl_geterror(err));
 		return err;
 	}
+	NI_PROBE2(nl_talk_send, nlmsg_hdr(msg)->nlmsg_type, nlmsg_hdr(msg)->nlmsg_seq);
 
 	if (!(cb = __ni_nl_cb_clone(nl)))
 		return -NLE_NOMEM;
@@ -386,6 +414,7 @@ __ni_nl_talk(ni_netlink_t *nl, struct nl_msg *msg,
 			break;
 		}
 	} while (ack == 0);
+	NI_PROBE2(nl_talk_ack, nlmsg_hdr(msg)->nlmsg_type, err);
 
 	nl_cb_put(cb);
 	return err;
@@ -471,32 +500,16 @@ __ni_nl_dump_valid(struct nl_msg *msg, void *p)
 	return NL_OK;
 }
 
-/*
- * Issue a DUMP request and store all replies in list
- */
-int
-ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+static int
+__ni_nl_dump_receive(struct nl_sock *nl_sock, const char *name, struct ni_nlmsg_list *list)
 {
-	struct nl_sock *nl_sock;
 	struct __ni_nl_dump_state data = {
 		.msg_type = -1,
 		.list = list,
 	};
 	struct nl_cb *cb;
-	const char *name;
 	int rv;
 
-	name = ni_rtnl_msg_type_to_name(type, __func__);
-	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
-		ni_error("%s: no netlink socket", name);
-		return -NLE_BAD_SOCK;
-	}
-
-	if ((rv = nl_rtgen_request(nl_sock, type, af, NLM_F_DUMP)) < 0) {
-		ni_error("%s: failed to send request", name);
-		return rv;
-	}
-
 	if (!(cb = __ni_nl_cb_clone(__ni_global_netlink)))
 		return -NLE_NOMEM;
 
@@ -526,6 +539,79 @@ retry:
 	return rv;
 }
 
+/*
+ * Issue a DUMP request and store all replies in list
+ */
+int
+ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+{
+	struct nl_sock *nl_sock;
+	struct timeval started;
+	const char *name;
+	int rv;
+
+	name = ni_rtnl_msg_type_to_name(type, __func__);
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", name);
+		return -NLE_BAD_SOCK;
+	}
+
+	ni_timer_get_time(&started);
+	if ((rv = nl_rtgen_request(nl_sock, type, af, NLM_F_DUMP)) < 0) {
+		ni_error("%s: failed to send request", name);
+		return rv;
+	}
+
+	rv = __ni_nl_dump_receive(nl_sock, name, list);
+	ni_stats_netlink_dump(name, &started);
+	return rv;
+}
+
+/*
+ * Issue a DUMP request with a complete header and attributes in msg,
+ * enabling strict checking when requested, so the kernel applies the
+ * header and attribute values as filter. Kernels without support for
+ * strict checking ignore the filter and send all objects.
+ */
+int
+ni_nl_dump_store_strict(struct nl_msg *msg, ni_bool_t strict, struct ni_nlmsg_list *list)
+{
+	struct nl_sock *nl_sock;
+	struct timeval started;
+	const char *name;
+	int on = 1, off = 0;
+	int fd, rv;
+
+	name = ni_rtnl_msg_type_to_name(nlmsg_hdr(msg)->nlmsg_type, __func__);
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", name);
+		return -NLE_BAD_SOCK;
+	}
+
+	fd = nl_socket_get_fd(nl_sock);
+	if (strict && setsockopt(fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &on, sizeof(on)) < 0) {
+		ni_debug_socket("%s: unable to enable netlink strict checking: %m", name);
+		strict = FALSE;
+	}
+
+	ni_timer_get_time(&started);
+	nlmsg_hdr(msg)->nlmsg_flags |= NLM_F_DUMP;
+	rv = nl_send_auto(nl_sock, msg);
+
+	/* the kernel has parsed the dump request in the send already */
+	if (strict)
+		setsockopt(fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &off, sizeof(off));
+
+	if (rv < 0) {
+		ni_error("%s: failed to send request", name);
+		return rv;
+	}
+
+	rv = __ni_nl_dump_receive(nl_sock, name, list);
+	ni_stats_netlink_dump(name, &started);
+	return rv;
+}
+
 /*
  * Send a message and capture the response message(s)
  */
@@ -550,6 +636,242 @@ ni_nl_talk(struct nl_msg *msg, struct ni_nlmsg_list *list)
 	}
 }
 
+/*
+ * Batched netlink transaction: the requests are sent in chunks of
+ * several messages in one datagram and the ACKs of each chunk are
+ * collected before the next one is sent, so the kernel processes a
+ * chunk without waiting for a round trip per request.
+ * Each ACK uses about a page of the socket receive buffer, so the
+ * number of requests per chunk is limited to not overrun it.
+ */
+#define NI_NL_BATCH_CHUNK_SIZE		(16 * 1024)
+#define NI_NL_BATCH_CHUNK_COUNT		64
+
+typedef struct ni_nl_batch_item {
+	struct nl_msg *		msg;
+	uint32_t		seq;
+	int			err;
+	ni_bool_t		done;
+} ni_nl_batch_item_t;
+
+struct ni_nl_batch {
+	unsigned int		count;
+	ni_nl_batch_item_t *	items;
+};
+
+typedef struct ni_nl_batch_state {
+	ni_nl_batch_t *		batch;
+	unsigned int		first;
+	unsigned int		last;
+	unsigned int		pending;
+} ni_nl_batch_state_t;
+
+ni_nl_batch_t *
+ni_nl_batch_new(void)
+{
+	return xcalloc(1, sizeof(ni_nl_batch_t));
+}
+
+void
+ni_nl_batch_free(ni_nl_batch_t *batch)
+{
+	unsigned int i;
+
+	if (!batch)
+		return;
+
+	for (i = 0; i < batch->count; ++i) {
+		if (batch->items[i].msg)
+			nlmsg_free(batch->items[i].msg);
+	}
+	free(batch->items);
+	free(batch);
+}
+
+/*
+ * Add a request message to the batch, which takes over the message.
+ * Returns the index used to query its result after the commit.
+ */
+int
+ni_nl_batch_add(ni_nl_batch_t *batch, struct nl_msg *msg)
+{
+	ni_nl_batch_item_t *item;
+
+	if (!batch || !msg)
+		return -1;
+
+	if ((batch->count % 16) == 0) {
+		batch->items = xrealloc(batch->items,
+				(batch->count + 16) * sizeof(*batch->items));
+	}
+	item = &batch->items[batch->count];
+	memset(item, 0, sizeof(*item));
+	item->msg = msg;
+	return batch->count++;
+}
+
+unsigned int
+ni_nl_batch_count(const ni_nl_batch_t *batch)
+{
+	return batch ? batch->count : 0;
+}
+
+int
+ni_nl_batch_result(const ni_nl_batch_t *batch, unsigned int index)
+{
+	if (!batch || index >= batch->count)
+		return -NLE_RANGE;
+	return batch->items[index].err;
+}
+
+static ni_nl_batch_item_t *
+ni_nl_batch_state_item(ni_nl_batch_state_t *state, uint32_t seq)
+{
+	ni_nl_batch_item_t *item;
+	unsigned int i;
+
+	for (i = state->first; i < state->last; ++i) {
+		item = &state->batch->items[i];
+		if (item->seq == seq && !item->done)
+			return item;
+	}
+	return NULL;
+}
+
+static int
+ni_nl_batch_seq_check(struct nl_msg *msg, void *arg)
+{
+	/* ACKs are matched to the requests in the ack and error handler */
+	return NL_OK;
+}
+
+static int
+ni_nl_batch_ack_handler(struct nl_msg *msg, void *arg)
+{
+	ni_nl_batch_state_t *state = arg;
+	ni_nl_batch_item_t *item;
+
+	if ((item = ni_nl_batch_state_item(state, nlmsg_hdr(msg)->nlmsg_seq))) {
+		item->done = TRUE;
+		state->pending--;
+	}
+	return NL_OK;
+}
+
+static int
+ni_nl_batch_error_handler(struct sockaddr_nl *sender, struct nlmsgerr *err, void *arg)
+{
+	ni_nl_batch_state_t *state = arg;
+	ni_nl_batch_item_t *item;
+
+	if ((item = ni_nl_batch_state_item(state, err->msg.nlmsg_seq))) {
+		ni_debug_ifconfig("netlink reports error %d for batch request %u",
+				err->error, (unsigned int)(item - state->batch->items));
+		item->err = -nl_syserr2nlerr(err->error);
+		item->done = TRUE;
+		state->pending--;
+	}
+	return NL_SKIP;
+}
+
+static int
+ni_nl_batch_send_chunk(struct nl_sock *nl_sock, ni_nl_batch_state_t *state)
+{
+	ni_nl_batch_t *batch = state->batch;
+	unsigned char *buf = NULL;
+	size_t len = 0, size = 0;
+	struct nlmsghdr *h;
+	unsigned int i;
+	int err;
+
+	for (i = state->first; i < batch->count; ++i) {
+		ni_nl_batch_item_t *item = &batch->items[i];
+		size_t mlen;
+
+		nl_complete_msg(nl_sock, item->msg);
+		h = nlmsg_hdr(item->msg);
+		mlen = NLMSG_ALIGN(h->nlmsg_len);
+		if (len && (len + mlen > NI_NL_BATCH_CHUNK_SIZE ||
+			    i - state->first >= NI_NL_BATCH_CHUNK_COUNT))
+			break;
+
+		if (len + mlen > size) {
+			size = len + mlen > NI_NL_BATCH_CHUNK_SIZE ?
+				len + mlen : NI_NL_BATCH_CHUNK_SIZE;
+			buf = xrealloc(buf, size);
+		}
+		memset(buf + len, 0, mlen);
+		memcpy(buf + len, h, h->nlmsg_len);
+		item->seq = h->nlmsg_seq;
+		len += mlen;
+	}
+	state->last = i;
+	state->pending = state->last - state->first;
+
+	err = nl_sendto(nl_sock, buf, len);
+	free(buf);
+	if (err < 0) {
+		ni_error("%s: unable to send: %s", __func__, nl_geterror(err));
+		return err;
+	}
+	return 0;
+}
+
+/*
+ * Send all requests and collect their ACKs; returns the number of
+ * failed requests or a negative error when the transaction failed.
+ * The results of the requests are available via ni_nl_batch_result.
+ */
+int
+ni_nl_batch_commit(ni_nl_batch_t *batch)
+{
+	ni_nl_batch_state_t state = { .batch = batch };
+	struct nl_sock *nl_sock;
+	unsigned int i, failed = 0;
+	struct nl_cb *cb;
+	int err = 0;
+
+	if (!batch || !batch->count)
+		return 0;
+
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", __func__);
+		return -NLE_BAD_SOCK;
+	}
+
+	if (!(cb = __ni_nl_cb_clone(__ni_global_netlink)))
+		return -NLE_NOMEM;
+
+	nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, ni_nl_batch_seq_check, NULL);
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, ni_nl_batch_ack_handler, &state);
+	nl_cb_err(cb, NL_CB_CUSTOM, ni_nl_batch_error_handler, &state);
+
+	for (state.first = 0; state.first < batch->count; state.first = state.last) {
+		if ((err = ni_nl_batch_send_chunk(nl_sock, &state)) < 0)
+			break;
+
+		while (state.pending) {
+			if ((err = nl_recvmsgs(nl_sock, cb)) < 0) {
+				ni_debug_socket("%s: recv failed: %s", __func__, nl_geterror(err));
+				break;
+			}
+		}
+		if (err < 0)
+			break;
+	}
+	nl_cb_put(cb);
+
+	for (i = 0; i < batch->count; ++i) {
+		ni_nl_batch_item_t *item = &batch->items[i];
+
+		if (!item->done)
+			item->err = err < 0 ? err : -NLE_FAILURE;
+		if (item->err)
+			failed++;
+	}
+	return err < 0 ? err : (int)failed;
+}
+
 #define ni_t2n(x)	[x] = #x
 static const char *	ni_rtnl_msg_type_names[RTM_MAX] = {
 #ifdef	RTM_NEWLINK
@@ -638,6 +960,10 @@ static const char *	ni_rtnl_msg_type_names[RTM_MAX] = {
 	ni_t2n(RTM_DELNSID),
 	ni_t2n(RTM_GETNSID),
 #endif
+#ifdef	RTM_NEWSTATS
+	ni_t2n(RTM_NEWSTATS),
+	ni_t2n(RTM_GETSTATS),
+#endif
 };
 #undef	ni_t2n
 
@@ -35,6 +35,7 @@ __ni_rta_get_uint16(uint16_t *val, struct rtattr *rta)
 }
 
 extern int		__ni_ethtool(const char *, int, void *);
+extern int		__ni_ethtool_fd(int, const char *, int, void *);
 extern int		__ni_brioctl_add_bridge(const char *);
 extern int		__ni_brioctl_del_bridge(const char *);
 extern int		__ni_brioctl_add_port(const char *, unsigned int);
@@ -64,6 +65,16 @@ struct ni_nlmsg_list {
 
 extern int	ni_nl_talk(struct nl_msg *, struct ni_nlmsg_list *);
 extern int	ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list);
+extern int	ni_nl_dump_store_strict(struct nl_msg *, ni_bool_t, struct ni_nlmsg_list *);
+
+typedef struct ni_nl_batch	ni_nl_batch_t;
+
+extern ni_nl_batch_t *	ni_nl_batch_new(void);
+extern void		ni_nl_batch_free(ni_nl_batch_t *);
+extern int		ni_nl_batch_add(ni_nl_batch_t *, struct nl_msg *);
+extern unsigned int	ni_nl_batch_count(const ni_nl_batch_t *);
+extern int		ni_nl_batch_commit(ni_nl_batch_t *);
+extern int		ni_nl_batch_result(const ni_nl_batch_t *, unsigned int);
 
 extern void	ni_nlmsg_list_init(struct ni_nlmsg_list *);
 extern void	ni_nlmsg_list_destroy(struct ni_nlmsg_list *);
@@ -116,7 +127,7 @@ ni_rtnl_nduseroptmsg(struct nlmsghdr *h, int expected_type)
 	return __ni_rtnl_msgdata(h, expected_type, sizeof(struct nduseroptmsg));
 }
 
-extern ni_bool_t	ni_rtnl_route_filter_msg(struct rtmsg *);
+extern ni_bool_t	ni_rtnl_route_filter_msg(struct nlmsghdr *, struct rtmsg *);
 extern int	ni_rtnl_route_parse_msg(struct nlmsghdr *, struct rtmsg *, ni_route_t *);
 extern int	ni_rtnl_rule_parse_msg(struct nlmsghdr *, struct fib_rule_hdr *, ni_rule_t *);
 
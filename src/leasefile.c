@@ -30,10 +30,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <unistd.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <netlink/netlink.h>
 
 #include <wicked/netinfo.h>
@@ -43,6 +47,7 @@
 #include <wicked/nis.h>
 #include <wicked/route.h>
 #include <wicked/logging.h>
+#include <wicked/time.h>
 #include <wicked/xml.h>
 
 #include "appconfig.h"
@@ -51,6 +56,8 @@
 #include "dhcp4/lease.h"
 #include "dhcp6/lease.h"
 #include "netinfo_priv.h"
+#include "util_priv.h"
+#include "stats.h"
 
 /*
  * utility returning a family + type specific node / name
@@ -1285,107 +1292,422 @@ ni_addrconf_lease_from_xml(ni_addrconf_lease_t **leasep, const xml_node_t *root,
 
 /*
  * lease file read and write routines
+ *
+ * Leases are stored either as xml or in a compact binary form of the
+ * same xml tree, which is read back from a mapped file without going
+ * through the xml parser. Binary files have their own suffix, so old
+ * xml lease files are still found and read.
  */
+#define NI_LEASE_FILE_MAGIC		"WICKEDLF"
+#define NI_LEASE_FILE_VERSION		1U
+#define NI_LEASE_FILE_MAX_SIZE		(1U << 20)
+
+#define NI_LEASE_FILE_SUFFIX_XML	"xml"
+#define NI_LEASE_FILE_SUFFIX_BINARY	"bin"
+
+static const char *		__ni_addrconf_lease_file_suffixes[] = {
+	NI_LEASE_FILE_SUFFIX_BINARY,
+	NI_LEASE_FILE_SUFFIX_XML,
+	NULL
+};
+
 static const char *		__ni_addrconf_lease_file_path(char **,
-				const char *, const char *, int, int);
+				const char *, const char *, int, int, const char *);
 static void			__ni_addrconf_lease_file_remove(
-				const char *, const char *, int, int);
+				const char *, const char *, int, int, const char *);
+
+static int
+__ni_addrconf_lease_file_write_binary(FILE *fp, const xml_node_t *xml)
+{
+	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
+	uint32_t u32;
+	size_t hlen;
+	int ret = -1;
+
+	ni_stringbuf_put(&out, NI_LEASE_FILE_MAGIC, sizeof(NI_LEASE_FILE_MAGIC) - 1);
+	u32 = NI_LEASE_FILE_VERSION;
+	ni_stringbuf_put(&out, (const char *)&u32, sizeof(u32));
+	u32 = 0;
+	ni_stringbuf_put(&out, (const char *)&u32, sizeof(u32));
+	hlen = out.len;
+
+	if (xml_node_write_binary(xml, &out) < 0 || out.len - hlen > NI_LEASE_FILE_MAX_SIZE)
+		goto done;
+
+	u32 = out.len - hlen;
+	memcpy(out.string + hlen - sizeof(u32), &u32, sizeof(u32));
+	ret = ni_file_write(fp, out.string, out.len) < 0 ? -1 : 0;
+
+done:
+	ni_stringbuf_destroy(&out);
+	return ret;
+}
 
 /*
- * Write a lease to a file
+ * Store the lease xml tree in a lease file, atomically replacing it.
+ * Returns the directory the file was written to in dirp.
  */
-int
-ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
+static int
+__ni_addrconf_lease_file_store(const char *ifname, int type, int family,
+				const xml_node_t *xml, const char **dirp)
 {
 	char tempname[PATH_MAX] = {'\0'};
+	const char *dir = ni_config_storedir();
 	ni_bool_t fallback = FALSE;
+	ni_bool_t binary;
+	const char *suffix, **sp;
 	char *filename = NULL;
-	xml_node_t *xml = NULL;
 	FILE *fp = NULL;
-	int ret = -1;
 	int fd;
 
-	if (lease->state == NI_ADDRCONF_STATE_RELEASED) {
-		ni_addrconf_lease_file_remove(ifname, lease->type, lease->family);
-		return 0;
+	binary = ni_config_addrconf_lease_file_format() == NI_CONFIG_LEASE_FILE_BINARY;
+	suffix = binary ? NI_LEASE_FILE_SUFFIX_BINARY : NI_LEASE_FILE_SUFFIX_XML;
+
+	/* the storedir of the initrd is gone after the switch-root */
+	if (ni_running_in_initrd()) {
+		dir = ni_config_statedir();
+		fallback = TRUE;
 	}
 
-	if (!__ni_addrconf_lease_file_path(&filename, ni_config_storedir(),
-					ifname, lease->type, lease->family)) {
+	if (!__ni_addrconf_lease_file_path(&filename, dir, ifname, type, family, suffix)) {
 		ni_error("Cannot construct lease file name: %m");
 		return -1;
 	}
 
-	ni_debug_dhcp("Preparing xml lease data for '%s'", filename);
-	if ((ret = ni_addrconf_lease_to_xml(lease, &xml, ifname)) != 0) {
-		if (ret > 0) {
-			ni_debug_dhcp("Skipped, %s:%s leases are disabled",
-		                        ni_addrfamily_type_to_name(lease->family),
-					ni_addrconf_type_to_name(lease->type));
-		} else {
-			ni_error("Unable to represent %s:%s lease as XML",
-					ni_addrfamily_type_to_name(lease->family),
-					ni_addrconf_type_to_name(lease->type));
-		}
-		goto failed;
-	}
-
 	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
 	if ((fd = mkstemp(tempname)) < 0) {
 		if (errno == EROFS && __ni_addrconf_lease_file_path(&filename,
 						ni_config_statedir(), ifname,
-						lease->type, lease->family)) {
+						type, family, suffix)) {
 			ni_debug_dhcp("Read-only filesystem, try fallback to %s",
 					filename);
 			snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
 			fd = mkstemp(tempname);
+			dir = ni_config_statedir();
 			fallback = TRUE;
 		}
 		if (fd < 0) {
 			ni_error("Cannot create temporary lease file '%s': %m",
 					tempname);
 			tempname[0] = '\0';
-			ret = -1;
 			goto failed;
 		}
 	}
 	if ((fp = fdopen(fd, "we")) == NULL) {
-		ret = -1;
 		close(fd);
 		ni_error("Cannot reopen temporary lease file '%s': %m", tempname);
 		goto failed;
 	}
 
 	ni_debug_dhcp("Writing lease to temporary file for '%s'", filename);
-	xml_node_print(xml, fp);
+	if (binary) {
+		if (__ni_addrconf_lease_file_write_binary(fp, xml) < 0) {
+			ni_error("Unable to write binary lease file '%s'", tempname);
+			goto failed;
+		}
+	} else {
+		xml_node_print(xml, fp);
+	}
 	fclose(fp);
 	fp = NULL;
-	xml_node_free(xml);
 
-	if ((ret = rename(tempname, filename)) != 0) {
+	if (rename(tempname, filename) != 0) {
 		ni_error("Unable to rename temporary lease file '%s' to '%s': %m",
 				tempname, filename);
 		goto failed;
-	} else if (!fallback) {
-		__ni_addrconf_lease_file_remove(ni_config_statedir(),
-				ifname, lease->type, lease->family);
+	}
+	ni_stats_inc(NI_STATS_LEASE_WRITES);
+
+	/* drop the lease in the other format and the statedir fallback */
+	for (sp = __ni_addrconf_lease_file_suffixes; *sp; ++sp) {
+		if (!fallback)
+			__ni_addrconf_lease_file_remove(ni_config_statedir(),
+					ifname, type, family, *sp);
+		if (!ni_string_eq(*sp, suffix))
+			__ni_addrconf_lease_file_remove(dir, ifname, type, family, *sp);
 	}
 
 	ni_debug_dhcp("Lease written to file '%s'", filename);
 	ni_string_free(&filename);
+	if (dirp)
+		*dirp = dir;
 	return 0;
 
 failed:
 	if (fp)
 		fclose(fp);
-	if (xml)
-		xml_node_free(xml);
 	if (tempname[0])
 		unlink(tempname);
 	ni_string_free(&filename);
 	return -1;
 }
 
+/*
+ * Write-behind lease store
+ *
+ * With a <lease-file-delay> configured, lease updates are kept in
+ * memory and written in one batch once the delay expired, followed
+ * by one sync of each lease directory. Updates of the same lease
+ * within the delay replace each other, so only the last one is
+ * written.
+ */
+typedef struct ni_addrconf_lease_file_pending ni_addrconf_lease_file_pending_t;
+struct ni_addrconf_lease_file_pending {
+	ni_addrconf_lease_file_pending_t *next;
+	char *			ifname;
+	int			type;
+	int			family;
+	xml_node_t *		xml;
+};
+
+static struct {
+	ni_addrconf_lease_file_pending_t *list;
+	const ni_timer_t *	timer;
+} ni_addrconf_lease_file_queue;
+
+static ni_addrconf_lease_file_pending_t **
+__ni_addrconf_lease_file_pending_find(const char *ifname, int type, int family)
+{
+	ni_addrconf_lease_file_pending_t **pos, *cur;
+
+	for (pos = &ni_addrconf_lease_file_queue.list; (cur = *pos); pos = &cur->next) {
+		if (cur->type == type && cur->family == family &&
+		    ni_string_eq(cur->ifname, ifname))
+			return pos;
+	}
+	return NULL;
+}
+
+static void
+__ni_addrconf_lease_file_pending_free(ni_addrconf_lease_file_pending_t *pending)
+{
+	ni_string_free(&pending->ifname);
+	xml_node_free(pending->xml);
+	free(pending);
+}
+
+static void
+__ni_addrconf_lease_file_pending_drop(const char *ifname, int type, int family)
+{
+	ni_addrconf_lease_file_pending_t **pos, *cur;
+
+	if ((pos = __ni_addrconf_lease_file_pending_find(ifname, type, family))) {
+		cur = *pos;
+		*pos = cur->next;
+		__ni_addrconf_lease_file_pending_free(cur);
+	}
+}
+
+static void
+__ni_addrconf_lease_file_sync_dir(const char *dir)
+{
+	int fd;
+
+	if ((fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+		return;
+	/* flushes the lease data and the renames in one go */
+	if (syncfs(fd) < 0)
+		ni_warn("Unable to sync lease directory '%s': %m", dir);
+	close(fd);
+}
+
+static void
+__ni_addrconf_lease_file_timeout(void *user_data, const ni_timer_t *timer)
+{
+	if (ni_addrconf_lease_file_queue.timer == timer) {
+		ni_addrconf_lease_file_queue.timer = NULL;
+		ni_addrconf_lease_file_flush();
+	}
+}
+
+/*
+ * Write all pending lease updates and sync the lease directories.
+ * To be called before exit.
+ */
+void
+ni_addrconf_lease_file_flush(void)
+{
+	ni_addrconf_lease_file_pending_t *cur;
+	const char *dirs[2] = { NULL, NULL };
+	const char *dir;
+	unsigned int count = 0;
+
+	if (ni_addrconf_lease_file_queue.timer) {
+		ni_timer_cancel(ni_addrconf_lease_file_queue.timer);
+		ni_addrconf_lease_file_queue.timer = NULL;
+	}
+
+	while ((cur = ni_addrconf_lease_file_queue.list)) {
+		ni_addrconf_lease_file_queue.list = cur->next;
+
+		dir = NULL;
+		if (__ni_addrconf_lease_file_store(cur->ifname, cur->type,
+					cur->family, cur->xml, &dir) == 0) {
+			if (!dirs[0] || ni_string_eq(dirs[0], dir))
+				dirs[0] = dir;
+			else
+				dirs[1] = dir;
+			count++;
+		}
+		__ni_addrconf_lease_file_pending_free(cur);
+	}
+
+	if (count)
+		ni_debug_dhcp("Flushed %u pending lease file updates", count);
+	if (dirs[0])
+		__ni_addrconf_lease_file_sync_dir(dirs[0]);
+	if (dirs[1])
+		__ni_addrconf_lease_file_sync_dir(dirs[1]);
+}
+
+/*
+ * Write a lease to a file
+ */
+int
+ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
+{
+	ni_addrconf_lease_file_pending_t **pos, *pending;
+	xml_node_t *xml = NULL;
+	unsigned int delay;
+	int ret;
+
+	if (lease->state == NI_ADDRCONF_STATE_RELEASED) {
+		ni_addrconf_lease_file_remove(ifname, lease->type, lease->family);
+		return 0;
+	}
+
+	ni_debug_dhcp("Preparing xml lease data for %s:%s lease on %s",
+			ni_addrfamily_type_to_name(lease->family),
+			ni_addrconf_type_to_name(lease->type), ifname);
+	if ((ret = ni_addrconf_lease_to_xml(lease, &xml, ifname)) != 0) {
+		if (ret > 0) {
+			ni_debug_dhcp("Skipped, %s:%s leases are disabled",
+		                        ni_addrfamily_type_to_name(lease->family),
+					ni_addrconf_type_to_name(lease->type));
+		} else {
+			ni_error("Unable to represent %s:%s lease as XML",
+					ni_addrfamily_type_to_name(lease->family),
+					ni_addrconf_type_to_name(lease->type));
+		}
+		xml_node_free(xml);
+		return -1;
+	}
+
+	if (!(delay = ni_config_addrconf_lease_file_delay())) {
+		ret = __ni_addrconf_lease_file_store(ifname, lease->type,
+					lease->family, xml, NULL);
+		xml_node_free(xml);
+		return ret;
+	}
+
+	if ((pos = __ni_addrconf_lease_file_pending_find(ifname, lease->type, lease->family))) {
+		pending = *pos;
+		xml_node_free(pending->xml);
+	} else {
+		pending = xcalloc(1, sizeof(*pending));
+		ni_string_dup(&pending->ifname, ifname);
+		pending->type = lease->type;
+		pending->family = lease->family;
+		pending->next = ni_addrconf_lease_file_queue.list;
+		ni_addrconf_lease_file_queue.list = pending;
+	}
+	pending->xml = xml;
+
+	if (!ni_addrconf_lease_file_queue.timer)
+		ni_addrconf_lease_file_queue.timer = ni_timer_register(delay,
+					__ni_addrconf_lease_file_timeout, NULL);
+	if (!ni_addrconf_lease_file_queue.timer)
+		ni_addrconf_lease_file_flush();
+	return 0;
+}
+
+static xml_node_t *
+__ni_addrconf_lease_file_read_binary(int fd, const char *filename)
+{
+	char magic[sizeof(NI_LEASE_FILE_MAGIC) - 1];
+	const unsigned char *data;
+	uint32_t version, len;
+	xml_node_t *xml = NULL;
+	size_t hlen, used = 0;
+	struct stat stb;
+	void *addr;
+
+	hlen = sizeof(magic) + sizeof(version) + sizeof(len);
+	if (fstat(fd, &stb) < 0 || (size_t)stb.st_size < hlen ||
+	    (size_t)stb.st_size > hlen + NI_LEASE_FILE_MAX_SIZE)
+		return NULL;
+
+	addr = mmap(NULL, stb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED)
+		return NULL;
+
+	data = addr;
+	memcpy(magic, data, sizeof(magic));
+	memcpy(&version, data + sizeof(magic), sizeof(version));
+	memcpy(&len, data + sizeof(magic) + sizeof(version), sizeof(len));
+
+	if (!memcmp(magic, NI_LEASE_FILE_MAGIC, sizeof(magic)) &&
+	    version == NI_LEASE_FILE_VERSION &&
+	    len == (size_t)stb.st_size - hlen) {
+		xml = xml_node_read_binary(data + hlen, len, &used, filename);
+		if (xml && used != len) {
+			xml_node_free(xml);
+			xml = NULL;
+		}
+	}
+
+	munmap(addr, stb.st_size);
+	return xml;
+}
+
+static xml_node_t *
+__ni_addrconf_lease_file_read_xml(int fd, const char *filename)
+{
+	xml_node_t *xml;
+	FILE *fp;
+
+	if ((fp = fdopen(fd, "re")) == NULL)
+		return NULL;
+
+	xml = xml_node_scan(fp, filename);
+	fclose(fp);
+	return xml;
+}
+
+/*
+ * Open the lease file, trying the statedir first and preferring
+ * the binary over the xml format in each directory.
+ */
+static int
+__ni_addrconf_lease_file_open(char **filename, const char *ifname,
+				int type, int family, const char **suffix)
+{
+	const char *dirs[] = { ni_config_statedir(), ni_config_storedir(), NULL };
+	const char **dp, **sp;
+	int fd;
+
+	for (dp = dirs; *dp; ++dp) {
+		for (sp = __ni_addrconf_lease_file_suffixes; *sp; ++sp) {
+			if (!__ni_addrconf_lease_file_path(filename, *dp,
+						ifname, type, family, *sp)) {
+				ni_error("Unable to construct lease file name: %m");
+				return -1;
+			}
+
+			if ((fd = open(*filename, O_RDONLY | O_CLOEXEC)) >= 0) {
+				*suffix = *sp;
+				return fd;
+			}
+			if (errno != ENOENT) {
+				ni_error("Unable to open %s for reading: %m",
+						*filename);
+				return -1;
+			}
+		}
+	}
+	return -1;
+}
+
 /*
  * Read a lease from a file
  */
@@ -1394,36 +1716,31 @@ ni_addrconf_lease_file_read(const char *ifname, int type, int family)
 {
 	ni_addrconf_lease_t *lease = NULL;
 	xml_node_t *xml = NULL, *lnode;
+	ni_addrconf_lease_file_pending_t **pos;
+	const char *suffix = NULL;
 	char *filename = NULL;
-	FILE *fp;
+	int fd;
 
-	if (!__ni_addrconf_lease_file_path(&filename,
-				ni_config_statedir(),
-				ifname, type, family)) {
-		ni_error("Unable to construct lease file name: %m");
-		return NULL;
+	/* a not yet written update is the current lease */
+	if ((pos = __ni_addrconf_lease_file_pending_find(ifname, type, family))) {
+		if (ni_addrconf_lease_from_xml(&lease, (*pos)->xml, ifname) < 0)
+			return NULL;
+		return lease;
 	}
 
-	if ((fp = fopen(filename, "re")) == NULL) {
-		if (errno == ENOENT) {
-			if (__ni_addrconf_lease_file_path(&filename,
-						ni_config_storedir(),
-						ifname, type, family))
-				fp = fopen(filename, "re");
-		}
-		if (fp == NULL) {
-			if (errno != ENOENT) {
-				ni_error("Unable to open %s for reading: %m",
-						filename);
-			}
-			ni_string_free(&filename);
-			return NULL;
-		}
+	if ((fd = __ni_addrconf_lease_file_open(&filename, ifname,
+					type, family, &suffix)) < 0) {
+		ni_string_free(&filename);
+		return NULL;
 	}
 
 	ni_debug_dhcp("Reading lease from %s", filename);
-	xml = xml_node_scan(fp, filename);
-	fclose(fp);
+	if (ni_string_eq(suffix, NI_LEASE_FILE_SUFFIX_BINARY)) {
+		xml = __ni_addrconf_lease_file_read_binary(fd, filename);
+		close(fd);
+	} else {
+		xml = __ni_addrconf_lease_file_read_xml(fd, filename);
+	}
 
 	if (xml == NULL) {
 		ni_error("Unable to parse %s", filename);
@@ -1460,11 +1777,11 @@ ni_addrconf_lease_file_read(const char *ifname, int type, int family)
  */
 static void
 __ni_addrconf_lease_file_remove(const char *dir, const char *ifname,
-				int type, int family)
+				int type, int family, const char *suffix)
 {
 	char *filename = NULL;
 
-	if (!__ni_addrconf_lease_file_path(&filename, dir, ifname, type, family))
+	if (!__ni_addrconf_lease_file_path(&filename, dir, ifname, type, family, suffix))
 		return;
 
 	if (ni_file_exists(filename) && unlink(filename) == 0)
@@ -1475,40 +1792,47 @@ __ni_addrconf_lease_file_remove(const char *dir, const char *ifname,
 void
 ni_addrconf_lease_file_remove(const char *ifname, int type, int family)
 {
-	__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname, type, family);
-	__ni_addrconf_lease_file_remove(ni_config_storedir(), ifname, type, family);
+	const char **sp;
+
+	__ni_addrconf_lease_file_pending_drop(ifname, type, family);
+	for (sp = __ni_addrconf_lease_file_suffixes; *sp; ++sp) {
+		__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname, type, family, *sp);
+		__ni_addrconf_lease_file_remove(ni_config_storedir(), ifname, type, family, *sp);
+	}
 }
 
 static const char *
 __ni_addrconf_lease_file_path(char **path, const char *dir,
-		const char *ifname, int type, int family)
+		const char *ifname, int type, int family, const char *suffix)
 {
 	const char *t = ni_addrconf_type_to_name(type);
 	const char *f = ni_addrfamily_type_to_name(family);
 
 	if (!path || ni_string_empty(dir) || ni_string_empty(ifname) || !t || !f)
 		return NULL;
-	return ni_string_printf(path, "%s/lease-%s-%s-%s.xml", dir, ifname, t, f);
+	return ni_string_printf(path, "%s/lease-%s-%s-%s.%s", dir, ifname, t, f, suffix);
 }
 
 ni_bool_t
 ni_addrconf_lease_file_exists(const char *ifname, int type, int family)
 {
+	const char *dirs[] = { ni_config_statedir(), ni_config_storedir(), NULL };
+	const char **dp, **sp;
 	char *filename = NULL;
 
-	if (__ni_addrconf_lease_file_path(&filename, ni_config_statedir(), ifname, type, family)) {
-		if (ni_file_exists(filename)) {
-			ni_string_free(&filename);
-			return TRUE;
-		}
-	}
-	if (__ni_addrconf_lease_file_path(&filename, ni_config_storedir(), ifname, type, family)) {
-		if (ni_file_exists(filename)) {
-			ni_string_free(&filename);
-			return TRUE;
+	if (__ni_addrconf_lease_file_pending_find(ifname, type, family))
+		return TRUE;
+
+	for (dp = dirs; *dp; ++dp) {
+		for (sp = __ni_addrconf_lease_file_suffixes; *sp; ++sp) {
+			if (__ni_addrconf_lease_file_path(&filename, *dp,
+						ifname, type, family, *sp) &&
+			    ni_file_exists(filename)) {
+				ni_string_free(&filename);
+				return TRUE;
+			}
 		}
 	}
 	ni_string_free(&filename);
 	return FALSE;
 }
-
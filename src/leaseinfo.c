@@ -28,11 +28,14 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 #include <arpa/inet.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <time.h>
+#include <errno.h>
 
 #include <wicked/leaseinfo.h>
 
@@ -801,12 +804,151 @@ ni_leaseinfo_path(const char *ifname, const ni_addrconf_mode_t type,
 	return filename;
 }
 
+/*
+ * Replace the leaseinfo file with new data using a temporary file
+ * and rename, so readers never see a partially written file.
+ * The file is not touched at all when the data did not change.
+ *
+ * Returns 1 when the file has been created, 0 when it has been
+ * replaced or kept and -1 on error.
+ */
+static int
+__ni_leaseinfo_file_update(const char *filename, const char *data, size_t len)
+{
+	char *tempname = NULL;
+	ni_bool_t created;
+	int fd, ret = -1;
+	FILE *fp;
+
+	if ((fp = fopen(filename, "re")) != NULL) {
+		size_t olen = 0;
+		char *odata;
+		ni_bool_t same;
+
+		odata = ni_file_read(fp, &olen, len + 1);
+		fclose(fp);
+
+		same = odata && olen == len && !memcmp(odata, data, len);
+		free(odata);
+		if (same) {
+			ni_debug_dhcp("Leaseinfo file %s is unchanged", filename);
+			return 0;
+		}
+		created = FALSE;
+	} else {
+		created = errno == ENOENT;
+	}
+
+	if (!ni_string_printf(&tempname, "%s/.%s.XXXXXX",
+			ni_config_statedir(), ni_basename(filename)))
+		goto cleanup;
+
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_error("Cannot create temporary file for %s: %m", filename);
+		ni_string_free(&tempname);
+		goto cleanup;
+	}
+	if (fchmod(fd, 0644) < 0 || (fp = fdopen(fd, "we")) == NULL) {
+		ni_error("Cannot open temporary file %s: %m", tempname);
+		close(fd);
+		goto cleanup;
+	}
+
+	if ((len && ni_file_write(fp, data, len) < 0) | (fclose(fp) != 0)) {
+		ni_error("Cannot write temporary file %s: %m", tempname);
+		goto cleanup;
+	}
+
+	if (rename(tempname, filename) != 0) {
+		ni_error("Cannot rename %s to %s: %m", tempname, filename);
+		goto cleanup;
+	}
+	ni_string_free(&tempname);
+
+	ni_debug_dhcp("Leaseinfo file %s %s", filename,
+			created ? "created" : "updated");
+	ret = created ? 1 : 0;
+
+cleanup:
+	if (tempname) {
+		unlink(tempname);
+		ni_string_free(&tempname);
+	}
+	return ret;
+}
+
+char *
+ni_leaseinfo_index_path(void)
+{
+	char *filename = NULL;
+
+	ni_string_printf(&filename, "%s/leaseinfo.index", ni_config_statedir());
+	return filename;
+}
+
+static int
+__ni_leaseinfo_index_cmp(const void *a, const void *b)
+{
+	return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+/*
+ * Refresh the consolidated index of all leaseinfo files in the state
+ * directory, e.g. to permit netconfig to read one file instead to scan
+ * the directory. Each line contains the interface name, lease type and
+ * family, followed by the leaseinfo file name.
+ */
+void
+ni_leaseinfo_index_update(void)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	const char *statedir = ni_config_statedir();
+	char *filename = NULL;
+	unsigned int i;
+
+	if (!(filename = ni_leaseinfo_index_path()))
+		return;
+
+	ni_scandir(statedir, "leaseinfo.*", &files);
+	if (files.count > 1)
+		qsort(files.data, files.count, sizeof(files.data[0]),
+				__ni_leaseinfo_index_cmp);
+
+	ni_stringbuf_puts(&buf, "# interface type family leaseinfo\n");
+	for (i = 0; i < files.count; ++i) {
+		char *name, *type, *family;
+
+		name = files.data[i] + sizeof("leaseinfo.") - 1;
+		if (!(family = strrchr(name, '.')) || family == name)
+			continue;
+		*family++ = '\0';
+		if (!(type = strrchr(name, '.')) || type == name)
+			continue;
+		*type++ = '\0';
+
+		if (ni_addrconf_name_to_type(type) < 0 ||
+		    ni_addrfamily_name_to_type(family) < 0)
+			continue;
+
+		ni_stringbuf_printf(&buf, "%s %s %s %s/leaseinfo.%s.%s.%s\n",
+				name, type, family, statedir, name, type, family);
+	}
+	ni_string_array_destroy(&files);
+
+	__ni_leaseinfo_file_update(filename, buf.string, buf.len);
+	ni_stringbuf_destroy(&buf);
+	ni_string_free(&filename);
+}
+
 void
 ni_leaseinfo_dump(FILE *out, const ni_addrconf_lease_t *lease,
 		const char *ifname, const char *prefix)
 {
 
 	char *filename = NULL;
+	char *data = NULL;
+	size_t size = 0;
 	ni_bool_t close_out_fp = TRUE; /* Used to prevent unwanted closure of
 					* things like stdout.
 					*/
@@ -821,8 +963,9 @@ ni_leaseinfo_dump(FILE *out, const ni_addrconf_lease_t *lease,
 		ni_leaseinfo_remove(ifname, lease->type, lease->family);
 	}
 
-	/* If we're supplied a FILE pointer, use it. Otherwise, open a file based
-	 * on lease info (ifname, type, family).
+	/* If we're supplied a FILE pointer, use it. Otherwise, dump into
+	 * a buffer and update the file based on lease info (ifname, type,
+	 * family) when the buffer differs from the current file content.
 	 */
 	if (!out) {
 		if ((filename = ni_leaseinfo_path(ifname, lease->type, lease->family)) == NULL) {
@@ -830,8 +973,9 @@ ni_leaseinfo_dump(FILE *out, const ni_addrconf_lease_t *lease,
 			return;
 		}
 
-		if ((out = fopen(filename, "w")) == NULL) {
-			ni_error("Cannot open %s", filename);
+		if ((out = open_memstream(&data, &size)) == NULL) {
+			ni_error("Cannot create leaseinfo buffer for %s: %m", filename);
+			ni_string_free(&filename);
 			return;
 		}
 	} else {
@@ -863,8 +1007,14 @@ ni_leaseinfo_dump(FILE *out, const ni_addrconf_lease_t *lease,
 		break;
 	}
 
-	if (close_out_fp)
-		fclose(out);
+	if (close_out_fp) {
+		if (fclose(out) != 0)
+			ni_error("Cannot dump leaseinfo for %s: %m", filename);
+		else
+		if (__ni_leaseinfo_file_update(filename, data, size) > 0)
+			ni_leaseinfo_index_update();
+	}
+	free(data);
 	ni_string_free(&filename);
 }
 
@@ -880,6 +1030,7 @@ ni_leaseinfo_remove(const char *ifname, const ni_addrconf_mode_t type,
 	}
 
 	ni_debug_dhcp("Removing leaseinfo file: %s", filename);
-	unlink(filename);
+	if (unlink(filename) == 0)
+		ni_leaseinfo_index_update();
 	ni_string_free(&filename);
 }
@@ -0,0 +1,407 @@
+/*
+ *	Periodic link statistics sampling of the wickedd daemon
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	The link statistics in the netdev are a snapshot of the last
+ *	discovery. To provide rates, the subscribed interfaces are sampled
+ *	using a single RTM_GETSTATS dump of the 64bit link counters per
+ *	interval and the samples are kept in a ring per interface, which
+ *	is a plain array of rows with the time stamp and the counters.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+
+#include <wicked/util.h>
+#include <wicked/time.h>
+#include <wicked/logging.h>
+#include "netinfo_priv.h"
+#include "util_priv.h"
+#include "appconfig.h"
+#include "kernel.h"
+#include "link-sampler.h"
+
+/* a ring row is the sample time in msec followed by the counters */
+#define NI_LINK_SAMPLER_ROW_SIZE	(1 + NI_LINK_SAMPLER_COUNTER_MAX)
+
+typedef struct ni_link_sampler_entry	ni_link_sampler_entry_t;
+
+struct ni_link_sampler_entry {
+	ni_link_sampler_entry_t *next;
+
+	unsigned int		ifindex;
+	ni_bool_t		seen;
+
+	unsigned int		size;		/* ring rows		*/
+	unsigned int		head;		/* next row to write	*/
+	unsigned int		count;		/* valid rows		*/
+	uint64_t *		ring;
+};
+
+static struct {
+	ni_link_sampler_entry_t *entries;
+	const ni_timer_t *	timer;
+	unsigned int		interval;
+} ni_link_sampler;
+
+static const char *		ni_link_sampler_counter_names[NI_LINK_SAMPLER_COUNTER_MAX] = {
+	[NI_LINK_SAMPLER_RX_BYTES]	= "rx-bytes",
+	[NI_LINK_SAMPLER_TX_BYTES]	= "tx-bytes",
+	[NI_LINK_SAMPLER_RX_PACKETS]	= "rx-packets",
+	[NI_LINK_SAMPLER_TX_PACKETS]	= "tx-packets",
+	[NI_LINK_SAMPLER_RX_ERRORS]	= "rx-errors",
+	[NI_LINK_SAMPLER_TX_ERRORS]	= "tx-errors",
+	[NI_LINK_SAMPLER_RX_DROPPED]	= "rx-dropped",
+	[NI_LINK_SAMPLER_TX_DROPPED]	= "tx-dropped",
+	[NI_LINK_SAMPLER_MULTICAST]	= "multicast",
+};
+
+static void			ni_link_sampler_arm(void);
+
+const char *
+ni_link_sampler_counter_name(unsigned int counter)
+{
+	return counter < NI_LINK_SAMPLER_COUNTER_MAX ?
+		ni_link_sampler_counter_names[counter] : NULL;
+}
+
+static unsigned int
+ni_link_sampler_interval(void)
+{
+	unsigned int interval = ni_config_link_stats_interval();
+
+	if (!interval)
+		return NI_LINK_SAMPLER_INTERVAL;
+	return max_t(unsigned int, interval, NI_LINK_SAMPLER_INTERVAL_MIN);
+}
+
+static unsigned int
+ni_link_sampler_history(void)
+{
+	unsigned int history = ni_config_link_stats_history();
+
+	if (!history)
+		return NI_LINK_SAMPLER_HISTORY;
+	history = max_t(unsigned int, history, 2);
+	return min_t(unsigned int, history, NI_LINK_SAMPLER_HISTORY_MAX);
+}
+
+static ni_link_sampler_entry_t *
+ni_link_sampler_entry_find(unsigned int ifindex)
+{
+	ni_link_sampler_entry_t *entry;
+
+	for (entry = ni_link_sampler.entries; entry; entry = entry->next) {
+		if (entry->ifindex == ifindex)
+			return entry;
+	}
+	return NULL;
+}
+
+static void
+ni_link_sampler_entry_free(ni_link_sampler_entry_t *entry)
+{
+	free(entry->ring);
+	free(entry);
+}
+
+/* the n-th newest row of the ring */
+static const uint64_t *
+ni_link_sampler_entry_row(const ni_link_sampler_entry_t *entry, unsigned int n)
+{
+	unsigned int pos = (entry->head + entry->size - 1 - n) % entry->size;
+
+	return entry->ring + (size_t)pos * NI_LINK_SAMPLER_ROW_SIZE;
+}
+
+static void
+ni_link_sampler_entry_add(ni_link_sampler_entry_t *entry, uint64_t msec,
+			const struct rtnl_link_stats64 *stats)
+{
+	const uint64_t *last;
+	uint64_t *row;
+	unsigned int i;
+
+	row = entry->ring + (size_t)entry->head * NI_LINK_SAMPLER_ROW_SIZE;
+	row[0] = msec;
+	row[1 + NI_LINK_SAMPLER_RX_BYTES]	= stats->rx_bytes;
+	row[1 + NI_LINK_SAMPLER_TX_BYTES]	= stats->tx_bytes;
+	row[1 + NI_LINK_SAMPLER_RX_PACKETS]	= stats->rx_packets;
+	row[1 + NI_LINK_SAMPLER_TX_PACKETS]	= stats->tx_packets;
+	row[1 + NI_LINK_SAMPLER_RX_ERRORS]	= stats->rx_errors;
+	row[1 + NI_LINK_SAMPLER_TX_ERRORS]	= stats->tx_errors;
+	row[1 + NI_LINK_SAMPLER_RX_DROPPED]	= stats->rx_dropped;
+	row[1 + NI_LINK_SAMPLER_TX_DROPPED]	= stats->tx_dropped;
+	row[1 + NI_LINK_SAMPLER_MULTICAST]	= stats->multicast;
+
+	/* counters went backwards (reset), restart the history */
+	if (entry->count) {
+		last = ni_link_sampler_entry_row(entry, 0);
+		for (i = 1; i < NI_LINK_SAMPLER_ROW_SIZE; ++i) {
+			if (row[i] < last[i]) {
+				entry->count = 0;
+				break;
+			}
+		}
+	}
+
+	entry->head = (entry->head + 1) % entry->size;
+	if (entry->count < entry->size)
+		entry->count++;
+}
+
+#ifdef	RTM_GETSTATS
+static int
+ni_link_sampler_dump(struct ni_nlmsg_list *list)
+{
+	struct if_stats_msg ifsm;
+	struct nl_msg *msg;
+	int rv;
+
+	if (!(msg = nlmsg_alloc_simple(RTM_GETSTATS, NLM_F_DUMP)))
+		return -NLE_NOMEM;
+
+	memset(&ifsm, 0, sizeof(ifsm));
+	ifsm.family = AF_UNSPEC;
+	ifsm.filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+
+	if (nlmsg_append(msg, &ifsm, sizeof(ifsm), NLMSG_ALIGNTO) < 0) {
+		nlmsg_free(msg);
+		return -NLE_NOMEM;
+	}
+
+	rv = ni_nl_dump_store_strict(msg, FALSE, list);
+	nlmsg_free(msg);
+	return rv;
+}
+
+static void
+ni_link_sampler_sample(void)
+{
+	struct ni_nlmsg_list list;
+	struct nlattr *tb[IFLA_STATS_MAX + 1];
+	struct rtnl_link_stats64 stats;
+	ni_link_sampler_entry_t *entry, **pos;
+	const struct if_stats_msg *ifsm;
+	struct ni_nlmsg *nlm;
+	struct timeval now;
+	uint64_t msec;
+	int rv;
+
+	for (entry = ni_link_sampler.entries; entry; entry = entry->next)
+		entry->seen = FALSE;
+
+	ni_nlmsg_list_init(&list);
+	if ((rv = ni_link_sampler_dump(&list)) < 0) {
+		ni_debug_ifconfig("unable to dump link stats: %s", nl_geterror(rv));
+		ni_nlmsg_list_destroy(&list);
+		return;
+	}
+
+	ni_timer_get_time(&now);
+	msec = (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+
+	for (nlm = list.head; nlm; nlm = nlm->next) {
+		if (nlm->h.nlmsg_type != RTM_NEWSTATS ||
+		    nlm->h.nlmsg_len < NLMSG_LENGTH(sizeof(*ifsm)))
+			continue;
+
+		ifsm = NLMSG_DATA(&nlm->h);
+		if (!(entry = ni_link_sampler_entry_find(ifsm->ifindex)))
+			continue;
+
+		if (nlmsg_parse(&nlm->h, sizeof(*ifsm), tb, IFLA_STATS_MAX, NULL) < 0 ||
+		    !tb[IFLA_STATS_LINK_64] ||
+		    nla_len(tb[IFLA_STATS_LINK_64]) < (int)sizeof(stats))
+			continue;
+
+		/* the attribute payload is not 64bit aligned */
+		memcpy(&stats, nla_data(tb[IFLA_STATS_LINK_64]), sizeof(stats));
+		ni_link_sampler_entry_add(entry, msec, &stats);
+		entry->seen = TRUE;
+	}
+	ni_nlmsg_list_destroy(&list);
+
+	/* drop the interfaces which do not exist any more */
+	for (pos = &ni_link_sampler.entries; (entry = *pos); ) {
+		if (entry->seen) {
+			pos = &entry->next;
+			continue;
+		}
+		ni_debug_ifconfig("link stats sampling of ifindex %u stopped: no such device",
+				entry->ifindex);
+		*pos = entry->next;
+		ni_link_sampler_entry_free(entry);
+	}
+}
+#else
+static void
+ni_link_sampler_sample(void)
+{
+	ni_link_sampler_entry_t *entry;
+
+	/* without RTM_GETSTATS support nothing can be sampled */
+	while ((entry = ni_link_sampler.entries)) {
+		ni_link_sampler.entries = entry->next;
+		ni_link_sampler_entry_free(entry);
+	}
+}
+#endif
+
+static void
+ni_link_sampler_timeout(void *user_data, const ni_timer_t *timer)
+{
+	(void)user_data;
+
+	if (ni_link_sampler.timer != timer)
+		return;
+
+	ni_link_sampler.timer = NULL;
+	ni_link_sampler_sample();
+	ni_link_sampler_arm();
+}
+
+static void
+ni_link_sampler_arm(void)
+{
+	if (!ni_link_sampler.entries) {
+		if (ni_link_sampler.timer)
+			ni_timer_cancel(ni_link_sampler.timer);
+		ni_link_sampler.timer = NULL;
+		return;
+	}
+
+	if (!ni_link_sampler.timer) {
+		ni_link_sampler.interval = ni_link_sampler_interval();
+		ni_link_sampler.timer = ni_timer_register(ni_link_sampler.interval,
+					ni_link_sampler_timeout, NULL);
+	}
+}
+
+/*
+ * Start to sample the interface, returns 0 when it is (already)
+ * subscribed, -1 when no statistics can be sampled for it.
+ */
+int
+ni_link_sampler_subscribe(unsigned int ifindex)
+{
+	ni_link_sampler_entry_t *entry;
+
+	if (!ifindex)
+		return -1;
+
+	if (ni_link_sampler_entry_find(ifindex))
+		return 0;
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->ifindex = ifindex;
+	entry->size = ni_link_sampler_history();
+	entry->ring = xcalloc(entry->size, NI_LINK_SAMPLER_ROW_SIZE * sizeof(uint64_t));
+	entry->next = ni_link_sampler.entries;
+	ni_link_sampler.entries = entry;
+
+	/* take the first sample as base for the rates */
+	ni_link_sampler_sample();
+	if (!ni_link_sampler_entry_find(ifindex)) {
+		ni_link_sampler_arm();
+		return -1;
+	}
+
+	ni_debug_ifconfig("link stats sampling of ifindex %u started", ifindex);
+	ni_link_sampler_arm();
+	return 0;
+}
+
+int
+ni_link_sampler_unsubscribe(unsigned int ifindex)
+{
+	ni_link_sampler_entry_t *entry, **pos;
+
+	for (pos = &ni_link_sampler.entries; (entry = *pos); pos = &entry->next) {
+		if (entry->ifindex != ifindex)
+			continue;
+
+		*pos = entry->next;
+		ni_link_sampler_entry_free(entry);
+		ni_link_sampler_arm();
+
+		ni_debug_ifconfig("link stats sampling of ifindex %u stopped", ifindex);
+		return 0;
+	}
+	return -1;
+}
+
+unsigned int
+ni_link_sampler_count(void)
+{
+	ni_link_sampler_entry_t *entry;
+	unsigned int count = 0;
+
+	for (entry = ni_link_sampler.entries; entry; entry = entry->next)
+		count++;
+	return count;
+}
+
+static void
+ni_link_sampler_rate(uint64_t *rates, const uint64_t *newer, const uint64_t *older)
+{
+	uint64_t msec = newer[0] - older[0];
+	unsigned int i;
+
+	for (i = 0; i < NI_LINK_SAMPLER_COUNTER_MAX; ++i)
+		rates[i] = msec ? (newer[1 + i] - older[1 + i]) * 1000 / msec : 0;
+}
+
+/*
+ * Return the rates of the n-th subscribed interface in units/sec.
+ */
+ni_bool_t
+ni_link_sampler_rates(unsigned int n, ni_link_sampler_rates_t *rates)
+{
+	ni_link_sampler_entry_t *entry;
+	const uint64_t *newest;
+
+	for (entry = ni_link_sampler.entries; entry && n; entry = entry->next)
+		n--;
+	if (!entry || !rates)
+		return FALSE;
+
+	memset(rates, 0, sizeof(*rates));
+	rates->ifindex = entry->ifindex;
+	rates->interval = ni_link_sampler.interval;
+	rates->samples = entry->count;
+	if (!entry->count)
+		return TRUE;
+
+	newest = ni_link_sampler_entry_row(entry, 0);
+	memcpy(rates->counters, newest + 1, sizeof(rates->counters));
+	if (entry->count < 2)
+		return TRUE;
+
+	ni_link_sampler_rate(rates->current, newest,
+			ni_link_sampler_entry_row(entry, 1));
+	ni_link_sampler_rate(rates->average, newest,
+			ni_link_sampler_entry_row(entry, entry->count - 1));
+	return TRUE;
+}
@@ -0,0 +1,65 @@
+/*
+ *	Periodic link statistics sampling of the wickedd daemon
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef   WICKED_LINK_SAMPLER_H
+#define   WICKED_LINK_SAMPLER_H
+
+#include <wicked/types.h>
+
+#define NI_LINK_SAMPLER_INTERVAL	1000	/* msec	*/
+#define NI_LINK_SAMPLER_INTERVAL_MIN	100	/* msec	*/
+#define NI_LINK_SAMPLER_HISTORY		60	/* samples	*/
+#define NI_LINK_SAMPLER_HISTORY_MAX	3600	/* samples	*/
+
+/*
+ * The sampled IFLA_STATS_LINK_64 counters
+ */
+enum {
+	NI_LINK_SAMPLER_RX_BYTES,
+	NI_LINK_SAMPLER_TX_BYTES,
+	NI_LINK_SAMPLER_RX_PACKETS,
+	NI_LINK_SAMPLER_TX_PACKETS,
+	NI_LINK_SAMPLER_RX_ERRORS,
+	NI_LINK_SAMPLER_TX_ERRORS,
+	NI_LINK_SAMPLER_RX_DROPPED,
+	NI_LINK_SAMPLER_TX_DROPPED,
+	NI_LINK_SAMPLER_MULTICAST,
+	NI_LINK_SAMPLER_COUNTER_MAX
+};
+
+/*
+ * Rates of an interface in units per second, over the last sample
+ * interval and as average over all samples in the history.
+ */
+typedef struct ni_link_sampler_rates {
+	unsigned int		ifindex;
+	unsigned int		interval;	/* msec		*/
+	unsigned int		samples;	/* in history	*/
+	uint64_t		counters[NI_LINK_SAMPLER_COUNTER_MAX];
+	uint64_t		current[NI_LINK_SAMPLER_COUNTER_MAX];
+	uint64_t		average[NI_LINK_SAMPLER_COUNTER_MAX];
+} ni_link_sampler_rates_t;
+
+extern const char *	ni_link_sampler_counter_name(unsigned int);
+
+extern int		ni_link_sampler_subscribe(unsigned int);
+extern int		ni_link_sampler_unsubscribe(unsigned int);
+extern unsigned int	ni_link_sampler_count(void);
+extern ni_bool_t	ni_link_sampler_rates(unsigned int, ni_link_sampler_rates_t *);
+
+#endif /* WICKED_LINK_SAMPLER_H */
@@ -32,11 +32,19 @@
 #include "netinfo_priv.h"
 #include "socket_priv.h"
 #include "lldp-priv.h"
+#include "appconfig.h"
 
 /*
  * Maximum number of LLDP peer entries we keep
  */
 #define NI_LLDP_MAX_PEERS	256
+#define NI_LLDP_PEER_HASH_SIZE	16
+
+/*
+ * PDUs of all agents due within this many msec of a tx scheduler
+ * tick are sent in the same tick
+ */
+#define NI_LLDP_TX_BATCH	100
 
 typedef struct ni_lldp_agent ni_lldp_agent_t;
 typedef struct ni_lldp_peer ni_lldp_peer_t;
@@ -45,7 +53,7 @@ struct ni_lldp_agent {
 	ni_lldp_agent_t *	next;
 	unsigned int		ifindex;
 
-	const ni_timer_t *	txTTR;
+	struct timeval		tx_due;
 	uint16_t		msgFastTx;
 	uint16_t		msgTxHold;
 	uint16_t		msgTxInterval;
@@ -62,7 +70,9 @@ struct ni_lldp_agent {
 	ni_lldp_t *		config;
 	ni_dcbx_state_t *	dcbx;
 
-	ni_lldp_peer_t *	peers;
+	ni_lldp_peer_t *	peers;		/* sorted by expiry	*/
+	ni_lldp_peer_t *	peer_hash[NI_LLDP_PEER_HASH_SIZE];
+	unsigned int		npeers;
 
 	ni_capture_t *		capture;
 	ni_buffer_t		sendbuf;
@@ -70,13 +80,23 @@ struct ni_lldp_agent {
 
 struct ni_lldp_peer {
 	ni_lldp_peer_t *	next;
+	ni_lldp_peer_t *	hnext;
 	struct timeval		expires;
 	ni_lldp_t *		data;
+
+	/* the last PDU received, to detect duplicates */
+	unsigned int		pdu_hash;
+	unsigned int		pdu_len;
+	unsigned char *		pdu;
+
+	unsigned int		raw_id_hash;
 	unsigned int		raw_id_len;
 	unsigned char		raw_id[0];
 };
 
 static ni_lldp_agent_t *	ni_lldp_agents;
+static const ni_timer_t *	ni_lldp_tx_timer;
+static ni_bool_t		ni_lldp_tx_running;
 
 static ni_hwaddr_t		ni_lldp_destaddr[__NI_LLDP_DEST_MAX] = {
 [NI_LLDP_DEST_NEAREST_BRIDGE] = {
@@ -104,9 +124,11 @@ static void		ni_lldp_agent_stop(ni_netdev_t *);
 static ni_bool_t	ni_lldp_agent_send(ni_lldp_agent_t *);
 static int		ni_lldp_agent_send_shutdown(ni_lldp_agent_t *);
 static void		ni_lldp_agent_free(ni_lldp_agent_t *);
-static int		ni_lldp_agent_update(ni_lldp_agent_t *, ni_lldp_t *, const void *, unsigned int);
+static int		ni_lldp_agent_update(ni_lldp_agent_t *, ni_lldp_t *, const void *, unsigned int,
+					const ni_buffer_t *);
 static void		ni_lldp_tx_timer_arm(ni_lldp_agent_t *);
 static void		ni_lldp_tx_timer_arm_quick(ni_lldp_agent_t *);
+static void		ni_lldp_tx_schedule(void);
 static void		ni_lldp_receive(ni_socket_t *);
 static ni_lldp_peer_t *	ni_lldp_peer_new(const void *raw_id, unsigned int raw_id_len);
 static void		ni_lldp_peer_unlink_and_free(ni_lldp_peer_t **);
@@ -201,6 +223,7 @@ ni_lldp_peer_new(const void *raw_id, unsigned int raw_id_len)
 	ni_lldp_peer_t *peer;
 
 	peer = xcalloc(1, sizeof(*peer) + raw_id_len);
+	peer->raw_id_hash = ni_string_hash_len(raw_id, raw_id_len);
 	peer->raw_id_len = raw_id_len;
 	memcpy(peer->raw_id, raw_id, raw_id_len);
 	return peer;
@@ -210,8 +233,34 @@ static void
 ni_lldp_peer_free(ni_lldp_peer_t *peer)
 {
 	ni_lldp_free(peer->data);
+	free(peer->pdu);
 	free(peer);
 }
+
+static void
+ni_lldp_peer_set_pdu(ni_lldp_peer_t *peer, const ni_buffer_t *pdu)
+{
+	unsigned int len = ni_buffer_count(pdu);
+
+	if (len != peer->pdu_len) {
+		free(peer->pdu);
+		peer->pdu = len ? xmalloc(len) : NULL;
+		peer->pdu_len = len;
+	}
+	if (len)
+		memcpy(peer->pdu, ni_buffer_head(pdu), len);
+	peer->pdu_hash = ni_string_hash_len(ni_buffer_head(pdu), len);
+}
+
+static ni_bool_t
+ni_lldp_peer_pdu_equal(const ni_lldp_peer_t *peer, const ni_buffer_t *pdu)
+{
+	unsigned int len = ni_buffer_count(pdu);
+
+	return peer->pdu && peer->pdu_len == len &&
+		peer->pdu_hash == ni_string_hash_len(ni_buffer_head(pdu), len) &&
+		!memcmp(peer->pdu, ni_buffer_head(pdu), len);
+}
 static void
 ni_lldp_peer_unlink_and_free(ni_lldp_peer_t **pos)
 {
@@ -323,6 +372,7 @@ ni_lldp_agent_new(ni_netdev_t *dev, unsigned int mtu)
 	ni_buffer_init(&agent->sendbuf, (void *) (agent + 1), mtu);
 
 	agent->dev = ni_netdev_get(dev);
+	agent->ifindex = dev->link.ifindex;
 
 	/* init tx state machine variables with recommended defaults */
 	agent->msgFastTx = 1;
@@ -345,8 +395,6 @@ ni_lldp_agent_free(ni_lldp_agent_t *agent)
 {
 	ni_capture_free(agent->capture);
 	ni_lldp_free(agent->config);
-	if (agent->txTTR)
-		ni_timer_cancel(agent->txTTR);
 	if (agent->dev)
 		ni_netdev_put(agent->dev);
 	if (agent->dcbx)
@@ -465,6 +513,7 @@ ni_lldp_agent_start(ni_netdev_t *dev, ni_lldp_t *lldp, ni_dcbx_state_t *dcbx)
 
 		memset(&protinfo, 0, sizeof(protinfo));
 		protinfo.eth_protocol = ETHERTYPE_LLDP;
+		protinfo.shared = ni_config_socket_shared_capture();
 
 		if (agent->config->destination >= __NI_LLDP_DEST_MAX)
 			return -1;
@@ -494,9 +543,20 @@ ni_lldp_agent_stop(ni_netdev_t *dev)
 		if (ni_netdev_device_is_up(dev))
 			ni_lldp_agent_send_shutdown(agent);
 		ni_lldp_agent_free(agent);
+		ni_lldp_tx_schedule();
 	}
 }
 
+/*
+ * The PDU is built once and resent from the send buffer until the
+ * local data it is built from changes.
+ */
+static inline void
+ni_lldp_agent_invalidate_pdu(ni_lldp_agent_t *agent)
+{
+	ni_buffer_reset(&agent->sendbuf);
+}
+
 static ni_bool_t
 ni_lldp_agent_send(ni_lldp_agent_t *agent)
 {
@@ -507,7 +567,7 @@ ni_lldp_agent_send(ni_lldp_agent_t *agent)
 	if (ni_buffer_count(&agent->sendbuf) == 0
 	 && ni_lldp_pdu_build(agent->config, agent->dcbx, &agent->sendbuf) < 0) {
 		ni_error("%s: error building LLDP PDU", agent->dev->name);
-		return -1;
+		return FALSE;
 	}
 
 	ni_timer_get_time(&now);
@@ -586,19 +646,71 @@ ni_lldp_agent_enter_fast_rx(ni_lldp_agent_t *agent)
 		ni_lldp_agent_send(agent);
 }
 
+/*
+ * One tx timer serves all agents: it expires at the earliest due time
+ * and sends the PDUs of all agents due within the NI_LLDP_TX_BATCH
+ * window, instead of waking up once per agent.
+ */
 static void
 ni_lldp_tx_timer_expires(void *user_data, const ni_timer_t *timer)
 {
-	ni_lldp_agent_t *agent = (ni_lldp_agent_t *) user_data;
+	ni_lldp_agent_t *agent;
+	struct timeval batch;
 
-	if (agent->txTTR != timer) {
+	if (ni_lldp_tx_timer != timer) {
 		ni_error("ni_lldp_tx_timer_expires: bad timer handle");
 		return;
 	}
-	agent->txTTR = NULL;
+	ni_lldp_tx_timer = NULL;
 
-	/* FIXME: rebuild the packet? */
-	ni_lldp_agent_send(agent);
+	ni_timer_get_time(&batch);
+	ni_timeval_add_timeout(&batch, NI_LLDP_TX_BATCH);
+
+	/* sending re-arms the agents, schedule once afterwards */
+	ni_lldp_tx_running = TRUE;
+	for (agent = ni_lldp_agents; agent; agent = agent->next) {
+		if (!timerisset(&agent->tx_due) || timercmp(&agent->tx_due, &batch, >))
+			continue;
+
+		timerclear(&agent->tx_due);
+		ni_lldp_agent_send(agent);
+	}
+	ni_lldp_tx_running = FALSE;
+
+	ni_lldp_tx_schedule();
+}
+
+static void
+ni_lldp_tx_schedule(void)
+{
+	const struct timeval *next = NULL;
+	ni_lldp_agent_t *agent;
+	ni_timeout_t timeout;
+
+	if (ni_lldp_tx_running)
+		return;
+
+	for (agent = ni_lldp_agents; agent; agent = agent->next) {
+		if (!timerisset(&agent->tx_due))
+			continue;
+		if (!next || timercmp(&agent->tx_due, next, <))
+			next = &agent->tx_due;
+	}
+
+	if (!next) {
+		if (ni_lldp_tx_timer)
+			ni_timer_cancel(ni_lldp_tx_timer);
+		ni_lldp_tx_timer = NULL;
+		return;
+	}
+
+	timeout = ni_timeout_left(next, NULL, NULL);
+	if (ni_lldp_tx_timer)
+		ni_lldp_tx_timer = ni_timer_rearm(ni_lldp_tx_timer, timeout);
+	if (!ni_lldp_tx_timer)
+		ni_lldp_tx_timer = ni_timer_register(timeout, ni_lldp_tx_timer_expires, NULL);
+	if (!ni_lldp_tx_timer)
+		ni_error("failed to arm LLDP tx timer");
 }
 
 static void
@@ -609,11 +721,9 @@ __ni_lldp_tx_timer_arm(ni_lldp_agent_t *agent, unsigned int timeout)
 	/* Apply a jitter between 0 and 0.4 sec */
 	timeout = ni_timeout_randomize(timeout, &jitter);
 
-	if (agent->txTTR)
-		ni_timer_cancel(agent->txTTR);
-	agent->txTTR = ni_timer_register(timeout, ni_lldp_tx_timer_expires, agent);
-	if (agent->txTTR == NULL)
-		ni_error("%s: failed to arm LLDP timer", agent->dev->name);
+	ni_timer_get_time(&agent->tx_due);
+	ni_timeval_add_timeout(&agent->tx_due, timeout);
+	ni_lldp_tx_schedule();
 }
 
 void
@@ -631,41 +741,124 @@ ni_lldp_tx_timer_arm_quick(ni_lldp_agent_t *agent)
 
 /*
  * LLDP rx agent
+ *
+ * The peers are kept in a list sorted by increasing expiry and
+ * in a hash table by their raw chassis and port id.
  */
-static int
-ni_lldp_agent_update(ni_lldp_agent_t *agent, ni_lldp_t *lldp, const void *raw_id, unsigned int raw_id_len)
+static ni_lldp_peer_t *
+ni_lldp_agent_find_peer(ni_lldp_agent_t *agent, const void *raw_id, unsigned int raw_id_len)
 {
-	ni_lldp_peer_t **pos, *peer, *found = NULL;
-	unsigned int npeers = 0;
-	struct timeval now;
+	unsigned int hash = ni_string_hash_len(raw_id, raw_id_len);
+	ni_lldp_peer_t *peer;
 
-	ni_timer_get_time(&now);
+	peer = agent->peer_hash[hash % NI_LLDP_PEER_HASH_SIZE];
+	for ( ; peer; peer = peer->hnext) {
+		if (peer->raw_id_hash == hash && peer->raw_id_len == raw_id_len
+		 && !memcmp(peer->raw_id, raw_id, raw_id_len))
+			return peer;
+	}
+	return NULL;
+}
+
+static void
+ni_lldp_agent_link_peer(ni_lldp_agent_t *agent, ni_lldp_peer_t *peer)
+{
+	ni_lldp_peer_t **pos, *cur;
 
 	pos = &agent->peers;
+	while ((cur = *pos) != NULL && timercmp(&cur->expires, &peer->expires, <))
+		pos = &cur->next;
+	peer->next = *pos;
+	*pos = peer;
 
-	/* First, expire any old entries. Note that peers are sorted by order
-	 * of increasing expiry timeout. */
-	while ((peer = *pos) != NULL && timercmp(&peer->expires, &now, <=))
-		ni_lldp_peer_unlink_and_free(pos);
+	pos = &agent->peer_hash[peer->raw_id_hash % NI_LLDP_PEER_HASH_SIZE];
+	peer->hnext = *pos;
+	*pos = peer;
 
-	while ((peer = *pos) != NULL) {
-		if (peer->raw_id_len == raw_id_len
-		 && !memcmp(peer->raw_id, raw_id, raw_id_len)) {
-			found = peer;
-			*pos = peer->next;
-			peer->next = NULL;
-		} else {
+	agent->npeers++;
+}
+
+static void
+ni_lldp_agent_unlink_peer(ni_lldp_agent_t *agent, ni_lldp_peer_t *peer)
+{
+	ni_lldp_peer_t **pos;
+
+	for (pos = &agent->peers; *pos; pos = &(*pos)->next) {
+		if (*pos == peer) {
 			*pos = peer->next;
-			npeers++;
+			break;
 		}
 	}
+	pos = &agent->peer_hash[peer->raw_id_hash % NI_LLDP_PEER_HASH_SIZE];
+	for ( ; *pos; pos = &(*pos)->hnext) {
+		if (*pos == peer) {
+			*pos = peer->hnext;
+			break;
+		}
+	}
+	peer->next = peer->hnext = NULL;
+	agent->npeers--;
+}
 
-	if (found != NULL) {
+static void
+ni_lldp_agent_expire_peers(ni_lldp_agent_t *agent, const struct timeval *now)
+{
+	ni_lldp_peer_t *peer;
+
+	while ((peer = agent->peers) != NULL && timercmp(&peer->expires, now, <=)) {
+		ni_lldp_agent_unlink_peer(agent, peer);
+		ni_lldp_peer_free(peer);
+	}
+}
+
+/*
+ * A PDU identical to the last one received from a peer only
+ * refreshes its expiry, without parsing it again.
+ */
+static ni_bool_t
+ni_lldp_agent_refresh_peer(ni_lldp_agent_t *agent, const ni_buffer_t *pdu,
+				const void *raw_id, unsigned int raw_id_len)
+{
+	ni_lldp_peer_t *peer;
+	struct timeval now;
+
+	ni_timer_get_time(&now);
+	ni_lldp_agent_expire_peers(agent, &now);
+
+	peer = ni_lldp_agent_find_peer(agent, raw_id, raw_id_len);
+	if (!peer || !peer->data || !ni_lldp_peer_pdu_equal(peer, pdu))
+		return FALSE;
+
+	ni_lldp_agent_unlink_peer(agent, peer);
+	peer->expires = now;
+	peer->expires.tv_sec += peer->data->ttl;
+	ni_lldp_agent_link_peer(agent, peer);
+	return TRUE;
+}
+
+/*
+ * Update the peer with the parsed PDU, taking ownership of lldp.
+ */
+static int
+ni_lldp_agent_update(ni_lldp_agent_t *agent, ni_lldp_t *lldp, const void *raw_id, unsigned int raw_id_len,
+			const ni_buffer_t *pdu)
+{
+	ni_lldp_peer_t *found;
+	struct timeval now;
+
+	ni_timer_get_time(&now);
+
+	/* First, expire any old entries. */
+	ni_lldp_agent_expire_peers(agent, &now);
+
+	if ((found = ni_lldp_agent_find_peer(agent, raw_id, raw_id_len)) != NULL) {
+		ni_lldp_agent_unlink_peer(agent, found);
 		ni_lldp_free(found->data);
 		found->data = NULL;
 	} else {
-		if (npeers >= NI_LLDP_MAX_PEERS) {
+		if (agent->npeers >= NI_LLDP_MAX_PEERS) {
 			ni_debug_lldp("%s: too many LLDP peers, ignoring this PDU", __func__);
+			ni_lldp_free(lldp);
 			return -1;
 		}
 		found = ni_lldp_peer_new(raw_id, raw_id_len);
@@ -677,6 +870,7 @@ ni_lldp_agent_update(ni_lldp_agent_t *agent, ni_lldp_t *lldp, const void *raw_id
 	if (lldp->ttl == 0) {
 		/* The peer agent wanted to say bye */
 		ni_lldp_peer_free(found);
+		ni_lldp_free(lldp);
 		return 0;
 	}
 
@@ -684,34 +878,34 @@ ni_lldp_agent_update(ni_lldp_agent_t *agent, ni_lldp_t *lldp, const void *raw_id
 	found->expires = now;
 	found->expires.tv_sec += lldp->ttl;
 	found->data = lldp;
+	ni_lldp_peer_set_pdu(found, pdu);
 
 	/* Insert in order of increasing timeout */
-	pos = &agent->peers;
-	while ((peer = *pos) != NULL && timercmp(&peer->expires, &found->expires, <))
-		*pos = peer->next;
-
-	found->next = *pos;
-	*pos = found;
-	npeers++;
+	ni_lldp_agent_link_peer(agent, found);
 
 	/* If there is exactly one peer on the link, and that peer
 	 * announces its DCB configuration via DCBX, we should invoke
 	 * the DCBX finite state machinery.
 	 */
 	if (agent->dcbx) {
-		if (lldp->dcb_attributes != NULL && npeers == 1) {
-			agent->dcbx->running = TRUE;
+		if (lldp->dcb_attributes != NULL && agent->npeers == 1) {
+			/* The DCBX TLVs are sent while running only */
+			if (!agent->dcbx->running) {
+				agent->dcbx->running = TRUE;
+				ni_lldp_agent_invalidate_pdu(agent);
+			}
 
 			/* Pass the received DCBX attributes to the DCB driver.
 			 * If the function returns TRUE, the configuration changed
 			 * and we're supposed to rebuild the PDU on the next transmit
 			 */
 			if (ni_dcbx_update_remote(agent->dcbx, lldp->dcb_attributes))
-				ni_buffer_reset(&agent->sendbuf);
+				ni_lldp_agent_invalidate_pdu(agent);
 		} else if (agent->dcbx->running) {
 			ni_debug_lldp("%s: more than one LLDP agent on the link, disabling DCBX",
 					agent->dev->name);
 			agent->dcbx->running = FALSE;
+			ni_lldp_agent_invalidate_pdu(agent);
 		}
 	}
 
@@ -735,6 +929,7 @@ ni_lldp_receive(ni_socket_t *sock)
 		ni_buffer_t raw_id_buf;
 		const void *raw_id;
 		unsigned int raw_id_len;
+		ni_buffer_t pdu = buf;
 		ni_lldp_t *lldp;
 
 		/* Get the chassis and port ID TLVs as a raw string
@@ -743,6 +938,9 @@ ni_lldp_receive(ni_socket_t *sock)
 		if (ni_lldp_pdu_get_raw_id(&raw_id_buf, &raw_id, &raw_id_len) < 0)
 			return;
 
+		if (ni_lldp_agent_refresh_peer(agent, &pdu, raw_id, raw_id_len))
+			return;
+
 		lldp = ni_lldp_new();
 		if (ni_lldp_pdu_parse(lldp, &buf) < 0) {
 			ni_debug_lldp("%s: failed to parse LLDP PDU", agent->dev->name);
@@ -750,7 +948,7 @@ ni_lldp_receive(ni_socket_t *sock)
 			return;
 		}
 
-		ni_lldp_agent_update(agent, lldp, raw_id, raw_id_len);
+		ni_lldp_agent_update(agent, lldp, raw_id, raw_id_len, &pdu);
 	}
 
 }
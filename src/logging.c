@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <syslog.h>
 #include <unistd.h>
 #include <sys/time.h>
@@ -18,11 +19,14 @@
 
 #include <wicked/logging.h>
 #include <wicked/util.h>
+#include <wicked/time.h>
 #include "util_priv.h"
+#include "stats.h"
 
 #define NI_LOG_PID	(1 << 0)
 #define NI_LOG_TIME	(1 << 1)
 #define NI_LOG_IDENT	(1 << 2)
+#define NI_LOG_ASYNC	(1 << 16)	/* above the syslog LOG_* options */
 #define NI_TRACE_NONE	0U
 #define NI_TRACE_MINI	(NI_TRACE_IFCONFIG | NI_TRACE_READWRITE)
 #define NI_TRACE_MOST	~(NI_TRACE_XPATH | NI_TRACE_WICKED_XML | NI_TRACE_DBUS)
@@ -35,6 +39,49 @@ static unsigned int	ni_log_syslog;
 static const char *	ni_log_ident;
 static unsigned int	ni_log_opts;
 
+/*
+ * The async log sink formats the messages into a ring buffer and
+ * writes them from the main loop (ni_log_flush) before it waits
+ * for socket events, so the event processing is not blocked by the
+ * stderr or syslog writes. When the ring is full, messages below
+ * warning level are dropped and counted, more important ones flush
+ * the ring first.
+ */
+#define NI_LOG_RING_SIZE	1024
+#define NI_LOG_RING_MSGLEN	1024
+
+typedef struct ni_log_record {
+	struct timeval		time;
+	int			prio;
+	const char *		tag;
+	const char *		end;
+	char			msg[NI_LOG_RING_MSGLEN];
+} ni_log_record_t;
+
+static struct ni_log_ring {
+	ni_log_record_t *	records;
+	unsigned int		head;
+	unsigned int		count;
+	unsigned int		dropped;
+	ni_bool_t		flushing;
+} ni_log_ring;
+
+/*
+ * Per debug facility rate limit of at most burst messages per interval;
+ * a burst of 0 disables it.
+ */
+#define NI_LOG_RATELIMIT_FACILITIES	33
+
+typedef struct ni_log_ratelimit {
+	struct timeval		start;
+	unsigned int		count;
+	unsigned int		suppressed;
+} ni_log_ratelimit_t;
+
+unsigned int		ni_log_ratelimit_burst = 0;
+static ni_timeout_t	ni_log_ratelimit_interval = 1000;
+static ni_log_ratelimit_t ni_log_ratelimits[NI_LOG_RATELIMIT_FACILITIES];
+
 static void		__ni_log_level_set(unsigned int level);
 
 /*
@@ -251,6 +298,77 @@ ni_log_init(void)
 	if ((var = getenv("WICKED_LOG_LEVEL"))) {
 		ni_log_level_set(var);
 	}
+
+	if ((var = getenv("WICKED_LOG_RATELIMIT"))) {
+		ni_log_ratelimit_set(var);
+	}
+}
+
+/*
+ * Set the debug message rate limit as "<burst>[/<interval msec>]"
+ */
+ni_bool_t
+ni_log_ratelimit_set(const char *limit)
+{
+	unsigned int burst, interval = 1000;
+	char *copy, *sep;
+	ni_bool_t ret = FALSE;
+
+	if (ni_string_empty(limit))
+		return FALSE;
+
+	copy = xstrdup(limit);
+	if ((sep = strchr(copy, '/')))
+		*sep++ = '\0';
+
+	if (ni_parse_uint(copy, &burst, 10) == 0 &&
+	    (!sep || (ni_parse_uint(sep, &interval, 10) == 0 && interval))) {
+		ni_log_ratelimit_burst = burst;
+		ni_log_ratelimit_interval = interval;
+		memset(ni_log_ratelimits, 0, sizeof(ni_log_ratelimits));
+		ret = TRUE;
+	}
+	free(copy);
+	return ret;
+}
+
+/*
+ * Returns whether a debug message of the facility is within the rate
+ * limit; the number of suppressed messages is reported once the
+ * interval is over.
+ */
+ni_bool_t
+__ni_log_ratelimit(unsigned int facility)
+{
+	ni_log_ratelimit_t *rl;
+	unsigned int suppressed;
+	struct timeval now;
+
+	if (!facility)
+		return TRUE;
+
+	rl = &ni_log_ratelimits[ffs(facility)];
+	ni_timer_get_time(&now);
+	if (!timerisset(&rl->start) ||
+	    ni_timeout_since(&rl->start, &now, NULL) >= ni_log_ratelimit_interval) {
+		suppressed = rl->suppressed;
+		rl->start = now;
+		rl->count = 0;
+		rl->suppressed = 0;
+
+		if (suppressed) {
+			ni_trace("%u %s debug messages suppressed by rate limit",
+					suppressed, ni_debug_facility_to_name(1U << (ffs(facility) - 1)));
+		}
+	}
+
+	if (rl->count >= ni_log_ratelimit_burst) {
+		rl->suppressed++;
+		ni_stats_inc(NI_STATS_LOG_SUPPRESSED);
+		return FALSE;
+	}
+	rl->count++;
+	return TRUE;
 }
 
 unsigned int
@@ -306,6 +424,7 @@ ni_log_level_set(const char *name)
 void
 ni_log_close(void)
 {
+	ni_log_flush();
 	if (ni_log_syslog) {
 		closelog();
 	}
@@ -319,7 +438,7 @@ ni_log_reopen(void)
 {
 	if (ni_log_syslog) {
 		closelog();
-		openlog(ni_log_ident, ni_log_opts, ni_log_syslog);
+		openlog(ni_log_ident, ni_log_opts & ~NI_LOG_ASYNC, ni_log_syslog);
 	}
 }
 
@@ -369,6 +488,7 @@ __ni_stderr_parse_args(const char *args, unsigned int *options)
 		{ "pid",	NI_LOG_PID	},
 		{ "time",	NI_LOG_TIME	},
 		{ "ident",	NI_LOG_IDENT	},
+		{ "async",	NI_LOG_ASYNC	},
 		{ NULL,		0		}
 	};
 	return __ni_parse_flag_options(option_map, args, options);
@@ -381,6 +501,7 @@ __ni_syslog_parse_args(const char *args, unsigned int *options, unsigned int *fa
 		{ "perror",	LOG_PERROR	},
 		{ "stderr",	LOG_PERROR	},
 		{ "pid",	LOG_PID		},
+		{ "async",	NI_LOG_ASYNC	},
 		{ NULL,		0		}
 	};
 	unsigned int _options  = LOG_NDELAY | LOG_PID;
@@ -420,7 +541,7 @@ ni_log_destination_syslog(const char *progname, const char *args)
 		return FALSE;
 
 	ni_log_ident = progname;
-	openlog(ni_log_ident, ni_log_opts, ni_log_syslog);
+	openlog(ni_log_ident, ni_log_opts & ~NI_LOG_ASYNC, ni_log_syslog);
 	return TRUE;
 }
 
@@ -469,45 +590,164 @@ ni_log_destination(const char *progname, const char *destination)
 	return FALSE;
 }
 
-static inline void
-__ni_log_stderr(const char *tag, const char *fmt, va_list ap, const char *end)
+static const char *
+__ni_log_stderr_prefix(char *buf, size_t size, const struct timeval *tv)
 {
+	size_t len = 0;
+
+	buf[0] = '\0';
+
 	/* rfc5424 / rfc3339 timestamp with ms precision, e.g.:
 	 * 	2013-11-07T19:29:38.663870+01:00
 	 */
 	if (ni_log_opts & NI_LOG_TIME) {
-		struct timeval tv;
 		struct tm lt;
 		char tzsign;
 
-		gettimeofday(&tv, NULL);
-		localtime_r(&tv.tv_sec, &lt);
+		localtime_r(&tv->tv_sec, &lt);
 		if (lt.tm_gmtoff < 0) {
 			lt.tm_gmtoff *= -1;
 			tzsign = '-';
 		} else {
 			tzsign = '+';
 		}
-		fprintf(stderr, "%04d-%02d-%02dT%02d:%02d:%02d.%06ld%c%02ld:%02ld ",
+		len = snprintf(buf, size, "%04d-%02d-%02dT%02d:%02d:%02d.%06ld%c%02ld:%02ld ",
 				lt.tm_year + 1900, lt.tm_mon + 1, lt.tm_mday,
-				lt.tm_hour, lt.tm_min, lt.tm_sec, tv.tv_usec,
+				lt.tm_hour, lt.tm_min, lt.tm_sec, tv->tv_usec,
 				tzsign, lt.tm_gmtoff/3600, (lt.tm_gmtoff%3600)/60);
+		if (len >= size)
+			return buf;
 	}
 
 	if (ni_log_opts & NI_LOG_PID) {
 		if (ni_log_opts & NI_LOG_IDENT)
-			fprintf(stderr, "%s[%d]: ", ni_log_ident, getpid());
+			snprintf(buf + len, size - len, "%s[%d]: ", ni_log_ident, getpid());
 		else
-			fprintf(stderr, "[%d]: ", getpid());
+			snprintf(buf + len, size - len, "[%d]: ", getpid());
 	} else if (ni_log_opts & NI_LOG_IDENT) {
-		fprintf(stderr, "%s: ", ni_log_ident);
+		snprintf(buf + len, size - len, "%s: ", ni_log_ident);
 	}
+	return buf;
+}
+
+static inline void
+__ni_log_stderr(const char *tag, const char *fmt, va_list ap, const char *end)
+{
+	struct timeval tv = { 0, 0 };
+	char prefix[128];
+
+	if (ni_log_opts & NI_LOG_TIME)
+		gettimeofday(&tv, NULL);
 
-	fprintf(stderr, "%s", tag);
+	fprintf(stderr, "%s%s", __ni_log_stderr_prefix(prefix, sizeof(prefix), &tv), tag);
 	vfprintf(stderr, fmt, ap);
 	fprintf(stderr, "%s\n", end);
 }
 
+static void
+__ni_log_direct(int prio, const char *tag, const char *fmt, va_list ap, const char *end)
+{
+	if (!ni_log_syslog) {
+		__ni_log_stderr(tag, fmt, ap, end);
+	} else {
+		vsyslog(prio, fmt, ap);
+	}
+}
+
+static void
+__ni_log_direct_printf(int prio, const char *tag, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	__ni_log_direct(prio, tag, fmt, ap, "");
+	va_end(ap);
+}
+
+static void
+__ni_log_record_write(const ni_log_record_t *rec)
+{
+	char prefix[128];
+
+	if (!ni_log_syslog) {
+		/* one write per message, stderr is unbuffered */
+		char line[sizeof(prefix) + NI_LOG_RING_MSGLEN + 64];
+
+		snprintf(line, sizeof(line), "%s%s%s%s\n",
+				__ni_log_stderr_prefix(prefix, sizeof(prefix), &rec->time),
+				rec->tag, rec->msg, rec->end);
+		fputs(line, stderr);
+	} else {
+		syslog(rec->prio, "%s", rec->msg);
+	}
+}
+
+/*
+ * Write the messages queued in the async log ring
+ */
+void
+ni_log_flush(void)
+{
+	struct ni_log_ring *ring = &ni_log_ring;
+	unsigned int dropped;
+
+	if (ring->flushing || (!ring->count && !ring->dropped))
+		return;
+
+	ring->flushing = TRUE;
+	while (ring->count) {
+		__ni_log_record_write(&ring->records[ring->head]);
+		ring->head = (ring->head + 1) % NI_LOG_RING_SIZE;
+		ring->count--;
+	}
+
+	if ((dropped = ring->dropped)) {
+		ring->dropped = 0;
+		__ni_log_direct_printf(LOG_WARNING, "Warning: ",
+				"%u log messages dropped, log ring buffer full", dropped);
+	}
+	ring->flushing = FALSE;
+}
+
+static void
+__ni_log_ring_add(int prio, const char *tag, const char *fmt, va_list ap, const char *end)
+{
+	struct ni_log_ring *ring = &ni_log_ring;
+	ni_log_record_t *rec;
+
+	if (!ring->records) {
+		ring->records = xcalloc(NI_LOG_RING_SIZE, sizeof(ring->records[0]));
+		atexit(ni_log_flush);
+	}
+
+	if (ring->count == NI_LOG_RING_SIZE) {
+		if (prio > LOG_WARNING || ring->flushing) {
+			ring->dropped++;
+			ni_stats_inc(NI_STATS_LOG_DROPPED);
+			return;
+		}
+		ni_log_flush();
+	}
+
+	rec = &ring->records[(ring->head + ring->count) % NI_LOG_RING_SIZE];
+	if (ni_log_opts & NI_LOG_TIME)
+		gettimeofday(&rec->time, NULL);
+	rec->prio = prio;
+	rec->tag  = tag;
+	rec->end  = end;
+	vsnprintf(rec->msg, sizeof(rec->msg), fmt, ap);
+	ring->count++;
+}
+
+static void
+__ni_log_vmsg(int prio, const char *tag, const char *fmt, va_list ap, const char *end)
+{
+	if (ni_log_opts & NI_LOG_ASYNC)
+		__ni_log_ring_add(prio, tag, fmt, ap, end);
+	else
+		__ni_log_direct(prio, tag, fmt, ap, end);
+}
+
 void
 ni_info(const char *fmt, ...)
 {
@@ -517,11 +757,7 @@ ni_info(const char *fmt, ...)
 		return;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("Info: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_INFO, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_INFO, "Info: ", fmt, ap, "");
 	va_end(ap);
 }
 
@@ -534,11 +770,7 @@ ni_note(const char *fmt, ...)
 		return;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("Notice: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_NOTICE, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_NOTICE, "Notice: ", fmt, ap, "");
 	va_end(ap);
 }
 
@@ -551,11 +783,7 @@ ni_warn(const char *fmt, ...)
 		return;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("Warning: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_WARNING, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_WARNING, "Warning: ", fmt, ap, "");
 	va_end(ap);
 }
 
@@ -565,11 +793,7 @@ ni_error(const char *fmt, ...)
 	va_list ap;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("Error: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_ERR, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_ERR, "Error: ", fmt, ap, "");
 	va_end(ap);
 }
 
@@ -583,11 +807,7 @@ ni_error_extra(const char *fmt, ...)
 	va_list ap;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("       ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_ERR, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_ERR, "       ", fmt, ap, "");
 	va_end(ap);
 }
 
@@ -600,11 +820,7 @@ ni_trace(const char *fmt, ...)
 		return;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("::: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_DEBUG, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_DEBUG, "::: ", fmt, ap, "");
 	va_end(ap);
 }
 
@@ -613,14 +829,11 @@ ni_fatal(const char *fmt, ...)
 {
 	va_list ap;
 
+	ni_log_flush();
+
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("FATAL ERROR: *** ", fmt, ap, " ***");
-	} else {
-		vsyslog(LOG_CRIT, fmt, ap);
-	}
+	__ni_log_direct(LOG_CRIT, "FATAL ERROR: *** ", fmt, ap, " ***");
 	va_end(ap);
 
 	exit(1);
 }
-
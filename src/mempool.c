@@ -0,0 +1,150 @@
+/*
+ *	mempool -- fixed size object pool allocator
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wicked/types.h>
+#include <wicked/logging.h>
+#include "mempool.h"
+
+/*
+ * Each object slot is preceded by a pointer to its chunk; free slots
+ * are linked via their object storage in the free list of the chunk.
+ */
+#define NI_MEMPOOL_ALIGN		16
+
+typedef union ni_mempool_slot {
+	ni_mempool_chunk_t *		chunk;
+	char				align[NI_MEMPOOL_ALIGN];
+} ni_mempool_slot_t;
+
+struct ni_mempool_chunk {
+	ni_mempool_chunk_t *		next;		/* in avail list */
+	ni_mempool_chunk_t **		pprev;
+	unsigned int			used;
+	void *				free;
+};
+
+static inline size_t
+ni_mempool_align(size_t size)
+{
+	return (size + NI_MEMPOOL_ALIGN - 1) & ~((size_t)NI_MEMPOOL_ALIGN - 1);
+}
+
+static inline size_t
+ni_mempool_stride(const ni_mempool_t *pool)
+{
+	size_t size = pool->size < sizeof(void *) ? sizeof(void *) : pool->size;
+
+	return ni_mempool_align(sizeof(ni_mempool_slot_t) + size);
+}
+
+static inline void
+ni_mempool_avail_link(ni_mempool_t *pool, ni_mempool_chunk_t *chunk)
+{
+	if ((chunk->next = pool->avail))
+		chunk->next->pprev = &chunk->next;
+	chunk->pprev = &pool->avail;
+	pool->avail = chunk;
+}
+
+static inline void
+ni_mempool_avail_unlink(ni_mempool_chunk_t *chunk)
+{
+	if (chunk->pprev) {
+		if ((*chunk->pprev = chunk->next))
+			chunk->next->pprev = chunk->pprev;
+		chunk->next = NULL;
+		chunk->pprev = NULL;
+	}
+}
+
+static ni_mempool_chunk_t *
+ni_mempool_chunk_new(ni_mempool_t *pool)
+{
+	size_t head = ni_mempool_align(sizeof(ni_mempool_chunk_t));
+	size_t stride = ni_mempool_stride(pool);
+	ni_mempool_chunk_t *chunk;
+	ni_mempool_slot_t *slot;
+	unsigned int i;
+	char *obj;
+
+	if (!(chunk = calloc(1, head + stride * pool->count)))
+		return NULL;
+
+	for (i = pool->count; i-- > 0; ) {
+		slot = (ni_mempool_slot_t *)((char *)chunk + head + stride * i);
+		slot->chunk = chunk;
+		obj = (char *)(slot + 1);
+		*(void **)obj = chunk->free;
+		chunk->free = obj;
+	}
+	ni_mempool_avail_link(pool, chunk);
+	return chunk;
+}
+
+void *
+ni_mempool_alloc(ni_mempool_t *pool)
+{
+	ni_mempool_chunk_t *chunk;
+	void *obj;
+
+	if (!pool || !pool->size || !pool->count)
+		return NULL;
+
+	if (!(chunk = pool->avail) && !(chunk = ni_mempool_chunk_new(pool)))
+		return NULL;
+
+	obj = chunk->free;
+	chunk->free = *(void **)obj;
+	chunk->used++;
+	if (!chunk->free)
+		ni_mempool_avail_unlink(chunk);
+
+	memset(obj, 0, pool->size);
+	return obj;
+}
+
+void
+ni_mempool_free(ni_mempool_t *pool, void *obj)
+{
+	ni_mempool_chunk_t *chunk;
+	ni_mempool_slot_t *slot;
+
+	if (!pool || !obj)
+		return;
+
+	slot = (ni_mempool_slot_t *)obj - 1;
+	chunk = slot->chunk;
+	ni_assert(chunk && chunk->used);
+
+	*(void **)obj = chunk->free;
+	if (!chunk->free)
+		ni_mempool_avail_link(pool, chunk);
+	chunk->free = obj;
+
+	if (--chunk->used == 0) {
+		ni_mempool_avail_unlink(chunk);
+		free(chunk);
+	}
+}
@@ -0,0 +1,42 @@
+/*
+ *	mempool -- fixed size object pool allocator
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef   WICKED_MEMPOOL_H
+#define   WICKED_MEMPOOL_H
+
+#include <stddef.h>
+
+/*
+ * Allocates objects of the same size from chunks of count objects,
+ * without the per-object malloc overhead and heap fragmentation of
+ * many small, long-living objects (e.g. routes). A chunk is released
+ * as soon as all its objects are freed again.
+ */
+typedef struct ni_mempool_chunk	ni_mempool_chunk_t;
+typedef struct ni_mempool {
+	size_t			size;
+	unsigned int		count;
+	ni_mempool_chunk_t *	avail;	/* chunks with free objects */
+} ni_mempool_t;
+
+#define NI_MEMPOOL_INIT(type, n)	{ .size = sizeof(type), .count = (n), .avail = NULL }
+
+extern void *			ni_mempool_alloc(ni_mempool_t *);
+extern void			ni_mempool_free(ni_mempool_t *, void *);
+
+#endif /* WICKED_MEMPOOL_H */
@@ -26,6 +26,7 @@
 #define NI_MM_SIGNAL_SIGNAL_QUALITY	"SignalQuality"
 #define NI_MM_SIGNAL_REGISTRATION_INFO	"RegistrationInfo"
 #define NI_MM_SIGNAL_NETWORK_MODE	"NetworkMode"
+#define NI_MM_SIGNAL_PROPERTIES_CHANGED	"PropertiesChanged"
 
 #define NI_MM_BUS_NAME		"org.freedesktop.ModemManager"
 #define NI_MM_OBJECT_PATH	"/org/freedesktop/ModemManager"
@@ -98,6 +99,12 @@ ni_modem_manager_client_open(void)
 				ni_modem_manager_signal,
 				modem_manager);
 
+	ni_dbus_client_add_signal_handler(dbc,
+				NI_MM_BUS_NAME,		/* sender */
+				NULL,			/* object path */
+				NI_DBUS_INTERFACE ".Properties",
+				ni_modem_manager_signal,
+				modem_manager);
 
 	return modem_manager;
 }
@@ -199,6 +206,19 @@ __ni_modem_manager_object(const ni_modem_t *modem)
 /*
  * Get modem information - manufacturer, model, version
  */
+static void
+ni_modem_manager_set_info(ni_modem_t *modem, const ni_dbus_variant_t *result)
+{
+	const char *string;
+
+	if (ni_dbus_struct_get_string(result, 0, &string))
+		ni_string_dup(&modem->identify.manufacturer, string);
+	if (ni_dbus_struct_get_string(result, 1, &string))
+		ni_string_dup(&modem->identify.model, string);
+	if (ni_dbus_struct_get_string(result, 2, &string))
+		ni_string_dup(&modem->identify.version, string);
+}
+
 int
 ni_modem_manager_get_info(ni_modem_t *modem, ni_dbus_object_t *modem_object)
 {
@@ -211,14 +231,7 @@ ni_modem_manager_get_info(ni_modem_t *modem, ni_dbus_object_t *modem_object)
 				0, NULL, 1, &result, &error)) {
 		rv = ni_dbus_get_error(&error, NULL);
 	} else {
-		const char *string;
-
-		if (ni_dbus_struct_get_string(&result, 0, &string))
-			ni_string_dup(&modem->identify.manufacturer, string);
-		if (ni_dbus_struct_get_string(&result, 1, &string))
-			ni_string_dup(&modem->identify.model, string);
-		if (ni_dbus_struct_get_string(&result, 2, &string))
-			ni_string_dup(&modem->identify.version, string);
+		ni_modem_manager_set_info(modem, &result);
 	}
 
 	ni_dbus_variant_destroy(&result);
@@ -364,43 +377,48 @@ ni_objectmodel_mm_modem_get_class(ni_modem_type_t type)
 	return ni_objectmodel_get_class(classname);
 }
 
-static void
-ni_modem_manager_add_modem(ni_modem_manager_client_t *modem_manager, const char *object_path)
+/*
+ * The modems are added using asynchronous Properties.GetAll and GetInfo
+ * calls, so the calls for all modems of the EnumerateDevices reply are
+ * sent at once instead to wait for the replies of each modem in turn.
+ * The calls use a temporary proxy, as the modem may be removed before
+ * the replies arrive. Once added, the PropertiesChanged and the other
+ * signals keep the modem properties current without further refreshes.
+ */
+static inline ni_bool_t
+ni_modem_manager_modem_added(const ni_modem_t *modem)
 {
-	DBusError error = DBUS_ERROR_INIT;
-	ni_dbus_object_t *modem_object;
-	const ni_dbus_class_t *class;
-	ni_modem_t *modem;
-
-	ni_debug_dbus("%s(%s)", __func__, object_path);
+	return modem->list.prev != NULL;
+}
 
-	modem = ni_modem_new();
-	ni_string_dup(&modem->real_path, object_path);
+static ni_dbus_object_t *
+ni_modem_manager_fetch_object(ni_modem_manager_client_t *modem_manager,
+				ni_dbus_object_t *proxy, ni_modem_t **modem)
+{
+	ni_dbus_object_t *modem_object;
 
-	/* Create the DBus client object for this modem. */
-	modem_object = ni_dbus_object_create(modem_manager->proxy, object_path, ni_objectmodel_mm_modem_class_ptr, modem);
-	if (modem_object == NULL) {
-		ni_modem_release(modem);
-		return;
+	modem_object = ni_dbus_object_lookup(modem_manager->proxy, proxy->path);
+	if (!modem_object || !(*modem = ni_objectmodel_unwrap_modem(modem_object, NULL))) {
+		ni_debug_dbus("%s: modem removed while fetching its properties", proxy->path);
+		return NULL;
 	}
-	ni_dbus_object_set_default_interface(modem_object, NI_MM_MODEM_IF);
+	if (ni_modem_manager_modem_added(*modem))
+		return NULL;
 
-	/* Use Properties.GetAll() to refresh the properties of this modem */
-	if (!ni_dbus_object_refresh_properties(modem_object, &ni_objectmodel_mm_modem_service, &error)) {
-		ni_dbus_print_error(&error, "cannot update properties of %s", object_path);
-		dbus_error_free(&error);
-		return;
-	}
+	return modem_object;
+}
 
-	if (ni_modem_manager_get_info(modem, modem_object) < 0)
-		ni_error("Cannot obtain model info for modem (%s)", object_path);
+static void
+ni_modem_manager_add_modem_done(ni_modem_t *modem, ni_dbus_object_t *modem_object)
+{
+	const ni_dbus_class_t *class;
 
 	/* Override the dbus class of this object */
 	if ((class = ni_objectmodel_mm_modem_get_class(modem->type)) != NULL)
 		modem_object->class = class;
 
 	ni_debug_dbus("%s: dev=%s master=%s type=%u equipment-id=%s",
-			object_path, modem->device, modem->master_device, modem->type,
+			modem_object->path, modem->device, modem->master_device, modem->type,
 			modem->identify.equipment);
 	ni_objectmodel_bind_compatible_interfaces(modem_object);
 
@@ -417,6 +435,103 @@ ni_modem_manager_add_modem(ni_modem_manager_client_t *modem_manager, const char
 	}
 }
 
+static void
+ni_modem_manager_add_modem_info(ni_dbus_object_t *proxy, ni_dbus_message_t *reply)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_dbus_object_t *modem_object;
+	ni_modem_t *modem = NULL;
+
+	if (ni_modem_manager_client &&
+	    (modem_object = ni_modem_manager_fetch_object(ni_modem_manager_client,
+							proxy, &modem))) {
+		if (dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN &&
+		    ni_dbus_message_get_args_variants(reply, &result, 1) == 1)
+			ni_modem_manager_set_info(modem, &result);
+		else
+			ni_error("Cannot obtain model info for modem (%s)", proxy->path);
+		ni_dbus_variant_destroy(&result);
+
+		ni_modem_manager_add_modem_done(modem, modem_object);
+	}
+	ni_dbus_object_free(proxy);
+}
+
+static void
+ni_modem_manager_add_modem_properties(ni_dbus_object_t *proxy, ni_dbus_message_t *reply)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_object_t *modem_object;
+	ni_modem_t *modem = NULL;
+
+	if (!ni_modem_manager_client ||
+	    !(modem_object = ni_modem_manager_fetch_object(ni_modem_manager_client,
+							proxy, &modem))) {
+		ni_dbus_object_free(proxy);
+		return;
+	}
+
+	if (!ni_dbus_object_refresh_properties_reply(modem_object,
+				&ni_objectmodel_mm_modem_service, reply, &error)) {
+		ni_dbus_print_error(&error, "cannot update properties of %s", proxy->path);
+		dbus_error_free(&error);
+		ni_dbus_object_free(modem_object);
+		ni_dbus_object_free(proxy);
+		return;
+	}
+
+	if (ni_dbus_object_call_variant_async(proxy, NI_MM_MODEM_IF, "GetInfo",
+				0, NULL, ni_modem_manager_add_modem_info, NULL) < 0) {
+		ni_error("Cannot obtain model info for modem (%s)", proxy->path);
+		ni_modem_manager_add_modem_done(modem, modem_object);
+		ni_dbus_object_free(proxy);
+	}
+}
+
+static void
+ni_modem_manager_add_modem(ni_modem_manager_client_t *modem_manager, const char *object_path)
+{
+	ni_dbus_variant_t arg = NI_DBUS_VARIANT_INIT;
+	ni_dbus_object_t *modem_object, *proxy;
+	ni_modem_t *modem;
+	int rv;
+
+	ni_debug_dbus("%s(%s)", __func__, object_path);
+
+	if (ni_dbus_object_lookup(modem_manager->proxy, object_path)) {
+		ni_debug_dbus("%s: modem object already known", object_path);
+		return;
+	}
+
+	modem = ni_modem_new();
+	ni_string_dup(&modem->real_path, object_path);
+
+	/* Create the DBus client object for this modem. */
+	modem_object = ni_dbus_object_create(modem_manager->proxy, object_path, ni_objectmodel_mm_modem_class_ptr, modem);
+	if (modem_object == NULL) {
+		ni_modem_release(modem);
+		return;
+	}
+	ni_dbus_object_set_default_interface(modem_object, NI_MM_MODEM_IF);
+
+	/* Use Properties.GetAll() to fetch the properties of this modem */
+	if (!(proxy = ni_dbus_client_object_new(modem_manager->dbus, &ni_dbus_anonymous_class,
+				object_path, NI_DBUS_INTERFACE ".Properties", NULL))) {
+		ni_dbus_object_free(modem_object);
+		return;
+	}
+
+	ni_dbus_variant_set_string(&arg, NI_MM_MODEM_IF);
+	rv = ni_dbus_object_call_variant_async(proxy, NI_DBUS_INTERFACE ".Properties",
+			"GetAll", 1, &arg, ni_modem_manager_add_modem_properties, NULL);
+	ni_dbus_variant_destroy(&arg);
+	if (rv < 0) {
+		ni_error("cannot update properties of %s: %s", object_path, ni_strerror(rv));
+		ni_dbus_object_free(proxy);
+		ni_dbus_object_free(modem_object);
+	}
+}
+
 static void
 ni_modem_manager_remove_modem(ni_modem_manager_client_t *modem_manager, const char *object_path)
 {
@@ -431,7 +546,8 @@ ni_modem_manager_remove_modem(ni_modem_manager_client_t *modem_manager, const ch
 		return;
 	}
 
-	if ((modem = ni_objectmodel_unwrap_modem(modem_object, NULL)) != NULL) {
+	if ((modem = ni_objectmodel_unwrap_modem(modem_object, NULL)) != NULL &&
+	    ni_modem_manager_modem_added(modem)) {
 		if (ni_modem_manager_event_handler)
 			ni_modem_manager_event_handler(modem, NI_EVENT_DEVICE_DELETE);
 		ni_modem_unlink(modem);
@@ -670,6 +786,73 @@ ni_modem_manager_client_dbus(ni_modem_manager_client_t *modem_manager)
 	return modem_manager->dbus;
 }
 
+static void
+ni_modem_manager_state_change(ni_modem_t *modem, uint32_t new_state)
+{
+	if (ni_modem_manager_event_handler) {
+		if (modem->state < MM_MODEM_STATE_REGISTERED && new_state >= MM_MODEM_STATE_REGISTERED)
+			ni_modem_manager_event_handler(modem, NI_EVENT_LINK_ASSOCIATED);
+		else
+		if (modem->state >= MM_MODEM_STATE_REGISTERED && new_state < MM_MODEM_STATE_REGISTERED)
+			ni_modem_manager_event_handler(modem, NI_EVENT_LINK_ASSOCIATION_LOST);
+		memset(&modem->event_uuid, 0, sizeof(modem->event_uuid));
+	}
+
+	modem->state = new_state;
+}
+
+/*
+ * Apply the changed properties to the modem; fall back to refresh
+ * the modem interface properties when the delta cannot be applied.
+ */
+static void
+ni_modem_manager_properties_changed(ni_modem_manager_client_t *modem_manager,
+				ni_dbus_message_t *msg, DBusMessageIter *iter)
+{
+	const char *object_path = dbus_message_get_path(msg);
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_object_t *modem_object;
+	const char *interface = NULL;
+	ni_modem_state_t old_state;
+	ni_modem_t *modem;
+
+	if (!(modem_object = ni_dbus_object_lookup(modem_manager->proxy, object_path)) ||
+	    !(modem = ni_objectmodel_unwrap_modem(modem_object, NULL)))
+		return;
+
+	/* the pending GetAll reply is newer than the signal */
+	if (!ni_modem_manager_modem_added(modem))
+		return;
+
+	if (dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_STRING)
+		dbus_message_iter_get_basic(iter, &interface);
+
+	old_state = modem->state;
+	if (!ni_dbus_object_apply_properties_changed(modem_object, msg)) {
+		if (!ni_string_eq(interface, NI_MM_MODEM_IF)) {
+			ni_debug_modem("%s: %s properties changed (not handled)",
+					object_path, interface);
+			return;
+		}
+
+		ni_debug_modem("%s: cannot apply property changes, refreshing", object_path);
+		if (!ni_dbus_object_refresh_properties(modem_object,
+					&ni_objectmodel_mm_modem_service, &error)) {
+			ni_dbus_print_error(&error, "cannot update properties of %s", object_path);
+			dbus_error_free(&error);
+			return;
+		}
+	}
+
+	if (modem->state != old_state) {
+		ni_modem_state_t new_state = modem->state;
+
+		ni_debug_modem("%s: state changed: %u -> %u", object_path, old_state, new_state);
+		modem->state = old_state;
+		ni_modem_manager_state_change(modem, new_state);
+	}
+}
+
 static void
 ni_modem_manager_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg, void *user_data)
 {
@@ -771,17 +954,7 @@ ni_modem_manager_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg, void
 				goto bad_vibes;
 
 			ni_debug_modem("%s: state changed: %u -> %u", object_path, old_state, new_state);
-
-			if (ni_modem_manager_event_handler) {
-				if (modem->state < MM_MODEM_STATE_REGISTERED && new_state >= MM_MODEM_STATE_REGISTERED)
-					ni_modem_manager_event_handler(modem, NI_EVENT_LINK_ASSOCIATED);
-				else
-				if (modem->state >= MM_MODEM_STATE_REGISTERED && new_state < MM_MODEM_STATE_REGISTERED)
-					ni_modem_manager_event_handler(modem, NI_EVENT_LINK_ASSOCIATION_LOST);
-				memset(&modem->event_uuid, 0, sizeof(modem->event_uuid));
-			}
-
-			modem->state = new_state;
+			ni_modem_manager_state_change(modem, new_state);
 		}
 	} else
 	if (!strcmp(member, NI_MM_SIGNAL_NETWORK_MODE)) {
@@ -802,6 +975,9 @@ ni_modem_manager_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg, void
 
 			ni_debug_modem("%s: network mode changed: %u", object_path, mode);
 		}
+	} else
+	if (!strcmp(member, NI_MM_SIGNAL_PROPERTIES_CHANGED)) {
+		ni_modem_manager_properties_changed(modem_manager, msg, &iter);
 	} else {
 		ni_debug_objectmodel("%s signal received (not handled)", member);
 	}
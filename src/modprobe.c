@@ -7,7 +7,13 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/utsname.h>
+
 #include <wicked/util.h>
+#include "modprobe.h"
 #include "process.h"
 
 #ifndef NI_MODPROBE_BIN
@@ -16,18 +22,169 @@
 #ifndef NI_MODPROBE_OPT
 #define NI_MODPROBE_OPT "-qs"
 #endif
+#ifndef NI_MODPROBE_ALL
+#define NI_MODPROBE_ALL "-a"
+#endif
+
+#define NI_MODPROBE_PROC_MODULES	"/proc/modules"
+#define NI_MODPROBE_SYS_MODULE		"/sys/module"
+#define NI_MODPROBE_LIB_MODULES		"/lib/modules"
+
+/*
+ * Cache of the modules built into the kernel and the loaded ones,
+ * initialized from /proc/modules, to not run modprobe for a module
+ * again and again while creating interfaces.  Loaded modules can be
+ * unloaded, so we verify them in /sys/module before to skip them.
+ */
+static struct {
+	ni_bool_t		initialized;
+	ni_string_array_t	builtin;
+	ni_string_array_t	loaded;
+} ni_modprobe_cache;
+
+static const char *
+ni_modprobe_module_name(char *buf, size_t size, const char *module)
+{
+	char *p;
+
+	/* the kernel reports module names with underscores */
+	snprintf(buf, size, "%s", module);
+	for (p = buf; *p; ++p) {
+		if (*p == '-')
+			*p = '_';
+	}
+	return buf;
+}
+
+static void
+ni_modprobe_cache_read_builtin(ni_string_array_t *builtin)
+{
+	char path[PATH_MAX], line[PATH_MAX], name[NAME_MAX + 1];
+	struct utsname uts;
+	char *base, *sfx;
+	FILE *fp;
+
+	if (uname(&uts) < 0)
+		return;
+
+	snprintf(path, sizeof(path), "%s/%s/modules.builtin",
+			NI_MODPROBE_LIB_MODULES, uts.release);
+	if (!(fp = fopen(path, "re")))
+		return;
+
+	/* kernel/drivers/net/dummy.ko */
+	while (fgets(line, sizeof(line), fp)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		base = strrchr(line, '/');
+		base = base ? base + 1 : line;
+		if ((sfx = strstr(base, ".ko")))
+			*sfx = '\0';
+		if (*base)
+			ni_string_array_append(builtin, ni_modprobe_module_name(
+						name, sizeof(name), base));
+	}
+	fclose(fp);
+}
+
+static void
+ni_modprobe_cache_read_loaded(ni_string_array_t *loaded)
+{
+	char line[BUFSIZ];
+	FILE *fp;
+
+	if (!(fp = fopen(NI_MODPROBE_PROC_MODULES, "re")))
+		return;
+
+	/* bonding 204800 0 - Live 0x0000000000000000 */
+	while (fgets(line, sizeof(line), fp)) {
+		line[strcspn(line, " \t\r\n")] = '\0';
+		if (*line)
+			ni_string_array_append(loaded, line);
+	}
+	fclose(fp);
+}
+
+static void
+ni_modprobe_cache_init(void)
+{
+	if (ni_modprobe_cache.initialized)
+		return;
+
+	ni_modprobe_cache.initialized = TRUE;
+	ni_modprobe_cache_read_builtin(&ni_modprobe_cache.builtin);
+	ni_modprobe_cache_read_loaded(&ni_modprobe_cache.loaded);
+}
+
+static ni_bool_t
+ni_modprobe_is_loaded(const char *module)
+{
+	char name[NAME_MAX + 1];
+	int pos;
+
+	ni_modprobe_cache_init();
+	ni_modprobe_module_name(name, sizeof(name), module);
+
+	if (ni_string_array_index(&ni_modprobe_cache.builtin, name) >= 0)
+		return TRUE;
+
+	if ((pos = ni_string_array_index(&ni_modprobe_cache.loaded, name)) < 0)
+		return FALSE;
+
+	if (ni_file_exists_fmt("%s/%s/initstate", NI_MODPROBE_SYS_MODULE, name))
+		return TRUE;
+
+	ni_string_array_remove_index(&ni_modprobe_cache.loaded, pos);
+	return FALSE;
+}
+
+static void
+ni_modprobe_set_loaded(const char *module)
+{
+	char name[NAME_MAX + 1];
+
+	ni_modprobe_module_name(name, sizeof(name), module);
+
+	/* it may be an alias, a real name does not need a modprobe later */
+	if (ni_file_exists_fmt("%s/%s", NI_MODPROBE_SYS_MODULE, name) &&
+	    ni_string_array_index(&ni_modprobe_cache.loaded, name) < 0)
+		ni_string_array_append(&ni_modprobe_cache.loaded, name);
+}
+
+static int
+ni_modprobe_run(ni_string_array_t *argv)
+{
+	ni_shellcmd_t *cmd;
+	ni_process_t *pi;
+	int rv;
+
+	if ((cmd = ni_shellcmd_new(argv)) == NULL)
+		return -1;
+
+	if ((pi = ni_process_new(cmd)) == NULL) {
+		ni_shellcmd_release(cmd);
+		return -1;
+	}
+	ni_shellcmd_release(cmd);
+
+	rv = ni_process_run_and_wait(pi);
+	ni_process_free(pi);
+
+	return rv;
+}
 
 int
 ni_modprobe(const char *module, const char *options)
 {
 	ni_string_array_t argv;
-	ni_shellcmd_t *cmd;
-	ni_process_t *pi;
 	int rv;
 
 	if (ni_string_len(module) == 0)
 		return -1;
 
+	/* modprobe ignores the options of an already loaded module */
+	if (ni_modprobe_is_loaded(module))
+		return 0;
+
 	ni_string_array_init(&argv);
 	if (ni_string_array_append(&argv, NI_MODPROBE_BIN) < 0 ||
 	    ni_string_array_append(&argv, NI_MODPROBE_OPT) < 0 ||
@@ -38,21 +195,60 @@ ni_modprobe(const char *module, const char *options)
 		return -1;
 	}
 
-	if ((cmd = ni_shellcmd_new(&argv)) == NULL) {
+	rv = ni_modprobe_run(&argv);
+	ni_string_array_destroy(&argv);
+
+	if (rv == 0)
+		ni_modprobe_set_loaded(module);
+	return rv;
+}
+
+/*
+ * Load all the given modules (without options) in one modprobe run.
+ */
+int
+ni_modprobe_all(const ni_string_array_t *modules)
+{
+	ni_string_array_t argv;
+	unsigned int i, count;
+	int rv;
+
+	if (!modules)
+		return -1;
+
+	ni_string_array_init(&argv);
+	if (ni_string_array_append(&argv, NI_MODPROBE_BIN) < 0 ||
+	    ni_string_array_append(&argv, NI_MODPROBE_OPT) < 0 ||
+	    ni_string_array_append(&argv, NI_MODPROBE_ALL) < 0 ||
+	    ni_string_array_append(&argv, "--") < 0) {
 		ni_string_array_destroy(&argv);
 		return -1;
 	}
-	ni_string_array_destroy(&argv);
+	count = argv.count;
 
-	if ((pi = ni_process_new(cmd)) == NULL) {
-		ni_shellcmd_release(cmd);
-		return -1;
+	for (i = 0; i < modules->count; ++i) {
+		const char *module = modules->data[i];
+
+		if (ni_string_len(module) == 0 || ni_modprobe_is_loaded(module) ||
+		    ni_string_array_index(&argv, module) >= (int)count)
+			continue;
+
+		if (ni_string_array_append(&argv, module) < 0) {
+			ni_string_array_destroy(&argv);
+			return -1;
+		}
 	}
-	ni_shellcmd_release(cmd);
 
-	rv = ni_process_run_and_wait(pi);
-	ni_process_free(pi);
+	if (argv.count == count) {
+		ni_string_array_destroy(&argv);
+		return 0;
+	}
 
+	rv = ni_modprobe_run(&argv);
+	if (rv == 0) {
+		for (i = count; i < argv.count; ++i)
+			ni_modprobe_set_loaded(argv.data[i]);
+	}
+	ni_string_array_destroy(&argv);
 	return rv;
 }
-
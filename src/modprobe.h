@@ -7,6 +7,9 @@
 #ifndef __WICKED_MODPROBE_H__
 #define __WICKED_MODPROBE_H__
 
+#include <wicked/types.h>
+
 extern int	ni_modprobe(const char *module, const char *options);
+extern int	ni_modprobe_all(const ni_string_array_t *modules);
 
 #endif /* __WICKED_MODPROBE_H__ */
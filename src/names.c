@@ -83,13 +83,14 @@ static const ni_intmap_t	__linktype_names[] = {
 
 	{ NULL }
 };
+static ni_intmap_index_t	__linktype_index = NI_INTMAP_INDEX_INIT(__linktype_names);
 
 int
 ni_linktype_name_to_type(const char *name)
 {
 	unsigned int value;
 
-	if (ni_parse_uint_mapped(name, __linktype_names, &value) < 0)
+	if (ni_intmap_index_parse(&__linktype_index, name, &value) < 0)
 		return -1;
 	return value;
 }
@@ -97,7 +98,7 @@ ni_linktype_name_to_type(const char *name)
 const char *
 ni_linktype_type_to_name(unsigned int type)
 {
-	return ni_format_uint_mapped(type, __linktype_names);
+	return ni_intmap_index_format(&__linktype_index, type);
 }
 
 /*
@@ -35,10 +35,15 @@
 #include <wicked/ipv6.h>
 #include <wicked/pci.h>
 #include <wicked/lldp.h>
+#include <wicked/dcb.h>
+#include <wicked/ethtool.h>
+#include <wicked/linkstats.h>
 #include <wicked/fsm.h>
 #include "netinfo_priv.h"
 #include "util_priv.h"
 #include "appconfig.h"
+#include "stats.h"
+#include "sysfs.h"
 
 /*
  * Constructor for network interface.
@@ -53,6 +58,7 @@ ni_netdev_new(const char *name, unsigned int index)
 	if (!dev)
 		return NULL;
 
+	ni_stats_object_alloc(NI_STATS_OBJECT_NETDEV, sizeof(*dev));
 	dev->users = 1;
 	dev->link.type = NI_IFTYPE_UNKNOWN;
 	dev->link.hwaddr.type = ARPHRD_VOID;
@@ -71,9 +77,75 @@ ni_netdev_new(const char *name, unsigned int index)
 void
 ni_netdev_clear_addresses(ni_netdev_t *dev)
 {
+	ni_netdev_drop_address_index(dev);
 	ni_address_list_destroy(&dev->addrs);
 }
 
+/*
+ * Devices with NI_NETDEV_ADDRESS_INDEX_MIN_COUNT or more addresses get
+ * a lazily built hash index of dev->addrs by the local address, which
+ * the helpers below keep in sync. Other modifications of the address
+ * list have to drop it using ni_netdev_drop_address_index.
+ */
+#define NI_NETDEV_ADDRESS_INDEX_MIN_COUNT	32
+
+ni_address_t *
+ni_netdev_find_address(ni_netdev_t *dev, const ni_sockaddr_t *addr)
+{
+	ni_address_t *ap;
+	unsigned int n;
+
+	if (!dev || !addr)
+		return NULL;
+
+	if (dev->addrs_index)
+		return ni_address_index_find(dev->addrs_index, addr);
+
+	for (n = 0, ap = dev->addrs; ap; ap = ap->next, ++n) {
+		if (ni_sockaddr_equal(&ap->local_addr, addr))
+			break;
+	}
+	if (n >= NI_NETDEV_ADDRESS_INDEX_MIN_COUNT)
+		dev->addrs_index = ni_address_index_new(dev->addrs);
+	return ap;
+}
+
+void
+ni_netdev_append_address(ni_netdev_t *dev, ni_address_t *ap)
+{
+	if (!dev || !ap)
+		return;
+
+	ni_address_list_append(&dev->addrs, ap);
+	ni_address_index_insert(dev->addrs_index, ap);
+}
+
+void
+ni_netdev_delete_address(ni_netdev_t *dev, ni_address_t *ap)
+{
+	if (!dev || !ap)
+		return;
+
+	ni_netdev_unindex_address(dev, ap);
+	ni_address_list_delete(&dev->addrs, ap);
+}
+
+void
+ni_netdev_unindex_address(ni_netdev_t *dev, const ni_address_t *ap)
+{
+	if (dev && dev->addrs_index && !ni_address_index_remove(dev->addrs_index, ap))
+		ni_netdev_drop_address_index(dev);
+}
+
+void
+ni_netdev_drop_address_index(ni_netdev_t *dev)
+{
+	if (dev && dev->addrs_index) {
+		ni_address_index_free(dev->addrs_index);
+		dev->addrs_index = NULL;
+	}
+}
+
 void
 ni_netdev_clear_routes(ni_netdev_t *dev)
 {
@@ -183,6 +255,7 @@ ni_netdev_put(ni_netdev_t *dev)
 
 		if (dev->users == 0) {
 			ni_netdev_reset(dev);
+			ni_stats_object_free(NI_STATS_OBJECT_NETDEV, sizeof(*dev));
 			free(dev);
 		} else {
 			return dev->users;
@@ -599,6 +672,18 @@ ni_netdev_set_dcb(ni_netdev_t *dev, ni_dcb_t *dcb)
 	dev->dcb = dcb;
 }
 
+/*
+ * Get the interface's link stats; allocated on first use only,
+ * the link events keep them current afterwards.
+ */
+ni_link_stats_t *
+ni_netdev_get_link_stats(ni_netdev_t *dev)
+{
+	if (!dev->link.stats)
+		dev->link.stats = xcalloc(1, sizeof(*dev->link.stats));
+	return dev->link.stats;
+}
+
 /*
  * Set the interface's link stats
  */
@@ -610,6 +695,19 @@ ni_netdev_set_link_stats(ni_netdev_t *dev, ni_link_stats_t *stats)
 	dev->link.stats = stats;
 }
 
+/*
+ * Get the PCI device info, looked up in sysfs on first use only
+ */
+const ni_pci_dev_t *
+ni_netdev_get_pci(ni_netdev_t *dev)
+{
+	if (!dev->pci_probed && dev->name) {
+		dev->pci_dev = ni_sysfs_netdev_get_pci(dev->name);
+		dev->pci_probed = TRUE;
+	}
+	return dev->pci_dev;
+}
+
 /*
  * Set the PCI device info
  */
@@ -619,6 +717,7 @@ ni_netdev_set_pci(ni_netdev_t *dev, ni_pci_dev_t *pci_dev)
 	if (dev->pci_dev)
 		ni_pci_dev_free(dev->pci_dev);
 	dev->pci_dev = pci_dev;
+	dev->pci_probed = pci_dev != NULL;
 }
 
 /*
@@ -941,21 +1040,10 @@ __ni_netdev_route_to_lease(ni_netdev_t *dev, const ni_route_t *rp, unsigned int
 ni_route_t *
 __ni_lease_owns_route(const ni_addrconf_lease_t *lease, const ni_route_t *rp)
 {
-	ni_route_table_t *tab;
-	ni_route_t *own;
-	unsigned int i;
-
 	if (!lease)
 		return 0;
 
-	if ((tab = ni_route_tables_find(lease->routes, rp->table))) {
-		for (i = 0; i < tab->routes.count; ++i) {
-			own = tab->routes.data[i];
-			if (own && ni_route_equal(own, rp))
-				return own;
-		}
-	}
-	return NULL;
+	return ni_route_tables_find_prefix_match(lease->routes, rp, ni_route_equal);
 }
 
 /*
@@ -1128,3 +1216,103 @@ ni_netdev_alias_label_is_valid(const char *ifname, const char *alabel)
 	}
 }
 
+/*
+ * Memory footprint of a device by block: the struct sizes of the
+ * device and of the blocks allocated for it, without the strings
+ * and arrays they refer to, as in the object allocation accounting.
+ */
+static const char *		ni_netdev_memory_block_names[NI_NETDEV_MEMORY_MAX] = {
+	[NI_NETDEV_MEMORY_NETDEV]	= "netdev",
+	[NI_NETDEV_MEMORY_CLIENT_STATE]	= "client-state",
+	[NI_NETDEV_MEMORY_ADDRESSES]	= "addresses",
+	[NI_NETDEV_MEMORY_LEASES]	= "leases",
+	[NI_NETDEV_MEMORY_IPV4]		= "ipv4",
+	[NI_NETDEV_MEMORY_IPV6]		= "ipv6",
+	[NI_NETDEV_MEMORY_IPV6_RA]	= "ipv6-ra",
+	[NI_NETDEV_MEMORY_LINK_TYPE]	= "link-type",
+	[NI_NETDEV_MEMORY_LINK_STATS]	= "link-stats",
+	[NI_NETDEV_MEMORY_ETHTOOL]	= "ethtool",
+	[NI_NETDEV_MEMORY_LLDP]		= "lldp",
+	[NI_NETDEV_MEMORY_DCB]		= "dcb",
+	[NI_NETDEV_MEMORY_PCI]		= "pci",
+};
+
+const char *
+ni_netdev_memory_block_name(unsigned int block)
+{
+	return block < NI_NETDEV_MEMORY_MAX ? ni_netdev_memory_block_names[block] : NULL;
+}
+
+#define __ni_netdev_memory_sizeof(ptr)	((ptr) ? sizeof(*(ptr)) : 0)
+
+static size_t
+ni_netdev_memory_usage_ethtool(const ni_ethtool_t *ethtool)
+{
+	if (!ethtool)
+		return 0;
+
+	return sizeof(*ethtool) +
+		__ni_netdev_memory_sizeof(ethtool->driver_info) +
+		__ni_netdev_memory_sizeof(ethtool->priv_flags) +
+		__ni_netdev_memory_sizeof(ethtool->link_settings) +
+		__ni_netdev_memory_sizeof(ethtool->wake_on_lan) +
+		__ni_netdev_memory_sizeof(ethtool->features) +
+		__ni_netdev_memory_sizeof(ethtool->eee) +
+		__ni_netdev_memory_sizeof(ethtool->ring) +
+		__ni_netdev_memory_sizeof(ethtool->channels) +
+		__ni_netdev_memory_sizeof(ethtool->coalesce) +
+		__ni_netdev_memory_sizeof(ethtool->pause);
+}
+
+size_t
+ni_netdev_memory_usage(const ni_netdev_t *dev, size_t usage[NI_NETDEV_MEMORY_MAX])
+{
+	const ni_addrconf_lease_t *lease;
+	const ni_address_t *ap;
+	unsigned int i;
+	size_t total = 0;
+
+	memset(usage, 0, NI_NETDEV_MEMORY_MAX * sizeof(usage[0]));
+	if (!dev)
+		return 0;
+
+	usage[NI_NETDEV_MEMORY_NETDEV] = sizeof(*dev);
+	usage[NI_NETDEV_MEMORY_CLIENT_STATE] = __ni_netdev_memory_sizeof(dev->client_state);
+	for (ap = dev->addrs; ap; ap = ap->next)
+		usage[NI_NETDEV_MEMORY_ADDRESSES] += sizeof(*ap);
+	for (lease = dev->leases; lease; lease = lease->next)
+		usage[NI_NETDEV_MEMORY_LEASES] += sizeof(*lease);
+
+	usage[NI_NETDEV_MEMORY_IPV4] = __ni_netdev_memory_sizeof(dev->ipv4);
+	usage[NI_NETDEV_MEMORY_IPV6] = __ni_netdev_memory_sizeof(dev->ipv6);
+	if (dev->ipv6)
+		usage[NI_NETDEV_MEMORY_IPV6_RA] = __ni_netdev_memory_sizeof(dev->ipv6->radv);
+
+	usage[NI_NETDEV_MEMORY_LINK_TYPE] =
+		__ni_netdev_memory_sizeof(dev->team) +
+		__ni_netdev_memory_sizeof(dev->bonding) +
+		__ni_netdev_memory_sizeof(dev->bridge) +
+		__ni_netdev_memory_sizeof(dev->ovsbr) +
+		__ni_netdev_memory_sizeof(dev->ethernet) +
+		__ni_netdev_memory_sizeof(dev->infiniband) +
+		__ni_netdev_memory_sizeof(dev->vlan) +
+		__ni_netdev_memory_sizeof(dev->vxlan) +
+		__ni_netdev_memory_sizeof(dev->macvlan) +
+		__ni_netdev_memory_sizeof(dev->wireless) +
+		__ni_netdev_memory_sizeof(dev->openvpn) +
+		__ni_netdev_memory_sizeof(dev->tuntap) +
+		__ni_netdev_memory_sizeof(dev->sit) +
+		__ni_netdev_memory_sizeof(dev->ipip) +
+		__ni_netdev_memory_sizeof(dev->gre) +
+		__ni_netdev_memory_sizeof(dev->ppp);
+
+	usage[NI_NETDEV_MEMORY_LINK_STATS] = __ni_netdev_memory_sizeof(dev->link.stats);
+	usage[NI_NETDEV_MEMORY_ETHTOOL] = ni_netdev_memory_usage_ethtool(dev->ethtool);
+	usage[NI_NETDEV_MEMORY_LLDP] = __ni_netdev_memory_sizeof(dev->lldp);
+	usage[NI_NETDEV_MEMORY_DCB] = __ni_netdev_memory_sizeof(dev->dcb);
+	usage[NI_NETDEV_MEMORY_PCI] = __ni_netdev_memory_sizeof(dev->pci_dev);
+
+	for (i = 0; i < NI_NETDEV_MEMORY_MAX; ++i)
+		total += usage[i];
+	return total;
+}
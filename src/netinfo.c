@@ -19,35 +19,53 @@
 #include <wicked/socket.h>
 #include "netinfo_priv.h"
 #include "util_priv.h"
+#include "array_priv.h"
 #include "dbus-server.h"
 #include "appconfig.h"
 #include "xml-schema.h"
 #include "sysfs.h"
 #include "modem-manager.h"
+#include "profile.h"
+#include "nexthop.h"
 
 #include <signal.h>
 #include <limits.h>
 #include <errno.h>
 
 #include <net/if.h>
+#include <linux/rtnetlink.h>
 
 #include <gcrypt.h>
 
 #define NI_NETDEV_REF_ARRAY_CHUNK	16
+#define NI_NETCONFIG_DEVHASH_MIN_SIZE	64
 
 typedef struct ni_netconfig_filter {
 	unsigned int		family;
 	unsigned int		discover;
 } ni_netconfig_filter_t;
 
+/*
+ * Hash index over the interface list; the list itself is
+ * authoritative, the buckets are rebuilt from it on resize.
+ */
+typedef struct ni_netconfig_devhash {
+	unsigned int		size;
+	unsigned int		count;
+	ni_netdev_t **		by_index;
+	ni_netdev_t **		by_name;
+} ni_netconfig_devhash_t;
+
 struct ni_netconfig {
 	ni_netconfig_filter_t	filter;
 
 	ni_netdev_t *		interfaces;
+	ni_netconfig_devhash_t	devhash;
 	ni_modem_t *		modems;
 
 	struct {
 		ni_rule_array_t	rules;
+		ni_uint_array_t	tables;	/* referenced by leases	*/
 	}			route;
 
 	unsigned char		initialized;
@@ -58,6 +76,7 @@ struct ni_netconfig {
  */
 ni_global_t	ni_global;
 unsigned int	__ni_global_seqno;
+ni_rtnl_refresh_stats_t	__ni_global_rtnl_refresh_stats;
 
 /*
  * Global initialization of application
@@ -151,7 +170,9 @@ ni_init_ex(const char *appname, ni_init_appdata_callback_t *cb, void *appdata)
 	}
 
 	if (ni_file_exists(ni_global.config_path)) {
+		ni_profile_enter("config-read");
 		ni_global.config = ni_config_parse(ni_global.config_path, cb, appdata);
+		ni_profile_leave();
 		if (!ni_global.config) {
 			ni_error("Unable to parse netinfo configuration file");
 			return -1;
@@ -397,9 +418,27 @@ ni_server_listen_other_events(void (*event_handler)(ni_event_t))
 	ni_global.other_event = event_handler;
 }
 
+/*
+ * The private socket of a wicked service, the other wicked daemons
+ * connect to directly, when enabled. It is root only (mode 0600).
+ */
+static const char *
+ni_dbus_peer_socket_path(char **path, const char *dbus_name)
+{
+	const char *statedir = ni_config_statedir();
+
+	if (ni_string_empty(statedir) || ni_string_empty(dbus_name))
+		return NULL;
+
+	return ni_string_printf(path, "%s/%s.socket", statedir, dbus_name);
+}
+
 ni_dbus_server_t *
 ni_server_listen_dbus(const char *dbus_name)
 {
+	ni_dbus_server_t *server;
+	char *path = NULL;
+
 	ni_global_assert_initialized();
 	if (dbus_name == NULL)
 		dbus_name = ni_global.config->dbus_name;
@@ -408,12 +447,23 @@ ni_server_listen_dbus(const char *dbus_name)
 		return NULL;
 	}
 
-	return ni_dbus_server_open(ni_global.config->dbus_type, dbus_name, NULL);
+	server = ni_dbus_server_open(ni_global.config->dbus_type, dbus_name, NULL);
+	if (server && ni_global.config->dbus_peer_socket &&
+	    ni_dbus_peer_socket_path(&path, dbus_name)) {
+		/* the bus name is still there for everyone else */
+		if (!ni_dbus_server_listen_peers(server, path))
+			ni_warn("unable to listen on dbus peer socket %s", path);
+		ni_string_free(&path);
+	}
+	return server;
 }
 
 ni_dbus_client_t *
 ni_create_dbus_client(const char *dbus_name)
 {
+	ni_dbus_client_t *client;
+	char *path = NULL;
+
 	ni_global_assert_initialized();
 	if (dbus_name == NULL)
 		dbus_name = ni_global.config->dbus_name;
@@ -422,6 +472,15 @@ ni_create_dbus_client(const char *dbus_name)
 		return NULL;
 	}
 
+	if (ni_global.config->dbus_peer_socket &&
+	    ni_dbus_peer_socket_path(&path, dbus_name)) {
+		/* a service without (or with a stale) socket is on the bus */
+		client = ni_dbus_client_open_peer(path, dbus_name);
+		ni_string_free(&path);
+		if (client)
+			return client;
+	}
+
 	return ni_dbus_client_open(ni_global.config->dbus_type, dbus_name);
 }
 
@@ -436,13 +495,18 @@ ni_server_dbus_xml_schema(void)
 		return NULL;
 	}
 
+	if (ni_global.config->dbus_xml_schema_cache)
+		ni_xs_cache_open(ni_global.config->dbus_xml_schema_cache);
+
 	scope = ni_dbus_xml_init();
 	if (ni_xs_process_schema_file(filename, scope) < 0) {
 		ni_error("Cannot create dbus xml schema: error in schema definition");
+		ni_xs_cache_close();
 		ni_xs_scope_free(scope);
 		return NULL;
 	}
 
+	ni_xs_cache_close();
 	return scope;
 }
 
@@ -517,8 +581,11 @@ ni_netconfig_init(ni_netconfig_t *nc)
 void
 ni_netconfig_destroy(ni_netconfig_t *nc)
 {
+	free(nc->devhash.by_index);
+	free(nc->devhash.by_name);
 	__ni_netdev_list_destroy(&nc->interfaces);
 	ni_rule_array_destroy(&nc->route.rules);
+	ni_uint_array_destroy(&nc->route.tables);
 	memset(nc, 0, sizeof(*nc));
 }
 
@@ -573,10 +640,158 @@ ni_netconfig_device_list_head(ni_netconfig_t *nc)
 	return &nc->interfaces;
 }
 
+/*
+ * Maintain the ifindex and name hash index of the interface list
+ */
+static inline unsigned int
+ni_netconfig_devhash_index_slot(const ni_netconfig_devhash_t *hash, unsigned int ifindex)
+{
+	return (ifindex * 2654435761U) & (hash->size - 1);
+}
+
+static inline unsigned int
+ni_netconfig_devhash_name_slot(const ni_netconfig_devhash_t *hash, unsigned int name_hash)
+{
+	return name_hash & (hash->size - 1);
+}
+
+static void
+ni_netconfig_devhash_link_name(ni_netconfig_devhash_t *hash, ni_netdev_t *dev)
+{
+	unsigned int slot;
+
+	dev->hash.name_hash = ni_string_hash(dev->name);
+	slot = ni_netconfig_devhash_name_slot(hash, dev->hash.name_hash);
+	dev->hash.name_next = hash->by_name[slot];
+	hash->by_name[slot] = dev;
+}
+
+static void
+ni_netconfig_devhash_unlink_name(ni_netconfig_devhash_t *hash, ni_netdev_t *dev)
+{
+	ni_netdev_t **pos, *cur;
+	unsigned int slot;
+
+	slot = ni_netconfig_devhash_name_slot(hash, dev->hash.name_hash);
+	for (pos = &hash->by_name[slot]; (cur = *pos); pos = &cur->hash.name_next) {
+		if (cur == dev) {
+			*pos = cur->hash.name_next;
+			break;
+		}
+	}
+	dev->hash.name_next = NULL;
+}
+
+static void
+ni_netconfig_devhash_link(ni_netconfig_devhash_t *hash, ni_netdev_t *dev)
+{
+	unsigned int slot;
+
+	slot = ni_netconfig_devhash_index_slot(hash, dev->link.ifindex);
+	dev->hash.index_next = hash->by_index[slot];
+	hash->by_index[slot] = dev;
+
+	ni_netconfig_devhash_link_name(hash, dev);
+}
+
+static void
+ni_netconfig_devhash_unlink(ni_netconfig_devhash_t *hash, ni_netdev_t *dev)
+{
+	ni_netdev_t **pos, *cur;
+	unsigned int slot;
+
+	slot = ni_netconfig_devhash_index_slot(hash, dev->link.ifindex);
+	for (pos = &hash->by_index[slot]; (cur = *pos); pos = &cur->hash.index_next) {
+		if (cur == dev) {
+			*pos = cur->hash.index_next;
+			break;
+		}
+	}
+	dev->hash.index_next = NULL;
+
+	ni_netconfig_devhash_unlink_name(hash, dev);
+}
+
+static ni_bool_t
+ni_netconfig_devhash_rebuild(ni_netconfig_t *nc, unsigned int size)
+{
+	ni_netconfig_devhash_t *hash = &nc->devhash;
+	ni_netdev_t **by_index, **by_name;
+	ni_netdev_t *dev;
+
+	by_index = calloc(size, sizeof(*by_index));
+	by_name  = calloc(size, sizeof(*by_name));
+	if (!by_index || !by_name) {
+		free(by_index);
+		free(by_name);
+		return FALSE;
+	}
+
+	free(hash->by_index);
+	free(hash->by_name);
+	hash->by_index = by_index;
+	hash->by_name  = by_name;
+	hash->size  = size;
+	hash->count = 0;
+
+	for (dev = nc->interfaces; dev; dev = dev->next) {
+		ni_netconfig_devhash_link(hash, dev);
+		hash->count++;
+	}
+	return TRUE;
+}
+
+void
+ni_netconfig_device_hash_insert(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	ni_netconfig_devhash_t *hash = &nc->devhash;
+
+	/* the device is already in the list, a rebuild picks it up */
+	if (hash->size == 0 || hash->count >= hash->size * 2) {
+		unsigned int size = hash->size ? hash->size * 2 :
+				NI_NETCONFIG_DEVHASH_MIN_SIZE;
+
+		if (!ni_netconfig_devhash_rebuild(nc, size))
+			ni_warn("%s: unable to rebuild device hash index", __func__);
+		return;
+	}
+
+	ni_netconfig_devhash_link(hash, dev);
+	hash->count++;
+}
+
+void
+ni_netconfig_device_hash_remove(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	ni_netconfig_devhash_t *hash = &nc->devhash;
+
+	if (hash->size == 0)
+		return;
+
+	ni_netconfig_devhash_unlink(hash, dev);
+	if (hash->count)
+		hash->count--;
+}
+
+void
+ni_netconfig_device_rename(ni_netconfig_t *nc, ni_netdev_t *dev, const char *name)
+{
+	ni_netconfig_devhash_t *hash = &nc->devhash;
+
+	if (hash->size)
+		ni_netconfig_devhash_unlink_name(hash, dev);
+
+	ni_string_dup(&dev->name, name);
+
+	if (hash->size)
+		ni_netconfig_devhash_link_name(hash, dev);
+}
+
 void
 ni_netconfig_device_append(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
 	__ni_netdev_list_append(&nc->interfaces, dev);
+	ni_netconfig_device_hash_insert(nc, dev);
 }
 
 static inline void
@@ -598,6 +813,7 @@ ni_netconfig_device_remove(ni_netconfig_t *nc, ni_netdev_t *dev)
 	for (pos = &nc->interfaces; (cur = *pos) != NULL; pos = &cur->next) {
 		if (cur == dev) {
 			*pos = cur->next;
+			ni_netconfig_device_hash_remove(nc, cur);
 			ni_netconfig_device_unbind_slave_index(nc, cur->link.ifindex);
 			ni_netdev_put(cur);
 			return;
@@ -658,7 +874,7 @@ ni_netconfig_route_add(ni_netconfig_t *nc, ni_route_t *rp, ni_netdev_t *dev)
 			ni_stringbuf_destroy(&buf);
 			ret = -1;
 		} else
-		if (!ni_route_tables_find_match(dev->routes, rp, ni_route_equal_ref) &&
+		if (!ni_route_tables_find_prefix_match(dev->routes, rp, ni_route_equal_ref) &&
 		    !ni_route_tables_add_route(&dev->routes, ni_route_ref(rp))) {
 			ni_warn("Unable to record route for device %s[%u]: %s",
 				dev->name, dev->link.ifindex, ni_route_print(&buf, rp));
@@ -719,6 +935,9 @@ ni_netconfig_route_del(ni_netconfig_t *nc, ni_route_t *rp, ni_netdev_t *dev)
 			ret = 0;
 	}
 
+	if (rp->nh_id)
+		ni_nexthop_groups_check();
+
 	ni_route_free(rp);
 	return ret;
 }
@@ -729,24 +948,81 @@ ni_netconfig_rule_array(ni_netconfig_t *nc)
 	return nc ? &nc->route.rules : NULL;
 }
 
+/*
+ * The rules are kept sorted by their pref, with rules without a final
+ * pref (not yet refreshed from the kernel) in front of them, so a rule
+ * with a pref is found using a binary search of its pref range.
+ */
+static unsigned int
+ni_netconfig_rule_pref_first(const ni_rule_array_t *rules)
+{
+	unsigned int i;
+
+	for (i = 0; i < rules->count; ++i) {
+		if (rules->data[i]->set & NI_RULE_SET_PREF)
+			break;
+	}
+	return i;
+}
+
+static unsigned int
+ni_netconfig_rule_pref_bound(const ni_rule_array_t *rules, unsigned int lo,
+				unsigned int pref, ni_bool_t upper)
+{
+	unsigned int hi = rules->count, mid;
+	const ni_rule_t *r;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		r = rules->data[mid];
+		if (r->pref < pref || (upper && r->pref == pref))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static unsigned int
+ni_netconfig_rule_index(const ni_rule_array_t *rules, const ni_rule_t *rule)
+{
+	unsigned int i, first;
+
+	first = ni_netconfig_rule_pref_first(rules);
+	for (i = 0; i < first; ++i) {
+		if (ni_rule_equal(rules->data[i], rule))
+			return i;
+	}
+
+	if (rule->set & NI_RULE_SET_PREF) {
+		i = ni_netconfig_rule_pref_bound(rules, first, rule->pref, FALSE);
+		for ( ; i < rules->count && rules->data[i]->pref == rule->pref; ++i) {
+			if (ni_rule_equal(rules->data[i], rule))
+				return i;
+		}
+	} else {
+		for (i = first; i < rules->count; ++i) {
+			if (ni_rule_equal(rules->data[i], rule))
+				return i;
+		}
+	}
+	return -1U;
+}
+
 int
 ni_netconfig_rule_add(ni_netconfig_t *nc, ni_rule_t *rule)
 {
-	unsigned int i, last = 0;
 	ni_rule_array_t *rules;
-	const ni_rule_t *r;
+	unsigned int pos;
 
 	if (!(rules = ni_netconfig_rule_array(nc)) || !rule)
 		return -1;
 
-	for (i = 0; i < rules->count; ++i) {
-		r = rules->data[i];
-		if (r->pref > rule->pref)
-			break;
-		last = i + 1;
-	}
+	pos = ni_netconfig_rule_pref_first(rules);
+	if (rule->set & NI_RULE_SET_PREF)
+		pos = ni_netconfig_rule_pref_bound(rules, pos, rule->pref, TRUE);
 
-	if (!ni_rule_array_insert(rules, last, ni_rule_ref(rule))) {
+	if (!ni_rule_array_insert(rules, pos, ni_rule_ref(rule))) {
 		ni_error("%s: unable to insert routing policy rule", __func__);
 		return -1;
 	}
@@ -759,32 +1035,27 @@ ni_netconfig_rule_del(ni_netconfig_t *nc, const ni_rule_t *rule, ni_rule_t **pde
 {
 	ni_rule_array_t *rules;
 	unsigned int i;
-	ni_rule_t *r;
 
 	if (!(rules = ni_netconfig_rule_array(nc)) || !rule)
 		return -1;
 
-	for (i = 0; i < rules->count; ++i) {
-		r = rules->data[i];
-		if (!ni_rule_equal(r, rule))
-			continue;
+	if ((i = ni_netconfig_rule_index(rules, rule)) == -1U)
+		return 1;
 
-		if (pdel) {
-			*pdel = ni_rule_array_remove_at(rules, i);
-			if (!*pdel) {
-				ni_error("%s: unable to remove policy rule", __func__);
-				return -1;
-			}
-		} else {
-			if (!ni_rule_array_delete_at(rules, i)) {
-				ni_error("%s: unable to remove policy rule", __func__);
-				return -1;
-			}
+	if (pdel) {
+		*pdel = ni_rule_array_remove_at(rules, i);
+		if (!*pdel) {
+			ni_error("%s: unable to remove policy rule", __func__);
+			return -1;
+		}
+	} else {
+		if (!ni_rule_array_delete_at(rules, i)) {
+			ni_error("%s: unable to remove policy rule", __func__);
+			return -1;
 		}
-
-		return 0;
 	}
-	return 1;
+
+	return 0;
 }
 
 ni_rule_t *
@@ -792,19 +1063,93 @@ ni_netconfig_rule_find(ni_netconfig_t *nc, const ni_rule_t *rule)
 {
 	ni_rule_array_t *rules;
 	unsigned int i;
-	ni_rule_t *r;
 
 	if (!(rules = ni_netconfig_rule_array(nc)) || !rule)
 		return NULL;
 
-	for (i = 0; i < rules->count; ++i) {
-		r = rules->data[i];
-		if (ni_rule_equal(r, rule))
-			return r;
+	if ((i = ni_netconfig_rule_index(rules, rule)) == -1U)
+		return NULL;
+
+	return rules->data[i];
+}
+
+
+/*
+ * The routing tables the leases refer to by their routes and rules;
+ * with the <route-filter><managed-tables> option, the routes of other
+ * tables than main are not tracked.
+ */
+static void
+ni_netconfig_route_tables_collect(ni_uint_array_t *tables, const ni_addrconf_lease_t *lease)
+{
+	const ni_route_table_t *tab;
+	const ni_rule_t *rule;
+	unsigned int i;
+
+	for (tab = lease->routes; tab; tab = tab->next) {
+		if (tab->routes.count && !ni_uint_array_contains(tables, tab->tid))
+			ni_uint_array_append(tables, tab->tid);
+	}
+
+	for (i = 0; lease->rules && i < lease->rules->count; ++i) {
+		if (!(rule = lease->rules->data[i]) || rule->action != NI_RULE_ACTION_TO_TBL)
+			continue;
+		if (!ni_uint_array_contains(tables, rule->table))
+			ni_uint_array_append(tables, rule->table);
 	}
-	return NULL;
 }
 
+/*
+ * Recompute the referenced tables of the leases of all devices, which
+ * include the leases in apply; returns TRUE when a table is referenced,
+ * which was not tracked before, so its routes need a refresh.
+ */
+ni_bool_t
+ni_netconfig_route_tables_update(ni_netconfig_t *nc)
+{
+	ni_uint_array_t tables = NI_UINT_ARRAY_INIT;
+	const ni_addrconf_lease_t *lease;
+	ni_bool_t added = FALSE;
+	ni_netdev_t *dev;
+	unsigned int i;
+
+	if (!nc || !ni_config_route_filter_managed_tables())
+		return FALSE;
+
+	for (dev = nc->interfaces; dev; dev = dev->next) {
+		for (lease = dev->leases; lease; lease = lease->next)
+			ni_netconfig_route_tables_collect(&tables, lease);
+	}
+
+	for (i = 0; i < tables.count; ++i) {
+		if (tables.data[i] == RT_TABLE_MAIN)
+			continue;
+		if (!ni_uint_array_contains(&nc->route.tables, tables.data[i])) {
+			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_ROUTE,
+					"tracking routes of table %u", tables.data[i]);
+			added = TRUE;
+		}
+	}
+
+	ni_uint_array_destroy(&nc->route.tables);
+	nc->route.tables = tables;
+	return added;
+}
+
+ni_bool_t
+ni_netconfig_route_table_tracked(ni_netconfig_t *nc, unsigned int table)
+{
+	if (table == RT_TABLE_MAIN || !nc || !ni_config_route_filter_managed_tables())
+		return TRUE;
+
+	return ni_uint_array_contains(&nc->route.tables, table);
+}
+
+const ni_uint_array_t *
+ni_netconfig_route_tables(ni_netconfig_t *nc)
+{
+	return nc ? &nc->route.tables : NULL;
+}
 
 /*
  * Find interface by name
@@ -812,11 +1157,34 @@ ni_netconfig_rule_find(ni_netconfig_t *nc, const ni_rule_t *rule)
 ni_netdev_t *
 ni_netdev_by_name(ni_netconfig_t *nc, const char *name)
 {
+	ni_netconfig_devhash_t *hash = &nc->devhash;
+	unsigned int slot;
 	ni_netdev_t *dev;
 
+	if (!name)
+		return NULL;
+
+	if (hash->size) {
+		slot = ni_netconfig_devhash_name_slot(hash, ni_string_hash(name));
+		for (dev = hash->by_name[slot]; dev; dev = dev->hash.name_next) {
+			if (dev->name && ni_string_eq(dev->name, name))
+				return dev;
+		}
+	}
+
+	/*
+	 * Not every rename goes through ni_netconfig_device_rename,
+	 * e.g. udev/uevent name updates -- fall back to the list and
+	 * move a device found there to the bucket of its new name.
+	 */
 	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (dev->name && ni_string_eq(dev->name, name))
+		if (dev->name && ni_string_eq(dev->name, name)) {
+			if (hash->size) {
+				ni_netconfig_devhash_unlink_name(hash, dev);
+				ni_netconfig_devhash_link_name(hash, dev);
+			}
 			return dev;
+		}
 	}
 
 	return NULL;
@@ -828,8 +1196,19 @@ ni_netdev_by_name(ni_netconfig_t *nc, const char *name)
 ni_netdev_t *
 ni_netdev_by_index(ni_netconfig_t *nc, unsigned int ifindex)
 {
+	ni_netconfig_devhash_t *hash = &nc->devhash;
+	unsigned int slot;
 	ni_netdev_t *dev;
 
+	if (hash->size) {
+		slot = ni_netconfig_devhash_index_slot(hash, ifindex);
+		for (dev = hash->by_index[slot]; dev; dev = dev->hash.index_next) {
+			if (dev->link.ifindex == ifindex)
+				return dev;
+		}
+		return NULL;
+	}
+
 	for (dev = nc->interfaces; dev; dev = dev->next) {
 		if (dev->link.ifindex == ifindex)
 			return dev;
@@ -1076,29 +1455,10 @@ ni_netdev_ref_array_find_name(const ni_netdev_ref_array_t *array, const char *na
 }
 
 static ni_bool_t
-ni_netdev_ref_array_realloc(ni_netdev_ref_array_t *array, unsigned int count)
+ni_netdev_ref_array_realloc(ni_netdev_ref_array_t *array, unsigned int newcount)
 {
-	ni_netdev_ref_t *newdata;
-	size_t           newsize;
-	unsigned int     i;
-
-	if ((UINT_MAX - array->count) <= count)
-		return FALSE;
-
-	newsize = array->count + count;
-	if ((SIZE_MAX / sizeof(*newdata)) < newsize)
-		return FALSE;
-
-	newdata = realloc(array->data, newsize * sizeof(*newdata));
-	if (!newdata)
-		return FALSE;
-
-	array->data = newdata;
-	for (i = array->count; i < newsize; ++i) {
-		array->data[i].index = 0;
-		array->data[i].name = NULL;
-	}
-	return TRUE;
+	return ni_array_grow((void **)&array->data, sizeof(ni_netdev_ref_t),
+				array->count, newcount, NI_NETDEV_REF_ARRAY_CHUNK);
 }
 
 const ni_netdev_ref_t *
@@ -1106,8 +1466,8 @@ ni_netdev_ref_array_append(ni_netdev_ref_array_t *array, const char *name, unsig
 {
 	ni_netdev_ref_t *item;
 
-	if (!array || ((array->count % NI_NETDEV_REF_ARRAY_CHUNK) == 0 &&
-	    !ni_netdev_ref_array_realloc(array, NI_NETDEV_REF_ARRAY_CHUNK)))
+	if (!array || array->count == UINT_MAX ||
+	    !ni_netdev_ref_array_realloc(array, array->count + 1))
 		return NULL;
 
 	item = &array->data[array->count++];
@@ -23,6 +23,7 @@
 
 typedef struct ni_capture	ni_capture_t;
 typedef struct __ni_netlink	ni_netlink_t;
+struct sock_filter;
 
 extern ni_netlink_t *		__ni_global_netlink;
 extern int			__ni_global_iocfd;
@@ -45,11 +46,30 @@ enum {
  */
 extern unsigned int	__ni_global_seqno;
 
+/*
+ * Counters of full rtnetlink dumps versus event driven refresh
+ */
+typedef struct ni_rtnl_refresh_stats {
+	unsigned long		full;		/* full link/addr/route dumps	*/
+	unsigned long		skipped;	/* dumps avoided (incremental)	*/
+	unsigned long		resync;		/* dumps to resync lost events	*/
+	unsigned long		overrun;	/* event receive buffer overruns*/
+	unsigned long		grown;		/* receive buffer size increases*/
+} ni_rtnl_refresh_stats_t;
+
+extern ni_rtnl_refresh_stats_t	__ni_global_rtnl_refresh_stats;
+
+extern ni_bool_t	__ni_rtevent_incremental_refresh(void);
+extern void		__ni_rtevent_refresh_synced(void);
+
 extern ni_netlink_t *	__ni_netlink_open(int);
 extern void		__ni_netlink_close(ni_netlink_t *);
 
 extern void		ni_netconfig_device_append(ni_netconfig_t *, ni_netdev_t *);
 extern void		ni_netconfig_device_remove(ni_netconfig_t *, ni_netdev_t *);
+extern void		ni_netconfig_device_rename(ni_netconfig_t *, ni_netdev_t *, const char *);
+extern void		ni_netconfig_device_hash_insert(ni_netconfig_t *, ni_netdev_t *);
+extern void		ni_netconfig_device_hash_remove(ni_netconfig_t *, ni_netdev_t *);
 extern ni_netdev_t **	ni_netconfig_device_list_head(ni_netconfig_t *);
 extern void		ni_netconfig_modem_append(ni_netconfig_t *, ni_modem_t *);
 extern int		ni_netconfig_route_add(ni_netconfig_t *, ni_route_t *, ni_netdev_t *);
@@ -58,6 +78,9 @@ extern int		ni_netconfig_rule_add(ni_netconfig_t *, ni_rule_t *);
 extern int		ni_netconfig_rule_del(ni_netconfig_t *, const ni_rule_t *, ni_rule_t **);
 extern ni_rule_t *	ni_netconfig_rule_find(ni_netconfig_t *, const ni_rule_t *);
 extern ni_rule_array_t *ni_netconfig_rule_array(ni_netconfig_t *);
+extern ni_bool_t	ni_netconfig_route_tables_update(ni_netconfig_t *);
+extern ni_bool_t	ni_netconfig_route_table_tracked(ni_netconfig_t *, unsigned int);
+extern const ni_uint_array_t *ni_netconfig_route_tables(ni_netconfig_t *);
 
 extern ni_bool_t	ni_netconfig_set_discover_filter(ni_netconfig_t *, unsigned int);
 extern ni_bool_t	ni_netconfig_discover_filtered(ni_netconfig_t *, unsigned int);
@@ -66,6 +89,30 @@ extern unsigned int	ni_netconfig_get_family_filter(ni_netconfig_t *);
 
 extern ni_bool_t	__ni_linkinfo_kind_to_type(const char *, ni_iftype_t *);
 
+/*
+ * Memory footprint of a device by block
+ */
+enum {
+	NI_NETDEV_MEMORY_NETDEV,
+	NI_NETDEV_MEMORY_CLIENT_STATE,
+	NI_NETDEV_MEMORY_ADDRESSES,
+	NI_NETDEV_MEMORY_LEASES,
+	NI_NETDEV_MEMORY_IPV4,
+	NI_NETDEV_MEMORY_IPV6,
+	NI_NETDEV_MEMORY_IPV6_RA,
+	NI_NETDEV_MEMORY_LINK_TYPE,
+	NI_NETDEV_MEMORY_LINK_STATS,
+	NI_NETDEV_MEMORY_ETHTOOL,
+	NI_NETDEV_MEMORY_LLDP,
+	NI_NETDEV_MEMORY_DCB,
+	NI_NETDEV_MEMORY_PCI,
+
+	NI_NETDEV_MEMORY_MAX
+};
+
+extern size_t		ni_netdev_memory_usage(const ni_netdev_t *, size_t [NI_NETDEV_MEMORY_MAX]);
+extern const char *	ni_netdev_memory_block_name(unsigned int);
+
 extern void		__ni_netdev_list_append(ni_netdev_t **, ni_netdev_t *);
 extern void		__ni_netdev_list_destroy(ni_netdev_t **);
 extern ni_addrconf_lease_t *__ni_netdev_find_lease(ni_netdev_t *, unsigned int, ni_addrconf_mode_t, int);
@@ -78,6 +125,8 @@ extern void		__ni_netdev_event(ni_netconfig_t *, ni_netdev_t *, ni_event_t);
 
 extern int		__ni_ipv4_devconf_process_flags(ni_netdev_t *, int32_t *, unsigned int);
 extern int		__ni_ipv6_devconf_process_flags(ni_netdev_t *, int32_t *, unsigned int);
+extern int		__ni_ipv4_devconf_process_missing(ni_netdev_t *, unsigned int);
+extern int		__ni_ipv6_devconf_process_missing(ni_netdev_t *, unsigned int);
 
 extern void		__ni_routes_clear(ni_netconfig_t *);
 
@@ -99,6 +148,8 @@ extern int		__ni_system_interface_flush_routes(ni_netconfig_t *, ni_netdev_t *);
 extern void		__ni_system_ethernet_refresh(ni_netdev_t *);
 extern void		__ni_system_ethernet_update(ni_netdev_t *, ni_ethernet_t *);
 extern void		ni_system_ethtool_refresh(ni_netdev_t *);
+extern ni_ethtool_t *	ni_system_ethtool_get(ni_netdev_t *);
+extern void		ni_system_ethtool_refresh_all(ni_netconfig_t *);
 
 /* FIXME: These should go elsewhere, maybe runtime.h */
 extern int		__ni_system_interface_update_lease(ni_netdev_t *, ni_addrconf_lease_t **, ni_event_t);
@@ -147,8 +198,27 @@ typedef struct ni_capture_protinfo {
 
 	/* If ip_protocol is IPPROT_UDP or TCP */
 	uint16_t		ip_port;
+
+	/* Receive via mmap'ed packet ring if supported */
+	ni_bool_t		rx_ring;
+
+	/* Use one socket for all interfaces with same protinfo */
+	ni_bool_t		shared;
+
+	/* Receive via a fanout group of sockets when shared */
+	unsigned int		fanout;
 } ni_capture_protinfo_t;
 
+typedef struct ni_capture_stats {
+	unsigned int		received;	/* packets read from socket	*/
+	unsigned int		csum_valid;	/* checksum validated by nic	*/
+	unsigned int		csum_partial;	/* checksum not ready (local)	*/
+	unsigned int		csum_verified;	/* udp checksum verified by us	*/
+	unsigned int		bad_header;	/* dropped, malformed header	*/
+	unsigned int		bad_checksum;	/* dropped, checksum mismatch	*/
+	unsigned int		kernel_drops;	/* dropped by the kernel	*/
+} ni_capture_stats_t;
+
 extern void		ni_capture_devinfo_destroy(ni_capture_devinfo_t *);
 extern int		ni_capture_devinfo_init(ni_capture_devinfo_t *, const char *, const ni_linkinfo_t *);
 extern int		ni_capture_devinfo_refresh(ni_capture_devinfo_t *, const char *, const ni_linkinfo_t *);
@@ -163,12 +233,15 @@ extern void		ni_capture_disarm_retransmit(ni_capture_t *);
 extern void		ni_capture_force_retransmit(ni_capture_t *, unsigned int);
 extern void		ni_capture_free(ni_capture_t *);
 extern int		ni_capture_desc(const ni_capture_t *);
+extern ni_bool_t	ni_capture_get_stats(ni_capture_t *, ni_capture_stats_t *);
 extern int		ni_capture_build_udp_header(ni_buffer_t *,
 					struct in_addr src_addr, uint16_t src_port,
 					struct in_addr dst_addr, uint16_t dst_port);
+extern int		ni_capture_patch_udp_payload16(ni_buffer_t *, size_t, uint16_t);
 extern void		ni_capture_set_user_data(ni_capture_t *, void *);
 extern void *		ni_capture_get_user_data(const ni_capture_t *);
 extern int		ni_capture_is_valid(const ni_capture_t *, int protocol);
+extern int		ni_capture_attach_filter(ni_capture_t *, const struct sock_filter *, unsigned int);
 
 typedef struct ni_arp_socket		ni_arp_socket_t;
 
@@ -188,6 +261,8 @@ struct ni_arp_socket {
 
 	ni_arp_callback_t *		callback;
 	void *				user_data;
+
+	ni_bool_t			filtered;	/* verify set filter installed */
 };
 
 extern ni_arp_socket_t *		ni_arp_socket_open(const ni_capture_devinfo_t *,
@@ -222,6 +297,7 @@ struct ni_arp_verify {
 	struct timeval			started;
 
 	ni_arp_address_array_t		ipaddrs;
+	ni_bool_t			refilter;	/* ipaddrs changed since filter install */
 };
 
 typedef enum {
@@ -254,6 +330,7 @@ extern void				ni_arp_notify_init(ni_arp_notify_t *, const ni_config_arp_notify_
 extern void				ni_arp_notify_reset(ni_arp_notify_t *, const ni_config_arp_notify_t *);
 extern void				ni_arp_notify_destroy(ni_arp_notify_t *);
 extern unsigned int			ni_arp_notify_add_address(ni_arp_notify_t *,  ni_address_t *);
+extern ni_bool_t			ni_arp_notify_has_address(ni_arp_notify_t *,  ni_address_t *);
 extern ni_bool_t			ni_arp_notify_send(ni_arp_socket_t *, ni_arp_notify_t *, ni_timeout_t *);
 
 /* netdev reques port config */
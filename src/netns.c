@@ -0,0 +1,272 @@
+/*
+ *	Network namespace contexts
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/netinfo.h>
+
+#include "netinfo_priv.h"
+#include "util_priv.h"
+#include "appconfig.h"
+#include "sysfs.h"
+#include "netns.h"
+
+struct ni_netns {
+	char *			name;
+	int			fd;
+	dev_t			dev;
+	ino_t			ino;
+
+	ni_netlink_t *		netlink;
+	int			iocfd;
+	ni_netconfig_t *	state;
+};
+
+/*
+ * The global sockets and state, saved while a namespace is entered
+ */
+static struct {
+	ni_netns_t *		current;
+	int			fd;
+	ni_netlink_t *		netlink;
+	int			iocfd;
+	ni_netconfig_t *	state;
+} ni_netns_saved = { .current = NULL, .fd = -1 };
+
+static ni_bool_t
+ni_netns_name_valid(const char *name)
+{
+	if (ni_string_empty(name) || ni_string_eq(name, ".") || ni_string_eq(name, ".."))
+		return FALSE;
+	return strchr(name, '/') == NULL && ni_string_len(name) < NAME_MAX;
+}
+
+static ni_bool_t
+ni_netns_switch(int fd, const char *name)
+{
+	if (setns(fd, CLONE_NEWNET) < 0) {
+		ni_error("unable to switch to network namespace %s: %m", name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static int
+ni_netns_self_fd(void)
+{
+	if (ni_netns_saved.fd < 0)
+		ni_netns_saved.fd = open("/proc/self/ns/net", O_RDONLY | O_CLOEXEC);
+	return ni_netns_saved.fd;
+}
+
+ni_netns_t *
+ni_netns_open(const char *name)
+{
+	char path[PATH_MAX];
+	struct stat st;
+	ni_netns_t *ns;
+	int self;
+
+	if (!ni_netns_name_valid(name)) {
+		ni_error("invalid network namespace name '%s'", name);
+		return NULL;
+	}
+	if (ni_netns_saved.current) {
+		ni_error("unable to open network namespace %s in namespace %s",
+				name, ni_netns_saved.current->name);
+		return NULL;
+	}
+	if ((self = ni_netns_self_fd()) < 0) {
+		ni_error("unable to open the current network namespace: %m");
+		return NULL;
+	}
+
+	ns = xcalloc(1, sizeof(*ns));
+	ns->iocfd = -1;
+	ni_string_dup(&ns->name, name);
+
+	snprintf(path, sizeof(path), "%s/%s", NI_NETNS_RUN_DIR, name);
+	if ((ns->fd = open(path, O_RDONLY | O_CLOEXEC)) < 0 || fstat(ns->fd, &st) < 0) {
+		ni_error("unable to open network namespace %s: %m", name);
+		goto failed;
+	}
+	ns->dev = st.st_dev;
+	ns->ino = st.st_ino;
+
+	/* sockets belong to the namespace they've been created in */
+	if (!ni_netns_switch(ns->fd, name))
+		goto failed;
+	ns->netlink = __ni_netlink_open(0);
+	ns->iocfd = socket(PF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (!ni_netns_switch(self, "of wickedd"))
+		ni_fatal("unable to return from network namespace %s", name);
+
+	if (!ns->netlink || ns->iocfd < 0) {
+		ni_error("unable to open sockets in network namespace %s", name);
+		goto failed;
+	}
+
+	/* no external tools and no rules, they're not in the namespace */
+	ns->state = ni_netconfig_new();
+	ni_netconfig_set_discover_filter(ns->state, NI_NETCONFIG_DISCOVER_LINK_EXTERN);
+	ni_netconfig_set_discover_filter(ns->state, NI_NETCONFIG_DISCOVER_ROUTE_RULES);
+	return ns;
+
+failed:
+	ni_netns_free(ns);
+	return NULL;
+}
+
+void
+ni_netns_free(ni_netns_t *ns)
+{
+	if (!ns)
+		return;
+
+	ni_assert(ni_netns_saved.current != ns);
+	if (ns->state)
+		ni_netconfig_free(ns->state);
+	if (ns->netlink)
+		__ni_netlink_close(ns->netlink);
+	if (ns->iocfd >= 0)
+		close(ns->iocfd);
+	if (ns->fd >= 0)
+		close(ns->fd);
+	ni_string_free(&ns->name);
+	free(ns);
+}
+
+const char *
+ni_netns_name(const ni_netns_t *ns)
+{
+	return ns ? ns->name : NULL;
+}
+
+unsigned long
+ni_netns_id(const ni_netns_t *ns)
+{
+	return ns ? (unsigned long)ns->ino : 0;
+}
+
+/*
+ * Whether the name still refers to the namespace we've opened,
+ * it may have been deleted and created again in the meantime.
+ */
+ni_bool_t
+ni_netns_valid(const ni_netns_t *ns)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	if (!ns)
+		return FALSE;
+
+	snprintf(path, sizeof(path), "%s/%s", NI_NETNS_RUN_DIR, ns->name);
+	if (stat(path, &st) < 0)
+		return FALSE;
+	return st.st_dev == ns->dev && st.st_ino == ns->ino;
+}
+
+ni_netconfig_t *
+ni_netns_state(ni_netns_t *ns)
+{
+	return ns ? ns->state : NULL;
+}
+
+ni_netns_t *
+ni_netns_current(void)
+{
+	return ni_netns_saved.current;
+}
+
+ni_bool_t
+ni_netns_enter(ni_netns_t *ns)
+{
+	if (!ns || ni_netns_saved.current)
+		return FALSE;
+
+	/* for the sockets and if_nametoindex() calls opened on demand */
+	if (ni_netns_self_fd() < 0 || !ni_netns_switch(ns->fd, ns->name))
+		return FALSE;
+
+	ni_netns_saved.netlink = __ni_global_netlink;
+	ni_netns_saved.iocfd = __ni_global_iocfd;
+	ni_netns_saved.state = ni_global.state;
+	ni_netns_saved.current = ns;
+
+	__ni_global_netlink = ns->netlink;
+	__ni_global_iocfd = ns->iocfd;
+	ni_global.state = ns->state;
+	ni_sysfs_netif_set_foreign(TRUE);
+	return TRUE;
+}
+
+void
+ni_netns_leave(ni_netns_t *ns)
+{
+	if (!ns || ni_netns_saved.current != ns)
+		return;
+
+	ni_sysfs_netif_set_foreign(FALSE);
+	__ni_global_netlink = ni_netns_saved.netlink;
+	__ni_global_iocfd = ni_netns_saved.iocfd;
+	ni_global.state = ni_netns_saved.state;
+	ni_netns_saved.current = NULL;
+
+	if (!ni_netns_switch(ni_netns_saved.fd, "of wickedd"))
+		ni_fatal("unable to return from network namespace %s", ns->name);
+}
+
+/*
+ * Dump the links, addresses and routes of the namespace into its
+ * state. There is no event monitor in the namespace, so we always
+ * need a full dump and the devices gone are just released.
+ */
+int
+ni_netns_refresh(ni_netns_t *ns)
+{
+	ni_netdev_t *del_list = NULL, *dev;
+	int rv;
+
+	if (!ni_netns_enter(ns))
+		return -1;
+
+	rv = __ni_system_refresh_all(ns->state, &del_list);
+
+	ni_netns_leave(ns);
+
+	while ((dev = del_list) != NULL) {
+		del_list = dev->next;
+		dev->next = NULL;
+		ni_netdev_put(dev);
+	}
+	return rv;
+}
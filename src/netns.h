@@ -0,0 +1,54 @@
+/*
+ *	Network namespace contexts
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef   WICKED_NETNS_H
+#define   WICKED_NETNS_H
+
+#include <sys/types.h>
+#include <wicked/types.h>
+
+#ifndef NI_NETNS_RUN_DIR
+#define NI_NETNS_RUN_DIR		"/run/netns"
+#endif
+
+/*
+ * A named network namespace (as created by "ip netns add") with an
+ * own rtnetlink and ioctl socket and an own ni_netconfig_t state.
+ *
+ * While a namespace is entered, the library uses its sockets and
+ * state instead of the global ones, so the same discovery code runs
+ * in the namespace. The sysfs mounted for the initial namespace does
+ * not show its devices, so the sysfs attributes are unavailable.
+ */
+typedef struct ni_netns		ni_netns_t;
+
+extern ni_netns_t *		ni_netns_open(const char *name);
+extern void			ni_netns_free(ni_netns_t *);
+
+extern const char *		ni_netns_name(const ni_netns_t *);
+extern unsigned long		ni_netns_id(const ni_netns_t *);
+extern ni_bool_t		ni_netns_valid(const ni_netns_t *);
+extern ni_netconfig_t *		ni_netns_state(ni_netns_t *);
+
+extern ni_bool_t		ni_netns_enter(ni_netns_t *);
+extern void			ni_netns_leave(ni_netns_t *);
+extern ni_netns_t *		ni_netns_current(void);
+
+extern int			ni_netns_refresh(ni_netns_t *);
+
+#endif /* WICKED_NETNS_H */
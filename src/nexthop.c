@@ -0,0 +1,373 @@
+/*
+ *	Kernel nexthop groups of multipath routes
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/route.h>
+#include <wicked/logging.h>
+#include <wicked/time.h>
+#include <wicked/util.h>
+
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <netlink/errno.h>
+
+#include "nexthop.h"
+#include "util_priv.h"
+#include "appconfig.h"
+#include "kernel.h"
+#include "debug.h"
+
+#if defined(HAVE_LINUX_NEXTHOP_H)
+#include <linux/rtnetlink.h>
+#include <linux/nexthop.h>
+
+/*
+ * Multipath routes with the same hops share one kernel nexthop group
+ * (RTM_NEWNEXTHOP), which the routes refer to by RTA_NH_ID instead to
+ * carry the RTA_MULTIPATH hops in every route. The groups and their hop
+ * objects use ids from NI_NEXTHOP_ID_BASE and are deleted again, when
+ * none of the tracked routes refers to them any more.
+ */
+#define NI_NEXTHOP_ID_BASE		0x10000000U
+#define NI_NEXTHOP_ID_RETRY		64U
+#define NI_NEXTHOP_CHECK_DELAY		1000
+
+typedef struct ni_nexthop_group	ni_nexthop_group_t;
+struct ni_nexthop_group {
+	ni_nexthop_group_t *		next;
+	unsigned int			id;
+	unsigned int			family;
+	unsigned int			count;
+	ni_nexthop_hop_t *		hops;
+};
+
+static struct {
+	ni_nexthop_group_t *		list;
+	unsigned int			next_id;
+	ni_bool_t			unsupported;
+	const ni_timer_t *		timer;
+} ni_nexthop_groups = {
+	.list		= NULL,
+	.next_id	= NI_NEXTHOP_ID_BASE,
+	.unsupported	= FALSE,
+	.timer		= NULL,
+};
+
+static unsigned int
+ni_nexthop_id_next(void)
+{
+	unsigned int id = ni_nexthop_groups.next_id++;
+
+	if (ni_nexthop_groups.next_id < NI_NEXTHOP_ID_BASE)
+		ni_nexthop_groups.next_id = NI_NEXTHOP_ID_BASE;
+	return id;
+}
+
+static struct nl_msg *
+ni_nexthop_msg(int type, int flags, unsigned int family, unsigned int id)
+{
+	struct nhmsg nhm;
+	struct nl_msg *msg;
+
+	memset(&nhm, 0, sizeof(nhm));
+	nhm.nh_family = family;
+	nhm.nh_protocol = RTPROT_BOOT;
+
+	if (!(msg = nlmsg_alloc_simple(type, flags)))
+		return NULL;
+
+	if (nlmsg_append(msg, &nhm, sizeof(nhm), NLMSG_ALIGNTO) < 0 ||
+	    nla_put_u32(msg, NHA_ID, id) < 0) {
+		nlmsg_free(msg);
+		return NULL;
+	}
+	return msg;
+}
+
+static int
+ni_nexthop_talk(struct nl_msg *msg)
+{
+	int err;
+
+	if (!msg)
+		return -NLE_NOMEM;
+
+	err = ni_nl_talk(msg, NULL);
+	nlmsg_free(msg);
+	return err;
+}
+
+static int
+ni_nexthop_del(unsigned int id)
+{
+	return ni_nexthop_talk(ni_nexthop_msg(RTM_DELNEXTHOP, 0, AF_UNSPEC, id));
+}
+
+static struct nl_msg *
+ni_nexthop_hop_msg(unsigned int family, const ni_nexthop_hop_t *hop, unsigned int id)
+{
+	struct nl_msg *msg;
+	unsigned int offset, len;
+
+	if (!(msg = ni_nexthop_msg(RTM_NEWNEXTHOP, NLM_F_CREATE|NLM_F_EXCL, family, id)))
+		return NULL;
+
+	((struct nhmsg *)nlmsg_data(nlmsg_hdr(msg)))->nh_flags = hop->flags;
+	if (nla_put_u32(msg, NHA_OIF, hop->ifindex) < 0)
+		goto failure;
+
+	if (ni_sockaddr_is_specified(&hop->gateway)) {
+		if (!ni_af_sockaddr_info(hop->gateway.ss_family, &offset, &len) ||
+		    nla_put(msg, NHA_GATEWAY, len, ((const char *)&hop->gateway) + offset) < 0)
+			goto failure;
+	}
+	return msg;
+
+failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static struct nl_msg *
+ni_nexthop_group_msg(const ni_nexthop_group_t *group, unsigned int id)
+{
+	struct nexthop_grp *grp;
+	struct nl_msg *msg;
+	unsigned int i;
+
+	if (!(msg = ni_nexthop_msg(RTM_NEWNEXTHOP, NLM_F_CREATE|NLM_F_EXCL, AF_UNSPEC, id)))
+		return NULL;
+
+	grp = xcalloc(group->count, sizeof(*grp));
+	for (i = 0; i < group->count; ++i) {
+		grp[i].id = group->hops[i].id;
+		grp[i].weight = group->hops[i].weight ? group->hops[i].weight - 1 : 0;
+	}
+	if (nla_put(msg, NHA_GROUP, group->count * sizeof(*grp), grp) < 0) {
+		nlmsg_free(msg);
+		msg = NULL;
+	}
+	free(grp);
+	return msg;
+}
+
+/*
+ * Create a nexthop object of the message built using a free id
+ */
+static unsigned int
+ni_nexthop_create(const ni_nexthop_group_t *group, const ni_nexthop_hop_t *hop)
+{
+	unsigned int retry, id;
+	struct nl_msg *msg;
+	int err = -NLE_EXIST;
+
+	for (retry = 0; retry < NI_NEXTHOP_ID_RETRY && err == -NLE_EXIST; ++retry) {
+		id = ni_nexthop_id_next();
+		if (hop)
+			msg = ni_nexthop_hop_msg(group->family, hop, id);
+		else
+			msg = ni_nexthop_group_msg(group, id);
+
+		if ((err = ni_nexthop_talk(msg)) == 0)
+			return id;
+	}
+
+	if (err == -NLE_OPNOTSUPP || err == -NLE_INVAL || err == -NLE_AF_NOSUPPORT) {
+		ni_debug_ifconfig("kernel nexthop objects are not supported: %s",
+				nl_geterror(err));
+		ni_nexthop_groups.unsupported = TRUE;
+	} else {
+		ni_warn("unable to create kernel nexthop object: %s", nl_geterror(err));
+	}
+	return 0;
+}
+
+static void
+ni_nexthop_group_destroy(ni_nexthop_group_t *group)
+{
+	unsigned int i;
+
+	if (group->id)
+		ni_nexthop_del(group->id);
+	for (i = 0; i < group->count; ++i) {
+		if (group->hops[i].id)
+			ni_nexthop_del(group->hops[i].id);
+	}
+	free(group->hops);
+	free(group);
+}
+
+static ni_bool_t
+ni_nexthop_hop_equal(const ni_nexthop_hop_t *h1, const ni_nexthop_hop_t *h2)
+{
+	return h1->ifindex == h2->ifindex &&
+		(h1->weight ? h1->weight : 1) == (h2->weight ? h2->weight : 1) &&
+		h1->flags == h2->flags &&
+		ni_sockaddr_equal(&h1->gateway, &h2->gateway);
+}
+
+static ni_nexthop_group_t *
+ni_nexthop_group_find(unsigned int family, const ni_nexthop_hop_t *hops, unsigned int count)
+{
+	ni_nexthop_group_t *group;
+	unsigned int i;
+
+	for (group = ni_nexthop_groups.list; group; group = group->next) {
+		if (group->family != family || group->count != count)
+			continue;
+
+		for (i = 0; i < count; ++i) {
+			if (!ni_nexthop_hop_equal(&group->hops[i], &hops[i]))
+				break;
+		}
+		if (i == count)
+			return group;
+	}
+	return NULL;
+}
+
+/*
+ * Return the id of the nexthop group with the hops, creating it when
+ * needed, or 0 when the route has to be programmed with its hops.
+ */
+unsigned int
+ni_nexthop_group_get(unsigned int family, const ni_nexthop_hop_t *hops, unsigned int count)
+{
+	ni_nexthop_group_t *group;
+	unsigned int i;
+
+	if (!ni_config_nexthop_groups() || ni_nexthop_groups.unsupported || !hops || count < 2)
+		return 0;
+
+	if ((group = ni_nexthop_group_find(family, hops, count)))
+		return group->id;
+
+	for (i = 0; i < count; ++i) {
+		/* no realms (RTA_FLOW) and onlink flag only in nexthop objects */
+		if (!hops[i].ifindex || (hops[i].flags & ~RTNH_F_ONLINK))
+			return 0;
+	}
+
+	group = xcalloc(1, sizeof(*group));
+	group->family = family;
+	group->count = count;
+	group->hops = xcalloc(count, sizeof(*group->hops));
+	for (i = 0; i < count; ++i) {
+		group->hops[i] = hops[i];
+		if (!(group->hops[i].id = ni_nexthop_create(group, &group->hops[i])))
+			goto failure;
+	}
+	if (!(group->id = ni_nexthop_create(group, NULL)))
+		goto failure;
+
+	ni_debug_ifconfig("created kernel nexthop group %u with %u hops", group->id, count);
+	group->next = ni_nexthop_groups.list;
+	ni_nexthop_groups.list = group;
+
+	/* a previous group may be unused by the replaced routes now */
+	ni_nexthop_groups_check();
+	return group->id;
+
+failure:
+	ni_nexthop_group_destroy(group);
+	return 0;
+}
+
+static void
+ni_nexthop_groups_collect(void)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_uint_array_t used = NI_UINT_ARRAY_INIT;
+	ni_nexthop_group_t *group, **pos;
+	ni_route_table_t *tab;
+	ni_netdev_t *dev;
+	ni_route_t *rp;
+	unsigned int i;
+
+	if (!nc)
+		return;
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		for (tab = dev->routes; tab; tab = tab->next) {
+			for (i = 0; i < tab->routes.count; ++i) {
+				if (!(rp = tab->routes.data[i]) || !rp->nh_id)
+					continue;
+				if (!ni_uint_array_contains(&used, rp->nh_id))
+					ni_uint_array_append(&used, rp->nh_id);
+			}
+		}
+	}
+
+	for (pos = &ni_nexthop_groups.list; (group = *pos); ) {
+		if (ni_uint_array_contains(&used, group->id)) {
+			pos = &group->next;
+			continue;
+		}
+
+		ni_debug_ifconfig("deleting unused kernel nexthop group %u", group->id);
+		*pos = group->next;
+		ni_nexthop_group_destroy(group);
+	}
+	ni_uint_array_destroy(&used);
+}
+
+static void
+ni_nexthop_groups_timeout(void *user_data, const ni_timer_t *timer)
+{
+	if (ni_nexthop_groups.timer != timer)
+		return;
+
+	ni_nexthop_groups.timer = NULL;
+	ni_nexthop_groups_collect();
+}
+
+/*
+ * Schedule a check for groups without any route referring to them,
+ * e.g. after a route of a group has been deleted or replaced.
+ */
+void
+ni_nexthop_groups_check(void)
+{
+	if (!ni_nexthop_groups.list || ni_nexthop_groups.timer)
+		return;
+
+	ni_nexthop_groups.timer = ni_timer_register(NI_NEXTHOP_CHECK_DELAY,
+				ni_nexthop_groups_timeout, NULL);
+}
+
+#else
+
+unsigned int
+ni_nexthop_group_get(unsigned int family, const ni_nexthop_hop_t *hops, unsigned int count)
+{
+	return 0;
+}
+
+void
+ni_nexthop_groups_check(void)
+{
+}
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ *	Kernel nexthop groups of multipath routes
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef   WICKED_NEXTHOP_H
+#define   WICKED_NEXTHOP_H
+
+#include <wicked/types.h>
+#include <wicked/address.h>
+
+/*
+ * A resolved hop of a multipath route, as programmed in the kernel
+ */
+typedef struct ni_nexthop_hop {
+	unsigned int		id;		/* nexthop object id */
+	unsigned int		ifindex;
+	unsigned int		weight;
+	unsigned int		flags;		/* RTNH_F_*	*/
+	ni_sockaddr_t		gateway;
+} ni_nexthop_hop_t;
+
+extern unsigned int		ni_nexthop_group_get(unsigned int, const ni_nexthop_hop_t *, unsigned int);
+extern void			ni_nexthop_groups_check(void);
+
+#endif /* WICKED_NEXTHOP_H */
@@ -30,6 +30,7 @@
 #include <wicked/util.h>
 #include <wicked/netinfo.h>
 #include "ovs.h"
+#include "ovsdb.h"
 #include "buffer.h"
 #include "process.h"
 #include "util_priv.h"
@@ -170,6 +171,9 @@ ni_ovs_vsctl_bridge_exists(const char *brname)
 	ni_process_t *pi;
 	int rv = NI_PROCESS_FAILURE;
 
+	if (ni_ovsdb_available())
+		return ni_ovsdb_bridge_exists(brname);
+
 	if (ni_string_empty(brname))
 		return rv;
 
@@ -212,6 +216,9 @@ ni_ovs_vsctl_bridge_to_vlan(const char *brname, uint16_t *vlan)
 	unsigned int value;
 	char *ptr;
 
+	if (ni_ovsdb_available())
+		return ni_ovsdb_bridge_to_vlan(brname, vlan);
+
 	if (ni_string_empty(brname) || !vlan)
 		return rv;
 
@@ -274,6 +281,9 @@ ni_ovs_vsctl_bridge_to_parent(const char *brname, char **parent)
 	int rv = NI_PROCESS_FAILURE;
 	char *ptr;
 
+	if (ni_ovsdb_available())
+		return ni_ovsdb_bridge_to_parent(brname, parent);
+
 	if (ni_string_empty(brname) || !parent)
 		return rv;
 
@@ -330,6 +340,9 @@ ni_ovs_vsctl_bridge_ports(const char *brname, ni_ovs_bridge_port_array_t *ports)
 	int rv = NI_PROCESS_FAILURE;
 	int cc;
 
+	if (ni_ovsdb_available())
+		return ni_ovsdb_bridge_ports(brname, ports);
+
 	if (ni_string_empty(brname) || !ports)
 		return rv;
 
@@ -390,6 +403,9 @@ ni_ovs_vsctl_bridge_add(const ni_netdev_t *cfg, ni_bool_t may_exist)
 	ni_process_t *pi;
 	int rv = NI_PROCESS_FAILURE;
 
+	if (ni_ovsdb_available())
+		return ni_ovsdb_bridge_add(cfg, may_exist);
+
 	/* Note: seems, ovs does not check any args and
 	 * permits "anything" without to trigger errors.
 	 * Add some checks before you call this function.
@@ -444,6 +460,9 @@ ni_ovs_vsctl_bridge_del(const char *brname)
 	ni_process_t *pi;
 	int rv = NI_PROCESS_FAILURE;
 
+	if (ni_ovsdb_available())
+		return ni_ovsdb_bridge_del(brname);
+
 	if (ni_string_empty(brname))
 		return rv;
 
@@ -483,6 +502,9 @@ ni_ovs_vsctl_bridge_port_add(const char *pname, const ni_ovs_bridge_port_config_
 	ni_process_t *pi;
 	int rv = NI_PROCESS_FAILURE;
 
+	if (ni_ovsdb_available())
+		return ni_ovsdb_bridge_port_add(pname, pconf, may_exist);
+
 	if (ni_string_empty(pname) || !pconf || ni_string_empty(pconf->bridge.name))
 		return rv;
 
@@ -529,6 +551,9 @@ ni_ovs_vsctl_bridge_port_del(const char *brname, const char *pname)
 	ni_process_t *pi;
 	int rv = NI_PROCESS_FAILURE;
 
+	if (ni_ovsdb_available())
+		return ni_ovsdb_bridge_port_del(brname, pname);
+
 	if (ni_string_empty(brname) || ni_string_empty(pname))
 		return rv;
 
@@ -573,6 +598,9 @@ ni_ovs_vsctl_bridge_port_to_bridge(const char *pname, char **brname)
 	int rv = NI_PROCESS_FAILURE;
 	char *ptr;
 
+	if (ni_ovsdb_available())
+		return ni_ovsdb_bridge_port_to_bridge(pname, brname);
+
 	if (ni_string_empty(pname) || !brname)
 		return rv;
 
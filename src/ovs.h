@@ -27,6 +27,10 @@
 #include <wicked/types.h>
 #include <wicked/ovs.h>
 
+/*
+ * The ovs-vsctl command alike calls are using the native ovsdb client
+ * when the ovsdb-server socket is available and ovs-vsctl otherwise.
+ */
 extern int	ni_ovs_vsctl_bridge_add(const ni_netdev_t *, ni_bool_t);
 extern int	ni_ovs_vsctl_bridge_del(const char *);
 extern int	ni_ovs_vsctl_bridge_exists(const char *);
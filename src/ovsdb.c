@@ -0,0 +1,1042 @@
+/*
+ *	Native OVSDB JSON-RPC client of the ovs (bridge) device support
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+#include <wicked/time.h>
+
+#include "ovsdb.h"
+#include "json.h"
+#include "process.h"
+#include "util_priv.h"
+
+/*
+ * The client connects to the ovsdb-server unix socket (RFC 7047) and
+ * monitors the Open_vSwitch, Bridge and Port tables, so the queries are
+ * answered from the local table cache after all pending update messages
+ * were processed. Changes are applied in one transaction per operation,
+ * which also increments next_cfg to wait until ovs-vswitchd applied it
+ * like ovs-vsctl does.
+ * When the socket is not available, ovs.c falls back to ovs-vsctl.
+ */
+#define NI_OVSDB_DATABASE		"Open_vSwitch"
+
+typedef struct ni_ovsdb_client {
+	int			fd;
+	int64_t			seqno;
+	ni_stringbuf_t		rbuf;
+	ni_json_t *		tables;		/* { table: { uuid: row } } */
+} ni_ovsdb_client_t;
+
+typedef struct ni_ovsdb_bridge_ref {
+	ni_json_t *		row;		/* (parent) bridge row		*/
+	const char *		uuid;		/* (parent) bridge uuid		*/
+	ni_json_t *		fake;		/* fake bridge port row		*/
+	const char *		fake_uuid;	/* fake bridge port uuid	*/
+	int64_t			tag;		/* fake bridge vlan tag		*/
+} ni_ovsdb_bridge_ref_t;
+
+static const char * const	ni_ovsdb_ovs_columns[] = {
+	"bridges", "cur_cfg", "next_cfg", NULL
+};
+static const char * const	ni_ovsdb_bridge_columns[] = {
+	"name", "ports", NULL
+};
+static const char * const	ni_ovsdb_port_columns[] = {
+	"name", "tag", "fake_bridge", NULL
+};
+static const struct {
+	const char *		table;
+	const char * const *	columns;
+} ni_ovsdb_monitor_tables[] = {
+	{ "Open_vSwitch",	ni_ovsdb_ovs_columns	},
+	{ "Bridge",		ni_ovsdb_bridge_columns	},
+	{ "Port",		ni_ovsdb_port_columns	},
+	{ NULL,			NULL			}
+};
+
+static ni_ovsdb_client_t	ni_ovsdb = {
+	.fd = -1,
+	.rbuf = NI_STRINGBUF_INIT_DYNAMIC,
+};
+
+static int			ni_ovsdb_process_pending(int64_t, ni_json_t **);
+
+/*
+ * OVSDB value helpers
+ */
+static ni_bool_t
+ni_ovsdb_is_tagged(ni_json_t *value, const char *tag)
+{
+	return ni_json_array_entries(value) == 2 &&
+		ni_string_eq(ni_json_string_value(ni_json_array_get(value, 0)), tag);
+}
+
+static const char *
+ni_ovsdb_uuid_value(ni_json_t *atom)
+{
+	if (!ni_ovsdb_is_tagged(atom, "uuid"))
+		return NULL;
+	return ni_json_string_value(ni_json_array_get(atom, 1));
+}
+
+static unsigned int
+ni_ovsdb_set_entries(ni_json_t *value)
+{
+	if (ni_ovsdb_is_tagged(value, "set"))
+		return ni_json_array_entries(ni_json_array_get(value, 1));
+	return value ? 1 : 0;
+}
+
+static ni_json_t *
+ni_ovsdb_set_get(ni_json_t *value, unsigned int pos)
+{
+	if (ni_ovsdb_is_tagged(value, "set"))
+		return ni_json_array_get(ni_json_array_get(value, 1), pos);
+	return pos == 0 ? value : NULL;
+}
+
+static ni_bool_t
+ni_ovsdb_set_has_uuid(ni_json_t *value, const char *uuid)
+{
+	unsigned int i, count = ni_ovsdb_set_entries(value);
+
+	for (i = 0; i < count; ++i) {
+		if (ni_string_eq(ni_ovsdb_uuid_value(ni_ovsdb_set_get(value, i)), uuid))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static ni_json_t *
+ni_ovsdb_tagged_new(const char *tag, ni_json_t *value)
+{
+	ni_json_t *atom = ni_json_new_array();
+
+	ni_json_array_append(atom, ni_json_new_string(tag));
+	ni_json_array_append(atom, value);
+	return atom;
+}
+
+static ni_json_t *
+ni_ovsdb_uuid_new(const char *type, const char *uuid)
+{
+	return ni_ovsdb_tagged_new(type, ni_json_new_string(uuid));
+}
+
+static ni_json_t *
+ni_ovsdb_triple_new(const char *column, const char *func, ni_json_t *value)
+{
+	ni_json_t *list = ni_json_new_array();
+	ni_json_t *item = ni_json_new_array();
+
+	ni_json_array_append(item, ni_json_new_string(column));
+	ni_json_array_append(item, ni_json_new_string(func));
+	ni_json_array_append(item, value);
+	ni_json_array_append(list, item);
+	return list;
+}
+
+/*
+ * Table cache access
+ */
+static ni_json_t *
+ni_ovsdb_table(const char *table)
+{
+	return ni_json_object_get_value(ni_ovsdb.tables, table);
+}
+
+static ni_json_t *
+ni_ovsdb_row_by_uuid(const char *table, const char *uuid)
+{
+	return uuid ? ni_json_object_get_value(ni_ovsdb_table(table), uuid) : NULL;
+}
+
+static ni_json_t *
+ni_ovsdb_row_by_name(const char *table, const char *name, const char **uuid)
+{
+	ni_json_t *rows = ni_ovsdb_table(table);
+	unsigned int i, count = ni_json_object_entries(rows);
+	ni_json_pair_t *pair;
+	ni_json_t *row;
+
+	for (i = 0; i < count; ++i) {
+		pair = ni_json_object_get_pair_at(rows, i);
+		row = ni_json_pair_get_value(pair);
+		if (!ni_string_eq(ni_json_string_value(ni_json_object_get_value(row, "name")), name))
+			continue;
+		if (uuid)
+			*uuid = ni_json_pair_get_name(pair);
+		return row;
+	}
+	return NULL;
+}
+
+static const char *
+ni_ovsdb_row_name(ni_json_t *row)
+{
+	return ni_json_string_value(ni_json_object_get_value(row, "name"));
+}
+
+static int64_t
+ni_ovsdb_port_tag(ni_json_t *port)
+{
+	ni_json_t *value = ni_json_object_get_value(port, "tag");
+	int64_t tag = 0;
+
+	if (ni_ovsdb_set_entries(value) != 1 ||
+	    !ni_json_int64_get(ni_ovsdb_set_get(value, 0), &tag))
+		return 0;
+	return tag;
+}
+
+static ni_bool_t
+ni_ovsdb_port_fake(ni_json_t *port)
+{
+	ni_bool_t fake = FALSE;
+
+	return ni_json_bool_get(ni_json_object_get_value(port, "fake_bridge"), &fake) && fake;
+}
+
+static ni_json_t *
+ni_ovsdb_port_bridge(const char *port_uuid, const char **uuid)
+{
+	ni_json_t *rows = ni_ovsdb_table("Bridge");
+	unsigned int i, count = ni_json_object_entries(rows);
+	ni_json_pair_t *pair;
+	ni_json_t *row;
+
+	for (i = 0; i < count; ++i) {
+		pair = ni_json_object_get_pair_at(rows, i);
+		row = ni_json_pair_get_value(pair);
+		if (!ni_ovsdb_set_has_uuid(ni_json_object_get_value(row, "ports"), port_uuid))
+			continue;
+		if (uuid)
+			*uuid = ni_json_pair_get_name(pair);
+		return row;
+	}
+	return NULL;
+}
+
+/*
+ * As ovs-vsctl, we consider the ports of a bridge with the vlan tag
+ * of a fake bridge in this (parent) bridge as ports of the fake bridge.
+ */
+static ni_json_t *
+ni_ovsdb_bridge_fake_by_tag(ni_json_t *bridge, int64_t tag)
+{
+	ni_json_t *ports = ni_json_object_get_value(bridge, "ports");
+	unsigned int i, count = ni_ovsdb_set_entries(ports);
+	ni_json_t *port;
+
+	if (tag <= 0)
+		return NULL;
+
+	for (i = 0; i < count; ++i) {
+		port = ni_ovsdb_row_by_uuid("Port",
+				ni_ovsdb_uuid_value(ni_ovsdb_set_get(ports, i)));
+		if (port && ni_ovsdb_port_fake(port) && ni_ovsdb_port_tag(port) == tag)
+			return port;
+	}
+	return NULL;
+}
+
+static ni_bool_t
+ni_ovsdb_bridge_lookup(const char *brname, ni_ovsdb_bridge_ref_t *ref)
+{
+	memset(ref, 0, sizeof(*ref));
+
+	if ((ref->row = ni_ovsdb_row_by_name("Bridge", brname, &ref->uuid)))
+		return TRUE;
+
+	ref->fake = ni_ovsdb_row_by_name("Port", brname, &ref->fake_uuid);
+	if (!ref->fake || !ni_ovsdb_port_fake(ref->fake))
+		return FALSE;
+
+	if (!(ref->row = ni_ovsdb_port_bridge(ref->fake_uuid, &ref->uuid)))
+		return FALSE;
+
+	ref->tag = ni_ovsdb_port_tag(ref->fake);
+	return TRUE;
+}
+
+static ni_bool_t
+ni_ovsdb_bridge_owns_port(const ni_ovsdb_bridge_ref_t *ref, ni_json_t *port)
+{
+	if (ni_ovsdb_port_fake(port))
+		return FALSE;
+
+	return ni_ovsdb_bridge_fake_by_tag(ref->row, ni_ovsdb_port_tag(port)) == ref->fake;
+}
+
+static void
+ni_ovsdb_tables_update(ni_json_t *updates)
+{
+	unsigned int i, n, tcount, rcount;
+	ni_json_pair_t *tpair, *rpair;
+	ni_json_t *table, *rows, *row;
+
+	tcount = ni_json_object_entries(updates);
+	for (i = 0; i < tcount; ++i) {
+		tpair = ni_json_object_get_pair_at(updates, i);
+		rows = ni_json_pair_get_value(tpair);
+
+		if (!(table = ni_ovsdb_table(ni_json_pair_get_name(tpair)))) {
+			table = ni_json_new_object();
+			ni_json_object_set(ni_ovsdb.tables, ni_json_pair_get_name(tpair), table);
+		}
+
+		rcount = ni_json_object_entries(rows);
+		for (n = 0; n < rcount; ++n) {
+			rpair = ni_json_object_get_pair_at(rows, n);
+			row = ni_json_object_get_value(ni_json_pair_get_value(rpair), "new");
+			if (row)
+				ni_json_object_set(table, ni_json_pair_get_name(rpair), ni_json_ref(row));
+			else
+				ni_json_object_delete(table, ni_json_pair_get_name(rpair));
+		}
+	}
+}
+
+/*
+ * JSON-RPC over the stream socket
+ */
+void
+ni_ovsdb_close(void)
+{
+	if (ni_ovsdb.fd >= 0) {
+		ni_debug_ifconfig("ovsdb: closing connection to %s", NI_OVSDB_SOCKET_PATH);
+		close(ni_ovsdb.fd);
+		ni_ovsdb.fd = -1;
+	}
+	ni_stringbuf_destroy(&ni_ovsdb.rbuf);
+	ni_json_free(ni_ovsdb.tables);
+	ni_ovsdb.tables = NULL;
+}
+
+static ni_bool_t
+ni_ovsdb_send(ni_json_t *msg)
+{
+	ni_json_format_options_t options = NI_JSON_OPTIONS_INIT;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	size_t done = 0;
+	ssize_t len;
+
+	options.indent = 0;
+	if (!ni_json_format_string(&buf, msg, &options))
+		goto failure;
+
+	while (done < buf.len) {
+		len = send(ni_ovsdb.fd, buf.string + done, buf.len - done, MSG_NOSIGNAL);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			ni_error("ovsdb: unable to send message: %m");
+			goto failure;
+		}
+		done += len;
+	}
+	ni_stringbuf_destroy(&buf);
+	return TRUE;
+
+failure:
+	ni_stringbuf_destroy(&buf);
+	return FALSE;
+}
+
+/*
+ * Receive available data, waiting up to timeout msec for it;
+ * returns -1 on error and closed connection, otherwise 0.
+ */
+static int
+ni_ovsdb_recv(ni_timeout_t timeout)
+{
+	struct pollfd pfd = { .fd = ni_ovsdb.fd, .events = POLLIN };
+	char data[4096];
+	ssize_t len;
+	int ret;
+
+	ret = poll(&pfd, 1, timeout > INT_MAX ? INT_MAX : (int)timeout);
+	if (ret <= 0)
+		return ret < 0 && errno != EINTR ? -1 : 0;
+
+	len = recv(ni_ovsdb.fd, data, sizeof(data), MSG_DONTWAIT);
+	if (len < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return 0;
+		ni_error("ovsdb: unable to receive message: %m");
+		return -1;
+	}
+	if (len == 0) {
+		ni_debug_ifconfig("ovsdb: connection closed by server");
+		return -1;
+	}
+	ni_stringbuf_put(&ni_ovsdb.rbuf, data, len);
+	return 0;
+}
+
+/*
+ * The messages are sent without any separator, so find the end of
+ * the first complete json object in the receive buffer.
+ */
+static size_t
+ni_ovsdb_message_length(const char *data, size_t len)
+{
+	ni_bool_t quoted = FALSE, escaped = FALSE;
+	unsigned int depth = 0;
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		if (quoted) {
+			if (escaped)
+				escaped = FALSE;
+			else if (data[i] == '\\')
+				escaped = TRUE;
+			else if (data[i] == '"')
+				quoted = FALSE;
+			continue;
+		}
+		switch (data[i]) {
+		case '"':
+			quoted = TRUE;
+			break;
+		case '{':
+		case '[':
+			depth++;
+			break;
+		case '}':
+		case ']':
+			if (depth && --depth == 0)
+				return i + 1;
+			break;
+		default:
+			break;
+		}
+	}
+	return 0;
+}
+
+static int
+ni_ovsdb_next_message(ni_json_t **msg)
+{
+	ni_stringbuf_t *rbuf = &ni_ovsdb.rbuf;
+	size_t len;
+	char save;
+
+	if (!rbuf->len || !(len = ni_ovsdb_message_length(rbuf->string, rbuf->len)))
+		return 0;
+
+	save = rbuf->string[len];
+	rbuf->string[len] = '\0';
+	*msg = ni_json_parse_string(rbuf->string);
+	rbuf->string[len] = save;
+
+	rbuf->len -= len;
+	memmove(rbuf->string, rbuf->string + len, rbuf->len);
+	rbuf->string[rbuf->len] = '\0';
+
+	if (!*msg) {
+		ni_error("ovsdb: unable to parse received message");
+		return -1;
+	}
+	return 1;
+}
+
+static void
+ni_ovsdb_echo_reply(ni_json_t *msg)
+{
+	ni_json_t *reply = ni_json_new_object();
+
+	ni_json_object_set(reply, "id", ni_json_object_ref_value(msg, "id"));
+	ni_json_object_set(reply, "result", ni_json_object_ref_value(msg, "params"));
+	ni_json_object_set(reply, "error", ni_json_new_null());
+	ni_ovsdb_send(reply);
+	ni_json_free(reply);
+}
+
+/*
+ * Process received server request/notification messages and return
+ * the reference to the response matching the id when received.
+ */
+static int
+ni_ovsdb_process_pending(int64_t id, ni_json_t **response)
+{
+	const char *method;
+	ni_json_t *msg;
+	int64_t msgid;
+	int ret;
+
+	while ((ret = ni_ovsdb_next_message(&msg)) > 0) {
+		if ((method = ni_json_string_value(ni_json_object_get_value(msg, "method")))) {
+			if (ni_string_eq(method, "echo"))
+				ni_ovsdb_echo_reply(msg);
+			else
+			if (ni_string_eq(method, "update"))
+				ni_ovsdb_tables_update(ni_json_array_get(
+					ni_json_object_get_value(msg, "params"), 1));
+		} else
+		if (response && !*response &&
+		    ni_json_int64_get(ni_json_object_get_value(msg, "id"), &msgid) &&
+		    msgid == id) {
+			*response = ni_json_ref(msg);
+		}
+		ni_json_free(msg);
+
+		if (response && *response)
+			break;
+	}
+	return ret;
+}
+
+static ni_json_t *
+ni_ovsdb_call(const char *method, ni_json_t *params)
+{
+	ni_json_t *req, *resp = NULL, *err, *result = NULL;
+	struct timeval deadline;
+	ni_timeout_t left;
+	int64_t id;
+
+	id = ++ni_ovsdb.seqno;
+	req = ni_json_new_object();
+	ni_json_object_set(req, "method", ni_json_new_string(method));
+	ni_json_object_set(req, "params", params);
+	ni_json_object_set(req, "id", ni_json_new_int64(id));
+	if (!ni_ovsdb_send(req)) {
+		ni_json_free(req);
+		goto failure;
+	}
+	ni_json_free(req);
+
+	ni_timer_get_time(&deadline);
+	ni_timeval_add_timeout(&deadline, NI_OVSDB_CALL_TIMEOUT);
+	while (!resp) {
+		if (ni_ovsdb_process_pending(id, &resp) < 0)
+			goto failure;
+		if (resp)
+			break;
+
+		if (!(left = ni_timeout_left(&deadline, NULL, NULL))) {
+			ni_error("ovsdb: %s call timed out", method);
+			goto failure;
+		}
+		if (ni_ovsdb_recv(left) < 0)
+			goto failure;
+	}
+
+	err = ni_json_object_get_value(resp, "error");
+	if (err && !ni_json_is_null(err)) {
+		ni_error("ovsdb: %s call failed: %s", method,
+				ni_json_string_value(err) ?: "unknown error");
+	} else {
+		result = ni_json_object_ref_value(resp, "result");
+	}
+	ni_json_free(resp);
+	return result;
+
+failure:
+	ni_ovsdb_close();
+	return NULL;
+}
+
+static ni_bool_t
+ni_ovsdb_monitor_start(void)
+{
+	ni_json_t *params, *requests, *request, *columns, *result;
+	unsigned int i, n;
+
+	requests = ni_json_new_object();
+	for (i = 0; ni_ovsdb_monitor_tables[i].table; ++i) {
+		request = ni_json_new_object();
+		columns = ni_json_new_array();
+		for (n = 0; ni_ovsdb_monitor_tables[i].columns[n]; ++n) {
+			ni_json_array_append(columns, ni_json_new_string(
+					ni_ovsdb_monitor_tables[i].columns[n]));
+		}
+		ni_json_object_set(request, "columns", columns);
+		ni_json_object_set(requests, ni_ovsdb_monitor_tables[i].table, request);
+	}
+
+	params = ni_json_new_array();
+	ni_json_array_append(params, ni_json_new_string(NI_OVSDB_DATABASE));
+	ni_json_array_append(params, ni_json_new_null());
+	ni_json_array_append(params, requests);
+
+	ni_ovsdb.tables = ni_json_new_object();
+	if (!(result = ni_ovsdb_call("monitor", params)))
+		return FALSE;
+
+	ni_ovsdb_tables_update(result);
+	ni_json_free(result);
+	return TRUE;
+}
+
+static ni_bool_t
+ni_ovsdb_connect(void)
+{
+	struct sockaddr_un sun;
+
+	if (ni_ovsdb.fd >= 0)
+		return TRUE;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	strncpy(sun.sun_path, NI_OVSDB_SOCKET_PATH, sizeof(sun.sun_path) - 1);
+
+	if ((ni_ovsdb.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+		ni_error("ovsdb: unable to create unix socket: %m");
+		return FALSE;
+	}
+	if (connect(ni_ovsdb.fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+		ni_debug_ifconfig("ovsdb: unable to connect to %s: %m", NI_OVSDB_SOCKET_PATH);
+		close(ni_ovsdb.fd);
+		ni_ovsdb.fd = -1;
+		return FALSE;
+	}
+
+	ni_debug_ifconfig("ovsdb: connected to %s", NI_OVSDB_SOCKET_PATH);
+	if (!ni_ovsdb_monitor_start()) {
+		ni_ovsdb_close();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * Process the already received and pending update messages without
+ * to wait and (re)connect when needed.
+ */
+ni_bool_t
+ni_ovsdb_available(void)
+{
+	if (ni_ovsdb.fd >= 0) {
+		if (ni_ovsdb_recv(0) < 0 || ni_ovsdb_process_pending(0, NULL) < 0)
+			ni_ovsdb_close();
+		else
+			return TRUE;
+	}
+	return ni_ovsdb_connect();
+}
+
+/*
+ * Wait until ovs-vswitchd applied the configuration
+ */
+static void
+ni_ovsdb_wait_cfg(int64_t next_cfg)
+{
+	struct timeval deadline;
+	ni_json_pair_t *pair;
+	ni_timeout_t left;
+	int64_t cur_cfg;
+
+	ni_timer_get_time(&deadline);
+	ni_timeval_add_timeout(&deadline, NI_OVSDB_CFG_TIMEOUT);
+	while (ni_ovsdb.fd >= 0) {
+		if (ni_ovsdb_process_pending(0, NULL) < 0) {
+			ni_ovsdb_close();
+			return;
+		}
+
+		pair = ni_json_object_get_pair_at(ni_ovsdb_table("Open_vSwitch"), 0);
+		if (ni_json_int64_get(ni_json_object_get_value(
+				ni_json_pair_get_value(pair), "cur_cfg"), &cur_cfg) &&
+		    cur_cfg >= next_cfg)
+			return;
+
+		if (!(left = ni_timeout_left(&deadline, NULL, NULL))) {
+			ni_warn("ovsdb: timeout while waiting for ovs-vswitchd to reconfigure");
+			return;
+		}
+		if (ni_ovsdb_recv(left) < 0)
+			ni_ovsdb_close();
+	}
+}
+
+/*
+ * Transactions
+ */
+static ni_json_t *
+ni_ovsdb_txn_new(void)
+{
+	ni_json_t *txn = ni_json_new_array();
+
+	ni_json_array_append(txn, ni_json_new_string(NI_OVSDB_DATABASE));
+	return txn;
+}
+
+static ni_json_t *
+ni_ovsdb_txn_op(ni_json_t *txn, const char *op, const char *table, ni_json_t *where)
+{
+	ni_json_t *obj = ni_json_new_object();
+
+	ni_json_object_set(obj, "op", ni_json_new_string(op));
+	ni_json_object_set(obj, "table", ni_json_new_string(table));
+	if (where)
+		ni_json_object_set(obj, "where", where);
+	ni_json_array_append(txn, obj);
+	return obj;
+}
+
+static ni_json_t *
+ni_ovsdb_txn_insert(ni_json_t *txn, const char *table, const char *uuid_name)
+{
+	ni_json_t *op = ni_ovsdb_txn_op(txn, "insert", table, NULL);
+	ni_json_t *row = ni_json_new_object();
+
+	ni_json_object_set(op, "uuid-name", ni_json_new_string(uuid_name));
+	ni_json_object_set(op, "row", row);
+	return row;
+}
+
+static void
+ni_ovsdb_txn_mutate(ni_json_t *txn, const char *table, ni_json_t *where,
+			const char *column, const char *mutator, ni_json_t *value)
+{
+	ni_json_t *op = ni_ovsdb_txn_op(txn, "mutate", table, where ?: ni_json_new_array());
+
+	ni_json_object_set(op, "mutations", ni_ovsdb_triple_new(column, mutator, value));
+}
+
+static ni_json_t *
+ni_ovsdb_where_uuid(const char *uuid)
+{
+	return ni_ovsdb_triple_new("_uuid", "==", ni_ovsdb_uuid_new("uuid", uuid));
+}
+
+static void
+ni_ovsdb_txn_port_insert(ni_json_t *txn, const char *name, const char *type, int64_t tag, ni_bool_t fake)
+{
+	ni_json_t *row;
+
+	row = ni_ovsdb_txn_insert(txn, "Interface", "iface");
+	ni_json_object_set(row, "name", ni_json_new_string(name));
+	if (type)
+		ni_json_object_set(row, "type", ni_json_new_string(type));
+
+	row = ni_ovsdb_txn_insert(txn, "Port", "port");
+	ni_json_object_set(row, "name", ni_json_new_string(name));
+	ni_json_object_set(row, "interfaces", ni_ovsdb_uuid_new("named-uuid", "iface"));
+	if (tag > 0)
+		ni_json_object_set(row, "tag", ni_json_new_int64(tag));
+	if (fake)
+		ni_json_object_set(row, "fake_bridge", ni_json_new_bool(TRUE));
+}
+
+/*
+ * Commit transaction (consumed) and wait for ovs-vswitchd to apply it
+ */
+static int
+ni_ovsdb_txn_commit(ni_json_t *txn, const char *ident)
+{
+	ni_json_t *op, *result, *entry, *rows;
+	unsigned int i, count;
+	const char *error;
+	int64_t next_cfg = 0;
+	int rv = 1;
+
+	ni_ovsdb_txn_mutate(txn, "Open_vSwitch", NULL, "next_cfg", "+=", ni_json_new_int64(1));
+	op = ni_ovsdb_txn_op(txn, "select", "Open_vSwitch", ni_json_new_array());
+	ni_json_object_set(op, "columns", ni_json_new_array());
+	ni_json_array_append(ni_json_object_get_value(op, "columns"),
+			ni_json_new_string("next_cfg"));
+
+	count = ni_json_array_entries(txn) - 1;
+	if (!(result = ni_ovsdb_call("transact", txn)))
+		return NI_PROCESS_FAILURE;
+
+	for (i = 0; i < ni_json_array_entries(result); ++i) {
+		entry = ni_json_array_get(result, i);
+		if (!(error = ni_json_string_value(ni_json_object_get_value(entry, "error"))))
+			continue;
+
+		ni_error("%s: ovsdb transaction failed: %s: %s", ident, error,
+			ni_json_string_value(ni_json_object_get_value(entry, "details")) ?: "");
+		goto cleanup;
+	}
+	if (ni_json_array_entries(result) < count) {
+		ni_error("%s: ovsdb transaction incomplete", ident);
+		goto cleanup;
+	}
+
+	rows = ni_json_object_get_value(ni_json_array_get(result, count - 1), "rows");
+	ni_json_int64_get(ni_json_object_get_value(ni_json_array_get(rows, 0), "next_cfg"), &next_cfg);
+	rv = NI_PROCESS_SUCCESS;
+
+cleanup:
+	ni_json_free(result);
+	if (rv == NI_PROCESS_SUCCESS && next_cfg > 0)
+		ni_ovsdb_wait_cfg(next_cfg);
+	return rv;
+}
+
+/*
+ * ovs-vsctl alike bridge and port operations
+ */
+int
+ni_ovsdb_bridge_exists(const char *brname)
+{
+	ni_ovsdb_bridge_ref_t ref;
+
+	if (ni_string_empty(brname) || !ni_ovsdb.tables)
+		return NI_PROCESS_FAILURE;
+
+	return ni_ovsdb_bridge_lookup(brname, &ref) ? NI_PROCESS_SUCCESS : 2;
+}
+
+int
+ni_ovsdb_bridge_to_vlan(const char *brname, uint16_t *vlan)
+{
+	ni_ovsdb_bridge_ref_t ref;
+
+	if (ni_string_empty(brname) || !vlan || !ni_ovsdb.tables)
+		return NI_PROCESS_FAILURE;
+
+	if (!ni_ovsdb_bridge_lookup(brname, &ref)) {
+		ni_error("%s: unable to query bridge vlan", brname);
+		return 1;
+	}
+	*vlan = ref.tag;
+	return NI_PROCESS_SUCCESS;
+}
+
+int
+ni_ovsdb_bridge_to_parent(const char *brname, char **parent)
+{
+	ni_ovsdb_bridge_ref_t ref;
+
+	if (ni_string_empty(brname) || !parent || !ni_ovsdb.tables)
+		return NI_PROCESS_FAILURE;
+
+	if (!ni_ovsdb_bridge_lookup(brname, &ref)) {
+		ni_error("%s: unable to query bridge parent", brname);
+		return 1;
+	}
+	if (ref.fake)
+		ni_string_dup(parent, ni_ovsdb_row_name(ref.row));
+	return NI_PROCESS_SUCCESS;
+}
+
+int
+ni_ovsdb_bridge_ports(const char *brname, ni_ovs_bridge_port_array_t *ports)
+{
+	ni_ovsdb_bridge_ref_t ref;
+	unsigned int i, count;
+	ni_json_t *set, *port;
+	const char *pname;
+
+	if (ni_string_empty(brname) || !ports || !ni_ovsdb.tables)
+		return NI_PROCESS_FAILURE;
+
+	if (!ni_ovsdb_bridge_lookup(brname, &ref)) {
+		ni_error("%s: unable to query bridge ports", brname);
+		return 1;
+	}
+
+	set = ni_json_object_get_value(ref.row, "ports");
+	count = ni_ovsdb_set_entries(set);
+	for (i = 0; i < count; ++i) {
+		port = ni_ovsdb_row_by_uuid("Port", ni_ovsdb_uuid_value(ni_ovsdb_set_get(set, i)));
+		pname = ni_ovsdb_row_name(port);
+
+		/* skip the bridge local port */
+		if (!port || ni_string_eq(pname, ni_ovsdb_row_name(ref.row)))
+			continue;
+
+		if (ni_ovsdb_bridge_owns_port(&ref, port))
+			ni_ovs_bridge_port_array_add_new(ports, pname);
+	}
+	return NI_PROCESS_SUCCESS;
+}
+
+int
+ni_ovsdb_bridge_add(const ni_netdev_t *cfg, ni_bool_t may_exist)
+{
+	ni_ovsdb_bridge_ref_t ref, parent;
+	ni_json_t *txn, *row;
+	const char *pname;
+
+	if (!cfg || ni_string_empty(cfg->name) || !cfg->ovsbr || !ni_ovsdb.tables)
+		return NI_PROCESS_FAILURE;
+
+	if (ni_ovsdb_bridge_lookup(cfg->name, &ref)) {
+		if (may_exist)
+			return NI_PROCESS_SUCCESS;
+		ni_error("%s: ovs bridge already exists", cfg->name);
+		return 1;
+	}
+	if (ni_ovsdb_row_by_name("Port", cfg->name, NULL)) {
+		ni_error("%s: ovs port with the bridge name already exists", cfg->name);
+		return 1;
+	}
+
+	txn = ni_ovsdb_txn_new();
+	pname = cfg->ovsbr->config.vlan.parent.name;
+	if (ni_string_empty(pname)) {
+		ni_ovsdb_txn_port_insert(txn, cfg->name, "internal", 0, FALSE);
+
+		row = ni_ovsdb_txn_insert(txn, "Bridge", "bridge");
+		ni_json_object_set(row, "name", ni_json_new_string(cfg->name));
+		ni_json_object_set(row, "ports", ni_ovsdb_uuid_new("named-uuid", "port"));
+
+		ni_ovsdb_txn_mutate(txn, "Open_vSwitch", NULL, "bridges", "insert",
+				ni_ovsdb_uuid_new("named-uuid", "bridge"));
+	} else {
+		if (!ni_ovsdb_bridge_lookup(pname, &parent) || parent.fake) {
+			ni_error("%s: ovs parent bridge %s does not exist", cfg->name, pname);
+			ni_json_free(txn);
+			return 1;
+		}
+
+		ni_ovsdb_txn_port_insert(txn, cfg->name, "internal",
+				cfg->ovsbr->config.vlan.tag, TRUE);
+
+		ni_ovsdb_txn_mutate(txn, "Bridge", ni_ovsdb_where_uuid(parent.uuid),
+				"ports", "insert", ni_ovsdb_uuid_new("named-uuid", "port"));
+	}
+	return ni_ovsdb_txn_commit(txn, cfg->name);
+}
+
+int
+ni_ovsdb_bridge_del(const char *brname)
+{
+	ni_ovsdb_bridge_ref_t ref;
+	ni_json_t *txn, *set, *del, *port;
+	unsigned int i, count;
+	const char *uuid;
+
+	if (ni_string_empty(brname) || !ni_ovsdb.tables)
+		return NI_PROCESS_FAILURE;
+
+	if (!ni_ovsdb_bridge_lookup(brname, &ref)) {
+		ni_error("%s: no ovs bridge with this name", brname);
+		return 1;
+	}
+
+	txn = ni_ovsdb_txn_new();
+	if (!ref.fake) {
+		/* ports and interfaces are garbage collected with the bridge */
+		ni_ovsdb_txn_mutate(txn, "Open_vSwitch", NULL, "bridges", "delete",
+				ni_ovsdb_uuid_new("uuid", ref.uuid));
+	} else {
+		del = ni_json_new_array();
+		ni_json_array_append(del, ni_ovsdb_uuid_new("uuid", ref.fake_uuid));
+
+		set = ni_json_object_get_value(ref.row, "ports");
+		count = ni_ovsdb_set_entries(set);
+		for (i = 0; i < count; ++i) {
+			uuid = ni_ovsdb_uuid_value(ni_ovsdb_set_get(set, i));
+			port = ni_ovsdb_row_by_uuid("Port", uuid);
+			if (port && ni_ovsdb_bridge_owns_port(&ref, port))
+				ni_json_array_append(del, ni_ovsdb_uuid_new("uuid", uuid));
+		}
+
+		ni_ovsdb_txn_mutate(txn, "Bridge", ni_ovsdb_where_uuid(ref.uuid),
+				"ports", "delete", ni_ovsdb_tagged_new("set", del));
+	}
+	return ni_ovsdb_txn_commit(txn, brname);
+}
+
+int
+ni_ovsdb_bridge_port_add(const char *pname, const ni_ovs_bridge_port_config_t *pconf, ni_bool_t may_exist)
+{
+	ni_ovsdb_bridge_ref_t ref;
+	const char *uuid = NULL;
+	ni_json_t *txn, *port;
+
+	if (ni_string_empty(pname) || !pconf || ni_string_empty(pconf->bridge.name) ||
+	    !ni_ovsdb.tables)
+		return NI_PROCESS_FAILURE;
+
+	if (!ni_ovsdb_bridge_lookup(pconf->bridge.name, &ref)) {
+		ni_error("%s: no ovs bridge %s to add port", pname, pconf->bridge.name);
+		return 1;
+	}
+
+	if ((port = ni_ovsdb_row_by_name("Port", pname, &uuid))) {
+		if (may_exist &&
+		    ni_ovsdb_set_has_uuid(ni_json_object_get_value(ref.row, "ports"), uuid) &&
+		    ni_ovsdb_bridge_owns_port(&ref, port))
+			return NI_PROCESS_SUCCESS;
+
+		ni_error("%s: ovs port already exists", pname);
+		return 1;
+	}
+
+	txn = ni_ovsdb_txn_new();
+	ni_ovsdb_txn_port_insert(txn, pname, NULL, ref.tag, FALSE);
+	ni_ovsdb_txn_mutate(txn, "Bridge", ni_ovsdb_where_uuid(ref.uuid),
+			"ports", "insert", ni_ovsdb_uuid_new("named-uuid", "port"));
+	return ni_ovsdb_txn_commit(txn, pname);
+}
+
+int
+ni_ovsdb_bridge_port_del(const char *brname, const char *pname)
+{
+	ni_ovsdb_bridge_ref_t ref;
+	const char *uuid = NULL;
+	ni_json_t *txn, *port;
+
+	if (ni_string_empty(brname) || ni_string_empty(pname) || !ni_ovsdb.tables)
+		return NI_PROCESS_FAILURE;
+
+	port = ni_ovsdb_row_by_name("Port", pname, &uuid);
+	if (!port || !ni_ovsdb_bridge_lookup(brname, &ref) ||
+	    !ni_ovsdb_set_has_uuid(ni_json_object_get_value(ref.row, "ports"), uuid) ||
+	    !ni_ovsdb_bridge_owns_port(&ref, port)) {
+		ni_error("%s: no ovs port in bridge %s", pname, brname);
+		return 1;
+	}
+
+	txn = ni_ovsdb_txn_new();
+	ni_ovsdb_txn_mutate(txn, "Bridge", ni_ovsdb_where_uuid(ref.uuid),
+			"ports", "delete", ni_ovsdb_uuid_new("uuid", uuid));
+	return ni_ovsdb_txn_commit(txn, pname);
+}
+
+int
+ni_ovsdb_bridge_port_to_bridge(const char *pname, char **brname)
+{
+	ni_json_t *port, *bridge, *fake;
+	const char *uuid = NULL;
+
+	if (ni_string_empty(pname) || !brname || !ni_ovsdb.tables)
+		return NI_PROCESS_FAILURE;
+
+	port = ni_ovsdb_row_by_name("Port", pname, &uuid);
+	if (!port || ni_ovsdb_port_fake(port) || !(bridge = ni_ovsdb_port_bridge(uuid, NULL))) {
+		ni_error("%s: unable to query port bridge", pname);
+		return 1;
+	}
+
+	fake = ni_ovsdb_bridge_fake_by_tag(bridge, ni_ovsdb_port_tag(port));
+	ni_string_dup(brname, ni_ovsdb_row_name(fake ?: bridge));
+	return NI_PROCESS_SUCCESS;
+}
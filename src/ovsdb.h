@@ -0,0 +1,49 @@
+/*
+ *	Native OVSDB JSON-RPC client of the ovs (bridge) device support
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef NI_WICKED_OVSDB_H
+#define NI_WICKED_OVSDB_H
+
+#include <wicked/types.h>
+#include <wicked/ovs.h>
+
+#define NI_OVSDB_SOCKET_PATH		"/var/run/openvswitch/db.sock"
+#define NI_OVSDB_CALL_TIMEOUT		5000	/* msec */
+#define NI_OVSDB_CFG_TIMEOUT		5000	/* msec */
+
+/*
+ * The calls are using the same return codes as the ovs-vsctl based
+ * calls in ovs.c, that is 0 on success, a positive ovs-vsctl alike
+ * exit code (1: error, 2: bridge does not exist) or a negative
+ * process run code on failures.
+ */
+extern ni_bool_t	ni_ovsdb_available(void);
+extern void		ni_ovsdb_close(void);
+
+extern int		ni_ovsdb_bridge_exists(const char *);
+extern int		ni_ovsdb_bridge_to_vlan(const char *, uint16_t *);
+extern int		ni_ovsdb_bridge_to_parent(const char *, char **);
+extern int		ni_ovsdb_bridge_ports(const char *, ni_ovs_bridge_port_array_t *);
+extern int		ni_ovsdb_bridge_add(const ni_netdev_t *, ni_bool_t);
+extern int		ni_ovsdb_bridge_del(const char *);
+
+extern int		ni_ovsdb_bridge_port_add(const char *, const ni_ovs_bridge_port_config_t *, ni_bool_t);
+extern int		ni_ovsdb_bridge_port_del(const char *, const char *);
+extern int		ni_ovsdb_bridge_port_to_bridge(const char *, char **);
+
+#endif /* NI_WICKED_OVSDB_H */
@@ -51,6 +51,13 @@
 
 #define NI_PPPD_SERVICE_FMT		"wickedd-pppd@%s.service"
 
+/* pidfile pppd writes for the "ifname" option, 2.5 and older versions */
+static const char *		ni_pppd_pidfile_fmts[] = {
+	"/run/pppd/%s.pid",
+	"/run/%s.pid",
+	NULL
+};
+
 #define NI_PPPD_PLUGIN_PPPOE		"rp-pppoe.so"
 
 #define NI_PPPD_PRE_START		"/etc/ppp/pre-start"
@@ -691,15 +698,51 @@ ni_pppd_service_show_property(const char *ifname, const char *property, char **r
 	return ret;
 }
 
+/*
+ * Check the pidfile of the pppd started for the interface to
+ * avoid a systemctl call on each link event of ppp devices.
+ */
+static int
+ni_pppd_pidfile_running_state(const char *ifname)
+{
+	char *pidfile = NULL;
+	const char **fmt;
+	pid_t pid;
+
+	for (fmt = ni_pppd_pidfile_fmts; *fmt; ++fmt) {
+		if (!ni_string_printf(&pidfile, *fmt, ifname))
+			break;
+
+		pid = ni_pidfile_check(pidfile);
+		ni_string_free(&pidfile);
+		if (pid > 0)
+			return 1;
+	}
+	return 0;
+}
+
 static int
 ni_pppd_service_running_state(const char *ifname)
 {
+	char *filename = NULL;
 	char *state = NULL;
 	int rv = 0; /* Not running */
 
 	if (!ni_netdev_name_to_index(ifname))
 		return rv;
 
+	/* not started by us, when there is no config file */
+	if (!ni_pppd_config_file_name(&filename, ifname))
+		return -1;
+	if (!ni_file_exists(filename)) {
+		ni_string_free(&filename);
+		return rv;
+	}
+	ni_string_free(&filename);
+
+	if (ni_pppd_pidfile_running_state(ifname) > 0)
+		return 1;
+
 	if (!ni_pppd_service_show_property(ifname, "SubState", &state))
 		rv = -1; /* Error */
 	else if (ni_string_eq(state, "running"))
@@ -717,6 +760,11 @@ ni_pppd_discover(ni_netdev_t *dev, ni_netconfig_t *nc)
 	if (!dev || dev->link.type != NI_IFTYPE_PPP)
 		return -1;
 
+	/* discovered before, the config does not change while running */
+	if (dev->ppp && !ni_string_empty(dev->name) &&
+	    ni_pppd_pidfile_running_state(dev->name) > 0)
+		return 0;
+
 	if (!(ppp = ni_ppp_new()))
 		goto failure;
 
@@ -0,0 +1,63 @@
+/*
+ *	Static USDT probes of the wicked daemons
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef   WICKED_PROBES_H
+#define   WICKED_PROBES_H
+
+/*
+ * The probes are placed in the "wicked" provider and compile to a
+ * single nop instruction per site when built with <sys/sdt.h>, so
+ * they can be attached to with e.g. bpftrace on production daemons:
+ *
+ *   bpftrace -e 'usdt:/usr/sbin/wickedd:wicked:dbus_method_end
+ *		{ @[str(arg0), str(arg1)] = hist(arg2); }'
+ *
+ * Without <sys/sdt.h> (or with --disable-usdt) they are no-ops and
+ * the arguments are not evaluated.
+ *
+ * Probes and their arguments:
+ *   rtnl_event		nlmsg_type, nl_groups
+ *   rtnl_event_done	nlmsg_type, result
+ *   nl_talk_send	nlmsg_type, nlmsg_seq
+ *   nl_talk_ack	nlmsg_type, result
+ *   dbus_method_start	interface, method, object path
+ *   dbus_method_end	interface, method, success
+ *   fsm_state		ifname, previous state, new state
+ *   dhcp4_rx		ifname, message type, xid
+ *   dhcp4_tx		ifname, message type, xid
+ *   dhcp6_rx		ifname, message type, xid
+ *   dhcp6_tx		ifname, message type, xid
+ *   timer_fire		timer ident, callback, user data
+ */
+#if defined(HAVE_SYS_SDT_H)
+#include <sys/sdt.h>
+
+#define NI_PROBE(name)				DTRACE_PROBE(wicked, name)
+#define NI_PROBE1(name, a1)			DTRACE_PROBE1(wicked, name, a1)
+#define NI_PROBE2(name, a1, a2)			DTRACE_PROBE2(wicked, name, a1, a2)
+#define NI_PROBE3(name, a1, a2, a3)		DTRACE_PROBE3(wicked, name, a1, a2, a3)
+#define NI_PROBE4(name, a1, a2, a3, a4)		DTRACE_PROBE4(wicked, name, a1, a2, a3, a4)
+#else
+#define NI_PROBE(name)				do { } while (0)
+#define NI_PROBE1(name, a1)			do { } while (0)
+#define NI_PROBE2(name, a1, a2)			do { } while (0)
+#define NI_PROBE3(name, a1, a2, a3)		do { } while (0)
+#define NI_PROBE4(name, a1, a2, a3, a4)		do { } while (0)
+#endif
+
+#endif /* WICKED_PROBES_H */
@@ -26,12 +26,15 @@
 #endif
 
 #include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
 #include <sys/wait.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <errno.h>
 #include <signal.h>
+#include <string.h>
 
 #include <wicked/logging.h>
 #include <wicked/socket.h>
@@ -39,6 +42,9 @@
 #include "socket_priv.h"
 #include "process.h"
 
+/* max. number of concurrently running output capturing processes */
+#define NI_PROCESS_CONCURRENCY		8
+
 static int				__ni_process_run(ni_process_t *, int *);
 static int				__ni_process_run_info(ni_process_t *);
 static ni_socket_t *			__ni_process_get_output(ni_process_t *, int);
@@ -639,6 +645,213 @@ ni_process_run_and_capture_output(ni_process_t *pi, ni_buffer_t *out_buffer)
 	return __ni_process_run_info(pi);
 }
 
+/*
+ * Run count processes concurrently, capturing the output of each into
+ * its buffer and returning the result of each in status. At most
+ * NI_PROCESS_CONCURRENCY processes are running at the same time, the
+ * next one is started when a running one closes its output. A process
+ * with a command timeout (in seconds) still running after it is killed
+ * and reported as NI_PROCESS_TIMEOUT.
+ */
+static ni_bool_t
+__ni_process_capture_start(ni_process_t *pi, struct pollfd *pfd, int *status)
+{
+	int fds[2];
+
+	pfd->fd = -1;
+	pfd->events = POLLIN;
+
+	if (pipe(fds) < 0) {
+		ni_error("%s: unable to create pipe: %m", __func__);
+		*status = NI_PROCESS_FAILURE;
+		return FALSE;
+	}
+	if ((*status = __ni_process_run(pi, fds)) < NI_PROCESS_SUCCESS) {
+		close(fds[0]);
+		close(fds[1]);
+		return FALSE;
+	}
+	close(fds[1]);
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	pfd->fd = fds[0];
+	return TRUE;
+}
+
+void
+ni_process_run_and_capture_outputs(unsigned int count, ni_process_t **procs,
+		ni_buffer_t **bufs, int *status)
+{
+	struct pollfd *pfds;
+	struct timeval now, deadline;
+	unsigned int i, next = 0, active = 0;
+	ni_timeout_t timeout;
+	int cnt;
+
+	if (!count || !procs || !bufs || !status)
+		return;
+
+	pfds = xcalloc(count, sizeof(*pfds));
+	for (i = 0; i < count; ++i)
+		pfds[i].fd = -1;
+
+	while (active || next < count) {
+		while (next < count && active < NI_PROCESS_CONCURRENCY) {
+			if (__ni_process_capture_start(procs[next], &pfds[next], &status[next]))
+				active++;
+			next++;
+		}
+		if (!active)
+			break;
+
+		ni_timer_get_time(&now);
+
+		timeout = NI_TIMEOUT_INFINITE;
+		for (i = 0; i < next; ++i) {
+			const ni_process_t *pi = procs[i];
+
+			if (pfds[i].fd < 0 || !pi->process->timeout)
+				continue;
+
+			deadline = pi->started;
+			ni_timeval_add_timeout(&deadline, NI_TIMEOUT_FROM_SEC(pi->process->timeout));
+			if (!timercmp(&now, &deadline, <)) {
+				ni_warn("subprocess %d (%s) timed out, killing it",
+						pi->pid, pi->process->command);
+				kill(pi->pid, SIGKILL);
+				close(pfds[i].fd);
+				pfds[i].fd = -1;
+				status[i] = NI_PROCESS_TIMEOUT;
+				active--;
+				continue;
+			}
+			timeout = min_t(ni_timeout_t, timeout, ni_timeout_left(&deadline, &now, NULL));
+		}
+		if (!active)
+			continue;
+
+		if (poll(pfds, next, timeout == NI_TIMEOUT_INFINITE ? -1 : (int)timeout + 1) < 0) {
+			if (errno == EINTR)
+				continue;
+			ni_error("%s: poll error on subprocess pipes: %m", __func__);
+			break;
+		}
+
+		for (i = 0; i < next; ++i) {
+			ni_buffer_t *buf = bufs[i];
+
+			if (pfds[i].fd < 0 || !pfds[i].revents)
+				continue;
+
+			if (ni_buffer_tailroom(buf) < 256)
+				ni_buffer_ensure_tailroom(buf, 4096);
+
+			cnt = read(pfds[i].fd, ni_buffer_tail(buf), ni_buffer_tailroom(buf));
+			if (cnt > 0) {
+				buf->tail += cnt;
+				continue;
+			}
+			if (cnt < 0 && errno == EINTR)
+				continue;
+			if (cnt < 0) {
+				ni_error("read error on subprocess pipe: %m");
+				status[i] = NI_PROCESS_IOERROR;
+			}
+			close(pfds[i].fd);
+			pfds[i].fd = -1;
+			active--;
+		}
+	}
+
+	for (i = next; i < count; ++i) {
+		/* poll failure: not started at all */
+		status[i] = NI_PROCESS_FAILURE;
+	}
+
+	for (i = 0; i < next; ++i) {
+		ni_process_t *pi = procs[i];
+
+		if (pfds[i].fd >= 0) {
+			/* poll failure: don't wait for a process blocked on output */
+			kill(pi->pid, SIGKILL);
+			close(pfds[i].fd);
+			status[i] = NI_PROCESS_IOERROR;
+		}
+		if (!pi->pid || pi->status != -1)
+			continue;
+
+		while (waitpid(pi->pid, &pi->status, 0) < 0) {
+			if (errno == EINTR)
+				continue;
+			ni_error("%s: waitpid returns error (%m)", __func__);
+			status[i] = NI_PROCESS_WAITPID;
+			break;
+		}
+		if (pi->notify_callback)
+			pi->notify_callback(pi);
+
+		if (status[i] == NI_PROCESS_SUCCESS)
+			status[i] = __ni_process_run_info(pi);
+	}
+	free(pfds);
+}
+
+#if defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP) && \
+    defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP)
+/*
+ * Execute a command without an exec callback using posix_spawn, which
+ * does not copy the page tables of a (large) daemon as fork does, with
+ * the same child setup as the fork path in __ni_process_run.
+ */
+static int
+__ni_process_spawn(ni_process_t *pi, int *pfd)
+{
+	posix_spawn_file_actions_t actions;
+	char **argv, **envp;
+	unsigned int i;
+	pid_t pid;
+	int err;
+
+	if ((err = posix_spawn_file_actions_init(&actions))) {
+		ni_error("%s: unable to initialize spawn actions: %s", __func__, strerror(err));
+		return NI_PROCESS_FAILURE;
+	}
+
+	if ((err = posix_spawn_file_actions_addchdir_np(&actions, "/")) ||
+	    (err = posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0)) ||
+	    (pfd && (err = posix_spawn_file_actions_adddup2(&actions, pfd[1], 1))) ||
+	    (pfd && (err = posix_spawn_file_actions_adddup2(&actions, pfd[1], 2))) ||
+	    (err = posix_spawn_file_actions_addclosefrom_np(&actions, 3))) {
+		ni_error("%s: unable to set up spawn actions: %s", __func__, strerror(err));
+		posix_spawn_file_actions_destroy(&actions);
+		return NI_PROCESS_FAILURE;
+	}
+
+	/* NULL terminated argv and env lists */
+	argv = xcalloc(pi->argv.count + 1, sizeof(char *));
+	for (i = 0; i < pi->argv.count; ++i)
+		argv[i] = pi->argv.data[i];
+	envp = xcalloc(pi->environ.count + 1, sizeof(char *));
+	for (i = 0; i < pi->environ.count; ++i)
+		envp[i] = pi->environ.data[i];
+
+	err = posix_spawn(&pid, argv[0], &actions, NULL, argv, envp);
+	posix_spawn_file_actions_destroy(&actions);
+	free(envp);
+	free(argv);
+
+	if (err) {
+		ni_error("%s: cannot execute %s: %s", __func__, pi->argv.data[0], strerror(err));
+		return err == ENOENT || err == EACCES || err == ENOEXEC ?
+			NI_PROCESS_COMMAND : NI_PROCESS_FAILURE;
+	}
+
+	pi->pid = pid;
+	pi->status = -1;
+	ni_timer_get_time(&pi->started);
+	return NI_PROCESS_SUCCESS;
+}
+#endif
+
 int
 __ni_process_run(ni_process_t *pi, int *pfd)
 {
@@ -657,6 +870,12 @@ __ni_process_run(ni_process_t *pi, int *pfd)
 
 	signal(SIGCHLD, ni_process_sigchild);
 
+#if defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP) && \
+    defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP)
+	if (!pi->exec)
+		return __ni_process_spawn(pi, pfd);
+#endif
+
 	if ((pid = fork()) < 0) {
 		ni_error("%s: unable to fork child process: %m", __func__);
 		return NI_PROCESS_FAILURE;
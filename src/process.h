@@ -86,12 +86,15 @@ enum {
 	NI_PROCESS_WAITPID	= -4,	/* failed to retrieve child status */
 	NI_PROCESS_TERMSIG	= -5,	/* child process died with signal  */
 	NI_PROCESS_UNKNOWN	= -6,	/* unknown (post fork) failure     */
+	NI_PROCESS_TIMEOUT	= -7,	/* child killed after its timeout  */
 };
 
 extern ni_process_t *		ni_process_new(ni_shellcmd_t *);
 extern int			ni_process_run(ni_process_t *);
 extern int			ni_process_run_and_wait(ni_process_t *);
 extern int			ni_process_run_and_capture_output(ni_process_t *, ni_buffer_t *);
+extern void			ni_process_run_and_capture_outputs(unsigned int, ni_process_t **,
+						ni_buffer_t **, int *);
 extern const char *		ni_process_getenv(const ni_process_t *, const char *);
 extern ni_bool_t		ni_process_setenv(ni_process_t *, const char *,
 						const char *);
@@ -0,0 +1,190 @@
+/*
+ *	Hierarchical timing profile in collapsed stack format
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <wicked/util.h>
+#include <wicked/time.h>
+#include <wicked/logging.h>
+
+#include "profile.h"
+#include "util_priv.h"
+
+typedef struct ni_profile_node	ni_profile_node_t;
+struct ni_profile_node {
+	ni_profile_node_t *	parent;
+	ni_profile_node_t *	children;
+	ni_profile_node_t *	next;
+
+	char *			name;
+	struct timeval		entered;
+	uint64_t		usec;		/* measured, incl. children	*/
+	uint64_t		added;		/* recorded via ni_profile_add	*/
+};
+
+static ni_bool_t		ni_profile_active;
+static ni_profile_node_t	ni_profile_root;
+static ni_profile_node_t *	ni_profile_current = &ni_profile_root;
+
+void
+ni_profile_enable(void)
+{
+	ni_profile_active = TRUE;
+}
+
+ni_bool_t
+ni_profile_enabled(void)
+{
+	return ni_profile_active;
+}
+
+static ni_profile_node_t *
+ni_profile_child(ni_profile_node_t *parent, const char *name, size_t len)
+{
+	ni_profile_node_t *node, **tail;
+
+	for (tail = &parent->children; (node = *tail); tail = &node->next) {
+		if (strlen(node->name) == len && !strncmp(node->name, name, len))
+			return node;
+	}
+
+	node = xcalloc(1, sizeof(*node));
+	node->parent = parent;
+	node->name = xmalloc(len + 1);
+	memcpy(node->name, name, len);
+	node->name[len] = '\0';
+	*tail = node;
+	return node;
+}
+
+void
+ni_profile_enter(const char *name)
+{
+	ni_profile_node_t *node;
+
+	if (!ni_profile_active || ni_string_empty(name))
+		return;
+
+	node = ni_profile_child(ni_profile_current, name, strlen(name));
+	ni_timer_get_time(&node->entered);
+	ni_profile_current = node;
+}
+
+void
+ni_profile_leave(void)
+{
+	ni_profile_node_t *node = ni_profile_current;
+	struct timeval now, delta;
+
+	if (!ni_profile_active || node == &ni_profile_root)
+		return;
+
+	if (!ni_timer_get_time(&now) && timercmp(&now, &node->entered, >)) {
+		timersub(&now, &node->entered, &delta);
+		node->usec += (uint64_t)delta.tv_sec * 1000000 + delta.tv_usec;
+	}
+	ni_profile_current = node->parent;
+}
+
+/*
+ * Record time measured elsewhere (e.g. the parallel fsm worker
+ * transitions) below the current scope; the stack is a ";"
+ * separated path relative to it.
+ */
+void
+ni_profile_add(const char *stack, uint64_t usec)
+{
+	ni_profile_node_t *node = ni_profile_current;
+	const char *end;
+
+	if (!ni_profile_active || ni_string_empty(stack))
+		return;
+
+	while (*stack) {
+		if (!(end = strchr(stack, ';')))
+			end = stack + strlen(stack);
+		if (end > stack)
+			node = ni_profile_child(node, stack, end - stack);
+		stack = *end ? end + 1 : end;
+	}
+	if (node != ni_profile_current)
+		node->added += usec;
+}
+
+static void
+ni_profile_write_node(FILE *fp, const ni_profile_node_t *node, ni_stringbuf_t *stack)
+{
+	const ni_profile_node_t *child;
+	uint64_t self, children = 0;
+	size_t len = stack->len;
+
+	if (len)
+		ni_stringbuf_putc(stack, ';');
+	ni_stringbuf_puts(stack, node->name);
+
+	for (child = node->children; child; child = child->next)
+		children += child->usec;
+
+	self = node->added + (node->usec > children ? node->usec - children : 0);
+	if (self)
+		fprintf(fp, "%s %llu\n", stack->string, (unsigned long long)self);
+
+	for (child = node->children; child; child = child->next)
+		ni_profile_write_node(fp, child, stack);
+
+	ni_stringbuf_truncate(stack, len);
+}
+
+/*
+ * Leave all open scopes and write the collapsed stacks to path.
+ */
+ni_bool_t
+ni_profile_write(const char *path)
+{
+	ni_stringbuf_t stack = NI_STRINGBUF_INIT_DYNAMIC;
+	const ni_profile_node_t *node;
+	FILE *fp;
+
+	if (!ni_profile_active || ni_string_empty(path))
+		return FALSE;
+
+	while (ni_profile_current != &ni_profile_root)
+		ni_profile_leave();
+
+	if (!(fp = fopen(path, "we"))) {
+		ni_error("%s: unable to open profile: %m", path);
+		return FALSE;
+	}
+
+	for (node = ni_profile_root.children; node; node = node->next)
+		ni_profile_write_node(fp, node, &stack);
+	ni_stringbuf_destroy(&stack);
+
+	if (fclose(fp) != 0) {
+		ni_error("%s: unable to write profile: %m", path);
+		return FALSE;
+	}
+	return TRUE;
+}
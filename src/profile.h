@@ -0,0 +1,43 @@
+/*
+ *	Hierarchical timing profile in collapsed stack format
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef   WICKED_PROFILE_H
+#define   WICKED_PROFILE_H
+
+#include <wicked/types.h>
+
+/*
+ * Named scopes are entered and left in nested order and aggregated
+ * by their stack path.  The profile is written as one "a;b;c <usec>"
+ * line per path with the time spent in the scope itself (without
+ * its children), as expected by the flamegraph.pl tooling:
+ *
+ *   flamegraph.pl --countname usec wicked.profile > wicked.svg
+ *
+ * When not enabled, entering and leaving a scope is a no-op.
+ */
+extern void			ni_profile_enable(void);
+extern ni_bool_t		ni_profile_enabled(void);
+
+extern void			ni_profile_enter(const char *name);
+extern void			ni_profile_leave(void);
+extern void			ni_profile_add(const char *stack, uint64_t usec);
+
+extern ni_bool_t		ni_profile_write(const char *path);
+
+#endif /* WICKED_PROFILE_H */
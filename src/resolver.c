@@ -24,10 +24,21 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+
 #include <wicked/resolver.h>
+#include <wicked/netinfo.h>
 #include <wicked/logging.h>
 #include <ctype.h>
 
+#include "netinfo_priv.h"
+#include "update.h"
+#include "debug.h"
+
 ni_resolver_info_t *
 ni_resolver_parse_resolv_conf(const char *filename)
 {
@@ -146,3 +157,150 @@ ni_resolver_info_free(ni_resolver_info_t *resolv)
 	ni_string_array_destroy(&resolv->dns_servers);
 	free(resolv);
 }
+
+/*
+ * In-process builtins of the resolver system-updater, implementing
+ * the actions of extensions/resolver on systems without netconfig:
+ * the preferred resolv.conf.<ifname>.<type>.<family> file from the
+ * extension state directory is installed as /etc/resolv.conf.
+ */
+#define NI_RESOLVER_UPDATER_NAME	"resolver"
+
+static int
+ni_resolver_updater_cmp(const void *a, const void *b)
+{
+	return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static unsigned int
+ni_resolver_updater_scan(const char *statedir, ni_string_array_t *files)
+{
+	if (!ni_scandir(statedir, "resolv.conf.*", files))
+		return 0;
+
+	/* consider them in the glob order of the script */
+	qsort(files->data, files->count, sizeof(files->data[0]),
+			ni_resolver_updater_cmp);
+	return files->count;
+}
+
+static unsigned int
+ni_resolver_updater_preference(const char *name)
+{
+	static const struct {
+		const char *	suffix;
+		unsigned int	preference;
+	} prefs[] = {
+		/* prefer static from any interfaces, then dhcp ipv4, ipv6 */
+		{ ".static.ipv4",	3 },
+		{ ".static.ipv6",	3 },
+		{ ".dhcp.ipv4",		2 },
+		{ ".dhcp.ipv6",		1 },
+		{ NULL,			0 }
+	};
+	size_t len = ni_string_len(name), slen;
+	unsigned int i;
+
+	for (i = 0; prefs[i].suffix; ++i) {
+		slen = strlen(prefs[i].suffix);
+		if (len > slen && !strcmp(name + len - slen, prefs[i].suffix))
+			return prefs[i].preference;
+	}
+	return 0;
+}
+
+static int
+ni_resolver_updater_install_preferred(const char *newfile)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	unsigned int i, pref, preference = 0;
+	const char *statedir;
+	char *path = NULL;
+	int rc = 0;
+
+	ni_string_dup(&path, newfile);
+	if ((statedir = ni_extension_statedir(NI_RESOLVER_UPDATER_NAME))) {
+		ni_resolver_updater_scan(statedir, &files);
+		for (i = 0; i < files.count; ++i) {
+			pref = ni_resolver_updater_preference(files.data[i]);
+			if (pref <= preference)
+				continue;
+
+			preference = pref;
+			ni_string_printf(&path, "%s/%s", statedir, files.data[i]);
+		}
+		ni_string_array_destroy(&files);
+	}
+
+	if (!ni_string_empty(path) && ni_file_exists(path)) {
+		ni_debug_extension("%s updater: installing %s as %s",
+				NI_RESOLVER_UPDATER_NAME, path, NI_PATH_RESOLV_CONF);
+		if (ni_copy_file_path(path, NI_PATH_RESOLV_CONF) < 0 ||
+		    chmod(NI_PATH_RESOLV_CONF, 0644) < 0)
+			rc = 1;
+	}
+	ni_string_free(&path);
+	return rc;
+}
+
+int
+ni_resolver_updater_backup(const char *ifname, const char *type,
+			const char *family, const ni_string_array_t *args)
+{
+	return __ni_system_resolver_backup() < 0 ? 1 : 0;
+}
+
+int
+ni_resolver_updater_restore(const char *ifname, const char *type,
+			const char *family, const ni_string_array_t *args)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	const char *statedir;
+	char path[PATH_MAX];
+	unsigned int i;
+
+	if ((statedir = ni_extension_statedir(NI_RESOLVER_UPDATER_NAME))) {
+		ni_resolver_updater_scan(statedir, &files);
+		for (i = 0; i < files.count; ++i) {
+			snprintf(path, sizeof(path), "%s/%s", statedir, files.data[i]);
+			unlink(path);
+		}
+		ni_string_array_destroy(&files);
+	}
+
+	return __ni_system_resolver_restore() < 0 ? 1 : 0;
+}
+
+int
+ni_resolver_updater_install(const char *ifname, const char *type,
+			const char *family, const ni_string_array_t *args)
+{
+	return ni_resolver_updater_install_preferred(args && args->count ?
+						args->data[0] : NULL);
+}
+
+int
+ni_resolver_updater_remove(const char *ifname, const char *type,
+			const char *family, const ni_string_array_t *args)
+{
+	const char *statedir;
+	char *own = NULL;
+	int rc;
+
+	if (ni_string_empty(ifname) || ni_string_empty(type) || ni_string_empty(family))
+		return 1;
+
+	if ((statedir = ni_extension_statedir(NI_RESOLVER_UPDATER_NAME)) &&
+	    ni_string_printf(&own, "%s/resolv.conf.%s.%s.%s", statedir,
+				ifname, type, family)) {
+		unlink(own);
+		ni_string_free(&own);
+	}
+
+	/* fall back to the backup copy when no file is left */
+	ni_string_printf(&own, "%s/%s", ni_config_backupdir(),
+			ni_basename(NI_PATH_RESOLV_CONF));
+	rc = ni_resolver_updater_install_preferred(own);
+	ni_string_free(&own);
+	return rc;
+}
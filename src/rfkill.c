@@ -42,13 +42,23 @@ static ni_bool_t		ni_rfkill_state[__NI_RFKILL_TYPE_MAX];
 
 static void			__ni_rfkill_recv(ni_socket_t *);
 
+/*
+ * The kernel reports the state of all switches on open as add events,
+ * so we read them immediately; the state table is then kept updated
+ * from the change events in the main loop.
+ */
 int
 ni_rfkill_open(ni_rfkill_event_handler_t *callback, void *user_data)
 {
 	int fd;
 
-	if (ni_rfkill_socket)
+	if (ni_rfkill_socket) {
+		if (callback) {
+			ni_rfkill_callback = callback;
+			ni_rfkill_callback_data = user_data;
+		}
 		return 0;
+	}
 
 	if ((fd = open("/dev/rfkill", O_RDONLY | O_NONBLOCK)) < 0) {
 		if (errno != ENOENT)
@@ -67,6 +77,7 @@ ni_rfkill_open(ni_rfkill_event_handler_t *callback, void *user_data)
 	ni_socket_activate(ni_rfkill_socket);
 	ni_rfkill_callback = callback;
 	ni_rfkill_callback_data = user_data;
+	__ni_rfkill_recv(ni_rfkill_socket);
 	return 0;
 }
 
@@ -173,12 +184,22 @@ ni_rfkill_type_string(ni_rfkill_type_t type)
 	return "unknown";
 }
 
+/*
+ * Query the cached radio state, opening /dev/rfkill on first use.
+ */
 ni_bool_t
 ni_rfkill_disabled(ni_rfkill_type_t type)
 {
-	if (type >= __NI_RFKILL_TYPE_MAX)
+	static ni_bool_t tried;
+
+	if ((unsigned int)type >= __NI_RFKILL_TYPE_MAX)
 		return FALSE;
 
+	if (!ni_rfkill_socket && !tried) {
+		tried = TRUE;
+		ni_rfkill_open(NULL, NULL);
+	}
+
 	return ni_rfkill_state[type];
 }
 
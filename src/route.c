@@ -34,6 +34,8 @@
 #include "array_priv.h"
 #include "util_priv.h"
 #include "debug.h"
+#include "stats.h"
+#include "mempool.h"
 
 #include <stdlib.h>
 #include <limits.h>
@@ -67,6 +69,7 @@ static const ni_intmap_t	ni_route_type_names[] = {
 
 	{ NULL,			RTN_UNSPEC		},
 };
+static ni_intmap_index_t	ni_route_type_index = NI_INTMAP_INDEX_INIT(ni_route_type_names);
 
 /*
  * Names for route table
@@ -115,6 +118,7 @@ static const ni_intmap_t	ni_route_protocol_names[] = {
 
 	{ NULL,			RTPROT_UNSPEC		}
 };
+static ni_intmap_index_t	ni_route_protocol_index = NI_INTMAP_INDEX_INIT(ni_route_protocol_names);
 
 /*
  * Names for bit numbers of route [next-hop] flags and lock bits.
@@ -164,6 +168,7 @@ ni_route_init(ni_route_t *route)
 {
 	if (route) {
 		memset(route, 0, sizeof(*route));
+		ni_stats_object_alloc(NI_STATS_OBJECT_ROUTE, sizeof(*route));
 		return TRUE;
 	}
 	return FALSE;
@@ -175,12 +180,48 @@ ni_route_destroy(ni_route_t *rp)
 	ni_route_nexthop_list_destroy(&rp->nh.next);
 	ni_route_nexthop_destroy(&rp->nh);
 	memset(rp, 0, sizeof(*rp));
+	ni_stats_object_free(NI_STATS_OBJECT_ROUTE, sizeof(*rp));
+}
+
+/*
+ * Routes are allocated from a pool, as wickedd tracks all kernel routes
+ * and they are numerous in routers and bgp/ospf nodes.
+ */
+#define NI_ROUTE_POOL_CHUNK	64
+
+static ni_mempool_t		ni_route_pool = NI_MEMPOOL_INIT(ni_route_t, NI_ROUTE_POOL_CHUNK);
+
+ni_route_t *
+ni_route_new(void)
+{
+	ni_route_t *rp;
+
+	if (!(rp = ni_mempool_alloc(&ni_route_pool)))
+		return NULL;
+
+	if (!ni_route_init(rp)) {
+		ni_mempool_free(&ni_route_pool, rp);
+		return NULL;
+	}
+	if (!ni_refcount_init(&rp->refcount)) {
+		ni_route_destroy(rp);
+		ni_mempool_free(&ni_route_pool, rp);
+		return NULL;
+	}
+	return rp;
+}
+
+void
+ni_route_free(ni_route_t *rp)
+{
+	if (rp && ni_refcount_decrement(&rp->refcount)) {
+		ni_route_destroy(rp);
+		ni_mempool_free(&ni_route_pool, rp);
+	}
 }
 
-extern ni_define_refcounted_new(ni_route);
 extern ni_define_refcounted_ref(ni_route);
 extern ni_define_refcounted_hold(ni_route);
-extern ni_define_refcounted_free(ni_route);
 extern ni_define_refcounted_drop(ni_route);
 extern ni_define_refcounted_move(ni_route);
 
@@ -278,6 +319,7 @@ ni_route_copy_options(ni_route_t *rp, const ni_route_t *src)
 	C(realm);
 	C(mark);
 	C(tos);
+	C(nh_id);
 
 	C(table);
 	C(type);
@@ -942,7 +984,7 @@ ni_route_print(ni_stringbuf_t *out, const ni_route_t *rp)
 const char *
 ni_route_type_type_to_name(unsigned int type)
 {
-	return ni_format_uint_maybe_mapped(type, ni_route_type_names);
+	return ni_intmap_index_format_maybe(&ni_route_type_index, type);
 }
 
 const char *
@@ -974,7 +1016,7 @@ ni_route_scope_type_to_name(unsigned int type)
 const char *
 ni_route_protocol_type_to_name(unsigned int type)
 {
-	return ni_format_uint_maybe_mapped(type, ni_route_protocol_names);
+	return ni_intmap_index_format_maybe(&ni_route_protocol_index, type);
 }
 
 const char *
@@ -1003,7 +1045,7 @@ ni_route_type_name_to_type(const char *name, unsigned int *type)
 	if (!type || !name)
 		return FALSE;
 
-	if (ni_parse_uint_maybe_mapped(name, ni_route_type_names, &value, 10) < 0)
+	if (ni_intmap_index_parse_maybe(&ni_route_type_index, name, &value, 10) < 0)
 		return FALSE;
 
 	*type = value;
@@ -1063,7 +1105,7 @@ ni_route_protocol_name_to_type(const char *name, unsigned int *proto)
 	if (!proto || !name)
 		return FALSE;
 
-	if (ni_parse_uint_maybe_mapped(name, ni_route_protocol_names, &value, 10) < 0)
+	if (ni_intmap_index_parse_maybe(&ni_route_protocol_index, name, &value, 10) < 0)
 		return FALSE;
 
 	*proto = value;
@@ -1468,6 +1510,7 @@ ni_route_array_free(ni_route_array_t *nra)
 extern				ni_define_ptr_array_init(ni_route);
 extern				ni_define_ptr_array_destroy(ni_route);
 static				ni_define_ptr_array_realloc(ni_route, NI_ROUTE_ARRAY_CHUNK);
+extern				ni_define_ptr_array_reserve(ni_route, NI_ROUTE_ARRAY_CHUNK);
 extern				ni_define_ptr_array_append(ni_route);
 extern				ni_define_ptr_array_delete_at(ni_route);
 extern				ni_define_ptr_array_remove_at(ni_route);
@@ -1574,6 +1617,258 @@ ni_route_array_sort_rev(ni_route_array_t *nra)
 }
 
 
+/*
+ * ni_route_index: per table path-compressed binary prefix trie
+ * of the inet and inet6 routes keyed by destination/prefixlen,
+ * so finding the routes of a prefix is O(prefixlen). The trie
+ * nodes refer to the routes of the table without own reference.
+ */
+#define NI_ROUTE_INDEX_KEY_LEN		16
+
+typedef struct ni_route_index_node	ni_route_index_node_t;
+struct ni_route_index_node {
+	ni_route_index_node_t *		child[2];
+	unsigned int			plen;
+	unsigned char			key[NI_ROUTE_INDEX_KEY_LEN];
+	ni_route_array_t		routes;
+};
+
+struct ni_route_index {
+	ni_route_index_node_t *		root[2];	/* inet, inet6	*/
+	unsigned int			unindexed;
+};
+
+static ni_bool_t
+ni_route_index_key(const ni_route_t *rp, unsigned int *af, unsigned char *key)
+{
+	unsigned int i, len;
+	const unsigned char *addr;
+
+	memset(key, 0, NI_ROUTE_INDEX_KEY_LEN);
+	switch (rp->family) {
+	case AF_INET:
+		if (rp->prefixlen > 32)
+			return FALSE;
+		*af = 0;
+		len = 4;
+		addr = (const unsigned char *)&rp->destination.sin.sin_addr;
+		break;
+	case AF_INET6:
+		if (rp->prefixlen > 128)
+			return FALSE;
+		*af = 1;
+		len = 16;
+		addr = (const unsigned char *)&rp->destination.six.sin6_addr;
+		break;
+	default:
+		return FALSE;
+	}
+
+	if (!rp->prefixlen)
+		return TRUE;
+	if (rp->destination.ss_family != rp->family)
+		return FALSE;
+
+	memcpy(key, addr, len);
+	for (i = rp->prefixlen; i < len * 8; ++i)
+		key[i / 8] &= ~(0x80 >> (i % 8));
+	return TRUE;
+}
+
+static inline unsigned int
+ni_route_index_bit(const unsigned char *key, unsigned int pos)
+{
+	return (key[pos / 8] >> (7 - pos % 8)) & 1;
+}
+
+static unsigned int
+ni_route_index_common(const unsigned char *k1, const unsigned char *k2, unsigned int max)
+{
+	unsigned int pos = 0;
+	unsigned char diff;
+
+	while (pos < max) {
+		if ((diff = k1[pos / 8] ^ k2[pos / 8]) == 0) {
+			pos += 8;
+			continue;
+		}
+		while (!(diff & 0x80)) {
+			diff <<= 1;
+			pos++;
+		}
+		break;
+	}
+	return pos < max ? pos : max;
+}
+
+static ni_route_index_node_t *
+ni_route_index_node_new(const unsigned char *key, unsigned int plen)
+{
+	ni_route_index_node_t *node;
+
+	if (!(node = calloc(1, sizeof(*node))))
+		return NULL;
+
+	memcpy(node->key, key, sizeof(node->key));
+	node->plen = plen;
+	return node;
+}
+
+static void
+ni_route_index_node_free(ni_route_index_node_t *node)
+{
+	if (node) {
+		ni_route_index_node_free(node->child[0]);
+		ni_route_index_node_free(node->child[1]);
+		free(node->routes.data);
+		free(node);
+	}
+}
+
+static ni_route_index_node_t *
+ni_route_index_lookup(ni_route_index_node_t *node, const unsigned char *key, unsigned int plen)
+{
+	while (node && node->plen <= plen) {
+		if (ni_route_index_common(node->key, key, node->plen) < node->plen)
+			return NULL;
+		if (node->plen == plen)
+			return node;
+		node = node->child[ni_route_index_bit(key, node->plen)];
+	}
+	return NULL;
+}
+
+static ni_route_index_node_t *
+ni_route_index_get(ni_route_index_node_t **pos, const unsigned char *key, unsigned int plen)
+{
+	ni_route_index_node_t *node, *leaf, *glue;
+	unsigned int common;
+
+	while ((node = *pos)) {
+		common = ni_route_index_common(node->key, key,
+				min_t(unsigned int, node->plen, plen));
+		if (common < node->plen) {
+			if (!(leaf = ni_route_index_node_new(key, plen)))
+				return NULL;
+
+			if (common == plen) {
+				/* the new prefix covers the node */
+				leaf->child[ni_route_index_bit(node->key, plen)] = node;
+				*pos = leaf;
+				return leaf;
+			}
+
+			/* split at the first differing bit */
+			if (!(glue = ni_route_index_node_new(key, common))) {
+				free(leaf);
+				return NULL;
+			}
+			memset(glue->key, 0, sizeof(glue->key));
+			memcpy(glue->key, key, (common + 7) / 8);
+			if (common % 8)
+				glue->key[common / 8] &= 0xff00 >> (common % 8);
+
+			glue->child[ni_route_index_bit(key, common)] = leaf;
+			glue->child[ni_route_index_bit(node->key, common)] = node;
+			*pos = glue;
+			return leaf;
+		}
+		if (node->plen == plen)
+			return node;
+
+		pos = &node->child[ni_route_index_bit(key, node->plen)];
+	}
+	return (*pos = ni_route_index_node_new(key, plen));
+}
+
+static ni_bool_t
+ni_route_index_insert(ni_route_table_t *tab, ni_route_t *rp)
+{
+	unsigned char key[NI_ROUTE_INDEX_KEY_LEN];
+	ni_route_index_node_t *node;
+	unsigned int af;
+
+	if (!tab->index && !(tab->index = calloc(1, sizeof(*tab->index))))
+		return FALSE;
+
+	if (!ni_route_index_key(rp, &af, key)) {
+		tab->index->unindexed++;
+		return TRUE;
+	}
+
+	if (!(node = ni_route_index_get(&tab->index->root[af], key, rp->prefixlen)))
+		return FALSE;
+
+	return ni_route_array_append(&node->routes, rp);
+}
+
+static void
+ni_route_index_remove(ni_route_table_t *tab, const ni_route_t *rp)
+{
+	unsigned char key[NI_ROUTE_INDEX_KEY_LEN];
+	ni_route_index_node_t **pos, **parent = NULL, *node;
+	unsigned int af;
+
+	if (!tab->index)
+		return;
+
+	if (!ni_route_index_key(rp, &af, key)) {
+		if (tab->index->unindexed)
+			tab->index->unindexed--;
+		return;
+	}
+
+	pos = &tab->index->root[af];
+	while ((node = *pos) && node->plen < rp->prefixlen) {
+		parent = pos;
+		pos = &node->child[ni_route_index_bit(key, node->plen)];
+	}
+	if (!node || node->plen != rp->prefixlen ||
+	    ni_route_index_common(node->key, key, node->plen) < node->plen)
+		return;
+
+	ni_route_array_remove_ref(&node->routes, rp);
+	if (node->routes.count || (node->child[0] && node->child[1]))
+		return;
+
+	/* prune the node and a then needless glue parent */
+	*pos = node->child[0] ? node->child[0] : node->child[1];
+	node->child[0] = node->child[1] = NULL;
+	ni_route_index_node_free(node);
+
+	if (parent && (node = *parent) && !node->routes.count &&
+	    !(node->child[0] && node->child[1])) {
+		*parent = node->child[0] ? node->child[0] : node->child[1];
+		node->child[0] = node->child[1] = NULL;
+		ni_route_index_node_free(node);
+	}
+}
+
+static void
+ni_route_index_free(ni_route_index_t *index)
+{
+	if (index) {
+		ni_route_index_node_free(index->root[0]);
+		ni_route_index_node_free(index->root[1]);
+		free(index);
+	}
+}
+
+static ni_route_t *
+ni_route_index_find_match(ni_route_table_t *tab, const ni_route_t *rp,
+		ni_bool_t (*match)(const ni_route_t *, const ni_route_t *))
+{
+	unsigned char key[NI_ROUTE_INDEX_KEY_LEN];
+	ni_route_index_node_t *node;
+	unsigned int af;
+
+	if (!tab->index || tab->index->unindexed || !ni_route_index_key(rp, &af, key))
+		return ni_route_array_find_match(&tab->routes, rp, match);
+
+	node = ni_route_index_lookup(tab->index->root[af], key, rp->prefixlen);
+	return node ? ni_route_array_find_match(&node->routes, rp, match) : NULL;
+}
+
 /*
  * ni_route_table functions
  */
@@ -1609,10 +1904,24 @@ void
 ni_route_table_clear(ni_route_table_t *tab)
 {
 	if (tab) {
+		ni_route_index_free(tab->index);
+		tab->index = NULL;
 		ni_route_array_destroy(&tab->routes);
 	}
 }
 
+ni_route_t *
+ni_route_table_remove_at(ni_route_table_t *tab, unsigned int index)
+{
+	ni_route_t *rp;
+
+	if (!tab || !(rp = ni_route_array_remove_at(&tab->routes, index)))
+		return NULL;
+
+	ni_route_index_remove(tab, rp);
+	return rp;
+}
+
 /*
  * ni_route_tables list functions
  */
@@ -1644,9 +1953,17 @@ ni_route_tables_add_route(ni_route_table_t **list, ni_route_t *rp)
 {
 	ni_route_table_t *tab;
 
-	if (rp && (tab = ni_route_tables_get(list, rp->table)))
-		return ni_route_array_append(&tab->routes, rp);
-	return FALSE;
+	if (!rp || !(tab = ni_route_tables_get(list, rp->table)))
+		return FALSE;
+
+	if (!ni_route_index_insert(tab, rp))
+		return FALSE;
+
+	if (!ni_route_array_append(&tab->routes, rp)) {
+		ni_route_index_remove(tab, rp);
+		return FALSE;
+	}
+	return TRUE;
 }
 
 ni_bool_t
@@ -1673,7 +1990,12 @@ ni_route_tables_del_route(ni_route_table_t *list, ni_route_t *rp)
 	if (!rp || !(tab = ni_route_tables_find(list, rp->table)))
 		return FALSE;
 
-	return ni_route_array_delete_ref(&tab->routes, rp);
+	if (!(rp = ni_route_array_remove_ref(&tab->routes, rp)))
+		return FALSE;
+
+	ni_route_index_remove(tab, rp);
+	ni_route_free(rp);
+	return TRUE;
 }
 
 ni_route_t *
@@ -1687,6 +2009,22 @@ ni_route_tables_find_match(ni_route_table_t *list, const ni_route_t *rp,
 	return ni_route_array_find_match(&tab->routes, rp, match);
 }
 
+/*
+ * Like ni_route_tables_find_match, but using the prefix index. The
+ * match function has to match routes with the same destination and
+ * prefixlen only, as e.g. ni_route_equal and ni_route_equal_ref do.
+ */
+ni_route_t *
+ni_route_tables_find_prefix_match(ni_route_table_t *list, const ni_route_t *rp,
+		ni_bool_t (*match)(const ni_route_t *, const ni_route_t *))
+{
+	ni_route_table_t *tab;
+
+	if (!rp || !match || !(tab = ni_route_tables_find(list, rp->table)))
+		return NULL;
+	return ni_route_index_find_match(tab, rp, match);
+}
+
 unsigned int
 ni_route_tables_find_matches(ni_route_table_t *list, const ni_route_t *rp,
 		ni_bool_t (*match)(const ni_route_t *, const ni_route_t *),
@@ -1968,14 +2306,16 @@ ni_bool_t
 ni_rule_equal(const ni_rule_t *r1, const ni_rule_t *r2)
 {
 #ifdef NI_RULE_TRACE_CMP_LEVEL
-	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
+	if (ni_debug_guard(NI_RULE_TRACE_CMP_LEVEL, NI_TRACE_IFCONFIG)) {
+		ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
 
-	ni_rule_print(&out, r1);
-	ni_stringbuf_puts(&out, ") =?= (");
-	ni_rule_print(&out, r2);
-	ni_debug_verbose(NI_RULE_TRACE_CMP_LEVEL, NI_TRACE_IFCONFIG,
-			"rule cmp (%s)", out.string);
-	ni_stringbuf_destroy(&out);
+		ni_rule_print(&out, r1);
+		ni_stringbuf_puts(&out, ") =?= (");
+		ni_rule_print(&out, r2);
+		ni_debug_verbose(NI_RULE_TRACE_CMP_LEVEL, NI_TRACE_IFCONFIG,
+				"rule cmp (%s)", out.string);
+		ni_stringbuf_destroy(&out);
+	}
 #endif
 
 	return ni_rule_cmp(r1, r2) == 0;
@@ -2208,6 +2548,7 @@ ni_rule_array_copy(ni_rule_array_t *dst, const ni_rule_array_t *src)
 	if (!src || !dst)
 		return;
 
+	ni_rule_array_reserve(dst, src->count);
 	for (i = 0; i < src->count; ++i)
 		ni_rule_array_append(dst, ni_rule_clone(src->data[i]));
 }
@@ -2216,6 +2557,7 @@ extern ni_define_ptr_array_init(ni_rule);
 extern ni_define_ptr_array_destroy(ni_rule);
 extern ni_define_ptr_array_index(ni_rule);
 static ni_define_ptr_array_realloc(ni_rule, NI_RULE_ARRAY_CHUNK);
+extern ni_define_ptr_array_reserve(ni_rule, NI_RULE_ARRAY_CHUNK);
 extern ni_define_ptr_array_append(ni_rule);
 extern ni_define_ptr_array_insert(ni_rule);
 extern ni_define_ptr_array_delete_at(ni_rule);
@@ -31,6 +31,7 @@ ni_secret_db_free(ni_secret_db_t *db)
 
 	while ((sec = db->list) != NULL) {
 		db->list = sec->next;
+		sec->prev = NULL;
 		ni_secret_put(sec);
 	}
 
@@ -38,18 +39,29 @@ ni_secret_db_free(ni_secret_db_t *db)
 }
 
 /*
- * Find a secret in the DB
+ * The secrets are kept in buckets keyed by the security id class and
+ * the path, which both have to match exactly; only the attributes of
+ * the id are matched by a subset check.
  */
+static unsigned int
+__ni_secret_db_key(const ni_security_id_t *id, const char *path)
+{
+	return ni_string_hash(id->class) * 31 + ni_string_hash(path);
+}
+
 static ni_secret_t *
 __ni_secret_db_find(ni_secret_db_t *db, const ni_security_id_t *id, const char *path)
 {
 	ni_secret_t *sec;
+	unsigned int key;
 
 	if (id == NULL)
 		return NULL;
 
-	for (sec = db->list; sec; sec = sec->next) {
-		if (ni_security_id_greater_equal(&sec->id, id)
+	key = __ni_secret_db_key(id, path);
+	for (sec = db->hash[key % NI_SECRET_DB_BUCKETS]; sec; sec = sec->hnext) {
+		if (sec->hkey == key
+		 && ni_security_id_greater_equal(&sec->id, id)
 		 && ni_string_eq(sec->path, path))
 			return sec;
 	}
@@ -68,6 +80,21 @@ __ni_secret_append(ni_secret_t **pos, ni_secret_t *sec)
 	*pos = sec;
 }
 
+static ni_secret_t *
+__ni_secret_db_add(ni_secret_db_t *db, const ni_security_id_t *id, const char *path)
+{
+	ni_secret_t *sec, **bucket;
+
+	sec = ni_secret_new(id, path);
+	sec->hkey = __ni_secret_db_key(id, path);
+	__ni_secret_append(&db->list, sec);
+
+	bucket = &db->hash[sec->hkey % NI_SECRET_DB_BUCKETS];
+	sec->hnext = *bucket;
+	*bucket = sec;
+	return sec;
+}
+
 /*
  * Find a secret in the DB
  */
@@ -77,6 +104,23 @@ ni_secret_db_find(ni_secret_db_t *db, const ni_security_id_t *id, const char *pa
 	return __ni_secret_db_find(db, id, path);
 }
 
+/*
+ * Find a secret or record it as requested without a value, so all
+ * the secrets a device waits for can be supplied at once.
+ */
+ni_secret_t *
+ni_secret_db_request(ni_secret_db_t *db, const ni_security_id_t *id, const char *path)
+{
+	ni_secret_t *sec;
+
+	if (id == NULL)
+		return NULL;
+
+	if ((sec = __ni_secret_db_find(db, id, path)) == NULL)
+		sec = __ni_secret_db_add(db, id, path);
+	return sec;
+}
+
 void
 ni_secret_db_drop(ni_secret_db_t *db, const ni_security_id_t *id, const char *path)
 {
@@ -97,10 +141,8 @@ ni_secret_db_update(ni_secret_db_t *db, const ni_security_id_t *id, const char *
 {
 	ni_secret_t *sec;
 
-	if ((sec = __ni_secret_db_find(db, id, path)) == NULL) {
-		sec = ni_secret_new(id, path);
-		__ni_secret_append(&db->list, sec);
-	}
+	if ((sec = __ni_secret_db_find(db, id, path)) == NULL)
+		sec = __ni_secret_db_add(db, id, path);
 
 	if (!ni_string_eq(sec->value, value)) {
 		ni_string_dup(&sec->value, value);
@@ -119,6 +161,7 @@ ni_secret_new(const ni_security_id_t *id, const char *path)
 	ni_secret_t *sec;
 
 	sec = xcalloc(1, sizeof(*sec));
+	sec->refcount = 1;
 	ni_security_id_set(&sec->id, id);
 	ni_string_dup(&sec->path, path);
 	return sec;
@@ -133,6 +176,7 @@ ni_secret_free(ni_secret_t *sec)
 	ni_security_id_destroy(&sec->id);
 	ni_string_free(&sec->path);
 	ni_string_free(&sec->value);
+	free(sec);
 }
 
 ni_secret_t *
@@ -163,7 +207,7 @@ ni_secret_array_append(ni_secret_array_t *array, ni_secret_t *sec)
 		return;
 
 	array->data = xrealloc(array->data, (array->count + 1) * sizeof(sec));
-	array->data[array->count + 1] = ni_secret_get(sec);
+	array->data[array->count++] = ni_secret_get(sec);
 }
 
 void
@@ -12,6 +12,9 @@
 #include <sys/time.h>
 #include <sys/poll.h>
 #include <sys/un.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 #include <signal.h>
 #include <string.h>
 #include <stdlib.h>
@@ -27,7 +30,9 @@
 #include <wicked/socket.h>
 #include "netinfo_priv.h"
 #include "socket_priv.h"
+#include "array_priv.h"
 #include "appconfig.h"
+#include "stats.h"
 
 #define	NI_SOCKET_ARRAY_CHUNK	16
 
@@ -102,10 +107,88 @@ __ni_default_hangup_handler(ni_socket_t *sock)
 
 
 /*
- * Wait for incoming data on any of the sockets.
+ * Compute the poll timeout from the wait timeout and the
+ * earliest socket timeout.
  */
-int
-ni_socket_array_wait(ni_socket_array_t *array, ni_timeout_t timeout)
+static int
+__ni_socket_array_poll_timeout(ni_timeout_t timeout, const struct timeval *expires)
+{
+	struct timeval now;
+	int ptimeout = -1;
+
+	ni_timer_get_time(&now);
+	if (timeout < NI_TIMEOUT_INFINITE)
+		ptimeout = timeout < INT_MAX ? (int)timeout : INT_MAX;
+	if (timerisset(expires)) {
+		ni_timeout_t delta = ni_timeout_left(expires, &now, NULL);
+
+		if (ptimeout < 0) {
+			if (delta < (ni_timeout_t)INT_MAX)
+				ptimeout = (int)delta;
+		} else {
+			if (delta < (ni_timeout_t)ptimeout)
+				ptimeout = (int)delta;
+		}
+	}
+	return ptimeout;
+}
+
+static void
+__ni_socket_get_timeout(const ni_socket_t *sock, struct timeval *expires)
+{
+	struct timeval socket_expires;
+
+	timerclear(&socket_expires);
+	if (sock->get_timeout && sock->get_timeout(sock, &socket_expires) == 0) {
+		if (!timerisset(expires) || timercmp(&socket_expires, expires, <))
+			*expires = socket_expires;
+	}
+}
+
+/*
+ * Dispatch the poll events reported for a socket
+ */
+static void
+__ni_socket_dispatch(ni_socket_t *sock, int revents)
+{
+	if (revents & POLLERR) {
+		/* Deactivate socket */
+		ni_socket_deactivate(sock);
+		sock->handle_error(sock);
+		return;
+	}
+
+	if (revents & POLLIN) {
+		if (sock->receive == NULL) {
+			ni_error("socket %d has no receive callback", sock->__fd);
+			ni_socket_deactivate(sock);
+		} else {
+			sock->receive(sock);
+		}
+		if (sock->__fd < 0)
+			return;
+	}
+
+	if (revents & POLLHUP) {
+		if (sock->handle_hangup)
+			sock->handle_hangup(sock);
+	} else
+
+	if (revents & POLLOUT) {
+		if (sock->transmit == NULL) {
+			ni_error("socket %d has no transmit callback", sock->__fd);
+			ni_socket_deactivate(sock);
+		} else {
+			sock->transmit(sock);
+		}
+	}
+}
+
+/*
+ * Wait for incoming data on any of the sockets using poll.
+ */
+static int
+__ni_socket_array_poll_wait(ni_socket_array_t *array, ni_timeout_t timeout)
 {
 	struct pollfd pfd[array->count];
 	ni_socket_t *sock_array[array->count];
@@ -118,7 +201,6 @@ ni_socket_array_wait(ni_socket_array_t *array, ni_timeout_t timeout)
 	timerclear(&expires);
 	for (i = 0; i < array->count; ++i) {
 		ni_socket_t *sock = array->data[i];
-		struct timeval socket_expires;
 
 		if (sock->active != array)
 			continue;
@@ -128,27 +210,10 @@ ni_socket_array_wait(ni_socket_array_t *array, ni_timeout_t timeout)
 		sock_array[socket_count] = ni_socket_hold(sock);
 		socket_count++;
 
-		timerclear(&socket_expires);
-		if (sock->get_timeout && sock->get_timeout(sock, &socket_expires) == 0) {
-			if (!timerisset(&expires) || timercmp(&socket_expires, &expires, <))
-				expires = socket_expires;
-		}
+		__ni_socket_get_timeout(sock, &expires);
 	}
 
-	ni_timer_get_time(&now);
-	if (timeout < NI_TIMEOUT_INFINITE)
-		ptimeout = timeout < INT_MAX ? (int)timeout : INT_MAX;
-	if (timerisset(&expires)) {
-		ni_timeout_t delta = ni_timeout_left(&expires, &now, NULL);
-
-		if (ptimeout < 0) {
-			if (delta < (ni_timeout_t)INT_MAX)
-				ptimeout = (int)delta;
-		} else {
-			if (delta < (ni_timeout_t)ptimeout)
-				ptimeout = (int)delta;
-		}
-	}
+	ptimeout = __ni_socket_array_poll_timeout(timeout, &expires);
 
 	if (socket_count == 0 && ptimeout < 0) {
 		ni_debug_socket("no sockets left to watch");
@@ -173,39 +238,7 @@ ni_socket_array_wait(ni_socket_array_t *array, ni_timeout_t timeout)
 		if (pfd[i].fd != sock->__fd)
 			continue;
 
-		if (pfd[i].revents & POLLERR) {
-			/* Deactivate socket */
-			ni_socket_deactivate(sock);
-			sock->handle_error(sock);
-			continue;
-		}
-
-		if (pfd[i].revents & POLLIN) {
-			if (sock->receive == NULL) {
-				ni_error("socket %d has no receive callback", sock->__fd);
-				ni_socket_deactivate(sock);
-			} else {
-				sock->receive(sock);
-			}
-			if (sock->__fd < 0)
-				continue;
-		}
-
-		if (pfd[i].revents & POLLHUP) {
-			if (sock->handle_hangup)
-				sock->handle_hangup(sock);
-			if (sock->__fd < 0)
-				continue;
-		} else
-
-		if (pfd[i].revents & POLLOUT) {
-			if (sock->transmit == NULL) {
-				ni_error("socket %d has no transmit callback", sock->__fd);
-				ni_socket_deactivate(sock);
-			} else {
-				sock->transmit(sock);
-			}
-		}
+		__ni_socket_dispatch(sock, pfd[i].revents);
 	}
 
 	ni_timer_get_time(&now);
@@ -226,9 +259,218 @@ out:
 	return retval;
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * The sockets stay registered in the epoll set while they are
+ * active. We use level triggered notification, so the receive
+ * and transmit callbacks don't need to drain the socket, which
+ * is how all of them are written.
+ */
+#define NI_SOCKET_EPOLL_EVENTS	64
+
+static inline uint32_t
+__ni_socket_poll_to_epoll(int poll_flags)
+{
+	uint32_t events = 0;
+
+	if (poll_flags & POLLIN)
+		events |= EPOLLIN;
+	if (poll_flags & POLLOUT)
+		events |= EPOLLOUT;
+	if (poll_flags & POLLPRI)
+		events |= EPOLLPRI;
+	return events;
+}
+
+static inline int
+__ni_socket_epoll_to_poll(uint32_t events)
+{
+	int revents = 0;
+
+	if (events & EPOLLIN)
+		revents |= POLLIN;
+	if (events & EPOLLOUT)
+		revents |= POLLOUT;
+	if (events & EPOLLPRI)
+		revents |= POLLPRI;
+	if (events & EPOLLERR)
+		revents |= POLLERR;
+	if (events & EPOLLHUP)
+		revents |= POLLHUP;
+	return revents;
+}
+
+static ni_bool_t
+__ni_socket_epoll_register(ni_socket_array_t *array, ni_socket_t *sock)
+{
+	struct epoll_event ev;
+	int op;
+
+	if (array->epfd < 0 || sock->__fd < 0)
+		return FALSE;
+
+	if (sock->epoll && sock->epoll_flags == sock->poll_flags)
+		return TRUE;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = __ni_socket_poll_to_epoll(sock->poll_flags);
+	ev.data.ptr = sock;
+
+	op = sock->epoll ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	if (epoll_ctl(array->epfd, op, sock->__fd, &ev) < 0) {
+		ni_debug_socket("unable to register socket %d in epoll set: %m",
+				sock->__fd);
+		sock->epoll = 0;
+		return FALSE;
+	}
+
+	sock->epoll = 1;
+	sock->epoll_flags = sock->poll_flags;
+	return TRUE;
+}
+
+static void
+__ni_socket_epoll_unregister(ni_socket_array_t *array, ni_socket_t *sock)
+{
+	if (!sock->epoll)
+		return;
+
+	/* a closed fd has been removed from the set by the kernel */
+	if (array->epfd >= 0 && sock->__fd >= 0)
+		epoll_ctl(array->epfd, EPOLL_CTL_DEL, sock->__fd, NULL);
+
+	sock->epoll = 0;
+	sock->epoll_flags = 0;
+}
+
+/*
+ * Wait for incoming data on any of the sockets using epoll.
+ */
+static int
+__ni_socket_array_epoll_wait(ni_socket_array_t *array, ni_timeout_t timeout)
+{
+	struct epoll_event events[NI_SOCKET_EPOLL_EVENTS];
+	ni_socket_t *ready[NI_SOCKET_EPOLL_EVENTS];
+	ni_socket_t *timed[array->count];
+	struct timeval now, expires;
+	unsigned int i, watched = 0, timed_count = 0;
+	int ptimeout, nready;
+	int retval = 0;
+
+	/*
+	 * Sync changed poll flags (e.g. dbus watch toggles POLLOUT)
+	 * and collect socket timeouts; no syscall unless changed.
+	 */
+	timerclear(&expires);
+	for (i = 0; i < array->count; ++i) {
+		ni_socket_t *sock = array->data[i];
+
+		if (sock->active != array)
+			continue;
+
+		if (__ni_socket_epoll_register(array, sock))
+			watched++;
+
+		__ni_socket_get_timeout(sock, &expires);
+	}
+
+	ptimeout = __ni_socket_array_poll_timeout(timeout, &expires);
+
+	if (watched == 0 && ptimeout < 0) {
+		ni_debug_socket("no sockets left to watch");
+		return 1;
+	}
+
+	nready = epoll_wait(array->epfd, events, NI_SOCKET_EPOLL_EVENTS, ptimeout);
+	if (nready < 0) {
+		if (errno == EINTR)
+			return 0;
+		ni_error("epoll_wait returns error: %m");
+		return -1;
+	}
+
+	/* Hold all ready sockets, a callback may close any of them */
+	for (i = 0; i < (unsigned int)nready; ++i)
+		ready[i] = ni_socket_hold(events[i].data.ptr);
+
+	for (i = 0; i < (unsigned int)nready; ++i) {
+		ni_socket_t *sock = ready[i];
+
+		if (sock->active != array || sock->__fd < 0)
+			continue;
+
+		__ni_socket_dispatch(sock, __ni_socket_epoll_to_poll(events[i].events));
+	}
+
+	for (i = 0; i < (unsigned int)nready; ++i)
+		ni_socket_release(ready[i]);
+
+	/* Check timeouts of the sockets implementing it */
+	for (i = 0; i < array->count && timed_count < array->count; ++i) {
+		ni_socket_t *sock = array->data[i];
+
+		if (sock->active == array && sock->check_timeout)
+			timed[timed_count++] = ni_socket_hold(sock);
+	}
+
+	ni_timer_get_time(&now);
+	for (i = 0; i < timed_count; ++i) {
+		ni_socket_t *sock = timed[i];
+
+		if (sock->active == array)
+			sock->check_timeout(sock, &now);
+	}
+
+	for (i = 0; i < timed_count; ++i)
+		ni_socket_release(timed[i]);
+
+	return retval;
+}
+#endif
+
+/*
+ * Wait for incoming data on any of the sockets.
+ */
+int
+ni_socket_array_wait(ni_socket_array_t *array, ni_timeout_t timeout)
+{
+	ni_stats_inc(NI_STATS_SOCKET_WAKEUPS);
+	ni_stats_snapshot_check();
+	ni_log_flush();
+#ifdef HAVE_SYS_EPOLL_H
+	if (array->epfd >= 0)
+		return __ni_socket_array_epoll_wait(array, timeout);
+#endif
+	return __ni_socket_array_poll_wait(array, timeout);
+}
+
+/*
+ * Apply the socket wait backend requested in the config
+ * to the global socket array.
+ */
+static void
+__ni_socket_array_apply_config(ni_socket_array_t *array)
+{
+	static ni_bool_t failed = FALSE;
+	ni_bool_t epoll;
+
+	epoll = ni_config_socket_backend() == NI_CONFIG_SOCKET_BACKEND_EPOLL;
+	if (epoll == ni_socket_array_is_epoll(array))
+		return;
+
+	if (epoll && failed)
+		return;
+
+	if (!ni_socket_array_set_epoll(array, epoll) && epoll) {
+		ni_warn("unable to use epoll socket backend, using poll");
+		failed = TRUE;
+	}
+}
+
 int
 ni_socket_wait(ni_timeout_t timeout)
 {
+	__ni_socket_array_apply_config(&__ni_sockets);
 	return ni_socket_array_wait(&__ni_sockets, timeout);
 }
 
@@ -300,6 +542,7 @@ void
 ni_socket_array_init(ni_socket_array_t *array)
 {
 	memset(array, 0, sizeof(*array));
+	array->epfd = -1;
 }
 
 void
@@ -312,28 +555,28 @@ ni_socket_array_destroy(ni_socket_array_t *array)
 			sock = array->data[array->count];
 			array->data[array->count] = NULL;
 			if (sock) {
-				if (sock->active == array)
+				if (sock->active == array) {
 					sock->active = NULL;
+					sock->epoll = 0;
+					sock->epoll_flags = 0;
+				}
 				ni_socket_release(sock);
 			}
 		}
 		free(array->data);
+		if (array->epfd >= 0)
+			close(array->epfd);
 		memset(array, 0, sizeof(*array));
+		array->epfd = -1;
 	}
 }
 
 static inline void
-__ni_socket_array_realloc(ni_socket_array_t *array, unsigned int newsize)
+__ni_socket_array_realloc(ni_socket_array_t *array, unsigned int newcount)
 {
-	ni_socket_t **newdata;
-	unsigned int i;
-
-	newsize = (newsize + NI_SOCKET_ARRAY_CHUNK);
-	newdata = xrealloc(array->data, newsize * sizeof(ni_socket_t *));
-
-	array->data = newdata;
-	for (i = array->count; i < newsize; ++i)
-		array->data[i] = NULL;
+	if (!ni_array_grow((void **)&array->data, sizeof(ni_socket_t *),
+				array->count, newcount, NI_SOCKET_ARRAY_CHUNK))
+		ni_fatal("allocation failed for %u socket array entries", newcount);
 }
 
 ni_bool_t
@@ -343,8 +586,7 @@ ni_socket_array_append(ni_socket_array_t *array, ni_socket_t *sock)
 		if (ni_socket_array_find(array, sock) != -1U)
 			return TRUE;
 
-		if ((array->count % NI_SOCKET_ARRAY_CHUNK) == 0)
-			__ni_socket_array_realloc(array, array->count);
+		__ni_socket_array_realloc(array, array->count + 1);
 
 		array->data[array->count++] = sock;
 		return TRUE;
@@ -368,8 +610,12 @@ ni_socket_array_remove_at(ni_socket_array_t *array, unsigned int index)
 	}
 	array->data[array->count] = NULL;
 
-	if (sock && sock->active == array)
+	if (sock && sock->active == array) {
+#ifdef HAVE_SYS_EPOLL_H
+		__ni_socket_epoll_unregister(array, sock);
+#endif
 		sock->active = NULL;
+	}
 	return sock;
 }
 
@@ -417,6 +663,9 @@ ni_socket_array_activate(ni_socket_array_t *array, ni_socket_t *sock)
 	ni_socket_hold(sock);
 	sock->active = array;
 	sock->poll_flags = POLLIN;
+#ifdef HAVE_SYS_EPOLL_H
+	__ni_socket_epoll_register(array, sock);
+#endif
 	return TRUE;
 }
 
@@ -437,3 +686,52 @@ ni_socket_array_deactivate(ni_socket_array_t *array, ni_socket_t *sock)
 	}
 	return FALSE;
 }
+
+/*
+ * Switch the socket array between the poll and epoll backend
+ */
+ni_bool_t
+ni_socket_array_is_epoll(const ni_socket_array_t *array)
+{
+	return array && array->epfd >= 0;
+}
+
+ni_bool_t
+ni_socket_array_set_epoll(ni_socket_array_t *array, ni_bool_t enable)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	unsigned int i;
+
+	if (!array)
+		return FALSE;
+
+	if (enable == ni_socket_array_is_epoll(array))
+		return TRUE;
+
+	if (!enable) {
+		for (i = 0; i < array->count; ++i) {
+			array->data[i]->epoll = 0;
+			array->data[i]->epoll_flags = 0;
+		}
+		close(array->epfd);
+		array->epfd = -1;
+		return TRUE;
+	}
+
+	if ((array->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		ni_error("unable to create epoll socket set: %m");
+		array->epfd = -1;
+		return FALSE;
+	}
+
+	for (i = 0; i < array->count; ++i) {
+		ni_socket_t *sock = array->data[i];
+
+		if (sock->active == array)
+			__ni_socket_epoll_register(array, sock);
+	}
+	return TRUE;
+#else
+	return !enable;
+#endif
+}
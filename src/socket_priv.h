@@ -18,8 +18,10 @@ struct ni_socket {
 	ni_socket_array_t *	active;
 
 	int		__fd;
-	unsigned int	error  : 1;
+	unsigned int	error  : 1,
+			epoll  : 1;
 	int		poll_flags;
+	int		epoll_flags;
 
 	ni_buffer_t	rbuf;
 	ni_buffer_t	wbuf;
@@ -43,9 +45,10 @@ struct ni_socket {
 struct ni_socket_array {
 	unsigned int	count;
 	ni_socket_t **	data;
+	int		epfd;
 };
 
-#define NI_SOCKET_ARRAY_INIT	{ .count = 0, .data = NULL }
+#define NI_SOCKET_ARRAY_INIT	{ .count = 0, .data = NULL, .epfd = -1 }
 
 extern void		ni_socket_array_init(ni_socket_array_t *);
 extern void		ni_socket_array_destroy(ni_socket_array_t *);
@@ -59,5 +62,9 @@ extern unsigned int	ni_socket_array_find(ni_socket_array_t *, ni_socket_t *);
 extern ni_bool_t	ni_socket_array_activate(ni_socket_array_t *, ni_socket_t *);
 extern ni_bool_t	ni_socket_array_deactivate(ni_socket_array_t *, ni_socket_t *);
 
+extern int		ni_socket_array_wait(ni_socket_array_t *, ni_timeout_t);
+extern ni_bool_t	ni_socket_array_set_epoll(ni_socket_array_t *, ni_bool_t);
+extern ni_bool_t	ni_socket_array_is_epoll(const ni_socket_array_t *);
+
 #endif /* __WICKED_SOCKET_PRIV_H__ */
 
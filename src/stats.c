@@ -0,0 +1,311 @@
+/*
+ *	Runtime performance counters of the wicked daemons
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <linux/rtnetlink.h>
+
+#include <wicked/util.h>
+#include <wicked/time.h>
+#include <wicked/logging.h>
+
+#include "stats.h"
+#include "util_priv.h"
+
+/* the nl_groups bitmask of received multicast messages covers 32 groups */
+#define NI_STATS_RTNL_GROUPS		33
+
+uint64_t				ni_stats_counters[NI_STATS_COUNTER_MAX];
+ni_stats_object_t			ni_stats_objects[NI_STATS_OBJECT_MAX];
+
+static volatile sig_atomic_t		ni_stats_snapshot_requested;
+static uint64_t				ni_stats_snapshot_live[NI_STATS_OBJECT_MAX];
+
+static uint64_t				ni_stats_rtnl_groups[NI_STATS_RTNL_GROUPS];
+static ni_stats_histogram_array_t	ni_stats_netlink_dump_array;
+static ni_stats_histogram_array_t	ni_stats_dbus_call_array;
+
+static const unsigned int		ni_stats_bounds[NI_STATS_HISTOGRAM_BUCKETS - 1] =
+						NI_STATS_HISTOGRAM_BOUNDS;
+
+static const ni_intmap_t		ni_stats_counter_names[] = {
+	{ "socket-wakeups",		NI_STATS_SOCKET_WAKEUPS		},
+	{ "timers-registered",		NI_STATS_TIMERS_REGISTERED	},
+	{ "timers-fired",		NI_STATS_TIMERS_FIRED		},
+	{ "timers-canceled",		NI_STATS_TIMERS_CANCELED	},
+	{ "lease-writes",		NI_STATS_LEASE_WRITES		},
+	{ "dbus-errors",		NI_STATS_DBUS_ERRORS		},
+	{ "log-dropped",		NI_STATS_LOG_DROPPED		},
+	{ "log-suppressed",		NI_STATS_LOG_SUPPRESSED		},
+	{ NULL,				NI_STATS_COUNTER_MAX		},
+};
+
+static const ni_intmap_t		ni_stats_object_names[] = {
+	{ "netdev",			NI_STATS_OBJECT_NETDEV		},
+	{ "address",			NI_STATS_OBJECT_ADDRESS		},
+	{ "route",			NI_STATS_OBJECT_ROUTE		},
+	{ "lease",			NI_STATS_OBJECT_LEASE		},
+	{ "xml",			NI_STATS_OBJECT_XML		},
+	{ "dbus",			NI_STATS_OBJECT_DBUS		},
+	{ "fsm",			NI_STATS_OBJECT_FSM		},
+	{ NULL,				NI_STATS_OBJECT_MAX		},
+};
+
+static const ni_intmap_t		ni_stats_rtnl_group_names[] = {
+	{ "unknown",			RTNLGRP_NONE			},
+	{ "link",			RTNLGRP_LINK			},
+	{ "notify",			RTNLGRP_NOTIFY			},
+	{ "neigh",			RTNLGRP_NEIGH			},
+	{ "tc",				RTNLGRP_TC			},
+	{ "ipv4-ifaddr",		RTNLGRP_IPV4_IFADDR		},
+	{ "ipv4-mroute",		RTNLGRP_IPV4_MROUTE		},
+	{ "ipv4-route",			RTNLGRP_IPV4_ROUTE		},
+	{ "ipv4-rule",			RTNLGRP_IPV4_RULE		},
+	{ "ipv6-ifaddr",		RTNLGRP_IPV6_IFADDR		},
+	{ "ipv6-mroute",		RTNLGRP_IPV6_MROUTE		},
+	{ "ipv6-route",			RTNLGRP_IPV6_ROUTE		},
+	{ "ipv6-ifinfo",		RTNLGRP_IPV6_IFINFO		},
+	{ "ipv6-prefix",		RTNLGRP_IPV6_PREFIX		},
+	{ "ipv6-rule",			RTNLGRP_IPV6_RULE		},
+	{ "nd-useropt",			RTNLGRP_ND_USEROPT		},
+	{ NULL,				0				},
+};
+
+const char *
+ni_stats_counter_name(unsigned int counter)
+{
+	return ni_format_uint_mapped(counter, ni_stats_counter_names);
+}
+
+const char *
+ni_stats_object_name(unsigned int type)
+{
+	return ni_format_uint_mapped(type, ni_stats_object_names);
+}
+
+/*
+ * Memory snapshot requested by a signal, logged from the main loop
+ * (ni_socket_wait) with the live objects per subsystem, their change
+ * since the previous snapshot and the process memory usage.
+ */
+static void
+ni_stats_snapshot_signal(int signum)
+{
+	ni_stats_snapshot_requested = 1;
+}
+
+void
+ni_stats_snapshot_enable(int signum)
+{
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = ni_stats_snapshot_signal;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART;
+	sigaction(signum, &sa, NULL);
+}
+
+void
+ni_stats_snapshot_check(void)
+{
+	if (ni_stats_snapshot_requested) {
+		ni_stats_snapshot_requested = 0;
+		ni_stats_snapshot_log();
+	}
+}
+
+void
+ni_stats_snapshot_log(void)
+{
+	const ni_stats_object_t *obj;
+	unsigned long size, rss;
+	uint64_t live;
+	unsigned int i;
+	FILE *fp;
+
+	if ((fp = fopen("/proc/self/statm", "r"))) {
+		if (fscanf(fp, "%lu %lu", &size, &rss) == 2) {
+			ni_note("memory snapshot: vsz %lu KiB, rss %lu KiB",
+				size * (sysconf(_SC_PAGESIZE) / 1024),
+				rss * (sysconf(_SC_PAGESIZE) / 1024));
+		}
+		fclose(fp);
+	}
+#if defined(HAVE_MALLINFO2)
+	{
+		struct mallinfo2 mi = mallinfo2();
+
+		ni_note("memory snapshot: heap %zu KiB, in use %zu KiB, free %zu KiB, mmap %zu KiB",
+			mi.arena / 1024, mi.uordblks / 1024, mi.fordblks / 1024,
+			mi.hblkhd / 1024);
+	}
+#endif
+
+	for (i = 0; i < NI_STATS_OBJECT_MAX; ++i) {
+		obj = &ni_stats_objects[i];
+		live = obj->allocated - obj->freed;
+		ni_note("memory snapshot: %-8s %8llu live (%+lld), %llu bytes, %llu allocated, %llu freed",
+			ni_stats_object_name(i), (unsigned long long)live,
+			(long long)(live - ni_stats_snapshot_live[i]),
+			(unsigned long long)obj->bytes,
+			(unsigned long long)obj->allocated,
+			(unsigned long long)obj->freed);
+		ni_stats_snapshot_live[i] = live;
+	}
+}
+
+/*
+ * The bucket upper bound in usec as string, "+Inf" for the last one
+ */
+const char *
+ni_stats_histogram_bucket_name(unsigned int bucket)
+{
+	static char names[NI_STATS_HISTOGRAM_BUCKETS - 1][16];
+
+	if (bucket >= NI_STATS_HISTOGRAM_BUCKETS - 1)
+		return "+Inf";
+
+	if (!names[bucket][0])
+		snprintf(names[bucket], sizeof(names[bucket]), "%u", ni_stats_bounds[bucket]);
+	return names[bucket];
+}
+
+/*
+ * Received rtnetlink multicast messages per group
+ */
+void
+ni_stats_rtnl_event(uint32_t nl_groups)
+{
+	ni_stats_rtnl_groups[ffs(nl_groups)]++;
+}
+
+const uint64_t *
+ni_stats_rtnl_events(unsigned int *count)
+{
+	if (count)
+		*count = NI_STATS_RTNL_GROUPS;
+	return ni_stats_rtnl_groups;
+}
+
+const char *
+ni_stats_rtnl_group_name(unsigned int group)
+{
+	return ni_format_uint_mapped(group, ni_stats_rtnl_group_names);
+}
+
+/*
+ * Latency histograms, looked up by a static key pointer (the
+ * message type name or the method definition) and named on
+ * first use.
+ */
+static ni_stats_histogram_t *
+ni_stats_histogram_get(ni_stats_histogram_array_t *array, const void *key,
+			const char *prefix, const char *name)
+{
+	ni_stats_histogram_t *hist;
+	unsigned int i;
+
+	for (i = 0; i < array->count; ++i) {
+		if (array->data[i]->key == key)
+			return array->data[i];
+	}
+
+	if ((array->count % 16) == 0) {
+		array->data = xrealloc(array->data,
+				(array->count + 16) * sizeof(array->data[0]));
+	}
+
+	hist = xcalloc(1, sizeof(*hist));
+	hist->key = key;
+	if (prefix)
+		ni_string_printf(&hist->name, "%s.%s", prefix, name);
+	else
+		ni_string_dup(&hist->name, name);
+
+	array->data[array->count++] = hist;
+	return hist;
+}
+
+static void
+ni_stats_histogram_add(ni_stats_histogram_t *hist, const struct timeval *started)
+{
+	struct timeval now, delta;
+	uint64_t usec;
+	unsigned int i;
+
+	if (ni_timer_get_time(&now) || !timercmp(&now, started, >))
+		timerclear(&delta);
+	else
+		timersub(&now, started, &delta);
+
+	usec = (uint64_t)delta.tv_sec * 1000000 + delta.tv_usec;
+	for (i = 0; i < NI_STATS_HISTOGRAM_BUCKETS - 1; ++i) {
+		if (usec <= ni_stats_bounds[i])
+			break;
+	}
+	hist->buckets[i]++;
+	hist->count++;
+	hist->sum += usec;
+}
+
+void
+ni_stats_netlink_dump(const char *name, const struct timeval *started)
+{
+	ni_stats_histogram_t *hist;
+
+	if (!name || !started)
+		return;
+
+	hist = ni_stats_histogram_get(&ni_stats_netlink_dump_array, name, NULL, name);
+	ni_stats_histogram_add(hist, started);
+}
+
+void
+ni_stats_dbus_call(const char *interface, const char *method, const void *key,
+			const struct timeval *started)
+{
+	ni_stats_histogram_t *hist;
+
+	if (!interface || !method || !key || !started)
+		return;
+
+	hist = ni_stats_histogram_get(&ni_stats_dbus_call_array, key, interface, method);
+	ni_stats_histogram_add(hist, started);
+}
+
+const ni_stats_histogram_array_t *
+ni_stats_netlink_dumps(void)
+{
+	return &ni_stats_netlink_dump_array;
+}
+
+const ni_stats_histogram_array_t *
+ni_stats_dbus_calls(void)
+{
+	return &ni_stats_dbus_call_array;
+}
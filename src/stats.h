@@ -0,0 +1,126 @@
+/*
+ *	Runtime performance counters of the wicked daemons
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef   WICKED_STATS_H
+#define   WICKED_STATS_H
+
+#include <sys/time.h>
+#include <wicked/types.h>
+
+/*
+ * Plain event counters; incremented unconditionally on the hot
+ * paths, so they are simple integers without any locking.
+ */
+enum {
+	NI_STATS_SOCKET_WAKEUPS,		/* socket array wait returns	*/
+	NI_STATS_TIMERS_REGISTERED,
+	NI_STATS_TIMERS_FIRED,
+	NI_STATS_TIMERS_CANCELED,
+	NI_STATS_LEASE_WRITES,			/* lease files written	*/
+	NI_STATS_DBUS_ERRORS,			/* method error replies	*/
+	NI_STATS_LOG_DROPPED,			/* async log ring full	*/
+	NI_STATS_LOG_SUPPRESSED,		/* debug rate limited	*/
+
+	NI_STATS_COUNTER_MAX
+};
+
+/*
+ * Allocation accounting of the long-living objects per subsystem,
+ * counting the objects and their struct size (without the strings
+ * and arrays they own), to attribute the growth of a daemon.
+ */
+enum {
+	NI_STATS_OBJECT_NETDEV,
+	NI_STATS_OBJECT_ADDRESS,
+	NI_STATS_OBJECT_ROUTE,
+	NI_STATS_OBJECT_LEASE,
+	NI_STATS_OBJECT_XML,
+	NI_STATS_OBJECT_DBUS,
+	NI_STATS_OBJECT_FSM,
+
+	NI_STATS_OBJECT_MAX
+};
+
+typedef struct ni_stats_object {
+	uint64_t		allocated;
+	uint64_t		freed;
+	uint64_t		bytes;		/* of the live objects	*/
+} ni_stats_object_t;
+
+/* latency histogram bucket upper bounds in usec, the last is +Inf */
+#define NI_STATS_HISTOGRAM_BOUNDS	{ 100, 250, 500, 1000, 2500, 5000,	\
+					  10000, 25000, 50000, 100000, 250000,	\
+					  500000, 1000000, 2500000 }
+#define NI_STATS_HISTOGRAM_BUCKETS	15
+
+typedef struct ni_stats_histogram {
+	const void *		key;
+	char *			name;
+	uint64_t		count;
+	uint64_t		sum;		/* in usec	*/
+	uint64_t		buckets[NI_STATS_HISTOGRAM_BUCKETS];
+} ni_stats_histogram_t;
+
+typedef struct ni_stats_histogram_array {
+	unsigned int		count;
+	ni_stats_histogram_t **	data;
+} ni_stats_histogram_array_t;
+
+extern uint64_t			ni_stats_counters[NI_STATS_COUNTER_MAX];
+extern ni_stats_object_t	ni_stats_objects[NI_STATS_OBJECT_MAX];
+
+static inline void
+ni_stats_inc(unsigned int counter)
+{
+	ni_stats_counters[counter]++;
+}
+
+static inline void
+ni_stats_object_alloc(unsigned int type, size_t size)
+{
+	ni_stats_objects[type].allocated++;
+	ni_stats_objects[type].bytes += size;
+}
+
+static inline void
+ni_stats_object_free(unsigned int type, size_t size)
+{
+	ni_stats_objects[type].freed++;
+	ni_stats_objects[type].bytes -= size;
+}
+
+extern const char *		ni_stats_counter_name(unsigned int);
+extern const char *		ni_stats_histogram_bucket_name(unsigned int);
+extern const char *		ni_stats_object_name(unsigned int);
+
+extern void			ni_stats_snapshot_enable(int signum);
+extern void			ni_stats_snapshot_check(void);
+extern void			ni_stats_snapshot_log(void);
+
+extern void			ni_stats_rtnl_event(uint32_t nl_groups);
+extern const uint64_t *		ni_stats_rtnl_events(unsigned int *);
+extern const char *		ni_stats_rtnl_group_name(unsigned int);
+
+extern void			ni_stats_netlink_dump(const char *, const struct timeval *);
+extern void			ni_stats_dbus_call(const char *, const char *, const void *,
+						const struct timeval *);
+
+extern const ni_stats_histogram_array_t *ni_stats_netlink_dumps(void);
+extern const ni_stats_histogram_array_t *ni_stats_dbus_calls(void);
+
+#endif /* WICKED_STATS_H */
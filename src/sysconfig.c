@@ -10,14 +10,16 @@
 #include <ctype.h>
 #include <errno.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
 #include <wicked/sysconfig.h>
 #include "util_priv.h"
 
-static ni_bool_t unquote(char *);
 static char *	quote(char *);
+static void	ni_sysconfig_index_free(ni_sysconfig_t *);
 
 int
 ni_sysconfig_scandir(const char *dirname, const char *pattern, ni_string_array_t *res)
@@ -43,20 +45,89 @@ ni_sysconfig_new(const char *pathname)
 void
 ni_sysconfig_destroy(ni_sysconfig_t *sc)
 {
+	ni_sysconfig_index_free(sc);
 	ni_var_array_destroy(&sc->vars);
 	ni_string_free(&sc->pathname);
 	free(sc);
 }
 
+static ni_bool_t
+__ni_sysconfig_varname_match(const char **varnames, const char *name, size_t len)
+{
+	const char *match;
+
+	while ((match = *varnames++) != NULL) {
+		if (!strncmp(match, name, len) && match[len] == '\0')
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * Parse a NAME=value line ending at end (or a NUL byte) and set the
+ * variable, unquoting the value into a reused scratch buffer.  Values
+ * with an unterminated quote or without a terminating newline/quote
+ * are ignored.
+ */
+static void
+__ni_sysconfig_read_line(ni_sysconfig_t *sc, const char *sp, const char *end,
+			const char **varnames, ni_stringbuf_t *name, ni_stringbuf_t *value)
+{
+	const char *start;
+	char quote_sign = 0;
+
+	while (sp < end && isspace((unsigned char)*sp))
+		++sp;
+	if (sp >= end || *sp == '#')
+		return;
+
+	/* Silently ignore fishy strings which do not seem to be
+	   variables . */
+	if (!isalpha((unsigned char)*sp))
+		return;
+	start = sp;
+
+	while (sp < end && (isalnum((unsigned char)*sp) || *sp == '_'))
+		++sp;
+	if (sp >= end || *sp != '=')
+		return;
+
+	/* If we were given a list of variable names to match
+	 * against, ignore all variables not in this list. */
+	if (varnames && !__ni_sysconfig_varname_match(varnames, start, sp - start))
+		return;
+
+	ni_stringbuf_truncate(name, 0);
+	ni_stringbuf_put(name, start, sp - start);
+
+	if (++sp < end && (*sp == '"' || *sp == '\''))
+		quote_sign = *sp++;
+	for (start = sp; ; ++sp) {
+		if (sp >= end || *sp == '\0')
+			return;
+		if (*sp == quote_sign || (!quote_sign && isspace((unsigned char)*sp)))
+			break;
+	}
+
+	ni_stringbuf_truncate(value, 0);
+	ni_stringbuf_put(value, start, sp - start);
+	ni_sysconfig_set(sc, name->string, value->string);
+}
+
 /*
  * Read a sysconfig file, and return an object containing all variables
  * found. Optionally, @varnames will restrict the list of variables we return.
+ * Regular files are mapped and parsed in place in a single pass.
  */
 ni_sysconfig_t *
 __ni_sysconfig_read(const char *filename, const char **varnames)
 {
+	ni_stringbuf_t name = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t value = NI_STRINGBUF_INIT_DYNAMIC;
+	const char *line, *next, *end;
 	ni_sysconfig_t *sc;
-	char linebuf[512];
+	struct stat stb;
+	void *addr = MAP_FAILED;
 	FILE *fp;
 
 	ni_debug_readwrite("ni_sysconfig_read(%s)", filename);
@@ -66,47 +137,30 @@ __ni_sysconfig_read(const char *filename, const char **varnames)
 	}
 
 	sc = ni_sysconfig_new(filename);
-	while (fgets(linebuf, sizeof(linebuf), fp) != NULL) {
-		char *name, *value;
-		char *sp = linebuf;
-
-		while (isspace(*sp))
-			++sp;
-		if (*sp == '#')
-			continue;
-
-		/* Silently ignore fishy strings which do not seem to be
-		   variables . */
-		if (!isalpha(*sp))
-			continue;
-		name = sp;
-
-		while (isalnum(*sp) || *sp == '_')
-			++sp;
-		if (*sp != '=')
-			continue;
-		*sp++ = '\0';
-
-		/* If we were given a list of variable names to match
-		 * against, ignore all variables not in this list. */
-		if (varnames) {
-			const char **vp = varnames, *match;
-
-			while ((match = *vp++) != NULL) {
-				if (!strcmp(match, name))
-					break;
-			}
-			if (!match)
-				continue;
+	if (fstat(fileno(fp), &stb) == 0 && S_ISREG(stb.st_mode) && stb.st_size > 0)
+		addr = mmap(NULL, stb.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+
+	if (addr != MAP_FAILED) {
+		end = (const char *)addr + stb.st_size;
+		for (line = addr; line < end; line = next) {
+			if ((next = memchr(line, '\n', end - line)))
+				next++;
+			else
+				next = end;
+			__ni_sysconfig_read_line(sc, line, next, varnames, &name, &value);
 		}
+		munmap(addr, stb.st_size);
+	} else {
+		char linebuf[512];
 
-		value = sp;
-		if (!unquote(value))
-			continue;
-
-		ni_sysconfig_set(sc, name, value);
+		while (fgets(linebuf, sizeof(linebuf), fp) != NULL) {
+			__ni_sysconfig_read_line(sc, linebuf, linebuf + strlen(linebuf),
+						varnames, &name, &value);
+		}
 	}
 
+	ni_stringbuf_destroy(&name);
+	ni_stringbuf_destroy(&value);
 	fclose(fp);
 	return sc;
 }
@@ -310,43 +364,6 @@ ni_sysconfig_merge_defaults(const ni_sysconfig_t *config, const ni_sysconfig_t *
 	return merged;
 }
 
-/* Extract values from a setting. string starts after '='
- * Good: sym=val ; sym="val" ; sym='val'
- * Bad:  sym="val ; sym='val
- *
- * returns true if val is valid.
- */
-static ni_bool_t
-unquote(char *string)
-{
-	char quote_sign = 0;
-	char *src, *dst, cc, lc = 0;
-	ni_bool_t ret = TRUE;
-
-	src = dst = string;
-	if (*string == '"' || *string == '\'') {
-		quote_sign = *string;
-		src++;
-	}
-	do {
-		cc = *src;
-		if (!cc) {
-			ret = quote_sign && lc == quote_sign;
-			break;
-		}
-		if (isspace(cc) && !quote_sign)
-			break;
-		if (cc == quote_sign)
-			break;
-		*dst = lc = cc;
-		dst++;
-		src++;
-	} while (1);
-
-	*dst = '\0';
-	return ret;
-}
-
 char *
 quote(char *string)
 {
@@ -365,6 +382,7 @@ quote(char *string)
 void
 ni_sysconfig_set(ni_sysconfig_t *sc, const char *name, const char *value)
 {
+	ni_sysconfig_index_free(sc);
 	ni_var_array_set(&sc->vars, name, value);
 }
 
@@ -389,20 +407,163 @@ ni_sysconfig_get(const ni_sysconfig_t *sc, const char *name)
 	return ni_var_array_get(&sc->vars, name);
 }
 
+/*
+ * The variable positions sorted by name, so all variables with a
+ * given prefix (e.g. IPADDR, BONDING_SLAVE) are found by a binary
+ * search as one range, that is then visited in the file order.
+ * Built on the first prefix lookup, dropped by ni_sysconfig_set.
+ */
+struct ni_sysconfig_index {
+	const ni_var_t *	data;
+	unsigned int		count;
+	unsigned int		named;		/* sorted positions	*/
+	unsigned int *		sorted;
+};
+
+typedef struct ni_sysconfig_index_entry {
+	const char *		name;
+	unsigned int		pos;
+} ni_sysconfig_index_entry_t;
+
+static int
+ni_sysconfig_index_entry_cmp(const void *p1, const void *p2)
+{
+	const ni_sysconfig_index_entry_t *e1 = p1;
+	const ni_sysconfig_index_entry_t *e2 = p2;
+	int ret;
+
+	if ((ret = strcmp(e1->name, e2->name)))
+		return ret;
+	return e1->pos < e2->pos ? -1 : e1->pos > e2->pos;
+}
+
+static int
+ni_sysconfig_index_pos_cmp(const void *p1, const void *p2)
+{
+	unsigned int pos1 = *(const unsigned int *)p1;
+	unsigned int pos2 = *(const unsigned int *)p2;
+
+	return pos1 < pos2 ? -1 : pos1 > pos2;
+}
+
+static void
+ni_sysconfig_index_free(ni_sysconfig_t *sc)
+{
+	if (sc->index) {
+		free(sc->index->sorted);
+		free(sc->index);
+		sc->index = NULL;
+	}
+}
+
+static const struct ni_sysconfig_index *
+ni_sysconfig_index(ni_sysconfig_t *sc)
+{
+	ni_sysconfig_index_entry_t *entries;
+	struct ni_sysconfig_index *index;
+	unsigned int i, n;
+
+	if ((index = sc->index) && index->data == sc->vars.data &&
+	    index->count == sc->vars.count)
+		return index;
+
+	ni_sysconfig_index_free(sc);
+	index = xcalloc(1, sizeof(*index));
+	entries = xcalloc(sc->vars.count + 1, sizeof(*entries));
+	index->sorted = xcalloc(sc->vars.count + 1, sizeof(*index->sorted));
+
+	for (i = n = 0; i < sc->vars.count; ++i) {
+		if (!sc->vars.data[i].name)
+			continue;
+		entries[n].name = sc->vars.data[i].name;
+		entries[n].pos = i;
+		n++;
+	}
+	qsort(entries, n, sizeof(*entries), ni_sysconfig_index_entry_cmp);
+
+	for (i = 0; i < n; ++i)
+		index->sorted[i] = entries[i].pos;
+	free(entries);
+
+	index->data = sc->vars.data;
+	index->count = sc->vars.count;
+	index->named = n;
+	sc->index = index;
+	return index;
+}
+
+/*
+ * Visit all variables with a non-empty value and the given name prefix
+ * in the order they appear in the file.  Returns the number of visited
+ * variables or -1 when the callback stopped the enumeration; a NULL
+ * callback just counts them.
+ */
 int
-ni_sysconfig_find_matching(const ni_sysconfig_t *sc, const char *prefix,
-		ni_string_array_t *res)
+ni_sysconfig_foreach_matching(const ni_sysconfig_t *sc, const char *prefix,
+		ni_sysconfig_match_fn_t *func, void *user_data)
 {
-	unsigned int i, pfxlen;
-	ni_var_t *var;
+	const struct ni_sysconfig_index *index;
+	unsigned int lo, hi, mid, i, n, pfxlen, *range;
+	const ni_var_t *var;
+	int ret = 0;
+
+	if (!sc || !prefix || !sc->vars.count)
+		return 0;
 
+	/* the index is a cache, building it does not modify the variables */
+	index = ni_sysconfig_index((ni_sysconfig_t *)sc);
 	pfxlen = strlen(prefix);
-	for (i = 0, var = sc->vars.data; i < sc->vars.count; ++i, ++var) {
-		const char *value = var->value;
+	n = index->named;
+
+	lo = 0;
+	hi = n;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strcmp(sc->vars.data[index->sorted[mid]].name, prefix) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (hi = lo; hi < n; ++hi) {
+		if (strncmp(sc->vars.data[index->sorted[hi]].name, prefix, pfxlen))
+			break;
+	}
+	if (lo == hi)
+		return 0;
+
+	range = xmalloc((hi - lo) * sizeof(*range));
+	memcpy(range, &index->sorted[lo], (hi - lo) * sizeof(*range));
+	qsort(range, hi - lo, sizeof(*range), ni_sysconfig_index_pos_cmp);
+
+	for (i = 0; i < hi - lo; ++i) {
+		var = &sc->vars.data[range[i]];
+		if (ni_string_empty(var->value))
+			continue;
 
-		if (value && *value && !strncmp(var->name, prefix, pfxlen))
-			ni_string_array_append(res, var->name);
+		if (func && !func(sc, var, var->name + pfxlen, user_data)) {
+			ret = -1;
+			break;
+		}
+		ret++;
 	}
+	free(range);
+	return ret;
+}
+
+static ni_bool_t
+ni_sysconfig_find_matching_name(const ni_sysconfig_t *sc, const ni_var_t *var,
+		const char *suffix, void *user_data)
+{
+	(void)sc;
+	(void)suffix;
+	return ni_string_array_append(user_data, var->name) == 0;
+}
+
+int
+ni_sysconfig_find_matching(const ni_sysconfig_t *sc, const char *prefix,
+		ni_string_array_t *res)
+{
+	ni_sysconfig_foreach_matching(sc, prefix, ni_sysconfig_find_matching_name, res);
 	return res->count;
 }
 
@@ -26,7 +26,9 @@
 #endif
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <errno.h>
 #include <net/if_arp.h>
 
 #include <wicked/netinfo.h>
@@ -34,6 +36,7 @@
 #include <wicked/pci.h>
 #include "util_priv.h"
 #include "sysfs.h"
+#include "worker.h"
 #include "ibft.h"
 
 #ifndef NI_SYSFS_PATH
@@ -77,6 +80,7 @@ static int		__ni_sysfs_netif_put_attr(const char *, const char *, const char *);
 static int		__ni_sysfs_printf(const char *, const char *, ...);
 static int		__ni_sysfs_read_list(const char *, ni_string_array_t *);
 static int		__ni_sysfs_read_string(const char *, char **);
+static const char *	__ni_sysfs_netif_get_cached_attr(const char *, const char *);
 
 
 /*
@@ -147,6 +151,168 @@ ni_sysfs_netif_get_string(const char *ifname, const char *attr_name, char **resu
 	return 0;
 }
 
+/*
+ * Cache of the (rarely changing) attributes read while discovering
+ * the devices, so repeated refreshes do not read them again. As the
+ * kernel does not notify about attribute changes, it is enabled by
+ * the link event monitor only, which drops the attributes of a device
+ * on every link event or uevent about it and on changes we apply.
+ */
+#define NI_SYSFS_ATTR_CACHE_BUCKETS	256
+
+typedef struct ni_sysfs_attr_cache	ni_sysfs_attr_cache_t;
+struct ni_sysfs_attr_cache {
+	ni_sysfs_attr_cache_t *	next;
+	char *			ifname;
+	ni_var_array_t		attrs;
+};
+
+static struct {
+	ni_bool_t		enabled;
+	ni_sysfs_attr_cache_t *	buckets[NI_SYSFS_ATTR_CACHE_BUCKETS];
+} ni_sysfs_attr_cache;
+
+/*
+ * Set while working in another network namespace: the sysfs we see
+ * shows the devices of the namespace it has been mounted in only.
+ */
+static ni_bool_t		ni_sysfs_netif_foreign;
+
+void
+ni_sysfs_netif_set_foreign(ni_bool_t foreign)
+{
+	ni_sysfs_netif_foreign = foreign;
+}
+
+static ni_sysfs_attr_cache_t **
+__ni_sysfs_attr_cache_bucket(const char *ifname)
+{
+	return &ni_sysfs_attr_cache.buckets[ni_string_hash(ifname) %
+						NI_SYSFS_ATTR_CACHE_BUCKETS];
+}
+
+static void
+__ni_sysfs_attr_cache_free(ni_sysfs_attr_cache_t *cache)
+{
+	ni_var_array_destroy(&cache->attrs);
+	ni_string_free(&cache->ifname);
+	free(cache);
+}
+
+void
+ni_sysfs_netif_cache_invalidate(const char *ifname)
+{
+	ni_sysfs_attr_cache_t **pos, *cache;
+	unsigned int i;
+
+	if (ifname) {
+		if (ni_string_empty(ifname))
+			return;
+
+		for (pos = __ni_sysfs_attr_cache_bucket(ifname); (cache = *pos); pos = &cache->next) {
+			if (ni_string_eq(cache->ifname, ifname)) {
+				*pos = cache->next;
+				__ni_sysfs_attr_cache_free(cache);
+				return;
+			}
+		}
+		return;
+	}
+
+	for (i = 0; i < NI_SYSFS_ATTR_CACHE_BUCKETS; ++i) {
+		while ((cache = ni_sysfs_attr_cache.buckets[i])) {
+			ni_sysfs_attr_cache.buckets[i] = cache->next;
+			__ni_sysfs_attr_cache_free(cache);
+		}
+	}
+}
+
+void
+ni_sysfs_netif_cache_enable(ni_bool_t enable)
+{
+	if (!enable)
+		ni_sysfs_netif_cache_invalidate(NULL);
+	ni_sysfs_attr_cache.enabled = enable;
+}
+
+static const char *
+__ni_sysfs_netif_get_cached_attr(const char *ifname, const char *attr_name)
+{
+	ni_sysfs_attr_cache_t **pos, *cache;
+	const char *value;
+	ni_var_t *var;
+
+	if (!ni_sysfs_attr_cache.enabled || ni_sysfs_netif_foreign ||
+	    ni_string_empty(ifname))
+		return __ni_sysfs_netif_get_attr(ifname, attr_name);
+
+	pos = __ni_sysfs_attr_cache_bucket(ifname);
+	for (cache = *pos; cache; cache = cache->next) {
+		if (ni_string_eq(cache->ifname, ifname))
+			break;
+	}
+
+	if (cache && (var = ni_var_array_get(&cache->attrs, attr_name))) {
+		if (!var->value)
+			errno = ENOENT;
+		return var->value;
+	}
+
+	/* remember missing attributes as well */
+	value = __ni_sysfs_netif_get_attr(ifname, attr_name);
+	if (value || errno == ENOENT) {
+		if (!cache) {
+			cache = xcalloc(1, sizeof(*cache));
+			ni_string_dup(&cache->ifname, ifname);
+			cache->next = *pos;
+			*pos = cache;
+		}
+		ni_var_array_set(&cache->attrs, attr_name, value);
+		if (!value)
+			errno = ENOENT;
+	}
+	return value;
+}
+
+int
+ni_sysfs_netif_get_cached_uint(const char *ifname, const char *attr_name, unsigned int *result)
+{
+	const char *attr;
+
+	attr = __ni_sysfs_netif_get_cached_attr(ifname, attr_name);
+	if (!attr)
+		return -1;
+
+	*result = strtoul(attr, NULL, 0);
+	return 0;
+}
+
+int
+ni_sysfs_netif_get_cached_ulong(const char *ifname, const char *attr_name, unsigned long *result)
+{
+	const char *attr;
+
+	attr = __ni_sysfs_netif_get_cached_attr(ifname, attr_name);
+	if (!attr)
+		return -1;
+
+	*result = strtoul(attr, NULL, 0);
+	return 0;
+}
+
+int
+ni_sysfs_netif_get_cached_string(const char *ifname, const char *attr_name, char **result)
+{
+	const char *attr;
+
+	attr = __ni_sysfs_netif_get_cached_attr(ifname, attr_name);
+	if (!attr)
+		return -1;
+
+	ni_string_dup(result, attr);
+	return 0;
+}
+
 int
 ni_sysfs_netif_put_int(const char *ifname, const char *attr_name, int result)
 {
@@ -196,6 +362,115 @@ ni_sysfs_netif_printf(const char *ifname, const char *attr_name, const char *fmt
 	return ret;
 }
 
+/*
+ * Write the attributes of an interface in a worker thread, as e.g. the
+ * IPoIB connection mode change is stalling for seconds in the driver.
+ * The done function is called in the main loop with the errno of each
+ * write (ECANCELED when the pool has been stopped); fails when no pool
+ * is running, so the caller has to use the blocking put functions.
+ */
+typedef struct ni_sysfs_netif_put_job {
+	char *				ifname;
+	ni_var_array_t			attrs;
+	ni_string_array_t		paths;
+	ni_string_array_t		lines;
+	int *				errors;
+
+	ni_sysfs_netif_put_done_t *	done;
+	void *				user_data;
+} ni_sysfs_netif_put_job_t;
+
+static void
+ni_sysfs_netif_put_job_free(ni_sysfs_netif_put_job_t *job)
+{
+	ni_string_free(&job->ifname);
+	ni_var_array_destroy(&job->attrs);
+	ni_string_array_destroy(&job->paths);
+	ni_string_array_destroy(&job->lines);
+	free(job->errors);
+	free(job);
+}
+
+static void
+ni_sysfs_netif_put_job_work(int iocfd, void *user_data)
+{
+	ni_sysfs_netif_put_job_t *job = user_data;
+	const char *line;
+	unsigned int i;
+	size_t len;
+	int fd;
+
+	for (i = 0; i < job->paths.count; ++i) {
+		if ((fd = open(job->paths.data[i], O_WRONLY | O_CLOEXEC)) < 0) {
+			job->errors[i] = errno;
+			continue;
+		}
+
+		/* sysfs stores the value from a single write */
+		line = job->lines.data[i];
+		len = strlen(line);
+		if (write(fd, line, len) != (ssize_t)len)
+			job->errors[i] = errno ? errno : EIO;
+		close(fd);
+	}
+}
+
+static void
+ni_sysfs_netif_put_job_done(void *user_data, ni_bool_t completed)
+{
+	ni_sysfs_netif_put_job_t *job = user_data;
+	unsigned int i;
+
+	if (!completed) {
+		for (i = 0; i < job->attrs.count; ++i)
+			job->errors[i] = ECANCELED;
+	}
+
+	ni_sysfs_netif_cache_invalidate(job->ifname);
+	job->done(job->user_data, job->ifname, &job->attrs, job->errors);
+
+	ni_sysfs_netif_put_job_free(job);
+}
+
+ni_bool_t
+ni_sysfs_netif_put_attrs_async(const char *ifname, const ni_var_array_t *attrs,
+				ni_sysfs_netif_put_done_t *done, void *user_data)
+{
+	ni_sysfs_netif_put_job_t *job;
+	char *line = NULL;
+	unsigned int i;
+
+	if (ni_string_empty(ifname) || !attrs || !attrs->count || !done)
+		return FALSE;
+
+	if (ni_sysfs_netif_foreign || !ni_worker_pool_active())
+		return FALSE;
+
+	job = xcalloc(1, sizeof(*job));
+	ni_string_dup(&job->ifname, ifname);
+	job->errors = xcalloc(attrs->count, sizeof(int));
+	job->done = done;
+	job->user_data = user_data;
+
+	for (i = 0; i < attrs->count; ++i) {
+		const ni_var_t *var = &attrs->data[i];
+
+		ni_var_array_append(&job->attrs, var->name, var->value);
+		ni_string_array_append(&job->paths,
+				__ni_sysfs_netif_attrpath(ifname, var->name));
+		ni_string_printf(&line, "%s\n", var->value ? var->value : "");
+		ni_string_array_append(&job->lines, line);
+	}
+	ni_string_free(&line);
+
+	if (ni_worker_submit(ni_sysfs_netif_put_job_work,
+				ni_sysfs_netif_put_job_done, job))
+		return TRUE;
+
+	ni_sysfs_netif_put_job_free(job);
+	return FALSE;
+}
+
 ni_bool_t
 ni_sysfs_is_read_only(void)
 {
@@ -205,6 +480,8 @@ ni_sysfs_is_read_only(void)
 ni_bool_t
 ni_sysfs_netif_exists(const char *ifname, const char *attr_name)
 {
+	if (ni_sysfs_netif_foreign)
+		return FALSE;
 	return ni_file_exists(__ni_sysfs_netif_attrpath(ifname, attr_name));
 }
 
@@ -214,6 +491,8 @@ ni_sysfs_netif_readlink(const char *ifname, const char *attr_name, char **link)
 	char linkbuf[PATH_MAX] = {'\0'};
 	const char *path = __ni_sysfs_netif_attrpath(ifname, attr_name);
 
+	if (ni_sysfs_netif_foreign)
+		return FALSE;
 	if (readlink(path, linkbuf, sizeof(linkbuf)) < 0 || !linkbuf[0])
 		return FALSE;
 
@@ -229,6 +508,11 @@ __ni_sysfs_netif_get_attr(const char *ifname, const char *attr_name)
 	char *result = NULL;
 	FILE *fp;
 
+	if (ni_sysfs_netif_foreign) {
+		errno = ENOENT;
+		return NULL;
+	}
+
 	filename = __ni_sysfs_netif_attrpath(ifname, attr_name);
 	if (!(fp = fopen(filename, "r")))
 		return NULL;
@@ -248,6 +532,13 @@ __ni_sysfs_netif_put_attr(const char *ifname, const char *attr_name, const char
 	FILE *fp;
 	int rv = 0;
 
+	if (ni_sysfs_netif_foreign) {
+		ni_error("Unable to set %s attribute %s in another network namespace",
+				ifname, attr_name);
+		return -1;
+	}
+
+	ni_sysfs_netif_cache_invalidate(ifname);
 	filename = __ni_sysfs_netif_attrpath(ifname, attr_name);
 	if (!(fp = fopen(filename, "w"))) {
 		ni_error("Unable to set %s attribute %s: %m",
@@ -271,6 +562,12 @@ __ni_sysfs_netif_attrpath(const char *ifname, const char *attr_name)
 {
 	static char pathbuf[PATH_MAX];
 
+	/* an empty path does not exist in any other namespace either */
+	if (ni_sysfs_netif_foreign) {
+		pathbuf[0] = '\0';
+		return pathbuf;
+	}
+
 	snprintf(pathbuf, sizeof(pathbuf), "%s/%s/%s",
 			NI_SYSFS_CLASS_NET_PATH, ifname, attr_name);
 	return pathbuf;
@@ -442,20 +739,22 @@ ni_sysfs_bridge_get_config(const char *ifname, ni_bridge_t *bridge)
 	unsigned int  ui;
 	unsigned long ul;
 
-	if (ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/stp_state", &ui) == 0)
+	if (ni_sysfs_netif_get_cached_uint(ifname, SYSFS_BRIDGE_ATTR "/stp_state", &ui) == 0)
 		bridge->stp = ui ? TRUE : FALSE;
 
-	if (ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/priority", &ui) == 0)
+	if (ni_sysfs_netif_get_cached_uint(ifname, SYSFS_BRIDGE_ATTR "/priority", &ui) == 0)
 		bridge->priority = ui;
 
-	if (ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/forward_delay", &ui) == 0)
+	if (ni_sysfs_netif_get_cached_uint(ifname, SYSFS_BRIDGE_ATTR "/forward_delay", &ui) == 0)
 		bridge->forward_delay = (double)ui / 100.0;
-	if (ni_sysfs_netif_get_ulong(ifname, SYSFS_BRIDGE_ATTR "/ageing_time", &ul) == 0)
+	if (ni_sysfs_netif_get_cached_ulong(ifname, SYSFS_BRIDGE_ATTR "/ageing_time", &ul) == 0)
 		bridge->ageing_time = (double)ui / 100.0;
-	if (ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/hello_time", &ui) == 0)
+	if (ni_sysfs_netif_get_cached_uint(ifname, SYSFS_BRIDGE_ATTR "/hello_time", &ui) == 0)
 		bridge->hello_time = (double)ui / 100.0;
-	if (ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/max_age", &ui) == 0)
+	if (ni_sysfs_netif_get_cached_uint(ifname, SYSFS_BRIDGE_ATTR "/max_age", &ui) == 0)
 		bridge->max_age = (double)ui / 100.0;
+	if (ni_sysfs_netif_get_cached_uint(ifname, SYSFS_BRIDGE_ATTR "/vlan_filtering", &ui) == 0)
+		ni_tristate_set(&bridge->vlan_filtering, ui != 0);
 }
 
 int
@@ -490,6 +789,11 @@ ni_sysfs_bridge_update_config(const char *ifname, const ni_bridge_t *bridge)
 				(unsigned int)(bridge->max_age * 100.0)) < 0)
 		rv = -1;
 
+	if (ni_tristate_is_set(bridge->vlan_filtering) &&
+	    ni_sysfs_netif_put_uint(ifname, SYSFS_BRIDGE_ATTR "/vlan_filtering",
+				ni_tristate_is_enabled(bridge->vlan_filtering)) < 0)
+		rv = -1;
+
 	return rv;
 }
 
@@ -513,14 +817,16 @@ ni_sysfs_bridge_get_status(const char *ifname, ni_bridge_status_t *bs)
 int
 ni_sysfs_bridge_get_port_names(const char *ifname, ni_string_array_t *names)
 {
+	if (ni_sysfs_netif_foreign)
+		return 0;
 	return ni_scandir(__ni_sysfs_netif_attrpath(ifname, SYSFS_BRIDGE_PORT_SUBDIR), NULL, names);
 }
 
 void
 ni_sysfs_bridge_port_get_config(const char *ifname, ni_bridge_port_t *port)
 {
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/priority", &port->priority);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/path_cost", &port->path_cost);
+	ni_sysfs_netif_get_cached_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/priority", &port->priority);
+	ni_sysfs_netif_get_cached_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/path_cost", &port->path_cost);
 }
 
 int
@@ -884,7 +1190,8 @@ __ni_sysfs_ibft_nic_get_uint(const char *base, const char *node,
 
 static int
 __ni_sysfs_ibft_nic_find_iface(const char *base, const char *devpath,
-				char **ifname, unsigned int *ifindex)
+				const ni_hwaddr_t *hwaddr, char **ifname,
+				unsigned int *ifindex)
 {
 	ni_string_array_t netlist = NI_STRING_ARRAY_INIT;
 	char * netbase = NULL;
@@ -926,12 +1233,28 @@ __ni_sysfs_ibft_nic_find_iface(const char *base, const char *devpath,
 		/*
 		 * netbase points to device/[subdir/]net/ directory,
 		 * netlist contains the interface name entries in it;
-		 * verify that the <iface>/ifindex file exists.
+		 * verify that the <iface>/ifindex file exists and,
+		 * when the iBFT provides a mac, the <iface>/address.
 		 */
 		for(i = 0; i < netlist.count && *ifname == NULL; ++i) {
 			char *path = NULL;
 			char *temp = NULL;
 
+			if (hwaddr && hwaddr->len) {
+				ni_hwaddr_t addr;
+
+				ni_string_printf(&path, "%s/%s/address",
+						netbase, netlist.data[i]);
+				if (__ni_sysfs_read_string(path, &temp) != 0 || !temp ||
+				    ni_link_address_parse(&addr, hwaddr->type, temp) != 0 ||
+				    !ni_link_address_equal(&addr, hwaddr)) {
+					ni_string_free(&temp);
+					ni_string_free(&path);
+					continue;
+				}
+				ni_string_free(&temp);
+			}
+
 			ni_string_printf(&path, "%s/%s/ifindex",
 					netbase, netlist.data[i]);
 
@@ -962,12 +1285,6 @@ __ni_sysfs_ibft_nic_parse(const char *base, const char *node)
 
 	ni_string_dup(&nic->node, node);
 
-	if (__ni_sysfs_ibft_nic_get_devpath(base, node,
-				"device", &nic->devpath) != 0)
-		goto error;
-	if (__ni_sysfs_ibft_nic_find_iface(base, nic->devpath,
-				&nic->ifname, &nic->ifindex) != 0)
-		goto error;
 
 	if (__ni_sysfs_ibft_nic_get_uint(base, node,
 				"index", &nic->index) != 0)
@@ -989,12 +1306,22 @@ __ni_sysfs_ibft_nic_parse(const char *base, const char *node)
 			goto error;
 	}
 
+	if (__ni_sysfs_ibft_nic_get_devpath(base, node,
+				"device", &nic->devpath) != 0)
+		goto error;
+	if (__ni_sysfs_ibft_nic_find_iface(base, nic->devpath, &nic->hwaddr,
+				&nic->ifname, &nic->ifindex) != 0)
+		goto error;
+
 	if (__ni_sysfs_ibft_nic_get_string(base, node,
 				"ip-addr", &temp) == 0 && temp) {
 		if (ni_sockaddr_parse(&nic->ipaddr, temp, AF_UNSPEC) != 0)
 			goto error;
 	}
-	if (__ni_sysfs_ibft_nic_get_string(base, node,
+	/* IPv6 aware kernels provide the ibft prefix length as is */
+	if (__ni_sysfs_ibft_nic_get_uint(base, node,
+				"prefix-len", &nic->prefix_len) != 0 &&
+	    __ni_sysfs_ibft_nic_get_string(base, node,
 				"subnet-mask", &temp) == 0 && temp) {
 		/* The ibft module in 3.0.x kernels prints the ibft prefix
 		   length as ipv4 netmask; I guess nobody ever used IPv6 */
@@ -1097,6 +1424,9 @@ ni_sysfs_netdev_get_pci(const char *ifname)
 	ni_pci_dev_t *pci = NULL;
 	const char *attr;
 
+	if (ni_sysfs_netif_foreign)
+		return NULL;
+
 	snprintf(pathbuf, sizeof(pathbuf), "%s/%s", NI_SYSFS_CLASS_NET_PATH, ifname);
 	if (readlink(pathbuf, device_link, sizeof(device_link)) < 0)
 		return NULL;
@@ -1109,11 +1439,11 @@ ni_sysfs_netdev_get_pci(const char *ifname)
 	*s = '\0';
 	pci = ni_pci_dev_new(pci_path);
 
-	if ((attr = __ni_sysfs_netif_get_attr(ifname, "device/vendor")) == NULL)
+	if ((attr = __ni_sysfs_netif_get_cached_attr(ifname, "device/vendor")) == NULL)
 		goto failed;
 	pci->vendor = strtoul(attr, NULL, 0);
 
-	if ((attr = __ni_sysfs_netif_get_attr(ifname, "device/device")) == NULL)
+	if ((attr = __ni_sysfs_netif_get_cached_attr(ifname, "device/device")) == NULL)
 		goto failed;
 	pci->device = strtoul(attr, NULL, 0);
 
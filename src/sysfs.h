@@ -32,12 +32,21 @@ extern int	ni_sysfs_netif_get_long(const char *, const char *, long *);
 extern int	ni_sysfs_netif_get_uint(const char *, const char *, unsigned int *);
 extern int	ni_sysfs_netif_get_ulong(const char *, const char *, unsigned long *);
 extern int	ni_sysfs_netif_get_string(const char *, const char *, char **);
+extern int	ni_sysfs_netif_get_cached_uint(const char *, const char *, unsigned int *);
+extern int	ni_sysfs_netif_get_cached_ulong(const char *, const char *, unsigned long *);
+extern int	ni_sysfs_netif_get_cached_string(const char *, const char *, char **);
+extern void	ni_sysfs_netif_cache_enable(ni_bool_t);
+extern void	ni_sysfs_netif_cache_invalidate(const char *);
+extern void	ni_sysfs_netif_set_foreign(ni_bool_t);
 extern int	ni_sysfs_netif_put_int(const char *, const char *, int);
 extern int	ni_sysfs_netif_put_long(const char *, const char *, long);
 extern int	ni_sysfs_netif_put_uint(const char *, const char *, unsigned int);
 extern int	ni_sysfs_netif_put_ulong(const char *, const char *, unsigned long);
 extern int	ni_sysfs_netif_put_string(const char *, const char *, const char *);
 extern int	ni_sysfs_netif_printf(const char *, const char *, const char *, ...);
+typedef void	ni_sysfs_netif_put_done_t(void *, const char *, const ni_var_array_t *, const int *);
+extern ni_bool_t ni_sysfs_netif_put_attrs_async(const char *, const ni_var_array_t *,
+				ni_sysfs_netif_put_done_t *, void *);
 extern ni_bool_t ni_sysfs_is_read_only(void);
 extern ni_bool_t ni_sysfs_netif_exists(const char *, const char *);
 extern ni_bool_t ni_sysfs_netif_readlink(const char *, const char *, char **);
@@ -1,5 +1,5 @@
 /*
- *	Interfacing with systemd using systemctl
+ *	Interfacing with systemd using its dbus api or systemctl
  *
  *	Copyright (C) 2016 SUSE Linux GmbH, Nuernberg, Germany.
  *
@@ -27,10 +27,35 @@
 
 #include <wicked/util.h>
 #include <wicked/logging.h>
+#include <wicked/time.h>
+#include <wicked/dbus.h>
 
+#include "systemctl.h"
 #include "buffer.h"
 #include "process.h"
 
+#define NI_SYSTEMD_BUS_NAME		"org.freedesktop.systemd1"
+#define NI_SYSTEMD_OBJECT_PATH		"/org/freedesktop/systemd1"
+#define NI_SYSTEMD_MANAGER_INTERFACE	NI_SYSTEMD_BUS_NAME ".Manager"
+#define NI_SYSTEMD_UNIT_INTERFACE	NI_SYSTEMD_BUS_NAME ".Unit"
+#define NI_SYSTEMD_SERVICE_INTERFACE	NI_SYSTEMD_BUS_NAME ".Service"
+#define NI_SYSTEMD_NO_SUCH_UNIT		NI_SYSTEMD_BUS_NAME ".NoSuchUnit"
+
+/* the start/stop job wait limit, above the default unit start timeout */
+#define NI_SYSTEMCTL_JOB_TIMEOUT	(120 * 1000)
+
+typedef struct ni_systemctl_job	ni_systemctl_job_t;
+struct ni_systemctl_job {
+	ni_systemctl_job_t *	next;
+	char *			path;
+	char *			result;		/* set by JobRemoved	*/
+};
+
+static ni_dbus_client_t *	ni_systemctl_dbus;
+static ni_bool_t		ni_systemctl_dbus_failed;
+static ni_bool_t		ni_systemctl_collecting;
+static ni_systemctl_job_t *	ni_systemctl_jobs;
+
 
 static const char *
 ni_systemctl_tool_path(void)
@@ -45,10 +70,10 @@ ni_systemctl_tool_path(void)
 }
 
 /*
- * systemd instance service methods
+ * systemd instance service methods using systemctl
  */
-int
-ni_systemctl_service_start(const char *service)
+static int
+ni_systemctl_exec_service_start(const char *service)
 {
 	const char *systemctl;
 	ni_shellcmd_t *cmd;
@@ -88,8 +113,8 @@ failure:
 	return -1;
 }
 
-int
-ni_systemctl_service_stop(const char *service)
+static int
+ni_systemctl_exec_service_stop(const char *service)
 {
 	const char *systemctl;
 	ni_shellcmd_t *cmd;
@@ -129,8 +154,8 @@ failure:
 	return -1;
 }
 
-const char *
-ni_systemctl_service_show_property(const char *service, const char *property, char **result)
+static const char *
+ni_systemctl_exec_service_show_property(const char *service, const char *property, char **result)
 {
 	const char *systemctl;
 	char *complete = NULL;
@@ -204,3 +229,399 @@ failure:
 	ni_buffer_destroy(&buf);
 	return NULL;
 }
+
+/*
+ * systemd instance service methods using the systemd dbus api:
+ * the start/stop calls return a job object path and the job result is
+ * reported by the JobRemoved signal, which systemd sends to the client
+ * requesting the job. All jobs of a batch are queued before we wait for
+ * their results, so systemd executes them in parallel.
+ */
+static ni_systemctl_job_t *
+ni_systemctl_job_find(const char *path)
+{
+	ni_systemctl_job_t *job;
+
+	for (job = ni_systemctl_jobs; job; job = job->next) {
+		if (ni_string_eq(job->path, path))
+			return job;
+	}
+	return NULL;
+}
+
+static ni_systemctl_job_t *
+ni_systemctl_job_track(const char *path)
+{
+	ni_systemctl_job_t *job;
+
+	if ((job = ni_systemctl_job_find(path)))
+		return job;
+
+	job = xcalloc(1, sizeof(*job));
+	ni_string_dup(&job->path, path);
+	job->next = ni_systemctl_jobs;
+	ni_systemctl_jobs = job;
+	return job;
+}
+
+static void
+ni_systemctl_jobs_destroy(void)
+{
+	ni_systemctl_job_t *job;
+
+	while ((job = ni_systemctl_jobs)) {
+		ni_systemctl_jobs = job->next;
+		ni_string_free(&job->path);
+		ni_string_free(&job->result);
+		free(job);
+	}
+}
+
+static void
+ni_systemctl_dbus_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg, void *user_data)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	const char *path, *unit, *result;
+	ni_systemctl_job_t *job;
+	uint32_t id;
+
+	(void)conn;
+	(void)user_data;
+
+	if (!ni_systemctl_collecting || !ni_string_eq(dbus_message_get_member(msg), "JobRemoved"))
+		return;
+
+	if (!dbus_message_get_args(msg, &error,
+				DBUS_TYPE_UINT32, &id,
+				DBUS_TYPE_OBJECT_PATH, &path,
+				DBUS_TYPE_STRING, &unit,
+				DBUS_TYPE_STRING, &result,
+				DBUS_TYPE_INVALID)) {
+		dbus_error_free(&error);
+		return;
+	}
+
+	/* the signal may arrive before we've seen the job in the call reply */
+	job = ni_systemctl_job_track(path);
+	ni_string_dup(&job->result, result);
+
+	ni_debug_dbus("systemd job %u for %s removed: %s", id, unit, result);
+}
+
+static ni_dbus_client_t *
+ni_systemctl_dbus_client(void)
+{
+	if (ni_systemctl_dbus || ni_systemctl_dbus_failed)
+		return ni_systemctl_dbus;
+
+	if (!(ni_systemctl_dbus = ni_dbus_client_open("system", NI_SYSTEMD_BUS_NAME))) {
+		ni_debug_dbus("unable to connect to systemd, using systemctl");
+		ni_systemctl_dbus_failed = TRUE;
+		return NULL;
+	}
+
+	ni_dbus_client_add_signal_handler(ni_systemctl_dbus, NI_SYSTEMD_BUS_NAME,
+			NI_SYSTEMD_OBJECT_PATH, NI_SYSTEMD_MANAGER_INTERFACE,
+			ni_systemctl_dbus_signal, NULL);
+	return ni_systemctl_dbus;
+}
+
+static ni_bool_t
+ni_systemctl_dbus_unavailable(const DBusError *error)
+{
+	return dbus_error_has_name(error, DBUS_ERROR_SERVICE_UNKNOWN) ||
+	       dbus_error_has_name(error, DBUS_ERROR_NAME_HAS_NO_OWNER) ||
+	       dbus_error_has_name(error, DBUS_ERROR_DISCONNECTED);
+}
+
+static ni_dbus_message_t *
+ni_systemctl_dbus_call(const char *path, const char *interface, const char *method,
+		const char *arg1, const char *arg2, DBusError *error)
+{
+	ni_dbus_client_t *client;
+	ni_dbus_message_t *call, *reply;
+
+	if (!(client = ni_systemctl_dbus_client())) {
+		dbus_set_error(error, DBUS_ERROR_DISCONNECTED, "not connected");
+		return NULL;
+	}
+
+	call = dbus_message_new_method_call(NI_SYSTEMD_BUS_NAME, path, interface, method);
+	if (!call || !dbus_message_append_args(call, DBUS_TYPE_STRING, &arg1, DBUS_TYPE_INVALID) ||
+	    (arg2 && !dbus_message_append_args(call, DBUS_TYPE_STRING, &arg2, DBUS_TYPE_INVALID))) {
+		if (call)
+			dbus_message_unref(call);
+		dbus_set_error(error, DBUS_ERROR_NO_MEMORY, "unable to build call");
+		return NULL;
+	}
+
+	reply = ni_dbus_client_call(client, call, error);
+	dbus_message_unref(call);
+	return reply;
+}
+
+/*
+ * Queue the StartUnit/StopUnit jobs for all units and wait for them.
+ * Returns -1 when systemd isn't reachable via dbus, otherwise 0 with
+ * per unit status: 0 on success, 1 when the job failed, -1 on error.
+ */
+static int
+ni_systemctl_dbus_jobs(const char *method, const ni_string_array_t *units, int *status)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	struct timeval now, deadline;
+	ni_systemctl_job_t *job;
+	ni_dbus_message_t *reply;
+	ni_timeout_t left;
+	unsigned int i, pending;
+	const char *path;
+	char **paths;
+
+	if (!ni_systemctl_dbus_client())
+		return -1;
+
+	paths = xcalloc(units->count, sizeof(*paths));
+	ni_systemctl_collecting = TRUE;
+
+	for (pending = i = 0; i < units->count; ++i) {
+		status[i] = -1;
+
+		reply = ni_systemctl_dbus_call(NI_SYSTEMD_OBJECT_PATH,
+				NI_SYSTEMD_MANAGER_INTERFACE, method,
+				units->data[i], "replace", &error);
+		if (!reply) {
+			if (i == 0 && ni_systemctl_dbus_unavailable(&error)) {
+				dbus_error_free(&error);
+				free(paths);
+				ni_systemctl_collecting = FALSE;
+				ni_systemctl_jobs_destroy();
+				return -1;
+			}
+			if (dbus_error_has_name(&error, NI_SYSTEMD_NO_SUCH_UNIT) &&
+			    ni_string_eq(method, "StopUnit")) {
+				/* not loaded, thus not running */
+				status[i] = 0;
+			} else {
+				ni_error("systemd %s(%s) failed: %s", method,
+						units->data[i], error.message);
+			}
+			dbus_error_free(&error);
+			continue;
+		}
+
+		if (dbus_message_get_args(reply, &error,
+					DBUS_TYPE_OBJECT_PATH, &path,
+					DBUS_TYPE_INVALID)) {
+			ni_systemctl_job_track(path);
+			ni_string_dup(&paths[i], path);
+			pending++;
+		} else {
+			ni_error("systemd %s(%s): unexpected reply: %s", method,
+					units->data[i], error.message);
+			dbus_error_free(&error);
+		}
+		dbus_message_unref(reply);
+	}
+
+	ni_timer_get_time(&deadline);
+	ni_timeval_add_timeout(&deadline, NI_SYSTEMCTL_JOB_TIMEOUT);
+	while (pending) {
+		for (pending = i = 0; i < units->count; ++i) {
+			if (paths[i] && (job = ni_systemctl_job_find(paths[i])) && !job->result)
+				pending++;
+		}
+		if (!pending)
+			break;
+
+		ni_timer_get_time(&now);
+		if (!(left = ni_timeout_left(&deadline, &now, NULL)) ||
+		    !ni_dbus_client_wait(ni_systemctl_dbus, left))
+			break;
+	}
+
+	for (i = 0; i < units->count; ++i) {
+		if (!paths[i])
+			continue;
+
+		job = ni_systemctl_job_find(paths[i]);
+		if (!job || !job->result) {
+			ni_warn("systemd %s(%s): no job result received",
+					method, units->data[i]);
+		} else if (ni_string_eq(job->result, "done")) {
+			status[i] = 0;
+		} else {
+			ni_info("systemd %s(%s) job result: %s",
+					method, units->data[i], job->result);
+			status[i] = 1;
+		}
+		ni_string_free(&paths[i]);
+	}
+	free(paths);
+
+	ni_systemctl_collecting = FALSE;
+	ni_systemctl_jobs_destroy();
+	return 0;
+}
+
+static int
+ni_systemctl_services_run(const char *method, const ni_string_array_t *services,
+		int (*fallback)(const char *))
+{
+	unsigned int i;
+	int *status;
+	int rv = 0;
+
+	if (!services || !services->count)
+		return -1;
+
+	for (i = 0; i < services->count; ++i) {
+		if (ni_string_empty(services->data[i]))
+			return -1;
+	}
+
+	status = xcalloc(services->count, sizeof(*status));
+	if (ni_systemctl_dbus_jobs(method, services, status) < 0) {
+		for (i = 0; i < services->count; ++i)
+			status[i] = fallback(services->data[i]);
+	}
+
+	/* the worst result: an error or a failed job */
+	for (i = 0; i < services->count; ++i) {
+		if (status[i] < 0)
+			rv = status[i];
+		else if (status[i] > 0 && rv == 0)
+			rv = status[i];
+	}
+	free(status);
+	return rv;
+}
+
+int
+ni_systemctl_services_start(const ni_string_array_t *services)
+{
+	return ni_systemctl_services_run("StartUnit", services,
+			ni_systemctl_exec_service_start);
+}
+
+int
+ni_systemctl_services_stop(const ni_string_array_t *services)
+{
+	return ni_systemctl_services_run("StopUnit", services,
+			ni_systemctl_exec_service_stop);
+}
+
+int
+ni_systemctl_service_start(const char *service)
+{
+	char *units[] = { (char *)service };
+	ni_string_array_t services = { .count = 1, .data = units };
+
+	return ni_systemctl_services_start(&services);
+}
+
+int
+ni_systemctl_service_stop(const char *service)
+{
+	char *units[] = { (char *)service };
+	ni_string_array_t services = { .count = 1, .data = units };
+
+	return ni_systemctl_services_stop(&services);
+}
+
+static const char *
+ni_systemctl_dbus_property_get(const char *path, const char *interface,
+		const char *property, char **result, DBusError *error)
+{
+	DBusMessageIter iter, value;
+	ni_dbus_message_t *reply;
+	DBusBasicValue basic;
+
+	reply = ni_systemctl_dbus_call(path, "org.freedesktop.DBus.Properties",
+			"Get", interface, property, error);
+	if (!reply)
+		return NULL;
+
+	ni_string_free(result);
+	if (dbus_message_iter_init(reply, &iter) &&
+	    dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_VARIANT) {
+		dbus_message_iter_recurse(&iter, &value);
+		if (dbus_type_is_basic(dbus_message_iter_get_arg_type(&value)))
+			dbus_message_iter_get_basic(&value, &basic);
+
+		/* formatted as systemctl show does it */
+		switch (dbus_message_iter_get_arg_type(&value)) {
+		case DBUS_TYPE_STRING:
+		case DBUS_TYPE_OBJECT_PATH:
+			ni_string_dup(result, basic.str);
+			break;
+		case DBUS_TYPE_BOOLEAN:
+			ni_string_dup(result, basic.bool_val ? "yes" : "no");
+			break;
+		case DBUS_TYPE_INT32:
+			ni_string_printf(result, "%d", basic.i32);
+			break;
+		case DBUS_TYPE_UINT32:
+			ni_string_printf(result, "%u", basic.u32);
+			break;
+		case DBUS_TYPE_INT64:
+			ni_string_printf(result, "%lld", (long long)basic.i64);
+			break;
+		case DBUS_TYPE_UINT64:
+			ni_string_printf(result, "%llu", (unsigned long long)basic.u64);
+			break;
+		default:
+			dbus_set_error(error, DBUS_ERROR_NOT_SUPPORTED,
+					"unsupported property type");
+			break;
+		}
+	}
+	dbus_message_unref(reply);
+	return *result;
+}
+
+const char *
+ni_systemctl_service_show_property(const char *service, const char *property, char **result)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_message_t *reply;
+	const char *path, *ret = NULL;
+	char *unit = NULL;
+
+	if (ni_string_empty(service) || ni_string_empty(property) || !result)
+		return NULL;
+
+	if (!(reply = ni_systemctl_dbus_call(NI_SYSTEMD_OBJECT_PATH,
+				NI_SYSTEMD_MANAGER_INTERFACE, "LoadUnit",
+				service, NULL, &error))) {
+		if (!ni_systemctl_dbus_client() || ni_systemctl_dbus_unavailable(&error)) {
+			dbus_error_free(&error);
+			return ni_systemctl_exec_service_show_property(service,
+					property, result);
+		}
+		ni_debug_dbus("systemd LoadUnit(%s) failed: %s", service, error.message);
+		dbus_error_free(&error);
+		return NULL;
+	}
+
+	if (dbus_message_get_args(reply, &error, DBUS_TYPE_OBJECT_PATH, &path,
+				DBUS_TYPE_INVALID))
+		ni_string_dup(&unit, path);
+	dbus_error_free(&error);
+	dbus_message_unref(reply);
+	if (!unit)
+		return NULL;
+
+	/* generic unit properties (e.g. SubState) or service ones (BusName) */
+	if (!(ret = ni_systemctl_dbus_property_get(unit, NI_SYSTEMD_UNIT_INTERFACE,
+					property, result, &error))) {
+		dbus_error_free(&error);
+		ret = ni_systemctl_dbus_property_get(unit, NI_SYSTEMD_SERVICE_INTERFACE,
+					property, result, &error);
+	}
+	if (!ret)
+		ni_debug_dbus("systemd %s property %s: %s", service, property,
+				error.message ? error.message : "unavailable");
+	dbus_error_free(&error);
+	ni_string_free(&unit);
+	return ret;
+}
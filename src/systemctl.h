@@ -28,6 +28,8 @@
  */
 extern int		ni_systemctl_service_start(const char *);
 extern int		ni_systemctl_service_stop(const char *);
+extern int		ni_systemctl_services_start(const ni_string_array_t *);
+extern int		ni_systemctl_services_stop(const ni_string_array_t *);
 
 extern const char *	ni_systemctl_service_show_property(const char *, const char *, char **);
 
@@ -735,63 +735,153 @@ ni_teamd_port_config_json(const ni_team_port_config_t *config)
 	return object;
 }
 
-int
-ni_teamd_port_enslave(const ni_netdev_t *master, const ni_netdev_t *port, const ni_team_port_config_t *config)
+/*
+ * Port batches collect the port removals and additions with their
+ * config updates of a team and apply them using one teamd client,
+ * followed by a single rediscovery of the team device.
+ */
+struct ni_teamd_port_batch {
+	ni_string_array_t	remove;
+	ni_var_array_t		add;		/* port name and json config */
+};
+
+ni_teamd_port_batch_t *
+ni_teamd_port_batch_new(void)
 {
-	ni_stringbuf_t dump = NI_STRINGBUF_INIT_DYNAMIC;
-	ni_teamd_client_t *tdc;
-	int ret = -1;
+	ni_teamd_port_batch_t *batch;
 
-	if (!master || !master->name || !port || !port->name)
-		return -1;
+	batch = xcalloc(1, sizeof(*batch));
+	ni_string_array_init(&batch->remove);
+	ni_var_array_init(&batch->add);
+	return batch;
+}
 
-	if (!(tdc = ni_teamd_client_open(master->name)))
-		return -1;
+void
+ni_teamd_port_batch_free(ni_teamd_port_batch_t *batch)
+{
+	if (batch) {
+		ni_string_array_destroy(&batch->remove);
+		ni_var_array_destroy(&batch->add);
+		free(batch);
+	}
+}
 
-	if (ni_teamd_ctl_port_add(tdc, port->name) < 0)
-		goto failure;
+ni_bool_t
+ni_teamd_port_batch_add(ni_teamd_port_batch_t *batch, const ni_netdev_t *port,
+			const ni_team_port_config_t *config)
+{
+	ni_stringbuf_t dump = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_bool_t ret;
+
+	if (!batch || !port || ni_string_empty(port->name))
+		return FALSE;
 
 	if (config) {
 		ni_json_t *object = ni_teamd_port_config_json(config);
 
-		if (ni_json_format_string(&dump, object, NULL)) {
-			ni_teamd_ctl_port_config_update(tdc, port->name, dump.string);
-		} else {
+		if (!ni_json_format_string(&dump, object, NULL))
 			ni_debug_application("Unable to format %s team port config update", port->name);
-		}
 		ni_json_free(object);
-		ni_stringbuf_destroy(&dump);
 	}
 
-	ret = 0;
+	ret = ni_var_array_append(&batch->add, port->name, dump.string);
+	ni_stringbuf_destroy(&dump);
+	return ret;
+}
 
-failure:
-	ni_teamd_client_free(tdc);
+ni_bool_t
+ni_teamd_port_batch_remove(ni_teamd_port_batch_t *batch, const ni_netdev_t *port)
+{
+	if (!batch || !port || ni_string_empty(port->name))
+		return FALSE;
+
+	return ni_string_array_append(&batch->remove, port->name) == 0;
+}
+
+static int
+ni_teamd_port_batch_apply(ni_teamd_port_batch_t *batch, ni_teamd_client_t *tdc)
+{
+	const ni_var_t *var;
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < batch->remove.count; ++i) {
+		if (ni_teamd_ctl_port_remove(tdc, batch->remove.data[i]) < 0)
+			ret = -1;
+	}
+
+	for (i = 0; i < batch->add.count; ++i) {
+		var = &batch->add.data[i];
+
+		if (ni_teamd_ctl_port_add(tdc, var->name) < 0) {
+			ret = -1;
+			continue;
+		}
+		if (!ni_string_empty(var->value))
+			ni_teamd_ctl_port_config_update(tdc, var->name, var->value);
+	}
 	return ret;
 }
 
+static int			ni_teamd_discover_client(ni_netdev_t *, ni_teamd_client_t *);
+
+/*
+ * Apply the batch to the team master; a non-NULL refresh device
+ * (the master) is rediscovered afterwards, also on failure.
+ */
 int
-ni_teamd_port_unenslave(const ni_netdev_t *master, const ni_netdev_t *port)
+ni_teamd_port_batch_commit(ni_teamd_port_batch_t *batch, const ni_netdev_t *master,
+			ni_netdev_t *refresh)
 {
 	ni_teamd_client_t *tdc;
-	int ret = -1;
+	int ret;
 
-	if (!master || !master->name || !port || !port->name)
+	if (!batch || !master || !master->name)
 		return -1;
 
 	if (!(tdc = ni_teamd_client_open(master->name)))
 		return -1;
 
-	if (ni_teamd_ctl_port_remove(tdc, port->name) < 0)
-		goto failure;
-
-	ret = 0;
+	ret = ni_teamd_port_batch_apply(batch, tdc);
+	if (refresh && refresh->link.type == NI_IFTYPE_TEAM)
+		ni_teamd_discover_client(refresh, tdc);
 
-failure:
 	ni_teamd_client_free(tdc);
 	return ret;
 }
 
+int
+ni_teamd_port_enslave(const ni_netdev_t *master, const ni_netdev_t *port, const ni_team_port_config_t *config)
+{
+	ni_teamd_port_batch_t *batch;
+	int ret = -1;
+
+	if (!master || !master->name || !port || !port->name)
+		return -1;
+
+	batch = ni_teamd_port_batch_new();
+	if (ni_teamd_port_batch_add(batch, port, config))
+		ret = ni_teamd_port_batch_commit(batch, master, NULL);
+	ni_teamd_port_batch_free(batch);
+	return ret;
+}
+
+int
+ni_teamd_port_unenslave(const ni_netdev_t *master, const ni_netdev_t *port)
+{
+	ni_teamd_port_batch_t *batch;
+	int ret = -1;
+
+	if (!master || !master->name || !port || !port->name)
+		return -1;
+
+	batch = ni_teamd_port_batch_new();
+	if (ni_teamd_port_batch_remove(batch, port))
+		ret = ni_teamd_port_batch_commit(batch, master, NULL);
+	ni_teamd_port_batch_free(batch);
+	return ret;
+}
+
 
 /*
  * teamd discovery
@@ -1150,30 +1240,38 @@ ni_teamd_discover_mcast_rejoin(ni_team_t *team, ni_json_t *conf)
 		team->mcast_rejoin.interval = i64;
 }
 
-int
-ni_teamd_discover(ni_netdev_t *dev)
+/*
+ * The config sections ni_teamd_discover evaluates, the others
+ * of the config dump are skipped while parsing.
+ */
+static const char * const	ni_teamd_discover_members[] = {
+	"debug_level",
+	"notify_peers",
+	"mcast_rejoin",
+	"runner",
+	"link_watch_policy",
+	"link_watch",
+	"ports",
+	NULL
+};
+
+static int
+ni_teamd_discover_client(ni_netdev_t *dev, ni_teamd_client_t *tdc)
 {
-	ni_teamd_client_t *tdc = NULL;
 	ni_json_t *conf = NULL;
 	ni_team_t *team = NULL;
 	char *val = NULL;
 	int64_t i64;
 
-	if (!dev || dev->link.type != NI_IFTYPE_TEAM)
-		return -1;
-
 	/* we are about to replace dev->team, so just
 	 * allocate new one we can drop at any time */
 	if (!(team = ni_team_new()))
 		goto failure;
 
-	if (!(tdc = ni_teamd_client_open(dev->name)))
-		goto failure;
-
 	if (ni_teamd_ctl_config_dump(tdc, TRUE, &val) < 0)
 		goto failure;
 
-	if (!(conf = ni_json_parse_string(val)))
+	if (!(conf = ni_json_parse_string_members(val, ni_teamd_discover_members)))
 		goto failure;
 
 	if (ni_json_int64_get(ni_json_object_get_value(conf, "debug_level"), &i64) && i64 < UINT_MAX)
@@ -1194,7 +1292,6 @@ ni_teamd_discover(ni_netdev_t *dev)
 		goto failure;
 
 	ni_netdev_set_team(dev, team);
-	ni_teamd_client_free(tdc);
 	ni_json_free(conf);
 	ni_string_free(&val);
 	return 0;
@@ -1202,11 +1299,59 @@ ni_teamd_discover(ni_netdev_t *dev)
 failure:
 	ni_json_free(conf);
 	ni_team_free(team);
-	ni_teamd_client_free(tdc);
 	ni_string_free(&val);
 	return -1;
 }
 
+int
+ni_teamd_discover(ni_netdev_t *dev)
+{
+	ni_teamd_client_t *tdc;
+	int ret;
+
+	if (!dev || dev->link.type != NI_IFTYPE_TEAM)
+		return -1;
+
+	if (!(tdc = ni_teamd_client_open(dev->name)))
+		return -1;
+
+	ret = ni_teamd_discover_client(dev, tdc);
+	ni_teamd_client_free(tdc);
+	return ret;
+}
+
+/*
+ * teamd does not signal config changes, so the rtnl events are used
+ * instead: on refresh, the team config discovered before is kept,
+ * unless the ports enslaved to the device differ from the discovered
+ * ones. Port changes made by wicked discover the team explicitly.
+ */
+static ni_bool_t
+ni_teamd_ports_changed(const ni_netdev_t *dev, ni_netconfig_t *nc)
+{
+	ni_team_t *team = dev->team;
+	unsigned int count = 0;
+	ni_netdev_t *port;
+
+	for (port = ni_netconfig_devlist(nc); port; port = port->next) {
+		if (port->link.masterdev.index != dev->link.ifindex)
+			continue;
+
+		if (!ni_team_port_array_find_by_name(&team->ports, port->name))
+			return TRUE;
+		count++;
+	}
+	return count != team->ports.count;
+}
+
+int
+ni_teamd_refresh(ni_netdev_t *dev, ni_netconfig_t *nc)
+{
+	if (!dev || !nc || !dev->team || ni_teamd_ports_changed(dev, nc))
+		return ni_teamd_discover(dev);
+	return 0;
+}
+
 /*
  * teamd startup config file
  */
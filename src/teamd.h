@@ -29,6 +29,7 @@
 #include <wicked/team.h>
 
 typedef struct ni_teamd_client		ni_teamd_client_t;
+typedef struct ni_teamd_port_batch	ni_teamd_port_batch_t;
 
 ni_teamd_client_t *			ni_teamd_client_open(const char*);
 void					ni_teamd_client_free(ni_teamd_client_t *);
@@ -45,7 +46,16 @@ extern int				ni_teamd_ctl_port_config_update(ni_teamd_client_t *, const char *,
 extern int				ni_teamd_port_enslave(const ni_netdev_t *, const ni_netdev_t *, const ni_team_port_config_t *);
 extern int				ni_teamd_port_unenslave(const ni_netdev_t *, const ni_netdev_t *);
 
+extern ni_teamd_port_batch_t *		ni_teamd_port_batch_new(void);
+extern void				ni_teamd_port_batch_free(ni_teamd_port_batch_t *);
+extern ni_bool_t			ni_teamd_port_batch_add(ni_teamd_port_batch_t *, const ni_netdev_t *,
+								const ni_team_port_config_t *);
+extern ni_bool_t			ni_teamd_port_batch_remove(ni_teamd_port_batch_t *, const ni_netdev_t *);
+extern int				ni_teamd_port_batch_commit(ni_teamd_port_batch_t *, const ni_netdev_t *,
+								ni_netdev_t *);
+
 extern int				ni_teamd_discover(ni_netdev_t *);
+extern int				ni_teamd_refresh(ni_netdev_t *, ni_netconfig_t *);
 
 extern int				ni_teamd_service_start(const ni_netdev_t *);
 extern int				ni_teamd_service_stop (const char *);
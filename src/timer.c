@@ -15,46 +15,208 @@
 
 #include "netinfo_priv.h"
 #include "util_priv.h"
+#include "stats.h"
+#include "probes.h"
+
+#define NI_TIMER_HEAP_CHUNK	64
+#define NI_TIMER_HASH_MIN_SIZE	64
 
 struct ni_timer {
-	ni_timer_t *		next;
+	unsigned int		index;
+	unsigned int		seqno;
+	ni_timer_t *		hnext;
 	unsigned int		ident;
 	struct timeval		expires;
 	ni_timeout_callback_t	*callback;
 	void *			user_data;
 };
 
-static ni_timer_t *		ni_timer_list;
+/*
+ * The armed timers are kept in a binary min-heap ordered by expiry
+ * (and arm sequence for equal expiry), giving O(log N) arm/disarm.
+ * A pointer hash of the armed timers lets us verify a handle before
+ * touching it, as callers may cancel timers that already expired.
+ */
+typedef struct ni_timer_heap {
+	unsigned int		count;
+	unsigned int		size;
+	ni_timer_t **		data;
+
+	unsigned int		seqno;
+
+	unsigned int		hsize;
+	ni_timer_t **		hash;
+} ni_timer_heap_t;
+
+static ni_timer_heap_t		ni_timer_heap;
 
 static ni_bool_t		ni_timer_arm(ni_timer_t *, ni_timeout_t);
 static ni_timer_t *		ni_timer_disarm(const ni_timer_t *);
 
-static inline void
-ni_timer_list_insert(ni_timer_t **list, ni_timer_t *timer)
+static inline unsigned int
+ni_timer_hash_slot(const ni_timer_heap_t *heap, const ni_timer_t *timer)
 {
-	ni_timer_t *tail, **pos;
+	unsigned long key = (unsigned long)timer / sizeof(void *);
 
-	for (pos = list; (tail = *pos) != NULL; pos = &tail->next) {
-		if (timercmp(&timer->expires, &tail->expires, <))
-			break;
+	return (unsigned int)(key * 2654435761UL) & (heap->hsize - 1);
+}
+
+static ni_bool_t
+ni_timer_hash_rebuild(ni_timer_heap_t *heap, unsigned int hsize)
+{
+	ni_timer_t **hash, *timer;
+	unsigned int i, slot;
+
+	if (!(hash = calloc(hsize, sizeof(*hash))))
+		return FALSE;
+
+	free(heap->hash);
+	heap->hash = hash;
+	heap->hsize = hsize;
+
+	for (i = 0; i < heap->count; ++i) {
+		timer = heap->data[i];
+		slot = ni_timer_hash_slot(heap, timer);
+		timer->hnext = heap->hash[slot];
+		heap->hash[slot] = timer;
 	}
-	timer->next = tail;
-	*pos = timer;
+	return TRUE;
 }
 
 static inline ni_timer_t *
-ni_timer_list_remove(ni_timer_t **list, const ni_timer_t *timer)
+ni_timer_hash_find(const ni_timer_heap_t *heap, const ni_timer_t *handle)
+{
+	ni_timer_t *timer;
+
+	if (!heap->hsize)
+		return NULL;
+
+	for (timer = heap->hash[ni_timer_hash_slot(heap, handle)]; timer; timer = timer->hnext) {
+		if (timer == handle)
+			return timer;
+	}
+	return NULL;
+}
+
+static inline void
+ni_timer_hash_remove(ni_timer_heap_t *heap, ni_timer_t *timer)
 {
 	ni_timer_t **pos, *cur;
 
-	for (pos = list; (cur = *pos) != NULL; pos = &cur->next) {
+	for (pos = &heap->hash[ni_timer_hash_slot(heap, timer)]; (cur = *pos); pos = &cur->hnext) {
 		if (cur == timer) {
-			*pos = cur->next;
-			cur->next = NULL;
-			return cur;
+			*pos = cur->hnext;
+			cur->hnext = NULL;
+			return;
 		}
 	}
-	return NULL;
+}
+
+static inline ni_bool_t
+ni_timer_heap_less(const ni_timer_t *a, const ni_timer_t *b)
+{
+	if (timercmp(&a->expires, &b->expires, !=))
+		return timercmp(&a->expires, &b->expires, <);
+	/* wrap-around safe arm order of equal expiry timers */
+	return (int)(a->seqno - b->seqno) < 0;
+}
+
+static inline void
+ni_timer_heap_set(ni_timer_heap_t *heap, unsigned int index, ni_timer_t *timer)
+{
+	heap->data[index] = timer;
+	timer->index = index;
+}
+
+static void
+ni_timer_heap_sift_up(ni_timer_heap_t *heap, unsigned int index)
+{
+	ni_timer_t *timer = heap->data[index];
+	unsigned int parent;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+		if (!ni_timer_heap_less(timer, heap->data[parent]))
+			break;
+		ni_timer_heap_set(heap, index, heap->data[parent]);
+		index = parent;
+	}
+	ni_timer_heap_set(heap, index, timer);
+}
+
+static void
+ni_timer_heap_sift_down(ni_timer_heap_t *heap, unsigned int index)
+{
+	ni_timer_t *timer = heap->data[index];
+	unsigned int child;
+
+	while ((child = 2 * index + 1) < heap->count) {
+		if (child + 1 < heap->count &&
+		    ni_timer_heap_less(heap->data[child + 1], heap->data[child]))
+			child++;
+		if (!ni_timer_heap_less(heap->data[child], timer))
+			break;
+		ni_timer_heap_set(heap, index, heap->data[child]);
+		index = child;
+	}
+	ni_timer_heap_set(heap, index, timer);
+}
+
+static ni_bool_t
+ni_timer_heap_insert(ni_timer_heap_t *heap, ni_timer_t *timer)
+{
+	unsigned int slot;
+
+	if (heap->count == heap->size) {
+		unsigned int size = heap->size + NI_TIMER_HEAP_CHUNK;
+		ni_timer_t **data;
+
+		if (!(data = realloc(heap->data, size * sizeof(*data))))
+			return FALSE;
+		heap->data = data;
+		heap->size = size;
+	}
+
+	if (!heap->hsize || heap->count >= heap->hsize) {
+		unsigned int hsize = heap->hsize ? heap->hsize * 2 : NI_TIMER_HASH_MIN_SIZE;
+
+		if (!ni_timer_hash_rebuild(heap, hsize) && !heap->hsize)
+			return FALSE;
+	}
+
+	timer->seqno = heap->seqno++;
+	ni_timer_heap_set(heap, heap->count++, timer);
+	ni_timer_heap_sift_up(heap, timer->index);
+
+	slot = ni_timer_hash_slot(heap, timer);
+	timer->hnext = heap->hash[slot];
+	heap->hash[slot] = timer;
+	return TRUE;
+}
+
+static void
+ni_timer_heap_remove(ni_timer_heap_t *heap, ni_timer_t *timer)
+{
+	unsigned int index = timer->index;
+	ni_timer_t *last;
+
+	ni_timer_hash_remove(heap, timer);
+
+	last = heap->data[--heap->count];
+	heap->data[heap->count] = NULL;
+	if (last != timer) {
+		ni_timer_heap_set(heap, index, last);
+		if (index > 0 && ni_timer_heap_less(last, heap->data[(index - 1) / 2]))
+			ni_timer_heap_sift_up(heap, index);
+		else
+			ni_timer_heap_sift_down(heap, index);
+	}
+}
+
+static inline ni_timer_t *
+ni_timer_heap_first(const ni_timer_heap_t *heap)
+{
+	return heap->count ? heap->data[0] : NULL;
 }
 
 const ni_timer_t *
@@ -72,6 +234,7 @@ ni_timer_register(ni_timeout_t timeout, ni_timeout_callback_t *callback, void *d
 		timer->ident = ++id_counter;
 
 	if (ni_timer_arm(timer, timeout)) {
+		ni_stats_inc(NI_STATS_TIMERS_REGISTERED);
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: timer %p id %x registered with callback %p/%p",
 				__func__, timer, timer->ident, callback, data);
@@ -90,6 +253,7 @@ ni_timer_cancel(const ni_timer_t *handle)
 
 	if ((timer = ni_timer_disarm(handle)) != NULL) {
 		user_data = timer->user_data;
+		ni_stats_inc(NI_STATS_TIMERS_CANCELED);
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: timer %p id %x canceled",
 				__func__, timer, timer->ident);
@@ -107,9 +271,12 @@ ni_timer_rearm(const ni_timer_t *handle, ni_timeout_t timeout)
 {
 	ni_timer_t *timer;
 
-	if ((timer = ni_timer_disarm(handle)) != NULL)
-		ni_timer_arm(timer, timeout);
-	else
+	if ((timer = ni_timer_disarm(handle)) != NULL) {
+		if (!ni_timer_arm(timer, timeout)) {
+			free(timer);
+			timer = NULL;
+		}
+	} else
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: timer %p NOT found",
 				__func__, handle);
@@ -129,7 +296,7 @@ ni_timer_next_timeout(void)
 	if (ni_timer_get_time(&now))
 		return NI_TIMEOUT_INFINITE;
 
-	while ((timer = ni_timer_list) != NULL) {
+	while ((timer = ni_timer_heap_first(&ni_timer_heap)) != NULL) {
 		if (timer->expires.tv_sec == LONG_MAX) {
 			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 					"%s: timer %p id %x next timeout is infinite",
@@ -152,7 +319,9 @@ ni_timer_next_timeout(void)
 				now.tv_sec, now.tv_usec,
 				timer->expires.tv_sec, timer->expires.tv_usec);
 
-		ni_timer_list = timer->next;
+		ni_timer_heap_remove(&ni_timer_heap, timer);
+		ni_stats_inc(NI_STATS_TIMERS_FIRED);
+		NI_PROBE3(timer_fire, timer->ident, timer->callback, timer->user_data);
 		timer->callback(timer->user_data, timer);
 		free(timer);
 	}
@@ -167,7 +336,8 @@ ni_timer_arm(ni_timer_t *timer, ni_timeout_t timeout)
 		return FALSE;
 
 	ni_timeval_add_timeout(&timer->expires, timeout);
-	ni_timer_list_insert(&ni_timer_list, timer);
+	if (!ni_timer_heap_insert(&ni_timer_heap, timer))
+		return FALSE;
 
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 			"%s: timer %p id %x armed with timeout %u.%03u (expires=%ld.%06ld)",
@@ -182,7 +352,8 @@ ni_timer_disarm(const ni_timer_t *handle)
 {
 	ni_timer_t *timer;
 
-	if (handle && (timer = ni_timer_list_remove(&ni_timer_list, handle))) {
+	if (handle && (timer = ni_timer_hash_find(&ni_timer_heap, handle))) {
+		ni_timer_heap_remove(&ni_timer_heap, timer);
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: timer %p id %x disarmed",
 				__func__, timer, timer->ident);
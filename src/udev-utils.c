@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <unistd.h>
 
@@ -43,6 +44,9 @@
 #ifndef _PATH_SYS_CLASS_NET
 #define _PATH_SYS_CLASS_NET	"/sys/class/net"
 #endif
+#ifndef _PATH_UDEV_DATA
+#define _PATH_UDEV_DATA		"/run/udev/data"
+#endif
 
 struct netdev_uinfo {
 	unsigned int	ifindex;
@@ -302,6 +306,59 @@ netdev_uinfo_ready(const ni_var_array_t *vars, const char *ifname, unsigned int
 	return -1;
 }
 
+/*
+ * Check the net device readiness in the udev database directly, which
+ * udevd writes to /run/udev/data/n<ifindex> after the rules processing,
+ * with the device tags (udevadm info TAGS) in "G:<tag>" lines.
+ * Returns 1 when the database is not available at all, otherwise the
+ * same result as netdev_uinfo_ready.
+ */
+static int
+netdev_udev_db_ready(const char *ifname, unsigned int ifindex)
+{
+	char path[PATH_MAX], line[PATH_MAX];
+	ni_bool_t systemd = FALSE;
+	size_t len;
+	FILE *fp;
+
+	if (!ni_isdir(_PATH_UDEV_DATA))
+		return 1;
+
+	snprintf(path, sizeof(path), "%s/n%u", _PATH_UDEV_DATA, ifindex);
+	if (!(fp = fopen(path, "re"))) {
+		ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_EVENTS,
+				"%s[%u] udev db: not (yet) processed",
+				ifname, ifindex);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		len = strcspn(line, "\r\n");
+		line[len] = '\0';
+
+		ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_EVENTS,
+				"udev db %s: %s", ifname, line);
+
+		if (ni_string_eq(line, "G:systemd")) {
+			systemd = TRUE;
+		} else
+		if (ni_string_startswith(line, "E:INTERFACE_OLD=") &&
+		    line[sizeof("E:INTERFACE_OLD=") - 1]) {
+			ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_EVENTS,
+					"%s[%u] udev db: interface_old still set to %s",
+					ifname, ifindex, line + sizeof("E:INTERFACE_OLD=") - 1);
+			fclose(fp);
+			return -1;
+		}
+	}
+	fclose(fp);
+
+	ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_EVENTS,
+			"%s[%u] udev db: systemd tag is %s", ifname, ifindex,
+			systemd ? "set" : "not set");
+	return systemd ? 0 : -1;
+}
+
 ni_bool_t
 ni_udev_netdev_is_ready(ni_netdev_t *dev)
 {
@@ -318,6 +375,10 @@ ni_udev_netdev_is_ready(ni_netdev_t *dev)
 		if (!ni_netdev_index_to_name(&dev->name, dev->link.ifindex))
 			return FALSE;
 
+		/* the database is keyed by ifindex, no fork+exec needed */
+		if ((ret = netdev_udev_db_ready(dev->name, dev->link.ifindex)) <= 0)
+			break;
+
 		snprintf(pathbuf, sizeof(pathbuf), "%s/%s",
 				_PATH_SYS_CLASS_NET, dev->name);
 
@@ -59,6 +59,7 @@
 #include "socket_priv.h"
 #include "uevent.h"
 #include "appconfig.h"
+#include "sysfs.h"
 
 
 /*
@@ -646,10 +647,19 @@ __ni_uevent_ifevent_forwarder(const ni_var_array_t *vars, void *user_data)
 		}
 	}
 
-	if (!uinfo.subsystem || uinfo.action == UDEV_ACTION_SKIP || !uinfo.ifindex)
+	if (!uinfo.subsystem || !uinfo.ifindex)
 		return;
 
+	/* udev rules may have changed the sysfs attributes */
 	dev = ni_netdev_by_index(nc, uinfo.ifindex);
+	ni_sysfs_netif_cache_invalidate(uinfo.interface);
+	ni_sysfs_netif_cache_invalidate(uinfo.interface_old);
+	if (dev)
+		ni_sysfs_netif_cache_invalidate(dev->name);
+
+	if (uinfo.action == UDEV_ACTION_SKIP)
+		return;
+
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EVENTS,
 			"UEVENT(%s) ACTION: %s, IFINDEX=%u, NAME=%s, PREV=%s, TAGS=%s",
 			dev ? dev->name : NULL,
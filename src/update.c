@@ -7,6 +7,7 @@
 #include "config.h"
 #endif
 
+#include <sys/time.h>
 #include <unistd.h>
 
 #include <wicked/netinfo.h>
@@ -14,16 +15,19 @@
 #include <wicked/addrconf.h>
 #include <wicked/system.h>
 #include <wicked/resolver.h>
+#include <wicked/nis.h>
 #include <wicked/leaseinfo.h>
 
 #include "netinfo_priv.h"
 #include "socket_priv.h"
 #include "util_priv.h"
+#include "array_priv.h"
 #include "process.h"
 #include "appconfig.h"
 #include "extension.h"
 #include "addrconf.h"
 #include "buffer.h"
+#include "update.h"
 #include "debug.h"
 
 /* secs we try to reverse resolve hostnames */
@@ -34,6 +38,15 @@
 #ifndef NI_UPDATER_REVERSE_MAX_CNT
 #define NI_UPDATER_REVERSE_MAX_CNT	1
 #endif
+#ifndef NI_UPDATER_REVERSE_CACHE_TTL
+#define NI_UPDATER_REVERSE_CACHE_TTL	300
+#endif
+#ifndef NI_UPDATER_REVERSE_CACHE_NEG_TTL
+#define NI_UPDATER_REVERSE_CACHE_NEG_TTL 30
+#endif
+#ifndef NI_UPDATER_REVERSE_CACHE_MAX
+#define NI_UPDATER_REVERSE_CACHE_MAX	64
+#endif
 
 #define	NI_UPDATER_SOURCE_ARRAY_CHUNK	4
 #define	NI_UPDATER_SOURCE_ARRAY_INIT	{ 0, NULL }
@@ -47,6 +60,8 @@ struct ni_updater_source {
 		unsigned int		family;
 		unsigned int		type;
 	} lease;
+
+	char *				fingerprint;	/* applied lease data	*/
 };
 
 typedef struct ni_updater_source_array	ni_updater_source_array_t;
@@ -93,7 +108,11 @@ struct ni_updater_job {
 	ni_process_t *			process;
 	int				result;
 
+	ni_updater_job_t *		batch;		/* job running our batch	*/
+	unsigned int			batch_kind;
+
 	char *				hostname;
+	ni_bool_t			unchanged;	/* install skipped	*/
 };
 
 struct ni_updater {
@@ -109,6 +128,11 @@ struct ni_updater {
 	ni_shellcmd_t *			proc_install;
 	ni_shellcmd_t *			proc_remove;
 	ni_shellcmd_t *			proc_batch;
+
+	ni_system_updater_builtin_t *	builtin_backup;
+	ni_system_updater_builtin_t *	builtin_restore;
+	ni_system_updater_builtin_t *	builtin_install;
+	ni_system_updater_builtin_t *	builtin_remove;
 };
 
 static ni_updater_t			updaters[__NI_ADDRCONF_UPDATER_MAX];
@@ -128,6 +152,7 @@ static const ni_intmap_t		ni_updater_kind_names[] = {
 };
 
 static ni_bool_t			ni_system_updater_generic_batch_test(ni_updater_t *);
+static void			ni_updater_job_free(ni_updater_job_t *);
 
 /*
  * Get the name of an updater
@@ -186,6 +211,7 @@ ni_updater_source_free(ni_updater_source_t *src)
 
 		if (src->refcount == 0) {
 			ni_netdev_ref_destroy(&src->device);
+			ni_string_free(&src->fingerprint);
 			free(src);
 		}
 	}
@@ -209,16 +235,11 @@ ni_updater_source_array_destroy(ni_updater_source_array_t *usa)
 	}
 }
 
-static void
-__ni_updater_source_array_realloc(ni_updater_source_array_t *usa, unsigned int newsize)
+static ni_bool_t
+__ni_updater_source_array_realloc(ni_updater_source_array_t *usa, unsigned int newcount)
 {
-	unsigned int i;
-
-	newsize = (newsize + NI_UPDATER_SOURCE_ARRAY_CHUNK);
-	usa->data = xrealloc(usa->data, newsize * sizeof(ni_updater_source_t *));
-
-	for (i = usa->count; i < newsize; ++i)
-		usa->data[i] = NULL;
+	return ni_array_grow((void **)&usa->data, sizeof(ni_updater_source_t *),
+				usa->count, newcount, NI_UPDATER_SOURCE_ARRAY_CHUNK);
 }
 
 static ni_bool_t
@@ -227,8 +248,8 @@ ni_updater_source_array_append(ni_updater_source_array_t *usa, ni_updater_source
 	if (!usa || !src)
 		return FALSE;
 
-	if ((usa-> count % NI_UPDATER_SOURCE_ARRAY_CHUNK) == 0)
-		__ni_updater_source_array_realloc(usa, usa->count);
+	if (!__ni_updater_source_array_realloc(usa, usa->count + 1))
+		return FALSE;
 
 	usa->data[usa->count++] = src;
 	return TRUE;
@@ -254,16 +275,16 @@ ni_updater_source_array_remove(ni_updater_source_array_t *usa, unsigned int inde
 	return ptr;
 }
 
-static ni_updater_source_t *
-ni_updater_sources_remove_match(ni_updater_source_array_t *usa,
+static unsigned int
+ni_updater_sources_index_match(const ni_updater_source_array_t *usa,
 					const ni_netdev_ref_t *device,
 					const ni_addrconf_lease_t *lease)
 {
-	ni_updater_source_t *ptr;
+	const ni_updater_source_t *ptr;
 	unsigned int i;
 
 	if (!usa || !device || !lease)
-		return NULL;
+		return -1U;
 
 	for (i = 0; i < usa->count; ++i) {
 		ptr = usa->data[i];
@@ -271,9 +292,55 @@ ni_updater_sources_remove_match(ni_updater_source_array_t *usa,
 		    ptr->device.index == device->index &&
 		    ptr->lease.family == lease->family &&
 		    ptr->lease.type   == lease->type)
-			return ni_updater_source_array_remove(usa, i);
+			return i;
 	}
-	return NULL;
+	return -1U;
+}
+
+static ni_updater_source_t *
+ni_updater_sources_find_match(const ni_updater_source_array_t *usa,
+					const ni_netdev_ref_t *device,
+					const ni_addrconf_lease_t *lease)
+{
+	unsigned int i;
+
+	if ((i = ni_updater_sources_index_match(usa, device, lease)) == -1U)
+		return NULL;
+	return usa->data[i];
+}
+
+static ni_updater_source_t *
+ni_updater_sources_remove_match(ni_updater_source_array_t *usa,
+					const ni_netdev_ref_t *device,
+					const ni_addrconf_lease_t *lease)
+{
+	unsigned int i;
+
+	if ((i = ni_updater_sources_index_match(usa, device, lease)) == -1U)
+		return NULL;
+	return ni_updater_source_array_remove(usa, i);
+}
+
+/*
+ * Check if the lease data currently applied by the updater from this
+ * device lease is the same as we would apply now, e.g. on dhcp renew.
+ */
+static ni_bool_t
+ni_updater_sources_unchanged(const ni_updater_source_array_t *usa,
+				const ni_netdev_ref_t *device,
+				const ni_addrconf_lease_t *lease,
+				const char *fingerprint)
+{
+	const ni_updater_source_t *src;
+
+	if (ni_string_empty(fingerprint))
+		return FALSE;
+
+	if (!(src = ni_updater_sources_find_match(usa, device, lease)))
+		return FALSE;
+
+	return ni_string_eq(src->device.name, device->name) &&
+		ni_string_eq(src->fingerprint, fingerprint);
 }
 
 /*
@@ -283,7 +350,8 @@ ni_updater_sources_remove_match(ni_updater_source_array_t *usa,
 static void
 ni_updater_sources_update_match(ni_updater_source_array_t *usa,
 				const ni_netdev_ref_t *device,
-				const ni_addrconf_lease_t *lease)
+				const ni_addrconf_lease_t *lease,
+				const char *fingerprint)
 {
 	ni_updater_source_t *src;
 
@@ -297,6 +365,7 @@ ni_updater_sources_update_match(ni_updater_source_array_t *usa,
 	if (src) {
 		src->lease.type = lease->type;
 		src->lease.family = lease->family;
+		ni_string_dup(&src->fingerprint, fingerprint);
 		if (!ni_netdev_ref_set(&src->device, device->name, device->index))
 			ni_updater_source_free(src);
 		else
@@ -445,6 +514,10 @@ ni_updater_job_destroy(ni_updater_job_t *job)
 	job->kind = __NI_ADDRCONF_UPDATER_MAX;
 	job->lease = NULL;
 	job->actions = NULL;
+	if (job->batch) {
+		ni_updater_job_free(job->batch);
+		job->batch = NULL;
+	}
 	if (job->process) {
 		job->process->user_data = NULL;
 		ni_process_free(job->process);
@@ -562,6 +635,26 @@ ni_updater_job_list_find_pending(ni_updater_job_t **list)
 	return NULL;
 }
 
+/*
+ * Find the address of an enabled <builtin> action of the updater
+ */
+static ni_system_updater_builtin_t *
+ni_system_updater_find_builtin(const ni_extension_t *ex, const char *action)
+{
+	const ni_c_binding_t *binding;
+	void *addr;
+
+	if (!(binding = ni_extension_find_c_binding(ex, action)))
+		return NULL;
+
+	if (!(addr = ni_c_binding_get_address(binding))) {
+		ni_warn("system-updater %s: unable to bind %s builtin action to %s",
+				ex->name, action, binding->symbol);
+		return NULL;
+	}
+	return addr;
+}
+
 /*
  * Initialize the system updaters based on the data found in the config
  * file.
@@ -595,6 +688,10 @@ ni_system_updaters_init(void)
 		updater->proc_restore = ni_extension_find_script(ex, "restore");
 		updater->proc_install = ni_extension_find_script(ex, "install");
 		updater->proc_remove = ni_extension_find_script(ex, "remove");
+		updater->builtin_backup = ni_system_updater_find_builtin(ex, "backup");
+		updater->builtin_restore = ni_system_updater_find_builtin(ex, "restore");
+		updater->builtin_install = ni_system_updater_find_builtin(ex, "install");
+		updater->builtin_remove = ni_system_updater_find_builtin(ex, "remove");
 		if (kind == NI_ADDRCONF_UPDATER_GENERIC) {
 			if ((updater->proc_batch = ni_extension_find_script(ex, "batch"))) {
 				if (!ni_system_updater_generic_batch_test(updater))
@@ -606,18 +703,23 @@ ni_system_updaters_init(void)
 		if (!(ni_extension_statedir(name))) {
 			updater->enabled = FALSE;
 		} else
-		if (updater->proc_install == NULL && updater->proc_batch == NULL) {
+		if (updater->proc_install == NULL && updater->builtin_install == NULL &&
+		    updater->proc_batch == NULL) {
 			ni_warn("system-updater %s configured, but no install script defined", name);
 			updater->enabled = FALSE;
 		} else
-		if (updater->proc_remove == NULL && updater->proc_batch == NULL) {
+		if (updater->proc_remove == NULL && updater->builtin_remove == NULL &&
+		    updater->proc_batch == NULL) {
 			ni_warn("system-updater %s configured, but no remove script defined", name);
 			updater->enabled = FALSE;
 		}
-		if (updater->enabled && (updater->proc_backup == NULL || updater->proc_restore == NULL)) {
+		if (updater->enabled &&
+		    ((updater->proc_backup == NULL && updater->builtin_backup == NULL) ||
+		     (updater->proc_restore == NULL && updater->builtin_restore == NULL))) {
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
 				"system-updater %s configured, but no backup/restore script defined", name);
 			updater->proc_backup = updater->proc_restore = NULL;
+			updater->builtin_backup = updater->builtin_restore = NULL;
 		}
 	}
 }
@@ -664,6 +766,133 @@ can_update_type(const ni_addrconf_lease_t *lease, unsigned int kind)
 	return can;
 }
 
+/*
+ * Lease data fingerprints used to detect unchanged updater input.
+ * They contain the data the updater consumes, but no lease times.
+ */
+static void
+ni_updater_fingerprint_string(ni_stringbuf_t *buf, const char *name, const char *str)
+{
+	ni_stringbuf_printf(buf, "%s=%s\n", name, str ? str : "");
+}
+
+static void
+ni_updater_fingerprint_array(ni_stringbuf_t *buf, const char *name, const ni_string_array_t *arr)
+{
+	unsigned int i;
+
+	ni_stringbuf_printf(buf, "%s=", name);
+	for (i = 0; arr && i < arr->count; ++i)
+		ni_stringbuf_printf(buf, "%s%s", i ? " " : "", arr->data[i]);
+	ni_stringbuf_putc(buf, '\n');
+}
+
+static void
+ni_updater_fingerprint_resolver(ni_stringbuf_t *buf, const ni_resolver_info_t *resolver)
+{
+	if (!resolver)
+		return;
+
+	ni_updater_fingerprint_string(buf, "domain", resolver->default_domain);
+	ni_updater_fingerprint_array(buf, "dns-servers", &resolver->dns_servers);
+	ni_updater_fingerprint_array(buf, "dns-search", &resolver->dns_search);
+}
+
+static void
+ni_updater_fingerprint_nis(ni_stringbuf_t *buf, const ni_nis_info_t *nis)
+{
+	const ni_nis_domain_t *dom;
+	unsigned int i;
+
+	if (!nis)
+		return;
+
+	ni_stringbuf_printf(buf, "nis=%s %u\n", nis->domainname ? nis->domainname : "",
+				nis->default_binding);
+	ni_updater_fingerprint_array(buf, "nis-servers", &nis->default_servers);
+	for (i = 0; i < nis->domains.count; ++i) {
+		if (!(dom = nis->domains.data[i]))
+			continue;
+		ni_stringbuf_printf(buf, "nis-domain=%s %u\n",
+				dom->domainname ? dom->domainname : "", dom->binding);
+		ni_updater_fingerprint_array(buf, "nis-domain-servers", &dom->servers);
+	}
+}
+
+static char *
+ni_updater_fingerprint(unsigned int kind, const ni_updater_job_t *job)
+{
+	const ni_addrconf_lease_t *lease = job->lease;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	const ni_address_t *ap;
+
+	ni_stringbuf_printf(&buf, "update=%#x\n", lease->update);
+	switch (kind) {
+	case NI_ADDRCONF_UPDATER_HOSTNAME:
+		if (ni_string_empty(job->hostname))
+			goto failure;
+		ni_updater_fingerprint_string(&buf, "hostname", job->hostname);
+		break;
+
+	case NI_ADDRCONF_UPDATER_RESOLVER:
+		if (!lease->resolver)
+			goto failure;
+		ni_updater_fingerprint_resolver(&buf, lease->resolver);
+		break;
+
+	case NI_ADDRCONF_UPDATER_GENERIC:
+		for (ap = lease->addrs; ap; ap = ap->next) {
+			ni_stringbuf_printf(&buf, "address=%s/%u\n",
+					ni_sockaddr_print(&ap->local_addr),
+					ap->prefixlen);
+		}
+		ni_updater_fingerprint_string(&buf, "hostname", lease->hostname);
+		ni_updater_fingerprint_resolver(&buf, lease->resolver);
+		ni_updater_fingerprint_nis(&buf, lease->nis);
+		ni_updater_fingerprint_array(&buf, "ntp", &lease->ntp_servers);
+		ni_updater_fingerprint_array(&buf, "nds", &lease->nds_servers);
+		ni_updater_fingerprint_array(&buf, "nds-context", &lease->nds_context);
+		ni_updater_fingerprint_string(&buf, "nds-tree", lease->nds_tree);
+		ni_updater_fingerprint_array(&buf, "netbios-ns", &lease->netbios_name_servers);
+		ni_updater_fingerprint_array(&buf, "netbios-dd", &lease->netbios_dd_servers);
+		ni_updater_fingerprint_string(&buf, "netbios-scope", lease->netbios_scope);
+		ni_stringbuf_printf(&buf, "netbios-type=%u\n", lease->netbios_type);
+		ni_updater_fingerprint_array(&buf, "slp", &lease->slp_servers);
+		ni_updater_fingerprint_array(&buf, "slp-scopes", &lease->slp_scopes);
+		ni_updater_fingerprint_array(&buf, "sip", &lease->sip_servers);
+		ni_updater_fingerprint_array(&buf, "lpr", &lease->lpr_servers);
+		ni_updater_fingerprint_array(&buf, "log", &lease->log_servers);
+		ni_updater_fingerprint_string(&buf, "tz-string", lease->posix_tz_string);
+		ni_updater_fingerprint_string(&buf, "tz-dbname", lease->posix_tz_dbname);
+		break;
+
+	default:
+		goto failure;
+	}
+	return buf.string;
+
+failure:
+	ni_stringbuf_destroy(&buf);
+	return NULL;
+}
+
+static ni_bool_t
+ni_system_updater_unchanged(ni_updater_t *updater, ni_updater_job_t *job,
+				const char *fingerprint)
+{
+	if (!ni_updater_sources_unchanged(&updater->sources, &job->device,
+					job->lease, fingerprint))
+		return FALSE;
+
+	ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_EXTENSION,
+			"%s: skipping %s updater for lease %s:%s in state %s: unchanged",
+			job->device.name, ni_updater_name(updater->kind),
+			ni_addrfamily_type_to_name(job->lease->family),
+			ni_addrconf_type_to_name(job->lease->type),
+			ni_addrconf_state_to_name(job->lease->state));
+	return TRUE;
+}
+
 /*
  * Run an extension script to update resolver, hostname etc.
  */
@@ -702,15 +931,57 @@ ni_system_updater_notify(ni_process_t *pi)
 	ni_updater_job_free(job);
 }
 
+/*
+ * Call a builtin action in-process with the arguments of the script
+ * action; the result is available to the wait step immediately.
+ */
 static int
-ni_system_updater_run(ni_updater_job_t *job, ni_shellcmd_t *shellcmd, ni_string_array_t *args)
+ni_system_updater_call_builtin(ni_updater_job_t *job, ni_system_updater_builtin_t *builtin,
+				const ni_string_array_t *args)
+{
+	ni_string_array_t rest = NI_STRING_ARRAY_INIT;
+	const char *ifname = NULL, *type = NULL, *family = NULL;
+	unsigned int i;
+
+	for (i = 0; args && i < args->count; ++i) {
+		const char *arg = args->data[i] ? args->data[i] : "";
+
+		if (i + 1 < args->count && ni_string_eq(arg, "-i"))
+			ifname = args->data[++i];
+		else if (i + 1 < args->count && ni_string_eq(arg, "-t"))
+			type = args->data[++i];
+		else if (i + 1 < args->count && ni_string_eq(arg, "-f"))
+			family = args->data[++i];
+		else
+			ni_string_array_append(&rest, arg);
+	}
+
+	job->result = builtin(ifname, type, family, args ? &rest : NULL);
+	ni_string_array_destroy(&rest);
+
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
+		"%s: lease %s:%s in state %s %s updater builtin finished, status %d",
+			job->device.name,
+			ni_addrfamily_type_to_name(job->lease->family),
+			ni_addrconf_type_to_name(job->lease->type),
+			ni_addrconf_state_to_name(job->lease->state),
+			ni_updater_name(job->kind), job->result);
+	return NI_PROCESS_SUCCESS;
+}
+
+static int
+ni_system_updater_run(ni_updater_job_t *job, ni_shellcmd_t *shellcmd,
+			ni_system_updater_builtin_t *builtin, ni_string_array_t *args)
 {
 	ni_process_t *pi;
 	int rv;
 
-	if (!job || job->process || !shellcmd)
+	if (!job || job->process || (!shellcmd && !builtin))
 		return NI_PROCESS_FAILURE;
 
+	if (builtin)
+		return ni_system_updater_call_builtin(job, builtin, args);
+
 	if (!(pi = ni_process_new(shellcmd)))
 		return NI_PROCESS_FAILURE;
 
@@ -789,10 +1060,11 @@ ni_system_updater_backup_call(ni_updater_t *updater, ni_updater_job_t *job)
 	if (updater->have_backup)
 		return 0;
 
-	if (!updater->proc_backup)
+	if (!updater->proc_backup && !updater->builtin_backup)
 		return 0;
 
-	if (ni_system_updater_run(job, updater->proc_backup, NULL) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_backup,
+				updater->builtin_backup, NULL) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_backup->command,
@@ -830,10 +1102,11 @@ ni_system_updater_restore_call(ni_updater_t *updater, ni_updater_job_t *job)
 	if (!updater->have_backup)
 		return 0;
 
-	if (!updater->proc_restore)
+	if (!updater->proc_restore && !updater->builtin_restore)
 		return 0;
 
-	if (ni_system_updater_run(job, updater->proc_restore, NULL) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_restore,
+				updater->builtin_restore, NULL) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_restore->command,
@@ -883,11 +1156,11 @@ ni_system_updater_generic_cleanup_call(ni_updater_t *updater, ni_updater_job_t *
 	int ret = -1;
 
 	/* Call remove action only, when the name changed */
+	src = ni_updater_sources_find_match(&updater->sources, &job->device, job->lease);
+	if (!src || ni_string_eq(job->device.name, src->device.name))
+		return 0;
+
 	src = ni_updater_sources_remove_match(&updater->sources, &job->device, job->lease);
-	if (!src || ni_string_eq(job->device.name, src->device.name)) {
-		ret = 0;
-		goto cleanup;
-	}
 
 	if (!ni_system_updater_common_args(&args, src->device.name,
 				src->lease.type, src->lease.family))
@@ -898,7 +1171,8 @@ ni_system_updater_generic_cleanup_call(ni_updater_t *updater, ni_updater_job_t *
 		ni_leaseinfo_remove(src->device.name, src->lease.type, src->lease.family);
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_remove, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_remove,
+				updater->builtin_remove, &args) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to cleanup %s updater (%s) for lease %s:%s in state %s",
 				src->device.name, ni_updater_name(updater->kind),
 				updater->proc_remove->command,
@@ -1016,6 +1290,43 @@ cleanup:
 	return ret;
 }
 
+/*
+ * Add the job to the batch unless it would install unchanged data;
+ * returns 1 when skipped, 0 when added and -1 on error.
+ */
+static int
+ni_system_updater_generic_batch_job(ni_updater_t *updater, FILE *out,
+				ni_updater_job_t *job, const char *ident)
+{
+	ni_updater_source_t *src;
+	char *fingerprint = NULL;
+	int ret = -1;
+
+	if (job->flow == NI_UPDATER_FLOW_INSTALL) {
+		fingerprint = ni_updater_fingerprint(updater->kind, job);
+		if (ni_system_updater_unchanged(updater, job, fingerprint)) {
+			ret = 1;
+			goto cleanup;
+		}
+	}
+
+	if ((ret = ni_system_updater_generic_batch_add(out, job, ident)) < 0)
+		goto cleanup;
+
+	if (job->flow == NI_UPDATER_FLOW_INSTALL) {
+		ni_updater_sources_update_match(&updater->sources, &job->device,
+						job->lease, fingerprint);
+	} else
+	if ((src = ni_updater_sources_remove_match(&updater->sources,
+						&job->device, job->lease))) {
+		ni_updater_source_free(src);
+	}
+
+cleanup:
+	ni_string_free(&fingerprint);
+	return ret;
+}
+
 static ni_process_t *
 ni_system_updater_generic_batch_create(ni_updater_t *updater, char **filename, FILE **out)
 {
@@ -1116,6 +1427,16 @@ ni_system_updater_generic_batch_call(ni_updater_t *updater, ni_updater_job_t *jo
 	if (!updater->proc_batch || !updater->proc_batch->command)
 		return -1;
 
+	job->result = 0;
+	if (job->flow == NI_UPDATER_FLOW_INSTALL) {
+		char *fingerprint = ni_updater_fingerprint(updater->kind, job);
+
+		job->unchanged = ni_system_updater_unchanged(updater, job, fingerprint);
+		ni_string_free(&fingerprint);
+		if (job->unchanged)
+			return 0;
+	}
+
 	ident = ni_basename(updater->proc_batch->command);
 	pi = ni_system_updater_generic_batch_create(updater, &filename, &out);
 	if (!pi) {
@@ -1134,20 +1455,32 @@ ni_system_updater_generic_batch_call(ni_updater_t *updater, ni_updater_job_t *jo
 				ni_addrconf_state_to_name(job->lease->state));
 	}
 
-	if (ni_system_updater_generic_batch_add(out, job, ident) < 0)
+	if (ni_system_updater_generic_batch_job(updater, out, job, ident) < 0)
 		goto cleanup;
 
 	/* pickup pending job actions to the batch */
 	for (j = job->next; (j = ni_updater_job_list_find_pending(&j)); j = j->next) {
 		unsigned int pos;
+		int rv;
 
-		if ((pos = ni_uint_array_index(&j->updater, j->kind)) == -1U)
+		if ((pos = ni_uint_array_index(&j->updater, updater->kind)) == -1U)
 			continue;
 
-		if (ni_system_updater_generic_batch_add(out, j, ident) < 0)
+		if (!can_update_type(j->lease, updater->kind))
+			continue;
+
+		if ((rv = ni_system_updater_generic_batch_job(updater, out, j, ident)) < 0)
 			break;
 
 		ni_uint_array_remove_at(&j->updater, pos);
+		if (rv > 0)
+			continue;
+
+		/* the remaining kinds of j wait until the batch finished */
+		if (j->batch)
+			ni_updater_job_free(j->batch);
+		j->batch = ni_updater_job_ref(job);
+		j->batch_kind = updater->kind;
 	}
 
 	if (fprintf(out, "update\n") <= 0)
@@ -1190,6 +1523,11 @@ ni_system_updater_generic_wait(ni_updater_t *updater, ni_updater_job_t *job)
 	if ((ret = ni_system_updater_process_wait(updater, job, __func__)))
 		return ret;
 
+	if (job->unchanged) {
+		job->unchanged = FALSE;
+		return ret;
+	}
+
 	if (ni_global.other_event)
 		ni_global.other_event(NI_EVENT_GENERIC_UPDATED);
 
@@ -1200,11 +1538,20 @@ static int
 ni_system_updater_generic_install_call(ni_updater_t *updater, ni_updater_job_t *job)
 {
 	ni_string_array_t args = NI_STRING_ARRAY_INIT;
+	char *fingerprint;
 	int ret = -1;
 
 	if (updater->proc_batch)
 		return ni_system_updater_generic_batch_call(updater, job);
 
+	fingerprint = ni_updater_fingerprint(updater->kind, job);
+	job->result = 0;
+	job->unchanged = ni_system_updater_unchanged(updater, job, fingerprint);
+	if (job->unchanged) {
+		ret = 0;
+		goto cleanup;
+	}
+
 	if (!ni_system_updater_common_args(&args, job->device.name,
 				job->lease->type, job->lease->family))
 		goto cleanup;
@@ -1213,7 +1560,8 @@ ni_system_updater_generic_install_call(ni_updater_t *updater, ni_updater_job_t *
 		goto cleanup;
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_install, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_install,
+				updater->builtin_install, &args) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_install->command,
@@ -1223,11 +1571,13 @@ ni_system_updater_generic_install_call(ni_updater_t *updater, ni_updater_job_t *
 		goto cleanup;
 	}
 
-	ni_updater_sources_update_match(&updater->sources, &job->device, job->lease);
+	ni_updater_sources_update_match(&updater->sources, &job->device,
+					job->lease, fingerprint);
 
 	ret = 0; /* started, advance to wait for finish */
 
 cleanup:
+	ni_string_free(&fingerprint);
 	ni_string_array_destroy(&args);
 	return ret;
 }
@@ -1265,7 +1615,8 @@ ni_system_updater_generic_remove_call(ni_updater_t *updater, ni_updater_job_t *j
 	}
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_remove, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_remove,
+				updater->builtin_remove, &args) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_remove->command,
@@ -1309,8 +1660,17 @@ ni_system_updater_resolver_install_call(ni_updater_t *updater, ni_updater_job_t
 	ni_string_array_t args = NI_STRING_ARRAY_INIT;
 	const char *statedir;
 	char *filename = NULL;
+	char *fingerprint;
 	int ret = -1;
 
+	fingerprint = ni_updater_fingerprint(updater->kind, job);
+	job->result = 0;
+	job->unchanged = ni_system_updater_unchanged(updater, job, fingerprint);
+	if (job->unchanged) {
+		ret = 0;
+		goto cleanup;
+	}
+
 	if (!ni_system_updater_common_args(&args, job->device.name,
 				job->lease->type, job->lease->family))
 		goto cleanup;
@@ -1342,7 +1702,8 @@ ni_system_updater_resolver_install_call(ni_updater_t *updater, ni_updater_job_t
 	}
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_install, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_install,
+				updater->builtin_install, &args) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_install->command,
@@ -1352,11 +1713,13 @@ ni_system_updater_resolver_install_call(ni_updater_t *updater, ni_updater_job_t
 		goto cleanup;
 	}
 
-	ni_updater_sources_update_match(&updater->sources, &job->device, job->lease);
+	ni_updater_sources_update_match(&updater->sources, &job->device,
+					job->lease, fingerprint);
 
 	ret = 0; /* started, advance to wait for finish */
 
 cleanup:
+	ni_string_free(&fingerprint);
 	ni_string_free(&filename);
 	ni_string_array_destroy(&args);
 	return ret;
@@ -1369,6 +1732,11 @@ ni_system_updater_resolver_install_wait(ni_updater_t *updater, ni_updater_job_t
 	if ((ret = ni_system_updater_process_wait(updater, job, __func__)))
 		return ret;
 
+	if (job->unchanged) {
+		job->unchanged = FALSE;
+		return ret;
+	}
+
 	if (ni_global.other_event)
 		ni_global.other_event(NI_EVENT_RESOLVER_UPDATED);
 
@@ -1393,7 +1761,8 @@ ni_system_updater_resolver_remove_call(ni_updater_t *updater, ni_updater_job_t *
 		goto cleanup;
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_remove, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_remove,
+				updater->builtin_remove, &args) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_remove->command,
@@ -1473,9 +1842,94 @@ do_reverse_resolve_ip_address(int argc, char *const argv[], char *const envp[])
 	return EXIT_FAILURE;
 }
 
+/*
+ * Cache of the reverse lookup results (incl. failures), so the lease
+ * refreshes and the leases of several interfaces in the same network
+ * do not fork a resolver helper and wait for the DNS on each update.
+ */
+typedef struct ni_updater_reverse_cache	ni_updater_reverse_cache_t;
+struct ni_updater_reverse_cache {
+	ni_updater_reverse_cache_t *	next;
+	ni_sockaddr_t			addr;
+	char *				hostname;
+	struct timeval			expires;
+};
+
+static ni_updater_reverse_cache_t *	ni_updater_reverse_cache;
+
+static ni_bool_t
+ni_system_updater_hostname_lookup_addr(const ni_addrconf_lease_t *lease, ni_sockaddr_t *addr)
+{
+	const ni_address_t *ap;
+
+	for (ap = lease->addrs; ap; ap = ap->next) {
+		if (ni_address_is_tentative(ap) || ni_address_is_duplicate(ap))
+			continue;
+
+		if (!ni_sockaddr_is_specified(&ap->local_addr))
+			continue;
+
+		*addr = ap->local_addr;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static ni_updater_reverse_cache_t *
+ni_updater_reverse_cache_find(const ni_sockaddr_t *addr)
+{
+	ni_updater_reverse_cache_t *item, **pos;
+	struct timeval now;
+
+	ni_timer_get_time(&now);
+	for (pos = &ni_updater_reverse_cache; (item = *pos); ) {
+		if (timercmp(&item->expires, &now, <)) {
+			*pos = item->next;
+			ni_string_free(&item->hostname);
+			free(item);
+			continue;
+		}
+		if (ni_sockaddr_equal(&item->addr, addr))
+			return item;
+		pos = &item->next;
+	}
+	return NULL;
+}
+
+static void
+ni_updater_reverse_cache_add(const ni_sockaddr_t *addr, const char *hostname)
+{
+	ni_updater_reverse_cache_t *item, **pos;
+	unsigned int count = 0;
+
+	for (pos = &ni_updater_reverse_cache; (item = *pos); pos = &item->next) {
+		if (++count < NI_UPDATER_REVERSE_CACHE_MAX)
+			continue;
+
+		/* drop the oldest entry at the end */
+		*pos = item->next;
+		ni_string_free(&item->hostname);
+		free(item);
+		break;
+	}
+	if (!(item = calloc(1, sizeof(*item))))
+		return;
+
+	item->addr = *addr;
+	ni_string_dup(&item->hostname, hostname);
+	ni_timer_get_time(&item->expires);
+	ni_timeval_add_timeout(&item->expires, NI_TIMEOUT_FROM_SEC(hostname ?
+			NI_UPDATER_REVERSE_CACHE_TTL : NI_UPDATER_REVERSE_CACHE_NEG_TTL));
+
+	item->next = ni_updater_reverse_cache;
+	ni_updater_reverse_cache = item;
+}
+
 static int
 ni_system_updater_hostname_lookup_call(ni_updater_t *updater, ni_updater_job_t *job)
 {
+	const ni_updater_reverse_cache_t *cached;
+	ni_sockaddr_t lookup;
 	const ni_address_t *ap;
 	ni_shellcmd_t *shellcmd;
 	ni_process_t *pi;
@@ -1492,6 +1946,19 @@ ni_system_updater_hostname_lookup_call(ni_updater_t *updater, ni_updater_job_t *
 	if (!can_try_reverse_lookup(job->lease))
 		return -1;
 
+	if (!ni_system_updater_hostname_lookup_addr(job->lease, &lookup))
+		return -1;
+
+	if ((cached = ni_updater_reverse_cache_find(&lookup))) {
+		ni_debug_extension("%s: using cached reverse lookup of %s: %s",
+				job->device.name, ni_sockaddr_print(&lookup),
+				cached->hostname ? cached->hostname : "failed");
+		if (!cached->hostname)
+			return -1;
+		ni_string_dup(&job->hostname, cached->hostname);
+		return 0;
+	}
+
 	shellcmd = ni_shellcmd_parse("wickedd-resolver");
 	if (!shellcmd)
 		return -1;
@@ -1539,18 +2006,39 @@ ni_system_updater_hostname_lookup_call(ni_updater_t *updater, ni_updater_job_t *
 static int
 ni_system_updater_hostname_lookup_wait(ni_updater_t *updater, ni_updater_job_t *job)
 {
-	return ni_system_updater_process_wait(updater, job, __func__);
+	ni_sockaddr_t lookup;
+	int ret;
+
+	if ((ret = ni_system_updater_process_wait(updater, job, __func__)) > 0)
+		return ret;
+
+	/* cache the result of a lookup we've just run */
+	if (ni_string_empty(job->lease->hostname) &&
+	    ni_system_updater_hostname_lookup_addr(job->lease, &lookup) &&
+	    !ni_updater_reverse_cache_find(&lookup))
+		ni_updater_reverse_cache_add(&lookup, ret ? NULL : job->hostname);
+
+	return ret;
 }
 
 static int
 ni_system_updater_hostname_install_call(ni_updater_t *updater, ni_updater_job_t *job)
 {
 	ni_string_array_t args = NI_STRING_ARRAY_INIT;
+	char *fingerprint;
 	int ret = -1;
 
 	if (ni_string_empty(job->hostname))
 		return -1;
 
+	fingerprint = ni_updater_fingerprint(updater->kind, job);
+	job->result = 0;
+	job->unchanged = ni_system_updater_unchanged(updater, job, fingerprint);
+	if (job->unchanged) {
+		ret = 0;
+		goto cleanup;
+	}
+
 	if (!ni_system_updater_common_args(&args, job->device.name,
 				job->lease->type, job->lease->family))
 		goto cleanup;
@@ -1558,7 +2046,8 @@ ni_system_updater_hostname_install_call(ni_updater_t *updater, ni_updater_job_t
 	ni_string_array_append(&args, job->hostname);
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_install, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_install,
+				updater->builtin_install, &args) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_install->command,
@@ -1568,9 +2057,13 @@ ni_system_updater_hostname_install_call(ni_updater_t *updater, ni_updater_job_t
 		goto cleanup;
 	}
 
+	ni_updater_sources_update_match(&updater->sources, &job->device,
+					job->lease, fingerprint);
+
 	ret = 0; /* started, advance to wait for finish */
 
 cleanup:
+	ni_string_free(&fingerprint);
 	ni_string_array_destroy(&args);
 	return ret;
 }
@@ -1582,6 +2075,11 @@ ni_system_updater_hostname_install_wait(ni_updater_t *updater, ni_updater_job_t
 	if ((ret = ni_system_updater_process_wait(updater, job, __func__)))
 		return ret;
 
+	if (job->unchanged) {
+		job->unchanged = FALSE;
+		return ret;
+	}
+
 	if (ni_global.other_event)
 		ni_global.other_event(NI_EVENT_HOSTNAME_UPDATED);
 
@@ -1606,7 +2104,8 @@ ni_system_updater_hostname_remove_call(ni_updater_t *updater, ni_updater_job_t *
 		goto cleanup;
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_remove, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_remove,
+				updater->builtin_remove, &args) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_remove->command,
@@ -1787,6 +2286,25 @@ ni_updater_job_action_call(ni_updater_t *updater, ni_updater_job_t *job)
 	return res;
 }
 
+/*
+ * Whether the batch, which applied a kind of the job, is still running
+ */
+static ni_bool_t
+ni_updater_job_batch_running(ni_updater_job_t *job)
+{
+	ni_updater_job_t *batch = job->batch;
+
+	if (!batch)
+		return FALSE;
+
+	if (batch->process && batch->kind == job->batch_kind)
+		return TRUE;
+
+	job->batch = NULL;
+	ni_updater_job_free(batch);
+	return FALSE;
+}
+
 static int
 ni_updater_job_execute(ni_updater_job_t *job)
 {
@@ -1811,6 +2329,9 @@ ni_updater_job_execute(ni_updater_job_t *job)
 	}
 
 	while (ni_uint_array_get(&job->updater, 0, &job->kind)) {
+		if (ni_updater_job_batch_running(job))
+			return 1;
+
 		updater = &updaters[job->kind];
 
 		if (updater && updater->enabled && can_update_type(job->lease, job->kind)) {
@@ -1843,6 +2364,50 @@ skip:
 	return 0;
 }
 
+/*
+ * Execute all jobs in one pass, running jobs of different updater kinds
+ * in parallel while jobs of the same kind run one after another in the
+ * order they have been queued.
+ */
+static void
+ni_updater_job_list_pipeline(ni_updater_job_t **list)
+{
+	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_updater_job_t *job, *next;
+	unsigned int busy = 0;
+	unsigned int kind;
+
+	for (job = *list; job; job = next) {
+		if ((next = job->next))
+			ni_updater_job_ref(next);
+
+		if (ni_updater_job_finished(job))
+			goto advance;
+
+		/* wait until the previous job of this kind is done */
+		if (ni_uint_array_get(&job->updater, 0, &kind) && (busy & NI_BIT(kind)))
+			goto advance;
+
+		if (ni_updater_job_execute(job) == 1) {
+			if (job->kind < __NI_ADDRCONF_UPDATER_MAX)
+				busy |= NI_BIT(job->kind);
+			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EXTENSION,
+					"deferred %s", ni_updater_job_info(&out, job));
+			ni_stringbuf_destroy(&out);
+		}
+
+advance:
+		if (next) {
+			/* stop when it has been unlinked in the meantime */
+			ni_bool_t linked = next->pprev != NULL;
+
+			ni_updater_job_free(next);
+			if (!linked)
+				break;
+		}
+	}
+}
+
 int
 ni_system_update_from_lease(const ni_addrconf_lease_t *lease, const unsigned int ifindex, const char *ifname)
 {
@@ -1863,6 +2428,17 @@ ni_system_update_from_lease(const ni_addrconf_lease_t *lease, const unsigned int
 		}
 	}
 
+	if (ni_config_addrconf_updater_pipeline()) {
+		ni_updater_job_list_pipeline(&job_list);
+		if (ni_updater_job_finished(job)) {
+			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EXTENSION, "%s",
+					ni_updater_job_info(&out, job));
+			ni_stringbuf_destroy(&out);
+			return 0;
+		}
+		return 1;
+	}
+
 	do {
 		if ((found = ni_updater_job_list_find_running(&job_list))) {
 			if (ni_updater_job_execute(found) == 1) {
@@ -0,0 +1,58 @@
+/*
+ *	In-process system-updater builtins
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WICKED_UPDATE_H
+#define WICKED_UPDATE_H
+
+#include <wicked/types.h>
+
+/*
+ * Signature of a system-updater <builtin> action symbol.  It gets the
+ * -i ifname, -t type and -f family and the remaining arguments of the
+ * corresponding script action (NULL for backup and restore) and returns
+ * the exit status the script would return.
+ */
+typedef int			ni_system_updater_builtin_t(const char *ifname,
+						const char *type, const char *family,
+						const ni_string_array_t *args);
+
+/*
+ * system-updater builtins of the "hostname" extension
+ */
+extern int			ni_hostname_updater_backup(const char *, const char *,
+						const char *, const ni_string_array_t *);
+extern int			ni_hostname_updater_restore(const char *, const char *,
+						const char *, const ni_string_array_t *);
+extern int			ni_hostname_updater_install(const char *, const char *,
+						const char *, const ni_string_array_t *);
+extern int			ni_hostname_updater_remove(const char *, const char *,
+						const char *, const ni_string_array_t *);
+
+/*
+ * system-updater builtins of the "resolver" extension
+ */
+extern int			ni_resolver_updater_backup(const char *, const char *,
+						const char *, const ni_string_array_t *);
+extern int			ni_resolver_updater_restore(const char *, const char *,
+						const char *, const ni_string_array_t *);
+extern int			ni_resolver_updater_install(const char *, const char *,
+						const char *, const ni_string_array_t *);
+extern int			ni_resolver_updater_remove(const char *, const char *,
+						const char *, const ni_string_array_t *);
+
+#endif /* WICKED_UPDATE_H */
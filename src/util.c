@@ -21,6 +21,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <stdint.h>
+#include <malloc.h>
 
 #include <wicked/util.h>
 #include <wicked/logging.h>
@@ -28,6 +29,7 @@
 #include <wicked/fsm.h> /* for NI_IFWORKER_INFINITE_TIMEOUT */
 #include "slist_priv.h"
 #include "util_priv.h"
+#include "array_priv.h"
 
 #define NI_STRING_ARRAY_CHUNK	16
 #define NI_UINT_ARRAY_CHUNK	16
@@ -58,6 +60,8 @@ ni_string_array_copy(ni_string_array_t *dst, const ni_string_array_t *src)
 	unsigned int i;
 
 	ni_string_array_destroy(dst);
+	if (!ni_string_array_reserve(dst, src->count))
+		return -1;
 	for (i = 0; i < src->count; ++i) {
 		if (ni_string_array_append(dst, src->data[i]) < 0)
 			return -1;
@@ -82,25 +86,33 @@ ni_string_array_destroy(ni_string_array_t *nsa)
 	memset(nsa, 0, sizeof(*nsa));
 }
 
-static void
-__ni_string_array_realloc(ni_string_array_t *nsa, unsigned int newsize)
+/* the data is kept NULL terminated */
+static ni_bool_t
+__ni_string_array_realloc(ni_string_array_t *nsa, unsigned int newcount)
 {
-	char **newdata;
-	unsigned int i;
+	if (newcount >= UINT_MAX - 1)
+		return FALSE;
+
+	if (!ni_array_grow((void **)&nsa->data, sizeof(char *), nsa->count,
+				newcount + 1, NI_STRING_ARRAY_CHUNK))
+		ni_fatal("allocation failed for %u string array entries: %m", newcount);
+	return TRUE;
+}
 
-	newsize = (newsize + NI_STRING_ARRAY_CHUNK) + 1;
-	newdata = xrealloc(nsa->data, newsize * sizeof(char *));
+ni_bool_t
+ni_string_array_reserve(ni_string_array_t *nsa, unsigned int count)
+{
+	if (!nsa || (UINT_MAX - nsa->count) < count)
+		return FALSE;
 
-	nsa->data = newdata;
-	for (i = nsa->count; i < newsize; ++i)
-		nsa->data[i] = NULL;
+	return __ni_string_array_realloc(nsa, nsa->count + count);
 }
 
 static int
 __ni_string_array_append(ni_string_array_t *nsa, char *str)
 {
-	if ((nsa->count % NI_STRING_ARRAY_CHUNK) == 0)
-		__ni_string_array_realloc(nsa, nsa->count);
+	if (!__ni_string_array_realloc(nsa, nsa->count + 1))
+		return -1;
 
 	nsa->data[nsa->count++] = str;
 	return 0;
@@ -109,8 +121,8 @@ __ni_string_array_append(ni_string_array_t *nsa, char *str)
 static int
 __ni_string_array_insert(ni_string_array_t *nsa, unsigned int pos, char *str)
 {
-	if ((nsa->count % NI_STRING_ARRAY_CHUNK) == 0)
-		__ni_string_array_realloc(nsa, nsa->count);
+	if (!__ni_string_array_realloc(nsa, nsa->count + 1))
+		return -1;
 
 	if (pos >= nsa->count) {
 		nsa->data[nsa->count++] = str;
@@ -385,31 +397,20 @@ ni_uint_array_destroy(ni_uint_array_t *nua)
 	}
 }
 
-static ni_bool_t
-ni_uint_array_realloc(ni_uint_array_t *nua, unsigned int newsize)
+ni_bool_t
+ni_uint_array_reserve(ni_uint_array_t *nua, unsigned int count)
 {
-	unsigned int *newdata, i;
-
-	newsize = newsize + NI_UINT_ARRAY_CHUNK;
-	newdata = realloc(nua->data, newsize * sizeof(unsigned int));
-	if (!newdata)
+	if (!nua || (UINT_MAX - nua->count) < count)
 		return FALSE;
 
-	nua->data = newdata;
-	for (i = nua->count; i < newsize; ++i) {
-		nua->data[i] = 0;
-	}
-	return TRUE;
+	return ni_array_grow((void **)&nua->data, sizeof(unsigned int), nua->count,
+				nua->count + count, NI_UINT_ARRAY_CHUNK);
 }
 
 ni_bool_t
 ni_uint_array_append(ni_uint_array_t *nua, unsigned int num)
 {
-	if (!nua)
-		return FALSE;
-
-	if ((nua->count % NI_UINT_ARRAY_CHUNK) == 0 &&
-	    !ni_uint_array_realloc(nua, nua->count))
+	if (!ni_uint_array_reserve(nua, 1))
 		return FALSE;
 
 	nua->data[nua->count++] = num;
@@ -649,7 +650,110 @@ ni_var_destroy(ni_var_t *var)
 
 /*
  * Array of variables
+ *
+ * Larger arrays, e.g. sysconfig files, get a hash index on the first
+ * ni_var_array_get() mapping each name to the position of its first
+ * occurrence.  Appends update it in place, other modifications drop
+ * it and it is rebuilt on the next lookup.  The index remembers the
+ * data and count it was built for to detect direct modifications.
  */
+#define NI_VAR_INDEX_MIN_COUNT	16
+#define NI_VAR_INDEX_MIN_SIZE	32
+
+struct ni_var_index {
+	const ni_var_t *	data;
+	unsigned int		count;
+	unsigned int		mask;
+	unsigned int *		slots;		/* position + 1, 0 is unused	*/
+};
+
+static unsigned int *
+ni_var_index_slot(const struct ni_var_index *index, const ni_var_t *data, const char *name)
+{
+	unsigned int i = ni_string_hash(name) & index->mask;
+
+	while (index->slots[i]) {
+		if (ni_string_eq(data[index->slots[i] - 1].name, name))
+			break;
+		i = (i + 1) & index->mask;
+	}
+	return &index->slots[i];
+}
+
+static void
+ni_var_index_free(ni_var_array_t *nva)
+{
+	if (nva->index) {
+		free(nva->index->slots);
+		free(nva->index);
+		nva->index = NULL;
+	}
+}
+
+static ni_bool_t
+ni_var_index_valid(const ni_var_array_t *nva)
+{
+	return nva->index && nva->index->data == nva->data &&
+		nva->index->count == nva->count;
+}
+
+static struct ni_var_index *
+ni_var_index_build(ni_var_array_t *nva)
+{
+	struct ni_var_index *index;
+	unsigned int size, pos, *slot;
+
+	ni_var_index_free(nva);
+
+	for (size = NI_VAR_INDEX_MIN_SIZE; size < 2 * nva->count; size <<= 1) {
+		if (size > UINT_MAX / 4)
+			return NULL;
+	}
+
+	if (!(index = calloc(1, sizeof(*index))))
+		return NULL;
+	if (!(index->slots = calloc(size, sizeof(*index->slots)))) {
+		free(index);
+		return NULL;
+	}
+	index->mask = size - 1;
+
+	for (pos = 0; pos < nva->count; ++pos) {
+		slot = ni_var_index_slot(index, nva->data, nva->data[pos].name);
+		if (!*slot)
+			*slot = pos + 1;
+	}
+	index->data = nva->data;
+	index->count = nva->count;
+	nva->index = index;
+	return index;
+}
+
+/*
+ * Add the just appended last variable while at most half full,
+ * otherwise drop the index to rebuild it with a larger size.
+ */
+static void
+ni_var_index_append(ni_var_array_t *nva, ni_bool_t valid)
+{
+	struct ni_var_index *index = nva->index;
+	unsigned int *slot;
+
+	if (!index)
+		return;
+
+	if (!valid || 2 * nva->count > index->mask + 1) {
+		ni_var_index_free(nva);
+		return;
+	}
+
+	slot = ni_var_index_slot(index, nva->data, nva->data[nva->count - 1].name);
+	if (!*slot)
+		*slot = nva->count;
+	index->data = nva->data;
+	index->count = nva->count;
+}
+
 ni_var_array_t *
 ni_var_array_new(void)
 {
@@ -681,29 +785,18 @@ ni_var_array_destroy(ni_var_array_t *nva)
 		free(nva->data[i].value);
 	}
 	free(nva->data);
+	ni_var_index_free(nva);
 	memset(nva, 0, sizeof(*nva));
 }
 
-static inline ni_bool_t
-ni_var_array_realloc(ni_var_array_t *nva, unsigned int newsize)
+ni_bool_t
+ni_var_array_reserve(ni_var_array_t *nva, unsigned int count)
 {
-	unsigned int i;
-	ni_var_t *newdata;
-
-	if ((UINT_MAX - NI_VAR_ARRAY_CHUNK) <= newsize)
+	if (!nva || (UINT_MAX - nva->count) < count)
 		return FALSE;
 
-	newsize = (newsize + NI_VAR_ARRAY_CHUNK);
-	newdata = xrealloc(nva->data, newsize * sizeof(ni_var_t));
-	if (!newdata)
-		return FALSE;
-
-	nva->data = newdata;
-	for (i = nva->count; i < newsize; ++i) {
-		nva->data[i].name = NULL;
-		nva->data[i].value = NULL;
-	}
-	return TRUE;
+	return ni_array_grow((void **)&nva->data, sizeof(ni_var_t), nva->count,
+				nva->count + count, NI_VAR_ARRAY_CHUNK);
 }
 
 ni_bool_t
@@ -712,6 +805,7 @@ ni_var_array_remove_at(ni_var_array_t *array, unsigned int index)
 	if (!array || index >= array->count)
 		return FALSE;
 
+	ni_var_index_free(array);
 	free(array->data[index].name);
 	free(array->data[index].value);
 
@@ -747,7 +841,7 @@ ni_var_array_copy(ni_var_array_t *dst, const ni_var_array_t *src)
 {
 	unsigned int i;
 
-	if (!dst || !src)
+	if (!dst || !src || !ni_var_array_reserve(dst, src->count))
 		return FALSE;
 
 	for (i = 0; i < src->count; ++i) {
@@ -774,6 +868,7 @@ ni_bool_t
 ni_var_array_insert(ni_var_array_t *nva, unsigned int pos, const char *name, const char *value)
 {
 	ni_var_t *var, tmp = NI_VAR_INIT;
+	ni_bool_t valid;
 
 	if (!nva)
 		return FALSE;
@@ -781,8 +876,8 @@ ni_var_array_insert(ni_var_array_t *nva, unsigned int pos, const char *name, con
 	if (!ni_var_set(&tmp, name, value))
 		return FALSE;
 
-	if ((nva->count % NI_VAR_ARRAY_CHUNK) == 0 &&
-	    !ni_var_array_realloc(nva, nva->count)) {
+	valid = ni_var_index_valid(nva);
+	if (!ni_var_array_reserve(nva, 1)) {
 		ni_var_destroy(&tmp);
 		return FALSE;
 	}
@@ -792,10 +887,12 @@ ni_var_array_insert(ni_var_array_t *nva, unsigned int pos, const char *name, con
 	} else {
 		memmove(&nva->data[pos + 1], &nva->data[pos], (nva->count - pos) * sizeof(ni_var_t));
 		var = &nva->data[pos];
+		valid = FALSE;
 	}
 	nva->count++;
 	var->name = tmp.name;
 	var->value = tmp.value;
+	ni_var_index_append(nva, valid);
 	return TRUE;
 }
 
@@ -829,9 +926,22 @@ ni_var_array_find(const ni_var_array_t *nva, unsigned int pos, const ni_var_t *v
 ni_var_t *
 ni_var_array_get(const ni_var_array_t *nva, const char *name)
 {
-	unsigned int i;
+	const struct ni_var_index *index;
+	unsigned int i, *slot;
 	ni_var_t *var;
 
+	if (nva && nva->count >= NI_VAR_INDEX_MIN_COUNT) {
+		/* the index is a cache, building it does not modify the array */
+		if (ni_var_index_valid(nva))
+			index = nva->index;
+		else
+			index = ni_var_index_build((ni_var_array_t *)nva);
+		if (index) {
+			slot = ni_var_index_slot(index, nva->data, name);
+			return *slot ? &nva->data[*slot - 1] : NULL;
+		}
+	}
+
 	if (nva) {
 		for (i = 0, var = nva->data; i < nva->count; ++i, ++var) {
 			if (ni_string_eq(var->name, name))
@@ -1073,6 +1183,7 @@ ni_var_array_set_vars(ni_var_array_t *nva, const ni_var_array_t *vars, ni_bool_t
 void
 ni_var_array_sort(ni_var_array_t *nva, ni_var_compare_fn_t fn)
 {
+	ni_var_index_free(nva);
 	qsort(nva->data, nva->count, sizeof(ni_var_t),
 			(int (*)(const void *, const void *)) fn);
 }
@@ -1222,6 +1333,142 @@ ni_bitfield_isset(const ni_bitfield_t *bf)
 	return FALSE;
 }
 
+/*
+ * Word-at-a-time bitfield operations. The bits beyond the size of
+ * a bitfield are zero; or/xor grow the destination as needed, and
+ * the comparison ignores different sizes with zero trailing words.
+ */
+unsigned int
+ni_bitfield_count(const ni_bitfield_t *bf)
+{
+	unsigned int word, count = 0;
+
+	if (bf) {
+		for (word = 0; word < bf->size; ++word)
+			count += __builtin_popcount(bf->field[word]);
+	}
+	return count;
+}
+
+/*
+ * Returns the first set bit starting at bit or ni_bitfield_bits(),
+ * when there is none:
+ *   for (bit = ni_bitfield_next_set(bf, 0); bit < ni_bitfield_bits(bf);
+ *        bit = ni_bitfield_next_set(bf, bit + 1))
+ */
+unsigned int
+ni_bitfield_next_set(const ni_bitfield_t *bf, unsigned int bit)
+{
+	unsigned int word;
+	uint32_t bits;
+
+	if (!bf || bit / 32 >= bf->size)
+		return ni_bitfield_bits(bf);
+
+	word = bit / 32;
+	bits = bf->field[word] & (~0U << (bit % 32u));
+	while (!bits) {
+		if (++word >= bf->size)
+			return ni_bitfield_bits(bf);
+		bits = bf->field[word];
+	}
+	return word * 32 + __builtin_ctz(bits);
+}
+
+ni_bool_t
+ni_bitfield_copy(ni_bitfield_t *dst, const ni_bitfield_t *src)
+{
+	unsigned int word;
+
+	if (!dst || !src || dst == src)
+		return dst && src;
+
+	if (src->size && !ni_bitfield_grow(dst, src->size * 32 - 1))
+		return FALSE;
+
+	for (word = 0; word < dst->size; ++word)
+		dst->field[word] = word < src->size ? src->field[word] : 0;
+	return TRUE;
+}
+
+ni_bool_t
+ni_bitfield_or(ni_bitfield_t *dst, const ni_bitfield_t *src)
+{
+	unsigned int word;
+
+	if (!dst || !src)
+		return FALSE;
+
+	if (src->size && !ni_bitfield_grow(dst, src->size * 32 - 1))
+		return FALSE;
+
+	for (word = 0; word < src->size; ++word)
+		dst->field[word] |= src->field[word];
+	return TRUE;
+}
+
+ni_bool_t
+ni_bitfield_and(ni_bitfield_t *dst, const ni_bitfield_t *src)
+{
+	unsigned int word;
+
+	if (!dst || !src)
+		return FALSE;
+
+	for (word = 0; word < dst->size; ++word)
+		dst->field[word] &= word < src->size ? src->field[word] : 0;
+	return TRUE;
+}
+
+ni_bool_t
+ni_bitfield_andnot(ni_bitfield_t *dst, const ni_bitfield_t *src)
+{
+	unsigned int word, words;
+
+	if (!dst || !src)
+		return FALSE;
+
+	words = min_t(unsigned int, dst->size, src->size);
+	for (word = 0; word < words; ++word)
+		dst->field[word] &= ~src->field[word];
+	return TRUE;
+}
+
+ni_bool_t
+ni_bitfield_xor(ni_bitfield_t *dst, const ni_bitfield_t *src)
+{
+	unsigned int word;
+
+	if (!dst || !src)
+		return FALSE;
+
+	if (src->size && !ni_bitfield_grow(dst, src->size * 32 - 1))
+		return FALSE;
+
+	for (word = 0; word < src->size; ++word)
+		dst->field[word] ^= src->field[word];
+	return TRUE;
+}
+
+ni_bool_t
+ni_bitfield_equal(const ni_bitfield_t *a, const ni_bitfield_t *b)
+{
+	unsigned int word, words;
+	unsigned int asize, bsize;
+	uint32_t wa, wb;
+
+	asize = ni_bitfield_words(a);
+	bsize = ni_bitfield_words(b);
+	words = max_t(unsigned int, asize, bsize);
+	for (word = 0; word < words; ++word) {
+		wa = word < asize ? a->field[word] : 0;
+		wb = word < bsize ? b->field[word] : 0;
+		if (wa != wb)
+			return FALSE;
+	}
+	return TRUE;
+}
+
 ni_bool_t
 ni_bitfield_parse(ni_bitfield_t *bf, const char *hexstr, unsigned int nwords)
 {
@@ -1421,6 +1668,19 @@ ni_file_exists(const char *filename)
 	return access(filename, F_OK) == 0;
 }
 
+/*
+ * Check if we're running in the initrd, using the systemd convention
+ */
+ni_bool_t
+ni_running_in_initrd(void)
+{
+	static int initrd = -1;
+
+	if (initrd < 0)
+		initrd = ni_file_exists("/etc/initrd-release");
+	return initrd;
+}
+
 ni_bool_t
 ni_file_executable(const char *filename)
 {
@@ -1689,6 +1949,197 @@ ni_string_toupper(char *str)
 		str[i] = toupper(str[i]);
 }
 
+/*
+ * FNV-1a string hash, used to index strings in hash tables.
+ */
+unsigned int
+ni_string_hash(const char *str)
+{
+	unsigned int hash = 2166136261U;
+
+	if (!str)
+		return 0;
+
+	while (*str) {
+		hash ^= (unsigned char)*str++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+unsigned int
+ni_string_hash_len(const char *str, size_t len)
+{
+	unsigned int hash = 2166136261U;
+
+	if (!str)
+		return 0;
+
+	while (len--) {
+		hash ^= (unsigned char)*str++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+/*
+ * Interned strings: one shared, reference counted copy per distinct
+ * string, so holders of interned strings can compare them by pointer.
+ */
+typedef struct ni_string_atom	ni_string_atom_t;
+struct ni_string_atom {
+	ni_string_atom_t *	next;
+	unsigned int		refcount;
+	unsigned int		hash;
+	char			string[];
+};
+
+#define NI_STRING_ATOM_MIN_SIZE	64
+
+static struct {
+	unsigned int		count;
+	unsigned int		mask;
+	ni_string_atom_t **	buckets;
+} ni_string_atoms;
+
+static inline ni_string_atom_t *
+ni_string_atom_of(const char *str)
+{
+	return (ni_string_atom_t *)(str - offsetof(ni_string_atom_t, string));
+}
+
+static ni_string_atom_t **
+ni_string_atom_slot(const char *str, unsigned int hash)
+{
+	ni_string_atom_t **slot, *atom;
+
+	if (!ni_string_atoms.buckets)
+		return NULL;
+
+	slot = &ni_string_atoms.buckets[hash & ni_string_atoms.mask];
+	for ( ; (atom = *slot); slot = &atom->next) {
+		if (atom->hash == hash && !strcmp(atom->string, str))
+			break;
+	}
+	return slot;
+}
+
+static void
+ni_string_atoms_resize(void)
+{
+	ni_string_atom_t **buckets, *atom, *next;
+	unsigned int i, size, mask;
+
+	size = ni_string_atoms.buckets ? (ni_string_atoms.mask + 1) * 2 : NI_STRING_ATOM_MIN_SIZE;
+	mask = size - 1;
+	buckets = xcalloc(size, sizeof(*buckets));
+
+	for (i = 0; ni_string_atoms.buckets && i <= ni_string_atoms.mask; ++i) {
+		for (atom = ni_string_atoms.buckets[i]; atom; atom = next) {
+			next = atom->next;
+			atom->next = buckets[atom->hash & mask];
+			buckets[atom->hash & mask] = atom;
+		}
+	}
+	free(ni_string_atoms.buckets);
+	ni_string_atoms.buckets = buckets;
+	ni_string_atoms.mask = mask;
+}
+
+/*
+ * Return a new reference to the interned copy of str.
+ */
+const char *
+ni_string_intern(const char *str)
+{
+	ni_string_atom_t **slot, *atom;
+	unsigned int hash;
+	size_t len;
+
+	if (!str)
+		return NULL;
+
+	hash = ni_string_hash(str);
+	if ((slot = ni_string_atom_slot(str, hash)) && (atom = *slot)) {
+		atom->refcount++;
+		return atom->string;
+	}
+
+	if (!ni_string_atoms.buckets || ni_string_atoms.count > ni_string_atoms.mask)
+		ni_string_atoms_resize();
+
+	len = strlen(str);
+	atom = xmalloc(sizeof(*atom) + len + 1);
+	atom->refcount = 1;
+	atom->hash = hash;
+	memcpy(atom->string, str, len + 1);
+
+	slot = &ni_string_atoms.buckets[hash & ni_string_atoms.mask];
+	atom->next = *slot;
+	*slot = atom;
+	ni_string_atoms.count++;
+	return atom->string;
+}
+
+/*
+ * Return the interned copy of str without taking a reference or
+ * NULL when it is not interned, that is not held by anyone.
+ */
+const char *
+ni_string_intern_lookup(const char *str)
+{
+	ni_string_atom_t **slot;
+
+	if (!str || !(slot = ni_string_atom_slot(str, ni_string_hash(str))) || !*slot)
+		return NULL;
+	return (*slot)->string;
+}
+
+const char *
+ni_string_intern_ref(const char *atom)
+{
+	if (atom)
+		ni_string_atom_of(atom)->refcount++;
+	return atom;
+}
+
+void
+ni_string_intern_free(const char **atom)
+{
+	ni_string_atom_t **slot, *entry;
+
+	if (!atom || !*atom)
+		return;
+
+	entry = ni_string_atom_of(*atom);
+	*atom = NULL;
+	if (--entry->refcount)
+		return;
+
+	if ((slot = ni_string_atom_slot(entry->string, entry->hash)) && *slot == entry) {
+		*slot = entry->next;
+		ni_string_atoms.count--;
+	}
+	free(entry);
+}
+
+/*
+ * Replace the atom by the interned copy of str, as ni_string_dup.
+ */
+ni_bool_t
+ni_string_intern_set(const char **atom, const char *str)
+{
+	const char *old;
+
+	if (!atom)
+		return FALSE;
+
+	old = *atom;
+	*atom = ni_string_intern(str);
+	ni_string_intern_free(&old);
+	return TRUE;
+}
+
 char *
 ni_sprint_hex(const unsigned char *data, size_t len)
 {
@@ -2002,6 +2453,169 @@ ni_format_uint_maybe_mapped(unsigned int value, const ni_intmap_t *map)
 	return name;
 }
 
+/*
+ * Map index with separate open addressing slots for the names and the
+ * values; a map with a few entries only is searched linearly instead.
+ */
+#define NI_INTMAP_INDEX_MIN_COUNT	8
+
+static unsigned int
+ni_intmap_index_name_hash(const char *name)
+{
+	unsigned int hash = 2166136261U;
+
+	while (*name) {
+		hash ^= (unsigned char)tolower((unsigned char)*name++);
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static inline unsigned int
+ni_intmap_index_value_hash(unsigned int value)
+{
+	/* mix the high bits of bit flag values into the slot bits */
+	value = ((value >> 16) ^ value) * 0x45d9f3bU;
+	value = ((value >> 16) ^ value) * 0x45d9f3bU;
+	return (value >> 16) ^ value;
+}
+
+static unsigned int *
+ni_intmap_index_name_slot(const ni_intmap_index_t *index, const char *name)
+{
+	unsigned int i = ni_intmap_index_name_hash(name) & index->mask;
+
+	while (index->names[i]) {
+		if (!strcasecmp(index->map[index->names[i] - 1].name, name))
+			break;
+		i = (i + 1) & index->mask;
+	}
+	return &index->names[i];
+}
+
+static unsigned int *
+ni_intmap_index_value_slot(const ni_intmap_index_t *index, unsigned int value)
+{
+	unsigned int i = ni_intmap_index_value_hash(value) & index->mask;
+
+	while (index->values[i]) {
+		if (index->map[index->values[i] - 1].value == value)
+			break;
+		i = (i + 1) & index->mask;
+	}
+	return &index->values[i];
+}
+
+static ni_bool_t
+ni_intmap_index_build(ni_intmap_index_t *index)
+{
+	unsigned int count, size, pos, *slot;
+
+	if (index->names)
+		return TRUE;
+	if (index->mask || !index->map)
+		return FALSE;	/* small map or allocation failed */
+
+	for (count = 0; index->map[count].name; ++count)
+		;
+	if (count < NI_INTMAP_INDEX_MIN_COUNT) {
+		index->mask = -1U;
+		return FALSE;
+	}
+
+	for (size = NI_INTMAP_INDEX_MIN_COUNT; size < 2 * count; size <<= 1)
+		;
+	index->names = calloc(size, sizeof(*index->names));
+	index->values = calloc(size, sizeof(*index->values));
+	index->mask = size - 1;
+	if (!index->names || !index->values) {
+		free(index->names);
+		free(index->values);
+		index->names = index->values = NULL;
+		return FALSE;
+	}
+
+	/* keep the first entry of duplicate names and values */
+	for (pos = 0; pos < count; ++pos) {
+		slot = ni_intmap_index_name_slot(index, index->map[pos].name);
+		if (!*slot)
+			*slot = pos + 1;
+		slot = ni_intmap_index_value_slot(index, index->map[pos].value);
+		if (!*slot)
+			*slot = pos + 1;
+	}
+	return TRUE;
+}
+
+int
+ni_intmap_index_parse(ni_intmap_index_t *index, const char *input, unsigned int *result)
+{
+	unsigned int *slot;
+
+	if (!index || !input || !result)
+		return -1;
+
+	if (!ni_intmap_index_build(index))
+		return ni_parse_uint_mapped(input, index->map, result);
+
+	slot = ni_intmap_index_name_slot(index, input);
+	if (!*slot)
+		return -1;
+
+	*result = index->map[*slot - 1].value;
+	return 0;
+}
+
+int
+ni_intmap_index_parse_maybe(ni_intmap_index_t *index, const char *input,
+				unsigned int *result, int base)
+{
+	if (!index || !input || !result)
+		return -1;
+
+	if (ni_intmap_index_parse(index, input, result) == 0)
+		return 0;
+
+	if (ni_parse_uint(input, result, base) < 0)
+		return -1;
+
+	if (ni_intmap_index_format(index, *result) == NULL)
+		return 1;
+
+	return 0;
+}
+
+const char *
+ni_intmap_index_format(ni_intmap_index_t *index, unsigned int value)
+{
+	unsigned int *slot;
+
+	if (!index)
+		return NULL;
+
+	if (!ni_intmap_index_build(index))
+		return ni_format_uint_mapped(value, index->map);
+
+	slot = ni_intmap_index_value_slot(index, value);
+	return *slot ? index->map[*slot - 1].name : NULL;
+}
+
+const char *
+ni_intmap_index_format_maybe(ni_intmap_index_t *index, unsigned int value)
+{
+	static char buffer[20];
+	const char *name;
+
+	if (!index)
+		return NULL;
+
+	if (!(name = ni_intmap_index_format(index, value))) {
+		snprintf(buffer, sizeof(buffer), "%u", value);
+		name = buffer;
+	}
+	return name;
+}
+
 int
 ni_parse_double(const char *input, double *result)
 {
@@ -2719,6 +3333,149 @@ ni_stringbuf_trim_empty_lines(ni_stringbuf_t *sb)
 	}
 }
 
+ni_slice_t
+ni_stringbuf_slice(const ni_stringbuf_t *sb)
+{
+	return ni_slice_init(sb->string, sb->string ? sb->len : 0);
+}
+
+void
+ni_stringbuf_put_slice(ni_stringbuf_t *sb, const ni_slice_t *slice)
+{
+	if (slice && slice->data)
+		ni_stringbuf_put(sb, slice->data, slice->len);
+}
+
+/*
+ * String slices
+ */
+ni_slice_t
+ni_slice_init(const char *data, size_t len)
+{
+	ni_slice_t slice;
+
+	slice.data = data;
+	slice.len = data ? len : 0;
+	return slice;
+}
+
+ni_slice_t
+ni_slice_from_string(const char *str)
+{
+	return ni_slice_init(str, ni_string_len(str));
+}
+
+ni_bool_t
+ni_slice_empty(const ni_slice_t *slice)
+{
+	return !slice || !slice->len;
+}
+
+/*
+ * Cut the next token separated by any of the sep characters off the
+ * front of str, skipping empty tokens as strtok does.  Returns FALSE
+ * and an empty token when str contains no further tokens.
+ */
+ni_bool_t
+ni_slice_token(ni_slice_t *str, const char *sep, ni_slice_t *token)
+{
+	size_t n;
+
+	*token = ni_slice_init(NULL, 0);
+	if (!str || !str->data || !sep)
+		return FALSE;
+
+	while (str->len && strchr(sep, *str->data)) {
+		str->data++;
+		str->len--;
+	}
+	if (!str->len)
+		return FALSE;
+
+	for (n = 0; n < str->len && !strchr(sep, str->data[n]); ++n)
+		;
+	*token = ni_slice_init(str->data, n);
+	str->data += n;
+	str->len -= n;
+	return TRUE;
+}
+
+void
+ni_slice_trim(ni_slice_t *slice, const char *reject)
+{
+	if (!slice || !slice->data || !reject)
+		return;
+
+	while (slice->len && strchr(reject, *slice->data)) {
+		slice->data++;
+		slice->len--;
+	}
+	while (slice->len && strchr(reject, slice->data[slice->len - 1]))
+		slice->len--;
+}
+
+ni_bool_t
+ni_slice_eq(const ni_slice_t *slice, const char *str)
+{
+	if (!slice || !slice->data || !str)
+		return (!slice || !slice->data) && !str;
+
+	return strlen(str) == slice->len && !memcmp(slice->data, str, slice->len);
+}
+
+int
+ni_slice_cmp(const ni_slice_t *s1, const ni_slice_t *s2)
+{
+	size_t len1 = s1 ? s1->len : 0;
+	size_t len2 = s2 ? s2->len : 0;
+	int ret;
+
+	if (len1 && len2 && (ret = memcmp(s1->data, s2->data, min_t(size_t, len1, len2))))
+		return ret;
+	return len1 < len2 ? -1 : len1 > len2;
+}
+
+/*
+ * NUL terminated copy of the slice in a caller provided buffer, e.g.
+ * to pass a token to a parser; NULL when it does not fit.
+ */
+const char *
+ni_slice_cstr(const ni_slice_t *slice, char *buf, size_t size)
+{
+	if (!slice || !slice->data || !buf || slice->len >= size)
+		return NULL;
+
+	memcpy(buf, slice->data, slice->len);
+	buf[slice->len] = '\0';
+	return buf;
+}
+
+char *
+ni_slice_dup(char **pp, const ni_slice_t *slice)
+{
+	char *copy = NULL;
+
+	if (!pp)
+		return NULL;
+
+	if (slice && slice->data) {
+		if (!(copy = malloc(slice->len + 1)))
+			return NULL;
+		memcpy(copy, slice->data, slice->len);
+		copy[slice->len] = '\0';
+	}
+	free(*pp);
+	return *pp = copy;
+}
+
+int
+ni_slice_parse_uint(const ni_slice_t *slice, unsigned int *result, int base)
+{
+	char buf[32];
+
+	return ni_parse_uint(ni_slice_cstr(slice, buf, sizeof(buf)), result, base);
+}
+
 /*
  * background the current process
  */
@@ -3465,6 +4222,56 @@ xrealloc(void *ptr, size_t size)
 	return p;
 }
 
+/*
+ * Array capacity for count entries: the chunk size doubled until
+ * the count fits, or 0 on overflow.
+ */
+unsigned int
+ni_array_capacity(unsigned int count, unsigned int chunk)
+{
+	unsigned int capacity;
+
+	if (!count)
+		return 0;
+
+	for (capacity = chunk ? chunk : 1; capacity < count; capacity <<= 1) {
+		if (capacity > UINT_MAX / 2)
+			return count;
+	}
+	return capacity;
+}
+
+ni_bool_t
+ni_array_grow(void **data, size_t entsize, unsigned int count,
+		unsigned int newcount, unsigned int chunk)
+{
+	unsigned int capacity;
+	unsigned char *newdata;
+
+	if (!data || !entsize)
+		return FALSE;
+	if (newcount <= count)
+		return TRUE;
+
+	/* reserved or allocated by a previous resize */
+	if (*data && malloc_usable_size(*data) / entsize >= newcount) {
+		memset((unsigned char *)*data + count * entsize, 0,
+				(newcount - count) * entsize);
+		return TRUE;
+	}
+
+	capacity = ni_array_capacity(newcount, chunk);
+	if (SIZE_MAX / entsize < capacity)
+		return FALSE;
+
+	if (!(newdata = realloc(*data, capacity * entsize)))
+		return FALSE;
+
+	memset(newdata + count * entsize, 0, (capacity - count) * entsize);
+	*data = newdata;
+	return TRUE;
+}
+
 ni_bool_t
 ni_try_mlock(const void *ptr, size_t len)
 {
@@ -22,8 +22,10 @@
 #endif
 
 #include <stdlib.h>
+#include <net/if_arp.h>
 
 #include <wicked/vxlan.h>
+#include <wicked/netinfo.h>
 #include "util_priv.h"
 
 /*
@@ -75,3 +77,54 @@ ni_vxlan_validate(const ni_vxlan_t *vxlan, const ni_netdev_ref_t *link)
 	return NULL;
 }
 
+/*
+ * Forwarding database entry arrays
+ */
+#define NI_VXLAN_FDB_ARRAY_CHUNK	64
+
+ni_bool_t
+ni_vxlan_fdb_array_append(ni_vxlan_fdb_array_t *array, const ni_vxlan_fdb_entry_t *entry)
+{
+	ni_vxlan_fdb_entry_t *data;
+	size_t size;
+
+	if (!array || !entry)
+		return FALSE;
+
+	if ((array->count % NI_VXLAN_FDB_ARRAY_CHUNK) == 0) {
+		size = array->count + NI_VXLAN_FDB_ARRAY_CHUNK;
+		if (!(data = realloc(array->data, size * sizeof(*data))))
+			return FALSE;
+		array->data = data;
+	}
+	array->data[array->count++] = *entry;
+	return TRUE;
+}
+
+void
+ni_vxlan_fdb_array_destroy(ni_vxlan_fdb_array_t *array)
+{
+	if (array) {
+		free(array->data);
+		array->data = NULL;
+		array->count = 0;
+	}
+}
+
+const char *
+ni_vxlan_fdb_entry_validate(const ni_vxlan_fdb_entry_t *entry)
+{
+	if (!entry)
+		return "Invalid/empty vxlan fdb entry";
+
+	if (entry->lladdr.len != ni_link_address_length(ARPHRD_ETHER))
+		return "vxlan fdb entry requires an ethernet address";
+
+	if (entry->dst.ss_family != AF_INET && entry->dst.ss_family != AF_INET6)
+		return "vxlan fdb entry requires an ipv4 or ipv6 destination";
+
+	if (entry->vni > 0xffffff)
+		return "vxlan fdb vni not in range 0..16777215";
+
+	return NULL;
+}
@@ -396,17 +396,6 @@ ni_wireless_set_scanning(ni_bool_t enable)
 	__ni_wireless_scanning_enabled = enable;
 }
 
-static void
-ni_wireless_scan_add_bss(ni_wireless_scan_t *scan, ni_wireless_bss_t *bss)
-{
-	ni_wireless_bss_t **next = &scan->bsss;
-
-	ni_assert(bss->next == NULL);
-
-	while(*next != NULL) next = &(*next)->next;
-	*next = bss;
-}
-
 static uint32_t
 ni_wireless_frequency_to_channel(uint16_t frequency)
 {
@@ -428,16 +417,17 @@ static int
 ni_wireless_scan_sync_bss(ni_wireless_scan_t *scan, const ni_wpa_bss_t *bss)
 {
 	int cnt = 0;
-	ni_wireless_bss_t *wireless_bss;
+	ni_wireless_bss_t *wireless_bss, **tail;
 
 	ni_timer_get_time(&scan->last_update);
 	ni_wireless_bss_list_destroy(&scan->bsss);
 
-	for(; bss; bss = bss->next){
+	for(tail = &scan->bsss; bss; bss = bss->next){
 		if (!(wireless_bss = ni_wireless_bss_new()))
 			break;
 		ni_wireless_bss_set(wireless_bss, bss);
-		ni_wireless_scan_add_bss(scan, wireless_bss);
+		*tail = wireless_bss;
+		tail = &wireless_bss->next;
 		cnt++;
 	}
 	return cnt;
@@ -735,6 +725,33 @@ ni_wireless_wpa_map_pmf(ni_wireless_pmf_t p, int *ret)
 	return TRUE;
 }
 
+/*
+ * Enable opportunistic key caching for EAP and the PMKSA caching for
+ * FT-EAP, so roaming between the APs of the network can skip the full
+ * EAP authentication.
+ */
+static ni_bool_t
+ni_wireless_wpa_net_format_pmksa(ni_wpa_net_properties_t *properties, const ni_wireless_network_t *net)
+{
+	unsigned int ft_eap_key_mgmt =
+		NI_BIT(NI_WIRELESS_KEY_MGMT_FT_EAP) | NI_BIT(NI_WIRELESS_KEY_MGMT_FT_EAP_SHA384);
+	const char *name;
+
+	if (!(net->keymgmt_proto & NI_WIRELESS_KEY_MGMT_DEFAULT_EAP))
+		return TRUE;
+
+	name = ni_wpa_net_property_name(NI_WPA_NET_PROPERTY_PROACTIVE_KEY_CACHING);
+	if (!name || !ni_dbus_dict_add_int32(properties, name, 1))
+		return FALSE;
+
+	if (net->keymgmt_proto & ft_eap_key_mgmt) {
+		name = ni_wpa_net_property_name(NI_WPA_NET_PROPERTY_FT_EAP_PMKSA_CACHING);
+		if (!name || !ni_dbus_dict_add_int32(properties, name, 1))
+			return FALSE;
+	}
+	return TRUE;
+}
+
 static ni_bool_t
 ni_wireless_wpa_net_format(ni_wpa_net_properties_t *properties, const ni_wireless_network_t *net)
 {
@@ -822,6 +839,9 @@ ni_wireless_wpa_net_format(ni_wpa_net_properties_t *properties, const ni_wireles
 	if (!ni_wireless_wpa_net_format_eap(properties, net))
 		return FALSE;
 
+	if (!ni_wireless_wpa_net_format_pmksa(properties, net))
+		return FALSE;
+
 	return !ni_dbus_dict_is_empty(properties);
 }
 
@@ -1027,20 +1047,20 @@ ni_wireless_wpa_complete_networks(ni_netdev_t *dev, ni_wireless_network_array_t
 	return TRUE;
 }
 
+/*
+ * Networks with unchanged config are kept in wpa_supplicant, so a
+ * reconnect can reuse their PMKSA cache entries; changed ones are
+ * replaced and networks that aren't in the config deleted.
+ */
 static int
 ni_wireless_setup_networks(ni_netdev_t *dev, ni_wpa_nif_t *wif, const ni_wireless_network_array_t *networks)
 {
-	ni_wpa_net_properties_t properties = NI_DBUS_VARIANT_INIT;
+	ni_wpa_net_properties_t *properties;
 	const ni_wireless_network_t *network;
-	unsigned int i;
+	unsigned int i, count = 0;
+	int ret;
 
-	/*
-	 * TODO: make something more useful here like compare
-	 * and update existing (if needed), add new and delete
-	 * networks that aren't in the config.
-	 * For now: delete everything + add requested.
-	 */
-	if (ni_wpa_nif_del_all_networks(wif) != NI_SUCCESS)
+	if (!(properties = calloc(networks->count + 1, sizeof(*properties))))
 		return NI_ERROR_GENERAL_FAILURE;
 
 	for (i = 0; i < networks->count; ++i) {
@@ -1049,18 +1069,23 @@ ni_wireless_setup_networks(ni_netdev_t *dev, ni_wpa_nif_t *wif, const ni_wireles
 
 		ni_wireless_wpa_set_blobs(wif, network);
 
-		ni_dbus_variant_init_dict(&properties);
-		if (!ni_wireless_wpa_net_format(&properties, network)){
+		ni_dbus_variant_init_dict(&properties[count]);
+		if (!ni_wireless_wpa_net_format(&properties[count], network)){
 			ni_error("Failed to format wireless network config '%.*s'",
 					network->essid.len, network->essid.data);
+			ni_dbus_variant_destroy(&properties[count]);
 			continue;
 		}
-
-		ni_wpa_nif_add_network(wif, &properties, NULL);
-		ni_dbus_variant_destroy(&properties);
+		count++;
 	}
 
-	return 0;
+	ret = ni_wpa_nif_sync_networks(wif, count, properties);
+
+	for (i = 0; i < count; ++i)
+		ni_dbus_variant_destroy(&properties[i]);
+	free(properties);
+
+	return ret != NI_SUCCESS ? NI_ERROR_GENERAL_FAILURE : 0;
 }
 
 static int
@@ -1178,6 +1203,13 @@ ni_wireless_setup(ni_netdev_t *dev, ni_wireless_config_t *conf)
 		ni_dbus_variant_set_uint32(data, conf->ap_scan);
 	}
 
+	if (!wif->properties.fast_reauth) {
+		name = ni_wpa_nif_property_name(NI_WPA_NIF_PROPERTY_FAST_REAUTH);
+		var = ni_dbus_dict_add(&arg, name);
+		data = ni_dbus_variant_init_variant(var);
+		ni_dbus_variant_set_bool(data, TRUE);
+	}
+
 	ret = ni_wpa_nif_set_properties(wif, &arg);
 	ni_dbus_variant_destroy(&arg);
 	if (ret < 0)
@@ -2272,7 +2304,7 @@ bad_ssid:
 }
 
 ni_bool_t
-ni_wireless_ssid_eq(ni_wireless_ssid_t *a, ni_wireless_ssid_t *b)
+ni_wireless_ssid_eq(const ni_wireless_ssid_t *a, const ni_wireless_ssid_t *b)
 {
 	if (a == NULL || b == NULL)
 		return a == b;
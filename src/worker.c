@@ -0,0 +1,288 @@
+/*
+ *	Worker threads for blocking system calls of the wickedd daemon
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+
+#include "socket_priv.h"
+#include "util_priv.h"
+#include "worker.h"
+
+/*
+ * The blocking ioctls and sysfs writes run in a small pool of threads,
+ * so the main loop keeps to receive the events while the kernel is busy
+ * to apply a request. The threads take the jobs from the pending queue
+ * and put them in the completed queue, signaling the main loop via an
+ * eventfd socket, which runs the done functions in completion order.
+ */
+typedef struct ni_worker_job	ni_worker_job_t;
+struct ni_worker_job {
+	ni_worker_job_t *	next;
+
+	ni_worker_work_t *	work;
+	ni_worker_done_t *	done;
+	void *			user_data;
+};
+
+typedef struct ni_worker_queue {
+	ni_worker_job_t *	head;
+	ni_worker_job_t **	tail;
+} ni_worker_queue_t;
+
+static struct {
+	pthread_mutex_t		lock;
+	pthread_cond_t		wakeup;
+	ni_bool_t		stopping;
+
+	unsigned int		count;
+	pthread_t		threads[NI_WORKER_THREADS_MAX];
+
+	ni_worker_queue_t	pending;
+	ni_worker_queue_t	completed;
+
+	ni_socket_t *		sock;
+} ni_worker_pool = {
+	.lock			= PTHREAD_MUTEX_INITIALIZER,
+	.wakeup			= PTHREAD_COND_INITIALIZER,
+};
+
+static inline void
+ni_worker_queue_init(ni_worker_queue_t *queue)
+{
+	queue->head = NULL;
+	queue->tail = &queue->head;
+}
+
+static inline void
+ni_worker_queue_push(ni_worker_queue_t *queue, ni_worker_job_t *job)
+{
+	job->next = NULL;
+	*queue->tail = job;
+	queue->tail = &job->next;
+}
+
+static inline ni_worker_job_t *
+ni_worker_queue_pop(ni_worker_queue_t *queue)
+{
+	ni_worker_job_t *job;
+
+	if ((job = queue->head)) {
+		queue->head = job->next;
+		if (!queue->head)
+			queue->tail = &queue->head;
+		job->next = NULL;
+	}
+	return job;
+}
+
+static inline ni_worker_job_t *
+ni_worker_queue_take(ni_worker_queue_t *queue)
+{
+	ni_worker_job_t *list = queue->head;
+
+	ni_worker_queue_init(queue);
+	return list;
+}
+
+static void *
+ni_worker_thread(void *arg)
+{
+	ni_worker_job_t *job;
+	uint64_t one = 1;
+	int iocfd;
+
+	(void)arg;
+	iocfd = socket(PF_INET, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+
+	pthread_mutex_lock(&ni_worker_pool.lock);
+	for (;;) {
+		while (!ni_worker_pool.stopping && !ni_worker_pool.pending.head)
+			pthread_cond_wait(&ni_worker_pool.wakeup, &ni_worker_pool.lock);
+
+		if (ni_worker_pool.stopping)
+			break;
+
+		job = ni_worker_queue_pop(&ni_worker_pool.pending);
+		pthread_mutex_unlock(&ni_worker_pool.lock);
+
+		job->work(iocfd, job->user_data);
+
+		pthread_mutex_lock(&ni_worker_pool.lock);
+		ni_worker_queue_push(&ni_worker_pool.completed, job);
+		if (write(ni_worker_pool.sock->__fd, &one, sizeof(one)) < 0) {
+			/* counter overflow only, still readable */
+		}
+	}
+	pthread_mutex_unlock(&ni_worker_pool.lock);
+
+	if (iocfd >= 0)
+		close(iocfd);
+	return NULL;
+}
+
+static void
+ni_worker_jobs_done(ni_worker_job_t *list, ni_bool_t completed)
+{
+	ni_worker_job_t *job;
+
+	while ((job = list)) {
+		list = job->next;
+		job->done(job->user_data, completed);
+		free(job);
+	}
+}
+
+static void
+ni_worker_pool_receive(ni_socket_t *sock)
+{
+	ni_worker_job_t *list;
+	uint64_t count;
+
+	if (read(sock->__fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		ni_warn("worker pool: unable to read completion event: %m");
+
+	pthread_mutex_lock(&ni_worker_pool.lock);
+	list = ni_worker_queue_take(&ni_worker_pool.completed);
+	pthread_mutex_unlock(&ni_worker_pool.lock);
+
+	ni_worker_jobs_done(list, TRUE);
+}
+
+ni_bool_t
+ni_worker_pool_active(void)
+{
+	return ni_worker_pool.count > 0;
+}
+
+ni_bool_t
+ni_worker_pool_start(unsigned int threads)
+{
+	sigset_t all, saved;
+	int fd;
+
+	if (ni_worker_pool.count)
+		return TRUE;
+
+	if (!threads)
+		threads = NI_WORKER_THREADS;
+	if (threads > NI_WORKER_THREADS_MAX)
+		threads = NI_WORKER_THREADS_MAX;
+
+	if ((fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK)) < 0) {
+		ni_error("worker pool: cannot create eventfd: %m");
+		return FALSE;
+	}
+	if (!(ni_worker_pool.sock = ni_socket_wrap(fd, SOCK_DGRAM))) {
+		close(fd);
+		return FALSE;
+	}
+	ni_worker_pool.sock->receive = ni_worker_pool_receive;
+
+	ni_worker_queue_init(&ni_worker_pool.pending);
+	ni_worker_queue_init(&ni_worker_pool.completed);
+	ni_worker_pool.stopping = FALSE;
+
+	/* the signals are handled by the main loop only */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &saved);
+	while (ni_worker_pool.count < threads) {
+		if (pthread_create(&ni_worker_pool.threads[ni_worker_pool.count],
+					NULL, ni_worker_thread, NULL) != 0)
+			break;
+		ni_worker_pool.count++;
+	}
+	pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+	if (!ni_worker_pool.count) {
+		ni_error("worker pool: cannot create worker threads");
+		ni_socket_release(ni_worker_pool.sock);
+		ni_worker_pool.sock = NULL;
+		return FALSE;
+	}
+
+	ni_socket_activate(ni_worker_pool.sock);
+	ni_debug_events("worker pool: started %u threads", ni_worker_pool.count);
+	return TRUE;
+}
+
+void
+ni_worker_pool_stop(void)
+{
+	ni_worker_job_t *canceled;
+	unsigned int i;
+
+	if (!ni_worker_pool.count)
+		return;
+
+	pthread_mutex_lock(&ni_worker_pool.lock);
+	ni_worker_pool.stopping = TRUE;
+	canceled = ni_worker_queue_take(&ni_worker_pool.pending);
+	pthread_cond_broadcast(&ni_worker_pool.wakeup);
+	pthread_mutex_unlock(&ni_worker_pool.lock);
+
+	/* wait until the running jobs are finished */
+	for (i = 0; i < ni_worker_pool.count; ++i)
+		pthread_join(ni_worker_pool.threads[i], NULL);
+	ni_worker_pool.count = 0;
+
+	ni_worker_jobs_done(ni_worker_queue_take(&ni_worker_pool.completed), TRUE);
+	ni_worker_jobs_done(canceled, FALSE);
+
+	ni_socket_release(ni_worker_pool.sock);
+	ni_worker_pool.sock = NULL;
+}
+
+/*
+ * Queue a job to the worker threads; fails when the pool is not
+ * started, so the caller has to fall back to the blocking call.
+ */
+ni_bool_t
+ni_worker_submit(ni_worker_work_t *work, ni_worker_done_t *done, void *user_data)
+{
+	ni_worker_job_t *job;
+
+	if (!work || !done || !ni_worker_pool.count)
+		return FALSE;
+
+	job = xcalloc(1, sizeof(*job));
+	job->work = work;
+	job->done = done;
+	job->user_data = user_data;
+
+	pthread_mutex_lock(&ni_worker_pool.lock);
+	ni_worker_queue_push(&ni_worker_pool.pending, job);
+	pthread_cond_signal(&ni_worker_pool.wakeup);
+	pthread_mutex_unlock(&ni_worker_pool.lock);
+	return TRUE;
+}
@@ -0,0 +1,43 @@
+/*
+ *	Worker threads for blocking system calls of the wickedd daemon
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef   WICKED_WORKER_H
+#define   WICKED_WORKER_H
+
+#include <wicked/types.h>
+
+#define NI_WORKER_THREADS		2
+#define NI_WORKER_THREADS_MAX		16
+
+/*
+ * The work function runs in a worker thread and is restricted to plain
+ * system calls on the data of the job: the library, its logging and the
+ * global state are not thread-safe. The ioctl socket of the thread is
+ * passed to it. The done function runs in the main loop afterwards,
+ * with completed set to FALSE when the job has been canceled instead.
+ */
+typedef void			ni_worker_work_t(int iocfd, void *user_data);
+typedef void			ni_worker_done_t(void *user_data, ni_bool_t completed);
+
+extern ni_bool_t		ni_worker_pool_start(unsigned int threads);
+extern void			ni_worker_pool_stop(void);
+extern ni_bool_t		ni_worker_pool_active(void);
+
+extern ni_bool_t		ni_worker_submit(ni_worker_work_t *, ni_worker_done_t *, void *);
+
+#endif /* WICKED_WORKER_H */
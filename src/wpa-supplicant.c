@@ -34,6 +34,7 @@
 #include <wicked/netinfo.h>
 
 #include "refcount_priv.h"
+#include "dbus-common.h"
 #include "wpa-supplicant.h"
 
 #include <sys/time.h>
@@ -48,6 +49,7 @@
 #define NI_WPA_OBJECT_PATH_NONE			"/"
 #define NI_WPA_NIF_OBJECT_PREFIX		"/Interfaces/"
 #define NI_WPA_NET_OBJECT_PREFIX		"/Networks/"
+#define NI_WPA_NIF_REFRESH_COALESCE		1000	/* msec		*/
 
 #define SIGNAL_ERR(path, member, msg, ...) \
 	ni_error("%s: %s signal processing error: " msg, path, member, ##__VA_ARGS__);
@@ -87,6 +89,7 @@ static void					ni_wpa_client_properties_init(ni_wpa_client_properties_t *);
 static int					ni_wpa_client_refresh(ni_wpa_client_t *);
 
 static ni_wpa_nif_t *				ni_wpa_nif_by_path(ni_wpa_client_t *wpa, const char *object_path);
+static ni_wpa_nif_t *				ni_wpa_nif_by_bss_path(ni_wpa_client_t *wpa, const char *bss_path);
 
 
 static						ni_declare_refcounted_new(ni_wpa_nif, const char *, unsigned int);
@@ -104,6 +107,7 @@ static ni_wpa_nif_t *				ni_objectmodel_wpa_nif_unwrap(const ni_dbus_object_t *,
 static void					ni_wpa_dbus_signal(ni_dbus_connection_t *, ni_dbus_message_t *, void *);
 static void					ni_wpa_nif_signal(ni_dbus_connection_t *, ni_dbus_message_t *, void *);
 static void					ni_wpa_signal(ni_dbus_connection_t *, ni_dbus_message_t *, void *);
+static void					ni_wpa_bss_signal(ni_dbus_connection_t *, ni_dbus_message_t *, void *);
 
 static						ni_declare_refcounted_new(ni_wpa_bss, ni_wpa_nif_t *, const char *);
 static						ni_declare_refcounted_free(ni_wpa_bss);
@@ -111,11 +115,12 @@ static						ni_declare_refcounted_ref(ni_wpa_bss);
 static ni_bool_t				ni_wpa_bss_init(ni_wpa_bss_t *bss, ni_wpa_nif_t *wif,
 								const char *object_path);
 static void					ni_wpa_bss_destroy(ni_wpa_bss_t *bss);
-static ni_bool_t				ni_wpa_bss_list_append(ni_wpa_bss_t **list, ni_wpa_bss_t *bss);
-static ni_bool_t				ni_wpa_bss_list_remove_by_path(ni_wpa_bss_t **list, const char *path);
-static ni_wpa_bss_t *				ni_wpa_bss_list_find_by_path(ni_wpa_bss_t **list, const char *object_path);
-static void					ni_wpa_bss_list_destroy(ni_wpa_bss_t **list);
+static ni_bool_t				ni_wpa_nif_bss_append(ni_wpa_nif_t *wif, ni_wpa_bss_t *bss);
+static ni_bool_t				ni_wpa_nif_bss_remove_by_path(ni_wpa_nif_t *wif, const char *path);
+static ni_wpa_bss_t *				ni_wpa_nif_bss_find_by_path(ni_wpa_nif_t *wif, const char *object_path);
+static void					ni_wpa_nif_bss_destroy(ni_wpa_nif_t *wif);
 static int					ni_wpa_bss_refresh(ni_wpa_bss_t * bss);
+static int					ni_wpa_bss_refresh_async(ni_wpa_nif_t *wif, ni_wpa_bss_t *bss);
 static ni_wpa_bss_t *				ni_wpa_nif_find_or_create_bss(ni_wpa_nif_t *wif, const char *object_path);
 
 
@@ -407,6 +412,13 @@ ni_wpa_client_open()
 				ni_wpa_nif_signal,
 				wpa);
 
+	ni_dbus_client_add_signal_handler(dbc,
+				NI_WPA_BUS_NAME,	/* sender */
+				NULL,			/* object path */
+				NI_WPA_BSS_INTERFACE,	/* object interface */
+				ni_wpa_bss_signal,
+				wpa);
+
 	ni_dbus_client_add_signal_handler(dbc,
 				NI_DBUS_BUS_NAME,	/* sender */
 				NULL,			/* object path */
@@ -755,6 +767,24 @@ ni_wpa_nif_by_path(ni_wpa_client_t *wpa, const char *object_path)
 	return NULL;
 }
 
+static ni_wpa_nif_t *
+ni_wpa_nif_by_bss_path(ni_wpa_client_t *wpa, const char *bss_path)
+{
+	ni_wpa_nif_t *wif;
+	size_t len;
+
+	if (!wpa || !bss_path)
+		return NULL;
+
+	for (wif = wpa->nifs; wif; wif = wif->next) {
+		if (!wif->object || !(len = ni_string_len(wif->object->path)))
+			continue;
+		if (!strncmp(bss_path, wif->object->path, len) && bss_path[len] == '/')
+			return ni_wpa_nif_ref(wif);
+	}
+	return NULL;
+}
+
 static ni_define_refcounted_new(ni_wpa_nif, const char *, unsigned int);
 static ni_define_refcounted_ref(ni_wpa_nif);
 static ni_define_refcounted_hold(ni_wpa_nif);
@@ -856,6 +886,27 @@ ni_wpa_nif_properties_destroy(ni_wpa_nif_properties_t *properties)
 	}
 }
 
+static void
+ni_wpa_nif_network_free(ni_wpa_nif_network_t *net)
+{
+	if (net) {
+		ni_string_free(&net->path);
+		ni_dbus_variant_destroy(&net->properties);
+		free(net);
+	}
+}
+
+static void
+ni_wpa_nif_networks_destroy(ni_wpa_nif_t *wif)
+{
+	ni_wpa_nif_network_t *net;
+
+	while ((net = wif->networks)) {
+		wif->networks = net->next;
+		ni_wpa_nif_network_free(net);
+	}
+}
+
 static void
 ni_wpa_nif_destroy(ni_wpa_nif_t *wif)
 {
@@ -883,7 +934,8 @@ ni_wpa_nif_destroy(ni_wpa_nif_t *wif)
 		ni_netdev_ref_destroy(&wif->device);
 		ni_wpa_nif_properties_destroy(&wif->properties);
 		ni_wpa_nif_capabilities_destroy(&wif->capabilities);
-		ni_wpa_bss_list_destroy(&wif->bsss);
+		ni_wpa_nif_bss_destroy(wif);
+		ni_wpa_nif_networks_destroy(wif);
 	}
 }
 
@@ -1350,6 +1402,86 @@ ni_wpa_nif_del_all_networks(ni_wpa_nif_t *wif)
 	return err;
 }
 
+/*
+ * Apply the network configurations, leaving networks we've added with
+ * an unchanged configuration in place (including their PMKSA cache
+ * entries), while replacing all others. The configurations of added
+ * networks are moved into the interface for the next comparison.
+ */
+int
+ni_wpa_nif_sync_networks(ni_wpa_nif_t *wif, unsigned int count, ni_wpa_net_properties_t *confs)
+{
+	ni_string_array_t *paths;
+	ni_wpa_nif_network_t **pos, *net;
+	ni_bool_t *applied;
+	unsigned int i;
+	int err;
+
+	if (!wif || !wif->object || (count && !confs))
+		return -NI_ERROR_INVALID_ARGS;
+
+	paths = &wif->properties.network_paths;
+	if (!(applied = calloc(count + 1, sizeof(*applied))))
+		return -NI_ERROR_GENERAL_FAILURE;
+
+	for (pos = &wif->networks; (net = *pos); ) {
+		i = count;
+		if (ni_string_array_index(paths, net->path) >= 0) {
+			for (i = 0; i < count; ++i) {
+				if (!applied[i] && ni_dbus_variant_equal(&net->properties, &confs[i]))
+					break;
+			}
+		}
+
+		if (i < count) {
+			ni_debug_wpa("%s: keeping unchanged network %s", wif->device.name, net->path);
+			applied[i] = TRUE;
+			pos = &net->next;
+		} else {
+			*pos = net->next;
+			ni_wpa_nif_network_free(net);
+		}
+	}
+
+	for (i = paths->count; i-- > 0; ) {
+		for (net = wif->networks; net; net = net->next) {
+			if (ni_string_eq(net->path, paths->data[i]))
+				break;
+		}
+		if (net)
+			continue;
+
+		if ((err = ni_wpa_nif_del_network(wif, paths->data[i])) != NI_SUCCESS)
+			goto cleanup;
+
+		/* we do not get NetworkRemoved signals */
+		ni_string_array_remove_index(paths, i);
+	}
+
+	for (i = 0; i < count; ++i) {
+		ni_stringbuf_t path = NI_STRINGBUF_INIT_DYNAMIC;
+		ni_dbus_variant_t moved = NI_DBUS_VARIANT_INIT;
+
+		if (applied[i])
+			continue;
+
+		if (ni_wpa_nif_add_network(wif, &confs[i], &path) == NI_SUCCESS &&
+		    (net = calloc(1, sizeof(*net)))) {
+			ni_string_dup(&net->path, path.string);
+			net->properties = confs[i];
+			confs[i] = moved;
+			net->next = wif->networks;
+			wif->networks = net;
+		}
+		ni_stringbuf_destroy(&path);
+	}
+	err = NI_SUCCESS;
+
+cleanup:
+	free(applied);
+	return err;
+}
+
 int
 ni_wpa_nif_flush_bss(ni_wpa_nif_t *wif, uint32_t max_age)
 {
@@ -1654,33 +1786,37 @@ ni_wpa_nif_set_state(ni_wpa_nif_t *wif, ni_wpa_nif_state_t new_state)
 		wif->ops.on_state_change(wif, old_state, new_state);
 }
 
+/*
+ * The BSSAdded signal provides all properties of a new BSS and the
+ * BSS PropertiesChanged signal the changes, so we fetch the properties
+ * of BSSs only, we don't know anything about yet (e.g. at startup).
+ *
+ * The GetAll calls are sent all at once without to wait for replies;
+ * a BSS with a call in flight is not requested again.
+ */
 static void
 ni_wpa_nif_refresh_all_bss(ni_wpa_nif_t *wif)
 {
-	unsigned int cnt = 0, i;
-	ni_wpa_bss_t **bss_array, *bss;
-
-	if (!wif->bsss)
-		return;
-
-	/* As a call to ni_wpa_bss_refresh() could manipulate the
-	 * wif->bsss linked list, duo to a incoming BSSRemoved or
-	 * BSSAdded Signals. So we need to copy the list for iteration! */
+	ni_wpa_bss_t *bss;
 
-	for (bss = wif->bsss; bss; bss = bss->next)
-		cnt++;
+	for (bss = wif->bsss; bss; bss = bss->next) {
+		if (bss->fetched || bss->fetching)
+			continue;
 
-	bss_array = malloc(cnt * sizeof(ni_wpa_nif_t *));
+		if (ni_wpa_bss_refresh_async(wif, bss) != 0)
+			ni_error("Failed to refresh bss %s ", bss->object->path);
+	}
+}
 
-	for (bss = wif->bsss, i = 0; bss && i < cnt; bss = bss->next, i++)
-		bss_array[i] = ni_wpa_bss_ref(bss);
+static void
+ni_wpa_nif_scan_notify(ni_wpa_nif_t *wif)
+{
+	if (wif->scan.fetching || !wif->scan.notify)
+		return;
 
-	for (i = 0; i < cnt; i++) {
-		if (ni_wpa_bss_refresh(bss_array[i]) != 0)
-			ni_error("Failed to refresh bss %s ", bss_array[i]->object->path);
-		ni_wpa_bss_drop(&bss_array[i]);
-	}
-	free(bss_array);
+	wif->scan.notify = FALSE;
+	if (wif->ops.on_scan_done)
+		wif->ops.on_scan_done(wif, wif->bsss);
 }
 
 static ni_wpa_bss_t *
@@ -1688,13 +1824,13 @@ ni_wpa_nif_find_or_create_bss(ni_wpa_nif_t *wif, const char *object_path)
 {
 	ni_wpa_bss_t *bss;
 
-	bss = ni_wpa_bss_list_find_by_path(&wif->bsss, object_path);
+	bss = ni_wpa_nif_bss_find_by_path(wif, object_path);
 	if (!bss){
 		if (!(bss = ni_wpa_bss_new(wif, object_path))){
 			ni_error("%s: failed to create BSS (%s)", __func__, object_path);
 			return NULL;
 		}
-		ni_wpa_bss_list_append(&wif->bsss, bss);
+		ni_wpa_nif_bss_append(wif, bss);
 	}
 	/* No ni_wpa_bss_drop() needed, the caller of this function need to do it */
 	return bss;
@@ -1716,8 +1852,9 @@ ni_wpa_nif_signal_scan_done(ni_wpa_nif_t *wif, const char *member, ni_dbus_messa
 	if (success)
 		ni_wpa_nif_refresh_all_bss(wif);
 
-	if (wif->ops.on_scan_done)
-		wif->ops.on_scan_done(wif, wif->bsss);
+	/* deferred until the bss properties requested above arrived */
+	wif->scan.notify = TRUE;
+	ni_wpa_nif_scan_notify(wif);
 
 cleanup:
 	ni_dbus_variant_destroy(&arg);
@@ -1744,7 +1881,9 @@ ni_wpa_nif_signal_bss_added(ni_wpa_nif_t *wif, const char *member, ni_dbus_messa
 
 	if (!ni_dbus_object_set_properties_from_dict(bss->object, &ni_objectmodel_wpa_bss_service, &argv[1], NULL)) {
 		SIGNAL_ERR(path, member, "unable to set properties for BSS (%s)", bss_path);
-		ni_wpa_bss_list_remove_by_path(&wif->bsss, bss_path);
+		ni_wpa_nif_bss_remove_by_path(wif, bss_path);
+	} else {
+		bss->fetched = TRUE;
 	}
 
 cleanup:
@@ -1766,7 +1905,7 @@ ni_wpa_nif_signal_bss_removed(ni_wpa_nif_t *wif, const char *member, ni_dbus_mes
 		goto cleanup;
 	}
 
-	ni_wpa_bss_list_remove_by_path(&wif->bsss, bss_path);
+	ni_wpa_nif_bss_remove_by_path(wif, bss_path);
 
 cleanup:
 	ni_dbus_variant_destroy(&arg);
@@ -1778,8 +1917,13 @@ ni_wpa_nif_get_current_bss(ni_wpa_nif_t *wif)
 	const char *path;
 	ni_wpa_bss_t *bss;
 
-	if (ni_wpa_nif_refresh(wif) < 0)
-		return NULL;
+	/* the PropertiesChanged signals keep the properties up to date,
+	 * so we skip the GetAll call when they've been just refreshed */
+	if (!timerisset(&wif->acquired) ||
+	    ni_timeout_since(&wif->acquired, NULL, NULL) >= NI_WPA_NIF_REFRESH_COALESCE) {
+		if (ni_wpa_nif_refresh(wif) < 0)
+			return NULL;
+	}
 
 	path = wif->properties.current_bss_path;
 	if (!path || !ni_string_startswith(path, ni_dbus_object_get_path(wif->object)))
@@ -1788,8 +1932,12 @@ ni_wpa_nif_get_current_bss(ni_wpa_nif_t *wif)
 	if (!(bss = ni_wpa_nif_find_or_create_bss(wif, path)))
 		return NULL;
 
+	/* kept up to date by the BSS PropertiesChanged signals */
+	if (bss->fetched)
+		return bss;
+
 	if(ni_wpa_bss_refresh(bss) != NI_SUCCESS){
-		ni_wpa_bss_list_remove_by_path(&wif->bsss, path);
+		ni_wpa_nif_bss_remove_by_path(wif, path);
 		ni_wpa_bss_drop(&bss);
 		return NULL;
 	}
@@ -1855,63 +2003,83 @@ ni_wpa_bss_destroy(ni_wpa_bss_t *bss)
 	ni_wpa_bss_properties_destroy(&bss->properties);
 }
 
+static inline ni_wpa_bss_t **
+ni_wpa_nif_bss_bucket(ni_wpa_nif_t *wif, const char *object_path)
+{
+	return &wif->bss_hash[ni_string_hash(object_path) % NI_WPA_BSS_HASH_SIZE];
+}
+
 static ni_bool_t
-ni_wpa_bss_list_append(ni_wpa_bss_t **list, ni_wpa_bss_t *bss)
+ni_wpa_nif_bss_append(ni_wpa_nif_t *wif, ni_wpa_bss_t *bss)
 {
-	if (!list || !bss)
+	ni_wpa_bss_t **list, **bucket;
+
+	if (!wif || !bss || !bss->object)
 		return FALSE;
 
-	while (*list)
+	for (list = &wif->bsss; *list; )
 		list = &(*list)->next;
 	*list = ni_wpa_bss_ref(bss);
+
+	bucket = ni_wpa_nif_bss_bucket(wif, bss->object->path);
+	bss->hnext = *bucket;
+	*bucket = bss;
 	return TRUE;
 }
 
 static ni_bool_t
-ni_wpa_bss_list_remove_by_path(ni_wpa_bss_t **list, const char *path)
+ni_wpa_nif_bss_remove_by_path(ni_wpa_nif_t *wif, const char *path)
 {
-	ni_wpa_bss_t *i;
+	ni_wpa_bss_t **pos, *bss;
 
-	if (!list || !path)
+	if (!wif || !path)
 		return FALSE;
 
-	for(i = *list; i; i = i->next){
-		if (ni_string_eq(i->object->path, path)){
-			*list = i->next;
-			ni_wpa_bss_free(i);
-			return TRUE;
+	for (pos = ni_wpa_nif_bss_bucket(wif, path); (bss = *pos); pos = &bss->hnext) {
+		if (ni_string_eq(bss->object->path, path))
+			break;
+	}
+	if (!bss)
+		return FALSE;
+	*pos = bss->hnext;
+	bss->hnext = NULL;
+
+	for (pos = &wif->bsss; *pos; pos = &(*pos)->next) {
+		if (*pos == bss) {
+			*pos = bss->next;
+			bss->next = NULL;
+			break;
 		}
-		list = &i->next;
 	}
-	return FALSE;
+	ni_wpa_bss_free(bss);
+	return TRUE;
 }
 
 static void
-ni_wpa_bss_list_destroy(ni_wpa_bss_t **list)
+ni_wpa_nif_bss_destroy(ni_wpa_nif_t *wif)
 {
 	ni_wpa_bss_t *bss;
 
-	if (list) {
-		while ((bss = *list)) {
-			*list = bss->next;
-			ni_wpa_bss_free(bss);
-		}
-		*list = NULL;
+	memset(wif->bss_hash, 0, sizeof(wif->bss_hash));
+	while ((bss = wif->bsss)) {
+		wif->bsss = bss->next;
+		bss->hnext = NULL;
+		ni_wpa_bss_free(bss);
 	}
 }
 
 static ni_wpa_bss_t *
-ni_wpa_bss_list_find_by_path(ni_wpa_bss_t **list, const char *object_path)
+ni_wpa_nif_bss_find_by_path(ni_wpa_nif_t *wif, const char *object_path)
 {
-	ni_wpa_bss_t *i;
+	ni_wpa_bss_t *bss;
 
-	if (!list || !object_path)
+	if (!wif || !object_path)
 		return NULL;
 
-	for(i = *list; i; i = i->next)
-		if (ni_string_eq(i->object->path, object_path))
-			return ni_wpa_bss_ref(i);
-
+	for (bss = *ni_wpa_nif_bss_bucket(wif, object_path); bss; bss = bss->hnext) {
+		if (ni_string_eq(bss->object->path, object_path))
+			return ni_wpa_bss_ref(bss);
+	}
 	return NULL;
 }
 
@@ -1950,6 +2118,76 @@ ni_wpa_bss_refresh(ni_wpa_bss_t * bss)
 		dbus_error_free(&error);
 		return rv;
 	}
+	bss->fetched = TRUE;
+	return 0;
+}
+
+static void
+ni_wpa_bss_refresh_reply(ni_dbus_object_t *proxy, ni_dbus_message_t *reply)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	ni_wpa_bss_t *bss = NULL;
+	ni_wpa_nif_t *wif;
+
+	if ((wif = ni_wpa_nif_by_bss_path(wpa_client, proxy->path))) {
+		bss = ni_wpa_nif_bss_find_by_path(wif, proxy->path);
+		if (bss && bss->fetching) {
+			bss->fetching = FALSE;
+			if (ni_dbus_object_refresh_properties_reply(bss->object,
+					&ni_objectmodel_wpa_bss_service, reply, &error))
+				bss->fetched = TRUE;
+			else
+				ni_error("Failed to refresh bss %s: %s", proxy->path,
+						error.message ? error.message : "unknown error");
+			dbus_error_free(&error);
+		}
+		ni_wpa_bss_drop(&bss);
+
+		if (wif->scan.fetching)
+			wif->scan.fetching--;
+		ni_wpa_nif_scan_notify(wif);
+		ni_wpa_nif_drop(&wif);
+	}
+	ni_dbus_object_free(proxy);
+}
+
+/*
+ * Send a Properties.GetAll call for the bss without to wait for the
+ * reply. The call is made on a temporary proxy the reply handler can
+ * release, as the bss object may vanish (BSSRemoved) in the meantime.
+ */
+static int
+ni_wpa_bss_refresh_async(ni_wpa_nif_t *wif, ni_wpa_bss_t *bss)
+{
+	ni_dbus_variant_t arg = NI_DBUS_VARIANT_INIT;
+	ni_dbus_client_t *client;
+	ni_dbus_object_t *proxy;
+	int rv;
+
+	if (!wif || !bss || !bss->object)
+		return -NI_ERROR_INVALID_ARGS;
+
+	if (bss->fetching)
+		return 0;
+
+	if (!(client = ni_dbus_object_get_client(bss->object)))
+		return -NI_ERROR_INVALID_ARGS;
+
+	if (!(proxy = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class,
+			bss->object->path, NI_DBUS_INTERFACE ".Properties", NULL)))
+		return -NI_ERROR_GENERAL_FAILURE;
+
+	ni_dbus_variant_set_string(&arg, NI_WPA_BSS_INTERFACE);
+	rv = ni_dbus_object_call_variant_async(proxy, NI_DBUS_INTERFACE ".Properties",
+			"GetAll", 1, &arg, ni_wpa_bss_refresh_reply, NULL);
+	ni_dbus_variant_destroy(&arg);
+	if (rv < 0) {
+		ni_dbus_object_free(proxy);
+		return rv;
+	}
+
+	bss->fetching = TRUE;
+	wif->scan.fetching++;
 	return 0;
 }
 
@@ -2573,6 +2811,7 @@ ni_wpa_signal_interface_added(ni_wpa_client_t *wpa, const char *member, ni_dbus_
 		ni_debug_wpa("%s signal: reusing an already known interface object %s", member, path);
 		ni_wpa_nif_properties_destroy(&wif->properties);
 		ni_wpa_nif_capabilities_destroy(&wif->capabilities);
+		ni_wpa_nif_networks_destroy(wif);
 		timerclear(&wif->acquired);
 	} else {
 		if (!(wif = ni_wpa_nif_new(NULL, 0))) {
@@ -2892,6 +3131,46 @@ ni_wpa_nif_signal(ni_dbus_connection_t *connection, ni_dbus_message_t *msg, void
 	ni_wpa_nif_drop(&wif);
 }
 
+/*
+ * BSS properties changes of the BSSs of our interfaces
+ */
+static void
+ni_wpa_bss_signal(ni_dbus_connection_t *connection, ni_dbus_message_t *msg, void *user_data)
+{
+	ni_dbus_variant_t arg = NI_DBUS_VARIANT_INIT;
+	const char *member = dbus_message_get_member(msg);
+	const char *path = dbus_message_get_path(msg);
+	ni_wpa_client_t *wpa = user_data;
+	ni_wpa_bss_t *bss = NULL;
+	ni_wpa_nif_t *wif;
+
+	if (!path || !ni_string_eq(member, "PropertiesChanged")) {
+		ni_debug_wpa("%s: received signal `%s` not processed (not implemented)", path, member);
+		return;
+	}
+
+	if (!(wif = ni_wpa_nif_by_bss_path(wpa, path)))
+		return;
+	if (!(bss = ni_wpa_nif_bss_find_by_path(wif, path))) {
+		ni_wpa_nif_drop(&wif);
+		return;
+	}
+
+	if (ni_dbus_message_get_args_variants(msg, &arg, 1) != 1 ||
+	    !ni_dbus_variant_is_dict(&arg)) {
+		SIGNAL_ERR(path, member, "unable to extract property-dict");
+		bss->fetched = FALSE;
+	} else
+	if (!ni_dbus_object_set_properties_from_dict(bss->object, &ni_objectmodel_wpa_bss_service, &arg, NULL)) {
+		SIGNAL_ERR(path, member, "unable to set properties for BSS");
+		bss->fetched = FALSE;
+	}
+
+	ni_wpa_bss_drop(&bss);
+	ni_wpa_nif_drop(&wif);
+	ni_dbus_variant_destroy(&arg);
+}
+
 static void
 ni_wpa_signal(ni_dbus_connection_t *connection, ni_dbus_message_t *msg, void *user_data)
 {
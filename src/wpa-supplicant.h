@@ -11,6 +11,7 @@
 #include <wicked/refcount.h>
 #include "dbus-connection.h"
 
+#define NI_WPA_BSS_HASH_SIZE			64	/* bss by object path	*/
 
 typedef struct ni_wpa_client			ni_wpa_client_t;
 typedef struct ni_wpa_client_ops		ni_wpa_client_ops_t;
@@ -20,6 +21,7 @@ typedef struct ni_wpa_nif_ops			ni_wpa_nif_ops_t;
 typedef struct ni_wpa_nif_properties		ni_wpa_nif_properties_t;
 typedef struct ni_wpa_nif_capabilities		ni_wpa_nif_capabilities_t;
 typedef        ni_dbus_variant_t		ni_wpa_net_properties_t;
+typedef struct ni_wpa_nif_network		ni_wpa_nif_network_t;
 typedef struct ni_wpa_bss			ni_wpa_bss_t;
 typedef struct ni_wpa_bss_properties		ni_wpa_bss_properties_t;
 
@@ -316,6 +318,12 @@ struct	ni_wpa_nif_properties {
 	char *					current_auth_mode;
 };
 
+struct ni_wpa_nif_network {
+	ni_wpa_nif_network_t *			next;
+	char *					path;
+	ni_wpa_net_properties_t			properties;
+};
+
 struct ni_wpa_nif {
 	ni_wpa_nif_t *				next;
 	ni_refcount_t				refcount;
@@ -330,6 +338,8 @@ struct ni_wpa_nif {
 	struct {
 		struct timeval			timestamp;
 		unsigned char			pending;
+		unsigned int			fetching;	/* bss GetAll calls	*/
+		ni_bool_t			notify;		/* on_scan_done pending	*/
 	} scan;
 
 	struct timeval				acquired;
@@ -339,6 +349,9 @@ struct ni_wpa_nif {
 	ni_wpa_nif_capabilities_t		capabilities;
 
 	ni_wpa_bss_t *				bsss;
+	ni_wpa_bss_t *				bss_hash[NI_WPA_BSS_HASH_SIZE];
+
+	ni_wpa_nif_network_t *			networks;	/* added by us	*/
 };
 
 struct ni_wpa_bss_properties {
@@ -372,7 +385,10 @@ struct ni_wpa_bss_properties {
 struct ni_wpa_bss {
 	ni_dbus_object_t *			object;
 	ni_wpa_bss_t *				next;
+	ni_wpa_bss_t *				hnext;		/* bss_hash chain	*/
 	ni_refcount_t				refcount;
+	ni_bool_t				fetched;	/* properties known	*/
+	ni_bool_t				fetching;	/* GetAll call pending	*/
 
 	ni_wpa_bss_properties_t			properties;
 };
@@ -405,6 +421,8 @@ extern int					ni_wpa_nif_add_network(ni_wpa_nif_t *wif, const ni_wpa_net_proper
 								ni_stringbuf_t *path);
 extern int					ni_wpa_nif_del_network(ni_wpa_nif_t *, const char *);
 extern int					ni_wpa_nif_del_all_networks(ni_wpa_nif_t *);
+extern int					ni_wpa_nif_sync_networks(ni_wpa_nif_t *, unsigned int,
+								ni_wpa_net_properties_t *);
 extern int					ni_wpa_nif_set_all_networks_property_enabled(ni_wpa_nif_t *wif, ni_bool_t enable);
 
 extern int					ni_wpa_nif_add_blob(ni_wpa_nif_t *wif, const char *name, const unsigned char *data, size_t len);
@@ -0,0 +1,353 @@
+/*
+ *	Cache of parsed xml files
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <wicked/logging.h>
+#include <wicked/xml.h>
+#include "xml-cache.h"
+#include "util_priv.h"
+#include "buffer.h"
+
+/*
+ * XML file cache.
+ *
+ * Parsing the schema and config files is a noticeable part of the
+ * startup time of every wicked process. The cache stores the parsed
+ * document trees of the files in a compact binary form, keyed by file
+ * name and validated using the file's device, inode, size and
+ * modification time. Stale or unused entries are dropped and the file
+ * is rewritten on close, when anything has changed.
+ */
+#define XML_FILE_CACHE_MAGIC_LEN	8
+#define XML_FILE_CACHE_VERSION	1U
+#define XML_FILE_CACHE_MAX_SIZE	(16U << 20)
+
+typedef struct xml_file_cache_entry xml_file_cache_entry_t;
+struct xml_file_cache_entry {
+	xml_file_cache_entry_t *next;
+	char *			path;
+	uint64_t		dev;
+	uint64_t		ino;
+	uint64_t		size;
+	uint64_t		mtime_sec;
+	uint64_t		mtime_nsec;
+	xml_node_t *		root;
+	ni_bool_t		used;
+};
+
+struct xml_file_cache {
+	char *			filename;
+	char			magic[XML_FILE_CACHE_MAGIC_LEN];
+	xml_file_cache_entry_t *entries;
+	ni_bool_t		dirty;
+};
+
+static void
+xml_file_cache_entry_free(xml_file_cache_entry_t *entry)
+{
+	if (entry) {
+		ni_string_free(&entry->path);
+		xml_node_free(entry->root);
+		free(entry);
+	}
+}
+
+static void
+xml_file_cache_entry_stat(xml_file_cache_entry_t *entry, const struct stat *stb)
+{
+	entry->dev = stb->st_dev;
+	entry->ino = stb->st_ino;
+	entry->size = stb->st_size;
+	entry->mtime_sec = stb->st_mtim.tv_sec;
+	entry->mtime_nsec = stb->st_mtim.tv_nsec;
+}
+
+static ni_bool_t
+xml_file_cache_entry_valid(const xml_file_cache_entry_t *entry, const struct stat *stb)
+{
+	return entry->dev == (uint64_t)stb->st_dev &&
+		entry->ino == (uint64_t)stb->st_ino &&
+		entry->size == (uint64_t)stb->st_size &&
+		entry->mtime_sec == (uint64_t)stb->st_mtim.tv_sec &&
+		entry->mtime_nsec == (uint64_t)stb->st_mtim.tv_nsec;
+}
+
+static ni_bool_t
+xml_file_cache_get_uint64(ni_buffer_t *bp, uint64_t *value)
+{
+	return ni_buffer_get(bp, value, sizeof(*value)) == 0;
+}
+
+static ni_bool_t
+xml_file_cache_get_uint32(ni_buffer_t *bp, uint32_t *value)
+{
+	return ni_buffer_get(bp, value, sizeof(*value)) == 0;
+}
+
+static ni_bool_t
+xml_file_cache_parse(xml_file_cache_t *cache, ni_buffer_t *bp)
+{
+	xml_file_cache_entry_t **tail = &cache->entries;
+	char magic[XML_FILE_CACHE_MAGIC_LEN];
+	uint32_t version, count, len;
+	xml_file_cache_entry_t *entry;
+
+	if (ni_buffer_get(bp, magic, sizeof(magic)) < 0 ||
+	    memcmp(magic, cache->magic, sizeof(magic)) ||
+	    !xml_file_cache_get_uint32(bp, &version) || version != XML_FILE_CACHE_VERSION ||
+	    !xml_file_cache_get_uint32(bp, &count))
+		return FALSE;
+
+	while (count--) {
+		size_t used = 0;
+
+		entry = xcalloc(1, sizeof(*entry));
+		*tail = entry;
+		tail = &entry->next;
+
+		if (!xml_file_cache_get_uint32(bp, &len) || len == 0 ||
+		    len >= PATH_MAX || len > ni_buffer_count(bp))
+			return FALSE;
+		ni_string_set(&entry->path, ni_buffer_head(bp), len);
+		ni_buffer_pull_head(bp, len);
+
+		if (!xml_file_cache_get_uint64(bp, &entry->dev) ||
+		    !xml_file_cache_get_uint64(bp, &entry->ino) ||
+		    !xml_file_cache_get_uint64(bp, &entry->size) ||
+		    !xml_file_cache_get_uint64(bp, &entry->mtime_sec) ||
+		    !xml_file_cache_get_uint64(bp, &entry->mtime_nsec))
+			return FALSE;
+
+		entry->root = xml_node_read_binary(ni_buffer_head(bp),
+					ni_buffer_count(bp), &used, entry->path);
+		if (!entry->root)
+			return FALSE;
+		ni_buffer_pull_head(bp, used);
+	}
+
+	return ni_buffer_count(bp) == 0;
+}
+
+static void
+xml_file_cache_load(xml_file_cache_t *cache)
+{
+	xml_file_cache_entry_t *entry;
+	ni_buffer_t buf;
+	size_t len = 0;
+	void *data;
+	FILE *fp;
+
+	if (!(fp = fopen(cache->filename, "re"))) {
+		if (errno != ENOENT)
+			ni_warn("unable to open xml cache %s: %m", cache->filename);
+		return;
+	}
+
+	data = ni_file_read(fp, &len, XML_FILE_CACHE_MAX_SIZE);
+	fclose(fp);
+	if (!data)
+		return;
+
+	ni_buffer_init_reader(&buf, data, len);
+	if (!xml_file_cache_parse(cache, &buf)) {
+		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_XML,
+			"ignoring invalid xml cache %s", cache->filename);
+		while ((entry = cache->entries) != NULL) {
+			cache->entries = entry->next;
+			xml_file_cache_entry_free(entry);
+		}
+		cache->dirty = TRUE;
+	}
+	free(data);
+}
+
+/*
+ * Return the root node of the (cached) document of the file,
+ * owned by the cache and valid until it is closed.
+ */
+xml_node_t *
+xml_file_cache_get(xml_file_cache_t *cache, const char *filename)
+{
+	xml_file_cache_entry_t **pos, *entry;
+	xml_document_t *doc;
+	struct stat stb;
+
+	if (stat(filename, &stb) < 0) {
+		ni_error("unable to stat xml file \"%s\": %m", filename);
+		return NULL;
+	}
+
+	for (pos = &cache->entries; (entry = *pos); pos = &entry->next) {
+		if (!ni_string_eq(entry->path, filename))
+			continue;
+
+		if (xml_file_cache_entry_valid(entry, &stb)) {
+			entry->used = TRUE;
+			return entry->root;
+		}
+
+		*pos = entry->next;
+		xml_file_cache_entry_free(entry);
+		break;
+	}
+
+	if (!(doc = xml_document_read(filename)))
+		return NULL;
+
+	entry = xcalloc(1, sizeof(*entry));
+	ni_string_dup(&entry->path, filename);
+	xml_file_cache_entry_stat(entry, &stb);
+	entry->root = xml_document_take_root(doc);
+	entry->used = TRUE;
+	xml_document_free(doc);
+
+	entry->next = cache->entries;
+	cache->entries = entry;
+	cache->dirty = TRUE;
+	return entry->root;
+}
+
+static inline void
+xml_file_cache_put_uint32(ni_stringbuf_t *out, uint32_t value)
+{
+	ni_stringbuf_put(out, (const char *)&value, sizeof(value));
+}
+
+static inline void
+xml_file_cache_put_uint64(ni_stringbuf_t *out, uint64_t value)
+{
+	ni_stringbuf_put(out, (const char *)&value, sizeof(value));
+}
+
+static int
+xml_file_cache_save(const xml_file_cache_t *cache)
+{
+	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
+	const xml_file_cache_entry_t *entry;
+	char tempname[PATH_MAX];
+	unsigned int count = 0;
+	int fd, ret = -1;
+	FILE *fp;
+
+	for (entry = cache->entries; entry; entry = entry->next) {
+		if (entry->used)
+			count++;
+	}
+
+	ni_stringbuf_put(&out, cache->magic, sizeof(cache->magic));
+	xml_file_cache_put_uint32(&out, XML_FILE_CACHE_VERSION);
+	xml_file_cache_put_uint32(&out, count);
+	for (entry = cache->entries; entry; entry = entry->next) {
+		if (!entry->used)
+			continue;
+
+		xml_file_cache_put_uint32(&out, strlen(entry->path));
+		ni_stringbuf_puts(&out, entry->path);
+		xml_file_cache_put_uint64(&out, entry->dev);
+		xml_file_cache_put_uint64(&out, entry->ino);
+		xml_file_cache_put_uint64(&out, entry->size);
+		xml_file_cache_put_uint64(&out, entry->mtime_sec);
+		xml_file_cache_put_uint64(&out, entry->mtime_nsec);
+		if (xml_node_write_binary(entry->root, &out) < 0)
+			goto failed;
+	}
+
+	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", cache->filename);
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_XML,
+			"cannot create temporary xml cache file %s: %m", tempname);
+		goto failed;
+	}
+	if (fchmod(fd, 0644) < 0 || !(fp = fdopen(fd, "we"))) {
+		close(fd);
+		unlink(tempname);
+		goto failed;
+	}
+
+	if (ni_file_write(fp, out.string, out.len) < 0) {
+		ni_error("unable to write xml cache %s", tempname);
+		fclose(fp);
+		unlink(tempname);
+		goto failed;
+	}
+	if (fclose(fp) != 0 || rename(tempname, cache->filename) < 0) {
+		ni_error("unable to write xml cache %s: %m", cache->filename);
+		unlink(tempname);
+		goto failed;
+	}
+	ret = 0;
+
+failed:
+	ni_stringbuf_destroy(&out);
+	return ret;
+}
+
+/*
+ * Open the cache file, returns a cache handle used to get the
+ * documents until xml_file_cache_close is called.
+ */
+xml_file_cache_t *
+xml_file_cache_open(const char *filename, const char *magic)
+{
+	xml_file_cache_t *cache;
+
+	if (ni_string_empty(filename) || !magic ||
+	    strlen(magic) != XML_FILE_CACHE_MAGIC_LEN)
+		return NULL;
+
+	cache = xcalloc(1, sizeof(*cache));
+	ni_string_dup(&cache->filename, filename);
+	memcpy(cache->magic, magic, sizeof(cache->magic));
+	xml_file_cache_load(cache);
+
+	return cache;
+}
+
+void
+xml_file_cache_close(xml_file_cache_t *cache)
+{
+	xml_file_cache_entry_t *entry;
+
+	if (!cache)
+		return;
+
+	for (entry = cache->entries; entry && !cache->dirty; entry = entry->next) {
+		if (!entry->used)
+			cache->dirty = TRUE;
+	}
+	if (cache->dirty)
+		xml_file_cache_save(cache);
+
+	while ((entry = cache->entries) != NULL) {
+		cache->entries = entry->next;
+		xml_file_cache_entry_free(entry);
+	}
+	ni_string_free(&cache->filename);
+	free(cache);
+}
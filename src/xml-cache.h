@@ -0,0 +1,32 @@
+/*
+ *	Cache of parsed xml files
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef NI_WICKED_XML_CACHE_H
+#define NI_WICKED_XML_CACHE_H
+
+#include <wicked/types.h>
+#include <wicked/xml.h>
+
+typedef struct xml_file_cache	xml_file_cache_t;
+
+/* cache file name and its 8 character file magic */
+extern xml_file_cache_t *	xml_file_cache_open(const char *, const char *);
+extern xml_node_t *		xml_file_cache_get(xml_file_cache_t *, const char *);
+extern void			xml_file_cache_close(xml_file_cache_t *);
+
+#endif /* NI_WICKED_XML_CACHE_H */
@@ -26,7 +26,11 @@
 #endif
 
 #include <ctype.h>
+#include <string.h>
+#include <unistd.h>
 #include <sys/param.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <wicked/xml.h>
 #include <wicked/logging.h>
@@ -61,6 +65,14 @@ typedef struct xml_reader {
 	FILE *			file;
 	unsigned char *		buffer;		/* FIXME: use in_buffer for this as well */
 
+	/* Whole input in memory: a mapped file or the in_buffer data */
+	struct {
+		const unsigned char *	base;
+		const unsigned char *	pos;
+		const unsigned char *	end;
+		size_t			mapped;
+	} data;
+
 	unsigned int		no_close : 1;
 
 	char *			doctype;
@@ -89,7 +101,9 @@ static void		xml_parse_error(xml_reader_t *, const char *, ...);
 static const char *	xml_parser_state_name(xml_parser_state_t);
 static const char *	xml_token_name(xml_token_type_t token);
 
+struct xml_location_shared *xml_location_shared_new(const char *);
 static xml_location_t *	xml_location_new(struct xml_location_shared *, unsigned int);
+static inline void	xml_location_shared_release(struct xml_location_shared *);
 
 #ifdef XMLDEBUG_PARSER
 static void		xml_debug(const char *, ...);
@@ -104,6 +118,27 @@ static int		xml_reader_destroy(xml_reader_t *xr);
 static int		xml_getc(xml_reader_t *xr);
 static void		xml_ungetc(xml_reader_t *xr, int cc);
 
+static inline ni_bool_t
+xml_reader_in_memory(const xml_reader_t *xr)
+{
+	return xr->data.base != NULL;
+}
+
+/*
+ * Advance the in-memory input position, counting the lines skipped
+ */
+static inline void
+xml_reader_advance(xml_reader_t *xr, const unsigned char *to)
+{
+	const unsigned char *p = xr->data.pos;
+
+	while ((p = memchr(p, '\n', to - p)) != NULL) {
+		xr->lineCount++;
+		p++;
+	}
+	xr->data.pos = to;
+}
+
 /*
  * Document reader implementation
  */
@@ -575,6 +610,15 @@ restart:
 			ni_stringbuf_putc(res, cc);
 		}
 
+		if (xml_reader_in_memory(xr)) {
+			const unsigned char *p = xr->data.pos;
+
+			while (p < xr->data.end && *p != '<' && *p != '&')
+				p++;
+			ni_stringbuf_put(res, (const char *)xr->data.pos, p - xr->data.pos);
+			xml_reader_advance(xr, p);
+		}
+
 		cc = xml_getc(xr);
 	} while (cc != EOF);
 
@@ -628,6 +672,16 @@ xml_get_token_tag(xml_reader_t *xr, ni_stringbuf_t *res)
 	case 'A' ... 'Z':
 	case '_':
 	case '!':
+		if (xml_reader_in_memory(xr)) {
+			const unsigned char *p = xr->data.pos;
+
+			while (p < xr->data.end && (isalnum(*p) ||
+				*p == '_' || *p == '!' || *p == ':' || *p == '-'))
+				p++;
+			ni_stringbuf_put(res, (const char *)xr->data.pos, p - xr->data.pos);
+			xr->data.pos = p;
+			return Identifier;
+		}
 		while ((cc = xml_getc(xr)) != EOF) {
 			if (!isalnum(cc) && cc != '_' && cc != '!' && cc != ':' && cc != '-') {
 				xml_ungetc(xr, cc);
@@ -641,6 +695,19 @@ xml_get_token_tag(xml_reader_t *xr, ni_stringbuf_t *res)
 	case '"':
 		ni_stringbuf_clear(res);
 		oc = cc;
+		if (xml_reader_in_memory(xr)) {
+			const unsigned char *q;
+
+			q = memchr(xr->data.pos, oc, xr->data.end - xr->data.pos);
+			if (q == NULL) {
+				xml_reader_advance(xr, xr->data.end);
+				xml_parse_error(xr, "Unexpected EOF while parsing quoted string");
+				return None;
+			}
+			ni_stringbuf_put(res, (const char *)xr->data.pos, q - xr->data.pos);
+			xml_reader_advance(xr, q + 1);
+			return QuotedString;
+		}
 		while (1) {
 			cc = xml_getc(xr);
 			if (cc == EOF) {
@@ -675,6 +742,17 @@ xml_skip_comment(xml_reader_t *xr)
 		return None;
 	}
 
+	if (xml_reader_in_memory(xr)) {
+		const unsigned char *q;
+
+		q = memmem(xr->data.pos, xr->data.end - xr->data.pos, "-->", 3);
+		if (q != NULL) {
+			xml_reader_advance(xr, q + 3);
+			return Comment;
+		}
+		xml_reader_advance(xr, xr->data.end);
+	}
+
 	while ((cc = xml_getc(xr)) != EOF) {
 		if (cc == '-') {
 			match++;
@@ -757,6 +835,17 @@ xml_skip_space(xml_reader_t *xr, ni_stringbuf_t *result)
 {
 	int cc;
 
+	if (xml_reader_in_memory(xr)) {
+		const unsigned char *p = xr->data.pos;
+
+		while (p < xr->data.end && isspace(*p))
+			p++;
+		if (result)
+			ni_stringbuf_put(result, (const char *)xr->data.pos, p - xr->data.pos);
+		xml_reader_advance(xr, p);
+		return;
+	}
+
 	while ((cc = xml_getc(xr)) != EOF) {
 		if (!isspace(cc)) {
 			xml_ungetc(xr, cc);
@@ -847,6 +936,128 @@ xml_debug(const char *fmt, ...)
 }
 #endif
 
+/*
+ * Read a node tree written by xml_node_write_binary
+ */
+typedef struct xml_binary_reader {
+	const unsigned char *	pos;
+	const unsigned char *	end;
+	struct xml_location_shared *shared_location;
+} xml_binary_reader_t;
+
+static ni_bool_t
+xml_binary_get_uint(xml_binary_reader_t *br, uint32_t *value)
+{
+	if ((size_t)(br->end - br->pos) < sizeof(*value))
+		return FALSE;
+	memcpy(value, br->pos, sizeof(*value));
+	br->pos += sizeof(*value);
+	return TRUE;
+}
+
+static ni_bool_t
+xml_binary_get_string(xml_binary_reader_t *br, const char **str, size_t *len)
+{
+	uint32_t n;
+
+	if (!xml_binary_get_uint(br, &n))
+		return FALSE;
+
+	if (n == XML_BINARY_NULL) {
+		*str = NULL;
+		*len = 0;
+		return TRUE;
+	}
+	if ((size_t)(br->end - br->pos) < n)
+		return FALSE;
+
+	*str = (const char *)br->pos;
+	*len = n;
+	br->pos += n;
+	return TRUE;
+}
+
+static xml_node_t *
+xml_binary_get_node(xml_binary_reader_t *br, xml_node_t *parent, unsigned int depth)
+{
+	char *name = NULL, *value = NULL;
+	uint32_t line, count, i;
+	const char *str;
+	xml_node_t *node;
+	size_t len;
+
+	if (depth > 256 || !xml_binary_get_uint(br, &line) ||
+	    !xml_binary_get_string(br, &str, &len))
+		return NULL;
+
+	ni_string_set(&name, str, len);
+	node = xml_node_new(name, NULL);
+	if (br->shared_location)
+		node->location = xml_location_new(br->shared_location, line);
+
+	if (!xml_binary_get_string(br, &str, &len))
+		goto failure;
+	if (str)
+		ni_string_set(&node->cdata, str, len);
+
+	if (!xml_binary_get_uint(br, &count))
+		goto failure;
+	for (i = 0; i < count; ++i) {
+		if (!xml_binary_get_string(br, &str, &len))
+			goto failure;
+		ni_string_set(&name, str, len);
+
+		if (!xml_binary_get_string(br, &str, &len))
+			goto failure;
+		ni_string_free(&value);
+		if (str)
+			ni_string_set(&value, str, len);
+
+		xml_node_add_attr(node, name, value);
+	}
+
+	if (!xml_binary_get_uint(br, &count))
+		goto failure;
+	for (i = 0; i < count; ++i) {
+		if (!xml_binary_get_node(br, node, depth + 1))
+			goto failure;
+	}
+
+	ni_string_free(&name);
+	ni_string_free(&value);
+	if (parent)
+		xml_node_add_child(parent, node);
+	return node;
+
+failure:
+	ni_string_free(&name);
+	ni_string_free(&value);
+	xml_node_free(node);
+	return NULL;
+}
+
+xml_node_t *
+xml_node_read_binary(const void *data, size_t len, size_t *used, const char *location)
+{
+	xml_binary_reader_t br;
+	xml_node_t *node;
+
+	if (!data)
+		return NULL;
+
+	br.pos = data;
+	br.end = br.pos + len;
+	br.shared_location = location ? xml_location_shared_new(location) : NULL;
+
+	node = xml_binary_get_node(&br, NULL, 0);
+	if (node && used)
+		*used = br.pos - (const unsigned char *)data;
+
+	if (br.shared_location)
+		xml_location_shared_release(br.shared_location);
+	return node;
+}
+
 /*
  * Location handling
  */
@@ -1009,6 +1220,34 @@ xml_location_free(xml_location_t *loc)
 /*
  * XML Reader object
  */
+static ni_bool_t
+xml_reader_map_file(xml_reader_t *xr)
+{
+	static const unsigned char empty[1];
+	struct stat stb;
+	void *addr;
+
+	if (fstat(fileno(xr->file), &stb) < 0 || !S_ISREG(stb.st_mode))
+		return FALSE;
+
+	if (stb.st_size == 0) {
+		xr->data.base = empty;
+		xr->data.pos  = empty;
+		xr->data.end  = empty;
+		return TRUE;
+	}
+
+	addr = mmap(NULL, stb.st_size, PROT_READ, MAP_PRIVATE, fileno(xr->file), 0);
+	if (addr == MAP_FAILED)
+		return FALSE;
+
+	xr->data.mapped = stb.st_size;
+	xr->data.base = addr;
+	xr->data.pos  = addr;
+	xr->data.end  = xr->data.base + stb.st_size;
+	return TRUE;
+}
+
 static int
 xml_reader_open(xml_reader_t *xr, const char *filename)
 {
@@ -1021,7 +1260,13 @@ xml_reader_open(xml_reader_t *xr, const char *filename)
 		return -1;
 	}
 
-	xr->buffer = xmalloc(XML_READER_BUFSZ);
+	/* Regular files are mapped and scanned in place */
+	if (xml_reader_map_file(xr)) {
+		fclose(xr->file);
+		xr->file = NULL;
+	} else {
+		xr->buffer = xmalloc(XML_READER_BUFSZ);
+	}
 	xr->state = Initial;
 	xr->lineCount = 1;
 	xr->shared_location = xml_location_shared_new(filename);
@@ -1058,6 +1303,10 @@ xml_reader_init_buffer(xml_reader_t *xr, ni_buffer_t *buf, const char *location)
 	xr->in_buffer = buf;
 	xr->no_close = 1;
 
+	xr->data.base = buf->base + buf->head;
+	xr->data.pos  = xr->data.base;
+	xr->data.end  = buf->base + MAX(buf->head, buf->tail);
+
 	xr->state = Initial;
 	xr->lineCount = 1;
 	xr->shared_location = xml_location_shared_new(location);
@@ -1080,6 +1329,14 @@ xml_reader_destroy(xml_reader_t *xr)
 		free(xr->buffer);
 		xr->buffer = NULL;
 	}
+	if (xr->in_buffer) {
+		/* consume the parsed input in the buffer */
+		xr->in_buffer->head = xr->data.pos - xr->in_buffer->base;
+		xr->in_buffer = NULL;
+	}
+	if (xr->data.mapped)
+		munmap((void *)xr->data.base, xr->data.mapped);
+	memset(&xr->data, 0, sizeof(xr->data));
 
 	if (xr->shared_location) {
 		xml_location_shared_release(xr->shared_location);
@@ -1093,8 +1350,10 @@ xml_getc(xml_reader_t *xr)
 {
 	int cc;
 
-	if (xr->in_buffer) {
-		cc = ni_buffer_getc(xr->in_buffer);
+	if (xml_reader_in_memory(xr)) {
+		if (xr->data.pos >= xr->data.end)
+			return EOF;
+		cc = *xr->data.pos++;
 		if (cc == '\n')
 			xr->lineCount++;
 		return cc;
@@ -1127,11 +1386,16 @@ xml_getc(xml_reader_t *xr)
 void
 xml_ungetc(xml_reader_t *xr, int cc)
 {
-	if (xr->in_buffer) {
-		if (ni_buffer_ungetc(xr->in_buffer, cc) < 0)
+	if (xml_reader_in_memory(xr)) {
+		if (cc == EOF)
+			return;
+		if (xr->data.pos == xr->data.base || xr->data.pos[-1] != cc) {
 			ni_error("xml_ungetc: cannot put back");
+			return;
+		}
 		if (cc == '\n')
 			xr->lineCount--;
+		xr->data.pos--;
 		return;
 	}
 
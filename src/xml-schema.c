@@ -13,6 +13,7 @@
 #include <wicked/xml.h>
 #include <wicked/logging.h>
 #include "xml-schema.h"
+#include "xml-cache.h"
 #include "util_priv.h"
 
 static int		ni_xs_process_include(xml_node_t *, ni_xs_scope_t *);
@@ -278,6 +279,7 @@ ni_xs_type_free(ni_xs_type_t *type)
 		xml_node_free(type->meta);
 	type->meta = NULL;
 
+	ni_string_free(&type->signature);
 	ni_string_free(&type->description);
 	ni_string_free(&type->name);
 	free(type);
@@ -323,6 +325,7 @@ ni_xs_name_type_array_destroy(ni_xs_name_type_array_t *array)
 		ni_xs_type_release(def->type);
 	}
 	free(array->data);
+	free(array->index);
 	memset(array, 0, sizeof(*array));
 }
 
@@ -342,6 +345,9 @@ ni_xs_name_type_array_append(ni_xs_name_type_array_t *array, const char *name, n
 		array->data = xrealloc(array->data, (array->count + 32) * sizeof(array->data[0]));
 	}
 	def = &array->data[array->count++];
+	free(array->index);
+	array->index = NULL;
+	array->index_size = 0;
 	def->name = xstrdup(name);
 	def->type = ni_xs_type_hold(type);
 	def->description = xstrdup(description);
@@ -359,15 +365,62 @@ ni_xs_name_type_array_copy(ni_xs_name_type_array_t *dst, const ni_xs_name_type_a
 		ni_xs_name_type_array_append(dst, def->name, def->type, def->description);
 }
 
+/*
+ * The (de)serialization looks up every xml element or dict entry in
+ * the member array of its dict type, so larger arrays get an open
+ * addressing hash index of the first definition of each name.
+ */
+#define NI_XS_NAME_TYPE_INDEX_MIN	8
+
+static void
+ni_xs_name_type_array_build_index(ni_xs_name_type_array_t *array)
+{
+	unsigned int size, i, h;
+
+	for (size = 16; size < 2 * array->count; size <<= 1)
+		;
+
+	array->index = xcalloc(size, sizeof(array->index[0]));
+	array->index_size = size;
+	for (i = 0; i < array->count; ++i) {
+		const char *name = array->data[i].name;
+
+		if (!name)
+			continue;
+
+		for (h = ni_string_hash(name) & (size - 1); array->index[h];
+				h = (h + 1) & (size - 1)) {
+			if (ni_string_eq(array->data[array->index[h] - 1].name, name))
+				break;
+		}
+		if (!array->index[h])
+			array->index[h] = i + 1;
+	}
+}
+
 static ni_xs_type_t *
 ni_xs_name_type_array_find_local(const ni_xs_name_type_array_t *array, const char *name)
 {
 	ni_xs_name_type_t *def;
-	unsigned int i;
+	unsigned int i, h, size;
 
 	if (!name || !array)
 		return NULL;
 
+	if (array->count >= NI_XS_NAME_TYPE_INDEX_MIN) {
+		if (!array->index)
+			ni_xs_name_type_array_build_index((ni_xs_name_type_array_t *)array);
+
+		size = array->index_size;
+		for (h = ni_string_hash(name) & (size - 1); (i = array->index[h]);
+				h = (h + 1) & (size - 1)) {
+			def = &array->data[i - 1];
+			if (ni_string_eq(def->name, name))
+				return def->type;
+		}
+		return NULL;
+	}
+
 	for (i = 0, def = array->data; i < array->count; ++i, ++def) {
 		if (ni_string_eq(def->name, name))
 			return def->type;
@@ -609,6 +662,34 @@ ni_xs_is_reserved_name(const char *name)
 	return __string_is_in_list(name, reserved);
 }
 
+/*
+ * Schema file cache, see xml-cache.c
+ */
+#define NI_XS_CACHE_MAGIC	"WICKEDXS"
+
+static xml_file_cache_t *	ni_xs_cache;
+
+/*
+ * Use the cache file while processing schema files, until
+ * ni_xs_cache_close is called.
+ */
+int
+ni_xs_cache_open(const char *filename)
+{
+	if (ni_string_empty(filename) || ni_xs_cache)
+		return -1;
+
+	ni_xs_cache = xml_file_cache_open(filename, NI_XS_CACHE_MAGIC);
+	return ni_xs_cache ? 0 : -1;
+}
+
+void
+ni_xs_cache_close(void)
+{
+	xml_file_cache_close(ni_xs_cache);
+	ni_xs_cache = NULL;
+}
+
 /*
  * Parse an XML schema file and process it
  */
@@ -625,6 +706,20 @@ ni_xs_process_schema_file(const char *filename, ni_xs_scope_t *scope)
 		return -1;
 	}
 
+	if (ni_xs_cache) {
+		xml_node_t *root;
+
+		if (!(root = xml_file_cache_get(ni_xs_cache, filename))) {
+			ni_error("cannot parse schema file \"%s\"", filename);
+			return -1;
+		}
+		if (ni_xs_process_schema(root, scope) < 0) {
+			ni_error("invalid schema xml for schema file \"%s\"", filename);
+			return -1;
+		}
+		return 0;
+	}
+
 	doc = xml_document_read(filename);
 	if (doc == NULL) {
 		ni_error("cannot parse schema file \"%s\"", filename);
@@ -802,7 +897,7 @@ ni_xs_process_method(xml_node_t *node, ni_xs_service_t *service, ni_xs_scope_t *
 			if (method->meta == NULL)
 				method->meta = xml_node_new("meta", NULL);
 			xml_node_reparent(method->meta, child);
-			ni_string_dup(&child->name, child->name + 5);
+			xml_node_set_name(child, child->name + 5);
 		}
 	}
 
@@ -1301,7 +1396,7 @@ ni_xs_build_simple_type(xml_node_t *node, const char *typeName, ni_xs_scope_t *s
 			if (meta == NULL)
 				meta = xml_node_new("meta", NULL);
 			xml_node_reparent(meta, child);
-			ni_string_dup(&child->name, child->name + 5);
+			xml_node_set_name(child, child->name + 5);
 		}
 	}
 	if (meta) {
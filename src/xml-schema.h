@@ -180,6 +180,10 @@ struct ni_xs_name_type {
 typedef struct ni_xs_name_type_array {
 	unsigned int		count;
 	ni_xs_name_type_t *	data;
+
+	/* name hash index, built on first lookup */
+	unsigned int		index_size;
+	unsigned int *		index;
 } ni_xs_name_type_array_t;
 
 typedef struct ni_xs_intmap {
@@ -294,6 +298,9 @@ struct ni_xs_type {
 
 	/* <meta> node holding additional information */
 	xml_node_t *		meta;
+
+	/* dbus signature, computed on first use */
+	char *			signature;
 };
 
 struct ni_xs_method {
@@ -353,6 +360,9 @@ extern ni_xs_type_t *	ni_xs_scope_lookup_local(const ni_xs_scope_t *, const char
 extern int		ni_xs_process_schema_file(const char *, ni_xs_scope_t *);
 extern int		ni_xs_process_schema(xml_node_t *, ni_xs_scope_t *);
 
+extern int		ni_xs_cache_open(const char *);
+extern void		ni_xs_cache_close(void);
+
 extern ni_xs_type_t *	ni_xs_scalar_new(const char *, unsigned int);
 extern int		ni_xs_scope_typedef(ni_xs_scope_t *, const char *, ni_xs_type_t *, const char *);
 extern void		ni_xs_type_free(ni_xs_type_t *type);
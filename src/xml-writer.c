@@ -30,25 +30,49 @@
 #include "netinfo_priv.h"
 #include "buffer.h"
 
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#define XML_WRITER_BUFSIZE	4096
+
+/*
+ * The writer escapes and formats directly into its buffer, which is
+ * flushed to the file, fd or hash in XML_WRITER_BUFSIZE chunks. When
+ * none of them is set, it collects the whole output in the string.
+ */
 typedef struct xml_writer {
 	FILE *		file;
+	int		fd;
 	ni_hashctx_t *	hash;
-	unsigned int	noclose : 1;
-	ni_stringbuf_t	buffer;
+	unsigned int	noclose : 1,
+			failed  : 1;
+	ni_stringbuf_t	string;
+	size_t		len;
+	char		data[XML_WRITER_BUFSIZE];
 } xml_writer_t;
 
 static int		xml_writer_open(xml_writer_t *, const char *);
 static int		xml_writer_init_file(xml_writer_t *, FILE *);
+static int		xml_writer_init_fd(xml_writer_t *, int);
 static int		xml_writer_init_hash(xml_writer_t *, ni_hashctx_algo_t);
+static int		xml_writer_init_string(xml_writer_t *);
 static int		xml_writer_close(xml_writer_t *);
 static int		xml_writer_destroy(xml_writer_t *);
 static int		xml_writer_destroy_get_hash(xml_writer_t *, void *, size_t);
+static char *		xml_writer_destroy_get_string(xml_writer_t *);
+static void		xml_writer_put(xml_writer_t *, const char *, size_t);
+static void		xml_writer_puts(xml_writer_t *, const char *);
+static void		xml_writer_indent(xml_writer_t *, unsigned int);
 static void		xml_writer_printf(xml_writer_t *, const char *, ...);
 
 static void		xml_document_output(const xml_document_t *, xml_writer_t *);
 static void		xml_node_output(const xml_node_t *node, xml_writer_t *, unsigned int indent);
-static const char *	xml_escape_quote(const char *);
-static const char *	xml_escape_entities(const char *, char **);
+static int		xml_node_output_content(const xml_node_t *, xml_writer_t *, unsigned int, int);
+static xml_node_digest_t *xml_node_digest_get(const xml_node_t *);
+static void		xml_writer_flush(xml_writer_t *);
+static void		xml_escape_quote(xml_writer_t *, const char *);
+static void		xml_escape_entities(xml_writer_t *, const char *);
 
 int
 xml_document_write(const xml_document_t *doc, const char *filename)
@@ -77,25 +101,25 @@ xml_document_print(const xml_document_t *doc, FILE *fp)
 char *
 xml_document_sprint(const xml_document_t *doc)
 {
-	char *string = NULL;
-	size_t size = 0;
-	FILE *fp;
-	int rv;
+	xml_writer_t writer;
 
-	if ((fp = open_memstream(&string, &size)) == NULL) {
-		ni_error("%s: unable to open memstream", __func__);
+	if (xml_writer_init_string(&writer) < 0)
 		return NULL;
-	}
 
-	rv = xml_document_print(doc, fp);
-	fclose(fp);
+	xml_document_output(doc, &writer);
+	return xml_writer_destroy_get_string(&writer);
+}
 
-	if (rv < 0) {
-		free(string);
-		return NULL;
-	}
+int
+xml_document_write_fd(const xml_document_t *doc, int fd)
+{
+	xml_writer_t writer;
 
-	return string;
+	if (xml_writer_init_fd(&writer, fd) < 0)
+		return -1;
+
+	xml_document_output(doc, &writer);
+	return xml_writer_destroy(&writer);
 }
 
 int
@@ -160,38 +184,63 @@ xml_node_print(const xml_node_t *node, FILE *fp)
 char *
 xml_node_sprint(const xml_node_t *node)
 {
-	char *string = NULL;
-	size_t size = 0;
-	FILE *fp;
-	int rv;
+	xml_writer_t writer;
 
-	if ((fp = open_memstream(&string, &size)) == NULL) {
-		ni_error("%s: unable to open memstream", __func__);
+	if (xml_writer_init_string(&writer) < 0)
 		return NULL;
-	}
 
-	rv = xml_node_print(node, fp);
-	fclose(fp);
+	xml_node_output(node, &writer, 0);
+	return xml_writer_destroy_get_string(&writer);
+}
 
-	if (rv < 0) {
-		free(string);
-		return NULL;
-	}
+int
+xml_node_write_fd(const xml_node_t *node, int fd)
+{
+	xml_writer_t writer;
 
-	return string;
+	if (xml_writer_init_fd(&writer, fd) < 0)
+		return -1;
+
+	xml_node_output(node, &writer, 0);
+	return xml_writer_destroy(&writer);
 }
 
 int
 xml_node_hash(const xml_node_t *node, unsigned int algo,
 		void *md_buffer, size_t md_size)
 {
+	xml_node_digest_t *digest;
 	xml_writer_t writer;
+	int len;
+
+	if ((digest = node->digest) && digest->hash_algo == algo) {
+		len = min_t(size_t, md_size, digest->hash_len);
+		memcpy(md_buffer, digest->hash, len);
+		return len;
+	}
 
 	if (xml_writer_init_hash(&writer, algo) < 0)
 		return -1;
 
 	xml_node_output(node, &writer, 0);
-	return xml_writer_destroy_get_hash(&writer, md_buffer, md_size);
+	xml_writer_flush(&writer);
+	ni_hashctx_finish(writer.hash);
+
+	len = ni_hashctx_get_digest_length(writer.hash);
+	if (len > 0 && (size_t)len <= sizeof(digest->hash) &&
+	    (digest = xml_node_digest_get(node)) &&
+	    ni_hashctx_get_digest(writer.hash, digest->hash, len) == len) {
+		digest->hash_algo = algo;
+		digest->hash_len = len;
+		len = min_t(size_t, md_size, digest->hash_len);
+		memcpy(md_buffer, digest->hash, len);
+	} else {
+		len = ni_hashctx_get_digest(writer.hash, md_buffer, md_size);
+	}
+
+	if (xml_writer_destroy(&writer) < 0)
+		len = -1;
+	return len;
 }
 
 int
@@ -219,51 +268,120 @@ xml_node_uuid(const xml_node_t *node, unsigned int version,
 	return ni_uuid_set_version(uuid, version);
 }
 
+/*
+ * Compact binary node tree serialization, see xml_node_read_binary.
+ * Integers use the host byte order; the format is meant for local
+ * caches only.
+ */
+static inline void
+xml_binary_put_uint(ni_stringbuf_t *out, uint32_t value)
+{
+	ni_stringbuf_put(out, (const char *)&value, sizeof(value));
+}
+
+static inline void
+xml_binary_put_string(ni_stringbuf_t *out, const char *str)
+{
+	if (str == NULL) {
+		xml_binary_put_uint(out, XML_BINARY_NULL);
+	} else {
+		uint32_t len = strlen(str);
+
+		xml_binary_put_uint(out, len);
+		ni_stringbuf_put(out, str, len);
+	}
+}
+
+int
+xml_node_write_binary(const xml_node_t *node, ni_stringbuf_t *out)
+{
+	const xml_node_t *child;
+	const ni_var_t *attr;
+	unsigned int i, count;
+
+	if (!node || !out)
+		return -1;
+
+	xml_binary_put_uint(out, node->location ? node->location->line : 0);
+	xml_binary_put_string(out, node->name);
+	xml_binary_put_string(out, node->cdata);
+
+	xml_binary_put_uint(out, node->attrs.count);
+	for (i = 0, attr = node->attrs.data; i < node->attrs.count; ++i, ++attr) {
+		xml_binary_put_string(out, attr->name);
+		xml_binary_put_string(out, attr->value);
+	}
+
+	for (count = 0, child = node->children; child; child = child->next)
+		count++;
+	xml_binary_put_uint(out, count);
+	for (child = node->children; child; child = child->next) {
+		if (xml_node_write_binary(child, out) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * The uuid of the node _content_: as a "root like" node with the
+ * children/cdata of the node, but without the node name or attrs.
+ */
 int
 xml_node_content_uuid(const xml_node_t *node, unsigned int version,
 		const ni_uuid_t *namespace, ni_uuid_t *uuid)
 {
-	xml_node_t *temp;
-	int ret;
+	xml_node_digest_t *digest;
+	xml_writer_t writer;
+	ni_hashctx_algo_t algo;
 
-	if (!node->name && !node->attrs.count)
-		return xml_node_uuid(node, version, namespace, uuid);
+	if ((digest = node->digest) && digest->uuid_version == version &&
+	    ni_uuid_equal(&digest->uuid_ns, namespace)) {
+		*uuid = digest->uuid;
+		return 0;
+	}
 
-	/* create a "root like" copy of the node with it's
-	 * children/cdata, but without node name or attrs. */
-	temp = xml_node_clone(node, NULL);
-	ni_var_array_destroy(&temp->attrs);
-	ni_string_free(&temp->name);
+	switch (version) {
+	case 3:	algo = NI_HASHCTX_MD5;	break;
+	case 5:	algo = NI_HASHCTX_SHA1;	break;
+	default:
+		return -1;
+	}
+
+	if (xml_writer_init_hash(&writer, algo) < 0)
+		return -1;
 
-	ret = xml_node_uuid(temp, version, namespace, uuid);
-	xml_node_free(temp);
-	return ret;
+	ni_hashctx_put(writer.hash, namespace, sizeof(*namespace));
+	xml_node_output_content(node, &writer, 0, 1);
+	if (xml_writer_destroy_get_hash(&writer, uuid, sizeof(*uuid)) < 0)
+		return -1;
+
+	if (ni_uuid_set_version(uuid, version) < 0)
+		return -1;
+
+	if ((digest = xml_node_digest_get(node))) {
+		digest->uuid_version = version;
+		digest->uuid_ns = *namespace;
+		digest->uuid = *uuid;
+	}
+	return 0;
 }
 
 int
 xml_node_print_fn(const xml_node_t *node, void (*writefn)(const char *, void *), void *user_data)
 {
-	char *membuf = NULL;
-	size_t memsz = 0;
-	FILE *memf;
-	int rv;
+	char *membuf, *s, *t;
 
-	memf = open_memstream(&membuf, &memsz);
-	rv = xml_node_print(node, memf);
-	fclose(memf);
-
-	if (rv >= 0) {
-		char *s, *t;
+	if (!(membuf = xml_node_sprint(node)))
+		return -1;
 
-		for (s = membuf; s; s = t) {
-			if ((t = strchr(s, '\n')) != NULL)
-				*t++ = '\0';
-			writefn(s, user_data);
-		}
+	for (s = membuf; s; s = t) {
+		if ((t = strchr(s, '\n')) != NULL)
+			*t++ = '\0';
+		writefn(s, user_data);
 	}
 
 	free(membuf);
-	return rv;
+	return 0;
 }
 
 /*
@@ -283,127 +401,157 @@ xml_node_print_debug(const xml_node_t *node, unsigned int facility)
 	return xml_node_print_fn(node, xml_node_trace_printer, facility? &facility : NULL);
 }
 
-void
-xml_node_output(const xml_node_t *node, xml_writer_t *writer, unsigned int indent)
+/*
+ * Allocate the digest cache of a node; it is no part of the content,
+ * so the node constness does not apply to it.
+ */
+static xml_node_digest_t *
+xml_node_digest_get(const xml_node_t *node)
 {
-	unsigned int child_indent = indent;
-	int newline = 0;
+	xml_node_t *np = (xml_node_t *)node;
 
-	if (node->name != NULL) {
-		ni_var_t *attr;
-		unsigned int i;
-
-		xml_writer_printf(writer, "%*.*s<%s", indent, indent, "", node->name);
-		for (i = 0, attr = node->attrs.data; i < node->attrs.count; ++i, ++attr) {
-			if (attr->value)
-				xml_writer_printf(writer, " %s=\"%s\"",
-						attr->name, xml_escape_quote(attr->value));
-			else
-				xml_writer_printf(writer, " %s", attr->name);
-		}
-
-		if (node->cdata == NULL && node->children == NULL) {
-			xml_writer_printf(writer, "/>\n");
-			return;
-		}
-		xml_writer_printf(writer, ">");
-		child_indent += 2;
-	} else {
-		newline = 1;
-	}
+	if (!np->digest)
+		np->digest = calloc(1, sizeof(*np->digest));
+	return np->digest;
+}
 
+/*
+ * Output the cdata and children of a node, returns whether the
+ * output ends with a newline.
+ */
+static int
+xml_node_output_content(const xml_node_t *node, xml_writer_t *writer,
+			unsigned int child_indent, int newline)
+{
 	if (node->cdata) {
 		unsigned int len;
-		char *temp = NULL;
 
 		if (strchr(node->cdata, '\n')) {
-			xml_writer_printf(writer, "\n");
+			xml_writer_put(writer, "\n", 1);
 			newline = 1;
 		}
-		xml_writer_printf(writer, "%s", xml_escape_entities(node->cdata, &temp));
-		ni_string_free(&temp);
+		xml_escape_entities(writer, node->cdata);
 
 		if (newline) {
 			len = strlen(node->cdata);
 			if (len && node->cdata[len-1] != '\n')
-				xml_writer_printf(writer, "\n");
+				xml_writer_put(writer, "\n", 1);
 		}
 	}
 	if (node->children) {
 		xml_node_t *child;
 
 		if (!newline)
-			xml_writer_printf(writer, "\n");
+			xml_writer_put(writer, "\n", 1);
 		for (child = node->children; child; child = child->next)
 			xml_node_output(child, writer, child_indent);
 		newline = 1;
 	}
-
-	if (node->name != NULL) {
-		if (newline)
-			xml_writer_printf(writer, "%*.*s", indent, indent, "");
-		xml_writer_printf(writer, "</%s>\n", node->name);
-	}
+	return newline;
 }
 
-const char *
-xml_escape_entities(const char *cdata, char **temp)
+void
+xml_node_output(const xml_node_t *node, xml_writer_t *writer, unsigned int indent)
 {
-	static const char *escmap[256] = {
-		['<'] = "&lt;",
-		['>'] = "&gt;",
-		['&'] = "&amp;",
-	};
-	const unsigned char *pos;
-	unsigned int expand = 0, idx;
-	char *copy = NULL;
+	unsigned int child_indent = indent;
+	int newline = 0;
 
-	if (!cdata)
-		return NULL;
+	if (node->name != NULL) {
+		ni_var_t *attr;
+		unsigned int i;
 
-	for (pos = (const unsigned char *)cdata; *pos; ++pos) {
-		const char *replace;
+		xml_writer_indent(writer, indent);
+		xml_writer_put(writer, "<", 1);
+		xml_writer_puts(writer, node->name);
+		for (i = 0, attr = node->attrs.data; i < node->attrs.count; ++i, ++attr) {
+			xml_writer_put(writer, " ", 1);
+			xml_writer_puts(writer, attr->name);
+			if (attr->value) {
+				xml_writer_put(writer, "=\"", 2);
+				xml_escape_quote(writer, attr->value);
+				xml_writer_put(writer, "\"", 1);
+			}
+		}
 
-		idx = *pos;
-		if ((replace = escmap[idx]) != NULL)
-			expand += strlen(replace);
+		if (node->cdata == NULL && node->children == NULL) {
+			xml_writer_put(writer, "/>\n", 3);
+			return;
+		}
+		xml_writer_put(writer, ">", 1);
+		child_indent += 2;
+	} else {
+		newline = 1;
 	}
 
-	if (expand == 0)
-		return cdata;
+	newline = xml_node_output_content(node, writer, child_indent, newline);
 
-	copy = *temp = xmalloc(expand + strlen(cdata) + 1);
-	for (pos = (const unsigned char *)cdata; *pos; ++pos) {
-		const char *replace;
+	if (node->name != NULL) {
+		if (newline)
+			xml_writer_indent(writer, indent);
+		xml_writer_put(writer, "</", 2);
+		xml_writer_puts(writer, node->name);
+		xml_writer_put(writer, ">\n", 2);
+	}
+}
 
-		idx = *pos;
-		if ((replace = escmap[idx]) != NULL) {
-			strcpy(copy, replace);
-			copy += strlen(copy);
-		} else {
-			*copy++ = *pos;
+/*
+ * Escape the cdata directly into the writer buffer; strcspn finds the
+ * (usually absent) characters to escape faster than a per-char loop.
+ */
+void
+xml_escape_entities(xml_writer_t *writer, const char *cdata)
+{
+	size_t len;
+
+	while (cdata && *cdata) {
+		len = strcspn(cdata, "<>&");
+		xml_writer_put(writer, cdata, len);
+		cdata += len;
+
+		switch (*cdata) {
+		case '<':
+			xml_writer_put(writer, "&lt;", 4);
+			break;
+		case '>':
+			xml_writer_put(writer, "&gt;", 4);
+			break;
+		case '&':
+			xml_writer_put(writer, "&amp;", 5);
+			break;
+		default:
+			return;
 		}
+		cdata++;
 	}
-	*copy = '\0';
-
-	return *temp;
 }
 
-const char *
-xml_escape_quote(const char *string)
+void
+xml_escape_quote(xml_writer_t *writer, const char *string)
 {
-	return string;
+	xml_writer_puts(writer, string);
 }
 
 /*
  * xml_writer object
  */
+static void
+xml_writer_reset(xml_writer_t *writer)
+{
+	writer->file = NULL;
+	writer->fd = -1;
+	writer->hash = NULL;
+	writer->noclose = 0;
+	writer->failed = 0;
+	writer->len = 0;
+	ni_stringbuf_init(&writer->string);
+}
+
 int
 xml_writer_open(xml_writer_t *writer, const char *filename)
 {
-	memset(writer, 0, sizeof(*writer));
-	writer->file = fopen(filename, "w");
-	if (!writer->file) {
+	xml_writer_reset(writer);
+	writer->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (writer->fd < 0) {
 		ni_error("xml_writer: cannot open %s for writing: %m", filename);
 		return -1;
 	}
@@ -414,33 +562,131 @@ xml_writer_open(xml_writer_t *writer, const char *filename)
 int
 xml_writer_init_file(xml_writer_t *writer, FILE *file)
 {
-	memset(writer, 0, sizeof(*writer));
+	xml_writer_reset(writer);
 	writer->file = file;
 	writer->noclose = 1;
 	return 0;
 }
 
+int
+xml_writer_init_fd(xml_writer_t *writer, int fd)
+{
+	xml_writer_reset(writer);
+	if (fd < 0)
+		return -1;
+	writer->fd = fd;
+	writer->noclose = 1;
+	return 0;
+}
+
 int
 xml_writer_init_hash(xml_writer_t *writer, ni_hashctx_algo_t algo)
 {
-	memset(writer, 0, sizeof(*writer));
+	xml_writer_reset(writer);
 	writer->hash = ni_hashctx_new(algo);
 	if (writer->hash)
 		return 0;
 	return -1;
 }
 
+int
+xml_writer_init_string(xml_writer_t *writer)
+{
+	xml_writer_reset(writer);
+	return 0;
+}
+
+static void
+xml_writer_write(xml_writer_t *writer, const char *data, size_t len)
+{
+	ssize_t ret;
+
+	if (writer->hash) {
+		ni_hashctx_put(writer->hash, data, len);
+	} else
+	if (writer->file) {
+		if (fwrite(data, 1, len, writer->file) != len)
+			writer->failed = 1;
+	} else
+	if (writer->fd >= 0) {
+		while (len && !writer->failed) {
+			ret = write(writer->fd, data, len);
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret <= 0) {
+				writer->failed = 1;
+				break;
+			}
+			data += ret;
+			len -= ret;
+		}
+	} else {
+		ni_stringbuf_put(&writer->string, data, len);
+	}
+}
+
+void
+xml_writer_flush(xml_writer_t *writer)
+{
+	if (writer->len) {
+		xml_writer_write(writer, writer->data, writer->len);
+		writer->len = 0;
+	}
+}
+
+void
+xml_writer_put(xml_writer_t *writer, const char *data, size_t len)
+{
+	if (writer->len + len > sizeof(writer->data)) {
+		xml_writer_flush(writer);
+		if (len >= sizeof(writer->data)) {
+			xml_writer_write(writer, data, len);
+			return;
+		}
+	}
+	memcpy(writer->data + writer->len, data, len);
+	writer->len += len;
+}
+
+void
+xml_writer_puts(xml_writer_t *writer, const char *string)
+{
+	if (string)
+		xml_writer_put(writer, string, strlen(string));
+}
+
+void
+xml_writer_indent(xml_writer_t *writer, unsigned int indent)
+{
+	static const char spaces[] = "                                ";
+	unsigned int len;
+
+	while (indent) {
+		len = min_t(unsigned int, indent, sizeof(spaces) - 1);
+		xml_writer_put(writer, spaces, len);
+		indent -= len;
+	}
+}
+
 int
 xml_writer_close(xml_writer_t *writer)
 {
 	int rv = 0;
 
+	xml_writer_flush(writer);
+	if (writer->failed)
+		rv = -1;
 	if (writer->file && ferror(writer->file))
 		rv = -1;
 	if (writer->file && !writer->noclose) {
 		fclose(writer->file);
 		writer->file = NULL;
 	}
+	if (writer->fd >= 0 && !writer->noclose) {
+		if (close(writer->fd) < 0)
+			rv = -1;
+		writer->fd = -1;
+	}
 	if (writer->hash) {
 		ni_hashctx_free(writer->hash);
 		writer->hash = NULL;
@@ -451,8 +697,11 @@ xml_writer_close(xml_writer_t *writer)
 int
 xml_writer_destroy(xml_writer_t *writer)
 {
-	ni_stringbuf_destroy(&writer->buffer);
-	return xml_writer_close(writer);
+	int rv;
+
+	rv = xml_writer_close(writer);
+	ni_stringbuf_destroy(&writer->string);
+	return rv;
 }
 
 int
@@ -460,6 +709,7 @@ xml_writer_destroy_get_hash(xml_writer_t *writer, void *md_buffer, size_t md_siz
 {
 	int rv;
 
+	xml_writer_flush(writer);
 	ni_hashctx_finish(writer->hash);
 
 	rv = ni_hashctx_get_digest(writer->hash, md_buffer, md_size);
@@ -469,21 +719,29 @@ xml_writer_destroy_get_hash(xml_writer_t *writer, void *md_buffer, size_t md_siz
 	return rv;
 }
 
+char *
+xml_writer_destroy_get_string(xml_writer_t *writer)
+{
+	char *string;
+
+	xml_writer_flush(writer);
+	string = writer->string.string ? writer->string.string : xstrdup("");
+	ni_stringbuf_init(&writer->string);
+	xml_writer_destroy(writer);
+	return string;
+}
+
 void
 xml_writer_printf(xml_writer_t *writer, const char *fmt, ...)
 {
 	char temp[256];
 	va_list ap;
+	int len;
 
 	va_start(ap, fmt);
-	if (writer->file) {
-		vfprintf(writer->file, fmt, ap);
-	} else {
-		vsnprintf(temp, sizeof(temp), fmt, ap);
-		if (writer->hash)
-			ni_hashctx_puts(writer->hash, temp);
-		else
-			ni_stringbuf_puts(&writer->buffer, temp);
-	}
+	len = vsnprintf(temp, sizeof(temp), fmt, ap);
 	va_end(ap);
+
+	if (len > 0)
+		xml_writer_put(writer, temp, min_t(size_t, len, sizeof(temp) - 1));
 }
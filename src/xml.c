@@ -26,7 +26,10 @@
 #include <wicked/xml.h>
 #include <wicked/logging.h>
 #include "util_priv.h"
+#include "array_priv.h"
+#include "stats.h"
 #include <inttypes.h>
+#include <stdint.h>
 
 #define XML_DOCUMENTARRAY_CHUNK		1
 #define XML_NODEARRAY_CHUNK		8
@@ -84,6 +87,22 @@ xml_document_free(xml_document_t *doc)
 	}
 }
 
+/*
+ * Drop the cached digests of a modified node and its parents.
+ * Nodes modified directly instead via the xml_node_* functions
+ * have to be touched by the caller.
+ */
+void
+xml_node_touch(xml_node_t *node)
+{
+	for ( ; node; node = node->parent) {
+		if (node->digest) {
+			node->digest->hash_algo = 0;
+			node->digest->uuid_version = 0;
+		}
+	}
+}
+
 /*
  * Helper functions for xml node list management
  */
@@ -93,6 +112,7 @@ __xml_node_list_insert(xml_node_t **pos, xml_node_t *node, xml_node_t *parent)
 	node->parent = parent;
 	node->next = *pos;
 	*pos = node;
+	xml_node_touch(parent);
 }
 
 static inline xml_node_t *
@@ -101,6 +121,7 @@ __xml_node_list_remove(xml_node_t **pos)
 	xml_node_t *np = *pos;
 
 	if (np) {
+		xml_node_touch(np->parent);
 		np->parent = NULL;
 		*pos = np->next;
 		np->next = NULL;
@@ -128,6 +149,15 @@ __xml_node_list_tail(xml_node_t **pos)
 	return pos;
 }
 
+void
+xml_node_set_name(xml_node_t *node, const char *name)
+{
+	if (node) {
+		node->name = xml_name_intern(name);
+		xml_node_touch(node);
+	}
+}
+
 void
 xml_node_add_child(xml_node_t *parent, xml_node_t *child)
 {
@@ -139,14 +169,223 @@ xml_node_add_child(xml_node_t *parent, xml_node_t *child)
 	__xml_node_list_insert(tail, child, parent);
 }
 
+/*
+ * Element names are interned: the tree stores atoms from a global
+ * table, so name matches are pointer comparisons. The vocabulary of
+ * element names is small, thus the atoms are never released.
+ */
+#define XML_NAME_HASH_MIN		256
+
+typedef struct xml_name		xml_name_t;
+struct xml_name {
+	xml_name_t *		next;
+	unsigned int		hash;
+	char *			name;
+};
+
+static struct {
+	unsigned int		size;
+	unsigned int		count;
+	xml_name_t **		table;
+} xml_names;
+
+static void
+xml_names_resize(unsigned int size)
+{
+	xml_name_t **table, *atom, *next;
+	unsigned int i;
+
+	table = xcalloc(size, sizeof(*table));
+	for (i = 0; i < xml_names.size; ++i) {
+		for (atom = xml_names.table[i]; atom; atom = next) {
+			next = atom->next;
+			atom->next = table[atom->hash & (size - 1)];
+			table[atom->hash & (size - 1)] = atom;
+		}
+	}
+	free(xml_names.table);
+	xml_names.table = table;
+	xml_names.size = size;
+}
+
+static xml_name_t *
+xml_name_find(const char *name, unsigned int hash)
+{
+	xml_name_t *atom;
+
+	if (!xml_names.table)
+		return NULL;
+
+	for (atom = xml_names.table[hash & (xml_names.size - 1)]; atom; atom = atom->next) {
+		if (atom->hash == hash && !strcmp(atom->name, name))
+			return atom;
+	}
+	return NULL;
+}
+
+/*
+ * Return the atom of an element name, adding it when needed
+ */
+const char *
+xml_name_intern(const char *name)
+{
+	unsigned int hash;
+	xml_name_t *atom;
+
+	if (!name)
+		return NULL;
+
+	hash = ni_string_hash(name);
+	if ((atom = xml_name_find(name, hash)))
+		return atom->name;
+
+	if (xml_names.count >= xml_names.size)
+		xml_names_resize(xml_names.size ? xml_names.size * 2 : XML_NAME_HASH_MIN);
+
+	atom = xcalloc(1, sizeof(*atom));
+	atom->hash = hash;
+	atom->name = xstrdup(name);
+	atom->next = xml_names.table[hash & (xml_names.size - 1)];
+	xml_names.table[hash & (xml_names.size - 1)] = atom;
+	xml_names.count++;
+	return atom->name;
+}
+
+/*
+ * Return the atom of an element name or NULL when no element
+ * with this name has been created so far.
+ */
+const char *
+xml_name_lookup(const char *name)
+{
+	xml_name_t *atom;
+
+	if (!name || !(atom = xml_name_find(name, ni_string_hash(name))))
+		return NULL;
+	return atom->name;
+}
+
+/*
+ * The nodes are allocated from aligned chunks, which are released
+ * again when all their nodes are freed, e.g. with the document.
+ * Parsing large documents then does not need a malloc per node and
+ * does not fragment the heap of long running processes.
+ */
+#define XML_NODE_CHUNK_SIZE		16384
+#define XML_NODE_CHUNK_NODES		((XML_NODE_CHUNK_SIZE - sizeof(xml_node_chunk_t)) \
+						/ sizeof(xml_node_t))
+
+typedef struct xml_node_chunk	xml_node_chunk_t;
+struct xml_node_chunk {
+	xml_node_chunk_t *	next;
+	xml_node_chunk_t **	pprev;
+
+	unsigned int		used;
+	unsigned int		bump;
+	xml_node_t *		free;
+};
+
+static xml_node_chunk_t *	xml_node_chunks;	/* chunks with free nodes */
+static xml_node_chunk_t *	xml_node_chunk_spare;
+
+static inline xml_node_chunk_t *
+xml_node_chunk_of(const xml_node_t *node)
+{
+	return (xml_node_chunk_t *)((uintptr_t)node & ~((uintptr_t)XML_NODE_CHUNK_SIZE - 1));
+}
+
+static inline xml_node_t *
+xml_node_chunk_nodes(xml_node_chunk_t *chunk)
+{
+	return (xml_node_t *)(chunk + 1);
+}
+
+static inline void
+xml_node_chunk_link(xml_node_chunk_t *chunk)
+{
+	chunk->pprev = &xml_node_chunks;
+	chunk->next = xml_node_chunks;
+	if (chunk->next)
+		chunk->next->pprev = &chunk->next;
+	xml_node_chunks = chunk;
+}
+
+static inline void
+xml_node_chunk_unlink(xml_node_chunk_t *chunk)
+{
+	if (chunk->pprev) {
+		*chunk->pprev = chunk->next;
+		if (chunk->next)
+			chunk->next->pprev = chunk->pprev;
+		chunk->pprev = NULL;
+		chunk->next = NULL;
+	}
+}
+
+static xml_node_t *
+xml_node_alloc(void)
+{
+	xml_node_chunk_t *chunk;
+	xml_node_t *node;
+	void *ptr;
+
+	if (!(chunk = xml_node_chunks)) {
+		if ((chunk = xml_node_chunk_spare)) {
+			xml_node_chunk_spare = NULL;
+		} else {
+			if (posix_memalign(&ptr, XML_NODE_CHUNK_SIZE, XML_NODE_CHUNK_SIZE) != 0)
+				ni_fatal("%s: unable to allocate xml node chunk", __func__);
+			chunk = ptr;
+			memset(chunk, 0, sizeof(*chunk));
+		}
+		xml_node_chunk_link(chunk);
+	}
+
+	if ((node = chunk->free))
+		chunk->free = node->next;
+	else
+		node = &xml_node_chunk_nodes(chunk)[chunk->bump++];
+
+	if (++chunk->used == XML_NODE_CHUNK_NODES)
+		xml_node_chunk_unlink(chunk);
+
+	ni_stats_object_alloc(NI_STATS_OBJECT_XML, sizeof(*node));
+
+	memset(node, 0, sizeof(*node));
+	return node;
+}
+
+static void
+xml_node_release(xml_node_t *node)
+{
+	xml_node_chunk_t *chunk = xml_node_chunk_of(node);
+
+	ni_stats_object_free(NI_STATS_OBJECT_XML, sizeof(*node));
+	if (chunk->used-- == XML_NODE_CHUNK_NODES)
+		xml_node_chunk_link(chunk);
+
+	if (chunk->used == 0) {
+		/* keep one empty chunk to avoid alloc/free cycles */
+		xml_node_chunk_unlink(chunk);
+		if (xml_node_chunk_spare)
+			free(xml_node_chunk_spare);
+		chunk->free = NULL;
+		chunk->bump = 0;
+		xml_node_chunk_spare = chunk;
+		return;
+	}
+
+	node->next = chunk->free;
+	chunk->free = node;
+}
+
 xml_node_t *
 xml_node_new(const char *ident, xml_node_t *parent)
 {
 	xml_node_t *node;
 
-	node = xcalloc(1, sizeof(xml_node_t));
-	if (ident)
-		node->name = xstrdup(ident);
+	node = xml_node_alloc();
+	node->name = xml_name_intern(ident);
 
 	if (parent)
 		xml_node_add_child(parent, node);
@@ -253,6 +492,32 @@ xml_node_clone_ref(xml_node_t *src)
 	return src;
 }
 
+/*
+ * Copy-on-write: return a node which can be modified by the caller.
+ *
+ * A node shared via xml_node_clone_ref (e.g. with its parent document)
+ * is replaced by a deep, detached copy, dropping the reference to the
+ * shared node. A node the caller holds the only reference to is returned
+ * unchanged without to copy it.
+ */
+xml_node_t *
+xml_node_unshare(xml_node_t *node)
+{
+	xml_node_t *copy;
+
+	if (!node)
+		return NULL;
+
+	ni_assert(node->refcount);
+	if (node->refcount == 1)
+		return node;
+
+	copy = xml_node_clone(node, NULL);
+	copy->final = node->final;
+	xml_node_free(node);
+	return copy;
+}
+
 /*
  * Merge node @merge into node @base.
  */
@@ -265,7 +530,7 @@ xml_node_merge(xml_node_t *base, const xml_node_t *merge)
 		xml_node_t **pos, *np, *clone;
 
 		for (pos = &base->children; (np = *pos) != NULL; pos = &np->next) {
-			if (ni_string_eq(mchild->name, np->name))
+			if (mchild->name == np->name)
 				goto dont_merge;
 		}
 
@@ -304,14 +569,15 @@ xml_node_free(xml_node_t *node)
 
 	ni_var_array_destroy(&node->attrs);
 	free(node->cdata);
-	free(node->name);
-	free(node);
+	free(node->digest);
+	xml_node_release(node);
 }
 
 void
 xml_node_set_cdata(xml_node_t *node, const char *cdata)
 {
 	ni_string_dup(&node->cdata, cdata);
+	xml_node_touch(node);
 }
 
 void
@@ -321,6 +587,7 @@ xml_node_set_int(xml_node_t *node, int value)
 
 	snprintf(buffer, sizeof(buffer), "%d", value);
 	ni_string_dup(&node->cdata, buffer);
+	xml_node_touch(node);
 }
 
 void
@@ -330,6 +597,7 @@ xml_node_set_int64(xml_node_t *node, int64_t value)
 
 	snprintf(buffer, sizeof(buffer), "%"PRId64, value);
 	ni_string_dup(&node->cdata, buffer);
+	xml_node_touch(node);
 }
 
 void
@@ -339,6 +607,7 @@ xml_node_set_uint(xml_node_t *node, unsigned int value)
 
 	snprintf(buffer, sizeof(buffer), "%u", value);
 	ni_string_dup(&node->cdata, buffer);
+	xml_node_touch(node);
 }
 
 void
@@ -348,6 +617,7 @@ xml_node_set_uint64(xml_node_t *node, uint64_t value)
 
 	snprintf(buffer, sizeof(buffer), "%"PRIu64, value);
 	ni_string_dup(&node->cdata, buffer);
+	xml_node_touch(node);
 }
 
 void
@@ -357,30 +627,35 @@ xml_node_set_uint_hex(xml_node_t *node, unsigned int value)
 
 	snprintf(buffer, sizeof(buffer), "0x%x", value);
 	ni_string_dup(&node->cdata, buffer);
+	xml_node_touch(node);
 }
 
 void
 xml_node_add_attr(xml_node_t *node, const char *name, const char *value)
 {
 	ni_var_array_set(&node->attrs, name, value);
+	xml_node_touch(node);
 }
 
 void
 xml_node_add_attr_uint(xml_node_t *node, const char *name, unsigned int value)
 {
 	ni_var_array_set_uint(&node->attrs, name, value);
+	xml_node_touch(node);
 }
 
 void
 xml_node_add_attr_ulong(xml_node_t *node, const char *name, unsigned long value)
 {
 	ni_var_array_set_ulong(&node->attrs, name, value);
+	xml_node_touch(node);
 }
 
 void
 xml_node_add_attr_double(xml_node_t *node, const char *name, double value)
 {
 	ni_var_array_set_double(&node->attrs, name, value);
+	xml_node_touch(node);
 }
 
 const ni_var_t *
@@ -408,7 +683,11 @@ xml_node_get_attr(const xml_node_t *node, const char *name)
 ni_bool_t
 xml_node_del_attr(xml_node_t *node, const char *name)
 {
-	return node ? ni_var_array_remove(&node->attrs, name) : FALSE;
+	if (!node || !ni_var_array_remove(&node->attrs, name))
+		return FALSE;
+
+	xml_node_touch(node);
+	return TRUE;
 }
 
 ni_bool_t
@@ -461,10 +740,10 @@ xml_node_get_next_child(const xml_node_t *top, const char *name, const xml_node_
 {
 	xml_node_t *child;
 
-	if (top == NULL)
+	if (top == NULL || !(name = xml_name_lookup(name)))
 		return NULL;
 	for (child = cur ? cur->next : top->children; child; child = child->next) {
-		if (!strcmp(child->name, name))
+		if (child->name == name)
 			return child;
 	}
 
@@ -486,8 +765,10 @@ xml_node_get_child_with_attrs(const xml_node_t *node, const char *name,
 {
 	xml_node_t *child;
 
+	if (!(name = xml_name_lookup(name)))
+		return NULL;
 	for (child = node->children; child; child = child->next) {
-		if (!strcmp(child->name, name)
+		if (child->name == name
 		 && xml_node_match_attrs(child, attrs))
 			return child;
 	}
@@ -502,7 +783,7 @@ xml_node_replace_child(xml_node_t *node, xml_node_t *newchild)
 
 	pos = &node->children;
 	while ((child = *pos) != NULL) {
-		if (!strcmp(child->name, newchild->name)) {
+		if (child->name == newchild->name) {
 			__xml_node_list_drop(pos);
 			found = TRUE;
 		} else {
@@ -520,9 +801,12 @@ xml_node_delete_child(xml_node_t *node, const char *name)
 	xml_node_t **pos, *child;
 	ni_bool_t found = FALSE;
 
+	if (!(name = xml_name_lookup(name)))
+		return FALSE;
+
 	pos = &node->children;
 	while ((child = *pos) != NULL) {
-		if (!strcmp(child->name, name)) {
+		if (child->name == name) {
 			__xml_node_list_drop(pos);
 			found = TRUE;
 		} else {
@@ -686,8 +970,10 @@ xml_node_get_next(xml_node_t *top, xml_node_t *cur)
 xml_node_t *
 xml_node_get_next_named(xml_node_t *top, const char *name, xml_node_t *cur)
 {
+	if (!(name = xml_name_lookup(name)))
+		return NULL;
 	while ((cur = xml_node_get_next(top, cur)) != NULL) {
-		if (!strcmp(cur->name, name))
+		if (cur->name == name)
 			return cur;
 	}
 
@@ -755,25 +1041,20 @@ xml_document_array_free(xml_document_array_t *array)
 	free(array);
 }
 
+/* the data is kept NULL terminated */
 static void
-__xml_document_array_realloc(xml_document_array_t *array, unsigned int newsize)
+__xml_document_array_realloc(xml_document_array_t *array, unsigned int newcount)
 {
-	xml_document_t **newdata;
-	unsigned int i;
-
-	newsize = (newsize + XML_DOCUMENTARRAY_CHUNK) + 1;
-	newdata = xrealloc(array->data, newsize * sizeof(xml_document_t *));
-
-	array->data = newdata;
-	for (i = array->count; i < newsize; ++i)
-		array->data[i] = NULL;
+	if (newcount >= UINT_MAX - 1 ||
+	    !ni_array_grow((void **)&array->data, sizeof(xml_document_t *),
+				array->count, newcount + 1, XML_DOCUMENTARRAY_CHUNK))
+		ni_fatal("allocation failed for %u xml document array entries", newcount);
 }
 
 void
 xml_document_array_append(xml_document_array_t *array, xml_document_t *doc)
 {
-	if ((array->count % XML_DOCUMENTARRAY_CHUNK) == 0)
-		__xml_document_array_realloc(array, array->count);
+	__xml_document_array_realloc(array, array->count + 1);
 
 	array->data[array->count++] = doc;
 }
@@ -816,18 +1097,14 @@ xml_node_array_free(xml_node_array_t *array)
 	free(array);
 }
 
+/* the data is kept NULL terminated */
 static void
-__xml_node_array_realloc(xml_node_array_t *array, unsigned int newsize)
+__xml_node_array_realloc(xml_node_array_t *array, unsigned int newcount)
 {
-	xml_node_t **newdata;
-	unsigned int i;
-
-	newsize = (newsize + XML_NODEARRAY_CHUNK) + 1;
-	newdata = xrealloc(array->data, newsize * sizeof(array->data[0]));
-
-	array->data = newdata;
-	for (i = array->count; i < newsize; ++i)
-		array->data[i] = NULL;
+	if (newcount >= UINT_MAX - 1 ||
+	    !ni_array_grow((void **)&array->data, sizeof(array->data[0]),
+				array->count, newcount + 1, XML_NODEARRAY_CHUNK))
+		ni_fatal("allocation failed for %u xml node array entries", newcount);
 }
 
 void
@@ -836,8 +1113,7 @@ xml_node_array_append(xml_node_array_t *array, xml_node_t *node)
 	if (!array || !node)
 		return;
 
-	if ((array->count % XML_NODEARRAY_CHUNK) == 0)
-		__xml_node_array_realloc(array, array->count);
+	__xml_node_array_realloc(array, array->count + 1);
 
 	array->data[array->count++] = xml_node_clone_ref(node);
 }
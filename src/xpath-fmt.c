@@ -119,7 +119,7 @@ xpath_format_parse(const char *format)
 					cur->optional = 1;
 					expression++;
 				}
-				cur->enode = xpath_expression_parse(expression);
+				cur->enode = xpath_expression_get(expression);
 				if (!cur->enode)
 					goto failed;
 
@@ -63,6 +63,8 @@ struct xpath_enode {
 
 	char *			identifier;
 	xpath_integer_t		integer;
+
+	unsigned int		refcount;	/* of the expression root */
 };
 
 static xpath_operator_t	__xpath_operator_node;
@@ -87,6 +89,41 @@ static void		__xpath_skipws(const char **);
 
 static xpath_enode_t *	xpath_enode_new(const xpath_operator_t *);
 static void		xpath_enode_free(xpath_enode_t *);
+static void		xpath_expr_free(xpath_enode_t *, unsigned int, const char *);
+static void		__xpath_expression_fold(xpath_enode_t *);
+
+/*
+ * Name index of the document evaluated, see __xpath_enode_descendants_evaluate.
+ * It lives as long as a single xpath_expression_eval call only, so changes
+ * of the document between two evaluations do not need to be tracked.
+ */
+typedef struct xpath_index_name {
+	const char *		name;
+	unsigned int		count;
+	unsigned int *		pos;
+} xpath_index_name_t;
+
+typedef struct xpath_index {
+	const xml_node_t *	root;
+	unsigned int		count;
+	xml_node_t **		nodes;		/* in document order */
+	unsigned int *		last;		/* last descendant of nodes[i] */
+
+	unsigned int		hsize;
+	unsigned int *		hash;		/* node -> position + 1 */
+
+	unsigned int		nnames;
+	xpath_index_name_t *	names;
+} xpath_index_t;
+
+typedef struct xpath_eval_context {
+	unsigned int		descendant_walks;
+	xpath_index_t *		index;
+} xpath_eval_context_t;
+
+static xpath_eval_context_t *	xpath_eval_ctx;
+
+static void		xpath_index_free(xpath_index_t *);
 
 #ifdef NI_XPATH_DEBUG_LEVEL
 # define xtrace(fmt, args...)	ni_debug_verbose(NI_XPATH_DEBUG_LEVEL, NI_TRACE_XPATH, fmt, ##args)
@@ -120,15 +157,101 @@ xpath_expression_parse(const char *expr)
 	if (*expr)
 		goto failed;
 
+	__xpath_expression_fold(tree);
+	tree->refcount = 1;
 	return tree;
 
 failed:
 	ni_error("unable to parse XPATH expression \"%s\"", orig_expr);
-	if (tree)
-		xpath_expression_free(tree);
+	xpath_expr_free(tree, 0, "expr ");
 	return NULL;
 }
 
+/*
+ * Cache of compiled XPATH expressions, shared by reference.
+ * The same expression strings are evaluated over and over again,
+ * e.g. element references of the schema in every fsm run.
+ */
+#define XPATH_CACHE_BUCKETS	64
+#define XPATH_CACHE_MAX		512
+
+typedef struct xpath_cache_entry xpath_cache_entry_t;
+struct xpath_cache_entry {
+	xpath_cache_entry_t *	next;
+	unsigned int		hash;
+	char *			expr;
+	xpath_enode_t *		enode;
+};
+
+static struct {
+	unsigned int		count;
+	xpath_cache_entry_t *	bucket[XPATH_CACHE_BUCKETS];
+} xpath_cache;
+
+xpath_enode_t *
+xpath_expression_hold(xpath_enode_t *enode)
+{
+	if (enode) {
+		ni_assert(enode->refcount);
+		enode->refcount++;
+	}
+	return enode;
+}
+
+/*
+ * Return a reference to the compiled expression, parsing it only
+ * when it is not cached yet. Release it using xpath_expression_free.
+ */
+xpath_enode_t *
+xpath_expression_get(const char *expr)
+{
+	xpath_cache_entry_t *entry;
+	xpath_enode_t *enode;
+	unsigned int hash;
+
+	if (!expr)
+		return NULL;
+
+	hash = ni_string_hash(expr);
+	for (entry = xpath_cache.bucket[hash % XPATH_CACHE_BUCKETS]; entry; entry = entry->next) {
+		if (entry->hash == hash && !strcmp(entry->expr, expr))
+			return xpath_expression_hold(entry->enode);
+	}
+
+	if (!(enode = xpath_expression_parse(expr)))
+		return NULL;
+
+	if (xpath_cache.count >= XPATH_CACHE_MAX)
+		xpath_expression_cache_flush();
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->hash = hash;
+	entry->expr = xstrdup(expr);
+	entry->enode = xpath_expression_hold(enode);
+	entry->next = xpath_cache.bucket[hash % XPATH_CACHE_BUCKETS];
+	xpath_cache.bucket[hash % XPATH_CACHE_BUCKETS] = entry;
+	xpath_cache.count++;
+
+	return enode;
+}
+
+void
+xpath_expression_cache_flush(void)
+{
+	xpath_cache_entry_t *entry;
+	unsigned int i;
+
+	for (i = 0; i < XPATH_CACHE_BUCKETS; ++i) {
+		while ((entry = xpath_cache.bucket[i]) != NULL) {
+			xpath_cache.bucket[i] = entry->next;
+			xpath_expression_free(entry->enode);
+			free(entry->expr);
+			free(entry);
+		}
+	}
+	xpath_cache.count = 0;
+}
+
 /*
  * Evaluate a parsed XPATH expression
  */
@@ -136,18 +259,25 @@ xpath_result_t *
 xpath_expression_eval(const xpath_enode_t *enode, xml_node_t *xn)
 {
 	xpath_result_t *in = xpath_result_new(XPATH_ELEMENT);
+	xpath_eval_context_t ctx, *saved = xpath_eval_ctx;
 	xpath_result_t *result;
 
+	memset(&ctx, 0, sizeof(ctx));
+	xpath_eval_ctx = &ctx;
+
 	xpath_result_append_element(in, xn);
 	result = __xpath_expression_eval(enode, in);
 	xpath_result_free(in);
+
+	xpath_eval_ctx = saved;
+	xpath_index_free(ctx.index);
 	return result;
 }
 
 /*
  * Free a parsed XPATH expression
  */
-static inline void
+static void
 xpath_expr_free(xpath_enode_t *enode, unsigned int depth, const char *info)
 {
 	if (!enode)
@@ -162,7 +292,12 @@ xpath_expr_free(xpath_enode_t *enode, unsigned int depth, const char *info)
 void
 xpath_expression_free(xpath_enode_t *enode)
 {
-	xpath_expr_free(enode, 0, "expr ");
+	if (!enode)
+		return;
+
+	ni_assert(enode->refcount);
+	if (--enode->refcount == 0)
+		xpath_expr_free(enode, 0, "expr ");
 }
 
 /*
@@ -176,7 +311,7 @@ xml_xpath_eval_string(xml_document_t *doc, xml_node_t *xn, const char *expr)
 	xpath_enode_t *expr_tree;
 	char *result = NULL;
 
-	expr_tree = xpath_expression_parse(expr);
+	expr_tree = xpath_expression_get(expr);
 	if (!expr_tree)
 		return NULL;
 
@@ -446,7 +581,7 @@ handle_function:
 failed:
 	/* ni_error("xpath: syntax error in expression \"%s\" at position %s", expr, pos); */
 	if (current)
-		xpath_expression_free(current);
+		xpath_expr_free(current, 0, "expr ");
 	return NULL;
 }
 
@@ -858,6 +993,69 @@ __xpath_expression_constant(const xpath_enode_t *enode)
 	return constant;
 }
 
+/*
+ * Replace constant sub-expressions by their value, so they do not
+ * get evaluated again for every node.
+ */
+static void
+__xpath_expression_fold(xpath_enode_t *enode)
+{
+	const xpath_operator_t *ops = NULL;
+	xpath_result_t *in, *result;
+
+	if (!enode || !enode->left)
+		return;
+
+	if (!__xpath_expression_constant(enode)) {
+		__xpath_expression_fold(enode->left);
+		__xpath_expression_fold(enode->right);
+		return;
+	}
+
+	in = xpath_result_new(XPATH_ELEMENT);
+	result = __xpath_expression_eval(enode, in);
+	xpath_result_free(in);
+	if (!result)
+		return;
+
+	switch (result->type) {
+	case XPATH_STRING:
+		if (result->count == 1)
+			ops = &__xpath_operator_stringconst;
+		break;
+	case XPATH_INTEGER:
+		if (result->count == 1)
+			ops = &__xpath_operator_intconst;
+		break;
+	case XPATH_BOOLEAN:
+		if (result->count == 0 || !result->node[0].value.boolean)
+			ops = &__xpath_operator_false;
+		else
+		if (result->count == 1)
+			ops = &__xpath_operator_true;
+		break;
+	default:
+		break;
+	}
+
+	if (ops) {
+		xtrace("    folding constant %s expression", enode->ops->name);
+
+		xpath_expr_free(enode->left, 2, "left ");
+		xpath_expr_free(enode->right, 2, "right");
+		enode->left = enode->right = NULL;
+		ni_string_free(&enode->identifier);
+
+		enode->ops = ops;
+		if (ops == &__xpath_operator_stringconst)
+			ni_string_dup(&enode->identifier, result->node[0].value.string);
+		else
+		if (ops == &__xpath_operator_intconst)
+			enode->integer = result->node[0].value.integer;
+	}
+	xpath_result_free(result);
+}
+
 /*
  * node()
  */
@@ -874,6 +1072,19 @@ static xpath_operator_t __xpath_operator_node = {
 	.evaluate = __xpath_enode_node_evaluate
 };
 
+/*
+ * Element names are interned, so the name tests of the axes below
+ * compare the name atoms. A name without atom matches no element.
+ */
+static inline ni_bool_t
+__xpath_name_atom(const xpath_enode_t *op, const char **atom)
+{
+	*atom = NULL;
+	if (!op->identifier)
+		return TRUE;
+	return (*atom = xml_name_lookup(op->identifier)) != NULL;
+}
+
 /*
  * self()
  */
@@ -881,13 +1092,16 @@ static xpath_result_t *
 __xpath_enode_self_evaluate(const xpath_enode_t *op, xpath_result_t *in)
 {
 	xpath_result_t *result = xpath_result_new(XPATH_ELEMENT);
-	const char *match_name = op->identifier;
+	const char *match_name;
 	unsigned int n;
 
+	if (!__xpath_name_atom(op, &match_name))
+		return result;
+
 	for (n = 0; n < in->count; ++n) {
 		xml_node_t *xn = in->node[n].value.node;
 
-		if (!match_name || !strcmp(xn->name, match_name))
+		if (!match_name || xn->name == match_name)
 			xpath_result_append_element(result, xn);
 	}
 
@@ -908,15 +1122,18 @@ static xpath_result_t *
 __xpath_enode_child_evaluate(const xpath_enode_t *op, xpath_result_t *in)
 {
 	xpath_result_t *result = xpath_result_new(XPATH_ELEMENT);
-	const char *match_name = op->identifier;
+	const char *match_name;
 	unsigned int n;
 
+	if (!__xpath_name_atom(op, &match_name))
+		return result;
+
 	for (n = 0; n < in->count; ++n) {
 		xml_node_t *xn = in->node[n].value.node;
 		xml_node_t *cn;
 
 		for (cn = xn->children; cn; cn = cn->next) {
-			if (!match_name || !strcmp(cn->name, match_name))
+			if (!match_name || cn->name == match_name)
 				xpath_result_append_element(result, cn);
 		}
 	}
@@ -940,23 +1157,191 @@ __xpath_enode_descendants_match(xml_node_t *node, const char *match_name, xpath_
 	xml_node_t *child;
 
 	for (child = node->children; child; child = child->next) {
-		if (!match_name || !strcmp(child->name, match_name))
+		if (!match_name || child->name == match_name)
 			xpath_result_append_element(result, child);
 		if (child->children)
 			__xpath_enode_descendants_match(child, match_name, result);
 	}
 }
 
+static inline unsigned int
+xpath_index_hash(const xpath_index_t *index, const xml_node_t *node)
+{
+	return ((unsigned long)node >> 4) * 2654435761UL & (index->hsize - 1);
+}
+
+static unsigned int
+xpath_index_add(xpath_index_t *index, xml_node_t *node)
+{
+	unsigned int pos = index->count++;
+	unsigned int h;
+	xml_node_t *child;
+
+	index->nodes[pos] = node;
+	for (h = xpath_index_hash(index, node); index->hash[h]; h = (h + 1) & (index->hsize - 1))
+		;
+	index->hash[h] = pos + 1;
+
+	for (child = node->children; child; child = child->next)
+		xpath_index_add(index, child);
+
+	index->last[pos] = index->count - 1;
+	return pos;
+}
+
+static void
+xpath_index_count(const xml_node_t *node, unsigned int *count)
+{
+	const xml_node_t *child;
+
+	(*count)++;
+	for (child = node->children; child; child = child->next)
+		xpath_index_count(child, count);
+}
+
+static xpath_index_t *
+xpath_index_new(const xml_node_t *root)
+{
+	xpath_index_t *index;
+	unsigned int count = 0;
+
+	xpath_index_count(root, &count);
+
+	index = xcalloc(1, sizeof(*index));
+	index->root = root;
+	index->nodes = xcalloc(count, sizeof(index->nodes[0]));
+	index->last = xcalloc(count, sizeof(index->last[0]));
+	for (index->hsize = 16; index->hsize < 2 * count; index->hsize <<= 1)
+		;
+	index->hash = xcalloc(index->hsize, sizeof(index->hash[0]));
+
+	xpath_index_add(index, (xml_node_t *)root);
+	return index;
+}
+
+static void
+xpath_index_free(xpath_index_t *index)
+{
+	unsigned int i;
+
+	if (!index)
+		return;
+
+	for (i = 0; i < index->nnames; ++i)
+		free(index->names[i].pos);
+	free(index->names);
+	free(index->hash);
+	free(index->last);
+	free(index->nodes);
+	free(index);
+}
+
+static ni_bool_t
+xpath_index_find(const xpath_index_t *index, const xml_node_t *node, unsigned int *pos)
+{
+	unsigned int h, p;
+
+	for (h = xpath_index_hash(index, node); (p = index->hash[h]); h = (h + 1) & (index->hsize - 1)) {
+		if (index->nodes[p - 1] == node) {
+			*pos = p - 1;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static const xpath_index_name_t *
+xpath_index_get_name(xpath_index_t *index, const char *name)
+{
+	xpath_index_name_t *entry;
+	unsigned int i;
+
+	for (i = 0; i < index->nnames; ++i) {
+		if (index->names[i].name == name)
+			return &index->names[i];
+	}
+
+	index->names = xrealloc(index->names, (index->nnames + 1) * sizeof(index->names[0]));
+	entry = &index->names[index->nnames++];
+	memset(entry, 0, sizeof(*entry));
+	entry->name = name;
+
+	for (i = 0; i < index->count; ++i) {
+		if (index->nodes[i]->name != name)
+			continue;
+		if ((entry->count % 16) == 0)
+			entry->pos = xrealloc(entry->pos, (entry->count + 16) * sizeof(entry->pos[0]));
+		entry->pos[entry->count++] = i;
+	}
+	return entry;
+}
+
+/*
+ * Append the descendants named by the index entry; returns FALSE when
+ * the node is not covered by the index.
+ */
+static ni_bool_t
+xpath_index_match(const xpath_index_t *index, const xpath_index_name_t *entry,
+		const xml_node_t *node, xpath_result_t *result)
+{
+	unsigned int pos, lo, hi, mid;
+
+	if (!xpath_index_find(index, node, &pos))
+		return FALSE;
+
+	/* first entry following pos in document order */
+	for (lo = 0, hi = entry->count; lo < hi; ) {
+		mid = lo + (hi - lo) / 2;
+		if (entry->pos[mid] <= pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (; lo < entry->count && entry->pos[lo] <= index->last[pos]; ++lo)
+		xpath_result_append_element(result, index->nodes[entry->pos[lo]]);
+	return TRUE;
+}
+
+static const xml_node_t *
+__xpath_document_root(const xml_node_t *node)
+{
+	while (node->parent)
+		node = node->parent;
+	return node;
+}
+
 static xpath_result_t *
 __xpath_enode_descendants_evaluate(const xpath_enode_t *op, xpath_result_t *in)
 {
 	xpath_result_t *result = xpath_result_new(XPATH_ELEMENT);
-	const char *match_name = op->identifier;
+	const xpath_index_name_t *entry = NULL;
+	xpath_eval_context_t *ctx = xpath_eval_ctx;
+	const char *match_name;
 	unsigned int n;
 
+	if (!__xpath_name_atom(op, &match_name))
+		return result;
+
+	/*
+	 * Build the name index of the document when the same evaluation
+	 * walks descendants repeatedly, e.g. in predicates.
+	 */
+	if (match_name && ctx && in->count && ++ctx->descendant_walks > 1) {
+		const xml_node_t *root = __xpath_document_root(in->node[0].value.node);
+
+		if (!ctx->index || ctx->index->root != root) {
+			xpath_index_free(ctx->index);
+			ctx->index = xpath_index_new(root);
+		}
+		entry = xpath_index_get_name(ctx->index, match_name);
+	}
+
 	for (n = 0; n < in->count; ++n) {
 		xml_node_t *xn = in->node[n].value.node;
 
+		if (entry && xpath_index_match(ctx->index, entry, xn, result))
+			continue;
 		__xpath_enode_descendants_match(xn, match_name, result);
 	}
 
@@ -1022,6 +1407,7 @@ static xpath_result_t *
 __xpath_enode_predicate_evaluate(const xpath_enode_t *enode, xpath_result_t *left)
 {
 	xpath_result_t *result = xpath_result_new(XPATH_ELEMENT);
+	xpath_result_t *tmp = NULL;
 	unsigned int m, n;
 
 	assert(enode->right);
@@ -1072,21 +1458,31 @@ __xpath_enode_predicate_evaluate(const xpath_enode_t *enode, xpath_result_t *lef
 	}
 
 	/* For every node element in the left expression, evaluate
-	 * the subscript (right) expression. */
+	 * the subscript (right) expression. The single element input
+	 * is reused unless the evaluation still holds a reference. */
 	for (m = 0; m < left->count; ++m) {
-		xpath_result_t *tmp, *right;
+		xpath_result_t *right;
 		xml_node_t *xn;
 
-		if (left->node[m].type != XPATH_ELEMENT)
+		if (left->node[m].type != XPATH_ELEMENT) {
+			xpath_result_free(tmp);
+			xpath_result_free(result);
 			return NULL;
+		}
 		xn = left->node[m].value.node;
 
-		tmp = xpath_result_new(XPATH_ELEMENT);
-		xpath_result_append_element(tmp, xn);
+		if (tmp && tmp->users > 1) {
+			xpath_result_free(tmp);
+			tmp = NULL;
+		}
+		if (tmp == NULL) {
+			tmp = xpath_result_new(XPATH_ELEMENT);
+			xpath_result_append_element(tmp, xn);
+		} else {
+			tmp->node[0].value.node = xn;
+		}
 
 		right = __xpath_expression_eval(enode->right, tmp);
-		xpath_result_free(tmp);
-
 		if (!right)
 			continue;
 
@@ -1120,6 +1516,7 @@ __xpath_enode_predicate_evaluate(const xpath_enode_t *enode, xpath_result_t *lef
 appended:
 		xpath_result_free(right);
 	}
+	xpath_result_free(tmp);
 
 out:
 	return result;
@@ -0,0 +1,229 @@
+/*
+ *	Device address index unit tests
+ *
+ *	Copyright (C) 2022 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wicked/util.h>
+#include <wicked/address.h>
+#include <wicked/netinfo.h>
+#include "wunit.h"
+
+#define ADDRESS_TEST_COUNT	1024
+
+static ni_sockaddr_t		addrs[ADDRESS_TEST_COUNT];
+
+static ni_netdev_t *
+address_test_populate(void)
+{
+	ni_address_t *ap;
+	ni_netdev_t *dev;
+	char buf[64];
+	unsigned int i;
+
+	dev = ni_netdev_new("test0", 1);
+	for (i = 0; i < ADDRESS_TEST_COUNT; ++i) {
+		if (i % 2)
+			snprintf(buf, sizeof(buf), "10.%u.%u.1", i / 256, i % 256);
+		else
+			snprintf(buf, sizeof(buf), "2001:db8::%x", i);
+		ni_sockaddr_parse(&addrs[i], buf, AF_UNSPEC);
+
+		ap = ni_address_create(addrs[i].ss_family, 24, &addrs[i], NULL);
+		ni_netdev_append_address(dev, ap);
+	}
+	return dev;
+}
+
+TESTCASE(find_every_address)
+{
+	ni_netdev_t *dev = address_test_populate();
+	unsigned int i, found = 0, same = 0;
+	ni_address_t *ap;
+	ni_sockaddr_t ss;
+
+	for (i = 0; i < ADDRESS_TEST_COUNT; ++i) {
+		ap = ni_netdev_find_address(dev, &addrs[i]);
+		if (ap && ni_sockaddr_equal(&ap->local_addr, &addrs[i]))
+			found++;
+		if (ap == ni_address_list_find(dev->addrs, &addrs[i]))
+			same++;
+	}
+	CHECK2(dev->addrs_index != NULL, "index built for %u addresses", ADDRESS_TEST_COUNT);
+	CHECK2(found == ADDRESS_TEST_COUNT, "found %u of %u addresses", found, ADDRESS_TEST_COUNT);
+	CHECK2(same == ADDRESS_TEST_COUNT, "index and scan agree on %u of %u", same, ADDRESS_TEST_COUNT);
+
+	ni_sockaddr_parse(&ss, "10.250.0.1", AF_INET);
+	CHECK(!ni_netdev_find_address(dev, &ss));
+
+	ni_netdev_put(dev);
+}
+
+TESTCASE(delete_addresses)
+{
+	ni_netdev_t *dev = address_test_populate();
+	unsigned int i, gone = 0, kept = 0;
+	ni_address_t *ap;
+
+	/* the first lookup builds the index */
+	ni_netdev_find_address(dev, &addrs[ADDRESS_TEST_COUNT - 1]);
+	for (i = 0; i < ADDRESS_TEST_COUNT; i += 3) {
+		if ((ap = ni_netdev_find_address(dev, &addrs[i])))
+			ni_netdev_delete_address(dev, ap);
+	}
+
+	for (i = 0; i < ADDRESS_TEST_COUNT; ++i) {
+		ap = ni_netdev_find_address(dev, &addrs[i]);
+		if (i % 3 == 0 && ap == NULL)
+			gone++;
+		if (i % 3 != 0 && ap && ap == ni_address_list_find(dev->addrs, &addrs[i]))
+			kept++;
+	}
+	CHECK2(gone + kept == ADDRESS_TEST_COUNT, "%u deleted and %u kept of %u addresses",
+			gone, kept, ADDRESS_TEST_COUNT);
+
+	ni_netdev_put(dev);
+}
+
+static int
+address_test_local_cmp(const ni_address_t *a1, const ni_address_t *a2)
+{
+	return ni_sockaddr_compare(&a1->local_addr, &a2->local_addr);
+}
+
+TESTCASE(merge_match_addresses)
+{
+	ni_netdev_t *dev = address_test_populate();
+	ni_address_t *list = NULL, *ap, **matches;
+	unsigned int i, n, same = 0;
+
+	/* every second address in reverse order, the first one twice */
+	for (i = ADDRESS_TEST_COUNT; i-- > 0; ) {
+		if (i % 2 == 0)
+			ni_address_create(addrs[i].ss_family, 64, &addrs[i], &list);
+	}
+	ap = ni_address_create(addrs[0].ss_family, 128, &addrs[0], &list);
+
+	matches = calloc(ADDRESS_TEST_COUNT, sizeof(*matches));
+	n = ni_address_list_merge_match(dev->addrs, list, address_test_local_cmp, matches);
+	CHECK2(n == ADDRESS_TEST_COUNT / 2, "matched %u of %u addresses", n, ADDRESS_TEST_COUNT / 2);
+
+	for (i = 0, ap = dev->addrs; ap; ap = ap->next, ++i) {
+		if (matches[i] == ni_address_list_find(list, &ap->local_addr))
+			same++;
+	}
+	CHECK2(same == ADDRESS_TEST_COUNT, "merge and scan agree on %u of %u", same, ADDRESS_TEST_COUNT);
+
+	free(matches);
+	ni_address_list_destroy(&list);
+	ni_netdev_put(dev);
+}
+
+/*
+ * Reference byte-wise versions of the family specialized fast paths
+ */
+static int
+address_test_ref_cmp(const ni_sockaddr_t *a, const ni_sockaddr_t *b)
+{
+	const unsigned char *p1, *p2;
+	size_t len;
+
+	if (a->ss_family != b->ss_family)
+		return a->ss_family - b->ss_family;
+
+	if (a->ss_family == AF_INET) {
+		p1 = (const unsigned char *)&a->sin.sin_addr;
+		p2 = (const unsigned char *)&b->sin.sin_addr;
+		len = 4;
+	} else {
+		p1 = a->six.sin6_addr.s6_addr;
+		p2 = b->six.sin6_addr.s6_addr;
+		len = 16;
+	}
+	return memcmp(p1, p2, len);
+}
+
+static ni_bool_t
+address_test_ref_prefix(unsigned int bits, const ni_sockaddr_t *a, const ni_sockaddr_t *b)
+{
+	const unsigned char *p1, *p2;
+	unsigned int i, max;
+
+	if (a->ss_family == AF_INET) {
+		p1 = (const unsigned char *)&a->sin.sin_addr;
+		p2 = (const unsigned char *)&b->sin.sin_addr;
+		max = 32;
+	} else {
+		p1 = a->six.sin6_addr.s6_addr;
+		p2 = b->six.sin6_addr.s6_addr;
+		max = 128;
+	}
+	for (i = 0; i < bits && i < max; ++i) {
+		if (((p1[i / 8] ^ p2[i / 8]) >> (7 - i % 8)) & 1)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static int
+address_test_sign(int v)
+{
+	return v > 0 ? 1 : v < 0 ? -1 : 0;
+}
+
+TESTCASE(sockaddr_fast_paths)
+{
+	static const char *samples[] = {
+		"10.0.0.1", "10.0.0.2", "10.128.0.1", "192.168.1.255", "0.0.0.0",
+		"255.255.255.255", "2001:db8::1", "2001:db8::2", "2001:db8:0:1::1",
+		"fe80::1", "::", "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff",
+		"2001:db8:ffff:ffff:8000::", NULL
+	};
+	ni_sockaddr_t ss[16];
+	unsigned int i, j, bits, n, errors = 0;
+
+	for (n = 0; samples[n]; ++n)
+		ni_sockaddr_parse(&ss[n], samples[n], AF_UNSPEC);
+
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j < n; ++j) {
+			if (address_test_sign(ni_sockaddr_compare(&ss[i], &ss[j])) !=
+			    address_test_sign(address_test_ref_cmp(&ss[i], &ss[j])))
+				errors++;
+			if (ni_sockaddr_equal(&ss[i], &ss[j]) != (i == j))
+				errors++;
+			if (ss[i].ss_family != ss[j].ss_family)
+				continue;
+			if (i == j && ni_sockaddr_hash(&ss[i]) != ni_sockaddr_hash(&ss[j]))
+				errors++;
+			for (bits = 0; bits <= 130; ++bits) {
+				if (ni_sockaddr_prefix_match(bits, &ss[i], &ss[j]) !=
+				    address_test_ref_prefix(bits, &ss[i], &ss[j]))
+					errors++;
+			}
+		}
+	}
+	CHECK2(errors == 0, "%u mismatches of the compare, hash and prefix fast paths", errors);
+}
+
+TESTMAIN();
@@ -0,0 +1,120 @@
+/**
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Test for bitfield util functions
+ *		* ni_bitfield_count()
+ *		* ni_bitfield_next_set()
+ *		* ni_bitfield_copy()
+ *		* ni_bitfield_or/and/andnot/xor()
+ *		* ni_bitfield_equal()
+ */
+
+#include "wunit.h"
+#include <wicked/util.h>
+
+static ni_bool_t
+bitfield_eq_hex(const ni_bitfield_t *bf, const char *hex)
+{
+	char *str = NULL;
+	ni_bool_t ret;
+
+	ret = ni_bitfield_format(bf, &str, TRUE) && ni_string_eq(str, hex);
+	ni_string_free(&str);
+	return ret;
+}
+
+TESTCASE(ni_bitfield_count_next_set)
+{
+	ni_bitfield_t bf = NI_BITFIELD_INIT;
+	unsigned int bit, bits, n;
+	unsigned int set[] = { 0, 5, 31, 32, 63, 100, 159 };
+
+	CHECK(ni_bitfield_count(&bf) == 0);
+	CHECK(ni_bitfield_next_set(&bf, 0) == 0);
+	CHECK(ni_bitfield_next_set(NULL, 0) == 0);
+
+	for (n = 0; n < sizeof(set)/sizeof(set[0]); ++n)
+		CHECK(ni_bitfield_setbit(&bf, set[n]));
+	CHECK(ni_bitfield_bits(&bf) == 160);
+	CHECK(ni_bitfield_count(&bf) == 7);
+
+	bits = ni_bitfield_bits(&bf);
+	for (n = 0, bit = ni_bitfield_next_set(&bf, 0); bit < bits;
+	     bit = ni_bitfield_next_set(&bf, bit + 1), ++n) {
+		CHECK(n < 7 && bit == set[n]);
+	}
+	CHECK(n == 7);
+
+	CHECK(ni_bitfield_next_set(&bf, 6) == 31);
+	CHECK(ni_bitfield_next_set(&bf, 64) == 100);
+	CHECK(ni_bitfield_next_set(&bf, 160) == bits);
+
+	CHECK(ni_bitfield_clearbit(&bf, 159));
+	CHECK(ni_bitfield_next_set(&bf, 101) == bits);
+	CHECK(ni_bitfield_count(&bf) == 6);
+
+	ni_bitfield_destroy(&bf);
+}
+
+TESTCASE(ni_bitfield_word_ops)
+{
+	ni_bitfield_t a = NI_BITFIELD_INIT;
+	ni_bitfield_t b = NI_BITFIELD_INIT;
+	ni_bitfield_t c = NI_BITFIELD_INIT;
+
+	CHECK(ni_bitfield_parse(&a, "0x10000000f0000000000000001", 0));
+	CHECK(ni_bitfield_parse(&b, "0xff", 0));
+
+	CHECK(ni_bitfield_copy(&c, &a));
+	CHECK(ni_bitfield_equal(&c, &a));
+	CHECK(!ni_bitfield_equal(&c, &b));
+
+	/* or grows the destination */
+	CHECK(ni_bitfield_copy(&c, &b));
+	CHECK(ni_bitfield_or(&c, &a));
+	CHECK(bitfield_eq_hex(&c, "0x10000000f00000000000000ff"));
+
+	/* and clears the words beyond the source */
+	CHECK(ni_bitfield_and(&c, &b));
+	CHECK(bitfield_eq_hex(&c, "0xff"));
+	CHECK(ni_bitfield_equal(&c, &b));
+	CHECK(ni_bitfield_equal(&b, &c));
+
+	CHECK(ni_bitfield_copy(&c, &a));
+	CHECK(ni_bitfield_andnot(&c, &b));
+	CHECK(bitfield_eq_hex(&c, "0x10000000f0000000000000000"));
+
+	CHECK(ni_bitfield_copy(&c, &a));
+	CHECK(ni_bitfield_xor(&c, &b));
+	CHECK(bitfield_eq_hex(&c, "0x10000000f00000000000000fe"));
+	CHECK(ni_bitfield_xor(&c, &c));
+	CHECK(!ni_bitfield_isset(&c));
+	CHECK(ni_bitfield_count(&c) == 0);
+
+	/* copy of an empty bitfield clears */
+	ni_bitfield_destroy(&b);
+	CHECK(ni_bitfield_copy(&c, &a));
+	CHECK(ni_bitfield_copy(&c, &b));
+	CHECK(!ni_bitfield_isset(&c));
+	CHECK(ni_bitfield_equal(&c, &b));
+
+	ni_bitfield_destroy(&a);
+	ni_bitfield_destroy(&b);
+	ni_bitfield_destroy(&c);
+}
+
+TESTMAIN();
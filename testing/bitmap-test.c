@@ -24,6 +24,8 @@
  *		* ni_format_bitmap_array()
  *		* ni_format_bitmap_string()
  *		* ni_format_bitmap()
+ *		* ni_intmap_index_parse()
+ *		* ni_intmap_index_format()
  */
 
 #include "wunit.h"
@@ -254,4 +256,57 @@ TESTCASE(ni_format_bitmap)
 	ni_stringbuf_destroy(&string_out);
 }
 
+static const ni_intmap_t	bit_map[] = {
+	{ "bit0",	NI_BIT(0)	},
+	{ "bit1",	NI_BIT(1)	},
+	{ "bit8",	NI_BIT(8)	},
+	{ "bit16",	NI_BIT(16)	},
+	{ "bit24",	NI_BIT(24)	},
+	{ "bit30",	NI_BIT(30)	},
+	{ "bit31",	NI_BIT(31)	},
+	{ "zero",	0		},
+	/* aliases */
+	{ "BIT0",	-1U		},
+	{ "first",	NI_BIT(0)	},
+	{ NULL }
+};
+
+TESTCASE(ni_intmap_index)
+{
+	ni_intmap_index_t index = NI_INTMAP_INDEX_INIT(bit_map);
+	ni_intmap_index_t small = NI_INTMAP_INDEX_INIT(map);
+	unsigned int value, linear, i;
+
+	for (i = 0; bit_map[i].name; ++i) {
+		CHECK(ni_intmap_index_parse(&index, bit_map[i].name, &value) == 0);
+		CHECK(ni_parse_uint_mapped(bit_map[i].name, bit_map, &linear) == 0);
+		CHECK(value == linear);
+		CHECK(ni_string_eq(ni_intmap_index_format(&index, bit_map[i].value),
+				ni_format_uint_mapped(bit_map[i].value, bit_map)));
+	}
+	CHECK(index.names != NULL);
+
+	/* first entry wins as in the linear lookup */
+	CHECK(ni_intmap_index_parse(&index, "BIT0", &value) == 0);
+	CHECK(value == NI_BIT(0));
+	CHECK(ni_string_eq(ni_intmap_index_format(&index, NI_BIT(0)), "bit0"));
+	CHECK(ni_string_eq(ni_intmap_index_format(&index, -1U), "BIT0"));
+
+	CHECK(ni_intmap_index_parse(&index, "bit2", &value) == -1);
+	CHECK(ni_intmap_index_format(&index, NI_BIT(2)) == NULL);
+	CHECK(ni_string_eq(ni_intmap_index_format_maybe(&index, NI_BIT(2)), "4"));
+	CHECK(ni_intmap_index_parse_maybe(&index, "256", &value, 10) == 0);
+	CHECK(value == NI_BIT(8));
+	CHECK(ni_intmap_index_parse_maybe(&index, "5", &value, 10) == 1);
+
+	/* small maps are searched without an index */
+	CHECK(ni_intmap_index_parse(&small, "write", &value) == 0);
+	CHECK(value == MY_SET);
+	CHECK(ni_string_eq(ni_intmap_index_format(&small, MY_GET), "GET"));
+	CHECK(small.names == NULL);
+
+	free(index.names);
+	free(index.values);
+}
+
 TESTMAIN();
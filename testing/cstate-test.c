@@ -36,7 +36,16 @@ int main(int argc, char **argv)
 	ni_client_state_load(cs, ifindex2);
 	ni_client_state_debug("Test3", cs, "print");
 
+	ni_client_state_save_deferred(cs, ifindex1);
+	ni_client_state_save_deferred(cs, ifindex1);
+	ni_client_state_load(cs, ifindex1);
+	ni_client_state_debug("Test4", cs, "print");
+	ni_client_state_flush();
+	ni_client_state_load(cs, ifindex1);
+	ni_client_state_debug("Test5", cs, "print");
+
 	ni_client_state_free(cs);
+	ni_client_state_drop(ifindex1);
 	ni_client_state_drop(ifindex2);
 
 	ni_config_free(ni_global.config);
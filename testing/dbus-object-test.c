@@ -0,0 +1,111 @@
+/*
+ *	DBus object tree lookup unit tests
+ *
+ *	Copyright (C) 2022 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wicked/util.h>
+#include <wicked/dbus.h>
+#include "wunit.h"
+
+#define OBJECT_TEST_ROOT	"/org/opensuse/Network"
+#define OBJECT_TEST_COUNT	1000
+
+static ni_dbus_object_t *	objects[OBJECT_TEST_COUNT + 1];
+
+static const char *
+object_test_path(unsigned int index)
+{
+	static char path[128];
+
+	snprintf(path, sizeof(path), "%s/Interface/%u", OBJECT_TEST_ROOT, index);
+	return path;
+}
+
+TESTCASE(create_and_lookup)
+{
+	ni_dbus_object_t *root, *obj;
+	unsigned int i, found = 0;
+
+	root = ni_dbus_object_new(NULL, OBJECT_TEST_ROOT, NULL);
+	for (i = 1; i <= OBJECT_TEST_COUNT; ++i)
+		objects[i] = ni_dbus_object_create(root, object_test_path(i), NULL, NULL);
+
+	for (i = 1; i <= OBJECT_TEST_COUNT; ++i) {
+		obj = ni_dbus_object_lookup(root, object_test_path(i));
+		if (obj && obj == objects[i] && ni_string_eq(obj->path, object_test_path(i)))
+			found++;
+	}
+	CHECK2(found == OBJECT_TEST_COUNT, "found %u of %u objects", found, OBJECT_TEST_COUNT);
+
+	obj = ni_dbus_object_lookup(root, "Interface/1");
+	CHECK(obj && obj == objects[1]);
+	obj = ni_dbus_object_lookup(root, "Interface//10/");
+	CHECK(obj && obj == objects[10]);
+	CHECK(ni_dbus_object_lookup(root, "") == root);
+	CHECK(ni_dbus_object_lookup(root, "Interface/1000") == objects[1000]);
+	CHECK(ni_dbus_object_lookup(root, "Interface/100") == objects[100]);
+	CHECK(ni_dbus_object_lookup(root, "Interface/10001") == NULL);
+	CHECK(ni_dbus_object_lookup(root, "Interface/1/foo") == NULL);
+	CHECK(ni_dbus_object_lookup(root, "/org/opensuse/Other") == NULL);
+
+	ni_dbus_object_free(root);
+}
+
+TESTCASE(delete_and_lookup)
+{
+	ni_dbus_object_t *root;
+	unsigned int i, gone = 0, kept = 0;
+
+	root = ni_dbus_object_new(NULL, OBJECT_TEST_ROOT, NULL);
+	for (i = 1; i <= OBJECT_TEST_COUNT; ++i)
+		objects[i] = ni_dbus_object_create(root, object_test_path(i), NULL, NULL);
+
+	for (i = 1; i <= OBJECT_TEST_COUNT; i += 2)
+		ni_dbus_object_free(objects[i]);
+	ni_dbus_objects_garbage_collect();
+
+	for (i = 1; i <= OBJECT_TEST_COUNT; ++i) {
+		ni_dbus_object_t *obj = ni_dbus_object_lookup(root, object_test_path(i));
+
+		if (i % 2 && obj == NULL)
+			gone++;
+		if (!(i % 2) && obj == objects[i])
+			kept++;
+	}
+	CHECK2(gone + kept == OBJECT_TEST_COUNT, "%u deleted and %u kept of %u objects",
+			gone, kept, OBJECT_TEST_COUNT);
+
+	/* re-creating the deleted objects works again */
+	for (i = 1; i <= OBJECT_TEST_COUNT; i += 2)
+		objects[i] = ni_dbus_object_create(root, object_test_path(i), NULL, NULL);
+	for (i = 1, kept = 0; i <= OBJECT_TEST_COUNT; ++i) {
+		if (ni_dbus_object_lookup(root, object_test_path(i)) == objects[i])
+			kept++;
+	}
+	CHECK2(kept == OBJECT_TEST_COUNT, "found %u of %u re-created objects",
+			kept, OBJECT_TEST_COUNT);
+
+	ni_dbus_object_free(root);
+}
+
+TESTMAIN();
@@ -277,6 +277,27 @@ TESTCASE(ni_json_parse_string)
 	ni_json_free(json);
 }
 
+TESTCASE(ni_json_parse_string_members)
+{
+	static const char * const members[] = { "obj1", "obj3", NULL };
+	char *json_str = "{\"obj1\": \"string1\", \"obj2\": {\"a\": [1, \"x\\\"}\", {}]},"
+			 " \"obj3\": {\"obj2\": true}, \"obj4\": -0.4e1}";
+	ni_json_t *json, *obj3;
+
+	CHECK((json = ni_json_parse_string_members(json_str, members)));
+	CHECK(ni_json_object_entries(json) == 2);
+	CHECK(ni_json_object_get_value(json, "obj1"));
+	CHECK(!ni_json_object_get_value(json, "obj2"));
+	CHECK((obj3 = ni_json_object_get_value(json, "obj3")));
+	CHECK(ni_json_object_get_value(obj3, "obj2"));
+	CHECK(!ni_json_object_get_value(json, "obj4"));
+
+	CHECK(!ni_json_parse_string_members("{\"obj2\": [ }", members));
+	CHECK(!ni_json_parse_string_members("{\"obj2\": 1 2}", members));
+
+	ni_json_free(json);
+}
+
 TESTCASE(ni_json_bool_get)
 {
 	ni_json_t *valid_json, *invalid_bool;
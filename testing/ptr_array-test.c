@@ -41,6 +41,7 @@ ni_declare_ptr_array_cmp_fn(ni_data);
 static ni_declare_ptr_array_init(ni_data);
 static ni_declare_ptr_array_destroy(ni_data);
 static ni_declare_ptr_array_realloc(ni_data);
+static ni_declare_ptr_array_reserve(ni_data);
 static ni_declare_ptr_array_append(ni_data);
 static ni_declare_ptr_array_insert(ni_data);
 static ni_declare_ptr_array_remove_at(ni_data);
@@ -60,6 +61,7 @@ ni_data_free(ni_data_t *d)
 static ni_define_ptr_array_init(ni_data);
 static ni_define_ptr_array_destroy(ni_data);
 static ni_define_ptr_array_realloc(ni_data, NI_DATA_ARRAY_CHUNK);
+static ni_define_ptr_array_reserve(ni_data, NI_DATA_ARRAY_CHUNK);
 static ni_define_ptr_array_append(ni_data);
 static ni_define_ptr_array_insert(ni_data);
 static ni_define_ptr_array_remove_at(ni_data);
@@ -247,5 +249,39 @@ TESTCASE(chunk_size_1)
 	ni_data2_array_destroy(&arr);
 }
 
+TESTCASE(growth)
+{
+	ni_data_array_t arr = NI_ARRAY_INIT;
+	ni_data_t e1 = { .age = 1, .name = "Foo" };
+	ni_data_t **data;
+	unsigned int i;
+
+	CHECK(ni_array_capacity(0, 32) == 0);
+	CHECK(ni_array_capacity(1, 32) == 32);
+	CHECK(ni_array_capacity(32, 32) == 32);
+	CHECK(ni_array_capacity(33, 32) == 64);
+	CHECK(ni_array_capacity(10000, 32) == 16384);
+	CHECK(ni_array_capacity(UINT_MAX, 32) == UINT_MAX);
+
+	/* reserved entries are used without a further resize */
+	CHECK(ni_data_array_reserve(&arr, 1000));
+	CHECK(arr.count == 0);
+	data = arr.data;
+	for (i = 0; i < 1000; i++)
+		CHECK(ni_data_array_append(&arr, &e1));
+	CHECK(arr.data == data);
+	CHECK(arr.count == 1000);
+
+	for (i = 0; i < 1000; i++)
+		CHECK(ni_data_array_insert(&arr, 0, &e1));
+	CHECK(arr.count == 2000);
+	CHECK(ni_data_array_at(&arr, 1999) == &e1);
+
+	CHECK(!ni_data_array_reserve(&arr, UINT_MAX));
+	CHECK(arr.count == 2000);
+
+	free(arr.data);
+}
+
 
 TESTMAIN();
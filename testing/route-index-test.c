@@ -0,0 +1,154 @@
+/*
+ *	Route table prefix index unit tests
+ *
+ *	Copyright (C) 2022 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <linux/rtnetlink.h>
+#include <wicked/util.h>
+#include <wicked/address.h>
+#include <wicked/route.h>
+#include "wunit.h"
+
+#define ROUTE_TEST_COUNT	512
+
+static ni_route_t *		routes[ROUTE_TEST_COUNT];
+static unsigned int		routes_count;
+
+static ni_route_t *
+route_test_new(const char *prefix)
+{
+	ni_route_t *rp;
+
+	if (!(rp = ni_route_new()))
+		return NULL;
+
+	if (!ni_sockaddr_prefix_parse(prefix, &rp->destination, &rp->prefixlen)) {
+		ni_route_free(rp);
+		return NULL;
+	}
+	rp->family = rp->destination.ss_family;
+	rp->table = RT_TABLE_MAIN;
+	return rp;
+}
+
+static void
+route_test_populate(ni_route_table_t **tables)
+{
+	char buf[64];
+	unsigned int i;
+
+	routes_count = 0;
+	routes[routes_count++] = route_test_new("0.0.0.0/0");
+	routes[routes_count++] = route_test_new("10.0.0.0/8");
+	routes[routes_count++] = route_test_new("::/0");
+	routes[routes_count++] = route_test_new("2001:db8::/32");
+	for (i = 0; routes_count + 4 <= ROUTE_TEST_COUNT; ++i) {
+		snprintf(buf, sizeof(buf), "10.%u.0.0/16", i);
+		routes[routes_count++] = route_test_new(buf);
+		snprintf(buf, sizeof(buf), "10.%u.%u.128/25", i, i);
+		routes[routes_count++] = route_test_new(buf);
+		snprintf(buf, sizeof(buf), "2001:db8:%x::/48", i);
+		routes[routes_count++] = route_test_new(buf);
+		snprintf(buf, sizeof(buf), "2001:db8:%x:%x::/64", i, i);
+		routes[routes_count++] = route_test_new(buf);
+	}
+
+	for (i = 0; i < routes_count; ++i) {
+		if (routes[i])
+			ni_route_tables_add_route(tables, ni_route_ref(routes[i]));
+	}
+}
+
+static void
+route_test_release(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < routes_count; ++i)
+		ni_route_free(routes[i]);
+	routes_count = 0;
+}
+
+TESTCASE(find_every_prefix)
+{
+	ni_route_table_t *tables = NULL;
+	unsigned int i, found = 0, same = 0;
+	ni_route_t *rp, *r;
+
+	route_test_populate(&tables);
+	for (i = 0; i < routes_count; ++i) {
+		if (!routes[i] || !(rp = ni_route_clone(routes[i])))
+			continue;
+
+		r = ni_route_tables_find_prefix_match(tables, rp, ni_route_equal);
+		if (r == routes[i])
+			found++;
+		if (r == ni_route_tables_find_match(tables, rp, ni_route_equal))
+			same++;
+		ni_route_free(rp);
+	}
+	CHECK2(found == routes_count, "found %u of %u routes", found, routes_count);
+	CHECK2(same == routes_count, "index and scan agree on %u of %u", same, routes_count);
+
+	rp = route_test_new("10.1.0.0/17");
+	CHECK(rp && !ni_route_tables_find_prefix_match(tables, rp, ni_route_equal));
+	ni_route_free(rp);
+
+	ni_route_tables_destroy(&tables);
+	route_test_release();
+}
+
+TESTCASE(delete_prefixes)
+{
+	ni_route_table_t *tables = NULL;
+	unsigned int i, gone = 0, kept = 0;
+	ni_route_t *r;
+
+	route_test_populate(&tables);
+	for (i = 0; i < routes_count; i += 3)
+		ni_route_tables_del_route(tables, routes[i]);
+
+	for (i = 0; i < routes_count; ++i) {
+		r = ni_route_tables_find_prefix_match(tables, routes[i], ni_route_equal);
+		if (i % 3 == 0 && r == NULL)
+			gone++;
+		if (i % 3 != 0 && r == routes[i])
+			kept++;
+	}
+	CHECK2(gone + kept == routes_count, "%u deleted and %u kept of %u routes",
+			gone, kept, routes_count);
+
+	/* re-adding after the pruning works again */
+	for (i = 0; i < routes_count; i += 3)
+		ni_route_tables_add_route(&tables, ni_route_ref(routes[i]));
+	for (i = 0, kept = 0; i < routes_count; ++i) {
+		if (ni_route_tables_find_prefix_match(tables, routes[i], ni_route_equal_ref))
+			kept++;
+	}
+	CHECK2(kept == routes_count, "found %u of %u re-added routes", kept, routes_count);
+
+	ni_route_tables_destroy(&tables);
+	route_test_release();
+}
+
+TESTMAIN();
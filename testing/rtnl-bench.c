@@ -0,0 +1,862 @@
+/*
+ *	rtnetlink event storm benchmark
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ * Creates test devices in a private network namespace and drives storms
+ * of link, address and route changes using batched netlink requests,
+ * while the event socket processes the resulting events the same way
+ * as wickedd does. For each request, the latency is the time from the
+ * request to its first event arriving in the handler, that is after the
+ * ni_netconfig_t state has been updated, where wickedd emits its D-Bus
+ * signals. Requires root (CAP_NET_ADMIN) permissions.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sched.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include <linux/veth.h>
+
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+#include <wicked/netinfo.h>
+#include <wicked/address.h>
+#include <wicked/route.h>
+#include <wicked/wireless.h>
+
+#include "netinfo_priv.h"
+#include "util_priv.h"
+#include "appconfig.h"
+#include "kernel.h"
+
+#define BENCH_IFNAME_PREFIX	"bnch"
+#define BENCH_IFNAME_PARENT	"bnchbase"
+#define BENCH_MAX_DEVICES	16384
+#define BENCH_MAX_VLANS		4094
+#define BENCH_IDLE_TIMEOUT	2000	/* msec without progress */
+
+typedef enum {
+	BENCH_DEV_DUMMY,
+	BENCH_DEV_VETH,
+	BENCH_DEV_VLAN,
+} bench_dev_type_t;
+
+typedef enum {
+	BENCH_KIND_LINK,
+	BENCH_KIND_ADDR,
+	BENCH_KIND_ROUTE,
+} bench_kind_t;
+
+typedef enum {
+	BENCH_STORM_LINK	= 1U << 0,	/* create and delete devices	*/
+	BENCH_STORM_ADDR	= 1U << 1,	/* add and delete addresses	*/
+	BENCH_STORM_ROUTE	= 1U << 2,	/* add and delete routes	*/
+	BENCH_STORM_FLAP	= 1U << 3,	/* set devices down and up	*/
+} bench_storm_t;
+
+typedef struct bench_phase	bench_phase_t;
+typedef struct nl_msg *		bench_build_fn_t(unsigned int);
+
+struct bench_phase {
+	const char *		name;
+	bench_storm_t		storm;
+	bench_kind_t		kind;
+	bench_build_fn_t *	build;
+};
+
+typedef struct bench_stats {
+	unsigned int		requests;
+	unsigned int		errors;
+	unsigned int		events;
+	unsigned int		missed;
+	unsigned long		elapsed;	/* usec */
+
+	unsigned int		count;
+	unsigned long *		latency;	/* usec */
+} bench_stats_t;
+
+static struct {
+	bench_dev_type_t	type;
+	unsigned int		count;
+	unsigned int		parent;		/* vlan lower device ifindex */
+
+	const bench_phase_t *	phase;
+	struct timeval *	sent;		/* per device request time  */
+	unsigned int		pending;
+	unsigned int		events;
+	bench_stats_t		stats;
+} bench;
+
+static const char *	program_name;
+
+/*
+ * Device, address and route naming: the device number is encoded
+ * in the name and in the IPv4 addresses, so the event handlers can
+ * map each event back to the request it belongs to.
+ */
+static void
+bench_ifname(char *buf, size_t len, unsigned int nr)
+{
+	snprintf(buf, len, "%s%u", BENCH_IFNAME_PREFIX, nr);
+}
+
+static ni_bool_t
+bench_ifname_nr(const char *name, unsigned int *nr)
+{
+	char tail;
+
+	if (!name || strncmp(name, BENCH_IFNAME_PREFIX, sizeof(BENCH_IFNAME_PREFIX) - 1))
+		return FALSE;
+	if (sscanf(name + sizeof(BENCH_IFNAME_PREFIX) - 1, "%u%c", nr, &tail) != 1)
+		return FALSE;
+	return *nr < bench.count;
+}
+
+static uint32_t
+bench_addr(unsigned int nr)
+{
+	/* 10.<hi>.<lo>.1/24 */
+	return htonl(0x0a000001U | ((nr & 0xffffU) << 8));
+}
+
+static uint32_t
+bench_route_dst(unsigned int nr)
+{
+	/* 100.64.0.0/10 split into /24 networks */
+	return htonl(0x64400000U | ((nr & 0x3fffU) << 8));
+}
+
+static ni_bool_t
+bench_addr_nr(const ni_sockaddr_t *sa, unsigned int *nr)
+{
+	uint32_t addr;
+
+	if (!sa || sa->ss_family != AF_INET)
+		return FALSE;
+
+	addr = ntohl(sa->sin.sin_addr.s_addr);
+	if ((addr & 0xff0000ffU) != 0x0a000001U)
+		return FALSE;
+
+	*nr = (addr >> 8) & 0xffffU;
+	return *nr < bench.count;
+}
+
+static ni_bool_t
+bench_route_nr(const ni_sockaddr_t *sa, unsigned int *nr)
+{
+	uint32_t addr;
+
+	if (!sa || sa->ss_family != AF_INET)
+		return FALSE;
+
+	addr = ntohl(sa->sin.sin_addr.s_addr);
+	if ((addr & 0xffc000ffU) != 0x64400000U)
+		return FALSE;
+
+	*nr = (addr >> 8) & 0x3fffU;
+	return *nr < bench.count;
+}
+
+static unsigned int
+bench_ifindex(unsigned int nr)
+{
+	char name[IFNAMSIZ];
+
+	bench_ifname(name, sizeof(name), nr);
+	return if_nametoindex(name);
+}
+
+/*
+ * Request messages
+ */
+static struct nl_msg *
+bench_link_msg(int type, int flags, unsigned int ifindex, unsigned int ifflags)
+{
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_index = ifindex;
+	ifi.ifi_flags = ifflags;
+	ifi.ifi_change = type == RTM_NEWLINK && ifindex ? IFF_UP : 0;
+
+	if (!(msg = nlmsg_alloc_simple(type, NLM_F_REQUEST | flags)))
+		return NULL;
+
+	if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0) {
+		nlmsg_free(msg);
+		return NULL;
+	}
+	return msg;
+}
+
+static struct nl_msg *
+bench_link_create_msg(const char *name, bench_dev_type_t type, unsigned int vid)
+{
+	struct nlattr *linkinfo, *data, *peer;
+	char pname[IFNAMSIZ];
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+
+	if (!(msg = bench_link_msg(RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL, 0, 0)))
+		return NULL;
+
+	NLA_PUT_STRING(msg, IFLA_IFNAME, name);
+
+	if (!(linkinfo = nla_nest_start(msg, IFLA_LINKINFO)))
+		goto nla_put_failure;
+
+	switch (type) {
+	case BENCH_DEV_VETH:
+		NLA_PUT_STRING(msg, IFLA_INFO_KIND, "veth");
+		if (!(data = nla_nest_start(msg, IFLA_INFO_DATA)))
+			goto nla_put_failure;
+		if (!(peer = nla_nest_start(msg, VETH_INFO_PEER)))
+			goto nla_put_failure;
+
+		memset(&ifi, 0, sizeof(ifi));
+		ifi.ifi_family = AF_UNSPEC;
+		if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0)
+			goto nla_put_failure;
+
+		snprintf(pname, sizeof(pname), "%sp", name);
+		NLA_PUT_STRING(msg, IFLA_IFNAME, pname);
+		nla_nest_end(msg, peer);
+		nla_nest_end(msg, data);
+		nla_nest_end(msg, linkinfo);
+		break;
+
+	case BENCH_DEV_VLAN:
+		NLA_PUT_STRING(msg, IFLA_INFO_KIND, "vlan");
+		if (!(data = nla_nest_start(msg, IFLA_INFO_DATA)))
+			goto nla_put_failure;
+		NLA_PUT_U16(msg, IFLA_VLAN_ID, vid);
+		nla_nest_end(msg, data);
+		nla_nest_end(msg, linkinfo);
+
+		/* Note, IFLA_LINK must be outside of IFLA_LINKINFO */
+		NLA_PUT_U32(msg, IFLA_LINK, bench.parent);
+		break;
+
+	case BENCH_DEV_DUMMY:
+	default:
+		NLA_PUT_STRING(msg, IFLA_INFO_KIND, "dummy");
+		nla_nest_end(msg, linkinfo);
+		break;
+	}
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static struct nl_msg *
+bench_link_add_msg(unsigned int nr)
+{
+	char name[IFNAMSIZ];
+
+	bench_ifname(name, sizeof(name), nr);
+	return bench_link_create_msg(name, bench.type, nr + 1);
+}
+
+static struct nl_msg *
+bench_link_del_msg(unsigned int nr)
+{
+	unsigned int ifindex;
+
+	if (!(ifindex = bench_ifindex(nr)))
+		return NULL;
+	return bench_link_msg(RTM_DELLINK, 0, ifindex, 0);
+}
+
+static struct nl_msg *
+bench_link_up_msg(unsigned int nr)
+{
+	unsigned int ifindex;
+
+	if (!(ifindex = bench_ifindex(nr)))
+		return NULL;
+	return bench_link_msg(RTM_NEWLINK, 0, ifindex, IFF_UP);
+}
+
+static struct nl_msg *
+bench_link_down_msg(unsigned int nr)
+{
+	unsigned int ifindex;
+
+	if (!(ifindex = bench_ifindex(nr)))
+		return NULL;
+	return bench_link_msg(RTM_NEWLINK, 0, ifindex, 0);
+}
+
+static struct nl_msg *
+bench_addr_msg(int type, int flags, unsigned int nr)
+{
+	struct ifaddrmsg ifa;
+	struct nl_msg *msg;
+	uint32_t addr;
+
+	memset(&ifa, 0, sizeof(ifa));
+	ifa.ifa_family = AF_INET;
+	ifa.ifa_prefixlen = 24;
+	if (!(ifa.ifa_index = bench_ifindex(nr)))
+		return NULL;
+
+	if (!(msg = nlmsg_alloc_simple(type, NLM_F_REQUEST | flags)))
+		return NULL;
+	if (nlmsg_append(msg, &ifa, sizeof(ifa), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+
+	addr = bench_addr(nr);
+	NLA_PUT(msg, IFA_LOCAL, sizeof(addr), &addr);
+	NLA_PUT(msg, IFA_ADDRESS, sizeof(addr), &addr);
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static struct nl_msg *
+bench_addr_add_msg(unsigned int nr)
+{
+	return bench_addr_msg(RTM_NEWADDR, NLM_F_CREATE | NLM_F_EXCL, nr);
+}
+
+static struct nl_msg *
+bench_addr_del_msg(unsigned int nr)
+{
+	return bench_addr_msg(RTM_DELADDR, 0, nr);
+}
+
+static struct nl_msg *
+bench_route_msg(int type, int flags, unsigned int nr)
+{
+	unsigned int ifindex;
+	struct nl_msg *msg;
+	struct rtmsg rtm;
+	uint32_t dst;
+
+	if (!(ifindex = bench_ifindex(nr)))
+		return NULL;
+
+	memset(&rtm, 0, sizeof(rtm));
+	rtm.rtm_family = AF_INET;
+	rtm.rtm_dst_len = 24;
+	rtm.rtm_table = RT_TABLE_MAIN;
+	rtm.rtm_protocol = RTPROT_STATIC;
+	rtm.rtm_scope = RT_SCOPE_LINK;
+	rtm.rtm_type = RTN_UNICAST;
+
+	if (!(msg = nlmsg_alloc_simple(type, NLM_F_REQUEST | flags)))
+		return NULL;
+	if (nlmsg_append(msg, &rtm, sizeof(rtm), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+
+	dst = bench_route_dst(nr);
+	NLA_PUT(msg, RTA_DST, sizeof(dst), &dst);
+	NLA_PUT_U32(msg, RTA_OIF, ifindex);
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static struct nl_msg *
+bench_route_add_msg(unsigned int nr)
+{
+	return bench_route_msg(RTM_NEWROUTE, NLM_F_CREATE | NLM_F_EXCL, nr);
+}
+
+static struct nl_msg *
+bench_route_del_msg(unsigned int nr)
+{
+	return bench_route_msg(RTM_DELROUTE, 0, nr);
+}
+
+/*
+ * The phases of a round in the order they run; the devices are
+ * created and set up by the link phases also when the link storm
+ * is not selected, but these are not reported then.
+ */
+static const bench_phase_t	bench_phases[] = {
+	{ "link-add",	BENCH_STORM_LINK,	BENCH_KIND_LINK,	bench_link_add_msg	},
+	{ "link-up",	BENCH_STORM_LINK,	BENCH_KIND_LINK,	bench_link_up_msg	},
+	{ "addr-add",	BENCH_STORM_ADDR,	BENCH_KIND_ADDR,	bench_addr_add_msg	},
+	{ "route-add",	BENCH_STORM_ROUTE,	BENCH_KIND_ROUTE,	bench_route_add_msg	},
+	{ "route-del",	BENCH_STORM_ROUTE,	BENCH_KIND_ROUTE,	bench_route_del_msg	},
+	{ "addr-del",	BENCH_STORM_ADDR,	BENCH_KIND_ADDR,	bench_addr_del_msg	},
+	{ "flap-down",	BENCH_STORM_FLAP,	BENCH_KIND_LINK,	bench_link_down_msg	},
+	{ "flap-up",	BENCH_STORM_FLAP,	BENCH_KIND_LINK,	bench_link_up_msg	},
+	{ "link-del",	BENCH_STORM_LINK,	BENCH_KIND_LINK,	bench_link_del_msg	},
+	{ NULL }
+};
+
+static const ni_intmap_t	bench_storm_names[] = {
+	{ "link",	BENCH_STORM_LINK	},
+	{ "addr",	BENCH_STORM_ADDR	},
+	{ "route",	BENCH_STORM_ROUTE	},
+	{ "flap",	BENCH_STORM_FLAP	},
+	{ NULL }
+};
+
+static const ni_intmap_t	bench_type_names[] = {
+	{ "dummy",	BENCH_DEV_DUMMY		},
+	{ "veth",	BENCH_DEV_VETH		},
+	{ "vlan",	BENCH_DEV_VLAN		},
+	{ NULL }
+};
+
+/*
+ * Event accounting
+ */
+static void
+bench_event(bench_kind_t kind, unsigned int nr)
+{
+	struct timeval now, *sent;
+	bench_stats_t *stats = &bench.stats;
+
+	if (!bench.phase || bench.phase->kind != kind)
+		return;
+
+	bench.events++;
+	sent = &bench.sent[nr];
+	if (!timerisset(sent))
+		return;
+
+	ni_timer_get_time(&now);
+	if (stats->count % 1024 == 0) {
+		stats->latency = xrealloc(stats->latency,
+				(stats->count + 1024) * sizeof(*stats->latency));
+	}
+	timersub(&now, sent, &now);
+	stats->latency[stats->count++] = now.tv_sec * 1000000UL + now.tv_usec;
+
+	timerclear(sent);
+	bench.pending--;
+}
+
+static void
+bench_interface_event(ni_netdev_t *dev, ni_event_t event)
+{
+	unsigned int nr;
+
+	if (dev && bench_ifname_nr(dev->name, &nr))
+		bench_event(BENCH_KIND_LINK, nr);
+}
+
+static void
+bench_interface_addr_event(ni_netdev_t *dev, ni_event_t event, const ni_address_t *ap)
+{
+	unsigned int nr;
+
+	if (ap && bench_addr_nr(&ap->local_addr, &nr))
+		bench_event(BENCH_KIND_ADDR, nr);
+}
+
+static void
+bench_route_event(ni_netconfig_t *nc, ni_event_t event, const ni_route_t *rp)
+{
+	unsigned int nr;
+
+	if (rp && rp->prefixlen == 24 && bench_route_nr(&rp->destination, &nr))
+		bench_event(BENCH_KIND_ROUTE, nr);
+}
+
+static int
+bench_latency_cmp(const void *a, const void *b)
+{
+	unsigned long la = *(const unsigned long *)a;
+	unsigned long lb = *(const unsigned long *)b;
+
+	return la > lb ? 1 : la < lb ? -1 : 0;
+}
+
+static void
+bench_report(const char *name, unsigned int round, bench_stats_t *stats)
+{
+	unsigned long sum = 0;
+	unsigned int i;
+	double rate;
+
+	if (stats->count)
+		qsort(stats->latency, stats->count, sizeof(*stats->latency), bench_latency_cmp);
+	for (i = 0; i < stats->count; ++i)
+		sum += stats->latency[i];
+
+	rate = stats->elapsed ? stats->events * 1000000.0 / stats->elapsed : 0.0;
+	printf("%-3u %-10s %6u %6u %6u %6u %9.3f %10.1f",
+		round, name, stats->requests, stats->errors, stats->missed,
+		stats->events, stats->elapsed / 1000.0, rate);
+	if (stats->count) {
+		printf(" %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+			stats->latency[0] / 1000.0,
+			sum / 1000.0 / stats->count,
+			stats->latency[stats->count / 2] / 1000.0,
+			stats->latency[(stats->count * 99) / 100] / 1000.0,
+			stats->latency[stats->count - 1] / 1000.0);
+	} else {
+		printf(" %9s %9s %9s %9s %9s\n", "-", "-", "-", "-", "-");
+	}
+}
+
+/*
+ * Send the requests of a phase in one batch and process the events
+ * until each request got its event or nothing arrived for a while.
+ */
+static void
+bench_run_phase(const bench_phase_t *phase, unsigned int round, ni_bool_t report)
+{
+	bench_stats_t *stats = &bench.stats;
+	struct timeval start, now, last;
+	unsigned int idx, nr, *nrs;
+	ni_nl_batch_t *batch;
+	unsigned int events;
+	struct nl_msg *msg;
+	int ret;
+
+	memset(stats, 0, sizeof(*stats));
+	memset(bench.sent, 0, bench.count * sizeof(*bench.sent));
+	bench.pending = 0;
+	bench.events = 0;
+
+	batch = ni_nl_batch_new();
+	nrs = xcalloc(bench.count, sizeof(*nrs));
+	for (nr = 0; nr < bench.count; ++nr) {
+		if (!(msg = phase->build(nr))) {
+			stats->errors++;
+			continue;
+		}
+		if ((ret = ni_nl_batch_add(batch, msg)) < 0) {
+			nlmsg_free(msg);
+			stats->errors++;
+			continue;
+		}
+		nrs[ret] = nr;
+	}
+	stats->requests = ni_nl_batch_count(batch);
+
+	ni_timer_get_time(&start);
+	for (idx = 0; idx < stats->requests; ++idx)
+		bench.sent[nrs[idx]] = start;
+	bench.pending = stats->requests;
+	bench.phase = phase;
+
+	ni_nl_batch_commit(batch);
+	for (idx = 0; idx < stats->requests; ++idx) {
+		if (ni_nl_batch_result(batch, idx) == 0)
+			continue;
+
+		stats->errors++;
+		nr = nrs[idx];
+		if (timerisset(&bench.sent[nr])) {
+			timerclear(&bench.sent[nr]);
+			bench.pending--;
+		}
+	}
+	ni_nl_batch_free(batch);
+	free(nrs);
+
+	events = bench.events;
+	now = last = start;
+	while (bench.pending) {
+		ni_timeout_t timeout = ni_timer_next_timeout();
+
+		if (timeout > 100)
+			timeout = 100;
+		if (ni_socket_wait(timeout) != 0)
+			ni_fatal("ni_socket_wait failed");
+
+		ni_timer_get_time(&now);
+		if (bench.events != events) {
+			events = bench.events;
+			last = now;
+		} else
+		if (ni_timeout_since(&last, &now, NULL) > BENCH_IDLE_TIMEOUT)
+			break;
+	}
+	bench.phase = NULL;
+
+	stats->events = bench.events;
+	stats->missed = bench.pending;
+	timersub(bench.events ? &last : &now, &start, &now);
+	stats->elapsed = now.tv_sec * 1000000UL + now.tv_usec;
+
+	if (report)
+		bench_report(phase->name, round, stats);
+	free(stats->latency);
+	stats->latency = NULL;
+}
+
+static ni_bool_t
+bench_parse_storms(const char *arg, unsigned int *storms)
+{
+	ni_string_array_t names = NI_STRING_ARRAY_INIT;
+	unsigned int i, storm;
+	ni_bool_t ret = TRUE;
+
+	*storms = 0;
+	ni_string_split(&names, arg, ",", 0);
+	for (i = 0; i < names.count; ++i) {
+		if (ni_string_eq(names.data[i], "all")) {
+			*storms |= BENCH_STORM_LINK | BENCH_STORM_ADDR |
+				   BENCH_STORM_ROUTE | BENCH_STORM_FLAP;
+		} else
+		if (ni_parse_uint_mapped(names.data[i], bench_storm_names, &storm) == 0) {
+			*storms |= storm;
+		} else {
+			ret = FALSE;
+		}
+	}
+	ni_string_array_destroy(&names);
+	return ret && *storms;
+}
+
+static int
+bench_talk(struct nl_msg *msg)
+{
+	ni_nl_batch_t *batch;
+	int ret = -1;
+
+	batch = ni_nl_batch_new();
+	if (ni_nl_batch_add(batch, msg) < 0)
+		nlmsg_free(msg);
+	else
+	if (ni_nl_batch_commit(batch) == 0)
+		ret = ni_nl_batch_result(batch, 0);
+	ni_nl_batch_free(batch);
+
+	return ret;
+}
+
+static ni_bool_t
+bench_create_parent(void)
+{
+	struct nl_msg *msg;
+
+	msg = bench_link_create_msg(BENCH_IFNAME_PARENT, BENCH_DEV_DUMMY, 0);
+	if (!msg || bench_talk(msg) < 0)
+		return FALSE;
+
+	if (!(bench.parent = if_nametoindex(BENCH_IFNAME_PARENT)))
+		return FALSE;
+
+	msg = bench_link_msg(RTM_NEWLINK, 0, bench.parent, IFF_UP);
+	return msg && bench_talk(msg) == 0;
+}
+
+static void
+bench_delete_parent(void)
+{
+	struct nl_msg *msg;
+
+	if (bench.parent && (msg = bench_link_msg(RTM_DELLINK, 0, bench.parent, 0)))
+		bench_talk(msg);
+	bench.parent = 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	enum {
+		OPT_HELP, OPT_COUNT, OPT_TYPE, OPT_ROUNDS, OPT_STORM, OPT_NO_NETNS,
+		OPT_REFRESH, OPT_COALESCE, OPT_CONFIG, OPT_DEBUG, OPT_LOG_LEVEL,
+	};
+	static struct option options[] = {
+		{ "help",	no_argument,		NULL,	OPT_HELP	},
+		{ "count",	required_argument,	NULL,	OPT_COUNT	},
+		{ "type",	required_argument,	NULL,	OPT_TYPE	},
+		{ "rounds",	required_argument,	NULL,	OPT_ROUNDS	},
+		{ "storm",	required_argument,	NULL,	OPT_STORM	},
+		{ "no-netns",	no_argument,		NULL,	OPT_NO_NETNS	},
+		{ "refresh",	required_argument,	NULL,	OPT_REFRESH	},
+		{ "coalesce",	required_argument,	NULL,	OPT_COALESCE	},
+		{ "config",	required_argument,	NULL,	OPT_CONFIG	},
+		{ "debug",	required_argument,	NULL,	OPT_DEBUG	},
+		{ "log-level",	required_argument,	NULL,	OPT_LOG_LEVEL	},
+		{ NULL,		no_argument,		NULL,	0		}
+	};
+	unsigned int storms = BENCH_STORM_LINK | BENCH_STORM_ADDR |
+			      BENCH_STORM_ROUTE | BENCH_STORM_FLAP;
+	unsigned int rounds = 3, type = BENCH_DEV_DUMMY, coalesce = 0;
+	const char *opt_refresh = NULL;
+	ni_bool_t opt_netns = TRUE;
+	const bench_phase_t *phase;
+	unsigned int round;
+	int c;
+
+	program_name = ni_basename(argv[0]);
+	bench.count = 100;
+
+	while ((c = getopt_long(argc, argv, "", options, NULL)) != EOF) {
+		switch (c) {
+		case OPT_COUNT:
+			if (ni_parse_uint(optarg, &bench.count, 10) < 0 ||
+			    !bench.count || bench.count > BENCH_MAX_DEVICES)
+				goto usage;
+			break;
+
+		case OPT_TYPE:
+			if (ni_parse_uint_mapped(optarg, bench_type_names, &type) < 0)
+				goto usage;
+			break;
+
+		case OPT_ROUNDS:
+			if (ni_parse_uint(optarg, &rounds, 10) < 0 || !rounds)
+				goto usage;
+			break;
+
+		case OPT_STORM:
+			if (!bench_parse_storms(optarg, &storms))
+				goto usage;
+			break;
+
+		case OPT_NO_NETNS:
+			opt_netns = FALSE;
+			break;
+
+		case OPT_REFRESH:
+			if (!ni_string_eq(optarg, "full") && !ni_string_eq(optarg, "incremental"))
+				goto usage;
+			opt_refresh = optarg;
+			break;
+
+		case OPT_COALESCE:
+			if (ni_parse_uint(optarg, &coalesce, 10) < 0)
+				goto usage;
+			break;
+
+		case OPT_CONFIG:
+			ni_set_global_config_path(optarg);
+			break;
+
+		case OPT_DEBUG:
+			if (ni_enable_debug(optarg) < 0)
+				goto usage;
+			break;
+
+		case OPT_LOG_LEVEL:
+			if (!ni_log_level_set(optarg))
+				goto usage;
+			break;
+
+		default:
+		usage:
+		case OPT_HELP:
+			fprintf(stderr,
+				"%s [options]\n"
+				"\n"
+				"Drives rtnetlink event storms and measures the event processing.\n"
+				"\n"
+				"Supported options:\n"
+				"  --help\n"
+				"      Show this help text.\n"
+				"  --count <n>\n"
+				"      Number of test devices (default 100, max %u).\n"
+				"  --type dummy|veth|vlan\n"
+				"      Type of the test devices (default dummy).\n"
+				"  --rounds <n>\n"
+				"      Number of storm rounds (default 3).\n"
+				"  --storm <link,addr,route,flap|all>\n"
+				"      Storms to drive and report (default all).\n"
+				"  --no-netns\n"
+				"      Do not run in a private network namespace.\n"
+				"  --refresh full|incremental\n"
+				"      Override the netlink-events refresh mode.\n"
+				"  --coalesce <msec>\n"
+				"      Override the netlink-events coalesce window.\n"
+				"  --config <filename>\n"
+				"      Use the specified configuration file.\n"
+				"  --debug <facility>\n"
+				"      Enable debugging for the given facility.\n"
+				"  --log-level <level>\n"
+				"      Set the log level.\n"
+				, program_name, BENCH_MAX_DEVICES);
+			return c == OPT_HELP ? 0 : 1;
+		}
+	}
+	if (optind < argc)
+		goto usage;
+
+	bench.type = type;
+	if (bench.type == BENCH_DEV_VLAN && bench.count > BENCH_MAX_VLANS)
+		bench.count = BENCH_MAX_VLANS;
+
+	if (opt_netns && unshare(CLONE_NEWNET) < 0)
+		ni_fatal("cannot create network namespace: %m");
+
+	if (ni_init(program_name) < 0)
+		return 1;
+
+	if (opt_refresh) {
+		ni_global.config->rtnl_event.refresh = ni_string_eq(opt_refresh, "incremental") ?
+			NI_CONFIG_RTNL_REFRESH_INCREMENTAL : NI_CONFIG_RTNL_REFRESH_FULL;
+	}
+	ni_global.config->rtnl_event.coalesce_window = coalesce;
+
+	ni_wireless_set_scanning(FALSE);
+	if (ni_server_listen_interface_events(bench_interface_event) < 0 ||
+	    ni_server_enable_interface_addr_events(bench_interface_addr_event) < 0 ||
+	    ni_server_enable_route_events(bench_route_event) < 0)
+		ni_fatal("cannot listen to rtnetlink events");
+
+	if (ni_global_state_handle(1) == NULL)
+		ni_fatal("cannot refresh global state!");
+
+	if (bench.type == BENCH_DEV_VLAN && !bench_create_parent())
+		ni_fatal("cannot create vlan parent device %s", BENCH_IFNAME_PARENT);
+
+	bench.sent = xcalloc(bench.count, sizeof(*bench.sent));
+
+	printf("# %u %s devices, %u rounds, latency from request to event in ms\n",
+		bench.count, ni_format_uint_mapped(bench.type, bench_type_names), rounds);
+	printf("%-3s %-10s %6s %6s %6s %6s %9s %10s %9s %9s %9s %9s %9s\n",
+		"#", "phase", "reqs", "errs", "missed", "events", "time(ms)",
+		"events/s", "min", "avg", "p50", "p99", "max");
+
+	for (round = 1; round <= rounds; ++round) {
+		for (phase = bench_phases; phase->name; ++phase) {
+			/* the devices and links are needed by the other storms */
+			if (!(storms & phase->storm) && phase->storm != BENCH_STORM_LINK)
+				continue;
+			bench_run_phase(phase, round, !!(storms & phase->storm));
+		}
+	}
+
+	bench_delete_parent();
+	free(bench.sent);
+
+	ni_server_deactivate_interface_events();
+	ni_socket_deactivate_all();
+	return 0;
+}
@@ -0,0 +1,201 @@
+#!/bin/bash
+#
+#	wicked dhcp4 load test -- many wickedd-dhcp4 test clients against
+#	the wickedd-dhcp4 test server in a private network namespace
+#
+#	Copyright (C) 2024 SUSE LLC
+#
+#	This program is free software; you can redistribute it and/or modify
+#	it under the terms of the GNU General Public License as published by
+#	the Free Software Foundation; either version 2 of the License, or
+#	(at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU General Public License along
+#	with this program; if not, see <http://www.gnu.org/licenses/> or write
+#	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+#	Boston, MA 02110-1301 USA.
+#
+# The test creates a bridge with the server address and N veth pairs
+# with one end in the bridge, starts "wickedd-dhcp4 --test-server" on
+# the bridge and runs "wickedd-dhcp4 --test" lease requests on the
+# other veth ends, at most P of them in parallel. It reports the wall
+# time, the number of acquired leases, the peak RSS of the clients (when
+# /usr/bin/time is available) and the server statistics with the
+# message counts, retransmits and acquisition times.
+#
+# Requires root permissions.
+
+PROGRAM=${0##*/}
+
+count=100
+parallel=0
+latency=0
+jitter=0
+loss=0
+timeout=30
+sbindir=""
+config=""
+keep=""
+workdir=""
+
+usage()
+{
+	cat <<-EOT
+	Usage: $PROGRAM [options]
+
+	Options:
+	  --help		show this help text
+	  --count <N>		number of clients (default $count)
+	  --parallel <P>	clients to run in parallel (default all)
+	  --latency <msec>	server reply delay (default $latency)
+	  --jitter <msec>	random extra server reply delay (default $jitter)
+	  --loss <percent>	server replies to drop (default $loss)
+	  --timeout <sec>	client acquire timeout (default $timeout)
+	  --sbindir <dir>	directory of the wickedd-dhcp4 daemon
+	  --config <file>	config file passed to wickedd-dhcp4
+	  --workdir <dir>	work directory (default a new temporary one)
+	  --keep		keep the work directory with leases and logs
+	EOT
+	exit ${1:-0}
+}
+
+die()
+{
+	echo "$PROGRAM: $*" >&2
+	exit 1
+}
+
+while test $# -gt 0 ; do
+	case $1 in
+	--help)			usage 0 ;;
+	--count)		count=$2 ; shift ;;
+	--parallel)		parallel=$2 ; shift ;;
+	--latency)		latency=$2 ; shift ;;
+	--jitter)		jitter=$2 ; shift ;;
+	--loss)			loss=$2 ; shift ;;
+	--timeout)		timeout=$2 ; shift ;;
+	--sbindir)		sbindir=$2 ; shift ;;
+	--config)		config=$2 ; shift ;;
+	--workdir)		workdir=$2 ; shift ;;
+	--keep)			keep=yes ;;
+	*)			usage 1 ;;
+	esac
+	shift
+done
+
+[[ $count =~ ^[0-9]+$ && $count -gt 0 && $count -le 65000 ]] || die "invalid count: $count"
+[[ $parallel =~ ^[0-9]+$ ]] || die "invalid parallel: $parallel"
+test $parallel -eq 0 -o $parallel -gt $count && parallel=$count
+
+#
+# Re-run ourself in a new network namespace
+#
+if test -z "$WICKED_DHCP_LOAD_NS" ; then
+	test $(id -u) -eq 0 || die "requires root permissions"
+	type -p unshare >/dev/null || die "unshare utility is missing"
+	exec env WICKED_DHCP_LOAD_NS=1 unshare --net \
+		"$0" --count "$count" --parallel "$parallel" \
+		--latency "$latency" --jitter "$jitter" --loss "$loss" \
+		--timeout "$timeout" ${sbindir:+--sbindir "$sbindir"} \
+		${config:+--config "$config"} ${workdir:+--workdir "$workdir"} \
+		${keep:+--keep}
+fi
+
+dhcp4=${sbindir:-/usr/lib/wicked/bin}/wickedd-dhcp4
+test -x "$dhcp4" || die "cannot find $dhcp4"
+timecmd=""
+test -x /usr/bin/time && timecmd=/usr/bin/time
+
+if test -z "$workdir" ; then
+	workdir=$(mktemp -d /tmp/wicked-dhcp-load.XXXXXX) || die "cannot create work directory"
+else
+	mkdir -p "$workdir" || die "cannot create work directory $workdir"
+fi
+
+server_pid=""
+cleanup()
+{
+	test -n "$server_pid" && kill $server_pid 2>/dev/null
+	wait 2>/dev/null
+	if test -z "$keep" ; then
+		rm -rf "$workdir"
+	else
+		echo "# work directory: $workdir" >&2
+	fi
+}
+trap cleanup EXIT
+
+#
+# Topology: dlbr (10.100.0.1/16) <- dlp<n> == dlc<n> (client)
+#
+ip link set lo up
+ip link add dlbr type bridge forward_delay 0 stp_state 0 || die "cannot create bridge"
+ip addr add 10.100.0.1/16 dev dlbr
+ip link set dlbr up
+for ((n = 0; n < count; n++)) ; do
+	ip link add dlc$n type veth peer name dlp$n || die "cannot create veth pair $n"
+	ip link set dlp$n master dlbr
+	ip link set dlp$n up
+	ip link set dlc$n up
+done
+
+cat > "$workdir/request.xml" <<-EOT
+	<request type="lease"/>
+EOT
+
+"$dhcp4" ${config:+--config "$config"} --test-server \
+	--test-latency "$latency" --test-jitter "$jitter" --test-loss "$loss" \
+	dlbr > "$workdir/server.out" 2> "$workdir/server.log" &
+server_pid=$!
+sleep 1
+kill -0 $server_pid 2>/dev/null || die "test server failed: $(cat "$workdir/server.log")"
+
+client()
+{
+	local n=$1
+
+	# the test mode uses the last third of its timeout to acquire
+	${timecmd:+$timecmd -f %M -o "$workdir/client$n.rss"} \
+	"$dhcp4" ${config:+--config "$config"} --test \
+		--test-request "$workdir/request.xml" \
+		--test-timeout $((timeout * 3)) \
+		--test-output "$workdir/lease$n" \
+		dlc$n > "$workdir/client$n.log" 2>&1
+}
+
+start=$(date +%s%N)
+for ((n = 0; n < count; n++)) ; do
+	while test $(jobs -rp | wc -l) -gt $parallel ; do
+		wait -n 2>/dev/null || sleep 0.01
+	done
+	client $n &
+done
+while test $(jobs -rp | wc -l) -gt 1 ; do
+	wait -n 2>/dev/null || sleep 0.01
+done
+stop=$(date +%s%N)
+
+kill -TERM $server_pid
+wait $server_pid 2>/dev/null
+server_pid=""
+
+leases=$(grep -l "^IPADDR=" "$workdir"/lease* 2>/dev/null | wc -l)
+elapsed=$(( (stop - start) / 1000000 ))
+
+echo "clients:        $count ($parallel parallel)"
+echo "leases:         $leases"
+echo "wall time:      $elapsed ms"
+if test -n "$timecmd" ; then
+	cat "$workdir"/client*.rss 2>/dev/null | awk '
+		/^[0-9]+$/ { n++; s += $1; if ($1 > m) m = $1 }
+		END { if (n) printf "client rss:     avg %d KiB, max %d KiB\n", s / n, m }'
+fi
+echo "server:"
+sed -e 's/^/  /' "$workdir/server.out"
+
+test $leases -eq $count
@@ -0,0 +1,444 @@
+#!/bin/bash
+#
+#	wicked scale test -- ifup, ifreload, ifstatus and ifdown of many
+#	generated interface configurations in a private network namespace
+#
+#	Copyright (C) 2024 SUSE LLC
+#
+#	This program is free software; you can redistribute it and/or modify
+#	it under the terms of the GNU General Public License as published by
+#	the Free Software Foundation; either version 2 of the License, or
+#	(at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU General Public License along
+#	with this program; if not, see <http://www.gnu.org/licenses/> or write
+#	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+#	Boston, MA 02110-1301 USA.
+#
+# The test generates K configurations of each selected type, starts a
+# private dbus system bus, wickedd and wickedd-nanny in a new network
+# and mount namespace and runs the client actions on all of them. For
+# each action it reports the wall time, the CPU time (user+system) and
+# the peak RSS of the client and of each daemon, where the peak RSS of
+# the daemons is reset before each action.
+#
+# Types (each instance uses its number <n> in the names):
+#   dummy	sdum<n>				a dummy with an IPv4 address
+#   bond	sbond<n> + sbond<n>.10		an active-backup bond of two
+#		sbnd<n>a, sbnd<n>b		dummy ports and a vlan on top
+#   bridge	sbr<n> + sbrp<n>		a bridge with a dummy port
+#   vlan	svl<n> on svlbase		vlans on a common dummy
+#
+# Requires root permissions.
+
+PROGRAM=${0##*/}
+
+count=100
+types="dummy,bond,bridge,vlan"
+format="xml"
+timeout=""
+bindir=""
+sbindir=""
+keep=""
+generate_only=""
+workdir=""
+clk_tck=$(getconf CLK_TCK 2>/dev/null || echo 100)
+
+usage()
+{
+	cat <<-EOT
+	Usage: $PROGRAM [options]
+
+	Options:
+	  --help		show this help text
+	  --count <K>		number of instances of each type (default $count)
+	  --types <list>	comma separated list of dummy,bond,bridge,vlan
+				(default $types)
+	  --format xml|ifcfg	configuration format to generate (default $format)
+	  --timeout <sec>	ifup timeout passed to the client
+	  --bindir <dir>	directory of the wicked client
+	  --sbindir <dir>	directory of the wickedd and wickedd-nanny daemons
+	  --workdir <dir>	work directory (default a new temporary one)
+	  --keep		keep the work directory with configs and logs
+	  --generate-only	generate the configurations into the work
+				directory and exit
+	EOT
+	exit ${1:-0}
+}
+
+die()
+{
+	echo "$PROGRAM: $*" >&2
+	exit 1
+}
+
+while test $# -gt 0 ; do
+	case $1 in
+	--help)			usage 0 ;;
+	--count)		count=$2 ; shift ;;
+	--types)		types=$2 ; shift ;;
+	--format)		format=$2 ; shift ;;
+	--timeout)		timeout=$2 ; shift ;;
+	--bindir)		bindir=$2 ; shift ;;
+	--sbindir)		sbindir=$2 ; shift ;;
+	--workdir)		workdir=$2 ; shift ;;
+	--keep)			keep=yes ;;
+	--generate-only)	generate_only=yes ;;
+	*)			usage 1 ;;
+	esac
+	shift
+done
+
+[[ $count =~ ^[0-9]+$ && $count -gt 0 ]] || die "invalid count: $count"
+case $format in
+xml|ifcfg) ;;
+*)	die "unsupported format: $format" ;;
+esac
+for t in ${types//,/ } ; do
+	case $t in
+	dummy|bond|bridge|vlan) ;;
+	*)	die "unsupported type: $t" ;;
+	esac
+done
+case ,$types, in
+*,vlan,*) test $count -le 4094 || die "vlan supports at most 4094 instances" ;;
+esac
+
+#
+# Configuration generators
+#
+ipv4_prefix()
+{
+	# distinct /8 per type, so the addresses do not collide
+	echo "$(( $2 )).$(( ($1 >> 8) & 255 )).$(( $1 & 255 )).1/24"
+}
+
+xml_dummy()
+{
+	local name=$1 addr=$2 master=$3
+
+	echo "<interface>"
+	echo "  <name>$name</name>"
+	test -n "$master" && echo "  <link><master>$master</master></link>"
+	echo "  <dummy/>"
+	if test -n "$addr" ; then
+		echo "  <ipv4:static><address><local>$addr</local></address></ipv4:static>"
+	fi
+	echo "</interface>"
+}
+
+xml_vlan()
+{
+	local name=$1 device=$2 tag=$3 addr=$4
+
+	echo "<interface>"
+	echo "  <name>$name</name>"
+	echo "  <vlan><device>$device</device><tag>$tag</tag></vlan>"
+	if test -n "$addr" ; then
+		echo "  <ipv4:static><address><local>$addr</local></address></ipv4:static>"
+	fi
+	echo "</interface>"
+}
+
+xml_bond()
+{
+	local name=$1 ; shift
+
+	echo "<interface>"
+	echo "  <name>$name</name>"
+	echo "  <bond>"
+	echo "    <mode>active-backup</mode>"
+	echo "    <miimon><frequency>100</frequency></miimon>"
+	echo "    <slaves>"
+	for port in "$@" ; do
+		echo "      <slave><device>$port</device></slave>"
+	done
+	echo "    </slaves>"
+	echo "  </bond>"
+	echo "</interface>"
+}
+
+xml_bridge()
+{
+	local name=$1 addr=$2 ; shift 2
+
+	echo "<interface>"
+	echo "  <name>$name</name>"
+	echo "  <bridge>"
+	echo "    <stp>false</stp>"
+	echo "    <ports>"
+	for port in "$@" ; do
+		echo "      <port><device>$port</device></port>"
+	done
+	echo "    </ports>"
+	echo "  </bridge>"
+	echo "  <ipv4:static><address><local>$addr</local></address></ipv4:static>"
+	echo "</interface>"
+}
+
+ifcfg_dummy()
+{
+	local name=$1 addr=$2 master=$3
+
+	echo "STARTMODE=auto"
+	echo "INTERFACETYPE=dummy"
+	if test -n "$master" ; then
+		echo "BOOTPROTO=none"
+	elif test -n "$addr" ; then
+		echo "BOOTPROTO=static"
+		echo "IPADDR=$addr"
+	else
+		echo "BOOTPROTO=none"
+	fi
+} > "$cfgdir/ifcfg-$1"
+
+ifcfg_vlan()
+{
+	local name=$1 device=$2 tag=$3 addr=$4
+
+	echo "STARTMODE=auto"
+	echo "ETHERDEVICE=$device"
+	echo "VLAN_ID=$tag"
+	if test -n "$addr" ; then
+		echo "BOOTPROTO=static"
+		echo "IPADDR=$addr"
+	else
+		echo "BOOTPROTO=none"
+	fi
+} > "$cfgdir/ifcfg-$1"
+
+ifcfg_bond()
+{
+	local name=$1 n=0 ; shift
+
+	echo "STARTMODE=auto"
+	echo "BOOTPROTO=none"
+	echo "BONDING_MASTER=yes"
+	echo "BONDING_MODULE_OPTS='mode=active-backup miimon=100'"
+	for port in "$@" ; do
+		echo "BONDING_SLAVE_$n=$port"
+		n=$((n + 1))
+	done
+} > "$cfgdir/ifcfg-$1"
+
+ifcfg_bridge()
+{
+	local name=$1 addr=$2 ; shift 2
+
+	echo "STARTMODE=auto"
+	echo "BOOTPROTO=static"
+	echo "IPADDR=$addr"
+	echo "BRIDGE=yes"
+	echo "BRIDGE_STP=off"
+	echo "BRIDGE_PORTS='$*'"
+} > "$cfgdir/ifcfg-$1"
+
+generate()
+{
+	local i t out
+
+	if test "$format" = "xml" ; then
+		out="$cfgdir/scale.xml"
+		: > "$out"
+	else
+		# empty global sysconfig files, so the defaults are used
+		: > "$cfgdir/config"
+		: > "$cfgdir/dhcp"
+		out=/dev/null
+	fi
+
+	for t in ${types//,/ } ; do
+		if test "$t" = "vlan" ; then
+			"${format}_dummy" svlbase "" "" >> "$out"
+		fi
+		for (( i = 0; i < count; ++i )) ; do
+			case $t in
+			dummy)
+				"${format}_dummy" "sdum$i" "$(ipv4_prefix $i 10)" "" >> "$out"
+				;;
+			bond)
+				"${format}_dummy" "sbnd${i}a" "" "sbond$i" >> "$out"
+				"${format}_dummy" "sbnd${i}b" "" "sbond$i" >> "$out"
+				"${format}_bond"  "sbond$i" "sbnd${i}a" "sbnd${i}b" >> "$out"
+				"${format}_vlan"  "sbond$i.10" "sbond$i" 10 \
+						"$(ipv4_prefix $i 11)" >> "$out"
+				;;
+			bridge)
+				"${format}_dummy"  "sbrp$i" "" "sbr$i" >> "$out"
+				"${format}_bridge" "sbr$i" "$(ipv4_prefix $i 12)" "sbrp$i" >> "$out"
+				;;
+			vlan)
+				"${format}_vlan" "svl$i" svlbase $((i + 1)) \
+						"$(ipv4_prefix $i 13)" >> "$out"
+				;;
+			esac
+		done
+	done
+}
+
+#
+# Measurement helpers
+#
+now()
+{
+	date +%s.%N
+}
+
+proc_cpu()
+{
+	# utime + stime in clock ticks
+	local stat
+	read -r stat < "/proc/$1/stat" 2>/dev/null || { echo 0 ; return ; }
+	set -- ${stat#*) }
+	echo $(( ${12} + ${13} ))
+}
+
+proc_hwm()
+{
+	sed -n 's/^VmHWM:[[:space:]]*\([0-9]*\).*/\1/p' "/proc/$1/status" 2>/dev/null
+}
+
+proc_reset_hwm()
+{
+	echo 5 > "/proc/$1/clear_refs" 2>/dev/null
+}
+
+run_action()
+{
+	local action=$1 ; shift
+	local t0 t1 c0w c1w c0n c1n rc times
+	local tf="$workdir/time.$action"
+
+	proc_reset_hwm $wickedd_pid
+	proc_reset_hwm $nanny_pid
+	c0w=$(proc_cpu $wickedd_pid)
+	c0n=$(proc_cpu $nanny_pid)
+
+	t0=$(now)
+	/usr/bin/time -o "$tf" -f "%U %S %M" \
+		"$client" "$@" > "$workdir/$action.log" 2>&1
+	rc=$?
+	t1=$(now)
+
+	c1w=$(proc_cpu $wickedd_pid)
+	c1n=$(proc_cpu $nanny_pid)
+	times=$(tail -n 1 "$tf")
+	set -- $times
+
+	printf "%-9s %4d %9.3f %9.3f %8s %9.3f %8s %9.3f %8s\n" \
+		"$action" $rc \
+		"$(echo "$t1 - $t0" | bc)" \
+		"$(echo "$1 + $2" | bc)" "$3" \
+		"$(echo "scale=3; ($c1w - $c0w) / $clk_tck" | bc)" "$(proc_hwm $wickedd_pid)" \
+		"$(echo "scale=3; ($c1n - $c0n) / $clk_tck" | bc)" "$(proc_hwm $nanny_pid)"
+}
+
+cleanup()
+{
+	test -n "$nanny_pid"   && kill $nanny_pid   2>/dev/null
+	test -n "$wickedd_pid" && kill $wickedd_pid 2>/dev/null
+	test -n "$dbus_pid"    && kill $dbus_pid    2>/dev/null
+	wait 2>/dev/null
+	if test -z "$keep" -a -n "$workdir" ; then
+		rm -rf "$workdir"
+	elif test -n "$workdir" ; then
+		echo "# work directory: $workdir" >&2
+	fi
+}
+
+#
+# Re-run ourself in a new network and mount namespace
+#
+if test -z "$generate_only" -a -z "$WICKED_SCALE_TEST_NS" ; then
+	test $(id -u) -eq 0 || die "requires root permissions"
+	type -p unshare >/dev/null || die "unshare utility is missing"
+	exec env WICKED_SCALE_TEST_NS=1 unshare --net --mount --propagation private \
+		"$0" --count "$count" --types "$types" --format "$format" \
+		${timeout:+--timeout "$timeout"} ${bindir:+--bindir "$bindir"} \
+		${sbindir:+--sbindir "$sbindir"} ${workdir:+--workdir "$workdir"} \
+		${keep:+--keep}
+fi
+
+if test -z "$workdir" ; then
+	workdir=$(mktemp -d /tmp/wicked-scale.XXXXXX) || die "cannot create work directory"
+else
+	mkdir -p "$workdir" || die "cannot create work directory $workdir"
+fi
+if test "$format" = "xml" ; then
+	cfgdir="$workdir/xml"
+	ifconfig="$cfgdir"
+else
+	cfgdir="$workdir/ifcfg"
+	ifconfig="compat:suse:$cfgdir"
+fi
+mkdir -p "$cfgdir" || die "cannot create $cfgdir"
+
+generate
+if test -n "$generate_only" ; then
+	echo "$ifconfig"
+	exit 0
+fi
+trap cleanup EXIT
+
+client=${bindir:+$bindir/}wicked
+wickedd=${sbindir:-/usr/sbin}/wickedd
+nanny=${sbindir:-/usr/sbin}/wickedd-nanny
+type -p "$client" >/dev/null || die "cannot find the wicked client $client"
+test -x "$wickedd" || die "cannot find $wickedd"
+test -x "$nanny"   || die "cannot find $nanny"
+type -p dbus-daemon >/dev/null || die "dbus-daemon is missing"
+test -x /usr/bin/time || die "/usr/bin/time is missing"
+type -p bc >/dev/null || die "bc is missing"
+
+# private state and a private system bus
+mount -t tmpfs tmpfs /run/wicked 2>/dev/null || \
+	{ mkdir -p /run/wicked && mount -t tmpfs tmpfs /run/wicked ; } || \
+	die "cannot mount a private /run/wicked"
+ip link set lo up
+
+cat > "$workdir/dbus.conf" <<-EOT
+	<!DOCTYPE busconfig PUBLIC "-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN"
+	 "http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd">
+	<busconfig>
+	  <type>system</type>
+	  <listen>unix:path=$workdir/dbus.socket</listen>
+	  <auth>EXTERNAL</auth>
+	  <policy context="default">
+	    <allow user="*"/>
+	    <allow own="*"/>
+	    <allow send_destination="*"/>
+	    <allow receive_sender="*"/>
+	  </policy>
+	</busconfig>
+EOT
+dbus-daemon --config-file="$workdir/dbus.conf" --nofork --nopidfile \
+	> "$workdir/dbus.log" 2>&1 &
+dbus_pid=$!
+export DBUS_SYSTEM_BUS_ADDRESS="unix:path=$workdir/dbus.socket"
+for (( i = 0; i < 50; ++i )) ; do
+	test -S "$workdir/dbus.socket" && break
+	sleep 0.1
+done
+test -S "$workdir/dbus.socket" || die "private dbus daemon did not start"
+
+"$wickedd" --foreground > "$workdir/wickedd.log" 2>&1 &
+wickedd_pid=$!
+sleep 1
+"$nanny" --foreground > "$workdir/nanny.log" 2>&1 &
+nanny_pid=$!
+sleep 1
+kill -0 $wickedd_pid 2>/dev/null || die "wickedd did not start, see $workdir/wickedd.log"
+kill -0 $nanny_pid   2>/dev/null || die "wickedd-nanny did not start, see $workdir/nanny.log"
+
+echo "# $count instances of $types ($format), wall/cpu in sec, rss in KiB"
+printf "%-9s %4s %9s %9s %8s %9s %8s %9s %8s\n" \
+	"#action" "rc" "wall" "cli-cpu" "cli-rss" "wd-cpu" "wd-rss" "nny-cpu" "nny-rss"
+run_action ifup     --ifconfig "$ifconfig" ifup ${timeout:+--timeout "$timeout"} all
+run_action ifreload --ifconfig "$ifconfig" ifreload all
+run_action ifstatus --ifconfig "$ifconfig" ifstatus all
+run_action ifdown   --ifconfig "$ifconfig" ifdown all
@@ -24,6 +24,7 @@
 #include <poll.h>
 #include <errno.h>
 #include <limits.h>
+#include <unistd.h>
 
 #include <wicked/time.h>
 #include <wicked/logging.h>
@@ -757,5 +758,54 @@ TESTCASE(socket_arrays_remove)
 	ni_socket_release(sock);
 }
 
+TESTCASE(socket_array_epoll)
+{
+	/* Check the epoll backend with a real pipe, poll is mocked */
+
+	ni_socket_t *sock = NULL;
+	ni_socket_array_t array;
+	struct s_testdata td;
+	int fds[2];
+
+	CHECK(ni_socket_array_set_epoll(NULL, TRUE) == FALSE);
+	if (pipe(fds) == 0) {
+		memset(&td, 0, sizeof(td));
+		ni_socket_array_init(&array);
+		CHECK(ni_socket_array_is_epoll(&array) == FALSE);
+		if (!ni_socket_array_set_epoll(&array, TRUE)) {
+			/* built without epoll support */
+			close(fds[0]);
+			close(fds[1]);
+			return;
+		}
+		CHECK(ni_socket_array_is_epoll(&array) == TRUE);
+
+		sock = ni_socket_wrap(fds[0], 0);
+		sock->user_data = &td;
+		sock->receive = cb_receive;
+		CHECK(ni_socket_array_activate(&array, sock) == TRUE);
+		CHECK(sock->epoll == 1);
+
+		mock_poll = NULL;
+		CHECK(ni_socket_array_wait(&array, 0) == 0);
+		CHECK(td.receive_cnt == 0);
+
+		CHECK(write(fds[1], "x", 1) == 1);
+		CHECK(ni_socket_array_wait(&array, 0) == 0);
+		CHECK(td.receive_cnt == 1);
+
+		CHECK(ni_socket_array_deactivate(&array, sock) == TRUE);
+		CHECK(sock->epoll == 0);
+		CHECK(ni_socket_array_wait(&array, 0) == 0);
+		CHECK(td.receive_cnt == 1);
+
+		sock->user_data = NULL;
+		ni_socket_close(sock);
+		close(fds[1]);
+		ni_socket_array_destroy(&array);
+		CHECK(ni_socket_array_is_epoll(&array) == FALSE);
+	}
+}
+
 TESTMAIN();
 
@@ -0,0 +1,120 @@
+/*
+ *	Timer unit tests
+ *
+ *	Copyright (C) 2022 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <wicked/time.h>
+#include "wunit.h"
+
+#define TIMER_TEST_COUNT	1000
+
+static unsigned int		fired[TIMER_TEST_COUNT];
+static unsigned int		fired_count;
+
+static void
+timer_test_callback(void *user_data, const ni_timer_t *timer)
+{
+	unsigned int *id = user_data;
+
+	if (fired_count < TIMER_TEST_COUNT)
+		fired[fired_count++] = *id;
+}
+
+TESTCASE(expire_in_arm_order)
+{
+	static unsigned int ids[TIMER_TEST_COUNT];
+	unsigned int i, ordered = 1;
+
+	fired_count = 0;
+	for (i = 0; i < TIMER_TEST_COUNT; ++i) {
+		ids[i] = i;
+		CHECK2(ni_timer_register(0, timer_test_callback, &ids[i]) != NULL,
+				"register expired timer %u", i);
+	}
+
+	CHECK(ni_timer_next_timeout() == NI_TIMEOUT_INFINITE);
+	CHECK(fired_count == TIMER_TEST_COUNT);
+	for (i = 0; i < fired_count; ++i) {
+		if (fired[i] != i)
+			ordered = 0;
+	}
+	CHECK2(ordered, "timers with equal expiry fire in arm order");
+}
+
+TESTCASE(cancel_and_rearm)
+{
+	static unsigned int ids[TIMER_TEST_COUNT];
+	const ni_timer_t *timers[TIMER_TEST_COUNT];
+	unsigned int i, canceled = 0;
+	ni_timeout_t timeout;
+
+	fired_count = 0;
+	for (i = 0; i < TIMER_TEST_COUNT; ++i) {
+		ids[i] = i;
+		timers[i] = ni_timer_register(NI_TIMEOUT_FROM_SEC(60 + (i % 7)),
+				timer_test_callback, &ids[i]);
+	}
+
+	/* cancel every odd timer, expire every even one */
+	for (i = 0; i < TIMER_TEST_COUNT; ++i) {
+		if (i % 2) {
+			if (ni_timer_cancel(timers[i]) == &ids[i])
+				canceled++;
+		} else {
+			timers[i] = ni_timer_rearm(timers[i], 0);
+		}
+	}
+	CHECK(canceled == TIMER_TEST_COUNT / 2);
+
+	timeout = ni_timer_next_timeout();
+	CHECK(timeout == NI_TIMEOUT_INFINITE);
+	CHECK(fired_count == TIMER_TEST_COUNT / 2);
+
+	/* handles of expired or canceled timers are not found any more */
+	CHECK(ni_timer_cancel(timers[0]) == NULL);
+	CHECK(ni_timer_cancel(timers[1]) == NULL);
+	CHECK(ni_timer_rearm(timers[2], 0) == NULL);
+}
+
+TESTCASE(next_timeout)
+{
+	static unsigned int id = 1;
+	const ni_timer_t *near, *far;
+	ni_timeout_t timeout;
+
+	fired_count = 0;
+	far  = ni_timer_register(NI_TIMEOUT_FROM_SEC(20), timer_test_callback, &id);
+	near = ni_timer_register(NI_TIMEOUT_FROM_SEC(10), timer_test_callback, &id);
+
+	timeout = ni_timer_next_timeout();
+	CHECK(timeout > NI_TIMEOUT_FROM_SEC(9) && timeout <= NI_TIMEOUT_FROM_SEC(10));
+
+	CHECK(ni_timer_cancel(near) == &id);
+	timeout = ni_timer_next_timeout();
+	CHECK(timeout > NI_TIMEOUT_FROM_SEC(19) && timeout <= NI_TIMEOUT_FROM_SEC(20));
+
+	CHECK(ni_timer_cancel(far) == &id);
+	CHECK(ni_timer_next_timeout() == NI_TIMEOUT_INFINITE);
+	CHECK(fired_count == 0);
+}
+
+TESTMAIN();
@@ -0,0 +1,1063 @@
+/*
+ *	Microbenchmarks for the libwicked data structures
+ *
+ *	Copyright (C) 2024 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ * Each benchmark builds its input from fixed, generated data, runs a
+ * fixed number of iterations several times and reports the minimum,
+ * median and maximum time per operation as JSON, so the results of
+ * different releases can be compared.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_addr.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/netinfo.h>
+#include <wicked/route.h>
+#include <wicked/address.h>
+#include <wicked/time.h>
+#include <wicked/xml.h>
+#include <wicked/xpath.h>
+#include <wicked/dbus.h>
+#include <wicked/fsm.h>
+#include <wicked/ethtool.h>
+
+#include "netinfo_priv.h"
+#include "util_priv.h"
+#include "json.h"
+#include "buffer.h"
+
+#define BENCH_XML_INTERFACES		256
+#define BENCH_JSON_OBJECTS		256
+#define BENCH_ROUTES			2048
+#define BENCH_NETDEVS			1024
+#define BENCH_TIMERS			1024
+#define BENCH_VARS			256
+#define BENCH_WORKERS			4000
+#define BENCH_DBUS_ENTRIES		32
+#define BENCH_TRACE_ADDRS		64
+#define BENCH_SOCKADDRS			1024
+#define BENCH_UDP_PAYLOAD		548
+#define BENCH_LINK_MODES		100
+#define BENCH_REPEATS			5
+
+typedef struct bench	bench_t;
+struct bench {
+	const char *		name;
+	unsigned int		iterations;
+	ni_bool_t		(*setup)(void);
+	unsigned int		(*run)(unsigned int);
+	void			(*cleanup)(void);
+};
+
+static const char *	program_name;
+
+/*
+ * Timing helpers
+ */
+static uint64_t
+bench_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int
+bench_ns_cmp(const void *a, const void *b)
+{
+	double da = *(const double *)a;
+	double db = *(const double *)b;
+
+	return da > db ? 1 : da < db ? -1 : 0;
+}
+
+/*
+ * xml_document_read and xml_node_get_child
+ */
+static char *		bench_xml_file;
+static xml_document_t *	bench_xml_doc;
+static xpath_enode_t *	bench_xpath_expr;
+
+static ni_bool_t
+bench_xml_setup(void)
+{
+	char path[] = "/tmp/wicked-bench-XXXXXX";
+	xml_document_t *doc;
+	xml_node_t *root, *ifnode, *node;
+	char name[64];
+	unsigned int i;
+	int fd;
+
+	if (bench_xml_doc)
+		return TRUE;
+
+	doc = xml_document_new();
+	root = xml_document_root(doc);
+	for (i = 0; i < BENCH_XML_INTERFACES; ++i) {
+		snprintf(name, sizeof(name), "interface-%u", i);
+		ifnode = xml_node_new(name, root);
+		snprintf(name, sizeof(name), "eth%u", i);
+		xml_node_new_element("name", ifnode, name);
+
+		node = xml_node_new("ipv4", ifnode);
+		xml_node_new_element("enabled", node, "true");
+		snprintf(name, sizeof(name), "10.%u.%u.1/24", i / 256, i % 256);
+		xml_node_new_element("address", node, name);
+
+		node = xml_node_new("ipv6", ifnode);
+		xml_node_new_element("enabled", node, "true");
+		snprintf(name, sizeof(name), "2001:db8:%x::1/64", i);
+		xml_node_new_element("address", node, name);
+	}
+
+	if ((fd = mkstemp(path)) < 0) {
+		xml_document_free(doc);
+		return FALSE;
+	}
+	close(fd);
+
+	if (xml_document_write(doc, path) < 0) {
+		unlink(path);
+		xml_document_free(doc);
+		return FALSE;
+	}
+	xml_document_free(doc);
+
+	ni_string_dup(&bench_xml_file, path);
+	bench_xml_doc = xml_document_read(bench_xml_file);
+	bench_xpath_expr = xpath_expression_parse("//ipv4/address");
+	return bench_xml_doc && bench_xpath_expr;
+}
+
+static unsigned int
+bench_xml_document_read(unsigned int iterations)
+{
+	xml_document_t *doc;
+	unsigned int i, ok = 0;
+
+	for (i = 0; i < iterations; ++i) {
+		if ((doc = xml_document_read(bench_xml_file))) {
+			xml_document_free(doc);
+			ok++;
+		}
+	}
+	return ok;
+}
+
+static unsigned int
+bench_xml_node_get_child(unsigned int iterations)
+{
+	xml_node_t *root = xml_document_root(bench_xml_doc);
+	unsigned int i, ok = 0;
+	char name[64];
+
+	for (i = 0; i < iterations; ++i) {
+		snprintf(name, sizeof(name), "interface-%u", i % BENCH_XML_INTERFACES);
+		if (xml_node_get_child(root, name))
+			ok++;
+	}
+	return ok;
+}
+
+static unsigned int
+bench_xml_document_sprint(unsigned int iterations)
+{
+	unsigned int i, ok = 0;
+	char *string;
+
+	for (i = 0; i < iterations; ++i) {
+		if ((string = xml_document_sprint(bench_xml_doc))) {
+			free(string);
+			ok++;
+		}
+	}
+	return ok;
+}
+
+static unsigned int
+bench_xpath_expression_eval(unsigned int iterations)
+{
+	xml_node_t *root = xml_document_root(bench_xml_doc);
+	xpath_result_t *result;
+	unsigned int i, ok = 0;
+
+	for (i = 0; i < iterations; ++i) {
+		if ((result = xpath_expression_eval(bench_xpath_expr, root))) {
+			xpath_result_free(result);
+			ok++;
+		}
+	}
+	return ok;
+}
+
+static void
+bench_xml_cleanup(void)
+{
+	if (bench_xpath_expr) {
+		xpath_expression_free(bench_xpath_expr);
+		bench_xpath_expr = NULL;
+	}
+	if (bench_xml_doc) {
+		xml_document_free(bench_xml_doc);
+		bench_xml_doc = NULL;
+	}
+	if (bench_xml_file) {
+		unlink(bench_xml_file);
+		ni_string_free(&bench_xml_file);
+	}
+}
+
+/*
+ * ni_json parsing and formatting
+ */
+static char *		bench_json_string;
+static ni_json_t *	bench_json;
+
+static ni_bool_t
+bench_json_setup(void)
+{
+	ni_json_format_options_t options = NI_JSON_OPTIONS_INIT;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_json_t *array, *object;
+	char name[64];
+	unsigned int i;
+
+	if (bench_json)
+		return TRUE;
+
+	array = ni_json_new_array();
+	for (i = 0; i < BENCH_JSON_OBJECTS; ++i) {
+		object = ni_json_new_object();
+		snprintf(name, sizeof(name), "eth%u", i);
+		ni_json_object_set(object, "name", ni_json_new_string(name));
+		ni_json_object_set(object, "index", ni_json_new_int64(i + 1));
+		ni_json_object_set(object, "mtu", ni_json_new_int64(1500));
+		ni_json_object_set(object, "up", ni_json_new_bool(i % 2));
+		ni_json_object_set(object, "load", ni_json_new_double(i / 100.0));
+		ni_json_object_set(object, "master", ni_json_new_null());
+		ni_json_array_append(array, object);
+	}
+
+	ni_json_format_string(&buf, array, &options);
+	ni_json_free(array);
+
+	bench_json_string = buf.string;
+	bench_json = ni_json_parse_string(bench_json_string);
+	return bench_json != NULL;
+}
+
+static unsigned int
+bench_json_parse(unsigned int iterations)
+{
+	unsigned int i, ok = 0;
+	ni_json_t *json;
+
+	for (i = 0; i < iterations; ++i) {
+		if ((json = ni_json_parse_string(bench_json_string))) {
+			ni_json_free(json);
+			ok++;
+		}
+	}
+	return ok;
+}
+
+static unsigned int
+bench_json_format(unsigned int iterations)
+{
+	ni_json_format_options_t options = NI_JSON_OPTIONS_INIT;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned int i, ok = 0;
+
+	for (i = 0; i < iterations; ++i) {
+		if (ni_json_format_string(&buf, bench_json, &options))
+			ok++;
+		ni_stringbuf_destroy(&buf);
+	}
+	return ok;
+}
+
+static void
+bench_json_cleanup(void)
+{
+	ni_json_free(bench_json);
+	bench_json = NULL;
+	ni_string_free(&bench_json_string);
+}
+
+/*
+ * ni_route_tables_find_match
+ */
+static ni_route_table_t *	bench_route_tables;
+static ni_route_t *		bench_routes[BENCH_ROUTES];
+
+static ni_route_t *
+bench_route_new(const char *prefix)
+{
+	ni_route_t *rp;
+
+	if (!(rp = ni_route_new()))
+		return NULL;
+
+	if (!ni_sockaddr_prefix_parse(prefix, &rp->destination, &rp->prefixlen)) {
+		ni_route_free(rp);
+		return NULL;
+	}
+	rp->family = rp->destination.ss_family;
+	rp->table = RT_TABLE_MAIN;
+	return rp;
+}
+
+static ni_bool_t
+bench_route_setup(void)
+{
+	char buf[64];
+	unsigned int i;
+
+	for (i = 0; i < BENCH_ROUTES; ++i) {
+		if (i % 2)
+			snprintf(buf, sizeof(buf), "2001:db8:%x::/48", i);
+		else
+			snprintf(buf, sizeof(buf), "10.%u.%u.0/24", i / 256, i % 256);
+
+		if (!(bench_routes[i] = bench_route_new(buf)))
+			return FALSE;
+		ni_route_tables_add_route(&bench_route_tables, ni_route_ref(bench_routes[i]));
+	}
+	return TRUE;
+}
+
+static unsigned int
+bench_route_tables_find_match(unsigned int iterations)
+{
+	unsigned int i, ok = 0;
+
+	for (i = 0; i < iterations; ++i) {
+		if (ni_route_tables_find_match(bench_route_tables,
+					bench_routes[(i * 7) % BENCH_ROUTES], ni_route_equal))
+			ok++;
+	}
+	return ok;
+}
+
+static void
+bench_route_cleanup(void)
+{
+	unsigned int i;
+
+	ni_route_tables_destroy(&bench_route_tables);
+	for (i = 0; i < BENCH_ROUTES; ++i) {
+		ni_route_free(bench_routes[i]);
+		bench_routes[i] = NULL;
+	}
+}
+
+/*
+ * ni_sockaddr_equal, ni_sockaddr_compare, ni_sockaddr_prefix_match
+ */
+static ni_sockaddr_t		bench_sockaddrs[BENCH_SOCKADDRS];
+
+static ni_bool_t
+bench_sockaddr_setup(void)
+{
+	char buf[64];
+	unsigned int i;
+
+	for (i = 0; i < BENCH_SOCKADDRS; ++i) {
+		if (i % 2)
+			snprintf(buf, sizeof(buf), "2001:db8:%x::%x", i % 16, i);
+		else
+			snprintf(buf, sizeof(buf), "10.%u.%u.1", i % 16, i / 16);
+
+		if (ni_sockaddr_parse(&bench_sockaddrs[i], buf, AF_UNSPEC) < 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static unsigned int
+bench_sockaddr_equal(unsigned int iterations)
+{
+	unsigned int i, j, ok = 0;
+
+	for (i = 0; i < iterations; ++i) {
+		j = (i * 3) % BENCH_SOCKADDRS;
+		if (ni_sockaddr_equal(&bench_sockaddrs[i % BENCH_SOCKADDRS],
+				&bench_sockaddrs[j]) == (i % BENCH_SOCKADDRS == j))
+			ok++;
+	}
+	return ok;
+}
+
+static unsigned int
+bench_sockaddr_compare(unsigned int iterations)
+{
+	unsigned int i, j, ok = 0;
+
+	for (i = 0; i < iterations; ++i) {
+		j = (i * 3) % BENCH_SOCKADDRS;
+		if ((ni_sockaddr_compare(&bench_sockaddrs[i % BENCH_SOCKADDRS],
+				&bench_sockaddrs[j]) == 0) == (i % BENCH_SOCKADDRS == j))
+			ok++;
+	}
+	return ok;
+}
+
+static unsigned int
+bench_sockaddr_prefix_match(unsigned int iterations)
+{
+	unsigned int i, ok = 0;
+
+	for (i = 0; i < iterations; ++i) {
+		/* the address pairs share their /16 or /64 prefix */
+		if (ni_sockaddr_prefix_match(i % 2 ? 64 : 16,
+				&bench_sockaddrs[i % BENCH_SOCKADDRS],
+				&bench_sockaddrs[(i + 32) % BENCH_SOCKADDRS]))
+			ok++;
+	}
+	return ok;
+}
+
+static void
+bench_sockaddr_cleanup(void)
+{
+}
+
+/*
+ * ni_netdev_by_name
+ */
+static ni_netconfig_t *	bench_netconfig;
+
+static ni_bool_t
+bench_netdev_setup(void)
+{
+	ni_netdev_t *dev;
+	char name[IFNAMSIZ];
+	unsigned int i;
+
+	if (!(bench_netconfig = ni_netconfig_new()))
+		return FALSE;
+
+	for (i = 0; i < BENCH_NETDEVS; ++i) {
+		snprintf(name, sizeof(name), "eth%u", i);
+		if (!(dev = ni_netdev_new(name, i + 1)))
+			return FALSE;
+		ni_netconfig_device_append(bench_netconfig, dev);
+	}
+	return TRUE;
+}
+
+static unsigned int
+bench_netdev_by_name(unsigned int iterations)
+{
+	unsigned int i, ok = 0;
+	char name[IFNAMSIZ];
+
+	for (i = 0; i < iterations; ++i) {
+		snprintf(name, sizeof(name), "eth%u", (i * 7) % BENCH_NETDEVS);
+		if (ni_netdev_by_name(bench_netconfig, name))
+			ok++;
+	}
+	return ok;
+}
+
+static void
+bench_netdev_cleanup(void)
+{
+	ni_netconfig_free(bench_netconfig);
+	bench_netconfig = NULL;
+}
+
+/*
+ * ni_var_array_get in a sysconfig sized array
+ */
+static ni_var_array_t		bench_vars = NI_VAR_ARRAY_INIT;
+
+static ni_bool_t
+bench_vars_setup(void)
+{
+	char name[32];
+	unsigned int i;
+
+	for (i = 0; i < BENCH_VARS; ++i) {
+		snprintf(name, sizeof(name), "IPADDR_%u", i);
+		if (!ni_var_array_append(&bench_vars, name, "192.0.2.1/24"))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static unsigned int
+bench_vars_get(unsigned int iterations)
+{
+	unsigned int i, ok = 0;
+	char name[32];
+
+	for (i = 0; i < iterations; ++i) {
+		snprintf(name, sizeof(name), "IPADDR_%u", (i * 7) % BENCH_VARS);
+		if (ni_var_array_get(&bench_vars, name))
+			ok++;
+	}
+	return ok;
+}
+
+static void
+bench_vars_cleanup(void)
+{
+	ni_var_array_destroy(&bench_vars);
+}
+
+/*
+ * ni_fsm_ifworker_by_name with many interface workers
+ */
+static ni_fsm_t *		bench_fsm;
+
+static ni_bool_t
+bench_fsm_setup(void)
+{
+	char name[IFNAMSIZ];
+	unsigned int i;
+
+	if (!(bench_fsm = ni_fsm_new()))
+		return FALSE;
+
+	for (i = 0; i < BENCH_WORKERS; ++i) {
+		snprintf(name, sizeof(name), "eth%u", i);
+		if (!ni_fsm_ifworker_new(bench_fsm, NI_IFWORKER_TYPE_NETDEV, name))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static unsigned int
+bench_fsm_ifworker_by_name(unsigned int iterations)
+{
+	unsigned int i, ok = 0;
+	char name[IFNAMSIZ];
+
+	for (i = 0; i < iterations; ++i) {
+		snprintf(name, sizeof(name), "eth%u", (i * 7) % BENCH_WORKERS);
+		if (ni_fsm_ifworker_by_name(bench_fsm, NI_IFWORKER_TYPE_NETDEV, name))
+			ok++;
+	}
+	return ok;
+}
+
+static void
+bench_fsm_cleanup(void)
+{
+	ni_fsm_free(bench_fsm);
+	bench_fsm = NULL;
+}
+
+/*
+ * ni_timer_register and ni_timer_cancel with armed timers
+ */
+static const ni_timer_t *	bench_timers[BENCH_TIMERS];
+
+static void
+bench_timer_callback(void *user_data, const ni_timer_t *timer)
+{
+}
+
+static ni_bool_t
+bench_timer_setup(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < BENCH_TIMERS; ++i) {
+		bench_timers[i] = ni_timer_register(NI_TIMEOUT_FROM_SEC(3600 + i),
+				bench_timer_callback, NULL);
+		if (!bench_timers[i])
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static unsigned int
+bench_timer_register_cancel(unsigned int iterations)
+{
+	const ni_timer_t *timer;
+	unsigned int i, ok = 0;
+
+	for (i = 0; i < iterations; ++i) {
+		timer = ni_timer_register(NI_TIMEOUT_FROM_SEC(3600 + i % BENCH_TIMERS),
+				bench_timer_callback, NULL);
+		if (timer) {
+			ni_timer_cancel(timer);
+			ok++;
+		}
+	}
+	return ok;
+}
+
+static void
+bench_timer_cleanup(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < BENCH_TIMERS; ++i) {
+		if (bench_timers[i])
+			ni_timer_cancel(bench_timers[i]);
+		bench_timers[i] = NULL;
+	}
+}
+
+/*
+ * ni_dbus variant serialization and deserialization
+ */
+static ni_dbus_variant_t	bench_dbus_dict;
+
+static ni_bool_t
+bench_dbus_setup(void)
+{
+	ni_dbus_variant_t *child;
+	char key[64], value[64];
+	unsigned int i;
+
+	ni_dbus_variant_init_dict(&bench_dbus_dict);
+	for (i = 0; i < BENCH_DBUS_ENTRIES; ++i) {
+		snprintf(key, sizeof(key), "name-%u", i);
+		snprintf(value, sizeof(value), "value-%u", i);
+		ni_dbus_dict_add_string(&bench_dbus_dict, key, value);
+
+		snprintf(key, sizeof(key), "index-%u", i);
+		ni_dbus_dict_add_uint32(&bench_dbus_dict, key, i);
+	}
+	if (!(child = ni_dbus_dict_add(&bench_dbus_dict, "ipv4")))
+		return FALSE;
+	ni_dbus_variant_init_dict(child);
+	ni_dbus_dict_add_string(child, "address", "192.0.2.1/24");
+	ni_dbus_dict_add_uint32(child, "prefixlen", 24);
+	return TRUE;
+}
+
+static unsigned int
+bench_dbus_variant_serialize(unsigned int iterations)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_message_t *msg;
+	unsigned int i, ok = 0;
+
+	for (i = 0; i < iterations; ++i) {
+		msg = dbus_message_new_method_call("org.opensuse.Network",
+				"/org/opensuse/Network/Interface/1",
+				"org.opensuse.Network.Interface", "changeDevice");
+		if (!msg)
+			continue;
+
+		if (ni_dbus_message_serialize_variants(msg, 1, &bench_dbus_dict, &error) &&
+		    ni_dbus_message_get_args_variants(msg, &result, 1) == 1)
+			ok++;
+
+		ni_dbus_variant_destroy(&result);
+		dbus_error_free(&error);
+		dbus_message_unref(msg);
+	}
+	return ok;
+}
+
+static void
+bench_dbus_cleanup(void)
+{
+	ni_dbus_variant_destroy(&bench_dbus_dict);
+}
+
+/*
+ * ni_server_trace_{route,interface_addr}_events with debug enabled
+ * for an unrelated facility only, the cost of the disabled traces on
+ * the route and address event paths.
+ */
+static unsigned int		bench_trace_debug;
+static unsigned int		bench_trace_level;
+static ni_netdev_t *		bench_trace_dev;
+static ni_address_t *		bench_trace_addrs[BENCH_TRACE_ADDRS];
+
+static ni_bool_t
+bench_trace_setup(void)
+{
+	ni_sockaddr_t addr;
+	char buf[64];
+	unsigned int i;
+
+	bench_trace_debug = ni_debug;
+	bench_trace_level = ni_log_level;
+	ni_debug = NI_TRACE_DHCP;
+	ni_log_level = NI_LOG_DEBUG2;
+
+	if (!bench_route_setup())
+		return FALSE;
+
+	if (!(bench_trace_dev = ni_netdev_new("eth0", 1)))
+		return FALSE;
+
+	for (i = 0; i < BENCH_TRACE_ADDRS; ++i) {
+		snprintf(buf, sizeof(buf), "2001:db8::%x", i + 1);
+		if (ni_sockaddr_parse(&addr, buf, AF_INET6) < 0)
+			return FALSE;
+		if (!(bench_trace_addrs[i] = ni_address_create(AF_INET6, 64, &addr, NULL)))
+			return FALSE;
+		bench_trace_addrs[i]->flags = IFA_F_PERMANENT | IFA_F_NOPREFIXROUTE;
+	}
+	return TRUE;
+}
+
+static unsigned int
+bench_trace_route_events(unsigned int iterations)
+{
+	unsigned int i;
+
+	for (i = 0; i < iterations; ++i) {
+		ni_server_trace_route_events(NULL, NI_EVENT_ROUTE_UPDATE,
+				bench_routes[i % BENCH_ROUTES]);
+	}
+	return iterations;
+}
+
+static unsigned int
+bench_trace_addr_events(unsigned int iterations)
+{
+	unsigned int i;
+
+	for (i = 0; i < iterations; ++i) {
+		ni_server_trace_interface_addr_events(bench_trace_dev, NI_EVENT_ADDRESS_UPDATE,
+				bench_trace_addrs[i % BENCH_TRACE_ADDRS]);
+	}
+	return iterations;
+}
+
+static void
+bench_trace_cleanup(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < BENCH_TRACE_ADDRS; ++i) {
+		ni_address_free(bench_trace_addrs[i]);
+		bench_trace_addrs[i] = NULL;
+	}
+	ni_netdev_put(bench_trace_dev);
+	bench_trace_dev = NULL;
+	bench_route_cleanup();
+
+	ni_debug = bench_trace_debug;
+	ni_log_level = bench_trace_level;
+}
+
+/*
+ * ni_capture_build_udp_header with the ip and udp checksum
+ * of a dhcp4 sized (576 bytes) packet
+ */
+static unsigned char		bench_udp_data[BENCH_UDP_PAYLOAD];
+
+static ni_bool_t
+bench_udp_setup(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < BENCH_UDP_PAYLOAD; ++i)
+		bench_udp_data[i] = (i * 31) & 0xff;
+	return TRUE;
+}
+
+static unsigned int
+bench_udp_build_header(unsigned int iterations)
+{
+	unsigned char packet[sizeof(struct ip) + sizeof(struct udphdr) + BENCH_UDP_PAYLOAD];
+	struct in_addr src = { 0 }, dst = { 0 };
+	unsigned int i, ok = 0;
+	ni_buffer_t buf;
+
+	for (i = 0; i < iterations; ++i) {
+		ni_buffer_init(&buf, packet, sizeof(packet));
+		ni_buffer_reserve_head(&buf, sizeof(struct ip) + sizeof(struct udphdr));
+		ni_buffer_put(&buf, bench_udp_data, sizeof(bench_udp_data));
+		if (ni_capture_build_udp_header(&buf, src, 68, dst, 67) == 0)
+			ok++;
+	}
+	return ok;
+}
+
+static void
+bench_udp_cleanup(void)
+{
+}
+
+/*
+ * ethtool advertise link mode name <-> bit mapping
+ */
+static unsigned int		bench_link_modes[BENCH_LINK_MODES];
+static unsigned int		bench_link_modes_count;
+
+static ni_bool_t
+bench_link_modes_setup(void)
+{
+	unsigned int bit;
+
+	bench_link_modes_count = 0;
+	for (bit = 0; bit < BENCH_LINK_MODES; ++bit) {
+		if (ni_ethtool_link_adv_name(bit))
+			bench_link_modes[bench_link_modes_count++] = bit;
+	}
+	return bench_link_modes_count > 0;
+}
+
+static unsigned int
+bench_link_modes_map(unsigned int iterations)
+{
+	unsigned int i, mode, bit, ok = 0;
+	const char *name;
+
+	for (i = 0; i < iterations; ++i) {
+		mode = bench_link_modes[i % bench_link_modes_count];
+		if (!(name = ni_ethtool_link_adv_name(mode)))
+			continue;
+		if (ni_ethtool_link_adv_type(name, &bit) && bit == mode)
+			ok++;
+	}
+	return ok;
+}
+
+static void
+bench_link_modes_cleanup(void)
+{
+}
+
+static const bench_t		bench_list[] = {
+	{ "xml_document_read",		200,	bench_xml_setup,
+		bench_xml_document_read,	bench_xml_cleanup	},
+	{ "xml_node_get_child",		200000,	bench_xml_setup,
+		bench_xml_node_get_child,	bench_xml_cleanup	},
+	{ "xpath_expression_eval",	2000,	bench_xml_setup,
+		bench_xpath_expression_eval,	bench_xml_cleanup	},
+	{ "xml_document_sprint",	500,	bench_xml_setup,
+		bench_xml_document_sprint,	bench_xml_cleanup	},
+	{ "ni_json_parse_string",	500,	bench_json_setup,
+		bench_json_parse,		bench_json_cleanup	},
+	{ "ni_json_format_string",	500,	bench_json_setup,
+		bench_json_format,		bench_json_cleanup	},
+	{ "ni_route_tables_find_match",	20000,	bench_route_setup,
+		bench_route_tables_find_match,	bench_route_cleanup	},
+	{ "ni_sockaddr_equal",		2000000, bench_sockaddr_setup,
+		bench_sockaddr_equal,		bench_sockaddr_cleanup	},
+	{ "ni_sockaddr_compare",	2000000, bench_sockaddr_setup,
+		bench_sockaddr_compare,		bench_sockaddr_cleanup	},
+	{ "ni_sockaddr_prefix_match",	2000000, bench_sockaddr_setup,
+		bench_sockaddr_prefix_match,	bench_sockaddr_cleanup	},
+	{ "ni_netdev_by_name",		200000,	bench_netdev_setup,
+		bench_netdev_by_name,		bench_netdev_cleanup	},
+	{ "ni_var_array_get",		200000,	bench_vars_setup,
+		bench_vars_get,			bench_vars_cleanup	},
+	{ "ni_fsm_ifworker_by_name",	200000,	bench_fsm_setup,
+		bench_fsm_ifworker_by_name,	bench_fsm_cleanup	},
+	{ "ni_timer_register_cancel",	200000,	bench_timer_setup,
+		bench_timer_register_cancel,	bench_timer_cleanup	},
+	{ "ni_dbus_variant_serialize",	5000,	bench_dbus_setup,
+		bench_dbus_variant_serialize,	bench_dbus_cleanup	},
+	{ "ni_server_trace_route_events", 200000, bench_trace_setup,
+		bench_trace_route_events,	bench_trace_cleanup	},
+	{ "ni_server_trace_addr_events", 200000, bench_trace_setup,
+		bench_trace_addr_events,	bench_trace_cleanup	},
+	{ "ni_capture_build_udp_header", 200000, bench_udp_setup,
+		bench_udp_build_header,		bench_udp_cleanup	},
+	{ "ni_ethtool_link_adv_name_type", 200000, bench_link_modes_setup,
+		bench_link_modes_map,		bench_link_modes_cleanup },
+	{ NULL }
+};
+
+static ni_json_t *
+bench_json_ns(double ns)
+{
+	return ni_json_new_int64((int64_t)(ns + 0.5));
+}
+
+static ni_json_t *
+bench_run(const bench_t *bench, unsigned int scale, unsigned int repeats)
+{
+	unsigned int iterations = bench->iterations * scale;
+	unsigned int r, ok = 0;
+	ni_json_t *json;
+	double *results;
+	uint64_t start;
+
+	if (bench->setup && !bench->setup()) {
+		ni_error("%s: setup failed", bench->name);
+		if (bench->cleanup)
+			bench->cleanup();
+		return NULL;
+	}
+
+	/* warm up caches and allocator pools */
+	bench->run(iterations / 10 + 1);
+
+	results = xcalloc(repeats, sizeof(*results));
+	for (r = 0; r < repeats; ++r) {
+		start = bench_clock_ns();
+		ok = bench->run(iterations);
+		results[r] = (double)(bench_clock_ns() - start) / iterations;
+	}
+
+	if (bench->cleanup)
+		bench->cleanup();
+
+	if (ok != iterations) {
+		ni_error("%s: %u of %u iterations failed", bench->name,
+				iterations - ok, iterations);
+		free(results);
+		return NULL;
+	}
+
+	qsort(results, repeats, sizeof(results[0]), bench_ns_cmp);
+
+	json = ni_json_new_object();
+	ni_json_object_set(json, "name", ni_json_new_string(bench->name));
+	ni_json_object_set(json, "iterations", ni_json_new_int64(iterations));
+	ni_json_object_set(json, "repeats", ni_json_new_int64(repeats));
+	ni_json_object_set(json, "min_ns_per_op", bench_json_ns(results[0]));
+	ni_json_object_set(json, "median_ns_per_op", bench_json_ns(results[repeats / 2]));
+	ni_json_object_set(json, "max_ns_per_op", bench_json_ns(results[repeats - 1]));
+	free(results);
+	return json;
+}
+
+int
+main(int argc, char **argv)
+{
+	enum {
+		OPT_HELP, OPT_FILTER, OPT_SCALE, OPT_REPEATS, OPT_OUTPUT, OPT_LIST,
+	};
+	static struct option options[] = {
+		{ "help",	no_argument,		NULL,	OPT_HELP	},
+		{ "filter",	required_argument,	NULL,	OPT_FILTER	},
+		{ "scale",	required_argument,	NULL,	OPT_SCALE	},
+		{ "repeats",	required_argument,	NULL,	OPT_REPEATS	},
+		{ "output",	required_argument,	NULL,	OPT_OUTPUT	},
+		{ "list",	no_argument,		NULL,	OPT_LIST	},
+		{ NULL,		no_argument,		NULL,	0		}
+	};
+	ni_json_format_options_t format = NI_JSON_OPTIONS_INIT;
+	ni_string_array_t filter = NI_STRING_ARRAY_INIT;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned int scale = 1, repeats = BENCH_REPEATS;
+	const char *opt_output = NULL;
+	ni_json_t *report, *results, *result;
+	const bench_t *bench;
+	int c, status = 0;
+	FILE *out = stdout;
+
+	program_name = ni_basename(argv[0]);
+	while ((c = getopt_long(argc, argv, "", options, NULL)) != EOF) {
+		switch (c) {
+		case OPT_FILTER:
+			ni_string_split(&filter, optarg, ",", 0);
+			break;
+
+		case OPT_SCALE:
+			if (ni_parse_uint(optarg, &scale, 10) < 0 || !scale)
+				goto usage;
+			break;
+
+		case OPT_REPEATS:
+			if (ni_parse_uint(optarg, &repeats, 10) < 0 || !repeats)
+				goto usage;
+			break;
+
+		case OPT_OUTPUT:
+			opt_output = optarg;
+			break;
+
+		case OPT_LIST:
+			for (bench = bench_list; bench->name; ++bench)
+				printf("%s\n", bench->name);
+			return 0;
+
+		default:
+		usage:
+		case OPT_HELP:
+			fprintf(stderr,
+				"%s [options]\n"
+				"\n"
+				"Runs the libwicked microbenchmarks and reports the results as JSON.\n"
+				"\n"
+				"Supported options:\n"
+				"  --help\n"
+				"      Show this help text.\n"
+				"  --list\n"
+				"      List the benchmark names.\n"
+				"  --filter <name,...>\n"
+				"      Run the named benchmarks only.\n"
+				"  --scale <n>\n"
+				"      Multiply the iterations of each benchmark (default 1).\n"
+				"  --repeats <n>\n"
+				"      Number of timed runs of each benchmark (default %u).\n"
+				"  --output <filename>\n"
+				"      Write the results to the file instead of stdout.\n"
+				, program_name, BENCH_REPEATS);
+			ni_string_array_destroy(&filter);
+			return c == OPT_HELP ? 0 : 1;
+		}
+	}
+	if (optind < argc)
+		goto usage;
+
+	report = ni_json_new_object();
+	ni_json_object_set(report, "program", ni_json_new_string(program_name));
+	ni_json_object_set(report, "version", ni_json_new_string(PACKAGE_VERSION));
+	ni_json_object_set(report, "scale", ni_json_new_int64(scale));
+	results = ni_json_new_array();
+	ni_json_object_set(report, "benchmarks", results);
+
+	for (bench = bench_list; bench->name; ++bench) {
+		if (filter.count && ni_string_array_index(&filter, bench->name) < 0)
+			continue;
+
+		if ((result = bench_run(bench, scale, repeats)))
+			ni_json_array_append(results, result);
+		else
+			status = 1;
+	}
+
+	if (opt_output && !(out = fopen(opt_output, "w"))) {
+		ni_error("cannot open %s: %m", opt_output);
+		status = 1;
+	} else {
+		fprintf(out, "%s\n", ni_json_format_string(&buf, report, &format));
+		if (out != stdout)
+			fclose(out);
+	}
+
+	ni_stringbuf_destroy(&buf);
+	ni_json_free(report);
+	ni_string_array_destroy(&filter);
+	return status;
+}